@@ -0,0 +1,480 @@
+//
+// MrsWatsonBenchMain.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "audio/AudioSettings.h"
+#include "audio/PcmSampleBuffer.h"
+#include "audio/SampleBuffer.h"
+#include "base/CharString.h"
+#include "base/RingBuffer.h"
+#include "io/SampleSource.h"
+#include "logging/EventLogger.h"
+#include "midi/MidiEvent.h"
+#include "midi/MidiSequence.h"
+#include "plugin/PluginChain.h"
+#include "plugin/PluginGain.h"
+#include "plugin/PluginLimiter.h"
+#include "plugin/PluginPassthru.h"
+#include "time/AudioClock.h"
+#include "time/TaskTimer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Each case runs for at least this long, so that timer resolution and startup
+// effects do not dominate the result
+static const double kBenchMinTimeInMs = 100.0;
+// Blocks run before timing starts, to warm up caches and lazy initialization
+static const int kBenchWarmupBlocks = 16;
+// How many blocks to process between checks of the timer
+static const int kBenchBlocksPerCheck = 32;
+// Number of blocks in the files used by the WAVE benchmarks. The write
+// benchmark starts a new file after this many blocks, so that it does not fill
+// up the disk.
+static const int kBenchFileBlocks = 256;
+// One MIDI event every this many frames, which is a dense but realistic
+// stream of notes
+static const unsigned long kBenchMidiEventSpacing = 32;
+static const char *kBenchWaveFilename = "mrswatsonbench.wav";
+
+static const SampleCount kBenchBlocksizes[] = {64, 256, 1024, 4096};
+static const ChannelCount kBenchChannelCounts[] = {1, 2, 8};
+static const BitDepth kBenchBitDepths[] = {kBitDepth8Bit, kBitDepth16Bit,
+                                           kBitDepth24Bit, kBitDepth32Bit};
+
+typedef struct {
+  ChannelCount numChannels;
+  SampleCount blocksize;
+  BitDepth bitDepth;
+  const char *pluginName;
+
+  SampleBuffer inBuffer;
+  SampleBuffer outBuffer;
+  PcmSampleBuffer pcmSampleBuffer;
+  PluginChain pluginChain;
+  MidiSequence midiSequence;
+  RingBuffer ringBuffer;
+  unsigned long midiTimestamp;
+  SampleSource sampleSource;
+  int fileBlocks;
+} BenchContextMembers;
+typedef BenchContextMembers *BenchContext;
+
+typedef boolByte (*BenchSetupFunc)(BenchContext context);
+typedef void (*BenchRunFunc)(BenchContext context);
+typedef void (*BenchTeardownFunc)(BenchContext context);
+
+typedef enum {
+  // Run once for each channel count, blocksize, and bit depth
+  kBenchMatrixFull,
+  // Run once for each channel count and blocksize, with float samples
+  kBenchMatrixChannels,
+  // Run once for each blocksize, since channels are irrelevant
+  kBenchMatrixBlocksize
+} BenchMatrix;
+
+typedef struct {
+  const char *name;
+  BenchMatrix matrix;
+  const char *pluginName;
+  BenchSetupFunc setup;
+  BenchRunFunc run;
+  BenchTeardownFunc teardown;
+} BenchDefinition;
+
+static void _fillTestSignal(SampleBuffer sampleBuffer) {
+  for (ChannelCount channel = 0; channel < sampleBuffer->numChannels;
+       ++channel) {
+    for (SampleCount frame = 0; frame < sampleBuffer->blocksize; ++frame) {
+      sampleBuffer->samples[channel][frame] =
+          (Sample)((frame * 31 + channel * 7) % 200) / 100.0f - 1.0f;
+    }
+  }
+}
+
+static boolByte _setupBuffers(BenchContext context) {
+  context->inBuffer = newSampleBuffer(context->numChannels, context->blocksize);
+  context->outBuffer =
+      newSampleBuffer(context->numChannels, context->blocksize);
+  _fillTestSignal(context->inBuffer);
+  return true;
+}
+
+static boolByte _setupPcmSampleBuffer(BenchContext context) {
+  _setupBuffers(context);
+  context->pcmSampleBuffer = newPcmSampleBuffer(
+      context->numChannels, context->blocksize, context->bitDepth);
+  // Fill the PCM data with valid samples for the read benchmark
+  context->pcmSampleBuffer->setSampleBuffer(context->pcmSampleBuffer,
+                                            context->inBuffer);
+  return true;
+}
+
+static void _runFloatToPcm(BenchContext context) {
+  context->pcmSampleBuffer->setSampleBuffer(context->pcmSampleBuffer,
+                                            context->inBuffer);
+}
+
+static void _runPcmToFloat(BenchContext context) {
+  context->pcmSampleBuffer->setSamples(context->pcmSampleBuffer);
+}
+
+static void _runCopyAndMapChannels(BenchContext context) {
+  sampleBufferCopyAndMapChannels(context->outBuffer, context->inBuffer);
+}
+
+static boolByte _setupPluginChain(BenchContext context) {
+  CharString pluginName = newCharStringWithCString(context->pluginName);
+  CharString pluginRoot = newCharString();
+  boolByte result;
+
+  _setupBuffers(context);
+  initPluginChain();
+  context->pluginChain = getPluginChain();
+  result = pluginChainAddFromArgumentString(context->pluginChain, pluginName,
+                                            pluginRoot) &&
+           pluginChainInitialize(context->pluginChain) == RETURN_CODE_SUCCESS;
+
+  if (result) {
+    pluginChainPrepareForProcessing(context->pluginChain);
+  }
+
+  freeCharString(pluginName);
+  freeCharString(pluginRoot);
+  return result;
+}
+
+static void _runPluginChain(BenchContext context) {
+  pluginChainProcessAudio(context->pluginChain, context->inBuffer,
+                          context->outBuffer);
+  advanceAudioClock(getAudioClock(), context->blocksize);
+}
+
+static boolByte _setupMidiSequence(BenchContext context) {
+  const unsigned long numEvents =
+      (unsigned long)(kBenchFileBlocks * context->blocksize) /
+      kBenchMidiEventSpacing;
+
+  context->midiSequence = newMidiSequence();
+
+  for (unsigned long i = 0; i < numEvents; ++i) {
+    MidiEvent midiEvent = newMidiEvent();
+    midiEvent->eventType = MIDI_TYPE_REGULAR;
+    midiEvent->timestamp = i * kBenchMidiEventSpacing;
+    midiEvent->status = (byte)(i % 2 == 0 ? 0x90 : 0x80);
+    midiEvent->data1 = (byte)(60 + (i / 2) % 12);
+    midiEvent->data2 = 100;
+    appendMidiEventToSequence(context->midiSequence, midiEvent);
+  }
+
+  context->midiTimestamp = 0;
+  return true;
+}
+
+static void _runFillMidiEvents(BenchContext context) {
+  LinkedList midiEvents = newLinkedList();
+
+  if (!fillMidiEventsFromRange(context->midiSequence, context->midiTimestamp,
+                               context->blocksize, midiEvents)) {
+    midiSequenceSeek(context->midiSequence, 0);
+    context->midiTimestamp = 0;
+  } else {
+    context->midiTimestamp += context->blocksize;
+  }
+
+  freeLinkedList(midiEvents);
+}
+
+static SampleSource _openWaveFile(const SampleSourceOpenAs openAs) {
+  CharString filename = newCharStringWithCString(kBenchWaveFilename);
+  SampleSource sampleSource = sampleSourceFactory(filename);
+  freeCharString(filename);
+
+  if (!sampleSource->openSampleSource(sampleSource, openAs)) {
+    freeSampleSource(sampleSource);
+    return NULL;
+  }
+
+  return sampleSource;
+}
+
+static void _closeWaveFile(BenchContext context) {
+  if (context->sampleSource != NULL) {
+    context->sampleSource->closeSampleSource(context->sampleSource);
+    freeSampleSource(context->sampleSource);
+    context->sampleSource = NULL;
+  }
+}
+
+static boolByte _setupWaveWrite(BenchContext context) {
+  _setupBuffers(context);
+  context->sampleSource = _openWaveFile(SAMPLE_SOURCE_OPEN_WRITE);
+  context->fileBlocks = 0;
+  return (boolByte)(context->sampleSource != NULL);
+}
+
+static void _runWaveWrite(BenchContext context) {
+  if (context->fileBlocks == kBenchFileBlocks) {
+    _closeWaveFile(context);
+    context->sampleSource = _openWaveFile(SAMPLE_SOURCE_OPEN_WRITE);
+    context->fileBlocks = 0;
+  }
+
+  context->sampleSource->writeSampleBlock(context->sampleSource,
+                                          context->inBuffer);
+  context->fileBlocks++;
+}
+
+static boolByte _setupWaveRead(BenchContext context) {
+  if (!_setupWaveWrite(context)) {
+    return false;
+  }
+
+  for (int i = 0; i < kBenchFileBlocks; ++i) {
+    _runWaveWrite(context);
+  }
+
+  _closeWaveFile(context);
+  context->sampleSource = _openWaveFile(SAMPLE_SOURCE_OPEN_READ);
+  return (boolByte)(context->sampleSource != NULL);
+}
+
+static void _runWaveRead(BenchContext context) {
+  if (!context->sampleSource->readSampleBlock(context->sampleSource,
+                                              context->outBuffer)) {
+    _closeWaveFile(context);
+    context->sampleSource = _openWaveFile(SAMPLE_SOURCE_OPEN_READ);
+    context->outBuffer->blocksize = context->blocksize;
+  }
+}
+
+// The ring buffer benchmarks pass blocks of mono samples through the ring on
+// a single thread, which measures the overhead of pushing and popping without
+// contention between threads
+static boolByte _setupRingBuffer(BenchContext context) {
+  _setupBuffers(context);
+  context->ringBuffer =
+      newRingBuffer(sizeof(Sample) * (size_t)context->blocksize, 4);
+  return true;
+}
+
+static boolByte _setupRingBufferMultiProducer(BenchContext context) {
+  _setupBuffers(context);
+  context->ringBuffer = newRingBufferMultiProducer(
+      sizeof(Sample) * (size_t)context->blocksize, 4);
+  return true;
+}
+
+static void _runRingBuffer(BenchContext context) {
+  ringBufferPush(context->ringBuffer, context->inBuffer->samples[0]);
+  ringBufferPop(context->ringBuffer, context->outBuffer->samples[0]);
+}
+
+static void _teardown(BenchContext context) {
+  _closeWaveFile(context);
+  remove(kBenchWaveFilename);
+
+  if (context->pluginChain != NULL) {
+    pluginChainShutdown(context->pluginChain);
+    freePluginChain(context->pluginChain);
+  }
+
+  freeMidiSequence(context->midiSequence);
+  freeRingBuffer(context->ringBuffer);
+  freePcmSampleBuffer(context->pcmSampleBuffer);
+  freeSampleBuffer(context->inBuffer);
+  freeSampleBuffer(context->outBuffer);
+}
+
+static void _runBenchmark(const BenchDefinition *definition,
+                          ChannelCount numChannels, SampleCount blocksize,
+                          BitDepth bitDepth) {
+  BenchContextMembers context;
+  TaskTimer timer = newTaskTimerWithCString("Bench", definition->name);
+  unsigned long numBlocks = 0;
+  double elapsedTimeInMs;
+  double framesPerSecond;
+  char channelsColumn[16] = "";
+  char bitDepthColumn[16] = "";
+
+  memset(&context, 0, sizeof(context));
+  context.numChannels = numChannels;
+  context.blocksize = blocksize;
+  context.bitDepth = bitDepth;
+  context.pluginName = definition->pluginName;
+
+  // Sources and plugins size their buffers from the global settings
+  setNumChannels(numChannels);
+  setBlocksize(blocksize);
+  setBitDepth(bitDepth);
+
+  if (!definition->setup(&context)) {
+    fprintf(stderr, "Could not set up benchmark %s\n", definition->name);
+    definition->teardown(&context);
+    freeTaskTimer(timer);
+    return;
+  }
+
+  for (int i = 0; i < kBenchWarmupBlocks; ++i) {
+    definition->run(&context);
+  }
+
+  while (timer->totalTaskTime < kBenchMinTimeInMs) {
+    taskTimerStart(timer);
+
+    for (int i = 0; i < kBenchBlocksPerCheck; ++i) {
+      definition->run(&context);
+    }
+
+    taskTimerStop(timer);
+    numBlocks += kBenchBlocksPerCheck;
+  }
+
+  elapsedTimeInMs = timer->totalTaskTime;
+  framesPerSecond = (double)(numBlocks * blocksize) * 1000.0 / elapsedTimeInMs;
+
+  // Columns which do not apply to a benchmark are left empty
+  if (definition->matrix != kBenchMatrixBlocksize) {
+    snprintf(channelsColumn, sizeof(channelsColumn), "%d", numChannels);
+  }
+
+  if (definition->matrix == kBenchMatrixFull) {
+    snprintf(bitDepthColumn, sizeof(bitDepthColumn), "%d", bitDepth);
+  }
+
+  printf("%s,%s,%lu,%s,%lu,%.6f,%.0f\n", definition->name, channelsColumn,
+         (unsigned long)blocksize, bitDepthColumn, numBlocks * blocksize,
+         elapsedTimeInMs / 1000.0, framesPerSecond);
+  fflush(stdout);
+  definition->teardown(&context);
+  freeTaskTimer(timer);
+}
+
+static void _runBenchmarkMatrix(const BenchDefinition *definition) {
+  const size_t numBlocksizes =
+      sizeof(kBenchBlocksizes) / sizeof(kBenchBlocksizes[0]);
+  const size_t numChannelCounts =
+      definition->matrix == kBenchMatrixBlocksize
+          ? 1
+          : sizeof(kBenchChannelCounts) / sizeof(kBenchChannelCounts[0]);
+  const size_t numBitDepths =
+      definition->matrix == kBenchMatrixFull
+          ? sizeof(kBenchBitDepths) / sizeof(kBenchBitDepths[0])
+          : 1;
+
+  for (size_t b = 0; b < numBitDepths; ++b) {
+    for (size_t c = 0; c < numChannelCounts; ++c) {
+      for (size_t s = 0; s < numBlocksizes; ++s) {
+        _runBenchmark(definition, kBenchChannelCounts[c], kBenchBlocksizes[s],
+                      definition->matrix == kBenchMatrixFull
+                          ? kBenchBitDepths[b]
+                          : kBitDepth16Bit);
+      }
+    }
+  }
+}
+
+static void _printUsage(const char *programName) {
+  printf("Usage: %s [--list] [benchmark...]\n\n", programName);
+  printf("Runs all benchmarks, or only the named ones, and prints the results "
+         "as CSV.\n");
+}
+
+int main(int argc, char *argv[]) {
+  const BenchDefinition definitions[] = {
+      {"pcm_float_to_pcm", kBenchMatrixFull, NULL, _setupPcmSampleBuffer,
+       _runFloatToPcm, _teardown},
+      {"pcm_pcm_to_float", kBenchMatrixFull, NULL, _setupPcmSampleBuffer,
+       _runPcmToFloat, _teardown},
+      {"sample_buffer_copy", kBenchMatrixChannels, NULL, _setupBuffers,
+       _runCopyAndMapChannels, _teardown},
+      {"plugin_chain_gain", kBenchMatrixChannels, kInternalPluginGainName,
+       _setupPluginChain, _runPluginChain, _teardown},
+      {"plugin_chain_limiter", kBenchMatrixChannels,
+       kInternalPluginLimiterName, _setupPluginChain, _runPluginChain,
+       _teardown},
+      {"plugin_chain_passthru", kBenchMatrixChannels,
+       kInternalPluginPassthruName, _setupPluginChain, _runPluginChain,
+       _teardown},
+      {"midi_fill_events", kBenchMatrixBlocksize, NULL, _setupMidiSequence,
+       _runFillMidiEvents, _teardown},
+      {"ring_buffer_spsc", kBenchMatrixBlocksize, NULL, _setupRingBuffer,
+       _runRingBuffer, _teardown},
+      {"ring_buffer_mpsc", kBenchMatrixBlocksize, NULL,
+       _setupRingBufferMultiProducer, _runRingBuffer, _teardown},
+      {"wave_write", kBenchMatrixChannels, NULL, _setupWaveWrite, _runWaveWrite,
+       _teardown},
+      {"wave_read", kBenchMatrixChannels, NULL, _setupWaveRead, _runWaveRead,
+       _teardown},
+  };
+  const size_t numDefinitions = sizeof(definitions) / sizeof(definitions[0]);
+  int numSelected = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h")) {
+      _printUsage(argv[0]);
+      return 0;
+    } else if (!strcmp(argv[i], "--list")) {
+      for (size_t d = 0; d < numDefinitions; ++d) {
+        printf("%s\n", definitions[d].name);
+      }
+
+      return 0;
+    }
+  }
+
+  initEventLogger();
+  setLogLevel(LOG_ERROR);
+  initAudioSettings();
+  initAudioClock();
+
+  printf("benchmark,channels,blocksize,bitdepth,frames,seconds,"
+         "frames_per_second\n");
+
+  for (size_t d = 0; d < numDefinitions; ++d) {
+    boolByte selected = (boolByte)(argc < 2);
+
+    for (int i = 1; i < argc; ++i) {
+      if (!strcmp(argv[i], definitions[d].name)) {
+        selected = true;
+      }
+    }
+
+    if (selected) {
+      _runBenchmarkMatrix(&definitions[d]);
+      numSelected++;
+    }
+  }
+
+  if (numSelected == 0) {
+    fprintf(stderr, "No benchmarks matched, run with --list to see them\n");
+  }
+
+  freeAudioClock(getAudioClock());
+  freeAudioSettings();
+  freeEventLogger();
+  return numSelected > 0 ? 0 : 1;
+}
@@ -10,7 +10,7 @@ function(configure_target target wordsize)
       set_target_properties(${target} PROPERTIES COMPILE_FLAGS "-m64")
       set_target_properties(${target} PROPERTIES LINK_FLAGS "-m64")
     endif()
-    target_link_libraries(${target} dl)
+    target_link_libraries(${target} dl pthread rt)
 
     if(WITH_GUI)
       target_link_libraries(${target} x11)
@@ -29,7 +29,17 @@ function(configure_target target wordsize)
     else()
       set_target_properties(${target} PROPERTIES COMPILE_FLAGS "/DWIN64=1")
     endif()
+    target_link_libraries(${target} avrt psapi ws2_32)
   endif()
 
   target_compile_definitions(${target} PUBLIC PLATFORM_BITS=${wordsize})
 endfunction()
+
+# Compile a target for a specific CPU, see WITH_MARCH_VARIANTS
+function(configure_target_march target march)
+  if(MSVC)
+    target_compile_options(${target} PRIVATE "/arch:${march}")
+  else()
+    target_compile_options(${target} PRIVATE "-march=${march}")
+  endif()
+endfunction()
@@ -0,0 +1,57 @@
+cmake_minimum_required(VERSION 3.0)
+
+# Runs the binaries of a WITH_PGO=GENERATE build to record a profile. This
+# script is run by the pgo_train target, which passes the paths below.
+#
+#   MRSWATSON, MRSWATSON_BENCH, MRSWATSON_TEST: Instrumented executables
+#   RESOURCES_DIR: Location of the AudioTestData repository
+#   PROFILE_DIR: Where the profile is written to
+#   COMPILER_ID: CMAKE_C_COMPILER_ID of the build
+#   LLVM_PROFDATA: Location of llvm-profdata, only needed for Clang
+
+# Profiles accumulate over runs, so a stale profile from an older build would
+# skew the results or fail the optimized build with a coverage mismatch
+file(REMOVE_RECURSE ${PROFILE_DIR})
+file(MAKE_DIRECTORY ${PROFILE_DIR})
+
+# Training only has to exercise the hot paths, so failures are reported but
+# don't stop the remaining runs
+function(run_training name)
+  message(STATUS "PGO training: ${name}")
+  execute_process(COMMAND ${ARGN} RESULT_VARIABLE result OUTPUT_QUIET)
+
+  if(NOT result EQUAL 0)
+    message(WARNING "PGO training run '${name}' exited with ${result}")
+  endif()
+endfunction()
+
+run_training("benchmarks" ${MRSWATSON_BENCH})
+run_training("unit benchmarks" ${MRSWATSON_TEST} --benchmark
+  --benchmark-output ${PROFILE_DIR}/benchmarks.json)
+
+if(EXISTS ${RESOURCES_DIR})
+  run_training("integration tests" ${MRSWATSON_TEST} --quiet
+    --mrswatson-path ${MRSWATSON} --resources ${RESOURCES_DIR})
+else()
+  message(WARNING "${RESOURCES_DIR} not found, the main executable is only "
+    "trained by the benchmarks. Run 'git submodule update --init' first.")
+endif()
+
+if(COMPILER_ID MATCHES Clang)
+  if(NOT LLVM_PROFDATA)
+    message(FATAL_ERROR "llvm-profdata is required to merge Clang profiles")
+  endif()
+
+  file(GLOB raw_profiles ${PROFILE_DIR}/*.profraw)
+  execute_process(
+    COMMAND ${LLVM_PROFDATA} merge -output=${PROFILE_DIR}/default.profdata
+      ${raw_profiles}
+    RESULT_VARIABLE result
+  )
+
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Merging profiles failed")
+  endif()
+endif()
+
+message(STATUS "PGO profile written to ${PROFILE_DIR}")
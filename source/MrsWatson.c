@@ -28,32 +28,479 @@
 #include "MrsWatsonOptions.h"
 
 #include "app/BuildInfo.h"
+#include "app/ControlServer.h"
+#include "app/LiveMetrics.h"
+#include "app/OutputHashes.h"
+#include "app/RealtimeAudit.h"
+#include "app/SamplingProfiler.h"
+#include "app/RenderCache.h"
+#include "app/RenderCheckpoint.h"
+#include "app/RenderContext.h"
+#include "app/RenderManifest.h"
+#include "app/RenderRequest.h"
+#include "app/RenderSegment.h"
+#include "audio/AudioAnalysis.h"
 #include "audio/AudioSettings.h"
+#include "audio/LoudnessMeter.h"
+#include "audio/Resampler.h"
+#include "base/File.h"
+#include "base/MemoryLock.h"
+#include "base/MemoryUsage.h"
 #include "base/PlatformInfo.h"
+#include "base/Process.h"
+#include "base/Socket.h"
+#include "base/Thread.h"
 #include "io/SampleSource.h"
+#include "io/SampleSourceAnalyzer.h"
+#include "io/SampleSourceAsync.h"
+#include "io/SampleSourceCached.h"
+#include "io/SampleSourceFlac.h"
+#include "io/SampleSourceHasher.h"
+#include "io/SampleSourceMemory.h"
+#include "io/SampleSourcePacked.h"
 #include "io/SampleSourcePcm.h"
+#include "io/SampleSourceResampler.h"
+#include "io/SampleSourceSegment.h"
 #include "logging/EventLogger.h"
 #include "logging/LogPrinter.h"
 #include "midi/MidiSequence.h"
 #include "midi/MidiSource.h"
+#include "plugin/PluginAutomation.h"
 #include "plugin/PluginChain.h"
+#include "plugin/PluginChainPool.h"
+#include "plugin/PluginIdler.h"
+#include "plugin/PluginIsolated.h"
+#include "plugin/PluginPresetCache.h"
+#include "plugin/PluginVst2x.h"
+#include "plugin/PluginWatchdog.h"
 #include "time/AudioClock.h"
+#include "time/StreamScheduler.h"
+#include "time/TraceEvents.h"
 
+#include <limits.h>
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+// Plugins which take longer than this to load while scanning are assumed to
+// be hanging, and are killed
+static const double kMrsWatsonPluginScanTimeoutInMs = 30000.0;
+// Number of plugin chains which are kept open in server mode
+static const unsigned int kMrsWatsonServerMaxPluginChains = 4;
+// How often the server checks whether its worker processes have exited
+static const double kMrsWatsonServerWorkerPollIntervalInMs = 100.0;
+// Length of a job's output before the end of its input has been reached
+static const unsigned long kMrsWatsonOutputLengthUnknown = ULONG_MAX;
+// Number of blocks buffered for pipes on stdin or stdout and for network
+// streams when --prefetch or --write-behind was not given
+static const unsigned int kMrsWatsonPipeBufferBlocks = 4;
+// Number of blocks which MP3 and Ogg inputs are decoded ahead of processing
+// when --prefetch was not given
+static const unsigned int kMrsWatsonDecodeAheadBlocks = 8;
+// Number of blocks which are queued for conversion in a background thread when
+// writing a file and --write-behind was not given
+static const unsigned int kMrsWatsonConvertBehindBlocks = 4;
+// Number of changes from a plugin editor which may wait for the next block
+static const unsigned int kMrsWatsonEditorMaxPendingChanges = 256;
+// Longest tail which is processed with --stop-on-silence when the output never
+// becomes silent
+static const double kMrsWatsonMaxSilenceTailInMs = 60000.0;
+// Smallest blocksize which is tried with --auto-blocksize
+static const SampleCount kMrsWatsonAutoBlocksizeMinimum = 64;
+// Length of audio processed at each blocksize which is tried, and the number
+// of times that all of them are tried, keeping the fastest time of each
+static const double kMrsWatsonAutoBlocksizeBenchmarkInMs = 250.0;
+static const unsigned int kMrsWatsonAutoBlocksizeRounds = 2;
+
 static void _printTaskTime(void *item, void *userData) {
   TaskTimer taskTimer = (TaskTimer)item;
   TaskTimer totalTimer = (TaskTimer)userData;
   CharString prettyTimeString = taskTimerHumanReadbleString(taskTimer);
   double timePercentage =
       100.0f * taskTimer->totalTaskTime / totalTimer->totalTaskTime;
-  logInfo("  %s %s: %s (%2.1f%%)", taskTimer->component->data,
-          taskTimer->subcomponent->data, prettyTimeString->data,
-          timePercentage);
+
+  if (taskTimer->numTasks > 1) {
+    // Single runs are usually well under a millisecond, so the minimum and
+    // maximum are shown in microseconds
+    logInfo("  %s %s: %s (%2.1f%%), %lu runs, min %.1fus, max %.1fus",
+            taskTimer->component->data, taskTimer->subcomponent->data,
+            prettyTimeString->data, timePercentage, taskTimer->numTasks,
+            taskTimer->minTaskTime * 1000.0, taskTimer->maxTaskTime * 1000.0);
+  } else {
+    logInfo("  %s %s: %s (%2.1f%%)", taskTimer->component->data,
+            taskTimer->subcomponent->data, prettyTimeString->data,
+            timePercentage);
+  }
+
   freeCharString(prettyTimeString);
 }
 
+static void _printLatency(const char *name, const LatencyHistogram latency) {
+  logInfo("  %s: p50 %.3fms, p99 %.3fms, p99.9 %.3fms, max %.3fms (block %lu), "
+          "%lu deadline misses",
+          name, latencyHistogramGetPercentile(latency, 50.0),
+          latencyHistogramGetPercentile(latency, 99.0),
+          latencyHistogramGetPercentile(latency, 99.9), latency->maxValue,
+          latency->maxValueIndex, latency->numDeadlineMisses);
+}
+
+static void _printLatencyReport(const PluginChain pluginChain) {
+  unsigned int i;
+
+  if (pluginChain->chainLatency->numValues == 0) {
+    return;
+  }
+
+  logInfo("Block processing latency (%.3fms deadline):",
+          getBlocksize() * 1000.0 / getSampleRate());
+  _printLatency("Plugin chain", pluginChain->chainLatency);
+
+  for (i = 0; i < pluginChain->numPlugins; i++) {
+    _printLatency(pluginChain->plugins[i]->pluginName->data,
+                  pluginChain->audioLatencies[i]);
+  }
+}
+
+static double _getChainAudioTime(const PluginChain pluginChain) {
+  double result = 0.0;
+  unsigned int i;
+
+  for (i = 0; i < pluginChain->numPlugins; i++) {
+    result += pluginChain->audioTimers[i]->totalTaskTime;
+  }
+
+  return result;
+}
+
+/**
+ * Print how fast each plugin processed audio compared to real time, and where
+ * that time went. CPU time lower than the wall time means that the plugin was
+ * blocked or preempted, and time in host callbacks is not spent on DSP.
+ */
+static void _printPluginCpuReport(const PluginChain pluginChain,
+                                  const unsigned long framesProcessed) {
+  const double audioTimeInMs = framesProcessed * 1000.0 / getSampleRate();
+  const double chainTimeInMs = _getChainAudioTime(pluginChain);
+  TaskTimer timer;
+  PerfCounters counters;
+  unsigned int i;
+
+  if (chainTimeInMs <= 0.0) {
+    return;
+  }
+
+  logInfo("Plugin CPU usage (%.1fms process CPU time):",
+          platformInfoGetProcessCpuTime());
+
+  for (i = 0; i < pluginChain->numPlugins; i++) {
+    timer = pluginChain->audioTimers[i];
+
+    if (timer->totalTaskTime <= 0.0) {
+      continue;
+    }
+
+    logInfo("  %s: %.1fx realtime, %.1f%% of chain time, %.1f%% on CPU, "
+            "%.1f%% in host callbacks",
+            pluginChain->plugins[i]->pluginName->data,
+            audioTimeInMs / timer->totalTaskTime,
+            100.0 * timer->totalTaskTime / chainTimeInMs,
+            100.0 * timer->totalCpuTime / timer->totalTaskTime,
+            100.0 * pluginChain->hostCallbackTimes[i] / timer->totalTaskTime);
+    counters = pluginChain->perfCounters[i];
+
+    if (counters->numTasks > 0) {
+      logInfo("    %.0f cycles per block, %.2f instructions per cycle, "
+              "%.2f LLC misses and %.2f branch misses per 1000 instructions",
+              (double)counters->counts[PERF_COUNTER_CYCLES] /
+                  counters->numTasks,
+              perfCountersGetInstructionsPerCycle(counters),
+              perfCountersGetPerThousandInstructions(counters,
+                                                     PERF_COUNTER_CACHE_MISSES),
+              perfCountersGetPerThousandInstructions(
+                  counters, PERF_COUNTER_BRANCH_MISSES));
+    }
+  }
+}
+
+static void _writeJsonString(FILE *file, const char *string) {
+  const char *c;
+
+  fputc('"', file);
+  for (c = string; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      fprintf(file, "\\%c", *c);
+    } else if ((unsigned char)*c < 0x20) {
+      fprintf(file, "\\u%04x", (unsigned char)*c);
+    } else {
+      fputc(*c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+static void _writeLatencyJson(FILE *file, const LatencyHistogram latency) {
+  fprintf(file,
+          "{\"blocks\": %lu, \"p50_ms\": %f, \"p99_ms\": %f, "
+          "\"p99_9_ms\": %f, \"max_ms\": %f, \"max_block\": %lu, "
+          "\"deadline_misses\": %lu}",
+          latency->numValues, latencyHistogramGetPercentile(latency, 50.0),
+          latencyHistogramGetPercentile(latency, 99.0),
+          latencyHistogramGetPercentile(latency, 99.9), latency->maxValue,
+          latency->maxValueIndex, latency->numDeadlineMisses);
+}
+
+static void _writeLatencyReportObject(FILE *file,
+                                      const PluginChain pluginChain,
+                                      const char *indent) {
+  unsigned int i;
+
+  fprintf(file, "{\n%s  \"deadline_ms\": %f,\n%s  \"chain\": ", indent,
+          getBlocksize() * 1000.0 / getSampleRate(), indent);
+  _writeLatencyJson(file, pluginChain->chainLatency);
+  fprintf(file, ",\n%s  \"plugins\": [", indent);
+
+  for (i = 0; i < pluginChain->numPlugins; i++) {
+    fprintf(file, "%s\n%s    {\"name\": ", i > 0 ? "," : "", indent);
+    _writeJsonString(file, pluginChain->plugins[i]->pluginName->data);
+    fprintf(file, ", \"latency\": ");
+    _writeLatencyJson(file, pluginChain->audioLatencies[i]);
+    fprintf(file, "}");
+  }
+
+  fprintf(file, "\n%s  ]\n%s}", indent, indent);
+}
+
+static void _writeLatencyReport(const PluginChain pluginChain,
+                                const CharString filename) {
+  FILE *file = fopen(filename->data, "w");
+
+  if (file == NULL) {
+    logError("Could not open '%s' to write latency report", filename->data);
+    return;
+  }
+
+  _writeLatencyReportObject(file, pluginChain, "");
+  fprintf(file, "\n");
+  fclose(file);
+  logInfo("Wrote latency report to '%s'", filename->data);
+}
+
+// Levels of silence are infinitely low, which JSON has no number for
+static void _writeJsonLevel(FILE *file, double level) {
+  if (level > -HUGE_VAL) {
+    fprintf(file, "%f", level);
+  } else {
+    fprintf(file, "null");
+  }
+}
+
+static void _writeAnalysisReport(const AudioAnalysis analysis,
+                                 const LoudnessMeter meter,
+                                 const CharString filename) {
+  FILE *file = fopen(filename->data, "w");
+  AudioAnalysisChannel channel;
+  ChannelCount i;
+
+  if (file == NULL) {
+    logError("Could not open '%s' to write analysis report", filename->data);
+    return;
+  }
+
+  fprintf(file, "{\n  \"frames\": %lu,\n  \"integrated_lufs\": ",
+          analysis->numFrames);
+  _writeJsonLevel(file, loudnessMeterGetIntegrated(meter));
+  fprintf(file, ",\n  \"loudness_range_lu\": %f,\n  \"channels\": [",
+          loudnessMeterGetRange(meter));
+
+  for (i = 0; i < analysis->numChannels; i++) {
+    channel = &(analysis->channels[i]);
+    fprintf(file,
+            "%s\n    {\"peak\": %f, \"clipped_samples\": %lu, "
+            "\"longest_clip_frames\": %lu, \"longest_clip_start\": %lu, "
+            "\"discontinuities\": %lu, \"first_discontinuity\": ",
+            i > 0 ? "," : "", channel->peak, channel->clippedSamples,
+            channel->longestClip, channel->longestClipStart,
+            channel->discontinuities);
+
+    if (channel->discontinuities > 0) {
+      fprintf(file, "%lu", channel->firstDiscontinuity);
+    } else {
+      fprintf(file, "null");
+    }
+
+    fprintf(file,
+            ", \"largest_jump\": %f, \"longest_silence_frames\": %lu, "
+            "\"longest_silence_start\": %lu, \"true_peak_dbtp\": ",
+            channel->largestJump, channel->longestSilence,
+            channel->longestSilenceStart);
+    _writeJsonLevel(file, loudnessMeterGetTruePeak(meter, i));
+    fprintf(file, "}");
+  }
+
+  fprintf(file, "\n  ]\n}\n");
+  fclose(file);
+  logInfo("Wrote analysis report to '%s'", filename->data);
+}
+
+typedef struct {
+  FILE *file;
+  boolByte first;
+} _PerfReportTimerData;
+
+static void _writeTaskTimerJson(void *item, void *userData) {
+  TaskTimer taskTimer = (TaskTimer)item;
+  _PerfReportTimerData *data = (_PerfReportTimerData *)userData;
+
+  fprintf(data->file, "%s\n    {\"component\": ", data->first ? "" : ",");
+  _writeJsonString(data->file, taskTimer->component->data);
+  fprintf(data->file, ", \"subcomponent\": ");
+  _writeJsonString(data->file, taskTimer->subcomponent->data);
+  fprintf(data->file,
+          ", \"total_ms\": %f, \"runs\": %lu, \"min_ms\": %f, "
+          "\"max_ms\": %f}",
+          taskTimer->totalTaskTime, taskTimer->numTasks, taskTimer->minTaskTime,
+          taskTimer->maxTaskTime);
+  data->first = false;
+}
+
+// Counters are null when they were not measured, or the CPU can't count them
+static void _writePerfCountersJson(FILE *file, const PerfCounters counters) {
+  int i;
+
+  if (counters->numTasks == 0) {
+    fprintf(file, "null");
+    return;
+  }
+
+  fprintf(file, "{");
+  for (i = 0; i < kPerfCounterNumTypes; i++) {
+    fprintf(file, "\"%s\": ", perfCounterTypeGetName((PerfCounterType)i));
+    if (counters->supported[i]) {
+      fprintf(file, "%llu, ", (unsigned long long)counters->counts[i]);
+    } else {
+      fprintf(file, "null, ");
+    }
+  }
+  fprintf(file, "\"instructions_per_cycle\": %f}",
+          perfCountersGetInstructionsPerCycle(counters));
+}
+
+static void _writePluginCpuReport(FILE *file, const PluginChain pluginChain,
+                                  const double audioTimeInMs) {
+  const double chainTimeInMs = _getChainAudioTime(pluginChain);
+  TaskTimer timer;
+  unsigned int i;
+
+  fprintf(file, "[");
+
+  for (i = 0; i < pluginChain->numPlugins; i++) {
+    timer = pluginChain->audioTimers[i];
+    fprintf(file, "%s\n    {\"name\": ", i > 0 ? "," : "");
+    _writeJsonString(file, pluginChain->plugins[i]->pluginName->data);
+    fprintf(file,
+            ", \"wall_ms\": %f, \"cpu_ms\": %f, \"host_callback_ms\": %f, "
+            "\"dsp_ms\": %f, \"chain_share\": %f, \"realtime_factor\": %f, "
+            "\"perf_counters\": ",
+            timer->totalTaskTime, timer->totalCpuTime,
+            pluginChain->hostCallbackTimes[i],
+            timer->totalTaskTime - pluginChain->hostCallbackTimes[i],
+            chainTimeInMs > 0.0 ? timer->totalTaskTime / chainTimeInMs : 0.0,
+            timer->totalTaskTime > 0.0 ? audioTimeInMs / timer->totalTaskTime
+                                       : 0.0);
+    _writePerfCountersJson(file, pluginChain->perfCounters[i]);
+    fprintf(file, "}");
+  }
+
+  fprintf(file, "\n  ]");
+}
+
+static void _writeMemoryReportObject(FILE *file,
+                                     const PluginChain pluginChain) {
+  Plugin plugin;
+  unsigned int i;
+
+  fprintf(file, "{\n    \"budget_kb\": %lu,",
+          memoryUsageInstance != NULL
+              ? (unsigned long)(memoryUsageInstance->budget / 1024)
+              : 0);
+
+  for (i = 0; i < kMemoryUsageNumCategories; i++) {
+    fprintf(file, "\n    \"%s_peak_kb\": %lu,",
+            memoryUsageGetCategoryName((MemoryUsageCategory)i),
+            (unsigned long)(memoryUsageGetPeak((MemoryUsageCategory)i) / 1024));
+  }
+
+  // Libraries can't be told apart from other memory while they are being used,
+  // so their size is taken from the pages of their mappings which are resident
+  fprintf(file, "\n    \"plugin_libraries\": [");
+
+  for (i = 0; i < pluginChain->numPlugins; i++) {
+    plugin = pluginChain->plugins[i];
+    fprintf(file, "%s\n      {\"name\": ", i > 0 ? "," : "");
+    _writeJsonString(file, plugin->pluginName->data);
+    fprintf(file, ", \"resident_kb\": %lu}",
+            platformInfoGetMappedMemoryUsage(plugin->pluginAbsolutePath->data));
+  }
+
+  fprintf(file, "\n    ]\n  }");
+}
+
+static void _writePerfReport(const CharString filename,
+                             const PluginChain pluginChain,
+                             const LinkedList taskTimers,
+                             const TaskTimer initTimer,
+                             const TaskTimer totalTimer,
+                             const unsigned long framesProcessed,
+                             const unsigned long processingDelayInFrames) {
+  FILE *file = fopen(filename->data, "w");
+  const double audioTimeInMs = framesProcessed * 1000.0 / getSampleRate();
+  // Initialization is excluded, since it does not depend on the input length
+  const double processingTimeInMs =
+      totalTimer->totalTaskTime - initTimer->totalTaskTime;
+  _PerfReportTimerData timerData;
+
+  if (file == NULL) {
+    logError("Could not open '%s' to write performance report",
+             filename->data);
+    return;
+  }
+
+  fprintf(file, "{\n  \"version\": \"%d.%d.%d\",\n", VERSION_MAJOR,
+          VERSION_MINOR, VERSION_PATCH);
+  fprintf(file, "  \"sample_rate\": %f,\n", getSampleRate());
+  fprintf(file, "  \"blocksize\": %lu,\n", getBlocksize());
+  fprintf(file, "  \"channels\": %d,\n", getNumChannels());
+  fprintf(file, "  \"frames_processed\": %lu,\n", framesProcessed);
+  fprintf(file, "  \"processing_delay_frames\": %lu,\n",
+          processingDelayInFrames);
+  fprintf(file, "  \"total_ms\": %f,\n", totalTimer->totalTaskTime);
+  fprintf(file, "  \"realtime_factor\": %f,\n",
+          processingTimeInMs > 0.0 ? audioTimeInMs / processingTimeInMs : 0.0);
+  fprintf(file, "  \"process_cpu_ms\": %f,\n",
+          platformInfoGetProcessCpuTime());
+  fprintf(file, "  \"peak_memory_kb\": %lu,\n",
+          platformInfoGetPeakMemoryUsage());
+  fprintf(file, "  \"plugins\": ");
+  _writePluginCpuReport(file, pluginChain, audioTimeInMs);
+  fprintf(file, ",\n");
+  fprintf(file, "  \"memory\": ");
+  _writeMemoryReportObject(file, pluginChain);
+  fprintf(file, ",\n");
+
+  fprintf(file, "  \"timers\": [");
+  timerData.file = file;
+  timerData.first = true;
+  linkedListForeach(taskTimers, _writeTaskTimerJson, &timerData);
+  fprintf(file, "\n  ],\n");
+
+  fprintf(file, "  \"latency\": ");
+  _writeLatencyReportObject(file, pluginChain, "  ");
+  fprintf(file, "\n}\n");
+  fclose(file);
+  logInfo("Wrote performance report to '%s'", filename->data);
+}
+
 static void _remapFileToErrorReport(ErrorReporter errorReporter,
                                     ProgramOptions options, unsigned int index,
                                     boolByte copyFile) {
@@ -149,7 +596,54 @@ static ReturnCode buildPluginChain(PluginChain pluginChain,
   return RETURN_CODE_SUCCESS;
 }
 
-static ReturnCode setupInputSource(SampleSource inputSource) {
+static boolByte _canMapInputSource(const SampleSource inputSource) {
+  switch (inputSource->sampleSourceType) {
+  case SAMPLE_SOURCE_TYPE_PCM:
+    return true;
+#if !USE_AUDIOFILE
+  // With audiofile, AIFF and WAVE files are not read by the internal PCM code
+  case SAMPLE_SOURCE_TYPE_AIFF:
+  case SAMPLE_SOURCE_TYPE_WAVE:
+    return true;
+#endif
+
+  default:
+    return false;
+  }
+}
+
+static void _mapInputSource(SampleSource inputSource) {
+  File inputFile;
+  size_t inputSize;
+
+  if (!_canMapInputSource(inputSource)) {
+    logWarn("Input source '%s' cannot be mapped into memory",
+            inputSource->sourceName->data);
+    return;
+  }
+
+  // Mapped pages become resident as they are read, so inputs which don't fit
+  // into the memory budget are streamed instead
+  inputFile = newFileWithPath(inputSource->sourceName);
+  inputSize = fileGetSize(inputFile);
+  freeFile(inputFile);
+
+  if (!memoryUsageFitsBudget(inputSize)) {
+    logInfo("Input source '%s' does not fit into the memory budget, reading it "
+            "normally instead",
+            inputSource->sourceName->data);
+    return;
+  }
+
+  if (!sampleSourcePcmMapInput(inputSource)) {
+    logWarn("Could not map input source '%s' into memory, reading it normally "
+            "instead",
+            inputSource->sourceName->data);
+  }
+}
+
+static ReturnCode setupInputSource(SampleSource inputSource,
+                                   boolByte mapInput) {
   if (inputSource == NULL) {
     return RETURN_CODE_INVALID_ARGUMENT;
   }
@@ -165,9 +659,268 @@ static ReturnCode setupInputSource(SampleSource inputSource) {
     return RETURN_CODE_IO_ERROR;
   }
 
+  if (mapInput) {
+    _mapInputSource(inputSource);
+  }
+
+  return RETURN_CODE_SUCCESS;
+}
+
+/**
+ * Get the number of frames which are read from the input source and written to
+ * the output source at once. This is always a multiple of the blocksize, so
+ * that each chunk of I/O can be sliced into whole blocks for the plugins.
+ *
+ * @param requestedIoBlocksize Requested size, or 0 to use the blocksize
+ * @return Number of frames in each chunk of I/O
+ */
+static SampleCount _getIoBlocksize(SampleCount requestedIoBlocksize) {
+  const SampleCount blocksize = getBlocksize();
+
+  if (requestedIoBlocksize <= blocksize) {
+    return blocksize;
+  }
+
+  return requestedIoBlocksize - (requestedIoBlocksize % blocksize);
+}
+
+static SampleSource _prefetchInputSource(SampleSource inputSource,
+                                        unsigned int numBlocks,
+                                        SampleCount ioBlocksize) {
+  SampleSource asyncSource;
+
+  // Pipes and network streams always get their own reader thread, otherwise
+  // the process on the other end stalls whenever the plugin chain is busy
+  if (numBlocks == 0 &&
+      (sampleSourcePcmIsPipe(inputSource) ||
+       inputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_TCP)) {
+    numBlocks = kMrsWatsonPipeBufferBlocks;
+  }
+
+  // Decoding MP3 and Ogg files costs about as much as a light plugin chain, so
+  // it is moved to another thread when there is a spare processor
+  if (numBlocks == 0 && platformInfoGetNumProcessors() > 1 &&
+      (inputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_MP3 ||
+       inputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_OGG)) {
+    numBlocks = kMrsWatsonDecodeAheadBlocks;
+  }
+
+  // Reading ahead from a live device would only add latency, and memory
+  // streams are already as fast as the prefetch buffer
+  if (numBlocks == 0 ||
+      inputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_SILENCE ||
+      inputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_DEVICE ||
+      inputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_MEMORY) {
+    return inputSource;
+  }
+
+  // Files can be read ahead through an I/O ring instead of a reader thread
+  if (sampleSourcePcmQueueReads(inputSource, numBlocks,
+                                _getIoBlocksize(ioBlocksize))) {
+    return inputSource;
+  }
+
+  asyncSource = newSampleSourceAsyncReader(inputSource, numBlocks,
+                                           _getIoBlocksize(ioBlocksize));
+
+  if (asyncSource == NULL) {
+    logWarn("Could not start prefetching input, reading synchronously instead");
+    return inputSource;
+  }
+
+  return asyncSource;
+}
+
+/**
+ * Convert an opened input source to another sample rate while it is read, and
+ * use the new rate for processing. Afterwards, getSampleRate() returns the
+ * converted rate.
+ *
+ * @param resampleRate Sample rate to convert to, or 0 to use the rate of the
+ * input source
+ * @return The wrapped input source, or the input source itself if it does not
+ * need to be converted
+ */
+static SampleSource _resampleInputSource(SampleSource inputSource,
+                                         SampleRate resampleRate,
+                                         ResamplerQuality resampleQuality) {
+  SampleSource resampledSource;
+
+  if (resampleRate <= 0.0 || resampleRate == getSampleRate()) {
+    return inputSource;
+  } else if (inputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_SILENCE) {
+    // Silence can simply be generated at the new rate
+    setSampleRate(resampleRate);
+    return inputSource;
+  }
+
+  resampledSource = newSampleSourceResampler(inputSource, getSampleRate(),
+                                             resampleRate, resampleQuality);
+
+  if (resampledSource == NULL) {
+    logWarn("Could not convert the sample rate of '%s'",
+            inputSource->sourceName->data);
+    return inputSource;
+  }
+
+  logInfo("Converting input from %.0fHz to %.0fHz", getSampleRate(),
+          resampleRate);
+  setSampleRate(resampleRate);
+  return resampledSource;
+}
+
+/**
+ * Open the source of a sidechain, given as 'name,file', and feed its channels
+ * to that plugin. The sidechain is read ahead like the input, and must have
+ * the same sample rate.
+ *
+ * @param argument Plugin name and file of the sidechain
+ * @param outSidechainSource Set to the opened sidechain source
+ * @return RETURN_CODE_SUCCESS, or an error code if the sidechain could not be
+ * opened
+ */
+static ReturnCode _setupSidechainSource(PluginChain pluginChain,
+                                        const CharString argument,
+                                        unsigned int prefetchBlocks,
+                                        SampleCount ioBlocksize,
+                                        SampleSource *outSidechainSource) {
+  const SampleRate sampleRate = getSampleRate();
+  const ChannelCount numChannels = getNumChannels();
+  const char *comma = strchr(argument->data, ',');
+  CharString pluginName;
+  CharString filename;
+  SampleSource sidechainSource;
+  ChannelCount sidechainChannels;
+  ReturnCode result;
+
+  if (comma == NULL || comma == argument->data || comma[1] == '\0') {
+    logError("Sidechain source '%s' is not in the format 'name,file'",
+             argument->data);
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  filename = newCharStringWithCString(comma + 1);
+  sidechainSource = sampleSourceFactory(filename);
+  freeCharString(filename);
+
+  if (sidechainSource == NULL ||
+      sidechainSource->sampleSourceType == SAMPLE_SOURCE_TYPE_INVALID) {
+    logError("Sidechain source '%s' has an unsupported file type", comma + 1);
+    freeSampleSource(sidechainSource);
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  // Opening the sidechain sets the format of the render to that of the file
+  result = setupInputSource(sidechainSource, false);
+  sidechainChannels = getNumChannels();
+
+  if (result == RETURN_CODE_SUCCESS && getSampleRate() != sampleRate) {
+    logError("Sidechain source '%s' has a sample rate of %gHz, but the input "
+             "has %gHz",
+             sidechainSource->sourceName->data, getSampleRate(), sampleRate);
+    result = RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  if (result != RETURN_CODE_SUCCESS) {
+    freeSampleSource(sidechainSource);
+    setSampleRate(sampleRate);
+    setNumChannels(numChannels);
+    return result;
+  }
+
+  pluginName = newCharStringWithCString(argument->data);
+  pluginName->data[comma - argument->data] = '\0';
+  pluginChainSetSidechain(pluginChain, pluginName, sidechainChannels);
+  freeCharString(pluginName);
+
+  // The read-ahead buffers are allocated for the channels of the sidechain
+  *outSidechainSource =
+      _prefetchInputSource(sidechainSource, prefetchBlocks, ioBlocksize);
+  setNumChannels(numChannels);
   return RETURN_CODE_SUCCESS;
 }
 
+/**
+ * Write an opened output source in the background, so that the processing
+ * thread does not wait for the disk or for the other end of a pipe.
+ *
+ * @param numBlocks Number of blocks which may be waiting to be written, or 0
+ * to only do this for pipes and network streams
+ * @param convertBehind True if the samples should also be converted to the
+ * output format in the background, which needs a writer thread. Otherwise
+ * files are written through an I/O ring where possible.
+ * @return The wrapped output source, or the output source itself if it is
+ * written from the processing thread
+ */
+static SampleSource _writeBehindOutputSource(SampleSource outputSource,
+                                             unsigned int numBlocks,
+                                             SampleCount ioBlocksize,
+                                             boolByte convertBehind) {
+  SampleSource asyncSource;
+
+  if (numBlocks == 0 &&
+      (sampleSourcePcmIsPipe(outputSource) ||
+       outputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_TCP)) {
+    numBlocks = kMrsWatsonPipeBufferBlocks;
+  }
+
+  if (numBlocks == 0 ||
+      outputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_SILENCE ||
+      outputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_DEVICE ||
+      outputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_MEMORY) {
+    return outputSource;
+  }
+
+  if (!convertBehind &&
+      sampleSourcePcmQueueWrites(outputSource, numBlocks,
+                                 _getIoBlocksize(ioBlocksize))) {
+    return outputSource;
+  }
+
+  asyncSource = newSampleSourceAsyncWriter(outputSource, numBlocks,
+                                           _getIoBlocksize(ioBlocksize));
+
+  if (asyncSource == NULL) {
+    logWarn("Could not start writing output in the background, writing "
+            "synchronously instead");
+    return outputSource;
+  }
+
+  return asyncSource;
+}
+
+/**
+ * Find out if the output of a single render should be written in a background
+ * thread when --write-behind was not given. Converting the processed samples
+ * to the output format, dithering and interleaving them can take as long as a
+ * cheap plugin chain, so doing this on another processor leaves the processing
+ * thread with only the plugin chain to run.
+ *
+ * This is only done for files, since pipes and network streams are always
+ * written in the background, and only if there is a spare processor. Chains
+ * which only apply a gain are left alone, since their samples may be copied
+ * without being converted at all.
+ */
+static boolByte _shouldConvertBehind(SampleSource outputSource,
+                                     PluginChain pluginChain) {
+  Sample gain;
+
+  switch (outputSource->sampleSourceType) {
+  case SAMPLE_SOURCE_TYPE_PCM:
+  case SAMPLE_SOURCE_TYPE_AIFF:
+  case SAMPLE_SOURCE_TYPE_FLAC:
+  case SAMPLE_SOURCE_TYPE_MP3:
+  case SAMPLE_SOURCE_TYPE_OGG:
+  case SAMPLE_SOURCE_TYPE_WAVE:
+    return (boolByte)(platformInfoGetNumProcessors() > 1 &&
+                      !sampleSourcePcmIsPipe(outputSource) &&
+                      !pluginChainGetLinearGain(pluginChain, &gain));
+
+  default:
+    return false;
+  }
+}
+
 static ReturnCode setupMidiSource(MidiSource midiSource,
                                   MidiSequence *outSequence) {
   if (midiSource != NULL) {
@@ -177,9 +930,8 @@ static ReturnCode setupMidiSource(MidiSource midiSource,
       return RETURN_CODE_IO_ERROR;
     }
 
-    // Read in all events from the MIDI source
-    // TODO: This will not work if we want to support streaming MIDI events (ie,
-    // from a pipe)
+    // Sources may stream their events into the sequence during processing,
+    // so this only needs to read enough to know that the source is valid
     *outSequence = newMidiSequence();
 
     if (!midiSource->readMidiEvents(midiSource, *outSequence)) {
@@ -192,11 +944,20 @@ static ReturnCode setupMidiSource(MidiSource midiSource,
   return RETURN_CODE_SUCCESS;
 }
 
-static ReturnCode setupOutputSource(SampleSource outputSource) {
+static ReturnCode setupOutputSource(SampleSource outputSource,
+                                    unsigned int flacLevel,
+                                    unsigned int flacThreads) {
   if (outputSource == NULL) {
     return RETURN_CODE_INVALID_ARGUMENT;
   }
 
+#if USE_FLAC
+  if (outputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_FLAC) {
+    sampleSourceFlacSetCompressionLevel(outputSource, flacLevel);
+    sampleSourceFlacSetNumThreads(outputSource, flacThreads);
+  }
+#endif
+
   if (!outputSource->openSampleSource(outputSource, SAMPLE_SOURCE_OPEN_WRITE)) {
     logError("Output source '%s' could not be opened",
              outputSource->sourceName->data);
@@ -206,17 +967,79 @@ static ReturnCode setupOutputSource(SampleSource outputSource) {
   return RETURN_CODE_SUCCESS;
 }
 
+/**
+ * Get the length of a PCM or WAVE input, which is used to estimate the length
+ * of the output before processing starts. Must be called before the input is
+ * wrapped for prefetching.
+ * @return Number of frames, or 0 if the length of the input is not known
+ */
+static unsigned long _getInputLengthInFrames(SampleSource inputSource) {
+  if (inputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_PACKED) {
+    return sampleSourcePackedGetLengthInFrames(inputSource);
+  } else if (inputSource->sampleSourceType != SAMPLE_SOURCE_TYPE_PCM &&
+      inputSource->sampleSourceType != SAMPLE_SOURCE_TYPE_WAVE) {
+    return 0;
+  }
+
+  return sampleSourcePcmGetLengthInFrames(inputSource);
+}
+
+/**
+ * Reserve disk space for a PCM or WAVE output, using the length of the input
+ * and the tail of the plugin chain as an estimate of its length. Any reserved
+ * space which is not written to is released when the output is closed.
+ */
+static void _preallocateOutputSource(SampleSource outputSource,
+                                     PluginChain pluginChain,
+                                     unsigned long inputLengthInFrames,
+                                     unsigned long maxTimeInMs,
+                                     boolByte flushTail) {
+  unsigned long numFrames = inputLengthInFrames;
+
+  if (numFrames == 0 ||
+      (outputSource->sampleSourceType != SAMPLE_SOURCE_TYPE_PCM &&
+       outputSource->sampleSourceType != SAMPLE_SOURCE_TYPE_WAVE)) {
+    return;
+  }
+
+  if (flushTail) {
+    numFrames +=
+        (unsigned long)(pluginChainGetMaximumTailTimeInMs(pluginChain) *
+                        getSampleRate() / 1000.0);
+  }
+
+  if (maxTimeInMs > 0 &&
+      (unsigned long)(maxTimeInMs * getSampleRate() / 1000.0) < numFrames) {
+    numFrames = (unsigned long)(maxTimeInMs * getSampleRate() / 1000.0);
+  }
+
+  sampleSourcePcmPreallocate(outputSource, numFrames);
+}
+
 static void _processMidiMetaEvent(void *item, void *userData) {
   MidiEvent midiEvent = (MidiEvent)item;
   boolByte *finishedReading = (boolByte *)userData;
 
+  // The clock's timeline applies changes at the exact frame of the event, and
+  // it must be updated before the settings, which it starts from
   if (midiEvent->eventType == MIDI_TYPE_META) {
     switch (midiEvent->status) {
     case MIDI_META_TYPE_TEMPO:
+      if (midiEvent->extraData != NULL) {
+        audioClockAddTempoChange(getAudioClock(), midiEvent->timestamp,
+                                 getTempoFromMidiBytes(midiEvent->extraData));
+      }
+
       setTempoFromMidiBytes(midiEvent->extraData);
       break;
 
     case MIDI_META_TYPE_TIME_SIGNATURE:
+      if (midiEvent->extraData != NULL && midiEvent->extraData[1] < 16) {
+        audioClockAddTimeSignatureChange(
+            getAudioClock(), midiEvent->timestamp, midiEvent->extraData[0],
+            (unsigned short)(1 << midiEvent->extraData[1]));
+      }
+
       if (!setTimeSignatureFromMidiBytes(midiEvent->extraData)) {
         logWarn("Could not set time signature from MIDI file");
       }
@@ -255,15 +1078,10 @@ boolByte readInput(SampleSource inputSource, SampleBuffer buffer) {
     // We have filled up the buffer, so return true to ask for more input
     return true;
   } else if (framesRead < bufferSize) {
-    // Partial read, meaning that we have reached the end of file
-    unsigned long numberOfFrames = (bufferSize - framesRead);
-    SampleBuffer silenceBuffer =
-        newSampleBuffer(buffer->numChannels, numberOfFrames);
-
-    buffer->blocksize = framesRead + numberOfFrames;
-    sampleBufferCopyAndMapChannelsWithOffset(buffer, framesRead, silenceBuffer,
-                                             0, numberOfFrames);
-    freeSampleBuffer(silenceBuffer);
+    // Partial read, meaning that we have reached the end of file. Pad the rest
+    // of the block with silence.
+    buffer->blocksize = bufferSize;
+    sampleBufferClearWithOffset(buffer, framesRead, bufferSize - framesRead);
 
     // Finished reading
     return false;
@@ -276,72 +1094,3869 @@ boolByte readInput(SampleSource inputSource, SampleBuffer buffer) {
   }
 }
 
+/**
+ * Read the block of the sidechain which goes with the next block of the plugin
+ * chain, if the chain has a sidechain. After the end of the sidechain source,
+ * the block is silent.
+ *
+ * @param sidechainSource Source to read from, or NULL for a silent block
+ * @param blocksize Number of frames in the next block
+ */
+static void _readSidechainBlock(PluginChain pluginChain,
+                                SampleSource sidechainSource,
+                                SampleCount blocksize) {
+  SampleBuffer sidechain = pluginChainGetSidechain(pluginChain);
+
+  if (sidechain == NULL) {
+    return;
+  }
+
+  sidechain->blocksize = blocksize;
+
+  if (sidechainSource != NULL) {
+    readInput(sidechainSource, sidechain);
+  } else {
+    sampleBufferClear(sidechain);
+  }
+}
+
 /**
  *  Writes to outputSource.
  *
  * @param outputSource The SampleSource to write to.
- * @param silenceSource The source from where to write skipHeadFrames frames.
+ * @param silenceSource The source from where to write the frames which are
+ * trimmed from the output.
  * @param buffer The SampleBuffer with the samples to be written.
  * @param skipHeadFrames Number of frames to ignore before writing to
  * outputSource.
+ * @param outputLengthInFrames Number of frames to write to outputSource after
+ * skipHeadFrames, any further frames are ignored. Use
+ * kMrsWatsonOutputLengthUnknown while the length is not yet known.
+ *
+ * This must be called after the audio clock has been advanced past the end of
+ * the buffer.
  */
 void writeOutput(SampleSource outputSource, SampleSource silenceSource,
-                 SampleBuffer buffer, unsigned long skipHeadFrames) {
+                 SampleBuffer buffer, unsigned long skipHeadFrames,
+                 unsigned long outputLengthInFrames) {
   unsigned long framesSkipped =
       silenceSource->numSamplesProcessed / buffer->numChannels;
   unsigned long framesProcessed =
       framesSkipped + outputSource->numSamplesProcessed / buffer->numChannels;
   unsigned long nextBlockStart = framesProcessed + buffer->blocksize;
+  unsigned long outputEnd = kMrsWatsonOutputLengthUnknown;
+  unsigned long soundStart = framesProcessed;
+  unsigned long soundEnd = nextBlockStart;
+
+  if (nextBlockStart != getAudioClock()->currentFrame) {
+    logWarn("nextBlockStart (%lu) != getAudioClock()->currentFrame (%lu)",
+            nextBlockStart, getAudioClock()->currentFrame);
+  }
+
+  if (outputLengthInFrames != kMrsWatsonOutputLengthUnknown) {
+    outputEnd = skipHeadFrames + outputLengthInFrames;
+  }
+
+  // Cut the delay at the start, and anything past the end of the output
+  if (soundStart < skipHeadFrames) {
+    soundStart = skipHeadFrames < nextBlockStart ? skipHeadFrames
+                                                 : nextBlockStart;
+  }
 
-  if (framesProcessed != getAudioClock()->currentFrame) {
-    logWarn("framesProcessed (%lu) != getAudioClock()->currentFrame (%lu)",
-            framesProcessed, getAudioClock()->currentFrame);
+  if (soundEnd > outputEnd) {
+    soundEnd = outputEnd > soundStart ? outputEnd : soundStart;
   }
 
-  // Cut the delay at the start
-  if (nextBlockStart <= skipHeadFrames) {
+  if (soundStart == framesProcessed && soundEnd == nextBlockStart) {
+    // Normal case: Nothing to cut. The whole block shall be written.
+    outputSource->writeSampleBlock(outputSource, buffer);
+  } else if (soundStart == soundEnd) {
     // Cutting away the whole block. nothing is written to the outputSource
     silenceSource->writeSampleBlock(silenceSource, buffer);
-  } else if (framesProcessed < skipHeadFrames &&
-             skipHeadFrames < nextBlockStart) {
-    SampleBuffer sourceBuffer =
-        newSampleBuffer(buffer->numChannels, buffer->blocksize);
-    unsigned long skippedFrames = skipHeadFrames - framesProcessed;
-    unsigned long soundFrames = nextBlockStart - skipHeadFrames;
-
-    // Cutting away start part of the block.
-    sourceBuffer->blocksize = skippedFrames;
-    sampleBufferCopyAndMapChannelsWithOffset(sourceBuffer, 0, buffer, 0,
-                                             sourceBuffer->blocksize);
-    silenceSource->writeSampleBlock(silenceSource, sourceBuffer);
-
-    // Writing remaining end part of the block.
-    sourceBuffer->blocksize = soundFrames;
-    sampleBufferCopyAndMapChannelsWithOffset(
-        sourceBuffer, 0, buffer, skippedFrames, sourceBuffer->blocksize);
-    outputSource->writeSampleBlock(outputSource, sourceBuffer);
-
-    freeSampleBuffer(sourceBuffer);
   } else {
-    // Normal case: Nothing more to cut. The whole block shall be written.
-    outputSource->writeSampleBlock(outputSource, buffer);
+    // Cutting away the start and/or end of the block, and writing the part
+    // in between
+    if (soundStart > framesProcessed) {
+      sampleSourceWriteFrames(silenceSource, buffer, 0,
+                              (SampleCount)(soundStart - framesProcessed));
+    }
+
+    sampleSourceWriteFrames(outputSource, buffer,
+                            (SampleCount)(soundStart - framesProcessed),
+                            (SampleCount)(soundEnd - soundStart));
+
+    if (soundEnd < nextBlockStart) {
+      sampleSourceWriteFrames(silenceSource, buffer,
+                              (SampleCount)(soundEnd - framesProcessed),
+                              (SampleCount)(nextBlockStart - soundEnd));
+    }
   }
 }
 
-int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
-  ReturnCode result;
-  // Input/Output sources, plugin chain, and other required objects
-  SampleSource inputSource = NULL;
-  SampleSource outputSource = NULL;
-  AudioClock audioClock;
-  PluginChain pluginChain;
-  CharString pluginSearchRoot = newCharString();
-  boolByte shouldDisplayPluginInfo = false;
-  MidiSequence midiSequence = NULL;
-  MidiSource midiSource = NULL;
+/**
+ * Write the hashes of a finished output, and compare them with the hashes of
+ * an earlier render.
+ *
+ * @param outputHashesPath File to write the hashes to, or NULL
+ * @param compareHashesPath File with the hashes of an earlier render, or NULL
+ * @return RETURN_CODE_OUTPUT_MISMATCH if the output is different from the
+ * earlier render, or RETURN_CODE_SUCCESS
+ */
+static ReturnCode _finishOutputHashes(const OutputHashes outputHashes,
+                                      const CharString outputHashesPath,
+                                      const CharString compareHashesPath) {
+  OutputHashes earlierHashes;
+  size_t firstDifference;
+  ReturnCode result = RETURN_CODE_SUCCESS;
+
+  if (outputHashesPath != NULL) {
+    if (!outputHashesWrite(outputHashes, outputHashesPath)) {
+      return RETURN_CODE_IO_ERROR;
+    }
+
+    logInfo("Wrote hashes of %lu blocks to '%s'",
+            (unsigned long)outputHashes->numBlocks, outputHashesPath->data);
+  }
+
+  if (compareHashesPath == NULL) {
+    return RETURN_CODE_SUCCESS;
+  }
+
+  earlierHashes = newOutputHashesFromFile(compareHashesPath);
+
+  if (earlierHashes == NULL) {
+    return RETURN_CODE_IO_ERROR;
+  }
+
+  if (earlierHashes->blocksize != outputHashes->blocksize ||
+      earlierHashes->numChannels != outputHashes->numChannels) {
+    logError("Hashes in '%s' were made with a blocksize of %lu and %d "
+             "channels, which cannot be compared with this render",
+             compareHashesPath->data, earlierHashes->blocksize,
+             earlierHashes->numChannels);
+    freeOutputHashes(earlierHashes);
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  firstDifference =
+      outputHashesFindFirstDifference(earlierHashes, outputHashes);
+
+  if (firstDifference == OUTPUT_HASHES_NO_DIFFERENCE) {
+    logInfo("Output matches '%s', hash %016llx", compareHashesPath->data,
+            outputHashesGetFileHash(outputHashes));
+  } else {
+    logError("Output differs from '%s' from block %lu, at frame %lu (%.3f "
+             "seconds)",
+             compareHashesPath->data, (unsigned long)firstDifference,
+             (unsigned long)firstDifference * outputHashes->blocksize,
+             (double)firstDifference * outputHashes->blocksize /
+                 getSampleRate());
+    result = RETURN_CODE_OUTPUT_MISMATCH;
+  }
+
+  freeOutputHashes(earlierHashes);
+  return result;
+}
+
+/**
+ * Get the number of frames which should be written for a job, once all of its
+ * input has been sent to the plugin chain. The output has the length of the
+ * input, or of the MIDI sequence when rendering an instrument, and is then
+ * extended by the tail time of the chain if requested.
+ *
+ * @param prerollFrames Frames at the start of the job which are processed but
+ * not written. The preroll of an input segment is not counted as read, but for
+ * MIDI it must be taken out of the processed frames.
+ */
+static unsigned long _getOutputLengthInFrames(PluginChain pluginChain,
+                                              SampleSource inputSource,
+                                              MidiSequence midiSequence,
+                                              unsigned long prerollFrames,
+                                              boolByte flushTail) {
+  unsigned long framesRead = inputSource->numSamplesProcessed /
+                             getNumChannels();
+  // Blocks are padded with silence after the end of input, and processing may
+  // also stop early if the maximum time was reached
+  unsigned long result = getAudioClock()->currentFrame;
+
+  if (midiSequence != NULL) {
+    // The sequence usually ends partway through the last block, so its length
+    // must not be taken from the clock, which depends on the blocksize
+    if (midiSequenceGetEndTimestamp(midiSequence) < result) {
+      result = midiSequenceGetEndTimestamp(midiSequence);
+    }
+
+    result = result > prerollFrames ? result - prerollFrames : 0;
+  } else if (framesRead < result) {
+    result = framesRead;
+  }
+
+  if (flushTail) {
+    result += (unsigned long)(pluginChainGetMaximumTailTimeInMs(pluginChain) *
+                              getSampleRate() / 1000.0);
+  }
+
+  return result;
+}
+
+typedef struct {
+  CharString inputSource;
+  CharString outputSource;
+  // Only set for jobs which render a segment of their input, see
+  // RenderSegment.h
+  unsigned long startFrame;
+  unsigned long numFrames;
+  unsigned long prerollFrames;
+} _InputListJobMembers;
+typedef _InputListJobMembers *_InputListJob;
+
+static void _freeInputListJob(void *item) {
+  _InputListJob job = (_InputListJob)item;
+
+  if (job != NULL) {
+    freeCharString(job->inputSource);
+    freeCharString(job->outputSource);
+    free(job);
+  }
+}
+
+/**
+ * Read jobs for batch processing from an input list file. Each line should
+ * contain an input source and an output source name separated by a tab.
+ *
+ * @param filename Input list file to read
+ * @return List of _InputListJob items, or NULL if the list could not be read or
+ * contains no jobs.
+ */
+static LinkedList _readInputList(const CharString filename) {
+  File inputListFile = newFileWithPath(filename);
+  LinkedList lines = NULL;
+  LinkedList result = NULL;
+  LinkedList lineItems = NULL;
+  LinkedListIterator iterator;
+  LinkedListIterator lineItem;
+  CharString line;
+  _InputListJob job = NULL;
+  char *carriageReturn = NULL;
+  int lineNumber = 0;
+
+  if (inputListFile == NULL || inputListFile->fileType != kFileTypeFile) {
+    logError("Input list '%s' does not exist", filename->data);
+    freeFile(inputListFile);
+    return NULL;
+  }
+
+  lines = fileReadLines(inputListFile);
+  freeFile(inputListFile);
+
+  if (lines == NULL) {
+    return NULL;
+  }
+
+  result = newLinkedList();
+
+  for (iterator = linkedListBegin(lines); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    line = (CharString)linkedListIteratorGetItem(iterator);
+    lineNumber++;
+    // Tolerate files which were saved with DOS line endings
+    carriageReturn = strrchr(line->data, '\r');
+
+    if (carriageReturn != NULL) {
+      *carriageReturn = '\0';
+    }
+
+    if (charStringIsEmpty(line) || line->data[0] == '#') {
+      continue;
+    }
+
+    lineItems = charStringSplit(line, '\t');
+
+    if (lineItems == NULL || linkedListLength(lineItems) != 2) {
+      logError("Line %d of input list '%s' should contain an input and output "
+               "source separated by a tab",
+               lineNumber, filename->data);
+      freeLinkedListAndItems(lineItems, (LinkedListFreeItemFunc)freeCharString);
+      freeLinkedListAndItems(result, _freeInputListJob);
+      result = NULL;
+      break;
+    }
+
+    job = (_InputListJob)malloc(sizeof(_InputListJobMembers));
+    lineItem = linkedListBegin(lineItems);
+    job->inputSource = (CharString)linkedListIteratorGetItem(lineItem);
+    lineItem = linkedListIteratorNext(lineItem);
+    job->outputSource = (CharString)linkedListIteratorGetItem(lineItem);
+    job->startFrame = 0;
+    job->numFrames = 0;
+    job->prerollFrames = 0;
+    linkedListAppend(result, job);
+    // The CharStrings are now owned by the job
+    freeLinkedList(lineItems);
+  }
+
+  if (result != NULL && linkedListLength(result) == 0) {
+    logError("Input list '%s' does not contain any jobs", filename->data);
+    freeLinkedList(result);
+    result = NULL;
+  }
+
+  freeLinkedListAndItems(lines, (LinkedListFreeItemFunc)freeCharString);
+  return result;
+}
+
+/**
+ * Send the MIDI events which fall within the current block to the plugin
+ * chain. Any meta events are handled here, too.
+ *
+ * @param pluginChain Chain to send the events to, or NULL to only handle the
+ * meta events
+ * @param midiEventsForBlock List which is filled with the events for the
+ * block. This is cleared on each call, so that its nodes are reused.
+ * @param finishedReading Set to true if the end of the sequence was reached
+ */
+static void _processMidiForBlock(PluginChain pluginChain,
+                                 MidiSequence midiSequence,
+                                 LinkedList midiEventsForBlock,
+                                 boolByte *finishedReading) {
+  MidiEvent midiEvents;
+  unsigned long numMidiEvents;
+  unsigned long event;
+
+  // When the sequence is streamed from its source, this also reads the events
+  // for the block from the source.
+  // MIDI source overrides the value set to finishedReading by the input source
+  *finishedReading = (boolByte)!midiSequenceGetRange(
+      midiSequence, getAudioClock()->currentFrame, getBlocksize(), &midiEvents,
+      &numMidiEvents);
+
+  // Most blocks have no events at all, so only build a list for the plugin
+  // chain when needed
+  if (numMidiEvents > 0) {
+    linkedListClear(midiEventsForBlock);
+
+    for (event = 0; event < numMidiEvents; event++) {
+      _processMidiMetaEvent(&midiEvents[event], finishedReading);
+      linkedListAppend(midiEventsForBlock, &midiEvents[event]);
+    }
+
+    if (pluginChain != NULL) {
+      pluginChainProcessMidi(pluginChain, midiEventsForBlock);
+    }
+  }
+}
+
+typedef struct {
+  RenderCheckpoint checkpoint;
+  CharString filename;
+  unsigned long intervalInFrames;
+  // Number of frames written by this render after which the next checkpoint
+  // is saved
+  unsigned long nextCheckpointFrames;
+  // Input frame which corresponds to the first frame written by this render
+  unsigned long startFrame;
+  // Number of frames in the output before this render started
+  unsigned long firstOutputFrame;
+} _CheckpointWriterMembers;
+typedef _CheckpointWriterMembers *_CheckpointWriter;
+
+/**
+ * Save a checkpoint if enough output has been written since the last one. The
+ * output is flushed to disk first, so that everything up to the checkpoint is
+ * kept when resuming. Must only be called while the input is still being read,
+ * since the input frame of the checkpoint must be within the input.
+ *
+ * @param writer Checkpoint writer, or NULL if no checkpoints are saved
+ */
+static void _writeCheckpointIfDue(_CheckpointWriter writer,
+                                  PluginChain pluginChain,
+                                  SampleSource outputSource) {
+  RenderCheckpoint checkpoint;
+  unsigned long framesWritten;
+  Plugin plugin;
+  byte *chunk;
+  size_t chunkSize;
+  unsigned int i;
+
+  if (writer == NULL) {
+    return;
+  }
+
+  framesWritten = outputSource->numSamplesProcessed / getNumChannels();
+
+  if (framesWritten < writer->nextCheckpointFrames) {
+    return;
+  }
+
+  checkpoint = writer->checkpoint;
+  checkpoint->outputOffset = sampleSourcePcmFlush(outputSource);
+
+  if (checkpoint->outputOffset == 0) {
+    logWarn("Could not flush output, skipping checkpoint");
+    writer->nextCheckpointFrames = framesWritten + writer->intervalInFrames;
+    return;
+  }
+
+  checkpoint->outputFrame = writer->firstOutputFrame + framesWritten;
+  checkpoint->inputFrame = writer->startFrame + framesWritten;
+  checkpoint->clockFrame = getAudioClock()->currentFrame;
+
+  // Plugins which save their state as chunks also get it back when resuming,
+  // which keeps any changes they have made to their parameters by themselves
+  for (i = 0; i < pluginChain->numPlugins; i++) {
+    plugin = pluginChain->plugins[i];
+
+    if (plugin->interfaceType == PLUGIN_TYPE_VST_2X &&
+        pluginVst2xHasProgramChunks(plugin)) {
+      chunk = NULL;
+      chunkSize = pluginVst2xGetChunk(plugin, false, &chunk);
+
+      if (chunkSize > 0 && chunk != NULL) {
+        renderCheckpointSetPluginState(checkpoint, i, chunk, chunkSize);
+      }
+    }
+  }
+
+  if (renderCheckpointWrite(checkpoint, writer->filename)) {
+    logDebug("Saved checkpoint at output frame %lu", checkpoint->outputFrame);
+  }
+
+  writer->nextCheckpointFrames = framesWritten + writer->intervalInFrames;
+}
+
+/**
+ * Give the plugins which save their state as chunks the state which they had
+ * when a checkpoint was saved.
+ *
+ * @return True if all states could be restored
+ */
+static boolByte _restoreCheckpointPluginStates(PluginChain pluginChain,
+                                               RenderCheckpoint checkpoint) {
+  LinkedListIterator iterator;
+  RenderCheckpointPluginState pluginState;
+  Plugin plugin;
+
+  for (iterator = linkedListBegin(checkpoint->pluginStates); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    pluginState =
+        (RenderCheckpointPluginState)linkedListIteratorGetItem(iterator);
+
+    if (pluginState->index >= pluginChain->numPlugins ||
+        pluginChain->plugins[pluginState->index]->interfaceType !=
+            PLUGIN_TYPE_VST_2X) {
+      logError("Checkpoint has state for plugin %u, which is not in the chain",
+               pluginState->index);
+      return false;
+    }
+
+    plugin = pluginChain->plugins[pluginState->index];
+    logDebug("Restoring %lu bytes of state for plugin '%s'",
+             (unsigned long)pluginState->dataSize, plugin->pluginName->data);
+    pluginVst2xSetProgramChunk(plugin, (char *)pluginState->data,
+                               pluginState->dataSize);
+  }
+
+  return true;
+}
+
+/**
+ * Process an input source in chunks of ioBlocksize frames, which are sliced
+ * into blocks for the plugin chain. Each MIDI event is still scheduled in the
+ * block which it falls in, so the plugins see the same blocks and events as
+ * when the sources are read one block at a time.
+ */
+static void _processJobInChunks(PluginChain pluginChain,
+                                SampleSource inputSource,
+                                SampleSource sidechainSource,
+                                SampleSource outputSource,
+                                SampleSource silentSampleOutput,
+                                MidiSequence midiSequence,
+                                LinkedList midiEventsForBlock,
+                                unsigned long maxTimeInFrames,
+                                unsigned long skipHeadFrames,
+                                unsigned long prerollFrames,
+                                boolByte flushTail, SampleCount ioBlocksize,
+                                SampleBuffer inputSampleBuffer,
+                                SampleBuffer outputSampleBuffer,
+                                TaskTimer inputTimer, TaskTimer outputTimer,
+                                _CheckpointWriter checkpointWriter) {
+  AudioClock audioClock = getAudioClock();
+  const SampleCount blocksize = getBlocksize();
+  SampleBuffer ioInputBuffer = newSampleBuffer(getNumChannels(), ioBlocksize);
+  SampleBuffer ioOutputBuffer = newSampleBuffer(getNumChannels(), ioBlocksize);
+  SampleBuffer sidechain = pluginChainGetSidechain(pluginChain);
+  SampleBuffer ioSidechainBuffer = NULL;
+  boolByte finishedReading = false;
+  SampleCount framesRead;
+  SampleCount framesInBlock;
+  SampleCount offset;
+  unsigned long outputLengthInFrames = kMrsWatsonOutputLengthUnknown;
+
+  // The sidechain was read ahead in chunks of the same size as the input
+  if (sidechainSource != NULL && sidechain != NULL) {
+    ioSidechainBuffer = newSampleBuffer(sidechain->numChannels, ioBlocksize);
+  }
+
+  while (!finishedReading) {
+    taskTimerStart(inputTimer);
+    ioInputBuffer->blocksize = ioBlocksize;
+    inputSource->readSampleBlock(inputSource, ioInputBuffer);
+    framesRead = ioInputBuffer->blocksize;
+
+    if (ioSidechainBuffer != NULL) {
+      ioSidechainBuffer->blocksize = ioBlocksize;
+      readInput(sidechainSource, ioSidechainBuffer);
+    }
+
+    taskTimerStop(inputTimer);
+    ioOutputBuffer->blocksize = ioBlocksize;
+
+    for (offset = 0; offset < ioBlocksize && !finishedReading;
+         offset += blocksize) {
+      taskTimerStart(inputTimer);
+      framesInBlock = 0;
+
+      if (framesRead > offset) {
+        framesInBlock =
+            framesRead - offset < blocksize ? framesRead - offset : blocksize;
+      }
+
+      // As with readInput(), a partial read ends the input and the rest of the
+      // block is filled with silence
+      inputSampleBuffer->blocksize = blocksize;
+
+      if (framesInBlock < blocksize) {
+        sampleBufferClear(inputSampleBuffer);
+        finishedReading = true;
+      }
+
+      sampleBufferCopyAndMapChannelsWithOffset(inputSampleBuffer, 0,
+                                               ioInputBuffer, offset,
+                                               framesInBlock);
+
+      if (ioSidechainBuffer != NULL) {
+        sidechain->blocksize = blocksize;
+        sampleBufferCopyAndMapChannelsWithOffset(sidechain, 0,
+                                                 ioSidechainBuffer, offset,
+                                                 blocksize);
+      }
+
+      if (midiSequence != NULL) {
+        _processMidiForBlock(pluginChain, midiSequence, midiEventsForBlock,
+                             &finishedReading);
+      }
+
+      taskTimerStop(inputTimer);
+
+      if (maxTimeInFrames > 0 && audioClock->currentFrame >= maxTimeInFrames) {
+        logInfo("Maximum time reached, stopping processing after this block");
+        finishedReading = true;
+      }
+
+      pluginChainProcessAudio(pluginChain, inputSampleBuffer,
+                              outputSampleBuffer);
+      sampleBufferCopyAndMapChannelsWithOffset(ioOutputBuffer, offset,
+                                               outputSampleBuffer, 0,
+                                               outputSampleBuffer->blocksize);
+      advanceAudioClock(audioClock, outputSampleBuffer->blocksize);
+    }
+
+    taskTimerStart(outputTimer);
+    // The loop above leaves offset at the end of the last processed block
+    ioOutputBuffer->blocksize = offset;
+
+    if (finishedReading) {
+      outputLengthInFrames = _getOutputLengthInFrames(
+          pluginChain, inputSource, midiSequence, prerollFrames, flushTail);
+    }
+
+    writeOutput(outputSource, silentSampleOutput, ioOutputBuffer,
+                skipHeadFrames, outputLengthInFrames);
+
+    if (!finishedReading) {
+      _writeCheckpointIfDue(checkpointWriter, pluginChain, outputSource);
+    }
+
+    taskTimerStop(outputTimer);
+  }
+
+  freeSampleBuffer(ioInputBuffer);
+  freeSampleBuffer(ioOutputBuffer);
+  freeSampleBuffer(ioSidechainBuffer);
+}
+
+/**
+ * Get the largest sample value which is written as zero in the output bit
+ * depth. Float output is treated like 24-bit, since it never rounds to zero.
+ */
+static Sample _getSilenceThreshold(void) {
+  const int bitDepth = getBitDepth() < kBitDepth24Bit ? (int)getBitDepth()
+                                                      : (int)kBitDepth24Bit;
+  return (Sample)(0.5 / (double)(1L << (bitDepth - 1)));
+}
+
+/**
+ * Check if the tail of a job has finished. Blocks which are still processing
+ * the end of the input, which is delayed by the plugin chain, are never
+ * counted as silent.
+ *
+ * @param outputSampleBuffer Last block written to the output, which ends at the
+ * current frame of the audio clock
+ * @param tailStartFrame Frame of the audio clock at which the tail starts
+ * @param silenceHoldFrames Frames of silence after which the tail is over
+ * @param silentFrames Number of consecutive silent frames so far, which is
+ * updated for this block
+ * @return True if the output has been silent for long enough
+ */
+static boolByte _isTailFinished(const SampleBuffer outputSampleBuffer,
+                                unsigned long tailStartFrame,
+                                unsigned long silenceHoldFrames,
+                                unsigned long *silentFrames) {
+  const unsigned long blockEnd = getAudioClock()->currentFrame;
+
+  if (blockEnd < tailStartFrame + outputSampleBuffer->blocksize) {
+    *silentFrames = 0;
+  } else if (sampleBufferGetPeak(outputSampleBuffer) <= _getSilenceThreshold()) {
+    *silentFrames += outputSampleBuffer->blocksize;
+  } else {
+    *silentFrames = 0;
+  }
+
+  return (boolByte)(*silentFrames >= silenceHoldFrames);
+}
+
+/**
+ * Process blocks of silence and discard the output, so that the plugins have
+ * done their first-block allocations and the chain's threads have touched
+ * their buffers and stacks before the first real block. The chain and audio
+ * clock are then reset, which also restarts the realtime clock, and the
+ * chain's timers are cleared, so the warmup changes neither the output nor the
+ * timing statistics.
+ *
+ * @param numBlocks Number of blocks of silence to process
+ */
+static void _warmUpPluginChain(PluginChain pluginChain,
+                               SampleBuffer inputSampleBuffer,
+                               SampleBuffer outputSampleBuffer,
+                               unsigned int numBlocks) {
+  unsigned int i;
+
+  logDebug("Warming up plugin chain with %u blocks", numBlocks);
+  memoryPrefaultStack();
+  inputSampleBuffer->blocksize = getBlocksize();
+  outputSampleBuffer->blocksize = getBlocksize();
+
+  for (i = 0; i < numBlocks; i++) {
+    sampleBufferClear(inputSampleBuffer);
+    pluginChainProcessAudio(pluginChain, inputSampleBuffer,
+                            outputSampleBuffer);
+    advanceAudioClock(getAudioClock(), getBlocksize());
+  }
+
+  sampleBufferClear(outputSampleBuffer);
+  pluginChainReset(pluginChain);
+  pluginChainResetTimers(pluginChain);
+  audioClockReset(getAudioClock());
+}
+
+/**
+ * Time the plugin chain while it processes noise at the current blocksize
+ * @param numFrames Minimum number of frames to process
+ * @param seed State of the noise generator, which is updated
+ * @return Time spent processing each frame, in milliseconds
+ */
+static double _benchmarkBlocksize(PluginChain pluginChain,
+                                  SampleBuffer inputSampleBuffer,
+                                  SampleBuffer outputSampleBuffer,
+                                  unsigned long numFrames,
+                                  unsigned int *seed) {
+  const SampleCount blocksize = getBlocksize();
+  uint64_t processingTimeInNs = 0;
+  uint64_t startTimeInNs;
+  unsigned long framesProcessed;
+  ChannelCount channel;
+  SampleCount frame;
+
+  inputSampleBuffer->blocksize = blocksize;
+  outputSampleBuffer->blocksize = blocksize;
+
+  for (framesProcessed = 0; framesProcessed < numFrames;
+       framesProcessed += blocksize) {
+    // Quiet noise, since some plugins take shortcuts when given silence
+    for (channel = 0; channel < inputSampleBuffer->numChannels; channel++) {
+      for (frame = 0; frame < blocksize; frame++) {
+        *seed = *seed * 1664525u + 1013904223u;
+        inputSampleBuffer->samples[channel][frame] =
+            (Sample)(((double)*seed / 4294967296.0 - 0.5) * 0.1);
+      }
+    }
+
+    startTimeInNs = taskTimerGetTimestampInNs();
+    pluginChainProcessAudio(pluginChain, inputSampleBuffer,
+                            outputSampleBuffer);
+    processingTimeInNs += taskTimerGetTimestampInNs() - startTimeInNs;
+    advanceAudioClock(getAudioClock(), blocksize);
+  }
+
+  return (double)processingTimeInNs / 1000000.0 / (double)framesProcessed;
+}
+
+/**
+ * Find the blocksize at which the plugin chain processes audio fastest. The
+ * candidates are the largest blocksize and each half of it, down to
+ * kMrsWatsonAutoBlocksizeMinimum, so that all of them evenly divide the I/O
+ * blocksize. Afterwards the fastest blocksize is set, and the chain, its
+ * timers and the audio clock are reset as after a warmup.
+ *
+ * @param maxBlocksize Largest blocksize to try, which the plugins must have
+ * been opened with
+ * @return Fastest blocksize
+ */
+static SampleCount _autoTuneBlocksize(PluginChain pluginChain,
+                                      SampleCount maxBlocksize) {
+  const unsigned long numFrames = (unsigned long)(
+      kMrsWatsonAutoBlocksizeBenchmarkInMs * getSampleRate() / 1000.0);
+  SampleBuffer inputSampleBuffer =
+      newSampleBuffer(getNumChannels(), maxBlocksize);
+  SampleBuffer outputSampleBuffer =
+      newSampleBuffer(getNumChannels(), maxBlocksize);
+  SampleCount bestBlocksize = maxBlocksize;
+  SampleCount blocksize;
+  double bestTimeInMs = 0.0;
+  double timeInMs;
+  unsigned int seed = 1;
+  unsigned int round;
+
+  logInfo("Timing plugin chain at blocksizes from %d to %d",
+          kMrsWatsonAutoBlocksizeMinimum, maxBlocksize);
+
+  for (round = 0; round < kMrsWatsonAutoBlocksizeRounds; round++) {
+    for (blocksize = maxBlocksize; blocksize >= kMrsWatsonAutoBlocksizeMinimum;
+         blocksize /= 2) {
+      setBlocksize(blocksize);
+      pluginChainReset(pluginChain);
+      timeInMs = _benchmarkBlocksize(pluginChain, inputSampleBuffer,
+                                     outputSampleBuffer, numFrames, &seed);
+      logDebug("Blocksize %d took %.3f ms per second of audio", blocksize,
+               timeInMs * getSampleRate());
+
+      if (bestTimeInMs == 0.0 || timeInMs < bestTimeInMs) {
+        bestTimeInMs = timeInMs;
+        bestBlocksize = blocksize;
+      }
+
+      // Halving an odd blocksize would not divide the I/O blocksize
+      if (blocksize % 2 != 0) {
+        break;
+      }
+    }
+  }
+
+  logInfo("Fastest blocksize is %d, taking %.3f ms per second of audio",
+          bestBlocksize, bestTimeInMs * getSampleRate());
+  setBlocksize(bestBlocksize);
+  pluginChainReset(pluginChain);
+  pluginChainResetTimers(pluginChain);
+  audioClockReset(getAudioClock());
+
+  freeSampleBuffer(inputSampleBuffer);
+  freeSampleBuffer(outputSampleBuffer);
+  return bestBlocksize;
+}
+
+typedef struct {
+  unsigned int numStems;
+  SampleSource *outputSources;
+  // Each stem is cut like the output, so each one needs its own count of the
+  // frames which were cut
+  SampleSource *silentOutputs;
+  // Holds one stem at a time, with as many channels as the output
+  SampleBuffer buffer;
+} _StemOutputsMembers;
+typedef _StemOutputsMembers *_StemOutputs;
+
+// Stems keep the extension of the output, so they are written in its format
+static CharString _getStemFilename(const CharString outputName,
+                                   unsigned int index) {
+  const char *extension = strrchr(outputName->data, '.');
+  CharString result = newCharStringWithCapacity(strlen(outputName->data) +
+                                                kCharStringLengthShort);
+
+  if (extension == NULL || strchr(extension, PATH_DELIMITER) != NULL) {
+    extension = outputName->data + strlen(outputName->data);
+  }
+
+  snprintf(result->data, result->capacity, "%.*s.stem%u%s",
+           (int)(extension - outputName->data), outputName->data, index + 1,
+           extension);
+  return result;
+}
+
+static void _freeStemOutputs(_StemOutputs self) {
+  unsigned int i;
+
+  if (self != NULL) {
+    for (i = 0; i < self->numStems; i++) {
+      freeSampleSource(self->outputSources[i]);
+      freeSampleSource(self->silentOutputs[i]);
+    }
+
+    free(self->outputSources);
+    free(self->silentOutputs);
+    freeSampleBuffer(self->buffer);
+    free(self);
+  }
+}
+
+/**
+ * Open a file for each stem of the outputs of the last plugin in the chain.
+ * The files are written in the background, with at least as many blocks of
+ * buffering as when converting the output behind the processing thread.
+ *
+ * @param outputSource Output source, which the stems are named after
+ * @param writeBehindBlocks Blocks given with --write-behind, or 0
+ * @param outStems Set to the opened stems, or NULL if the last plugin does not
+ * have more outputs than the output has channels
+ * @return RETURN_CODE_SUCCESS if all stems were opened
+ */
+static ReturnCode _openStemOutputs(const SampleSource outputSource,
+                                   const PluginChain pluginChain,
+                                   unsigned int flacLevel,
+                                   unsigned int flacThreads,
+                                   unsigned int writeBehindBlocks,
+                                   SampleCount ioBlocksize,
+                                   _StemOutputs *outStems) {
+  const ChannelCount numChannels = getNumChannels();
+  Plugin lastPlugin;
+  _StemOutputs self;
+  CharString filename;
+  SampleSource stemSource;
+  ChannelCount numOutputs;
+  unsigned int i;
+  ReturnCode result;
+
+  *outStems = NULL;
+
+  if (pluginChain->numPlugins == 0) {
+    logWarn("There is no plugin to write stems for");
+    return RETURN_CODE_SUCCESS;
+  }
+
+  lastPlugin = pluginChain->plugins[pluginChain->numPlugins - 1];
+  numOutputs = lastPlugin->outputBuffer->numChannels;
+
+  if (numOutputs <= numChannels) {
+    logWarn("Plugin '%s' has only %d outputs, not writing any stems",
+            lastPlugin->pluginName->data, numOutputs);
+    return RETURN_CODE_SUCCESS;
+  }
+
+  if (writeBehindBlocks < kMrsWatsonConvertBehindBlocks) {
+    writeBehindBlocks = kMrsWatsonConvertBehindBlocks;
+  }
+
+  self = (_StemOutputs)malloc(sizeof(_StemOutputsMembers));
+  // The last stem is padded with silent channels if it is not complete
+  self->numStems = (unsigned int)((numOutputs + numChannels - 1) / numChannels);
+  self->outputSources =
+      (SampleSource *)calloc(self->numStems, sizeof(SampleSource));
+  self->silentOutputs =
+      (SampleSource *)calloc(self->numStems, sizeof(SampleSource));
+  self->buffer = newSampleBuffer(numChannels, getBlocksize());
+
+  for (i = 0; i < self->numStems; i++) {
+    filename = _getStemFilename(outputSource->sourceName, i);
+    stemSource = sampleSourceFactory(filename);
+    freeCharString(filename);
+
+    if ((result = setupOutputSource(stemSource, flacLevel, flacThreads)) !=
+        RETURN_CODE_SUCCESS) {
+      freeSampleSource(stemSource);
+      _freeStemOutputs(self);
+      return result;
+    }
+
+    self->outputSources[i] = _writeBehindOutputSource(
+        stemSource, writeBehindBlocks, ioBlocksize, false);
+    self->silentOutputs[i] = sampleSourceFactory(NULL);
+  }
+
+  logInfo("Writing %d outputs of plugin '%s' to %u stems", numOutputs,
+          lastPlugin->pluginName->data, self->numStems);
+  *outStems = self;
+  return RETURN_CODE_SUCCESS;
+}
+
+/**
+ * Write the last block which the chain processed to each stem, cut in the same
+ * way as the output.
+ * @param self Stems to write, or NULL
+ * @param blocksize Number of frames which are written to the output
+ */
+static void _writeStemOutputs(_StemOutputs self, PluginChain pluginChain,
+                              SampleCount blocksize,
+                              unsigned long skipHeadFrames,
+                              unsigned long outputLengthInFrames) {
+  SampleBuffer outputs = pluginChainGetLastOutputs(pluginChain);
+  ChannelCount channel;
+  unsigned int outputIndex;
+  unsigned int i;
+
+  if (self == NULL) {
+    return;
+  }
+
+  self->buffer->blocksize = blocksize;
+
+  for (i = 0; i < self->numStems; i++) {
+    for (channel = 0; channel < self->buffer->numChannels; channel++) {
+      outputIndex = i * self->buffer->numChannels + channel;
+
+      if (outputs != NULL && outputIndex < outputs->numChannels) {
+        memcpy(self->buffer->samples[channel], outputs->samples[outputIndex],
+               sizeof(Sample) * blocksize);
+      } else {
+        memset(self->buffer->samples[channel], 0, sizeof(Sample) * blocksize);
+      }
+    }
+
+    writeOutput(self->outputSources[i], self->silentOutputs[i], self->buffer,
+                skipHeadFrames, outputLengthInFrames);
+  }
+}
+
+static void _closeStemOutputs(_StemOutputs self) {
+  unsigned int i;
+
+  if (self == NULL) {
+    return;
+  }
+
+  for (i = 0; i < self->numStems; i++) {
+    self->silentOutputs[i]->closeSampleSource(self->silentOutputs[i]);
+    self->outputSources[i]->closeSampleSource(self->outputSources[i]);
+  }
+
+  logInfo("Wrote %u stems of %ld frames", self->numStems,
+          self->outputSources[0]->numSamplesProcessed /
+              self->buffer->numChannels);
+}
+
+/**
+ * Run the main processing loop for a single input/output pair. Both sources
+ * must already be opened, and they will be closed when processing has
+ * finished.
+ *
+ * @param prerollFrames Frames at the start of the input which only settle the
+ * plugin chain, and which are cut from the output like the processing delay
+ * @param flushTail True to keep processing after the end of input for the
+ * tail time of the chain, instead of writing exactly as many frames as input
+ * @param stopOnSilenceInMs If greater than 0, keep processing after the end of
+ * input until the output has been silent for this long instead, which
+ * overrides flushTail
+ * @param ioBlocksize Requested number of frames to read and write at once, or 0
+ * to read and write one block at a time
+ * @param checkpointWriter Saves checkpoints while the input is read, or NULL
+ * @param sidechainSource Source of the chain's sidechain, which is read in step
+ * with the input and closed afterwards, or NULL
+ * @param stems Stems which are written along with the output and closed
+ * afterwards, or NULL
+ * @return Number of frames processed by the plugin chain
+ */
+static unsigned long _processJob(PluginChain pluginChain,
+                                 SampleSource inputSource,
+                                 SampleSource outputSource,
+                                 MidiSequence midiSequence,
+                                 unsigned long maxTimeInFrames,
+                                 unsigned long processingDelayInFrames,
+                                 unsigned long prerollFrames,
+                                 boolByte flushTail, double stopOnSilenceInMs,
+                                 SampleCount ioBlocksize,
+                                 SampleBuffer inputSampleBuffer,
+                                 SampleBuffer outputSampleBuffer,
+                                 TaskTimer inputTimer, TaskTimer outputTimer,
+                                 _CheckpointWriter checkpointWriter,
+                                 SampleSource sidechainSource,
+                                 _StemOutputs stems) {
+  AudioClock audioClock = getAudioClock();
+  const unsigned long skipHeadFrames = processingDelayInFrames + prerollFrames;
+  SampleSource silentSampleOutput = sampleSourceFactory(NULL);
+  LinkedList midiEventsForBlock = newLinkedList();
+  boolByte finishedReading = false;
+  unsigned long outputLengthInFrames = kMrsWatsonOutputLengthUnknown;
+  const unsigned long silenceHoldFrames =
+      (unsigned long)(stopOnSilenceInMs * getSampleRate() / 1000.0);
+  unsigned long tailStartFrame;
+  unsigned long silentFrames = 0;
+  boolByte mixNoteRenders = false;
+  Sample gain;
+
+  // The tail is flushed until it is silent, but never for longer than this
+  if (silenceHoldFrames > 0) {
+    flushTail = false;
+  }
+
+  // An instrument which only plays MIDI can be replaced by mixing renders of
+  // single notes, when the chain has a note render cache
+  if (midiSequence != NULL && prerollFrames == 0 && checkpointWriter == NULL &&
+      sidechainSource == NULL && stems == NULL &&
+      inputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_SILENCE) {
+    mixNoteRenders = pluginChainPrepareNoteRenders(pluginChain, midiSequence,
+                                                   _getSilenceThreshold());
+  }
+
+  inputSampleBuffer->blocksize = getBlocksize();
+  outputSampleBuffer->blocksize = getBlocksize();
+  ioBlocksize = _getIoBlocksize(ioBlocksize);
+
+  // A chain which only scales the audio can be skipped entirely when both files
+  // have the same format. The samples are scaled with the same rounding as in
+  // the chain, so the output does not depend on whether this is done. When
+  // dithering, the samples must still go through the conversion which adds the
+  // dither.
+  if (midiSequence == NULL && maxTimeInFrames == 0 &&
+      skipHeadFrames == 0 && sidechainSource == NULL && stems == NULL &&
+      getDitherType() == kDitherTypeNone &&
+      pluginChainGetLinearGain(pluginChain, &gain) &&
+      sampleSourcePcmCanCopy(inputSource, outputSource)) {
+    logInfo("Plugin chain only applies a gain of %g, copying samples directly",
+            gain);
+    taskTimerStart(outputTimer);
+    advanceAudioClock(audioClock, sampleSourcePcmCopyWithGain(
+                                      inputSource, outputSource, gain));
+    taskTimerStop(outputTimer);
+    finishedReading = true;
+  } else if (ioBlocksize > getBlocksize() && !mixNoteRenders &&
+             stems == NULL) {
+    _processJobInChunks(pluginChain, inputSource, sidechainSource,
+                        outputSource, silentSampleOutput, midiSequence,
+                        midiEventsForBlock, maxTimeInFrames, skipHeadFrames,
+                        prerollFrames, flushTail, ioBlocksize,
+                        inputSampleBuffer, outputSampleBuffer, inputTimer,
+                        outputTimer, checkpointWriter);
+    finishedReading = true;
+  }
+
+  while (!finishedReading) {
+    taskTimerStart(inputTimer);
+    finishedReading = (boolByte)!readInput(inputSource, inputSampleBuffer);
+    _readSidechainBlock(pluginChain, sidechainSource,
+                        inputSampleBuffer->blocksize);
+
+    if (midiSequence != NULL) {
+      _processMidiForBlock(mixNoteRenders ? NULL : pluginChain, midiSequence,
+                           midiEventsForBlock, &finishedReading);
+    }
+
+    taskTimerStop(inputTimer);
+
+    if (maxTimeInFrames > 0 && audioClock->currentFrame >= maxTimeInFrames) {
+      logInfo("Maximum time reached, stopping processing after this block");
+      finishedReading = true;
+    }
+
+    if (mixNoteRenders) {
+      pluginChainMixNoteRenders(pluginChain, outputSampleBuffer,
+                                audioClock->currentFrame);
+    } else {
+      pluginChainProcessAudio(pluginChain, inputSampleBuffer,
+                              outputSampleBuffer);
+    }
+
+    taskTimerStart(outputTimer);
+
+    if (finishedReading) {
+      outputSampleBuffer->blocksize =
+          inputSampleBuffer
+              ->blocksize; // The input buffer size has been adjusted.
+      logDebug("Using buffer size of %d for final block",
+               outputSampleBuffer->blocksize);
+    }
+
+    advanceAudioClock(audioClock, outputSampleBuffer->blocksize);
+
+    if (finishedReading) {
+      outputLengthInFrames = _getOutputLengthInFrames(
+          pluginChain, inputSource, midiSequence, prerollFrames, flushTail);
+    }
+
+    writeOutput(outputSource, silentSampleOutput, outputSampleBuffer,
+                skipHeadFrames, outputLengthInFrames);
+    _writeStemOutputs(stems, pluginChain, outputSampleBuffer->blocksize,
+                      skipHeadFrames, outputLengthInFrames);
+
+    if (!finishedReading) {
+      _writeCheckpointIfDue(checkpointWriter, pluginChain, outputSource);
+    }
+
+    taskTimerStop(outputTimer);
+  }
+
+  // The output of the chain lags behind its input by the processing delay,
+  // which also includes the delay of a pipelined chain. Push silence through
+  // the chain until the end of the input, and the tail if requested, has come
+  // out of the end.
+  outputLengthInFrames = _getOutputLengthInFrames(
+      pluginChain, inputSource, midiSequence, prerollFrames, flushTail);
+  tailStartFrame = skipHeadFrames + outputLengthInFrames;
+  inputSampleBuffer->blocksize = getBlocksize();
+
+  if (silenceHoldFrames > 0) {
+    outputLengthInFrames += (unsigned long)(kMrsWatsonMaxSilenceTailInMs *
+                                            getSampleRate() / 1000.0);
+  }
+
+  while (audioClock->currentFrame < skipHeadFrames + outputLengthInFrames) {
+    if (mixNoteRenders) {
+      pluginChainMixNoteRenders(pluginChain, outputSampleBuffer,
+                                audioClock->currentFrame);
+    } else {
+      // Like the input, the sidechain is silent while the tail is flushed
+      sampleBufferClear(inputSampleBuffer);
+      _readSidechainBlock(pluginChain, NULL, inputSampleBuffer->blocksize);
+      pluginChainProcessAudio(pluginChain, inputSampleBuffer,
+                              outputSampleBuffer);
+    }
+
+    advanceAudioClock(audioClock, outputSampleBuffer->blocksize);
+    taskTimerStart(outputTimer);
+    writeOutput(outputSource, silentSampleOutput, outputSampleBuffer,
+                skipHeadFrames, outputLengthInFrames);
+    _writeStemOutputs(stems, pluginChain, outputSampleBuffer->blocksize,
+                      skipHeadFrames, outputLengthInFrames);
+    taskTimerStop(outputTimer);
+
+    if (silenceHoldFrames > 0 &&
+        _isTailFinished(outputSampleBuffer, tailStartFrame, silenceHoldFrames,
+                        &silentFrames)) {
+      logInfo("Output was silent for %gms, stopping after %lu frames of tail",
+              stopOnSilenceInMs, audioClock->currentFrame - tailStartFrame);
+      break;
+    }
+  }
+
+  // Close file handles for input/output sources
+  silentSampleOutput->closeSampleSource(silentSampleOutput);
+  inputSource->closeSampleSource(inputSource);
+  outputSource->closeSampleSource(outputSource);
+  _closeStemOutputs(stems);
+
+  if (sidechainSource != NULL) {
+    sidechainSource->closeSampleSource(sidechainSource);
+  }
+
+  freeSampleSource(silentSampleOutput);
+  freeLinkedList(midiEventsForBlock);
+  audioClockStop(audioClock);
+
+  if (midiSequence == NULL) {
+    logInfo("Read %ld frames from %s",
+            inputSource->numSamplesProcessed / getNumChannels(),
+            inputSource->sourceName->data);
+  }
+
+  logInfo("Wrote %ld frames to %s",
+          outputSource->numSamplesProcessed / getNumChannels(),
+          outputSource->sourceName->data);
+  return audioClock->currentFrame;
+}
+
+/**
+ * Get the number of frames which a segment or range of the input starts
+ * processing before its first frame. Unless given with --segment-preroll, this
+ * is long enough for the processing delay and the tail of the plugin chain.
+ */
+static unsigned long _getPrerollFrames(ProgramOptions programOptions,
+                                       PluginChain pluginChain) {
+  if (programOptions->options[OPTION_SEGMENT_PREROLL]->enabled) {
+    return (unsigned long)(programOptionsGetNumber(programOptions,
+                                                   OPTION_SEGMENT_PREROLL) *
+                           getSampleRate() / 1000.0);
+  }
+
+  return (unsigned long)pluginChainGetProcessingDelay(pluginChain) +
+         (unsigned long)(pluginChainGetMaximumTailTimeInMs(pluginChain) *
+                         getSampleRate() / 1000.0);
+}
+
+/**
+ * Limit an opened input source to a segment of the input. Does nothing if the
+ * whole input should be rendered.
+ *
+ * @param inputSource Opened input source, which is replaced by the wrapped
+ * source. If the segment is invalid, the source is closed.
+ * @return RETURN_CODE_SUCCESS if the source covers the segment
+ */
+static ReturnCode _segmentInputSource(SampleSource *inputSource,
+                                      unsigned long startFrame,
+                                      unsigned long numFrames,
+                                      unsigned long prerollFrames) {
+  SampleSource segmentSource;
+
+  if (startFrame == 0 && numFrames == 0) {
+    return RETURN_CODE_SUCCESS;
+  }
+
+  segmentSource = newSampleSourceSegment(*inputSource, startFrame, numFrames,
+                                         prerollFrames);
+
+  if (segmentSource == NULL) {
+    logError("Invalid segment of %lu frames at frame %lu of '%s'", numFrames,
+             startFrame, (*inputSource)->sourceName->data);
+    (*inputSource)->closeSampleSource(*inputSource);
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  *inputSource = segmentSource;
+  return RETURN_CODE_SUCCESS;
+}
+
+/**
+ * Limit the input to the time range given with --start and --end. Audio inputs
+ * are wrapped in a segment source, which seeks to the start of the preroll when
+ * the input supports it. MIDI sequences are started at the preroll instead,
+ * since their silent input has no position.
+ *
+ * @param startFrame First frame of the range
+ * @param endFrame End of the range, or 0 to render until the end of input
+ * @param prerollFrames Requested preroll, which is shortened if the range
+ * starts closer than that to the start of the input
+ * @param inputSource Opened input source, which is replaced by the wrapped
+ * source. If the range is invalid, the source is closed.
+ * @param inputLengthInFrames Length of the input, or 0 if unknown. Receives the
+ * length of the range.
+ * @param outPrerollFrames Receives the preroll which is cut from the output
+ * @param outNumFrames Receives the length of the range, or 0 if it lasts until
+ * the end of the input
+ * @return RETURN_CODE_SUCCESS if the range is valid
+ */
+static ReturnCode _setupRange(unsigned long startFrame,
+                              unsigned long endFrame,
+                              unsigned long prerollFrames,
+                              MidiSequence midiSequence,
+                              SampleSource *inputSource,
+                              unsigned long *inputLengthInFrames,
+                              unsigned long *outPrerollFrames,
+                              unsigned long *outNumFrames) {
+  unsigned long numFrames = 0;
+  ReturnCode result;
+
+  if (endFrame > 0) {
+    if (endFrame <= startFrame) {
+      logError("--end must be after --start");
+      (*inputSource)->closeSampleSource(*inputSource);
+      return RETURN_CODE_INVALID_ARGUMENT;
+    }
+
+    numFrames = endFrame - startFrame;
+  }
+
+  if (*inputLengthInFrames > 0) {
+    if (startFrame >= *inputLengthInFrames) {
+      logError("--start is past the end of '%s'",
+               (*inputSource)->sourceName->data);
+      (*inputSource)->closeSampleSource(*inputSource);
+      return RETURN_CODE_INVALID_ARGUMENT;
+    }
+
+    if (numFrames == 0 || startFrame + numFrames > *inputLengthInFrames) {
+      *inputLengthInFrames -= startFrame;
+    } else {
+      *inputLengthInFrames = numFrames;
+    }
+  }
+
+  if (prerollFrames > startFrame) {
+    prerollFrames = startFrame;
+  }
+
+  logInfo("Rendering from frame %lu with %lu frames of preroll", startFrame,
+          prerollFrames);
+
+  if (midiSequence != NULL) {
+    midiSequenceSetStartTimestamp(midiSequence, startFrame - prerollFrames);
+  } else if ((result = _segmentInputSource(inputSource, startFrame, numFrames,
+                                           prerollFrames)) !=
+             RETURN_CODE_SUCCESS) {
+    return result;
+  }
+
+  *outPrerollFrames = prerollFrames;
+  *outNumFrames = numFrames;
+  return RETURN_CODE_SUCCESS;
+}
+
+/**
+ * Create the checkpoint for a render which saves checkpoints or is resumed.
+ * When resuming, the checkpoint of the interrupted render is loaded, and the
+ * plugins get back their saved state.
+ *
+ * @param startFrame First frame of the range to render. When resuming, this
+ * receives the input frame where the checkpoint was saved.
+ * @param endFrame End of the range to render, or 0 for the end of the input
+ * @param outCheckpoint Receives the checkpoint, or NULL on failure
+ * @return RETURN_CODE_SUCCESS if the checkpoint matches this render
+ */
+static ReturnCode _setupCheckpoint(boolByte resume, SampleSource inputSource,
+                                   SampleSource outputSource,
+                                   PluginChain pluginChain,
+                                   unsigned long *startFrame,
+                                   unsigned long endFrame,
+                                   RenderCheckpoint *outCheckpoint) {
+  RenderCheckpoint checkpoint = newRenderCheckpoint();
+  CharString filename;
+  boolByte result;
+
+  *outCheckpoint = NULL;
+
+  if (!resume) {
+    // Paths may be longer than the default string capacity
+    freeCharString(checkpoint->inputSource);
+    checkpoint->inputSource =
+        newCharStringWithCString(inputSource->sourceName->data);
+    freeCharString(checkpoint->outputSource);
+    checkpoint->outputSource =
+        newCharStringWithCString(outputSource->sourceName->data);
+    *outCheckpoint = checkpoint;
+    return RETURN_CODE_SUCCESS;
+  }
+
+  filename = renderCheckpointGetFilename(outputSource->sourceName);
+  result = renderCheckpointRead(checkpoint, filename);
+  freeCharString(filename);
+
+  if (!result) {
+    freeRenderCheckpoint(checkpoint);
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  // The output before the checkpoint was rendered from the same range, so its
+  // first frame must be the start of the range
+  if (!charStringIsEqualTo(checkpoint->inputSource, inputSource->sourceName,
+                           false) ||
+      !charStringIsEqualTo(checkpoint->outputSource, outputSource->sourceName,
+                           false) ||
+      checkpoint->inputFrame < checkpoint->outputFrame ||
+      checkpoint->inputFrame - checkpoint->outputFrame != *startFrame ||
+      (endFrame > 0 && checkpoint->inputFrame >= endFrame)) {
+    logError("Checkpoint was saved by a render of a different input, output, "
+             "or range");
+    freeRenderCheckpoint(checkpoint);
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  if (!_restoreCheckpointPluginStates(pluginChain, checkpoint)) {
+    freeRenderCheckpoint(checkpoint);
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  logInfo("Resuming from checkpoint at input frame %lu, output frame %lu, "
+          "clock frame %lu",
+          checkpoint->inputFrame, checkpoint->outputFrame,
+          checkpoint->clockFrame);
+  *startFrame = checkpoint->inputFrame;
+  *outCheckpoint = checkpoint;
+  return RETURN_CODE_SUCCESS;
+}
+
+/**
+ * Check that an output which was opened for resuming continues where the
+ * checkpoint was saved, which is not the case if it was written again with a
+ * different format in the meantime.
+ */
+static ReturnCode _verifyResumedOutput(SampleSource outputSource,
+                                       RenderCheckpoint checkpoint) {
+  if (sampleSourcePcmFlush(outputSource) != checkpoint->outputOffset) {
+    logError("Output '%s' does not match its checkpoint",
+             outputSource->sourceName->data);
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  return RETURN_CODE_SUCCESS;
+}
+
+/**
+ * Remove the checkpoint of an output once it has been rendered completely.
+ */
+static void _removeCheckpoint(const CharString outputSource) {
+  CharString filename = renderCheckpointGetFilename(outputSource);
+  File file = newFileWithPath(filename);
+
+  if (fileExists(file) && !fileRemove(file)) {
+    logWarn("Could not remove checkpoint '%s'", filename->data);
+  }
+
+  freeFile(file);
+  freeCharString(filename);
+}
+
+/**
+ * Open the sources for the next job in an input list. Jobs whose input has a
+ * different sample rate or channel count than the first job are rejected, since
+ * the plugin chain has already been configured for those settings.
+ *
+ * @param sharedOutputSource Output prepared with
+ * sampleSourcePcmPrepareRegions() which the job writes its segment of, or NULL
+ * to write to the output of the job
+ * @return RETURN_CODE_SUCCESS if both sources were opened
+ */
+static ReturnCode _setupInputListJob(_InputListJob job,
+                                     SampleSource sharedOutputSource,
+                                     boolByte mapInput,
+                                     unsigned int prefetchBlocks,
+                                     unsigned int writeBehindBlocks,
+                                     SampleCount ioBlocksize,
+                                     unsigned int flacLevel,
+                                     unsigned int flacThreads,
+                                     SampleRate resampleRate,
+                                     ResamplerQuality resampleQuality,
+                                     SampleSource *outInputSource,
+                                     SampleSource *outOutputSource) {
+  const SampleRate sampleRate = getSampleRate();
+  const ChannelCount numChannels = getNumChannels();
+  ReturnCode result;
+
+  *outInputSource =
+      sampleSourceCacheWrap(sampleSourceFactory(job->inputSource));
+  *outOutputSource =
+      sharedOutputSource != NULL
+          ? newSampleSourcePcmRegion(sharedOutputSource, job->startFrame)
+          : sampleSourceFactory(job->outputSource);
+
+  if ((result = setupInputSource(*outInputSource, mapInput)) !=
+      RETURN_CODE_SUCCESS) {
+    return result;
+  }
+
+  *outInputSource =
+      _resampleInputSource(*outInputSource, resampleRate, resampleQuality);
+
+  if (getSampleRate() != sampleRate || getNumChannels() != numChannels) {
+    logError("Input source '%s' does not match the sample rate or channel "
+             "count of the first job",
+             job->inputSource->data);
+    (*outInputSource)->closeSampleSource(*outInputSource);
+    setSampleRate(sampleRate);
+    setNumChannels(numChannels);
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  if ((result = _segmentInputSource(outInputSource, job->startFrame,
+                                    job->numFrames, job->prerollFrames)) !=
+      RETURN_CODE_SUCCESS) {
+    return result;
+  }
+
+  if ((result = setupOutputSource(*outOutputSource, flacLevel,
+                                 flacThreads)) !=
+      RETURN_CODE_SUCCESS) {
+    (*outInputSource)->closeSampleSource(*outInputSource);
+    return result;
+  }
+
+  *outInputSource =
+      _prefetchInputSource(*outInputSource, prefetchBlocks, ioBlocksize);
+  *outOutputSource = _writeBehindOutputSource(
+      *outOutputSource, writeBehindBlocks, ioBlocksize, false);
+  return RETURN_CODE_SUCCESS;
+}
+
+typedef struct {
+  _InputListJob *jobs;
+  unsigned int numJobs;
+  // Index of the next job which has not been claimed by any thread yet
+  volatile unsigned int nextJob;
+  boolByte mapInput;
+  unsigned int prefetchBlocks;
+  unsigned int writeBehindBlocks;
+  SampleCount ioBlocksize;
+  unsigned int flacLevel;
+  unsigned int flacThreads;
+  SampleRate resampleRate;
+  ResamplerQuality resampleQuality;
+  unsigned long maxTimeInFrames;
+  // Only used by worker threads, which build their own plugin chain
+  CharString pluginChainString;
+  CharString pluginSearchRoot;
+  LinkedList parameters;
+  PluginAutomation automation;
+  boolByte pipelined;
+  boolByte skipSilence;
+  boolByte flushDenormals;
+  boolByte channelInstances;
+  boolByte parallelLoading;
+  LinkedList serialLoadPlugins;
+  LinkedList midiRoutes;
+  CharString isolatedHost;
+  double watchdogBudgetInMs;
+  ErrorReporter errorReporter;
+  boolByte flushTail;
+  double stopOnSilenceInMs;
+  unsigned int warmupBlocks;
+  // Output which segments write their part of directly, or NULL if each job
+  // writes to its own output
+  SampleSource sharedOutputSource;
+  // Hashes which segments add their blocks to, or NULL if the output is not
+  // hashed
+  OutputHashes outputHashes;
+  // Guarded by mutex, since these are updated by all threads
+  Mutex mutex;
+  unsigned long framesProcessed;
+  boolByte failed;
+} _InputListWorkersMembers;
+typedef _InputListWorkersMembers *_InputListWorkers;
+
+typedef struct {
+  _InputListWorkers workers;
+  RenderContext renderContext;
+  Thread thread;
+} _InputListWorkerMembers;
+typedef _InputListWorkerMembers *_InputListWorker;
+
+/**
+ * Called by the plugin watchdog when a plugin hangs. The processing thread is
+ * still stuck in the plugin, so the only way out is to exit from here.
+ */
+static void _pluginWatchdogExpired(const PluginChain pluginChain,
+                                   const Plugin plugin,
+                                   unsigned long blockIndex,
+                                   double elapsedTimeInMs, void *userData) {
+  ErrorReporter errorReporter = (ErrorReporter)userData;
+
+  logError("Plugin '%s' has been processing block %lu for %.0fms, which is "
+           "over the watchdog budget",
+           plugin->pluginName->data, blockIndex, elapsedTimeInMs);
+  logError("The plugin appears to be hung, aborting");
+
+  if (errorReporter != NULL && errorReporter->started) {
+    errorReporterWritePerformanceSnapshot(errorReporter, pluginChain,
+                                          "watchdog");
+    errorReporterClose(errorReporter);
+  }
+
+  exit(RETURN_CODE_PLUGIN_ERROR);
+}
+
+/**
+ * Start a plugin watchdog for a plugin chain, if a budget was given
+ * @return Started watchdog, or NULL if none is used
+ */
+static PluginWatchdog _startPluginWatchdog(PluginChain pluginChain,
+                                           double budgetInMs,
+                                           ErrorReporter errorReporter) {
+  PluginWatchdog watchdog;
+
+  if (budgetInMs <= 0.0) {
+    return NULL;
+  }
+
+  watchdog = newPluginWatchdog(pluginChain, budgetInMs, _pluginWatchdogExpired,
+                               errorReporter);
+
+  if (!pluginWatchdogStart(watchdog)) {
+    logWarn("Processing without a plugin watchdog");
+    freePluginWatchdog(watchdog);
+    return NULL;
+  }
+
+  return watchdog;
+}
+
+/**
+ * Process jobs from an input list until none are left. This may be called from
+ * several threads at once, in which case each job is only processed by one of
+ * them. The plugin chain must already be prepared for processing.
+ */
+static void _processInputListJobs(_InputListWorkers workers,
+                                  PluginChain pluginChain,
+                                  unsigned long processingDelayInFrames,
+                                  SampleBuffer inputSampleBuffer,
+                                  SampleBuffer outputSampleBuffer,
+                                  TaskTimer inputTimer,
+                                  TaskTimer outputTimer) {
+  SampleSource inputSource;
+  SampleSource outputSource;
+  SampleSource hashedSource;
+  unsigned long framesProcessed;
+  ReturnCode result;
+  unsigned int job;
+
+  while ((job = atomicAdd(&(workers->nextJob), 1) - 1) < workers->numJobs) {
+    logInfo("Starting job %d of %d", job + 1, workers->numJobs);
+    pluginChainReset(pluginChain);
+    audioClockReset(getAudioClock());
+
+    result = _setupInputListJob(
+        workers->jobs[job], workers->sharedOutputSource, workers->mapInput,
+        workers->prefetchBlocks, workers->writeBehindBlocks,
+        workers->ioBlocksize, workers->flacLevel, workers->flacThreads,
+        workers->resampleRate, workers->resampleQuality, &inputSource,
+        &outputSource);
+
+    if (result != RETURN_CODE_SUCCESS) {
+      logError("Skipping job %d, sources could not be opened", job + 1);
+      freeSampleSource(inputSource);
+      freeSampleSource(outputSource);
+      mutexLock(workers->mutex);
+      workers->failed = true;
+      mutexUnlock(workers->mutex);
+      continue;
+    }
+
+    if (workers->outputHashes != NULL) {
+      hashedSource = newSampleSourceHasher(
+          outputSource, workers->outputHashes, workers->jobs[job]->startFrame);
+
+      if (hashedSource != NULL) {
+        outputSource = hashedSource;
+      } else {
+        logWarn("Output of job %d cannot be hashed", job + 1);
+      }
+    }
+
+    // Only the last segment of an input has a tail
+    framesProcessed = _processJob(
+        pluginChain, inputSource, outputSource, NULL, workers->maxTimeInFrames,
+        processingDelayInFrames, workers->jobs[job]->prerollFrames,
+        (boolByte)(workers->flushTail && workers->jobs[job]->numFrames == 0),
+        workers->jobs[job]->numFrames == 0 ? workers->stopOnSilenceInMs : 0.0,
+        workers->ioBlocksize, inputSampleBuffer, outputSampleBuffer,
+        inputTimer, outputTimer, NULL, NULL, NULL);
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+
+    mutexLock(workers->mutex);
+    workers->framesProcessed += framesProcessed;
+    mutexUnlock(workers->mutex);
+  }
+}
+
+/**
+ * Thread function for processing input list jobs with a separate plugin chain.
+ * The chain is built and initialized in the worker's own render context, so
+ * that its plugins see the settings of that context.
+ */
+static void _inputListWorkerThread(void *userData) {
+  _InputListWorker worker = (_InputListWorker)userData;
+  _InputListWorkers workers = worker->workers;
+  PluginChain pluginChain;
+  SampleBuffer inputSampleBuffer;
+  SampleBuffer outputSampleBuffer;
+  TaskTimer inputTimer, outputTimer;
+  PluginWatchdog watchdog;
+
+  renderContextMakeCurrent(worker->renderContext);
+  pluginChain = getPluginChain();
+  pluginChainSetPipelined(pluginChain, workers->pipelined);
+  pluginChainSetSkipSilence(pluginChain, workers->skipSilence);
+  pluginChainSetFlushDenormals(pluginChain, workers->flushDenormals);
+  pluginChainSetChannelInstances(pluginChain, workers->channelInstances);
+  pluginChainSetParallelLoading(pluginChain, workers->parallelLoading);
+  pluginChainSetSerialLoadPlugins(pluginChain, workers->serialLoadPlugins);
+  pluginChainSetMidiRoutes(pluginChain, workers->midiRoutes);
+  pluginChainSetIsolatedHost(pluginChain, workers->isolatedHost);
+  pluginChainSetAutomation(pluginChain, workers->automation);
+
+  if (buildPluginChain(pluginChain, workers->pluginChainString,
+                       workers->pluginSearchRoot) != RETURN_CODE_SUCCESS ||
+      pluginChainInitialize(pluginChain) != RETURN_CODE_SUCCESS ||
+      !pluginChainSetParameters(pluginChain, workers->parameters)) {
+    // The jobs are still processed by the other threads
+    logError("Worker thread could not load the plugin chain");
+    renderContextMakeCurrent(NULL);
+    return;
+  }
+
+  inputSampleBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  outputSampleBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  inputTimer = newTaskTimerWithCString(PROGRAM_NAME, "Input Source");
+  outputTimer = newTaskTimerWithCString(PROGRAM_NAME, "Output Source");
+  pluginChainPrepareForProcessing(pluginChain);
+  if (workers->warmupBlocks > 0) {
+    _warmUpPluginChain(pluginChain, inputSampleBuffer, outputSampleBuffer,
+                       workers->warmupBlocks);
+  }
+  watchdog = _startPluginWatchdog(pluginChain, workers->watchdogBudgetInMs,
+                                  workers->errorReporter);
+
+  _processInputListJobs(workers, pluginChain,
+                        pluginChainGetProcessingDelay(pluginChain),
+                        inputSampleBuffer, outputSampleBuffer, inputTimer,
+                        outputTimer);
+  freePluginWatchdog(watchdog);
+
+  if (pluginChainHasCrashedPlugins(pluginChain)) {
+    mutexLock(workers->mutex);
+    workers->failed = true;
+    mutexUnlock(workers->mutex);
+  }
+
+  pluginChainShutdown(pluginChain);
+  freeSampleBuffer(inputSampleBuffer);
+  freeSampleBuffer(outputSampleBuffer);
+  freeTaskTimer(inputTimer);
+  freeTaskTimer(outputTimer);
+  renderContextMakeCurrent(NULL);
+}
+
+/**
+ * Start worker threads for an input list, each with its own render context.
+ * The render contexts copy the calling thread's current audio settings.
+ * @return List of _InputListWorker items, which must be freed with
+ * _joinInputListWorker() once all jobs have been processed
+ */
+static LinkedList _startInputListWorkers(_InputListWorkers workers,
+                                         unsigned int numWorkers) {
+  LinkedList result = newLinkedList();
+  _InputListWorker worker;
+  unsigned int i;
+
+  for (i = 0; i < numWorkers; i++) {
+    worker = (_InputListWorker)malloc(sizeof(_InputListWorkerMembers));
+    worker->workers = workers;
+    worker->renderContext = newRenderContext();
+    worker->thread = newThread(_inputListWorkerThread, worker);
+
+    if (worker->thread == NULL) {
+      logWarn("Could not start worker thread");
+      freeRenderContext(worker->renderContext);
+      free(worker);
+      break;
+    }
+
+    linkedListAppend(result, worker);
+  }
+
+  return result;
+}
+
+static void _joinInputListWorker(void *item) {
+  _InputListWorker worker = (_InputListWorker)item;
+  threadJoinAndFree(worker->thread);
+  freeRenderContext(worker->renderContext);
+  free(worker);
+}
+
+typedef struct {
+  _InputListWorkers workers;
+  CharString address;
+  // Copied from the audio settings before the thread is started
+  SampleRate sampleRate;
+  SampleCount blocksize;
+  Thread thread;
+} _JobDispatcherMembers;
+typedef _JobDispatcherMembers *_JobDispatcher;
+
+/**
+ * Send a job to a server and wait for it to finish
+ * @return True if the server replied that the job was processed
+ */
+static boolByte _dispatchJob(Socket connection, RenderRequest request,
+                             unsigned long *outFramesProcessed) {
+  CharString line = renderRequestFormat(request);
+  CharString reply = newCharString();
+  boolByte result = false;
+
+  if (socketWriteLine(connection, line) && socketReadLine(connection, reply)) {
+    if (!strncmp(reply->data, "OK\t", 3)) {
+      *outFramesProcessed = strtoul(reply->data + 3, NULL, 10);
+      result = true;
+    } else {
+      logError("Server replied '%s' to job for '%s'", reply->data,
+               request->outputSource->data);
+    }
+  } else {
+    logError("Lost connection to server while processing '%s'",
+             request->outputSource->data);
+  }
+
+  freeCharString(line);
+  freeCharString(reply);
+  return result;
+}
+
+/**
+ * Thread function which hands input list jobs to a server started with --serve,
+ * claiming them from the same list as the local worker threads. If the server
+ * cannot be reached, its jobs are simply processed by the other threads.
+ */
+static void _jobDispatcherThread(void *userData) {
+  _JobDispatcher dispatcher = (_JobDispatcher)userData;
+  _InputListWorkers workers = dispatcher->workers;
+  Socket connection = newSocketConnected(dispatcher->address);
+  RenderRequest request;
+  LinkedListIterator iterator;
+  const char *parameter;
+  char *parameterCopy;
+  _InputListJob job;
+  unsigned long framesProcessed;
+  unsigned int index;
+
+  if (connection == NULL) {
+    logWarn("Server '%s' is not available, not sending it any jobs",
+            dispatcher->address->data);
+    return;
+  }
+
+  request = newRenderRequest();
+  charStringCopy(request->pluginChain, workers->pluginChainString);
+  request->sampleRate = dispatcher->sampleRate;
+  request->blocksize = dispatcher->blocksize;
+
+  for (iterator = linkedListBegin(workers->parameters); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    // The request frees its parameters, so it gets its own copies
+    parameter = (const char *)linkedListIteratorGetItem(iterator);
+    parameterCopy = (char *)malloc(strlen(parameter) + 1);
+    strcpy(parameterCopy, parameter);
+    linkedListAppend(request->parameters, parameterCopy);
+  }
+
+  while ((index = atomicAdd(&(workers->nextJob), 1) - 1) < workers->numJobs) {
+    job = workers->jobs[index];
+    logInfo("Sending job %d of %d to server '%s'", index + 1, workers->numJobs,
+            dispatcher->address->data);
+    freeCharString(request->inputSource);
+    request->inputSource = newCharStringWithCString(job->inputSource->data);
+    freeCharString(request->outputSource);
+    request->outputSource = newCharStringWithCString(job->outputSource->data);
+    request->startFrame = job->startFrame;
+    request->numFrames = job->numFrames;
+    request->prerollFrames = job->prerollFrames;
+
+    if (!_dispatchJob(connection, request, &framesProcessed)) {
+      mutexLock(workers->mutex);
+      workers->failed = true;
+      mutexUnlock(workers->mutex);
+      // The connection may be in an unknown state, so leave the remaining
+      // jobs to the other threads
+      break;
+    }
+
+    mutexLock(workers->mutex);
+    workers->framesProcessed += framesProcessed;
+    mutexUnlock(workers->mutex);
+  }
+
+  freeRenderRequest(request);
+  freeSocket(connection);
+}
+
+/**
+ * Start a thread for each server which jobs should be sent to
+ * @param addresses List of C string addresses, in the same format as --serve
+ * @return List of _JobDispatcher items, which must be freed with
+ * _joinJobDispatcher() once all jobs have been processed
+ */
+static LinkedList _startJobDispatchers(_InputListWorkers workers,
+                                       const LinkedList addresses) {
+  LinkedList result = newLinkedList();
+  LinkedListIterator iterator;
+  _JobDispatcher dispatcher;
+
+  for (iterator = linkedListBegin(addresses); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    dispatcher = (_JobDispatcher)malloc(sizeof(_JobDispatcherMembers));
+    dispatcher->workers = workers;
+    dispatcher->address = newCharStringWithCString(
+        (const char *)linkedListIteratorGetItem(iterator));
+    dispatcher->sampleRate = getSampleRate();
+    dispatcher->blocksize = getBlocksize();
+    dispatcher->thread = newThread(_jobDispatcherThread, dispatcher);
+
+    if (dispatcher->thread == NULL) {
+      logWarn("Could not start thread for server '%s'",
+              dispatcher->address->data);
+      freeCharString(dispatcher->address);
+      free(dispatcher);
+      continue;
+    }
+
+    linkedListAppend(result, dispatcher);
+  }
+
+  return result;
+}
+
+static void _joinJobDispatcher(void *item) {
+  _JobDispatcher dispatcher = (_JobDispatcher)item;
+  threadJoinAndFree(dispatcher->thread);
+  freeCharString(dispatcher->address);
+  free(dispatcher);
+}
+
+/**
+ * Split the input into segments which are rendered as separate jobs, and
+ * replace the input and output with those of the first segment. The jobs write
+ * to temporary files next to the final output, which are joined by
+ * _joinSegmentFiles() once all of them have finished, unless the output is
+ * later shared with _shareSegmentOutput().
+ *
+ * @param inputSource Opened input source, which is replaced by its first
+ * segment
+ * @param outputSource Final output source, which is replaced by the output of
+ * the first segment
+ * @param outFinalOutputSource Set to the final output source, or NULL if the
+ * input is too short to be split
+ * @param outJobs Set to a list of _InputListJob items for the segments
+ * @return RETURN_CODE_SUCCESS if the segments were set up
+ */
+static ReturnCode _setupSegments(unsigned int numSegments,
+                                 unsigned long prerollFrames,
+                                 unsigned long inputLengthInFrames,
+                                 SampleSource *inputSource,
+                                 SampleSource *outputSource,
+                                 SampleSource *outFinalOutputSource,
+                                 LinkedList *outJobs) {
+  RenderSegment segments;
+  _InputListJob job;
+  unsigned int i;
+  ReturnCode result;
+
+  *outFinalOutputSource = NULL;
+  *outJobs = NULL;
+
+  if (inputLengthInFrames == 0) {
+    logError("Input source must have a known length to be rendered in "
+             "segments");
+    return RETURN_CODE_INVALID_ARGUMENT;
+  } else if (*outputSource == NULL) {
+    logError("No output source to render segments for");
+    return RETURN_CODE_MISSING_REQUIRED_OPTION;
+  }
+
+  segments = newRenderSegments(inputLengthInFrames, numSegments,
+                               getBlocksize(), prerollFrames, &numSegments);
+
+  if (numSegments < 2) {
+    logInfo("Input is too short to be split, rendering it in one piece");
+    freeRenderSegments(segments);
+    return RETURN_CODE_SUCCESS;
+  }
+
+  logInfo("Rendering %u segments of %lu frames, with %lu frames of preroll",
+          numSegments, segments[0].numFrames, prerollFrames);
+  *outJobs = newLinkedList();
+
+  for (i = 0; i < numSegments; i++) {
+    job = (_InputListJob)malloc(sizeof(_InputListJobMembers));
+    job->inputSource =
+        newCharStringWithCString((*inputSource)->sourceName->data);
+    job->outputSource = newCharStringWithCapacity(
+        strlen((*outputSource)->sourceName->data) + kCharStringLengthShort);
+    renderSegmentGetFilename((*outputSource)->sourceName, i, job->outputSource);
+    job->startFrame = segments[i].startFrame;
+    job->numFrames = segments[i].numFrames;
+    job->prerollFrames = segments[i].prerollFrames;
+    linkedListAppend(*outJobs, job);
+  }
+
+  freeRenderSegments(segments);
+  job = (_InputListJob)linkedListBegin(*outJobs)->item;
+
+  if ((result = _segmentInputSource(inputSource, job->startFrame,
+                                    job->numFrames, job->prerollFrames)) !=
+      RETURN_CODE_SUCCESS) {
+    return result;
+  }
+
+  *outFinalOutputSource = *outputSource;
+  *outputSource = sampleSourceFactory(job->outputSource);
+  return RETURN_CODE_SUCCESS;
+}
+
+/**
+ * Join the files which the segments of an input were rendered to into the final
+ * output, and remove them afterwards.
+ *
+ * @param removeOnly True to only remove the segment files, for example because
+ * some of the segments could not be rendered
+ * @return RETURN_CODE_SUCCESS if the output was written
+ */
+static ReturnCode _joinSegmentFiles(SampleSource outputSource,
+                                    _InputListJob *jobs, unsigned int numJobs,
+                                    unsigned int flacLevel,
+                                    unsigned int flacThreads,
+                                    boolByte removeOnly) {
+  const DitherType ditherType = getDitherType();
+  SampleBuffer buffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  SampleSource segment;
+  File segmentFile;
+  ReturnCode result = RETURN_CODE_SUCCESS;
+  boolByte moreBlocks;
+  unsigned int i;
+
+  // The segments were already dithered when they were rendered, and their
+  // samples should be copied as they are
+  setDitherType(kDitherTypeNone);
+
+  if (!removeOnly) {
+    result = setupOutputSource(outputSource, flacLevel, flacThreads);
+  }
+
+  for (i = 0; i < numJobs; i++) {
+    if (result == RETURN_CODE_SUCCESS && !removeOnly) {
+      segment = sampleSourceFactory(jobs[i]->outputSource);
+
+      if (!segment->openSampleSource(segment, SAMPLE_SOURCE_OPEN_READ)) {
+        logError("Could not read segment '%s'", jobs[i]->outputSource->data);
+        result = RETURN_CODE_IO_ERROR;
+      } else {
+        if (sampleSourcePcmCanCopy(segment, outputSource)) {
+          sampleSourcePcmCopy(segment, outputSource);
+        } else {
+          do {
+            buffer->blocksize = getBlocksize();
+            moreBlocks = segment->readSampleBlock(segment, buffer);
+
+            if (buffer->blocksize > 0) {
+              outputSource->writeSampleBlock(outputSource, buffer);
+            }
+          } while (moreBlocks);
+        }
+
+        segment->closeSampleSource(segment);
+      }
+
+      freeSampleSource(segment);
+    }
+
+    segmentFile = newFileWithPath(jobs[i]->outputSource);
+
+    if (segmentFile->fileType == kFileTypeFile && !fileRemove(segmentFile)) {
+      logWarn("Could not remove segment '%s'", jobs[i]->outputSource->data);
+    }
+
+    freeFile(segmentFile);
+  }
+
+  if (!removeOnly && outputSource->openedAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    outputSource->closeSampleSource(outputSource);
+  }
+
+  if (result == RETURN_CODE_SUCCESS && !removeOnly) {
+    logInfo("Joined %u segments into '%s'", numJobs,
+            outputSource->sourceName->data);
+  }
+
+  setDitherType(ditherType);
+  freeSampleBuffer(buffer);
+  return result;
+}
+
+/**
+ * Open the final output so that all segments can write their part of it
+ * directly, which saves writing them to separate files and joining those.
+ * This only works for PCM and WAVE files, since other formats cannot be
+ * written out of order.
+ *
+ * @param numFrames Expected length of the output
+ * @return True if the output was opened and prepared for the segments
+ */
+static boolByte _shareSegmentOutput(SampleSource outputSource,
+                                    unsigned long numFrames,
+                                    unsigned int flacLevel,
+                                    unsigned int flacThreads) {
+  if ((outputSource->sampleSourceType != SAMPLE_SOURCE_TYPE_PCM &&
+       outputSource->sampleSourceType != SAMPLE_SOURCE_TYPE_WAVE) ||
+      charStringIsEqualToCString(outputSource->sourceName, "-", false) ||
+      setupOutputSource(outputSource, flacLevel, flacThreads) !=
+          RETURN_CODE_SUCCESS) {
+    return false;
+  }
+
+  if (!sampleSourcePcmPrepareRegions(outputSource, numFrames)) {
+    outputSource->closeSampleSource(outputSource);
+    return false;
+  }
+
+  logInfo("Segments are written directly to '%s'",
+          outputSource->sourceName->data);
+  return true;
+}
+
+/**
+ * Close an output which all segments have written their part of. If any of
+ * them failed, the output is incomplete and is removed instead.
+ * @return RETURN_CODE_SUCCESS if the output was finished
+ */
+static ReturnCode _finishSharedSegmentOutput(SampleSource outputSource,
+                                             boolByte failed) {
+  File outputFile;
+
+  if (!failed) {
+    logDebug("Segments wrote %lu frames to '%s'",
+             sampleSourcePcmFinishRegions(outputSource),
+             outputSource->sourceName->data);
+    outputSource->closeSampleSource(outputSource);
+    return RETURN_CODE_SUCCESS;
+  }
+
+  outputSource->closeSampleSource(outputSource);
+  outputFile = newFileWithPath(outputSource->sourceName);
+
+  if (outputFile->fileType == kFileTypeFile && !fileRemove(outputFile)) {
+    logWarn("Could not remove incomplete output '%s'",
+            outputSource->sourceName->data);
+  }
+
+  freeFile(outputFile);
+  return RETURN_CODE_IO_ERROR;
+}
+
+typedef struct {
+  CharString pluginSearchRoot;
+  boolByte mapInput;
+  unsigned int prefetchBlocks;
+  unsigned int writeBehindBlocks;
+  SampleCount ioBlocksize;
+  unsigned int flacLevel;
+  unsigned int flacThreads;
+  boolByte pipelined;
+  boolByte skipSilence;
+  // Maximum size of the note render cache of each chain, or 0 for none
+  size_t noteCacheSize;
+  boolByte flushDenormals;
+  boolByte channelInstances;
+  boolByte parallelLoading;
+  LinkedList serialLoadPlugins;
+  LinkedList midiRoutes;
+  CharString isolatedHost;
+  boolByte flushTail;
+  double stopOnSilenceInMs;
+  unsigned int warmupBlocks;
+  // Audio settings which are used when a job does not override them
+  SampleRate sampleRate;
+  SampleCount blocksize;
+  ChannelCount numChannels;
+  // Number of forked processes which accept jobs, or 0 to accept them in this
+  // process, and the chain which is loaded before forking them, if any
+  unsigned int numWorkers;
+  CharString preloadPluginChain;
+} _RenderServerSettings;
+
+/**
+ * Build, initialize and prepare a plugin chain with the server settings, in
+ * the current render context.
+ *
+ * @return RETURN_CODE_SUCCESS if the chain is ready for processing
+ */
+static ReturnCode _newServerPluginChain(const CharString pluginChainString,
+                                        const _RenderServerSettings *settings,
+                                        boolByte warmUp,
+                                        PluginChain *outPluginChain) {
+  PluginChain pluginChain;
+  ReturnCode result;
+
+  logInfo("Loading plugin chain '%s'", pluginChainString->data);
+  pluginChain = newPluginChain();
+  pluginChainSetPipelined(pluginChain, settings->pipelined);
+  pluginChainSetSkipSilence(pluginChain, settings->skipSilence);
+  pluginChainSetNoteRenderCache(pluginChain, settings->noteCacheSize);
+  pluginChainSetFlushDenormals(pluginChain, settings->flushDenormals);
+  pluginChainSetChannelInstances(pluginChain, settings->channelInstances);
+  pluginChainSetParallelLoading(pluginChain, settings->parallelLoading);
+  pluginChainSetSerialLoadPlugins(pluginChain, settings->serialLoadPlugins);
+  pluginChainSetMidiRoutes(pluginChain, settings->midiRoutes);
+  pluginChainSetIsolatedHost(pluginChain, settings->isolatedHost);
+  result = buildPluginChain(pluginChain, pluginChainString,
+                            settings->pluginSearchRoot);
+
+  if (result == RETURN_CODE_SUCCESS) {
+    result = pluginChainInitialize(pluginChain);
+  }
+
+  if (result != RETURN_CODE_SUCCESS) {
+    freePluginChain(pluginChain);
+    return result;
+  }
+
+  pluginChainPrepareForProcessing(pluginChain);
+
+  if (warmUp && settings->warmupBlocks > 0) {
+    SampleBuffer inputSampleBuffer =
+        newSampleBuffer(getNumChannels(), getBlocksize());
+    SampleBuffer outputSampleBuffer =
+        newSampleBuffer(getNumChannels(), getBlocksize());
+    _warmUpPluginChain(pluginChain, inputSampleBuffer, outputSampleBuffer,
+                       settings->warmupBlocks);
+    freeSampleBuffer(inputSampleBuffer);
+    freeSampleBuffer(outputSampleBuffer);
+  }
+
+  *outPluginChain = pluginChain;
+  return RETURN_CODE_SUCCESS;
+}
+
+/**
+ * Build and initialize a plugin chain for the server, and add it to the pool.
+ * Chains which are loaded before the server forks its workers are not warmed
+ * up, since that may start threads which would not exist in the workers.
+ *
+ * @return RETURN_CODE_SUCCESS if the chain is ready for processing
+ */
+static ReturnCode _loadServerPluginChain(PluginChainPool pool,
+                                         const CharString pluginChainString,
+                                         const _RenderServerSettings *settings,
+                                         boolByte warmUp,
+                                         PluginChain *outPluginChain) {
+  ReturnCode result = _newServerPluginChain(pluginChainString, settings,
+                                            warmUp, outPluginChain);
+
+  if (result == RETURN_CODE_SUCCESS) {
+    pluginChainPoolAdd(pool, pluginChainString, *outPluginChain);
+  }
+
+  return result;
+}
+
+/**
+ * Find a warm plugin chain for a render request, or build and initialize a new
+ * one. Reused chains are reset, which also applies the current sample rate and
+ * blocksize to each plugin. New chains are warmed up once before they are added
+ * to the pool.
+ *
+ * @return RETURN_CODE_SUCCESS if the chain is ready for processing
+ */
+static ReturnCode _getServerPluginChain(PluginChainPool pool,
+                                        const RenderRequest request,
+                                        const _RenderServerSettings *settings,
+                                        PluginChain *outPluginChain) {
+  PluginChain pluginChain = pluginChainPoolGet(pool, request->pluginChain);
+
+  if (pluginChain != NULL) {
+    logInfo("Reusing plugin chain '%s'", request->pluginChain->data);
+    pluginChainReset(pluginChain);
+    *outPluginChain = pluginChain;
+    return RETURN_CODE_SUCCESS;
+  }
+
+  return _loadServerPluginChain(pool, request->pluginChain, settings, true,
+                                outPluginChain);
+}
+
+/**
+ * Run a single job which was received in server mode.
+ *
+ * @return RETURN_CODE_SUCCESS if the job was processed
+ */
+static ReturnCode _runServerJob(PluginChainPool pool,
+                                const RenderRequest request,
+                                const _RenderServerSettings *settings,
+                                unsigned long *outFramesProcessed) {
+  SampleSource inputSource = NULL;
+  SampleSource outputSource = NULL;
+  MidiSource midiSource = NULL;
+  MidiSequence midiSequence = NULL;
+  PluginChain pluginChain = NULL;
+  SampleBuffer inputSampleBuffer;
+  SampleBuffer outputSampleBuffer;
+  TaskTimer inputTimer, outputTimer;
+  ReturnCode result = RETURN_CODE_SUCCESS;
+
+  *outFramesProcessed = 0;
+
+  // Settings from an earlier job must not leak into this one
+  setSampleRate(settings->sampleRate);
+  setBlocksize(settings->blocksize);
+  setNumChannels(settings->numChannels);
+
+  if ((request->sampleRate > 0.0 && !setSampleRate(request->sampleRate)) ||
+      (request->blocksize > 0 && !setBlocksize(request->blocksize))) {
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  if (charStringIsEmpty(request->inputSource) &&
+      charStringIsEmpty(request->midiSource)) {
+    logError("Request contains neither an input nor a MIDI source");
+    return RETURN_CODE_MISSING_REQUIRED_OPTION;
+  }
+
+  inputSource = sampleSourceCacheWrap(sampleSourceFactory(
+      charStringIsEmpty(request->inputSource) ? NULL : request->inputSource));
+  outputSource = sampleSourceFactory(request->outputSource);
+
+  if ((result = setupInputSource(inputSource, settings->mapInput)) !=
+          RETURN_CODE_SUCCESS ||
+      (result = _segmentInputSource(&inputSource, request->startFrame,
+                                    request->numFrames,
+                                    request->prerollFrames)) !=
+          RETURN_CODE_SUCCESS) {
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    return result;
+  }
+
+  result = _getServerPluginChain(pool, request, settings, &pluginChain);
+
+  if (result == RETURN_CODE_SUCCESS &&
+      inputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_SILENCE &&
+      pluginChain->plugins[0]->pluginType != PLUGIN_TYPE_INSTRUMENT) {
+    logError("Plugin chain contains only effects, but no input source was "
+             "supplied");
+    result = RETURN_CODE_MISSING_REQUIRED_OPTION;
+  }
+
+  if (result == RETURN_CODE_SUCCESS &&
+      linkedListLength(request->parameters) > 0 &&
+      !pluginChainSetParameters(pluginChain, request->parameters)) {
+    result = RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  if (result == RETURN_CODE_SUCCESS &&
+      !charStringIsEmpty(request->midiSource)) {
+    midiSource = newMidiSource(guessMidiSourceType(request->midiSource),
+                               request->midiSource);
+    result = setupMidiSource(midiSource, &midiSequence);
+  }
+
+  if (result == RETURN_CODE_SUCCESS) {
+    result = setupOutputSource(outputSource, settings->flacLevel,
+                               settings->flacThreads);
+
+    if (result != RETURN_CODE_SUCCESS) {
+      inputSource->closeSampleSource(inputSource);
+    }
+  } else {
+    inputSource->closeSampleSource(inputSource);
+  }
+
+  if (result == RETURN_CODE_SUCCESS) {
+    inputSource = _prefetchInputSource(inputSource, settings->prefetchBlocks,
+                                       settings->ioBlocksize);
+    outputSource = _writeBehindOutputSource(outputSource,
+                                            settings->writeBehindBlocks,
+                                            settings->ioBlocksize, false);
+    inputSampleBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+    outputSampleBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+    inputTimer = newTaskTimerWithCString(PROGRAM_NAME, "Input Source");
+    outputTimer = newTaskTimerWithCString(PROGRAM_NAME, "Output Source");
+    audioClockReset(getAudioClock());
+
+    *outFramesProcessed = _processJob(
+        pluginChain, inputSource, outputSource, midiSequence, 0,
+        pluginChainGetProcessingDelay(pluginChain), request->prerollFrames,
+        (boolByte)(settings->flushTail && request->numFrames == 0),
+        request->numFrames == 0 ? settings->stopOnSilenceInMs : 0.0,
+        settings->ioBlocksize, inputSampleBuffer, outputSampleBuffer,
+        inputTimer, outputTimer, NULL, NULL, NULL);
+
+    freeSampleBuffer(inputSampleBuffer);
+    freeSampleBuffer(outputSampleBuffer);
+    freeTaskTimer(inputTimer);
+    freeTaskTimer(outputTimer);
+  }
+
+  freeSampleSource(inputSource);
+  freeSampleSource(outputSource);
+  freeMidiSource(midiSource);
+  freeMidiSequence(midiSequence);
+  return result;
+}
+
+/**
+ * Accept render jobs on a socket until a shutdown request is received. Jobs
+ * are processed one at a time, in the order in which they arrive.
+ *
+ * @return RETURN_CODE_SUCCESS if the server was shut down by a request
+ */
+static ReturnCode _serveJobs(Socket server, PluginChainPool pool,
+                             const _RenderServerSettings *settings) {
+  Socket connection;
+  RenderRequest request = newRenderRequest();
+  CharString line = newCharStringWithCapacity(kCharStringLengthLong);
+  CharString reply = newCharString();
+  ReturnCode result = RETURN_CODE_SUCCESS;
+  ReturnCode jobResult;
+  unsigned long framesProcessed;
+  boolByte shutdown = false;
+
+  while (!shutdown) {
+    connection = socketAccept(server);
+
+    if (connection == NULL) {
+      result = RETURN_CODE_IO_ERROR;
+      break;
+    }
+
+    while (!shutdown && socketReadLine(connection, line)) {
+      if (charStringIsEmpty(line)) {
+        continue;
+      }
+
+      if (!renderRequestParse(request, line)) {
+        snprintf(reply->data, reply->capacity, "ERROR\t%d",
+                 RETURN_CODE_INVALID_ARGUMENT);
+      } else if (request->shutdown) {
+        logInfo("Shutdown requested");
+        shutdown = true;
+        charStringCopyCString(reply, "OK");
+      } else {
+        jobResult = _runServerJob(pool, request, settings, &framesProcessed);
+        liveMetricsRecordJob((boolByte)(jobResult == RETURN_CODE_SUCCESS));
+
+        if (jobResult == RETURN_CODE_SUCCESS) {
+          snprintf(reply->data, reply->capacity, "OK\t%lu", framesProcessed);
+        } else {
+          logError("Job for '%s' failed", request->outputSource->data);
+          snprintf(reply->data, reply->capacity, "ERROR\t%d", jobResult);
+        }
+      }
+
+      if (!socketWriteLine(connection, reply)) {
+        logWarn("Could not send reply to client");
+      }
+    }
+
+    freeSocket(connection);
+  }
+
+  freeCharString(line);
+  freeCharString(reply);
+  freeRenderRequest(request);
+  return result;
+}
+
+/**
+ * Fork a worker process which serves jobs from the server's socket. The worker
+ * inherits the pool, so chains which are already loaded are shared with the
+ * parent until either process writes to their memory. The worker never returns
+ * from this function.
+ *
+ * @return Worker process, or NULL if it could not be started
+ */
+static Process _forkServerWorker(Socket server, PluginChainPool pool,
+                                 const _RenderServerSettings *settings) {
+  boolByte isChild;
+  Process worker = newProcessForked(&isChild);
+  ReturnCode result;
+
+  if (!isChild) {
+    return worker;
+  }
+
+  result = _serveJobs(server, pool, settings);
+  freePluginChainPool(pool);
+  // The parent still listens on the socket, and removes it once all workers
+  // have stopped
+  socketKeepPath(server);
+  freeSocket(server);
+  exit(result);
+}
+
+/**
+ * Ask the workers which are still running to stop. Each one handles a single
+ * shutdown request and then stops accepting connections, so every request is
+ * received by a different worker once it has finished its current job.
+ */
+static void _stopServerWorkers(const CharString address,
+                               unsigned int numRunning) {
+  CharString line = newCharStringWithCString("shutdown");
+  Socket connection;
+  unsigned int i;
+
+  for (i = 0; i < numRunning; i++) {
+    connection = newSocketConnected(address);
+
+    if (connection == NULL) {
+      break;
+    }
+
+    if (socketWriteLine(connection, line)) {
+      // Wait for the reply, so that the next request goes to another worker
+      socketReadLine(connection, line);
+      charStringCopyCString(line, "shutdown");
+    }
+
+    freeSocket(connection);
+  }
+
+  freeCharString(line);
+}
+
+/**
+ * Check the plugin index for whether the plugins of a chain may be loaded
+ * before forking. The plugins are only looked up, not opened.
+ * @return False if any plugin is known to break when its process is forked
+ */
+static boolByte _isPluginChainForkSafe(const CharString pluginChainString,
+                                       const _RenderServerSettings *settings) {
+  PluginChain pluginChain = newPluginChain();
+  boolByte result = true;
+
+  if (buildPluginChain(pluginChain, pluginChainString,
+                       settings->pluginSearchRoot) == RETURN_CODE_SUCCESS) {
+    result = (boolByte)(pluginChainGetCapability(
+                            pluginChain, PLUGIN_CAPABILITY_FORK_SAFE) !=
+                        PLUGIN_CAPABILITY_UNSUPPORTED);
+  }
+
+  freePluginChain(pluginChain);
+  return result;
+}
+
+/**
+ * Serve jobs on several forked worker processes which share the same socket.
+ * Workers which crash are replaced, and once any worker has stopped normally,
+ * the others are stopped as well.
+ *
+ * @return RETURN_CODE_SUCCESS if the server was shut down by a request
+ */
+static ReturnCode _runServerWorkers(Socket server, PluginChainPool pool,
+                                    const _RenderServerSettings *settings) {
+  Process *workers =
+      (Process *)calloc(settings->numWorkers, sizeof(Process));
+  PluginChain pluginChain;
+  ReturnCode result = RETURN_CODE_SUCCESS;
+  unsigned int numRunning = 0;
+  boolByte stopping = false;
+  unsigned int i;
+
+  if (settings->preloadPluginChain != NULL) {
+    if (settings->pipelined || settings->channelInstances ||
+        settings->isolatedHost != NULL) {
+      logWarn("Plugin chains with threads or isolated plugins are not loaded "
+              "before forking workers");
+    } else if (!_isPluginChainForkSafe(settings->preloadPluginChain,
+                                       settings)) {
+      logWarn("Plugin chain '%s' contains plugins which do not support "
+              "forking, each worker loads it on its own",
+              settings->preloadPluginChain->data);
+    } else {
+      result =
+          _loadServerPluginChain(pool, settings->preloadPluginChain, settings,
+                                 false, &pluginChain);
+    }
+  }
+
+  for (i = 0; i < settings->numWorkers && result == RETURN_CODE_SUCCESS; i++) {
+    workers[i] = _forkServerWorker(server, pool, settings);
+
+    if (workers[i] == NULL) {
+      result = RETURN_CODE_FORK_FAILED;
+    } else {
+      numRunning++;
+    }
+  }
+
+  if (result == RETURN_CODE_SUCCESS) {
+    logInfo("Waiting for jobs on '%s' with %u workers", server->address->data,
+            numRunning);
+  } else {
+    stopping = true;
+    _stopServerWorkers(server->address, numRunning);
+  }
+
+  while (numRunning > 0) {
+    taskTimerSleep(kMrsWatsonServerWorkerPollIntervalInMs);
+
+    for (i = 0; i < settings->numWorkers; i++) {
+      if (workers[i] == NULL || !processPoll(workers[i])) {
+        continue;
+      }
+
+      numRunning--;
+
+      if (workers[i]->exitCode < 0 && !stopping) {
+        logWarn("Server worker crashed, starting a new one");
+        freeProcess(workers[i]);
+        workers[i] = _forkServerWorker(server, pool, settings);
+        numRunning += workers[i] != NULL ? 1 : 0;
+        continue;
+      }
+
+      if (workers[i]->exitCode != RETURN_CODE_SUCCESS &&
+          result == RETURN_CODE_SUCCESS) {
+        result = (ReturnCode)workers[i]->exitCode;
+      }
+
+      freeProcess(workers[i]);
+      workers[i] = NULL;
+
+      if (!stopping) {
+        stopping = true;
+        _stopServerWorkers(server->address, numRunning);
+      }
+    }
+  }
+
+  free(workers);
+  return result;
+}
+
+static ReturnCode _runServer(const CharString address,
+                             const _RenderServerSettings *settings) {
+  Socket server = newSocketListening(address);
+  PluginChainPool pool;
+  ReturnCode result;
+
+  if (server == NULL) {
+    return RETURN_CODE_IO_ERROR;
+  }
+
+  pool = newPluginChainPool(kMrsWatsonServerMaxPluginChains);
+
+  if (settings->numWorkers > 0) {
+    result = _runServerWorkers(server, pool, settings);
+  } else {
+    logInfo("Waiting for jobs on '%s'", address->data);
+    result = _serveJobs(server, pool, settings);
+  }
+
+  freePluginChainPool(pool);
+  freeSocket(server);
+  return result;
+}
+
+typedef struct {
+  RenderManifest manifest;
+  const _RenderServerSettings *settings;
+  // Guards the manifest and the fields below
+  Mutex mutex;
+  // Posted once for each waiting thread when a job finishes
+  Semaphore jobFinished;
+  unsigned int numWaiting;
+  unsigned long framesProcessed;
+} _ManifestRunnerMembers;
+typedef _ManifestRunnerMembers *_ManifestRunner;
+
+typedef struct {
+  _ManifestRunner runner;
+  RenderContext renderContext;
+  Thread thread;
+} _ManifestWorkerMembers;
+typedef _ManifestWorkerMembers *_ManifestWorker;
+
+/**
+ * Remove the memory streams written by manifest jobs once no other job is
+ * going to read them. Must be called with the runner's mutex locked.
+ */
+static void _releaseManifestMemoryStreams(RenderManifest manifest) {
+  CharString outputSource;
+  unsigned int i;
+
+  for (i = 0; i < manifest->numJobs; i++) {
+    outputSource = manifest->jobs[i]->request->outputSource;
+
+    if (sampleSourceIsMemoryName(outputSource) &&
+        renderManifestIsConsumed(manifest, i)) {
+      sampleSourceMemoryRemove(outputSource);
+    }
+  }
+}
+
+/**
+ * Run manifest jobs until all of them have finished, waiting whenever the
+ * remaining jobs depend on jobs which are still running. Several workers may
+ * run at once, each with its own render context and plugin chains.
+ */
+static void _manifestWorkerThread(void *userData) {
+  _ManifestWorker worker = (_ManifestWorker)userData;
+  _ManifestRunner runner = worker->runner;
+  RenderManifestJob job;
+  PluginChainPool pool;
+  ReturnCode result;
+  unsigned long framesProcessed;
+  int index = -1;
+
+  renderContextMakeCurrent(worker->renderContext);
+  pool = newPluginChainPool(kMrsWatsonServerMaxPluginChains);
+  mutexLock(runner->mutex);
+
+  while (!renderManifestIsFinished(runner->manifest)) {
+    index = renderManifestNextJob(runner->manifest, index);
+
+    if (index < 0) {
+      runner->numWaiting++;
+      mutexUnlock(runner->mutex);
+      semaphoreWait(runner->jobFinished);
+      mutexLock(runner->mutex);
+      continue;
+    }
+
+    job = runner->manifest->jobs[index];
+    mutexUnlock(runner->mutex);
+
+    logInfo("Starting job '%s'", job->name->data);
+    result = _runServerJob(pool, job->request, runner->settings,
+                           &framesProcessed);
+    liveMetricsRecordJob((boolByte)(result == RETURN_CODE_SUCCESS));
+
+    if (result != RETURN_CODE_SUCCESS) {
+      logError("Job '%s' failed", job->name->data);
+    }
+
+    mutexLock(runner->mutex);
+    renderManifestFinishJob(runner->manifest, (unsigned int)index, result);
+    runner->framesProcessed += framesProcessed;
+    _releaseManifestMemoryStreams(runner->manifest);
+
+    // Finishing a job may make others ready, or finish the whole manifest
+    while (runner->numWaiting > 0) {
+      runner->numWaiting--;
+      semaphorePost(runner->jobFinished);
+    }
+  }
+
+  mutexUnlock(runner->mutex);
+  freePluginChainPool(pool);
+  renderContextMakeCurrent(NULL);
+}
+
+/**
+ * Run all jobs of a manifest, on the calling thread and numThreads - 1 extra
+ * threads.
+ *
+ * @return RETURN_CODE_SUCCESS if all jobs succeeded, otherwise the result of
+ * the first job in the manifest which failed
+ */
+static ReturnCode _runManifest(RenderManifest manifest,
+                               const _RenderServerSettings *settings,
+                               unsigned int numThreads) {
+  _ManifestRunnerMembers runner;
+  _ManifestWorker workers;
+  unsigned int numWorkers;
+  unsigned int i;
+  ReturnCode result = RETURN_CODE_SUCCESS;
+
+  if (numThreads > manifest->numJobs) {
+    numThreads = manifest->numJobs;
+  }
+
+  runner.manifest = manifest;
+  runner.settings = settings;
+  runner.mutex = newMutex();
+  runner.jobFinished = newSemaphore(0);
+  runner.numWaiting = 0;
+  runner.framesProcessed = 0;
+  logInfo("Running %d jobs from manifest on %d threads", manifest->numJobs,
+          numThreads);
+
+  // The first worker runs on this thread, and always exists
+  workers = (_ManifestWorker)malloc(sizeof(_ManifestWorkerMembers) *
+                                    numThreads);
+
+  for (numWorkers = 0; numWorkers < numThreads; numWorkers++) {
+    workers[numWorkers].runner = &runner;
+    workers[numWorkers].renderContext = newRenderContext();
+    workers[numWorkers].thread = NULL;
+
+    if (numWorkers > 0) {
+      workers[numWorkers].thread =
+          newThread(_manifestWorkerThread, &workers[numWorkers]);
+
+      if (workers[numWorkers].thread == NULL) {
+        logWarn("Could not start worker thread");
+        freeRenderContext(workers[numWorkers].renderContext);
+        break;
+      }
+    }
+  }
+
+  _manifestWorkerThread(&workers[0]);
+
+  for (i = 0; i < numWorkers; i++) {
+    if (workers[i].thread != NULL) {
+      threadJoinAndFree(workers[i].thread);
+    }
+
+    freeRenderContext(workers[i].renderContext);
+  }
+
+  for (i = 0; i < manifest->numJobs; i++) {
+    if (manifest->jobs[i]->state == RENDER_MANIFEST_JOB_FAILED) {
+      result = manifest->jobs[i]->result;
+      break;
+    }
+  }
+
+  logInfo("Manifest finished: %d jobs done, %d failed, %d skipped, %lu frames "
+          "processed",
+          renderManifestCountJobs(manifest, RENDER_MANIFEST_JOB_DONE),
+          renderManifestCountJobs(manifest, RENDER_MANIFEST_JOB_FAILED),
+          renderManifestCountJobs(manifest, RENDER_MANIFEST_JOB_SKIPPED),
+          runner.framesProcessed);
+
+  free(workers);
+  freeMutex(runner.mutex);
+  freeSemaphore(runner.jobFinished);
+  return result;
+}
+
+typedef struct {
+  const _RenderServerSettings *settings;
+  SampleSource inputSource;
+  // Block of input which all variants process. It is only written by the
+  // reading thread while none of the variants is processing.
+  SampleBuffer inputSampleBuffer;
+  boolByte finishedReading;
+  // Posted by each variant once it has loaded, and after each block
+  Semaphore blockDone;
+  // Held while processing by variants with plugins which may not run in
+  // several instances at the same time
+  Mutex processLock;
+} _FanOutMembers;
+typedef _FanOutMembers *_FanOut;
+
+typedef struct {
+  _FanOut fanOut;
+  RenderRequest request;
+  RenderContext renderContext;
+  // Posted by the reading thread when the next block of input is ready
+  Semaphore blockReady;
+  Thread thread;
+  ReturnCode result;
+  // True if the plugin index says that the chain does not support running in
+  // several instances, see PLUGIN_CAPABILITY_MULTI_INSTANCE
+  boolByte serialized;
+} _FanOutVariantMembers;
+typedef _FanOutVariantMembers *_FanOutVariant;
+
+/**
+ * Check a single render request from a file.
+ * @return True if the request may be used
+ */
+typedef boolByte (*_RenderRequestCheckFunc)(const RenderRequest request);
+
+/**
+ * Read a file of render requests, with one request per line in the same
+ * format as for --serve. Empty lines and lines starting with '#' are skipped.
+ * @param filename File to read
+ * @param description What the file lists, such as "fan-out variants"
+ * @param isValid Function which checks each request
+ * @param expected Description of what each line may contain, which is logged
+ * for lines which do not pass the check
+ * @return List of RenderRequest items, or NULL if the file could not be read
+ * or contains invalid lines
+ */
+static LinkedList _readRenderRequests(const CharString filename,
+                                      const char *description,
+                                      _RenderRequestCheckFunc isValid,
+                                      const char *expected) {
+  File requestsFile = newFileWithPath(filename);
+  LinkedList lines = NULL;
+  LinkedList result = NULL;
+  LinkedListIterator iterator;
+  CharString line;
+  RenderRequest request;
+  char *carriageReturn = NULL;
+  int lineNumber = 0;
+
+  if (requestsFile == NULL || requestsFile->fileType != kFileTypeFile) {
+    logError("File of %s '%s' does not exist", description, filename->data);
+    freeFile(requestsFile);
+    return NULL;
+  }
+
+  lines = fileReadLines(requestsFile);
+  freeFile(requestsFile);
+
+  if (lines == NULL) {
+    return NULL;
+  }
+
+  result = newLinkedList();
+
+  for (iterator = linkedListBegin(lines); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    line = (CharString)linkedListIteratorGetItem(iterator);
+    lineNumber++;
+    // Tolerate files which were saved with DOS line endings
+    carriageReturn = strrchr(line->data, '\r');
+
+    if (carriageReturn != NULL) {
+      *carriageReturn = '\0';
+    }
+
+    if (charStringIsEmpty(line) || line->data[0] == '#') {
+      continue;
+    }
+
+    request = newRenderRequest();
+
+    if (!renderRequestParse(request, line) || request->shutdown ||
+        !isValid(request)) {
+      logError("Line %d of '%s' should only contain %s", lineNumber,
+               filename->data, expected);
+      freeRenderRequest(request);
+      freeLinkedListAndItems(result, (LinkedListFreeItemFunc)freeRenderRequest);
+      result = NULL;
+      break;
+    }
+
+    linkedListAppend(result, request);
+  }
+
+  freeLinkedListAndItems(lines, (LinkedListFreeItemFunc)freeCharString);
+
+  if (result != NULL && linkedListLength(result) == 0) {
+    logError("File '%s' does not contain any %s", filename->data,
+             description);
+    freeLinkedList(result);
+    result = NULL;
+  }
+
+  return result;
+}
+
+static boolByte _isFanOutVariant(const RenderRequest request) {
+  return (boolByte)(charStringIsEmpty(request->inputSource) &&
+                    charStringIsEmpty(request->midiSource) &&
+                    request->sampleRate <= 0.0 && request->blocksize == 0 &&
+                    request->numFrames == 0);
+}
+
+/**
+ * Read the variants of a fan-out file, where each line is a render request
+ * with an output and a plugin chain.
+ * @return List of RenderRequest items, or NULL if the file could not be read
+ * or contains invalid lines
+ */
+static LinkedList _readFanOutVariants(const CharString filename) {
+  return _readRenderRequests(filename, "fan-out variants", _isFanOutVariant,
+                             "an output, a plugin chain and parameters");
+}
+
+static void _fanOutVariantProcess(_FanOutVariant variant,
+                                  PluginChain pluginChain,
+                                  const SampleBuffer inputSampleBuffer,
+                                  SampleBuffer outputSampleBuffer) {
+  if (variant->serialized) {
+    mutexLock(variant->fanOut->processLock);
+  }
+
+  pluginChainProcessAudio(pluginChain, inputSampleBuffer, outputSampleBuffer);
+
+  if (variant->serialized) {
+    mutexUnlock(variant->fanOut->processLock);
+  }
+}
+
+/**
+ * Thread function for one variant of a fan-out. The variant loads its own
+ * plugin chain in its own render context, and then processes each block of
+ * input which the reading thread hands out. Once the input has ended, the
+ * variant flushes its chain on its own and closes its output.
+ */
+static void _fanOutVariantThread(void *userData) {
+  _FanOutVariant variant = (_FanOutVariant)userData;
+  _FanOut fanOut = variant->fanOut;
+  const _RenderServerSettings *settings = fanOut->settings;
+  SampleSource outputSource =
+      sampleSourceFactory(variant->request->outputSource);
+  SampleSource silentSampleOutput = sampleSourceFactory(NULL);
+  PluginChain pluginChain = NULL;
+  AudioClock audioClock;
+  SampleBuffer silentSampleBuffer;
+  SampleBuffer outputSampleBuffer;
+  unsigned long skipHeadFrames = 0;
+  unsigned long outputLengthInFrames = kMrsWatsonOutputLengthUnknown;
+  boolByte finishedReading = false;
+
+  renderContextMakeCurrent(variant->renderContext);
+  audioClock = getAudioClock();
+  variant->result = _newServerPluginChain(variant->request->pluginChain,
+                                          settings, true, &pluginChain);
+
+  if (variant->result == RETURN_CODE_SUCCESS &&
+      linkedListLength(variant->request->parameters) > 0 &&
+      !pluginChainSetParameters(pluginChain, variant->request->parameters)) {
+    variant->result = RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  if (variant->result == RETURN_CODE_SUCCESS) {
+    variant->result = setupOutputSource(outputSource, settings->flacLevel,
+                                        settings->flacThreads);
+  }
+
+  if (variant->result == RETURN_CODE_SUCCESS) {
+    outputSource = _writeBehindOutputSource(outputSource,
+                                            settings->writeBehindBlocks,
+                                            settings->ioBlocksize, false);
+    skipHeadFrames = pluginChainGetProcessingDelay(pluginChain);
+    variant->serialized =
+        (boolByte)(pluginChainGetCapability(pluginChain,
+                                            PLUGIN_CAPABILITY_MULTI_INSTANCE) ==
+                   PLUGIN_CAPABILITY_UNSUPPORTED);
+
+    if (variant->serialized) {
+      logInfo("Variant '%s' does not support running alongside other "
+              "instances of its plugins, it will not process in parallel",
+              variant->request->outputSource->data);
+    }
+  } else {
+    logError("Could not start variant '%s'",
+             variant->request->outputSource->data);
+  }
+
+  silentSampleBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  outputSampleBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  audioClockReset(audioClock);
+  semaphorePost(fanOut->blockDone);
+
+  // A variant which failed to load still waits for each block, so that the
+  // reading thread can treat all variants in the same way
+  while (!finishedReading) {
+    semaphoreWait(variant->blockReady);
+    finishedReading = fanOut->finishedReading;
+
+    if (variant->result == RETURN_CODE_SUCCESS) {
+      _fanOutVariantProcess(variant, pluginChain, fanOut->inputSampleBuffer,
+                            outputSampleBuffer);
+      advanceAudioClock(audioClock, outputSampleBuffer->blocksize);
+
+      if (finishedReading) {
+        outputLengthInFrames =
+            _getOutputLengthInFrames(pluginChain, fanOut->inputSource, NULL, 0,
+                                     settings->flushTail);
+      }
+
+      writeOutput(outputSource, silentSampleOutput, outputSampleBuffer,
+                  skipHeadFrames, outputLengthInFrames);
+    }
+
+    semaphorePost(fanOut->blockDone);
+  }
+
+  // The input may be closed from here on, and the rest of the output is only
+  // the processing delay and tail of this variant's chain
+  if (variant->result == RETURN_CODE_SUCCESS) {
+    while (audioClock->currentFrame < skipHeadFrames + outputLengthInFrames) {
+      _fanOutVariantProcess(variant, pluginChain, silentSampleBuffer,
+                            outputSampleBuffer);
+      advanceAudioClock(audioClock, outputSampleBuffer->blocksize);
+      writeOutput(outputSource, silentSampleOutput, outputSampleBuffer,
+                  skipHeadFrames, outputLengthInFrames);
+    }
+
+    outputSource->closeSampleSource(outputSource);
+    audioClockStop(audioClock);
+    logInfo("Wrote %ld frames to %s",
+            outputSource->numSamplesProcessed / getNumChannels(),
+            outputSource->sourceName->data);
+
+    if (pluginChainHasCrashedPlugins(pluginChain)) {
+      variant->result = RETURN_CODE_PLUGIN_ERROR;
+    }
+  }
+
+  if (pluginChain != NULL) {
+    pluginChainShutdown(pluginChain);
+    freePluginChain(pluginChain);
+  }
+
+  silentSampleOutput->closeSampleSource(silentSampleOutput);
+  freeSampleSource(silentSampleOutput);
+  freeSampleSource(outputSource);
+  freeSampleBuffer(silentSampleBuffer);
+  freeSampleBuffer(outputSampleBuffer);
+  renderContextMakeCurrent(NULL);
+}
+
+/**
+ * Render one input through several variants of a plugin chain. The input is
+ * read once on the calling thread, and each block is processed by all of the
+ * variants in parallel, each on its own thread and with its own render context.
+ *
+ * @param variants List of RenderRequest items with the output, plugin chain
+ * and parameters of each variant
+ * @return RETURN_CODE_SUCCESS if all variants succeeded, otherwise the result
+ * of the first variant which failed
+ */
+static ReturnCode _runFanOut(const CharString inputSourceName,
+                             LinkedList variants,
+                             const _RenderServerSettings *settings) {
+  _FanOutMembers fanOut;
+  _FanOutVariant variantWorkers;
+  RenderRequest *requests = (RenderRequest *)linkedListToArray(variants);
+  const unsigned int numVariants = (unsigned int)linkedListLength(variants);
+  unsigned int numStarted;
+  unsigned int numLoaded = 0;
+  unsigned int i;
+  ReturnCode result;
+
+  fanOut.settings = settings;
+  fanOut.inputSource =
+      sampleSourceCacheWrap(sampleSourceFactory(inputSourceName));
+
+  if ((result = setupInputSource(fanOut.inputSource, settings->mapInput)) !=
+      RETURN_CODE_SUCCESS) {
+    freeSampleSource(fanOut.inputSource);
+    free(requests);
+    return result;
+  }
+
+  fanOut.inputSource = _prefetchInputSource(
+      fanOut.inputSource, settings->prefetchBlocks, settings->ioBlocksize);
+  fanOut.inputSampleBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  fanOut.finishedReading = false;
+  fanOut.blockDone = newSemaphore(0);
+  fanOut.processLock = newMutex();
+  logInfo("Rendering %d variants of '%s'", numVariants,
+          inputSourceName->data);
+
+  variantWorkers =
+      (_FanOutVariant)malloc(sizeof(_FanOutVariantMembers) * numVariants);
+
+  for (numStarted = 0; numStarted < numVariants; numStarted++) {
+    variantWorkers[numStarted].fanOut = &fanOut;
+    variantWorkers[numStarted].request = requests[numStarted];
+    variantWorkers[numStarted].renderContext = newRenderContext();
+    variantWorkers[numStarted].blockReady = newSemaphore(0);
+    variantWorkers[numStarted].result = RETURN_CODE_SUCCESS;
+    variantWorkers[numStarted].serialized = false;
+    variantWorkers[numStarted].thread =
+        newThread(_fanOutVariantThread, &variantWorkers[numStarted]);
+
+    if (variantWorkers[numStarted].thread == NULL) {
+      logError("Could not start thread for variant '%s'",
+               requests[numStarted]->outputSource->data);
+      freeRenderContext(variantWorkers[numStarted].renderContext);
+      freeSemaphore(variantWorkers[numStarted].blockReady);
+      result = RETURN_CODE_INTERNAL_ERROR;
+      break;
+    }
+  }
+
+  for (i = 0; i < numStarted; i++) {
+    semaphoreWait(fanOut.blockDone);
+  }
+
+  for (i = 0; i < numStarted; i++) {
+    if (variantWorkers[i].result == RETURN_CODE_SUCCESS) {
+      numLoaded++;
+    }
+  }
+
+  // Without any working variant, the input is not read at all and the
+  // variants are only released from their first wait
+  if (numLoaded == 0) {
+    fanOut.finishedReading = true;
+  }
+
+  do {
+    if (numLoaded > 0) {
+      fanOut.finishedReading =
+          (boolByte)!readInput(fanOut.inputSource, fanOut.inputSampleBuffer);
+    }
+
+    for (i = 0; i < numStarted; i++) {
+      semaphorePost(variantWorkers[i].blockReady);
+    }
+
+    for (i = 0; i < numStarted; i++) {
+      semaphoreWait(fanOut.blockDone);
+    }
+  } while (!fanOut.finishedReading);
+
+  fanOut.inputSource->closeSampleSource(fanOut.inputSource);
+  logInfo("Read %ld frames from %s",
+          fanOut.inputSource->numSamplesProcessed / getNumChannels(),
+          fanOut.inputSource->sourceName->data);
+
+  for (i = 0; i < numStarted; i++) {
+    threadJoinAndFree(variantWorkers[i].thread);
+    freeRenderContext(variantWorkers[i].renderContext);
+    freeSemaphore(variantWorkers[i].blockReady);
+
+    if (result == RETURN_CODE_SUCCESS &&
+        variantWorkers[i].result != RETURN_CODE_SUCCESS) {
+      result = variantWorkers[i].result;
+    }
+  }
+
+  logInfo("Fan-out finished: %d of %d variants rendered", numLoaded,
+          numVariants);
+  free(variantWorkers);
+  free(requests);
+  freeSemaphore(fanOut.blockDone);
+  freeMutex(fanOut.processLock);
+  freeSampleBuffer(fanOut.inputSampleBuffer);
+  freeSampleSource(fanOut.inputSource);
+  return result;
+}
+
+static boolByte _isStream(const RenderRequest request) {
+  return (boolByte)(!charStringIsEmpty(request->inputSource) &&
+                    charStringIsEmpty(request->midiSource) &&
+                    request->startFrame == 0 && request->numFrames == 0 &&
+                    request->prerollFrames == 0);
+}
+
+/**
+ * Read the streams of a streams file, where each line is a render request
+ * with an input, an output and a plugin chain.
+ * @return List of RenderRequest items, or NULL if the file could not be read
+ * or contains invalid lines
+ */
+static LinkedList _readStreams(const CharString filename) {
+  return _readRenderRequests(filename, "streams", _isStream,
+                             "an input, an output, a plugin chain, parameters, "
+                             "a sample rate and a blocksize");
+}
+
+typedef struct {
+  const _RenderServerSettings *settings;
+  RenderRequest request;
+  RenderContext renderContext;
+  PluginChain pluginChain;
+  SampleSource inputSource;
+  SampleSource outputSource;
+  SampleSource silentSampleOutput;
+  SampleBuffer inputSampleBuffer;
+  SampleBuffer silentSampleBuffer;
+  SampleBuffer outputSampleBuffer;
+  unsigned long skipHeadFrames;
+  unsigned long outputLengthInFrames;
+  boolByte finishedReading;
+  ReturnCode result;
+} _StreamMembers;
+typedef _StreamMembers *_Stream;
+
+/**
+ * Process one block of a stream on a worker of the stream scheduler. Once the
+ * input has ended, the stream goes on with silence until the processing delay
+ * and tail of its chain have been written.
+ * @return True if the stream has more blocks
+ */
+static boolByte _processStreamBlock(void *userData) {
+  _Stream stream = (_Stream)userData;
+  AudioClock audioClock;
+  SampleBuffer inputSampleBuffer = stream->silentSampleBuffer;
+  boolByte hasMoreBlocks;
+
+  renderContextMakeCurrent(stream->renderContext);
+  audioClock = getAudioClock();
+
+  if (!stream->finishedReading) {
+    inputSampleBuffer = stream->inputSampleBuffer;
+    stream->finishedReading =
+        (boolByte)!readInput(stream->inputSource, inputSampleBuffer);
+  }
+
+  pluginChainProcessAudio(stream->pluginChain, inputSampleBuffer,
+                          stream->outputSampleBuffer);
+  advanceAudioClock(audioClock, stream->outputSampleBuffer->blocksize);
+
+  if (stream->finishedReading &&
+      stream->outputLengthInFrames == kMrsWatsonOutputLengthUnknown) {
+    stream->outputLengthInFrames =
+        _getOutputLengthInFrames(stream->pluginChain, stream->inputSource,
+                                 NULL, 0, stream->settings->flushTail);
+  }
+
+  writeOutput(stream->outputSource, stream->silentSampleOutput,
+              stream->outputSampleBuffer, stream->skipHeadFrames,
+              stream->outputLengthInFrames);
+  hasMoreBlocks = (boolByte)(!stream->finishedReading ||
+                             audioClock->currentFrame <
+                                 stream->skipHeadFrames +
+                                     stream->outputLengthInFrames);
+  renderContextMakeCurrent(NULL);
+  return hasMoreBlocks;
+}
+
+/**
+ * Open the input, output and plugin chain of a stream in its own render
+ * context, and add it to the scheduler with the stream's blocksize and sample
+ * rate.
+ * @return RETURN_CODE_SUCCESS if the stream is ready to run
+ */
+static ReturnCode _openStream(_Stream stream, StreamScheduler scheduler) {
+  const _RenderServerSettings *settings = stream->settings;
+  const RenderRequest request = stream->request;
+  ReturnCode result = RETURN_CODE_SUCCESS;
+
+  renderContextMakeCurrent(stream->renderContext);
+
+  if ((request->sampleRate > 0.0 && !setSampleRate(request->sampleRate)) ||
+      (request->blocksize > 0 && !setBlocksize(request->blocksize))) {
+    renderContextMakeCurrent(NULL);
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  stream->inputSource = sampleSourceFactory(request->inputSource);
+  stream->outputSource = sampleSourceFactory(request->outputSource);
+  stream->silentSampleOutput = sampleSourceFactory(NULL);
+
+  if ((result = setupInputSource(stream->inputSource, settings->mapInput)) !=
+      RETURN_CODE_SUCCESS) {
+    renderContextMakeCurrent(NULL);
+    return result;
+  }
+
+  result = _newServerPluginChain(request->pluginChain, settings, true,
+                                 &stream->pluginChain);
+
+  if (result == RETURN_CODE_SUCCESS &&
+      linkedListLength(request->parameters) > 0 &&
+      !pluginChainSetParameters(stream->pluginChain, request->parameters)) {
+    result = RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  if (result == RETURN_CODE_SUCCESS) {
+    result = setupOutputSource(stream->outputSource, settings->flacLevel,
+                               settings->flacThreads);
+  }
+
+  if (result == RETURN_CODE_SUCCESS) {
+    stream->skipHeadFrames =
+        pluginChainGetProcessingDelay(stream->pluginChain);
+    stream->inputSampleBuffer =
+        newSampleBuffer(getNumChannels(), getBlocksize());
+    stream->silentSampleBuffer =
+        newSampleBuffer(getNumChannels(), getBlocksize());
+    stream->outputSampleBuffer =
+        newSampleBuffer(getNumChannels(), getBlocksize());
+    audioClockReset(getAudioClock());
+    streamSchedulerAddStream(scheduler, request->outputSource, getBlocksize(),
+                             getSampleRate(), _processStreamBlock, stream);
+  } else {
+    stream->inputSource->closeSampleSource(stream->inputSource);
+  }
+
+  renderContextMakeCurrent(NULL);
+  return result;
+}
+
+static void _closeStream(_Stream stream) {
+  renderContextMakeCurrent(stream->renderContext);
+
+  if (stream->result == RETURN_CODE_SUCCESS) {
+    stream->inputSource->closeSampleSource(stream->inputSource);
+    stream->outputSource->closeSampleSource(stream->outputSource);
+    audioClockStop(getAudioClock());
+    logInfo("Wrote %ld frames to %s",
+            stream->outputSource->numSamplesProcessed / getNumChannels(),
+            stream->outputSource->sourceName->data);
+
+    if (pluginChainHasCrashedPlugins(stream->pluginChain)) {
+      stream->result = RETURN_CODE_PLUGIN_ERROR;
+    }
+  }
+
+  if (stream->pluginChain != NULL) {
+    pluginChainShutdown(stream->pluginChain);
+    freePluginChain(stream->pluginChain);
+  }
+
+  if (stream->silentSampleOutput != NULL) {
+    stream->silentSampleOutput->closeSampleSource(stream->silentSampleOutput);
+  }
+
+  freeSampleSource(stream->silentSampleOutput);
+  freeSampleSource(stream->inputSource);
+  freeSampleSource(stream->outputSource);
+  freeSampleBuffer(stream->inputSampleBuffer);
+  freeSampleBuffer(stream->silentSampleBuffer);
+  freeSampleBuffer(stream->outputSampleBuffer);
+  renderContextMakeCurrent(NULL);
+}
+
+/**
+ * Run many realtime streams in this process. Each stream has its own input,
+ * output, plugin chain and render context, and all of them are processed by a
+ * few worker threads, which always run the block with the earliest deadline
+ * next. See StreamScheduler.h.
+ *
+ * @param requests List of RenderRequest items with the input, output, plugin
+ * chain and parameters of each stream
+ * @param numThreads Number of worker threads, or 0 for one per processor
+ * @param pinThreads Pin each worker thread to its own processor
+ * @return RETURN_CODE_SUCCESS if all streams succeeded, otherwise the result
+ * of the first stream which failed
+ */
+static ReturnCode _runStreams(LinkedList requests,
+                              const _RenderServerSettings *settings,
+                              unsigned int numThreads, boolByte pinThreads) {
+  RenderRequest *requestArray = (RenderRequest *)linkedListToArray(requests);
+  const unsigned int numStreams = (unsigned int)linkedListLength(requests);
+  _Stream streams = (_Stream)calloc(numStreams, sizeof(_StreamMembers));
+  StreamScheduler scheduler = newStreamScheduler(numThreads, pinThreads);
+  ReturnCode result = RETURN_CODE_SUCCESS;
+  unsigned int i;
+
+  for (i = 0; i < numStreams; i++) {
+    streams[i].settings = settings;
+    streams[i].request = requestArray[i];
+    streams[i].renderContext = newRenderContext();
+    streams[i].outputLengthInFrames = kMrsWatsonOutputLengthUnknown;
+    streams[i].finishedReading = false;
+    streams[i].result = _openStream(&streams[i], scheduler);
+
+    if (streams[i].result != RETURN_CODE_SUCCESS) {
+      logError("Could not start stream '%s'",
+               requestArray[i]->outputSource->data);
+    }
+  }
+
+  if (!streamSchedulerRun(scheduler)) {
+    result = RETURN_CODE_INTERNAL_ERROR;
+  }
+
+  streamSchedulerLogReport(scheduler);
+
+  for (i = 0; i < numStreams; i++) {
+    _closeStream(&streams[i]);
+    freeRenderContext(streams[i].renderContext);
+
+    if (result == RETURN_CODE_SUCCESS &&
+        streams[i].result != RETURN_CODE_SUCCESS) {
+      result = streams[i].result;
+    }
+  }
+
+  logInfo("Streams finished: %u of %u streams started, %lu deadlines missed",
+          scheduler->numStreams, numStreams,
+          streamSchedulerGetNumMissedDeadlines(scheduler));
+  freeStreamScheduler(scheduler);
+  free(streams);
+  free(requestArray);
+  return result;
+}
+
+/**
+ * Stop the real-time audit and log its results, if it was enabled
+ * @param enabled True if the audit was enabled
+ * @param result Result of processing
+ * @return RETURN_CODE_REALTIME_VIOLATION if processing succeeded but any
+ * violations were detected, otherwise the result of processing
+ */
+static ReturnCode _finishRealtimeAudit(boolByte enabled, ReturnCode result) {
+  if (!enabled) {
+    return result;
+  }
+
+  realtimeAuditSetEnabled(false);
+  realtimeAuditLogReport();
+
+  if (result == RETURN_CODE_SUCCESS && realtimeAuditGetNumViolations() > 0) {
+    return RETURN_CODE_REALTIME_VIOLATION;
+  }
+
+  return result;
+}
+
+/**
+ * Start the sampling profiler, if it was requested
+ * @param programOptions Parsed program options
+ * @return File which the profile should be written to, or NULL if the profiler
+ * is not running
+ */
+static CharString _startSamplingProfiler(const ProgramOptions programOptions) {
+  CharString profilePath;
+
+  if (!programOptions->options[OPTION_PROFILE]->enabled ||
+      !samplingProfilerStart()) {
+    return NULL;
+  }
+
+  profilePath = newCharString();
+  charStringCopy(profilePath,
+                 programOptionsGetString(programOptions, OPTION_PROFILE));
+  return profilePath;
+}
+
+/**
+ * Stop the sampling profiler and write the profile, if it was started
+ * @param profilePath File to write, which is freed by this function. May be
+ * NULL, in which case this function does nothing.
+ */
+static void _finishSamplingProfiler(CharString profilePath) {
+  if (profilePath == NULL) {
+    return;
+  }
+
+  samplingProfilerStop();
+
+  if (samplingProfilerWriteCollapsedStacks(profilePath)) {
+    logInfo("Wrote %lu profiler samples to '%s'",
+            samplingProfilerGetNumSamples(), profilePath->data);
+  }
+
+  freeCharString(profilePath);
+}
+
+// Steps of starting up which are timed for --startup-profile. These are kept
+// in static storage, so that the many early returns during startup do not all
+// have to free them.
+#define STARTUP_PROFILE_MAX_STEPS 16
+
+typedef struct {
+  const char *name;
+  uint64_t endTimeInNs;
+} _StartupProfileStep;
+
+static uint64_t _startupProfileStartTimeInNs = 0;
+static _StartupProfileStep _startupProfileSteps[STARTUP_PROFILE_MAX_STEPS];
+static unsigned int _startupProfileNumSteps = 0;
+
+static void _startupProfileStart(void) {
+  _startupProfileStartTimeInNs = taskTimerGetTimestampInNs();
+  _startupProfileNumSteps = 0;
+}
+
+/**
+ * Mark the end of a step of starting up, which began when the previous step
+ * ended
+ * @param name Name of the step, which must be a string literal
+ */
+static void _startupProfileMark(const char *name) {
+  if (_startupProfileNumSteps < STARTUP_PROFILE_MAX_STEPS) {
+    _startupProfileSteps[_startupProfileNumSteps].name = name;
+    _startupProfileSteps[_startupProfileNumSteps].endTimeInNs =
+        taskTimerGetTimestampInNs();
+    _startupProfileNumSteps++;
+  }
+}
+
+static void _printStartupProfile(const ProgramOptions programOptions) {
+  uint64_t stepStartTimeInNs = _startupProfileStartTimeInNs;
+  double totalTimeInMs;
+  double stepTimeInMs;
+  unsigned int i;
+
+  if (!programOptions->options[OPTION_STARTUP_PROFILE]->enabled ||
+      _startupProfileNumSteps == 0) {
+    return;
+  }
+
+  totalTimeInMs = (_startupProfileSteps[_startupProfileNumSteps - 1]
+                       .endTimeInNs -
+                   _startupProfileStartTimeInNs) /
+                  1000000.0;
+  logInfo("Startup took %.2fms, breakdown:", totalTimeInMs);
+
+  for (i = 0; i < _startupProfileNumSteps; i++) {
+    stepTimeInMs =
+        (_startupProfileSteps[i].endTimeInNs - stepStartTimeInNs) / 1000000.0;
+    logInfo("  %s: %.2fms (%2.1f%%)", _startupProfileSteps[i].name,
+            stepTimeInMs,
+            totalTimeInMs > 0.0 ? 100.0 * stepTimeInMs / totalTimeInMs : 0.0);
+    stepStartTimeInNs = _startupProfileSteps[i].endTimeInNs;
+  }
+}
+
+/**
+ * Start recording trace events, if they were requested
+ * @param programOptions Parsed program options
+ */
+static void _startTraceEvents(const ProgramOptions programOptions) {
+  if (programOptions->options[OPTION_TRACE_FILE]->enabled) {
+    traceEventsStart();
+  }
+}
+
+/**
+ * Stop recording trace events and write them, if they were requested. This
+ * must be called after all processing threads have finished.
+ * @param programOptions Parsed program options
+ */
+static void _finishTraceEvents(const ProgramOptions programOptions) {
+  const CharString tracePath =
+      programOptionsGetString(programOptions, OPTION_TRACE_FILE);
+
+  if (!programOptions->options[OPTION_TRACE_FILE]->enabled) {
+    return;
+  }
+
+  traceEventsStop();
+
+  if (traceEventsWriteJson(tracePath)) {
+    logInfo("Wrote %lu trace events to '%s'", traceEventsGetNumEvents(),
+            tracePath->data);
+  }
+  if (traceEventsGetNumDroppedEvents() > 0) {
+    logWarn("%lu trace events were dropped", traceEventsGetNumDroppedEvents());
+  }
+
+  traceEventsReset();
+}
+
+/**
+ * Start serving live metrics, if they were requested. Failing to start the
+ * server is not fatal, since the processing itself is not affected.
+ * @param programOptions Parsed program options
+ */
+static void _startLiveMetrics(const ProgramOptions programOptions) {
+  if (programOptions->options[OPTION_METRICS]->enabled) {
+    liveMetricsStartServer(
+        programOptionsGetString(programOptions, OPTION_METRICS));
+  }
+}
+
+static void _startControlServer(const ProgramOptions programOptions,
+                                PluginChain pluginChain) {
+  if (programOptions->options[OPTION_CONTROL]->enabled) {
+    controlServerStart(programOptionsGetString(programOptions, OPTION_CONTROL),
+                       pluginChain);
+  }
+}
+
+// Editor of the head plugin which is shown while the chain processes audio
+typedef struct {
+  Plugin plugin;
+  // Only set when no control server is running, otherwise its queue is shared
+  PluginControl ownedControl;
+  Thread thread;
+} _EditorThreadMembers;
+
+static void _editorThread(void *userData) {
+  Plugin plugin = (Plugin)userData;
+  // Returns when the window is closed or pluginVst2xCloseEditor() is called
+  plugin->showEditor(plugin);
+}
+
+static void _startEditorThread(_EditorThreadMembers *editor,
+                               PluginChain pluginChain) {
+  PluginControl control = pluginChainGetControl(pluginChain);
+
+  editor->plugin = pluginChain->plugins[0];
+  editor->ownedControl = NULL;
+  editor->thread = NULL;
+
+  if (editor->plugin->interfaceType != PLUGIN_TYPE_VST_2X) {
+    logWarn("Plugin '%s' cannot show its editor while processing",
+            editor->plugin->pluginName->data);
+    return;
+  }
+
+  // Changes made in the editor are applied to the chain between two blocks,
+  // so that any other instances of the plugin follow them
+  if (control == NULL) {
+    editor->ownedControl = newPluginControl(kMrsWatsonEditorMaxPendingChanges);
+    control = editor->ownedControl;
+    pluginChainSetControl(pluginChain, control);
+  }
+
+  pluginVst2xSetAutomationControl(editor->plugin, control, 0);
+  editor->thread = newThread(_editorThread, editor->plugin);
+}
+
+static void _stopEditorThread(_EditorThreadMembers *editor,
+                              PluginChain pluginChain) {
+  if (editor->thread != NULL) {
+    pluginVst2xCloseEditor(editor->plugin);
+    threadJoinAndFree(editor->thread);
+    editor->thread = NULL;
+  }
+
+  if (editor->plugin != NULL) {
+    pluginVst2xSetAutomationControl(editor->plugin, NULL, 0);
+  }
+
+  if (editor->ownedControl != NULL) {
+    pluginChainSetControl(pluginChain, NULL);
+    freePluginControl(editor->ownedControl);
+    editor->ownedControl = NULL;
+  }
+}
+
+// Devices, sockets and standard output are never cached
+static boolByte _isRenderCacheOutput(const SampleSource outputSource) {
+  switch (outputSource->sampleSourceType) {
+  case SAMPLE_SOURCE_TYPE_PCM:
+  case SAMPLE_SOURCE_TYPE_AIFF:
+  case SAMPLE_SOURCE_TYPE_FLAC:
+  case SAMPLE_SOURCE_TYPE_MP3:
+  case SAMPLE_SOURCE_TYPE_OGG:
+  case SAMPLE_SOURCE_TYPE_WAVE:
+    return (boolByte)(!charStringIsEqualToCString(outputSource->sourceName,
+                                                  "-", false));
+
+  default:
+    return false;
+  }
+}
+
+// Options which only change how the output is produced, not its contents
+static boolByte _isRenderCacheNeutralOption(unsigned int optionIndex) {
+  switch (optionIndex) {
+  case OPTION_COLOR_LOGGING:
+  case OPTION_COLOR_TEST:
+  case OPTION_CONFIG_FILE:
+  case OPTION_CPU_AFFINITY:
+  case OPTION_DECODE_CACHE:
+  case OPTION_DISPLAY_INFO:
+  case OPTION_ERROR_REPORT:
+  case OPTION_IDLE_INTERVAL:
+  case OPTION_INPUT_MMAP:
+  case OPTION_JOBS:
+  case OPTION_LATENCY_REPORT:
+  case OPTION_LOCK_MEMORY:
+  case OPTION_LOG_FILE:
+  case OPTION_LOG_LEVEL:
+  case OPTION_METRICS:
+  case OPTION_NUMA_NODE:
+  case OPTION_OUTPUT_SOURCE:
+  case OPTION_PARALLEL_LOAD:
+  case OPTION_PERF_COUNTERS:
+  case OPTION_PERF_REPORT:
+  case OPTION_PLUGIN_INDEX:
+  case OPTION_PLUGIN_ROOT:
+  case OPTION_PREFETCH:
+  case OPTION_PRESET_CACHE:
+  case OPTION_PROFILE:
+  case OPTION_QUIET:
+  case OPTION_RENDER_CACHE:
+  case OPTION_RT_AUDIT:
+  case OPTION_SERIAL_LOAD:
+  case OPTION_STARTUP_PROFILE:
+  case OPTION_TRACE_FILE:
+  case OPTION_VERBOSE:
+  case OPTION_WATCHDOG:
+  case OPTION_WRITE_BEHIND:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+/**
+ * Build the render cache key of this run. Files named by string options are
+ * hashed by their contents, so that moving an input does not miss the cache
+ * but editing it does.
+ * @param programOptions Parsed program options
+ * @param pluginChain Initialized plugin chain
+ * @return Key, or NULL if the output of this run cannot be cached
+ */
+static RenderCacheKey _newRenderCacheKey(const ProgramOptions programOptions,
+                                         const PluginChain pluginChain) {
+  RenderCacheKey key = newRenderCacheKey();
+  CharString versionString = buildInfoGetVersionString();
+  ProgramOption option;
+  LinkedListIterator iterator;
+  Plugin plugin;
+  unsigned int i;
+
+  renderCacheKeyAddString(key, versionString->data);
+  freeCharString(versionString);
+
+  for (i = 0; i < programOptions->numOptions; ++i) {
+    option = programOptions->options[i];
+
+    if (!option->enabled || _isRenderCacheNeutralOption(i)) {
+      continue;
+    }
+
+    renderCacheKeyAddString(key, option->name->data);
+
+    switch (option->type) {
+    case kProgramOptionTypeString:
+      if (renderCacheKeyAddFile(key, option->_data.string)) {
+        break;
+      } else if (i == OPTION_INPUT_SOURCE || i == OPTION_MIDI_SOURCE) {
+        // Pipes, devices and sockets can give different data on each run
+        logDebug("Not using render cache, '%s' is not a regular file",
+                 option->_data.string->data);
+        freeRenderCacheKey(key);
+        return NULL;
+      }
+
+      renderCacheKeyAddString(key, option->_data.string->data);
+      break;
+
+    case kProgramOptionTypeNumber:
+      renderCacheKeyAddNumber(key, option->_data.number);
+      break;
+
+    case kProgramOptionTypeList:
+      for (iterator = linkedListBegin(option->_data.list); iterator != NULL;
+           iterator = linkedListIteratorNext(iterator)) {
+        renderCacheKeyAddString(
+            key, (const char *)linkedListIteratorGetItem(iterator));
+      }
+
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  for (i = 0; i < pluginChain->numPlugins; ++i) {
+    plugin = pluginChain->plugins[i];
+    renderCacheKeyAddString(key, plugin->pluginName->data);
+    renderCacheKeyAddNumber(key, (double)plugin->interfaceType);
+
+    if (plugin->interfaceType == PLUGIN_TYPE_VST_2X) {
+      renderCacheKeyAddNumber(key, (double)pluginVst2xGetUniqueId(plugin));
+      renderCacheKeyAddNumber(key, (double)pluginVst2xGetVersion(plugin));
+    }
+
+    // Internal presets are program numbers rather than files
+    if (pluginChain->presets[i] != NULL &&
+        !renderCacheKeyAddFile(key, pluginChain->presets[i]->presetName)) {
+      renderCacheKeyAddString(key, pluginChain->presets[i]->presetName->data);
+    }
+  }
+
+  renderCacheKeyAddNumber(key, getSampleRate());
+  renderCacheKeyAddNumber(key, (double)getNumChannels());
+  renderCacheKeyAddNumber(key, (double)getBlocksize());
+  renderCacheKeyAddNumber(key, (double)getBitDepth());
+  renderCacheKeyAddNumber(key, getTempo());
+  renderCacheKeyAddNumber(key, (double)getTimeSignatureBeatsPerMeasure());
+  renderCacheKeyAddNumber(key, (double)getTimeSignatureNoteValue());
+  return key;
+}
+
+int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
+  ReturnCode result;
+  // Input/Output sources, plugin chain, and other required objects
+  SampleSource inputSource = NULL;
+  SampleSource outputSource = NULL;
+  SampleSource sidechainSource = NULL;
+  PluginChain pluginChain;
+  CharString pluginSearchRoot = newCharString();
+  boolByte shouldDisplayPluginInfo = false;
+  MidiSequence midiSequence = NULL;
+  MidiSource midiSource = NULL;
   unsigned long maxTimeInMs = 0;
+  unsigned long checkpointIntervalInMs = 0;
+  boolByte resume = false;
+  RenderCheckpoint checkpoint = NULL;
+  CharString checkpointFilename = NULL;
+  _CheckpointWriterMembers checkpointWriter;
+  _EditorThreadMembers editor = {NULL, NULL, NULL};
+  boolByte editorWhileProcessing = false;
+  RenderCacheKey renderCacheKey = NULL;
+  _StemOutputs stemOutputs = NULL;
+  CharString renderCacheOutput = NULL;
+  unsigned long startTimeInMs = 0;
+  unsigned long endTimeInMs = 0;
+  unsigned long inputLengthInFrames = 0;
   unsigned long maxTimeInFrames = 0;
   unsigned long processingDelayInFrames;
+  boolByte mapInput = false;
+  unsigned int prefetchBlocks = 0;
+  unsigned int writeBehindBlocks = 0;
+  boolByte convertBehind = false;
+  unsigned int warmupBlocks = 0;
+  SampleCount ioBlocksize = 0;
+  SampleCount autoBlocksize = 0;
+  unsigned int flacLevel;
+  unsigned int flacThreads = 1;
+  SampleRate resampleRate = 0.0;
+  ResamplerQuality resampleQuality;
+  CharString resampleQualityName;
+  SampleRate inputSampleRate;
+  boolByte pipelined = false;
+  boolByte skipSilence = false;
+  size_t noteCacheSize = 0;
+  boolByte flushDenormals = true;
+  boolByte lockMemory = false;
+  double memoryBudgetInMb;
+  boolByte channelInstances = false;
+  boolByte parallelLoading = false;
+  CharString isolatedHost = NULL;
+  double watchdogBudgetInMs = 0.0;
+  PluginWatchdog watchdog = NULL;
+  PluginAutomation automation = NULL;
+  boolByte flushTail = false;
+  double stopOnSilenceInMs = 0.0;
+  boolByte realtimeAudit = false;
   ProgramOptions programOptions;
   ProgramOption option;
   Plugin headPlugin;
@@ -350,23 +4965,51 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
   TaskTimer initTimer, totalTimer, inputTimer, outputTimer = NULL;
   LinkedList taskTimerList = NULL;
   CharString totalTimeString = NULL;
-  boolByte finishedReading = false;
-  SampleSource silentSampleOutput;
+  CharString latencyReportPath = NULL;
+  CharString analysisReportPath = NULL;
+  AudioAnalysis analysis = NULL;
+  LoudnessMeter meter = NULL;
+  SampleSource analyzedSource = NULL;
+  OutputHashes outputHashes = NULL;
+  CharString outputHashesPath = NULL;
+  CharString compareHashesPath = NULL;
+  SampleSource hashedSource = NULL;
+  CharString perfReportPath = NULL;
+  CharString profilePath = NULL;
+  unsigned long framesProcessed = 0;
+  LinkedList inputList = NULL;
+  _InputListJob *inputListJobs = NULL;
+  int numInputListJobs = 0;
+  _InputListWorkersMembers inputListWorkers;
+  LinkedList inputListWorkerThreads = NULL;
+  LinkedList jobDispatchers = NULL;
+  unsigned int numJobThreads = 1;
+  CharString numaProcessors = NULL;
+  unsigned int numSegments = 0;
+  boolByte renderRange = false;
+  unsigned long rangeStartFrame = 0;
+  unsigned long rangeEndFrame = 0;
+  unsigned long rangePrerollFrames = 0;
+  unsigned long rangeNumFrames = 0;
+  SampleSource finalOutputSource = NULL;
+  SampleSource sharedOutputSource = NULL;
   unsigned int i;
 
   initTimer = newTaskTimerWithCString(PROGRAM_NAME, "Initialization");
   totalTimer = newTaskTimerWithCString(PROGRAM_NAME, "Total Time");
   taskTimerStart(initTimer);
   taskTimerStart(totalTimer);
+  _startupProfileStart();
 
   initEventLogger();
   initAudioSettings();
   initAudioClock();
-  audioClock = getAudioClock();
   initPluginChain();
   pluginChain = getPluginChain();
+  _startupProfileMark("Subsystems");
   programOptions = newMrsWatsonOptions();
   inputSource = sampleSourceFactory(NULL);
+  _startupProfileMark("Option table");
 
   if (!programOptionsParseArgs(programOptions, argc, argv)) {
     printf("Run with '--help' to see possible options\n");
@@ -481,6 +5124,7 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     programOptions->options[OPTION_VERBOSE]->enabled = true;
     programOptions->options[OPTION_LOG_FILE]->enabled = true;
     programOptions->options[OPTION_DISPLAY_INFO]->enabled = true;
+    programOptions->options[OPTION_TRACE_FILE]->enabled = true;
     // Shell script with original command line arguments
     errorReporterCreateLauncher(errorReporter, argc, argv);
     // Rewrite some paths before any input or output sources have been opened.
@@ -492,6 +5136,8 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
                             true);
     _remapFileToErrorReport(errorReporter, programOptions, OPTION_LOG_FILE,
                             false);
+    _remapFileToErrorReport(errorReporter, programOptions, OPTION_TRACE_FILE,
+                            false);
   }
 
   // Read in options from a configuration file, if given
@@ -513,6 +5159,8 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     }
   }
 
+  _startupProfileMark("Arguments");
+
   // Parse these options first so that log messages displayed in the below
   // loop are properly displayed
   if (programOptions->options[OPTION_VERBOSE]->enabled) {
@@ -547,6 +5195,30 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
 
     if (option->enabled) {
       switch (option->index) {
+      case OPTION_AUTOMATION:
+        automation = newPluginAutomation();
+
+        if (!pluginAutomationReadFile(
+                automation,
+                programOptionsGetString(programOptions, OPTION_AUTOMATION))) {
+          freePluginAutomation(automation);
+          freeSampleSource(inputSource);
+          freeSampleSource(outputSource);
+          freePluginChain(pluginChain);
+          freeProgramOptions(programOptions);
+          freeTaskTimer(initTimer);
+          freeTaskTimer(totalTimer);
+          freeCharString(pluginSearchRoot);
+          freeMidiSource(midiSource);
+          freeAudioSettings();
+          freeEventLogger();
+          freeAudioClock(getAudioClock());
+          return RETURN_CODE_INVALID_ARGUMENT;
+        }
+
+        pluginChainSetAutomation(pluginChain, automation);
+        break;
+
       case OPTION_BIT_DEPTH:
         if (!setBitDepth((const BitDepth)(short)programOptionsGetNumber(
                 programOptions, OPTION_BIT_DEPTH))) {
@@ -585,6 +5257,11 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
 
         break;
 
+      case OPTION_CHANNEL_INSTANCES:
+        channelInstances = true;
+        pluginChainSetChannelInstances(pluginChain, true);
+        break;
+
       case OPTION_CHANNELS:
         if (!setNumChannels((const ChannelCount)programOptionsGetNumber(
                 programOptions, OPTION_CHANNELS))) {
@@ -604,21 +5281,210 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
 
         break;
 
+      case OPTION_CHECKPOINT:
+        checkpointIntervalInMs = (unsigned long)programOptionsGetNumber(
+            programOptions, OPTION_CHECKPOINT);
+        break;
+
+      case OPTION_CPU_AFFINITY:
+        if (!threadSetAffinityList(
+                programOptionsGetString(programOptions, OPTION_CPU_AFFINITY)
+                    ->data)) {
+          freeSampleSource(inputSource);
+          freeSampleSource(outputSource);
+          freePluginChain(pluginChain);
+          freeProgramOptions(programOptions);
+          freeTaskTimer(initTimer);
+          freeTaskTimer(totalTimer);
+          freeCharString(pluginSearchRoot);
+          freeMidiSource(midiSource);
+          freeAudioSettings();
+          freeEventLogger();
+          freeAudioClock(getAudioClock());
+          return RETURN_CODE_INVALID_ARGUMENT;
+        }
+
+        break;
+
+      case OPTION_DECODE_CACHE:
+        if (!initSampleSourceCache(
+                programOptionsGetString(programOptions, OPTION_DECODE_CACHE))) {
+          freeSampleSource(inputSource);
+          freeSampleSource(outputSource);
+          freePluginChain(pluginChain);
+          freeProgramOptions(programOptions);
+          freeTaskTimer(initTimer);
+          freeTaskTimer(totalTimer);
+          freeCharString(pluginSearchRoot);
+          freeMidiSource(midiSource);
+          freeAudioSettings();
+          freeEventLogger();
+          freeAudioClock(getAudioClock());
+          return RETURN_CODE_INVALID_ARGUMENT;
+        }
+
+        break;
+
+      case OPTION_DEGRADE:
+        if (!pluginChainSetDegradePolicies(
+                pluginChain,
+                programOptionsGetList(programOptions, OPTION_DEGRADE))) {
+          freeSampleSource(inputSource);
+          freeSampleSource(outputSource);
+          freePluginChain(pluginChain);
+          freeProgramOptions(programOptions);
+          freeTaskTimer(initTimer);
+          freeTaskTimer(totalTimer);
+          freeCharString(pluginSearchRoot);
+          freeMidiSource(midiSource);
+          freeAudioSettings();
+          freeEventLogger();
+          freeAudioClock(getAudioClock());
+          return RETURN_CODE_INVALID_ARGUMENT;
+        }
+
+        if (!programOptions->options[OPTION_REALTIME]->enabled) {
+          logWarn("Plugins are only degraded with --realtime");
+        }
+
+        break;
+
       case OPTION_DISPLAY_INFO:
         shouldDisplayPluginInfo = true;
         break;
 
+      case OPTION_DITHER:
+        if (!setDitherTypeFromString(
+                programOptionsGetString(programOptions, OPTION_DITHER))) {
+          freeSampleSource(inputSource);
+          freeSampleSource(outputSource);
+          freePluginChain(pluginChain);
+          freeProgramOptions(programOptions);
+          freeTaskTimer(initTimer);
+          freeTaskTimer(totalTimer);
+          freeCharString(pluginSearchRoot);
+          freeMidiSource(midiSource);
+          freeAudioSettings();
+          freeEventLogger();
+          freeAudioClock(getAudioClock());
+          return RETURN_CODE_INVALID_ARGUMENT;
+        }
+
+        break;
+
+      case OPTION_END:
+        endTimeInMs = (unsigned long)programOptionsGetNumber(programOptions,
+                                                             OPTION_END);
+        renderRange = true;
+        break;
+
+      case OPTION_FLAC_THREADS:
+        flacThreads = (unsigned int)programOptionsGetNumber(
+            programOptions, OPTION_FLAC_THREADS);
+
+        if (flacThreads == 0) {
+          flacThreads = platformInfoGetNumProcessors();
+        }
+
+        break;
+
+      case OPTION_FLUSH_TAIL:
+        flushTail = true;
+        break;
+
+      case OPTION_IDLE_INTERVAL:
+        pluginIdlerSetInterval(
+            programOptionsGetNumber(programOptions, OPTION_IDLE_INTERVAL));
+        break;
+
       case OPTION_INPUT_SOURCE:
         freeSampleSource(inputSource);
         inputSource = sampleSourceFactory(
             programOptionsGetString(programOptions, OPTION_INPUT_SOURCE));
         break;
 
+      case OPTION_INPUT_MMAP:
+        mapInput = true;
+        break;
+
+      case OPTION_IO_BLOCKSIZE:
+        ioBlocksize = (SampleCount)programOptionsGetNumber(programOptions,
+                                                           OPTION_IO_BLOCKSIZE);
+        break;
+
+      case OPTION_ISOLATE:
+        isolatedHost = programOptionsGetString(programOptions, OPTION_ISOLATE);
+        pluginChainSetIsolatedHost(pluginChain, isolatedHost);
+        break;
+
+      case OPTION_JOBS:
+        numJobThreads =
+            (unsigned int)programOptionsGetNumber(programOptions, OPTION_JOBS);
+
+        if (numJobThreads == 0) {
+          numJobThreads = platformInfoGetNumProcessors();
+        }
+
+        break;
+
+      case OPTION_KEEP_DENORMALS:
+        flushDenormals = false;
+        pluginChainSetFlushDenormals(pluginChain, false);
+        break;
+
+      case OPTION_LOCK_MEMORY:
+        lockMemory = true;
+        break;
+
       case OPTION_MAX_TIME:
         maxTimeInMs = (const unsigned long)programOptionsGetNumber(
             programOptions, OPTION_MAX_TIME);
         break;
 
+      case OPTION_MEMORY_BUDGET:
+        memoryBudgetInMb =
+            programOptionsGetNumber(programOptions, OPTION_MEMORY_BUDGET);
+
+        if (memoryBudgetInMb <= 0.0) {
+          logError("Invalid memory budget of %gMB", memoryBudgetInMb);
+          freeSampleSource(inputSource);
+          freeSampleSource(outputSource);
+          freePluginChain(pluginChain);
+          freeProgramOptions(programOptions);
+          freeTaskTimer(initTimer);
+          freeTaskTimer(totalTimer);
+          freeCharString(pluginSearchRoot);
+          freeMidiSource(midiSource);
+          freeAudioSettings();
+          freeEventLogger();
+          freeAudioClock(getAudioClock());
+          return RETURN_CODE_INVALID_ARGUMENT;
+        }
+
+        initMemoryUsage();
+        memoryUsageSetBudget((size_t)(memoryBudgetInMb * 1024.0 * 1024.0));
+        break;
+
+      case OPTION_MIDI_ROUTE:
+        if (!pluginChainSetMidiRoutes(
+                pluginChain,
+                programOptionsGetList(programOptions, OPTION_MIDI_ROUTE))) {
+          freeSampleSource(inputSource);
+          freeSampleSource(outputSource);
+          freePluginChain(pluginChain);
+          freeProgramOptions(programOptions);
+          freeTaskTimer(initTimer);
+          freeTaskTimer(totalTimer);
+          freeCharString(pluginSearchRoot);
+          freeMidiSource(midiSource);
+          freeAudioSettings();
+          freeEventLogger();
+          freeAudioClock(getAudioClock());
+          return RETURN_CODE_INVALID_ARGUMENT;
+        }
+
+        break;
+
       case OPTION_MIDI_SOURCE:
         freeMidiSource(midiSource);
         midiSource = newMidiSource(
@@ -627,25 +5493,214 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
             programOptionsGetString(programOptions, OPTION_MIDI_SOURCE));
         break;
 
+      case OPTION_NOTE_CACHE:
+        noteCacheSize = (size_t)programOptionsGetNumber(programOptions,
+                                                        OPTION_NOTE_CACHE) *
+                        1024 * 1024;
+        pluginChainSetNoteRenderCache(pluginChain, noteCacheSize);
+        break;
+
+      case OPTION_NUMA_NODE:
+        if (programOptions->options[OPTION_CPU_AFFINITY]->enabled) {
+          logWarn("Ignoring --numa-node, since --cpu-affinity was also given");
+          break;
+        }
+
+        numaProcessors = platformInfoGetNumaNodeProcessors(
+            (unsigned int)programOptionsGetNumber(programOptions,
+                                                  OPTION_NUMA_NODE));
+
+        if (numaProcessors == NULL ||
+            !threadSetAffinityList(numaProcessors->data)) {
+          freeCharString(numaProcessors);
+          freeSampleSource(inputSource);
+          freeSampleSource(outputSource);
+          freePluginChain(pluginChain);
+          freeProgramOptions(programOptions);
+          freeTaskTimer(initTimer);
+          freeTaskTimer(totalTimer);
+          freeCharString(pluginSearchRoot);
+          freeMidiSource(midiSource);
+          freeAudioSettings();
+          freeEventLogger();
+          freeAudioClock(getAudioClock());
+          return RETURN_CODE_INVALID_ARGUMENT;
+        }
+
+        logInfo("Pinned processing thread to processors %s",
+                numaProcessors->data);
+        freeCharString(numaProcessors);
+        break;
+
+      case OPTION_OFFLINE:
+        if (programOptions->options[OPTION_REALTIME]->enabled) {
+          logWarn("Ignoring --offline, which cannot be combined with "
+                  "--realtime");
+        } else {
+          pluginVst2xSetRenderMode(PLUGIN_VST2X_RENDER_MODE_OFFLINE);
+        }
+        break;
+
       case OPTION_OUTPUT_SOURCE:
         freeSampleSource(outputSource);
         outputSource = sampleSourceFactory(
             programOptionsGetString(programOptions, OPTION_OUTPUT_SOURCE));
         break;
 
+      case OPTION_PARALLEL_LOAD:
+        parallelLoading = true;
+        pluginChainSetParallelLoading(pluginChain, true);
+        break;
+
+      case OPTION_PLUGIN_INDEX:
+        pluginVst2xSetIndexFile(
+            programOptionsGetString(programOptions, OPTION_PLUGIN_INDEX));
+        break;
+
       case OPTION_PLUGIN_ROOT:
         charStringCopy(
             pluginSearchRoot,
             programOptionsGetString(programOptions, OPTION_PLUGIN_ROOT));
         break;
 
+      case OPTION_PCM_PLANAR:
+        setPlanarPcm(true);
+        break;
+
+      case OPTION_PERF_COUNTERS:
+        if (perfCountersIsAvailable()) {
+          pluginChainSetMeasurePerfCounters(pluginChain, true);
+        } else {
+          logWarn("Hardware performance counters are not available, ignoring "
+                  "--perf-counters");
+        }
+        break;
+
+      case OPTION_PERF_REPORT:
+        // Only memory which is allocated from now on is counted
+        initMemoryUsage();
+        break;
+
+      case OPTION_PIPELINE:
+        pipelined = true;
+        pluginChainSetPipelined(pluginChain, true);
+        break;
+
+      case OPTION_PREFETCH:
+        prefetchBlocks = (unsigned int)programOptionsGetNumber(programOptions,
+                                                               OPTION_PREFETCH);
+        break;
+
+      case OPTION_PRESET_CACHE:
+        initPluginPresetCache((size_t)programOptionsGetNumber(
+                                  programOptions, OPTION_PRESET_CACHE) *
+                              1024 * 1024);
+        break;
+
       case OPTION_REALTIME:
         pluginChainSetRealtime(pluginChain, true);
+        pluginVst2xSetRenderMode(PLUGIN_VST2X_RENDER_MODE_REALTIME);
+        break;
+
+      case OPTION_RENDER_CACHE:
+        if (!initRenderCache(
+                programOptionsGetString(programOptions, OPTION_RENDER_CACHE))) {
+          freeSampleSource(inputSource);
+          freeSampleSource(outputSource);
+          freePluginChain(pluginChain);
+          freeProgramOptions(programOptions);
+          freeTaskTimer(initTimer);
+          freeTaskTimer(totalTimer);
+          freeCharString(pluginSearchRoot);
+          freeMidiSource(midiSource);
+          freeAudioSettings();
+          freeEventLogger();
+          freeAudioClock(getAudioClock());
+          return RETURN_CODE_INVALID_ARGUMENT;
+        }
+
+        break;
+
+      case OPTION_RESAMPLE:
+        resampleRate = programOptionsGetNumber(programOptions, OPTION_RESAMPLE);
+
+        if (resampleRate <= 0.0) {
+          logError("Invalid sample rate %f for --resample", resampleRate);
+          freeSampleSource(inputSource);
+          freeSampleSource(outputSource);
+          freePluginChain(pluginChain);
+          freeProgramOptions(programOptions);
+          freeTaskTimer(initTimer);
+          freeTaskTimer(totalTimer);
+          freeCharString(pluginSearchRoot);
+          freeMidiSource(midiSource);
+          freeAudioSettings();
+          freeEventLogger();
+          freeAudioClock(getAudioClock());
+          return RETURN_CODE_INVALID_ARGUMENT;
+        }
+
+        break;
+
+      case OPTION_RESUME:
+        resume = true;
+        break;
+
+      case OPTION_RT_AUDIT:
+        realtimeAudit = true;
+        break;
+
+      case OPTION_SAMPLE_RATE:
+        if (!setSampleRate(
+                programOptionsGetNumber(programOptions, OPTION_SAMPLE_RATE))) {
+          freeSampleSource(inputSource);
+          freeSampleSource(outputSource);
+          freePluginChain(pluginChain);
+          freeProgramOptions(programOptions);
+          freeTaskTimer(initTimer);
+          freeTaskTimer(totalTimer);
+          freeCharString(pluginSearchRoot);
+          freeMidiSource(midiSource);
+          freeAudioSettings();
+          freeEventLogger();
+          freeAudioClock(getAudioClock());
+          return RETURN_CODE_INVALID_ARGUMENT;
+        }
+
+        break;
+
+      case OPTION_SEGMENTS:
+        numSegments = (unsigned int)programOptionsGetNumber(programOptions,
+                                                            OPTION_SEGMENTS);
+        break;
+
+      case OPTION_SERIAL_LOAD:
+        pluginChainSetSerialLoadPlugins(
+            pluginChain,
+            programOptionsGetList(programOptions, OPTION_SERIAL_LOAD));
+        break;
+
+      case OPTION_SKIP_SILENCE:
+        skipSilence = true;
+        pluginChainSetSkipSilence(pluginChain, true);
+        break;
+
+      case OPTION_SPARSE_OUTPUT:
+        setSparseOutput(true);
+        break;
+
+      case OPTION_START:
+        startTimeInMs = (unsigned long)programOptionsGetNumber(programOptions,
+                                                               OPTION_START);
+        renderRange = true;
         break;
 
-      case OPTION_SAMPLE_RATE:
-        if (!setSampleRate(
-                programOptionsGetNumber(programOptions, OPTION_SAMPLE_RATE))) {
+      case OPTION_STOP_ON_SILENCE:
+        stopOnSilenceInMs =
+            programOptionsGetNumber(programOptions, OPTION_STOP_ON_SILENCE);
+
+        if (stopOnSilenceInMs <= 0.0) {
+          logError("Invalid silence time %gms", stopOnSilenceInMs);
           freeSampleSource(inputSource);
           freeSampleSource(outputSource);
           freePluginChain(pluginChain);
@@ -697,22 +5752,552 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
           return RETURN_CODE_INVALID_ARGUMENT;
         }
 
-        break;
+        break;
+
+      case OPTION_WATCHDOG:
+        watchdogBudgetInMs =
+            programOptionsGetNumber(programOptions, OPTION_WATCHDOG);
+
+        if (watchdogBudgetInMs <= 0.0) {
+          logError("Invalid watchdog budget, must be greater than 0ms");
+          freeSampleSource(inputSource);
+          freeSampleSource(outputSource);
+          freePluginChain(pluginChain);
+          freeProgramOptions(programOptions);
+          freeTaskTimer(initTimer);
+          freeTaskTimer(totalTimer);
+          freeCharString(pluginSearchRoot);
+          freeMidiSource(midiSource);
+          freeAudioSettings();
+          freeEventLogger();
+          freeAudioClock(getAudioClock());
+          return RETURN_CODE_INVALID_ARGUMENT;
+        }
+
+        break;
+
+      case OPTION_WARMUP:
+        warmupBlocks = (unsigned int)programOptionsGetNumber(programOptions,
+                                                             OPTION_WARMUP);
+        break;
+
+      case OPTION_WRITE_BEHIND:
+        writeBehindBlocks = (unsigned int)programOptionsGetNumber(
+            programOptions, OPTION_WRITE_BEHIND);
+        break;
+
+      case OPTION_ZEBRA_SIZE:
+        setLoggingZebraSize((const unsigned long)programOptionsGetNumber(
+            programOptions, OPTION_ZEBRA_SIZE));
+        break;
+
+      default:
+        // Ignore -- no special handling needs to be performed here
+        break;
+      }
+    }
+  }
+
+  // The FLAC level has a default value, so it is needed even when not given
+  flacLevel =
+      (unsigned int)programOptionsGetNumber(programOptions, OPTION_FLAC_LEVEL);
+
+  resampleQualityName =
+      programOptionsGetString(programOptions, OPTION_RESAMPLE_QUALITY);
+
+  if (!resamplerQualityFromString(resampleQualityName->data,
+                                  &resampleQuality)) {
+    logError("Unknown resampling quality '%s'", resampleQualityName->data);
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  // The plugins are opened with the largest blocksize which is tried, and I/O
+  // is always done in blocks of that size or a multiple of it, so that only
+  // the chain's blocksize changes once the fastest one is known
+  if (programOptions->options[OPTION_AUTO_BLOCKSIZE]->enabled) {
+    if (programOptions->options[OPTION_REALTIME]->enabled ||
+        programOptions->options[OPTION_SERVE]->enabled ||
+        programOptions->options[OPTION_MANIFEST]->enabled ||
+        programOptions->options[OPTION_FAN_OUT]->enabled ||
+        programOptions->options[OPTION_STREAMS]->enabled) {
+      logWarn("Ignoring --auto-blocksize, which only applies to offline "
+              "processing of a single input");
+    } else if (setBlocksize((SampleCount)programOptionsGetNumber(
+                   programOptions, OPTION_AUTO_BLOCKSIZE))) {
+      autoBlocksize = getBlocksize();
+      ioBlocksize = _getIoBlocksize(ioBlocksize);
+    } else {
+      freeSampleSource(inputSource);
+      freeSampleSource(outputSource);
+      freePluginChain(pluginChain);
+      freeProgramOptions(programOptions);
+      freeTaskTimer(initTimer);
+      freeTaskTimer(totalTimer);
+      freeCharString(pluginSearchRoot);
+      freeMidiSource(midiSource);
+      freeAudioSettings();
+      freeEventLogger();
+      freeAudioClock(getAudioClock());
+      return RETURN_CODE_INVALID_ARGUMENT;
+    }
+  }
+
+  if (programOptions->options[OPTION_LIST_PLUGINS]->enabled) {
+    listAvailablePlugins(pluginSearchRoot);
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return RETURN_CODE_NOT_RUN;
+  }
+
+  if (programOptions->options[OPTION_LIST_FILE_TYPES]->enabled) {
+    sampleSourcePrintSupportedTypes();
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return RETURN_CODE_NOT_RUN;
+  }
+
+  if (programOptions->options[OPTION_SCAN_PLUGINS]->enabled) {
+    unsigned int numScanJobs = (unsigned int)programOptionsGetNumber(
+        programOptions, OPTION_SCAN_PLUGINS);
+    if (numScanJobs == 0) {
+      numScanJobs = platformInfoGetNumProcessors();
+    }
+
+    result = scanAvailablePluginsVst2x(pluginSearchRoot, numScanJobs,
+                                       kMrsWatsonPluginScanTimeoutInMs)
+                 ? RETURN_CODE_NOT_RUN
+                 : RETURN_CODE_MISSING_REQUIRED_OPTION;
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return result;
+  }
+
+  if (programOptions->options[OPTION_PLUGIN_CAPABILITY]->enabled) {
+    result = pluginVst2xSetCapabilities(
+                 programOptionsGetList(programOptions,
+                                       OPTION_PLUGIN_CAPABILITY),
+                 pluginSearchRoot)
+                 ? RETURN_CODE_NOT_RUN
+                 : RETURN_CODE_INVALID_ARGUMENT;
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return result;
+  }
+
+  if (programOptions->options[OPTION_PLUGIN_HOST]->enabled) {
+    result = pluginIsolatedServe(
+        programOptionsGetString(programOptions, OPTION_PLUGIN_HOST));
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return result;
+  }
+
+  if (programOptions->options[OPTION_SCAN_PLUGIN]->enabled) {
+    result = pluginVst2xScan(
+                 programOptionsGetString(programOptions, OPTION_SCAN_PLUGIN))
+                 ? RETURN_CODE_NOT_RUN
+                 : RETURN_CODE_PLUGIN_ERROR;
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return result;
+  }
+
+  _startupProfileMark("Options");
+  printWelcomeMessage(argc, argv);
+  _startupProfileMark("Welcome message");
+
+  if (programOptions->options[OPTION_SERVE]->enabled ||
+      programOptions->options[OPTION_MANIFEST]->enabled ||
+      programOptions->options[OPTION_FAN_OUT]->enabled ||
+      programOptions->options[OPTION_STREAMS]->enabled) {
+    _RenderServerSettings serverSettings;
+    CharString serverAddress = newCharString();
+    RenderManifest manifest = NULL;
+    LinkedList fanOutVariants = NULL;
+    LinkedList streams = NULL;
+    const boolByte pinStreamThreads =
+        (boolByte)!programOptions->options[OPTION_CPU_AFFINITY]->enabled;
+
+    serverSettings.pluginSearchRoot = pluginSearchRoot;
+    serverSettings.mapInput = mapInput;
+    serverSettings.prefetchBlocks = prefetchBlocks;
+    serverSettings.writeBehindBlocks = writeBehindBlocks;
+    serverSettings.warmupBlocks = warmupBlocks;
+    serverSettings.ioBlocksize = ioBlocksize;
+    serverSettings.flacLevel = flacLevel;
+    serverSettings.flacThreads = flacThreads;
+    serverSettings.pipelined = pipelined;
+    serverSettings.skipSilence = skipSilence;
+    serverSettings.noteCacheSize = noteCacheSize;
+    serverSettings.flushDenormals = flushDenormals;
+    serverSettings.channelInstances = channelInstances;
+    serverSettings.parallelLoading = parallelLoading;
+    serverSettings.serialLoadPlugins =
+        programOptionsGetList(programOptions, OPTION_SERIAL_LOAD);
+    serverSettings.midiRoutes =
+        programOptionsGetList(programOptions, OPTION_MIDI_ROUTE);
+    serverSettings.isolatedHost = isolatedHost;
+    serverSettings.flushTail = flushTail;
+    serverSettings.stopOnSilenceInMs = stopOnSilenceInMs;
+    serverSettings.sampleRate = getSampleRate();
+    serverSettings.blocksize = getBlocksize();
+    serverSettings.numChannels = getNumChannels();
+    serverSettings.numWorkers = 0;
+    serverSettings.preloadPluginChain = NULL;
+
+    if (programOptions->options[OPTION_SERVER_WORKERS]->enabled) {
+      if (programOptions->options[OPTION_SERVE]->enabled) {
+        serverSettings.numWorkers = (unsigned int)programOptionsGetNumber(
+            programOptions, OPTION_SERVER_WORKERS);
+      } else {
+        logWarn("Ignoring --server-workers, which only applies to --serve");
+      }
+    }
+
+    if (serverSettings.numWorkers > 0 &&
+        programOptions->options[OPTION_PLUGIN]->enabled) {
+      serverSettings.preloadPluginChain =
+          programOptionsGetString(programOptions, OPTION_PLUGIN);
+    }
+
+    profilePath = _startSamplingProfiler(programOptions);
+    _startLiveMetrics(programOptions);
+    _startTraceEvents(programOptions);
+
+    if (automation != NULL) {
+      logWarn("Automation is not applied to the plugin chains of server, "
+              "manifest or fan-out jobs");
+    }
+
+    if (programOptions->options[OPTION_ANALYZE_OUTPUT]->enabled) {
+      logWarn("The output of server, manifest or fan-out jobs is not "
+              "analyzed");
+    }
+
+    if (programOptions->options[OPTION_OUTPUT_HASHES]->enabled ||
+        programOptions->options[OPTION_COMPARE_HASHES]->enabled) {
+      logWarn("The output of server, manifest or fan-out jobs is not hashed");
+    }
+
+    if (programOptions->options[OPTION_SIDECHAIN_SOURCE]->enabled) {
+      logWarn("Ignoring --sidechain-source, server, manifest or fan-out jobs "
+              "have no sidechain");
+    }
+
+    if (programOptions->options[OPTION_CONTROL]->enabled) {
+      logWarn("Ignoring --control, the plugin chains of server, manifest or "
+              "fan-out jobs cannot be changed while processing");
+    }
+
+    realtimeAuditSetEnabled(realtimeAudit);
+
+    if (programOptions->options[OPTION_SERVE]->enabled) {
+      charStringCopy(serverAddress,
+                     programOptionsGetString(programOptions, OPTION_SERVE));
+      result = _runServer(serverAddress, &serverSettings);
+    } else if (programOptions->options[OPTION_FAN_OUT]->enabled) {
+      if (stopOnSilenceInMs > 0.0) {
+        logWarn("Ignoring --stop-on-silence, variants of a fan-out only flush "
+                "their tail with --flush-tail");
+      }
+
+      fanOutVariants = _readFanOutVariants(
+          programOptionsGetString(programOptions, OPTION_FAN_OUT));
+
+      if (!programOptions->options[OPTION_INPUT_SOURCE]->enabled ||
+          midiSource != NULL) {
+        logError("A fan-out needs an input source, and cannot be combined "
+                 "with a MIDI source");
+        result = RETURN_CODE_INVALID_ARGUMENT;
+      } else {
+        result = fanOutVariants != NULL
+                     ? _runFanOut(programOptionsGetString(
+                                      programOptions, OPTION_INPUT_SOURCE),
+                                  fanOutVariants, &serverSettings)
+                     : RETURN_CODE_INVALID_ARGUMENT;
+      }
+
+      freeLinkedListAndItems(fanOutVariants,
+                             (LinkedListFreeItemFunc)freeRenderRequest);
+    } else if (programOptions->options[OPTION_STREAMS]->enabled) {
+      if (stopOnSilenceInMs > 0.0) {
+        logWarn("Ignoring --stop-on-silence, streams only flush their tail "
+                "with --flush-tail");
+      }
+
+      // Without --jobs, the scheduler uses one worker per processor
+      streams =
+          _readStreams(programOptionsGetString(programOptions, OPTION_STREAMS));
+      result = streams != NULL
+                   ? _runStreams(streams, &serverSettings,
+                                 programOptions->options[OPTION_JOBS]->enabled
+                                     ? numJobThreads
+                                     : 0,
+                                 pinStreamThreads)
+                   : RETURN_CODE_INVALID_ARGUMENT;
+      freeLinkedListAndItems(streams,
+                             (LinkedListFreeItemFunc)freeRenderRequest);
+    } else {
+      manifest = newRenderManifest();
+      result = renderManifestRead(
+                   manifest,
+                   programOptionsGetString(programOptions, OPTION_MANIFEST))
+                   ? _runManifest(manifest, &serverSettings, numJobThreads)
+                   : RETURN_CODE_INVALID_ARGUMENT;
+      freeRenderManifest(manifest);
+    }
+
+    result = _finishRealtimeAudit(realtimeAudit, result);
+    _finishSamplingProfiler(profilePath);
+    liveMetricsStopServer();
+    _finishTraceEvents(programOptions);
+    // The serial load and MIDI route lists belong to the options, so they are
+    // kept until the server or manifest has finished
+    freeProgramOptions(programOptions);
+    freeCharString(serverAddress);
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freePluginAutomation(automation);
+    freePluginPresetCache();
+    freeSampleSourceCache();
+    freeMemoryUsage();
+    freeAudioSettings();
+    logInfo("Goodbye!");
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return result;
+  }
+
+  if (programOptions->options[OPTION_INPUT_LIST]->enabled) {
+    if (midiSource != NULL) {
+      logError("An input list cannot be combined with a MIDI source");
+    } else {
+      inputList = _readInputList(
+          programOptionsGetString(programOptions, OPTION_INPUT_LIST));
+    }
+
+    if (inputList == NULL) {
+      freeSampleSource(inputSource);
+      freeSampleSource(outputSource);
+      freePluginChain(pluginChain);
+      freeProgramOptions(programOptions);
+      freeTaskTimer(initTimer);
+      freeTaskTimer(totalTimer);
+      freeCharString(pluginSearchRoot);
+      freeMidiSource(midiSource);
+      freeAudioSettings();
+      freeEventLogger();
+      freeAudioClock(getAudioClock());
+      return RETURN_CODE_INVALID_ARGUMENT;
+    }
+
+    // The first job takes the place of the regular input and output sources
+    inputListJobs = (_InputListJob *)linkedListToArray(inputList);
+    numInputListJobs = linkedListLength(inputList);
+    logInfo("Processing %d jobs from input list", numInputListJobs);
+    freeSampleSource(inputSource);
+    inputSource = sampleSourceFactory(inputListJobs[0]->inputSource);
+    freeSampleSource(outputSource);
+    outputSource = sampleSourceFactory(inputListJobs[0]->outputSource);
+  }
+
+  if (numSegments > 1 &&
+      (inputList != NULL || midiSource != NULL || maxTimeInMs > 0 ||
+       resampleRate > 0.0)) {
+    logError("--segments cannot be combined with --input-list, --midi-file, "
+             "--max-time, or --resample");
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  // A checkpoint only describes a single render into a PCM or WAVE file, whose
+  // plugins see the same audio and parameter changes when resuming
+  if ((checkpointIntervalInMs > 0 || resume) &&
+      (numSegments > 1 || inputList != NULL || maxTimeInMs > 0 ||
+       resampleRate > 0.0 || automation != NULL || writeBehindBlocks > 0 ||
+       pipelined || isolatedHost != NULL || outputSource == NULL ||
+       !sampleSourcePcmCanResume(outputSource))) {
+    logError("--checkpoint and --resume need a PCM or WAVE output file, and "
+             "cannot be combined with --segments, --input-list, --max-time, "
+             "--resample, --automation, --write-behind, --pipeline, or "
+             "--isolate");
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  // The analysis is only made of a single output, written from start to end
+  if (programOptions->options[OPTION_ANALYZE_OUTPUT]->enabled &&
+      (numSegments > 1 || inputList != NULL || checkpointIntervalInMs > 0 ||
+       resume)) {
+    logError("--analyze-output cannot be combined with --segments, "
+             "--input-list, --checkpoint, or --resume");
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  // Stems are written next to a single output, from start to end
+  if (programOptions->options[OPTION_STEMS]->enabled &&
+      (numSegments > 1 || inputList != NULL || checkpointIntervalInMs > 0 ||
+       resume)) {
+    logError("--stems cannot be combined with --segments, --input-list, "
+             "--checkpoint, or --resume");
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
 
-      case OPTION_ZEBRA_SIZE:
-        setLoggingZebraSize((const unsigned long)programOptionsGetNumber(
-            programOptions, OPTION_ZEBRA_SIZE));
-        break;
+  // Segments hash their own blocks of the output, but the jobs of an input
+  // list have separate outputs, dispatched segments are rendered elsewhere,
+  // and a resumed output was partly written by an earlier run
+  if ((programOptions->options[OPTION_OUTPUT_HASHES]->enabled ||
+       programOptions->options[OPTION_COMPARE_HASHES]->enabled) &&
+      (inputList != NULL || programOptions->options[OPTION_DISPATCH]->enabled ||
+       resume)) {
+    logError("--output-hashes and --compare-hashes cannot be combined with "
+             "--input-list, --dispatch, or --resume");
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
 
-      default:
-        // Ignore -- no special handling needs to be performed here
-        break;
-      }
-    }
+  // Checkpointed renders are set up like a range, which starts at the
+  // checkpoint when resuming
+  if (checkpointIntervalInMs > 0 || resume) {
+    renderRange = true;
   }
 
-  if (programOptions->options[OPTION_LIST_PLUGINS]->enabled) {
-    listAvailablePlugins(pluginSearchRoot);
+  if (renderRange && (numSegments > 1 || inputList != NULL ||
+                      maxTimeInMs > 0 || resampleRate > 0.0)) {
+    logError("--start and --end cannot be combined with --segments, "
+             "--input-list, --max-time, or --resample");
     freeSampleSource(inputSource);
     freeSampleSource(outputSource);
     freePluginChain(pluginChain);
@@ -721,14 +6306,22 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     freeTaskTimer(totalTimer);
     freeCharString(pluginSearchRoot);
     freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
     freeAudioSettings();
     freeEventLogger();
     freeAudioClock(getAudioClock());
-    return RETURN_CODE_NOT_RUN;
+    return RETURN_CODE_INVALID_ARGUMENT;
   }
 
-  if (programOptions->options[OPTION_LIST_FILE_TYPES]->enabled) {
-    sampleSourcePrintSupportedTypes();
+  // The sidechain is read in step with a single input from its start
+  if (programOptions->options[OPTION_SIDECHAIN_SOURCE]->enabled &&
+      (numSegments > 1 || inputList != NULL || renderRange ||
+       resampleRate > 0.0 ||
+       programOptions->options[OPTION_DISPATCH]->enabled)) {
+    logError("--sidechain-source cannot be combined with --input-list, "
+             "--segments, --start, --end, --checkpoint, --resample, or "
+             "--dispatch");
     freeSampleSource(inputSource);
     freeSampleSource(outputSource);
     freePluginChain(pluginChain);
@@ -737,15 +6330,18 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     freeTaskTimer(totalTimer);
     freeCharString(pluginSearchRoot);
     freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
     freeAudioSettings();
     freeEventLogger();
     freeAudioClock(getAudioClock());
-    return RETURN_CODE_NOT_RUN;
+    return RETURN_CODE_INVALID_ARGUMENT;
   }
 
-  printWelcomeMessage(argc, argv);
+  inputSource = sampleSourceCacheWrap(inputSource);
 
-  if ((result = setupInputSource(inputSource)) != RETURN_CODE_SUCCESS) {
+  if ((result = setupInputSource(inputSource, mapInput)) !=
+      RETURN_CODE_SUCCESS) {
     logError("Input source could not be opened, exiting");
     freeSampleSource(inputSource);
     freeSampleSource(outputSource);
@@ -755,17 +6351,58 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     freeTaskTimer(totalTimer);
     freeCharString(pluginSearchRoot);
     freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return result;
+  }
+
+  inputLengthInFrames = _getInputLengthInFrames(inputSource);
+  inputSampleRate = getSampleRate();
+  inputSource =
+      _resampleInputSource(inputSource, resampleRate, resampleQuality);
+  inputLengthInFrames = (unsigned long)((double)inputLengthInFrames *
+                                        getSampleRate() / inputSampleRate);
+
+  // A segmented input, or the range of it which is rendered, must be split
+  // before it is wrapped in any other sources
+  if (numSegments < 2 && !renderRange) {
+    inputSource =
+        _prefetchInputSource(inputSource, prefetchBlocks, ioBlocksize);
+  }
+
+  if (programOptions->options[OPTION_SIDECHAIN_SOURCE]->enabled &&
+      (result = _setupSidechainSource(
+           pluginChain,
+           programOptionsGetString(programOptions, OPTION_SIDECHAIN_SOURCE),
+           prefetchBlocks, ioBlocksize, &sidechainSource)) !=
+          RETURN_CODE_SUCCESS) {
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
     freeAudioSettings();
     freeEventLogger();
     freeAudioClock(getAudioClock());
     return result;
   }
 
+  _startupProfileMark("Input source");
+
   if ((result = buildPluginChain(
            pluginChain, programOptionsGetString(programOptions, OPTION_PLUGIN),
            pluginSearchRoot)) != RETURN_CODE_SUCCESS) {
     logError("Plugin chain could not be constructed, exiting");
     freeSampleSource(inputSource);
+    freeSampleSource(sidechainSource);
     freeSampleSource(outputSource);
     freePluginChain(pluginChain);
     freeProgramOptions(programOptions);
@@ -773,6 +6410,8 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     freeTaskTimer(totalTimer);
     freeCharString(pluginSearchRoot);
     freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
     freeAudioSettings();
     freeEventLogger();
     freeAudioClock(getAudioClock());
@@ -788,12 +6427,15 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     if (result != RETURN_CODE_SUCCESS) {
       logError("MIDI source could not be opened, exiting");
       freeSampleSource(inputSource);
+      freeSampleSource(sidechainSource);
       freeSampleSource(outputSource);
       freePluginChain(pluginChain);
       freeProgramOptions(programOptions);
       freeTaskTimer(initTimer);
       freeTaskTimer(totalTimer);
       freeMidiSource(midiSource);
+      freeLinkedListAndItems(inputList, _freeInputListJob);
+      free(inputListJobs);
       freeMidiSequence(midiSequence);
       freeAudioSettings();
       freeEventLogger();
@@ -811,18 +6453,25 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     }
   }
 
+  _startupProfileMark("Plugin chain and MIDI");
+  // Tracing starts here so that loading the plugins is included
+  _startTraceEvents(programOptions);
+
   // Initialize the plugin chain after the global sample rate has been set
   result = pluginChainInitialize(pluginChain);
 
   if (result != RETURN_CODE_SUCCESS) {
     logError("Could not initialize plugin chain");
     freeSampleSource(inputSource);
+    freeSampleSource(sidechainSource);
     freeSampleSource(outputSource);
     freePluginChain(pluginChain);
     freeProgramOptions(programOptions);
     freeTaskTimer(initTimer);
     freeTaskTimer(totalTimer);
     freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
     freeMidiSequence(midiSequence);
     freeAudioSettings();
     freeEventLogger();
@@ -830,21 +6479,34 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     return result;
   }
 
+  _startupProfileMark("Loading plugins");
+
   // Display info for plugins in the chain before checking for valid
   // input/output sources
   if (shouldDisplayPluginInfo) {
     pluginChainInspect(pluginChain);
   }
 
-  if (programOptions->options[OPTION_EDITOR]->enabled) {
+  // With a source to process, the editor is shown beside the processing
+  // thread, otherwise it is shown until its window is closed
+  editorWhileProcessing =
+      (boolByte)(programOptions->options[OPTION_EDITOR]->enabled &&
+                 (programOptions->options[OPTION_INPUT_SOURCE]->enabled ||
+                  midiSource != NULL));
+
+  if (programOptions->options[OPTION_EDITOR]->enabled &&
+      !editorWhileProcessing) {
     pluginChain->plugins[0]->showEditor(pluginChain->plugins[0]);
     freeSampleSource(inputSource);
+    freeSampleSource(sidechainSource);
     freeSampleSource(outputSource);
     freePluginChain(pluginChain);
     freeProgramOptions(programOptions);
     freeTaskTimer(initTimer);
     freeTaskTimer(totalTimer);
     freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
     freeSampleSource(inputSource);
     freeAudioSettings();
     freeEventLogger();
@@ -858,12 +6520,15 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
             pluginChain,
             programOptionsGetList(programOptions, OPTION_PARAMETER))) {
       freeSampleSource(inputSource);
+      freeSampleSource(sidechainSource);
       freeSampleSource(outputSource);
       freePluginChain(pluginChain);
       freeProgramOptions(programOptions);
       freeTaskTimer(initTimer);
       freeTaskTimer(totalTimer);
       freeMidiSource(midiSource);
+      freeLinkedListAndItems(inputList, _freeInputListJob);
+      free(inputListJobs);
       freeMidiSequence(midiSequence);
       freeAudioSettings();
       freeEventLogger();
@@ -872,18 +6537,171 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     }
   }
 
+  // The segments are set up once the plugin chain is initialized, since their
+  // default preroll depends on its processing delay and tail time
+  if (numSegments > 1) {
+    result = _setupSegments(numSegments,
+                            _getPrerollFrames(programOptions, pluginChain),
+                            inputLengthInFrames, &inputSource, &outputSource,
+                            &finalOutputSource, &inputList);
+
+    if (result != RETURN_CODE_SUCCESS) {
+      freeSampleSource(inputSource);
+      freeSampleSource(sidechainSource);
+      freeSampleSource(outputSource);
+      freeSampleSource(finalOutputSource);
+      freePluginChain(pluginChain);
+      freeProgramOptions(programOptions);
+      freeTaskTimer(initTimer);
+      freeTaskTimer(totalTimer);
+      freeMidiSource(midiSource);
+      freeLinkedListAndItems(inputList, _freeInputListJob);
+      freeMidiSequence(midiSequence);
+      freeAudioSettings();
+      freeEventLogger();
+      freeAudioClock(getAudioClock());
+      return result;
+    }
+
+    if (inputList != NULL) {
+      inputListJobs = (_InputListJob *)linkedListToArray(inputList);
+      numInputListJobs = linkedListLength(inputList);
+    }
+
+    // When no servers are involved, each segment can write straight into its
+    // part of the output from whichever thread renders it
+    if (finalOutputSource != NULL &&
+        !programOptions->options[OPTION_DISPATCH]->enabled &&
+        _shareSegmentOutput(finalOutputSource, inputLengthInFrames, flacLevel,
+                            flacThreads)) {
+      sharedOutputSource = finalOutputSource;
+      freeSampleSource(outputSource);
+      outputSource = newSampleSourcePcmRegion(sharedOutputSource, 0);
+    }
+
+    inputSource =
+        _prefetchInputSource(inputSource, prefetchBlocks, ioBlocksize);
+  }
+
+  // Like the segments, the range needs the preroll of the plugin chain. The
+  // plugins must also have their parameters before a checkpoint restores the
+  // state of some of them.
+  if (renderRange) {
+    rangeStartFrame = (unsigned long)(startTimeInMs * getSampleRate() / 1000.0);
+    rangeEndFrame = (unsigned long)(endTimeInMs * getSampleRate() / 1000.0);
+    result = RETURN_CODE_SUCCESS;
+
+    if (checkpointIntervalInMs > 0 || resume) {
+      result = _setupCheckpoint(resume, inputSource, outputSource, pluginChain,
+                                &rangeStartFrame, rangeEndFrame, &checkpoint);
+
+      if (result != RETURN_CODE_SUCCESS) {
+        inputSource->closeSampleSource(inputSource);
+      }
+    }
+
+    if (result == RETURN_CODE_SUCCESS) {
+      result = _setupRange(rangeStartFrame, rangeEndFrame,
+                           _getPrerollFrames(programOptions, pluginChain),
+                           midiSequence, &inputSource, &inputLengthInFrames,
+                           &rangePrerollFrames, &rangeNumFrames);
+    }
+
+    if (result != RETURN_CODE_SUCCESS) {
+      freeRenderCheckpoint(checkpoint);
+      freeSampleSource(inputSource);
+      freeSampleSource(sidechainSource);
+      freeSampleSource(outputSource);
+      freePluginChain(pluginChain);
+      freeProgramOptions(programOptions);
+      freeTaskTimer(initTimer);
+      freeTaskTimer(totalTimer);
+      freeMidiSource(midiSource);
+      freeMidiSequence(midiSequence);
+      freeAudioSettings();
+      freeEventLogger();
+      freeAudioClock(getAudioClock());
+      return result;
+    }
+
+    inputSource =
+        _prefetchInputSource(inputSource, prefetchBlocks, ioBlocksize);
+  }
+
+  // A resumed output keeps everything before the checkpoint
+  if (resume && checkpoint != NULL) {
+    sampleSourcePcmSetResumeFrame(outputSource, checkpoint->outputFrame);
+  }
+
+  // Only a plain file output of a single, non-interactive run can be cached
+  if (renderCacheIsEnabled() && finalOutputSource == NULL &&
+      inputList == NULL && !resume && checkpointIntervalInMs == 0 &&
+      !editorWhileProcessing &&
+      !programOptions->options[OPTION_CONTROL]->enabled &&
+      // A cached output is copied without being hashed
+      !programOptions->options[OPTION_OUTPUT_HASHES]->enabled &&
+      !programOptions->options[OPTION_COMPARE_HASHES]->enabled &&
+      // The key does not cover the contents of the sidechain
+      !programOptions->options[OPTION_SIDECHAIN_SOURCE]->enabled &&
+      // Only the output is cached, not the stems written next to it
+      !programOptions->options[OPTION_STEMS]->enabled &&
+      outputSource != NULL && _isRenderCacheOutput(outputSource)) {
+    renderCacheKey = _newRenderCacheKey(programOptions, pluginChain);
+  }
+
+  if (renderCacheKey != NULL) {
+    if (renderCacheFetch(renderCacheKey, outputSource->sourceName)) {
+      freeRenderCacheKey(renderCacheKey);
+      freeSampleSource(inputSource);
+      freeSampleSource(sidechainSource);
+      freeSampleSource(outputSource);
+      pluginChainShutdown(pluginChain);
+      freePluginChain(pluginChain);
+      pluginIdlerStop();
+      freeProgramOptions(programOptions);
+      freeTaskTimer(initTimer);
+      freeTaskTimer(totalTimer);
+      freeMidiSource(midiSource);
+      freeMidiSequence(midiSequence);
+      freeRenderCache();
+      freeAudioSettings();
+      freeEventLogger();
+      freeAudioClock(getAudioClock());
+      return RETURN_CODE_SUCCESS;
+    }
+
+    renderCachePrepareOutput(outputSource->sourceName);
+    renderCacheOutput =
+        newCharStringWithCString(outputSource->sourceName->data);
+  }
+
   // Setup output source here. Having an invalid output source should not cause
   // the program
   // to exit if the user only wants to list plugins or query info about a chain.
-  if ((result = setupOutputSource(outputSource)) != RETURN_CODE_SUCCESS) {
+  if ((result = setupOutputSource(outputSource, flacLevel, flacThreads)) !=
+          RETURN_CODE_SUCCESS ||
+      (resume && checkpoint != NULL &&
+       (result = _verifyResumedOutput(outputSource, checkpoint)) !=
+           RETURN_CODE_SUCCESS) ||
+      (programOptions->options[OPTION_STEMS]->enabled &&
+       (result = _openStemOutputs(outputSource, pluginChain, flacLevel,
+                                  flacThreads, writeBehindBlocks, ioBlocksize,
+                                  &stemOutputs)) != RETURN_CODE_SUCCESS)) {
     logError("Output source could not be opened, exiting");
+    freeRenderCheckpoint(checkpoint);
     freeSampleSource(inputSource);
+    freeSampleSource(sidechainSource);
     freeSampleSource(outputSource);
+    freeSampleSource(finalOutputSource);
+    freeRenderCacheKey(renderCacheKey);
+    freeCharString(renderCacheOutput);
     freePluginChain(pluginChain);
     freeProgramOptions(programOptions);
     freeTaskTimer(initTimer);
     freeTaskTimer(totalTimer);
     freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
     freeMidiSequence(midiSequence);
     freeAudioSettings();
     freeEventLogger();
@@ -891,6 +6709,87 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     return result;
   }
 
+  _startupProfileMark("Output source");
+
+  // Each segment is shorter than the input, so it would be a waste to
+  // preallocate the whole input length for it
+  if (finalOutputSource == NULL) {
+    _preallocateOutputSource(outputSource, pluginChain, inputLengthInFrames,
+                             maxTimeInMs, flushTail);
+  }
+
+  // Checkpoints flush the output on the processing thread, and segments and
+  // input lists already keep every processor busy
+  if (!programOptions->options[OPTION_WRITE_BEHIND]->enabled &&
+      finalOutputSource == NULL && inputList == NULL &&
+      checkpointIntervalInMs == 0 && !resume &&
+      _shouldConvertBehind(outputSource, pluginChain)) {
+    logDebug("Converting output in a background thread");
+    writeBehindBlocks = kMrsWatsonConvertBehindBlocks;
+    convertBehind = true;
+  }
+
+  outputSource = _writeBehindOutputSource(outputSource, writeBehindBlocks,
+                                          ioBlocksize, convertBehind);
+
+  // The analyzer goes in front of any writer thread, so that the output is
+  // analyzed on the processing thread, and the writer can still tell whether
+  // the output is a pipe
+  if (programOptions->options[OPTION_ANALYZE_OUTPUT]->enabled) {
+    analysis = newAudioAnalysis(getNumChannels());
+    meter = newLoudnessMeter(getNumChannels(), getSampleRate());
+    analyzedSource = newSampleSourceAnalyzer(outputSource, analysis, meter);
+
+    if (analyzedSource != NULL) {
+      outputSource = analyzedSource;
+      analysisReportPath = newCharString();
+      charStringCopy(analysisReportPath,
+                     programOptionsGetString(programOptions,
+                                             OPTION_ANALYZE_OUTPUT));
+    } else {
+      logWarn("Output source '%s' cannot be analyzed",
+              outputSource->sourceName->data);
+      freeAudioAnalysis(analysis);
+      freeLoudnessMeter(meter);
+      analysis = NULL;
+      meter = NULL;
+    }
+  }
+
+  // Like the analyzer, the hasher runs on the processing thread. The first
+  // segment starts at the beginning of the output, and the other segments are
+  // hashed by the input list workers.
+  if (programOptions->options[OPTION_OUTPUT_HASHES]->enabled ||
+      programOptions->options[OPTION_COMPARE_HASHES]->enabled) {
+    outputHashes = newOutputHashes(getBlocksize(), getNumChannels());
+    hashedSource = newSampleSourceHasher(outputSource, outputHashes, 0);
+
+    if (hashedSource != NULL) {
+      outputSource = hashedSource;
+    } else {
+      logWarn("Output source '%s' cannot be hashed",
+              outputSource->sourceName->data);
+      freeOutputHashes(outputHashes);
+      outputHashes = NULL;
+    }
+
+    if (outputHashes != NULL &&
+        programOptions->options[OPTION_OUTPUT_HASHES]->enabled) {
+      outputHashesPath = newCharString();
+      charStringCopy(outputHashesPath,
+                     programOptionsGetString(programOptions,
+                                             OPTION_OUTPUT_HASHES));
+    }
+
+    if (outputHashes != NULL &&
+        programOptions->options[OPTION_COMPARE_HASHES]->enabled) {
+      compareHashesPath = newCharString();
+      charStringCopy(compareHashesPath,
+                     programOptionsGetString(programOptions,
+                                             OPTION_COMPARE_HASHES));
+    }
+  }
+
   // Verify input/output sources. This must be done after the plugin chain is
   // initialized
   // otherwise the head plugin type is not known, which influences whether we
@@ -901,12 +6800,19 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
         charStringIsEqualToCString(outputSource->sourceName, "-", false)) {
       printf("ERROR: Using stdin/stdout is incompatible with --error-report\n");
       freeSampleSource(inputSource);
+      freeSampleSource(sidechainSource);
       freeSampleSource(outputSource);
+      freeSampleSource(finalOutputSource);
+      _freeStemOutputs(stemOutputs);
+      freeRenderCacheKey(renderCacheKey);
+      freeCharString(renderCacheOutput);
       freePluginChain(pluginChain);
       freeProgramOptions(programOptions);
       freeTaskTimer(initTimer);
       freeTaskTimer(totalTimer);
       freeMidiSource(midiSource);
+      freeLinkedListAndItems(inputList, _freeInputListJob);
+      free(inputListJobs);
       freeMidiSequence(midiSequence);
       freeAudioSettings();
       freeEventLogger();
@@ -919,12 +6825,19 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
       printf("ERROR: MIDI source from stdin is incompatible with "
              "--error-report\n");
       freeSampleSource(inputSource);
+      freeSampleSource(sidechainSource);
       freeSampleSource(outputSource);
+      freeSampleSource(finalOutputSource);
+      _freeStemOutputs(stemOutputs);
+      freeRenderCacheKey(renderCacheKey);
+      freeCharString(renderCacheOutput);
       freePluginChain(pluginChain);
       freeProgramOptions(programOptions);
       freeTaskTimer(initTimer);
       freeTaskTimer(totalTimer);
       freeMidiSource(midiSource);
+      freeLinkedListAndItems(inputList, _freeInputListJob);
+      free(inputListJobs);
       freeMidiSequence(midiSequence);
       freeAudioSettings();
       freeEventLogger();
@@ -936,12 +6849,19 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
   if (outputSource == NULL) {
     logInternalError("Default output sample source was null");
     freeSampleSource(inputSource);
+    freeSampleSource(sidechainSource);
     freeSampleSource(outputSource);
+    freeSampleSource(finalOutputSource);
+    _freeStemOutputs(stemOutputs);
+    freeRenderCacheKey(renderCacheKey);
+    freeCharString(renderCacheOutput);
     freePluginChain(pluginChain);
     freeProgramOptions(programOptions);
     freeTaskTimer(initTimer);
     freeTaskTimer(totalTimer);
     freeMidiSource(midiSource);
+    freeLinkedListAndItems(inputList, _freeInputListJob);
+    free(inputListJobs);
     freeMidiSequence(midiSequence);
     freeAudioSettings();
     freeEventLogger();
@@ -974,12 +6894,19 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
           logError("No valid input source or maximum time, don't know when to "
                    "stop processing");
           freeSampleSource(inputSource);
+          freeSampleSource(sidechainSource);
           freeSampleSource(outputSource);
+          freeSampleSource(finalOutputSource);
+          _freeStemOutputs(stemOutputs);
+          freeRenderCacheKey(renderCacheKey);
+          freeCharString(renderCacheOutput);
           freePluginChain(pluginChain);
           freeProgramOptions(programOptions);
           freeTaskTimer(initTimer);
           freeTaskTimer(totalTimer);
           freeMidiSource(midiSource);
+          freeLinkedListAndItems(inputList, _freeInputListJob);
+          free(inputListJobs);
           freeMidiSequence(midiSequence);
           freeAudioSettings();
           freeEventLogger();
@@ -995,12 +6922,19 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
       logError("Plugin chain contains only effects, but no input source was "
                "supplied");
       freeSampleSource(inputSource);
+      freeSampleSource(sidechainSource);
       freeSampleSource(outputSource);
+      freeSampleSource(finalOutputSource);
+      _freeStemOutputs(stemOutputs);
+      freeRenderCacheKey(renderCacheKey);
+      freeCharString(renderCacheOutput);
       freePluginChain(pluginChain);
       freeProgramOptions(programOptions);
       freeTaskTimer(initTimer);
       freeTaskTimer(totalTimer);
       freeMidiSource(midiSource);
+      freeLinkedListAndItems(inputList, _freeInputListJob);
+      free(inputListJobs);
       freeMidiSequence(midiSequence);
       freeAudioSettings();
       freeEventLogger();
@@ -1009,19 +6943,98 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     }
   }
 
+  if (autoBlocksize > 0) {
+    _autoTuneBlocksize(pluginChain, autoBlocksize);
+  }
+
   inputSampleBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
   inputTimer = newTaskTimerWithCString(PROGRAM_NAME, "Input Source");
   outputSampleBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
   outputTimer = newTaskTimerWithCString(PROGRAM_NAME, "Output Source");
 
-  // Initialization is finished, we should be able to free this memory now
-  freeProgramOptions(programOptions);
+  if (programOptions->options[OPTION_LATENCY_REPORT]->enabled) {
+    latencyReportPath = newCharString();
+    charStringCopy(latencyReportPath,
+                   programOptionsGetString(programOptions,
+                                           OPTION_LATENCY_REPORT));
+  }
+
+  if (programOptions->options[OPTION_PERF_REPORT]->enabled) {
+    perfReportPath = newCharString();
+    charStringCopy(perfReportPath,
+                   programOptionsGetString(programOptions, OPTION_PERF_REPORT));
+  }
 
   // If a maximum time was given, figure it out here
   if (maxTimeInMs > 0) {
     maxTimeInFrames = (unsigned long)(maxTimeInMs * getSampleRate()) / 1000l;
   }
 
+  // A MIDI sequence keeps playing after the end of the silent input, so the end
+  // of the range stops it in the same way
+  if (midiSequence != NULL && rangeNumFrames > 0) {
+    maxTimeInFrames = rangePrerollFrames + rangeNumFrames;
+  }
+
+  if (checkpoint != NULL && checkpointIntervalInMs > 0) {
+    checkpointFilename = renderCheckpointGetFilename(outputSource->sourceName);
+    checkpointWriter.checkpoint = checkpoint;
+    checkpointWriter.filename = checkpointFilename;
+    checkpointWriter.intervalInFrames =
+        (unsigned long)(checkpointIntervalInMs * getSampleRate() / 1000.0);
+    checkpointWriter.startFrame = rangeStartFrame;
+    checkpointWriter.firstOutputFrame = resume ? checkpoint->outputFrame : 0;
+    checkpointWriter.nextCheckpointFrames = checkpointWriter.intervalInFrames;
+  }
+
+  // The first job of an input list is processed below, and all other jobs are
+  // shared between this thread and any additional worker threads
+  inputListWorkers.jobs = inputListJobs;
+  inputListWorkers.numJobs = (unsigned int)numInputListJobs;
+  inputListWorkers.nextJob = 1;
+  inputListWorkers.mapInput = mapInput;
+  inputListWorkers.prefetchBlocks = prefetchBlocks;
+  inputListWorkers.writeBehindBlocks = writeBehindBlocks;
+  inputListWorkers.warmupBlocks = warmupBlocks;
+  inputListWorkers.ioBlocksize = ioBlocksize;
+  inputListWorkers.flacLevel = flacLevel;
+  inputListWorkers.flacThreads = flacThreads;
+  inputListWorkers.resampleRate = resampleRate;
+  inputListWorkers.resampleQuality = resampleQuality;
+  inputListWorkers.maxTimeInFrames = maxTimeInFrames;
+  inputListWorkers.pluginChainString = newCharString();
+  charStringCopy(inputListWorkers.pluginChainString,
+                 programOptionsGetString(programOptions, OPTION_PLUGIN));
+  inputListWorkers.pluginSearchRoot = newCharString();
+
+  if (programOptions->options[OPTION_PLUGIN_ROOT]->enabled) {
+    charStringCopy(inputListWorkers.pluginSearchRoot,
+                   programOptionsGetString(programOptions, OPTION_PLUGIN_ROOT));
+  }
+
+  inputListWorkers.parameters =
+      programOptionsGetList(programOptions, OPTION_PARAMETER);
+  inputListWorkers.pipelined = pipelined;
+  inputListWorkers.skipSilence = skipSilence;
+  inputListWorkers.flushDenormals = flushDenormals;
+  inputListWorkers.channelInstances = channelInstances;
+  inputListWorkers.parallelLoading = parallelLoading;
+  inputListWorkers.automation = automation;
+  inputListWorkers.serialLoadPlugins =
+      programOptionsGetList(programOptions, OPTION_SERIAL_LOAD);
+  inputListWorkers.midiRoutes =
+      programOptionsGetList(programOptions, OPTION_MIDI_ROUTE);
+  inputListWorkers.isolatedHost = isolatedHost;
+  inputListWorkers.watchdogBudgetInMs = watchdogBudgetInMs;
+  inputListWorkers.errorReporter = errorReporter;
+  inputListWorkers.flushTail = flushTail;
+  inputListWorkers.stopOnSilenceInMs = stopOnSilenceInMs;
+  inputListWorkers.sharedOutputSource = sharedOutputSource;
+  inputListWorkers.outputHashes = outputHashes;
+  inputListWorkers.mutex = newMutex();
+  inputListWorkers.framesProcessed = 0;
+  inputListWorkers.failed = false;
+
   processingDelayInFrames = pluginChainGetProcessingDelay(pluginChain);
   pluginChainPrepareForProcessing(pluginChain);
 
@@ -1030,94 +7043,190 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
   logInfo("Starting processing input source");
   logDebug("Sample rate: %.0f", getSampleRate());
   logDebug("Blocksize: %d", getBlocksize());
+  logDebug("I/O blocksize: %d", _getIoBlocksize(ioBlocksize));
   logDebug("Channels: %d", getNumChannels());
   logDebug("Tempo: %.2f", getTempo());
   logDebug("Processing delay frames: %lu", processingDelayInFrames);
   logDebug("Time signature: %d/%d", getTimeSignatureBeatsPerMeasure(),
            getTimeSignatureNoteValue());
+
+  if (lockMemory) {
+    memoryLockAll();
+
+    // Touch the chain's memory at least once after it has been locked
+    if (warmupBlocks == 0) {
+      warmupBlocks = 1;
+    }
+  }
+
+  if (warmupBlocks > 0) {
+    _warmUpPluginChain(pluginChain, inputSampleBuffer, outputSampleBuffer,
+                       warmupBlocks);
+  }
+
   taskTimerStop(initTimer);
+  _startupProfileMark("Preparing");
+  _printStartupProfile(programOptions);
+
+  if (numJobThreads > 1 && numInputListJobs > 1) {
+    if (numJobThreads > (unsigned int)numInputListJobs) {
+      numJobThreads = (unsigned int)numInputListJobs;
+    }
+
+    logInfo("Processing input list on %d threads", numJobThreads);
+    inputListWorkerThreads =
+        _startInputListWorkers(&inputListWorkers, numJobThreads - 1);
+  }
 
-  silentSampleOutput = sampleSourceFactory(NULL);
+  if (programOptions->options[OPTION_DISPATCH]->enabled &&
+      numInputListJobs > 1) {
+    jobDispatchers = _startJobDispatchers(
+        &inputListWorkers,
+        programOptionsGetList(programOptions, OPTION_DISPATCH));
+  }
 
   // Main processing loop
-  while (!finishedReading) {
-    taskTimerStart(inputTimer);
-    finishedReading = (boolByte)!readInput(inputSource, inputSampleBuffer);
+  profilePath = _startSamplingProfiler(programOptions);
+  _startLiveMetrics(programOptions);
+  _startControlServer(programOptions, pluginChain);
 
-    // TODO: For streaming MIDI, we would need to read in events from source
-    // here
-    if (midiSequence != NULL) {
-      LinkedList midiEventsForBlock = newLinkedList();
-      // MIDI source overrides the value set to finishedReading by the input
-      // source
-      finishedReading = (boolByte)!fillMidiEventsFromRange(
-          midiSequence, audioClock->currentFrame, getBlocksize(),
-          midiEventsForBlock);
-      linkedListForeach(midiEventsForBlock, _processMidiMetaEvent,
-                        &finishedReading);
-      pluginChainProcessMidi(pluginChain, midiEventsForBlock);
-      freeLinkedList(midiEventsForBlock);
-    }
+  if (editorWhileProcessing) {
+    _startEditorThread(&editor, pluginChain);
+  }
 
-    taskTimerStop(inputTimer);
+  watchdog =
+      _startPluginWatchdog(pluginChain, watchdogBudgetInMs, errorReporter);
+  realtimeAuditSetEnabled(realtimeAudit);
+  framesProcessed += _processJob(
+      pluginChain, inputSource, outputSource, midiSequence, maxTimeInFrames,
+      processingDelayInFrames,
+      inputListJobs != NULL ? inputListJobs[0]->prerollFrames
+                            : rangePrerollFrames,
+      flushTail && (inputListJobs != NULL ? inputListJobs[0]->numFrames == 0
+                                          : rangeNumFrames == 0),
+      (inputListJobs != NULL ? inputListJobs[0]->numFrames == 0
+                             : rangeNumFrames == 0)
+          ? stopOnSilenceInMs
+          : 0.0,
+      ioBlocksize, inputSampleBuffer, outputSampleBuffer, inputTimer,
+      outputTimer, checkpointFilename != NULL ? &checkpointWriter : NULL,
+      sidechainSource, stemOutputs);
 
-    if (maxTimeInFrames > 0 && audioClock->currentFrame >= maxTimeInFrames) {
-      logInfo("Maximum time reached, stopping processing after this block");
-      finishedReading = true;
-    }
+  if (midiSequence != NULL) {
+    logInfo("Read %ld MIDI events from %s",
+            midiSequence->numMidiEventsProcessed, midiSource->sourceName->data);
+  }
 
-    pluginChainProcessAudio(pluginChain, inputSampleBuffer, outputSampleBuffer);
+  // Any remaining jobs from the input list reuse the initialized plugin chain
+  _processInputListJobs(&inputListWorkers, pluginChain,
+                        processingDelayInFrames, inputSampleBuffer,
+                        outputSampleBuffer, inputTimer, outputTimer);
+  _stopEditorThread(&editor, pluginChain);
+  controlServerStop();
+  freePluginWatchdog(watchdog);
+  freeLinkedListAndItems(inputListWorkerThreads, _joinInputListWorker);
+  freeLinkedListAndItems(jobDispatchers, _joinJobDispatcher);
+  framesProcessed += inputListWorkers.framesProcessed;
+  result = inputListWorkers.failed ? RETURN_CODE_IO_ERROR : RETURN_CODE_SUCCESS;
+
+  if (result == RETURN_CODE_SUCCESS &&
+      pluginChainHasCrashedPlugins(pluginChain)) {
+    logError("An isolated plugin crashed, its output was silent from then on");
+    result = RETURN_CODE_PLUGIN_ERROR;
+  }
 
-    taskTimerStart(outputTimer);
+  if (sharedOutputSource != NULL) {
+    if (result != RETURN_CODE_SUCCESS) {
+      logError("Not all segments could be rendered, output was removed");
+    }
 
-    if (finishedReading) {
-      outputSampleBuffer->blocksize =
-          inputSampleBuffer
-              ->blocksize; // The input buffer size has been adjusted.
-      logDebug("Using buffer size of %d for final block",
-               outputSampleBuffer->blocksize);
+    result = _finishSharedSegmentOutput(sharedOutputSource,
+                                        result != RETURN_CODE_SUCCESS);
+  } else if (finalOutputSource != NULL) {
+    if (result != RETURN_CODE_SUCCESS) {
+      logError("Not all segments could be rendered, output was not written");
+      _joinSegmentFiles(finalOutputSource, inputListJobs,
+                        (unsigned int)numInputListJobs, flacLevel, flacThreads,
+                        true);
+    } else {
+      result = _joinSegmentFiles(finalOutputSource, inputListJobs,
+                                 (unsigned int)numInputListJobs, flacLevel,
+                                 flacThreads, false);
     }
+  }
 
-    writeOutput(outputSource, silentSampleOutput, outputSampleBuffer,
-                processingDelayInFrames);
-    taskTimerStop(outputTimer);
-    advanceAudioClock(audioClock, outputSampleBuffer->blocksize);
+  // A finished render has nothing left to resume
+  if (checkpoint != NULL && result == RETURN_CODE_SUCCESS) {
+    _removeCheckpoint(outputSource->sourceName);
   }
 
-  // Close file handles for input/output sources
-  silentSampleOutput->closeSampleSource(silentSampleOutput);
-  inputSource->closeSampleSource(inputSource);
-  outputSource->closeSampleSource(outputSource);
+  if (outputHashes != NULL && result == RETURN_CODE_SUCCESS) {
+    result = _finishOutputHashes(outputHashes, outputHashesPath,
+                                 compareHashesPath);
+  }
+
+  freeOutputHashes(outputHashes);
+  freeCharString(outputHashesPath);
+  freeCharString(compareHashesPath);
+
+  result = _finishRealtimeAudit(realtimeAudit, result);
+  _finishSamplingProfiler(profilePath);
+  liveMetricsStopServer();
+  _finishTraceEvents(programOptions);
+
+  // Slow jobs are reported as well as failed ones, so this is always written
+  if (errorReporter->started) {
+    errorReporterWritePerformanceSnapshot(
+        errorReporter, pluginChain,
+        result == RETURN_CODE_SUCCESS ? "finished" : "failed");
+  }
+
+  freeMutex(inputListWorkers.mutex);
+  freeCharString(inputListWorkers.pluginChainString);
+  freeCharString(inputListWorkers.pluginSearchRoot);
+  // Worker threads read the parameter list from the options, so they can only
+  // be freed once all threads have finished
+  freeProgramOptions(programOptions);
 
   // Print out statistics about each plugin's time usage
-  // TODO: On windows, the total processing time is stored in clocks and not
-  // milliseconds
-  // These values must be converted using the QueryPerformanceFrequency()
-  // function
-  audioClockStop(audioClock);
   taskTimerStop(totalTimer);
+  taskTimerList = newLinkedList();
+  linkedListAppend(taskTimerList, initTimer);
+  linkedListAppend(taskTimerList, inputTimer);
+  linkedListAppend(taskTimerList, outputTimer);
+
+  for (i = 0; i < pluginChain->numPlugins; i++) {
+    linkedListAppend(taskTimerList, pluginChain->audioTimers[i]);
+    linkedListAppend(taskTimerList, pluginChain->midiTimers[i]);
+  }
 
   if (totalTimer->totalTaskTime > 0) {
-    taskTimerList = newLinkedList();
-    linkedListAppend(taskTimerList, initTimer);
-    linkedListAppend(taskTimerList, inputTimer);
-    linkedListAppend(taskTimerList, outputTimer);
-
-    for (i = 0; i < pluginChain->numPlugins; i++) {
-      linkedListAppend(taskTimerList, pluginChain->audioTimers[i]);
-      linkedListAppend(taskTimerList, pluginChain->midiTimers[i]);
-    }
-
     totalTimeString = taskTimerHumanReadbleString(totalTimer);
     logInfo("Total processing time %s, approximate breakdown:",
             totalTimeString->data);
     linkedListForeach(taskTimerList, _printTaskTime, totalTimer);
+    _printLatencyReport(pluginChain);
+    _printPluginCpuReport(pluginChain, framesProcessed);
   } else {
     // Woo-hoo!
     logInfo("Total processing time <1ms. Either something went wrong, or your "
             "computer is smokin' fast!");
   }
 
+  if (memoryUsageInstance != NULL && memoryUsageInstance->budget > 0 &&
+      (size_t)platformInfoGetPeakMemoryUsage() * 1024 >
+          memoryUsageInstance->budget) {
+    logWarn("Peak memory usage of %luMB exceeded the memory budget of %luMB",
+            platformInfoGetPeakMemoryUsage() / 1024,
+            (unsigned long)(memoryUsageInstance->budget / 1024 / 1024));
+  }
+
+  if (perfReportPath != NULL) {
+    _writePerfReport(perfReportPath, pluginChain, taskTimerList, initTimer,
+                     totalTimer, framesProcessed, processingDelayInFrames);
+    freeCharString(perfReportPath);
+  }
+
   freeTaskTimer(initTimer);
   freeTaskTimer(inputTimer);
   freeTaskTimer(outputTimer);
@@ -1125,31 +7234,49 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
   freeLinkedList(taskTimerList);
   freeCharString(totalTimeString);
 
-  if (midiSequence != NULL) {
-    logInfo("Read %ld MIDI events from %s",
-            midiSequence->numMidiEventsProcessed, midiSource->sourceName->data);
-  } else {
-    logInfo("Read %ld frames from %s",
-            inputSource->numSamplesProcessed / getNumChannels(),
-            inputSource->sourceName->data);
+  if (latencyReportPath != NULL) {
+    _writeLatencyReport(pluginChain, latencyReportPath);
+    freeCharString(latencyReportPath);
   }
 
-  logInfo("Wrote %ld frames to %s",
-          outputSource->numSamplesProcessed / getNumChannels(),
-          outputSource->sourceName->data);
+  if (analysisReportPath != NULL) {
+    _writeAnalysisReport(analysis, meter, analysisReportPath);
+    freeCharString(analysisReportPath);
+  }
 
   // Shut down and free data (will also close open files, plugins, etc)
   logInfo("Shutting down");
   freeSampleSource(inputSource);
+  freeSampleSource(sidechainSource);
   freeSampleSource(outputSource);
-  freeSampleSource(silentSampleOutput);
+  freeSampleSource(finalOutputSource);
+  _freeStemOutputs(stemOutputs);
+
+  if (renderCacheKey != NULL && result == RETURN_CODE_SUCCESS) {
+    renderCacheStore(renderCacheKey, renderCacheOutput);
+  }
+
+  freeRenderCacheKey(renderCacheKey);
+  freeCharString(renderCacheOutput);
+  freeAudioAnalysis(analysis);
+  freeLoudnessMeter(meter);
   freeSampleBuffer(inputSampleBuffer);
   freeSampleBuffer(outputSampleBuffer);
   pluginChainShutdown(pluginChain);
   freePluginChain(pluginChain);
+  pluginIdlerStop();
   freeMidiSource(midiSource);
+  freeLinkedListAndItems(inputList, _freeInputListJob);
+  free(inputListJobs);
   freeMidiSequence(midiSequence);
-
+  freePluginAutomation(automation);
+  freeRenderCheckpoint(checkpoint);
+  freeCharString(checkpointFilename);
+
+  freePluginPresetCache();
+  freeSampleSourceCache();
+  freeRenderCache();
+  freeMemoryUsage();
   freeAudioSettings();
   logInfo("Goodbye!");
   freeEventLogger();
@@ -1159,5 +7286,5 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     errorReporterClose(errorReporter);
   }
 
-  return RETURN_CODE_SUCCESS;
+  return result;
 }
@@ -28,12 +28,57 @@
 
 #include "audio/AudioSettings.h"
 #include "base/File.h"
+#include "plugin/PluginIdler.h"
 
 #include <stdio.h>
 
 ProgramOptions newMrsWatsonOptions(void) {
   ProgramOptions options = newProgramOptions(NUM_OPTIONS);
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_ANALYZE_OUTPUT, "analyze-output",
+          "Analyze the output as it is written, and write the results as JSON to \
+the given file when processing finishes. For each channel, this includes the \
+peak level, clipped samples, jumps between samples which are large enough to \
+be heard as clicks, and the longest run of digital silence, along with the \
+frames where they occur, and the true peak in dBTP. The integrated loudness \
+and loudness range of the whole output are measured as in EBU R128. This \
+cannot be combined with --segments, --input-list, --checkpoint, or --resume.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+  programOptionsSetCString(options, OPTION_ANALYZE_OUTPUT, "analysis.json");
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_AUTO_BLOCKSIZE, "auto-blocksize",
+          "Before processing, time the plugin chain with noise at the given \
+blocksize and at each half of it down to 64 frames, and process at whichever \
+blocksize was fastest. Input and output are still read and written in blocks \
+of the given size, or of --io-blocksize if that is larger. This overrides \
+--blocksize, and is ignored with --realtime and in server or manifest mode.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetNumber(options, OPTION_AUTO_BLOCKSIZE, 4096.0f);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_AUTOMATION, "automation",
+          "Change parameters of the first plugin in the chain while processing, \
+as read from the given file. Each line of the file contains the time in seconds, \
+the parameter index, and the new value, separated by commas. Changes take effect \
+on the exact frame, by processing the plugin in several parts of a block, so a \
+large blocksize may still be used. With --pipeline, or when the chain starts with \
+a split, changes are applied at the start of each block instead. The automation \
+starts over for each job of an input list. For example:\n\n\
+\t0.0,1,0.3\n\
+\t2.5,1,0.75",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -55,6 +100,21 @@ multiple of the blocksize, then empty frames will be added to the last block.",
   programOptionsSetNumber(options, OPTION_BLOCKSIZE,
                           (const float)getBlocksize());
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_CHANNEL_INSTANCES, "channel-instances",
+          "When the input has more channels than an effect plugin supports, run \
+several instances of the plugin side by side, each of which processes its own \
+group of channels on a separate thread. For example, a 5.1 input is processed \
+by 3 instances of a stereo plugin. Presets and parameters are applied to all \
+instances. Without this option, the channels which the plugin does not support \
+are lost, and its output channels are repeated to fill the others. Plugins \
+whose multi-instance capability is 'no' in the plugin index (see \
+--plugin-capability) are always run as a single instance.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -66,6 +126,18 @@ count, then that value will override the one set by this option.",
   programOptionsSetNumber(options, OPTION_CHANNELS,
                           (const float)getNumChannels());
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_CHECKPOINT, "checkpoint",
+          "Save the progress of the render every <argument> milliseconds of output, \
+so that it can be continued with --resume if it is interrupted. The checkpoint \
+is written next to the output source with the extension '.checkpoint', and is \
+removed once the render has finished. Only supported when writing a PCM or WAVE \
+file.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -84,6 +156,18 @@ used automatically unless 'none' is given to this option.",
                                  kProgramOptionArgumentTypeNone));
   options->options[OPTION_COLOR_TEST]->hideInHelp = true;
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_COMPARE_HASHES, "compare-hashes",
+          "Hash the output as it is written, like --output-hashes, and compare it \
+with the hashes of an earlier render from the given file. If the outputs differ, \
+the first different block is reported and the program exits with an error. \
+This checks that pipelined, segmented or multi-instance renders match a serial \
+render without reading either output back.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -98,6 +182,85 @@ like so:\n\n\
           NO_SHORT_FORM, kProgramOptionTypeEmpty,
           kProgramOptionArgumentTypeRequired));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_CONTROL, "control",
+          "Accept parameter and preset changes while processing, for example \
+in a realtime session, without reloading the plugin chain. Clients connect to \
+the argument, which is a port on the loopback interface or the path of a UNIX \
+domain socket, and send one command per line:\n\n\
+\tparameter <plugin> <index> <value>\n\
+\tpreset <plugin> <preset name>\n\
+\tstatus\n\n\
+Plugins are given by their position in the chain, starting with 0. Changes are \
+applied between two blocks, and presets are read by a background thread so \
+that processing never waits for them. Only the main plugin chain is changed, \
+not those of --serve, --manifest, --fan-out or the worker threads of --jobs. \
+Default value: 9465.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetCString(options, OPTION_CONTROL, "9465");
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_CPU_AFFINITY, "cpu-affinity",
+          "Pin the processing thread to the processors in <argument>, which is a \
+list of processor numbers and ranges such as '0-3,8'. On Linux, the threads \
+started for --pipeline, --jobs, and the other parallel options inherit this \
+setting, and the buffers which they allocate are placed in memory close to \
+these processors. When running several jobs on one machine, giving each one \
+its own processors avoids threads moving between sockets. Not supported on \
+Mac OS X.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_DECODE_CACHE, "decode-cache",
+          "Keep the decoded audio of FLAC, MP3, and OGG inputs in the \
+directory <argument>, which is created if needed. Later runs and jobs reading \
+the same file skip decoding it and read the cached samples instead, which is \
+useful when one input is rendered many times with --input-list, --serve, or \
+--fan-out. Entries are only used while the input file keeps its size and \
+modification time, and are never removed, so the directory must be cleaned \
+up by hand. Raw PCM, AIFF, and WAVE inputs are never cached, unless AIFF \
+files are read with audiofile.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_DEGRADE, "degrade",
+          "With --realtime, degrade a plugin when the chain misses the \
+deadline of a block instead of letting the output drop out. <argument> is \
+either 'name,bypass' to pass the plugin's input through with its latency, \
+'name,skip' to pass the input through without a delay, for analysis plugins \
+which do not change the audio, or 'name,parameter,index,degraded,normal' to \
+set a cheaper parameter value. This can be given several times, and each \
+missed deadline degrades the next plugin in the order given. Plugins are \
+restored in reverse order once the chain has kept enough headroom to run \
+them for a few seconds.",
+          NO_SHORT_FORM, kProgramOptionTypeList,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_DISPATCH, "dispatch",
+          "Send jobs from --input-list or --segments to a server started with \
+--serve at <argument>, which uses the same address format as --serve. This can \
+be given several times to spread the jobs over several servers, which claim \
+them from the same list as the local --jobs threads. Since servers only listen \
+on the loopback interface or on UNIX sockets, servers on other machines must be \
+reached through a tunnel, for example with 'ssh -L'. The servers must be able to \
+read the input and write the output at the same paths.",
+          NO_SHORT_FORM, kProgramOptionTypeList,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(options,
                     newProgramOptionWithName(
                         OPTION_DISPLAY_INFO, "display-info",
@@ -105,6 +268,19 @@ like so:\n\n\
                         NO_SHORT_FORM, kProgramOptionTypeEmpty,
                         kProgramOptionArgumentTypeNone));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_DITHER, "dither",
+          "Dither to add when writing 16 or 24-bit integer output. Recognized values \
+are \"none\", \"tpdf\" (triangular noise of one LSB), and \"shaped\" (TPDF dither \
+with noise shaping, which moves most of the noise to high frequencies). The \
+dither is added while the samples are converted, so it is faster than adding a \
+dither plugin to the end of the chain.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+  programOptionsSetCString(options, OPTION_DITHER, "none");
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -119,18 +295,86 @@ are \"big\" or \"little\".",
       options,
       newProgramOptionWithName(
           OPTION_EDITOR, "editor",
-          "EXPERIMENTAL: Show plugin editor. When the editor window is closed, \
-MrsWatson will exit. Changes made in the editor are not sent to the plugin. This feature is mostly \
+          "EXPERIMENTAL: Show the editor of the first plugin in the chain. \
+Without an input or MIDI source, MrsWatson exits when the editor window is \
+closed. Otherwise the editor runs on its own thread while audio is processed, \
+changes made in it are also applied to any other instances of the plugin, and \
+the window is closed once processing is done. Showing the editor while \
+processing is not supported on Mac OS X or Windows. This feature is mostly \
 intended for debugging plugin GUIs.",
           false, kProgramOptionTypeEmpty, kProgramOptionArgumentTypeNone));
   options->options[OPTION_EDITOR]->hideInHelp = true;
 
-  programOptionsAdd(options,
-                    newProgramOptionWithName(
-                        OPTION_ERROR_REPORT, "error-report",
-                        "Generate an error report zipfile on the desktop.",
-                        NO_SHORT_FORM, kProgramOptionTypeString,
-                        kProgramOptionArgumentTypeNone));
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_END, "end",
+          "Stop rendering the input source at <argument> milliseconds, so that \
+only the part of the input before this time is written. Unlike --max-time, the \
+output ends exactly at this time, unless --flush-tail is also given.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_ERROR_REPORT, "error-report",
+          "Generate an error report zipfile on the desktop. The report also has \
+a trace of the run, and a snapshot of the processing times of each plugin in \
+the last blocks, deadline misses, I/O queue depths, and memory usage, which is \
+also written when a plugin is stopped by --watchdog.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeNone));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_FAN_OUT, "fan-out",
+          "Render the input through several variants of a plugin chain at \
+once, which are listed in the file <argument> with one variant per line in the \
+same format as for --serve. Each variant needs an output and a plugin chain, \
+which may load a preset for each plugin, and may also set parameters. The \
+input is only read once, and each block of it is processed by all variants in \
+parallel, each on its own thread and with its own plugin instances. Variants \
+with plugins whose multi-instance capability is 'no' in the plugin index (see \
+--plugin-capability) take turns instead of processing at the same time. Empty \
+lines and lines starting with '#' are ignored. For example:\n\n\
+\toutput=soft.wav\tplugin=mrs_gain\tparameter=0,0.25\n\
+\toutput=loud.wav\tplugin=mrs_gain\tparameter=0,0.75",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_FLAC_LEVEL, "flac-level",
+          "Compression level to use when writing FLAC files, from 0 (fastest) to \
+8 (smallest files). Only available in builds with FLAC support.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+  programOptionsSetNumber(options, OPTION_FLAC_LEVEL, 5.0f);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_FLAC_THREADS, "flac-threads",
+          "Encode FLAC output on <argument> threads, which compress several FLAC \
+frames at once and then write them out in order. If no argument is given, then \
+one thread per processor is used. Requires a build with libFLAC 1.5 or newer.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetNumber(options, OPTION_FLAC_THREADS, 0.0f);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_FLUSH_TAIL, "flush-tail",
+          "Keep processing after the end of the input for the longest tail time \
+of any plugin in the chain, so that reverb and delay tails are not cut off. \
+Without this option, the latency of the plugin chain is compensated so that \
+the output has exactly the same length as the input.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
 
   programOptionsAdd(
       options,
@@ -150,16 +394,123 @@ Otherwise, extended help can be printed for an individual option given by \
           HAS_SHORT_FORM, kProgramOptionTypeString,
           kProgramOptionArgumentTypeOptional));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_IDLE_INTERVAL, "idle-interval",
+          "Time in milliseconds between two idle calls to each VST plugin \
+which asks for them. Such plugins are idled by a low priority background \
+thread, so that they can do deferred work like streaming samples from disk \
+outside of the processing thread.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+  programOptionsSetNumber(options, OPTION_IDLE_INTERVAL,
+                          PLUGIN_IDLER_DEFAULT_INTERVAL_IN_MS);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_INPUT_LIST, "input-list",
+          "Process many files in one run, loading and initializing the plugin chain \
+only once. The argument is a plain text file with one job per line, where each \
+line contains an input source and an output source separated by a tab \
+character. Empty lines and lines starting with '#' are ignored. Plugins are \
+reset between each job. This option overrides --input and --output, and cannot \
+be combined with --midi-file. For example:\n\n\
+\tdrums.wav\tdrums-processed.wav\n\
+\tbass.wav\tbass-processed.wav",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_INPUT_MMAP, "input-mmap",
+          "Map PCM and WAVE input files into memory, and convert samples directly \
+from the mapped file instead of reading each block into a temporary buffer. \
+This mostly helps with very large input files. Inputs which cannot be mapped, \
+such as stdin, are read normally.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
           OPTION_INPUT_SOURCE, "input",
           "Input source to use for processing, where the file type is determined from \
 the extension. Run with --list-file-types to see a list of supported types. Use \
-'-' to read from stdin.",
+'-' to read from stdin, or 'tcp://host:port' to receive a PCM stream from \
+another machine ('tcp://:port' waits for the sender to connect). When built \
+with PortAudio, use 'device' to record from the default audio input, or \
+'device:<host API>' (for example 'device:jack') to pick the host API.",
           HAS_SHORT_FORM, kProgramOptionTypeString,
           kProgramOptionArgumentTypeRequired));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_IO_BLOCKSIZE, "io-blocksize",
+          "Read and write audio in chunks of <argument> frames, while the plugins \
+still process blocks of --blocksize frames. MIDI events are scheduled in the \
+same blocks as without this option. Larger chunks reduce the overhead of \
+reading and writing audio when rendering offline. The size is rounded down to \
+a multiple of the blocksize.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetNumber(options, OPTION_IO_BLOCKSIZE, 65536.0f);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_ISOLATE, "isolate",
+          "Host each plugin in its own child process, so that a plugin which \
+crashes does not take down the whole render. Audio and MIDI are exchanged with \
+the child through shared memory. If a plugin crashes, an error is logged, its \
+output is silent for the rest of the render, and the program exits with an \
+error. If [argument] is given, it is the executable used to host the plugins, \
+for example the 32-bit build to load 32-bit plugins from the 64-bit build. \
+Plugin editors cannot be shown for isolated plugins. Currently only supported \
+on Linux and Mac OS X.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeOptional));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_JOBS, "jobs",
+          "Process the jobs from --input-list or --manifest, or the streams \
+from --streams, on <argument> threads at once. Each thread loads its own copy \
+of the plugin chain, so plugins which keep global state may not work with this \
+option. If no argument is given, then one thread per processor is used. \
+Latency and performance reports only include the jobs \
+which were processed on the main thread.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetNumber(options, OPTION_JOBS, 0.0f);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_KEEP_DENORMALS, "keep-denormals",
+          "Don't flush denormal numbers to zero while plugins process audio. By \
+default, the processor is told to treat these tiny numbers as zero, since many \
+plugins become many times slower when processing them, for example in reverb \
+tails and after the input has gone silent. Use this option if a plugin relies \
+on denormals for its output to be correct.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_LATENCY_REPORT, "latency-report",
+          "Write the block processing latency of the plugin chain and each plugin \
+as JSON to the given file when processing finishes. This includes percentiles, \
+the longest block and the number of blocks which took longer than real-time.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+  programOptionsSetCString(options, OPTION_LATENCY_REPORT, "latency.json");
+
   programOptionsAdd(options, newProgramOptionWithName(
                                  OPTION_LIST_PLUGINS, "list-plugins",
                                  "List available plugins. Useful for "
@@ -167,6 +518,18 @@ the extension. Run with --list-file-types to see a list of supported types. Use
                                  NO_SHORT_FORM, kProgramOptionTypeEmpty,
                                  kProgramOptionArgumentTypeNone));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_LOCK_MEMORY, "lock-memory",
+          "Lock all of the program's memory into RAM and run at least one block \
+of silence through the plugin chain before processing starts (see --warmup), \
+so that the first blocks are not slowed down by page faults. This is mostly \
+useful together with --realtime. Locking memory usually requires elevated \
+privileges, if it fails only a warning is logged.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
   programOptionsAdd(options, newProgramOptionWithName(
                                  OPTION_LOG_FILE, "log-file",
                                  "Save logging output to the given file "
@@ -185,6 +548,25 @@ errors are always logged to console regardless of this setting.",
           kProgramOptionArgumentTypeRequired));
   programOptionsSetCString(options, OPTION_LOG_LEVEL, "info");
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_MANIFEST, "manifest",
+          "Run all render jobs listed in the manifest file <argument>, with one job \
+per line in the same format as for --serve. Each line may also give the job a \
+name, the names of jobs which must finish before it starts with \
+\"after=<name>,<name>\", and a relative cost with \"cost=<number>\". A job \
+whose input is the output of another job always runs after it. Outputs named \
+\"mem://<name>\" are kept in memory instead of being written to a file, and \
+are released once all jobs reading them have finished. Jobs run on the \
+number of threads given by --jobs, more expensive jobs are started first, and \
+a job which depends on the job that a thread just finished runs next on the \
+same thread. Each thread keeps its plugin chains open between jobs, the same \
+as --serve. If a job fails, then the jobs which depend on it are skipped. \
+Empty lines and lines starting with '#' are ignored.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -194,24 +576,140 @@ input source length. Mostly useful when using internal plugins as sources.",
           NO_SHORT_FORM, kProgramOptionTypeNumber,
           kProgramOptionArgumentTypeRequired));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_MEMORY_BUDGET, "memory-budget",
+          "Keep the resident memory of the process below <argument> megabytes where \
+possible. Inputs which would exceed the budget are read block by block instead \
+of being mapped into memory with --input-mmap, and preset snapshots are no \
+longer added to the --preset-cache once the budget is used up. MIDI files are \
+always streamed. A warning is logged if the peak memory usage still exceeded \
+the budget.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_METRICS, "metrics",
+          "Serve live metrics in the Prometheus text format over HTTP while \
+processing, so that long-running servers and realtime sessions can be \
+monitored. The metrics include the number of blocks processed, deadline \
+misses, block time histograms for the chain and each plugin, the depth of the \
+--prefetch and --write-behind queues, and the resident memory. The argument is \
+a port on the loopback interface or the path of a UNIX domain socket. Default \
+value: 9464.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetCString(options, OPTION_METRICS, "9464");
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_MIDI_ROUTE, "midi-route",
+          "Send MIDI events to a plugin in the chain, in the format \
+'name[,channels]', where the channels are either a single channel or a range \
+such as '1-4'. By default only the first plugin receives MIDI, on all \
+channels. This can be given several times, for example to drive a gate or \
+vocoder later in the chain from its own channel. A plugin which is routed only \
+receives the channels of its routes. Routes to plugins after the first are \
+ignored with --pipeline.",
+          NO_SHORT_FORM, kProgramOptionTypeList,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(options, newProgramOptionWithName(
                                  OPTION_MIDI_SOURCE, "midi-file",
                                  "MIDI file to read events from. Required if "
-                                 "processing an instrument plugin.",
+                                 "processing an instrument plugin. Use '-' to "
+                                 "read from stdin.",
                                  HAS_SHORT_FORM, kProgramOptionTypeString,
                                  kProgramOptionArgumentTypeRequired));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_NOTE_CACHE, "note-cache",
+          "Render each unique note of the MIDI input (same channel, pitch, \
+velocity and length) through the instrument once on its own, and play the MIDI \
+by mixing these renders. Rendering many MIDI files through the same \
+instrument, for example drum parts, is then much faster. This only gives the \
+same output if the instrument is deterministic and its voices do not affect \
+each other, which is checked against playing the first note of the MIDI \
+directly, or known from the plugin index (see --plugin-capability). MIDI with \
+events other than notes, automation and realtime processing are played as \
+usual. The optional argument is the maximum memory \
+to use for renders, in megabytes.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetNumber(options, OPTION_NOTE_CACHE, 256.0f);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_NUMA_NODE, "numa-node",
+          "Pin the processing thread to the processors of NUMA node <argument>, \
+like --cpu-affinity does with the processor list of that node. This option is \
+ignored if --cpu-affinity is also given. Only supported on Linux and Windows.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_OFFLINE, "offline",
+          "Tell VST plugins that they render offline when they ask for the \
+current process level. Disk-streaming samplers then usually wait for their \
+samples instead of dropping voices, which makes renders deterministic. \
+Plugins whose offline capability is 'no' in the plugin index (see \
+--plugin-capability) are still told that they render in realtime. Cannot be \
+combined with --realtime, which tells plugins that they render in realtime \
+instead.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_OUTPUT_HASHES, "output-hashes",
+          "Hash each block of the output as it is written, and write the hashes \
+along with a hash of the whole output to the given file when processing \
+finishes. The blocks have the processing blocksize and are counted from the \
+start of the output, so renders with the same blocksize can be compared block \
+by block with --compare-hashes, whichever way they were processed. This cannot \
+be combined with --input-list, --dispatch, or --resume.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+  programOptionsSetCString(options, OPTION_OUTPUT_HASHES, "hashes.txt");
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
           OPTION_OUTPUT_SOURCE, "output",
           "Output source to write processed data to, where the file type is determined \
 from the extension. Run with --list-file-types to see a list of supported types. \
-Use '-' to write to stdout..",
+Use '-' to write to stdout, or 'tcp://host:port' to send a PCM stream to another \
+machine ('tcp://:port' waits for the receiver to connect). When built with \
+PortAudio, use 'device' or 'device:<host API>' to play through an audio output.",
           HAS_SHORT_FORM, kProgramOptionTypeString,
           kProgramOptionArgumentTypeOptional));
   programOptionsSetCString(options, OPTION_OUTPUT_SOURCE, "out.wav");
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PARALLEL_LOAD, "parallel-load",
+          "Open all VST plugins in the chain and load their presets at the same \
+time, each on its own thread, which can greatly reduce startup time for chains \
+of large plugins. The whole chain is checked before any plugin is loaded. Some \
+plugins do not support being loaded from a thread other than the main one, so \
+this is not enabled by default. Such plugins can also be excluded with \
+--serial-load. Plugins with a parallel-load capability in the plugin index \
+(see --plugin-capability) are loaded according to it, with or without this \
+option.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -224,6 +722,57 @@ index/value, for example:\n\n\
           NO_SHORT_FORM, kProgramOptionTypeList,
           kProgramOptionArgumentTypeRequired));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PCM_PLANAR, "pcm-planar",
+          "Read and write raw PCM data as planar 32-bit floats in the byte \
+order of the machine. Each block holds all samples of the first channel, then \
+all samples of the second channel, and so on. This matches the layout of \
+arrays which are indexed by channel first, and needs no conversion at all. The \
+other end must use the same blocksize, and --bit-depth must be 32.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PERF_COUNTERS, "perf-counters",
+          "Count the CPU cycles, instructions, last level cache misses and \
+branch misses of each plugin's audio processing with the hardware performance \
+counters, and show them in the plugin CPU usage and the --perf-report. This is \
+only supported on Linux, and the kernel must allow reading the counters (see \
+/proc/sys/kernel/perf_event_paranoid). Many virtual machines do not provide \
+these counters at all.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PERF_REPORT, "perf-report",
+          "Write a performance report as JSON to the given file when processing \
+finishes. This includes all timers shown in the processing time breakdown, the \
+number of frames processed, the realtime factor, the block processing latency, \
+and the peak memory usage, together with the peak memory of sample buffers, \
+MIDI sequences and preset chunks, and the resident size of each plugin's \
+libraries.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+  programOptionsSetCString(options, OPTION_PERF_REPORT, "perf.json");
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PIPELINE, "pipeline",
+          "Run each plugin in the chain on its own thread, so that consecutive \
+blocks are processed by different plugins at the same time. The output is \
+identical to serial processing, but the chain has one block of additional \
+latency per plugin (which is trimmed from the output), so this only pays off \
+for long chains of heavy effects.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -237,15 +786,60 @@ the --plugin-root directory, the current directory, and the standard locations \
 for the OS. File extensions are added automatically to plugin names. Each plugin \
 may be followed by a comma with a program to be loaded, which should be of the \
 corresponding file format for the respective plugin. For shell plugins (like \
-Waves), use --display-info to get a list of sub-plugin ID's and then use a colon \
-to indicate which plugin to load. Examples:\n\n\
+Waves), use --display-info to get a list of sub-plugins and then give the ID \
+or name of the one to load after a colon. With --plugin-index, the sub-plugins \
+of each shell are remembered, so that the shell is only asked for them once. \
+Part of a chain may be split into parallel \
+branches by giving them in brackets, separated by a '|'. Each branch processes \
+the same input, and their outputs are summed after the delay of each branch has \
+been compensated. A plugin may process its own blocksize, which is given \
+after its name with an '@'. Audio for such plugins is collected into blocks \
+of that size, which adds latency unless it divides --blocksize. Examples:\n\n\
 \t--plugin LFX-1310\n\
 \t--plugin 'AutoTune,KayneWest.fxp;Compressor,SoftKnee.fxp;Limiter'\n\
+\t--plugin 'EQ;[Compressor|Reverb;Delay];Limiter' (parallel branches)\n\
+\t--plugin 'EQ;Convolver@4096,Hall.fxp' (own blocksize)\n\
 \t--plugin 'WavesShell-VST' --display-info (list shell sub-plugins)\n\
-\t--plugin 'WavesShell-VST:IDFX' (load a shell plugins)",
+\t--plugin 'WavesShell-VST:IDFX' (load a shell sub-plugin)\n\
+\t--plugin 'WavesShell-VST:C1 comp Stereo' (load it by name)",
           HAS_SHORT_FORM, kProgramOptionTypeString,
           kProgramOptionArgumentTypeRequired));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PLUGIN_CAPABILITY, "plugin-capability",
+          "Set a capability of a plugin in the plugin index by hand, given as \
+'name,capability,state'. The capabilities are 'parallel-load', \
+'multi-instance', 'fork-safe', 'deterministic' and 'offline', and the state is \
+'yes', 'no', or 'auto' to use the one which was probed by --scan-plugins \
+again. The plugin must have been scanned, and the setting applies to all \
+copies of the plugin with the same ID. This can be given several times, and \
+MrsWatson exits after the index has been updated. Requires --plugin-index.",
+          NO_SHORT_FORM, kProgramOptionTypeList,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PLUGIN_HOST, "plugin-host",
+          "Host a single plugin for another process, which communicates with this \
+one through the shared memory named by <argument>. This is used internally by \
+--isolate.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PLUGIN_INDEX, "plugin-index",
+          "Use a persistent index file to find VST plugins, rather than \
+searching each plugin location on every run. The file is created if it does \
+not exist, and a location is only searched again once its directory has been \
+modified. The plugin index is also used for --list-plugins.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -255,6 +849,49 @@ to indicate which plugin to load. Examples:\n\n\
           NO_SHORT_FORM, kProgramOptionTypeString,
           kProgramOptionArgumentTypeRequired));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PREFETCH, "prefetch",
+          "Read the input source in a background thread, buffering up to <argument> \
+blocks ahead of the plugin chain. This overlaps file I/O with processing, which \
+mostly helps when reading from slow or network-mounted storage. When reading from \
+a pipe on stdin or a TCP stream, this is always done with 4 blocks unless another \
+value is given. MP3 and Ogg files are likewise decoded 8 blocks ahead when there \
+is more than one processor. Raw PCM and WAVE files are read ahead without a \
+thread through an I/O ring where the platform supports it, which is io_uring on \
+Linux and overlapped I/O on Windows.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetNumber(options, OPTION_PREFETCH, 4.0f);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PRESET_CACHE, "preset-cache",
+          "After an FXP/FXB preset is loaded into a plugin which stores its state \
+as chunk data, keep a copy of that state in memory. When the same preset is \
+loaded into the same plugin again, for example by the parallel jobs of \
+--input-list, the stored state is handed back to the plugin instead of loading \
+the preset again. The optional argument is the maximum memory to use for \
+stored state, in megabytes.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetNumber(options, OPTION_PRESET_CACHE, 256.0f);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PROFILE, "profile",
+          "Sample which plugin is running after every millisecond of CPU time, and \
+whether it is processing audio, MIDI, or calling the host. When processing \
+finishes, the samples are written to the given file as collapsed stacks, which \
+can be turned into a flame graph with flamegraph.pl. This works without any \
+debugging symbols for the plugins. Only supported on Mac OS X and Linux.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetCString(options, OPTION_PROFILE, "profile.txt");
+
   programOptionsAdd(
       options, newProgramOptionWithName(OPTION_QUIET, "quiet",
                                         "Only log critical errors.",
@@ -265,12 +902,77 @@ to indicate which plugin to load. Examples:\n\n\
       options,
       newProgramOptionWithName(
           OPTION_REALTIME, "realtime",
-          "Simulate running in realtime by sleeping for any remaining time needed to process \
-the given block. Some plugins which are unable to do offline rendering may require this \
+          "Simulate running in realtime by waiting until each block's deadline on the wall \
+clock, and raise the processing thread to realtime priority where the system allows it. \
+Some plugins which are unable to do offline rendering may require this \
 option in order to function properly.",
           NO_SHORT_FORM, kProgramOptionTypeEmpty,
           kProgramOptionArgumentTypeNone));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_RENDER_CACHE, "render-cache",
+          "Keep finished outputs in the directory <argument>, which is created \
+if needed. Each output is stored under a hash of the input and MIDI file \
+contents, the plugin chain with each plugin's ID and version, the preset file \
+contents, the other options, and the audio settings. When a later run \
+produces the same hash, the stored output is hard linked or copied to the \
+output path and nothing is rendered. Runs using --control, --editor, \
+--input-list, --resume, segments, or standard input or output are never \
+cached. Entries are never removed, so the directory must be cleaned up by \
+hand, and it should be emptied after a plugin is updated in place without \
+changing its version.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_RESAMPLE, "resample",
+          "Convert the input source to <argument> Hz while it is read, so that the \
+plugins process and the output is written at this sample rate. Without this \
+option, the sample rate of the input source is used for processing.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_RESAMPLE_QUALITY, "resample-quality",
+          "Quality of the sample rate conversion done with --resample. Recognized \
+values are \"low\", \"medium\", and \"high\". Higher qualities use longer filters, \
+which keep more of the high frequencies and alias less, but take longer to \
+compute.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+  programOptionsSetCString(options, OPTION_RESAMPLE_QUALITY, "medium");
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_RESUME, "resume",
+          "Continue a render which was interrupted after saving a checkpoint with \
+--checkpoint. All other options must be the same as for the interrupted render. \
+The output written before the checkpoint is kept, and the plugin chain is \
+settled with a preroll as set by --segment-preroll before rendering the rest.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_RT_AUDIT, "rt-audit",
+          "Check that no memory is allocated or freed, no locks are taken, and no \
+file I/O is done while the plugin chain processes audio or MIDI. Each violation \
+is attributed to either the host or the plugin which was processing, and a \
+summary is printed when processing finishes. If any violations were found, the \
+program exits with an error code. This is only supported on Linux, and the \
+real-time audit library built with WITH_RT_AUDIT must be loaded with \
+LD_PRELOAD.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -284,6 +986,221 @@ using unusual sample rates will probably result in weird behavior from plugins."
   programOptionsSetNumber(options, OPTION_SAMPLE_RATE,
                           (const float)getSampleRate());
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SCAN_PLUGIN, "scan-plugin",
+          "Load a single plugin and print its information in a format which is \
+read by --scan-plugins. This is used internally by the plugin scanner.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SCAN_PLUGINS, "scan-plugins",
+          "Load every plugin in the plugin index which has not been scanned yet \
+and store its type, ID, I/O configuration, and shell sub-plugins in the index. \
+Each plugin is loaded in a separate process, so plugins which crash or hang do \
+not stop the scan. Each effect and instrument is also probed for the \
+capabilities which are listed for --plugin-capability, by loading and \
+rendering it several times. Up to <argument> plugins are loaded at once, or \
+one per processor if no argument is given. Requires --plugin-index.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetNumber(options, OPTION_SCAN_PLUGINS, 0.0f);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SEGMENT_PREROLL, "segment-preroll",
+          "Time in milliseconds which each segment of --segments, the range given \
+with --start, or a render continued with --resume starts processing before \
+its first frame, so that delay lines, reverbs, and other plugin state have \
+settled by the time that output is written. By default this is the processing \
+delay plus the longest tail time in the plugin chain.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SEGMENTS, "segments",
+          "Split the input source into <argument> segments which are rendered \
+as separate jobs, and join them into the output source afterwards. The \
+segments are processed on --jobs threads and by any servers given with \
+--dispatch. Each segment starts with a preroll (see --segment-preroll) whose \
+output is discarded, and the segments are joined end to end, so plugins whose \
+output depends on more than the preroll may produce slightly different audio \
+at segment boundaries. When no servers are used and the output is a PCM or \
+WAVE file, each segment writes directly to its part of the output, otherwise \
+the segments are written to temporary files which are joined afterwards. The \
+input must be a file with a known length, and this \
+option cannot be combined with --input-list, --midi-file, --max-time, or \
+--resample.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SERIAL_LOAD, "serial-load",
+          "Name of a plugin which is always loaded on the main thread, even with \
+--parallel-load. This can be given several times, for plugins which crash or \
+misbehave when they are loaded at the same time as others.",
+          NO_SHORT_FORM, kProgramOptionTypeList,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SERVE, "serve",
+          "Run as a server which accepts render jobs on <argument>, which is \
+either a TCP port on the loopback interface or the path of a UNIX socket. Each \
+job is a single line of tab-separated key=value fields, for example \
+\"input=in.wav<TAB>output=out.wav<TAB>plugin=mrs_gain<TAB>parameter=0,0.5\". \
+Supported keys are input, output, midi, plugin, parameter, sample-rate, \
+blocksize, and start, length and preroll, which are given in frames and render \
+only part of the input. The server replies with \"OK<TAB><frames>\" or \"ERROR<TAB><code>\" once \
+the job has finished. Plugin chains are kept open between jobs, so that \
+repeated jobs with the same chain do not load the plugins again, although \
+parameters which were set by an earlier job stay in effect. Changing the \
+sample rate or blocksize only suspends and resumes the plugins. Send \
+\"shutdown\" to stop the server.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SERVER_WORKERS, "server-workers",
+          "Fork <argument> worker processes which all accept jobs for --serve, \
+so that several jobs are rendered at once. If --plugin is also given, then \
+that chain is loaded before the workers are forked, and they all share the \
+memory of its plugins and the data which they loaded, instead of each loading \
+its own copy. Plugins which start threads when they are opened should not be \
+used for this chain, and it is not loaded before forking if the fork-safe \
+capability of any of its plugins is 'no' in the plugin index (see \
+--plugin-capability). Workers which crash are replaced, and a shutdown request \
+stops all workers once they have finished their current job. Not supported \
+on Windows.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+  programOptionsSetNumber(options, OPTION_SERVER_WORKERS, 0.0f);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SIDECHAIN_SOURCE, "sidechain-source",
+          "Feed a second audio file into the inputs of a plugin which follow the \
+channels it receives from the chain, in the format 'name,file'. This is the key \
+input of a compressor, gate or ducker, which then no longer has to be premixed \
+into extra channels of the input. The file is read in step with the input and \
+must have the same sample rate, and the plugin must have more inputs than the \
+file has channels. This option cannot be combined with --input-list, \
+--segments, --start, --end, --checkpoint, --resample, or --dispatch.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SKIP_SILENCE, "skip-silence",
+          "Skip processing effect plugins while their input is silent, once their \
+reported tail time and delay has passed. Such plugins output silence instead, \
+which saves most of the processing time for sparse input like stems. Plugins \
+which do not report a tail time are skipped after one block of silent input, \
+so this option should not be used with plugins which report their tail time \
+incorrectly.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SPARSE_OUTPUT, "sparse-output",
+          "Do not write output blocks which are entirely silent to raw PCM and \
+WAVE files, but skip over them instead. The skipped parts read back as silence \
+and take no disk space on filesystems which support sparse files, which saves \
+I/O for renders that are mostly silent, such as instruments driven by sparse \
+MIDI. Silent blocks written to stdout are still written, but without \
+converting their samples. This has no effect with --dither, 8-bit output, or \
+when resuming an output.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_START, "start",
+          "Start rendering the input source at <argument> milliseconds. PCM, \
+WAVE, and FLAC inputs jump straight to this time, minus --segment-preroll, and \
+the preroll is processed without being written. MIDI files are played from \
+this time as well, but notes and tempo changes before the preroll are skipped. \
+Cannot be combined with --segments, --input-list, --max-time, or --resample.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_STARTUP_PROFILE, "startup-profile",
+          "Log how long each step of starting up took before processing began, \
+such as parsing options, loading plugins, and opening the input and output. \
+For short jobs, startup can take longer than the processing itself.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_STEMS, "stems",
+          "Also write the outputs of the last plugin in the chain as separate \
+stems, for instruments which have more outputs than the output has channels. \
+Each group of outputs with as many channels as the output is written to its \
+own file, which is named after the output with the number of the stem before \
+the extension, for example 'drums.stem1.wav', 'drums.stem2.wav' and so on. All \
+stems come from the same render, and are written in the background like \
+--write-behind. The output itself is written as usual. This cannot be \
+combined with --segments, --input-list, --checkpoint, or --resume.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_STOP_ON_SILENCE, "stop-on-silence",
+          "After the end of the input, or the last event of the MIDI file, keep \
+processing until the output has been silent for <argument> milliseconds, and \
+then stop. Unlike --flush-tail, this does not depend on the tail times which \
+the plugins report, which are often far too long, or zero for instruments whose \
+release would then be cut off. Samples which round to zero in the output bit \
+depth count as silent. Processing stops after at most 60 seconds of tail. \
+Default value: 500 milliseconds.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetNumber(options, OPTION_STOP_ON_SILENCE, 500.0f);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_STREAMS, "streams",
+          "Run many realtime streams in one process, which are listed in the \
+file <argument> with one stream per line in the same format as for --serve. \
+Each stream needs an input, an output and a plugin chain, and may also set \
+parameters, a sample rate and a blocksize. Every block of a stream must be \
+processed before the time which it would take to play it, and the streams are \
+shared by a few worker threads, which always process the block with the \
+earliest deadline next. The number of threads is set with --jobs, which uses \
+one thread per processor by default, and each thread is pinned to its own \
+processor unless --cpu-affinity is given. The number of missed deadlines is \
+reported for each stream. Empty lines and lines starting with '#' are ignored. \
+For example:\n\n\
+\tinput=a.wav\toutput=a-out.wav\tplugin=mrs_gain\tblocksize=256\n\
+\tinput=b.wav\toutput=b-out.wav\tplugin=mrs_limiter\tsample-rate=48000",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options, newProgramOptionWithName(OPTION_TEMPO, "tempo",
                                         "Tempo to use when processing.",
@@ -302,6 +1219,19 @@ using unusual sample rates will probably result in weird behavior from plugins."
   // hardcoded string is also relatively safe.
   programOptionsSetCString(options, OPTION_TIME_SIGNATURE, "4/4");
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_TRACE_FILE, "trace-file",
+          "Record when each phase of processing started and how long it took on\
+every thread: loading plugins and presets, reading input, processing audio and \
+MIDI in each plugin, and writing output. When processing finishes, the events \
+are written to the given file in the Chrome trace event format, which can be \
+opened with chrome://tracing or ui.perfetto.dev.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetCString(options, OPTION_TRACE_FILE, "trace.json");
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -318,6 +1248,54 @@ using unusual sample rates will probably result in weird behavior from plugins."
                         NO_SHORT_FORM, kProgramOptionTypeEmpty,
                         kProgramOptionArgumentTypeNone));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_WARMUP, "warmup",
+          "Run <argument> blocks of silence through the plugin chain before \
+processing starts, and then reset the plugins. Many plugins allocate memory or \
+compile code when they process their first blocks, which would otherwise be \
+counted in the plugin timing statistics and make the first blocks miss their \
+deadline with --realtime. The warmup is not written to the output, and is not \
+counted in the timing statistics. Server, manifest and input list jobs warm up \
+each plugin chain once, when it is loaded. Default value: 8 blocks.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetNumber(options, OPTION_WARMUP, 8.0f);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_WATCHDOG, "watchdog",
+          "Abort processing if a plugin spends longer than <argument> \
+milliseconds on a single block, which catches plugins which hang instead of \
+crashing. The error names the plugin and the block which it was processing, \
+and when --error-report is given the report is written before exiting. Default \
+value: 10000 milliseconds.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetNumber(options, OPTION_WATCHDOG, 10000.0f);
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_WRITE_BEHIND, "write-behind",
+          "Write the output source in a background thread, buffering up to \
+<argument> processed blocks. The plugin chain then keeps running while earlier \
+blocks are converted and written, which mostly helps when writing to slow or \
+network-mounted storage. When writing to a pipe on stdout or a TCP stream, this is \
+always done with 4 blocks unless another value is given. When rendering a \
+single input to a file on a computer with more than one processor, the output \
+is converted to its sample format and written in the background with 4 blocks \
+as well, unless another value is given. Otherwise, raw PCM and WAVE files are \
+written without a thread through an I/O ring where the platform supports it, \
+so that blocks are converted on the processing thread and only written in the \
+background. Use 0 to convert and write the output on the processing thread \
+instead.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetNumber(options, OPTION_WRITE_BEHIND, 4.0f);
+
   programOptionsAdd(
       options, newProgramOptionWithName(
                    OPTION_ZEBRA_SIZE, "zebra-size",
@@ -31,35 +31,104 @@
 
 // Runtime options
 typedef enum {
+  OPTION_ANALYZE_OUTPUT,
+  OPTION_AUTO_BLOCKSIZE,
+  OPTION_AUTOMATION,
   OPTION_BIT_DEPTH,
   OPTION_BLOCKSIZE,
+  OPTION_CHANNEL_INSTANCES,
   OPTION_CHANNELS,
+  OPTION_CHECKPOINT,
   OPTION_COLOR_LOGGING,
   OPTION_COLOR_TEST,
+  OPTION_COMPARE_HASHES,
   OPTION_CONFIG_FILE,
+  OPTION_CONTROL,
+  OPTION_CPU_AFFINITY,
+  OPTION_DECODE_CACHE,
+  OPTION_DEGRADE,
+  OPTION_DISPATCH,
   OPTION_DISPLAY_INFO,
+  OPTION_DITHER,
   OPTION_EDITOR,
+  OPTION_END,
   OPTION_ENDIAN,
   OPTION_ERROR_REPORT,
+  OPTION_FAN_OUT,
+  OPTION_FLAC_LEVEL,
+  OPTION_FLAC_THREADS,
+  OPTION_FLUSH_TAIL,
   OPTION_HELP,
+  OPTION_IDLE_INTERVAL,
+  OPTION_INPUT_LIST,
+  OPTION_INPUT_MMAP,
   OPTION_INPUT_SOURCE,
+  OPTION_IO_BLOCKSIZE,
+  OPTION_ISOLATE,
+  OPTION_JOBS,
+  OPTION_KEEP_DENORMALS,
+  OPTION_LATENCY_REPORT,
   OPTION_LIST_FILE_TYPES,
   OPTION_LIST_PLUGINS,
+  OPTION_LOCK_MEMORY,
   OPTION_LOG_FILE,
   OPTION_LOG_LEVEL,
+  OPTION_MANIFEST,
   OPTION_MAX_TIME,
+  OPTION_MEMORY_BUDGET,
+  OPTION_METRICS,
+  OPTION_MIDI_ROUTE,
   OPTION_MIDI_SOURCE,
+  OPTION_NOTE_CACHE,
+  OPTION_NUMA_NODE,
+  OPTION_OFFLINE,
+  OPTION_OUTPUT_HASHES,
   OPTION_OUTPUT_SOURCE,
+  OPTION_PARALLEL_LOAD,
   OPTION_PARAMETER,
+  OPTION_PCM_PLANAR,
+  OPTION_PERF_COUNTERS,
+  OPTION_PERF_REPORT,
+  OPTION_PIPELINE,
   OPTION_PLUGIN,
+  OPTION_PLUGIN_CAPABILITY,
+  OPTION_PLUGIN_HOST,
+  OPTION_PLUGIN_INDEX,
   OPTION_PLUGIN_ROOT,
+  OPTION_PREFETCH,
+  OPTION_PRESET_CACHE,
+  OPTION_PROFILE,
   OPTION_QUIET,
   OPTION_REALTIME,
+  OPTION_RENDER_CACHE,
+  OPTION_RESAMPLE,
+  OPTION_RESAMPLE_QUALITY,
+  OPTION_RESUME,
+  OPTION_RT_AUDIT,
   OPTION_SAMPLE_RATE,
+  OPTION_SCAN_PLUGIN,
+  OPTION_SCAN_PLUGINS,
+  OPTION_SEGMENT_PREROLL,
+  OPTION_SEGMENTS,
+  OPTION_SERIAL_LOAD,
+  OPTION_SERVE,
+  OPTION_SERVER_WORKERS,
+  OPTION_SIDECHAIN_SOURCE,
+  OPTION_SKIP_SILENCE,
+  OPTION_SPARSE_OUTPUT,
+  OPTION_START,
+  OPTION_STARTUP_PROFILE,
+  OPTION_STEMS,
+  OPTION_STOP_ON_SILENCE,
+  OPTION_STREAMS,
   OPTION_TEMPO,
   OPTION_TIME_SIGNATURE,
+  OPTION_TRACE_FILE,
   OPTION_VERBOSE,
   OPTION_VERSION,
+  OPTION_WARMUP,
+  OPTION_WATCHDOG,
+  OPTION_WRITE_BEHIND,
   OPTION_ZEBRA_SIZE,
   NUM_OPTIONS
 } ProgramOptionIndex;
@@ -0,0 +1,163 @@
+//
+// ControlServer.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "ControlServer.h"
+
+#include "base/Socket.h"
+#include "base/Thread.h"
+#include "logging/EventLogger.h"
+
+// Only used by the thread which starts and stops the server
+static Socket _controlServer = NULL;
+static Thread _controlServerThread = NULL;
+static CharString _controlServerAddress = NULL;
+static PluginChain _controlServerPluginChain = NULL;
+static PluginControl _controlServerControl = NULL;
+static volatile unsigned int _controlServerStopping = 0;
+// The client which is being served, guarded by _controlServerMutex so that
+// controlServerStop() can disconnect it
+static Socket _controlServerConnection = NULL;
+static Mutex _controlServerMutex = NULL;
+
+static void _controlServerSetConnection(Socket connection) {
+  mutexLock(_controlServerMutex);
+  _controlServerConnection = connection;
+  mutexUnlock(_controlServerMutex);
+}
+
+static void _controlServerServeConnection(Socket connection, CharString line,
+                                          CharString reply) {
+  while (!atomicLoad(&_controlServerStopping) &&
+         socketReadLine(connection, line)) {
+    if (charStringIsEmpty(line)) {
+      continue;
+    }
+
+    if (pluginControlHandleLine(_controlServerControl, line, reply)) {
+      logInfo("Control command '%s' accepted", line->data);
+    } else {
+      logWarn("Control command '%s' was refused", line->data);
+    }
+
+    if (!socketWriteLine(connection, reply)) {
+      break;
+    }
+  }
+}
+
+static void _controlServerThreadFunc(void *unused) {
+  CharString line = newCharStringWithCapacity(kCharStringLengthLong);
+  CharString reply = newCharStringWithCapacity(kCharStringLengthLong);
+  Socket connection;
+
+  threadSetBackgroundPriority();
+
+  while (true) {
+    connection = socketAccept(_controlServer);
+
+    // controlServerStop() connects once to wake this thread up
+    if (connection == NULL || atomicLoad(&_controlServerStopping)) {
+      freeSocket(connection);
+      break;
+    }
+
+    _controlServerSetConnection(connection);
+    _controlServerServeConnection(connection, line, reply);
+    _controlServerSetConnection(NULL);
+    freeSocket(connection);
+  }
+
+  freeCharString(line);
+  freeCharString(reply);
+}
+
+boolByte controlServerStart(const CharString address, PluginChain pluginChain) {
+  if (_controlServer != NULL) {
+    logError("Control server is already running");
+    return false;
+  }
+
+  _controlServer = newSocketListening(address);
+
+  if (_controlServer == NULL) {
+    logError("Could not listen for control commands on '%s'", address->data);
+    return false;
+  }
+
+  _controlServerControl =
+      newPluginControl(CONTROL_SERVER_MAX_PENDING_COMMANDS);
+  _controlServerMutex = newMutex();
+  atomicStore(&_controlServerStopping, 0);
+  _controlServerThread = newThread(_controlServerThreadFunc, NULL);
+
+  if (_controlServerThread == NULL) {
+    logError("Could not start control server thread");
+    freeSocket(_controlServer);
+    freePluginControl(_controlServerControl);
+    freeMutex(_controlServerMutex);
+    _controlServer = NULL;
+    _controlServerControl = NULL;
+    _controlServerMutex = NULL;
+    return false;
+  }
+
+  _controlServerAddress = newCharString();
+  charStringCopy(_controlServerAddress, address);
+  _controlServerPluginChain = pluginChain;
+  pluginChainSetControl(pluginChain, _controlServerControl);
+  logInfo("Accepting control commands on '%s'", address->data);
+  return true;
+}
+
+void controlServerStop(void) {
+  Socket wakeUp;
+
+  if (_controlServer == NULL) {
+    return;
+  }
+
+  atomicStore(&_controlServerStopping, 1);
+
+  mutexLock(_controlServerMutex);
+  if (_controlServerConnection != NULL) {
+    socketShutdown(_controlServerConnection);
+  }
+  mutexUnlock(_controlServerMutex);
+
+  wakeUp = newSocketConnected(_controlServerAddress);
+  freeSocket(wakeUp);
+  threadJoinAndFree(_controlServerThread);
+  pluginChainSetControl(_controlServerPluginChain, NULL);
+  freePluginControl(_controlServerControl);
+  freeSocket(_controlServer);
+  freeMutex(_controlServerMutex);
+  freeCharString(_controlServerAddress);
+  _controlServerThread = NULL;
+  _controlServerControl = NULL;
+  _controlServerPluginChain = NULL;
+  _controlServer = NULL;
+  _controlServerMutex = NULL;
+  _controlServerAddress = NULL;
+}
@@ -0,0 +1,61 @@
+//
+// ControlServer.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_ControlServer_h
+#define MrsWatson_ControlServer_h
+
+#include "base/CharString.h"
+#include "base/Types.h"
+#include "plugin/PluginChain.h"
+
+/**
+ * Maximum number of changes which may wait to be applied to the plugin chain.
+ * Further changes are refused until the chain processes another block.
+ */
+#define CONTROL_SERVER_MAX_PENDING_COMMANDS 64
+
+/**
+ * Start accepting parameter and preset changes for a plugin chain which is
+ * processing audio, for example in a realtime session. Clients connect to the
+ * address and send commands in the text protocol which is described in
+ * PluginControl.h, one per line, and receive one reply line for each. Clients
+ * are served one after another by a background thread, which also opens any
+ * presets, so the processing thread never waits for the control connection.
+ * @param address Port number on the loopback interface, or path of a UNIX
+ * domain socket, see newSocketListening()
+ * @param pluginChain Plugin chain to change, which must not be freed before
+ * controlServerStop() is called
+ * @return True if the server was started
+ */
+boolByte controlServerStart(const CharString address, PluginChain pluginChain);
+
+/**
+ * Stop the server started by controlServerStart(), if it is running. Any
+ * client which is still connected is disconnected, and changes which were not
+ * applied yet are dropped.
+ */
+void controlServerStop(void);
+
+#endif
@@ -0,0 +1,420 @@
+//
+// LiveMetrics.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "LiveMetrics.h"
+
+#include "base/PlatformInfo.h"
+#include "base/Socket.h"
+#include "base/Thread.h"
+#include "logging/EventLogger.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LIVE_METRICS_NUM_BOUNDS 10
+// Longest line of the exported text, which is at most a label and a number
+#define LIVE_METRICS_LINE_LENGTH 512
+
+// Upper bounds of the block time histogram buckets, in seconds, which is the
+// base unit that Prometheus expects. Blocks which take longer than the last
+// bound are only counted in the implicit "+Inf" bucket.
+static const double kLiveMetricsBucketBounds[LIVE_METRICS_NUM_BOUNDS] = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1};
+static const char *kLiveMetricsQueueNames[NUM_LIVE_METRICS_QUEUES] = {
+    "prefetch", "write_behind"};
+static const char *kLiveMetricsHttpHeader =
+    "HTTP/1.0 200 OK\r\n"
+    "Content-Type: text/plain; version=0.0.4\r\n"
+    "Connection: close\r\n"
+    "Content-Length: %lu\r\n\r\n";
+
+typedef struct {
+  char name[LIVE_METRICS_PLUGIN_NAME_LENGTH];
+  // Number of blocks in each bucket, which are not cumulative like in the
+  // exported metrics. The last bucket holds blocks above the last bound.
+  uint64_t buckets[LIVE_METRICS_NUM_BOUNDS + 1];
+  uint64_t count;
+  double sumInSeconds;
+} _LiveMetricsHistogramMembers;
+
+typedef struct {
+  _LiveMetricsHistogramMembers chain;
+  _LiveMetricsHistogramMembers plugins[LIVE_METRICS_MAX_PLUGINS];
+  unsigned int numPlugins;
+  uint64_t deadlineMisses;
+  uint64_t jobsSucceeded;
+  uint64_t jobsFailed;
+} _LiveMetricsValuesMembers;
+
+// Guarded by _liveMetricsLock
+static _LiveMetricsValuesMembers _liveMetricsValues;
+static volatile unsigned int _liveMetricsLock = 0;
+static volatile unsigned int _liveMetricsEnabled = 0;
+// Updated with atomic operations, and read as signed values
+static volatile unsigned int _liveMetricsQueuedBlocks[NUM_LIVE_METRICS_QUEUES];
+
+// Only used by the thread which starts and stops the server
+static Socket _liveMetricsServer = NULL;
+static Thread _liveMetricsThread = NULL;
+static CharString _liveMetricsAddress = NULL;
+static volatile unsigned int _liveMetricsStopping = 0;
+
+boolByte liveMetricsIsEnabled(void) {
+  return (boolByte)(atomicLoad(&_liveMetricsEnabled) != 0);
+}
+
+void liveMetricsSetEnabled(boolByte enabled) {
+  atomicStore(&_liveMetricsEnabled, enabled ? 1 : 0);
+}
+
+static void _liveMetricsLockValues(void) {
+  // A spin lock, since the processing threads must not sleep on a mutex while
+  // the server copies the values
+  while (!atomicCompareAndSwap(&_liveMetricsLock, 0, 1)) {
+  }
+}
+
+static void _liveMetricsUnlockValues(void) {
+  atomicStore(&_liveMetricsLock, 0);
+}
+
+static void
+_liveMetricsHistogramRecord(_LiveMetricsHistogramMembers *histogram,
+                            double timeInSeconds) {
+  unsigned int i;
+
+  for (i = 0; i < LIVE_METRICS_NUM_BOUNDS; i++) {
+    if (timeInSeconds <= kLiveMetricsBucketBounds[i]) {
+      break;
+    }
+  }
+
+  histogram->buckets[i]++;
+  histogram->count++;
+  histogram->sumInSeconds += timeInSeconds;
+}
+
+void liveMetricsRecordBlock(double timeInMs, double deadlineInMs) {
+  if (!liveMetricsIsEnabled()) {
+    return;
+  }
+
+  _liveMetricsLockValues();
+  _liveMetricsHistogramRecord(&(_liveMetricsValues.chain), timeInMs / 1000.0);
+
+  if (timeInMs > deadlineInMs) {
+    _liveMetricsValues.deadlineMisses++;
+  }
+
+  _liveMetricsUnlockValues();
+}
+
+static _LiveMetricsHistogramMembers *_liveMetricsFindPlugin(const char *name) {
+  _LiveMetricsHistogramMembers *plugin;
+  unsigned int i;
+
+  for (i = 0; i < _liveMetricsValues.numPlugins; i++) {
+    if (strncmp(_liveMetricsValues.plugins[i].name, name,
+                LIVE_METRICS_PLUGIN_NAME_LENGTH - 1) == 0) {
+      return &(_liveMetricsValues.plugins[i]);
+    }
+  }
+
+  if (_liveMetricsValues.numPlugins == LIVE_METRICS_MAX_PLUGINS) {
+    return &(_liveMetricsValues.plugins[LIVE_METRICS_MAX_PLUGINS - 1]);
+  }
+
+  plugin = &(_liveMetricsValues.plugins[_liveMetricsValues.numPlugins++]);
+  memset(plugin, 0, sizeof(_LiveMetricsHistogramMembers));
+  strncpy(plugin->name, name, LIVE_METRICS_PLUGIN_NAME_LENGTH - 1);
+  return plugin;
+}
+
+void liveMetricsRecordPluginBlock(const char *pluginName, double timeInMs) {
+  if (!liveMetricsIsEnabled()) {
+    return;
+  }
+
+  _liveMetricsLockValues();
+  _liveMetricsHistogramRecord(_liveMetricsFindPlugin(pluginName),
+                              timeInMs / 1000.0);
+  _liveMetricsUnlockValues();
+}
+
+void liveMetricsRecordJob(boolByte succeeded) {
+  _liveMetricsLockValues();
+
+  if (succeeded) {
+    _liveMetricsValues.jobsSucceeded++;
+  } else {
+    _liveMetricsValues.jobsFailed++;
+  }
+
+  _liveMetricsUnlockValues();
+}
+
+void liveMetricsAddQueuedBlocks(LiveMetricsQueue queue, int numBlocks) {
+  // Negative numbers wrap around to the same unsigned addition
+  atomicAdd(&(_liveMetricsQueuedBlocks[queue]), (unsigned int)numBlocks);
+}
+
+int liveMetricsGetQueuedBlocks(LiveMetricsQueue queue) {
+  return (int)atomicLoad(&(_liveMetricsQueuedBlocks[queue]));
+}
+
+static void _liveMetricsAppend(CharString outText, const char *format, ...) {
+  char line[LIVE_METRICS_LINE_LENGTH];
+  va_list arguments;
+
+  va_start(arguments, format);
+  vsnprintf(line, sizeof(line), format, arguments);
+  va_end(arguments);
+  charStringAppendCString(outText, line);
+}
+
+static void _liveMetricsAppendHeader(CharString outText, const char *name,
+                                     const char *type, const char *help) {
+  _liveMetricsAppend(outText, "# HELP %s %s\n# TYPE %s %s\n", name, help, name,
+                     type);
+}
+
+// Escapes a label value, which is always shorter than the plugin name limit
+static void _liveMetricsEscapeLabel(const char *value, char *outValue) {
+  size_t length = 0;
+  const char *c;
+
+  for (c = value; *c != '\0'; c++) {
+    if (*c == '\\' || *c == '"') {
+      outValue[length++] = '\\';
+      outValue[length++] = *c;
+    } else if (*c == '\n') {
+      outValue[length++] = '\\';
+      outValue[length++] = 'n';
+    } else {
+      outValue[length++] = *c;
+    }
+  }
+
+  outValue[length] = '\0';
+}
+
+// Labels are given without braces, and may be empty
+static void
+_liveMetricsAppendHistogram(CharString outText, const char *name,
+                            const char *labels,
+                            const _LiveMetricsHistogramMembers *histogram) {
+  const char *separator = *labels != '\0' ? "," : "";
+  char labelSet[LIVE_METRICS_LINE_LENGTH] = "";
+  uint64_t cumulativeCount = 0;
+  unsigned int i;
+
+  if (*labels != '\0') {
+    snprintf(labelSet, sizeof(labelSet), "{%s}", labels);
+  }
+
+  for (i = 0; i < LIVE_METRICS_NUM_BOUNDS; i++) {
+    cumulativeCount += histogram->buckets[i];
+    _liveMetricsAppend(outText, "%s_bucket{%s%sle=\"%g\"} %llu\n", name,
+                       labels, separator, kLiveMetricsBucketBounds[i],
+                       (unsigned long long)cumulativeCount);
+  }
+
+  _liveMetricsAppend(outText, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name,
+                     labels, separator, (unsigned long long)histogram->count);
+  _liveMetricsAppend(outText, "%s_sum%s %.9f\n%s_count%s %llu\n", name,
+                     labelSet, histogram->sumInSeconds, name, labelSet,
+                     (unsigned long long)histogram->count);
+}
+
+void liveMetricsWritePrometheus(CharString outText) {
+  // Copied so that the processing threads are not held up while formatting
+  _LiveMetricsValuesMembers values;
+  char escapedName[LIVE_METRICS_PLUGIN_NAME_LENGTH * 2];
+  char labels[LIVE_METRICS_PLUGIN_NAME_LENGTH * 2 + 16];
+  unsigned int i;
+
+  _liveMetricsLockValues();
+  memcpy(&values, &_liveMetricsValues, sizeof(_LiveMetricsValuesMembers));
+  _liveMetricsUnlockValues();
+
+  _liveMetricsAppendHeader(outText, "mrswatson_blocks_processed_total",
+                           "counter", "Blocks processed by the plugin chain.");
+  _liveMetricsAppend(outText, "mrswatson_blocks_processed_total %llu\n",
+                     (unsigned long long)values.chain.count);
+  _liveMetricsAppendHeader(outText, "mrswatson_deadline_misses_total",
+                           "counter",
+                           "Blocks which took longer to process than their "
+                           "duration.");
+  _liveMetricsAppend(outText, "mrswatson_deadline_misses_total %llu\n",
+                     (unsigned long long)values.deadlineMisses);
+
+  _liveMetricsAppendHeader(outText, "mrswatson_block_duration_seconds",
+                           "histogram",
+                           "Time taken by the plugin chain to process a "
+                           "block.");
+  _liveMetricsAppendHistogram(outText, "mrswatson_block_duration_seconds", "",
+                              &(values.chain));
+
+  if (values.numPlugins > 0) {
+    _liveMetricsAppendHeader(outText, "mrswatson_plugin_block_duration_seconds",
+                             "histogram",
+                             "Time taken by each plugin to process a block.");
+  }
+
+  for (i = 0; i < values.numPlugins; i++) {
+    _liveMetricsEscapeLabel(values.plugins[i].name, escapedName);
+    snprintf(labels, sizeof(labels), "plugin=\"%s\"", escapedName);
+    _liveMetricsAppendHistogram(outText,
+                                "mrswatson_plugin_block_duration_seconds",
+                                labels, &(values.plugins[i]));
+  }
+
+  _liveMetricsAppendHeader(outText, "mrswatson_jobs_total", "counter",
+                           "Jobs finished in server or manifest mode.");
+  _liveMetricsAppend(outText,
+                     "mrswatson_jobs_total{result=\"success\"} %llu\n"
+                     "mrswatson_jobs_total{result=\"failure\"} %llu\n",
+                     (unsigned long long)values.jobsSucceeded,
+                     (unsigned long long)values.jobsFailed);
+
+  _liveMetricsAppendHeader(outText, "mrswatson_queued_blocks", "gauge",
+                           "Blocks waiting in the asynchronous I/O queues.");
+
+  for (i = 0; i < NUM_LIVE_METRICS_QUEUES; i++) {
+    _liveMetricsAppend(
+        outText, "mrswatson_queued_blocks{queue=\"%s\"} %d\n",
+        kLiveMetricsQueueNames[i],
+        (int)atomicLoad(&(_liveMetricsQueuedBlocks[i])));
+  }
+
+  _liveMetricsAppendHeader(outText, "process_resident_memory_bytes", "gauge",
+                           "Resident memory size in bytes.");
+  _liveMetricsAppend(outText, "process_resident_memory_bytes %llu\n",
+                     (unsigned long long)platformInfoGetMemoryUsage() * 1024);
+  _liveMetricsAppendHeader(outText, "process_cpu_seconds_total", "counter",
+                           "Total user and system CPU time in seconds.");
+  _liveMetricsAppend(outText, "process_cpu_seconds_total %.3f\n",
+                     platformInfoGetProcessCpuTime() / 1000.0);
+}
+
+static void _liveMetricsServeConnection(Socket connection, CharString line,
+                                        CharString text) {
+  char header[LIVE_METRICS_LINE_LENGTH];
+
+  // Everything about the request is ignored, but it must be read before the
+  // connection is closed or the client may see a reset instead of the reply
+  while (socketReadLine(connection, line) && !charStringIsEmpty(line)) {
+  }
+
+  charStringClear(text);
+  liveMetricsWritePrometheus(text);
+  snprintf(header, sizeof(header), kLiveMetricsHttpHeader,
+           (unsigned long)strlen(text->data));
+
+  if (!socketWrite(connection, header, strlen(header)) ||
+      !socketWrite(connection, text->data, strlen(text->data))) {
+    logDebug("Could not send metrics to client");
+  }
+}
+
+static void _liveMetricsServerThread(void *unused) {
+  CharString line = newCharStringWithCapacity(kCharStringLengthLong);
+  CharString text = newCharString();
+  Socket connection;
+
+  threadSetBackgroundPriority();
+
+  while (true) {
+    connection = socketAccept(_liveMetricsServer);
+
+    // liveMetricsStopServer() connects once to wake this thread up
+    if (connection == NULL || atomicLoad(&_liveMetricsStopping)) {
+      freeSocket(connection);
+      break;
+    }
+
+    _liveMetricsServeConnection(connection, line, text);
+    freeSocket(connection);
+  }
+
+  freeCharString(line);
+  freeCharString(text);
+}
+
+boolByte liveMetricsStartServer(const CharString address) {
+  if (_liveMetricsServer != NULL) {
+    logError("Metrics server is already running");
+    return false;
+  }
+
+  _liveMetricsServer = newSocketListening(address);
+
+  if (_liveMetricsServer == NULL) {
+    logError("Could not listen for metrics requests on '%s'", address->data);
+    return false;
+  }
+
+  atomicStore(&_liveMetricsStopping, 0);
+  _liveMetricsThread = newThread(_liveMetricsServerThread, NULL);
+
+  if (_liveMetricsThread == NULL) {
+    logError("Could not start metrics server thread");
+    freeSocket(_liveMetricsServer);
+    _liveMetricsServer = NULL;
+    return false;
+  }
+
+  _liveMetricsAddress = newCharString();
+  charStringCopy(_liveMetricsAddress, address);
+  liveMetricsSetEnabled(true);
+  logInfo("Serving metrics on '%s'", address->data);
+  return true;
+}
+
+void liveMetricsStopServer(void) {
+  Socket wakeUp;
+
+  if (_liveMetricsServer == NULL) {
+    return;
+  }
+
+  atomicStore(&_liveMetricsStopping, 1);
+  wakeUp = newSocketConnected(_liveMetricsAddress);
+  freeSocket(wakeUp);
+  threadJoinAndFree(_liveMetricsThread);
+  freeSocket(_liveMetricsServer);
+  freeCharString(_liveMetricsAddress);
+  _liveMetricsThread = NULL;
+  _liveMetricsServer = NULL;
+  _liveMetricsAddress = NULL;
+}
+
+void liveMetricsReset(void) {
+  _liveMetricsLockValues();
+  memset(&_liveMetricsValues, 0, sizeof(_LiveMetricsValuesMembers));
+  _liveMetricsUnlockValues();
+}
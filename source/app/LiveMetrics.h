@@ -0,0 +1,142 @@
+//
+// LiveMetrics.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_LiveMetrics_h
+#define MrsWatson_LiveMetrics_h
+
+#include "base/CharString.h"
+#include "base/Types.h"
+
+/**
+ * Live metrics are counters and gauges which are updated while audio is being
+ * processed, so that a monitoring system can watch a long-running server or
+ * realtime session instead of waiting for the end-of-run summary. They are
+ * served in the Prometheus text format over plain HTTP by a background thread
+ * with a lowered priority.
+ *
+ * Block times are recorded by the processing threads under a spin lock which
+ * is held only for a few additions, and the server copies a snapshot of them
+ * under the same lock, so recording never waits on a system call.
+ */
+typedef enum {
+  // Blocks which were read ahead by --prefetch and not yet processed
+  LIVE_METRICS_QUEUE_PREFETCH,
+  // Blocks which were processed and not yet written by --write-behind
+  LIVE_METRICS_QUEUE_WRITE_BEHIND,
+  NUM_LIVE_METRICS_QUEUES
+} LiveMetricsQueue;
+
+/**
+ * Maximum length of a plugin name, including the terminating NULL byte. Longer
+ * plugin names are truncated in the metrics.
+ */
+#define LIVE_METRICS_PLUGIN_NAME_LENGTH 64
+
+/**
+ * Maximum number of different plugins which can be tracked. Blocks from any
+ * further plugins are attributed to the last one.
+ */
+#define LIVE_METRICS_MAX_PLUGINS 32
+
+/**
+ * Check if block times are being recorded
+ * @return True once liveMetricsSetEnabled() or liveMetricsStartServer() has
+ * been called
+ */
+boolByte liveMetricsIsEnabled(void);
+
+/**
+ * Start or stop recording block times for all threads. Recorded values are
+ * kept when recording is stopped.
+ * @param enabled True to start recording
+ */
+void liveMetricsSetEnabled(boolByte enabled);
+
+/**
+ * Record the time which the plugin chain took to process a block. Does nothing
+ * unless recording is enabled.
+ * @param timeInMs Processing time of the block, in milliseconds
+ * @param deadlineInMs Duration of the block's audio, in milliseconds. Blocks
+ * which took longer than this are counted as deadline misses.
+ */
+void liveMetricsRecordBlock(double timeInMs, double deadlineInMs);
+
+/**
+ * Record the time which a single plugin took to process a block. Does nothing
+ * unless recording is enabled.
+ * @param pluginName Name of the plugin
+ * @param timeInMs Processing time of the block, in milliseconds
+ */
+void liveMetricsRecordPluginBlock(const char *pluginName, double timeInMs);
+
+/**
+ * Count a finished job in server or manifest mode
+ * @param succeeded True if the job was processed successfully
+ */
+void liveMetricsRecordJob(boolByte succeeded);
+
+/**
+ * Change the number of blocks which are waiting in a queue. Queues are always
+ * tracked, even while recording is disabled, so that the gauge stays correct.
+ * @param queue Queue to change
+ * @param numBlocks Number of blocks which were added, or a negative number for
+ * blocks which were removed
+ */
+void liveMetricsAddQueuedBlocks(LiveMetricsQueue queue, int numBlocks);
+
+/**
+ * Get the number of blocks which are waiting in a queue
+ * @param queue Queue to check
+ * @return Number of blocks
+ */
+int liveMetricsGetQueuedBlocks(LiveMetricsQueue queue);
+
+/**
+ * Append all metrics to a string, in the Prometheus text exposition format.
+ * This is also used by the server, but may be called from any thread.
+ * @param outText String to append to
+ */
+void liveMetricsWritePrometheus(CharString outText);
+
+/**
+ * Enable recording and start serving the metrics over HTTP. Any request on
+ * the address gets the current metrics as the response.
+ * @param address Port number on the loopback interface, or path of a UNIX
+ * domain socket, see newSocketListening()
+ * @return True if the server was started
+ */
+boolByte liveMetricsStartServer(const CharString address);
+
+/**
+ * Stop the server started by liveMetricsStartServer(), if it is running
+ */
+void liveMetricsStopServer(void);
+
+/**
+ * Forget all recorded values except for the queue depths
+ */
+void liveMetricsReset(void);
+
+#endif
@@ -0,0 +1,211 @@
+//
+// OutputHashes.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "OutputHashes.h"
+
+#include "base/XxHash.h"
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const size_t kOutputHashesInitialCapacity = 256;
+
+static OutputHashes _newOutputHashes(SampleCount blocksize,
+                                     ChannelCount numChannels,
+                                     size_t capacity) {
+  OutputHashes self = (OutputHashes)malloc(sizeof(OutputHashesMembers));
+
+  self->blocksize = blocksize;
+  self->numChannels = numChannels;
+  self->numFrames = 0;
+  self->capacity = capacity;
+  self->blockHashes =
+      (unsigned long long *)calloc(capacity, sizeof(unsigned long long));
+  self->numBlocks = 0;
+  self->mutex = newMutex();
+  return self;
+}
+
+OutputHashes newOutputHashes(SampleCount blocksize, ChannelCount numChannels) {
+  return _newOutputHashes(blocksize, numChannels,
+                          kOutputHashesInitialCapacity);
+}
+
+OutputHashes newOutputHashesFromFile(const CharString filename) {
+  FILE *file = fopen(filename->data, "r");
+  OutputHashes self;
+  unsigned long blocksize;
+  unsigned int numChannels;
+  unsigned long numFrames;
+  unsigned long long fileHash;
+  unsigned long long hash;
+
+  if (file == NULL) {
+    logError("Could not open output hashes '%s'", filename->data);
+    return NULL;
+  }
+
+  if (fscanf(file, " blocksize %lu channels %u frames %lu file %llx",
+             &blocksize, &numChannels, &numFrames, &fileHash) != 4 ||
+      blocksize == 0) {
+    logError("'%s' does not contain output hashes", filename->data);
+    fclose(file);
+    return NULL;
+  }
+
+  self = _newOutputHashes((SampleCount)blocksize, (ChannelCount)numChannels,
+                          kOutputHashesInitialCapacity);
+
+  while (fscanf(file, "%llx", &hash) == 1) {
+    outputHashesSetBlock(self, self->numBlocks, hash, self->blocksize);
+  }
+
+  fclose(file);
+  self->numFrames = numFrames;
+
+  if (outputHashesGetFileHash(self) != fileHash) {
+    logError("Output hashes in '%s' are incomplete or damaged",
+             filename->data);
+    freeOutputHashes(self);
+    return NULL;
+  }
+
+  return self;
+}
+
+void outputHashesSetBlock(OutputHashes self, size_t blockIndex,
+                          unsigned long long hash, SampleCount numFrames) {
+  const unsigned long endFrame =
+      (unsigned long)blockIndex * self->blocksize + numFrames;
+  size_t capacity;
+
+  mutexLock(self->mutex);
+
+  if (blockIndex >= self->capacity) {
+    capacity = self->capacity * 2;
+
+    while (capacity <= blockIndex) {
+      capacity *= 2;
+    }
+
+    self->blockHashes = (unsigned long long *)realloc(
+        self->blockHashes, sizeof(unsigned long long) * capacity);
+    memset(self->blockHashes + self->capacity, 0,
+           sizeof(unsigned long long) * (capacity - self->capacity));
+    self->capacity = capacity;
+  }
+
+  self->blockHashes[blockIndex] = hash;
+
+  if (blockIndex >= self->numBlocks) {
+    self->numBlocks = blockIndex + 1;
+  }
+
+  if (endFrame > self->numFrames) {
+    self->numFrames = endFrame;
+  }
+
+  mutexUnlock(self->mutex);
+}
+
+unsigned long long outputHashesGetFileHash(const OutputHashes self) {
+  XxHashMembers state;
+  byte bytes[8];
+  size_t i;
+  unsigned int j;
+
+  state.seed = 0;
+  xxHashReset(&state);
+
+  // Block hashes are hashed as little-endian bytes, so that the file hash does
+  // not depend on the byte order of the processor
+  for (i = 0; i < self->numBlocks; i++) {
+    for (j = 0; j < sizeof(bytes); j++) {
+      bytes[j] = (byte)(self->blockHashes[i] >> (j * 8));
+    }
+
+    xxHashUpdate(&state, bytes, sizeof(bytes));
+  }
+
+  return xxHashDigest(&state);
+}
+
+size_t outputHashesFindFirstDifference(const OutputHashes self,
+                                       const OutputHashes other) {
+  size_t i;
+
+  for (i = 0; i < self->numBlocks && i < other->numBlocks; i++) {
+    if (self->blockHashes[i] != other->blockHashes[i]) {
+      return i;
+    }
+  }
+
+  if (self->numBlocks != other->numBlocks) {
+    return i;
+  } else if (self->numFrames != other->numFrames) {
+    // Only the length of the last block is different
+    return i > 0 ? i - 1 : 0;
+  }
+
+  return OUTPUT_HASHES_NO_DIFFERENCE;
+}
+
+boolByte outputHashesWrite(const OutputHashes self, const CharString filename) {
+  FILE *file = fopen(filename->data, "w");
+  boolByte result;
+  size_t i;
+
+  if (file == NULL) {
+    logError("Could not write output hashes to '%s'", filename->data);
+    return false;
+  }
+
+  fprintf(file, "blocksize %lu\n", (unsigned long)self->blocksize);
+  fprintf(file, "channels %u\n", (unsigned int)self->numChannels);
+  fprintf(file, "frames %lu\n", self->numFrames);
+  fprintf(file, "file %016llx\n", outputHashesGetFileHash(self));
+
+  for (i = 0; i < self->numBlocks; i++) {
+    fprintf(file, "%016llx\n", self->blockHashes[i]);
+  }
+
+  result = (boolByte)(fclose(file) == 0);
+
+  if (!result) {
+    logError("Could not write output hashes to '%s'", filename->data);
+  }
+
+  return result;
+}
+
+void freeOutputHashes(OutputHashes self) {
+  if (self != NULL) {
+    freeMutex(self->mutex);
+    free(self->blockHashes);
+    free(self);
+  }
+}
@@ -0,0 +1,128 @@
+//
+// OutputHashes.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_OutputHashes_h
+#define MrsWatson_OutputHashes_h
+
+#include "base/CharString.h"
+#include "base/Thread.h"
+#include "base/Types.h"
+
+#include <stddef.h>
+
+/**
+ * Hashes of an output, which prove that two renders produced the same samples
+ * without comparing the files themselves. The output is split into blocks of
+ * a fixed number of frames, counted from the start of the output rather than
+ * from wherever a write happened to start, so that renders which wrote their
+ * output in pieces of different sizes have the same hashes. The hash of the
+ * whole output is made from the block hashes, which lets segments that are
+ * rendered in parallel contribute their blocks in any order.
+ *
+ * Each block hash is the XXH64 hash of the XXH64 hashes of its channels, and
+ * the samples are hashed as they are in memory. Builds with double precision
+ * samples therefore have different hashes than other builds.
+ */
+typedef struct {
+  SampleCount blocksize;
+  ChannelCount numChannels;
+  // Length of the output, which is the end of the last block that was hashed
+  unsigned long numFrames;
+  // Blocks which no writer has hashed yet, for example because a segment
+  // failed, have a hash of 0
+  unsigned long long *blockHashes;
+  size_t numBlocks;
+  size_t capacity;
+  // Segments hash their blocks from several threads at once
+  Mutex mutex;
+} OutputHashesMembers;
+typedef OutputHashesMembers *OutputHashes;
+
+/**
+ * Returned by outputHashesFindFirstDifference() when two outputs are the same
+ */
+#define OUTPUT_HASHES_NO_DIFFERENCE ((size_t)-1)
+
+/**
+ * Create an empty set of output hashes
+ * @param blocksize Number of frames in each block
+ * @param numChannels Number of channels in the output
+ * @return New output hashes
+ */
+OutputHashes newOutputHashes(SampleCount blocksize, ChannelCount numChannels);
+
+/**
+ * Read output hashes from a file written by outputHashesWrite().
+ * @param filename File to read
+ * @return New output hashes, or NULL if the file could not be read
+ */
+OutputHashes newOutputHashesFromFile(const CharString filename);
+
+/**
+ * Store the hash of one block. This may be called from any thread.
+ * @param self
+ * @param blockIndex Index of the block, counted from the start of the output
+ * @param hash Hash of the block's samples
+ * @param numFrames Number of frames in the block, which is only less than the
+ * blocksize for the last block of the output
+ */
+void outputHashesSetBlock(OutputHashes self, size_t blockIndex,
+                          unsigned long long hash, SampleCount numFrames);
+
+/**
+ * Get the hash of the whole output, which is the XXH64 hash of all block
+ * hashes in order.
+ * @param self
+ * @return 64-bit hash
+ */
+unsigned long long outputHashesGetFileHash(const OutputHashes self);
+
+/**
+ * Find the first block where two outputs differ. Outputs of different lengths
+ * differ at the first block which only one of them has.
+ * @param self
+ * @param other Hashes to compare with, which must have the same blocksize and
+ * number of channels
+ * @return Index of the first different block, or OUTPUT_HASHES_NO_DIFFERENCE
+ */
+size_t outputHashesFindFirstDifference(const OutputHashes self,
+                                       const OutputHashes other);
+
+/**
+ * Write the hashes to a text file. The file starts with the blocksize, number
+ * of channels, length and file hash, and then has one line for each block.
+ * @param self
+ * @param filename File to write
+ * @return True if the file was written
+ */
+boolByte outputHashesWrite(const OutputHashes self, const CharString filename);
+
+/**
+ * Free output hashes
+ * @param self
+ */
+void freeOutputHashes(OutputHashes self);
+
+#endif
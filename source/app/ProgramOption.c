@@ -50,7 +50,7 @@ ProgramOption newProgramOptionWithName(const int optionIndex, const char *name,
 
   option->index = (unsigned int)optionIndex;
   option->name = newCharStringWithCString(name);
-  option->help = newCharStringWithCString(help);
+  option->help = help;
   option->hasShortForm = hasShortForm;
   option->hideInHelp = false;
 
@@ -108,6 +108,7 @@ void _programOptionPrintDefaultValue(const ProgramOption self) {
 
 void programOptionPrintHelp(const ProgramOption self, boolByte withFullHelp,
                             int indentSize, int initialIndent) {
+  CharString helpString;
   CharString wrappedHelpString;
   int i;
 
@@ -147,10 +148,12 @@ void programOptionPrintHelp(const ProgramOption self, boolByte withFullHelp,
 
   if (withFullHelp) {
     // Newline and indentation before help
+    helpString = newCharStringWithCString(self->help);
     wrappedHelpString =
-        charStringWrap(self->help, (unsigned int)(initialIndent + indentSize));
+        charStringWrap(helpString, (unsigned int)(initialIndent + indentSize));
     printf("\n%s\n\n", wrappedHelpString->data);
     freeCharString(wrappedHelpString);
+    freeCharString(helpString);
   } else {
     printf("\n");
   }
@@ -221,7 +224,6 @@ static void _programOptionSetData(ProgramOption self, const char *data) {
 void freeProgramOption(ProgramOption self) {
   if (self != NULL) {
     freeCharString(self->name);
-    freeCharString(self->help);
 
     switch (self->type) {
     case kProgramOptionTypeString:
@@ -390,7 +392,7 @@ boolByte programOptionsParseConfigFile(ProgramOptions self,
   boolByte result = false;
   File configFile = NULL;
   LinkedList configFileLines = NULL;
-  CharString *argvCharStrings;
+  LinkedListIterator iterator;
   int argc;
   char **argv;
   int i;
@@ -424,14 +426,15 @@ boolByte programOptionsParseConfigFile(ProgramOptions self,
     freeFile(configFile);
   }
 
-  argvCharStrings = (CharString *)linkedListToArray(configFileLines);
   argc = linkedListLength(configFileLines);
   argv = (char **)malloc(sizeof(char *) * (argc + 1));
   // Normally this would be the application name, don't care about it here
   argv[0] = NULL;
+  i = 1;
 
-  for (i = 0; i < argc; i++) {
-    argv[i + 1] = argvCharStrings[i]->data;
+  for (iterator = linkedListBegin(configFileLines); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    argv[i++] = ((CharString)linkedListIteratorGetItem(iterator))->data;
   }
 
   argc++;
@@ -439,7 +442,6 @@ boolByte programOptionsParseConfigFile(ProgramOptions self,
 
   freeLinkedListAndItems(configFileLines,
                          (LinkedListFreeItemFunc)freeCharString);
-  free(argvCharStrings);
   free(argv);
   return result;
 }
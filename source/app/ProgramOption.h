@@ -58,7 +58,8 @@ typedef union {
 typedef struct {
   unsigned int index;
   CharString name;
-  CharString help;
+  // Not copied, since most help is only printed when asked for
+  const char *help;
   boolByte hasShortForm;
   // For "hidden" options which should not be printed out in the help output
   boolByte hideInHelp;
@@ -86,7 +87,8 @@ ProgramOption newProgramOption(void);
  * Create a new ProgramOption instance with some default values
  * @param opnionIndex Reference index for option (ie, from an enum)
  * @param name Full option name, hyphenated in the case of multiple words
- * @param help Full help string
+ * @param help Full help string, which is not copied and so must outlive the
+ * option, which it does when it is a string literal
  * @param hasShortForm True if the option should also be matched with the first
  * letter
  * @param argumentType Expected argument type which can be passed to this option
@@ -0,0 +1,265 @@
+//
+// RealtimeAudit.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "RealtimeAudit.h"
+
+#include "base/Thread.h"
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if LINUX
+#include <dlfcn.h>
+#include <pthread.h>
+#endif
+
+static const char *kRealtimeAuditViolationNames[NUM_REALTIME_VIOLATION_TYPES] =
+    {"allocations", "locks", "I/O calls"};
+
+typedef struct {
+  char name[REALTIME_AUDIT_OWNER_NAME_LENGTH];
+  unsigned long numViolations[NUM_REALTIME_VIOLATION_TYPES];
+  const char *firstFunction[NUM_REALTIME_VIOLATION_TYPES];
+} _RealtimeAuditOwnerMembers;
+
+// The first owner is always the host, and plugins are added after it as they
+// cause violations. All of this is guarded by _realtimeAuditLock.
+static _RealtimeAuditOwnerMembers
+    _realtimeAuditOwners[REALTIME_AUDIT_MAX_OWNERS];
+static unsigned int _realtimeAuditNumOwners = 1;
+static volatile unsigned int _realtimeAuditLock = 0;
+static volatile unsigned int _realtimeAuditEnabled = 0;
+
+static THREAD_LOCAL unsigned int _realtimeAuditDepth = 0;
+static THREAD_LOCAL const char *_realtimeAuditPlugin = NULL;
+// Set while a violation is being recorded, so that nothing which is called
+// from the recording code can cause another violation
+static THREAD_LOCAL boolByte _realtimeAuditRecording = false;
+
+#if LINUX
+static pthread_once_t _realtimeAuditPreloadOnce = PTHREAD_ONCE_INIT;
+static boolByte _realtimeAuditPreloaded = false;
+
+static void _realtimeAuditConnectPreload(void) {
+  union {
+    RealtimeAuditPreloadRegisterFunc function;
+    void *pointer;
+  } preloadRegister;
+  void *program = dlopen(NULL, RTLD_LAZY);
+
+  if (program == NULL) {
+    return;
+  }
+
+  // Libraries loaded with LD_PRELOAD are searched along with the program
+  preloadRegister.pointer = dlsym(program, REALTIME_AUDIT_PRELOAD_REGISTER);
+
+  if (preloadRegister.pointer != NULL) {
+    preloadRegister.function(realtimeAuditRecordViolation);
+    _realtimeAuditPreloaded = true;
+  }
+
+  dlclose(program);
+}
+#endif
+
+boolByte realtimeAuditIsSupported(void) {
+#if LINUX
+  pthread_once(&_realtimeAuditPreloadOnce, _realtimeAuditConnectPreload);
+  return _realtimeAuditPreloaded;
+#else
+  return false;
+#endif
+}
+
+void realtimeAuditSetEnabled(boolByte enabled) {
+  if (enabled) {
+    realtimeAuditIsSupported();
+  }
+
+  atomicStore(&_realtimeAuditEnabled, enabled ? 1 : 0);
+}
+
+void realtimeAuditBegin(void) { _realtimeAuditDepth++; }
+
+void realtimeAuditEnd(void) {
+  if (_realtimeAuditDepth > 0) {
+    _realtimeAuditDepth--;
+  }
+}
+
+void realtimeAuditEnterPlugin(const char *pluginName) {
+  _realtimeAuditPlugin = pluginName;
+  _realtimeAuditDepth++;
+}
+
+void realtimeAuditExitPlugin(void) {
+  _realtimeAuditPlugin = NULL;
+  realtimeAuditEnd();
+}
+
+static void _realtimeAuditLockOwners(void) {
+  // A spin lock, since a mutex would be reported as a violation itself
+  while (!atomicCompareAndSwap(&_realtimeAuditLock, 0, 1)) {
+  }
+}
+
+static void _realtimeAuditUnlockOwners(void) {
+  atomicStore(&_realtimeAuditLock, 0);
+}
+
+static _RealtimeAuditOwnerMembers *_realtimeAuditFindOwner(const char *name,
+                                                           boolByte create) {
+  unsigned int i;
+
+  if (name == NULL) {
+    return &(_realtimeAuditOwners[0]);
+  }
+
+  for (i = 1; i < _realtimeAuditNumOwners; i++) {
+    if (strncmp(_realtimeAuditOwners[i].name, name,
+                REALTIME_AUDIT_OWNER_NAME_LENGTH - 1) == 0) {
+      return &(_realtimeAuditOwners[i]);
+    }
+  }
+
+  if (!create) {
+    return NULL;
+  } else if (_realtimeAuditNumOwners == REALTIME_AUDIT_MAX_OWNERS) {
+    return &(_realtimeAuditOwners[REALTIME_AUDIT_MAX_OWNERS - 1]);
+  }
+
+  i = _realtimeAuditNumOwners++;
+  strncpy(_realtimeAuditOwners[i].name, name,
+          REALTIME_AUDIT_OWNER_NAME_LENGTH - 1);
+  _realtimeAuditOwners[i].name[REALTIME_AUDIT_OWNER_NAME_LENGTH - 1] = '\0';
+  return &(_realtimeAuditOwners[i]);
+}
+
+void realtimeAuditRecordViolation(RealtimeViolationType type,
+                                  const char *functionName) {
+  _RealtimeAuditOwnerMembers *owner;
+
+  // Checked first, since this is called for every interposed function
+  if (_realtimeAuditEnabled == 0 || _realtimeAuditDepth == 0 ||
+      _realtimeAuditRecording) {
+    return;
+  }
+
+  _realtimeAuditRecording = true;
+  _realtimeAuditLockOwners();
+  owner = _realtimeAuditFindOwner(_realtimeAuditPlugin, true);
+
+  if (owner->numViolations[type] == 0) {
+    owner->firstFunction[type] = functionName;
+  }
+
+  owner->numViolations[type]++;
+  _realtimeAuditUnlockOwners();
+  _realtimeAuditRecording = false;
+}
+
+unsigned long realtimeAuditGetNumViolations(void) {
+  unsigned long result = 0;
+  unsigned int i;
+  int type;
+
+  _realtimeAuditLockOwners();
+
+  for (i = 0; i < _realtimeAuditNumOwners; i++) {
+    for (type = 0; type < NUM_REALTIME_VIOLATION_TYPES; type++) {
+      result += _realtimeAuditOwners[i].numViolations[type];
+    }
+  }
+
+  _realtimeAuditUnlockOwners();
+  return result;
+}
+
+unsigned long realtimeAuditGetNumViolationsForOwner(const char *ownerName,
+                                                    RealtimeViolationType type) {
+  _RealtimeAuditOwnerMembers *owner;
+  unsigned long result = 0;
+
+  _realtimeAuditLockOwners();
+  owner = _realtimeAuditFindOwner(ownerName, false);
+
+  if (owner != NULL) {
+    result = owner->numViolations[type];
+  }
+
+  _realtimeAuditUnlockOwners();
+  return result;
+}
+
+void realtimeAuditLogReport(void) {
+  _RealtimeAuditOwnerMembers *owner;
+  unsigned int i;
+  int type;
+
+  if (!realtimeAuditIsSupported()) {
+    logWarn("Real-time audit library was not preloaded, no violations could "
+            "be detected. Set LD_PRELOAD to the libmrswatson-rt-audit.so or "
+            "libmrswatson64-rt-audit.so built with WITH_RT_AUDIT.");
+    return;
+  } else if (realtimeAuditGetNumViolations() == 0) {
+    logInfo("Real-time audit passed, no violations were detected");
+    return;
+  }
+
+  // Copies are not needed here, since nothing is being processed anymore
+  for (i = 0; i < _realtimeAuditNumOwners; i++) {
+    owner = &(_realtimeAuditOwners[i]);
+
+    for (type = 0; type < NUM_REALTIME_VIOLATION_TYPES; type++) {
+      if (owner->numViolations[type] > 0) {
+        if (i == 0) {
+          logWarn("Real-time audit: host made %lu %s while processing "
+                  "(first was %s)",
+                  owner->numViolations[type],
+                  kRealtimeAuditViolationNames[type],
+                  owner->firstFunction[type]);
+        } else {
+          logWarn("Real-time audit: plugin '%s' made %lu %s while processing "
+                  "(first was %s)",
+                  owner->name, owner->numViolations[type],
+                  kRealtimeAuditViolationNames[type],
+                  owner->firstFunction[type]);
+        }
+      }
+    }
+  }
+}
+
+void realtimeAuditReset(void) {
+  _realtimeAuditLockOwners();
+  memset(_realtimeAuditOwners, 0, sizeof(_realtimeAuditOwners));
+  _realtimeAuditNumOwners = 1;
+  _realtimeAuditUnlockOwners();
+}
+
@@ -0,0 +1,162 @@
+//
+// RealtimeAudit.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_RealtimeAudit_h
+#define MrsWatson_RealtimeAudit_h
+
+#include "base/Types.h"
+
+/**
+ * The real-time audit watches for calls which may block the processing thread
+ * while the plugin chain is processing a block, such as allocating memory,
+ * acquiring a lock, or doing file I/O. Each violation is attributed either to
+ * the host or to the plugin which was processing at the time.
+ *
+ * The calls are caught by interposing the corresponding libc functions in a
+ * separate library, which must be loaded with LD_PRELOAD so that nothing is
+ * interposed unless the audit is actually used. This is currently only
+ * supported on Linux builds with glibc. Otherwise the audit can still be
+ * enabled, but no violations will be recorded.
+ */
+typedef enum {
+  REALTIME_VIOLATION_ALLOCATION,
+  REALTIME_VIOLATION_LOCK,
+  REALTIME_VIOLATION_IO,
+  NUM_REALTIME_VIOLATION_TYPES
+} RealtimeViolationType;
+
+/**
+ * Maximum length of an owner name, including the terminating NULL byte. Longer
+ * plugin names are truncated in the report.
+ */
+#define REALTIME_AUDIT_OWNER_NAME_LENGTH 64
+
+/**
+ * Maximum number of different owners (the host and each plugin) which can be
+ * tracked. Violations from any further plugins are attributed to the last one.
+ */
+#define REALTIME_AUDIT_MAX_OWNERS 32
+
+/**
+ * Name of the preload library's function which connects it to this process.
+ * It is looked up at runtime, so the library is never linked to the program.
+ */
+#define REALTIME_AUDIT_PRELOAD_REGISTER "realtimeAuditPreloadRegister"
+
+/**
+ * Called by the preload library for each interposed function
+ */
+typedef void (*RealtimeAuditRecordFunc)(RealtimeViolationType type,
+                                        const char *functionName);
+
+/**
+ * Implemented by the preload library, see REALTIME_AUDIT_PRELOAD_REGISTER
+ * @param record Function which records a violation, or NULL to stop recording
+ */
+typedef void (*RealtimeAuditPreloadRegisterFunc)(
+    RealtimeAuditRecordFunc record);
+
+/**
+ * Check if violations can be detected, which requires the preload library. The
+ * first call connects the library to this process, so it should be made
+ * before processing starts.
+ * @return True if the libc functions are interposed in this process
+ */
+boolByte realtimeAuditIsSupported(void);
+
+/**
+ * Enable or disable the real-time audit for all threads. Recorded violations
+ * are kept when the audit is disabled. Enabling the audit also connects the
+ * preload library, if it was loaded.
+ * @param enabled True to start recording violations
+ */
+void realtimeAuditSetEnabled(boolByte enabled);
+
+/**
+ * Mark the start of a real-time section on the calling thread, for instance
+ * while the plugin chain processes a block. Sections may be nested.
+ */
+void realtimeAuditBegin(void);
+
+/**
+ * Mark the end of a real-time section started with realtimeAuditBegin().
+ */
+void realtimeAuditEnd(void);
+
+/**
+ * Attribute any violations on the calling thread to a plugin, until
+ * realtimeAuditExitPlugin() is called. This also starts a real-time section,
+ * since plugins may be processed on threads other than the chain's.
+ * @param pluginName Name of the plugin, which is copied when a violation is
+ * recorded. It must remain valid until realtimeAuditExitPlugin() is called.
+ */
+void realtimeAuditEnterPlugin(const char *pluginName);
+
+/**
+ * Attribute violations on the calling thread to the host again, and end the
+ * real-time section started by realtimeAuditEnterPlugin().
+ */
+void realtimeAuditExitPlugin(void);
+
+/**
+ * Record a violation if the audit is enabled and the calling thread is inside
+ * a real-time section. This function is safe to call from within the
+ * interposed functions, since it does not allocate, lock, or do any I/O
+ * itself.
+ * @param type Type of violation
+ * @param functionName Name of the function which was called. This must be a
+ * string constant.
+ */
+void realtimeAuditRecordViolation(RealtimeViolationType type,
+                                  const char *functionName);
+
+/**
+ * Get the total number of violations which have been recorded
+ * @return Number of violations of all types, for all owners
+ */
+unsigned long realtimeAuditGetNumViolations(void);
+
+/**
+ * Get the number of violations of one type which were recorded for an owner
+ * @param ownerName Name of the plugin, or NULL for the host
+ * @param type Type of violation
+ * @return Number of violations
+ */
+unsigned long realtimeAuditGetNumViolationsForOwner(const char *ownerName,
+                                                    RealtimeViolationType type);
+
+/**
+ * Log a summary of all recorded violations. This must not be called from a
+ * real-time section.
+ */
+void realtimeAuditLogReport(void);
+
+/**
+ * Forget all recorded violations
+ */
+void realtimeAuditReset(void);
+
+#endif
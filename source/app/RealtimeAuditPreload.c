@@ -0,0 +1,282 @@
+//
+// RealtimeAuditPreload.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+// This file is built into its own library, which is only loaded with
+// LD_PRELOAD while running the real-time audit. It is never linked into the
+// program, so the libc functions are not interposed otherwise.
+
+// Must be declared before any system headers, needed for RTLD_NEXT. The
+// fortified inline versions of the interposed functions are also disabled,
+// since they would conflict with the definitions below. Nothing else is
+// built in this library, so fortification is unaffected elsewhere.
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#undef _FORTIFY_SOURCE
+
+#include "RealtimeAudit.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#if !defined(__GLIBC__)
+#error "The real-time audit library requires glibc"
+#endif
+
+// The sanitizers interpose the same functions, so both cannot be used at once
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#error "The real-time audit library cannot be built with sanitizers"
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer)
+#error "The real-time audit library cannot be built with sanitizers"
+#endif
+#endif
+
+// Set by the program when the audit is enabled, and read by every interposed
+// call on any thread
+static RealtimeAuditRecordFunc _realtimeAuditRecord = NULL;
+
+// The next definition of each interposed function, which are all looked up
+// once by _realtimeAuditResolve(). The allocator is reached through glibc's
+// internal names instead, since dlsym() itself may need to allocate.
+static pthread_once_t _realtimeAuditResolveOnce = PTHREAD_ONCE_INIT;
+static int (*_nextPthreadMutexLock)(pthread_mutex_t *) = NULL;
+static int (*_nextPthreadCondWait)(pthread_cond_t *, pthread_mutex_t *) = NULL;
+static int (*_nextSemWait)(sem_t *) = NULL;
+static int (*_nextOpen)(const char *, int, ...) = NULL;
+static int (*_nextClose)(int) = NULL;
+static ssize_t (*_nextRead)(int, void *, size_t) = NULL;
+static ssize_t (*_nextWrite)(int, const void *, size_t) = NULL;
+static FILE *(*_nextFopen)(const char *, const char *) = NULL;
+static int (*_nextFclose)(FILE *) = NULL;
+static size_t (*_nextFread)(void *, size_t, size_t, FILE *) = NULL;
+static size_t (*_nextFwrite)(const void *, size_t, size_t, FILE *) = NULL;
+static int (*_nextFflush)(FILE *) = NULL;
+static int (*_nextFputs)(const char *, FILE *) = NULL;
+static int (*_nextPuts)(const char *) = NULL;
+static int (*_nextVfprintf)(FILE *, const char *, va_list) = NULL;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+// dlsym() returns an object pointer, which C99 does not allow to be converted
+// to a function pointer directly
+#define REALTIME_AUDIT_RESOLVE(next, functionName)                             \
+  *(void **)(&(next)) = dlsym(RTLD_NEXT, functionName)
+
+static void _realtimeAuditResolve(void) {
+  REALTIME_AUDIT_RESOLVE(_nextPthreadMutexLock, "pthread_mutex_lock");
+  REALTIME_AUDIT_RESOLVE(_nextPthreadCondWait, "pthread_cond_wait");
+  REALTIME_AUDIT_RESOLVE(_nextSemWait, "sem_wait");
+  REALTIME_AUDIT_RESOLVE(_nextOpen, "open");
+  REALTIME_AUDIT_RESOLVE(_nextClose, "close");
+  REALTIME_AUDIT_RESOLVE(_nextRead, "read");
+  REALTIME_AUDIT_RESOLVE(_nextWrite, "write");
+  REALTIME_AUDIT_RESOLVE(_nextFopen, "fopen");
+  REALTIME_AUDIT_RESOLVE(_nextFclose, "fclose");
+  REALTIME_AUDIT_RESOLVE(_nextFread, "fread");
+  REALTIME_AUDIT_RESOLVE(_nextFwrite, "fwrite");
+  REALTIME_AUDIT_RESOLVE(_nextFflush, "fflush");
+  REALTIME_AUDIT_RESOLVE(_nextFputs, "fputs");
+  REALTIME_AUDIT_RESOLVE(_nextPuts, "puts");
+  REALTIME_AUDIT_RESOLVE(_nextVfprintf, "vfprintf");
+}
+
+// Runs when the library is loaded, before the program starts any threads.
+// Each function still checks this as well, since the constructors of other
+// libraries may call them before this one has run.
+__attribute__((constructor)) static void _realtimeAuditPreloadInit(void) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+}
+
+static void _realtimeAuditRecordViolation(RealtimeViolationType type,
+                                          const char *functionName) {
+  RealtimeAuditRecordFunc record =
+      __atomic_load_n(&_realtimeAuditRecord, __ATOMIC_ACQUIRE);
+
+  if (record != NULL) {
+    record(type, functionName);
+  }
+}
+
+void realtimeAuditPreloadRegister(RealtimeAuditRecordFunc record);
+void realtimeAuditPreloadRegister(RealtimeAuditRecordFunc record) {
+  __atomic_store_n(&_realtimeAuditRecord, record, __ATOMIC_RELEASE);
+}
+
+void *malloc(size_t size) {
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_ALLOCATION, "malloc");
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_ALLOCATION, "calloc");
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_ALLOCATION, "realloc");
+  return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+  if (ptr != NULL) {
+    _realtimeAuditRecordViolation(REALTIME_VIOLATION_ALLOCATION, "free");
+  }
+
+  __libc_free(ptr);
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_LOCK, "pthread_mutex_lock");
+  return _nextPthreadMutexLock(mutex);
+}
+
+int pthread_cond_wait(pthread_cond_t *condition, pthread_mutex_t *mutex) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_LOCK, "pthread_cond_wait");
+  return _nextPthreadCondWait(condition, mutex);
+}
+
+int sem_wait(sem_t *semaphore) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_LOCK, "sem_wait");
+  return _nextSemWait(semaphore);
+}
+
+int open(const char *path, int flags, ...) {
+  int mode = 0;
+  va_list arguments;
+
+  if (flags & O_CREAT) {
+    va_start(arguments, flags);
+    mode = va_arg(arguments, int);
+    va_end(arguments);
+  }
+
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "open");
+  return _nextOpen(path, flags, mode);
+}
+
+int close(int fd) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "close");
+  return _nextClose(fd);
+}
+
+ssize_t read(int fd, void *buffer, size_t count) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "read");
+  return _nextRead(fd, buffer, count);
+}
+
+ssize_t write(int fd, const void *buffer, size_t count) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "write");
+  return _nextWrite(fd, buffer, count);
+}
+
+FILE *fopen(const char *path, const char *mode) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "fopen");
+  return _nextFopen(path, mode);
+}
+
+int fclose(FILE *stream) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "fclose");
+  return _nextFclose(stream);
+}
+
+size_t fread(void *buffer, size_t size, size_t count, FILE *stream) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "fread");
+  return _nextFread(buffer, size, count, stream);
+}
+
+size_t fwrite(const void *buffer, size_t size, size_t count, FILE *stream) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "fwrite");
+  return _nextFwrite(buffer, size, count, stream);
+}
+
+int fflush(FILE *stream) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "fflush");
+  return _nextFflush(stream);
+}
+
+int fputs(const char *string, FILE *stream) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "fputs");
+  return _nextFputs(string, stream);
+}
+
+int puts(const char *string) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "puts");
+  return _nextPuts(string);
+}
+
+int vfprintf(FILE *stream, const char *format, va_list arguments) {
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "vfprintf");
+  return _nextVfprintf(stream, format, arguments);
+}
+
+int fprintf(FILE *stream, const char *format, ...) {
+  va_list arguments;
+  int result;
+
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "fprintf");
+  va_start(arguments, format);
+  result = _nextVfprintf(stream, format, arguments);
+  va_end(arguments);
+  return result;
+}
+
+int printf(const char *format, ...) {
+  va_list arguments;
+  int result;
+
+  pthread_once(&_realtimeAuditResolveOnce, _realtimeAuditResolve);
+  _realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "printf");
+  va_start(arguments, format);
+  result = _nextVfprintf(stdout, format, arguments);
+  va_end(arguments);
+  return result;
+}
@@ -0,0 +1,362 @@
+//
+// RenderCache.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "RenderCache.h"
+
+#include "base/File.h"
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if WINDOWS
+#include <process.h>
+#include <windows.h>
+#define getpid _getpid
+#elif UNIX
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 128-bit FNV-1a offset basis, and the prime is 2^88 + kRenderCacheFnvPrimeLow
+static const uint64_t kRenderCacheFnvOffsetHigh = 0x6c62272e07bb0142ULL;
+static const uint64_t kRenderCacheFnvOffsetLow = 0x62b821756295c58dULL;
+static const uint64_t kRenderCacheFnvPrimeLow = 0x13bULL;
+// Size of the blocks which files are read in for hashing and copying
+static const size_t kRenderCacheBlockSize = 65536;
+
+static CharString renderCacheDirectory = NULL;
+
+RenderCacheKey newRenderCacheKey(void) {
+  RenderCacheKey self = (RenderCacheKey)malloc(sizeof(RenderCacheKeyMembers));
+  self->high = kRenderCacheFnvOffsetHigh;
+  self->low = kRenderCacheFnvOffsetLow;
+  return self;
+}
+
+static void _renderCacheKeyAddBytes(RenderCacheKey self, const byte *data,
+                                    size_t numBytes) {
+  uint64_t high = self->high;
+  uint64_t low = self->low;
+  uint64_t lowLow, lowHigh, product;
+  size_t i;
+
+  for (i = 0; i < numBytes; i++) {
+    low ^= data[i];
+    // Multiply the 128-bit value by the prime with 64-bit operations. The
+    // 2^88 part only moves the low half into the high half.
+    lowLow = (low & 0xffffffffULL) * kRenderCacheFnvPrimeLow;
+    lowHigh = (low >> 32) * kRenderCacheFnvPrimeLow;
+    product = lowLow + (lowHigh << 32);
+    high = high * kRenderCacheFnvPrimeLow + (lowHigh >> 32) +
+           (product < lowLow ? 1 : 0) + (low << 24);
+    low = product;
+  }
+
+  self->high = high;
+  self->low = low;
+}
+
+void renderCacheKeyAddString(RenderCacheKey self, const char *string) {
+  // The terminator is also hashed, so that parts cannot run into each other
+  _renderCacheKeyAddBytes(self, (const byte *)string, strlen(string) + 1);
+}
+
+void renderCacheKeyAddNumber(RenderCacheKey self, double number) {
+  char text[64];
+  snprintf(text, sizeof(text), "%.17g", number);
+  renderCacheKeyAddString(self, text);
+}
+
+// Devices and pipes must never be read for a key or replaced by an output
+static boolByte _renderCacheIsRegularFile(const char *path) {
+#if UNIX
+  struct stat fileStat;
+  return (boolByte)(stat(path, &fileStat) == 0 && S_ISREG(fileStat.st_mode));
+#else
+  FILE *file = fopen(path, "rb");
+
+  if (file != NULL) {
+    fclose(file);
+  }
+
+  return (boolByte)(file != NULL);
+#endif
+}
+
+static boolByte _renderCacheCanReplace(const char *path) {
+#if UNIX
+  struct stat fileStat;
+
+  if (stat(path, &fileStat) != 0) {
+    return true;
+  }
+
+  return (boolByte)S_ISREG(fileStat.st_mode);
+#else
+  return true;
+#endif
+}
+
+boolByte renderCacheKeyAddFile(RenderCacheKey self, const CharString path) {
+  FILE *file;
+  byte *block;
+  size_t numBytes;
+  boolByte result;
+
+  if (!_renderCacheIsRegularFile(path->data) ||
+      (file = fopen(path->data, "rb")) == NULL) {
+    return false;
+  }
+
+  block = (byte *)malloc(kRenderCacheBlockSize);
+
+  while ((numBytes = fread(block, 1, kRenderCacheBlockSize, file)) > 0) {
+    _renderCacheKeyAddBytes(self, block, numBytes);
+  }
+
+  result = (boolByte)(ferror(file) == 0);
+  free(block);
+  fclose(file);
+  // Separates the contents from the next part, like the string terminator
+  renderCacheKeyAddString(self, "");
+  return result;
+}
+
+CharString renderCacheKeyToString(const RenderCacheKey self) {
+  CharString result = newCharStringWithCapacity(33);
+  snprintf(result->data, result->capacity, "%016llx%016llx",
+           (unsigned long long)self->high, (unsigned long long)self->low);
+  return result;
+}
+
+void freeRenderCacheKey(RenderCacheKey self) {
+  free(self);
+}
+
+boolByte initRenderCache(const CharString cacheDirectory) {
+  File directory = newFileWithPath(cacheDirectory);
+  boolByte result = false;
+
+  if (directory != NULL) {
+    if (directory->fileType == kFileTypeDirectory) {
+      result = true;
+    } else if (directory->fileType == kFileTypeInvalid) {
+      result = fileCreate(directory, kFileTypeDirectory);
+    }
+  }
+
+  if (!result) {
+    logError("Could not use '%s' as render cache directory",
+             cacheDirectory->data);
+    freeFile(directory);
+    return false;
+  }
+
+  freeRenderCache();
+  renderCacheDirectory = newCharString();
+  charStringCopy(renderCacheDirectory, directory->absolutePath);
+  freeFile(directory);
+  return true;
+}
+
+boolByte renderCacheIsEnabled(void) {
+  return (boolByte)(renderCacheDirectory != NULL);
+}
+
+// Entries are named by the key and keep the output's extension, so that the
+// same render to another file format gets its own entry
+static CharString _getRenderCacheEntryPath(const RenderCacheKey key,
+                                           const CharString outputPath) {
+  CharString keyString = renderCacheKeyToString(key);
+  const char *extension = strrchr(outputPath->data, '.');
+  CharString result =
+      newCharStringWithCapacity(renderCacheDirectory->capacity + 64);
+
+  if (extension == NULL || strchr(extension, PATH_DELIMITER) != NULL) {
+    extension = "";
+  }
+
+  snprintf(result->data, result->capacity, "%s%c%s%s",
+           renderCacheDirectory->data, PATH_DELIMITER, keyString->data,
+           extension);
+  freeCharString(keyString);
+  return result;
+}
+
+static boolByte _renderCacheCopy(const char *sourcePath,
+                                 const char *destinationPath) {
+  FILE *source = fopen(sourcePath, "rb");
+  FILE *destination;
+  byte *block;
+  size_t numBytes;
+  boolByte result = true;
+
+  if (source == NULL) {
+    return false;
+  }
+
+  destination = fopen(destinationPath, "wb");
+
+  if (destination == NULL) {
+    fclose(source);
+    return false;
+  }
+
+  block = (byte *)malloc(kRenderCacheBlockSize);
+
+  while (result &&
+         (numBytes = fread(block, 1, kRenderCacheBlockSize, source)) > 0) {
+    result = (boolByte)(fwrite(block, 1, numBytes, destination) == numBytes);
+  }
+
+  result = (boolByte)(result && ferror(source) == 0);
+  free(block);
+  fclose(source);
+  result = (boolByte)(fclose(destination) == 0 && result);
+
+  if (!result) {
+    remove(destinationPath);
+  }
+
+  return result;
+}
+
+// Hard links share the data with the entry, so a hit costs no disk space
+static boolByte _renderCacheLinkOrCopy(const char *sourcePath,
+                                       const char *destinationPath) {
+#if UNIX
+  if (link(sourcePath, destinationPath) == 0) {
+    return true;
+  }
+#elif WINDOWS
+  if (CreateHardLinkA(destinationPath, sourcePath, NULL)) {
+    return true;
+  }
+#endif
+
+  return _renderCacheCopy(sourcePath, destinationPath);
+}
+
+boolByte renderCacheFetch(const RenderCacheKey key,
+                          const CharString outputPath) {
+  CharString entryPath;
+  FILE *entry;
+  boolByte result = false;
+
+  if (!renderCacheIsEnabled()) {
+    return false;
+  }
+
+  entryPath = _getRenderCacheEntryPath(key, outputPath);
+  entry = fopen(entryPath->data, "rb");
+
+  if (entry != NULL) {
+    fclose(entry);
+
+    if (!_renderCacheCanReplace(outputPath->data)) {
+      logWarn("Output '%s' is not a regular file, not using render cache",
+              outputPath->data);
+      entry = NULL;
+    }
+  }
+
+  if (entry != NULL) {
+    // Linking fails if the output already exists
+    remove(outputPath->data);
+    result = _renderCacheLinkOrCopy(entryPath->data, outputPath->data);
+
+    if (result) {
+      logInfo("Using cached render '%s'", entryPath->data);
+    } else {
+      logWarn("Could not use cached render '%s'", entryPath->data);
+    }
+  }
+
+  freeCharString(entryPath);
+  return result;
+}
+
+boolByte renderCacheStore(const RenderCacheKey key,
+                          const CharString outputPath) {
+  CharString entryPath;
+  CharString tempPath;
+  boolByte result;
+
+  if (!renderCacheIsEnabled()) {
+    return false;
+  }
+
+  entryPath = _getRenderCacheEntryPath(key, outputPath);
+  tempPath = newCharStringWithCapacity(entryPath->capacity + 32);
+  // Each process writes its own temporary file, so that concurrent renders
+  // never see a partially written entry
+  snprintf(tempPath->data, tempPath->capacity, "%s.%d.tmp", entryPath->data,
+           (int)getpid());
+  remove(tempPath->data);
+  // The entry is a copy rather than a link, since the output belongs to the
+  // caller. It is made read-only, since later hits may be linked to it.
+  result = _renderCacheCopy(outputPath->data, tempPath->data);
+#if UNIX
+  result = (boolByte)(result && chmod(tempPath->data, 0444) == 0);
+#endif
+
+#if WINDOWS
+  // Windows cannot rename a file over an existing one
+  if (result) {
+    remove(entryPath->data);
+  }
+#endif
+
+  if (result && rename(tempPath->data, entryPath->data) == 0) {
+    logInfo("Stored render in cache '%s'", entryPath->data);
+  } else {
+    logWarn("Could not write render cache entry '%s'", entryPath->data);
+    remove(tempPath->data);
+    result = false;
+  }
+
+  freeCharString(entryPath);
+  freeCharString(tempPath);
+  return result;
+}
+
+void renderCachePrepareOutput(const CharString outputPath) {
+#if UNIX
+  struct stat fileStat;
+
+  if (stat(outputPath->data, &fileStat) == 0 && S_ISREG(fileStat.st_mode) &&
+      fileStat.st_nlink > 1 && (fileStat.st_mode & 0222) == 0) {
+    remove(outputPath->data);
+  }
+#endif
+}
+
+void freeRenderCache(void) {
+  freeCharString(renderCacheDirectory);
+  renderCacheDirectory = NULL;
+}
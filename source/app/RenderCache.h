@@ -0,0 +1,139 @@
+//
+// RenderCache.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_RenderCache_h
+#define MrsWatson_RenderCache_h
+
+#include "base/CharString.h"
+#include "base/Types.h"
+
+#include <stdint.h>
+
+/**
+ * Identifies a render by everything which affects its output, such as the
+ * contents of the input file, the plugin chain, presets, parameters and audio
+ * settings. The parts are combined in a 128-bit FNV-1a hash, so two renders
+ * with the same key are assumed to produce the same output.
+ */
+typedef struct {
+  uint64_t high;
+  uint64_t low;
+} RenderCacheKeyMembers;
+typedef RenderCacheKeyMembers *RenderCacheKey;
+
+/**
+ * @return New key which has no parts yet
+ */
+RenderCacheKey newRenderCacheKey(void);
+
+/**
+ * Add a string to the key. Each part is terminated, so that adding "ab" and
+ * "c" gives another key than adding "a" and "bc".
+ * @param self
+ * @param string String to add
+ */
+void renderCacheKeyAddString(RenderCacheKey self, const char *string);
+
+/**
+ * Add a number to the key, in its decimal text form.
+ * @param self
+ * @param number Number to add
+ */
+void renderCacheKeyAddNumber(RenderCacheKey self, double number);
+
+/**
+ * Add the contents of a file to the key. The path itself is not added, so the
+ * same contents give the same key wherever the file is.
+ * @param self
+ * @param path Path to the file
+ * @return False if the file is not a regular file or could not be read, in
+ * which case the key should not be used
+ */
+boolByte renderCacheKeyAddFile(RenderCacheKey self, const CharString path);
+
+/**
+ * @param self
+ * @return Key as 32 hexadecimal digits, which the caller must free
+ */
+CharString renderCacheKeyToString(const RenderCacheKey self);
+
+/**
+ * @param self
+ */
+void freeRenderCacheKey(RenderCacheKey self);
+
+/**
+ * Enable the global render cache. If the cache was already enabled, then its
+ * directory is replaced.
+ * @param cacheDirectory Directory to store outputs in, which is created if it
+ * does not exist
+ * @return True if the directory exists or could be created
+ */
+boolByte initRenderCache(const CharString cacheDirectory);
+
+/**
+ * @return True if initRenderCache() has been called
+ */
+boolByte renderCacheIsEnabled(void);
+
+/**
+ * Get the output of an earlier render with the same key. The cached output is
+ * hard linked to the output path where the file system allows it, and copied
+ * otherwise. An existing file at the output path is replaced. Since entries
+ * are read-only, a linked output cannot be changed in place, and must be
+ * removed before it is written again.
+ * @param key Key of the render
+ * @param outputPath Path to place the output at, whose extension is also part
+ * of the entry's name
+ * @return True if the output was found and placed at outputPath
+ */
+boolByte renderCacheFetch(const RenderCacheKey key,
+                          const CharString outputPath);
+
+/**
+ * Store a copy of the output of a finished render, so that later renders with
+ * the same key can skip rendering. The entry is written under a temporary name
+ * first, so that concurrent renders never see a partial entry.
+ * @param key Key of the render
+ * @param outputPath Path of the finished output
+ * @return True if the output was stored
+ */
+boolByte renderCacheStore(const RenderCacheKey key,
+                          const CharString outputPath);
+
+/**
+ * Remove an output which an earlier hit linked to a read-only entry, so that
+ * it can be written again. Other files are left alone.
+ * @param outputPath Path of the output which is about to be written
+ */
+void renderCachePrepareOutput(const CharString outputPath);
+
+/**
+ * Disable the global render cache.
+ */
+void freeRenderCache(void);
+
+#endif
@@ -0,0 +1,311 @@
+//
+// RenderCheckpoint.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "RenderCheckpoint.h"
+
+#include "base/File.h"
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if UNIX
+#include <unistd.h>
+#endif
+
+static const char *kRenderCheckpointMagic = "MrsWatson checkpoint 1";
+static const char *kRenderCheckpointHexDigits = "0123456789abcdef";
+
+RenderCheckpoint newRenderCheckpoint(void) {
+  RenderCheckpoint self =
+      (RenderCheckpoint)malloc(sizeof(RenderCheckpointMembers));
+
+  self->inputSource = newCharString();
+  self->outputSource = newCharString();
+  self->inputFrame = 0;
+  self->outputFrame = 0;
+  self->outputOffset = 0;
+  self->clockFrame = 0;
+  self->pluginStates = newLinkedList();
+
+  return self;
+}
+
+static void _freeRenderCheckpointPluginState(void *item) {
+  RenderCheckpointPluginState pluginState = (RenderCheckpointPluginState)item;
+  free(pluginState->data);
+  free(pluginState);
+}
+
+CharString renderCheckpointGetFilename(const CharString outputSource) {
+  CharString result = newCharStringWithCString(outputSource->data);
+  charStringAppendCString(result, RENDER_CHECKPOINT_EXTENSION);
+  return result;
+}
+
+void renderCheckpointSetPluginState(RenderCheckpoint self, unsigned int index,
+                                    const byte *data, size_t dataSize) {
+  RenderCheckpointPluginState pluginState = NULL;
+  LinkedListIterator iterator;
+
+  for (iterator = linkedListBegin(self->pluginStates); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    pluginState =
+        (RenderCheckpointPluginState)linkedListIteratorGetItem(iterator);
+
+    if (pluginState->index == index) {
+      break;
+    }
+
+    pluginState = NULL;
+  }
+
+  if (pluginState == NULL) {
+    pluginState = (RenderCheckpointPluginState)malloc(
+        sizeof(RenderCheckpointPluginStateMembers));
+    pluginState->index = index;
+    pluginState->data = NULL;
+    linkedListAppend(self->pluginStates, pluginState);
+  }
+
+  free(pluginState->data);
+  pluginState->data = (byte *)malloc(dataSize > 0 ? dataSize : 1);
+  memcpy(pluginState->data, data, dataSize);
+  pluginState->dataSize = dataSize;
+}
+
+static void _renderCheckpointWritePluginState(void *item, void *userData) {
+  RenderCheckpointPluginState pluginState = (RenderCheckpointPluginState)item;
+  FILE *file = (FILE *)userData;
+  size_t i;
+
+  fprintf(file, "plugin-state=%u,", pluginState->index);
+
+  for (i = 0; i < pluginState->dataSize; i++) {
+    fputc(kRenderCheckpointHexDigits[pluginState->data[i] >> 4], file);
+    fputc(kRenderCheckpointHexDigits[pluginState->data[i] & 0x0f], file);
+  }
+
+  fputc('\n', file);
+}
+
+boolByte renderCheckpointWrite(const RenderCheckpoint self,
+                               const CharString filename) {
+  CharString tempFilename = newCharStringWithCString(filename->data);
+  FILE *file;
+  boolByte result;
+
+  charStringAppendCString(tempFilename, ".tmp");
+  file = fopen(tempFilename->data, "w");
+
+  if (file == NULL) {
+    logError("Could not open '%s' to write checkpoint", tempFilename->data);
+    freeCharString(tempFilename);
+    return false;
+  }
+
+  fprintf(file, "%s\n", kRenderCheckpointMagic);
+  fprintf(file, "input=%s\n", self->inputSource->data);
+  fprintf(file, "output=%s\n", self->outputSource->data);
+  fprintf(file, "input-frame=%lu\n", self->inputFrame);
+  fprintf(file, "output-frame=%lu\n", self->outputFrame);
+  fprintf(file, "output-offset=%lu\n", self->outputOffset);
+  fprintf(file, "clock-frame=%lu\n", self->clockFrame);
+  linkedListForeach(self->pluginStates, _renderCheckpointWritePluginState,
+                    file);
+
+  // The checkpoint must be on disk before it replaces the previous one
+  result = (boolByte)(fflush(file) == 0);
+#if UNIX
+  result = (boolByte)(result && fsync(fileno(file)) == 0);
+#endif
+  result = (boolByte)(fclose(file) == 0 && result);
+
+#if WINDOWS
+  // Unlike on Unix, rename() does not replace an existing file
+  remove(filename->data);
+#endif
+
+  if (!result || rename(tempFilename->data, filename->data) != 0) {
+    logError("Could not write checkpoint '%s'", filename->data);
+    remove(tempFilename->data);
+    result = false;
+  }
+
+  freeCharString(tempFilename);
+  return result;
+}
+
+static int _renderCheckpointHexValue(char c) {
+  const char *digit = strchr(kRenderCheckpointHexDigits, c);
+  return c != '\0' && digit != NULL ? (int)(digit - kRenderCheckpointHexDigits)
+                                    : -1;
+}
+
+static boolByte _renderCheckpointParsePluginState(RenderCheckpoint self,
+                                                  const char *value) {
+  char *end = NULL;
+  const unsigned long index = strtoul(value, &end, 10);
+  size_t numHexDigits;
+  byte *data;
+  size_t i;
+  int high;
+  int low;
+
+  if (end == value || *end != ',' || value[0] == '-') {
+    return false;
+  }
+
+  end++;
+  numHexDigits = strlen(end);
+
+  if (numHexDigits % 2 != 0) {
+    return false;
+  }
+
+  data = (byte *)malloc(numHexDigits / 2 + 1);
+
+  for (i = 0; i < numHexDigits / 2; i++) {
+    high = _renderCheckpointHexValue(end[i * 2]);
+    low = _renderCheckpointHexValue(end[i * 2 + 1]);
+
+    if (high < 0 || low < 0) {
+      free(data);
+      return false;
+    }
+
+    data[i] = (byte)((high << 4) | low);
+  }
+
+  renderCheckpointSetPluginState(self, (unsigned int)index, data,
+                                 numHexDigits / 2);
+  free(data);
+  return true;
+}
+
+static boolByte _renderCheckpointParseFrames(const char *value,
+                                             unsigned long *outFrames) {
+  char *end = NULL;
+
+  // strtoul() would silently accept a negative number
+  *outFrames = strtoul(value, &end, 10);
+  return (boolByte)(end != value && *end == '\0' && value[0] != '-');
+}
+
+static boolByte _renderCheckpointSetField(RenderCheckpoint self,
+                                          const char *key, const char *value) {
+  if (!strcmp(key, "input")) {
+    freeCharString(self->inputSource);
+    self->inputSource = newCharStringWithCString(value);
+  } else if (!strcmp(key, "output")) {
+    freeCharString(self->outputSource);
+    self->outputSource = newCharStringWithCString(value);
+  } else if (!strcmp(key, "input-frame")) {
+    return _renderCheckpointParseFrames(value, &(self->inputFrame));
+  } else if (!strcmp(key, "output-frame")) {
+    return _renderCheckpointParseFrames(value, &(self->outputFrame));
+  } else if (!strcmp(key, "output-offset")) {
+    return _renderCheckpointParseFrames(value, &(self->outputOffset));
+  } else if (!strcmp(key, "clock-frame")) {
+    return _renderCheckpointParseFrames(value, &(self->clockFrame));
+  } else if (!strcmp(key, "plugin-state")) {
+    return _renderCheckpointParsePluginState(self, value);
+  } else {
+    // Unknown keys are skipped, so that newer checkpoints can still be read
+    logDebug("Ignoring unknown checkpoint field '%s'", key);
+  }
+
+  return true;
+}
+
+boolByte renderCheckpointRead(RenderCheckpoint self,
+                              const CharString filename) {
+  File file = newFileWithPath(filename);
+  CharString contents = NULL;
+  LinkedList lines = NULL;
+  LinkedListIterator iterator;
+  CharString line;
+  char *equals;
+  boolByte result = false;
+
+  if (fileExists(file)) {
+    contents = fileReadContents(file);
+  }
+
+  if (contents == NULL) {
+    logError("Could not read checkpoint '%s'", filename->data);
+    freeFile(file);
+    return false;
+  }
+
+  // fileReadLines() limits lines to the default string length, which the hex
+  // encoded plugin states easily exceed
+  lines = charStringSplit(contents, '\n');
+  iterator = linkedListBegin(lines);
+
+  if (iterator != NULL &&
+      !strcmp(((CharString)linkedListIteratorGetItem(iterator))->data,
+              kRenderCheckpointMagic)) {
+    result = true;
+    freeLinkedListAndItems(self->pluginStates,
+                           _freeRenderCheckpointPluginState);
+    self->pluginStates = newLinkedList();
+
+    for (iterator = linkedListIteratorNext(iterator);
+         iterator != NULL && result;
+         iterator = linkedListIteratorNext(iterator)) {
+      line = (CharString)linkedListIteratorGetItem(iterator);
+      equals = strchr(line->data, '=');
+
+      if (equals == NULL) {
+        result = false;
+      } else {
+        *equals = '\0';
+        result = _renderCheckpointSetField(self, line->data, equals + 1);
+      }
+    }
+  }
+
+  if (!result) {
+    logError("'%s' is not a valid checkpoint", filename->data);
+  }
+
+  freeLinkedListAndItems(lines, (LinkedListFreeItemFunc)freeCharString);
+  freeCharString(contents);
+  freeFile(file);
+  return result;
+}
+
+void freeRenderCheckpoint(RenderCheckpoint self) {
+  if (self != NULL) {
+    freeCharString(self->inputSource);
+    freeCharString(self->outputSource);
+    freeLinkedListAndItems(self->pluginStates,
+                           _freeRenderCheckpointPluginState);
+    free(self);
+  }
+}
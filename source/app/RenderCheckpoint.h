@@ -0,0 +1,119 @@
+//
+// RenderCheckpoint.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_RenderCheckpoint_h
+#define MrsWatson_RenderCheckpoint_h
+
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+#include "base/Types.h"
+
+#define RENDER_CHECKPOINT_EXTENSION ".checkpoint"
+
+/** Saved state of one plugin in the chain */
+typedef struct {
+  /** Position of the plugin in the chain */
+  unsigned int index;
+  byte *data;
+  size_t dataSize;
+} RenderCheckpointPluginStateMembers;
+typedef RenderCheckpointPluginStateMembers *RenderCheckpointPluginState;
+
+/**
+ * Progress of a long render, which is saved from time to time so that the
+ * render can be continued with --resume if it is interrupted. A checkpoint is
+ * only written once everything before it has reached the output file, so the
+ * output can be kept up to the checkpoint and the rest rendered again.
+ *
+ * Checkpoints are stored as text files with one key=value pair per line, next
+ * to the output and named after it.
+ */
+typedef struct {
+  CharString inputSource;
+  CharString outputSource;
+  /** Input frame which corresponds to the first frame after the checkpoint */
+  unsigned long inputFrame;
+  /** Number of frames in the output file at the time of the checkpoint */
+  unsigned long outputFrame;
+  /** Offset in bytes of the end of those frames in the output file */
+  unsigned long outputOffset;
+  /** Frame of the audio clock at the time of the checkpoint */
+  unsigned long clockFrame;
+  /** List of RenderCheckpointPluginState for plugins which can save state */
+  LinkedList pluginStates;
+} RenderCheckpointMembers;
+typedef RenderCheckpointMembers *RenderCheckpoint;
+
+/**
+ * Create a new empty checkpoint
+ * @return New checkpoint
+ */
+RenderCheckpoint newRenderCheckpoint(void);
+
+/**
+ * Get the name of the checkpoint file which belongs to an output
+ * @param outputSource Name of the output source
+ * @return New string with the filename
+ */
+CharString renderCheckpointGetFilename(const CharString outputSource);
+
+/**
+ * Add the state of a plugin to a checkpoint, or replace the state which was
+ * added for the same plugin before.
+ * @param self
+ * @param index Position of the plugin in the chain
+ * @param data State of the plugin, which is copied
+ * @param dataSize Size of the state in bytes
+ */
+void renderCheckpointSetPluginState(RenderCheckpoint self, unsigned int index,
+                                    const byte *data, size_t dataSize);
+
+/**
+ * Save a checkpoint. The file is first written under a temporary name and then
+ * renamed, so that a crash while saving leaves the previous checkpoint intact.
+ * @param self
+ * @param filename File to write
+ * @return True if the checkpoint was saved
+ */
+boolByte renderCheckpointWrite(const RenderCheckpoint self,
+                               const CharString filename);
+
+/**
+ * Load a checkpoint which was saved with renderCheckpointWrite(). Any values
+ * which were already set are replaced.
+ * @param self
+ * @param filename File to read
+ * @return True if the file was a valid checkpoint
+ */
+boolByte renderCheckpointRead(RenderCheckpoint self, const CharString filename);
+
+/**
+ * Free a checkpoint and all of its plugin states
+ * @param self
+ */
+void freeRenderCheckpoint(RenderCheckpoint self);
+
+#endif
@@ -0,0 +1,57 @@
+//
+// RenderContext.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "RenderContext.h"
+
+#include <stdlib.h>
+
+static THREAD_LOCAL RenderContext currentRenderContext = NULL;
+
+RenderContext newRenderContext(void) {
+  RenderContext self = (RenderContext)malloc(sizeof(RenderContextMembers));
+
+  self->audioSettings = newAudioSettings();
+  self->audioClock = newAudioClock();
+  self->pluginChain = newPluginChain();
+
+  return self;
+}
+
+RenderContext getRenderContext(void) { return currentRenderContext; }
+
+void renderContextMakeCurrent(RenderContext self) {
+  currentRenderContext = self;
+}
+
+void freeRenderContext(RenderContext self) {
+  if (self != NULL) {
+    freePluginChain(self->pluginChain);
+    freeAudioClock(self->audioClock);
+    // Audio settings do not own any other memory
+    free(self->audioSettings);
+    free(self);
+  }
+}
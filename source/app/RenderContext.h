@@ -0,0 +1,78 @@
+//
+// RenderContext.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_RenderContext_h
+#define MrsWatson_RenderContext_h
+
+#include "audio/AudioSettings.h"
+#include "plugin/PluginChain.h"
+#include "time/AudioClock.h"
+
+/**
+ * State which belongs to a single render job. Most of the code reaches the
+ * audio settings, audio clock and plugin chain through their global accessors,
+ * such as getSampleRate() or getAudioClock(). Those accessors return the
+ * members of the calling thread's current render context, and only fall back
+ * to the global instances when no context has been made current. This allows
+ * several jobs to be rendered at once on different threads, each with its own
+ * settings and plugin instances.
+ */
+typedef struct {
+  AudioSettings audioSettings;
+  AudioClock audioClock;
+  PluginChain pluginChain;
+} RenderContextMembers;
+typedef RenderContextMembers *RenderContext;
+
+/**
+ * Create a new render context. The audio settings are copied from the calling
+ * thread's current settings, and the clock and plugin chain start out empty.
+ * @return New render context
+ */
+RenderContext newRenderContext(void);
+
+/**
+ * Get the render context of the calling thread.
+ * @return Current render context, or NULL if the global instances are in use
+ */
+RenderContext getRenderContext(void);
+
+/**
+ * Make a render context current for the calling thread. This does not affect
+ * any other threads.
+ * @param self Render context, or NULL to use the global instances again
+ */
+void renderContextMakeCurrent(RenderContext self);
+
+/**
+ * Free a render context along with its settings, clock and plugin chain. The
+ * plugin chain should be shut down first. The context must not be current for
+ * any thread when it is freed.
+ * @param self
+ */
+void freeRenderContext(RenderContext self);
+
+#endif
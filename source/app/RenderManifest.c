@@ -0,0 +1,552 @@
+//
+// RenderManifest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "RenderManifest.h"
+
+#include "base/File.h"
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RENDER_MANIFEST_DEPENDENCY_SEPARATOR ','
+
+RenderManifest newRenderManifest(void) {
+  RenderManifest self = (RenderManifest)malloc(sizeof(RenderManifestMembers));
+  self->jobs = NULL;
+  self->numJobs = 0;
+  return self;
+}
+
+static RenderManifestJob _newRenderManifestJob(void) {
+  RenderManifestJob job =
+      (RenderManifestJob)malloc(sizeof(RenderManifestJobMembers));
+
+  job->name = NULL;
+  job->request = newRenderRequest();
+  job->dependencies = NULL;
+  job->numDependencies = 0;
+  job->cost = 1.0;
+  job->state = RENDER_MANIFEST_JOB_PENDING;
+  job->result = RETURN_CODE_NOT_RUN;
+  job->_dependencyNames = newLinkedList();
+  return job;
+}
+
+static void _freeRenderManifestJob(RenderManifestJob job) {
+  freeCharString(job->name);
+  freeRenderRequest(job->request);
+  free(job->dependencies);
+  freeLinkedListAndItems(job->_dependencyNames,
+                         (LinkedListFreeItemFunc)freeCharString);
+  free(job);
+}
+
+static void _renderManifestAddJob(RenderManifest self, RenderManifestJob job) {
+  self->jobs = (RenderManifestJob *)realloc(
+      self->jobs, sizeof(RenderManifestJob) * (self->numJobs + 1));
+  self->jobs[self->numJobs] = job;
+  self->numJobs++;
+}
+
+/**
+ * Handle one of the keys which only exist in manifests
+ * @return True if the key was a manifest key, in which case outResult is set
+ * to false if its value was invalid
+ */
+static boolByte _renderManifestSetField(RenderManifestJob job, const char *key,
+                                        const char *value,
+                                        boolByte *outResult) {
+  CharString dependencies;
+  char *end = NULL;
+
+  if (!strcmp(key, "name")) {
+    freeCharString(job->name);
+    job->name = newCharStringWithCString(value);
+  } else if (!strcmp(key, "after")) {
+    dependencies = newCharStringWithCString(value);
+    freeLinkedListAndItems(job->_dependencyNames,
+                           (LinkedListFreeItemFunc)freeCharString);
+    job->_dependencyNames =
+        charStringSplit(dependencies, RENDER_MANIFEST_DEPENDENCY_SEPARATOR);
+    freeCharString(dependencies);
+
+    if (job->_dependencyNames == NULL) {
+      job->_dependencyNames = newLinkedList();
+    }
+  } else if (!strcmp(key, "cost")) {
+    job->cost = strtod(value, &end);
+
+    if (end == value || *end != '\0' || job->cost < 0.0) {
+      logError("Invalid cost '%s' in manifest", value);
+      *outResult = false;
+    }
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+static boolByte _renderManifestParseLine(RenderManifest self,
+                                         const CharString line,
+                                         int lineNumber) {
+  RenderManifestJob job = _newRenderManifestJob();
+  CharString requestLine = newCharString();
+  LinkedList fields = charStringSplit(line, RENDER_REQUEST_FIELD_SEPARATOR);
+  LinkedListIterator iterator;
+  CharString field;
+  char *separator;
+  boolByte result = true;
+
+  // Fields which don't belong to the manifest are passed on to the request
+  for (iterator = linkedListBegin(fields); iterator != NULL && result;
+       iterator = linkedListIteratorNext(iterator)) {
+    field = (CharString)linkedListIteratorGetItem(iterator);
+    separator = strchr(field->data, RENDER_REQUEST_VALUE_SEPARATOR);
+
+    if (separator != NULL) {
+      *separator = '\0';
+
+      if (_renderManifestSetField(job, field->data, separator + 1, &result)) {
+        continue;
+      }
+
+      *separator = RENDER_REQUEST_VALUE_SEPARATOR;
+    }
+
+    if (!charStringIsEmpty(requestLine)) {
+      charStringAppendCString(requestLine, "\t");
+    }
+
+    charStringAppend(requestLine, field);
+  }
+
+  if (result && (!renderRequestParse(job->request, requestLine) ||
+                 job->request->shutdown)) {
+    result = false;
+  }
+
+  if (result) {
+    if (job->name == NULL) {
+      job->name = newCharString();
+      snprintf(job->name->data, job->name->capacity, "job%d", lineNumber);
+    }
+
+    _renderManifestAddJob(self, job);
+  } else {
+    logError("Line %d of the manifest is not a valid job", lineNumber);
+    _freeRenderManifestJob(job);
+  }
+
+  freeLinkedListAndItems(fields, (LinkedListFreeItemFunc)freeCharString);
+  freeCharString(requestLine);
+  return result;
+}
+
+boolByte renderManifestParseLines(RenderManifest self, const LinkedList lines) {
+  LinkedListIterator iterator;
+  CharString line;
+  int lineNumber = 0;
+
+  for (iterator = linkedListBegin(lines); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    line = (CharString)linkedListIteratorGetItem(iterator);
+    lineNumber++;
+
+    if (charStringIsEmpty(line) || line->data[0] == '#') {
+      continue;
+    }
+
+    if (!_renderManifestParseLine(self, line, lineNumber)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+boolByte renderManifestRead(RenderManifest self, const CharString filename) {
+  File manifestFile = newFileWithPath(filename);
+  LinkedList lines = NULL;
+  LinkedListIterator iterator;
+  CharString line;
+  char *carriageReturn;
+  boolByte result;
+
+  if (manifestFile == NULL || manifestFile->fileType != kFileTypeFile) {
+    logError("Manifest '%s' does not exist", filename->data);
+    freeFile(manifestFile);
+    return false;
+  }
+
+  lines = fileReadLines(manifestFile);
+  freeFile(manifestFile);
+
+  if (lines == NULL) {
+    return false;
+  }
+
+  // Tolerate files which were saved with DOS line endings
+  for (iterator = linkedListBegin(lines); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    line = (CharString)linkedListIteratorGetItem(iterator);
+    carriageReturn = strrchr(line->data, '\r');
+
+    if (carriageReturn != NULL) {
+      *carriageReturn = '\0';
+    }
+  }
+
+  result = renderManifestParseLines(self, lines) && renderManifestResolve(self);
+  freeLinkedListAndItems(lines, (LinkedListFreeItemFunc)freeCharString);
+
+  if (result && self->numJobs == 0) {
+    logError("Manifest '%s' does not contain any jobs", filename->data);
+    result = false;
+  }
+
+  return result;
+}
+
+static int _renderManifestFindJob(const RenderManifest self,
+                                  const CharString name) {
+  unsigned int i;
+
+  for (i = 0; i < self->numJobs; i++) {
+    if (charStringIsEqualTo(self->jobs[i]->name, name, false)) {
+      return (int)i;
+    }
+  }
+
+  return -1;
+}
+
+static void _renderManifestAddDependency(RenderManifestJob job,
+                                         unsigned int dependency) {
+  unsigned int i;
+
+  for (i = 0; i < job->numDependencies; i++) {
+    if (job->dependencies[i] == dependency) {
+      return;
+    }
+  }
+
+  job->dependencies[job->numDependencies] = dependency;
+  job->numDependencies++;
+}
+
+static boolByte _renderManifestResolveJob(RenderManifest self,
+                                          unsigned int index) {
+  RenderManifestJob job = self->jobs[index];
+  LinkedListIterator iterator;
+  CharString name;
+  int dependency;
+  unsigned int i;
+
+  free(job->dependencies);
+  job->dependencies = (unsigned int *)malloc(sizeof(unsigned int) *
+                                             self->numJobs);
+  job->numDependencies = 0;
+
+  for (iterator = linkedListBegin(job->_dependencyNames); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    name = (CharString)linkedListIteratorGetItem(iterator);
+    dependency = _renderManifestFindJob(self, name);
+
+    if (dependency < 0) {
+      logError("Job '%s' depends on unknown job '%s'", job->name->data,
+               name->data);
+      return false;
+    }
+
+    _renderManifestAddDependency(job, (unsigned int)dependency);
+  }
+
+  if (charStringIsEmpty(job->request->inputSource)) {
+    return true;
+  }
+
+  for (i = 0; i < self->numJobs; i++) {
+    if (charStringIsEqualTo(self->jobs[i]->request->outputSource,
+                            job->request->inputSource, false)) {
+      _renderManifestAddDependency(job, i);
+    }
+  }
+
+  return true;
+}
+
+boolByte renderManifestResolve(RenderManifest self) {
+  unsigned int *numWaitingFor;
+  unsigned int numOrdered = 0;
+  boolByte progress = true;
+  unsigned int i, j, k;
+
+  for (i = 0; i < self->numJobs; i++) {
+    for (j = i + 1; j < self->numJobs; j++) {
+      if (charStringIsEqualTo(self->jobs[i]->name, self->jobs[j]->name,
+                              false)) {
+        logError("Manifest contains two jobs named '%s'",
+                 self->jobs[i]->name->data);
+        return false;
+      } else if (charStringIsEqualTo(self->jobs[i]->request->outputSource,
+                                     self->jobs[j]->request->outputSource,
+                                     false)) {
+        logError("Jobs '%s' and '%s' write to the same output",
+                 self->jobs[i]->name->data, self->jobs[j]->name->data);
+        return false;
+      }
+    }
+  }
+
+  for (i = 0; i < self->numJobs; i++) {
+    if (!_renderManifestResolveJob(self, i)) {
+      return false;
+    }
+  }
+
+  // Repeatedly take out the jobs whose dependencies have all been taken out,
+  // whatever remains once that stops is part of a cycle
+  numWaitingFor = (unsigned int *)malloc(sizeof(unsigned int) * self->numJobs);
+
+  for (i = 0; i < self->numJobs; i++) {
+    numWaitingFor[i] = self->jobs[i]->numDependencies;
+  }
+
+  while (progress) {
+    progress = false;
+
+    for (i = 0; i < self->numJobs; i++) {
+      if (numWaitingFor[i] != 0) {
+        continue;
+      }
+
+      // Mark the job as taken out
+      numWaitingFor[i] = self->numJobs + 1;
+      numOrdered++;
+      progress = true;
+
+      for (j = 0; j < self->numJobs; j++) {
+        for (k = 0; k < self->jobs[j]->numDependencies; k++) {
+          if (self->jobs[j]->dependencies[k] == i) {
+            numWaitingFor[j]--;
+          }
+        }
+      }
+    }
+  }
+
+  if (numOrdered < self->numJobs) {
+    for (i = 0; i < self->numJobs; i++) {
+      if (numWaitingFor[i] <= self->numJobs) {
+        logError("Job '%s' is part of a dependency cycle",
+                 self->jobs[i]->name->data);
+        break;
+      }
+    }
+  }
+
+  free(numWaitingFor);
+  return (boolByte)(numOrdered == self->numJobs);
+}
+
+static boolByte _renderManifestIsReady(const RenderManifest self,
+                                       const RenderManifestJob job) {
+  unsigned int i;
+
+  for (i = 0; i < job->numDependencies; i++) {
+    if (self->jobs[job->dependencies[i]]->state != RENDER_MANIFEST_JOB_DONE) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static boolByte _renderManifestDependsOn(const RenderManifestJob job,
+                                         unsigned int dependency) {
+  unsigned int i;
+
+  for (i = 0; i < job->numDependencies; i++) {
+    if (job->dependencies[i] == dependency) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Rank a job for scheduling after a caller's previous job
+ * @return 2 for dependents of the previous job, 1 for jobs using the same
+ * plugin chain, otherwise 0
+ */
+static int _renderManifestGetAffinity(const RenderManifest self,
+                                      const RenderManifestJob job,
+                                      int previousJob) {
+  if (previousJob < 0) {
+    return 0;
+  } else if (_renderManifestDependsOn(job, (unsigned int)previousJob)) {
+    return 2;
+  } else if (charStringIsEqualTo(
+                 job->request->pluginChain,
+                 self->jobs[previousJob]->request->pluginChain, false)) {
+    return 1;
+  } else {
+    return 0;
+  }
+}
+
+int renderManifestNextJob(RenderManifest self, int previousJob) {
+  RenderManifestJob job;
+  int best = -1;
+  int bestAffinity = -1;
+  int affinity;
+  unsigned int i;
+
+  for (i = 0; i < self->numJobs; i++) {
+    job = self->jobs[i];
+
+    if (job->state != RENDER_MANIFEST_JOB_PENDING ||
+        !_renderManifestIsReady(self, job)) {
+      continue;
+    }
+
+    affinity = _renderManifestGetAffinity(self, job, previousJob);
+
+    if (affinity > bestAffinity ||
+        (affinity == bestAffinity && job->cost > self->jobs[best]->cost)) {
+      best = (int)i;
+      bestAffinity = affinity;
+    }
+  }
+
+  if (best >= 0) {
+    self->jobs[best]->state = RENDER_MANIFEST_JOB_RUNNING;
+  }
+
+  return best;
+}
+
+void renderManifestFinishJob(RenderManifest self, unsigned int index,
+                             ReturnCode result) {
+  RenderManifestJob job;
+  boolByte changed = true;
+  unsigned int i, j;
+
+  self->jobs[index]->result = result;
+  self->jobs[index]->state = result == RETURN_CODE_SUCCESS
+                                 ? RENDER_MANIFEST_JOB_DONE
+                                 : RENDER_MANIFEST_JOB_FAILED;
+
+  if (result == RETURN_CODE_SUCCESS) {
+    return;
+  }
+
+  // Skipping a job may in turn skip the jobs which depend on it
+  while (changed) {
+    changed = false;
+
+    for (i = 0; i < self->numJobs; i++) {
+      job = self->jobs[i];
+
+      if (job->state != RENDER_MANIFEST_JOB_PENDING) {
+        continue;
+      }
+
+      for (j = 0; j < job->numDependencies; j++) {
+        if (self->jobs[job->dependencies[j]]->state ==
+                RENDER_MANIFEST_JOB_FAILED ||
+            self->jobs[job->dependencies[j]]->state ==
+                RENDER_MANIFEST_JOB_SKIPPED) {
+          logWarn("Skipping job '%s', since job '%s' did not succeed",
+                  job->name->data,
+                  self->jobs[job->dependencies[j]]->name->data);
+          job->state = RENDER_MANIFEST_JOB_SKIPPED;
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+}
+
+boolByte renderManifestIsConsumed(const RenderManifest self,
+                                  unsigned int index) {
+  RenderManifestJob job;
+  unsigned int i;
+
+  if (self->jobs[index]->state == RENDER_MANIFEST_JOB_PENDING ||
+      self->jobs[index]->state == RENDER_MANIFEST_JOB_RUNNING) {
+    return false;
+  }
+
+  for (i = 0; i < self->numJobs; i++) {
+    job = self->jobs[i];
+
+    if ((job->state == RENDER_MANIFEST_JOB_PENDING ||
+         job->state == RENDER_MANIFEST_JOB_RUNNING) &&
+        _renderManifestDependsOn(job, index)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+boolByte renderManifestIsFinished(const RenderManifest self) {
+  return (boolByte)(
+      renderManifestCountJobs(self, RENDER_MANIFEST_JOB_PENDING) == 0 &&
+      renderManifestCountJobs(self, RENDER_MANIFEST_JOB_RUNNING) == 0);
+}
+
+unsigned int renderManifestCountJobs(const RenderManifest self,
+                                     RenderManifestJobState state) {
+  unsigned int result = 0;
+  unsigned int i;
+
+  for (i = 0; i < self->numJobs; i++) {
+    if (self->jobs[i]->state == state) {
+      result++;
+    }
+  }
+
+  return result;
+}
+
+void freeRenderManifest(RenderManifest self) {
+  unsigned int i;
+
+  if (self != NULL) {
+    for (i = 0; i < self->numJobs; i++) {
+      _freeRenderManifestJob(self->jobs[i]);
+    }
+
+    free(self->jobs);
+    free(self);
+  }
+}
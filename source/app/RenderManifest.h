@@ -0,0 +1,170 @@
+//
+// RenderManifest.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_RenderManifest_h
+#define MrsWatson_RenderManifest_h
+
+#include "app/RenderRequest.h"
+#include "app/ReturnCodes.h"
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+#include "base/Types.h"
+
+typedef enum {
+  RENDER_MANIFEST_JOB_PENDING,
+  RENDER_MANIFEST_JOB_RUNNING,
+  RENDER_MANIFEST_JOB_DONE,
+  RENDER_MANIFEST_JOB_FAILED,
+  // Not run because a job which it depends on failed
+  RENDER_MANIFEST_JOB_SKIPPED
+} RenderManifestJobState;
+
+typedef struct {
+  CharString name;
+  RenderRequest request;
+  // Indexes of the jobs which must be done before this one can start
+  unsigned int *dependencies;
+  unsigned int numDependencies;
+  // Relative cost of the job, expensive jobs are started first
+  double cost;
+  RenderManifestJobState state;
+  // Result of running the job, only set once it has finished
+  ReturnCode result;
+
+  // Private field, names from the "after" key until they are resolved
+  LinkedList _dependencyNames;
+} RenderManifestJobMembers;
+typedef RenderManifestJobMembers *RenderManifestJob;
+
+/**
+ * A list of render jobs which are run in one process, parsed from a manifest
+ * file. Each line of the manifest is a render request in the same format as
+ * for the server (see RenderRequest.h), with these additional keys:
+ *
+ * - name: Name of the job, which defaults to "job<line number>"
+ * - after: Comma-separated names of jobs which must finish first
+ * - cost: Relative cost of the job (default 1), used to start long jobs first
+ *
+ * A job whose input is the output of another job also depends on it, without
+ * needing to list it. Empty lines and lines starting with '#' are ignored.
+ *
+ * The manifest also keeps track of which jobs have been run, so that it can
+ * hand out the jobs which are ready in a sensible order. It is not thread
+ * safe, so callers running jobs on several threads must lock around it.
+ */
+typedef struct {
+  RenderManifestJob *jobs;
+  unsigned int numJobs;
+} RenderManifestMembers;
+typedef RenderManifestMembers *RenderManifest;
+
+/**
+ * Create a new manifest without any jobs
+ * @return New manifest
+ */
+RenderManifest newRenderManifest(void);
+
+/**
+ * Add jobs from the lines of a manifest. Dependencies are only resolved by
+ * renderManifestResolve(), so jobs may be listed in any order.
+ * @param self
+ * @param lines List of CharString lines
+ * @return True if all lines were valid jobs
+ */
+boolByte renderManifestParseLines(RenderManifest self, const LinkedList lines);
+
+/**
+ * Read and resolve the jobs of a manifest file
+ * @param self
+ * @param filename Path to the manifest
+ * @return True if the manifest was read and contains at least one job
+ */
+boolByte renderManifestRead(RenderManifest self, const CharString filename);
+
+/**
+ * Resolve the dependencies between jobs, and check that they can be run.
+ * This fails if a job depends on an unknown job, if two jobs have the same
+ * name or output, or if the dependencies form a cycle.
+ * @param self
+ * @return True if the jobs can be run
+ */
+boolByte renderManifestResolve(RenderManifest self);
+
+/**
+ * Claim the next job which is ready to run, and mark it as running. A job
+ * which depends on the previous job of the caller is preferred, so that
+ * dependent jobs run back-to-back while their input is still cached, followed
+ * by jobs with the same plugin chain, which reuse its instances. Otherwise the
+ * most expensive job is chosen, and then the first in the manifest.
+ * @param self
+ * @param previousJob Index of the caller's last job, or -1 if there was none
+ * @return Index of the job, or -1 if no job is ready at the moment
+ */
+int renderManifestNextJob(RenderManifest self, int previousJob);
+
+/**
+ * Mark a running job as finished. If it failed, then all jobs which depend on
+ * it, directly or not, are marked as skipped.
+ * @param self
+ * @param index Index of the job
+ * @param result RETURN_CODE_SUCCESS if the job succeeded, otherwise the error
+ */
+void renderManifestFinishJob(RenderManifest self, unsigned int index,
+                             ReturnCode result);
+
+/**
+ * Check if the output of a job is no longer needed by the manifest, which is
+ * the case once the job has finished and no job depending on it is still
+ * pending or running.
+ * @param self
+ * @param index Index of the job
+ * @return True if the output is not read by any other job anymore
+ */
+boolByte renderManifestIsConsumed(const RenderManifest self,
+                                  unsigned int index);
+
+/**
+ * Check if all jobs have finished, failed or were skipped
+ * @param self
+ * @return True if no job is pending or running
+ */
+boolByte renderManifestIsFinished(const RenderManifest self);
+
+/**
+ * Count the jobs in a given state
+ * @param self
+ * @param state State to look for
+ * @return Number of jobs
+ */
+unsigned int renderManifestCountJobs(const RenderManifest self,
+                                     RenderManifestJobState state);
+
+/**
+ * Free a manifest and all of its jobs
+ * @param self
+ */
+void freeRenderManifest(RenderManifest self);
+
+#endif
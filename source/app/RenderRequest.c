@@ -0,0 +1,266 @@
+//
+// RenderRequest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "RenderRequest.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *kRenderRequestShutdown = "shutdown";
+
+RenderRequest newRenderRequest(void) {
+  RenderRequest self = (RenderRequest)malloc(sizeof(RenderRequestMembers));
+
+  self->inputSource = newCharString();
+  self->outputSource = newCharString();
+  self->midiSource = newCharString();
+  self->pluginChain = newCharString();
+  self->parameters = newLinkedList();
+  self->sampleRate = 0.0;
+  self->blocksize = 0;
+  self->startFrame = 0;
+  self->numFrames = 0;
+  self->prerollFrames = 0;
+  self->shutdown = false;
+
+  return self;
+}
+
+static void _renderRequestClear(RenderRequest self) {
+  charStringClear(self->inputSource);
+  charStringClear(self->outputSource);
+  charStringClear(self->midiSource);
+  charStringClear(self->pluginChain);
+  freeLinkedListAndItems(self->parameters, free);
+  self->parameters = newLinkedList();
+  self->sampleRate = 0.0;
+  self->blocksize = 0;
+  self->startFrame = 0;
+  self->numFrames = 0;
+  self->prerollFrames = 0;
+  self->shutdown = false;
+}
+
+// Paths and chain strings may be longer than the default string capacity, so
+// the string is replaced rather than copied into
+static void _renderRequestSetString(CharString *field, const char *value) {
+  freeCharString(*field);
+  *field = newCharStringWithCString(value);
+}
+
+static boolByte _renderRequestParseFrames(const char *key, const char *value,
+                                          unsigned long *outFrames) {
+  char *end = NULL;
+
+  // strtoul() would silently accept a negative number
+  *outFrames = strtoul(value, &end, 10);
+
+  if (end == value || *end != '\0' || value[0] == '-') {
+    logError("Invalid %s '%s' in request", key, value);
+    return false;
+  }
+
+  return true;
+}
+
+static boolByte _renderRequestSetField(RenderRequest self, const char *key,
+                                       const char *value) {
+  char *parameter;
+  char *end = NULL;
+
+  if (!strcmp(key, "input")) {
+    _renderRequestSetString(&(self->inputSource), value);
+  } else if (!strcmp(key, "output")) {
+    _renderRequestSetString(&(self->outputSource), value);
+  } else if (!strcmp(key, "midi")) {
+    _renderRequestSetString(&(self->midiSource), value);
+  } else if (!strcmp(key, "plugin")) {
+    _renderRequestSetString(&(self->pluginChain), value);
+  } else if (!strcmp(key, "parameter")) {
+    // The plugin chain expects C strings, the same as from the command line
+    parameter = (char *)malloc(strlen(value) + 1);
+    strcpy(parameter, value);
+    linkedListAppend(self->parameters, parameter);
+  } else if (!strcmp(key, "sample-rate")) {
+    self->sampleRate = strtod(value, &end);
+
+    if (end == value || *end != '\0' || self->sampleRate <= 0.0) {
+      logError("Invalid sample rate '%s' in request", value);
+      return false;
+    }
+  } else if (!strcmp(key, "blocksize")) {
+    self->blocksize = strtoul(value, &end, 10);
+
+    if (end == value || *end != '\0' || self->blocksize == 0) {
+      logError("Invalid blocksize '%s' in request", value);
+      return false;
+    }
+  } else if (!strcmp(key, "start")) {
+    return _renderRequestParseFrames(key, value, &(self->startFrame));
+  } else if (!strcmp(key, "length")) {
+    return _renderRequestParseFrames(key, value, &(self->numFrames));
+  } else if (!strcmp(key, "preroll")) {
+    return _renderRequestParseFrames(key, value, &(self->prerollFrames));
+  } else {
+    logError("Unknown field '%s' in request", key);
+    return false;
+  }
+
+  return true;
+}
+
+boolByte renderRequestParse(RenderRequest self, const CharString line) {
+  LinkedList fields;
+  LinkedListIterator iterator;
+  CharString field;
+  char *separator;
+  boolByte result = true;
+
+  _renderRequestClear(self);
+
+  if (line == NULL || charStringIsEmpty(line)) {
+    logError("Empty request");
+    return false;
+  } else if (charStringIsEqualToCString(line, kRenderRequestShutdown, false)) {
+    self->shutdown = true;
+    return true;
+  }
+
+  fields = charStringSplit(line, RENDER_REQUEST_FIELD_SEPARATOR);
+
+  for (iterator = fields; iterator != NULL && result;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    field = (CharString)iterator->item;
+
+    if (field == NULL) {
+      continue;
+    }
+
+    separator = strchr(field->data, RENDER_REQUEST_VALUE_SEPARATOR);
+
+    if (separator == NULL) {
+      logError("Request field '%s' should be in the form key=value",
+               field->data);
+      result = false;
+    } else {
+      *separator = '\0';
+      result = _renderRequestSetField(self, field->data, separator + 1);
+    }
+  }
+
+  freeLinkedListAndItems(fields, (LinkedListFreeItemFunc)freeCharString);
+
+  if (result && charStringIsEmpty(self->outputSource)) {
+    logError("Request does not contain an output");
+    result = false;
+  } else if (result && charStringIsEmpty(self->pluginChain)) {
+    logError("Request does not contain a plugin chain");
+    result = false;
+  }
+
+  return result;
+}
+
+static void _renderRequestAppendField(CharString line, const char *key,
+                                      const char *value) {
+  if (!charStringIsEmpty(line)) {
+    charStringAppendCString(line, "\t");
+  }
+
+  charStringAppendCString(line, key);
+  charStringAppendCString(line, "=");
+  charStringAppendCString(line, value);
+}
+
+static void _renderRequestAppendFrames(CharString line, const char *key,
+                                       unsigned long frames) {
+  char value[32];
+
+  if (frames > 0) {
+    snprintf(value, sizeof(value), "%lu", frames);
+    _renderRequestAppendField(line, key, value);
+  }
+}
+
+CharString renderRequestFormat(const RenderRequest self) {
+  CharString result;
+  LinkedListIterator iterator;
+  char value[32];
+
+  if (self->shutdown) {
+    return newCharStringWithCString(kRenderRequestShutdown);
+  }
+
+  // Appending grows the string as needed for long paths and chain strings
+  result = newCharString();
+
+  if (!charStringIsEmpty(self->inputSource)) {
+    _renderRequestAppendField(result, "input", self->inputSource->data);
+  }
+
+  _renderRequestAppendField(result, "output", self->outputSource->data);
+
+  if (!charStringIsEmpty(self->midiSource)) {
+    _renderRequestAppendField(result, "midi", self->midiSource->data);
+  }
+
+  _renderRequestAppendField(result, "plugin", self->pluginChain->data);
+
+  for (iterator = linkedListBegin(self->parameters); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    _renderRequestAppendField(result, "parameter",
+                              (char *)linkedListIteratorGetItem(iterator));
+  }
+
+  if (self->sampleRate > 0.0) {
+    snprintf(value, sizeof(value), "%g", self->sampleRate);
+    _renderRequestAppendField(result, "sample-rate", value);
+  }
+
+  if (self->blocksize > 0) {
+    snprintf(value, sizeof(value), "%lu", (unsigned long)self->blocksize);
+    _renderRequestAppendField(result, "blocksize", value);
+  }
+
+  _renderRequestAppendFrames(result, "start", self->startFrame);
+  _renderRequestAppendFrames(result, "length", self->numFrames);
+  _renderRequestAppendFrames(result, "preroll", self->prerollFrames);
+  return result;
+}
+
+void freeRenderRequest(RenderRequest self) {
+  if (self != NULL) {
+    freeCharString(self->inputSource);
+    freeCharString(self->outputSource);
+    freeCharString(self->midiSource);
+    freeCharString(self->pluginChain);
+    freeLinkedListAndItems(self->parameters, free);
+    free(self);
+  }
+}
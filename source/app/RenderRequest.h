@@ -0,0 +1,100 @@
+//
+// RenderRequest.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_RenderRequest_h
+#define MrsWatson_RenderRequest_h
+
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+#include "base/Types.h"
+
+#define RENDER_REQUEST_FIELD_SEPARATOR '\t'
+#define RENDER_REQUEST_VALUE_SEPARATOR '='
+
+/**
+ * A single job which is sent to MrsWatson when running in server mode. Each
+ * request is one line of tab-separated key=value fields, for example:
+ *
+ * input=in.wav<TAB>output=out.wav<TAB>plugin=mrs_gain<TAB>parameter=0,0.5
+ *
+ * The keys "input", "output", "midi", "plugin", "sample-rate" and "blocksize"
+ * correspond to the command line options of the same name, and "parameter"
+ * may be given several times. The keys "start", "length" and "preroll" render
+ * only a segment of the input, see RenderSegment.h. A line containing only
+ * "shutdown" stops the server.
+ */
+typedef struct {
+  CharString inputSource;
+  CharString outputSource;
+  CharString midiSource;
+  CharString pluginChain;
+  /** List of C string parameters in the same format as --parameter */
+  LinkedList parameters;
+  /** Requested sample rate, or 0 to use the server's default */
+  SampleRate sampleRate;
+  /** Requested blocksize, or 0 to use the server's default */
+  SampleCount blocksize;
+  /** First input frame to render, 0 to start at the beginning */
+  unsigned long startFrame;
+  /** Number of input frames to render, or 0 to render until the end */
+  unsigned long numFrames;
+  /** Frames before startFrame which are processed but not written */
+  unsigned long prerollFrames;
+  boolByte shutdown;
+} RenderRequestMembers;
+typedef RenderRequestMembers *RenderRequest;
+
+/**
+ * Create a new empty render request
+ * @return New request
+ */
+RenderRequest newRenderRequest(void);
+
+/**
+ * Parse a request line. Any values from a previously parsed line are cleared
+ * first. A request must contain at least an output and a plugin chain,
+ * unless it is a shutdown request.
+ * @param self
+ * @param line Request line, without the trailing newline
+ * @return True if the line was a valid request
+ */
+boolByte renderRequestParse(RenderRequest self, const CharString line);
+
+/**
+ * Format a request as a line which can be sent to a server, the reverse of
+ * renderRequestParse(). Fields which are empty or 0 are left out.
+ * @param self
+ * @return New string with the request line, without a trailing newline
+ */
+CharString renderRequestFormat(const RenderRequest self);
+
+/**
+ * Free a render request and all of its values
+ * @param self
+ */
+void freeRenderRequest(RenderRequest self);
+
+#endif
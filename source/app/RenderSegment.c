@@ -0,0 +1,75 @@
+//
+// RenderSegment.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "RenderSegment.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+RenderSegment newRenderSegments(unsigned long inputLengthInFrames,
+                                unsigned int numSegments, SampleCount blocksize,
+                                unsigned long prerollFrames,
+                                unsigned int *outNumSegments) {
+  const unsigned long block = blocksize > 0 ? (unsigned long)blocksize : 1;
+  unsigned long minSegmentLength =
+      prerollFrames > block ? prerollFrames : block;
+  unsigned long segmentLength;
+  RenderSegment result;
+  unsigned int i;
+
+  if (numSegments == 0 || inputLengthInFrames == 0) {
+    numSegments = 1;
+  } else if (inputLengthInFrames / minSegmentLength < numSegments) {
+    numSegments = (unsigned int)(inputLengthInFrames / minSegmentLength);
+
+    if (numSegments == 0) {
+      numSegments = 1;
+    }
+  }
+
+  segmentLength = (inputLengthInFrames / numSegments / block) * block;
+  result = (RenderSegment)malloc(sizeof(RenderSegmentMembers) * numSegments);
+
+  for (i = 0; i < numSegments; i++) {
+    result[i].startFrame = i * segmentLength;
+    // The last segment also picks up any remainder from rounding
+    result[i].numFrames = i + 1 < numSegments ? segmentLength : 0;
+    result[i].prerollFrames = prerollFrames < result[i].startFrame
+                                  ? prerollFrames
+                                  : result[i].startFrame;
+  }
+
+  *outNumSegments = numSegments;
+  return result;
+}
+
+void renderSegmentGetFilename(const CharString outputName, unsigned int index,
+                              CharString outFilename) {
+  snprintf(outFilename->data, outFilename->capacity, "%s.segment%03u.wav",
+           outputName->data, index);
+}
+
+void freeRenderSegments(RenderSegment self) { free(self); }
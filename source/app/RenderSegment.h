@@ -0,0 +1,91 @@
+//
+// RenderSegment.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_RenderSegment_h
+#define MrsWatson_RenderSegment_h
+
+#include "base/CharString.h"
+#include "base/Types.h"
+
+/**
+ * A part of a long input which is rendered separately from the rest, possibly
+ * on another machine. Since the plugins start with empty state, each segment
+ * begins with a preroll: input before the segment which is sent through the
+ * chain to fill its delay lines and envelopes, but cut from the output. For
+ * effects whose memory is shorter than the preroll, the rendered segments can
+ * then be joined end to end without any audible seams.
+ */
+typedef struct {
+  /** First input frame which is written to the output */
+  unsigned long startFrame;
+  /** Number of frames to render, or 0 for the last segment, which runs until
+   * the end of the input */
+  unsigned long numFrames;
+  /** Frames before startFrame which are processed but not written */
+  unsigned long prerollFrames;
+} RenderSegmentMembers;
+typedef RenderSegmentMembers *RenderSegment;
+
+/**
+ * Split an input into segments of about the same length. Segments start on
+ * block boundaries, so that the first segment sees the same blocks as an
+ * unsegmented render. Fewer segments than requested are made if they would be
+ * shorter than the preroll, since then more time is spent priming the plugins
+ * than rendering.
+ *
+ * @param inputLengthInFrames Length of the input, or 0 if it is not known, in
+ * which case the whole input is a single segment
+ * @param numSegments Requested number of segments
+ * @param blocksize Processing blocksize
+ * @param prerollFrames Preroll before each segment. The first segment has no
+ * preroll, and others only get as much as there is input before them.
+ * @param outNumSegments Set to the number of segments
+ * @return Array of segments, which must be freed with freeRenderSegments()
+ */
+RenderSegment newRenderSegments(unsigned long inputLengthInFrames,
+                                unsigned int numSegments, SampleCount blocksize,
+                                unsigned long prerollFrames,
+                                unsigned int *outNumSegments);
+
+/**
+ * Get the name of the file which a segment of an output is rendered to. The
+ * file is a WAVE file next to the output, so that it is on the same storage
+ * as the final output.
+ *
+ * @param outputName Name of the final output
+ * @param index Index of the segment
+ * @param outFilename Set to the name of the segment file
+ */
+void renderSegmentGetFilename(const CharString outputName, unsigned int index,
+                              CharString outFilename);
+
+/**
+ * Free an array of segments
+ * @param self Array returned by newRenderSegments(), may be NULL
+ */
+void freeRenderSegments(RenderSegment self);
+
+#endif
@@ -0,0 +1,196 @@
+//
+// RenderSession.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "RenderSession.h"
+
+#include "logging/EventLogger.h"
+#include "time/AudioClock.h"
+
+#include <stdlib.h>
+
+void initRenderSessions(void) {
+  initEventLogger();
+  initAudioSettings();
+  initAudioClock();
+  initPluginChain();
+}
+
+RenderSession newRenderSession(SampleRate sampleRate, ChannelCount numChannels,
+                               SampleCount blocksize) {
+  const RenderContext previousContext = getRenderContext();
+  RenderSession self;
+
+  self = (RenderSession)malloc(sizeof(RenderSessionMembers));
+  self->renderContext = newRenderContext();
+  self->started = false;
+
+  renderContextMakeCurrent(self->renderContext);
+
+  if (!setSampleRate(sampleRate) || !setNumChannels(numChannels) ||
+      !setBlocksize(blocksize)) {
+    renderContextMakeCurrent(previousContext);
+    freeRenderContext(self->renderContext);
+    free(self);
+    return NULL;
+  }
+
+  renderContextMakeCurrent(previousContext);
+  return self;
+}
+
+ReturnCode renderSessionAddPlugins(RenderSession self,
+                                   const CharString pluginChainString,
+                                   const CharString pluginSearchRoot) {
+  const RenderContext previousContext = getRenderContext();
+  PluginChain pluginChain = self->renderContext->pluginChain;
+  const unsigned int numPlugins = pluginChain->numPlugins;
+  ReturnCode result = RETURN_CODE_SUCCESS;
+
+  if (self->started) {
+    logError("Plugins cannot be added after the render session was started");
+    return RETURN_CODE_INVALID_PLUGIN_CHAIN;
+  }
+
+  renderContextMakeCurrent(self->renderContext);
+
+  // Plugins which are not found are skipped without failing
+  if (!pluginChainAddFromArgumentString(pluginChain, pluginChainString,
+                                        pluginSearchRoot) ||
+      pluginChain->numPlugins == numPlugins) {
+    logError("Could not add plugins '%s' to render session",
+             pluginChainString->data);
+    result = RETURN_CODE_INVALID_PLUGIN_CHAIN;
+  }
+
+  renderContextMakeCurrent(previousContext);
+  return result;
+}
+
+ReturnCode renderSessionStart(RenderSession self) {
+  const RenderContext previousContext = getRenderContext();
+  PluginChain pluginChain = self->renderContext->pluginChain;
+  ReturnCode result;
+
+  if (self->started) {
+    return RETURN_CODE_SUCCESS;
+  } else if (pluginChain->numPlugins == 0) {
+    logError("Render session has no plugins");
+    return RETURN_CODE_INVALID_PLUGIN_CHAIN;
+  }
+
+  renderContextMakeCurrent(self->renderContext);
+  result = pluginChainInitialize(pluginChain);
+
+  if (result == RETURN_CODE_SUCCESS) {
+    pluginChainPrepareForProcessing(pluginChain);
+    self->started = true;
+  }
+
+  renderContextMakeCurrent(previousContext);
+  return result;
+}
+
+boolByte renderSessionSetParameter(RenderSession self,
+                                   unsigned int pluginIndex,
+                                   unsigned int parameterIndex, float value) {
+  const RenderContext previousContext = getRenderContext();
+  boolByte result;
+
+  renderContextMakeCurrent(self->renderContext);
+  result = pluginChainSetParameter(self->renderContext->pluginChain,
+                                   pluginIndex, parameterIndex, value);
+  renderContextMakeCurrent(previousContext);
+  return result;
+}
+
+void renderSessionProcessMidi(RenderSession self, LinkedList midiEvents) {
+  const RenderContext previousContext = getRenderContext();
+
+  renderContextMakeCurrent(self->renderContext);
+  pluginChainProcessMidi(self->renderContext->pluginChain, midiEvents);
+  renderContextMakeCurrent(previousContext);
+}
+
+boolByte renderSessionProcess(RenderSession self, const SampleBuffer input,
+                              SampleBuffer output) {
+  const AudioSettings audioSettings = self->renderContext->audioSettings;
+  const RenderContext previousContext = getRenderContext();
+
+  if (!self->started) {
+    logError("Render session must be started before processing");
+    return false;
+  } else if (input->numChannels != audioSettings->numChannels ||
+             output->numChannels != audioSettings->numChannels ||
+             input->blocksize > audioSettings->blocksize ||
+             output->blocksize < input->blocksize) {
+    logError("Sample buffers do not match the settings of the render session");
+    return false;
+  }
+
+  renderContextMakeCurrent(self->renderContext);
+  output->blocksize = input->blocksize;
+  pluginChainProcessAudio(self->renderContext->pluginChain, input, output);
+  advanceAudioClock(self->renderContext->audioClock, input->blocksize);
+  renderContextMakeCurrent(previousContext);
+  return true;
+}
+
+unsigned long renderSessionGetLatency(RenderSession self) {
+  const RenderContext previousContext = getRenderContext();
+  unsigned long result;
+
+  renderContextMakeCurrent(self->renderContext);
+  result = pluginChainGetProcessingDelay(self->renderContext->pluginChain);
+  renderContextMakeCurrent(previousContext);
+  return result;
+}
+
+void renderSessionReset(RenderSession self) {
+  const RenderContext previousContext = getRenderContext();
+
+  if (!self->started) {
+    return;
+  }
+
+  renderContextMakeCurrent(self->renderContext);
+  pluginChainReset(self->renderContext->pluginChain);
+  audioClockReset(self->renderContext->audioClock);
+  renderContextMakeCurrent(previousContext);
+}
+
+void freeRenderSession(RenderSession self) {
+  RenderContext previousContext;
+
+  if (self == NULL) {
+    return;
+  }
+
+  previousContext = getRenderContext();
+  renderContextMakeCurrent(self->renderContext);
+  pluginChainShutdown(self->renderContext->pluginChain);
+  renderContextMakeCurrent(previousContext);
+  freeRenderContext(self->renderContext);
+  free(self);
+}
@@ -0,0 +1,142 @@
+//
+// RenderSession.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_RenderSession_h
+#define MrsWatson_RenderSession_h
+
+#include "app/RenderContext.h"
+#include "app/ReturnCodes.h"
+#include "audio/SampleBuffer.h"
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+
+/**
+ * A render session processes audio block by block through a plugin chain,
+ * for programs which link against the MrsWatson core library rather than
+ * running the command line tool. Each session has its own render context, so
+ * several sessions may be used at once on different threads. All functions of
+ * one session must be called from the same thread at a time.
+ */
+typedef struct {
+  RenderContext renderContext;
+  boolByte started;
+} RenderSessionMembers;
+typedef RenderSessionMembers *RenderSession;
+
+/**
+ * Initialize the global state which render sessions depend on, such as the
+ * event logger. This must be called once by the host program before the first
+ * session is created, and is not needed when running mrsWatsonMain().
+ */
+void initRenderSessions(void);
+
+/**
+ * Create a new render session with an empty plugin chain
+ * @param sampleRate Sample rate
+ * @param numChannels Number of channels of the input and output
+ * @param blocksize Largest number of frames which are processed at once
+ * @return New render session, or NULL if the settings are invalid
+ */
+RenderSession newRenderSession(SampleRate sampleRate, ChannelCount numChannels,
+                               SampleCount blocksize);
+
+/**
+ * Add plugins to the chain of a session, which must not be started yet. The
+ * plugins are given in the same format as the --plugin option.
+ * @param self
+ * @param pluginChainString Comma-separated list of plugins to add
+ * @param pluginSearchRoot Additional directory to search for plugins, or NULL
+ * @return RETURN_CODE_SUCCESS, or RETURN_CODE_INVALID_PLUGIN_CHAIN if any of
+ * the plugins could not be loaded
+ */
+ReturnCode renderSessionAddPlugins(RenderSession self,
+                                   const CharString pluginChainString,
+                                   const CharString pluginSearchRoot);
+
+/**
+ * Initialize the plugin chain of a session and prepare it for processing.
+ * Must be called after all plugins have been added.
+ * @param self
+ * @return RETURN_CODE_SUCCESS, or an error code if a plugin failed
+ */
+ReturnCode renderSessionStart(RenderSession self);
+
+/**
+ * Set a parameter of a plugin. This may be called before or after the session
+ * has been started, including between blocks.
+ * @param self
+ * @param pluginIndex Index of the plugin in the chain
+ * @param parameterIndex Index of the parameter
+ * @param value New value, normally between 0 and 1
+ * @return True if the parameter was set
+ */
+boolByte renderSessionSetParameter(RenderSession self,
+                                   unsigned int pluginIndex,
+                                   unsigned int parameterIndex, float value);
+
+/**
+ * Send MIDI events to the plugin chain, which are processed together with the
+ * next block of audio.
+ * @param self
+ * @param midiEvents List of MidiEvent items with offsets within the next block
+ */
+void renderSessionProcessMidi(RenderSession self, LinkedList midiEvents);
+
+/**
+ * Process a block of audio. Both buffers must have the channel count of the
+ * session, and may have any blocksize up to the blocksize of the session.
+ * @param self
+ * @param input Block to process, which is not modified
+ * @param output Buffer which receives the processed block. Its blocksize is set
+ * to the blocksize of the input.
+ * @return True if the block was processed, false if the session has not been
+ * started or the buffers do not match its settings
+ */
+boolByte renderSessionProcess(RenderSession self, const SampleBuffer input,
+                              SampleBuffer output);
+
+/**
+ * Get the number of frames by which the output of a session lags behind its
+ * input. The first this many output frames should be discarded.
+ * @param self
+ * @return Processing delay in frames
+ */
+unsigned long renderSessionGetLatency(RenderSession self);
+
+/**
+ * Clear the processing state of all plugins, such as reverb tails, so that the
+ * session can be used for another input without reloading its plugins.
+ * Parameters and presets are kept.
+ * @param self
+ */
+void renderSessionReset(RenderSession self);
+
+/**
+ * Shut down the plugins of a session and free it
+ * @param self
+ */
+void freeRenderSession(RenderSession self);
+
+#endif
@@ -91,6 +91,18 @@ typedef enum {
    */
   RETURN_CODE_INTERNAL_ERROR,
 
+  /**
+   * Processing finished, but the real-time audit detected calls which are not
+   * safe to make on the processing thread.
+   */
+  RETURN_CODE_REALTIME_VIOLATION,
+
+  /**
+   * Processing finished, but the output is different from the earlier render
+   * which it was compared with by --compare-hashes.
+   */
+  RETURN_CODE_OUTPUT_MISMATCH,
+
   /**
    * A signal was caught, forcing termination.
    *
@@ -0,0 +1,322 @@
+//
+// SamplingProfiler.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SamplingProfiler.h"
+
+#include "base/Thread.h"
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if UNIX
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+// Interval of CPU time between two samples
+static const long kSamplingProfilerIntervalInMicroseconds = 1000;
+
+// Names of the frames below the plugin in the collapsed stacks
+static const char
+    *kSamplingProfilerFrameNames[NUM_SAMPLING_PROFILER_FRAMES] = {
+        "MrsWatson",
+        "PluginChain",
+        "processAudio",
+        "processMidi",
+        "processAudio;hostCallback",
+        "processMidi;hostCallback"};
+
+typedef struct {
+  char name[SAMPLING_PROFILER_OWNER_NAME_LENGTH];
+  volatile unsigned int numSamples[NUM_SAMPLING_PROFILER_FRAMES];
+} _SamplingProfilerOwnerMembers;
+
+// The first owner is always the host, and plugins are added after it as they
+// are entered. New owners are added under _samplingProfilerLock, but the
+// sample counts are updated by the signal handler without taking the lock.
+static _SamplingProfilerOwnerMembers
+    _samplingProfilerOwners[SAMPLING_PROFILER_MAX_OWNERS];
+static unsigned int _samplingProfilerNumOwners = 1;
+static volatile unsigned int _samplingProfilerLock = 0;
+static volatile unsigned int _samplingProfilerRunning = 0;
+
+// Read by the signal handler, which runs on whichever thread was interrupted
+static THREAD_LOCAL volatile unsigned int _samplingProfilerOwner = 0;
+static THREAD_LOCAL volatile unsigned int _samplingProfilerFrame =
+    SAMPLING_PROFILER_FRAME_HOST;
+
+#if UNIX
+static struct sigaction _samplingProfilerPreviousAction;
+
+static void _samplingProfilerHandleSignal(int signalNumber) {
+  (void)signalNumber;
+  atomicAdd(&(_samplingProfilerOwners[_samplingProfilerOwner]
+                  .numSamples[_samplingProfilerFrame]),
+            1);
+}
+#endif
+
+boolByte samplingProfilerIsSupported(void) {
+#if UNIX
+  return true;
+#else
+  return false;
+#endif
+}
+
+static void _samplingProfilerLockOwners(void) {
+  // A spin lock, since this is called for each plugin in every block
+  while (!atomicCompareAndSwap(&_samplingProfilerLock, 0, 1)) {
+  }
+}
+
+static void _samplingProfilerUnlockOwners(void) {
+  atomicStore(&_samplingProfilerLock, 0);
+}
+
+boolByte samplingProfilerStart(void) {
+#if UNIX
+  struct sigaction action;
+  struct itimerval timer;
+
+  _samplingProfilerLockOwners();
+  memset(_samplingProfilerOwners, 0, sizeof(_samplingProfilerOwners));
+  _samplingProfilerNumOwners = 1;
+  _samplingProfilerUnlockOwners();
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = _samplingProfilerHandleSignal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+
+  if (sigaction(SIGPROF, &action, &_samplingProfilerPreviousAction) != 0) {
+    logError("Could not install the signal handler for the sampling profiler");
+    return false;
+  }
+
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = kSamplingProfilerIntervalInMicroseconds;
+  timer.it_value = timer.it_interval;
+
+  if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+    logError("Could not start the timer for the sampling profiler");
+    sigaction(SIGPROF, &_samplingProfilerPreviousAction, NULL);
+    return false;
+  }
+
+  atomicStore(&_samplingProfilerRunning, 1);
+  return true;
+#else
+  logUnsupportedFeature("Sampling profiler on this platform");
+  return false;
+#endif
+}
+
+void samplingProfilerStop(void) {
+#if UNIX
+  struct itimerval timer;
+
+  if (atomicLoad(&_samplingProfilerRunning) == 0) {
+    return;
+  }
+
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+  sigaction(SIGPROF, &_samplingProfilerPreviousAction, NULL);
+  atomicStore(&_samplingProfilerRunning, 0);
+#endif
+}
+
+SamplingProfilerFrame samplingProfilerSetFrame(SamplingProfilerFrame frame) {
+  const SamplingProfilerFrame previousFrame =
+      (SamplingProfilerFrame)_samplingProfilerFrame;
+  _samplingProfilerFrame = frame;
+  return previousFrame;
+}
+
+static unsigned int _samplingProfilerFindOwner(const char *name) {
+  unsigned int i;
+
+  for (i = 1; i < _samplingProfilerNumOwners; i++) {
+    if (strncmp(_samplingProfilerOwners[i].name, name,
+                SAMPLING_PROFILER_OWNER_NAME_LENGTH - 1) == 0) {
+      return i;
+    }
+  }
+
+  return 0;
+}
+
+static unsigned int _samplingProfilerAddOwner(const char *name) {
+  unsigned int owner;
+
+  if (_samplingProfilerNumOwners == SAMPLING_PROFILER_MAX_OWNERS) {
+    return SAMPLING_PROFILER_MAX_OWNERS - 1;
+  }
+
+  owner = _samplingProfilerNumOwners++;
+  strncpy(_samplingProfilerOwners[owner].name, name,
+          SAMPLING_PROFILER_OWNER_NAME_LENGTH - 1);
+  _samplingProfilerOwners[owner].name[SAMPLING_PROFILER_OWNER_NAME_LENGTH - 1] =
+      '\0';
+  return owner;
+}
+
+void samplingProfilerEnterPlugin(const char *pluginName,
+                                 SamplingProfilerFrame frame) {
+  unsigned int owner = 0;
+
+  // Plugins are only looked up while sampling, so this costs nothing
+  // otherwise
+  if (atomicLoad(&_samplingProfilerRunning) != 0 && pluginName != NULL) {
+    _samplingProfilerLockOwners();
+    owner = _samplingProfilerFindOwner(pluginName);
+
+    if (owner == 0) {
+      owner = _samplingProfilerAddOwner(pluginName);
+    }
+
+    _samplingProfilerUnlockOwners();
+  }
+
+  // The owner is set first, so that a sample which arrives in between is
+  // still counted for the plugin chain
+  _samplingProfilerOwner = owner;
+  _samplingProfilerFrame = frame;
+}
+
+void samplingProfilerExitPlugin(void) {
+  _samplingProfilerFrame = SAMPLING_PROFILER_FRAME_PLUGIN_CHAIN;
+  _samplingProfilerOwner = 0;
+}
+
+SamplingProfilerFrame samplingProfilerEnterHostCallback(void) {
+  const SamplingProfilerFrame previousFrame =
+      (SamplingProfilerFrame)_samplingProfilerFrame;
+
+  if (previousFrame == SAMPLING_PROFILER_FRAME_PROCESS_AUDIO) {
+    _samplingProfilerFrame = SAMPLING_PROFILER_FRAME_AUDIO_HOST_CALLBACK;
+  } else if (previousFrame == SAMPLING_PROFILER_FRAME_PROCESS_MIDI) {
+    _samplingProfilerFrame = SAMPLING_PROFILER_FRAME_MIDI_HOST_CALLBACK;
+  }
+
+  return previousFrame;
+}
+
+unsigned long samplingProfilerGetNumSamples(void) {
+  unsigned long result = 0;
+  unsigned int i;
+  int frame;
+
+  _samplingProfilerLockOwners();
+
+  for (i = 0; i < _samplingProfilerNumOwners; i++) {
+    for (frame = 0; frame < NUM_SAMPLING_PROFILER_FRAMES; frame++) {
+      result += atomicLoad(&(_samplingProfilerOwners[i].numSamples[frame]));
+    }
+  }
+
+  _samplingProfilerUnlockOwners();
+  return result;
+}
+
+unsigned long
+samplingProfilerGetNumSamplesForOwner(const char *ownerName,
+                                      SamplingProfilerFrame frame) {
+  unsigned long result = 0;
+  unsigned int owner = 0;
+
+  _samplingProfilerLockOwners();
+
+  if (ownerName != NULL) {
+    owner = _samplingProfilerFindOwner(ownerName);
+  }
+
+  if (ownerName == NULL || owner > 0) {
+    result = atomicLoad(&(_samplingProfilerOwners[owner].numSamples[frame]));
+  }
+
+  _samplingProfilerUnlockOwners();
+  return result;
+}
+
+// Write a plugin name as one frame of a collapsed stack, where semicolons would
+// otherwise start a new frame
+static void _samplingProfilerWriteFrameName(FILE *file, const char *name) {
+  const char *c;
+
+  for (c = name; *c != '\0'; c++) {
+    fputc(*c == ';' ? '_' : *c, file);
+  }
+}
+
+boolByte samplingProfilerWriteCollapsedStacks(const CharString filename) {
+  FILE *file = fopen(filename->data, "w");
+  _SamplingProfilerOwnerMembers *owner;
+  unsigned int numSamples;
+  unsigned int i;
+  int frame;
+
+  if (file == NULL) {
+    logError("Could not open '%s' to write sampling profile", filename->data);
+    return false;
+  }
+
+  _samplingProfilerLockOwners();
+
+  for (i = 0; i < _samplingProfilerNumOwners; i++) {
+    owner = &(_samplingProfilerOwners[i]);
+
+    for (frame = 0; frame < NUM_SAMPLING_PROFILER_FRAMES; frame++) {
+      numSamples = atomicLoad(&(owner->numSamples[frame]));
+
+      if (numSamples == 0) {
+        continue;
+      }
+
+      // Every stack starts with the host, and plugins are below the chain
+      fprintf(file, "%s", kSamplingProfilerFrameNames[0]);
+
+      if (frame != SAMPLING_PROFILER_FRAME_HOST) {
+        fprintf(file, ";%s", kSamplingProfilerFrameNames[1]);
+      }
+
+      if (frame != SAMPLING_PROFILER_FRAME_HOST &&
+          frame != SAMPLING_PROFILER_FRAME_PLUGIN_CHAIN) {
+        fprintf(file, ";");
+        _samplingProfilerWriteFrameName(file, i > 0 ? owner->name : "host");
+        fprintf(file, ";%s", kSamplingProfilerFrameNames[frame]);
+      }
+
+      fprintf(file, " %u\n", numSamples);
+    }
+  }
+
+  _samplingProfilerUnlockOwners();
+  fclose(file);
+  return true;
+}
@@ -0,0 +1,143 @@
+//
+// SamplingProfiler.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_SamplingProfiler_h
+#define MrsWatson_SamplingProfiler_h
+
+#include "base/CharString.h"
+#include "base/Types.h"
+
+/**
+ * The sampling profiler interrupts the process at regular intervals of CPU
+ * time, and counts what each thread was doing when it was interrupted. Rather
+ * than walking the call stack, which is of little use for plugins which have
+ * been stripped of their symbols, each thread marks which plugin it is running
+ * and whether it is processing audio, MIDI, or calling back into the host.
+ *
+ * The results are written in the "collapsed stack" format, which can be turned
+ * into a flame graph with tools such as flamegraph.pl. Sampling is only
+ * supported on Unix platforms, since it relies on SIGPROF.
+ */
+typedef enum {
+  // Host code outside of the plugin chain, for example reading the input
+  SAMPLING_PROFILER_FRAME_HOST,
+  // Host code inside the plugin chain, but between plugins
+  SAMPLING_PROFILER_FRAME_PLUGIN_CHAIN,
+  SAMPLING_PROFILER_FRAME_PROCESS_AUDIO,
+  SAMPLING_PROFILER_FRAME_PROCESS_MIDI,
+  // A plugin which is processing audio or MIDI has called the host
+  SAMPLING_PROFILER_FRAME_AUDIO_HOST_CALLBACK,
+  SAMPLING_PROFILER_FRAME_MIDI_HOST_CALLBACK,
+  NUM_SAMPLING_PROFILER_FRAMES
+} SamplingProfilerFrame;
+
+/**
+ * Maximum length of a plugin name, including the terminating NULL byte. Longer
+ * plugin names are truncated in the profile.
+ */
+#define SAMPLING_PROFILER_OWNER_NAME_LENGTH 64
+
+/**
+ * Maximum number of different owners (the host and each plugin) which can be
+ * tracked. Samples from any further plugins are attributed to the last one.
+ */
+#define SAMPLING_PROFILER_MAX_OWNERS 32
+
+/**
+ * Check if the profiler can take samples on this platform
+ * @return True if sampling is supported
+ */
+boolByte samplingProfilerIsSupported(void);
+
+/**
+ * Start taking samples. This discards any samples from a previous run.
+ * @return True if the profiling timer was started
+ */
+boolByte samplingProfilerStart(void);
+
+/**
+ * Stop taking samples. The samples which were taken are kept until the
+ * profiler is started again.
+ */
+void samplingProfilerStop(void);
+
+/**
+ * Set what the calling thread is doing, without changing which plugin it is
+ * attributed to.
+ * @param frame New frame
+ * @return Previous frame, which should be restored afterwards
+ */
+SamplingProfilerFrame samplingProfilerSetFrame(SamplingProfilerFrame frame);
+
+/**
+ * Attribute samples on the calling thread to a plugin, until
+ * samplingProfilerExitPlugin() is called.
+ * @param pluginName Name of the plugin
+ * @param frame What the plugin is about to do, either
+ * SAMPLING_PROFILER_FRAME_PROCESS_AUDIO or SAMPLING_PROFILER_FRAME_PROCESS_MIDI
+ */
+void samplingProfilerEnterPlugin(const char *pluginName,
+                                 SamplingProfilerFrame frame);
+
+/**
+ * Attribute samples on the calling thread to the plugin chain again
+ */
+void samplingProfilerExitPlugin(void);
+
+/**
+ * Mark that a plugin has called the host. Only calls which are made while the
+ * plugin is processing are counted separately, all other calls are counted
+ * as time spent by the host.
+ * @return Previous frame, which should be restored with
+ * samplingProfilerSetFrame() when the call returns
+ */
+SamplingProfilerFrame samplingProfilerEnterHostCallback(void);
+
+/**
+ * Get the number of samples which have been taken
+ * @return Number of samples of all frames, for all owners
+ */
+unsigned long samplingProfilerGetNumSamples(void);
+
+/**
+ * Get the number of samples which were taken in one frame of an owner
+ * @param ownerName Name of the plugin, or NULL for the host
+ * @param frame Frame to look up
+ * @return Number of samples
+ */
+unsigned long
+samplingProfilerGetNumSamplesForOwner(const char *ownerName,
+                                      SamplingProfilerFrame frame);
+
+/**
+ * Write all samples to a file, with one line for each stack in the collapsed
+ * stack format.
+ * @param filename File to write
+ * @return True if the file was written
+ */
+boolByte samplingProfilerWriteCollapsedStacks(const CharString filename);
+
+#endif
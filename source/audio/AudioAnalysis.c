@@ -0,0 +1,199 @@
+//
+// AudioAnalysis.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "AudioAnalysis.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// Same as in SampleBuffer.c, SSE2 is always available on x86-64
+#if USE_SIMD && !USE_DOUBLE_SAMPLES &&                                         \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define AUDIO_ANALYSIS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+AudioAnalysis newAudioAnalysis(ChannelCount numChannels) {
+  AudioAnalysis self = (AudioAnalysis)malloc(sizeof(AudioAnalysisMembers));
+
+  self->numChannels = numChannels;
+  self->channels = (AudioAnalysisChannelMembers *)calloc(
+      numChannels, sizeof(AudioAnalysisChannelMembers));
+  self->numFrames = 0;
+  return self;
+}
+
+static void _audioAnalysisSample(AudioAnalysisChannel channel, Sample sample,
+                                 unsigned long frame) {
+  const Sample level = (Sample)fabs(sample);
+  const Sample jump = (Sample)fabs(sample - channel->_lastSample);
+
+  if (level > channel->peak) {
+    channel->peak = level;
+  }
+
+  if (level >= AUDIO_ANALYSIS_CLIP_LEVEL) {
+    channel->clippedSamples++;
+    channel->_clipRun++;
+
+    if (channel->_clipRun > channel->longestClip) {
+      channel->longestClip = channel->_clipRun;
+      channel->longestClipStart = frame + 1 - channel->_clipRun;
+    }
+  } else {
+    channel->_clipRun = 0;
+  }
+
+  if (sample == 0.0f) {
+    channel->_silenceRun++;
+
+    if (channel->_silenceRun > channel->longestSilence) {
+      channel->longestSilence = channel->_silenceRun;
+      channel->longestSilenceStart = frame + 1 - channel->_silenceRun;
+    }
+  } else {
+    channel->_silenceRun = 0;
+  }
+
+  if (jump >= AUDIO_ANALYSIS_JUMP_LEVEL) {
+    if (channel->discontinuities == 0) {
+      channel->firstDiscontinuity = frame;
+    }
+
+    channel->discontinuities++;
+  }
+
+  if (jump > channel->largestJump) {
+    channel->largestJump = jump;
+  }
+
+  channel->_lastSample = sample;
+}
+
+#if AUDIO_ANALYSIS_SSE2
+static Sample _audioAnalysisGetMax(__m128 values) {
+  values = _mm_max_ps(values, _mm_shuffle_ps(values, values,
+                                             _MM_SHUFFLE(1, 0, 3, 2)));
+  values = _mm_max_ps(values, _mm_shuffle_ps(values, values,
+                                             _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtss_f32(values);
+}
+#endif
+
+static void _audioAnalysisChannel(AudioAnalysisChannel channel,
+                                  const Samples samples, SampleCount blocksize,
+                                  unsigned long firstFrame) {
+  SampleCount i = 0;
+  SampleCount j;
+#if AUDIO_ANALYSIS_SSE2
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 clipLevel = _mm_set1_ps(AUDIO_ANALYSIS_CLIP_LEVEL);
+  const __m128 jumpLevel = _mm_set1_ps(AUDIO_ANALYSIS_JUMP_LEVEL);
+  const __m128 zero = _mm_setzero_ps();
+  __m128 peak = zero;
+  __m128 largestJump = zero;
+  __m128 current;
+  __m128 level;
+  __m128 jump;
+  __m128 flags;
+
+  // The first sample is compared with the last one of the previous block, so
+  // the vectorized loop starts after it
+  if (blocksize > 0) {
+    _audioAnalysisSample(channel, samples[0], firstFrame);
+    i = 1;
+  }
+
+  // Most blocks have no clipped, silent or jumping samples at all, which only
+  // need the running maximums. Everything else is counted one sample at a
+  // time, since the runs depend on the order of the samples.
+  for (; i + 4 <= blocksize; i += 4) {
+    current = _mm_loadu_ps(samples + i);
+    level = _mm_and_ps(current, absMask);
+    jump = _mm_and_ps(_mm_sub_ps(current, _mm_loadu_ps(samples + i - 1)),
+                      absMask);
+    flags = _mm_or_ps(_mm_or_ps(_mm_cmpge_ps(level, clipLevel),
+                                _mm_cmpge_ps(jump, jumpLevel)),
+                      _mm_cmpeq_ps(current, zero));
+
+    if (_mm_movemask_ps(flags) == 0) {
+      peak = _mm_max_ps(peak, level);
+      largestJump = _mm_max_ps(largestJump, jump);
+      channel->_clipRun = 0;
+      channel->_silenceRun = 0;
+    } else {
+      channel->_lastSample = samples[i - 1];
+
+      for (j = i; j < i + 4; j++) {
+        _audioAnalysisSample(channel, samples[j],
+                             firstFrame + (unsigned long)j);
+      }
+    }
+  }
+
+  if (i > 0) {
+    channel->_lastSample = samples[i - 1];
+  }
+
+  if (_audioAnalysisGetMax(peak) > channel->peak) {
+    channel->peak = _audioAnalysisGetMax(peak);
+  }
+
+  if (_audioAnalysisGetMax(largestJump) > channel->largestJump) {
+    channel->largestJump = _audioAnalysisGetMax(largestJump);
+  }
+#endif
+
+  for (j = i; j < blocksize; j++) {
+    _audioAnalysisSample(channel, samples[j], firstFrame + (unsigned long)j);
+  }
+}
+
+void audioAnalysisProcess(AudioAnalysis self, const SampleBuffer buffer) {
+  const ChannelCount numChannels = buffer->numChannels < self->numChannels
+                                       ? buffer->numChannels
+                                       : self->numChannels;
+  ChannelCount i;
+
+  for (i = 0; i < numChannels; i++) {
+    // Nothing comes before the first sample, so it cannot jump
+    if (self->numFrames == 0 && buffer->blocksize > 0) {
+      self->channels[i]._lastSample = buffer->samples[i][0];
+    }
+
+    _audioAnalysisChannel(&(self->channels[i]), buffer->samples[i],
+                          buffer->blocksize, self->numFrames);
+  }
+
+  self->numFrames += (unsigned long)buffer->blocksize;
+}
+
+void freeAudioAnalysis(AudioAnalysis self) {
+  if (self != NULL) {
+    free(self->channels);
+    free(self);
+  }
+}
@@ -0,0 +1,92 @@
+//
+// AudioAnalysis.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_AudioAnalysis_h
+#define MrsWatson_AudioAnalysis_h
+
+#include "audio/SampleBuffer.h"
+#include "base/Types.h"
+
+// Samples at or above this absolute value are counted as clipped
+#define AUDIO_ANALYSIS_CLIP_LEVEL 1.0f
+// Jumps between two consecutive samples of at least this size are counted as
+// discontinuities, which are heard as clicks
+#define AUDIO_ANALYSIS_JUMP_LEVEL 0.5f
+
+typedef struct {
+  Sample peak;
+  unsigned long clippedSamples;
+  // Longest run of clipped samples, and the frame where it starts
+  unsigned long longestClip;
+  unsigned long longestClipStart;
+  unsigned long discontinuities;
+  // Only valid when there are discontinuities
+  unsigned long firstDiscontinuity;
+  Sample largestJump;
+  // Longest run of digital silence, and the frame where it starts
+  unsigned long longestSilence;
+  unsigned long longestSilenceStart;
+
+  // Private fields
+  unsigned long _clipRun;
+  unsigned long _silenceRun;
+  Sample _lastSample;
+} AudioAnalysisChannelMembers;
+typedef AudioAnalysisChannelMembers *AudioAnalysisChannel;
+
+typedef struct {
+  ChannelCount numChannels;
+  AudioAnalysisChannelMembers *channels;
+  // Number of frames analyzed so far
+  unsigned long numFrames;
+} AudioAnalysisMembers;
+typedef AudioAnalysisMembers *AudioAnalysis;
+
+/**
+ * Create an analysis which checks audio for clipping, discontinuities and
+ * dropouts of digital silence as it is processed, block by block.
+ * @param numChannels Number of channels of the analyzed audio
+ * @return New analysis with no frames analyzed
+ */
+AudioAnalysis newAudioAnalysis(ChannelCount numChannels);
+
+/**
+ * Analyze the next block of audio. All checks are done in a single pass over
+ * each channel, which is vectorized where SIMD is available. Runs of clipped
+ * or silent samples, and jumps between samples, carry over from one block to
+ * the next.
+ * @param self
+ * @param buffer Block to analyze, which may have a short blocksize. Extra
+ * channels beyond those of the analysis are ignored.
+ */
+void audioAnalysisProcess(AudioAnalysis self, const SampleBuffer buffer);
+
+/**
+ * Free an analysis and its results
+ * @param self
+ */
+void freeAudioAnalysis(AudioAnalysis self);
+
+#endif
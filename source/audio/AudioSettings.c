@@ -26,6 +26,7 @@
 
 #include "AudioSettings.h"
 
+#include "app/RenderContext.h"
 #include "logging/EventLogger.h"
 
 #include <math.h>
@@ -49,16 +50,31 @@ void initAudioSettings(void) {
       DEFAULT_TIMESIG_BEATS_PER_MEASURE;
   audioSettingsInstance->timeSignatureNoteValue = DEFAULT_TIMESIG_NOTE_VALUE;
   audioSettingsInstance->bitDepth = kBitDepthDefault;
+  audioSettingsInstance->ditherType = kDitherTypeDefault;
+  audioSettingsInstance->planarPcm = false;
+  audioSettingsInstance->sparseOutput = false;
+  audioSettingsInstance->inputLatency = 0;
+  audioSettingsInstance->outputLatency = 0;
 }
 
 static AudioSettings _getAudioSettings(void) {
-  if (audioSettingsInstance == NULL) {
+  RenderContext renderContext = getRenderContext();
+
+  if (renderContext != NULL) {
+    return renderContext->audioSettings;
+  } else if (audioSettingsInstance == NULL) {
     initAudioSettings();
   }
 
   return audioSettingsInstance;
 }
 
+AudioSettings newAudioSettings(void) {
+  AudioSettings self = (AudioSettings)malloc(sizeof(AudioSettingsMembers));
+  memcpy(self, _getAudioSettings(), sizeof(AudioSettingsMembers));
+  return self;
+}
+
 SampleRate getSampleRate(void) { return _getAudioSettings()->sampleRate; }
 
 ChannelCount getNumChannels(void) { return _getAudioSettings()->numChannels; }
@@ -77,6 +93,18 @@ unsigned short getTimeSignatureNoteValue(void) {
 
 BitDepth getBitDepth(void) { return _getAudioSettings()->bitDepth; }
 
+DitherType getDitherType(void) { return _getAudioSettings()->ditherType; }
+
+boolByte getPlanarPcm(void) { return _getAudioSettings()->planarPcm; }
+
+boolByte getSparseOutput(void) { return _getAudioSettings()->sparseOutput; }
+
+SampleCount getInputLatency(void) { return _getAudioSettings()->inputLatency; }
+
+SampleCount getOutputLatency(void) {
+  return _getAudioSettings()->outputLatency;
+}
+
 boolByte setSampleRate(const SampleRate sampleRate) {
   if (sampleRate <= 0.0f) {
     logError("Can't set sample rate to %f", sampleRate);
@@ -121,16 +149,25 @@ boolByte setTempo(const Tempo tempo) {
   return true;
 }
 
-void setTempoFromMidiBytes(const byte *bytes) {
-  double tempo;
+Tempo getTempoFromMidiBytes(const byte *bytes) {
   unsigned long beatLengthInMicroseconds = 0;
 
   if (bytes != NULL) {
     beatLengthInMicroseconds = (unsigned long)(0x00000000 | (bytes[0] << 16) |
                                                (bytes[1] << 8) | (bytes[2]));
-    // Convert beats / microseconds -> beats / minutes
-    tempo = (1000000.0 / (double)beatLengthInMicroseconds) * 60.0;
-    setTempo((float)tempo);
+  }
+
+  if (beatLengthInMicroseconds == 0) {
+    return 0.0;
+  }
+
+  // Convert beats / microseconds -> beats / minutes
+  return (1000000.0 / (double)beatLengthInMicroseconds) * 60.0;
+}
+
+void setTempoFromMidiBytes(const byte *bytes) {
+  if (bytes != NULL) {
+    setTempo((float)getTempoFromMidiBytes(bytes));
   }
 }
 
@@ -217,6 +254,54 @@ boolByte setBitDepth(const BitDepth bitDepth) {
   }
 }
 
+boolByte setDitherType(const DitherType ditherType) {
+  switch (ditherType) {
+  case kDitherTypeNone:
+  case kDitherTypeTpdf:
+  case kDitherTypeShaped:
+    _getAudioSettings()->ditherType = ditherType;
+    return true;
+
+  default:
+    logError("Invalid dither type %d", ditherType);
+    return false;
+  }
+}
+
+boolByte setDitherTypeFromString(const CharString ditherType) {
+  if (charStringIsEqualToCString(ditherType, "none", true)) {
+    return setDitherType(kDitherTypeNone);
+  } else if (charStringIsEqualToCString(ditherType, "tpdf", true)) {
+    return setDitherType(kDitherTypeTpdf);
+  } else if (charStringIsEqualToCString(ditherType, "shaped", true)) {
+    return setDitherType(kDitherTypeShaped);
+  }
+
+  logError("Invalid dither type '%s'", ditherType->data);
+  return false;
+}
+
+void setPlanarPcm(const boolByte planarPcm) {
+  logDebug("Setting raw PCM layout to %s",
+           planarPcm ? "planar" : "interleaved");
+  _getAudioSettings()->planarPcm = planarPcm;
+}
+
+void setSparseOutput(const boolByte sparseOutput) {
+  logDebug("%s silent output blocks", sparseOutput ? "Skipping" : "Writing");
+  _getAudioSettings()->sparseOutput = sparseOutput;
+}
+
+void setInputLatency(const SampleCount latency) {
+  logDebug("Setting input latency to %ld frames", latency);
+  _getAudioSettings()->inputLatency = latency;
+}
+
+void setOutputLatency(const SampleCount latency) {
+  logDebug("Setting output latency to %ld frames", latency);
+  _getAudioSettings()->outputLatency = latency;
+}
+
 void freeAudioSettings(void) {
   free(audioSettingsInstance);
   audioSettingsInstance = NULL;
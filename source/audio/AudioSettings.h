@@ -46,6 +46,17 @@ typedef enum {
   kBitDepthDefault = kBitDepth16Bit
 } BitDepth;
 
+typedef enum {
+  // Truncate samples when converting them to integer PCM
+  kDitherTypeNone,
+  // Add triangular noise of +/- 1 LSB, and round to the nearest value
+  kDitherTypeTpdf,
+  // Like kDitherTypeTpdf, but filter the quantization error so that most of
+  // the noise is moved to high frequencies
+  kDitherTypeShaped,
+  kDitherTypeDefault = kDitherTypeNone
+} DitherType;
+
 typedef struct {
   SampleRate sampleRate;
   ChannelCount numChannels;
@@ -54,6 +65,17 @@ typedef struct {
   unsigned short timeSignatureBeatsPerMeasure;
   unsigned short timeSignatureNoteValue;
   BitDepth bitDepth;
+  DitherType ditherType;
+  // Raw PCM data is stored with one run of samples per channel and block,
+  // rather than with the channels of each frame interleaved
+  boolByte planarPcm;
+  // Silent blocks of file outputs are skipped rather than written, which
+  // leaves holes in the file on filesystems that support sparse files
+  boolByte sparseOutput;
+  // Latency of a live audio device, in sample frames. These are 0 when
+  // rendering from and to files.
+  SampleCount inputLatency;
+  SampleCount outputLatency;
 } AudioSettingsMembers;
 
 typedef AudioSettingsMembers *AudioSettings;
@@ -62,10 +84,21 @@ extern AudioSettings audioSettingsInstance;
 /**
  * Initialize the global audio settings instance. Since many different classes
  * require quick access to the audio settings, this is one of the few classes
- * that has a global singleton instance rather than a "new" allocator.
+ * that has a global singleton instance. All getters and setters in this file
+ * use the settings of the calling thread's render context instead if it has
+ * one, see RenderContext.h.
  */
 void initAudioSettings(void);
 
+/**
+ * Create a separate copy of the current audio settings, which is used by a
+ * render context. Settings in the copy can then be changed without affecting
+ * any other render jobs. Since the settings do not own any memory, the copy
+ * can be released with free().
+ * @return New audio settings
+ */
+AudioSettings newAudioSettings(void);
+
 /**
  * Get the current sample rate.
  * @return Sample rate in Hertz
@@ -112,6 +145,35 @@ unsigned short getTimeSignatureNoteValue(void);
  */
 BitDepth getBitDepth(void);
 
+/**
+ * @return Dither used when converting samples to integer PCM output
+ */
+DitherType getDitherType(void);
+
+/**
+ * @return True if raw PCM input and output is planar, see setPlanarPcm()
+ */
+boolByte getPlanarPcm(void);
+
+/**
+ * @return True if silent output blocks are not written, see setSparseOutput()
+ */
+boolByte getSparseOutput(void);
+
+/**
+ * Get the latency between audio arriving at the input device and it being
+ * passed to the plugins, which is reported to plugins that ask for it.
+ * @return Input latency in sample frames, or 0 when not using a device
+ */
+SampleCount getInputLatency(void);
+
+/**
+ * Get the latency between audio leaving the plugins and it being played by
+ * the output device.
+ * @return Output latency in sample frames, or 0 when not using a device
+ */
+SampleCount getOutputLatency(void);
+
 /**
  * Set the sample rate to be used during processing. This must be set before the
  * plugin chain is initialized. This function only requires a nonzero value,
@@ -144,6 +206,15 @@ boolByte setBlocksize(const SampleCount blocksize);
  */
 boolByte setTempo(const Tempo tempo);
 
+/**
+ * Convert the three-byte payload of a MIDI tempo meta event, which holds the
+ * length of a beat in microseconds, to a tempo.
+ * @param bytes Three byte sequence as read from a MIDI file
+ * @return Tempo in beats per minute, or 0 if the bytes are NULL or the beat
+ * length is 0
+ */
+Tempo getTempoFromMidiBytes(const byte *bytes);
+
 /**
  * MIDI files represent tempo in meta events with a three-byte payload. This
  * method transforms the three byte sequence from such file into an actual tempo
@@ -193,6 +264,54 @@ boolByte setTimeSignatureFromString(const CharString signature);
  */
 boolByte setBitDepth(const BitDepth bitDepth);
 
+/**
+ * Set the dither which is added when samples are converted to 16 or 24-bit
+ * integer PCM output.
+ * @param ditherType Dither type
+ * @return True if successfully set, false otherwise
+ */
+boolByte setDitherType(const DitherType ditherType);
+
+/**
+ * Set the dither type from a string, which should be "none", "tpdf", or
+ * "shaped".
+ * @param ditherType Name of the dither type
+ * @return True if successfully set, false otherwise
+ */
+boolByte setDitherTypeFromString(const CharString ditherType);
+
+/**
+ * Set whether raw PCM input and output is planar. Each block of planar PCM
+ * holds all samples of the first channel, followed by all samples of the next
+ * channel and so on, so the blocksize must be the same at both ends.
+ * @param planarPcm True for planar PCM, false for interleaved PCM
+ */
+void setPlanarPcm(const boolByte planarPcm);
+
+/**
+ * Set whether raw PCM and WAVE outputs skip over blocks which are entirely
+ * silent instead of converting and writing them. The skipped ranges read back
+ * as zeroes, and most filesystems do not allocate any disk space for them.
+ * Outputs which cannot seek, such as stdout, still write the silent blocks but
+ * do not convert their samples.
+ * @param sparseOutput True to skip silent blocks
+ */
+void setSparseOutput(const boolByte sparseOutput);
+
+/**
+ * Set the input latency, which is normally done by a device sample source once
+ * its stream has been opened.
+ * @param latency Latency in sample frames
+ */
+void setInputLatency(const SampleCount latency);
+
+/**
+ * Set the output latency, which is normally done by a device sample source
+ * once its stream has been opened.
+ * @param latency Latency in sample frames
+ */
+void setOutputLatency(const SampleCount latency);
+
 /**
  * Release memory of the global audio settings instance. Any attempt to use the
  * audio settings functions after this has been called will result in undefined
@@ -0,0 +1,103 @@
+//
+// Dither.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "Dither.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// Error feedback filter for kDitherTypeShaped. Subtracting these multiples of
+// the previous two errors gives the quantization noise a (1 - z^-1)^2 response,
+// which is silent at DC and rises by 12dB per octave towards Nyquist.
+static const double kDitherShapingFirst = 2.0;
+static const double kDitherShapingSecond = -1.0;
+
+Dither newDither(DitherType type, ChannelCount numChannels) {
+  Dither self = (Dither)malloc(sizeof(DitherMembers));
+  unsigned int i;
+
+  self->type = type;
+  self->numChannels = numChannels;
+
+  // Any non-zero seeds work for xorshift, these are just spread far apart
+  for (i = 0; i < DITHER_NUM_RANDOM_STATES; i++) {
+    self->randomState[i] = 0x9e3779b9u * (i + 1);
+  }
+
+  self->errors = (double *)calloc((size_t)numChannels * 2, sizeof(double));
+  return self;
+}
+
+int ditherQuantize(Dither self, ChannelCount channel, Sample sample,
+                   double scale, int maxValue) {
+  double *errors = self->errors + channel * 2;
+  unsigned int random = self->randomState[0];
+  double target = sample * scale;
+  double value;
+
+  // Same generator as the vectorized conversion in PcmSampleBuffer.c. The
+  // difference of the two 16-bit halves has a triangular distribution.
+  random ^= random << 13;
+  random ^= random >> 17;
+  random ^= random << 5;
+  self->randomState[0] = random;
+
+  if (self->type == kDitherTypeShaped) {
+    target -= kDitherShapingFirst * errors[0] + kDitherShapingSecond * errors[1];
+  }
+
+  value = floor(target +
+                ((double)(random & 0xffff) - (double)(random >> 16)) / 65536.0 +
+                0.5);
+
+  if (self->type == kDitherTypeShaped) {
+    // The error is taken before clipping, otherwise a clipped block would
+    // keep feeding back large errors afterwards. It is never larger than
+    // 1.5, except for NaN or infinite samples, which must not be fed back.
+    errors[1] = errors[0];
+    errors[0] = value - target;
+
+    if (!(fabs(errors[0]) <= 2.0)) {
+      errors[0] = 0.0;
+    }
+  }
+
+  // Written so that NaN samples end up at full scale instead of being cast
+  if (!(value <= (double)maxValue)) {
+    return maxValue;
+  } else if (value < (double)-maxValue - 1.0) {
+    return -maxValue - 1;
+  }
+
+  return (int)value;
+}
+
+void freeDither(Dither self) {
+  if (self != NULL) {
+    free(self->errors);
+    free(self);
+  }
+}
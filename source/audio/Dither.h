@@ -0,0 +1,76 @@
+//
+// Dither.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_Dither_h
+#define MrsWatson_Dither_h
+
+#include "audio/AudioSettings.h"
+#include "base/Types.h"
+
+// Number of independent random generators, one for each lane of a 4-wide
+// vectorized conversion
+#define DITHER_NUM_RANDOM_STATES 4
+
+typedef struct {
+  DitherType type;
+  ChannelCount numChannels;
+  unsigned int randomState[DITHER_NUM_RANDOM_STATES];
+  // Quantization errors of the last two samples in each channel, which are fed
+  // back when noise shaping
+  double *errors;
+} DitherMembers;
+typedef DitherMembers *Dither;
+
+/**
+ * Create the state needed to dither samples when converting them to integer
+ * PCM. The random generators are seeded with fixed values, so the same input
+ * always produces the same output.
+ * @param type Dither type, which must not be kDitherTypeNone
+ * @param numChannels Number of channels which will be converted
+ * @return New dither state
+ */
+Dither newDither(DitherType type, ChannelCount numChannels);
+
+/**
+ * Convert one sample to an integer PCM value with dither, rounding to the
+ * nearest value and clipping at full scale.
+ * @param self
+ * @param channel Channel of the sample, which is used for noise shaping
+ * @param sample Sample to convert
+ * @param scale Factor which maps full scale samples to PCM values
+ * @param maxValue Largest PCM value. The smallest one is -maxValue - 1.
+ * @return Dithered PCM value
+ */
+int ditherQuantize(Dither self, ChannelCount channel, Sample sample,
+                   double scale, int maxValue);
+
+/**
+ * Free a dither state and all associated memory
+ * @param self
+ */
+void freeDither(Dither self);
+
+#endif
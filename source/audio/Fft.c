@@ -0,0 +1,239 @@
+//
+// Fft.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "Fft.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// Same as in SampleBuffer.c, SSE2 is always available on x86-64
+#if USE_SIMD &&                                                                \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define FFT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// M_PI is not part of C99
+static const double kFftPi = 3.14159265358979323846;
+
+Fft newFft(unsigned int size) {
+  Fft fft;
+  unsigned int half = size / 2;
+  unsigned int bits = 0;
+  unsigned int i, j;
+
+  if (size < 2 || (size & (size - 1)) != 0) {
+    return NULL;
+  }
+
+  while ((1u << bits) < half) {
+    bits++;
+  }
+
+  fft = (Fft)malloc(sizeof(FftMembers));
+  fft->size = size;
+  fft->bitReverse = (unsigned int *)malloc(sizeof(unsigned int) * half);
+  fft->cosTable = (float *)malloc(sizeof(float) * (half / 2 + 1));
+  fft->sinTable = (float *)malloc(sizeof(float) * (half / 2 + 1));
+  fft->splitCos = (float *)malloc(sizeof(float) * half);
+  fft->splitSin = (float *)malloc(sizeof(float) * half);
+  fft->workReal = (float *)malloc(sizeof(float) * half);
+  fft->workImag = (float *)malloc(sizeof(float) * half);
+
+  for (i = 0; i < half; i++) {
+    fft->bitReverse[i] = 0;
+
+    for (j = 0; j < bits; j++) {
+      fft->bitReverse[i] |= ((i >> j) & 1) << (bits - 1 - j);
+    }
+
+    fft->splitCos[i] = (float)cos(2.0 * kFftPi * i / size);
+    fft->splitSin[i] = (float)sin(2.0 * kFftPi * i / size);
+  }
+
+  for (i = 0; i <= half / 2; i++) {
+    fft->cosTable[i] = (float)cos(2.0 * kFftPi * i / half);
+    fft->sinTable[i] = (float)sin(2.0 * kFftPi * i / half);
+  }
+
+  return fft;
+}
+
+unsigned int fftGetNumBins(const Fft self) { return self->size / 2 + 1; }
+
+// In-place radix-2 transform of the work buffers, which must already be in
+// bit-reversed order. The inverse transform is not scaled.
+static void _fftComplex(Fft self, boolByte inverse) {
+  const unsigned int n = self->size / 2;
+  const float sign = inverse ? 1.0f : -1.0f;
+  float *re = self->workReal;
+  float *im = self->workImag;
+  float wr, wi, tr, ti;
+  unsigned int length, halfLength, step, i, j, a, b;
+
+  for (length = 2; length <= n; length <<= 1) {
+    halfLength = length / 2;
+    step = n / length;
+
+    for (i = 0; i < n; i += length) {
+      for (j = 0; j < halfLength; j++) {
+        wr = self->cosTable[j * step];
+        wi = sign * self->sinTable[j * step];
+        a = i + j;
+        b = a + halfLength;
+        tr = wr * re[b] - wi * im[b];
+        ti = wr * im[b] + wi * re[b];
+        re[b] = re[a] - tr;
+        im[b] = im[a] - ti;
+        re[a] += tr;
+        im[a] += ti;
+      }
+    }
+  }
+}
+
+void fftForward(Fft self, const float *input, float *real, float *imag) {
+  const unsigned int n = self->size / 2;
+  float evenReal, evenImag, oddReal, oddImag;
+  float zkReal, zkImag, znkReal, znkImag;
+  unsigned int i, k;
+
+  for (i = 0; i < n; i++) {
+    self->workReal[self->bitReverse[i]] = input[2 * i];
+    self->workImag[self->bitReverse[i]] = input[2 * i + 1];
+  }
+
+  _fftComplex(self, false);
+
+  // The even samples have the conjugate symmetric part of the half length
+  // spectrum, and the odd samples the rest
+  for (k = 0; k <= n / 2; k++) {
+    zkReal = self->workReal[k % n];
+    zkImag = self->workImag[k % n];
+    znkReal = self->workReal[(n - k) % n];
+    znkImag = self->workImag[(n - k) % n];
+
+    evenReal = 0.5f * (zkReal + znkReal);
+    evenImag = 0.5f * (zkImag - znkImag);
+    oddReal = 0.5f * (zkImag + znkImag);
+    oddImag = -0.5f * (zkReal - znkReal);
+
+    real[k] = evenReal + self->splitCos[k % n] * oddReal +
+              self->splitSin[k % n] * oddImag;
+    imag[k] = evenImag + self->splitCos[k % n] * oddImag -
+              self->splitSin[k % n] * oddReal;
+
+    // Bin n - k has the same even and odd parts, only conjugated
+    if (k > 0 && k < n - k) {
+      real[n - k] = evenReal - self->splitCos[k] * oddReal -
+                    self->splitSin[k] * oddImag;
+      imag[n - k] = -evenImag + self->splitCos[k] * oddImag -
+                    self->splitSin[k] * oddReal;
+    }
+  }
+
+  // The Nyquist bin only has the difference of the even and odd samples
+  real[n] = self->workReal[0] - self->workImag[0];
+  imag[n] = 0.0f;
+  imag[0] = 0.0f;
+}
+
+void fftInverse(Fft self, const float *real, const float *imag,
+                float *output) {
+  const unsigned int n = self->size / 2;
+  const float scale = 1.0f / (float)n;
+  float evenReal, evenImag, sumReal, sumImag, oddReal, oddImag;
+  float xkReal, xkImag, xnkReal, xnkImag;
+  unsigned int i, k;
+
+  for (k = 0; k < n; k++) {
+    xkReal = real[k];
+    xkImag = k == 0 ? 0.0f : imag[k];
+    xnkReal = real[n - k];
+    xnkImag = k == 0 ? 0.0f : -imag[n - k];
+
+    evenReal = 0.5f * (xkReal + xnkReal);
+    evenImag = 0.5f * (xkImag + xnkImag);
+    sumReal = 0.5f * (xkReal - xnkReal);
+    sumImag = 0.5f * (xkImag - xnkImag);
+    oddReal = sumReal * self->splitCos[k] - sumImag * self->splitSin[k];
+    oddImag = sumReal * self->splitSin[k] + sumImag * self->splitCos[k];
+
+    self->workReal[self->bitReverse[k]] = evenReal - oddImag;
+    self->workImag[self->bitReverse[k]] = evenImag + oddReal;
+  }
+
+  _fftComplex(self, true);
+
+  for (i = 0; i < n; i++) {
+    output[2 * i] = self->workReal[i] * scale;
+    output[2 * i + 1] = self->workImag[i] * scale;
+  }
+}
+
+void fftMultiplyAccumulate(const float *aReal, const float *aImag,
+                           const float *bReal, const float *bImag,
+                           float *outReal, float *outImag,
+                           unsigned int numBins) {
+  unsigned int i = 0;
+
+#if FFT_SSE2
+  __m128 ar, ai, br, bi;
+
+  for (; i + 4 <= numBins; i += 4) {
+    ar = _mm_loadu_ps(aReal + i);
+    ai = _mm_loadu_ps(aImag + i);
+    br = _mm_loadu_ps(bReal + i);
+    bi = _mm_loadu_ps(bImag + i);
+    _mm_storeu_ps(outReal + i,
+                  _mm_add_ps(_mm_loadu_ps(outReal + i),
+                             _mm_sub_ps(_mm_mul_ps(ar, br),
+                                        _mm_mul_ps(ai, bi))));
+    _mm_storeu_ps(outImag + i,
+                  _mm_add_ps(_mm_loadu_ps(outImag + i),
+                             _mm_add_ps(_mm_mul_ps(ar, bi),
+                                        _mm_mul_ps(ai, br))));
+  }
+#endif
+
+  for (; i < numBins; i++) {
+    outReal[i] += aReal[i] * bReal[i] - aImag[i] * bImag[i];
+    outImag[i] += aReal[i] * bImag[i] + aImag[i] * bReal[i];
+  }
+}
+
+void freeFft(Fft self) {
+  if (self != NULL) {
+    free(self->bitReverse);
+    free(self->cosTable);
+    free(self->sinTable);
+    free(self->splitCos);
+    free(self->splitSin);
+    free(self->workReal);
+    free(self->workImag);
+    free(self);
+  }
+}
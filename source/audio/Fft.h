@@ -0,0 +1,115 @@
+//
+// Fft.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_Fft_h
+#define MrsWatson_Fft_h
+
+#include "base/Types.h"
+
+/**
+ * Fast Fourier transform of real signals with a power of two length. Spectra
+ * are stored with the real and imaginary parts in separate arrays, which lets
+ * them be multiplied with SIMD instructions without shuffling. A transform of
+ * size samples has size / 2 + 1 bins, from DC up to the Nyquist frequency.
+ *
+ * The real signal is transformed as a complex signal of half the length, with
+ * the even samples as the real parts and the odd samples as the imaginary
+ * parts, and the two halves of the spectrum are then separated again.
+ */
+typedef struct {
+  unsigned int size;
+  // Index of each element of the half length complex transform after the
+  // bit-reversal permutation
+  unsigned int *bitReverse;
+  // Twiddle factors of the complex transform, for size / 4 angles
+  float *cosTable;
+  float *sinTable;
+  // Twiddle factors which separate the spectrum, for size / 2 angles
+  float *splitCos;
+  float *splitSin;
+  // Complex signal of size / 2 elements being transformed
+  float *workReal;
+  float *workImag;
+} FftMembers;
+typedef FftMembers *Fft;
+
+/**
+ * Create a transform for signals of a given length. A transform has its own
+ * work buffers, so each thread needs its own instance.
+ * @param size Number of samples, which must be a power of two and at least 2
+ * @return New transform, or NULL if the size is not supported
+ */
+Fft newFft(unsigned int size);
+
+/**
+ * Get the number of bins in the spectrum of a transform
+ * @param self
+ * @return size / 2 + 1
+ */
+unsigned int fftGetNumBins(const Fft self);
+
+/**
+ * Transform a signal to its spectrum, without any scaling
+ * @param self
+ * @param input Signal with size samples
+ * @param real Real parts of the spectrum, with fftGetNumBins() elements
+ * @param imag Imaginary parts of the spectrum, with fftGetNumBins() elements
+ */
+void fftForward(Fft self, const float *input, float *real, float *imag);
+
+/**
+ * Transform a spectrum back to a signal. The result is scaled by 1 / size, so
+ * that a forward and inverse transform give back the original signal.
+ * @param self
+ * @param real Real parts of the spectrum. The imaginary parts of the DC and
+ * Nyquist bins are ignored.
+ * @param imag Imaginary parts of the spectrum
+ * @param output Signal with size samples
+ */
+void fftInverse(Fft self, const float *real, const float *imag, float *output);
+
+/**
+ * Multiply two spectra and add the result to a third one, which is how
+ * convolution is done in the frequency domain.
+ * @param aReal Real parts of the first spectrum
+ * @param aImag Imaginary parts of the first spectrum
+ * @param bReal Real parts of the second spectrum
+ * @param bImag Imaginary parts of the second spectrum
+ * @param outReal Real parts of the spectrum to add to
+ * @param outImag Imaginary parts of the spectrum to add to
+ * @param numBins Number of bins in each spectrum
+ */
+void fftMultiplyAccumulate(const float *aReal, const float *aImag,
+                           const float *bReal, const float *bImag,
+                           float *outReal, float *outImag,
+                           unsigned int numBins);
+
+/**
+ * Free a transform and all associated memory
+ * @param self
+ */
+void freeFft(Fft self);
+
+#endif
@@ -0,0 +1,384 @@
+//
+// LoudnessMeter.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include "LoudnessMeter.h"
+
+#include "audio/TruePeak.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// M_PI is not part of C99
+static const double kLoudnessMeterPi = 3.14159265358979323846;
+// Offset of the loudness from the weighted mean square, from BS.1770
+static const double kLoudnessMeterOffset = -0.691;
+static const double kLoudnessMeterAbsoluteGate = -70.0;
+static const double kLoudnessMeterIntegratedRelativeGate = -10.0;
+static const double kLoudnessMeterRangeRelativeGate = -20.0;
+// A gating block is 400ms long, and starts every 100ms
+static const unsigned long kLoudnessMeterBlockSteps = 4;
+
+static double _energyToLoudness(double energy) {
+  return energy > 0.0 ? kLoudnessMeterOffset + 10.0 * log10(energy)
+                      : -HUGE_VAL;
+}
+
+static double _loudnessToEnergy(double loudness) {
+  return pow(10.0, (loudness - kLoudnessMeterOffset) / 10.0);
+}
+
+// The K-weighting filters of BS.1770 are given for 48kHz, so they are
+// designed here from their analog prototypes for other sample rates
+static void _setFilters(LoudnessMeter self, SampleRate sampleRate) {
+  const double shelfGain = pow(10.0, 3.999843853973347 / 20.0);
+  const double shelfBandGain = pow(shelfGain, 0.4996667741545416);
+  const double shelfQ = 0.7071752369554196;
+  const double highPassQ = 0.5003270373238773;
+  double k, a0;
+
+  k = tan(kLoudnessMeterPi * 1681.974450955533 / sampleRate);
+  a0 = 1.0 + k / shelfQ + k * k;
+  self->_shelfB[0] = (shelfGain + shelfBandGain * k / shelfQ + k * k) / a0;
+  self->_shelfB[1] = 2.0 * (k * k - shelfGain) / a0;
+  self->_shelfB[2] = (shelfGain - shelfBandGain * k / shelfQ + k * k) / a0;
+  self->_shelfA[0] = 1.0;
+  self->_shelfA[1] = 2.0 * (k * k - 1.0) / a0;
+  self->_shelfA[2] = (1.0 - k / shelfQ + k * k) / a0;
+
+  k = tan(kLoudnessMeterPi * 38.13547087602444 / sampleRate);
+  a0 = 1.0 + k / highPassQ + k * k;
+  self->_highPassB[0] = 1.0;
+  self->_highPassB[1] = -2.0;
+  self->_highPassB[2] = 1.0;
+  self->_highPassA[0] = 1.0;
+  self->_highPassA[1] = 2.0 * (k * k - 1.0) / a0;
+  self->_highPassA[2] = (1.0 - k / highPassQ + k * k) / a0;
+}
+
+static void _setChannelWeights(LoudnessMeter self) {
+  ChannelCount i;
+
+  for (i = 0; i < self->numChannels; i++) {
+    self->_channelWeights[i] = 1.0;
+  }
+
+  // L, R, C, Ls, Rs and L, R, C, LFE, Ls, Rs
+  if (self->numChannels == 5) {
+    self->_channelWeights[3] = 1.41;
+    self->_channelWeights[4] = 1.41;
+  } else if (self->numChannels == 6) {
+    self->_channelWeights[3] = 0.0;
+    self->_channelWeights[4] = 1.41;
+    self->_channelWeights[5] = 1.41;
+  }
+}
+
+LoudnessMeter newLoudnessMeter(ChannelCount numChannels,
+                               SampleRate sampleRate) {
+  LoudnessMeter self = (LoudnessMeter)malloc(sizeof(LoudnessMeterMembers));
+  ChannelCount i;
+
+  memset(self, 0, sizeof(LoudnessMeterMembers));
+  self->numChannels = numChannels;
+  _setFilters(self, sampleRate);
+  self->_filterState = (double *)calloc(numChannels * 4, sizeof(double));
+  self->_channelWeights = (double *)malloc(sizeof(double) * numChannels);
+  _setChannelWeights(self);
+
+  self->_stepFrames = (unsigned long)(sampleRate / 10.0 + 0.5);
+  if (self->_stepFrames == 0) {
+    self->_stepFrames = 1;
+  }
+
+  self->_filter = (float *)malloc(sizeof(float) * TRUE_PEAK_FILTER_TAPS *
+                                  TRUE_PEAK_OVERSAMPLING);
+  truePeakFillFilter(self->_filter);
+  self->_history = (Samples *)malloc(sizeof(Samples) * numChannels);
+
+  for (i = 0; i < numChannels; i++) {
+    self->_history[i] =
+        (Samples)calloc(2 * TRUE_PEAK_FILTER_TAPS, sizeof(Sample));
+  }
+
+  self->_truePeaks = (Sample *)calloc(numChannels, sizeof(Sample));
+  return self;
+}
+
+static void _appendEnergy(double **energies, size_t *size, size_t *capacity,
+                          double energy) {
+  if (*size == *capacity) {
+    *capacity = *capacity > 0 ? *capacity * 2 : 64;
+    *energies = (double *)realloc(*energies, sizeof(double) * *capacity);
+  }
+
+  (*energies)[(*size)++] = energy;
+}
+
+static double _getRecentEnergy(const LoudnessMeter self, unsigned long steps) {
+  double sum = 0.0;
+  unsigned long i;
+
+  for (i = 0; i < steps; i++) {
+    sum += self->_recentSteps[(self->_numSteps - 1 - i) %
+                              LOUDNESS_METER_SHORT_TERM_STEPS];
+  }
+
+  return sum / (double)steps;
+}
+
+static void _finishStep(LoudnessMeter self) {
+  self->_recentSteps[self->_numSteps % LOUDNESS_METER_SHORT_TERM_STEPS] =
+      self->_stepEnergy / (double)self->_stepFrames;
+  self->_numSteps++;
+  self->_stepEnergy = 0.0;
+  self->_stepPosition = 0;
+
+  if (self->_numSteps >= kLoudnessMeterBlockSteps) {
+    _appendEnergy(&self->_blockEnergies, &self->_numBlocks,
+                  &self->_blockCapacity,
+                  _getRecentEnergy(self, kLoudnessMeterBlockSteps));
+  }
+
+  if (self->_numSteps >= LOUDNESS_METER_SHORT_TERM_STEPS) {
+    _appendEnergy(&self->_shortTermEnergies, &self->_numShortTerms,
+                  &self->_shortTermCapacity,
+                  _getRecentEnergy(self, LOUDNESS_METER_SHORT_TERM_STEPS));
+  }
+}
+
+// Filter some samples of one channel and return their summed square
+static double _filterChannel(LoudnessMeter self, ChannelCount channel,
+                             const Samples samples, SampleCount numFrames) {
+  double *state = self->_filterState + channel * 4;
+  double s0 = state[0], s1 = state[1], s2 = state[2], s3 = state[3];
+  double x, y, z;
+  double sum = 0.0;
+  SampleCount i;
+
+  for (i = 0; i < numFrames; i++) {
+    x = (double)samples[i];
+    y = self->_shelfB[0] * x + s0;
+    s0 = self->_shelfB[1] * x - self->_shelfA[1] * y + s1;
+    s1 = self->_shelfB[2] * x - self->_shelfA[2] * y;
+    z = y + s2;
+    s2 = -2.0 * y - self->_highPassA[1] * z + s3;
+    s3 = y - self->_highPassA[2] * z;
+    sum += z * z;
+  }
+
+  state[0] = s0;
+  state[1] = s1;
+  state[2] = s2;
+  state[3] = s3;
+  return sum;
+}
+
+void loudnessMeterProcess(LoudnessMeter self, const SampleBuffer buffer) {
+  const ChannelCount numChannels = buffer->numChannels < self->numChannels
+                                       ? buffer->numChannels
+                                       : self->numChannels;
+  SampleCount offset = 0;
+  SampleCount numFrames;
+  ChannelCount i;
+  SampleCount j;
+
+  // The block is measured in pieces which end on each 100ms step
+  while (offset < buffer->blocksize) {
+    numFrames = (SampleCount)(self->_stepFrames - self->_stepPosition);
+    if (numFrames > buffer->blocksize - offset) {
+      numFrames = buffer->blocksize - offset;
+    }
+
+    for (i = 0; i < numChannels; i++) {
+      self->_stepEnergy +=
+          self->_channelWeights[i] *
+          _filterChannel(self, i, buffer->samples[i] + offset, numFrames);
+    }
+
+    self->_stepPosition += (unsigned long)numFrames;
+    offset += numFrames;
+
+    if (self->_stepPosition == self->_stepFrames) {
+      _finishStep(self);
+    }
+  }
+
+  if (self->_peaksSize < buffer->blocksize) {
+    free(self->_peaks);
+    self->_peaks = (Sample *)malloc(sizeof(Sample) * buffer->blocksize);
+    self->_peaksSize = buffer->blocksize;
+  }
+
+  for (i = 0; i < numChannels; i++) {
+    memset(self->_peaks, 0, sizeof(Sample) * buffer->blocksize);
+    // Each channel has its own history, so the index is only stored after the
+    // last one
+    j = (SampleCount)truePeakDetect(self->_filter, self->_history[i],
+                                    self->_historyIndex, buffer->samples[i],
+                                    buffer->blocksize, self->_peaks);
+
+    if (i == numChannels - 1) {
+      self->_historyIndex = (unsigned int)j;
+    }
+
+    for (j = 0; j < buffer->blocksize; j++) {
+      if (self->_peaks[j] > self->_truePeaks[i]) {
+        self->_truePeaks[i] = self->_peaks[j];
+      }
+    }
+  }
+}
+
+double loudnessMeterGetIntegrated(const LoudnessMeter self) {
+  const double absoluteGate = _loudnessToEnergy(kLoudnessMeterAbsoluteGate);
+  double relativeGate;
+  double sum = 0.0;
+  size_t count = 0;
+  size_t i;
+
+  for (i = 0; i < self->_numBlocks; i++) {
+    if (self->_blockEnergies[i] > absoluteGate) {
+      sum += self->_blockEnergies[i];
+      count++;
+    }
+  }
+
+  if (count == 0) {
+    return -HUGE_VAL;
+  }
+
+  relativeGate =
+      _loudnessToEnergy(_energyToLoudness(sum / (double)count) +
+                        kLoudnessMeterIntegratedRelativeGate);
+  if (relativeGate < absoluteGate) {
+    relativeGate = absoluteGate;
+  }
+
+  sum = 0.0;
+  count = 0;
+
+  for (i = 0; i < self->_numBlocks; i++) {
+    if (self->_blockEnergies[i] > relativeGate) {
+      sum += self->_blockEnergies[i];
+      count++;
+    }
+  }
+
+  return count > 0 ? _energyToLoudness(sum / (double)count) : -HUGE_VAL;
+}
+
+static int _compareDoubles(const void *a, const void *b) {
+  const double first = *(const double *)a;
+  const double second = *(const double *)b;
+  return (first > second) - (first < second);
+}
+
+double loudnessMeterGetRange(const LoudnessMeter self) {
+  const double absoluteGate = _loudnessToEnergy(kLoudnessMeterAbsoluteGate);
+  double relativeGate;
+  double *gated;
+  double range;
+  double sum = 0.0;
+  size_t count = 0;
+  size_t i;
+
+  for (i = 0; i < self->_numShortTerms; i++) {
+    if (self->_shortTermEnergies[i] > absoluteGate) {
+      sum += self->_shortTermEnergies[i];
+      count++;
+    }
+  }
+
+  if (count == 0) {
+    return 0.0;
+  }
+
+  relativeGate = _loudnessToEnergy(_energyToLoudness(sum / (double)count) +
+                                   kLoudnessMeterRangeRelativeGate);
+  if (relativeGate < absoluteGate) {
+    relativeGate = absoluteGate;
+  }
+
+  gated = (double *)malloc(sizeof(double) * count);
+  count = 0;
+
+  for (i = 0; i < self->_numShortTerms; i++) {
+    if (self->_shortTermEnergies[i] > relativeGate) {
+      gated[count++] = _energyToLoudness(self->_shortTermEnergies[i]);
+    }
+  }
+
+  if (count == 0) {
+    free(gated);
+    return 0.0;
+  }
+
+  qsort(gated, count, sizeof(double), _compareDoubles);
+  range = gated[(size_t)((double)(count - 1) * 0.95 + 0.5)] -
+          gated[(size_t)((double)(count - 1) * 0.10 + 0.5)];
+  free(gated);
+  return range;
+}
+
+double loudnessMeterGetTruePeak(const LoudnessMeter self,
+                                ChannelCount channel) {
+  Sample history[2 * TRUE_PEAK_FILTER_TAPS];
+  Sample silence[TRUE_PEAK_FILTER_DELAY] = {0.0f};
+  Sample peaks[TRUE_PEAK_FILTER_DELAY] = {0.0f};
+  Sample peak = self->_truePeaks[channel];
+  unsigned int i;
+
+  // Detection lags behind the input, so the peaks around the last samples are
+  // found by following them with silence, on a copy of the history
+  memcpy(history, self->_history[channel], sizeof(history));
+  truePeakDetect(self->_filter, history, self->_historyIndex, silence,
+                 TRUE_PEAK_FILTER_DELAY, peaks);
+
+  for (i = 0; i < TRUE_PEAK_FILTER_DELAY; i++) {
+    peak = peaks[i] > peak ? peaks[i] : peak;
+  }
+
+  return peak > 0.0f ? 20.0 * log10((double)peak) : -HUGE_VAL;
+}
+
+void freeLoudnessMeter(LoudnessMeter self) {
+  ChannelCount i;
+
+  if (self != NULL) {
+    for (i = 0; i < self->numChannels; i++) {
+      free(self->_history[i]);
+    }
+
+    free(self->_history);
+    free(self->_filter);
+    free(self->_truePeaks);
+    free(self->_peaks);
+    free(self->_filterState);
+    free(self->_channelWeights);
+    free(self->_blockEnergies);
+    free(self->_shortTermEnergies);
+    free(self);
+  }
+}
@@ -0,0 +1,126 @@
+//
+// LoudnessMeter.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef MrsWatson_LoudnessMeter_h
+#define MrsWatson_LoudnessMeter_h
+
+#include "audio/SampleBuffer.h"
+#include "base/Types.h"
+
+#include <stddef.h>
+
+/** Number of 100ms steps in a short-term window of 3 seconds */
+#define LOUDNESS_METER_SHORT_TERM_STEPS 30
+
+typedef struct {
+  ChannelCount numChannels;
+
+  // Private fields
+  // K-weighting filter, which is a shelf and a high-pass biquad in series.
+  // Each channel has the transposed direct form state of both of them.
+  double _shelfB[3];
+  double _shelfA[3];
+  double _highPassB[3];
+  double _highPassA[3];
+  double *_filterState;
+  double *_channelWeights;
+
+  // Weighted energy is summed over steps of 100ms, and the last steps are kept
+  // to make the overlapping gating and short-term blocks from them
+  unsigned long _stepFrames;
+  unsigned long _stepPosition;
+  double _stepEnergy;
+  double _recentSteps[LOUDNESS_METER_SHORT_TERM_STEPS];
+  unsigned long _numSteps;
+
+  // Mean square energy of each 400ms gating block and 3s short-term block
+  double *_blockEnergies;
+  size_t _numBlocks;
+  size_t _blockCapacity;
+  double *_shortTermEnergies;
+  size_t _numShortTerms;
+  size_t _shortTermCapacity;
+
+  // True-peak detection state, as in the true-peak limiter
+  float *_filter;
+  Samples *_history;
+  unsigned int _historyIndex;
+  Sample *_truePeaks;
+  Sample *_peaks;
+  SampleCount _peaksSize;
+} LoudnessMeterMembers;
+typedef LoudnessMeterMembers *LoudnessMeter;
+
+/**
+ * Create a meter which measures loudness as specified by ITU-R BS.1770 and
+ * EBU R128, along with the true peak of each channel, as audio is processed
+ * block by block. With 5 or 6 channels, the channels are taken to be in the
+ * order of WAVE files, where the surround channels are weighted by 1.41 and the
+ * LFE channel is left out.
+ * @param numChannels Number of channels of the measured audio
+ * @param sampleRate Sample rate of the measured audio
+ * @return New meter with nothing measured
+ */
+LoudnessMeter newLoudnessMeter(ChannelCount numChannels, SampleRate sampleRate);
+
+/**
+ * Measure the next block of audio
+ * @param self
+ * @param buffer Block to measure, which may have a short blocksize. Extra
+ * channels beyond those of the meter are ignored.
+ */
+void loudnessMeterProcess(LoudnessMeter self, const SampleBuffer buffer);
+
+/**
+ * Get the integrated loudness of everything measured so far, which is gated
+ * at -70 LUFS and 10 LU below the ungated loudness.
+ * @param self
+ * @return Loudness in LUFS, or -HUGE_VAL if no blocks pass the gates
+ */
+double loudnessMeterGetIntegrated(const LoudnessMeter self);
+
+/**
+ * Get the loudness range of everything measured so far, which is the spread
+ * between the 10th and 95th percentiles of the short-term loudness.
+ * @param self
+ * @return Loudness range in LU
+ */
+double loudnessMeterGetRange(const LoudnessMeter self);
+
+/**
+ * Get the largest true peak of a channel, which includes the peaks between the
+ * last samples measured so far.
+ * @param self
+ * @param channel Channel index
+ * @return True peak in dBTP, or -HUGE_VAL for digital silence
+ */
+double loudnessMeterGetTruePeak(const LoudnessMeter self, ChannelCount channel);
+
+/**
+ * Free a meter and its results
+ * @param self
+ */
+void freeLoudnessMeter(LoudnessMeter self);
+
+#endif
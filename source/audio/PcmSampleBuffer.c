@@ -35,6 +35,23 @@
 #include <stdlib.h>
 #include <string.h>
 
+// SSE2 is part of the x86-64 baseline, so when the compiler targets it, the
+// vectorized conversions can be used without any runtime CPU detection.
+#if USE_SIMD && !USE_DOUBLE_SAMPLES &&                                         \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define PCM_SAMPLE_BUFFER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Packed 24-bit samples are shuffled with SSSE3, which is not part of the
+// x86-64 baseline, so it is only used when the compiler targets it (for
+// example with -march=native). audiofile builds have no packed samples.
+#if PCM_SAMPLE_BUFFER_SSE2 && !USE_AUDIOFILE && defined(__SSSE3__)
+#define PCM_SAMPLE_BUFFER_SSSE3 1
+#include <tmmintrin.h>
+#endif
+
 static SampleBuffer _getSampleBuffer(void *selfPtr) {
   PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
   return self->_super;
@@ -46,265 +63,877 @@ static double _getMaxPcmSampleValue(const PcmSampleBuffer self) {
   return pow(2.0, (double)(self->bitDepth - 1)) - 1.0;
 }
 
-static void _setSampleBuffer8Bit(void *selfPtr, SampleBuffer sampleBuffer) {
-  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
-  const double pcmSampleMax = _getMaxPcmSampleValue(self);
-  unsigned char *charSamples = (unsigned char *)(self->pcmSamples);
-  SampleCount index = 0;
+#if PCM_SAMPLE_BUFFER_SSE2
+// Swap the bytes of each 16-bit lane, which converts big-endian samples to the
+// processor's byte order and back. x86 processors are always little-endian.
+static __m128i _flipBytes16Sse2(const __m128i value) {
+#if PCM_SAMPLE_BUFFER_SSSE3
+  return _mm_shuffle_epi8(value, _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8,
+                                               11, 10, 13, 12, 15, 14));
+#else
+  return _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+#endif
+}
 
-  // 8-bit PCM samples are unsigned, so instead of relying on 2's compliment
-  // storage, we must map the samples from {-1.0 .. 1.0} - {0 .. 255}
-  for (SampleCount sample = 0; sample < sampleBuffer->blocksize; ++sample) {
-    for (ChannelCount channel = 0; channel < sampleBuffer->numChannels;
-         ++channel) {
-      charSamples[index++] =
-          (unsigned char)((sampleBuffer->samples[channel][sample] + 1.0f) *
-                          pcmSampleMax);
-    }
+// Swap the bytes of each 32-bit lane. Without SSSE3, the bytes of each 16-bit
+// half are swapped first, and then the halves themselves.
+static __m128i _flipBytes32Sse2(const __m128i value) {
+#if PCM_SAMPLE_BUFFER_SSSE3
+  return _mm_shuffle_epi8(value, _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10,
+                                               9, 8, 15, 14, 13, 12));
+#else
+  const __m128i flipped = _flipBytes16Sse2(value);
+  return _mm_shufflehi_epi16(
+      _mm_shufflelo_epi16(flipped, _MM_SHUFFLE(2, 3, 0, 1)),
+      _MM_SHUFFLE(2, 3, 0, 1));
+#endif
+}
+
+static __m128 _loadFloatsSse2(const float *floatSamples, const boolByte flip) {
+  return flip ? _mm_castsi128_ps(_flipBytes32Sse2(
+                    _mm_loadu_si128((const __m128i *)floatSamples)))
+              : _mm_loadu_ps(floatSamples);
+}
+
+static void _storeFloatsSse2(float *floatSamples, const __m128 value,
+                             const boolByte flip) {
+  if (flip) {
+    _mm_storeu_si128((__m128i *)floatSamples,
+                     _flipBytes32Sse2(_mm_castps_si128(value)));
+  } else {
+    _mm_storeu_ps(floatSamples, value);
   }
 }
 
-static void _setSampleBuffer16Bit(void *selfPtr, SampleBuffer sampleBuffer) {
-  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
-  const double pcmSampleMax = _getMaxPcmSampleValue(self);
-  short *shortSamples = (short *)(self->pcmSamples);
-  SampleCount index = 0;
+static __m128i _loadShortsSse2(const short *shortSamples,
+                               const boolByte flip) {
+  const __m128i value = _mm_loadu_si128((const __m128i *)shortSamples);
+  return flip ? _flipBytes16Sse2(value) : value;
+}
+
+static void _storeShortsSse2(short *shortSamples, const __m128i value,
+                             const boolByte flip) {
+  _mm_storeu_si128((__m128i *)shortSamples,
+                   flip ? _flipBytes16Sse2(value) : value);
+}
 
-  for (SampleCount sample = 0; sample < sampleBuffer->blocksize; ++sample) {
-    for (ChannelCount channel = 0; channel < sampleBuffer->numChannels;
-         ++channel) {
-      shortSamples[index++] =
-          (short)(sampleBuffer->samples[channel][sample] * pcmSampleMax);
+// Convert 4 samples to 32-bit integers with the same double precision multiply
+// and truncation as the scalar code. This keeps the output bit-identical.
+static __m128i _convertSamplesToPcmSse2(const Sample *samples,
+                                        const __m128d pcmSampleMax) {
+  const __m128 input = _mm_loadu_ps(samples);
+  const __m128i low =
+      _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtps_pd(input), pcmSampleMax));
+  const __m128i high = _mm_cvttpd_epi32(
+      _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(input, input)), pcmSampleMax));
+  return _mm_unpacklo_epi64(low, high);
+}
+
+// Interleave mono or stereo samples into 16-bit PCM, and return the number of
+// frames which were converted. Any remaining frames must be converted by the
+// caller. If flip is set, the samples are stored big-endian.
+static SampleCount _setSampleBuffer16BitSse2(short *shortSamples,
+                                             const SampleBuffer sampleBuffer,
+                                             const double pcmSampleMax,
+                                             const boolByte flip) {
+  const __m128d multiplier = _mm_set1_pd(pcmSampleMax);
+  const __m128i lowHalfMask = _mm_set1_epi32(0xffff);
+  SampleCount frame = 0;
+
+  if (sampleBuffer->numChannels == 1) {
+    for (; frame + 8 <= sampleBuffer->blocksize; frame += 8) {
+      __m128i first = _convertSamplesToPcmSse2(
+          sampleBuffer->samples[0] + frame, multiplier);
+      __m128i second = _convertSamplesToPcmSse2(
+          sampleBuffer->samples[0] + frame + 4, multiplier);
+      // Keep only the low 16 bits like the scalar cast to short, so that the
+      // saturating pack below never changes a value
+      first = _mm_srai_epi32(_mm_slli_epi32(first, 16), 16);
+      second = _mm_srai_epi32(_mm_slli_epi32(second, 16), 16);
+      _storeShortsSse2(shortSamples + frame, _mm_packs_epi32(first, second),
+                       flip);
+    }
+  } else if (sampleBuffer->numChannels == 2) {
+    for (; frame + 4 <= sampleBuffer->blocksize; frame += 4) {
+      const __m128i left = _convertSamplesToPcmSse2(
+          sampleBuffer->samples[0] + frame, multiplier);
+      const __m128i right = _convertSamplesToPcmSse2(
+          sampleBuffer->samples[1] + frame, multiplier);
+      // Each 32-bit lane holds one frame, with the left channel in the low half
+      _storeShortsSse2(shortSamples + frame * 2,
+                       _mm_or_si128(_mm_and_si128(left, lowHalfMask),
+                                    _mm_slli_epi32(right, 16)),
+                       flip);
     }
   }
+
+  return frame;
 }
 
-static void _setSampleBuffer24Bit(void *selfPtr, SampleBuffer sampleBuffer) {
-  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
-  const double pcmSampleMax = _getMaxPcmSampleValue(self);
-  int *intSamples = (int *)(self->pcmSamples);
-  SampleCount index = 0;
+// Convert 4 samples to 32-bit integers with TPDF dither, rounding and clipping
+// them to the 16-bit range. Each lane has its own xorshift generator, which is
+// the same one that ditherQuantize() uses.
+static __m128i _convertSamplesToDitheredPcmSse2(const Sample *samples,
+                                                const __m128 multiplier,
+                                                __m128i *randomState) {
+  const __m128i lowHalfMask = _mm_set1_epi32(0xffff);
+  __m128i random = *randomState;
+  __m128 noise;
+  __m128 value;
 
-  for (SampleCount sample = 0; sample < sampleBuffer->blocksize; ++sample) {
-    for (ChannelCount channel = 0; channel < sampleBuffer->numChannels;
-         ++channel) {
-      intSamples[index++] =
-          (int)(sampleBuffer->samples[channel][sample] * pcmSampleMax);
+  random = _mm_xor_si128(random, _mm_slli_epi32(random, 13));
+  random = _mm_xor_si128(random, _mm_srli_epi32(random, 17));
+  random = _mm_xor_si128(random, _mm_slli_epi32(random, 5));
+  *randomState = random;
+
+  noise = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(
+                         _mm_and_si128(random, lowHalfMask),
+                         _mm_srli_epi32(random, 16))),
+                     _mm_set1_ps(1.0f / 65536.0f));
+  value = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(samples), multiplier), noise);
+  // With NaN in the first operand, minps returns the second one, so NaN
+  // samples are clipped to full scale just like in ditherQuantize()
+  value = _mm_max_ps(_mm_min_ps(value, _mm_set1_ps(32767.0f)),
+                     _mm_set1_ps(-32768.0f));
+  return _mm_cvtps_epi32(value);
+}
+
+// Same as _setSampleBuffer16BitSse2(), but with TPDF dither. Noise shaping
+// feeds back the error of the previous sample in each channel, so it can't be
+// vectorized and is always done by the scalar code.
+static SampleCount _setSampleBuffer16BitDitheredSse2(
+    short *shortSamples, const SampleBuffer sampleBuffer,
+    const double pcmSampleMax, unsigned int *randomState, const boolByte flip) {
+  const __m128 multiplier = _mm_set1_ps((float)pcmSampleMax);
+  __m128i random = _mm_loadu_si128((const __m128i *)randomState);
+  SampleCount frame = 0;
+
+  if (sampleBuffer->numChannels == 1) {
+    for (; frame + 8 <= sampleBuffer->blocksize; frame += 8) {
+      const __m128i first = _convertSamplesToDitheredPcmSse2(
+          sampleBuffer->samples[0] + frame, multiplier, &random);
+      const __m128i second = _convertSamplesToDitheredPcmSse2(
+          sampleBuffer->samples[0] + frame + 4, multiplier, &random);
+      _storeShortsSse2(shortSamples + frame, _mm_packs_epi32(first, second),
+                       flip);
+    }
+  } else if (sampleBuffer->numChannels == 2) {
+    for (; frame + 4 <= sampleBuffer->blocksize; frame += 4) {
+      const __m128i left = _convertSamplesToDitheredPcmSse2(
+          sampleBuffer->samples[0] + frame, multiplier, &random);
+      const __m128i right = _convertSamplesToDitheredPcmSse2(
+          sampleBuffer->samples[1] + frame, multiplier, &random);
+      _storeShortsSse2(shortSamples + frame * 2,
+                       _mm_unpacklo_epi16(_mm_packs_epi32(left, left),
+                                          _mm_packs_epi32(right, right)),
+                       flip);
     }
   }
+
+  _mm_storeu_si128((__m128i *)randomState, random);
+  return frame;
 }
 
-static void _setSampleBuffer32Bit(void *selfPtr, SampleBuffer sampleBuffer) {
-  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
-  float *floatSamples = (float *)(self->pcmSamples);
-  SampleCount index = 0;
+// Deinterleave mono or stereo 16-bit PCM samples, and return the number of
+// frames which were converted. Dividing in single precision gives exactly the
+// same result as the scalar code's double precision divide, since the quotient
+// of a 16-bit integer and an odd divisor can never be a float rounding
+// midpoint. If flip is set, the PCM samples are big-endian.
+static SampleCount _setSamples16BitSse2(const short *shortSamples,
+                                        Samples *samples,
+                                        const ChannelCount numChannels,
+                                        const SampleCount blocksize,
+                                        const double pcmSampleMax,
+                                        const boolByte flip) {
+  const __m128 divisor = _mm_set1_ps((float)pcmSampleMax);
+  SampleCount frame = 0;
 
-  for (SampleCount sample = 0; sample < sampleBuffer->blocksize; ++sample) {
-    for (ChannelCount channel = 0; channel < sampleBuffer->numChannels;
-         ++channel) {
-      floatSamples[index++] = sampleBuffer->samples[channel][sample];
+  if (numChannels == 1) {
+    for (; frame + 8 <= blocksize; frame += 8) {
+      const __m128i pcm = _loadShortsSse2(shortSamples + frame, flip);
+      // Sign-extend each 16-bit sample to 32 bits
+      const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(pcm, pcm), 16);
+      const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(pcm, pcm), 16);
+      _mm_storeu_ps(samples[0] + frame,
+                    _mm_div_ps(_mm_cvtepi32_ps(low), divisor));
+      _mm_storeu_ps(samples[0] + frame + 4,
+                    _mm_div_ps(_mm_cvtepi32_ps(high), divisor));
+    }
+  } else if (numChannels == 2) {
+    for (; frame + 4 <= blocksize; frame += 4) {
+      const __m128i pcm = _loadShortsSse2(shortSamples + frame * 2, flip);
+      const __m128i left = _mm_srai_epi32(_mm_slli_epi32(pcm, 16), 16);
+      const __m128i right = _mm_srai_epi32(pcm, 16);
+      _mm_storeu_ps(samples[0] + frame,
+                    _mm_div_ps(_mm_cvtepi32_ps(left), divisor));
+      _mm_storeu_ps(samples[1] + frame,
+                    _mm_div_ps(_mm_cvtepi32_ps(right), divisor));
     }
   }
+
+  return frame;
 }
 
-static void _setSamples8Bit(void *selfPtr) {
-  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
-  Samples *samples = self->_super->samples;
-  unsigned char *charSamples = (unsigned char *)(self->pcmSamples);
-  const SampleCount numSamples =
-      self->_super->blocksize * self->_super->numChannels;
-  SampleCount sampleIndex = 0;
-  ChannelCount channelIndex = 0;
-  const double pcmSampleMax = _getMaxPcmSampleValue(self);
+// Deinterleave stereo 32-bit float samples, and return the number of frames
+// which were converted. If flip is set, the PCM samples are big-endian, and
+// mono samples are also converted.
+static SampleCount _setSamples32BitSse2(const float *floatSamples,
+                                        Samples *samples,
+                                        const ChannelCount numChannels,
+                                        const SampleCount blocksize,
+                                        const boolByte flip) {
+  SampleCount frame = 0;
 
-  for (SampleCount sample = 0; sample < numSamples; ++sample) {
-    samples[channelIndex++][sampleIndex] =
-        (Sample)((double)(charSamples[sample] - 127) / pcmSampleMax);
+  if (numChannels == 1 && flip) {
+    for (; frame + 4 <= blocksize; frame += 4) {
+      _mm_storeu_ps(samples[0] + frame,
+                    _loadFloatsSse2(floatSamples + frame, flip));
+    }
+  } else if (numChannels == 2) {
+    for (; frame + 4 <= blocksize; frame += 4) {
+      const __m128 first = _loadFloatsSse2(floatSamples + frame * 2, flip);
+      const __m128 second =
+          _loadFloatsSse2(floatSamples + frame * 2 + 4, flip);
+      _mm_storeu_ps(samples[0] + frame,
+                    _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+      _mm_storeu_ps(samples[1] + frame,
+                    _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+  }
 
-    if (channelIndex >= self->_super->numChannels) {
-      channelIndex = 0;
-      ++sampleIndex;
+  return frame;
+}
+
+// Interleave stereo or 4 channel samples into 32-bit float PCM, and return the
+// number of frames which were converted. The samples are only moved, so the
+// output is identical to the scalar code. If flip is set, the samples are
+// stored big-endian, and mono samples are also converted.
+static SampleCount _setSampleBuffer32BitSse2(float *floatSamples,
+                                             const SampleBuffer sampleBuffer,
+                                             const boolByte flip) {
+  Samples *samples = sampleBuffer->samples;
+  SampleCount frame = 0;
+
+  if (sampleBuffer->numChannels == 1 && flip) {
+    for (; frame + 4 <= sampleBuffer->blocksize; frame += 4) {
+      _storeFloatsSse2(floatSamples + frame, _mm_loadu_ps(samples[0] + frame),
+                       flip);
+    }
+  } else if (sampleBuffer->numChannels == 2) {
+    for (; frame + 4 <= sampleBuffer->blocksize; frame += 4) {
+      const __m128 left = _mm_loadu_ps(samples[0] + frame);
+      const __m128 right = _mm_loadu_ps(samples[1] + frame);
+      _storeFloatsSse2(floatSamples + frame * 2, _mm_unpacklo_ps(left, right),
+                       flip);
+      _storeFloatsSse2(floatSamples + frame * 2 + 4,
+                       _mm_unpackhi_ps(left, right), flip);
+    }
+  } else if (sampleBuffer->numChannels == 4) {
+    for (; frame + 4 <= sampleBuffer->blocksize; frame += 4) {
+      __m128 first = _mm_loadu_ps(samples[0] + frame);
+      __m128 second = _mm_loadu_ps(samples[1] + frame);
+      __m128 third = _mm_loadu_ps(samples[2] + frame);
+      __m128 fourth = _mm_loadu_ps(samples[3] + frame);
+      // After the transpose, each register holds all channels of one frame
+      _MM_TRANSPOSE4_PS(first, second, third, fourth);
+      _storeFloatsSse2(floatSamples + frame * 4, first, flip);
+      _storeFloatsSse2(floatSamples + frame * 4 + 4, second, flip);
+      _storeFloatsSse2(floatSamples + frame * 4 + 8, third, flip);
+      _storeFloatsSse2(floatSamples + frame * 4 + 12, fourth, flip);
     }
   }
+
+  return frame;
 }
+#endif
 
-static void _setSamples16Bit(void *selfPtr) {
-  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
-  Samples *samples = self->_super->samples;
-  short *shortSamples = (short *)(self->pcmSamples);
-  const SampleCount numSamples =
-      self->_super->blocksize * self->_super->numChannels;
-  SampleCount sampleIndex = 0;
-  ChannelCount channelIndex = 0;
-  const double pcmSampleMax = _getMaxPcmSampleValue(self);
+#if PCM_SAMPLE_BUFFER_SSSE3
+// Shuffle masks which move 4 packed 24-bit samples into the top 3 bytes of
+// each 32-bit lane, so that shifting right sign-extends them, and back
+static __m128i _get24BitUnpackMask(const boolByte littleEndian) {
+  return littleEndian ? _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8,
+                                      -1, 9, 10, 11)
+                      : _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6,
+                                      -1, 11, 10, 9);
+}
 
-  if (platformInfoIsLittleEndian() && self->littleEndian) {
-    for (SampleCount sample = 0; sample < numSamples; ++sample) {
-      samples[channelIndex++][sampleIndex] =
-          (Sample)((double)shortSamples[sample] / pcmSampleMax);
+static __m128i _get24BitPackMask(const boolByte littleEndian) {
+  return littleEndian ? _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+                                      -1, -1, -1, -1)
+                      : _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                      -1, -1, -1, -1);
+}
 
-      if (channelIndex >= self->_super->numChannels) {
-        channelIndex = 0;
-        ++sampleIndex;
-      }
+// Convert 4 packed samples to floating point. Like the 16-bit conversion,
+// dividing in single precision gives the same result as the scalar code,
+// since the binary expansion of a 24-bit integer divided by 2^23 - 1 repeats
+// every 23 bits and so can never round differently in double precision.
+static __m128 _unpack24BitSsse3(const byte *bytes, const __m128i mask,
+                                const __m128 divisor) {
+  const __m128i pcm = _mm_shuffle_epi8(
+      _mm_loadu_si128((const __m128i *)bytes), mask);
+  return _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(pcm, 8)), divisor);
+}
+
+// Deinterleave mono or stereo packed 24-bit samples, and return the number of
+// frames which were converted. Each load reads 16 bytes for 12 bytes of
+// samples, so the loops stop before reading past the end of the block.
+static SampleCount _setSamples24BitSsse3(const byte *bytes, Samples *samples,
+                                         const ChannelCount numChannels,
+                                         const SampleCount blocksize,
+                                         const double pcmSampleMax,
+                                         const boolByte littleEndian) {
+  const __m128i mask = _get24BitUnpackMask(littleEndian);
+  const __m128 divisor = _mm_set1_ps((float)pcmSampleMax);
+  SampleCount frame = 0;
+
+  if (numChannels == 1) {
+    for (; frame * 3 + 16 <= blocksize * 3; frame += 4) {
+      _mm_storeu_ps(samples[0] + frame,
+                    _unpack24BitSsse3(bytes + frame * 3, mask, divisor));
     }
-  } else {
-    short flippedSample;
+  } else if (numChannels == 2) {
+    for (; frame * 6 + 28 <= blocksize * 6; frame += 4) {
+      const __m128 first =
+          _unpack24BitSsse3(bytes + frame * 6, mask, divisor);
+      const __m128 second =
+          _unpack24BitSsse3(bytes + frame * 6 + 12, mask, divisor);
+      _mm_storeu_ps(samples[0] + frame,
+                    _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+      _mm_storeu_ps(samples[1] + frame,
+                    _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+  }
 
-    for (SampleCount sample = 0; sample < numSamples; ++sample) {
-      flippedSample = flipShortEndian(shortSamples[sample]);
-      samples[channelIndex++][sampleIndex] =
-          (Sample)((double)flippedSample / pcmSampleMax);
+  return frame;
+}
 
-      if (channelIndex >= self->_super->numChannels) {
-        channelIndex = 0;
-        ++sampleIndex;
-      }
+// Interleave mono or stereo samples into packed 24-bit PCM, and return the
+// number of frames which were converted. Each store writes 4 bytes past the
+// 12 bytes of samples, which are overwritten by the next store, so the loops
+// stop before writing past the end of the block.
+static SampleCount _setSampleBuffer24BitSsse3(byte *bytes,
+                                              const SampleBuffer sampleBuffer,
+                                              const double pcmSampleMax,
+                                              const boolByte littleEndian) {
+  const __m128i mask = _get24BitPackMask(littleEndian);
+  const __m128d multiplier = _mm_set1_pd(pcmSampleMax);
+  const SampleCount blocksize = sampleBuffer->blocksize;
+  SampleCount frame = 0;
+
+  if (sampleBuffer->numChannels == 1) {
+    for (; frame * 3 + 16 <= blocksize * 3; frame += 4) {
+      const __m128i pcm = _convertSamplesToPcmSse2(
+          sampleBuffer->samples[0] + frame, multiplier);
+      _mm_storeu_si128((__m128i *)(bytes + frame * 3),
+                       _mm_shuffle_epi8(pcm, mask));
+    }
+  } else if (sampleBuffer->numChannels == 2) {
+    for (; frame * 6 + 28 <= blocksize * 6; frame += 4) {
+      const __m128i left = _convertSamplesToPcmSse2(
+          sampleBuffer->samples[0] + frame, multiplier);
+      const __m128i right = _convertSamplesToPcmSse2(
+          sampleBuffer->samples[1] + frame, multiplier);
+      _mm_storeu_si128((__m128i *)(bytes + frame * 6),
+                       _mm_shuffle_epi8(_mm_unpacklo_epi32(left, right), mask));
+      _mm_storeu_si128((__m128i *)(bytes + frame * 6 + 12),
+                       _mm_shuffle_epi8(_mm_unpackhi_epi32(left, right), mask));
     }
   }
+
+  return frame;
+}
+#endif
+
+// Conversions of a single sample, which are expanded into the loops below.
+// Every read function converts the PCM sample at the given index in the
+// interleaved data, and every write function stores a sample at that index.
+static Sample _read8Bit(const void *pcmSamples, size_t index,
+                        double pcmSampleMax) {
+  return (Sample)(
+      (double)(((const unsigned char *)pcmSamples)[index] - 127) /
+      pcmSampleMax);
 }
 
-static void _setSamples24Bit(void *selfPtr) {
-  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
-  Samples *samples = self->_super->samples;
-  const SampleCount numSamples =
-      self->_super->blocksize * self->_super->numChannels;
-  SampleCount sampleIndex = 0;
-  ChannelCount channelIndex = 0;
-  const double pcmSampleMax = _getMaxPcmSampleValue(self);
+static Sample _read16Bit(const void *pcmSamples, size_t index,
+                         double pcmSampleMax) {
+  return (Sample)((double)((const short *)pcmSamples)[index] / pcmSampleMax);
+}
+
+static Sample _read16BitFlipped(const void *pcmSamples, size_t index,
+                                double pcmSampleMax) {
+  const unsigned short pcmSample =
+      (unsigned short)((const short *)pcmSamples)[index];
+  const short value = (short)flipShortEndian(pcmSample);
+  return (Sample)((double)value / pcmSampleMax);
+}
 
 #if USE_AUDIOFILE
-  int *intSamples = (int *)(self->pcmSamples);
+// audiofile expands 24-bit samples to 32-bit integers
+static Sample _read24Bit(const void *pcmSamples, size_t index,
+                         double pcmSampleMax) {
+  return (Sample)((double)((const int *)pcmSamples)[index] / pcmSampleMax);
+}
 
-  if (platformInfoIsLittleEndian() && self->littleEndian) {
-    for (SampleCount sample = 0; sample < numSamples; ++sample) {
-      samples[channelIndex++][sampleIndex] =
-          (Sample)((double)intSamples[sample] / pcmSampleMax);
+static Sample _read24BitFlipped(const void *pcmSamples, size_t index,
+                                double pcmSampleMax) {
+  const int value =
+      (int)flipIntEndian((unsigned int)((const int *)pcmSamples)[index]);
+  return (Sample)((double)value / pcmSampleMax);
+}
+#else
+// Without audiofile, 24-bit samples are packed into 3 bytes each, as they are
+// stored in files. Shift the top byte up to bit 31 and back down to
+// sign-extend the sample.
+static Sample _read24BitLittleEndian(const void *pcmSamples, size_t index,
+                                     double pcmSampleMax) {
+  const byte *bytes = (const byte *)pcmSamples + index * 3;
+  const int value = (int)(((unsigned int)bytes[2] << 24) |
+                          ((unsigned int)bytes[1] << 16) |
+                          ((unsigned int)bytes[0] << 8)) >>
+                    8;
+  return (Sample)((double)value / pcmSampleMax);
+}
 
-      if (channelIndex >= self->_super->numChannels) {
-        channelIndex = 0;
-        ++sampleIndex;
-      }
-    }
-  } else {
-    logWarn("Bit-flipping on 24-bit PCM data has not been tested, unexpected "
-            "output may occur");
-    int flippedSample;
+static Sample _read24BitBigEndian(const void *pcmSamples, size_t index,
+                                  double pcmSampleMax) {
+  const byte *bytes = (const byte *)pcmSamples + index * 3;
+  const int value = (int)(((unsigned int)bytes[0] << 24) |
+                          ((unsigned int)bytes[1] << 16) |
+                          ((unsigned int)bytes[2] << 8)) >>
+                    8;
+  return (Sample)((double)value / pcmSampleMax);
+}
+#endif
 
-    for (SampleCount sample = 0; sample < numSamples; ++sample) {
-      flippedSample = flipIntEndian(intSamples[sample]);
-      samples[channelIndex++][sampleIndex] =
-          (Sample)((double)flippedSample / pcmSampleMax);
+// 32-bit PCM files are usually not stored as 32-bit integer data (though the
+// WAVE standard does seem to allow this), but in most cases IEEE 32-bit floats
+// are just written directly to disk. In this case, we don't need to do any
+// sample conversion aside from bit flipping, if necessary.
+static Sample _read32Bit(const void *pcmSamples, size_t index,
+                         double pcmSampleMax) {
+  return (Sample)((const float *)pcmSamples)[index];
+}
 
-      if (channelIndex >= self->_super->numChannels) {
-        channelIndex = 0;
-        ++sampleIndex;
-      }
-    }
+static Sample _read32BitFlipped(const void *pcmSamples, size_t index,
+                                double pcmSampleMax) {
+  return (Sample)convertBigEndianFloatToPlatform(
+      ((const float *)pcmSamples)[index]);
+}
+
+// 8-bit PCM samples are unsigned, so instead of relying on 2's compliment
+// storage, we must map the samples from {-1.0 .. 1.0} - {0 .. 255}
+static void _write8Bit(void *pcmSamples, size_t index, Sample sample,
+                       double pcmSampleMax) {
+  ((unsigned char *)pcmSamples)[index] =
+      (unsigned char)((sample + 1.0f) * pcmSampleMax);
+}
+
+static void _write16Bit(void *pcmSamples, size_t index, Sample sample,
+                        double pcmSampleMax) {
+  ((short *)pcmSamples)[index] = (short)(sample * pcmSampleMax);
+}
+
+static void _write16BitFlipped(void *pcmSamples, size_t index, Sample sample,
+                               double pcmSampleMax) {
+  const short value = (short)(sample * pcmSampleMax);
+  ((short *)pcmSamples)[index] = (short)flipShortEndian((unsigned short)value);
+}
+
+#if USE_AUDIOFILE
+// audiofile expects 24-bit samples as 32-bit integers
+static void _write24Bit(void *pcmSamples, size_t index, Sample sample,
+                        double pcmSampleMax) {
+  ((int *)pcmSamples)[index] = (int)(sample * pcmSampleMax);
+}
+#else
+static void _pack24BitLittleEndian(byte *bytes, const int value) {
+  bytes[0] = (byte)(value & 0xff);
+  bytes[1] = (byte)((value >> 8) & 0xff);
+  bytes[2] = (byte)((value >> 16) & 0xff);
+}
+
+static void _pack24BitBigEndian(byte *bytes, const int value) {
+  bytes[0] = (byte)((value >> 16) & 0xff);
+  bytes[1] = (byte)((value >> 8) & 0xff);
+  bytes[2] = (byte)(value & 0xff);
+}
+
+static void _write24BitLittleEndian(void *pcmSamples, size_t index,
+                                    Sample sample, double pcmSampleMax) {
+  _pack24BitLittleEndian((byte *)pcmSamples + index * 3,
+                         (int)(sample * pcmSampleMax));
+}
+
+static void _write24BitBigEndian(void *pcmSamples, size_t index,
+                                 Sample sample, double pcmSampleMax) {
+  _pack24BitBigEndian((byte *)pcmSamples + index * 3,
+                      (int)(sample * pcmSampleMax));
+}
+#endif
+
+static void _write32Bit(void *pcmSamples, size_t index, Sample sample,
+                        double pcmSampleMax) {
+  ((float *)pcmSamples)[index] = (float)sample;
+}
+
+static void _write32BitFlipped(void *pcmSamples, size_t index, Sample sample,
+                               double pcmSampleMax) {
+  ((float *)pcmSamples)[index] = convertBigEndianFloatToPlatform((float)sample);
+}
+
+// Each conversion is expanded into loops for mono, stereo and 5.1 audio, where
+// the channel count is a constant so that the compiler can unroll the inner
+// loop over the channels and vectorize the frames. All other channel counts
+// use a generic loop, for which the channel count is passed as "numChannels".
+#define PCM_SAMPLE_BUFFER_READ_LOOP(name, channels, read)                      \
+  static void name(const void *pcmSamples, Samples *samples,                  \
+                   ChannelCount numChannels, SampleCount firstFrame,          \
+                   SampleCount blocksize, double pcmSampleMax) {              \
+    size_t index = (size_t)firstFrame * (size_t)(channels);                   \
+    (void)numChannels;                                                         \
+    for (SampleCount frame = firstFrame; frame < blocksize; ++frame) {        \
+      for (ChannelCount channel = 0; channel < (channels); ++channel) {       \
+        samples[channel][frame] = read(pcmSamples, index++, pcmSampleMax);    \
+      }                                                                        \
+    }                                                                          \
   }
 
+#define PCM_SAMPLE_BUFFER_WRITE_LOOP(name, channels, write)                    \
+  static void name(const Samples *samples, void *pcmSamples,                  \
+                   ChannelCount numChannels, SampleCount firstFrame,          \
+                   SampleCount blocksize, double pcmSampleMax) {              \
+    size_t index = (size_t)firstFrame * (size_t)(channels);                   \
+    (void)numChannels;                                                         \
+    for (SampleCount frame = firstFrame; frame < blocksize; ++frame) {        \
+      for (ChannelCount channel = 0; channel < (channels); ++channel) {       \
+        write(pcmSamples, index++, samples[channel][frame], pcmSampleMax);    \
+      }                                                                        \
+    }                                                                          \
+  }
+
+// Define the loops for one conversion, and a table of them which is indexed
+// by _getLoopIndex()
+#define PCM_SAMPLE_BUFFER_READ_LOOPS(read)                                     \
+  PCM_SAMPLE_BUFFER_READ_LOOP(read##Loop, numChannels, read)                  \
+  PCM_SAMPLE_BUFFER_READ_LOOP(read##MonoLoop, 1, read)                        \
+  PCM_SAMPLE_BUFFER_READ_LOOP(read##StereoLoop, 2, read)                      \
+  PCM_SAMPLE_BUFFER_READ_LOOP(read##SurroundLoop, 6, read)                    \
+  static const PcmSampleBufferReadFunc read##Loops[] = {                      \
+      read##Loop, read##MonoLoop, read##StereoLoop, read##SurroundLoop};
+
+#define PCM_SAMPLE_BUFFER_WRITE_LOOPS(write)                                   \
+  PCM_SAMPLE_BUFFER_WRITE_LOOP(write##Loop, numChannels, write)               \
+  PCM_SAMPLE_BUFFER_WRITE_LOOP(write##MonoLoop, 1, write)                     \
+  PCM_SAMPLE_BUFFER_WRITE_LOOP(write##StereoLoop, 2, write)                   \
+  PCM_SAMPLE_BUFFER_WRITE_LOOP(write##SurroundLoop, 6, write)                 \
+  static const PcmSampleBufferWriteFunc write##Loops[] = {                    \
+      write##Loop, write##MonoLoop, write##StereoLoop, write##SurroundLoop};
+
+PCM_SAMPLE_BUFFER_READ_LOOPS(_read8Bit)
+PCM_SAMPLE_BUFFER_READ_LOOPS(_read16Bit)
+PCM_SAMPLE_BUFFER_READ_LOOPS(_read16BitFlipped)
+#if USE_AUDIOFILE
+PCM_SAMPLE_BUFFER_READ_LOOPS(_read24Bit)
+PCM_SAMPLE_BUFFER_READ_LOOPS(_read24BitFlipped)
 #else
-  // audiofile will expand 24-bit samples to 32-bit integer quantities for us,
-  // but
-  // if we are not using audiofile, then we will need to do the expansion by
-  // hand.
-  char *charSamples = (char *)(self->pcmSamples);
-  int value;
+PCM_SAMPLE_BUFFER_READ_LOOPS(_read24BitLittleEndian)
+PCM_SAMPLE_BUFFER_READ_LOOPS(_read24BitBigEndian)
+#endif
+PCM_SAMPLE_BUFFER_READ_LOOPS(_read32Bit)
+PCM_SAMPLE_BUFFER_READ_LOOPS(_read32BitFlipped)
+PCM_SAMPLE_BUFFER_WRITE_LOOPS(_write8Bit)
+PCM_SAMPLE_BUFFER_WRITE_LOOPS(_write16Bit)
+PCM_SAMPLE_BUFFER_WRITE_LOOPS(_write16BitFlipped)
+#if USE_AUDIOFILE
+PCM_SAMPLE_BUFFER_WRITE_LOOPS(_write24Bit)
+#else
+PCM_SAMPLE_BUFFER_WRITE_LOOPS(_write24BitLittleEndian)
+PCM_SAMPLE_BUFFER_WRITE_LOOPS(_write24BitBigEndian)
+#endif
+PCM_SAMPLE_BUFFER_WRITE_LOOPS(_write32Bit)
+PCM_SAMPLE_BUFFER_WRITE_LOOPS(_write32BitFlipped)
 
-  if (self->littleEndian) {
-    for (size_t index = 0; index < numSamples * self->bytesPerSample;
-         index += 3) {
-      // If the topmost bit here is set, then we have a negative number and must
-      // take the 2's compliment of it.
-      if (charSamples[index + 2] & 0x80) {
-        value = 0xffffffff;
-        value &= (charSamples[index + 2] << 16) | 0xff000000;
-        value &= (charSamples[index + 1] << 8) | 0xffff0000;
-        value &= (charSamples[index]) | 0xffffff00;
-      } else {
-        value = 0;
-        value |= (charSamples[index + 2] << 16) & 0x00ff0000;
-        value |= (charSamples[index + 1] << 8) & 0x0000ff00;
-        value |= (charSamples[index]) & 0x000000ff;
-      }
+static size_t _getLoopIndex(ChannelCount numChannels) {
+  switch (numChannels) {
+  case 1:
+    return 1;
 
-      samples[channelIndex++][sampleIndex] =
-          (Sample)((double)value / pcmSampleMax);
+  case 2:
+    return 2;
 
-      if (channelIndex >= self->_super->numChannels) {
-        channelIndex = 0;
-        ++sampleIndex;
-      }
-    }
-  } else {
-    for (size_t index = 0; index < numSamples * self->bytesPerSample;
-         index += 3) {
-      // If the topmost bit here is set, then we have a negative number and must
-      // take the 2's compliment of it.
-      if (charSamples[index] & 0x80) {
-        value = 0xffffffff;
-        value &= (charSamples[index] << 16) | 0xff000000;
-        value &= (charSamples[index + 1] << 8) | 0xffff0000;
-        value &= (charSamples[index + 2]) | 0xffffff00;
-      } else {
-        value = 0;
-        value |= (charSamples[index] << 16) & 0x00ff0000;
-        value |= (charSamples[index + 1] << 8) & 0x0000ff00;
-        value |= (charSamples[index + 2]) & 0x000000ff;
-      }
+  case 6:
+    return 3;
 
-      samples[channelIndex++][sampleIndex] =
-          (Sample)((double)value / pcmSampleMax);
+  default:
+    return 0;
+  }
+}
 
-      if (channelIndex >= self->_super->numChannels) {
-        channelIndex = 0;
-        ++sampleIndex;
-      }
-    }
+// Select the conversion loops for the bit depth, byte order and channel count
+// of the buffer. They are only looked up again when the byte order or channel
+// count change, which usually happens only once after the buffer is opened.
+static void _selectLoops(PcmSampleBuffer self, ChannelCount numChannels) {
+  const boolByte native =
+      (boolByte)(platformInfoIsLittleEndian() && self->littleEndian);
+  const size_t loop = _getLoopIndex(numChannels);
+
+  if (self->_readLoop != NULL && self->_loopNumChannels == numChannels &&
+      self->_loopLittleEndian == self->littleEndian) {
+    return;
   }
 
+  switch (self->bitDepth) {
+  case kBitDepth8Bit:
+    self->_readLoop = _read8BitLoops[loop];
+    self->_writeLoop = _write8BitLoops[loop];
+    break;
+
+  case kBitDepth16Bit:
+    self->_readLoop =
+        native ? _read16BitLoops[loop] : _read16BitFlippedLoops[loop];
+    self->_writeLoop =
+        native ? _write16BitLoops[loop] : _write16BitFlippedLoops[loop];
+    break;
+
+  case kBitDepth24Bit:
+#if USE_AUDIOFILE
+    self->_readLoop =
+        native ? _read24BitLoops[loop] : _read24BitFlippedLoops[loop];
+    self->_writeLoop = _write24BitLoops[loop];
+#else
+    self->_readLoop = self->littleEndian ? _read24BitLittleEndianLoops[loop]
+                                         : _read24BitBigEndianLoops[loop];
+    self->_writeLoop = self->littleEndian ? _write24BitLittleEndianLoops[loop]
+                                          : _write24BitBigEndianLoops[loop];
 #endif
+    break;
+
+  case kBitDepth32Bit:
+    self->_readLoop =
+        native ? _read32BitLoops[loop] : _read32BitFlippedLoops[loop];
+    self->_writeLoop =
+        native ? _write32BitLoops[loop] : _write32BitFlippedLoops[loop];
+    break;
+
+  default:
+    logInternalError("Invalid bit depth");
+    return;
+  }
+
+  self->_loopNumChannels = numChannels;
+  self->_loopLittleEndian = self->littleEndian;
 }
 
-static void _setSamples32Bit(void *selfPtr) {
+// Returns the dither state for the current dither type, or NULL if samples
+// should be truncated without dither
+static Dither _getDither(PcmSampleBuffer self, ChannelCount numChannels) {
+  const DitherType ditherType = getDitherType();
+
+  if (ditherType == kDitherTypeNone) {
+    return NULL;
+  } else if (self->_dither == NULL || self->_dither->type != ditherType ||
+             self->_dither->numChannels < numChannels) {
+    freeDither(self->_dither);
+    self->_dither = newDither(ditherType, numChannels);
+  }
+
+  return self->_dither;
+}
+
+static void _setSampleBuffer8Bit(void *selfPtr, SampleBuffer sampleBuffer) {
   PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
-  Samples *samples = self->_super->samples;
-  float *floatSamples = (float *)(self->pcmSamples);
-  const SampleCount numSamples =
-      self->_super->blocksize * self->_super->numChannels;
-  SampleCount sampleIndex = 0;
-  ChannelCount channelIndex = 0;
-
-  // 32-bit PCM files are usually not stored as 32-bit integer data (though the
-  // WAVE standard does seem to allow this), but in most cases IEEE 32-bit
-  // floats
-  // are just written directly to disk. In this case, we don't need to do any
-  // sample conversion (aside from bit flipping, if necessary), basically we
-  // just
-  // interlace the data.
 
+  _selectLoops(self, sampleBuffer->numChannels);
+  self->_writeLoop(sampleBuffer->samples, self->pcmSamples,
+                   sampleBuffer->numChannels, 0, sampleBuffer->blocksize,
+                   _getMaxPcmSampleValue(self));
+}
+
+static void _store16Bit(PcmSampleBuffer self, size_t index, const int value) {
   if (platformInfoIsLittleEndian() && self->littleEndian) {
-    for (SampleCount sample = 0; sample < numSamples; ++sample) {
-      samples[channelIndex++][sampleIndex] = floatSamples[sample];
+    ((short *)self->pcmSamples)[index] = (short)value;
+  } else {
+    ((short *)self->pcmSamples)[index] =
+        (short)flipShortEndian((unsigned short)value);
+  }
+}
+
+static void _setSampleBuffer16Bit(void *selfPtr, SampleBuffer sampleBuffer) {
+  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
+  const double pcmSampleMax = _getMaxPcmSampleValue(self);
+  short *shortSamples = (short *)(self->pcmSamples);
+  Dither dither = _getDither(self, sampleBuffer->numChannels);
+  SampleCount firstSample = 0;
+  SampleCount index = 0;
+
+#if PCM_SAMPLE_BUFFER_SSE2
+  if (dither == NULL) {
+    firstSample = _setSampleBuffer16BitSse2(shortSamples, sampleBuffer,
+                                            pcmSampleMax, !self->littleEndian);
+  } else if (dither->type == kDitherTypeTpdf) {
+    firstSample = _setSampleBuffer16BitDitheredSse2(
+        shortSamples, sampleBuffer, pcmSampleMax, dither->randomState,
+        !self->littleEndian);
+  }
 
-      if (channelIndex >= self->_super->numChannels) {
-        channelIndex = 0;
-        ++sampleIndex;
+  index = firstSample * sampleBuffer->numChannels;
+#endif
+
+  if (dither != NULL) {
+    for (SampleCount sample = firstSample; sample < sampleBuffer->blocksize;
+         ++sample) {
+      for (ChannelCount channel = 0; channel < sampleBuffer->numChannels;
+           ++channel) {
+        _store16Bit(self, index++,
+                    ditherQuantize(dither, channel,
+                                   sampleBuffer->samples[channel][sample],
+                                   pcmSampleMax, 32767));
       }
     }
+
+    return;
+  }
+
+  _selectLoops(self, sampleBuffer->numChannels);
+  self->_writeLoop(sampleBuffer->samples, shortSamples,
+                   sampleBuffer->numChannels, firstSample,
+                   sampleBuffer->blocksize, pcmSampleMax);
+}
+
+static void _store24Bit(PcmSampleBuffer self, size_t index, const int value) {
+#if USE_AUDIOFILE
+  ((int *)self->pcmSamples)[index] = value;
+#else
+  if (self->littleEndian) {
+    _pack24BitLittleEndian((byte *)self->pcmSamples + index * 3, value);
   } else {
-    float flippedSample;
+    _pack24BitBigEndian((byte *)self->pcmSamples + index * 3, value);
+  }
+#endif
+}
 
-    for (SampleCount sample = 0; sample < numSamples; ++sample) {
-      flippedSample = convertBigEndianFloatToPlatform(floatSamples[sample]);
-      samples[channelIndex++][sampleIndex] = flippedSample;
+static void _setSampleBuffer24Bit(void *selfPtr, SampleBuffer sampleBuffer) {
+  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
+  const double pcmSampleMax = _getMaxPcmSampleValue(self);
+  Dither dither = _getDither(self, sampleBuffer->numChannels);
+  SampleCount firstFrame = 0;
+  size_t index = 0;
 
-      if (channelIndex >= self->_super->numChannels) {
-        channelIndex = 0;
-        ++sampleIndex;
+  if (dither != NULL) {
+    for (SampleCount sample = 0; sample < sampleBuffer->blocksize; ++sample) {
+      for (ChannelCount channel = 0; channel < sampleBuffer->numChannels;
+           ++channel) {
+        _store24Bit(self, index++,
+                    ditherQuantize(dither, channel,
+                                   sampleBuffer->samples[channel][sample],
+                                   pcmSampleMax, 8388607));
       }
     }
+
+    return;
+  }
+
+#if PCM_SAMPLE_BUFFER_SSSE3
+  firstFrame = _setSampleBuffer24BitSsse3(
+      (byte *)self->pcmSamples, sampleBuffer, pcmSampleMax, self->littleEndian);
+#endif
+
+  _selectLoops(self, sampleBuffer->numChannels);
+  self->_writeLoop(sampleBuffer->samples, self->pcmSamples,
+                   sampleBuffer->numChannels, firstFrame,
+                   sampleBuffer->blocksize, pcmSampleMax);
+}
+
+static void _setSampleBuffer32Bit(void *selfPtr, SampleBuffer sampleBuffer) {
+  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
+  SampleCount firstFrame = 0;
+
+#if !USE_DOUBLE_SAMPLES
+  // Mono float samples are already in the layout of the PCM data
+  if (sampleBuffer->numChannels == 1 && platformInfoIsLittleEndian() &&
+      self->littleEndian) {
+    memcpy(self->pcmSamples, sampleBuffer->samples[0],
+           sizeof(float) * sampleBuffer->blocksize);
+    return;
   }
+#endif
+
+#if PCM_SAMPLE_BUFFER_SSE2
+  firstFrame = _setSampleBuffer32BitSse2((float *)self->pcmSamples,
+                                         sampleBuffer, !self->littleEndian);
+#endif
+
+  _selectLoops(self, sampleBuffer->numChannels);
+  self->_writeLoop(sampleBuffer->samples, self->pcmSamples,
+                   sampleBuffer->numChannels, firstFrame,
+                   sampleBuffer->blocksize, _getMaxPcmSampleValue(self));
+}
+
+static void _setSamples8Bit(void *selfPtr) {
+  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
+
+  _selectLoops(self, self->_super->numChannels);
+  self->_readLoop(self->pcmSamples, self->_super->samples,
+                  self->_super->numChannels, 0, self->_super->blocksize,
+                  _getMaxPcmSampleValue(self));
+}
+
+static void _setSamples16Bit(void *selfPtr) {
+  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
+  const double pcmSampleMax = _getMaxPcmSampleValue(self);
+  SampleCount firstFrame = 0;
+
+#if PCM_SAMPLE_BUFFER_SSE2
+  firstFrame = _setSamples16BitSse2(
+      (const short *)self->pcmSamples, self->_super->samples,
+      self->_super->numChannels, self->_super->blocksize, pcmSampleMax,
+      !self->littleEndian);
+#endif
+
+  _selectLoops(self, self->_super->numChannels);
+  self->_readLoop(self->pcmSamples, self->_super->samples,
+                  self->_super->numChannels, firstFrame,
+                  self->_super->blocksize, pcmSampleMax);
+}
+
+static void _setSamples24Bit(void *selfPtr) {
+  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
+  const double pcmSampleMax = _getMaxPcmSampleValue(self);
+  SampleCount firstFrame = 0;
+
+#if USE_AUDIOFILE
+  if (!(platformInfoIsLittleEndian() && self->littleEndian)) {
+    logWarn("Bit-flipping on 24-bit PCM data has not been tested, unexpected "
+            "output may occur");
+  }
+#elif PCM_SAMPLE_BUFFER_SSSE3
+  firstFrame = _setSamples24BitSsse3(
+      (const byte *)self->pcmSamples, self->_super->samples,
+      self->_super->numChannels, self->_super->blocksize, pcmSampleMax,
+      self->littleEndian);
+#endif
+
+  _selectLoops(self, self->_super->numChannels);
+  self->_readLoop(self->pcmSamples, self->_super->samples,
+                  self->_super->numChannels, firstFrame,
+                  self->_super->blocksize, pcmSampleMax);
+}
+
+static void _setSamples32Bit(void *selfPtr) {
+  PcmSampleBuffer self = (PcmSampleBuffer)selfPtr;
+  SampleCount firstFrame = 0;
+
+#if PCM_SAMPLE_BUFFER_SSE2
+  firstFrame = _setSamples32BitSse2(
+      (const float *)self->pcmSamples, self->_super->samples,
+      self->_super->numChannels, self->_super->blocksize, !self->littleEndian);
+#endif
+
+  _selectLoops(self, self->_super->numChannels);
+  self->_readLoop(self->pcmSamples, self->_super->samples,
+                  self->_super->numChannels, firstFrame,
+                  self->_super->blocksize, 0.0);
 }
 
 PcmSampleBuffer newPcmSampleBuffer(ChannelCount numChannels,
@@ -318,14 +947,13 @@ PcmSampleBuffer newPcmSampleBuffer(ChannelCount numChannels,
   SampleCount pcmSampleBufferSize =
       numChannels * blocksize * pcmSampleBuffer->bytesPerSample;
 
+#if USE_AUDIOFILE
   if (bitDepth == kBitDepth24Bit) {
-    // For 24-bit samples, bytesPerSample is 3 but we store the values
-    // internally
-    // as regular 32-bit integers. This value is correct when reading samples
-    // from
-    // file, but it will cause us to overwrite memory when writing samples.
+    // audiofile expands 24-bit samples to regular 32-bit integers, so the
+    // buffer must be larger than bytesPerSample suggests
     pcmSampleBufferSize = numChannels * blocksize * sizeof(int);
   }
+#endif
 
   pcmSampleBuffer->pcmSamples = malloc(pcmSampleBufferSize);
   memset(pcmSampleBuffer->pcmSamples, 0, pcmSampleBufferSize);
@@ -357,12 +985,140 @@ PcmSampleBuffer newPcmSampleBuffer(ChannelCount numChannels,
   }
 
   pcmSampleBuffer->_super = newSampleBuffer(numChannels, blocksize);
+  pcmSampleBuffer->_dither = NULL;
+  pcmSampleBuffer->_readLoop = NULL;
+  pcmSampleBuffer->_writeLoop = NULL;
+  pcmSampleBuffer->_loopNumChannels = 0;
+  pcmSampleBuffer->_loopLittleEndian = false;
+  pcmSampleBuffer->_droppedChannels = NULL;
+  pcmSampleBuffer->_mappedChannels = NULL;
   return pcmSampleBuffer;
 }
 
+void pcmSampleBufferConvertToSampleBuffer(PcmSampleBuffer self,
+                                          const void *pcmSamples,
+                                          SampleBuffer sampleBuffer) {
+  void *ownPcmSamples = self->pcmSamples;
+  SampleBuffer ownSampleBuffer = self->_super;
+
+  // The setSamples() implementations only read from pcmSamples, so it is safe
+  // to point them at the caller's memory for the duration of the conversion.
+  self->pcmSamples = (void *)pcmSamples;
+  self->_super = sampleBuffer;
+  self->setSamples(self);
+  self->pcmSamples = ownPcmSamples;
+  self->_super = ownSampleBuffer;
+}
+
+// Returns channel pointers for converting PCM data with more channels than the
+// destination buffer, where the extra channels go to a scratch buffer
+static Samples *_getMappedChannels(PcmSampleBuffer self,
+                                   ChannelCount numChannels,
+                                   const SampleBuffer sampleBuffer) {
+  if (self->_droppedChannels == NULL ||
+      self->_droppedChannels->numChannels < numChannels ||
+      self->_droppedChannels->blocksize < sampleBuffer->blocksize) {
+    freeSampleBuffer(self->_droppedChannels);
+    free(self->_mappedChannels);
+    self->_droppedChannels =
+        newSampleBuffer(numChannels, sampleBuffer->blocksize);
+    self->_mappedChannels = (Samples *)malloc(sizeof(Samples) * numChannels);
+  }
+
+  for (ChannelCount channel = 0; channel < numChannels; ++channel) {
+    self->_mappedChannels[channel] =
+        channel < sampleBuffer->numChannels
+            ? sampleBuffer->samples[channel]
+            : self->_droppedChannels->samples[channel];
+  }
+
+  return self->_mappedChannels;
+}
+
+void pcmSampleBufferConvertAndMapChannels(PcmSampleBuffer self,
+                                          const void *pcmSamples,
+                                          ChannelCount numChannels,
+                                          SampleBuffer sampleBuffer) {
+  SampleBufferMembers target = *sampleBuffer;
+
+  if (numChannels == 0) {
+    sampleBufferClear(sampleBuffer);
+    return;
+  }
+
+  // Convert straight into the first channels of the destination, and repeat
+  // them in any further channels, for example L R L R for 2 -> 4 channels
+  target.numChannels = numChannels;
+
+  if (numChannels > sampleBuffer->numChannels) {
+    target.samples = _getMappedChannels(self, numChannels, sampleBuffer);
+  }
+
+  pcmSampleBufferConvertToSampleBuffer(self, pcmSamples, &target);
+
+  for (ChannelCount channel = numChannels; channel < sampleBuffer->numChannels;
+       ++channel) {
+    memcpy(sampleBuffer->samples[channel],
+           sampleBuffer->samples[channel % numChannels],
+           sizeof(Sample) * sampleBuffer->blocksize);
+  }
+}
+
+// Each sample goes through the same conversions as when it is read into a
+// SampleBuffer, scaled by the gain plugin and written back with
+// setSampleBuffer(), so the result is bit-identical to processing it that way
+static void _applyGain16Bit(const short *input, short *output,
+                            size_t numSamples, Sample gain) {
+  const double pcmSampleMax = 32767.0;
+  size_t i;
+
+  for (i = 0; i < numSamples; i++) {
+    _write16Bit(output, i, _read16Bit(input, i, pcmSampleMax) * gain,
+                pcmSampleMax);
+  }
+}
+
+static void _applyGain24Bit(const byte *input, byte *output,
+                            size_t numSamples, Sample gain) {
+  const double pcmSampleMax = 8388607.0;
+  const size_t numBytes = numSamples * 3;
+  Sample sample;
+  int value;
+  size_t i;
+
+  for (i = 0; i < numBytes; i += 3) {
+    // Shift the top byte up to bit 31 and back down to sign-extend the sample
+    value = (int)(((unsigned int)input[i + 2] << 24) |
+                  ((unsigned int)input[i + 1] << 16) |
+                  ((unsigned int)input[i] << 8)) >>
+            8;
+    sample = (Sample)((double)value / pcmSampleMax) * gain;
+    value = (int)(sample * pcmSampleMax);
+    output[i] = (byte)(value & 0xff);
+    output[i + 1] = (byte)((value >> 8) & 0xff);
+    output[i + 2] = (byte)((value >> 16) & 0xff);
+  }
+}
+
+boolByte pcmSamplesApplyGain(const void *input, void *output, size_t numSamples,
+                             BitDepth bitDepth, Sample gain) {
+  if (bitDepth == kBitDepth16Bit) {
+    _applyGain16Bit((const short *)input, (short *)output, numSamples, gain);
+  } else if (bitDepth == kBitDepth24Bit) {
+    _applyGain24Bit((const byte *)input, (byte *)output, numSamples, gain);
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
 void freePcmSampleBuffer(PcmSampleBuffer self) {
   if (self != NULL) {
     freeSampleBuffer(self->_super);
+    freeDither(self->_dither);
+    freeSampleBuffer(self->_droppedChannels);
+    free(self->_mappedChannels);
     free(self->pcmSamples);
     free(self);
   }
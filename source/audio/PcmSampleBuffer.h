@@ -28,6 +28,7 @@
 #define MrsWatson_PcmSampleBuffer_h
 
 #include "audio/AudioSettings.h"
+#include "audio/Dither.h"
 #include "audio/SampleBuffer.h"
 
 typedef SampleBuffer (*PcmSampleBufferGetSampleBufferFunc)(void *selfPtr);
@@ -37,6 +38,20 @@ typedef void (*PcmSampleBufferSetSampleBufferFunc)(void *selfPtr,
 
 typedef void (*PcmSampleBufferSetSamplesFunc)(void *selfPtr);
 
+typedef void (*PcmSampleBufferReadFunc)(const void *pcmSamples,
+                                        Samples *samples,
+                                        ChannelCount numChannels,
+                                        SampleCount firstFrame,
+                                        SampleCount blocksize,
+                                        double pcmSampleMax);
+
+typedef void (*PcmSampleBufferWriteFunc)(const Samples *samples,
+                                         void *pcmSamples,
+                                         ChannelCount numChannels,
+                                         SampleCount firstFrame,
+                                         SampleCount blocksize,
+                                         double pcmSampleMax);
+
 typedef struct {
   void *pcmSamples;
   BitDepth bitDepth;
@@ -48,12 +63,84 @@ typedef struct {
   PcmSampleBufferSetSamplesFunc setSamples;
 
   SampleBuffer _super;
+  // Created when setSampleBuffer() is first called with dithering enabled
+  Dither _dither;
+  // Conversion loops which are specialized for the channel count and byte
+  // order they were selected for
+  PcmSampleBufferReadFunc _readLoop;
+  PcmSampleBufferWriteFunc _writeLoop;
+  ChannelCount _loopNumChannels;
+  boolByte _loopLittleEndian;
+  // Created when PCM data with more channels than the destination buffer is
+  // converted, to hold the channels which are dropped
+  SampleBuffer _droppedChannels;
+  Samples *_mappedChannels;
 } PcmSampleBufferMembers;
 typedef PcmSampleBufferMembers *PcmSampleBuffer;
 
+/**
+ * Create a buffer which converts between floating point samples and integer
+ * PCM data. When converting to 16 or 24-bit PCM with setSampleBuffer(), the
+ * dither type from the audio settings is added during the conversion, see
+ * setDitherType().
+ * @param numChannels Number of channels
+ * @param blocksize Number of frames in the buffer
+ * @param bitDepth Bit depth of the PCM data
+ * @return New PCM sample buffer
+ */
 PcmSampleBuffer newPcmSampleBuffer(ChannelCount numChannels,
                                    SampleCount blocksize, BitDepth bitDepth);
 
+/**
+ * Convert interleaved PCM data from external memory, such as a memory-mapped
+ * file, directly into a sample buffer. This uses the same conversion as
+ * setSamples(), but neither the PCM data nor the converted samples pass
+ * through this object's own buffers.
+ * @param self
+ * @param pcmSamples PCM data in this buffer's bit depth and byte order, which
+ * must hold at least one block of the sample buffer's size
+ * @param sampleBuffer Destination buffer. Its channel count and blocksize
+ * determine how many samples are converted.
+ */
+void pcmSampleBufferConvertToSampleBuffer(PcmSampleBuffer self,
+                                          const void *pcmSamples,
+                                          SampleBuffer sampleBuffer);
+
+/**
+ * Convert interleaved PCM data directly into a sample buffer which may have a
+ * different number of channels. Channels are mapped in the same way as with
+ * sampleBufferCopyAndMapChannels(), but without converting the samples into a
+ * buffer of the PCM data's channel count and copying them from there.
+ * @param self
+ * @param pcmSamples PCM data in this buffer's bit depth and byte order, which
+ * must hold at least one block of the sample buffer's size
+ * @param numChannels Number of interleaved channels in the PCM data
+ * @param sampleBuffer Destination buffer. Its blocksize determines how many
+ * frames are converted.
+ */
+void pcmSampleBufferConvertAndMapChannels(PcmSampleBuffer self,
+                                          const void *pcmSamples,
+                                          ChannelCount numChannels,
+                                          SampleBuffer sampleBuffer);
+
+/**
+ * Scale little-endian integer PCM samples by a constant gain. The samples are
+ * converted, scaled and truncated exactly as when they are read into a sample
+ * buffer, processed by the internal gain plugin and written with
+ * setSampleBuffer() without dither, so the result is bit-identical to that.
+ * Like there, even a gain of 1 can change a sample by one step.
+ * @param input Interleaved PCM samples
+ * @param output Destination for the scaled samples, which may be the same as
+ * the input
+ * @param numSamples Number of samples in all channels
+ * @param bitDepth Bit depth of the samples, which must be 16 or 24. 24-bit
+ * samples are packed into 3 bytes each, as they are stored in files.
+ * @param gain Linear gain to apply
+ * @return False if the bit depth is not supported
+ */
+boolByte pcmSamplesApplyGain(const void *input, void *output, size_t numSamples,
+                             BitDepth bitDepth, Sample gain);
+
 void freePcmSampleBuffer(PcmSampleBuffer self);
 
 #endif
@@ -0,0 +1,359 @@
+//
+// Resampler.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "Resampler.h"
+
+#include "logging/EventLogger.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Same as in SampleBuffer.c, SSE2 is always available on x86-64
+#if USE_SIMD && !USE_DOUBLE_SAMPLES &&                                         \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define RESAMPLER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Settings for each quality preset. Longer filters have a steeper transition
+// and more stopband attenuation. The number of taps is always a multiple of 4
+// so that the filter can be processed in whole vectors.
+static const unsigned int kResamplerHalfTaps[NUM_RESAMPLER_QUALITIES] = {8, 16,
+                                                                         32};
+static const unsigned int kResamplerNumPhases[NUM_RESAMPLER_QUALITIES] = {
+    64, 256, 1024};
+static const double kResamplerKaiserBeta[NUM_RESAMPLER_QUALITIES] = {6.0, 8.0,
+                                                                     10.0};
+// Cutoff frequency relative to the lower of the two Nyquist frequencies
+static const double kResamplerPassband[NUM_RESAMPLER_QUALITIES] = {0.85, 0.92,
+                                                                   0.96};
+
+// M_PI is not part of C99
+static const double kResamplerPi = 3.14159265358979323846;
+
+// Zeroth order modified Bessel function of the first kind, for the window
+static double _besselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  int k;
+
+  for (k = 1; k < 50 && term > sum * 1e-12; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+  }
+
+  return sum;
+}
+
+static void _fillResamplerFilter(Resampler self, double cutoff, double beta) {
+  const unsigned int numTaps = self->halfTaps * 2;
+  double position, window, value, sum;
+  unsigned int phase, tap;
+  float *row;
+
+  for (phase = 0; phase <= self->numPhases; phase++) {
+    row = self->filter + phase * numTaps;
+    sum = 0.0;
+
+    // Tap 0 is the oldest of the input frames around the output frame
+    for (tap = 0; tap < numTaps; tap++) {
+      position = (double)phase / self->numPhases + self->halfTaps - 1 - tap;
+      window = 1.0 - (position / self->halfTaps) * (position / self->halfTaps);
+      window = window > 0.0 ? _besselI0(beta * sqrt(window)) / _besselI0(beta)
+                            : 0.0;
+      value = position == 0.0 ? cutoff
+                              : sin(kResamplerPi * cutoff * position) /
+                                    (kResamplerPi * position);
+      row[tap] = (float)(value * window);
+      sum += row[tap];
+    }
+
+    // Normalize each phase so that a constant signal is left unchanged
+    for (tap = 0; tap < numTaps; tap++) {
+      row[tap] = (float)(row[tap] / sum);
+    }
+  }
+}
+
+Resampler newResampler(ChannelCount numChannels, SampleRate inputRate,
+                       SampleRate outputRate, ResamplerQuality quality) {
+  Resampler resampler;
+  ChannelCount channel;
+
+  if (inputRate <= 0.0 || outputRate <= 0.0 ||
+      quality >= NUM_RESAMPLER_QUALITIES) {
+    logInternalError("Invalid resampler settings");
+    return NULL;
+  }
+
+  resampler = (Resampler)malloc(sizeof(ResamplerMembers));
+  resampler->numChannels = numChannels;
+  resampler->step = inputRate / outputRate;
+  resampler->halfTaps = kResamplerHalfTaps[quality];
+  resampler->numPhases = kResamplerNumPhases[quality];
+  resampler->filter = (float *)malloc(sizeof(float) * resampler->halfTaps * 2 *
+                                      (resampler->numPhases + 1));
+  resampler->coefficients =
+      (float *)malloc(sizeof(float) * resampler->halfTaps * 2);
+
+  // When lowering the sample rate, the cutoff has to be below the Nyquist
+  // frequency of the output to avoid aliasing
+  _fillResamplerFilter(resampler,
+                       kResamplerPassband[quality] *
+                           (resampler->step > 1.0 ? 1.0 / resampler->step
+                                                  : 1.0),
+                       kResamplerKaiserBeta[quality]);
+
+  // The filter starts out with silence before the first input frame
+  resampler->bufferCapacity = resampler->halfTaps * 4;
+  resampler->bufferFrames = resampler->halfTaps - 1;
+  resampler->bufferStart = -(long long)resampler->bufferFrames;
+  resampler->buffer = (Samples *)malloc(sizeof(Samples) * numChannels);
+
+  for (channel = 0; channel < numChannels; channel++) {
+    resampler->buffer[channel] =
+        (Samples)calloc(resampler->bufferCapacity, sizeof(Sample));
+  }
+
+  resampler->inputFrames = 0;
+  resampler->outputFrames = 0;
+  resampler->finished = false;
+  return resampler;
+}
+
+boolByte resamplerQualityFromString(const char *name,
+                                    ResamplerQuality *outQuality) {
+  if (name == NULL) {
+    return false;
+  } else if (strcmp(name, "low") == 0) {
+    *outQuality = RESAMPLER_QUALITY_LOW;
+  } else if (strcmp(name, "medium") == 0) {
+    *outQuality = RESAMPLER_QUALITY_MEDIUM;
+  } else if (strcmp(name, "high") == 0) {
+    *outQuality = RESAMPLER_QUALITY_HIGH;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+static void _reserveResamplerFrames(Resampler self, SampleCount numFrames) {
+  ChannelCount channel;
+
+  if (self->bufferFrames + numFrames <= self->bufferCapacity) {
+    return;
+  }
+
+  while (self->bufferFrames + numFrames > self->bufferCapacity) {
+    self->bufferCapacity *= 2;
+  }
+
+  for (channel = 0; channel < self->numChannels; channel++) {
+    self->buffer[channel] = (Samples)realloc(
+        self->buffer[channel], sizeof(Sample) * self->bufferCapacity);
+  }
+}
+
+void resamplerPush(Resampler self, const SampleBuffer input) {
+  ChannelCount channel;
+
+  if (self->finished) {
+    logInternalError("Cannot add input to a finished resampler");
+    return;
+  }
+
+  _reserveResamplerFrames(self, input->blocksize);
+
+  for (channel = 0; channel < self->numChannels; channel++) {
+    if (input->numChannels > 0) {
+      memcpy(self->buffer[channel] + self->bufferFrames,
+             input->samples[channel % input->numChannels],
+             sizeof(Sample) * input->blocksize);
+    } else {
+      memset(self->buffer[channel] + self->bufferFrames, 0,
+             sizeof(Sample) * input->blocksize);
+    }
+  }
+
+  self->bufferFrames += input->blocksize;
+  self->inputFrames += input->blocksize;
+}
+
+void resamplerFinish(Resampler self) {
+  const SampleCount padding = self->halfTaps * 2;
+  ChannelCount channel;
+
+  if (self->finished) {
+    return;
+  }
+
+  // The last output frames need input frames after the end of the input, which
+  // are silent
+  _reserveResamplerFrames(self, padding);
+
+  for (channel = 0; channel < self->numChannels; channel++) {
+    memset(self->buffer[channel] + self->bufferFrames, 0,
+           sizeof(Sample) * padding);
+  }
+
+  self->bufferFrames += padding;
+  self->finished = true;
+}
+
+static void _interpolateCoefficients(Resampler self, double fraction) {
+  const unsigned int numTaps = self->halfTaps * 2;
+  const double position = fraction * self->numPhases;
+  const unsigned int phase = (unsigned int)position;
+  const float weight = (float)(position - phase);
+  const float *first = self->filter + phase * numTaps;
+  const float *second = first + numTaps;
+  unsigned int tap = 0;
+
+#if RESAMPLER_SSE2
+  const __m128 weights = _mm_set1_ps(weight);
+  __m128 a, b;
+
+  for (; tap < numTaps; tap += 4) {
+    a = _mm_loadu_ps(first + tap);
+    b = _mm_loadu_ps(second + tap);
+    _mm_storeu_ps(self->coefficients + tap,
+                  _mm_add_ps(a, _mm_mul_ps(weights, _mm_sub_ps(b, a))));
+  }
+#endif
+
+  for (; tap < numTaps; tap++) {
+    self->coefficients[tap] = first[tap] + weight * (second[tap] - first[tap]);
+  }
+}
+
+static Sample _convolve(const float *coefficients, const Sample *input,
+                        unsigned int numTaps) {
+  unsigned int tap = 0;
+  Sample sum = 0.0f;
+
+#if RESAMPLER_SSE2
+  __m128 sums = _mm_setzero_ps();
+
+  for (; tap < numTaps; tap += 4) {
+    sums = _mm_add_ps(sums, _mm_mul_ps(_mm_loadu_ps(coefficients + tap),
+                                       _mm_loadu_ps(input + tap)));
+  }
+
+  sums = _mm_add_ps(sums, _mm_movehl_ps(sums, sums));
+  sums = _mm_add_ss(sums, _mm_shuffle_ps(sums, sums, 1));
+  sum = _mm_cvtss_f32(sums);
+#endif
+
+  for (; tap < numTaps; tap++) {
+    sum += coefficients[tap] * input[tap];
+  }
+
+  return sum;
+}
+
+// Drop the input frames which are before the filter of the next output frame
+static void _discardResamplerFrames(Resampler self) {
+  const long long firstNeeded =
+      (long long)floor((double)self->outputFrames * self->step) -
+      self->halfTaps + 1;
+  SampleCount numFrames;
+  ChannelCount channel;
+
+  if (firstNeeded <= self->bufferStart) {
+    return;
+  }
+
+  numFrames = (SampleCount)(firstNeeded - self->bufferStart);
+  numFrames = numFrames < self->bufferFrames ? numFrames : self->bufferFrames;
+
+  for (channel = 0; channel < self->numChannels; channel++) {
+    memmove(self->buffer[channel], self->buffer[channel] + numFrames,
+            sizeof(Sample) * (self->bufferFrames - numFrames));
+  }
+
+  self->bufferFrames -= numFrames;
+  self->bufferStart += numFrames;
+}
+
+SampleCount resamplerPull(Resampler self, SampleBuffer output,
+                          SampleCount offset) {
+  const unsigned int numTaps = self->halfTaps * 2;
+  const unsigned long long totalOutputFrames =
+      (unsigned long long)ceil((double)self->inputFrames / self->step - 1e-9);
+  SampleCount framesWritten = 0;
+  double position, whole;
+  long long first;
+  ChannelCount channel;
+
+  while (offset + framesWritten < output->blocksize) {
+    if (self->finished && self->outputFrames >= totalOutputFrames) {
+      break;
+    }
+
+    position = (double)self->outputFrames * self->step;
+    whole = floor(position);
+    first = (long long)whole - self->halfTaps + 1 - self->bufferStart;
+
+    if (first + numTaps > (long long)self->bufferFrames) {
+      // More input is needed for this frame
+      break;
+    }
+
+    _interpolateCoefficients(self, position - whole);
+
+    for (channel = 0; channel < output->numChannels; channel++) {
+      output->samples[channel][offset + framesWritten] =
+          channel < self->numChannels
+              ? _convolve(self->coefficients, self->buffer[channel] + first,
+                          numTaps)
+              : 0.0f;
+    }
+
+    self->outputFrames++;
+    framesWritten++;
+  }
+
+  _discardResamplerFrames(self);
+  return framesWritten;
+}
+
+void freeResampler(Resampler self) {
+  ChannelCount channel;
+
+  if (self != NULL) {
+    for (channel = 0; channel < self->numChannels; channel++) {
+      free(self->buffer[channel]);
+    }
+
+    free(self->buffer);
+    free(self->filter);
+    free(self->coefficients);
+    free(self);
+  }
+}
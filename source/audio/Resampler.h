@@ -0,0 +1,122 @@
+//
+// Resampler.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_Resampler_h
+#define MrsWatson_Resampler_h
+
+#include "audio/SampleBuffer.h"
+#include "base/Types.h"
+
+typedef enum {
+  RESAMPLER_QUALITY_LOW,
+  RESAMPLER_QUALITY_MEDIUM,
+  RESAMPLER_QUALITY_HIGH,
+  NUM_RESAMPLER_QUALITIES
+} ResamplerQuality;
+
+typedef struct {
+  ChannelCount numChannels;
+  // Distance between output frames, measured in input frames
+  double step;
+
+  // Windowed sinc filter with numPhases + 1 rows of 2 * halfTaps coefficients,
+  // where each row is the filter for one fractional position between two input
+  // frames. Positions in between are interpolated from the adjacent rows.
+  unsigned int halfTaps;
+  unsigned int numPhases;
+  float *filter;
+  float *coefficients;
+
+  // Input frames which have not been consumed yet. The first frame in each
+  // channel is the input frame with index bufferStart, which is negative at
+  // first since the filter starts out on silence.
+  Samples *buffer;
+  SampleCount bufferFrames;
+  SampleCount bufferCapacity;
+  long long bufferStart;
+
+  unsigned long long inputFrames;
+  unsigned long long outputFrames;
+  boolByte finished;
+} ResamplerMembers;
+typedef ResamplerMembers *Resampler;
+
+/**
+ * Create a streaming sample-rate converter based on a polyphase windowed sinc
+ * filter. Input is added with resamplerPush(), and converted frames are taken
+ * out again with resamplerPull().
+ * @param numChannels Number of channels to convert
+ * @param inputRate Sample rate of the input
+ * @param outputRate Sample rate of the output
+ * @param quality Filter length and steepness to use
+ * @return New resampler, or NULL if the rates or quality are invalid
+ */
+Resampler newResampler(ChannelCount numChannels, SampleRate inputRate,
+                       SampleRate outputRate, ResamplerQuality quality);
+
+/**
+ * Parse a quality preset name, which is either "low", "medium", or "high"
+ * @param name Name of the preset
+ * @param outQuality Set to the preset if the name was recognized
+ * @return True if the name was recognized
+ */
+boolByte resamplerQualityFromString(const char *name,
+                                    ResamplerQuality *outQuality);
+
+/**
+ * Add input frames to be converted. Channels are mapped in the same way as with
+ * sampleBufferCopyAndMapChannels().
+ * @param self
+ * @param input Buffer with blocksize frames of input
+ */
+void resamplerPush(Resampler self, const SampleBuffer input);
+
+/**
+ * Mark the end of the input. Afterwards, resamplerPull() converts the remaining
+ * frames, and then stops once the output has the same length as the input.
+ * @param self
+ */
+void resamplerFinish(Resampler self);
+
+/**
+ * Convert as many frames as possible with the input which has been pushed so
+ * far, and write them to a buffer.
+ * @param self
+ * @param output Buffer to write the converted frames to
+ * @param offset First frame in the output to write to. At most
+ * output->blocksize - offset frames are written.
+ * @return Number of frames written
+ */
+SampleCount resamplerPull(Resampler self, SampleBuffer output,
+                          SampleCount offset);
+
+/**
+ * Free a resampler and all associated memory
+ * @param self
+ */
+void freeResampler(Resampler self);
+
+#endif
@@ -29,6 +29,7 @@
 #include "audio/AudioSettings.h"
 #include "audio/SampleBuffer.h"
 #include "base/Endian.h"
+#include "base/MemoryUsage.h"
 #include "logging/EventLogger.h"
 
 #include <math.h>
@@ -36,26 +37,317 @@
 #include <stdlib.h>
 #include <string.h>
 
+// Same as in PcmSampleBuffer.c, SSE2 is always available on x86-64
+#if USE_SIMD && !USE_DOUBLE_SAMPLES &&                                         \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SAMPLE_BUFFER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX is not part of the x86-64 baseline, so the wider loops are only built
+// when the compiler targets it (for example with -march=native)
+#if SAMPLE_BUFFER_SSE2 && defined(__AVX__)
+#define SAMPLE_BUFFER_AVX 1
+#include <immintrin.h>
+#endif
+
+// Number of samples which fit into one alignment unit
+static const SampleCount kSampleBufferAlignmentInSamples =
+    SAMPLE_BUFFER_ALIGNMENT / sizeof(Sample);
+
+static size_t _sampleBufferGetStorageSize(const SampleBuffer self) {
+  return sizeof(Sample) * (size_t)self->_stride * self->numChannels +
+         SAMPLE_BUFFER_ALIGNMENT;
+}
+
 SampleBuffer newSampleBuffer(ChannelCount numChannels, SampleCount blocksize) {
   SampleBuffer sampleBuffer = (SampleBuffer)malloc(sizeof(SampleBufferMembers));
+  size_t alignedAddress;
+
   sampleBuffer->numChannels = numChannels;
   sampleBuffer->blocksize = blocksize;
   sampleBuffer->samples = (Samples *)malloc(sizeof(Samples) * numChannels);
 
+  // Pad each channel to a whole number of alignment units, so that every
+  // channel starts on an aligned address
+  sampleBuffer->_stride = (blocksize + kSampleBufferAlignmentInSamples - 1) /
+                          kSampleBufferAlignmentInSamples *
+                          kSampleBufferAlignmentInSamples;
+
+  // Allocate enough extra space to align the start of the first channel
+  sampleBuffer->_storage = malloc(_sampleBufferGetStorageSize(sampleBuffer));
+  memoryUsageAdd(kMemoryUsageSampleBuffers,
+                 _sampleBufferGetStorageSize(sampleBuffer));
+  alignedAddress = (size_t)sampleBuffer->_storage + SAMPLE_BUFFER_ALIGNMENT - 1;
+  alignedAddress &= ~((size_t)SAMPLE_BUFFER_ALIGNMENT - 1);
+
   for (ChannelCount i = 0; i < numChannels; i++) {
-    sampleBuffer->samples[i] = (Samples)malloc(sizeof(Sample) * blocksize);
+    sampleBuffer->samples[i] =
+        (Samples)alignedAddress + (size_t)i * sampleBuffer->_stride;
   }
 
   sampleBufferClear(sampleBuffer);
   return sampleBuffer;
 }
 
+SampleBuffer newSampleBufferWithChannels(ChannelCount numChannels,
+                                         SampleCount blocksize,
+                                         Samples const *channels) {
+  SampleBuffer sampleBuffer = (SampleBuffer)malloc(sizeof(SampleBufferMembers));
+
+  sampleBuffer->numChannels = numChannels;
+  sampleBuffer->blocksize = blocksize;
+  sampleBuffer->samples = (Samples *)malloc(sizeof(Samples) * numChannels);
+  // The channels may be anywhere in memory, so there is no common stride
+  sampleBuffer->_storage = NULL;
+  sampleBuffer->_stride = 0;
+
+  for (ChannelCount i = 0; i < numChannels; i++) {
+    sampleBuffer->samples[i] = channels[i];
+  }
+
+  return sampleBuffer;
+}
+
 void sampleBufferClear(SampleBuffer self) {
   for (ChannelCount i = 0; i < self->numChannels; i++) {
     memset(self->samples[i], 0, sizeof(Sample) * self->blocksize);
   }
 }
 
+static boolByte _samplesAreSilent(const Sample *samples,
+                                  SampleCount numberOfFrames) {
+  SampleCount i = 0;
+
+#if SAMPLE_BUFFER_SSE2
+  const __m128 zero = _mm_setzero_ps();
+
+  // NaN compares as not equal to zero, like in the scalar loop
+  for (; i + 4 <= numberOfFrames; i += 4) {
+    if (_mm_movemask_ps(_mm_cmpneq_ps(_mm_loadu_ps(samples + i), zero))) {
+      return false;
+    }
+  }
+#endif
+
+  for (; i < numberOfFrames; i++) {
+    if (samples[i] != 0.0f) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+boolByte sampleBufferIsSilent(const SampleBuffer self) {
+  for (ChannelCount i = 0; i < self->numChannels; i++) {
+    if (!_samplesAreSilent(self->samples[i], self->blocksize)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+#if SAMPLE_BUFFER_SSE2
+static Sample _getLargestValue(__m128 values) {
+  values = _mm_max_ps(values, _mm_shuffle_ps(values, values,
+                                             _MM_SHUFFLE(1, 0, 3, 2)));
+  values = _mm_max_ps(values, _mm_shuffle_ps(values, values,
+                                             _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtss_f32(values);
+}
+
+static Sample _getSmallestValue(__m128 values) {
+  values = _mm_min_ps(values, _mm_shuffle_ps(values, values,
+                                             _MM_SHUFFLE(1, 0, 3, 2)));
+  values = _mm_min_ps(values, _mm_shuffle_ps(values, values,
+                                             _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtss_f32(values);
+}
+#endif
+
+// In all of the vectorized comparisons below, the sample is the first operand
+// so that NaN is skipped, as it is with the comparisons in the scalar loops
+static Sample _getPeakOfSamples(const Sample *samples,
+                                SampleCount numberOfFrames, Sample peak) {
+  SampleCount i = 0;
+  Sample value;
+
+#if SAMPLE_BUFFER_SSE2
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  __m128 peaks = _mm_set1_ps(peak);
+#if SAMPLE_BUFFER_AVX
+  const __m256 wideAbsMask =
+      _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  __m256 widePeaks = _mm256_set1_ps(peak);
+
+  for (; i + 8 <= numberOfFrames; i += 8) {
+    widePeaks = _mm256_max_ps(
+        _mm256_and_ps(_mm256_loadu_ps(samples + i), wideAbsMask), widePeaks);
+  }
+
+  peaks = _mm_max_ps(_mm256_castps256_ps128(widePeaks),
+                     _mm256_extractf128_ps(widePeaks, 1));
+#endif
+
+  for (; i + 4 <= numberOfFrames; i += 4) {
+    peaks = _mm_max_ps(_mm_and_ps(_mm_loadu_ps(samples + i), absMask), peaks);
+  }
+
+  peak = _getLargestValue(peaks);
+#endif
+
+  for (; i < numberOfFrames; i++) {
+    value = (Sample)fabs(samples[i]);
+
+    if (value > peak) {
+      peak = value;
+    }
+  }
+
+  return peak;
+}
+
+Sample sampleBufferGetPeak(const SampleBuffer self) {
+  Sample peak = 0.0f;
+
+  for (ChannelCount i = 0; i < self->numChannels; i++) {
+    peak = _getPeakOfSamples(self->samples[i], self->blocksize, peak);
+  }
+
+  return peak;
+}
+
+static void _getRangeOfSamples(const Sample *samples,
+                               SampleCount numberOfFrames, Sample *minimum,
+                               Sample *maximum) {
+  SampleCount i = 0;
+
+#if SAMPLE_BUFFER_SSE2
+  __m128 minimums = _mm_set1_ps(*minimum);
+  __m128 maximums = _mm_set1_ps(*maximum);
+  __m128 current;
+#if SAMPLE_BUFFER_AVX
+  __m256 wideMinimums = _mm256_set1_ps(*minimum);
+  __m256 wideMaximums = _mm256_set1_ps(*maximum);
+  __m256 wideCurrent;
+
+  for (; i + 8 <= numberOfFrames; i += 8) {
+    wideCurrent = _mm256_loadu_ps(samples + i);
+    wideMinimums = _mm256_min_ps(wideCurrent, wideMinimums);
+    wideMaximums = _mm256_max_ps(wideCurrent, wideMaximums);
+  }
+
+  minimums = _mm_min_ps(_mm256_castps256_ps128(wideMinimums),
+                        _mm256_extractf128_ps(wideMinimums, 1));
+  maximums = _mm_max_ps(_mm256_castps256_ps128(wideMaximums),
+                        _mm256_extractf128_ps(wideMaximums, 1));
+#endif
+
+  for (; i + 4 <= numberOfFrames; i += 4) {
+    current = _mm_loadu_ps(samples + i);
+    minimums = _mm_min_ps(current, minimums);
+    maximums = _mm_max_ps(current, maximums);
+  }
+
+  *minimum = _getSmallestValue(minimums);
+  *maximum = _getLargestValue(maximums);
+#endif
+
+  for (; i < numberOfFrames; i++) {
+    if (samples[i] < *minimum) {
+      *minimum = samples[i];
+    }
+
+    if (samples[i] > *maximum) {
+      *maximum = samples[i];
+    }
+  }
+}
+
+void sampleBufferGetRange(const SampleBuffer self, Sample *minimum,
+                          Sample *maximum) {
+  *minimum = 0.0f;
+  *maximum = 0.0f;
+
+  if (self->numChannels == 0 || self->blocksize == 0) {
+    return;
+  }
+
+  *minimum = self->samples[0][0];
+  *maximum = self->samples[0][0];
+
+  for (ChannelCount i = 0; i < self->numChannels; i++) {
+    _getRangeOfSamples(self->samples[i], self->blocksize, minimum, maximum);
+  }
+}
+
+// Squares are summed in double precision, otherwise the small samples at the
+// end of a long buffer would be lost in the sum
+static double _getSumOfSquares(const Sample *samples,
+                               SampleCount numberOfFrames) {
+  SampleCount i = 0;
+  double sum = 0.0;
+
+#if SAMPLE_BUFFER_SSE2
+  __m128d sums = _mm_setzero_pd();
+  __m128 current;
+  __m128d low;
+  __m128d high;
+#if SAMPLE_BUFFER_AVX
+  __m256d wideSums = _mm256_setzero_pd();
+  __m256d wideCurrent;
+
+  for (; i + 4 <= numberOfFrames; i += 4) {
+    wideCurrent = _mm256_cvtps_pd(_mm_loadu_ps(samples + i));
+    wideSums = _mm256_add_pd(wideSums, _mm256_mul_pd(wideCurrent, wideCurrent));
+  }
+
+  sums = _mm_add_pd(_mm256_castpd256_pd128(wideSums),
+                    _mm256_extractf128_pd(wideSums, 1));
+#endif
+
+  for (; i + 4 <= numberOfFrames; i += 4) {
+    current = _mm_loadu_ps(samples + i);
+    low = _mm_cvtps_pd(current);
+    high = _mm_cvtps_pd(_mm_movehl_ps(current, current));
+    sums = _mm_add_pd(sums, _mm_add_pd(_mm_mul_pd(low, low),
+                                       _mm_mul_pd(high, high)));
+  }
+
+  sum = _mm_cvtsd_f64(_mm_add_sd(sums, _mm_unpackhi_pd(sums, sums)));
+#endif
+
+  for (; i < numberOfFrames; i++) {
+    sum += (double)samples[i] * (double)samples[i];
+  }
+
+  return sum;
+}
+
+double sampleBufferGetRms(const SampleBuffer self) {
+  double sum = 0.0;
+
+  if (self->numChannels == 0 || self->blocksize == 0) {
+    return 0.0;
+  }
+
+  for (ChannelCount i = 0; i < self->numChannels; i++) {
+    sum += _getSumOfSquares(self->samples[i], self->blocksize);
+  }
+
+  return sqrt(sum / ((double)self->numChannels * self->blocksize));
+}
+
+void sampleBufferClearWithOffset(SampleBuffer self, SampleCount offset,
+                                 SampleCount numberOfFrames) {
+  for (ChannelCount i = 0; i < self->numChannels; i++) {
+    memset(self->samples[i] + offset, 0, sizeof(Sample) * numberOfFrames);
+  }
+}
+
 boolByte sampleBufferCopyAndMapChannelsWithOffset(
     SampleBuffer destinationBuffer, SampleCount destinationOffset,
     const SampleBuffer sourceBuffer, SampleCount sourceOffset,
@@ -76,8 +368,8 @@ boolByte sampleBufferCopyAndMapChannelsWithOffset(
   }
 
   if (sourceBuffer->numChannels != destinationBuffer->numChannels) {
-    logDebug("Mapping channels from %d -> %d", sourceBuffer->numChannels,
-             destinationBuffer->numChannels);
+    logDebugFast("Mapping channels from %d -> %d", sourceBuffer->numChannels,
+                 destinationBuffer->numChannels);
   }
 
   // If the other buffer is bigger (or the same size) as this buffer, then only
@@ -124,12 +416,193 @@ boolByte sampleBufferCopyAndMapChannels(SampleBuffer self,
                                                   self->blocksize);
 }
 
+static void _copySamplesWithGain(Samples destination, const Samples source,
+                                 SampleCount numberOfFrames, Sample gain) {
+  SampleCount i = 0;
+
+#if SAMPLE_BUFFER_SSE2
+  const __m128 multiplier = _mm_set1_ps(gain);
+#if SAMPLE_BUFFER_AVX
+  const __m256 wideMultiplier = _mm256_set1_ps(gain);
+
+  for (; i + 8 <= numberOfFrames; i += 8) {
+    _mm256_storeu_ps(destination + i,
+                     _mm256_mul_ps(_mm256_loadu_ps(source + i),
+                                   wideMultiplier));
+  }
+#endif
+
+  for (; i + 4 <= numberOfFrames; i += 4) {
+    _mm_storeu_ps(destination + i,
+                  _mm_mul_ps(_mm_loadu_ps(source + i), multiplier));
+  }
+#endif
+
+  for (; i < numberOfFrames; i++) {
+    destination[i] = source[i] * gain;
+  }
+}
+
+static void _mixSamplesWithGain(Samples destination, const Samples source,
+                                SampleCount numberOfFrames, Sample gain) {
+  SampleCount i = 0;
+
+  // The multiply and add are separate instructions like in the scalar loop,
+  // so the result does not depend on which of the loops mixed a sample
+#if SAMPLE_BUFFER_SSE2
+  const __m128 multiplier = _mm_set1_ps(gain);
+#if SAMPLE_BUFFER_AVX
+  const __m256 wideMultiplier = _mm256_set1_ps(gain);
+
+  for (; i + 8 <= numberOfFrames; i += 8) {
+    _mm256_storeu_ps(
+        destination + i,
+        _mm256_add_ps(_mm256_loadu_ps(destination + i),
+                      _mm256_mul_ps(_mm256_loadu_ps(source + i),
+                                    wideMultiplier)));
+  }
+#endif
+
+  for (; i + 4 <= numberOfFrames; i += 4) {
+    _mm_storeu_ps(destination + i,
+                  _mm_add_ps(_mm_loadu_ps(destination + i),
+                             _mm_mul_ps(_mm_loadu_ps(source + i),
+                                        multiplier)));
+  }
+#endif
+
+  for (; i < numberOfFrames; i++) {
+    destination[i] += source[i] * gain;
+  }
+}
+
+static void _copySamplesWithClip(Samples destination, const Samples source,
+                                 SampleCount numberOfFrames, Sample limit) {
+  SampleCount i = 0;
+
+#if SAMPLE_BUFFER_SSE2
+  const __m128 upper = _mm_set1_ps(limit);
+  const __m128 lower = _mm_set1_ps(-limit);
+
+  // The sample is the second operand so that NaN passes through unchanged, as
+  // it does with the comparisons in the scalar loop
+  for (; i + 4 <= numberOfFrames; i += 4) {
+    _mm_storeu_ps(destination + i,
+                  _mm_max_ps(lower, _mm_min_ps(upper,
+                                               _mm_loadu_ps(source + i))));
+  }
+#endif
+
+  for (; i < numberOfFrames; i++) {
+    destination[i] = source[i] > limit
+                         ? limit
+                         : (source[i] < -limit ? -limit : source[i]);
+  }
+}
+
+typedef void (*_SampleBufferCopyFunc)(Samples destination,
+                                      const Samples source,
+                                      SampleCount numberOfFrames,
+                                      Sample value);
+
+static boolByte _copyAndMapChannelsWith(SampleBuffer self,
+                                        const SampleBuffer buffer,
+                                        _SampleBufferCopyFunc copyFunc,
+                                        Sample value) {
+  if (self->blocksize != buffer->blocksize) {
+    logInternalError("Source and destination buffer are not the same size");
+    return false;
+  }
+
+  // Channels are mapped like in sampleBufferCopyAndMapChannelsWithOffset()
+  for (ChannelCount i = 0; i < self->numChannels; ++i) {
+    if (buffer->numChannels > 0) {
+      copyFunc(self->samples[i], buffer->samples[i % buffer->numChannels],
+               self->blocksize, value);
+    } else {
+      memset(self->samples[i], 0, sizeof(Sample) * self->blocksize);
+    }
+  }
+
+  return true;
+}
+
+boolByte sampleBufferCopyAndMapChannelsWithGain(SampleBuffer self,
+                                                const SampleBuffer buffer,
+                                                Sample gain) {
+  return _copyAndMapChannelsWith(self, buffer, _copySamplesWithGain, gain);
+}
+
+boolByte sampleBufferCopyAndMapChannelsWithClip(SampleBuffer self,
+                                                const SampleBuffer buffer,
+                                                Sample limit) {
+  return _copyAndMapChannelsWith(self, buffer, _copySamplesWithClip, limit);
+}
+
+void sampleBufferScale(SampleBuffer self, Sample gain) {
+  for (ChannelCount i = 0; i < self->numChannels; i++) {
+    _copySamplesWithGain(self->samples[i], self->samples[i], self->blocksize,
+                         gain);
+  }
+}
+
+boolByte sampleBufferMixWithOffset(SampleBuffer destinationBuffer,
+                                   SampleCount destinationOffset,
+                                   const SampleBuffer sourceBuffer,
+                                   SampleCount sourceOffset,
+                                   SampleCount numberOfFrames, Sample gain) {
+  if (destinationBuffer->blocksize < destinationOffset + numberOfFrames) {
+    logInternalError("Destination buffer size %d < %d",
+                     destinationBuffer->blocksize,
+                     destinationOffset + numberOfFrames);
+    return false;
+  }
+
+  if (sourceBuffer->blocksize < sourceOffset + numberOfFrames) {
+    logInternalError("Source buffer size %d < %d", sourceBuffer->blocksize,
+                     sourceOffset + numberOfFrames);
+    return false;
+  }
+
+  // Channels are mapped like in sampleBufferCopyAndMapChannelsWithOffset(),
+  // except that a buffer without channels adds nothing
+  if (sourceBuffer->numChannels == 0) {
+    return true;
+  }
+
+  for (ChannelCount i = 0; i < destinationBuffer->numChannels; ++i) {
+    _mixSamplesWithGain(
+        destinationBuffer->samples[i] + destinationOffset,
+        sourceBuffer->samples[i % sourceBuffer->numChannels] + sourceOffset,
+        numberOfFrames, gain);
+  }
+
+  return true;
+}
+
+boolByte sampleBufferMix(SampleBuffer self, const SampleBuffer buffer,
+                         Sample gain) {
+  if (self->blocksize != buffer->blocksize) {
+    logInternalError("Source and destination buffer are not the same size");
+    return false;
+  }
+
+  return sampleBufferMixWithOffset(self, 0, buffer, 0, self->blocksize, gain);
+}
+
+boolByte sampleBufferAdd(SampleBuffer self, const SampleBuffer buffer) {
+  return sampleBufferMix(self, buffer, 1.0f);
+}
+
 void freeSampleBuffer(SampleBuffer self) {
   if (self != NULL) {
-    for (ChannelCount channel = 0; channel < self->numChannels; ++channel) {
-      free(self->samples[channel]);
+    // Views into other buffers have no storage of their own
+    if (self->_storage != NULL) {
+      memoryUsageRemove(kMemoryUsageSampleBuffers,
+                        _sampleBufferGetStorageSize(self));
     }
 
+    free(self->_storage);
     free(self->samples);
     free(self);
   }
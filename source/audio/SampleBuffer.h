@@ -29,27 +29,100 @@
 
 #include "base/Types.h"
 
+/**
+ * Alignment in bytes of each channel in a SampleBuffer. This is enough for
+ * aligned vector loads and stores with any common SIMD instruction set, and
+ * matches the cache line size on most processors.
+ */
+#define SAMPLE_BUFFER_ALIGNMENT 64
+
 typedef struct {
   ChannelCount numChannels;
   SampleCount blocksize;
   Samples *samples;
+
+  // All channels are allocated in this one block of memory, and each entry in
+  // samples points into it. Each channel starts at an aligned address, and the
+  // channels are separated by _stride samples.
+  void *_storage;
+  SampleCount _stride;
 } SampleBufferMembers;
 typedef SampleBufferMembers *SampleBuffer;
 
 /**
- * Create a new SampleBuffer instance
+ * Create a new SampleBuffer instance. The samples of all channels are stored
+ * in a single allocation, and each channel starts on a boundary of
+ * SAMPLE_BUFFER_ALIGNMENT bytes.
  * @param numChannels Number of channels
  * @param blocksize Processing blocksize to use
  * @return An initialized SampleBuffer instance
  */
 SampleBuffer newSampleBuffer(ChannelCount numChannels, SampleCount blocksize);
 
+/**
+ * Create a SampleBuffer which uses sample memory owned by the caller, for
+ * example arrays which belong to a host application or a scripting language.
+ * No samples are copied, and the channels need not be aligned or contiguous.
+ * The caller must keep the channel memory alive for as long as the buffer is
+ * used, and freeSampleBuffer() will not free it.
+ * @param numChannels Number of channels
+ * @param blocksize Number of samples in each channel
+ * @param channels Array of numChannels pointers to the channel samples. The
+ * pointers are copied, so this array need not outlive the call.
+ * @return An initialized SampleBuffer instance
+ */
+SampleBuffer newSampleBufferWithChannels(ChannelCount numChannels,
+                                         SampleCount blocksize,
+                                         Samples const *channels);
+
 /**
  * Set all samples to zero
  * @param self
  */
 void sampleBufferClear(SampleBuffer self);
 
+/**
+ * Check if all samples in the buffer are zero, for example to detect silent
+ * passages which do not need to be processed.
+ * @param self
+ * @return True if every sample in each channel is zero
+ */
+boolByte sampleBufferIsSilent(const SampleBuffer self);
+
+/**
+ * Get the largest absolute sample value in the buffer
+ * @param self
+ * @return Peak of all channels, or 0 if the buffer is empty
+ */
+Sample sampleBufferGetPeak(const SampleBuffer self);
+
+/**
+ * Get the smallest and largest sample values in the buffer
+ * @param self
+ * @param minimum Set to the smallest sample of all channels, or 0 if the
+ * buffer is empty
+ * @param maximum Set to the largest sample of all channels, or 0 if the buffer
+ * is empty
+ */
+void sampleBufferGetRange(const SampleBuffer self, Sample *minimum,
+                          Sample *maximum);
+
+/**
+ * Get the root mean square level of the buffer
+ * @param self
+ * @return RMS of the samples in all channels, or 0 if the buffer is empty
+ */
+double sampleBufferGetRms(const SampleBuffer self);
+
+/**
+ * Set some samples in each channel to zero
+ * @param self
+ * @param offset Index of the first frame to clear
+ * @param numberOfFrames Number of frames to clear
+ */
+void sampleBufferClearWithOffset(SampleBuffer self, SampleCount offset,
+                                 SampleCount numberOfFrames);
+
 /**
  * Copy some samples from another buffer to this one
  * @param destinationBuffer
@@ -74,6 +147,79 @@ boolByte sampleBufferCopyAndMapChannelsWithOffset(
 boolByte sampleBufferCopyAndMapChannels(SampleBuffer self,
                                         const SampleBuffer buffer);
 
+/**
+ * Copy all samples from another buffer to this one and multiply them by a
+ * constant gain, in a single pass over the data. Channels are mapped in the
+ * same way as with sampleBufferCopyAndMapChannels().
+ * @param self
+ * @param buffer Other buffer to copy from, which may be the same as self
+ * @param gain Linear gain to apply
+ * @return True on success, false on failure
+ */
+boolByte sampleBufferCopyAndMapChannelsWithGain(SampleBuffer self,
+                                                const SampleBuffer buffer,
+                                                Sample gain);
+
+/**
+ * Copy all samples from another buffer to this one and clip them to the range
+ * of -limit to limit, in a single pass over the data. Channels are mapped in
+ * the same way as with sampleBufferCopyAndMapChannels().
+ * @param self
+ * @param buffer Other buffer to copy from, which may be the same as self
+ * @param limit Largest absolute value of the output samples
+ * @return True on success, false on failure
+ */
+boolByte sampleBufferCopyAndMapChannelsWithClip(SampleBuffer self,
+                                                const SampleBuffer buffer,
+                                                Sample limit);
+
+/**
+ * Multiply all samples by a constant gain
+ * @param self
+ * @param gain Linear gain to apply
+ */
+void sampleBufferScale(SampleBuffer self, Sample gain);
+
+/**
+ * Multiply some samples from another buffer by a constant gain and add them to
+ * this one. Channels are mapped in the same way as with
+ * sampleBufferCopyAndMapChannelsWithOffset(), except that a source buffer
+ * without any channels leaves the destination unchanged.
+ * @param destinationBuffer
+ * @param destinationOffset zero-based index of where to start in
+ * destinationBuffer.
+ * @param sourceBuffer Other buffer to mix from
+ * @param sourceOffset zero-based index of where to start in sourceBuffer.
+ * @param numberOfFrames number of frames to mix.
+ * @param gain Linear gain to apply to the source samples
+ * @return True on success, false on failure
+ */
+boolByte sampleBufferMixWithOffset(SampleBuffer destinationBuffer,
+                                   SampleCount destinationOffset,
+                                   const SampleBuffer sourceBuffer,
+                                   SampleCount sourceOffset,
+                                   SampleCount numberOfFrames, Sample gain);
+
+/**
+ * Multiply all samples from another buffer by a constant gain and add them to
+ * this one, for example to mix a dry signal into a processed one
+ * @param self
+ * @param buffer Other buffer to mix from, which may be the same as self
+ * @param gain Linear gain to apply to the samples of buffer
+ * @return True on success, false on failure
+ */
+boolByte sampleBufferMix(SampleBuffer self, const SampleBuffer buffer,
+                         Sample gain);
+
+/**
+ * Add all samples from another buffer to this one. This is the same as
+ * sampleBufferMix() with a gain of 1.
+ * @param self
+ * @param buffer Other buffer to add
+ * @return True on success, false on failure
+ */
+boolByte sampleBufferAdd(SampleBuffer self, const SampleBuffer buffer);
+
 /**
  * Free all memory used by a SampleBuffer instance
  * @param sampleBuffer
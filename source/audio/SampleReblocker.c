@@ -0,0 +1,242 @@
+//
+// SampleReblocker.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include "SampleReblocker.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static SampleCount _greatestCommonDivisor(SampleCount a, SampleCount b) {
+  SampleCount remainder;
+
+  while (b > 0) {
+    remainder = a % b;
+    a = b;
+    b = remainder;
+  }
+
+  return a;
+}
+
+SampleCount sampleReblockerGetLatency(SampleCount innerBlocksize,
+                                      SampleCount outerBlocksize) {
+  // After any number of outer blocks, the input FIFO holds the frames which
+  // did not fill an inner block. The output must already hold that many frames
+  // before they are processed.
+  if (innerBlocksize == 0) {
+    return 0;
+  } else if (outerBlocksize == 0) {
+    return innerBlocksize - 1;
+  }
+
+  return innerBlocksize -
+         _greatestCommonDivisor(innerBlocksize, outerBlocksize);
+}
+
+// Largest number of frames which is passed through the FIFOs at once. Longer
+// outer blocks are split into parts of this size.
+static SampleCount _sampleReblockerGetMaxPart(SampleReblocker self) {
+  return self->outerBlocksize > self->innerBlocksize ? self->outerBlocksize
+                                                     : self->innerBlocksize;
+}
+
+SampleReblocker newSampleReblocker(ChannelCount numInputs,
+                                   ChannelCount numOutputs,
+                                   SampleCount innerBlocksize,
+                                   SampleCount outerBlocksize) {
+  SampleReblocker self;
+  SampleCount capacity;
+
+  if (innerBlocksize == 0) {
+    return NULL;
+  }
+
+  self = (SampleReblocker)malloc(sizeof(SampleReblockerMembers));
+  self->numInputs = numInputs;
+  self->numOutputs = numOutputs;
+  self->innerBlocksize = innerBlocksize;
+  self->outerBlocksize = outerBlocksize;
+  self->latency = sampleReblockerGetLatency(innerBlocksize, outerBlocksize);
+  self->innerInputs = newSampleBuffer(numInputs, innerBlocksize);
+  self->innerOutputs = newSampleBuffer(numOutputs, innerBlocksize);
+
+  // Before a part is added, the input FIFO holds less than one inner block,
+  // and the output FIFO holds at most the latency after the part has been
+  // processed, so neither ever holds more than this
+  capacity = _sampleReblockerGetMaxPart(self) + innerBlocksize;
+  self->_inputRing = newSampleBuffer(numInputs, capacity);
+  self->_outputRing = newSampleBuffer(numOutputs, capacity);
+
+  sampleReblockerReset(self);
+  return self;
+}
+
+// Copy frames into a ring, wrapping around at its end. Channels which are
+// missing from the source are written as silence.
+static void _sampleReblockerWriteRing(SampleBuffer ring,
+                                      SampleCount writePosition,
+                                      const SampleBuffer source,
+                                      SampleCount sourceOffset,
+                                      SampleCount numFrames) {
+  const SampleCount capacity = ring->blocksize;
+  const SampleCount firstPart = writePosition + numFrames > capacity
+                                    ? capacity - writePosition
+                                    : numFrames;
+  ChannelCount channel;
+
+  for (channel = 0; channel < ring->numChannels; channel++) {
+    if (source != NULL && channel < source->numChannels) {
+      memcpy(ring->samples[channel] + writePosition,
+             source->samples[channel] + sourceOffset,
+             sizeof(Sample) * firstPart);
+      memcpy(ring->samples[channel],
+             source->samples[channel] + sourceOffset + firstPart,
+             sizeof(Sample) * (numFrames - firstPart));
+    } else {
+      memset(ring->samples[channel] + writePosition, 0,
+             sizeof(Sample) * firstPart);
+      memset(ring->samples[channel], 0,
+             sizeof(Sample) * (numFrames - firstPart));
+    }
+  }
+}
+
+static void _sampleReblockerReadRing(const SampleBuffer ring,
+                                     SampleCount readPosition,
+                                     SampleBuffer destination,
+                                     SampleCount destinationOffset,
+                                     SampleCount numFrames) {
+  const SampleCount capacity = ring->blocksize;
+  const SampleCount firstPart = readPosition + numFrames > capacity
+                                    ? capacity - readPosition
+                                    : numFrames;
+  ChannelCount channel;
+
+  for (channel = 0; channel < destination->numChannels; channel++) {
+    if (channel < ring->numChannels) {
+      memcpy(destination->samples[channel] + destinationOffset,
+             ring->samples[channel] + readPosition, sizeof(Sample) * firstPart);
+      memcpy(destination->samples[channel] + destinationOffset + firstPart,
+             ring->samples[channel], sizeof(Sample) * (numFrames - firstPart));
+    } else {
+      memset(destination->samples[channel] + destinationOffset, 0,
+             sizeof(Sample) * numFrames);
+    }
+  }
+}
+
+static void _sampleReblockerPushOutput(SampleReblocker self,
+                                       const SampleBuffer source,
+                                       SampleCount numFrames) {
+  const SampleCount capacity = self->_outputRing->blocksize;
+  _sampleReblockerWriteRing(
+      self->_outputRing,
+      (self->_outputReadPosition + self->_outputFrames) % capacity, source, 0,
+      numFrames);
+  self->_outputFrames += numFrames;
+}
+
+static void _sampleReblockerProcessPart(SampleReblocker self,
+                                        const SampleBuffer inputs,
+                                        SampleBuffer outputs,
+                                        SampleCount offset,
+                                        SampleCount numFrames,
+                                        SampleReblockerProcessFunc processFunc,
+                                        void *userData) {
+  const SampleCount inputCapacity = self->_inputRing->blocksize;
+  const SampleCount outputCapacity = self->_outputRing->blocksize;
+
+  _sampleReblockerWriteRing(
+      self->_inputRing,
+      (self->_inputReadPosition + self->_inputFrames) % inputCapacity, inputs,
+      offset, numFrames);
+  self->_inputFrames += numFrames;
+
+  while (self->_inputFrames >= self->innerBlocksize) {
+    _sampleReblockerReadRing(self->_inputRing, self->_inputReadPosition,
+                             self->innerInputs, 0, self->innerBlocksize);
+    self->_inputReadPosition =
+        (self->_inputReadPosition + self->innerBlocksize) % inputCapacity;
+    self->_inputFrames -= self->innerBlocksize;
+
+    self->innerInputs->blocksize = self->innerBlocksize;
+    self->innerOutputs->blocksize = self->innerBlocksize;
+    processFunc(userData, self->innerInputs, self->innerOutputs);
+    _sampleReblockerPushOutput(self, self->innerOutputs, self->innerBlocksize);
+  }
+
+  // Only blocks of an unexpected size can drain the output, in which case the
+  // missing frames become silence and the latency grows by as much
+  if (self->_outputFrames < numFrames) {
+    self->latency += numFrames - self->_outputFrames;
+    _sampleReblockerPushOutput(self, NULL, numFrames - self->_outputFrames);
+  }
+
+  _sampleReblockerReadRing(self->_outputRing, self->_outputReadPosition,
+                           outputs, offset, numFrames);
+  self->_outputReadPosition =
+      (self->_outputReadPosition + numFrames) % outputCapacity;
+  self->_outputFrames -= numFrames;
+}
+
+void sampleReblockerProcess(SampleReblocker self, const SampleBuffer inputs,
+                            SampleBuffer outputs,
+                            SampleReblockerProcessFunc processFunc,
+                            void *userData) {
+  const SampleCount maxPart = _sampleReblockerGetMaxPart(self);
+  SampleCount offset;
+  SampleCount numFrames;
+
+  outputs->blocksize = inputs->blocksize;
+
+  for (offset = 0; offset < inputs->blocksize; offset += numFrames) {
+    numFrames = inputs->blocksize - offset < maxPart
+                    ? inputs->blocksize - offset
+                    : maxPart;
+    _sampleReblockerProcessPart(self, inputs, outputs, offset, numFrames,
+                                processFunc, userData);
+  }
+}
+
+void sampleReblockerReset(SampleReblocker self) {
+  self->_inputReadPosition = 0;
+  self->_inputFrames = 0;
+  self->_outputReadPosition = 0;
+  self->_outputFrames = 0;
+  self->latency =
+      sampleReblockerGetLatency(self->innerBlocksize, self->outerBlocksize);
+  _sampleReblockerPushOutput(self, NULL, self->latency);
+}
+
+void freeSampleReblocker(SampleReblocker self) {
+  if (self == NULL) {
+    return;
+  }
+
+  freeSampleBuffer(self->innerInputs);
+  freeSampleBuffer(self->innerOutputs);
+  freeSampleBuffer(self->_inputRing);
+  freeSampleBuffer(self->_outputRing);
+  free(self);
+}
@@ -0,0 +1,130 @@
+//
+// SampleReblocker.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef MrsWatson_SampleReblocker_h
+#define MrsWatson_SampleReblocker_h
+
+#include "audio/SampleBuffer.h"
+#include "base/Types.h"
+
+/**
+ * Called by a reblocker for every inner block which is ready to be processed
+ * @param userData User data which was passed to sampleReblockerProcess()
+ * @param inputs Inner block of input, with exactly the inner blocksize
+ * @param outputs Buffer for the inner block of output, with the same blocksize
+ */
+typedef void (*SampleReblockerProcessFunc)(void *userData, SampleBuffer inputs,
+                                           SampleBuffer outputs);
+
+/**
+ * A reblocker lets a processor which needs blocks of one size run inside a
+ * chain which uses blocks of another size. Input is collected in a FIFO until
+ * there are enough frames for an inner block, and the processed output is
+ * queued in another FIFO, from which each outer block is taken. The output
+ * FIFO starts with enough silence that it never runs dry, which is the
+ * reblocker's latency.
+ *
+ * Both FIFOs are planar rings which are allocated along with the reblocker,
+ * so processing does not allocate any memory.
+ */
+typedef struct {
+  ChannelCount numInputs;
+  ChannelCount numOutputs;
+  SampleCount innerBlocksize;
+  SampleCount outerBlocksize;
+  // Frames of silence which the output starts with, plus any silence which was
+  // added because a block of an unexpected size drained the output
+  SampleCount latency;
+
+  // Blocks which are passed to the process function
+  SampleBuffer innerInputs;
+  SampleBuffer innerOutputs;
+
+  SampleBuffer _inputRing;
+  SampleCount _inputReadPosition;
+  SampleCount _inputFrames;
+  SampleBuffer _outputRing;
+  SampleCount _outputReadPosition;
+  SampleCount _outputFrames;
+} SampleReblockerMembers;
+typedef SampleReblockerMembers *SampleReblocker;
+
+/**
+ * Get the latency which a reblocker adds, without creating one. When each
+ * outer block has the same size, this is the inner blocksize minus the
+ * greatest common divisor of both blocksizes, so a reblocker whose outer
+ * blocksize is a multiple of the inner one adds no latency at all.
+ * @param innerBlocksize Blocksize of the process function
+ * @param outerBlocksize Blocksize of each call to sampleReblockerProcess(), or
+ * 0 if the calls may have any size, in which case the latency is one frame
+ * less than the inner blocksize
+ * @return Latency in frames
+ */
+SampleCount sampleReblockerGetLatency(SampleCount innerBlocksize,
+                                      SampleCount outerBlocksize);
+
+/**
+ * Create a new reblocker
+ * @param numInputs Number of input channels
+ * @param numOutputs Number of output channels
+ * @param innerBlocksize Blocksize of the process function
+ * @param outerBlocksize Blocksize of each call to sampleReblockerProcess(), or
+ * 0 if the calls may have any size. Calls of other sizes are still processed,
+ * but may add silence to the output, making the latency longer.
+ * @return New reblocker, or NULL if the inner blocksize is 0
+ */
+SampleReblocker newSampleReblocker(ChannelCount numInputs,
+                                   ChannelCount numOutputs,
+                                   SampleCount innerBlocksize,
+                                   SampleCount outerBlocksize);
+
+/**
+ * Pass one outer block through the reblocker, calling the process function for
+ * every inner block which is completed by the input.
+ * @param self
+ * @param inputs Input block. Channels which are missing from the buffer are
+ * passed on as silence, and extra channels are ignored.
+ * @param outputs Buffer for the output block, which is given the blocksize of
+ * the input
+ * @param processFunc Function which processes each inner block
+ * @param userData Passed to the process function
+ */
+void sampleReblockerProcess(SampleReblocker self, const SampleBuffer inputs,
+                            SampleBuffer outputs,
+                            SampleReblockerProcessFunc processFunc,
+                            void *userData);
+
+/**
+ * Discard all queued frames, so that the output starts over with the latency
+ * @param self
+ */
+void sampleReblockerReset(SampleReblocker self);
+
+/**
+ * Free a reblocker and its buffers
+ * @param self
+ */
+void freeSampleReblocker(SampleReblocker self);
+
+#endif
@@ -0,0 +1,161 @@
+//
+// SampleRingBuffer.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SampleRingBuffer.h"
+
+#include "base/Thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+SampleRingBuffer newSampleRingBuffer(const ChannelCount numChannels,
+                                     const SampleCount minCapacity) {
+  SampleRingBuffer self =
+      (SampleRingBuffer)malloc(sizeof(SampleRingBufferMembers));
+
+  self->numChannels = numChannels;
+  self->capacity = 1;
+
+  while (self->capacity < minCapacity) {
+    self->capacity <<= 1;
+  }
+
+  self->samples =
+      (Sample *)calloc((size_t)(self->capacity * numChannels), sizeof(Sample));
+  self->_writeIndex = 0;
+  self->_readIndex = 0;
+  return self;
+}
+
+SampleCount sampleRingBufferGetReadable(SampleRingBuffer self) {
+  return (SampleCount)(atomicLoad(&self->_writeIndex) -
+                       atomicLoad(&self->_readIndex));
+}
+
+SampleCount sampleRingBufferGetWritable(SampleRingBuffer self) {
+  return self->capacity - sampleRingBufferGetReadable(self);
+}
+
+SampleCount sampleRingBufferWriteInterleaved(SampleRingBuffer self,
+                                             const Sample *frames,
+                                             const SampleCount numFrames) {
+  const unsigned int writeIndex = self->_writeIndex;
+  const SampleCount writable = sampleRingBufferGetWritable(self);
+  const SampleCount toWrite = numFrames < writable ? numFrames : writable;
+  const SampleCount start = (SampleCount)(writeIndex & (self->capacity - 1));
+  const SampleCount firstPart =
+      toWrite < self->capacity - start ? toWrite : self->capacity - start;
+
+  memcpy(self->samples + start * self->numChannels, frames,
+         (size_t)(firstPart * self->numChannels) * sizeof(Sample));
+  memcpy(self->samples, frames + firstPart * self->numChannels,
+         (size_t)((toWrite - firstPart) * self->numChannels) * sizeof(Sample));
+
+  // Publish the frames only after they have been copied
+  atomicStore(&self->_writeIndex, writeIndex + (unsigned int)toWrite);
+  return toWrite;
+}
+
+SampleCount sampleRingBufferReadInterleaved(SampleRingBuffer self,
+                                            Sample *frames,
+                                            const SampleCount numFrames) {
+  const unsigned int readIndex = self->_readIndex;
+  const SampleCount readable = sampleRingBufferGetReadable(self);
+  const SampleCount toRead = numFrames < readable ? numFrames : readable;
+  const SampleCount start = (SampleCount)(readIndex & (self->capacity - 1));
+  const SampleCount firstPart =
+      toRead < self->capacity - start ? toRead : self->capacity - start;
+
+  memcpy(frames, self->samples + start * self->numChannels,
+         (size_t)(firstPart * self->numChannels) * sizeof(Sample));
+  memcpy(frames + firstPart * self->numChannels, self->samples,
+         (size_t)((toRead - firstPart) * self->numChannels) * sizeof(Sample));
+
+  // Only hand the space back to the writer once it has been copied out
+  atomicStore(&self->_readIndex, readIndex + (unsigned int)toRead);
+  return toRead;
+}
+
+SampleCount sampleRingBufferWriteBlock(SampleRingBuffer self,
+                                       const SampleBuffer buffer) {
+  const unsigned int writeIndex = self->_writeIndex;
+  const SampleCount writable = sampleRingBufferGetWritable(self);
+  const SampleCount toWrite =
+      buffer->blocksize < writable ? buffer->blocksize : writable;
+  const SampleCount mask = self->capacity - 1;
+  SampleCount frame;
+  ChannelCount channel;
+
+  for (channel = 0; channel < self->numChannels; channel++) {
+    const Sample *source =
+        channel < buffer->numChannels ? buffer->samples[channel] : NULL;
+
+    for (frame = 0; frame < toWrite; frame++) {
+      const SampleCount position = (writeIndex + frame) & mask;
+      self->samples[position * self->numChannels + channel] =
+          source != NULL ? source[frame] : 0.0f;
+    }
+  }
+
+  atomicStore(&self->_writeIndex, writeIndex + (unsigned int)toWrite);
+  return toWrite;
+}
+
+SampleCount sampleRingBufferReadBlock(SampleRingBuffer self,
+                                      SampleBuffer buffer) {
+  const unsigned int readIndex = self->_readIndex;
+  const SampleCount readable = sampleRingBufferGetReadable(self);
+  const SampleCount toRead =
+      buffer->blocksize < readable ? buffer->blocksize : readable;
+  const SampleCount mask = self->capacity - 1;
+  SampleCount frame;
+  ChannelCount channel;
+
+  for (channel = 0; channel < buffer->numChannels; channel++) {
+    Sample *destination = buffer->samples[channel];
+
+    if (channel >= self->numChannels) {
+      memset(destination, 0, (size_t)toRead * sizeof(Sample));
+      continue;
+    }
+
+    for (frame = 0; frame < toRead; frame++) {
+      const SampleCount position = (readIndex + frame) & mask;
+      destination[frame] =
+          self->samples[position * self->numChannels + channel];
+    }
+  }
+
+  atomicStore(&self->_readIndex, readIndex + (unsigned int)toRead);
+  return toRead;
+}
+
+void freeSampleRingBuffer(SampleRingBuffer self) {
+  if (self != NULL) {
+    free(self->samples);
+    free(self);
+  }
+}
@@ -0,0 +1,122 @@
+//
+// SampleRingBuffer.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_SampleRingBuffer_h
+#define MrsWatson_SampleRingBuffer_h
+
+#include "audio/SampleBuffer.h"
+#include "base/Types.h"
+
+typedef struct {
+  ChannelCount numChannels;
+  // Number of frames which the ring can hold, always a power of two
+  SampleCount capacity;
+  // Interleaved samples
+  Sample *samples;
+
+  // Total number of frames written and read so far. These are allowed to wrap
+  // around, since only their difference is used. Only the writer stores
+  // _writeIndex and only the reader stores _readIndex.
+  volatile unsigned int _writeIndex;
+  volatile unsigned int _readIndex;
+} SampleRingBufferMembers;
+typedef SampleRingBufferMembers *SampleRingBuffer;
+
+/**
+ * Create a ring buffer which passes samples from one thread to another without
+ * locking, so it can be used from an audio device callback. Each ring may have
+ * only one reading and one writing thread.
+ * @param numChannels Number of channels
+ * @param minCapacity Minimum number of frames the ring must hold, this is
+ * rounded up to the next power of two
+ * @return New ring buffer
+ */
+SampleRingBuffer newSampleRingBuffer(const ChannelCount numChannels,
+                                     const SampleCount minCapacity);
+
+/**
+ * @param self
+ * @return Number of frames which can currently be read
+ */
+SampleCount sampleRingBufferGetReadable(SampleRingBuffer self);
+
+/**
+ * @param self
+ * @return Number of frames which can currently be written
+ */
+SampleCount sampleRingBufferGetWritable(SampleRingBuffer self);
+
+/**
+ * Write interleaved frames, as delivered by most audio device APIs.
+ * @param self
+ * @param frames Interleaved samples with the ring's number of channels
+ * @param numFrames Number of frames to write
+ * @return Number of frames written, which is less than numFrames if the ring
+ * did not have enough free space
+ */
+SampleCount sampleRingBufferWriteInterleaved(SampleRingBuffer self,
+                                             const Sample *frames,
+                                             const SampleCount numFrames);
+
+/**
+ * Read interleaved frames, as expected by most audio device APIs.
+ * @param self
+ * @param frames Interleaved samples with the ring's number of channels
+ * @param numFrames Number of frames to read
+ * @return Number of frames read, which is less than numFrames if the ring did
+ * not contain enough frames. The rest of the output is left untouched.
+ */
+SampleCount sampleRingBufferReadInterleaved(SampleRingBuffer self,
+                                            Sample *frames,
+                                            const SampleCount numFrames);
+
+/**
+ * Write all frames of a sample buffer. Channels which are missing from the
+ * buffer are written as silence, and extra channels are ignored.
+ * @param self
+ * @param buffer Buffer to write
+ * @return Number of frames written
+ */
+SampleCount sampleRingBufferWriteBlock(SampleRingBuffer self,
+                                       const SampleBuffer buffer);
+
+/**
+ * Read frames into a sample buffer, up to its blocksize. Channels which are
+ * missing from the ring are filled with silence.
+ * @param self
+ * @param buffer Buffer to read into
+ * @return Number of frames read
+ */
+SampleCount sampleRingBufferReadBlock(SampleRingBuffer self,
+                                      SampleBuffer buffer);
+
+/**
+ * Free a ring buffer and its associated resources
+ * @param self
+ */
+void freeSampleRingBuffer(SampleRingBuffer self);
+
+#endif
@@ -0,0 +1,132 @@
+//
+// TruePeak.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include "TruePeak.h"
+
+#include <math.h>
+
+// Same as in SampleBuffer.c, SSE2 is always available on x86-64
+#if USE_SIMD && !USE_DOUBLE_SAMPLES &&                                         \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TRUE_PEAK_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// M_PI is not part of C99
+static const double kTruePeakPi = 3.14159265358979323846;
+
+// Hann-windowed sinc, which interpolates between the two samples in the
+// middle of the filter
+void truePeakFillFilter(float *filter) {
+  const double halfWidth = TRUE_PEAK_FILTER_TAPS / 2.0;
+  double coefficients[TRUE_PEAK_FILTER_TAPS];
+  double position, sum;
+  unsigned int phase, tap;
+
+  for (phase = 0; phase < TRUE_PEAK_OVERSAMPLING; phase++) {
+    sum = 0.0;
+
+    for (tap = 0; tap < TRUE_PEAK_FILTER_TAPS; tap++) {
+      position = TRUE_PEAK_FILTER_DELAY - (double)tap -
+                 (double)phase / TRUE_PEAK_OVERSAMPLING;
+
+      if (position == 0.0) {
+        coefficients[tap] = 1.0;
+      } else if (fabs(position) >= halfWidth) {
+        coefficients[tap] = 0.0;
+      } else {
+        coefficients[tap] =
+            sin(kTruePeakPi * position) / (kTruePeakPi * position) * 0.5 *
+            (1.0 + cos(kTruePeakPi * position / halfWidth));
+      }
+
+      sum += coefficients[tap];
+    }
+
+    // Normalize each phase so that a constant signal is left unchanged
+    for (tap = 0; tap < TRUE_PEAK_FILTER_TAPS; tap++) {
+      filter[tap * TRUE_PEAK_OVERSAMPLING + phase] =
+          (float)(coefficients[tap] / sum);
+    }
+  }
+}
+
+// Find the largest absolute value of the interpolated samples between the two
+// samples in the middle of the history window, including the first of them
+static Sample _getTruePeak(const float *filter, const Samples window) {
+  unsigned int tap;
+
+#if TRUE_PEAK_SSE2
+  // All phases are computed at once, one in each lane
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+  __m128 sum = _mm_setzero_ps();
+
+  for (tap = 0; tap < TRUE_PEAK_FILTER_TAPS; tap++) {
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(filter + tap * 4),
+                                     _mm_set1_ps(window[-(int)tap])));
+  }
+
+  sum = _mm_andnot_ps(signMask, sum);
+  sum = _mm_max_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_max_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  return _mm_cvtss_f32(sum);
+#else
+  Sample sums[TRUE_PEAK_OVERSAMPLING] = {0.0f};
+  Sample peak = 0.0f;
+  unsigned int phase;
+
+  for (tap = 0; tap < TRUE_PEAK_FILTER_TAPS; tap++) {
+    for (phase = 0; phase < TRUE_PEAK_OVERSAMPLING; phase++) {
+      sums[phase] +=
+          filter[tap * TRUE_PEAK_OVERSAMPLING + phase] * window[-(int)tap];
+    }
+  }
+
+  for (phase = 0; phase < TRUE_PEAK_OVERSAMPLING; phase++) {
+    peak = fabsf(sums[phase]) > peak ? fabsf(sums[phase]) : peak;
+  }
+
+  return peak;
+#endif
+}
+
+unsigned int truePeakDetect(const float *filter, Samples history,
+                            unsigned int historyIndex, const Samples input,
+                            SampleCount numFrames, Sample *peaks) {
+  const unsigned int taps = TRUE_PEAK_FILTER_TAPS;
+  Sample peak;
+  SampleCount frame;
+
+  for (frame = 0; frame < numFrames; frame++) {
+    history[historyIndex] = input[frame];
+    history[historyIndex + taps] = input[frame];
+    // The newest sample is the last one in the window
+    peak = _getTruePeak(filter, history + historyIndex + taps);
+    peaks[frame] = peak > peaks[frame] ? peak : peaks[frame];
+    historyIndex = historyIndex + 1 < taps ? historyIndex + 1 : 0;
+  }
+
+  return historyIndex;
+}
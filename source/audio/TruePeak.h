@@ -0,0 +1,72 @@
+//
+// TruePeak.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef MrsWatson_TruePeak_h
+#define MrsWatson_TruePeak_h
+
+#include "base/Types.h"
+
+/**
+ * Number of phases of the oversampled peak detection. 4x oversampling is the
+ * same as used for true-peak measurement by ITU-R BS.1770.
+ */
+#define TRUE_PEAK_OVERSAMPLING 4
+/** Number of filter taps per phase of the interpolation filter. */
+#define TRUE_PEAK_FILTER_TAPS 12
+/**
+ * The interpolation filter is centered on this many samples in the past, so
+ * detected peaks lag behind the input by this many frames.
+ */
+#define TRUE_PEAK_FILTER_DELAY (TRUE_PEAK_FILTER_TAPS / 2)
+
+/**
+ * Fill an interpolation filter for true-peak detection. The filter is stored
+ * tap by tap with the coefficients of all phases next to each other, so that
+ * the phases can be computed in parallel.
+ * @param filter Array of TRUE_PEAK_FILTER_TAPS * TRUE_PEAK_OVERSAMPLING
+ * coefficients
+ */
+void truePeakFillFilter(float *filter);
+
+/**
+ * Detect the true peaks of one channel of audio, which are the largest
+ * absolute values of the signal when it is oversampled. Each history holds the
+ * last filter taps twice in a row, so that the most recent samples can always
+ * be read without wrapping around.
+ * @param filter Filter made by truePeakFillFilter()
+ * @param history History of the channel, with 2 * TRUE_PEAK_FILTER_TAPS
+ * samples which are zero at the start of the signal
+ * @param historyIndex Position in the history where the next sample goes
+ * @param input Samples to detect the peaks of
+ * @param numFrames Number of samples in the input
+ * @param peaks Peaks for each frame. Each peak is only written if it is larger
+ * than the value which is already there, so that several channels can be
+ * detected into the same array.
+ * @return Position in the history where the sample after the input goes
+ */
+unsigned int truePeakDetect(const float *filter, Samples history,
+                            unsigned int historyIndex, const Samples input,
+                            SampleCount numFrames, Sample *peaks);
+
+#endif
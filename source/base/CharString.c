@@ -37,13 +37,53 @@ CharString newCharString(void) {
 }
 
 CharString newCharStringWithCapacity(size_t length) {
-  CharString charString = (CharString)malloc(sizeof(CharStringMembers));
+  // The initial buffer lives in the same allocation as the struct itself, so
+  // creating a string costs a single malloc. It only moves to a separate heap
+  // block if an append outgrows it.
+  CharString charString =
+      (CharString)malloc(sizeof(CharStringMembers) + sizeof(char) * length);
   charString->capacity = length;
-  charString->data = (char *)malloc(sizeof(char) * length);
-  charStringClear(charString);
+  charString->data = (char *)(charString + 1);
+  memset(charString->data, 0, charString->capacity);
   return charString;
 }
 
+static boolByte _charStringIsInline(const CharString self) {
+  return (boolByte)(self->data == (char *)(self + 1));
+}
+
+// Length of the string, bounded by its capacity. Callers are allowed to write
+// directly to the data buffer, so the length is not cached in the struct.
+static size_t _charStringGetLength(const CharString self) {
+  const char *end = (const char *)memchr(self->data, '\0', self->capacity);
+  return end != NULL ? (size_t)(end - self->data) : self->capacity;
+}
+
+// Copy characters to the start of the string, truncating them to fit and
+// zeroing whatever remains of the previous contents.
+static void _charStringSetContents(CharString self, const char *string,
+                                   size_t stringLength) {
+  size_t oldLength;
+
+  if (self->capacity == 0) {
+    return;
+  }
+
+  oldLength = _charStringGetLength(self);
+
+  if (stringLength >= self->capacity) {
+    stringLength = self->capacity - 1;
+  }
+
+  memmove(self->data, string, stringLength);
+
+  if (oldLength > stringLength) {
+    memset(self->data + stringLength, 0, oldLength - stringLength);
+  } else {
+    self->data[stringLength] = '\0';
+  }
+}
+
 CharString newCharStringWithCString(const char *string) {
   size_t length;
   CharString result = NULL;
@@ -69,25 +109,35 @@ void charStringAppend(CharString self, const CharString string) {
 
 void charStringAppendCString(CharString self, const char *string) {
   size_t stringLength = strlen(string);
-  size_t selfLength = strlen(self->data);
+  size_t selfLength = _charStringGetLength(self);
+  char *data;
 
   if (stringLength + selfLength >= self->capacity) {
     self->capacity = stringLength + selfLength + 1; // don't forget the null!
-    self->data = (char *)realloc(self->data, self->capacity);
-    strcat(self->data, string);
-  } else {
-    strcat(self->data, string);
+
+    if (_charStringIsInline(self)) {
+      data = (char *)malloc(self->capacity);
+      memcpy(data, self->data, selfLength);
+      self->data = data;
+    } else {
+      self->data = (char *)realloc(self->data, self->capacity);
+    }
   }
+
+  memcpy(self->data + selfLength, string, stringLength);
+  self->data[selfLength + stringLength] = '\0';
 }
 
-void charStringClear(CharString self) { memset(self->data, 0, self->capacity); }
+void charStringClear(CharString self) {
+  memset(self->data, 0, _charStringGetLength(self));
+}
 
 void charStringCopyCString(CharString self, const char *string) {
-  strncpy(self->data, string, self->capacity);
+  _charStringSetContents(self, string, strlen(string));
 }
 
 void charStringCopy(CharString self, const CharString string) {
-  strncpy(self->data, string->data, self->capacity);
+  _charStringSetContents(self, string->data, _charStringGetLength(string));
 }
 
 boolByte charStringIsEmpty(const CharString self) {
@@ -287,7 +337,10 @@ CharString charStringWrap(const CharString srcString, unsigned int indentSize) {
 
 void freeCharString(CharString self) {
   if (self != NULL) {
-    free(self->data);
+    if (!_charStringIsInline(self)) {
+      free(self->data);
+    }
+
     free(self);
   }
 }
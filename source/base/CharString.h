@@ -48,6 +48,12 @@ static const size_t kCharStringLengthLong = 8192;
 #include <strings.h>
 #endif
 
+/**
+ * Strings are allocated together with their initial buffer, so short strings
+ * only need a single allocation. The data pointer may change when appending
+ * grows the string. Bytes past the terminating NULL character are always
+ * zero, which lets clearing and copying touch only the string's length.
+ */
 typedef struct {
   size_t capacity;
   char *data;
@@ -91,14 +97,14 @@ void charStringAppend(CharString self, const CharString string);
 void charStringAppendCString(CharString self, const char *string);
 
 /**
- * Copy the contents of another CharString to this one
+ * Copy the contents of another CharString to this one, truncating if necessary
  * @param self
  * @param string String to copy
  */
 void charStringCopy(CharString self, const CharString string);
 
 /**
- * Copy the contents of a C-String to this one
+ * Copy the contents of a C-String to this one, truncating if necessary
  * @param self
  * @param string NULL-terminated string to copy
  */
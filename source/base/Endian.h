@@ -94,4 +94,20 @@ unsigned short convertByteArrayToUnsignedShort(const byte *value);
  */
 unsigned int convertByteArrayToUnsignedInt(const byte *value);
 
+/**
+ * Convert raw big endian bytes, as they are stored in AIFF files, to an
+ * unsigned short value. This does not depend on the host's endian-ness.
+ * @param value A buffer which holds at least two bytes
+ * @return Unsigned short integer
+ */
+unsigned short convertBigEndianByteArrayToUnsignedShort(const byte *value);
+
+/**
+ * Convert raw big endian bytes, as they are stored in AIFF files, to an
+ * unsigned int value. This does not depend on the host's endian-ness.
+ * @param value A buffer which holds at least four bytes
+ * @return Unsigned integer
+ */
+unsigned int convertBigEndianByteArrayToUnsignedInt(const byte *value);
+
 #endif
@@ -26,6 +26,8 @@
 
 // Must be declared before stdlib, shouldn't have any effect on Windows builds
 #define _XOPEN_SOURCE 700
+// Also needed for the d_type constants in dirent.h
+#define _DEFAULT_SOURCE
 
 #include "File.h"
 
@@ -543,32 +545,48 @@ boolByte fileRemove(File self) {
   return result;
 }
 
-LinkedList fileListDirectory(File self) {
-  LinkedList items = newLinkedList();
-  CharString path;
-  File file;
-
-#if UNIX
-  DIR *directoryPtr = opendir(self->absolutePath->data);
+static boolByte _nameHasExtension(const char *name, const char *extension) {
+  size_t nameLength;
+  size_t extensionLength;
 
-  if (directoryPtr == NULL) {
-    freeLinkedList(items);
-    return 0;
+  if (extension == NULL) {
+    return true;
   }
 
-  struct dirent *entry;
+  nameLength = strlen(name);
+  extensionLength = strlen(extension);
+  return (boolByte)(nameLength > extensionLength &&
+                    strncasecmp(name + nameLength - extensionLength, extension,
+                                extensionLength) == 0);
+}
 
-  while ((entry = readdir(directoryPtr)) != NULL) {
-    if (entry->d_name[0] != '.') {
-      path = newCharStringWithCString(entry->d_name);
-      file = newFileWithParent(self, path);
-      linkedListAppend(items, file);
-      freeCharString(path);
-    }
+// Point the reusable item at an entry in the directory, keeping the parent
+// directory's part of the path which was written before listing.
+static boolByte _setDirectoryItemName(File item, size_t prefixLength,
+                                      const char *name) {
+  if (prefixLength + strlen(name) >= item->absolutePath->capacity) {
+    logDebug("Skipping '%s', path is too long", name);
+    return false;
   }
 
-  closedir(directoryPtr);
+  strncpy(item->absolutePath->data + prefixLength, name,
+          item->absolutePath->capacity - prefixLength - 1);
+  return true;
+}
+
+boolByte fileListDirectoryForeach(File self, const char *extension,
+                                  FileListDirectoryFunc callback,
+                                  void *userData) {
+  File item;
+  size_t prefixLength;
+
+#if UNIX
+  DIR *directoryPtr = opendir(self->absolutePath->data);
+  struct dirent *entry;
 
+  if (directoryPtr == NULL) {
+    return false;
+  }
 #elif WINDOWS
   WIN32_FIND_DATAA findData;
   HANDLE findHandle;
@@ -580,25 +598,93 @@ LinkedList fileListDirectory(File self) {
   freeCharString(searchString);
 
   if (findHandle == INVALID_HANDLE_VALUE) {
-    freeLinkedList(items);
-    return 0;
+    return false;
+  }
+#else
+  logUnsupportedFeature("List directory contents");
+  return false;
+#endif
+
+  // A single item is reused for every entry, so listing a directory does not
+  // allocate anything per entry
+  item = newFile();
+  snprintf(item->absolutePath->data, item->absolutePath->capacity, "%s%c",
+           self->absolutePath->data, PATH_DELIMITER);
+  prefixLength = strlen(item->absolutePath->data);
+
+#if UNIX
+  while ((entry = readdir(directoryPtr)) != NULL) {
+    if (entry->d_name[0] == '.' ||
+        !_nameHasExtension(entry->d_name, extension) ||
+        !_setDirectoryItemName(item, prefixLength, entry->d_name)) {
+      continue;
+    }
+
+    // The entry's type is usually known without having to stat() it, except
+    // for symlinks or filesystems which don't report types
+    switch (entry->d_type) {
+    case DT_DIR:
+      item->fileType = kFileTypeDirectory;
+      break;
+
+    case DT_REG:
+      item->fileType = kFileTypeFile;
+      break;
+
+    default:
+      item->fileType = kFileTypeInvalid;
+      break;
+    }
+
+    callback(item, entry->d_name, userData);
   }
 
+  closedir(directoryPtr);
+
+#elif WINDOWS
   do {
-    if (findData.cFileName[0] != '.') {
-      path = newCharStringWithCString(findData.cFileName);
-      file = newFileWithParent(self, path);
-      linkedListAppend(items, file);
-      freeCharString(path);
+    if (findData.cFileName[0] == '.' ||
+        !_nameHasExtension(findData.cFileName, extension) ||
+        !_setDirectoryItemName(item, prefixLength, findData.cFileName)) {
+      continue;
     }
+
+    item->fileType = (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                         ? kFileTypeDirectory
+                         : kFileTypeFile;
+    callback(item, findData.cFileName, userData);
   } while (FindNextFileA(findHandle, &findData) != 0);
 
   FindClose(findHandle);
-
-#else
-  logUnsupportedFeature("List directory contents");
 #endif
 
+  freeFile(item);
+  return true;
+}
+
+static void _appendDirectoryItem(File item, const char *name, void *userData) {
+  LinkedList items = (LinkedList)userData;
+  File file = newFile();
+
+  charStringCopy(file->absolutePath, item->absolutePath);
+  file->fileType = item->fileType;
+
+  if (file->fileType == kFileTypeInvalid && fileExists(file)) {
+    file->fileType =
+        _isDirectory(file->absolutePath) ? kFileTypeDirectory : kFileTypeFile;
+  }
+
+  linkedListAppend(items, file);
+}
+
+LinkedList fileListDirectory(File self) {
+  LinkedList items = newLinkedList();
+
+  if (!fileListDirectoryForeach(self, NULL, _appendDirectoryItem, items)) {
+    freeLinkedList(items);
+    return NULL;
+  }
+
   return items;
 }
 
@@ -636,6 +722,38 @@ size_t fileGetSize(File self) {
   return result;
 }
 
+unsigned long fileGetModificationTime(File self) {
+  unsigned long result = 0;
+
+#if UNIX
+  struct stat fileStat;
+
+  if (self->absolutePath == NULL) {
+    return 0;
+  }
+
+  if (stat(self->absolutePath->data, &fileStat) == 0) {
+    result = (unsigned long)fileStat.st_mtime;
+  }
+
+#elif WINDOWS
+  struct _stat fileStat;
+
+  if (self->absolutePath == NULL) {
+    return 0;
+  }
+
+  if (_stat(self->absolutePath->data, &fileStat) == 0) {
+    result = (unsigned long)fileStat.st_mtime;
+  }
+
+#else
+  logUnsupportedFeature("Get file modification time");
+#endif
+
+  return result;
+}
+
 CharString fileReadContents(File self) {
   CharString result = NULL;
   size_t fileSize = 0;
@@ -783,6 +901,30 @@ void *fileReadBytes(File self, size_t numBytes) {
   return result;
 }
 
+MappedFile fileMap(File self) {
+  if (self->fileType != kFileTypeFile) {
+    logError("Attempt to map non-file object '%s'", self->absolutePath->data);
+    return NULL;
+  }
+
+  if (self->_openMode != kFileOpenModeRead && self->_fileHandle != NULL) {
+    fileClose(self);
+  }
+
+  if (self->_fileHandle == NULL) {
+    self->_fileHandle = fopen(self->absolutePath->data, "rb");
+
+    if (self->_fileHandle == NULL) {
+      logError("Could not open '%s' for reading", self->absolutePath->data);
+      return NULL;
+    } else {
+      self->_openMode = kFileOpenModeRead;
+    }
+  }
+
+  return newMappedFile(self->_fileHandle);
+}
+
 boolByte fileWrite(File self, const CharString data) {
   return fileWriteBytes(self, data->data, strlen(data->data));
 }
@@ -29,6 +29,7 @@
 
 #include "base/CharString.h"
 #include "base/LinkedList.h"
+#include "base/MappedFile.h"
 #include "base/Types.h"
 
 #include <stdio.h>
@@ -142,6 +143,34 @@ boolByte fileRemove(File self);
  */
 LinkedList fileListDirectory(File self);
 
+/**
+ * Called for each entry found by fileListDirectoryForeach()
+ * @param item Entry in the directory. This object is owned by the listing and
+ * reused for the next entry, so it must be copied if it is needed after the
+ * callback returns. Its type is taken from the directory entry, and will be
+ * kFileTypeInvalid if that did not say whether it is a file or directory.
+ * @param name Name of the entry, without the parent directory
+ * @param userData User data passed to fileListDirectoryForeach()
+ */
+typedef void (*FileListDirectoryFunc)(File item, const char *name,
+                                      void *userData);
+
+/**
+ * Stream the contents of a directory to a callback, non-recursively. Unlike
+ * fileListDirectory(), no objects are allocated for each entry and entries are
+ * not stat'ed, which makes this suitable for scanning large directories.
+ * Special entries and hidden dotfiles are skipped.
+ * @param self
+ * @param extension If not NULL, only pass entries whose name ends with this
+ * extension (compared case-insensitively) to the callback
+ * @param callback Function to call for each entry
+ * @param userData User data to pass to the callback
+ * @return True if the directory could be read
+ */
+boolByte fileListDirectoryForeach(File self, const char *extension,
+                                  FileListDirectoryFunc callback,
+                                  void *userData);
+
 /**
  * Return the size of a file in bytes.
  * @param self
@@ -150,6 +179,15 @@ LinkedList fileListDirectory(File self);
  */
 size_t fileGetSize(File self);
 
+/**
+ * Return the time when a file or directory was last modified. For
+ * directories, this changes whenever an entry is added, removed, or renamed.
+ * @param self
+ * @return Modification time in seconds since the epoch, or 0 if this object
+ * does not exist.
+ */
+unsigned long fileGetModificationTime(File self);
+
 /**
  * Read the contents of an entire file into a string. If the file had previously
  * been opened for writing, then it will be flushed, closed, and reopened for
@@ -184,6 +222,17 @@ LinkedList fileReadLines(File self);
  */
 void *fileReadBytes(File self, size_t numBytes);
 
+/**
+ * Map the contents of a file into memory, which avoids copying large files
+ * into a buffer before parsing them. If the file had previously been opened
+ * for writing, then it will be flushed, closed, and reopened for reading.
+ * @param self
+ * @return Read-only view of the file, or NULL if the file is empty or could
+ * not be mapped. The caller must unmap the file with freeMappedFile(), which
+ * may be done after the file itself has been closed.
+ */
+MappedFile fileMap(File self);
+
 /**
  * Write a string to file. The first time this function is called, the file will
  * be opened for write mode, truncating any data present there if the file
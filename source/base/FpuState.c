@@ -0,0 +1,112 @@
+//
+// FpuState.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "FpuState.h"
+
+#if defined(__SSE__) || defined(_M_X64) ||                                     \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FPU_STATE_SSE 1
+#include <xmmintrin.h>
+
+// Flush to zero, which flushes denormal results
+#define FPU_STATE_SSE_FTZ 0x8000
+// Denormals are zero, which flushes denormal inputs. This is not supported by
+// some of the first 32-bit processors with SSE, which raise an exception when
+// it is set, so it is only used on x86-64.
+#if defined(__x86_64__) || defined(_M_X64)
+#define FPU_STATE_SSE_DAZ 0x0040
+#else
+#define FPU_STATE_SSE_DAZ 0
+#endif
+#define FPU_STATE_SSE_FLUSH (FPU_STATE_SSE_FTZ | FPU_STATE_SSE_DAZ)
+#elif defined(__aarch64__)
+#define FPU_STATE_AARCH64 1
+#elif defined(__arm__) && defined(__VFP_FP__) && !defined(__SOFTFP__)
+#define FPU_STATE_ARM 1
+#endif
+
+// The FZ bit of FPCR and FPSCR, which flushes both inputs and results
+#define FPU_STATE_ARM_FZ (1ull << 24)
+
+static FpuState _getFpuState(void) {
+#if FPU_STATE_SSE
+  return (FpuState)_mm_getcsr();
+#elif FPU_STATE_AARCH64
+  unsigned long long fpcr;
+  __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+  return (FpuState)fpcr;
+#elif FPU_STATE_ARM
+  unsigned int fpscr;
+  __asm__ __volatile__("vmrs %0, fpscr" : "=r"(fpscr));
+  return (FpuState)fpscr;
+#else
+  return 0;
+#endif
+}
+
+static void _setFpuState(const FpuState state) {
+#if FPU_STATE_SSE
+  _mm_setcsr((unsigned int)state);
+#elif FPU_STATE_AARCH64
+  unsigned long long fpcr = (unsigned long long)state;
+  __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr));
+#elif FPU_STATE_ARM
+  unsigned int fpscr = (unsigned int)state;
+  __asm__ __volatile__("vmsr fpscr, %0" : : "r"(fpscr));
+#else
+  (void)state;
+#endif
+}
+
+FpuState fpuStateFlushDenormals(void) {
+  const FpuState previous = _getFpuState();
+
+#if FPU_STATE_SSE
+  _setFpuState(previous | FPU_STATE_SSE_FLUSH);
+#elif FPU_STATE_AARCH64 || FPU_STATE_ARM
+  _setFpuState(previous | FPU_STATE_ARM_FZ);
+#endif
+
+  return previous;
+}
+
+void fpuStateRestore(const FpuState state) {
+  // Writing the register can be slow, so skip it if nothing changed
+  if (_getFpuState() != state) {
+    _setFpuState(state);
+  }
+}
+
+boolByte fpuStateIsFlushingDenormals(void) {
+#if FPU_STATE_SSE
+  return (boolByte)((_getFpuState() & FPU_STATE_SSE_FLUSH) ==
+                    FPU_STATE_SSE_FLUSH);
+#elif FPU_STATE_AARCH64 || FPU_STATE_ARM
+  return (boolByte)((_getFpuState() & FPU_STATE_ARM_FZ) != 0);
+#else
+  return false;
+#endif
+}
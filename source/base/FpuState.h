@@ -0,0 +1,60 @@
+//
+// FpuState.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_FpuState_h
+#define MrsWatson_FpuState_h
+
+#include "base/Types.h"
+
+/**
+ * Saved floating point control register of the calling thread, which is MXCSR
+ * on x86 and FPCR or FPSCR on ARM.
+ */
+typedef unsigned long long FpuState;
+
+/**
+ * Make the calling thread flush denormal numbers to zero, both when they are
+ * produced and when they are used as input. Denormals appear in decaying tails
+ * of reverbs and filters, and are processed many times slower than normal
+ * numbers by most processors. Since they are far below the noise floor of any
+ * output format, flushing them does not change the audible result.
+ * On platforms which do not support this, nothing is changed.
+ * @return State before the call, to be passed to fpuStateRestore()
+ */
+FpuState fpuStateFlushDenormals(void);
+
+/**
+ * Restore the floating point state of the calling thread.
+ * @param state State returned by fpuStateFlushDenormals()
+ */
+void fpuStateRestore(const FpuState state);
+
+/**
+ * @return True if the calling thread flushes denormals to zero
+ */
+boolByte fpuStateIsFlushingDenormals(void);
+
+#endif
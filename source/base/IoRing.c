@@ -0,0 +1,563 @@
+//
+// IoRing.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Must be declared before any system headers, needed for syscall()
+#if LINUX
+#define _GNU_SOURCE
+#endif
+
+#include "IoRing.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if WINDOWS
+#include <io.h>
+#elif LINUX && USE_IO_URING
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if WINDOWS
+
+static boolByte _openIoRing(IoRing self, FILE *fileHandle) {
+  HANDLE handle = (HANDLE)_get_osfhandle(_fileno(fileHandle));
+  unsigned int i;
+
+  if (handle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  // The stream's handle was not opened for overlapped I/O, but a second
+  // handle to the same file can be
+  self->_fileHandle =
+      ReOpenFile(handle, self->forWriting ? GENERIC_WRITE : GENERIC_READ,
+                 FILE_SHARE_READ | FILE_SHARE_WRITE, FILE_FLAG_OVERLAPPED);
+
+  if (self->_fileHandle == INVALID_HANDLE_VALUE) {
+    logDebug("Could not reopen file for overlapped I/O, got error %d",
+             GetLastError());
+    self->_fileHandle = NULL;
+    return false;
+  }
+
+  self->_overlapped =
+      (OVERLAPPED *)calloc(self->numSlots, sizeof(OVERLAPPED));
+
+  for (i = 0; i < self->numSlots; ++i) {
+    self->_overlapped[i].hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+    if (self->_overlapped[i].hEvent == NULL) {
+      logDebug("Could not create event for overlapped I/O, got error %d",
+               GetLastError());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void _closeIoRing(IoRing self) {
+  unsigned int i;
+
+  if (self->_overlapped != NULL) {
+    for (i = 0; i < self->numSlots; ++i) {
+      if (self->_overlapped[i].hEvent != NULL) {
+        CloseHandle(self->_overlapped[i].hEvent);
+      }
+    }
+
+    free(self->_overlapped);
+  }
+
+  if (self->_fileHandle != NULL) {
+    CloseHandle(self->_fileHandle);
+  }
+}
+
+// Operations are started when they are submitted
+static void _queueIoRing(IoRing self, unsigned int slot) {}
+
+static boolByte _submitIoRing(IoRing self) {
+  boolByte result = true;
+  OVERLAPPED *overlapped;
+  unsigned long long offset;
+  DWORD numBytes;
+  BOOL started;
+  unsigned int slot;
+
+  for (slot = 0; slot < self->numSlots; ++slot) {
+    if (self->_states[slot] != IO_RING_SLOT_QUEUED) {
+      continue;
+    }
+
+    overlapped = &self->_overlapped[slot];
+    offset = (unsigned long long)self->_offsets[slot];
+    numBytes = (DWORD)self->_lengths[slot];
+    overlapped->Offset = (DWORD)(offset & 0xffffffff);
+    overlapped->OffsetHigh = (DWORD)(offset >> 32);
+    ResetEvent(overlapped->hEvent);
+
+    if (self->forWriting) {
+      started = WriteFile(self->_fileHandle, self->buffers[slot], numBytes,
+                          NULL, overlapped);
+    } else {
+      started = ReadFile(self->_fileHandle, self->buffers[slot], numBytes,
+                         NULL, overlapped);
+    }
+
+    if (started || GetLastError() == ERROR_IO_PENDING) {
+      self->_states[slot] = IO_RING_SLOT_SUBMITTED;
+    } else {
+      // Reading at the end of the file fails instead of reading nothing
+      self->_results[slot] = GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+      self->_states[slot] = IO_RING_SLOT_DONE;
+      result = (boolByte)(self->_results[slot] == 0);
+    }
+  }
+
+  return result;
+}
+
+static boolByte _waitForIoRing(IoRing self, unsigned int slot) {
+  DWORD numBytes;
+
+  if (self->_states[slot] != IO_RING_SLOT_SUBMITTED) {
+    return true;
+  }
+
+  if (GetOverlappedResult(self->_fileHandle, &self->_overlapped[slot],
+                          &numBytes, TRUE)) {
+    self->_results[slot] = (long)numBytes;
+  } else {
+    self->_results[slot] = GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+  }
+
+  self->_states[slot] = IO_RING_SLOT_DONE;
+  return true;
+}
+
+static long _completeIoRing(IoRing self, unsigned int slot, long numBytes) {
+  return numBytes;
+}
+
+#elif LINUX && USE_IO_URING
+
+// There is no wrapper for these system calls in libc
+static int _ioUringSetup(unsigned int numEntries,
+                         struct io_uring_params *params) {
+  return (int)syscall(__NR_io_uring_setup, numEntries, params);
+}
+
+static int _ioUringEnter(int ringDescriptor, unsigned int numToSubmit,
+                         unsigned int minComplete, unsigned int flags) {
+  return (int)syscall(__NR_io_uring_enter, ringDescriptor, numToSubmit,
+                      minComplete, flags, NULL, 0);
+}
+
+static void *_mapIoRing(IoRing self, size_t size, off_t offset) {
+  void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    self->_ringDescriptor, offset);
+  return data == MAP_FAILED ? NULL : data;
+}
+
+static boolByte _openIoRing(IoRing self, FILE *fileHandle) {
+  struct io_uring_params params;
+  struct iovec *vectors;
+  byte *submitRing;
+  byte *completeRing;
+  unsigned int i;
+
+  memset(&params, 0, sizeof(params));
+  self->_fileDescriptor = fileno(fileHandle);
+  self->_ringDescriptor = _ioUringSetup(self->numSlots, &params);
+
+  if (self->_ringDescriptor < 0) {
+    logDebug("io_uring is not available, got error %d", errno);
+    return false;
+  }
+
+  self->_submitRingSize =
+      params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  self->_completeRingSize =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+  // Newer kernels share one mapping for both queues
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (self->_completeRingSize > self->_submitRingSize) {
+      self->_submitRingSize = self->_completeRingSize;
+    }
+
+    self->_completeRingSize = self->_submitRingSize;
+  }
+
+  self->_submitRing =
+      _mapIoRing(self, self->_submitRingSize, IORING_OFF_SQ_RING);
+
+  if (self->_submitRing == NULL) {
+    self->_completeRing = NULL;
+  } else if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    self->_completeRing = self->_submitRing;
+  } else {
+    self->_completeRing =
+        _mapIoRing(self, self->_completeRingSize, IORING_OFF_CQ_RING);
+  }
+
+  self->_submitEntriesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  self->_submitEntries =
+      _mapIoRing(self, self->_submitEntriesSize, IORING_OFF_SQES);
+
+  if (self->_submitRing == NULL || self->_completeRing == NULL ||
+      self->_submitEntries == NULL) {
+    logDebug("Could not map io_uring queues, got error %d", errno);
+    return false;
+  }
+
+  submitRing = (byte *)self->_submitRing;
+  completeRing = (byte *)self->_completeRing;
+  self->_submitTail = (unsigned int *)(submitRing + params.sq_off.tail);
+  self->_submitMask = (unsigned int *)(submitRing + params.sq_off.ring_mask);
+  self->_submitArray = (unsigned int *)(submitRing + params.sq_off.array);
+  self->_completeHead = (unsigned int *)(completeRing + params.cq_off.head);
+  self->_completeTail = (unsigned int *)(completeRing + params.cq_off.tail);
+  self->_completeMask =
+      (unsigned int *)(completeRing + params.cq_off.ring_mask);
+  self->_completeEntries = completeRing + params.cq_off.cqes;
+
+  vectors = (struct iovec *)malloc(sizeof(struct iovec) * self->numSlots);
+
+  for (i = 0; i < self->numSlots; ++i) {
+    vectors[i].iov_base = self->buffers[i];
+    vectors[i].iov_len = self->slotSize;
+  }
+
+  self->_vectors = vectors;
+
+  // Registered buffers are pinned once, rather than for every operation. This
+  // counts against the locked memory limit, so it may fail for large rings.
+  self->_fixedBuffers = (boolByte)(
+      syscall(__NR_io_uring_register, self->_ringDescriptor,
+              IORING_REGISTER_BUFFERS, vectors, self->numSlots) == 0);
+
+  if (!self->_fixedBuffers) {
+    logDebug("Could not register buffers with io_uring, got error %d", errno);
+  }
+
+  return true;
+}
+
+static void _closeIoRing(IoRing self) {
+  if (self->_submitEntries != NULL) {
+    munmap(self->_submitEntries, self->_submitEntriesSize);
+  }
+
+  if (self->_completeRing != NULL &&
+      self->_completeRing != self->_submitRing) {
+    munmap(self->_completeRing, self->_completeRingSize);
+  }
+
+  if (self->_submitRing != NULL) {
+    munmap(self->_submitRing, self->_submitRingSize);
+  }
+
+  if (self->_ringDescriptor >= 0) {
+    close(self->_ringDescriptor);
+  }
+
+  free(self->_vectors);
+}
+
+static void _queueIoRing(IoRing self, unsigned int slot) {
+  struct io_uring_sqe *entries = (struct io_uring_sqe *)self->_submitEntries;
+  struct iovec *vectors = (struct iovec *)self->_vectors;
+  const unsigned int tail = *self->_submitTail;
+  const unsigned int index = tail & *self->_submitMask;
+  struct io_uring_sqe *entry = &entries[index];
+
+  memset(entry, 0, sizeof(struct io_uring_sqe));
+  entry->fd = self->_fileDescriptor;
+  entry->off = (unsigned long long)self->_offsets[slot];
+  entry->user_data = slot;
+
+  if (self->_fixedBuffers) {
+    entry->opcode =
+        self->forWriting ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+    entry->addr = (unsigned long long)(size_t)self->buffers[slot];
+    entry->len = (unsigned int)self->_lengths[slot];
+    entry->buf_index = (unsigned short)slot;
+  } else {
+    vectors[slot].iov_len = self->_lengths[slot];
+    entry->opcode = self->forWriting ? IORING_OP_WRITEV : IORING_OP_READV;
+    entry->addr = (unsigned long long)(size_t)&vectors[slot];
+    entry->len = 1;
+  }
+
+  // The ring never holds more entries than there are slots, so it cannot
+  // overflow before the entries are submitted
+  self->_submitArray[index] = index;
+  __atomic_store_n(self->_submitTail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static boolByte _submitIoRing(IoRing self) {
+  unsigned int remaining = self->numQueued;
+  boolByte result = true;
+  unsigned int slot;
+  int numSubmitted;
+
+  while (remaining > 0) {
+    numSubmitted = _ioUringEnter(self->_ringDescriptor, remaining, 0, 0);
+
+    if (numSubmitted > 0) {
+      remaining -= (unsigned int)numSubmitted;
+    } else if (numSubmitted < 0 && errno != EINTR) {
+      logDebug("Could not submit to io_uring, got error %d", errno);
+      result = false;
+      break;
+    }
+  }
+
+  for (slot = 0; slot < self->numSlots; ++slot) {
+    if (self->_states[slot] == IO_RING_SLOT_QUEUED) {
+      self->_states[slot] = result ? IO_RING_SLOT_SUBMITTED : IO_RING_SLOT_DONE;
+      self->_results[slot] = -1;
+    }
+  }
+
+  return result;
+}
+
+// Operations may finish in any order, so the result of every finished one is
+// stored in its slot
+static void _reapIoRing(IoRing self) {
+  const struct io_uring_cqe *entries =
+      (const struct io_uring_cqe *)self->_completeEntries;
+  const unsigned int tail =
+      __atomic_load_n(self->_completeTail, __ATOMIC_ACQUIRE);
+  unsigned int head = *self->_completeHead;
+  const struct io_uring_cqe *entry;
+
+  for (; head != tail; ++head) {
+    entry = &entries[head & *self->_completeMask];
+    self->_results[entry->user_data] = (long)entry->res;
+    self->_states[entry->user_data] = IO_RING_SLOT_DONE;
+  }
+
+  __atomic_store_n(self->_completeHead, head, __ATOMIC_RELEASE);
+}
+
+static boolByte _waitForIoRing(IoRing self, unsigned int slot) {
+  _reapIoRing(self);
+
+  while (self->_states[slot] == IO_RING_SLOT_SUBMITTED) {
+    if (_ioUringEnter(self->_ringDescriptor, 0, 1, IORING_ENTER_GETEVENTS) <
+            0 &&
+        errno != EINTR) {
+      logDebug("Could not wait for io_uring, got error %d", errno);
+      return false;
+    }
+
+    _reapIoRing(self);
+  }
+
+  return true;
+}
+
+// The kernel may transfer less than requested, for example when interrupted
+// by a signal, so the rest is read or written directly
+static long _completeIoRing(IoRing self, unsigned int slot, long numBytes) {
+  size_t done = (size_t)numBytes;
+  const size_t length = self->_lengths[slot];
+  const off_t offset = (off_t)self->_offsets[slot];
+  ssize_t result;
+
+  while (done < length) {
+    if (self->forWriting) {
+      result = pwrite(self->_fileDescriptor, self->buffers[slot] + done,
+                      length - done, offset + (off_t)done);
+    } else {
+      result = pread(self->_fileDescriptor, self->buffers[slot] + done,
+                     length - done, offset + (off_t)done);
+    }
+
+    if (result < 0 && errno == EINTR) {
+      continue;
+    } else if (result < 0) {
+      return -1;
+    } else if (result == 0) {
+      // End of file
+      break;
+    }
+
+    done += (size_t)result;
+  }
+
+  return (long)done;
+}
+
+#else
+
+static boolByte _openIoRing(IoRing self, FILE *fileHandle) {
+  return false;
+}
+
+static void _closeIoRing(IoRing self) {}
+
+static void _queueIoRing(IoRing self, unsigned int slot) {}
+
+static boolByte _submitIoRing(IoRing self) {
+  return false;
+}
+
+static boolByte _waitForIoRing(IoRing self, unsigned int slot) {
+  return false;
+}
+
+static long _completeIoRing(IoRing self, unsigned int slot, long numBytes) {
+  return numBytes;
+}
+
+#endif
+
+IoRing newIoRing(FILE *fileHandle, boolByte forWriting, unsigned int numSlots,
+                 size_t slotSize) {
+  IoRing ioRing;
+  byte *data;
+  unsigned int i;
+
+  if (fileHandle == NULL || numSlots == 0 || slotSize == 0) {
+    return NULL;
+  }
+
+  data = (byte *)malloc(numSlots * slotSize);
+
+  if (data == NULL) {
+    return NULL;
+  }
+
+  ioRing = (IoRing)calloc(1, sizeof(IoRingMembers));
+  ioRing->buffers = (byte **)malloc(sizeof(byte *) * numSlots);
+  ioRing->numSlots = numSlots;
+  ioRing->slotSize = slotSize;
+  ioRing->forWriting = forWriting;
+  ioRing->numQueued = 0;
+
+  for (i = 0; i < numSlots; ++i) {
+    ioRing->buffers[i] = data + i * slotSize;
+  }
+
+  ioRing->_states =
+      (IoRingSlotState *)calloc(numSlots, sizeof(IoRingSlotState));
+  ioRing->_offsets = (size_t *)calloc(numSlots, sizeof(size_t));
+  ioRing->_lengths = (size_t *)calloc(numSlots, sizeof(size_t));
+  ioRing->_results = (long *)calloc(numSlots, sizeof(long));
+#if LINUX && USE_IO_URING
+  ioRing->_ringDescriptor = -1;
+#endif
+
+  if (!_openIoRing(ioRing, fileHandle)) {
+    freeIoRing(ioRing);
+    return NULL;
+  }
+
+  return ioRing;
+}
+
+void ioRingQueue(IoRing self, unsigned int slot, size_t offset,
+                 size_t numBytes) {
+  self->_offsets[slot] = offset;
+  self->_lengths[slot] = numBytes;
+  self->_states[slot] = IO_RING_SLOT_QUEUED;
+  _queueIoRing(self, slot);
+  self->numQueued++;
+}
+
+boolByte ioRingSubmit(IoRing self) {
+  boolByte result;
+
+  if (self->numQueued == 0) {
+    return true;
+  }
+
+  result = _submitIoRing(self);
+  self->numQueued = 0;
+  return result;
+}
+
+long ioRingWait(IoRing self, unsigned int slot) {
+  long result;
+
+  if (self->_states[slot] == IO_RING_SLOT_IDLE) {
+    return 0;
+  } else if (self->_states[slot] == IO_RING_SLOT_QUEUED) {
+    ioRingSubmit(self);
+  }
+
+  result = _waitForIoRing(self, slot) ? self->_results[slot] : -1;
+  self->_states[slot] = IO_RING_SLOT_IDLE;
+
+  if (result < 0) {
+    logDebug("Could not %s %lu bytes at offset %lu",
+             self->forWriting ? "write" : "read",
+             (unsigned long)self->_lengths[slot],
+             (unsigned long)self->_offsets[slot]);
+    return -1;
+  }
+
+  return _completeIoRing(self, slot, result);
+}
+
+boolByte ioRingWaitAll(IoRing self) {
+  boolByte result = true;
+  unsigned int slot;
+
+  for (slot = 0; slot < self->numSlots; ++slot) {
+    if (ioRingWait(self, slot) < 0) {
+      result = false;
+    }
+  }
+
+  return result;
+}
+
+void freeIoRing(IoRing self) {
+  if (self != NULL) {
+    ioRingWaitAll(self);
+    _closeIoRing(self);
+    free(self->buffers[0]);
+    free(self->buffers);
+    free(self->_states);
+    free(self->_offsets);
+    free(self->_lengths);
+    free(self->_results);
+    free(self);
+  }
+}
@@ -0,0 +1,151 @@
+//
+// IoRing.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_IoRing_h
+#define MrsWatson_IoRing_h
+
+#include "base/Types.h"
+
+#include <stdio.h>
+
+#if WINDOWS
+#include <Windows.h>
+#endif
+
+typedef enum {
+  IO_RING_SLOT_IDLE,
+  IO_RING_SLOT_QUEUED,
+  IO_RING_SLOT_SUBMITTED,
+  IO_RING_SLOT_DONE
+} IoRingSlotState;
+
+typedef struct {
+  /** Buffer of each slot, which holds the data of one read or write */
+  byte **buffers;
+  unsigned int numSlots;
+  /** Size of each buffer in bytes */
+  size_t slotSize;
+  boolByte forWriting;
+  /** Number of operations which have been queued but not yet submitted */
+  unsigned int numQueued;
+
+  IoRingSlotState *_states;
+  size_t *_offsets;
+  size_t *_lengths;
+  long *_results;
+
+#if WINDOWS
+  HANDLE _fileHandle;
+  OVERLAPPED *_overlapped;
+#elif LINUX && USE_IO_URING
+  int _fileDescriptor;
+  int _ringDescriptor;
+  // Submission and completion queues shared with the kernel
+  void *_submitRing;
+  size_t _submitRingSize;
+  void *_completeRing;
+  size_t _completeRingSize;
+  void *_submitEntries;
+  size_t _submitEntriesSize;
+  void *_completeEntries;
+  unsigned int *_submitTail;
+  unsigned int *_submitMask;
+  unsigned int *_submitArray;
+  unsigned int *_completeHead;
+  unsigned int *_completeTail;
+  unsigned int *_completeMask;
+  // Set when the buffers have been registered with the kernel, otherwise
+  // they are passed with each operation
+  boolByte _fixedBuffers;
+  void *_vectors;
+#endif
+} IoRingMembers;
+typedef IoRingMembers *IoRing;
+
+/**
+ * Create a ring for reading or writing blocks of an open file asynchronously
+ * from the calling thread, without a separate thread. Each slot of the ring
+ * holds one read or write. Operations are queued for a slot, and then sent to
+ * the kernel together with ioRingSubmit(), so that a batch of blocks costs a
+ * single system call. On Linux this uses io_uring with buffers which are
+ * registered with the kernel, and on Windows it uses overlapped I/O.
+ * @param fileHandle Regular file which stays open while the ring is used.
+ * Operations go straight to the file, so anything buffered by stdio must have
+ * been flushed, and the position of the stream is not changed by them.
+ * @param forWriting True if the ring writes to the file, otherwise it reads
+ * @param numSlots Number of operations which may be in flight at once
+ * @param slotSize Size of the buffer of each slot in bytes
+ * @return New ring, or NULL if the platform or the file does not support
+ * asynchronous I/O, in which case the file should be accessed normally
+ */
+IoRing newIoRing(FILE *fileHandle, boolByte forWriting, unsigned int numSlots,
+                 size_t slotSize);
+
+/**
+ * Queue a read or write of a slot's buffer, which is started by the next call
+ * to ioRingSubmit() or ioRingWait(). The slot must not be in use.
+ * @param self
+ * @param slot Slot whose buffer is read into or written from
+ * @param offset Offset in the file in bytes
+ * @param numBytes Number of bytes, which may not exceed the slot size
+ */
+void ioRingQueue(IoRing self, unsigned int slot, size_t offset,
+                 size_t numBytes);
+
+/**
+ * Start all queued operations at once
+ * @param self
+ * @return False if the operations could not be started, in which case they
+ * fail when waiting for them
+ */
+boolByte ioRingSubmit(IoRing self);
+
+/**
+ * Wait until the operation of a slot has finished, which frees the slot for
+ * the next one. Reads and writes which the kernel only finished partially are
+ * completed synchronously.
+ * @param self
+ * @param slot
+ * @return Number of bytes read or written, which is only less than requested
+ * when a read reached the end of the file. 0 if nothing was queued for the
+ * slot, or -1 if the operation failed.
+ */
+long ioRingWait(IoRing self, unsigned int slot);
+
+/**
+ * Wait for all operations of the ring to finish
+ * @param self
+ * @return False if any of them failed
+ */
+boolByte ioRingWaitAll(IoRing self);
+
+/**
+ * Wait for all operations to finish and free the ring. The file is not closed.
+ * @param self
+ */
+void freeIoRing(IoRing self);
+
+#endif
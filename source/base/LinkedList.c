@@ -37,13 +37,14 @@ LinkedList newLinkedList(void) {
   list->item = NULL;
   list->nextItem = NULL;
   list->_numItems = 0;
+  list->_lastNode = list;
+  list->_spareNodes = NULL;
 
   return list;
 }
 
 void linkedListAppend(LinkedList self, void *item) {
-  LinkedListIterator iterator = self;
-  LinkedListIterator headNode;
+  LinkedList lastNode;
   LinkedList nextItem;
 
   if (self == NULL || item == NULL) {
@@ -51,31 +52,44 @@ void linkedListAppend(LinkedList self, void *item) {
   }
 
   // First item in the list
-  if (iterator->item == NULL) {
-    iterator->item = item;
-    iterator->_numItems = 1;
+  if (self->item == NULL) {
+    self->item = item;
+    self->_numItems = 1;
     return;
   }
 
-  headNode = self;
-
-  while (true) {
-    if (iterator->nextItem == NULL) {
-      nextItem = newLinkedList();
-      nextItem->item = item;
-      iterator->nextItem = nextItem;
-      headNode->_numItems++;
-      break;
-    } else {
-      iterator = (LinkedListIterator)(iterator->nextItem);
-    }
+  if (self->_spareNodes != NULL) {
+    nextItem = (LinkedList)self->_spareNodes;
+    self->_spareNodes = nextItem->nextItem;
+    nextItem->nextItem = NULL;
+  } else {
+    nextItem = newLinkedList();
   }
+
+  nextItem->item = item;
+  lastNode = (LinkedList)self->_lastNode;
+  lastNode->nextItem = nextItem;
+  self->_lastNode = nextItem;
+  self->_numItems++;
 }
 
 int linkedListLength(LinkedList self) {
   return self != NULL ? self->_numItems : 0;
 }
 
+LinkedListIterator linkedListBegin(LinkedList self) {
+  // Only the head node of an empty list has no item
+  return (self != NULL && self->item != NULL) ? self : NULL;
+}
+
+LinkedListIterator linkedListIteratorNext(LinkedListIterator iterator) {
+  return (LinkedListIterator)iterator->nextItem;
+}
+
+void *linkedListIteratorGetItem(LinkedListIterator iterator) {
+  return iterator->item;
+}
+
 void **linkedListToArray(LinkedList self) {
   LinkedListIterator iterator = self;
   void **array;
@@ -112,9 +126,43 @@ void linkedListForeach(LinkedList self, LinkedListForeachFunc foreachFunc,
   }
 }
 
+void linkedListClear(LinkedList self) {
+  LinkedList lastNode;
+
+  if (self == NULL) {
+    return;
+  }
+
+  // Move all nodes after the head node to the front of the spare list
+  if (self->nextItem != NULL) {
+    lastNode = (LinkedList)self->_lastNode;
+    lastNode->nextItem = self->_spareNodes;
+    self->_spareNodes = self->nextItem;
+    self->nextItem = NULL;
+  }
+
+  self->item = NULL;
+  self->_numItems = 0;
+  self->_lastNode = self;
+}
+
+static void _freeLinkedListSpareNodes(LinkedList self) {
+  LinkedList current;
+
+  while (self->_spareNodes != NULL) {
+    current = (LinkedList)self->_spareNodes;
+    self->_spareNodes = current->nextItem;
+    free(current);
+  }
+}
+
 void freeLinkedList(LinkedList self) {
   LinkedListIterator iterator = self;
 
+  if (self != NULL) {
+    _freeLinkedListSpareNodes(self);
+  }
+
   while (iterator != NULL) {
     if (iterator->nextItem == NULL) {
       free(iterator);
@@ -131,6 +179,12 @@ void freeLinkedListAndItems(LinkedList self, LinkedListFreeItemFunc freeItem) {
   LinkedListIterator iterator = self;
   LinkedList current;
 
+  if (iterator == NULL) {
+    return;
+  }
+
+  _freeLinkedListSpareNodes(self);
+
   if (iterator->item == NULL) {
     free(iterator);
     return;
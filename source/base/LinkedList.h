@@ -31,9 +31,14 @@ typedef struct {
   void *item;
   void *nextItem;
 
-  // This field should be considered private, and is only valid for the head
+  // These fields should be considered private, and are only valid for the head
   // node
   int _numItems;
+  // Last node in the list, so that appending does not need to walk the list
+  void *_lastNode;
+  // Nodes which were released by linkedListClear(), and are reused by the next
+  // calls to linkedListAppend()
+  void *_spareNodes;
 } LinkedListMembers;
 
 typedef LinkedListMembers *LinkedList;
@@ -65,6 +70,38 @@ void linkedListAppend(LinkedList self, void *item);
  */
 int linkedListLength(LinkedList self);
 
+/**
+ * Get an iterator for the first item in a list. Together with
+ * linkedListIteratorNext(), this walks over the items without needing to copy
+ * them with linkedListToArray():
+ *
+ *   for (iterator = linkedListBegin(list); iterator != NULL;
+ *        iterator = linkedListIteratorNext(iterator)) {
+ *     item = linkedListIteratorGetItem(iterator);
+ *   }
+ *
+ * Items must not be appended to the list while iterating over it.
+ * @param self
+ * @return Iterator for the first item, or NULL if the list is empty
+ */
+LinkedListIterator linkedListBegin(LinkedList self);
+
+/**
+ * Advance an iterator to the next item in the list
+ * @param iterator Iterator returned by linkedListBegin() or a previous call to
+ * this function
+ * @return Iterator for the next item, or NULL if the end of the list was
+ * reached
+ */
+LinkedListIterator linkedListIteratorNext(LinkedListIterator iterator);
+
+/**
+ * Get the item which an iterator points to
+ * @param iterator Valid (non-NULL) iterator
+ * @return Item in the list
+ */
+void *linkedListIteratorGetItem(LinkedListIterator iterator);
+
 /**
  * Flatten a LinkedList to an array. The resulting array will be size N + 1,
  * with a NULL object at the end of the array.
@@ -83,6 +120,15 @@ void **linkedListToArray(LinkedList self);
 void linkedListForeach(LinkedList self, LinkedListForeachFunc foreachFunc,
                        void *userData);
 
+/**
+ * Remove all items from a list, without freeing the items themselves. The
+ * nodes of the list are kept and reused when new items are appended, so a list
+ * which is cleared and refilled over and over does not allocate any memory
+ * once it has reached its largest size.
+ * @param self
+ */
+void linkedListClear(LinkedList self);
+
 /**
  * Free each item in a linked list. The contents of the items themselves are
  * *not*
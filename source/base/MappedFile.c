@@ -0,0 +1,118 @@
+//
+// MappedFile.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "MappedFile.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+
+#if WINDOWS
+#include <io.h>
+#elif UNIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile newMappedFile(FILE *fileHandle) {
+  MappedFile mappedFile;
+
+  if (fileHandle == NULL) {
+    return NULL;
+  }
+
+  mappedFile = (MappedFile)malloc(sizeof(MappedFileMembers));
+  mappedFile->data = NULL;
+  mappedFile->size = 0;
+
+#if WINDOWS
+  HANDLE fileNativeHandle = (HANDLE)_get_osfhandle(_fileno(fileHandle));
+  LARGE_INTEGER fileSize;
+
+  if (fileNativeHandle == INVALID_HANDLE_VALUE ||
+      !GetFileSizeEx(fileNativeHandle, &fileSize) || fileSize.QuadPart == 0) {
+    free(mappedFile);
+    return NULL;
+  }
+
+  mappedFile->size = (size_t)fileSize.QuadPart;
+  mappedFile->_mappingHandle =
+      CreateFileMapping(fileNativeHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+  if (mappedFile->_mappingHandle == NULL) {
+    logDebug("Could not create file mapping, got error %d", GetLastError());
+    free(mappedFile);
+    return NULL;
+  }
+
+  mappedFile->data = (const byte *)MapViewOfFile(mappedFile->_mappingHandle,
+                                                 FILE_MAP_READ, 0, 0, 0);
+
+  if (mappedFile->data == NULL) {
+    logDebug("Could not map view of file, got error %d", GetLastError());
+    CloseHandle(mappedFile->_mappingHandle);
+    free(mappedFile);
+    return NULL;
+  }
+#elif UNIX
+  struct stat fileStat;
+  void *data;
+
+  if (fstat(fileno(fileHandle), &fileStat) != 0 ||
+      !S_ISREG(fileStat.st_mode) || fileStat.st_size == 0) {
+    free(mappedFile);
+    return NULL;
+  }
+
+  mappedFile->size = (size_t)fileStat.st_size;
+  data = mmap(NULL, mappedFile->size, PROT_READ, MAP_PRIVATE,
+              fileno(fileHandle), 0);
+
+  if (data == MAP_FAILED) {
+    logDebug("Could not map file into memory");
+    free(mappedFile);
+    return NULL;
+  }
+
+  // Blocks are always consumed front to back, so ask for aggressive read-ahead
+  posix_madvise(data, mappedFile->size, POSIX_MADV_SEQUENTIAL);
+  mappedFile->data = (const byte *)data;
+#endif
+
+  return mappedFile;
+}
+
+void freeMappedFile(MappedFile self) {
+  if (self != NULL) {
+#if WINDOWS
+    UnmapViewOfFile(self->data);
+    CloseHandle(self->_mappingHandle);
+#elif UNIX
+    munmap((void *)self->data, self->size);
+#endif
+    free(self);
+  }
+}
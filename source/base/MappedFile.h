@@ -0,0 +1,66 @@
+//
+// MappedFile.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_MappedFile_h
+#define MrsWatson_MappedFile_h
+
+#include "base/Types.h"
+
+#include <stdio.h>
+
+#if WINDOWS
+#include <Windows.h>
+#endif
+
+typedef struct {
+  /** Start of the mapped file contents. This memory is read-only. */
+  const byte *data;
+  /** Size of the mapping, which is the size of the file when it was mapped */
+  size_t size;
+
+#if WINDOWS
+  HANDLE _mappingHandle;
+#endif
+} MappedFileMembers;
+typedef MappedFileMembers *MappedFile;
+
+/**
+ * Map the entire contents of an open file into memory for reading. The file
+ * handle's position is not changed, and the handle may be closed once the
+ * mapping has been created.
+ * @param fileHandle File opened for reading. This must be a regular file and
+ * not a stream such as stdin.
+ * @return New mapped file, or NULL if the file is empty or could not be mapped
+ */
+MappedFile newMappedFile(FILE *fileHandle);
+
+/**
+ * Unmap a file and free the object
+ * @param self
+ */
+void freeMappedFile(MappedFile self);
+
+#endif
@@ -0,0 +1,117 @@
+//
+// MemoryArena.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "MemoryArena.h"
+
+#include <stdlib.h>
+
+// Enough for any of the basic types on all supported platforms
+static const size_t kMemoryArenaAlignment = 16;
+
+// Each block starts with a pointer to the block which was allocated before it,
+// padded so that the first allocation in the block is aligned
+typedef struct {
+  void *previousBlock;
+} _MemoryArenaBlockHeader;
+
+static size_t _memoryArenaAlign(size_t numBytes) {
+  return (numBytes + kMemoryArenaAlignment - 1) & ~(kMemoryArenaAlignment - 1);
+}
+
+MemoryArena newMemoryArena(size_t blockSize) {
+  MemoryArena self = (MemoryArena)malloc(sizeof(MemoryArenaMembers));
+
+  self->blockSize = blockSize;
+  self->totalSize = 0;
+  self->_currentBlock = NULL;
+  self->_currentBlockUsed = 0;
+  self->_currentBlockSize = 0;
+
+  return self;
+}
+
+static void *_memoryArenaNewBlock(MemoryArena self, void *previousBlock,
+                                  size_t numBytes) {
+  const size_t headerSize = _memoryArenaAlign(sizeof(_MemoryArenaBlockHeader));
+  _MemoryArenaBlockHeader *header =
+      (_MemoryArenaBlockHeader *)calloc(1, headerSize + numBytes);
+
+  header->previousBlock = previousBlock;
+  self->totalSize += headerSize + numBytes;
+  return header;
+}
+
+void *memoryArenaAlloc(MemoryArena self, size_t numBytes) {
+  const size_t headerSize = _memoryArenaAlign(sizeof(_MemoryArenaBlockHeader));
+  _MemoryArenaBlockHeader *header;
+  char *result;
+
+  numBytes = _memoryArenaAlign(numBytes);
+
+  if (numBytes > self->blockSize) {
+    // Put large allocations behind the current block, so that the rest of the
+    // current block can still be used
+    if (self->_currentBlock == NULL) {
+      self->_currentBlock = _memoryArenaNewBlock(self, NULL, numBytes);
+      self->_currentBlockUsed = numBytes;
+      self->_currentBlockSize = numBytes;
+      return (char *)self->_currentBlock + headerSize;
+    }
+
+    header = (_MemoryArenaBlockHeader *)self->_currentBlock;
+    header->previousBlock =
+        _memoryArenaNewBlock(self, header->previousBlock, numBytes);
+    return (char *)header->previousBlock + headerSize;
+  }
+
+  if (self->_currentBlock == NULL ||
+      self->_currentBlockUsed + numBytes > self->_currentBlockSize) {
+    self->_currentBlock =
+        _memoryArenaNewBlock(self, self->_currentBlock, self->blockSize);
+    self->_currentBlockUsed = 0;
+    self->_currentBlockSize = self->blockSize;
+  }
+
+  result = (char *)self->_currentBlock + headerSize + self->_currentBlockUsed;
+  self->_currentBlockUsed += numBytes;
+  return result;
+}
+
+void freeMemoryArena(MemoryArena self) {
+  _MemoryArenaBlockHeader *header;
+
+  if (self == NULL) {
+    return;
+  }
+
+  while (self->_currentBlock != NULL) {
+    header = (_MemoryArenaBlockHeader *)self->_currentBlock;
+    self->_currentBlock = header->previousBlock;
+    free(header);
+  }
+
+  free(self);
+}
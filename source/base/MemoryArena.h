@@ -0,0 +1,75 @@
+//
+// MemoryArena.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_MemoryArena_h
+#define MrsWatson_MemoryArena_h
+
+#include <stddef.h>
+
+/**
+ * An arena hands out memory from large blocks, and frees all of it at once
+ * when the arena itself is freed. This is much cheaper than calling malloc()
+ * and free() for each of a large number of small objects which all have the
+ * same lifetime, for instance the events of a MIDI file. Memory from the arena
+ * must never be passed to free().
+ */
+typedef struct {
+  size_t blockSize;
+  /** Total size of all blocks which have been allocated, in bytes */
+  size_t totalSize;
+
+  // Private fields
+  void *_currentBlock;
+  size_t _currentBlockUsed;
+  size_t _currentBlockSize;
+} MemoryArenaMembers;
+typedef MemoryArenaMembers *MemoryArena;
+
+/**
+ * Create a new arena. No memory is allocated for the blocks until the first
+ * call to memoryArenaAlloc().
+ * @param blockSize Size of each block in bytes. Allocations which are larger
+ * than this get a block of their own.
+ * @return New arena
+ */
+MemoryArena newMemoryArena(size_t blockSize);
+
+/**
+ * Allocate memory from an arena. The memory is suitably aligned for any type,
+ * and is set to zero.
+ * @param self
+ * @param numBytes Number of bytes to allocate
+ * @return Pointer to the memory, which is valid until the arena is freed
+ */
+void *memoryArenaAlloc(MemoryArena self, size_t numBytes);
+
+/**
+ * Free an arena, together with all memory which was allocated from it
+ * @param self
+ */
+void freeMemoryArena(MemoryArena self);
+
+#endif
@@ -0,0 +1,73 @@
+//
+// MemoryLock.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "MemoryLock.h"
+
+#include "logging/EventLogger.h"
+
+#include <stddef.h>
+
+#if LINUX
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#endif
+
+// Smallest page size of all supported platforms, touching every page of a
+// larger size more than once does no harm
+#define MEMORY_LOCK_PAGE_SIZE 4096
+
+boolByte memoryLockAll(void) {
+#if LINUX
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    logWarn("Could not lock memory: %s", strerror(errno));
+    return false;
+  }
+
+  logDebug("Locked process memory");
+  return true;
+#else
+  logWarn("Locking memory is not supported on this platform");
+  return false;
+#endif
+}
+
+void memoryUnlockAll(void) {
+#if LINUX
+  munlockall();
+#endif
+}
+
+void memoryPrefaultStack(void) {
+  // Volatile so that the writes are not optimized away
+  volatile unsigned char stack[MEMORY_LOCK_STACK_SIZE];
+  size_t i;
+
+  for (i = 0; i < MEMORY_LOCK_STACK_SIZE; i += MEMORY_LOCK_PAGE_SIZE) {
+    stack[i] = 0;
+  }
+
+  (void)stack[0];
+}
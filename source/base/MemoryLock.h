@@ -0,0 +1,57 @@
+//
+// MemoryLock.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_MemoryLock_h
+#define MrsWatson_MemoryLock_h
+
+#include "base/Types.h"
+
+// Amount of stack prefaulted by memoryPrefaultStack(), which is far more than
+// any plugin should need for processing a block
+#define MEMORY_LOCK_STACK_SIZE (256 * 1024)
+
+/**
+ * Lock all pages of the process into memory, including the ones which are
+ * mapped afterwards, so that realtime processing is never stalled by paging.
+ * This usually requires elevated privileges or a large enough memory lock
+ * limit, and is only supported on Linux.
+ * @return True if the memory was locked
+ */
+boolByte memoryLockAll(void);
+
+/**
+ * Unlock pages locked with memoryLockAll(). Does nothing if memory was not
+ * locked.
+ */
+void memoryUnlockAll(void);
+
+/**
+ * Write to MEMORY_LOCK_STACK_SIZE bytes of stack below the calling function, so
+ * that its pages are mapped before they are needed by time-critical code. This
+ * only affects the calling thread's stack.
+ */
+void memoryPrefaultStack(void);
+
+#endif
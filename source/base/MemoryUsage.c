@@ -0,0 +1,133 @@
+//
+// MemoryUsage.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "MemoryUsage.h"
+
+#include "base/PlatformInfo.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+MemoryUsage memoryUsageInstance = NULL;
+
+void initMemoryUsage(void) {
+  if (memoryUsageInstance != NULL) {
+    return;
+  }
+
+  memoryUsageInstance = (MemoryUsage)malloc(sizeof(MemoryUsageMembers));
+  memset(memoryUsageInstance->current, 0,
+         sizeof(memoryUsageInstance->current));
+  memset(memoryUsageInstance->peak, 0, sizeof(memoryUsageInstance->peak));
+  memoryUsageInstance->budget = 0;
+  memoryUsageInstance->_mutex = newMutex();
+}
+
+void memoryUsageAdd(const MemoryUsageCategory category, const size_t numBytes) {
+  MemoryUsage self = memoryUsageInstance;
+
+  if (self == NULL || numBytes == 0) {
+    return;
+  }
+
+  mutexLock(self->_mutex);
+  self->current[category] += numBytes;
+
+  if (self->current[category] > self->peak[category]) {
+    self->peak[category] = self->current[category];
+  }
+
+  mutexUnlock(self->_mutex);
+}
+
+void memoryUsageRemove(const MemoryUsageCategory category,
+                       const size_t numBytes) {
+  MemoryUsage self = memoryUsageInstance;
+
+  if (self == NULL || numBytes == 0) {
+    return;
+  }
+
+  mutexLock(self->_mutex);
+
+  // Objects which were allocated before counting started are freed without
+  // ever having been added
+  if (numBytes > self->current[category]) {
+    self->current[category] = 0;
+  } else {
+    self->current[category] -= numBytes;
+  }
+
+  mutexUnlock(self->_mutex);
+}
+
+size_t memoryUsageGetPeak(const MemoryUsageCategory category) {
+  size_t result;
+
+  if (memoryUsageInstance == NULL) {
+    return 0;
+  }
+
+  mutexLock(memoryUsageInstance->_mutex);
+  result = memoryUsageInstance->peak[category];
+  mutexUnlock(memoryUsageInstance->_mutex);
+  return result;
+}
+
+const char *memoryUsageGetCategoryName(const MemoryUsageCategory category) {
+  switch (category) {
+  case kMemoryUsageSampleBuffers:
+    return "sample_buffers";
+  case kMemoryUsageMidiSequences:
+    return "midi_sequences";
+  case kMemoryUsagePresetChunks:
+    return "preset_chunks";
+  default:
+    return "unknown";
+  }
+}
+
+void memoryUsageSetBudget(const size_t numBytes) {
+  if (memoryUsageInstance != NULL) {
+    memoryUsageInstance->budget = numBytes;
+  }
+}
+
+boolByte memoryUsageFitsBudget(const size_t numBytes) {
+  if (memoryUsageInstance == NULL || memoryUsageInstance->budget == 0) {
+    return true;
+  }
+
+  return (boolByte)((size_t)platformInfoGetMemoryUsage() * 1024 + numBytes <=
+                    memoryUsageInstance->budget);
+}
+
+void freeMemoryUsage(void) {
+  if (memoryUsageInstance != NULL) {
+    freeMutex(memoryUsageInstance->_mutex);
+    free(memoryUsageInstance);
+    memoryUsageInstance = NULL;
+  }
+}
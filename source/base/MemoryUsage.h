@@ -0,0 +1,115 @@
+//
+// MemoryUsage.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_MemoryUsage_h
+#define MrsWatson_MemoryUsage_h
+
+#include "base/Thread.h"
+#include "base/Types.h"
+
+#include <stddef.h>
+
+typedef enum {
+  kMemoryUsageSampleBuffers,
+  kMemoryUsageMidiSequences,
+  kMemoryUsagePresetChunks,
+  kMemoryUsageNumCategories
+} MemoryUsageCategory;
+
+/**
+ * Keeps track of how much memory is used by the larger kinds of objects, so
+ * that the peak usage can be reported per category, and of an optional budget
+ * for the resident memory of the whole process. Memory is only counted once
+ * initMemoryUsage() has been called. The tracker is shared by all threads.
+ */
+typedef struct {
+  size_t current[kMemoryUsageNumCategories];
+  size_t peak[kMemoryUsageNumCategories];
+  size_t budget;
+
+  // Private fields
+  Mutex _mutex;
+} MemoryUsageMembers;
+typedef MemoryUsageMembers *MemoryUsage;
+
+extern MemoryUsage memoryUsageInstance;
+
+/**
+ * Start counting memory usage. Does nothing if counting was already started.
+ */
+void initMemoryUsage(void);
+
+/**
+ * Count memory which was allocated. Does nothing if initMemoryUsage() was not
+ * called.
+ * @param category Kind of object which the memory belongs to
+ * @param numBytes Size of the allocation
+ */
+void memoryUsageAdd(const MemoryUsageCategory category, const size_t numBytes);
+
+/**
+ * Count memory which was freed. Does nothing if initMemoryUsage() was not
+ * called.
+ * @param category Kind of object which the memory belonged to
+ * @param numBytes Size of the allocation, as passed to memoryUsageAdd()
+ */
+void memoryUsageRemove(const MemoryUsageCategory category,
+                       const size_t numBytes);
+
+/**
+ * @param category Kind of object
+ * @return Highest number of bytes which were used by this category at once,
+ * or 0 if memory usage is not being counted
+ */
+size_t memoryUsageGetPeak(const MemoryUsageCategory category);
+
+/**
+ * @param category Kind of object
+ * @return Name of the category, suitable for reports
+ */
+const char *memoryUsageGetCategoryName(const MemoryUsageCategory category);
+
+/**
+ * Limit the resident memory of the process. The budget is not enforced, but
+ * code which could either load something into memory at once or stream it
+ * should check memoryUsageFitsBudget() first. Does nothing if initMemoryUsage()
+ * was not called.
+ * @param numBytes Budget in bytes, or 0 for no limit
+ */
+void memoryUsageSetBudget(const size_t numBytes);
+
+/**
+ * @param numBytes Amount of memory which is about to be used
+ * @return True if the process's resident memory plus this amount stays within
+ * the budget, or if there is no budget
+ */
+boolByte memoryUsageFitsBudget(const size_t numBytes);
+
+/**
+ * Stop counting memory usage and free the tracker
+ */
+void freeMemoryUsage(void);
+
+#endif
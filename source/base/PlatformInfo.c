@@ -29,6 +29,7 @@
 #include "logging/EventLogger.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #if LINUX
@@ -40,6 +41,14 @@
 #elif WINDOWS
 #include <VersionHelpers.h>
 #include <ntverp.h>
+#include <psapi.h>
+#elif MACOSX
+#include <mach/mach.h>
+#endif
+
+#if UNIX
+#include <sys/resource.h>
+#include <unistd.h>
 #endif
 
 static PlatformType _getPlatformType() {
@@ -73,15 +82,14 @@ static void _findLsbDistribution(void *item, void *userData) {
   LinkedList tokens = charStringSplit(line, '=');
 
   if (tokens != NULL && linkedListLength(tokens) == 2) {
-    CharString *tokensArray = (CharString *)linkedListToArray(tokens);
-    CharString key = tokensArray[0];
-    CharString value = tokensArray[1];
+    LinkedListIterator iterator = linkedListBegin(tokens);
+    CharString key = (CharString)linkedListIteratorGetItem(iterator);
+    CharString value =
+        (CharString)linkedListIteratorGetItem(linkedListIteratorNext(iterator));
 
     if (!strcmp(key->data, LSB_DISTRIBUTION)) {
       charStringCopy(distributionName, value);
     }
-
-    free(tokensArray);
   }
 
   freeLinkedListAndItems(tokens, (LinkedListFreeItemFunc)freeCharString);
@@ -182,6 +190,8 @@ static CharString _getPlatformName(void) {
   return result;
 }
 
+PlatformType platformInfoGetType(void) { return _getPlatformType(); }
+
 boolByte platformInfoIsRuntime64Bit(void) {
   return (boolByte)(sizeof(void *) == 8);
 }
@@ -230,6 +240,235 @@ boolByte platformInfoIsLittleEndian(void) {
   return (boolByte)(*(char *)&num == 1);
 }
 
+unsigned long platformInfoGetPeakMemoryUsage(void) {
+#if WINDOWS
+  PROCESS_MEMORY_COUNTERS counters;
+
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return (unsigned long)(counters.PeakWorkingSetSize / 1024);
+  }
+#elif UNIX
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if MACOSX
+    // Reported in bytes on Mac OS X, but in kilobytes on Linux
+    return (unsigned long)(usage.ru_maxrss / 1024);
+#else
+    return (unsigned long)usage.ru_maxrss;
+#endif
+  }
+#endif
+
+  return 0;
+}
+
+unsigned long platformInfoGetMemoryUsage(void) {
+#if WINDOWS
+  PROCESS_MEMORY_COUNTERS counters;
+
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return (unsigned long)(counters.WorkingSetSize / 1024);
+  }
+#elif MACOSX
+  mach_task_basic_info_data_t taskInfo;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&taskInfo,
+                &count) == KERN_SUCCESS) {
+    return (unsigned long)(taskInfo.resident_size / 1024);
+  }
+#elif LINUX
+  FILE *statm = fopen("/proc/self/statm", "r");
+  unsigned long totalPages;
+  unsigned long residentPages;
+  int numFields = 0;
+
+  if (statm != NULL) {
+    numFields = fscanf(statm, "%lu %lu", &totalPages, &residentPages);
+    fclose(statm);
+  }
+
+  if (numFields == 2) {
+    return residentPages * (unsigned long)sysconf(_SC_PAGESIZE) / 1024;
+  }
+#endif
+
+  return 0;
+}
+
+double platformInfoGetProcessCpuTime(void) {
+#if WINDOWS
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  ULARGE_INTEGER kernel, user;
+
+  if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime,
+                      &kernelTime, &userTime)) {
+    kernel.LowPart = kernelTime.dwLowDateTime;
+    kernel.HighPart = kernelTime.dwHighDateTime;
+    user.LowPart = userTime.dwLowDateTime;
+    user.HighPart = userTime.dwHighDateTime;
+    // FILETIME counts in units of 100ns
+    return (double)(kernel.QuadPart + user.QuadPart) / 10000.0;
+  }
+#elif UNIX
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+  }
+#endif
+
+  return 0.0;
+}
+
+unsigned long platformInfoGetMappedMemoryUsage(const char *path) {
+  unsigned long result = 0;
+#if LINUX
+  // Mapping lines may contain a full path, which can be longer than a CharString
+  char line[4096];
+  const size_t pathLength = strlen(path);
+  boolByte matchingMapping = false;
+  unsigned long residentSize;
+  FILE *smaps;
+  char *fieldEnd;
+  int pathOffset;
+
+  if (pathLength == 0 || (smaps = fopen("/proc/self/smaps", "r")) == NULL) {
+    return 0;
+  }
+
+  while (fgets(line, sizeof(line), smaps) != NULL) {
+    // Each mapping starts with a line of its address range, permissions,
+    // offset, device, inode and path, followed by lines of "Field: value"
+    fieldEnd = line + strcspn(line, " \t");
+
+    if (fieldEnd > line && fieldEnd[-1] == ':') {
+      if (matchingMapping && sscanf(line, "Rss: %lu", &residentSize) == 1) {
+        result += residentSize;
+      }
+    } else {
+      pathOffset = 0;
+      sscanf(line, "%*s %*s %*s %*s %*s %n", &pathOffset);
+      matchingMapping = (boolByte)(pathOffset > 0 && strncmp(line + pathOffset,
+                                                             path,
+                                                             pathLength) == 0);
+    }
+  }
+
+  fclose(smaps);
+#endif
+  return result;
+}
+
+unsigned int platformInfoGetNumProcessors(void) {
+#if WINDOWS
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+  return (unsigned int)systemInfo.dwNumberOfProcessors;
+#elif UNIX
+  long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (numProcessors > 0) {
+    return (unsigned int)numProcessors;
+  }
+#endif
+
+  return 1;
+}
+
+#if LINUX
+// Files in /sys report a bigger size than their contents, so they can't be
+// read with fileReadContents()
+static CharString _readSysFileLine(const char *path) {
+  CharString result = NULL;
+  FILE *sysFile = fopen(path, "r");
+
+  if (sysFile != NULL) {
+    result = newCharStringWithCapacity(kCharStringLengthLong);
+
+    if (fgets(result->data, (int)result->capacity, sysFile) == NULL) {
+      freeCharString(result);
+      result = NULL;
+    } else {
+      result->data[strcspn(result->data, "\r\n")] = '\0';
+    }
+
+    fclose(sysFile);
+  }
+
+  return result;
+}
+#endif
+
+CharString platformInfoGetNumaNodeProcessors(const unsigned int node) {
+  CharString result = NULL;
+#if LINUX
+  char path[64];
+
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist",
+           node);
+  result = _readSysFileLine(path);
+#elif WINDOWS
+  ULONGLONG mask = 0;
+  char processor[16];
+
+  if (node <= 0xff && GetNumaNodeProcessorMask((UCHAR)node, &mask) &&
+      mask != 0) {
+    result = newCharString();
+
+    for (unsigned int i = 0; i < 64; ++i) {
+      if (mask & ((ULONGLONG)1 << i)) {
+        snprintf(processor, sizeof(processor), "%s%u",
+                 charStringIsEmpty(result) ? "" : ",", i);
+        charStringAppendCString(result, processor);
+      }
+    }
+  }
+#else
+  logUnsupportedFeature("NUMA node placement");
+  return NULL;
+#endif
+
+  if (result == NULL) {
+    logError("Could not find processors for NUMA node %d", node);
+  }
+
+  return result;
+}
+
+unsigned long platformInfoGetProcessorFrequency(const unsigned int processor) {
+  unsigned long result = 0;
+#if LINUX
+  char path[80];
+  CharString frequency;
+
+  snprintf(path, sizeof(path),
+           "/sys/devices/system/cpu/cpu%u/cpufreq/scaling_cur_freq", processor);
+  frequency = _readSysFileLine(path);
+
+  if (frequency != NULL) {
+    // The kernel reports the frequency in kHz
+    result = strtoul(frequency->data, NULL, 10) / 1000;
+    freeCharString(frequency);
+  }
+#endif
+  return result;
+}
+
+CharString platformInfoGetProcessorGovernor(const unsigned int processor) {
+#if LINUX
+  char path[80];
+
+  snprintf(path, sizeof(path),
+           "/sys/devices/system/cpu/cpu%u/cpufreq/scaling_governor", processor);
+  return _readSysFileLine(path);
+#else
+  return NULL;
+#endif
+}
+
 PlatformInfo newPlatformInfo(void) {
   PlatformInfo platformInfo = (PlatformInfo)malloc(sizeof(PlatformInfoMembers));
   platformInfo->type = _getPlatformType();
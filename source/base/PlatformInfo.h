@@ -46,8 +46,18 @@ typedef struct {
 } PlatformInfoMembers;
 typedef PlatformInfoMembers *PlatformInfo;
 
+/**
+ * @brief Get all information about the platform. Finding the name of the
+ * platform may read files or ask the system, so use platformInfoGetType() if
+ * only the type is needed.
+ */
 PlatformInfo newPlatformInfo(void);
 
+/**
+ * @brief Type of the platform which this executable was built for
+ */
+PlatformType platformInfoGetType(void);
+
 /**
  * @brief Static method which returns true if the host CPU is little endian
  */
@@ -63,6 +73,66 @@ boolByte platformInfoIsHost64Bit(void);
  */
 boolByte platformInfoIsRuntime64Bit(void);
 
+/**
+ * @brief Peak resident memory used by this process so far, in kilobytes
+ * @return Peak memory usage, or 0 if it could not be determined
+ */
+unsigned long platformInfoGetPeakMemoryUsage(void);
+
+/**
+ * @brief Resident memory currently used by this process, in kilobytes
+ * @return Memory usage, or 0 if it could not be determined
+ */
+unsigned long platformInfoGetMemoryUsage(void);
+
+/**
+ * @brief User and system CPU time used by all threads of this process so far
+ * @return CPU time in milliseconds, or 0 if it could not be determined
+ */
+double platformInfoGetProcessCpuTime(void);
+
+/**
+ * @brief Resident memory of all files mapped by this process whose path starts
+ * with the given path, such as the libraries of a plugin. This is only
+ * supported on Linux.
+ * @param path Path of a file or directory
+ * @return Resident memory of the mappings in kilobytes, or 0 if there are none
+ * or it could not be determined
+ */
+unsigned long platformInfoGetMappedMemoryUsage(const char *path);
+
+/**
+ * @brief Number of processors which are currently online
+ * @return Number of processors, which is always at least 1
+ */
+unsigned int platformInfoGetNumProcessors(void);
+
+/**
+ * @brief Processors which belong to a NUMA node
+ * @param node Index of the node, starting from 0
+ * @return Processor list in the format accepted by threadSetAffinityList(), or
+ * NULL if the node does not exist or NUMA is not supported on this platform
+ */
+CharString platformInfoGetNumaNodeProcessors(const unsigned int node);
+
+/**
+ * @brief Current clock speed of a processor. With frequency scaling this
+ * changes over time, so it is only a snapshot. This is only supported on
+ * Linux.
+ * @param processor Index of the processor, starting from 0
+ * @return Clock speed in MHz, or 0 if it could not be determined
+ */
+unsigned long platformInfoGetProcessorFrequency(const unsigned int processor);
+
+/**
+ * @brief Name of the frequency scaling governor of a processor, such as
+ * "performance" or "powersave". This is only supported on Linux.
+ * @param processor Index of the processor, starting from 0
+ * @return Governor name, or NULL if there is no frequency scaling or it could
+ * not be determined
+ */
+CharString platformInfoGetProcessorGovernor(const unsigned int processor);
+
 void freePlatformInfo(PlatformInfo self);
 
 #endif
@@ -0,0 +1,356 @@
+//
+// Process.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Must be declared before stdlib, shouldn't have any effect on Windows builds
+#define _XOPEN_SOURCE 700
+
+#include "Process.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Size of the buffer used when reading output from the child
+#define PROCESS_READ_BUFFER_SIZE 1024
+
+#if WINDOWS
+static void _appendQuotedArgument(CharString commandLine,
+                                  const CharString argument) {
+  charStringAppendCString(commandLine, " \"");
+  charStringAppend(commandLine, argument);
+  charStringAppendCString(commandLine, "\"");
+}
+
+Process newProcess(const CharString executable, LinkedList arguments) {
+  Process self;
+  SECURITY_ATTRIBUTES securityAttributes;
+  STARTUPINFOA startupInfo;
+  PROCESS_INFORMATION processInfo;
+  HANDLE readPipe = NULL;
+  HANDLE writePipe = NULL;
+  HANDLE nullHandle;
+  CharString commandLine = newCharString();
+  LinkedListIterator iterator;
+  BOOL started;
+
+  securityAttributes.nLength = sizeof(securityAttributes);
+  securityAttributes.lpSecurityDescriptor = NULL;
+  securityAttributes.bInheritHandle = TRUE;
+  if (!CreatePipe(&readPipe, &writePipe, &securityAttributes, 0)) {
+    logError("Could not create pipe for child process");
+    freeCharString(commandLine);
+    return NULL;
+  }
+  // Only the write end should be inherited by the child
+  SetHandleInformation(readPipe, HANDLE_FLAG_INHERIT, 0);
+  nullHandle = CreateFileA("NUL", GENERIC_WRITE, FILE_SHARE_WRITE,
+                           &securityAttributes, OPEN_EXISTING, 0, NULL);
+
+  charStringAppendCString(commandLine, "\"");
+  charStringAppend(commandLine, executable);
+  charStringAppendCString(commandLine, "\"");
+  for (iterator = arguments; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    if (iterator->item != NULL) {
+      _appendQuotedArgument(commandLine, (CharString)iterator->item);
+    }
+  }
+
+  memset(&startupInfo, 0, sizeof(startupInfo));
+  startupInfo.cb = sizeof(startupInfo);
+  startupInfo.dwFlags = STARTF_USESTDHANDLES;
+  startupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+  startupInfo.hStdOutput = writePipe;
+  startupInfo.hStdError = nullHandle;
+  memset(&processInfo, 0, sizeof(processInfo));
+
+  started = CreateProcessA(executable->data, commandLine->data, NULL, NULL,
+                           TRUE, CREATE_NO_WINDOW, NULL, NULL, &startupInfo,
+                           &processInfo);
+  CloseHandle(writePipe);
+  if (nullHandle != INVALID_HANDLE_VALUE) {
+    CloseHandle(nullHandle);
+  }
+  freeCharString(commandLine);
+
+  if (!started) {
+    logError("Could not start child process '%s'", executable->data);
+    CloseHandle(readPipe);
+    return NULL;
+  }
+
+  CloseHandle(processInfo.hThread);
+  self = (Process)malloc(sizeof(ProcessMembers));
+  self->output = newCharString();
+  self->finished = false;
+  self->exitCode = -1;
+  self->_handle = processInfo.hProcess;
+  self->_outputPipe = readPipe;
+  return self;
+}
+
+static void _readOutput(Process self) {
+  char buffer[PROCESS_READ_BUFFER_SIZE];
+  DWORD bytesAvailable = 0;
+  DWORD bytesRead = 0;
+
+  while (PeekNamedPipe(self->_outputPipe, NULL, 0, NULL, &bytesAvailable,
+                       NULL) &&
+         bytesAvailable > 0) {
+    if (!ReadFile(self->_outputPipe, buffer, PROCESS_READ_BUFFER_SIZE - 1,
+                  &bytesRead, NULL) ||
+        bytesRead == 0) {
+      break;
+    }
+    buffer[bytesRead] = '\0';
+    charStringAppendCString(self->output, buffer);
+  }
+}
+
+boolByte processPoll(Process self) {
+  DWORD exitCode;
+
+  if (self->finished) {
+    return true;
+  }
+
+  _readOutput(self);
+  if (WaitForSingleObject(self->_handle, 0) == WAIT_OBJECT_0) {
+    // Anything written just before exiting is still in the pipe
+    _readOutput(self);
+    if (GetExitCodeProcess(self->_handle, &exitCode)) {
+      self->exitCode = (int)exitCode;
+    }
+    self->finished = true;
+  }
+
+  return self->finished;
+}
+
+void processKill(Process self) {
+  if (!self->finished) {
+    TerminateProcess(self->_handle, 1);
+    WaitForSingleObject(self->_handle, INFINITE);
+    self->exitCode = -1;
+    self->finished = true;
+  }
+}
+
+Process newProcessForked(boolByte *outIsChild) {
+  *outIsChild = false;
+  logUnsupportedFeature("Forking processes");
+  return NULL;
+}
+
+void freeProcess(Process self) {
+  if (self != NULL) {
+    processKill(self);
+    CloseHandle(self->_handle);
+    CloseHandle(self->_outputPipe);
+    freeCharString(self->output);
+    free(self);
+  }
+}
+
+#elif UNIX
+Process newProcess(const CharString executable, LinkedList arguments) {
+  Process self;
+  int pipeFds[2];
+  char **argv;
+  int numArguments = linkedListLength(arguments);
+  int i = 0;
+  LinkedListIterator iterator;
+  pid_t pid;
+
+  if (pipe(pipeFds) != 0) {
+    logError("Could not create pipe for child process");
+    return NULL;
+  }
+
+  // The argument vector must be built before forking, since the child may
+  // only call async-signal-safe functions
+  argv = (char **)malloc(sizeof(char *) * (size_t)(numArguments + 2));
+  argv[i++] = executable->data;
+  for (iterator = arguments; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    if (iterator->item != NULL) {
+      argv[i++] = ((CharString)iterator->item)->data;
+    }
+  }
+  argv[i] = NULL;
+
+  pid = fork();
+  if (pid == 0) {
+    int nullFd = open("/dev/null", O_WRONLY);
+    dup2(pipeFds[1], STDOUT_FILENO);
+    if (nullFd >= 0) {
+      dup2(nullFd, STDERR_FILENO);
+      close(nullFd);
+    }
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+    execv(executable->data, argv);
+    _exit(127);
+  }
+
+  free(argv);
+  close(pipeFds[1]);
+  if (pid < 0) {
+    logError("Could not start child process '%s'", executable->data);
+    close(pipeFds[0]);
+    return NULL;
+  }
+
+  fcntl(pipeFds[0], F_SETFL, fcntl(pipeFds[0], F_GETFL) | O_NONBLOCK);
+  self = (Process)malloc(sizeof(ProcessMembers));
+  self->output = newCharString();
+  self->finished = false;
+  self->exitCode = -1;
+  self->_pid = pid;
+  self->_outputPipe = pipeFds[0];
+  return self;
+}
+
+Process newProcessForked(boolByte *outIsChild) {
+  Process self;
+  pid_t pid;
+
+  *outIsChild = false;
+  // Anything which is still buffered would otherwise be written by both
+  fflush(stdout);
+  fflush(stderr);
+  pid = fork();
+
+  if (pid == 0) {
+    *outIsChild = true;
+    return NULL;
+  } else if (pid < 0) {
+    logError("Could not fork process");
+    return NULL;
+  }
+
+  self = (Process)malloc(sizeof(ProcessMembers));
+  self->output = newCharString();
+  self->finished = false;
+  self->exitCode = -1;
+  self->_pid = pid;
+  self->_outputPipe = -1;
+  return self;
+}
+
+static void _readOutput(Process self) {
+  char buffer[PROCESS_READ_BUFFER_SIZE];
+  ssize_t bytesRead;
+
+  if (self->_outputPipe < 0) {
+    return;
+  }
+
+  while (true) {
+    bytesRead = read(self->_outputPipe, buffer, PROCESS_READ_BUFFER_SIZE - 1);
+    if (bytesRead > 0) {
+      buffer[bytesRead] = '\0';
+      charStringAppendCString(self->output, buffer);
+    } else if (bytesRead < 0 && errno == EINTR) {
+      continue;
+    } else {
+      // Either the child closed its end of the pipe (0), or no more output is
+      // available right now (EAGAIN)
+      break;
+    }
+  }
+}
+
+boolByte processPoll(Process self) {
+  int status;
+
+  if (self->finished) {
+    return true;
+  }
+
+  _readOutput(self);
+  if (waitpid(self->_pid, &status, WNOHANG) == self->_pid) {
+    // Anything written just before exiting is still in the pipe
+    _readOutput(self);
+    self->exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    self->finished = true;
+  }
+
+  return self->finished;
+}
+
+void processKill(Process self) {
+  int status;
+
+  if (!self->finished) {
+    kill(self->_pid, SIGKILL);
+    waitpid(self->_pid, &status, 0);
+    self->exitCode = -1;
+    self->finished = true;
+  }
+}
+
+void freeProcess(Process self) {
+  if (self != NULL) {
+    processKill(self);
+
+    if (self->_outputPipe >= 0) {
+      close(self->_outputPipe);
+    }
+
+    freeCharString(self->output);
+    free(self);
+  }
+}
+
+#else
+Process newProcess(const CharString executable, LinkedList arguments) {
+  logUnsupportedFeature("Child processes");
+  return NULL;
+}
+
+Process newProcessForked(boolByte *outIsChild) {
+  *outIsChild = false;
+  logUnsupportedFeature("Forking processes");
+  return NULL;
+}
+
+boolByte processPoll(Process self) { return true; }
+
+void processKill(Process self) {}
+
+void freeProcess(Process self) {}
+#endif
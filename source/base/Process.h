@@ -0,0 +1,98 @@
+//
+// Process.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_Process_h
+#define MrsWatson_Process_h
+
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+#include "base/Types.h"
+
+#if WINDOWS
+#include <Windows.h>
+#elif UNIX
+#include <sys/types.h>
+#endif
+
+typedef struct {
+  /** Everything which the child process has written to stdout so far */
+  CharString output;
+  boolByte finished;
+  /** Exit code of the child, or -1 if it was killed or crashed */
+  int exitCode;
+
+#if WINDOWS
+  HANDLE _handle;
+  HANDLE _outputPipe;
+#elif UNIX
+  pid_t _pid;
+  int _outputPipe;
+#endif
+} ProcessMembers;
+typedef ProcessMembers *Process;
+
+/**
+ * Start a child process. The child's stdout is captured into the output
+ * string, and its stderr is discarded. The child does not share any memory
+ * with the parent, so it may be used to run code which might crash or hang.
+ * @param executable Absolute path to the executable
+ * @param arguments List of CharString arguments, not including the executable
+ * @return New process, or NULL if the process could not be started
+ */
+Process newProcess(const CharString executable, LinkedList arguments);
+
+/**
+ * Fork a copy of the calling process. The child starts with the same memory as
+ * the parent, which both share copy-on-write until either of them changes it,
+ * but only the calling thread is running in the child. The child's output is
+ * not captured. Not supported on Windows.
+ * @param outIsChild Set to true in the child process, and false otherwise
+ * @return New process in the parent, or NULL in the child and if the process
+ * could not be forked
+ */
+Process newProcessForked(boolByte *outIsChild);
+
+/**
+ * Read any new output from a process and check if it has exited. This function
+ * never blocks.
+ * @param self
+ * @return True if the process has finished
+ */
+boolByte processPoll(Process self);
+
+/**
+ * Forcibly terminate a process and wait for it to exit.
+ * @param self
+ */
+void processKill(Process self);
+
+/**
+ * Release a process. If the process is still running, then it is killed.
+ * @param self
+ */
+void freeProcess(Process self);
+
+#endif
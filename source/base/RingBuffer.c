@@ -0,0 +1,203 @@
+//
+// RingBuffer.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "RingBuffer.h"
+
+#include "base/Thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static RingBuffer _newRingBuffer(size_t blockSize, unsigned int minNumBlocks,
+                                 boolByte multiProducer) {
+  RingBuffer self = (RingBuffer)malloc(sizeof(RingBufferMembers));
+  unsigned int numBlocks = 1;
+
+  while (numBlocks < minNumBlocks) {
+    numBlocks <<= 1;
+  }
+
+  memset(self, 0, sizeof(RingBufferMembers));
+  self->blockSize = blockSize;
+  self->numBlocks = numBlocks;
+  self->multiProducer = multiProducer;
+  self->_blocks = (byte *)malloc(blockSize * numBlocks);
+  self->_sequences = NULL;
+  self->_writeIndex = 0;
+  self->_readIndex = 0;
+
+  if (multiProducer) {
+    self->_sequences =
+        (volatile unsigned int *)malloc(sizeof(unsigned int) * numBlocks);
+
+    // Slot i is free for the producer which claims write index i
+    for (unsigned int i = 0; i < numBlocks; ++i) {
+      self->_sequences[i] = i;
+    }
+  }
+
+  return self;
+}
+
+RingBuffer newRingBuffer(size_t blockSize, unsigned int minNumBlocks) {
+  return _newRingBuffer(blockSize, minNumBlocks, false);
+}
+
+RingBuffer newRingBufferMultiProducer(size_t blockSize,
+                                      unsigned int minNumBlocks) {
+  return _newRingBuffer(blockSize, minNumBlocks, true);
+}
+
+static byte *_getBlock(RingBuffer self, unsigned int index) {
+  return self->_blocks + (size_t)(index & (self->numBlocks - 1)) *
+                             self->blockSize;
+}
+
+// Producers claim a slot by advancing the write index, and then publish it by
+// advancing the slot's sequence number. The consumer only reads a slot after
+// it has been published, so a producer which is still copying its block never
+// holds up the others.
+static boolByte _pushMultiProducer(RingBuffer self, const void *block) {
+  unsigned int writeIndex;
+  unsigned int sequence;
+
+  for (;;) {
+    writeIndex = atomicLoadAcquire(&self->_writeIndex);
+    sequence = atomicLoadAcquire(
+        &self->_sequences[writeIndex & (self->numBlocks - 1)]);
+
+    if (sequence == writeIndex) {
+      if (atomicCompareAndSwap(&self->_writeIndex, writeIndex,
+                               writeIndex + 1)) {
+        break;
+      }
+    } else if ((int)(sequence - writeIndex) < 0) {
+      // The slot still holds a block from the previous pass
+      return false;
+    }
+
+    // Otherwise another producer claimed this slot first, try the next one
+  }
+
+  memcpy(_getBlock(self, writeIndex), block, self->blockSize);
+  atomicStoreRelease(&self->_sequences[writeIndex & (self->numBlocks - 1)],
+                     writeIndex + 1);
+  return true;
+}
+
+boolByte ringBufferPush(RingBuffer self, const void *block) {
+  void *destination;
+
+  if (self->multiProducer) {
+    return _pushMultiProducer(self, block);
+  }
+
+  destination = ringBufferBeginWrite(self);
+
+  if (destination == NULL) {
+    return false;
+  }
+
+  memcpy(destination, block, self->blockSize);
+  ringBufferEndWrite(self);
+  return true;
+}
+
+boolByte ringBufferPop(RingBuffer self, void *block) {
+  const void *source = ringBufferBeginRead(self);
+
+  if (source == NULL) {
+    return false;
+  }
+
+  memcpy(block, source, self->blockSize);
+  ringBufferEndRead(self);
+  return true;
+}
+
+void *ringBufferBeginWrite(RingBuffer self) {
+  // Only the producer stores the write index, so it can be read directly
+  const unsigned int writeIndex = self->_writeIndex;
+
+  if (self->multiProducer ||
+      writeIndex - atomicLoadAcquire(&self->_readIndex) >= self->numBlocks) {
+    return NULL;
+  }
+
+  return _getBlock(self, writeIndex);
+}
+
+void ringBufferEndWrite(RingBuffer self) {
+  atomicStoreRelease(&self->_writeIndex, self->_writeIndex + 1);
+}
+
+const void *ringBufferBeginRead(RingBuffer self) {
+  const unsigned int readIndex = self->_readIndex;
+
+  if (self->multiProducer) {
+    // The write index is claimed before the block is copied, so only the
+    // slot's sequence number tells whether the block is complete
+    if (atomicLoadAcquire(
+            &self->_sequences[readIndex & (self->numBlocks - 1)]) !=
+        readIndex + 1) {
+      return NULL;
+    }
+  } else if (atomicLoadAcquire(&self->_writeIndex) == readIndex) {
+    return NULL;
+  }
+
+  return _getBlock(self, readIndex);
+}
+
+void ringBufferEndRead(RingBuffer self) {
+  const unsigned int readIndex = self->_readIndex;
+
+  if (self->multiProducer) {
+    // Free the slot for the producer which claims it on the next pass
+    atomicStoreRelease(&self->_sequences[readIndex & (self->numBlocks - 1)],
+                       readIndex + self->numBlocks);
+  }
+
+  atomicStoreRelease(&self->_readIndex, readIndex + 1);
+}
+
+unsigned int ringBufferGetNumReadable(RingBuffer self) {
+  const unsigned int readIndex = atomicLoadAcquire(&self->_readIndex);
+  const unsigned int writeIndex = atomicLoadAcquire(&self->_writeIndex);
+  const unsigned int numReadable = writeIndex - readIndex;
+
+  // Both indices can't be read at once, so the consumer may have advanced
+  // past a write index which was read too early
+  return (int)numReadable < 0 ? 0 : numReadable;
+}
+
+void freeRingBuffer(RingBuffer self) {
+  if (self != NULL) {
+    free(self->_blocks);
+    free((void *)self->_sequences);
+    free(self);
+  }
+}
@@ -0,0 +1,155 @@
+//
+// RingBuffer.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_RingBuffer_h
+#define MrsWatson_RingBuffer_h
+
+#include "base/Types.h"
+
+#include <stddef.h>
+
+/**
+ * Size in bytes of a cache line on most processors. The indices of a ring
+ * buffer are kept this far apart, so that the producer and consumer do not
+ * invalidate each other's cache line on every operation.
+ */
+#define RING_BUFFER_CACHE_LINE_SIZE 64
+
+/**
+ * A ring buffer passes fixed-size blocks of memory from one thread to another
+ * without locking, so it can be used from realtime threads. Each ring has a
+ * single consuming thread, and either a single producing thread or, when it is
+ * created with newRingBufferMultiProducer(), any number of producing threads.
+ *
+ * With a single producer, pushing and popping are wait-free. With multiple
+ * producers, a producer may need to retry when another producer claims the
+ * same slot at the same time, but no thread ever blocks.
+ */
+typedef struct {
+  // Size of each block in bytes
+  size_t blockSize;
+  // Number of blocks which the ring can hold, always a power of two
+  unsigned int numBlocks;
+  boolByte multiProducer;
+
+  // Private fields
+  byte *_blocks;
+  // Only used with multiple producers. Each slot's sequence number tells
+  // whether it is free for the producer, or filled for the consumer, in the
+  // current pass over the ring.
+  volatile unsigned int *_sequences;
+  char _padding0[RING_BUFFER_CACHE_LINE_SIZE];
+  // Total number of blocks pushed and popped so far. These are allowed to wrap
+  // around, since only their difference is used.
+  volatile unsigned int _writeIndex;
+  char _padding1[RING_BUFFER_CACHE_LINE_SIZE];
+  volatile unsigned int _readIndex;
+  char _padding2[RING_BUFFER_CACHE_LINE_SIZE];
+} RingBufferMembers;
+typedef RingBufferMembers *RingBuffer;
+
+/**
+ * Create a ring buffer with a single producer and a single consumer.
+ * @param blockSize Size of each block in bytes
+ * @param minNumBlocks Minimum number of blocks the ring must hold, this is
+ * rounded up to the next power of two
+ * @return New ring buffer
+ */
+RingBuffer newRingBuffer(size_t blockSize, unsigned int minNumBlocks);
+
+/**
+ * Create a ring buffer which any number of threads may push to, while a single
+ * thread pops from it.
+ * @param blockSize Size of each block in bytes
+ * @param minNumBlocks Minimum number of blocks the ring must hold, this is
+ * rounded up to the next power of two
+ * @return New ring buffer
+ */
+RingBuffer newRingBufferMultiProducer(size_t blockSize,
+                                      unsigned int minNumBlocks);
+
+/**
+ * Copy a block into the ring.
+ * @param self
+ * @param block Block of blockSize bytes
+ * @return False if the ring is full, in which case nothing is copied
+ */
+boolByte ringBufferPush(RingBuffer self, const void *block);
+
+/**
+ * Copy the oldest block out of the ring and remove it.
+ * @param self
+ * @param block Destination for blockSize bytes
+ * @return False if the ring is empty, in which case nothing is copied
+ */
+boolByte ringBufferPop(RingBuffer self, void *block);
+
+/**
+ * Get the next free block, so that the producer can fill it in place instead
+ * of copying it with ringBufferPush(). The block is passed to the consumer by
+ * ringBufferEndWrite(). This is only possible with a single producer.
+ * @param self
+ * @return Block of blockSize bytes, or NULL if the ring is full or has
+ * multiple producers
+ */
+void *ringBufferBeginWrite(RingBuffer self);
+
+/**
+ * Pass the block returned by ringBufferBeginWrite() to the consumer.
+ * @param self
+ */
+void ringBufferEndWrite(RingBuffer self);
+
+/**
+ * Get the oldest block, so that the consumer can use it in place instead of
+ * copying it with ringBufferPop(). The block stays in the ring until
+ * ringBufferEndRead() is called.
+ * @param self
+ * @return Block of blockSize bytes, or NULL if the ring is empty
+ */
+const void *ringBufferBeginRead(RingBuffer self);
+
+/**
+ * Remove the block returned by ringBufferBeginRead() from the ring.
+ * @param self
+ */
+void ringBufferEndRead(RingBuffer self);
+
+/**
+ * Get the number of blocks in the ring. When called from other threads than
+ * the consumer, the result may already be outdated when it is returned.
+ * @param self
+ * @return Number of blocks which can be read
+ */
+unsigned int ringBufferGetNumReadable(RingBuffer self);
+
+/**
+ * Free a ring buffer and all blocks in it
+ * @param self
+ */
+void freeRingBuffer(RingBuffer self);
+
+#endif
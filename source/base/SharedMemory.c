@@ -0,0 +1,215 @@
+//
+// SharedMemory.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Must be declared before any system headers, needed for syscall()
+#if LINUX
+#define _GNU_SOURCE
+#else
+#define _XOPEN_SOURCE 700
+#endif
+
+#include "SharedMemory.h"
+
+#include "base/Thread.h"
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#if LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+// Number of times to check a value before sleeping, on platforms without futex
+#define SHARED_MEMORY_SPIN_COUNT 1000
+// Time to sleep between checks of a value once spinning has given up
+#define SHARED_MEMORY_SLEEP_IN_US 50
+
+#if UNIX
+static unsigned int sharedMemoryCounter = 0;
+
+static SharedMemory _newSharedMemory(const char *name, int fd, size_t size,
+                                     boolByte owner) {
+  SharedMemory self;
+  void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  close(fd);
+  if (data == MAP_FAILED) {
+    logError("Could not map shared memory '%s'", name);
+    return NULL;
+  }
+
+  self = (SharedMemory)malloc(sizeof(SharedMemoryMembers));
+  self->name = newCharStringWithCString(name);
+  self->data = data;
+  self->size = size;
+  self->_owner = owner;
+  return self;
+}
+
+SharedMemory newSharedMemory(size_t size) {
+  SharedMemory self;
+  char name[64];
+  int fd;
+
+  // macOS limits shared memory names to 31 characters
+  snprintf(name, sizeof(name), "/mrsw-%d-%u", (int)getpid(),
+           atomicAdd(&sharedMemoryCounter, 1));
+  fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    logError("Could not create shared memory '%s', got error %d", name, errno);
+    return NULL;
+  }
+
+  // A new shared memory object is zero-filled by ftruncate()
+  if (ftruncate(fd, (off_t)size) != 0) {
+    logError("Could not allocate %zu bytes of shared memory", size);
+    close(fd);
+    shm_unlink(name);
+    return NULL;
+  }
+
+  self = _newSharedMemory(name, fd, size, true);
+  if (self == NULL) {
+    shm_unlink(name);
+  }
+
+  return self;
+}
+
+SharedMemory newSharedMemoryWithName(const CharString name) {
+  struct stat fileStat;
+  int fd = shm_open(name->data, O_RDWR, 0);
+
+  if (fd < 0) {
+    logError("Could not open shared memory '%s', got error %d", name->data,
+             errno);
+    return NULL;
+  }
+
+  if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+    logError("Shared memory '%s' is empty", name->data);
+    close(fd);
+    return NULL;
+  }
+
+  return _newSharedMemory(name->data, fd, (size_t)fileStat.st_size, false);
+}
+
+boolByte sharedMemoryWait(volatile unsigned int *address,
+                          const unsigned int expectedValue,
+                          const unsigned long timeoutInMs) {
+#if LINUX
+  struct timespec timeout;
+
+  if (atomicLoad(address) != expectedValue) {
+    return true;
+  }
+
+  timeout.tv_sec = (time_t)(timeoutInMs / 1000);
+  timeout.tv_nsec = (long)(timeoutInMs % 1000) * 1000000L;
+  // The wait returns early if the value has already changed, or if it is woken
+  // by a signal, so the value is checked again in either case. This must not
+  // be a private futex, since the other side is a different process.
+  syscall(SYS_futex, address, FUTEX_WAIT, expectedValue, &timeout, NULL, 0);
+  return (boolByte)(atomicLoad(address) != expectedValue);
+#else
+  struct timespec sleepTime = {0, SHARED_MEMORY_SLEEP_IN_US * 1000L};
+  unsigned long numSleeps =
+      (timeoutInMs * 1000) / SHARED_MEMORY_SLEEP_IN_US + 1;
+  unsigned long i;
+
+  for (i = 0; i < SHARED_MEMORY_SPIN_COUNT; i++) {
+    if (atomicLoad(address) != expectedValue) {
+      return true;
+    }
+  }
+
+  for (i = 0; i < numSleeps; i++) {
+    if (atomicLoad(address) != expectedValue) {
+      return true;
+    }
+    nanosleep(&sleepTime, NULL);
+  }
+
+  return (boolByte)(atomicLoad(address) != expectedValue);
+#endif
+}
+
+void sharedMemoryWake(volatile unsigned int *address) {
+#if LINUX
+  syscall(SYS_futex, address, FUTEX_WAKE, 0x7fffffff, NULL, NULL, 0);
+#endif
+}
+
+void sharedMemoryUnlink(SharedMemory self) {
+  if (self->_owner) {
+    shm_unlink(self->name->data);
+    self->_owner = false;
+  }
+}
+
+void freeSharedMemory(SharedMemory self) {
+  if (self != NULL) {
+    munmap(self->data, self->size);
+    sharedMemoryUnlink(self);
+    freeCharString(self->name);
+    free(self);
+  }
+}
+
+#else
+SharedMemory newSharedMemory(size_t size) {
+  logUnsupportedFeature("Shared memory");
+  return NULL;
+}
+
+SharedMemory newSharedMemoryWithName(const CharString name) {
+  logUnsupportedFeature("Shared memory");
+  return NULL;
+}
+
+boolByte sharedMemoryWait(volatile unsigned int *address,
+                          const unsigned int expectedValue,
+                          const unsigned long timeoutInMs) {
+  return false;
+}
+
+void sharedMemoryWake(volatile unsigned int *address) {}
+
+void sharedMemoryUnlink(SharedMemory self) {}
+
+void freeSharedMemory(SharedMemory self) {}
+#endif
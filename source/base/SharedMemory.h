@@ -0,0 +1,99 @@
+//
+// SharedMemory.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_SharedMemory_h
+#define MrsWatson_SharedMemory_h
+
+#include "base/CharString.h"
+#include "base/Types.h"
+
+typedef struct {
+  /** Name which another process may use to open the same memory */
+  CharString name;
+  /** Start of the shared memory, which is zero-filled when it is created */
+  void *data;
+  /** Size of the shared memory in bytes */
+  size_t size;
+
+  // Private fields
+  boolByte _owner;
+} SharedMemoryMembers;
+typedef SharedMemoryMembers *SharedMemory;
+
+/**
+ * Create a new block of memory which can be shared with other processes. The
+ * memory is given a unique name, and is removed from the system when this
+ * object is freed.
+ * @param size Size of the memory in bytes
+ * @return New shared memory, or NULL if it could not be created
+ */
+SharedMemory newSharedMemory(size_t size);
+
+/**
+ * Open a block of shared memory which was created by another process
+ * @param name Name of the shared memory, as given by the creating process
+ * @return Shared memory of the size it was created with, or NULL if it could
+ * not be opened
+ */
+SharedMemory newSharedMemoryWithName(const CharString name);
+
+/**
+ * Wait until a value in shared memory differs from an expected value. This is
+ * used along with sharedMemoryWake() to signal other processes without a
+ * syscall in the common case where the value has already changed.
+ * @param address Address of the value, which must be in shared memory
+ * @param expectedValue Value to wait for a change from
+ * @param timeoutInMs Maximum time to wait
+ * @return True if the value changed, false if the wait timed out
+ */
+boolByte sharedMemoryWait(volatile unsigned int *address,
+                          const unsigned int expectedValue,
+                          const unsigned long timeoutInMs);
+
+/**
+ * Wake all processes waiting on a value in shared memory. The value should be
+ * changed before calling this function.
+ * @param address Address of the value, which must be in shared memory
+ */
+void sharedMemoryWake(volatile unsigned int *address);
+
+/**
+ * Remove the name of the shared memory from the system, once all other
+ * processes have opened it. The memory stays mapped until it is freed, and the
+ * system releases it once no process has it mapped, even if this process
+ * crashes.
+ * @param self
+ */
+void sharedMemoryUnlink(SharedMemory self);
+
+/**
+ * Unmap the shared memory and free the object. If this process created the
+ * memory, then it is also removed from the system.
+ * @param self
+ */
+void freeSharedMemory(SharedMemory self);
+
+#endif
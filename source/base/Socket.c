@@ -0,0 +1,537 @@
+//
+// Socket.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Must be declared before stdlib, shouldn't have any effect on Windows builds
+#define _XOPEN_SOURCE 700
+#if MACOSX
+// Needed for SO_NOSIGPIPE, which is hidden when _XOPEN_SOURCE is defined
+#define _DARWIN_C_SOURCE
+#endif
+
+#if WINDOWS
+// Must be included before anything which includes Windows.h
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+
+#include "Socket.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if UNIX
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Number of pending connections which may wait for socketAccept()
+static const int kSocketListenBacklog = 8;
+
+#if WINDOWS
+#define SOCKET_HANDLE_INVALID ((size_t)INVALID_SOCKET)
+#else
+#define SOCKET_HANDLE_INVALID -1
+#endif
+
+#if WINDOWS
+static boolByte _initSockets(void) {
+  static boolByte initialized = false;
+  WSADATA wsaData;
+
+  if (!initialized) {
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+      logError("Could not initialize Windows sockets");
+      return false;
+    }
+    initialized = true;
+  }
+
+  return true;
+}
+
+static void _closeSocketHandle(size_t handle) { closesocket((SOCKET)handle); }
+#else
+static boolByte _initSockets(void) { return true; }
+
+static void _closeSocketHandle(int handle) { close(handle); }
+#endif
+
+static boolByte _isPortAddress(const CharString address,
+                               unsigned short *outPort) {
+  char *end = NULL;
+  long port = strtol(address->data, &end, 10);
+
+  if (end == address->data || *end != '\0') {
+    return false;
+  } else if (port <= 0 || port > 65535) {
+    return false;
+  }
+
+  *outPort = (unsigned short)port;
+  return true;
+}
+
+static Socket _newSocket(const CharString address, boolByte listening,
+                         boolByte isUnixSocket) {
+  Socket self = (Socket)malloc(sizeof(SocketMembers));
+  self->address = newCharStringWithCapacity(address->capacity);
+  charStringCopy(self->address, address);
+  self->_listening = listening;
+  self->_isUnixSocket = isUnixSocket;
+  self->_ownsPath = listening;
+  self->_socket = SOCKET_HANDLE_INVALID;
+  return self;
+}
+
+static void _ignoreSigpipe(Socket self) {
+#if defined(SO_NOSIGPIPE)
+  int enabled = 1;
+  setsockopt(self->_socket, SOL_SOCKET, SO_NOSIGPIPE, &enabled,
+             sizeof(enabled));
+#else
+  (void)self;
+#endif
+}
+
+/**
+ * Create a socket handle and fill in the address to bind or connect to.
+ * @return True if the address was valid and the handle was created
+ */
+static boolByte _openSocket(Socket self, struct sockaddr_storage *outAddress,
+                            size_t *outAddressLength) {
+  unsigned short port;
+
+  memset(outAddress, 0, sizeof(struct sockaddr_storage));
+
+  if (!_initSockets()) {
+    return false;
+  }
+
+  if (_isPortAddress(self->address, &port)) {
+    struct sockaddr_in *inAddress = (struct sockaddr_in *)outAddress;
+    inAddress->sin_family = AF_INET;
+    inAddress->sin_port = htons(port);
+    inAddress->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    *outAddressLength = sizeof(struct sockaddr_in);
+    self->_socket = socket(AF_INET, SOCK_STREAM, 0);
+  } else {
+#if UNIX
+    struct sockaddr_un *unixAddress = (struct sockaddr_un *)outAddress;
+
+    if (strlen(self->address->data) >= sizeof(unixAddress->sun_path)) {
+      logError("Socket path '%s' is too long", self->address->data);
+      return false;
+    }
+
+    unixAddress->sun_family = AF_UNIX;
+    strncpy(unixAddress->sun_path, self->address->data,
+            sizeof(unixAddress->sun_path) - 1);
+    *outAddressLength = sizeof(struct sockaddr_un);
+    self->_isUnixSocket = true;
+    self->_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+#else
+    logError("'%s' is not a port number, and UNIX sockets are not supported "
+             "on this platform",
+             self->address->data);
+    return false;
+#endif
+  }
+
+  if (self->_socket == SOCKET_HANDLE_INVALID) {
+    logError("Could not create socket for '%s'", self->address->data);
+    return false;
+  }
+
+  return true;
+}
+
+#if UNIX
+static void _removeStaleUnixSocket(const CharString path) {
+  struct stat fileStat;
+
+  // Only remove sockets left over from an earlier run, never any other files
+  if (stat(path->data, &fileStat) == 0 && S_ISSOCK(fileStat.st_mode)) {
+    logDebug("Removing stale socket '%s'", path->data);
+    unlink(path->data);
+  }
+}
+#endif
+
+Socket newSocketListening(const CharString address) {
+  Socket self;
+  struct sockaddr_storage socketAddress;
+  size_t socketAddressLength = 0;
+  int enabled = 1;
+
+  if (address == NULL || charStringIsEmpty(address)) {
+    logError("No address given for socket");
+    return NULL;
+  }
+
+  self = _newSocket(address, true, false);
+
+  if (!_openSocket(self, &socketAddress, &socketAddressLength)) {
+    // Nothing was bound yet, so there is no socket file which could be removed
+    self->_isUnixSocket = false;
+    freeSocket(self);
+    return NULL;
+  }
+
+  if (self->_isUnixSocket) {
+#if UNIX
+    _removeStaleUnixSocket(self->address);
+#endif
+  } else {
+    setsockopt(self->_socket, SOL_SOCKET, SO_REUSEADDR, (const char *)&enabled,
+               sizeof(enabled));
+  }
+
+  if (bind(self->_socket, (struct sockaddr *)&socketAddress,
+           (int)socketAddressLength) != 0) {
+    logError("Could not bind socket to '%s'", self->address->data);
+    self->_isUnixSocket = false;
+    freeSocket(self);
+    return NULL;
+  }
+
+  if (listen(self->_socket, kSocketListenBacklog) != 0) {
+    logError("Could not listen on '%s'", self->address->data);
+    freeSocket(self);
+    return NULL;
+  }
+
+  return self;
+}
+
+Socket newSocketConnected(const CharString address) {
+  Socket self;
+  struct sockaddr_storage socketAddress;
+  size_t socketAddressLength = 0;
+
+  if (address == NULL || charStringIsEmpty(address)) {
+    logError("No address given for socket");
+    return NULL;
+  }
+
+  self = _newSocket(address, false, false);
+
+  if (!_openSocket(self, &socketAddress, &socketAddressLength)) {
+    freeSocket(self);
+    return NULL;
+  }
+
+  if (connect(self->_socket, (struct sockaddr *)&socketAddress,
+              (int)socketAddressLength) != 0) {
+    logError("Could not connect to '%s'", self->address->data);
+    freeSocket(self);
+    return NULL;
+  }
+
+  _ignoreSigpipe(self);
+  return self;
+}
+
+static Socket _newSocketForHost(const CharString host, unsigned short port,
+                                boolByte listening) {
+  CharString address = newCharStringWithCapacity(kCharStringLengthShort);
+  const boolByte anyHost = (boolByte)(host == NULL || charStringIsEmpty(host));
+  struct addrinfo hints;
+  struct addrinfo *results = NULL;
+  struct addrinfo *result;
+  char portString[8];
+  int enabled = 1;
+  Socket self;
+
+  snprintf(address->data, address->capacity, "%s:%u",
+           anyHost ? "*" : host->data, port);
+  self = _newSocket(address, listening, false);
+  freeCharString(address);
+
+  if (!_initSockets()) {
+    freeSocket(self);
+    return NULL;
+  }
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = listening ? AI_PASSIVE : 0;
+  snprintf(portString, sizeof(portString), "%u", port);
+
+  if (getaddrinfo(anyHost ? NULL : host->data, portString, &hints,
+                  &results) != 0) {
+    logError("Could not resolve '%s'", self->address->data);
+    freeSocket(self);
+    return NULL;
+  }
+
+  // Hosts may resolve to several addresses, for example both IPv4 and IPv6,
+  // so use the first one which works
+  for (result = results; result != NULL; result = result->ai_next) {
+    self->_socket =
+        socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+
+    if (self->_socket == SOCKET_HANDLE_INVALID) {
+      continue;
+    }
+
+    if (listening) {
+      setsockopt(self->_socket, SOL_SOCKET, SO_REUSEADDR,
+                 (const char *)&enabled, sizeof(enabled));
+
+      if (bind(self->_socket, result->ai_addr, (int)result->ai_addrlen) == 0 &&
+          listen(self->_socket, kSocketListenBacklog) == 0) {
+        break;
+      }
+    } else if (connect(self->_socket, result->ai_addr,
+                       (int)result->ai_addrlen) == 0) {
+      break;
+    }
+
+    _closeSocketHandle(self->_socket);
+    self->_socket = SOCKET_HANDLE_INVALID;
+  }
+
+  freeaddrinfo(results);
+
+  if (self->_socket == SOCKET_HANDLE_INVALID) {
+    logError("Could not %s '%s'", listening ? "listen on" : "connect to",
+             self->address->data);
+    freeSocket(self);
+    return NULL;
+  }
+
+  if (!listening) {
+    _ignoreSigpipe(self);
+  }
+
+  return self;
+}
+
+Socket newSocketListeningOnHost(const CharString host, unsigned short port) {
+  return _newSocketForHost(host, port, true);
+}
+
+Socket newSocketConnectedToHost(const CharString host, unsigned short port) {
+  if (host == NULL || charStringIsEmpty(host)) {
+    logError("No host given for socket");
+    return NULL;
+  }
+
+  return _newSocketForHost(host, port, false);
+}
+
+Socket socketAccept(Socket self) {
+  Socket connection;
+
+  if (self == NULL || !self->_listening) {
+    return NULL;
+  }
+
+  connection = _newSocket(self->address, false, self->_isUnixSocket);
+  connection->_socket = accept(self->_socket, NULL, NULL);
+
+  if (connection->_socket == SOCKET_HANDLE_INVALID) {
+    logError("Could not accept connection on '%s'", self->address->data);
+    freeSocket(connection);
+    return NULL;
+  }
+
+  _ignoreSigpipe(connection);
+  return connection;
+}
+
+boolByte socketReadLine(Socket self, CharString outLine) {
+  size_t length = 0;
+  char c;
+
+  if (self == NULL || self->_listening) {
+    return false;
+  }
+
+  charStringClear(outLine);
+
+  // Lines are short and only used for control messages, so reading one byte
+  // at a time avoids having to buffer data past the end of the line
+  while (recv(self->_socket, &c, 1, 0) == 1) {
+    if (c == '\n') {
+      if (length > 0 && outLine->data[length - 1] == '\r') {
+        outLine->data[length - 1] = '\0';
+      }
+      return true;
+    } else if (length + 1 >= outLine->capacity) {
+      logError("Line received on '%s' is too long", self->address->data);
+      return false;
+    }
+
+    outLine->data[length++] = c;
+    outLine->data[length] = '\0';
+  }
+
+  return false;
+}
+
+boolByte socketWriteLine(Socket self, const CharString line) {
+  size_t length;
+  size_t written = 0;
+  int flags = 0;
+  int result;
+
+  if (self == NULL || self->_listening) {
+    return false;
+  }
+
+#if defined(MSG_NOSIGNAL)
+  flags = MSG_NOSIGNAL;
+#endif
+
+  length = strlen(line->data);
+
+  while (written < length) {
+    result =
+        (int)send(self->_socket, line->data + written, (int)(length - written),
+                  flags);
+
+    if (result <= 0) {
+      return false;
+    }
+
+    written += (size_t)result;
+  }
+
+  return (boolByte)(send(self->_socket, "\n", 1, flags) == 1);
+}
+
+void socketSetStreamingOptions(Socket self, int bufferSize) {
+  int enabled = 1;
+
+  if (self == NULL || self->_listening || self->_isUnixSocket) {
+    return;
+  }
+
+  // None of these are fatal, the stream only gets a bit slower without them
+  if (setsockopt(self->_socket, IPPROTO_TCP, TCP_NODELAY,
+                 (const char *)&enabled, sizeof(enabled)) != 0) {
+    logDebug("Could not disable Nagle's algorithm on '%s'",
+             self->address->data);
+  }
+
+  if (setsockopt(self->_socket, SOL_SOCKET, SO_SNDBUF,
+                 (const char *)&bufferSize, sizeof(bufferSize)) != 0 ||
+      setsockopt(self->_socket, SOL_SOCKET, SO_RCVBUF,
+                 (const char *)&bufferSize, sizeof(bufferSize)) != 0) {
+    logDebug("Could not resize socket buffers on '%s'", self->address->data);
+  }
+}
+
+size_t socketRead(Socket self, void *data, size_t numBytes) {
+  size_t numRead = 0;
+  int result;
+
+  if (self == NULL || self->_listening) {
+    return 0;
+  }
+
+  while (numRead < numBytes) {
+    result = (int)recv(self->_socket, (char *)data + numRead,
+                       (int)(numBytes - numRead), 0);
+
+    if (result <= 0) {
+      break;
+    }
+
+    numRead += (size_t)result;
+  }
+
+  return numRead;
+}
+
+boolByte socketWrite(Socket self, const void *data, size_t numBytes) {
+  size_t written = 0;
+  int flags = 0;
+  int result;
+
+  if (self == NULL || self->_listening) {
+    return false;
+  }
+
+#if defined(MSG_NOSIGNAL)
+  flags = MSG_NOSIGNAL;
+#endif
+
+  while (written < numBytes) {
+    result = (int)send(self->_socket, (const char *)data + written,
+                       (int)(numBytes - written), flags);
+
+    if (result <= 0) {
+      return false;
+    }
+
+    written += (size_t)result;
+  }
+
+  return true;
+}
+
+void socketShutdown(Socket self) {
+#if WINDOWS
+  shutdown((SOCKET)self->_socket, SD_BOTH);
+#else
+  shutdown(self->_socket, SHUT_RDWR);
+#endif
+}
+
+void socketKeepPath(Socket self) {
+  if (self != NULL) {
+    self->_ownsPath = false;
+  }
+}
+
+void freeSocket(Socket self) {
+  if (self != NULL) {
+    if (self->_socket != SOCKET_HANDLE_INVALID) {
+      _closeSocketHandle(self->_socket);
+    }
+
+#if UNIX
+    if (self->_ownsPath && self->_isUnixSocket) {
+      unlink(self->address->data);
+    }
+#endif
+
+    freeCharString(self->address);
+    free(self);
+  }
+}
@@ -0,0 +1,169 @@
+//
+// Socket.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_Socket_h
+#define MrsWatson_Socket_h
+
+#include "base/CharString.h"
+#include "base/Types.h"
+
+typedef struct {
+  /** Address which was given when the socket was created */
+  CharString address;
+
+  // Private fields
+  boolByte _listening;
+  boolByte _isUnixSocket;
+  boolByte _ownsPath;
+#if WINDOWS
+  // Same width as SOCKET, which is not declared here so that this header does
+  // not have to include winsock2.h before Windows.h
+  size_t _socket;
+#else
+  int _socket;
+#endif
+} SocketMembers;
+typedef SocketMembers *Socket;
+
+/**
+ * Create a socket which listens for incoming connections. If the address is a
+ * number, then the socket listens on that TCP port of the loopback interface,
+ * so that only local clients may connect. Otherwise, the address is treated as
+ * the path of a UNIX domain socket, which is not supported on Windows.
+ * @param address Port number or socket path
+ * @return New socket, or NULL if the socket could not be created
+ */
+Socket newSocketListening(const CharString address);
+
+/**
+ * Connect to a listening socket, using the same address rules as
+ * newSocketListening().
+ * @param address Port number or socket path
+ * @return New socket, or NULL if the connection failed
+ */
+Socket newSocketConnected(const CharString address);
+
+/**
+ * Create a TCP socket which listens for connections from other machines.
+ * Unlike newSocketListening(), this is not restricted to the loopback
+ * interface.
+ * @param host Host name or address of the interface to listen on, or an empty
+ * string to listen on all interfaces
+ * @param port TCP port
+ * @return New socket, or NULL if the socket could not be created
+ */
+Socket newSocketListeningOnHost(const CharString host, unsigned short port);
+
+/**
+ * Connect to a TCP socket on another machine.
+ * @param host Host name or address to connect to
+ * @param port TCP port
+ * @return New socket, or NULL if the host could not be resolved or the
+ * connection failed
+ */
+Socket newSocketConnectedToHost(const CharString host, unsigned short port);
+
+/**
+ * Wait for the next connection on a listening socket.
+ * @param self
+ * @return Socket for the new connection, or NULL if accepting failed
+ */
+Socket socketAccept(Socket self);
+
+/**
+ * Read one line from a connected socket. The line ending is stripped, and
+ * carriage returns before it are also removed.
+ * @param self
+ * @param outLine String to store the line in. Lines which do not fit in the
+ * string's capacity are treated as an error.
+ * @return True if a line was read, false if the connection was closed or the
+ * line was too long
+ */
+boolByte socketReadLine(Socket self, CharString outLine);
+
+/**
+ * Write a string followed by a newline to a connected socket.
+ * @param self
+ * @param line Line to send, which should not contain any newlines
+ * @return True if the whole line was sent
+ */
+boolByte socketWriteLine(Socket self, const CharString line);
+
+/**
+ * Tune a connected TCP socket for streaming audio. Nagle's algorithm is turned
+ * off so that each block is sent as soon as it is written, and the kernel's
+ * send and receive buffers are resized.
+ * @param self
+ * @param bufferSize Size of the send and receive buffers, in bytes
+ */
+void socketSetStreamingOptions(Socket self, int bufferSize);
+
+/**
+ * Read binary data from a connected socket, waiting until all of it has
+ * arrived.
+ * @param self
+ * @param data Buffer to read into
+ * @param numBytes Number of bytes to read
+ * @return Number of bytes read, which is less than numBytes only if the
+ * connection was closed
+ */
+size_t socketRead(Socket self, void *data, size_t numBytes);
+
+/**
+ * Write binary data to a connected socket.
+ * @param self
+ * @param data Data to write
+ * @param numBytes Number of bytes to write
+ * @return True if all of the data was sent
+ */
+boolByte socketWrite(Socket self, const void *data, size_t numBytes);
+
+/**
+ * Stop all reads and writes on a connected socket, without closing it. This
+ * may be called from another thread to wake up a thread which is waiting in
+ * socketReadLine() or socketRead(), which then returns as if the connection
+ * was closed.
+ * @param self
+ */
+void socketShutdown(Socket self);
+
+/**
+ * Leave the path of a listening UNIX domain socket in place when the socket is
+ * freed. This is used by forked processes which share a listening socket with
+ * their parent, which remains responsible for removing it.
+ * @param self
+ */
+void socketKeepPath(Socket self);
+
+/**
+ * Close a socket and free its memory. UNIX domain sockets which were created
+ * with newSocketListening() are also removed from the filesystem, unless
+ * socketKeepPath() was called.
+ * @param self
+ */
+void freeSocket(Socket self);
+
+#endif
@@ -0,0 +1,435 @@
+//
+// Thread.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Must be declared before any system headers, needed for CPU affinity
+#if LINUX
+#define _GNU_SOURCE
+#endif
+
+#include "Thread.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if WINDOWS
+#include <avrt.h>
+#elif UNIX
+#include <sys/resource.h>
+#endif
+#if LINUX
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Highest processor index plus one which is accepted in a processor list,
+// which is the size of the default cpu_set_t on Linux
+#define THREAD_MAX_PROCESSORS 1024
+
+#if LINUX
+static const int kThreadBackgroundNiceValue = 10;
+#endif
+
+#if WINDOWS
+static DWORD WINAPI _threadEntryPoint(LPVOID threadPtr) {
+  Thread self = (Thread)threadPtr;
+  self->function(self->userData);
+  return 0;
+}
+#elif UNIX
+static void *_threadEntryPoint(void *threadPtr) {
+  Thread self = (Thread)threadPtr;
+  self->function(self->userData);
+  return NULL;
+}
+#endif
+
+Thread newThread(ThreadFunc function, void *userData) {
+  Thread thread = (Thread)malloc(sizeof(ThreadMembers));
+  thread->function = function;
+  thread->userData = userData;
+
+#if WINDOWS
+  thread->_handle = CreateThread(NULL, 0, _threadEntryPoint, thread, 0, NULL);
+
+  if (thread->_handle == NULL) {
+    logError("Could not create thread, got error %d", GetLastError());
+    free(thread);
+    return NULL;
+  }
+#elif UNIX
+  int result =
+      pthread_create(&thread->_handle, NULL, _threadEntryPoint, thread);
+
+  if (result != 0) {
+    logError("Could not create thread, got error %d", result);
+    free(thread);
+    return NULL;
+  }
+#endif
+
+  return thread;
+}
+
+void threadJoinAndFree(Thread self) {
+  if (self != NULL) {
+#if WINDOWS
+    WaitForSingleObject(self->_handle, INFINITE);
+    CloseHandle(self->_handle);
+#elif UNIX
+    pthread_join(self->_handle, NULL);
+#endif
+    free(self);
+  }
+}
+
+boolByte threadSetRealtimePriority(void) {
+#if WINDOWS
+  DWORD taskIndex = 0;
+
+  if (AvSetMmThreadCharacteristicsA("Pro Audio", &taskIndex) == NULL) {
+    logWarn("Could not register thread with MMCSS, got error %d",
+            GetLastError());
+    return false;
+  }
+
+  return true;
+#elif UNIX
+  struct sched_param param;
+  int result;
+
+  // Stay below the top priorities, which are used by the kernel's own
+  // realtime threads on some systems
+  param.sched_priority =
+      (sched_get_priority_min(SCHED_FIFO) + sched_get_priority_max(SCHED_FIFO)) /
+      2;
+  result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+  if (result != 0) {
+    logWarn("Could not raise thread to realtime priority, got error %d",
+            result);
+    return false;
+  }
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+boolByte threadSetBackgroundPriority(void) {
+#if WINDOWS
+  return (boolByte)(SetThreadPriority(GetCurrentThread(),
+                                      THREAD_PRIORITY_BELOW_NORMAL) != 0);
+#elif MACOSX
+  return (boolByte)(setpriority(PRIO_DARWIN_THREAD, 0, PRIO_DARWIN_BG) == 0);
+#elif LINUX
+  return (boolByte)(setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid),
+                                kThreadBackgroundNiceValue) == 0);
+#else
+  return false;
+#endif
+}
+
+boolByte threadSetAffinity(const unsigned int processor) {
+#if WINDOWS
+  if (processor >= sizeof(DWORD_PTR) * 8 ||
+      SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << processor) ==
+          0) {
+    logWarn("Could not pin thread to processor %d", processor);
+    return false;
+  }
+
+  return true;
+#elif LINUX
+  cpu_set_t cpuSet;
+  int result;
+
+  CPU_ZERO(&cpuSet);
+  CPU_SET(processor, &cpuSet);
+  result = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+
+  if (result != 0) {
+    logWarn("Could not pin thread to processor %d, got error %d", processor,
+            result);
+    return false;
+  }
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+static boolByte _parseProcessorList(const char *processors,
+                                    boolByte *selected) {
+  const char *current = processors;
+  char *end = NULL;
+  unsigned long first;
+  unsigned long last;
+  boolByte result = false;
+
+  memset(selected, 0, sizeof(boolByte) * THREAD_MAX_PROCESSORS);
+
+  while (*current != '\0') {
+    first = strtoul(current, &end, 10);
+
+    if (end == current) {
+      return false;
+    }
+
+    last = first;
+
+    if (*end == '-') {
+      current = end + 1;
+      last = strtoul(current, &end, 10);
+
+      if (end == current) {
+        return false;
+      }
+    }
+
+    if (first > last || last >= THREAD_MAX_PROCESSORS) {
+      return false;
+    }
+
+    for (unsigned long i = first; i <= last; ++i) {
+      selected[i] = true;
+    }
+
+    result = true;
+
+    if (*end == ',') {
+      current = end + 1;
+    } else if (*end == '\0') {
+      current = end;
+    } else {
+      return false;
+    }
+  }
+
+  return result;
+}
+
+boolByte threadSetAffinityList(const char *processors) {
+  boolByte selected[THREAD_MAX_PROCESSORS];
+
+  if (!_parseProcessorList(processors, selected)) {
+    logError("Invalid processor list '%s'", processors);
+    return false;
+  }
+
+#if WINDOWS
+  DWORD_PTR mask = 0;
+
+  for (unsigned int i = 0; i < sizeof(DWORD_PTR) * 8; ++i) {
+    if (selected[i]) {
+      mask |= (DWORD_PTR)1 << i;
+    }
+  }
+
+  if (mask == 0 || SetThreadAffinityMask(GetCurrentThread(), mask) == 0) {
+    logWarn("Could not pin thread to processors %s", processors);
+    return false;
+  }
+
+  return true;
+#elif LINUX
+  cpu_set_t cpuSet;
+  int result;
+
+  CPU_ZERO(&cpuSet);
+
+  for (unsigned int i = 0; i < THREAD_MAX_PROCESSORS; ++i) {
+    if (selected[i]) {
+      CPU_SET(i, &cpuSet);
+    }
+  }
+
+  result = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+
+  if (result != 0) {
+    logWarn("Could not pin thread to processors %s, got error %d", processors,
+            result);
+    return false;
+  }
+
+  return true;
+#else
+  logUnsupportedFeature("Pinning threads to processors");
+  return false;
+#endif
+}
+
+Semaphore newSemaphore(const unsigned int initialCount) {
+  Semaphore semaphore = (Semaphore)malloc(sizeof(SemaphoreMembers));
+  semaphore->count = initialCount;
+
+#if WINDOWS
+  semaphore->_handle =
+      CreateSemaphore(NULL, (LONG)initialCount, MAXLONG, NULL);
+#elif UNIX
+  pthread_mutex_init(&semaphore->_mutex, NULL);
+  pthread_cond_init(&semaphore->_condition, NULL);
+#endif
+
+  return semaphore;
+}
+
+void semaphoreWait(Semaphore self) {
+#if WINDOWS
+  WaitForSingleObject(self->_handle, INFINITE);
+#elif UNIX
+  pthread_mutex_lock(&self->_mutex);
+
+  while (self->count == 0) {
+    pthread_cond_wait(&self->_condition, &self->_mutex);
+  }
+
+  self->count--;
+  pthread_mutex_unlock(&self->_mutex);
+#endif
+}
+
+void semaphorePost(Semaphore self) {
+#if WINDOWS
+  ReleaseSemaphore(self->_handle, 1, NULL);
+#elif UNIX
+  pthread_mutex_lock(&self->_mutex);
+  self->count++;
+  pthread_cond_signal(&self->_condition);
+  pthread_mutex_unlock(&self->_mutex);
+#endif
+}
+
+void freeSemaphore(Semaphore self) {
+  if (self != NULL) {
+#if WINDOWS
+    CloseHandle(self->_handle);
+#elif UNIX
+    pthread_cond_destroy(&self->_condition);
+    pthread_mutex_destroy(&self->_mutex);
+#endif
+    free(self);
+  }
+}
+
+Mutex newMutex(void) {
+  Mutex mutex = (Mutex)malloc(sizeof(MutexMembers));
+#if WINDOWS
+  InitializeCriticalSection(&mutex->_handle);
+#elif UNIX
+  pthread_mutex_init(&mutex->_handle, NULL);
+#endif
+  return mutex;
+}
+
+void mutexLock(Mutex self) {
+#if WINDOWS
+  EnterCriticalSection(&self->_handle);
+#elif UNIX
+  pthread_mutex_lock(&self->_handle);
+#endif
+}
+
+void mutexUnlock(Mutex self) {
+#if WINDOWS
+  LeaveCriticalSection(&self->_handle);
+#elif UNIX
+  pthread_mutex_unlock(&self->_handle);
+#endif
+}
+
+void freeMutex(Mutex self) {
+  if (self != NULL) {
+#if WINDOWS
+    DeleteCriticalSection(&self->_handle);
+#elif UNIX
+    pthread_mutex_destroy(&self->_handle);
+#endif
+    free(self);
+  }
+}
+
+unsigned int atomicLoad(volatile unsigned int *value) {
+#if WINDOWS
+  return (unsigned int)InterlockedCompareExchange((volatile LONG *)value, 0, 0);
+#else
+  return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+void atomicStore(volatile unsigned int *value, const unsigned int newValue) {
+#if WINDOWS
+  InterlockedExchange((volatile LONG *)value, (LONG)newValue);
+#else
+  __atomic_store_n(value, newValue, __ATOMIC_SEQ_CST);
+#endif
+}
+
+unsigned int atomicLoadAcquire(volatile unsigned int *value) {
+#if WINDOWS
+  return (unsigned int)InterlockedCompareExchange((volatile LONG *)value, 0, 0);
+#else
+  return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void atomicStoreRelease(volatile unsigned int *value,
+                        const unsigned int newValue) {
+#if WINDOWS
+  InterlockedExchange((volatile LONG *)value, (LONG)newValue);
+#else
+  __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+#endif
+}
+
+unsigned int atomicAdd(volatile unsigned int *value,
+                       const unsigned int amount) {
+#if WINDOWS
+  return (unsigned int)InterlockedExchangeAdd((volatile LONG *)value,
+                                              (LONG)amount) +
+         amount;
+#else
+  return __atomic_add_fetch(value, amount, __ATOMIC_SEQ_CST);
+#endif
+}
+
+boolByte atomicCompareAndSwap(volatile unsigned int *value,
+                              const unsigned int expectedValue,
+                              const unsigned int newValue) {
+#if WINDOWS
+  return (boolByte)(InterlockedCompareExchange((volatile LONG *)value,
+                                               (LONG)newValue,
+                                               (LONG)expectedValue) ==
+                    (LONG)expectedValue);
+#else
+  unsigned int expected = expectedValue;
+  return (boolByte)__atomic_compare_exchange_n(
+      value, &expected, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
@@ -0,0 +1,240 @@
+//
+// Thread.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_Thread_h
+#define MrsWatson_Thread_h
+
+#include "base/Types.h"
+
+#if WINDOWS
+#include <Windows.h>
+#elif UNIX
+#include <pthread.h>
+#endif
+
+/**
+ * Function to be run in a separate thread
+ * @param userData User-provided data passed to newThread()
+ */
+typedef void (*ThreadFunc)(void *userData);
+
+typedef struct {
+  ThreadFunc function;
+  void *userData;
+
+#if WINDOWS
+  HANDLE _handle;
+#elif UNIX
+  pthread_t _handle;
+#endif
+} ThreadMembers;
+typedef ThreadMembers *Thread;
+
+typedef struct {
+  unsigned int count;
+
+#if WINDOWS
+  HANDLE _handle;
+#elif UNIX
+  // Unnamed POSIX semaphores are not available on Mac OS X, so the semaphore
+  // is built from a mutex and condition variable instead.
+  pthread_mutex_t _mutex;
+  pthread_cond_t _condition;
+#endif
+} SemaphoreMembers;
+typedef SemaphoreMembers *Semaphore;
+
+typedef struct {
+#if WINDOWS
+  CRITICAL_SECTION _handle;
+#elif UNIX
+  pthread_mutex_t _handle;
+#endif
+} MutexMembers;
+typedef MutexMembers *Mutex;
+
+/**
+ * Start a new thread which runs the given function.
+ * @param function Function to run
+ * @param userData Data to pass to the function
+ * @return New thread object, or NULL if the thread could not be started
+ */
+Thread newThread(ThreadFunc function, void *userData);
+
+/**
+ * Wait for a thread to finish and release its resources. After this call
+ * returns, the thread object is no longer valid.
+ * @param self
+ */
+void threadJoinAndFree(Thread self);
+
+/**
+ * Raise the calling thread to realtime priority, which is SCHED_FIFO on Unix
+ * systems and the "Pro Audio" MMCSS task on Windows. Most systems only allow
+ * this for privileged users, in which case a warning is logged and the thread
+ * keeps its normal priority.
+ * @return True if the priority was raised, false otherwise
+ */
+boolByte threadSetRealtimePriority(void);
+
+/**
+ * Lower the priority of the calling thread, for background work which must not
+ * take processor time away from audio processing. On Linux, the thread's nice
+ * value is raised, since each thread has its own nice value there.
+ * @return True if the priority was lowered, false otherwise
+ */
+boolByte threadSetBackgroundPriority(void);
+
+/**
+ * Pin the calling thread to a single processor, so that the scheduler does not
+ * move it between cores and its caches stay warm. Mac OS X does not allow
+ * threads to be pinned, so this always fails there.
+ * @param processor Index of the processor, starting from 0
+ * @return True if the thread was pinned, false otherwise
+ */
+boolByte threadSetAffinity(const unsigned int processor);
+
+/**
+ * Pin the calling thread to a set of processors, which is given as a list of
+ * processor indexes and ranges such as "0-3,8". This is the same format that
+ * Linux uses for processor lists in /sys. Threads which the calling thread
+ * starts later inherit this setting on Linux.
+ * @param processors Processor list
+ * @return True if the thread was pinned, false if the list is invalid or
+ * pinning is not supported
+ */
+boolByte threadSetAffinityList(const char *processors);
+
+/**
+ * Create a new counting semaphore.
+ * @param initialCount Initial value of the semaphore
+ * @return New semaphore object
+ */
+Semaphore newSemaphore(const unsigned int initialCount);
+
+/**
+ * Decrement the semaphore, blocking the calling thread until the count is
+ * greater than zero.
+ * @param self
+ */
+void semaphoreWait(Semaphore self);
+
+/**
+ * Increment the semaphore, waking up one waiting thread (if any).
+ * @param self
+ */
+void semaphorePost(Semaphore self);
+
+/**
+ * Free a semaphore. No threads may be waiting on it when this is called.
+ * @param self
+ */
+void freeSemaphore(Semaphore self);
+
+/**
+ * Create a new mutex, which is initially unlocked.
+ * @return New mutex object
+ */
+Mutex newMutex(void);
+
+/**
+ * Lock the mutex, blocking the calling thread until it is available.
+ * @param self
+ */
+void mutexLock(Mutex self);
+
+/**
+ * Unlock a mutex previously locked by the calling thread.
+ * @param self
+ */
+void mutexUnlock(Mutex self);
+
+/**
+ * Free a mutex. The mutex must not be locked when this is called.
+ * @param self
+ */
+void freeMutex(Mutex self);
+
+/**
+ * Atomically read a value which is shared between threads. This is a full
+ * memory barrier, so writes made by another thread before it stored the value
+ * are also visible after this call.
+ * @param value Pointer to the shared value
+ * @return Current value
+ */
+unsigned int atomicLoad(volatile unsigned int *value);
+
+/**
+ * Atomically write a value which is shared between threads. All writes made
+ * before this call are visible to any thread which reads the new value with
+ * atomicLoad().
+ * @param value Pointer to the shared value
+ * @param newValue Value to store
+ */
+void atomicStore(volatile unsigned int *value, const unsigned int newValue);
+
+/**
+ * Read a value which is shared between threads, with only the ordering that is
+ * needed to hand off data. Writes made by another thread before it stored the
+ * value with atomicStoreRelease() are visible after this call. This is cheaper
+ * than atomicLoad() on some processors.
+ * @param value Pointer to the shared value
+ * @return Current value
+ */
+unsigned int atomicLoadAcquire(volatile unsigned int *value);
+
+/**
+ * Write a value which is shared between threads, with only the ordering that
+ * is needed to hand off data. All writes made before this call are visible to
+ * any thread which reads the new value with atomicLoadAcquire(). On x86 this
+ * is a plain store, unlike atomicStore().
+ * @param value Pointer to the shared value
+ * @param newValue Value to store
+ */
+void atomicStoreRelease(volatile unsigned int *value,
+                        const unsigned int newValue);
+
+/**
+ * Atomically add to a value which is shared between threads.
+ * @param value Pointer to the shared value
+ * @param amount Amount to add
+ * @return Value after the addition
+ */
+unsigned int atomicAdd(volatile unsigned int *value, const unsigned int amount);
+
+/**
+ * Atomically replace a value, but only if it has not been changed by another
+ * thread in the meantime.
+ * @param value Pointer to the shared value
+ * @param expectedValue Value which must currently be stored
+ * @param newValue Value to store
+ * @return True if the value was replaced
+ */
+boolByte atomicCompareAndSwap(volatile unsigned int *value,
+                              const unsigned int expectedValue,
+                              const unsigned int newValue);
+
+#endif
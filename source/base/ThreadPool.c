@@ -0,0 +1,294 @@
+//
+// ThreadPool.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "ThreadPool.h"
+
+#include "base/PlatformInfo.h"
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned int kThreadPoolInitialQueueCapacity = 64;
+
+static void _pushTask(ThreadPoolWorker worker, const ThreadPoolTask *task) {
+  mutexLock(worker->_mutex);
+
+  if (worker->_numTasks == worker->_capacity) {
+    const unsigned int newCapacity = worker->_capacity * 2;
+    ThreadPoolTask *newTasks =
+        (ThreadPoolTask *)malloc(sizeof(ThreadPoolTask) * newCapacity);
+
+    // Unwrap the old queue so that it starts at the beginning of the new one
+    for (unsigned int i = 0; i < worker->_numTasks; ++i) {
+      newTasks[i] = worker->_tasks[(worker->_head + i) % worker->_capacity];
+    }
+
+    free(worker->_tasks);
+    worker->_tasks = newTasks;
+    worker->_capacity = newCapacity;
+    worker->_head = 0;
+  }
+
+  worker->_tasks[(worker->_head + worker->_numTasks) % worker->_capacity] =
+      *task;
+  worker->_numTasks++;
+  mutexUnlock(worker->_mutex);
+}
+
+// Take the newest task, which is only done by the worker which owns the queue
+static boolByte _popTask(ThreadPoolWorker worker, ThreadPoolTask *task) {
+  boolByte result = false;
+
+  mutexLock(worker->_mutex);
+
+  if (worker->_numTasks > 0) {
+    worker->_numTasks--;
+    *task =
+        worker->_tasks[(worker->_head + worker->_numTasks) % worker->_capacity];
+    result = true;
+  }
+
+  mutexUnlock(worker->_mutex);
+  return result;
+}
+
+// Take the oldest task, which is done by other threads
+static boolByte _stealTask(ThreadPoolWorker worker, ThreadPoolTask *task) {
+  boolByte result = false;
+
+  mutexLock(worker->_mutex);
+
+  if (worker->_numTasks > 0) {
+    *task = worker->_tasks[worker->_head];
+    worker->_head = (worker->_head + 1) % worker->_capacity;
+    worker->_numTasks--;
+    result = true;
+  }
+
+  mutexUnlock(worker->_mutex);
+  return result;
+}
+
+// Steal from each worker in turn, starting at the given one, so that thieves
+// do not all compete for the same queue
+static boolByte _stealTaskFromAny(ThreadPool self, unsigned int start,
+                                  ThreadPoolTask *task) {
+  for (unsigned int i = 0; i < self->numWorkers; ++i) {
+    if (_stealTask(self->workers[(start + i) % self->numWorkers], task)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void _runTask(const ThreadPoolTask *task) {
+  ThreadPoolGroup group = task->group;
+
+  task->function(task->userData);
+
+  if (group != NULL) {
+    mutexLock(group->_mutex);
+
+    if (atomicAdd(&group->numPending, (unsigned int)-1) == 0 &&
+        group->_waiting) {
+      group->_waiting = false;
+      semaphorePost(group->_finished);
+    }
+
+    mutexUnlock(group->_mutex);
+  }
+}
+
+static void _threadPoolWorkerThread(void *userData) {
+  ThreadPoolWorker worker = (ThreadPoolWorker)userData;
+  ThreadPool pool = (ThreadPool)worker->pool;
+  ThreadPoolTask task;
+
+  if (pool->pinToProcessors) {
+    threadSetAffinity(worker->index % platformInfoGetNumProcessors());
+  }
+
+  for (;;) {
+    // Every submitted task posts the semaphore once, but tasks may also be run
+    // by threads waiting in threadPoolWait(), so a worker can wake up and find
+    // nothing to do. That is harmless, it just waits again.
+    semaphoreWait(pool->_available);
+
+    if (_popTask(worker, &task) ||
+        _stealTaskFromAny(pool, worker->index + 1, &task)) {
+      _runTask(&task);
+    } else if (atomicLoad(&pool->_shutdown)) {
+      break;
+    }
+  }
+}
+
+static ThreadPoolWorker _newThreadPoolWorker(ThreadPool pool,
+                                             unsigned int index) {
+  ThreadPoolWorker worker =
+      (ThreadPoolWorker)malloc(sizeof(ThreadPoolWorkerMembers));
+
+  worker->thread = NULL;
+  worker->index = index;
+  worker->pool = pool;
+  worker->_mutex = newMutex();
+  worker->_capacity = kThreadPoolInitialQueueCapacity;
+  worker->_tasks =
+      (ThreadPoolTask *)malloc(sizeof(ThreadPoolTask) * worker->_capacity);
+  worker->_head = 0;
+  worker->_numTasks = 0;
+  return worker;
+}
+
+static void _freeThreadPoolWorker(ThreadPoolWorker worker) {
+  freeMutex(worker->_mutex);
+  free(worker->_tasks);
+  free(worker);
+}
+
+ThreadPool newThreadPool(unsigned int numWorkers, boolByte pinToProcessors) {
+  ThreadPool self = (ThreadPool)malloc(sizeof(ThreadPoolMembers));
+
+  if (numWorkers == 0) {
+    numWorkers = platformInfoGetNumProcessors();
+  }
+
+  self->numWorkers = numWorkers;
+  self->workers =
+      (ThreadPoolWorker *)malloc(sizeof(ThreadPoolWorker) * numWorkers);
+  self->pinToProcessors = pinToProcessors;
+  self->_available = newSemaphore(0);
+  self->_nextWorker = 0;
+  self->_shutdown = false;
+
+  // All queues must exist before any worker starts stealing from them
+  for (unsigned int i = 0; i < numWorkers; ++i) {
+    self->workers[i] = _newThreadPoolWorker(self, i);
+  }
+
+  for (unsigned int i = 0; i < numWorkers; ++i) {
+    self->workers[i]->thread =
+        newThread(_threadPoolWorkerThread, self->workers[i]);
+
+    if (self->workers[i]->thread == NULL) {
+      logError("Could not start thread pool worker %d", i);
+      freeThreadPool(self);
+      return NULL;
+    }
+  }
+
+  logDebug("Started thread pool with %d workers", numWorkers);
+  return self;
+}
+
+void threadPoolSubmit(ThreadPool self, ThreadPoolGroup group,
+                      ThreadPoolTaskFunc function, void *userData) {
+  ThreadPoolTask task;
+  const unsigned int index =
+      atomicAdd(&self->_nextWorker, 1) % self->numWorkers;
+
+  task.function = function;
+  task.userData = userData;
+  task.group = group;
+
+  // The group must count the task before any worker can finish it
+  if (group != NULL) {
+    atomicAdd(&group->numPending, 1);
+  }
+
+  _pushTask(self->workers[index], &task);
+  semaphorePost(self->_available);
+}
+
+void threadPoolWait(ThreadPool self, ThreadPoolGroup group) {
+  ThreadPoolTask task;
+
+  while (atomicLoad(&group->numPending) > 0 &&
+         _stealTaskFromAny(self, 0, &task)) {
+    _runTask(&task);
+  }
+
+  mutexLock(group->_mutex);
+
+  if (atomicLoad(&group->numPending) == 0) {
+    mutexUnlock(group->_mutex);
+    return;
+  }
+
+  // Any tasks which are left are already running on other threads
+  group->_waiting = true;
+  mutexUnlock(group->_mutex);
+  semaphoreWait(group->_finished);
+
+  // The last task posts the semaphore while holding the mutex, so once the
+  // mutex is free again that task no longer uses the group, and the caller may
+  // free it
+  mutexLock(group->_mutex);
+  mutexUnlock(group->_mutex);
+}
+
+void freeThreadPool(ThreadPool self) {
+  if (self != NULL) {
+    atomicStore(&self->_shutdown, true);
+
+    // Wake every worker, so that each one finds the queues empty and exits
+    for (unsigned int i = 0; i < self->numWorkers; ++i) {
+      semaphorePost(self->_available);
+    }
+
+    for (unsigned int i = 0; i < self->numWorkers; ++i) {
+      threadJoinAndFree(self->workers[i]->thread);
+    }
+
+    for (unsigned int i = 0; i < self->numWorkers; ++i) {
+      _freeThreadPoolWorker(self->workers[i]);
+    }
+
+    freeSemaphore(self->_available);
+    free(self->workers);
+    free(self);
+  }
+}
+
+ThreadPoolGroup newThreadPoolGroup(void) {
+  ThreadPoolGroup self =
+      (ThreadPoolGroup)malloc(sizeof(ThreadPoolGroupMembers));
+  self->numPending = 0;
+  self->_mutex = newMutex();
+  self->_waiting = false;
+  self->_finished = newSemaphore(0);
+  return self;
+}
+
+void freeThreadPoolGroup(ThreadPoolGroup self) {
+  if (self != NULL) {
+    freeMutex(self->_mutex);
+    freeSemaphore(self->_finished);
+    free(self);
+  }
+}
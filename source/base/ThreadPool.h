@@ -0,0 +1,147 @@
+//
+// ThreadPool.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_ThreadPool_h
+#define MrsWatson_ThreadPool_h
+
+#include "base/Thread.h"
+#include "base/Types.h"
+
+typedef void (*ThreadPoolTaskFunc)(void *userData);
+
+/**
+ * A group of tasks which can be waited for together. Tasks from any number of
+ * groups can share the same pool, and a task may submit more tasks to its own
+ * group, or wait for another group, while it runs.
+ */
+typedef struct {
+  // Number of tasks in the group which have not finished yet
+  volatile unsigned int numPending;
+
+  // Private fields
+  Mutex _mutex;
+  // Set while a thread is blocked in threadPoolWait()
+  boolByte _waiting;
+  // Posted when the last pending task finishes while a thread is waiting
+  Semaphore _finished;
+} ThreadPoolGroupMembers;
+typedef ThreadPoolGroupMembers *ThreadPoolGroup;
+
+typedef struct {
+  ThreadPoolTaskFunc function;
+  void *userData;
+  ThreadPoolGroup group;
+} ThreadPoolTask;
+
+/**
+ * Each worker has its own queue of tasks. A worker runs the newest task from
+ * its own queue first, since its data is most likely still in the cache, and
+ * when its queue is empty it steals the oldest task from another worker.
+ */
+typedef struct {
+  Thread thread;
+  unsigned int index;
+  void *pool;
+
+  // Private fields
+  Mutex _mutex;
+  ThreadPoolTask *_tasks;
+  unsigned int _capacity;
+  unsigned int _head;
+  unsigned int _numTasks;
+} ThreadPoolWorkerMembers;
+typedef ThreadPoolWorkerMembers *ThreadPoolWorker;
+
+/**
+ * A fixed set of worker threads which run short tasks, so that different
+ * parts of the program can run work in parallel without each starting their
+ * own threads and oversubscribing the processors.
+ */
+typedef struct {
+  unsigned int numWorkers;
+  ThreadPoolWorker *workers;
+  boolByte pinToProcessors;
+
+  // Private fields
+  // Counts submitted tasks, so that idle workers sleep instead of spinning
+  Semaphore _available;
+  // Spreads submitted tasks over the workers' queues
+  volatile unsigned int _nextWorker;
+  volatile unsigned int _shutdown;
+} ThreadPoolMembers;
+typedef ThreadPoolMembers *ThreadPool;
+
+/**
+ * Create a thread pool and start its workers.
+ * @param numWorkers Number of worker threads, or 0 to start one per processor
+ * @param pinToProcessors If true, pin each worker to its own processor. This
+ * can improve cache locality, but should only be used when nothing else on the
+ * machine is busy.
+ * @return New thread pool, or NULL if the workers could not be started
+ */
+ThreadPool newThreadPool(unsigned int numWorkers, boolByte pinToProcessors);
+
+/**
+ * Queue a task to be run by one of the pool's workers.
+ * @param self
+ * @param group Group to add the task to, or NULL if nobody needs to wait for it
+ * @param function Function to run
+ * @param userData Argument passed to the function
+ */
+void threadPoolSubmit(ThreadPool self, ThreadPoolGroup group,
+                      ThreadPoolTaskFunc function, void *userData);
+
+/**
+ * Wait until all tasks in a group have finished. While waiting, the calling
+ * thread runs queued tasks itself instead of sleeping, so this may also be
+ * called from inside a task without starving the pool. Only one thread may
+ * wait for a group at a time.
+ * @param self
+ * @param group Group to wait for
+ */
+void threadPoolWait(ThreadPool self, ThreadPoolGroup group);
+
+/**
+ * Stop the pool's workers and free the pool. Tasks which are still queued are
+ * run before the workers stop.
+ * @param self
+ */
+void freeThreadPool(ThreadPool self);
+
+/**
+ * Create an empty task group. A group can be reused after it has been waited
+ * for.
+ * @return New task group
+ */
+ThreadPoolGroup newThreadPoolGroup(void);
+
+/**
+ * Free a task group. All of its tasks must have finished.
+ * @param self
+ */
+void freeThreadPoolGroup(ThreadPoolGroup self);
+
+#endif
@@ -29,7 +29,14 @@
 
 // Custom types used across the application
 typedef int PcmSample; // TODO: int32_t?
+// Audio is processed in single precision, unless the build is configured with
+// WITH_DOUBLE_SAMPLES. Samples are then only converted at the I/O edges, and
+// VST plugins which support it process doubles as well.
+#if USE_DOUBLE_SAMPLES
+typedef double Sample;
+#else
 typedef float Sample;
+#endif
 typedef Sample *Samples;
 
 typedef double SampleRate;
@@ -77,6 +84,13 @@ typedef unsigned char byte;
 
 #endif
 
+// Storage class for variables which have a separate instance in each thread
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
 // LibraryHandle definition
 #if MACOSX
 #include <CoreFoundation/CFBundle.h>
@@ -0,0 +1,207 @@
+//
+// XxHash.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "XxHash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned long long kXxHashPrime1 = 0x9e3779b185ebca87ull;
+static const unsigned long long kXxHashPrime2 = 0xc2b2ae3d27d4eb4full;
+static const unsigned long long kXxHashPrime3 = 0x165667b19e3779f9ull;
+static const unsigned long long kXxHashPrime4 = 0x85ebca77c2b2ae63ull;
+static const unsigned long long kXxHashPrime5 = 0x27d4eb2f165667c5ull;
+
+static unsigned long long _rotateLeft(unsigned long long value,
+                                      unsigned int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+// XXH64 reads its input as little-endian words on every platform. Compilers
+// turn these into single loads on little-endian processors.
+static unsigned long long _read64(const byte *data) {
+  return (unsigned long long)data[0] | ((unsigned long long)data[1] << 8) |
+         ((unsigned long long)data[2] << 16) |
+         ((unsigned long long)data[3] << 24) |
+         ((unsigned long long)data[4] << 32) |
+         ((unsigned long long)data[5] << 40) |
+         ((unsigned long long)data[6] << 48) |
+         ((unsigned long long)data[7] << 56);
+}
+
+static unsigned long long _read32(const byte *data) {
+  return (unsigned long long)data[0] | ((unsigned long long)data[1] << 8) |
+         ((unsigned long long)data[2] << 16) |
+         ((unsigned long long)data[3] << 24);
+}
+
+static unsigned long long _round(unsigned long long accumulator,
+                                 unsigned long long input) {
+  accumulator += input * kXxHashPrime2;
+  accumulator = _rotateLeft(accumulator, 31);
+  return accumulator * kXxHashPrime1;
+}
+
+static unsigned long long _mergeRound(unsigned long long hash,
+                                      unsigned long long accumulator) {
+  hash ^= _round(0, accumulator);
+  return hash * kXxHashPrime1 + kXxHashPrime4;
+}
+
+static void _consumeStripes(unsigned long long *accumulators,
+                            const byte *data, size_t numStripes) {
+  unsigned long long v1 = accumulators[0];
+  unsigned long long v2 = accumulators[1];
+  unsigned long long v3 = accumulators[2];
+  unsigned long long v4 = accumulators[3];
+  size_t i;
+
+  for (i = 0; i < numStripes; i++, data += 32) {
+    v1 = _round(v1, _read64(data));
+    v2 = _round(v2, _read64(data + 8));
+    v3 = _round(v3, _read64(data + 16));
+    v4 = _round(v4, _read64(data + 24));
+  }
+
+  accumulators[0] = v1;
+  accumulators[1] = v2;
+  accumulators[2] = v3;
+  accumulators[3] = v4;
+}
+
+static unsigned long long _finish(unsigned long long hash, const byte *data,
+                                  size_t size) {
+  while (size >= 8) {
+    hash ^= _round(0, _read64(data));
+    hash = _rotateLeft(hash, 27) * kXxHashPrime1 + kXxHashPrime4;
+    data += 8;
+    size -= 8;
+  }
+
+  if (size >= 4) {
+    hash ^= _read32(data) * kXxHashPrime1;
+    hash = _rotateLeft(hash, 23) * kXxHashPrime2 + kXxHashPrime3;
+    data += 4;
+    size -= 4;
+  }
+
+  while (size > 0) {
+    hash ^= (unsigned long long)(*data) * kXxHashPrime5;
+    hash = _rotateLeft(hash, 11) * kXxHashPrime1;
+    data++;
+    size--;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kXxHashPrime2;
+  hash ^= hash >> 29;
+  hash *= kXxHashPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+unsigned long long xxHash64(const void *data, size_t size,
+                            unsigned long long seed) {
+  XxHashMembers state;
+  state.seed = seed;
+  xxHashReset(&state);
+  xxHashUpdate(&state, data, size);
+  return xxHashDigest(&state);
+}
+
+XxHash newXxHash(unsigned long long seed) {
+  XxHash self = (XxHash)malloc(sizeof(XxHashMembers));
+  self->seed = seed;
+  xxHashReset(self);
+  return self;
+}
+
+void xxHashReset(XxHash self) {
+  self->totalLength = 0;
+  self->accumulators[0] = self->seed + kXxHashPrime1 + kXxHashPrime2;
+  self->accumulators[1] = self->seed + kXxHashPrime2;
+  self->accumulators[2] = self->seed;
+  self->accumulators[3] = self->seed - kXxHashPrime1;
+  self->bufferSize = 0;
+}
+
+void xxHashUpdate(XxHash self, const void *data, size_t size) {
+  const byte *input = (const byte *)data;
+  size_t numBytes;
+
+  self->totalLength += size;
+
+  if (self->bufferSize > 0) {
+    numBytes = sizeof(self->buffer) - self->bufferSize;
+
+    if (numBytes > size) {
+      numBytes = size;
+    }
+
+    memcpy(self->buffer + self->bufferSize, input, numBytes);
+    self->bufferSize += numBytes;
+    input += numBytes;
+    size -= numBytes;
+
+    if (self->bufferSize < sizeof(self->buffer)) {
+      return;
+    }
+
+    _consumeStripes(self->accumulators, self->buffer, 1);
+    self->bufferSize = 0;
+  }
+
+  _consumeStripes(self->accumulators, input, size / 32);
+  input += size - size % 32;
+  size %= 32;
+
+  if (size > 0) {
+    memcpy(self->buffer, input, size);
+    self->bufferSize = size;
+  }
+}
+
+unsigned long long xxHashDigest(const XxHash self) {
+  const unsigned long long *v = self->accumulators;
+  unsigned long long hash;
+
+  if (self->totalLength >= 32) {
+    hash = _rotateLeft(v[0], 1) + _rotateLeft(v[1], 7) +
+           _rotateLeft(v[2], 12) + _rotateLeft(v[3], 18);
+    hash = _mergeRound(hash, v[0]);
+    hash = _mergeRound(hash, v[1]);
+    hash = _mergeRound(hash, v[2]);
+    hash = _mergeRound(hash, v[3]);
+  } else {
+    hash = self->seed + kXxHashPrime5;
+  }
+
+  hash += self->totalLength;
+  return _finish(hash, self->buffer, self->bufferSize);
+}
+
+void freeXxHash(XxHash self) {
+  free(self);
+}
@@ -0,0 +1,94 @@
+//
+// XxHash.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_XxHash_h
+#define MrsWatson_XxHash_h
+
+#include "base/Types.h"
+
+#include <stddef.h>
+
+/**
+ * Streaming state of the XXH64 hash. XXH64 is not a cryptographic hash, but it
+ * mixes 32 bytes per round and runs several times faster than FNV-1a, which
+ * only mixes one byte at a time. The result is the same as for the reference
+ * implementation, however the data is split across calls to xxHashUpdate().
+ */
+typedef struct {
+  unsigned long long seed;
+  unsigned long long totalLength;
+  unsigned long long accumulators[4];
+  // Input which does not fill a whole round yet
+  byte buffer[32];
+  size_t bufferSize;
+} XxHashMembers;
+typedef XxHashMembers *XxHash;
+
+/**
+ * Calculate the XXH64 hash of a piece of data at once.
+ * @param data Data to hash
+ * @param size Size of the data in bytes
+ * @param seed Seed, which gives a different hash for the same data
+ * @return 64-bit hash
+ */
+unsigned long long xxHash64(const void *data, size_t size,
+                            unsigned long long seed);
+
+/**
+ * Create a new hash state for data which arrives in several pieces.
+ * @param seed Seed, which gives a different hash for the same data
+ * @return New hash state
+ */
+XxHash newXxHash(unsigned long long seed);
+
+/**
+ * Start over with no data, using the same seed.
+ * @param self
+ */
+void xxHashReset(XxHash self);
+
+/**
+ * Add data to the hash.
+ * @param self
+ * @param data Data to hash
+ * @param size Size of the data in bytes
+ */
+void xxHashUpdate(XxHash self, const void *data, size_t size);
+
+/**
+ * Get the hash of all data added so far. More data may still be added
+ * afterwards.
+ * @param self
+ * @return 64-bit hash
+ */
+unsigned long long xxHashDigest(const XxHash self);
+
+/**
+ * Free a hash state
+ * @param self
+ */
+void freeXxHash(XxHash self);
+
+#endif
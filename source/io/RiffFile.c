@@ -39,8 +39,8 @@ RiffChunk newRiffChunk(void) {
   return chunk;
 }
 
-boolByte riffChunkReadNext(RiffChunk self, FILE *fileHandle,
-                           boolByte readData) {
+static boolByte _riffChunkReadNext(RiffChunk self, FILE *fileHandle,
+                                   boolByte readData, boolByte bigEndian) {
   size_t itemsRead = 0;
   byte *chunkSize;
 
@@ -60,22 +60,41 @@ boolByte riffChunkReadNext(RiffChunk self, FILE *fileHandle,
       return false;
     }
 
-    self->size = convertByteArrayToUnsignedInt(chunkSize);
+    self->size = bigEndian ? convertBigEndianByteArrayToUnsignedInt(chunkSize)
+                           : convertByteArrayToUnsignedInt(chunkSize);
     free(chunkSize);
 
-    if (self->size > 0 && readData) {
-      self->data = (byte *)malloc(self->size);
-      itemsRead = fread(self->data, 1, self->size, fileHandle);
-
-      if (itemsRead != self->size) {
-        return false;
-      }
+    if (readData && !riffChunkReadData(self, fileHandle)) {
+      return false;
     }
   }
 
   return (boolByte)!feof(fileHandle);
 }
 
+boolByte riffChunkReadNext(RiffChunk self, FILE *fileHandle,
+                           boolByte readData) {
+  return _riffChunkReadNext(self, fileHandle, readData, false);
+}
+
+boolByte riffChunkReadNextBigEndian(RiffChunk self, FILE *fileHandle,
+                                    boolByte readData) {
+  return _riffChunkReadNext(self, fileHandle, readData, true);
+}
+
+boolByte riffChunkReadData(RiffChunk self, FILE *fileHandle) {
+  if (self->size > 0) {
+    free(self->data);
+    self->data = (byte *)malloc(self->size);
+
+    if (fread(self->data, 1, self->size, fileHandle) != self->size) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 boolByte riffChunkIsIdEqualTo(const RiffChunk self, const char *id) {
   return (boolByte)(strncmp(self->id, id, 4) == 0);
 }
@@ -87,3 +106,106 @@ void freeRiffChunk(RiffChunk self) {
 
   free(self);
 }
+
+RiffChunkIndex newRiffChunkIndex(FILE *fileHandle, boolByte bigEndian) {
+  RiffChunkIndex index;
+  long startOffset;
+  long fileSize;
+
+  if (fileHandle == NULL || (startOffset = ftell(fileHandle)) < 0 ||
+      fseek(fileHandle, 0, SEEK_END) != 0 ||
+      (fileSize = ftell(fileHandle)) < 0 ||
+      fseek(fileHandle, startOffset, SEEK_SET) != 0) {
+    return NULL;
+  }
+
+  index = (RiffChunkIndex)malloc(sizeof(RiffChunkIndexMembers));
+  index->fileHandle = fileHandle;
+  index->bigEndian = bigEndian;
+  index->entries = NULL;
+  index->numEntries = 0;
+  index->capacity = 0;
+  index->nextChunkOffset = startOffset;
+  index->fileSize = fileSize;
+  index->finished = false;
+  return index;
+}
+
+// Index the next chunk header, and skip over the chunk's data
+static boolByte _riffChunkIndexNext(RiffChunkIndex self) {
+  RiffChunkIndexEntry *entry;
+  byte header[8];
+  long dataEnd;
+
+  if (self->finished) {
+    return false;
+  }
+
+  if (fseek(self->fileHandle, self->nextChunkOffset, SEEK_SET) != 0 ||
+      fread(header, 1, 8, self->fileHandle) != 8) {
+    self->finished = true;
+    return false;
+  }
+
+  if (self->numEntries == self->capacity) {
+    self->capacity = self->capacity == 0 ? 8 : self->capacity * 2;
+    self->entries = (RiffChunkIndexEntry *)realloc(
+        self->entries, sizeof(RiffChunkIndexEntry) * self->capacity);
+  }
+
+  entry = &(self->entries[self->numEntries++]);
+  memcpy(entry->id, header, 4);
+  entry->id[4] = '\0';
+  entry->offset = self->nextChunkOffset + 8;
+  entry->size = self->bigEndian
+                    ? convertBigEndianByteArrayToUnsignedInt(header + 4)
+                    : convertByteArrayToUnsignedInt(header + 4);
+
+  // Chunks are padded to an even size. A chunk which runs past the end of the
+  // file is either truncated or has a placeholder size, as the data chunk of
+  // an RF64 file does, and in both cases nothing useful can follow it.
+  dataEnd = entry->offset + (long)entry->size + (long)(entry->size & 1);
+
+  if (dataEnd > self->fileSize || dataEnd < entry->offset) {
+    self->finished = true;
+  } else {
+    self->nextChunkOffset = dataEnd;
+  }
+
+  return true;
+}
+
+boolByte riffChunkIndexFind(RiffChunkIndex self, const char *id,
+                            RiffChunk chunk, boolByte readData) {
+  const RiffChunkIndexEntry *entry = NULL;
+  size_t i;
+
+  for (i = 0; i < self->numEntries; i++) {
+    if (strncmp(self->entries[i].id, id, 4) == 0) {
+      entry = &(self->entries[i]);
+      break;
+    }
+  }
+
+  while (entry == NULL && _riffChunkIndexNext(self)) {
+    if (strncmp(self->entries[self->numEntries - 1].id, id, 4) == 0) {
+      entry = &(self->entries[self->numEntries - 1]);
+    }
+  }
+
+  if (entry == NULL ||
+      fseek(self->fileHandle, entry->offset, SEEK_SET) != 0) {
+    return false;
+  }
+
+  memcpy(chunk->id, entry->id, 5);
+  chunk->size = entry->size;
+  return (boolByte)(!readData || riffChunkReadData(chunk, self->fileHandle));
+}
+
+void freeRiffChunkIndex(RiffChunkIndex self) {
+  if (self != NULL) {
+    free(self->entries);
+    free(self);
+  }
+}
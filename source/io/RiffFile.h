@@ -57,6 +57,28 @@ RiffChunk newRiffChunk(void);
  */
 boolByte riffChunkReadNext(RiffChunk self, FILE *fileHandle, boolByte readData);
 
+/**
+ * Same as riffChunkReadNext(), but for files such as AIFF which store the
+ * chunk sizes as big endian integers
+ * @param self
+ * @param fileHandle File which should be opened for reading
+ * @param readData If true, save the contents of the chunk in the RiffChunk's
+ * data field
+ * @return True if the chunk was successfully read
+ */
+boolByte riffChunkReadNextBigEndian(RiffChunk self, FILE *fileHandle,
+                                    boolByte readData);
+
+/**
+ * Read the contents of a chunk whose header was read with riffChunkReadNext()
+ * without its data. This allows a parser to only load the chunks it needs, and
+ * skip over the others.
+ * @param self
+ * @param fileHandle RIFF file, positioned at the start of the chunk's data
+ * @return True if the chunk's data was read
+ */
+boolByte riffChunkReadData(RiffChunk self, FILE *fileHandle);
+
 /**
  * Test to see if this chunk's ID is equal to the given four character sequence
  * @param self
@@ -71,4 +93,62 @@ boolByte riffChunkIsIdEqualTo(const RiffChunk self, const char *id);
  */
 void freeRiffChunk(RiffChunk self);
 
+typedef struct {
+  char id[5];
+  // Position of the chunk's data in the file
+  long offset;
+  unsigned int size;
+} RiffChunkIndexEntry;
+
+/**
+ * Index of the chunks in a RIFF file, which is built by seeking from one chunk
+ * header to the next without reading any chunk data. Chunks are only indexed
+ * as far as needed to find the ones which are looked up, so that the audio
+ * data of a file is not scanned for more headers once the parser has what it
+ * needs. Metadata chunks of any size therefore cost one seek each, and the
+ * chunks may be looked up in any order.
+ */
+typedef struct {
+  FILE *fileHandle;
+  boolByte bigEndian;
+  RiffChunkIndexEntry *entries;
+  size_t numEntries;
+  size_t capacity;
+  // Position of the next chunk header which has not been indexed yet
+  long nextChunkOffset;
+  long fileSize;
+  // Set once the end of the file, or a chunk running past it, was reached
+  boolByte finished;
+} RiffChunkIndexMembers;
+typedef RiffChunkIndexMembers *RiffChunkIndex;
+
+/**
+ * Create an index of the chunks in a RIFF file
+ * @param fileHandle File opened for reading, positioned at the first chunk
+ * header to index, which for most formats is just after the form type
+ * @param bigEndian True for files such as AIFF which store the chunk sizes as
+ * big endian integers
+ * @return New chunk index, or NULL if the file cannot be seeked
+ */
+RiffChunkIndex newRiffChunkIndex(FILE *fileHandle, boolByte bigEndian);
+
+/**
+ * Look up the first chunk with the given ID, indexing more of the file if it
+ * has not been seen yet. If found, the file is positioned at the start of the
+ * chunk's data.
+ * @param self
+ * @param id Chunk ID, should be exactly 4 characters
+ * @param chunk Chunk to store the ID and size in
+ * @param readData If true, also read the contents of the chunk
+ * @return True if the chunk was found, and its data read if requested
+ */
+boolByte riffChunkIndexFind(RiffChunkIndex self, const char *id,
+                            RiffChunk chunk, boolByte readData);
+
+/**
+ * Free a chunk index. This does not close the file.
+ * @param self
+ */
+void freeRiffChunkIndex(RiffChunkIndex self);
+
 #endif
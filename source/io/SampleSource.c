@@ -27,6 +27,10 @@
 #include "SampleSource.h"
 
 #include "base/File.h"
+#include "io/SampleSourceDevice.h"
+#include "io/SampleSourceMemory.h"
+#include "io/SampleSourcePacked.h"
+#include "io/SampleSourceTcp.h"
 #include "logging/EventLogger.h"
 
 #include <stdio.h>
@@ -42,19 +46,39 @@ void sampleSourcePrintSupportedTypes(void) {
 // special setup when writing, so we only choose the most common ones.
 #if USE_AUDIOFILE
   logInfo("- AIFF (via libaudiofile)");
+#else
+  logInfo("- AIFF and AIFF-C (internal)");
 #endif
 #if USE_FLAC
-  logInfo("- FLAC (via libaudiofile)");
+  logInfo("- FLAC (via libFLAC)");
+#endif
+#if USE_MP3
+  logInfo("- MP3, reading only (via libmpg123)");
+#endif
+#if USE_OGG
+  logInfo("- Ogg Vorbis and Opus, reading only (via libvorbisfile and "
+          "libopusfile)");
+#endif
+#if USE_PORTAUDIO
+  logInfo("- Live audio devices (via PortAudio)");
 #endif
 
   // Always supported
   logInfo("- PCM");
+  logInfo("- PCM streams over TCP (tcp://host:port)");
+  logInfo("- Memory streams between jobs of one process (mem://name)");
+  logInfo("- Packed lossless temporary files (.%s)",
+          SAMPLE_SOURCE_PACKED_EXTENSION);
 
 #if USE_AUDIOFILE
   logInfo("- WAV (via libaudiofile)");
 #else
   logInfo("- WAV (internal)");
 #endif
+
+#if USE_PORTAUDIO
+  sampleSourceDevicePrintDevices();
+#endif
 }
 
 static SampleSourceType _sampleSourceGuess(const CharString sampleSourceName) {
@@ -69,7 +93,17 @@ static SampleSourceType _sampleSourceGuess(const CharString sampleSourceName) {
     if (strlen(sampleSourceName->data) == 1 &&
         sampleSourceName->data[0] == '-') {
       result = SAMPLE_SOURCE_TYPE_PCM;
-    } else {
+    } else if (sampleSourceIsTcpName(sampleSourceName)) {
+      result = SAMPLE_SOURCE_TYPE_TCP;
+    } else if (sampleSourceIsMemoryName(sampleSourceName)) {
+      result = SAMPLE_SOURCE_TYPE_MEMORY;
+    }
+#if USE_PORTAUDIO
+    else if (sampleSourceIsDeviceName(sampleSourceName)) {
+      result = SAMPLE_SOURCE_TYPE_DEVICE;
+    }
+#endif
+    else {
       sourceFile = newFileWithPath(sampleSourceName);
       sourceFileExtension = fileGetExtension(sourceFile);
       freeFile(sourceFile);
@@ -86,24 +120,40 @@ static SampleSourceType _sampleSourceGuess(const CharString sampleSourceName) {
         result = SAMPLE_SOURCE_TYPE_PCM;
       }
 
-#if USE_AUDIOFILE
       else if (charStringIsEqualToCString(sourceFileExtension, "aif", true) ||
-               charStringIsEqualToCString(sourceFileExtension, "aiff", true)) {
+               charStringIsEqualToCString(sourceFileExtension, "aiff", true) ||
+               charStringIsEqualToCString(sourceFileExtension, "aifc", true)) {
         result = SAMPLE_SOURCE_TYPE_AIFF;
       }
 
-#endif
-
 #if USE_FLAC
       else if (charStringIsEqualToCString(sourceFileExtension, "flac", true)) {
         result = SAMPLE_SOURCE_TYPE_FLAC;
       }
 
+#endif
+#if USE_MP3
+      else if (charStringIsEqualToCString(sourceFileExtension, "mp3", true)) {
+        result = SAMPLE_SOURCE_TYPE_MP3;
+      }
+
+#endif
+#if USE_OGG
+      else if (charStringIsEqualToCString(sourceFileExtension, "ogg", true) ||
+               charStringIsEqualToCString(sourceFileExtension, "oga", true) ||
+               charStringIsEqualToCString(sourceFileExtension, "opus", true)) {
+        result = SAMPLE_SOURCE_TYPE_OGG;
+      }
+
 #endif
 
       else if (charStringIsEqualToCString(sourceFileExtension, "wav", true) ||
                charStringIsEqualToCString(sourceFileExtension, "wave", true)) {
         result = SAMPLE_SOURCE_TYPE_WAVE;
+      } else if (charStringIsEqualToCString(sourceFileExtension,
+                                            SAMPLE_SOURCE_PACKED_EXTENSION,
+                                            true)) {
+        result = SAMPLE_SOURCE_TYPE_PACKED;
       } else {
         logCritical("Sample source '%s' does not match any supported type",
                     sampleSourceName->data);
@@ -119,8 +169,16 @@ static SampleSourceType _sampleSourceGuess(const CharString sampleSourceName) {
 extern SampleSource
 _newSampleSourceAudiofile(const CharString sampleSourceName,
                           const SampleSourceType sampleSourceType);
+extern SampleSource _newSampleSourceAiff(const CharString sampleSourceName);
+extern SampleSource _newSampleSourceDevice(const CharString sampleSourceName);
+extern SampleSource _newSampleSourceFlac(const CharString sampleSourceName);
+extern SampleSource _newSampleSourceMemory(const CharString sampleSourceName);
+extern SampleSource _newSampleSourceMp3(const CharString sampleSourceName);
+extern SampleSource _newSampleSourceOgg(const CharString sampleSourceName);
+extern SampleSource _newSampleSourcePacked(const CharString sampleSourceName);
 extern SampleSource _newSampleSourcePcm(const CharString sampleSourceName);
 extern SampleSource _newSampleSourceSilence();
+extern SampleSource _newSampleSourceTcp(const CharString sampleSourceName);
 extern SampleSource _newSampleSourceWave(const CharString sampleSourceName);
 
 SampleSource sampleSourceFactory(const CharString sampleSourceName) {
@@ -133,16 +191,47 @@ SampleSource sampleSourceFactory(const CharString sampleSourceName) {
   case SAMPLE_SOURCE_TYPE_PCM:
     return _newSampleSourcePcm(sampleSourceName);
 
+  case SAMPLE_SOURCE_TYPE_TCP:
+    return _newSampleSourceTcp(sampleSourceName);
+
+  case SAMPLE_SOURCE_TYPE_MEMORY:
+    return _newSampleSourceMemory(sampleSourceName);
+
+  case SAMPLE_SOURCE_TYPE_PACKED:
+    return _newSampleSourcePacked(sampleSourceName);
+
+#if USE_PORTAUDIO
+
+  case SAMPLE_SOURCE_TYPE_DEVICE:
+    return _newSampleSourceDevice(sampleSourceName);
+#endif
+
 #if USE_AUDIOFILE
 
   case SAMPLE_SOURCE_TYPE_AIFF:
     return _newSampleSourceAudiofile(sampleSourceName, sampleSourceType);
+#else
+
+  case SAMPLE_SOURCE_TYPE_AIFF:
+    return _newSampleSourceAiff(sampleSourceName);
 #endif
 
 #if USE_FLAC
 
   case SAMPLE_SOURCE_TYPE_FLAC:
-    return _newSampleSourceAudiofile(sampleSourceName, sampleSourceType);
+    return _newSampleSourceFlac(sampleSourceName);
+#endif
+
+#if USE_MP3
+
+  case SAMPLE_SOURCE_TYPE_MP3:
+    return _newSampleSourceMp3(sampleSourceName);
+#endif
+
+#if USE_OGG
+
+  case SAMPLE_SOURCE_TYPE_OGG:
+    return _newSampleSourceOgg(sampleSourceName);
 #endif
 
 #if USE_AUDIOFILE
@@ -160,6 +249,53 @@ SampleSource sampleSourceFactory(const CharString sampleSourceName) {
   }
 }
 
+boolByte sampleSourceWriteFrames(SampleSource self, const SampleBuffer buffer,
+                                 SampleCount offset, SampleCount numFrames) {
+  const SampleCount blocksize = buffer->blocksize;
+  boolByte result;
+  ChannelCount i;
+
+  if (offset + numFrames > blocksize) {
+    logInternalError("Cannot write %d frames at offset %d from a block of %d",
+                     numFrames, offset, blocksize);
+    return false;
+  }
+
+  for (i = 0; i < buffer->numChannels; i++) {
+    buffer->samples[i] += offset;
+  }
+
+  buffer->blocksize = numFrames;
+  result = self->writeSampleBlock(self, buffer);
+  buffer->blocksize = blocksize;
+
+  for (i = 0; i < buffer->numChannels; i++) {
+    buffer->samples[i] -= offset;
+  }
+
+  return result;
+}
+
+boolByte sampleSourceSeek(SampleSource self, unsigned long frame) {
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_READ ||
+      self->seekSampleSource == NULL) {
+    return false;
+  }
+
+  return self->seekSampleSource(self, frame);
+}
+
+boolByte sampleSourceReadSampleBlockAt(SampleSource self, unsigned long frame,
+                                       SampleBuffer buffer) {
+  if (!sampleSourceSeek(self, frame)) {
+    logDebug("Could not read '%s' at frame %lu", self->sourceName->data, frame);
+    buffer->blocksize = 0;
+    return false;
+  }
+
+  return self->readSampleBlock(self, buffer);
+}
+
 void freeSampleSource(SampleSource self) {
   if (self != NULL) {
     self->freeSampleSourceData(self->extraData);
@@ -35,11 +35,15 @@ typedef enum {
   SAMPLE_SOURCE_TYPE_INVALID,
   SAMPLE_SOURCE_TYPE_SILENCE,
   SAMPLE_SOURCE_TYPE_PCM,
+  SAMPLE_SOURCE_TYPE_DEVICE,
+  SAMPLE_SOURCE_TYPE_TCP,
+  SAMPLE_SOURCE_TYPE_MEMORY,
   SAMPLE_SOURCE_TYPE_AIFF,
   SAMPLE_SOURCE_TYPE_FLAC,
   SAMPLE_SOURCE_TYPE_MP3,
   SAMPLE_SOURCE_TYPE_OGG,
   SAMPLE_SOURCE_TYPE_WAVE,
+  SAMPLE_SOURCE_TYPE_PACKED,
   NUM_SAMPLE_SOURCES
 } SampleSourceType;
 
@@ -53,6 +57,7 @@ typedef enum {
 typedef boolByte (*OpenSampleSourceFunc)(void *, const SampleSourceOpenAs);
 typedef boolByte (*ReadSampleBlockFunc)(void *, SampleBuffer);
 typedef boolByte (*WriteSampleBlockFunc)(void *, const SampleBuffer);
+typedef boolByte (*SeekSampleSourceFunc)(void *, unsigned long);
 typedef void (*CloseSampleSourceFunc)(void *);
 typedef void (*FreeSampleSourceDataFunc)(void *);
 
@@ -65,6 +70,8 @@ typedef struct {
   OpenSampleSourceFunc openSampleSource;
   ReadSampleBlockFunc readSampleBlock;
   WriteSampleBlockFunc writeSampleBlock;
+  // NULL for sources which can only be read from start to end
+  SeekSampleSourceFunc seekSampleSource;
   CloseSampleSourceFunc closeSampleSource;
   FreeSampleSourceDataFunc freeSampleSourceData;
 
@@ -85,6 +92,44 @@ SampleSource sampleSourceFactory(const CharString sampleSourceName);
  */
 void sampleSourcePrintSupportedTypes(void);
 
+/**
+ * Write part of a sample buffer to a sample source. The buffer's channel
+ * pointers and blocksize are adjusted while the block is being written, and
+ * then restored, so that no temporary buffer needs to be allocated.
+ * @param self
+ * @param buffer Buffer to write from
+ * @param offset Index of the first frame in the buffer to write
+ * @param numFrames Number of frames to write
+ * @return True if all frames were written
+ */
+boolByte sampleSourceWriteFrames(SampleSource self, const SampleBuffer buffer,
+                                 SampleCount offset, SampleCount numFrames);
+
+/**
+ * Move the read position of a sample source to another frame, so that reading
+ * part of a long file does not have to decode everything before it.
+ * Uncompressed files seek in constant time, and FLAC files use their seek
+ * table when they have one.
+ * @param self Sample source which has been opened for reading
+ * @param frame Frame to read next, counted from the start of the audio data
+ * @return True if the position was changed, or false if the source cannot
+ * seek, for example when reading from a pipe
+ */
+boolByte sampleSourceSeek(SampleSource self, unsigned long frame);
+
+/**
+ * Read a block starting at any frame of a sample source. This is the same as
+ * seeking and then reading, and the source continues reading from the end of
+ * the block afterwards.
+ * @param self Sample source which has been opened for reading
+ * @param frame First frame to read
+ * @param buffer Buffer to read into. If the end of the source is reached, the
+ * blocksize is reduced to the number of frames which were read.
+ * @return True if a full block was read
+ */
+boolByte sampleSourceReadSampleBlockAt(SampleSource self, unsigned long frame,
+                                       SampleBuffer buffer);
+
 /**
  * Release a sample source and associated resources
  * @param self
@@ -0,0 +1,545 @@
+//
+// SampleSourceAiff.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SampleSourceAiff.h"
+
+#include "audio/AudioSettings.h"
+#include "base/Endian.h"
+#include "io/RiffFile.h"
+#include "io/SampleSource.h"
+#include "io/SampleSourcePcm.h"
+#include "logging/EventLogger.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Size of the COMM chunk in AIFF files, and in AIFF-C files where it is
+// followed by the compression type and an empty compression name
+static const unsigned int kAiffCommChunkSize = 18;
+static const unsigned int kAifcCommChunkSize = 24;
+// Timestamp of the only version of AIFF-C, which is written to its FVER chunk
+static const unsigned int kAifcVersion = 0xa2805140;
+// The largest header which _writeAiffFileInfo() writes
+#define AIFF_MAX_HEADER_SIZE 72
+
+// Sample rates are stored as 80-bit extended precision numbers, which have a
+// 15-bit exponent and a 64-bit mantissa with an explicit integer bit
+static double _convertExtendedToDouble(const byte *bytes) {
+  const int exponent = ((bytes[0] & 0x7f) << 8) | bytes[1];
+  unsigned long long mantissa = 0;
+  double result;
+  int i;
+
+  for (i = 2; i < 10; i++) {
+    mantissa = (mantissa << 8) | bytes[i];
+  }
+
+  if (exponent == 0 && mantissa == 0) {
+    return 0.0;
+  }
+
+  result = ldexp((double)mantissa, exponent - 16383 - 63);
+  return (bytes[0] & 0x80) ? -result : result;
+}
+
+static void _convertDoubleToExtended(const double value, byte *bytes) {
+  unsigned long long mantissa;
+  int exponent;
+  int i;
+
+  memset(bytes, 0, 10);
+
+  if (value <= 0.0) {
+    return;
+  }
+
+  // frexp() returns a fraction in [0.5, 1), so its highest bit is the integer
+  // bit of the mantissa
+  mantissa = (unsigned long long)ldexp(frexp(value, &exponent), 64);
+  exponent += 16382;
+  bytes[0] = (byte)((exponent >> 8) & 0x7f);
+  bytes[1] = (byte)(exponent & 0xff);
+
+  for (i = 9; i >= 2; i--) {
+    bytes[i] = (byte)(mantissa & 0xff);
+    mantissa >>= 8;
+  }
+}
+
+static size_t _putBigEndian(byte *bytes, const unsigned int value,
+                            const size_t numBytes) {
+  size_t i;
+
+  for (i = 0; i < numBytes; i++) {
+    bytes[i] = (byte)((value >> (8 * (numBytes - 1 - i))) & 0xff);
+  }
+
+  return numBytes;
+}
+
+// 32-bit samples are floats, which are only supported by AIFF-C
+static boolByte _isAifcOutput(const SampleSourcePcmData extraData) {
+  return (boolByte)(extraData->bitDepth == kBitDepth32Bit);
+}
+
+// Offset of the COMM chunk, which follows the FVER chunk in AIFF-C files
+static long _getAiffCommOffset(const SampleSourcePcmData extraData) {
+  return _isAifcOutput(extraData) ? 24 : 12;
+}
+
+static boolByte _readAiffCommChunk(const char *filename, const RiffChunk chunk,
+                                   const boolByte isAifc,
+                                   SampleSourcePcmData extraData,
+                                   unsigned long *outNumFrames) {
+  const byte *compressionType = chunk->data + kAiffCommChunkSize;
+  unsigned short sampleSize;
+  boolByte isFloat = false;
+
+  if (chunk->size < kAiffCommChunkSize || (isAifc && chunk->size < 22)) {
+    logFileError(filename, "Invalid COMM chunk");
+    return false;
+  }
+
+  extraData->numChannels =
+      convertBigEndianByteArrayToUnsignedShort(chunk->data);
+  *outNumFrames = convertBigEndianByteArrayToUnsignedInt(chunk->data + 2);
+  sampleSize = convertBigEndianByteArrayToUnsignedShort(chunk->data + 6);
+  extraData->sampleRate = _convertExtendedToDouble(chunk->data + 8);
+  extraData->isLittleEndian = false;
+
+  // AIFF-C files may also hold uncompressed samples, either big-endian like in
+  // AIFF files, little-endian, or as 32-bit floats
+  if (isAifc) {
+    if (!memcmp(compressionType, "sowt", 4)) {
+      extraData->isLittleEndian = true;
+    } else if (!memcmp(compressionType, "fl32", 4) ||
+               !memcmp(compressionType, "FL32", 4)) {
+      isFloat = true;
+    } else if (memcmp(compressionType, "NONE", 4) &&
+               memcmp(compressionType, "twos", 4)) {
+      logError("AIFF-C compression type '%.4s' is not supported",
+               (const char *)compressionType);
+      return false;
+    }
+  }
+
+  if (isFloat && sampleSize != 32) {
+    logFileError(filename, "Invalid sample size for floating point samples");
+    return false;
+  } else if (!isFloat && (sampleSize <= 8 || sampleSize > 24)) {
+    logUnsupportedFeature("8 and 32-bit integer AIFF files");
+    return false;
+  }
+
+  // Samples are stored in whole bytes and aligned to the most significant bit,
+  // so for example 20-bit samples can be read as 24-bit samples
+  extraData->bitDepth = (BitDepth)((sampleSize + 7) / 8 * 8);
+  return true;
+}
+
+static boolByte _readAiffFileInfo(const char *filename,
+                                  SampleSourcePcmData extraData) {
+  RiffChunk chunk = newRiffChunk();
+  char formType[4];
+  byte ssndHeader[8];
+  boolByte isAifc;
+  boolByte commFound = false;
+  boolByte ssndFound = false;
+  unsigned long numFrames = 0;
+  size_t ssndDataSize = 0;
+  size_t bytesPerFrame;
+  long chunkEnd;
+
+  if (!riffChunkReadNextBigEndian(chunk, extraData->fileHandle, false) ||
+      !riffChunkIsIdEqualTo(chunk, "FORM")) {
+    logFileError(filename, "Invalid FORM chunk descriptor");
+    freeRiffChunk(chunk);
+    return false;
+  }
+
+  if (fread(formType, sizeof(byte), 4, extraData->fileHandle) != 4 ||
+      (strncmp(formType, "AIFF", 4) && strncmp(formType, "AIFC", 4))) {
+    logFileError(filename, "Invalid format description");
+    freeRiffChunk(chunk);
+    return false;
+  }
+
+  isAifc = (boolByte)!strncmp(formType, "AIFC", 4);
+
+  // The sound data chunk may come before the COMM chunk, so all chunks are
+  // visited. Only the COMM chunk is read, and chunks are padded to an even
+  // number of bytes.
+  while (riffChunkReadNextBigEndian(chunk, extraData->fileHandle, false)) {
+    chunkEnd = ftell(extraData->fileHandle) + (long)chunk->size +
+               (long)(chunk->size & 1);
+
+    if (riffChunkIsIdEqualTo(chunk, "COMM")) {
+      if (!riffChunkReadData(chunk, extraData->fileHandle) ||
+          !_readAiffCommChunk(filename, chunk, isAifc, extraData,
+                              &numFrames)) {
+        freeRiffChunk(chunk);
+        return false;
+      }
+
+      commFound = true;
+    } else if (riffChunkIsIdEqualTo(chunk, "SSND")) {
+      // The sound data starts after an offset, which is usually 0
+      if (chunk->size < 8 ||
+          fread(ssndHeader, 1, 8, extraData->fileHandle) != 8 ||
+          convertBigEndianByteArrayToUnsignedInt(ssndHeader) >
+              chunk->size - 8) {
+        logFileError(filename, "Invalid SSND chunk");
+        freeRiffChunk(chunk);
+        return false;
+      }
+
+      extraData->dataOffset =
+          (size_t)ftell(extraData->fileHandle) +
+          convertBigEndianByteArrayToUnsignedInt(ssndHeader);
+      ssndDataSize = chunk->size - 8 -
+                     convertBigEndianByteArrayToUnsignedInt(ssndHeader);
+      ssndFound = true;
+    }
+
+    if (fseek(extraData->fileHandle, chunkEnd, SEEK_SET) != 0) {
+      break;
+    }
+  }
+
+  freeRiffChunk(chunk);
+
+  if (!commFound || !ssndFound) {
+    logFileError(filename, commFound ? "Could not find a SSND chunk"
+                                     : "Could not find a COMM chunk");
+    return false;
+  }
+
+  // The frame count is used rather than the size of the SSND chunk, which
+  // may be padded up to a block boundary
+  bytesPerFrame = extraData->numChannels * (size_t)(extraData->bitDepth / 8);
+  extraData->dataSize = numFrames * bytesPerFrame;
+
+  if (extraData->dataSize > ssndDataSize) {
+    extraData->dataSize = ssndDataSize - ssndDataSize % bytesPerFrame;
+  }
+
+  logDebug("AIFF file has %lu frames", numFrames);
+  return (boolByte)(fseek(extraData->fileHandle, (long)extraData->dataOffset,
+                          SEEK_SET) == 0);
+}
+
+static boolByte _writeAiffFileInfo(SampleSourcePcmData extraData) {
+  const boolByte isAifc = _isAifcOutput(extraData);
+  byte header[AIFF_MAX_HEADER_SIZE];
+  size_t size = 0;
+
+  // The sizes and frame count are set by _writeAiffFileSizes() when the file
+  // is finished writing
+  memcpy(header + size, "FORM", 4);
+  size += 4;
+  size += _putBigEndian(header + size, 0, 4);
+  memcpy(header + size, isAifc ? "AIFC" : "AIFF", 4);
+  size += 4;
+
+  if (isAifc) {
+    memcpy(header + size, "FVER", 4);
+    size += 4;
+    size += _putBigEndian(header + size, 4, 4);
+    size += _putBigEndian(header + size, kAifcVersion, 4);
+  }
+
+  memcpy(header + size, "COMM", 4);
+  size += 4;
+  size += _putBigEndian(header + size,
+                        isAifc ? kAifcCommChunkSize : kAiffCommChunkSize, 4);
+  size += _putBigEndian(header + size, extraData->numChannels, 2);
+  size += _putBigEndian(header + size, 0, 4);
+  size += _putBigEndian(header + size, extraData->bitDepth, 2);
+  _convertDoubleToExtended(extraData->sampleRate, header + size);
+  size += 10;
+
+  // The compression name is an empty Pascal string, padded to an even length
+  if (isAifc) {
+    memcpy(header + size, "fl32", 4);
+    size += 4;
+    size += _putBigEndian(header + size, 0, 2);
+  }
+
+  memcpy(header + size, "SSND", 4);
+  size += 4;
+  size += _putBigEndian(header + size, 8, 4);
+  size += _putBigEndian(header + size, 0, 4);
+  size += _putBigEndian(header + size, 0, 4);
+
+  if (fwrite(header, 1, size, extraData->fileHandle) != size) {
+    logError("Could not write AIFF header");
+    return false;
+  }
+
+  return true;
+}
+
+static boolByte _writeAiffValueAt(FILE *fileHandle, long offset,
+                                  const unsigned int value, size_t numBytes) {
+  byte bytes[4];
+  _putBigEndian(bytes, value, numBytes);
+  return (boolByte)(fseek(fileHandle, offset, SEEK_SET) == 0 &&
+                    fwrite(bytes, 1, numBytes, fileHandle) == numBytes);
+}
+
+// Write the final chunk sizes and frame count to the header. The FORM chunk
+// also counts the pad byte after an odd number of bytes of sound data.
+static boolByte _writeAiffFileSizes(SampleSource sampleSource) {
+  SampleSourcePcmData extraData = (SampleSourcePcmData)sampleSource->extraData;
+  const unsigned long long dataSize =
+      (unsigned long long)sampleSource->numSamplesProcessed *
+      (extraData->bitDepth / 8);
+  const unsigned long long formSize =
+      extraData->dataOffset - 8 + dataSize + (dataSize & 1);
+  const unsigned long numFrames =
+      extraData->numChannels > 0
+          ? sampleSource->numSamplesProcessed / extraData->numChannels
+          : 0;
+
+  if (formSize > 0xffffffff) {
+    logWarn("AIFF file is larger than 4GB, its header will be invalid");
+  }
+
+  return (boolByte)(
+      _writeAiffValueAt(extraData->fileHandle, 4, (unsigned int)formSize, 4) &&
+      _writeAiffValueAt(extraData->fileHandle,
+                        _getAiffCommOffset(extraData) + 10,
+                        (unsigned int)numFrames, 4) &&
+      _writeAiffValueAt(extraData->fileHandle,
+                        (long)extraData->dataOffset - 12,
+                        (unsigned int)(dataSize + 8), 4));
+}
+
+// Replace the PCM sample buffer with one for the sample format of the file
+static void _setAiffSampleFormat(SampleSourcePcmData extraData) {
+  freePcmSampleBuffer(extraData->pcmSampleBuffer);
+  extraData->pcmSampleBuffer = newPcmSampleBuffer(
+      extraData->numChannels, getBlocksize(), extraData->bitDepth);
+  extraData->pcmSampleBuffer->littleEndian = extraData->isLittleEndian;
+  extraData->dataBufferNumItems = extraData->numChannels * getBlocksize();
+}
+
+static boolByte _openSampleSourceAiff(void *sampleSourcePtr,
+                                      const SampleSourceOpenAs openAs) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourcePcmData extraData = (SampleSourcePcmData)sampleSource->extraData;
+
+  if (openAs == SAMPLE_SOURCE_OPEN_READ) {
+    extraData->fileHandle = fopen(sampleSource->sourceName->data, "rb");
+
+    if (extraData->fileHandle != NULL) {
+      if (_readAiffFileInfo(sampleSource->sourceName->data, extraData)) {
+        setNumChannels(extraData->numChannels);
+        setSampleRate(extraData->sampleRate);
+        _setAiffSampleFormat(extraData);
+      } else {
+        fclose(extraData->fileHandle);
+        extraData->fileHandle = NULL;
+      }
+    }
+  } else if (openAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    extraData->numChannels = (unsigned short)getNumChannels();
+    extraData->sampleRate = getSampleRate();
+    extraData->bitDepth = getBitDepth();
+    extraData->isLittleEndian = false;
+
+    // 8-bit AIFF samples are signed, unlike the unsigned 8-bit PCM samples
+    // which are written for other file types
+    if (extraData->bitDepth == kBitDepth8Bit) {
+      logUnsupportedFeature("8-bit AIFF files");
+    } else {
+      extraData->fileHandle = fopen(sampleSource->sourceName->data, "wb");
+      sampleSourcePcmBufferOutput(extraData);
+    }
+
+    if (extraData->fileHandle != NULL) {
+      _setAiffSampleFormat(extraData);
+
+      if (!_writeAiffFileInfo(extraData)) {
+        fclose(extraData->fileHandle);
+        extraData->fileHandle = NULL;
+      } else {
+        extraData->dataOffset = (size_t)ftell(extraData->fileHandle);
+        sampleSourcePcmSetupSparseOutput(extraData, false);
+      }
+    }
+  } else {
+    logInternalError("Invalid type for openAs in AIFF file");
+    return false;
+  }
+
+  if (extraData->fileHandle == NULL) {
+    logError("AIFF file '%s' could not be opened for %s",
+             sampleSource->sourceName->data,
+             openAs == SAMPLE_SOURCE_OPEN_READ ? "reading" : "writing");
+    return false;
+  }
+
+  sampleSource->openedAs = openAs;
+  return true;
+}
+
+static boolByte _readBlockFromAiffFile(void *sampleSourcePtr,
+                                       SampleBuffer sampleBuffer) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourcePcmData extraData = (SampleSourcePcmData)sampleSource->extraData;
+  const size_t dataEnd = extraData->dataOffset + extraData->dataSize;
+  const size_t bytesPerFrame =
+      extraData->numChannels * (size_t)(extraData->bitDepth / 8);
+  unsigned long originalBlocksize = sampleBuffer->blocksize;
+  SampleCount samplesRead;
+  long position;
+
+  // Other chunks may follow the sound data, and must not be read as samples.
+  // Mapped files already stop at the end of the sound data.
+  if (extraData->mappedFile == NULL && bytesPerFrame > 0) {
+    position = ftell(extraData->fileHandle);
+
+    if (position < 0 || (size_t)position + bytesPerFrame > dataEnd) {
+      sampleBuffer->blocksize = 0;
+      return false;
+    } else if ((size_t)position + sampleBuffer->blocksize * bytesPerFrame >
+               dataEnd) {
+      sampleBuffer->blocksize = (dataEnd - (size_t)position) / bytesPerFrame;
+    }
+  }
+
+  samplesRead = sampleSourcePcmRead(extraData, sampleBuffer);
+  sampleSource->numSamplesProcessed += samplesRead;
+  return (boolByte)(originalBlocksize == sampleBuffer->blocksize);
+}
+
+static boolByte _writeBlockToAiffFile(void *sampleSourcePtr,
+                                      const SampleBuffer sampleBuffer) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourcePcmData extraData = (SampleSourcePcmData)sampleSource->extraData;
+  SampleCount samplesWritten = sampleSourcePcmWrite(extraData, sampleBuffer);
+  sampleSource->numSamplesProcessed += samplesWritten;
+  return (boolByte)(samplesWritten ==
+                    sampleBuffer->blocksize * sampleBuffer->numChannels);
+}
+
+static void _closeSampleSourceAiff(void *sampleSourceDataPtr) {
+  SampleSource sampleSource = (SampleSource)sampleSourceDataPtr;
+  SampleSourcePcmData extraData = (SampleSourcePcmData)sampleSource->extraData;
+
+  if (sampleSource->openedAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    sampleSourcePcmFinishSparseOutput(extraData);
+
+    // Chunks must have an even size, so odd sound data is followed by a pad
+    // byte, which only happens with 24-bit samples
+    if ((sampleSource->numSamplesProcessed * (extraData->bitDepth / 8)) & 1) {
+      fputc(0, extraData->fileHandle);
+    }
+
+    // Re-open the file for editing
+    fflush(extraData->fileHandle);
+
+    if (fclose(extraData->fileHandle) != 0) {
+      logError("Could not close AIFF file for finalization");
+      return;
+    }
+
+    extraData->fileHandle = fopen(sampleSource->sourceName->data, "rb+");
+
+    if (extraData->fileHandle == NULL) {
+      logError("Could not reopen AIFF file for finalization");
+      return;
+    }
+
+    if (!_writeAiffFileSizes(sampleSource)) {
+      logError("Could not write AIFF file size during finalization");
+    }
+
+    fflush(extraData->fileHandle);
+    fclose(extraData->fileHandle);
+  } else if (sampleSource->openedAs == SAMPLE_SOURCE_OPEN_READ &&
+             extraData->fileHandle != NULL) {
+    freeMappedFile(extraData->mappedFile);
+    extraData->mappedFile = NULL;
+    fclose(extraData->fileHandle);
+  }
+}
+
+SampleSource _newSampleSourceAiff(const CharString sampleSourceName) {
+  SampleSource sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  SampleSourcePcmData extraData =
+      (SampleSourcePcmData)malloc(sizeof(SampleSourcePcmDataMembers));
+
+  sampleSource->sampleSourceType = SAMPLE_SOURCE_TYPE_AIFF;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, sampleSourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceAiff;
+  sampleSource->readSampleBlock = _readBlockFromAiffFile;
+  sampleSource->writeSampleBlock = _writeBlockToAiffFile;
+  sampleSource->seekSampleSource = sampleSourcePcmSeek;
+  sampleSource->closeSampleSource = _closeSampleSourceAiff;
+  sampleSource->freeSampleSourceData = freeSampleSourceDataPcm;
+
+  extraData->isStream = false;
+  extraData->isPipe = false;
+  extraData->isLittleEndian = false;
+  extraData->isPlanar = false;
+  extraData->fileHandle = NULL;
+  // The sample format is only known once the file has been opened, and the
+  // PCM sample buffer is replaced then
+  extraData->dataBufferNumItems = getNumChannels() * getBlocksize();
+  extraData->pcmSampleBuffer =
+      newPcmSampleBuffer(getNumChannels(), getBlocksize(), getBitDepth());
+  extraData->dataOffset = 0;
+  extraData->dataSize = 0;
+  extraData->mappedFile = NULL;
+  extraData->mappedReadPosition = 0;
+  extraData->mappedDataEnd = 0;
+  extraData->ioRing = NULL;
+  extraData->ioRingStarted = false;
+  extraData->ioRingSlot = 0;
+  extraData->ioRingOffset = 0;
+  extraData->ioRingQueueOffset = 0;
+  extraData->ioRingEnd = 0;
+  extraData->preallocated = false;
+  extraData->resumeFrame = 0;
+  extraData->skipSilentConversion = false;
+  extraData->seekOverSilence = false;
+  extraData->silenceAtEnd = false;
+
+  extraData->numChannels = (unsigned short)getNumChannels();
+  extraData->sampleRate = (unsigned int)getSampleRate();
+  extraData->bitDepth = kBitDepth16Bit;
+
+  sampleSource->extraData = extraData;
+  return sampleSource;
+}
@@ -0,0 +1,113 @@
+//
+// SampleSourceAnalyzer.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "SampleSourceAnalyzer.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+
+static boolByte _openSampleSourceAnalyzer(void *sampleSourcePtr,
+                                          const SampleSourceOpenAs openAs) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  // The wrapped source was already opened before it was wrapped
+  return (boolByte)(self->openedAs == openAs);
+}
+
+static boolByte _readBlockFromAnalyzer(void *sampleSourcePtr,
+                                       SampleBuffer sampleBuffer) {
+  logInternalError("Cannot read from an analyzed output source");
+  return false;
+}
+
+static boolByte _writeBlockToAnalyzer(void *sampleSourcePtr,
+                                      const SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceAnalyzerData extraData =
+      (SampleSourceAnalyzerData)self->extraData;
+
+  audioAnalysisProcess(extraData->analysis, sampleBuffer);
+
+  if (extraData->meter != NULL) {
+    loudnessMeterProcess(extraData->meter, sampleBuffer);
+  }
+
+  self->numSamplesProcessed +=
+      sampleBuffer->blocksize * sampleBuffer->numChannels;
+  return extraData->source->writeSampleBlock(extraData->source, sampleBuffer);
+}
+
+static void _closeSampleSourceAnalyzer(void *sampleSourcePtr) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceAnalyzerData extraData =
+      (SampleSourceAnalyzerData)self->extraData;
+
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_NOT_OPENED) {
+    extraData->source->closeSampleSource(extraData->source);
+    self->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  }
+}
+
+static void _freeSampleSourceDataAnalyzer(void *sampleSourceDataPtr) {
+  SampleSourceAnalyzerData extraData =
+      (SampleSourceAnalyzerData)sampleSourceDataPtr;
+  freeSampleSource(extraData->source);
+  free(extraData);
+}
+
+SampleSource newSampleSourceAnalyzer(SampleSource source,
+                                     AudioAnalysis analysis,
+                                     LoudnessMeter meter) {
+  SampleSource sampleSource;
+  SampleSourceAnalyzerData extraData;
+
+  if (source == NULL || source->openedAs != SAMPLE_SOURCE_OPEN_WRITE ||
+      analysis == NULL) {
+    return NULL;
+  }
+
+  sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  extraData = (SampleSourceAnalyzerData)malloc(
+      sizeof(SampleSourceAnalyzerDataMembers));
+
+  sampleSource->sampleSourceType = source->sampleSourceType;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_WRITE;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, source->sourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceAnalyzer;
+  sampleSource->readSampleBlock = _readBlockFromAnalyzer;
+  sampleSource->writeSampleBlock = _writeBlockToAnalyzer;
+  sampleSource->seekSampleSource = NULL;
+  sampleSource->closeSampleSource = _closeSampleSourceAnalyzer;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataAnalyzer;
+
+  extraData->source = source;
+  extraData->analysis = analysis;
+  extraData->meter = meter;
+  sampleSource->extraData = extraData;
+  return sampleSource;
+}
@@ -0,0 +1,60 @@
+//
+// SampleSourceAnalyzer.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_SampleSourceAnalyzer_h
+#define MrsWatson_SampleSourceAnalyzer_h
+
+#include "audio/AudioAnalysis.h"
+#include "audio/LoudnessMeter.h"
+#include "io/SampleSource.h"
+
+typedef struct {
+  SampleSource source;
+  AudioAnalysis analysis;
+  LoudnessMeter meter;
+} SampleSourceAnalyzerDataMembers;
+typedef SampleSourceAnalyzerDataMembers *SampleSourceAnalyzerData;
+
+/**
+ * Wrap an output source so that every block is analyzed as it is written,
+ * which checks the output without reading it back afterwards.
+ *
+ * The returned source takes ownership of the wrapped source, which must
+ * already be opened for writing. Closing the returned source closes the
+ * wrapped source.
+ *
+ * @param source Opened output source
+ * @param analysis Analysis to add the written blocks to, which is not owned by
+ * the returned source and must outlive it
+ * @param meter Loudness meter to measure the written blocks with, or NULL. Like
+ * the analysis, it is not owned by the returned source.
+ * @return New sample source, or NULL if the source is not opened for writing.
+ * In that case, the caller retains ownership of the source.
+ */
+SampleSource newSampleSourceAnalyzer(SampleSource source,
+                                     AudioAnalysis analysis,
+                                     LoudnessMeter meter);
+
+#endif
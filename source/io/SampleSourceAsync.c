@@ -0,0 +1,336 @@
+//
+// SampleSourceAsync.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SampleSourceAsync.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+
+static boolByte _openSampleSourceAsync(void *sampleSourcePtr,
+                                       const SampleSourceOpenAs openAs) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  // The wrapped source was already opened before the worker thread started
+  return (boolByte)(self->openedAs == openAs);
+}
+
+static void _changeAsyncQueue(SampleSourceAsyncData extraData, int numBlocks) {
+  atomicAdd(&extraData->numQueuedBlocks, (unsigned int)numBlocks);
+  liveMetricsAddQueuedBlocks(extraData->metricsQueue, numBlocks);
+}
+
+static void _asyncReaderThread(void *sampleSourcePtr) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceAsyncData extraData = (SampleSourceAsyncData)self->extraData;
+  SampleBuffer block;
+  boolByte finished = false;
+  boolByte stopRequested;
+
+  while (!finished) {
+    semaphoreWait(extraData->freeBlocks);
+
+    mutexLock(extraData->mutex);
+    stopRequested = extraData->stopRequested;
+    mutexUnlock(extraData->mutex);
+
+    if (stopRequested) {
+      break;
+    }
+
+    block = extraData->blocks[extraData->workerIndex];
+    block->blocksize = extraData->blocksize;
+    extraData->source->readSampleBlock(extraData->source, block);
+    // A short read means that the end of the source was reached
+    finished = (boolByte)(block->blocksize < extraData->blocksize);
+    extraData->workerIndex =
+        (extraData->workerIndex + 1) % extraData->numBlocks;
+    _changeAsyncQueue(extraData, 1);
+    semaphorePost(extraData->filledBlocks);
+  }
+}
+
+static boolByte _readBlockFromAsyncReader(void *sampleSourcePtr,
+                                          SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceAsyncData extraData = (SampleSourceAsyncData)self->extraData;
+  SampleBuffer block;
+  SampleCount blocksize = sampleBuffer->blocksize;
+
+  if (extraData->finished) {
+    sampleBuffer->blocksize = 0;
+    return false;
+  }
+
+  semaphoreWait(extraData->filledBlocks);
+  block = extraData->blocks[extraData->clientIndex];
+  sampleBuffer->blocksize = block->blocksize;
+  sampleBufferCopyAndMapChannels(sampleBuffer, block);
+  self->numSamplesProcessed += block->blocksize * block->numChannels;
+  extraData->finished = (boolByte)(block->blocksize < blocksize);
+  extraData->clientIndex = (extraData->clientIndex + 1) % extraData->numBlocks;
+  _changeAsyncQueue(extraData, -1);
+  semaphorePost(extraData->freeBlocks);
+
+  return (boolByte)!extraData->finished;
+}
+
+static boolByte _writeBlockToAsyncReader(void *sampleSourcePtr,
+                                         const SampleBuffer sampleBuffer) {
+  logInternalError("Cannot write to an asynchronous input source");
+  return false;
+}
+
+static void _asyncWriterThread(void *sampleSourcePtr) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceAsyncData extraData = (SampleSourceAsyncData)self->extraData;
+  SampleBuffer block;
+  boolByte stopRequested;
+  boolByte result;
+
+  while (true) {
+    semaphoreWait(extraData->filledBlocks);
+
+    mutexLock(extraData->mutex);
+    stopRequested = extraData->stopRequested;
+    mutexUnlock(extraData->mutex);
+
+    if (stopRequested) {
+      break;
+    }
+
+    block = extraData->blocks[extraData->workerIndex];
+    result = extraData->source->writeSampleBlock(extraData->source, block);
+
+    if (!result) {
+      mutexLock(extraData->mutex);
+      extraData->writeFailed = true;
+      mutexUnlock(extraData->mutex);
+    }
+
+    extraData->workerIndex =
+        (extraData->workerIndex + 1) % extraData->numBlocks;
+    _changeAsyncQueue(extraData, -1);
+    semaphorePost(extraData->freeBlocks);
+  }
+}
+
+static boolByte _readBlockFromAsyncWriter(void *sampleSourcePtr,
+                                          SampleBuffer sampleBuffer) {
+  logInternalError("Cannot read from an asynchronous output source");
+  return false;
+}
+
+static boolByte _writeBlockToAsyncWriter(void *sampleSourcePtr,
+                                         const SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceAsyncData extraData = (SampleSourceAsyncData)self->extraData;
+  SampleBuffer block;
+  boolByte writeFailed;
+
+  if (sampleBuffer->blocksize > extraData->blocksize) {
+    logInternalError("Block of %d frames is larger than the queue blocksize",
+                     sampleBuffer->blocksize);
+    return false;
+  }
+
+  mutexLock(extraData->mutex);
+  writeFailed = extraData->writeFailed;
+  mutexUnlock(extraData->mutex);
+
+  if (writeFailed) {
+    return false;
+  }
+
+  semaphoreWait(extraData->freeBlocks);
+  block = extraData->blocks[extraData->clientIndex];
+  block->blocksize = sampleBuffer->blocksize;
+  sampleBufferCopyAndMapChannels(block, sampleBuffer);
+  self->numSamplesProcessed +=
+      sampleBuffer->blocksize * sampleBuffer->numChannels;
+  extraData->clientIndex = (extraData->clientIndex + 1) % extraData->numBlocks;
+  _changeAsyncQueue(extraData, 1);
+  semaphorePost(extraData->filledBlocks);
+
+  return true;
+}
+
+static void _drainAsyncWriter(SampleSourceAsyncData extraData) {
+  unsigned int i;
+
+  // Once every block has been handed back, the worker has written them all
+  for (i = 0; i < extraData->numBlocks; i++) {
+    semaphoreWait(extraData->freeBlocks);
+  }
+
+  for (i = 0; i < extraData->numBlocks; i++) {
+    semaphorePost(extraData->freeBlocks);
+  }
+}
+
+static void _stopAsyncWorker(SampleSourceAsyncData extraData) {
+  if (extraData->thread != NULL) {
+    // Wake up the worker, which is either a reader waiting for a free block or
+    // a writer waiting for a filled one. If it has already finished, then this
+    // has no effect.
+    mutexLock(extraData->mutex);
+    extraData->stopRequested = true;
+    mutexUnlock(extraData->mutex);
+    semaphorePost(extraData->freeBlocks);
+    semaphorePost(extraData->filledBlocks);
+    threadJoinAndFree(extraData->thread);
+    extraData->thread = NULL;
+    // Blocks which were left in the queue are dropped with it
+    _changeAsyncQueue(extraData, -(int)atomicLoad(&extraData->numQueuedBlocks));
+  }
+}
+
+static void _closeSampleSourceAsync(void *sampleSourcePtr) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceAsyncData extraData = (SampleSourceAsyncData)self->extraData;
+
+  if (self->openedAs == SAMPLE_SOURCE_OPEN_WRITE && extraData->thread != NULL) {
+    _drainAsyncWriter(extraData);
+  }
+
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_NOT_OPENED) {
+    _stopAsyncWorker(extraData);
+    extraData->source->closeSampleSource(extraData->source);
+    self->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  }
+}
+
+static void _freeSampleSourceDataAsync(void *sampleSourceDataPtr) {
+  SampleSourceAsyncData extraData = (SampleSourceAsyncData)sampleSourceDataPtr;
+  unsigned int i;
+
+  _stopAsyncWorker(extraData);
+  freeSampleSource(extraData->source);
+
+  for (i = 0; i < extraData->numBlocks; i++) {
+    freeSampleBuffer(extraData->blocks[i]);
+  }
+
+  free(extraData->blocks);
+  freeSemaphore(extraData->freeBlocks);
+  freeSemaphore(extraData->filledBlocks);
+  freeMutex(extraData->mutex);
+  free(extraData);
+}
+
+static SampleSource _newSampleSourceAsync(SampleSource source,
+                                          SampleSourceOpenAs openAs,
+                                          unsigned int numBlocks,
+                                          SampleCount blocksize) {
+  SampleSource sampleSource;
+  SampleSourceAsyncData extraData;
+  unsigned int i;
+
+  if (source == NULL || source->openedAs != openAs || numBlocks == 0 ||
+      blocksize == 0) {
+    return NULL;
+  }
+
+  sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  extraData =
+      (SampleSourceAsyncData)malloc(sizeof(SampleSourceAsyncDataMembers));
+
+  sampleSource->sampleSourceType = source->sampleSourceType;
+  sampleSource->openedAs = openAs;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, source->sourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceAsync;
+  sampleSource->closeSampleSource = _closeSampleSourceAsync;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataAsync;
+  // The worker thread reads ahead of the caller, so the read position of the
+  // wrapped source is never the position of the next block
+  sampleSource->seekSampleSource = NULL;
+
+  if (openAs == SAMPLE_SOURCE_OPEN_READ) {
+    sampleSource->readSampleBlock = _readBlockFromAsyncReader;
+    sampleSource->writeSampleBlock = _writeBlockToAsyncReader;
+  } else {
+    sampleSource->readSampleBlock = _readBlockFromAsyncWriter;
+    sampleSource->writeSampleBlock = _writeBlockToAsyncWriter;
+  }
+
+  extraData->source = source;
+  extraData->numBlocks = numBlocks;
+  extraData->blocksize = blocksize;
+  extraData->blocks = (SampleBuffer *)malloc(sizeof(SampleBuffer) * numBlocks);
+
+  for (i = 0; i < numBlocks; i++) {
+    extraData->blocks[i] = newSampleBuffer(getNumChannels(), blocksize);
+  }
+
+  extraData->freeBlocks = newSemaphore(numBlocks);
+  extraData->filledBlocks = newSemaphore(0);
+  extraData->workerIndex = 0;
+  extraData->clientIndex = 0;
+  extraData->finished = false;
+  extraData->mutex = newMutex();
+  extraData->stopRequested = false;
+  extraData->writeFailed = false;
+  extraData->numQueuedBlocks = 0;
+  extraData->metricsQueue = openAs == SAMPLE_SOURCE_OPEN_READ
+                                ? LIVE_METRICS_QUEUE_PREFETCH
+                                : LIVE_METRICS_QUEUE_WRITE_BEHIND;
+  extraData->thread = NULL;
+  sampleSource->extraData = extraData;
+
+  extraData->thread = newThread(openAs == SAMPLE_SOURCE_OPEN_READ
+                                    ? _asyncReaderThread
+                                    : _asyncWriterThread,
+                                sampleSource);
+
+  if (extraData->thread == NULL) {
+    // Don't free the wrapped source, it still belongs to the caller
+    extraData->source = NULL;
+    freeSampleSource(sampleSource);
+    return NULL;
+  }
+
+  logDebug("Started asynchronous %s for '%s' with %d blocks",
+           openAs == SAMPLE_SOURCE_OPEN_READ ? "reader" : "writer",
+           source->sourceName->data, numBlocks);
+  return sampleSource;
+}
+
+SampleSource newSampleSourceAsyncReader(SampleSource source,
+                                        unsigned int numBlocks,
+                                        SampleCount blocksize) {
+  return _newSampleSourceAsync(source, SAMPLE_SOURCE_OPEN_READ, numBlocks,
+                               blocksize);
+}
+
+SampleSource newSampleSourceAsyncWriter(SampleSource source,
+                                        unsigned int numBlocks,
+                                        SampleCount blocksize) {
+  return _newSampleSourceAsync(source, SAMPLE_SOURCE_OPEN_WRITE, numBlocks,
+                               blocksize);
+}
@@ -0,0 +1,101 @@
+//
+// SampleSourceAsync.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_SampleSourceAsync_h
+#define MrsWatson_SampleSourceAsync_h
+
+#include "app/LiveMetrics.h"
+#include "base/Thread.h"
+#include "io/SampleSource.h"
+
+typedef struct {
+  SampleSource source;
+  SampleBuffer *blocks;
+  unsigned int numBlocks;
+  SampleCount blocksize;
+  Semaphore freeBlocks;
+  Semaphore filledBlocks;
+  Thread thread;
+
+  // Only accessed from the worker thread
+  unsigned int workerIndex;
+  // Only accessed from the processing thread
+  unsigned int clientIndex;
+  boolByte finished;
+  // Guarded by mutex, since these are shared between both threads
+  Mutex mutex;
+  boolByte stopRequested;
+  boolByte writeFailed;
+  // Filled blocks which the other side has not taken yet, updated atomically
+  // so that the queue depth can be reported in the live metrics
+  volatile unsigned int numQueuedBlocks;
+  LiveMetricsQueue metricsQueue;
+} SampleSourceAsyncDataMembers;
+typedef SampleSourceAsyncDataMembers *SampleSourceAsyncData;
+
+/**
+ * Wrap an input source so that blocks are read ahead of processing in a
+ * background thread. The reader fills a ring of sample blocks and blocks
+ * itself once the ring is full, so at most numBlocks blocks are buffered.
+ *
+ * The returned source takes ownership of the wrapped source, which must
+ * already be opened for reading. Closing the returned source stops the reader
+ * thread and closes the wrapped source.
+ *
+ * @param source Opened input source
+ * @param numBlocks Number of blocks to read ahead, must be at least 1
+ * @param blocksize Number of frames in each block. This must be the same as
+ * the blocksize of the buffers which are passed to readSampleBlock().
+ * @return New sample source, or NULL if the reader thread could not be
+ * started. In that case, the caller retains ownership of the source.
+ */
+SampleSource newSampleSourceAsyncReader(SampleSource source,
+                                        unsigned int numBlocks,
+                                        SampleCount blocksize);
+
+/**
+ * Wrap an output source so that blocks are written behind processing in a
+ * background thread. Each written block is copied into a ring of sample
+ * blocks, and the caller only waits if all numBlocks blocks are still queued.
+ *
+ * The returned source takes ownership of the wrapped source, which must
+ * already be opened for writing. Closing the returned source first waits for
+ * all queued blocks to be written, and then closes the wrapped source so that
+ * any header fix-ups happen after the last block. If the background thread
+ * fails to write a block, then the next call to writeSampleBlock() returns
+ * false.
+ *
+ * @param source Opened output source
+ * @param numBlocks Number of blocks to queue, must be at least 1
+ * @param blocksize Largest number of frames which may be written at once
+ * @return New sample source, or NULL if the writer thread could not be
+ * started. In that case, the caller retains ownership of the source.
+ */
+SampleSource newSampleSourceAsyncWriter(SampleSource source,
+                                        unsigned int numBlocks,
+                                        SampleCount blocksize);
+
+#endif
@@ -30,6 +30,7 @@
 
 #include "audio/AudioSettings.h"
 #include "audio/PcmSampleBuffer.h"
+#include "base/PlatformInfo.h"
 #include "io/SampleSourcePcm.h"
 #include "logging/EventLogger.h"
 
@@ -130,11 +131,12 @@ static boolByte _openSampleSourceAudiofile(void *selfPtr,
         afOpenFile(self->sourceName->data, "w", outfileSetup);
     extraData->pcmSampleBuffer =
         newPcmSampleBuffer(getNumChannels(), getBlocksize(), getBitDepth());
-    extraData->pcmSampleBuffer->littleEndian =
-        (boolByte)(byteOrder == AF_BYTEORDER_LITTLEENDIAN);
+    // audiofile converts samples from the processor's byte order to the byte
+    // order of the file, so they must not be flipped before writing them
+    extraData->pcmSampleBuffer->littleEndian = platformInfoIsLittleEndian();
     logDebug("Opened audiofile %d-bit, %s-endian for writing",
              extraData->pcmSampleBuffer->bitDepth,
-             extraData->pcmSampleBuffer->littleEndian ? "little" : "big");
+             byteOrder == AF_BYTEORDER_LITTLEENDIAN ? "little" : "big");
     afFreeFileSetup(outfileSetup);
   } else {
     logInternalError("Invalid type for openAs in audiofile source");
@@ -168,17 +170,19 @@ boolByte _readBlockFromAudiofile(void *selfPtr, SampleBuffer sampleBuffer) {
         sampleBuffer->numChannels, sampleBuffer->blocksize, getBitDepth());
   }
 
-  numFramesRead =
-      afReadFrames(extraData->fileHandle, AF_DEFAULT_TRACK,
-                   extraData->pcmSampleBuffer->pcmSamples, (int)getBlocksize());
-  extraData->pcmSampleBuffer->setSamples(extraData->pcmSampleBuffer);
+  numFramesRead = afReadFrames(extraData->fileHandle, AF_DEFAULT_TRACK,
+                               extraData->pcmSampleBuffer->pcmSamples,
+                               (int)sampleBuffer->blocksize);
 
-  sampleBufferCopyAndMapChannels(
-      sampleBuffer,
-      extraData->pcmSampleBuffer->getSampleBuffer(extraData->pcmSampleBuffer));
-
-  // Set the blocksize of the sample buffer to be the number of frames read
+  // Set the blocksize of the sample buffer to be the number of frames read,
+  // and convert only those frames directly into it
   sampleBuffer->blocksize = (SampleCount)numFramesRead;
+
+  if (numFramesRead > 0) {
+    pcmSampleBufferConvertToSampleBuffer(
+        extraData->pcmSampleBuffer, extraData->pcmSampleBuffer->pcmSamples,
+        sampleBuffer);
+  }
   self->numSamplesProcessed += sampleBuffer->blocksize;
 
   if (numFramesRead == 0) {
@@ -192,20 +196,51 @@ boolByte _readBlockFromAudiofile(void *selfPtr, SampleBuffer sampleBuffer) {
   }
 }
 
+static boolByte _seekSampleSourceAudiofile(void *selfPtr,
+                                           unsigned long frame) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceAudiofileData extraData =
+      (SampleSourceAudiofileData)(self->extraData);
+
+  if (extraData->fileHandle == NULL ||
+      afSeekFrame(extraData->fileHandle, AF_DEFAULT_TRACK,
+                  (AFframecount)frame) < 0) {
+    logDebug("Could not seek to frame %lu of '%s'", frame,
+             self->sourceName->data);
+    return false;
+  }
+
+  return true;
+}
+
 boolByte _writeBlockToAudiofile(void *selfPtr,
                                 const SampleBuffer sampleBuffer) {
   SampleSource self = (SampleSource)selfPtr;
   SampleSourceAudiofileData extraData =
       (SampleSourceAudiofileData)(self->extraData);
   const AFframecount numSamplesToWrite = sampleBuffer->blocksize;
+  const SampleBuffer superSampleBuffer =
+      extraData->pcmSampleBuffer->getSampleBuffer(extraData->pcmSampleBuffer);
   AFframecount numFramesWritten = 0;
 
+  // Smaller blocks fit into the PCM sample buffer, so it only needs to be
+  // regenerated when writing a larger block than before
+  if (superSampleBuffer->blocksize < sampleBuffer->blocksize ||
+      superSampleBuffer->numChannels != sampleBuffer->numChannels) {
+    boolByte littleEndian = extraData->pcmSampleBuffer->littleEndian;
+    freePcmSampleBuffer(extraData->pcmSampleBuffer);
+    extraData->pcmSampleBuffer = newPcmSampleBuffer(
+        sampleBuffer->numChannels, sampleBuffer->blocksize, getBitDepth());
+    extraData->pcmSampleBuffer->littleEndian = littleEndian;
+  }
+
   extraData->pcmSampleBuffer->setSampleBuffer(extraData->pcmSampleBuffer,
                                               sampleBuffer);
   numFramesWritten = afWriteFrames(extraData->fileHandle, AF_DEFAULT_TRACK,
                                    extraData->pcmSampleBuffer->pcmSamples,
-                                   (int)getBlocksize());
-  self->numSamplesProcessed += getBlocksize() * getNumChannels();
+                                   (int)sampleBuffer->blocksize);
+  self->numSamplesProcessed +=
+      sampleBuffer->blocksize * sampleBuffer->numChannels;
 
   if (numFramesWritten == -1) {
     logWarn("audiofile encountered an error when writing to file");
@@ -254,6 +289,7 @@ _newSampleSourceAudiofile(const CharString sampleSourceName,
   sampleSource->openSampleSource = _openSampleSourceAudiofile;
   sampleSource->readSampleBlock = _readBlockFromAudiofile;
   sampleSource->writeSampleBlock = _writeBlockToAudiofile;
+  sampleSource->seekSampleSource = _seekSampleSourceAudiofile;
   sampleSource->closeSampleSource = _closeSampleSourceAudiofile;
   sampleSource->freeSampleSourceData = _freeSampleSourceDataAudiofile;
 
@@ -0,0 +1,575 @@
+//
+// SampleSourceCached.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SampleSourceCached.h"
+
+#include "audio/AudioSettings.h"
+#include "base/File.h"
+#include "logging/EventLogger.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if WINDOWS
+#include <process.h>
+#define getpid _getpid
+#elif UNIX
+#include <unistd.h>
+#endif
+
+// The header holds the magic, version, channel count, frames per chunk, sample
+// rate and number of frames. Everything is stored in the native byte order, so
+// an entry written on a machine with another byte order fails the version
+// check and is simply decoded again.
+#define CACHED_HEADER_SIZE 32
+
+static const char *kSampleSourceCachedMagic = "MWDC";
+static const uint32_t kSampleSourceCachedVersion = 1;
+static const SampleCount kSampleSourceCachedChunkFrames = 16384;
+
+static CharString sampleSourceCacheDirectory = NULL;
+
+boolByte initSampleSourceCache(const CharString cacheDirectory) {
+  File directory = newFileWithPath(cacheDirectory);
+  boolByte result = false;
+
+  if (directory != NULL) {
+    if (directory->fileType == kFileTypeDirectory) {
+      result = true;
+    } else if (directory->fileType == kFileTypeInvalid) {
+      result = fileCreate(directory, kFileTypeDirectory);
+    }
+  }
+
+  if (!result) {
+    logError("Could not use '%s' as decode cache directory",
+             cacheDirectory->data);
+    freeFile(directory);
+    return false;
+  }
+
+  freeSampleSourceCache();
+  sampleSourceCacheDirectory = newCharString();
+  charStringCopy(sampleSourceCacheDirectory, directory->absolutePath);
+  freeFile(directory);
+  return true;
+}
+
+boolByte sampleSourceCacheIsEnabled(void) {
+  return (boolByte)(sampleSourceCacheDirectory != NULL);
+}
+
+boolByte sampleSourceCanBeCached(const SampleSource source) {
+  if (source == NULL) {
+    return false;
+  }
+
+  switch (source->sampleSourceType) {
+#if USE_AUDIOFILE
+  // Without audiofile, AIFF files are read as PCM data like WAVE files
+  case SAMPLE_SOURCE_TYPE_AIFF:
+#endif
+  case SAMPLE_SOURCE_TYPE_FLAC:
+  case SAMPLE_SOURCE_TYPE_MP3:
+  case SAMPLE_SOURCE_TYPE_OGG:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+SampleSource sampleSourceCacheWrap(SampleSource source) {
+  if (!sampleSourceCacheIsEnabled() || !sampleSourceCanBeCached(source)) {
+    return source;
+  }
+
+  return newSampleSourceCached(source, sampleSourceCacheDirectory);
+}
+
+// 64-bit FNV-1a, which is only used to name the entries
+static unsigned long long _hashCachedKey(const char *data,
+                                         unsigned long long hash) {
+  while (*data != '\0') {
+    hash ^= (unsigned char)*data++;
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
+/**
+ * Build the path of the cache entry for the wrapped source's file
+ * @return True if the source is a regular file
+ */
+static boolByte _setCachedEntryPath(SampleSourceCachedData extraData) {
+  File inputFile = newFileWithPath(extraData->source->sourceName);
+  char key[64];
+  unsigned long long hash = 0xcbf29ce484222325ULL;
+
+  if (inputFile == NULL || inputFile->fileType != kFileTypeFile) {
+    freeFile(inputFile);
+    return false;
+  }
+
+  snprintf(key, sizeof(key), "\t%lu\t%lu",
+           (unsigned long)fileGetSize(inputFile),
+           fileGetModificationTime(inputFile));
+  hash = _hashCachedKey(inputFile->absolutePath->data, hash);
+  hash = _hashCachedKey(key, hash);
+  freeFile(inputFile);
+
+  extraData->entryPath = newCharStringWithCapacity(
+      extraData->cacheDirectory->capacity + 32);
+  snprintf(extraData->entryPath->data, extraData->entryPath->capacity,
+           "%s%c%016llx.%s", extraData->cacheDirectory->data, PATH_DELIMITER,
+           hash, SAMPLE_SOURCE_CACHED_EXTENSION);
+  return true;
+}
+
+static size_t _getCachedChunkSize(SampleSourceCachedData extraData) {
+  return sizeof(float) * (size_t)extraData->chunkFrames *
+         extraData->numChannels;
+}
+
+/**
+ * Map an existing entry and check its header
+ * @return True if the entry can be read
+ */
+static boolByte _openCachedEntry(SampleSource self) {
+  SampleSourceCachedData extraData = (SampleSourceCachedData)self->extraData;
+  FILE *entryFile = fopen(extraData->entryPath->data, "rb");
+  uint32_t version, numChannels, chunkFrames;
+  uint64_t numFrames;
+  double sampleRate;
+  unsigned long numChunks;
+  const byte *header;
+
+  if (entryFile == NULL) {
+    return false;
+  }
+
+  extraData->entry = newMappedFile(entryFile);
+  fclose(entryFile);
+
+  if (extraData->entry == NULL ||
+      extraData->entry->size < CACHED_HEADER_SIZE) {
+    freeMappedFile(extraData->entry);
+    extraData->entry = NULL;
+    return false;
+  }
+
+  header = extraData->entry->data;
+  memcpy(&version, header + 4, sizeof(version));
+  memcpy(&numChannels, header + 8, sizeof(numChannels));
+  memcpy(&chunkFrames, header + 12, sizeof(chunkFrames));
+  memcpy(&sampleRate, header + 16, sizeof(sampleRate));
+  memcpy(&numFrames, header + 24, sizeof(numFrames));
+
+  if (memcmp(header, kSampleSourceCachedMagic, 4) != 0 ||
+      version != kSampleSourceCachedVersion || numChannels == 0 ||
+      chunkFrames == 0) {
+    logWarn("Ignoring invalid decode cache entry '%s'",
+            extraData->entryPath->data);
+    freeMappedFile(extraData->entry);
+    extraData->entry = NULL;
+    return false;
+  }
+
+  extraData->numChannels = (ChannelCount)numChannels;
+  extraData->chunkFrames = (SampleCount)chunkFrames;
+  extraData->numFrames = (unsigned long)numFrames;
+  numChunks = (extraData->numFrames + extraData->chunkFrames - 1) /
+              extraData->chunkFrames;
+
+  if (extraData->entry->size <
+      CACHED_HEADER_SIZE + numChunks * _getCachedChunkSize(extraData)) {
+    logWarn("Ignoring truncated decode cache entry '%s'",
+            extraData->entryPath->data);
+    freeMappedFile(extraData->entry);
+    extraData->entry = NULL;
+    return false;
+  }
+
+  if (!setNumChannels(extraData->numChannels) || !setSampleRate(sampleRate)) {
+    freeMappedFile(extraData->entry);
+    extraData->entry = NULL;
+    return false;
+  }
+
+  logInfo("Reading decoded audio of '%s' from cache", self->sourceName->data);
+  return true;
+}
+
+static void _writeCachedHeader(SampleSourceCachedData extraData) {
+  byte header[CACHED_HEADER_SIZE];
+  const uint32_t numChannels = extraData->numChannels;
+  const uint32_t chunkFrames = (uint32_t)extraData->chunkFrames;
+  const double sampleRate = getSampleRate();
+  const uint64_t numFrames = extraData->framesWritten;
+
+  memcpy(header, kSampleSourceCachedMagic, 4);
+  memcpy(header + 4, &kSampleSourceCachedVersion, sizeof(uint32_t));
+  memcpy(header + 8, &numChannels, sizeof(numChannels));
+  memcpy(header + 12, &chunkFrames, sizeof(chunkFrames));
+  memcpy(header + 16, &sampleRate, sizeof(sampleRate));
+  memcpy(header + 24, &numFrames, sizeof(numFrames));
+  fwrite(header, 1, CACHED_HEADER_SIZE, extraData->tempFile);
+}
+
+static void _abandonCachedEntry(SampleSourceCachedData extraData) {
+  if (extraData->tempFile != NULL) {
+    fclose(extraData->tempFile);
+    extraData->tempFile = NULL;
+    remove(extraData->tempPath->data);
+  }
+}
+
+/**
+ * Start writing a new entry for a wrapped source which was just opened
+ */
+static void _startCachedEntry(SampleSourceCachedData extraData) {
+  extraData->tempPath =
+      newCharStringWithCapacity(extraData->entryPath->capacity + 32);
+  // Each process writes its own temporary file, so that concurrent jobs never
+  // see a partially written entry
+  snprintf(extraData->tempPath->data, extraData->tempPath->capacity,
+           "%s.%d.tmp", extraData->entryPath->data, (int)getpid());
+  extraData->tempFile = fopen(extraData->tempPath->data, "wb");
+
+  if (extraData->tempFile == NULL) {
+    logWarn("Could not write decode cache entry '%s'",
+            extraData->tempPath->data);
+    return;
+  }
+
+  extraData->numChannels = getNumChannels();
+  extraData->chunkFrames = kSampleSourceCachedChunkFrames;
+  extraData->chunk = (float *)calloc(
+      (size_t)extraData->chunkFrames * extraData->numChannels, sizeof(float));
+  extraData->chunkPosition = 0;
+  extraData->framesWritten = 0;
+  // The header is written again with the number of frames once it is known
+  _writeCachedHeader(extraData);
+}
+
+static boolByte _writeCachedChunk(SampleSourceCachedData extraData) {
+  const size_t chunkSize = _getCachedChunkSize(extraData);
+  boolByte result =
+      (boolByte)(fwrite(extraData->chunk, 1, chunkSize,
+                        extraData->tempFile) == chunkSize);
+
+  memset(extraData->chunk, 0, chunkSize);
+  extraData->chunkPosition = 0;
+  return result;
+}
+
+static void _finishCachedEntry(SampleSourceCachedData extraData) {
+  boolByte result = true;
+
+  if (extraData->chunkPosition > 0) {
+    result = _writeCachedChunk(extraData);
+  }
+
+  if (result && fseek(extraData->tempFile, 0, SEEK_SET) == 0) {
+    _writeCachedHeader(extraData);
+  } else {
+    result = false;
+  }
+
+  result = (boolByte)(fclose(extraData->tempFile) == 0 && result);
+  extraData->tempFile = NULL;
+
+#if WINDOWS
+  // Windows cannot rename a file over an existing one
+  remove(extraData->entryPath->data);
+#endif
+
+  if (result &&
+      rename(extraData->tempPath->data, extraData->entryPath->data) == 0) {
+    logInfo("Stored %lu decoded frames in cache '%s'",
+            extraData->framesWritten, extraData->entryPath->data);
+  } else {
+    logWarn("Could not write decode cache entry '%s'",
+            extraData->entryPath->data);
+    remove(extraData->tempPath->data);
+  }
+}
+
+/**
+ * Add the frames of a block which was read from the wrapped source to the entry
+ */
+static void _appendCachedBlock(SampleSourceCachedData extraData,
+                               const SampleBuffer sampleBuffer) {
+  SampleCount numFrames = 0;
+  SampleCount chunkFrames;
+  ChannelCount i;
+  SampleCount j;
+  float *destination;
+
+  while (numFrames < sampleBuffer->blocksize) {
+    chunkFrames = extraData->chunkFrames - extraData->chunkPosition;
+
+    if (chunkFrames > sampleBuffer->blocksize - numFrames) {
+      chunkFrames = sampleBuffer->blocksize - numFrames;
+    }
+
+    for (i = 0; i < extraData->numChannels && i < sampleBuffer->numChannels;
+         i++) {
+      destination = extraData->chunk + (size_t)i * extraData->chunkFrames +
+                    extraData->chunkPosition;
+
+      for (j = 0; j < chunkFrames; j++) {
+        destination[j] = (float)sampleBuffer->samples[i][numFrames + j];
+      }
+    }
+
+    numFrames += chunkFrames;
+    extraData->chunkPosition += chunkFrames;
+    extraData->framesWritten += chunkFrames;
+
+    if (extraData->chunkPosition == extraData->chunkFrames &&
+        !_writeCachedChunk(extraData)) {
+      logWarn("Could not write decode cache entry '%s'",
+              extraData->tempPath->data);
+      _abandonCachedEntry(extraData);
+      return;
+    }
+  }
+}
+
+static boolByte _openSampleSourceCached(void *sampleSourcePtr,
+                                        const SampleSourceOpenAs openAs) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceCachedData extraData = (SampleSourceCachedData)self->extraData;
+  SampleSource source = extraData->source;
+
+  if (openAs != SAMPLE_SOURCE_OPEN_READ) {
+    logError("Cached sample source '%s' can only be read",
+             self->sourceName->data);
+    return false;
+  }
+
+  if (_setCachedEntryPath(extraData) && _openCachedEntry(self)) {
+    extraData->position = 0;
+    self->openedAs = openAs;
+    return true;
+  }
+
+  if (!source->openSampleSource(source, openAs)) {
+    return false;
+  }
+
+  if (extraData->entryPath != NULL) {
+    _startCachedEntry(extraData);
+  }
+
+  self->openedAs = openAs;
+  return true;
+}
+
+static boolByte _readBlockFromCachedEntry(SampleSource self,
+                                          SampleBuffer sampleBuffer) {
+  SampleSourceCachedData extraData = (SampleSourceCachedData)self->extraData;
+  const SampleCount originalBlocksize = sampleBuffer->blocksize;
+  const ChannelCount numChannels =
+      sampleBuffer->numChannels < extraData->numChannels
+          ? sampleBuffer->numChannels
+          : extraData->numChannels;
+  const float *chunk;
+  SampleCount numFrames = 0;
+  SampleCount chunkOffset;
+  SampleCount chunkFrames;
+  ChannelCount i;
+  SampleCount j;
+
+  while (numFrames < originalBlocksize &&
+         extraData->position < extraData->numFrames) {
+    chunk = (const float *)(extraData->entry->data + CACHED_HEADER_SIZE +
+                            extraData->position / extraData->chunkFrames *
+                                _getCachedChunkSize(extraData));
+    chunkOffset = extraData->position % extraData->chunkFrames;
+    chunkFrames = extraData->chunkFrames - chunkOffset;
+
+    if (chunkFrames > originalBlocksize - numFrames) {
+      chunkFrames = originalBlocksize - numFrames;
+    }
+
+    if (chunkFrames > extraData->numFrames - extraData->position) {
+      chunkFrames = extraData->numFrames - extraData->position;
+    }
+
+    for (i = 0; i < numChannels; i++) {
+      for (j = 0; j < chunkFrames; j++) {
+        sampleBuffer->samples[i][numFrames + j] =
+            chunk[(size_t)i * extraData->chunkFrames + chunkOffset + j];
+      }
+    }
+
+    numFrames += chunkFrames;
+    extraData->position += chunkFrames;
+  }
+
+  for (i = numChannels; i < sampleBuffer->numChannels; i++) {
+    memset(sampleBuffer->samples[i], 0, sizeof(Sample) * numFrames);
+  }
+
+  sampleBuffer->blocksize = numFrames;
+  self->numSamplesProcessed += numFrames * sampleBuffer->numChannels;
+  return (boolByte)(numFrames == originalBlocksize);
+}
+
+static boolByte _readBlockFromCached(void *sampleSourcePtr,
+                                     SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceCachedData extraData = (SampleSourceCachedData)self->extraData;
+  const SampleCount originalBlocksize = sampleBuffer->blocksize;
+  boolByte result;
+
+  if (extraData->entry != NULL) {
+    return _readBlockFromCachedEntry(self, sampleBuffer);
+  }
+
+  result = extraData->source->readSampleBlock(extraData->source, sampleBuffer);
+  self->numSamplesProcessed = extraData->source->numSamplesProcessed;
+
+  if (extraData->tempFile != NULL) {
+    _appendCachedBlock(extraData, sampleBuffer);
+
+    // A short block means that the whole input has been decoded
+    if (extraData->tempFile != NULL &&
+        sampleBuffer->blocksize < originalBlocksize) {
+      _finishCachedEntry(extraData);
+    }
+  }
+
+  return result;
+}
+
+static boolByte _writeBlockToCached(void *sampleSourcePtr,
+                                    const SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  logInternalError("Cached sample source '%s' cannot be written to",
+                   self->sourceName->data);
+  return false;
+}
+
+static boolByte _seekSampleSourceCached(void *sampleSourcePtr,
+                                        unsigned long frame) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceCachedData extraData = (SampleSourceCachedData)self->extraData;
+
+  if (extraData->entry != NULL) {
+    if (frame > extraData->numFrames) {
+      return false;
+    }
+
+    extraData->position = frame;
+    return true;
+  }
+
+  // An entry must contain the whole input, which is no longer read in order
+  _abandonCachedEntry(extraData);
+  return sampleSourceSeek(extraData->source, frame);
+}
+
+static void _closeSampleSourceCached(void *sampleSourcePtr) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceCachedData extraData = (SampleSourceCachedData)self->extraData;
+
+  if (extraData->entry != NULL) {
+    freeMappedFile(extraData->entry);
+    extraData->entry = NULL;
+  } else if (extraData->source->openedAs != SAMPLE_SOURCE_OPEN_NOT_OPENED) {
+    // Stopping before the end of the input leaves an incomplete entry
+    _abandonCachedEntry(extraData);
+    extraData->source->closeSampleSource(extraData->source);
+  }
+
+  self->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+}
+
+static void _freeSampleSourceDataCached(void *sampleSourceDataPtr) {
+  SampleSourceCachedData extraData =
+      (SampleSourceCachedData)sampleSourceDataPtr;
+
+  _abandonCachedEntry(extraData);
+  freeMappedFile(extraData->entry);
+  freeSampleSource(extraData->source);
+  freeCharString(extraData->cacheDirectory);
+  freeCharString(extraData->entryPath);
+  freeCharString(extraData->tempPath);
+  free(extraData->chunk);
+  free(extraData);
+}
+
+SampleSource newSampleSourceCached(SampleSource source,
+                                   const CharString cacheDirectory) {
+  SampleSource sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  SampleSourceCachedData extraData =
+      (SampleSourceCachedData)malloc(sizeof(SampleSourceCachedDataMembers));
+
+  sampleSource->sampleSourceType = source->sampleSourceType;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, source->sourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceCached;
+  sampleSource->readSampleBlock = _readBlockFromCached;
+  sampleSource->writeSampleBlock = _writeBlockToCached;
+  sampleSource->seekSampleSource = _seekSampleSourceCached;
+  sampleSource->closeSampleSource = _closeSampleSourceCached;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataCached;
+
+  extraData->source = source;
+  extraData->cacheDirectory = newCharString();
+  charStringCopy(extraData->cacheDirectory, cacheDirectory);
+  extraData->entryPath = NULL;
+  extraData->entry = NULL;
+  extraData->numChannels = 0;
+  extraData->chunkFrames = 0;
+  extraData->numFrames = 0;
+  extraData->position = 0;
+  extraData->tempFile = NULL;
+  extraData->tempPath = NULL;
+  extraData->chunk = NULL;
+  extraData->chunkPosition = 0;
+  extraData->framesWritten = 0;
+  sampleSource->extraData = extraData;
+  return sampleSource;
+}
+
+boolByte sampleSourceCachedIsHit(const SampleSource self) {
+  SampleSourceCachedData extraData = (SampleSourceCachedData)self->extraData;
+  return (boolByte)(extraData->entry != NULL);
+}
+
+void freeSampleSourceCache(void) {
+  freeCharString(sampleSourceCacheDirectory);
+  sampleSourceCacheDirectory = NULL;
+}
@@ -0,0 +1,126 @@
+//
+// SampleSourceCached.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_SampleSourceCached_h
+#define MrsWatson_SampleSourceCached_h
+
+#include "base/MappedFile.h"
+#include "io/SampleSource.h"
+
+#include <stdio.h>
+
+#define SAMPLE_SOURCE_CACHED_EXTENSION "mwdc"
+
+/**
+ * Decoded audio from an input file, which is kept in a cache directory so that
+ * later jobs reading the same file can skip decoding it. Entries are keyed by
+ * a hash of the file's absolute path, size and modification time, so they are
+ * ignored once the file changes. They hold 32-bit float samples in chunks of a
+ * fixed number of frames, with the channels of each chunk following each
+ * other, and are mapped into memory for reading. Since entries are plain
+ * files, they are shared by all processes using the same cache directory.
+ */
+typedef struct {
+  // Wrapped source, which is only opened when no cache entry exists yet
+  SampleSource source;
+  CharString cacheDirectory;
+  CharString entryPath;
+
+  // Set when reading from an existing entry
+  MappedFile entry;
+  ChannelCount numChannels;
+  SampleCount chunkFrames;
+  unsigned long numFrames;
+  unsigned long position;
+
+  // Set while a new entry is written from the decoded audio. The entry is
+  // only moved into place once the whole input has been read.
+  FILE *tempFile;
+  CharString tempPath;
+  float *chunk;
+  SampleCount chunkPosition;
+  unsigned long framesWritten;
+} SampleSourceCachedDataMembers;
+typedef SampleSourceCachedDataMembers *SampleSourceCachedData;
+
+/**
+ * Enable the global decode cache, which is used by sampleSourceCacheWrap(). If
+ * the cache was already enabled, then its directory is replaced.
+ * @param cacheDirectory Directory to store entries in, which is created if it
+ * does not exist
+ * @return True if the directory exists or could be created
+ */
+boolByte initSampleSourceCache(const CharString cacheDirectory);
+
+/**
+ * @return True if initSampleSourceCache() has been called
+ */
+boolByte sampleSourceCacheIsEnabled(void);
+
+/**
+ * Check if decoding a source is expensive enough to be worth caching. Raw PCM
+ * and WAVE files are read directly or mapped instead, and streams cannot be
+ * cached since they have no file to key the entry by.
+ * @param source Sample source which has not been opened yet
+ * @return True if the source decodes a compressed or foreign file format
+ */
+boolByte sampleSourceCanBeCached(const SampleSource source);
+
+/**
+ * Wrap an input source with the global decode cache, if it is enabled and the
+ * source can be cached.
+ * @param source Sample source which has not been opened yet
+ * @return New cached source which takes ownership of source, or source itself
+ */
+SampleSource sampleSourceCacheWrap(SampleSource source);
+
+/**
+ * Wrap an input source so that its decoded audio is cached. When the returned
+ * source is opened, it reads from the cache entry for the wrapped source's
+ * file if there is one, and otherwise reads the wrapped source while writing
+ * a new entry. Seeking a source without an entry stops writing the entry,
+ * since it would not contain the whole file. The returned source can only be
+ * opened for reading.
+ * @param source Sample source which has not been opened yet. The returned
+ * source takes ownership of it.
+ * @param cacheDirectory Existing directory to store entries in
+ * @return New sample source
+ */
+SampleSource newSampleSourceCached(SampleSource source,
+                                   const CharString cacheDirectory);
+
+/**
+ * @param self Cached source which has been opened
+ * @return True if it reads from an existing cache entry
+ */
+boolByte sampleSourceCachedIsHit(const SampleSource self);
+
+/**
+ * Disable the global decode cache. Entries are kept on disk.
+ */
+void freeSampleSourceCache(void);
+
+#endif
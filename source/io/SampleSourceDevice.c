@@ -0,0 +1,407 @@
+//
+// SampleSourceDevice.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#if USE_PORTAUDIO
+
+#include "SampleSourceDevice.h"
+
+#include "audio/AudioSettings.h"
+#include "base/Thread.h"
+#include "logging/EventLogger.h"
+#include "time/TaskTimer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Longest time to wait for the device to consume or produce audio before
+// giving up, in milliseconds
+static const double kSampleSourceDeviceTimeoutInMs = 2000.0;
+
+typedef struct {
+  const char *name;
+  PaHostApiTypeId typeId;
+} SampleSourceDeviceHostApi;
+
+static const SampleSourceDeviceHostApi kSampleSourceDeviceHostApis[] = {
+    {"alsa", paALSA},
+    {"jack", paJACK},
+    {"coreaudio", paCoreAudio},
+    {"wasapi", paWASAPI},
+    {"asio", paASIO},
+    {"directsound", paDirectSound},
+    {"mme", paMME},
+    {"oss", paOSS},
+    {NULL, paInDevelopment}};
+
+boolByte sampleSourceIsDeviceName(const CharString sampleSourceName) {
+  const size_t prefixLength = strlen(SAMPLE_SOURCE_DEVICE_NAME);
+
+  if (sampleSourceName == NULL ||
+      strncmp(sampleSourceName->data, SAMPLE_SOURCE_DEVICE_NAME,
+              prefixLength) != 0) {
+    return false;
+  }
+
+  return (boolByte)(sampleSourceName->data[prefixLength] == '\0' ||
+                    sampleSourceName->data[prefixLength] == ':');
+}
+
+void sampleSourceDevicePrintDevices(void) {
+  PaHostApiIndex i;
+  PaDeviceIndex j;
+
+  if (Pa_Initialize() != paNoError) {
+    return;
+  }
+
+  logInfo("Audio devices (use as 'device' or 'device:<host API>'):");
+
+  for (i = 0; i < Pa_GetHostApiCount(); i++) {
+    const PaHostApiInfo *hostApiInfo = Pa_GetHostApiInfo(i);
+    logInfo("- %s%s", hostApiInfo->name,
+            i == Pa_GetDefaultHostApi() ? " (default)" : "");
+
+    for (j = 0; j < hostApiInfo->deviceCount; j++) {
+      const PaDeviceIndex device = Pa_HostApiDeviceIndexToDeviceIndex(i, j);
+      const PaDeviceInfo *deviceInfo = Pa_GetDeviceInfo(device);
+      logInfo("  - %s (%d in, %d out)", deviceInfo->name,
+              deviceInfo->maxInputChannels, deviceInfo->maxOutputChannels);
+    }
+  }
+
+  Pa_Terminate();
+}
+
+static PaHostApiIndex
+_sampleSourceDeviceFindHostApi(const CharString sampleSourceName) {
+  const char *separator = strchr(sampleSourceName->data, ':');
+  const SampleSourceDeviceHostApi *hostApi;
+  PaHostApiIndex result = paHostApiNotFound;
+  CharString hostApiName;
+
+  if (separator == NULL || separator[1] == '\0') {
+    return Pa_GetDefaultHostApi();
+  }
+
+  hostApiName = newCharStringWithCString(separator + 1);
+
+  for (hostApi = kSampleSourceDeviceHostApis; hostApi->name != NULL;
+       hostApi++) {
+    if (charStringIsEqualToCString(hostApiName, hostApi->name, true)) {
+      result = Pa_HostApiTypeIdToHostApiIndex(hostApi->typeId);
+      break;
+    }
+  }
+
+  if (hostApi->name == NULL) {
+    logError("Unknown audio host API '%s'", hostApiName->data);
+  }
+
+  freeCharString(hostApiName);
+  return result;
+}
+
+static int _sampleSourceDeviceInputCallback(
+    const void *input, void *output, unsigned long frameCount,
+    const PaStreamCallbackTimeInfo *timeInfo,
+    PaStreamCallbackFlags statusFlags, void *userData) {
+  SampleSourceDeviceData extraData = (SampleSourceDeviceData)userData;
+
+  if (sampleRingBufferWriteInterleaved(extraData->ring, (const Sample *)input,
+                                       frameCount) < frameCount) {
+    atomicAdd(&extraData->numDropouts, 1);
+  }
+
+  return paContinue;
+}
+
+static int _sampleSourceDeviceOutputCallback(
+    const void *input, void *output, unsigned long frameCount,
+    const PaStreamCallbackTimeInfo *timeInfo,
+    PaStreamCallbackFlags statusFlags, void *userData) {
+  SampleSourceDeviceData extraData = (SampleSourceDeviceData)userData;
+  Sample *frames = (Sample *)output;
+  const SampleCount framesRead =
+      sampleRingBufferReadInterleaved(extraData->ring, frames, frameCount);
+
+  if (framesRead < frameCount) {
+    memset(frames + framesRead * extraData->numChannels, 0,
+           (frameCount - framesRead) * extraData->numChannels * sizeof(Sample));
+
+    if (atomicLoad(&extraData->outputStarted)) {
+      atomicAdd(&extraData->numDropouts, 1);
+    }
+  }
+
+  return paContinue;
+}
+
+static boolByte _openSampleSourceDevice(void *sampleSourcePtr,
+                                        const SampleSourceOpenAs openAs) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourceDeviceData extraData =
+      (SampleSourceDeviceData)sampleSource->extraData;
+  const boolByte isInput = (boolByte)(openAs == SAMPLE_SOURCE_OPEN_READ);
+  const PaHostApiInfo *hostApiInfo;
+  const PaStreamInfo *streamInfo;
+  PaStreamParameters parameters;
+  PaError result;
+
+  result = Pa_Initialize();
+
+  if (result != paNoError) {
+    logError("Could not initialize audio devices: %s",
+             Pa_GetErrorText(result));
+    return false;
+  }
+
+  extraData->initialized = true;
+  extraData->hostApi = _sampleSourceDeviceFindHostApi(sampleSource->sourceName);
+
+  if (extraData->hostApi < 0) {
+    logError("Audio host API for '%s' is not available",
+             sampleSource->sourceName->data);
+    return false;
+  }
+
+  hostApiInfo = Pa_GetHostApiInfo(extraData->hostApi);
+  parameters.device = isInput ? hostApiInfo->defaultInputDevice
+                              : hostApiInfo->defaultOutputDevice;
+
+  if (parameters.device == paNoDevice) {
+    logError("%s has no default %s device", hostApiInfo->name,
+             isInput ? "input" : "output");
+    return false;
+  }
+
+  extraData->numChannels = getNumChannels();
+  extraData->blocksize = getBlocksize();
+  parameters.channelCount = extraData->numChannels;
+  parameters.sampleFormat = paFloat32;
+  parameters.suggestedLatency =
+      isInput ? Pa_GetDeviceInfo(parameters.device)->defaultLowInputLatency
+              : Pa_GetDeviceInfo(parameters.device)->defaultLowOutputLatency;
+  parameters.hostApiSpecificStreamInfo = NULL;
+
+  extraData->ring = newSampleRingBuffer(
+      extraData->numChannels,
+      extraData->blocksize * kSampleSourceDeviceRingBlocks);
+
+  // The device is asked to call back once per block, so that each block read
+  // by the plugin chain is available as soon as the device has delivered it
+  result = Pa_OpenStream(
+      &extraData->stream, isInput ? &parameters : NULL,
+      isInput ? NULL : &parameters, getSampleRate(), extraData->blocksize,
+      paNoFlag,
+      isInput ? _sampleSourceDeviceInputCallback
+              : _sampleSourceDeviceOutputCallback,
+      extraData);
+
+  if (result != paNoError) {
+    logError("Could not open %s device '%s': %s", isInput ? "input" : "output",
+             Pa_GetDeviceInfo(parameters.device)->name,
+             Pa_GetErrorText(result));
+    extraData->stream = NULL;
+    return false;
+  }
+
+  result = Pa_StartStream(extraData->stream);
+
+  if (result != paNoError) {
+    logError("Could not start audio device: %s", Pa_GetErrorText(result));
+    return false;
+  }
+
+  // Besides the device's own latency, one more block is spent waiting in the
+  // ring until the whole block has been delivered or consumed
+  streamInfo = Pa_GetStreamInfo(extraData->stream);
+
+  if (isInput) {
+    setInputLatency((SampleCount)(streamInfo->inputLatency * getSampleRate() +
+                                  0.5) +
+                    extraData->blocksize);
+  } else {
+    setOutputLatency((SampleCount)(streamInfo->outputLatency *
+                                       getSampleRate() +
+                                   0.5) +
+                     extraData->blocksize);
+  }
+
+  logInfo("Opened %s device '%s' via %s, latency %ld frames",
+          isInput ? "input" : "output",
+          Pa_GetDeviceInfo(parameters.device)->name, hostApiInfo->name,
+          isInput ? getInputLatency() : getOutputLatency());
+  sampleSource->openedAs = openAs;
+  return true;
+}
+
+// Move part of a block to or from the ring, waiting for the device whenever
+// the ring is empty or full. The buffer's channel pointers are offset in place
+// so that blocks larger than the ring can be passed in several parts.
+static boolByte _sampleSourceDeviceTransfer(SampleSourceDeviceData extraData,
+                                            SampleBuffer buffer,
+                                            const boolByte isInput) {
+  const SampleCount blocksize = buffer->blocksize;
+  const double pollTimeInMs =
+      extraData->blocksize * 1000.0 / getSampleRate() / 4.0;
+  double waitedTimeInMs = 0.0;
+  SampleCount position = 0;
+  SampleCount numFrames;
+  ChannelCount i;
+
+  while (position < blocksize) {
+    for (i = 0; i < buffer->numChannels; i++) {
+      buffer->samples[i] += position;
+    }
+
+    buffer->blocksize = blocksize - position;
+    numFrames = isInput ? sampleRingBufferReadBlock(extraData->ring, buffer)
+                        : sampleRingBufferWriteBlock(extraData->ring, buffer);
+    buffer->blocksize = blocksize;
+
+    for (i = 0; i < buffer->numChannels; i++) {
+      buffer->samples[i] -= position;
+    }
+
+    position += numFrames;
+
+    if (numFrames > 0) {
+      waitedTimeInMs = 0.0;
+    } else if (waitedTimeInMs > kSampleSourceDeviceTimeoutInMs ||
+               Pa_IsStreamActive(extraData->stream) != 1) {
+      logError("Audio device stopped responding");
+      return false;
+    } else {
+      taskTimerSleep(pollTimeInMs);
+      waitedTimeInMs += pollTimeInMs;
+    }
+  }
+
+  return true;
+}
+
+static boolByte _readBlockFromDevice(void *sampleSourcePtr,
+                                     SampleBuffer sampleBuffer) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourceDeviceData extraData =
+      (SampleSourceDeviceData)sampleSource->extraData;
+
+  if (!_sampleSourceDeviceTransfer(extraData, sampleBuffer, true)) {
+    return false;
+  }
+
+  sampleSource->numSamplesProcessed +=
+      sampleBuffer->blocksize * sampleBuffer->numChannels;
+  return true;
+}
+
+static boolByte _writeBlockToDevice(void *sampleSourcePtr,
+                                    const SampleBuffer sampleBuffer) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourceDeviceData extraData =
+      (SampleSourceDeviceData)sampleSource->extraData;
+
+  if (!_sampleSourceDeviceTransfer(extraData, sampleBuffer, false)) {
+    return false;
+  }
+
+  atomicStore(&extraData->outputStarted, 1);
+  sampleSource->numSamplesProcessed +=
+      sampleBuffer->blocksize * sampleBuffer->numChannels;
+  return true;
+}
+
+static void _closeSampleSourceDevice(void *sampleSourcePtr) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourceDeviceData extraData =
+      (SampleSourceDeviceData)sampleSource->extraData;
+  double waitedTimeInMs = 0.0;
+
+  if (extraData->stream != NULL) {
+    // Let the device play whatever is still queued
+    while (sampleSource->openedAs == SAMPLE_SOURCE_OPEN_WRITE &&
+           sampleRingBufferGetReadable(extraData->ring) > 0 &&
+           Pa_IsStreamActive(extraData->stream) == 1 &&
+           waitedTimeInMs < kSampleSourceDeviceTimeoutInMs) {
+      taskTimerSleep(1.0);
+      waitedTimeInMs += 1.0;
+    }
+
+    Pa_StopStream(extraData->stream);
+    Pa_CloseStream(extraData->stream);
+    extraData->stream = NULL;
+
+    if (extraData->numDropouts > 0) {
+      logWarn("Audio device '%s' had %u dropouts",
+              sampleSource->sourceName->data, extraData->numDropouts);
+    }
+  }
+
+  if (extraData->initialized) {
+    Pa_Terminate();
+    extraData->initialized = false;
+  }
+}
+
+static void _freeSampleSourceDataDevice(void *sampleSourceDataPtr) {
+  SampleSourceDeviceData extraData =
+      (SampleSourceDeviceData)sampleSourceDataPtr;
+  freeSampleRingBuffer(extraData->ring);
+  free(extraData);
+}
+
+SampleSource _newSampleSourceDevice(const CharString sampleSourceName) {
+  SampleSource sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  SampleSourceDeviceData extraData =
+      (SampleSourceDeviceData)malloc(sizeof(SampleSourceDeviceDataMembers));
+
+  sampleSource->sampleSourceType = SAMPLE_SOURCE_TYPE_DEVICE;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, sampleSourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceDevice;
+  sampleSource->readSampleBlock = _readBlockFromDevice;
+  sampleSource->writeSampleBlock = _writeBlockToDevice;
+  sampleSource->seekSampleSource = NULL;
+  sampleSource->closeSampleSource = _closeSampleSourceDevice;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataDevice;
+
+  extraData->stream = NULL;
+  extraData->hostApi = paHostApiNotFound;
+  extraData->initialized = false;
+  extraData->ring = NULL;
+  extraData->numChannels = 0;
+  extraData->blocksize = 0;
+  extraData->outputStarted = 0;
+  extraData->numDropouts = 0;
+
+  sampleSource->extraData = extraData;
+  return sampleSource;
+}
+
+#endif
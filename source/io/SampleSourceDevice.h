@@ -0,0 +1,77 @@
+//
+// SampleSourceDevice.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#if USE_PORTAUDIO
+
+#ifndef MrsWatson_SampleSourceDevice_h
+#define MrsWatson_SampleSourceDevice_h
+
+#include "audio/SampleRingBuffer.h"
+#include "io/SampleSource.h"
+
+#include <portaudio.h>
+
+// Sources with this name, optionally followed by a colon and the name of a
+// host API such as "device:jack", use a live audio device
+#define SAMPLE_SOURCE_DEVICE_NAME "device"
+
+// Number of blocks which the ring between the device and the plugin chain
+// can hold
+static const SampleCount kSampleSourceDeviceRingBlocks = 4;
+
+typedef struct {
+  PaStream *stream;
+  PaHostApiIndex hostApi;
+  boolByte initialized;
+
+  // Filled by the device callback and emptied by readSampleBlock() for
+  // inputs, and the other way around for outputs
+  SampleRingBuffer ring;
+  ChannelCount numChannels;
+  SampleCount blocksize;
+
+  // Set once the first block has been written to an output, since the device
+  // starts asking for audio before the plugin chain has produced any
+  volatile unsigned int outputStarted;
+  // Blocks where the device callback found the ring full (for inputs) or
+  // empty (for outputs)
+  volatile unsigned int numDropouts;
+} SampleSourceDeviceDataMembers;
+typedef SampleSourceDeviceDataMembers *SampleSourceDeviceData;
+
+/**
+ * @param sampleSourceName Name of a sample source
+ * @return True if the name refers to an audio device rather than a file
+ */
+boolByte sampleSourceIsDeviceName(const CharString sampleSourceName);
+
+/**
+ * Print the host APIs and devices which can be used with device sources
+ */
+void sampleSourceDevicePrintDevices(void);
+
+#endif
+#endif
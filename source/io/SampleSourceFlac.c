@@ -0,0 +1,470 @@
+//
+// SampleSourceFlac.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#if USE_FLAC
+
+#include "SampleSourceFlac.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static FLAC__StreamDecoderWriteStatus
+_flacDecoderWrite(const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame,
+                  const FLAC__int32 *const buffer[], void *clientData) {
+  SampleSourceFlacData extraData = (SampleSourceFlacData)clientData;
+  const SampleCount numFrames = frame->header.blocksize;
+  const ChannelCount numChannels = (ChannelCount)frame->header.channels;
+  const Sample scale =
+      1.0f / (Sample)(1u << (frame->header.bits_per_sample - 1));
+  SampleBuffer decoded = extraData->decodedBuffer;
+  ChannelCount channel;
+  SampleCount i;
+
+  if (decoded == NULL || decoded->blocksize < numFrames ||
+      decoded->numChannels != numChannels) {
+    freeSampleBuffer(decoded);
+    decoded = newSampleBuffer(numChannels, numFrames);
+    extraData->decodedBuffer = decoded;
+  }
+
+  // Convert straight into planar floating-point samples, since FLAC frames
+  // are already stored one channel after the other
+  for (channel = 0; channel < numChannels; channel++) {
+    for (i = 0; i < numFrames; i++) {
+      decoded->samples[channel][i] = (Sample)buffer[channel][i] * scale;
+    }
+  }
+
+  extraData->decodedFrames = numFrames;
+  extraData->decodedPosition = 0;
+  return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+static void _flacDecoderMetadata(const FLAC__StreamDecoder *decoder,
+                                 const FLAC__StreamMetadata *metadata,
+                                 void *clientData) {
+  SampleSourceFlacData extraData = (SampleSourceFlacData)clientData;
+
+  if (metadata->type == FLAC__METADATA_TYPE_STREAMINFO) {
+    setNumChannels((ChannelCount)metadata->data.stream_info.channels);
+    setSampleRate((SampleRate)metadata->data.stream_info.sample_rate);
+    extraData->bitDepth = metadata->data.stream_info.bits_per_sample;
+
+    switch (extraData->bitDepth) {
+    case kBitDepth8Bit:
+    case kBitDepth16Bit:
+    case kBitDepth24Bit:
+      setBitDepth((BitDepth)extraData->bitDepth);
+      break;
+
+    default:
+      break;
+    }
+  }
+}
+
+static void _flacDecoderError(const FLAC__StreamDecoder *decoder,
+                              FLAC__StreamDecoderErrorStatus status,
+                              void *clientData) {
+  SampleSourceFlacData extraData = (SampleSourceFlacData)clientData;
+  logError("Error decoding FLAC file: %s",
+           FLAC__StreamDecoderErrorStatusString[status]);
+  extraData->decodeFailed = true;
+}
+
+static boolByte _openFlacDecoder(SampleSource self) {
+  SampleSourceFlacData extraData = (SampleSourceFlacData)self->extraData;
+  FLAC__StreamDecoderInitStatus status;
+
+  extraData->decoder = FLAC__stream_decoder_new();
+
+  if (extraData->decoder == NULL) {
+    return false;
+  }
+
+  status = FLAC__stream_decoder_init_file(
+      extraData->decoder, self->sourceName->data, _flacDecoderWrite,
+      _flacDecoderMetadata, _flacDecoderError, extraData);
+
+  if (status != FLAC__STREAM_DECODER_INIT_STATUS_OK) {
+    logDebug("FLAC decoder could not be initialized: %s",
+             FLAC__StreamDecoderInitStatusString[status]);
+    return false;
+  }
+
+  // Setting up the audio settings needs the stream info, which is the first
+  // metadata block of every FLAC file
+  if (!FLAC__stream_decoder_process_until_end_of_metadata(extraData->decoder) ||
+      extraData->decodeFailed || extraData->bitDepth == 0) {
+    return false;
+  }
+
+  logDebug("Opened FLAC file %d-bit for reading", extraData->bitDepth);
+  return true;
+}
+
+static boolByte _openFlacEncoder(SampleSource self) {
+  SampleSourceFlacData extraData = (SampleSourceFlacData)self->extraData;
+  FLAC__StreamEncoderInitStatus status;
+
+  if (getBitDepth() == kBitDepth32Bit) {
+    logUnsupportedFeature("32-bit FLAC files");
+    return false;
+  }
+
+  extraData->encoder = FLAC__stream_encoder_new();
+
+  if (extraData->encoder == NULL) {
+    return false;
+  }
+
+  extraData->bitDepth = getBitDepth();
+  FLAC__stream_encoder_set_channels(extraData->encoder, getNumChannels());
+  FLAC__stream_encoder_set_bits_per_sample(extraData->encoder,
+                                           extraData->bitDepth);
+  FLAC__stream_encoder_set_sample_rate(extraData->encoder,
+                                       (unsigned int)getSampleRate());
+  FLAC__stream_encoder_set_compression_level(extraData->encoder,
+                                             extraData->compressionLevel);
+
+  if (extraData->numThreads > 1) {
+#if FLAC_API_VERSION_CURRENT >= 14
+    if (FLAC__stream_encoder_set_num_threads(extraData->encoder,
+                                             extraData->numThreads) !=
+        FLAC__STREAM_ENCODER_SET_NUM_THREADS_OK) {
+      logWarn("libFLAC could not use %d threads, encoding on one thread",
+              extraData->numThreads);
+    }
+#else
+    logWarn("This version of libFLAC cannot encode on multiple threads");
+#endif
+  }
+
+  status = FLAC__stream_encoder_init_file(
+      extraData->encoder, self->sourceName->data, NULL, NULL);
+
+  if (status != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
+    logDebug("FLAC encoder could not be initialized: %s",
+             FLAC__StreamEncoderInitStatusString[status]);
+    return false;
+  }
+
+  logDebug("Opened FLAC file %d-bit for writing with compression level %d",
+           extraData->bitDepth, extraData->compressionLevel);
+  return true;
+}
+
+static boolByte _openSampleSourceFlac(void *selfPtr,
+                                      const SampleSourceOpenAs openAs) {
+  SampleSource self = (SampleSource)selfPtr;
+  boolByte result;
+
+  if (openAs == SAMPLE_SOURCE_OPEN_READ) {
+    result = _openFlacDecoder(self);
+  } else if (openAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    result = _openFlacEncoder(self);
+  } else {
+    logInternalError("Invalid type for openAs in FLAC file");
+    return false;
+  }
+
+  if (!result) {
+    logError("FLAC file '%s' could not be opened for %s",
+             self->sourceName->data,
+             openAs == SAMPLE_SOURCE_OPEN_READ ? "reading" : "writing");
+    // The decoder and encoder are deleted even if they were not initialized
+    self->closeSampleSource(self);
+    return false;
+  }
+
+  self->openedAs = openAs;
+  return true;
+}
+
+static boolByte _readBlockFromFlacFile(void *selfPtr,
+                                       SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceFlacData extraData = (SampleSourceFlacData)self->extraData;
+  SampleCount framesRead = 0;
+  SampleCount framesToCopy;
+  ChannelCount channel;
+
+  while (framesRead < sampleBuffer->blocksize) {
+    if (extraData->decodedPosition >= extraData->decodedFrames) {
+      extraData->decodedFrames = 0;
+
+      if (extraData->decodeFailed ||
+          FLAC__stream_decoder_get_state(extraData->decoder) ==
+              FLAC__STREAM_DECODER_END_OF_STREAM ||
+          !FLAC__stream_decoder_process_single(extraData->decoder)) {
+        break;
+      }
+
+      // Metadata blocks after the stream info do not produce any frames
+      continue;
+    }
+
+    framesToCopy = extraData->decodedFrames - extraData->decodedPosition;
+
+    if (framesToCopy > sampleBuffer->blocksize - framesRead) {
+      framesToCopy = sampleBuffer->blocksize - framesRead;
+    }
+
+    for (channel = 0; channel < sampleBuffer->numChannels; channel++) {
+      if (channel < extraData->decodedBuffer->numChannels) {
+        memcpy(sampleBuffer->samples[channel] + framesRead,
+               extraData->decodedBuffer->samples[channel] +
+                   extraData->decodedPosition,
+               sizeof(Sample) * framesToCopy);
+      } else {
+        memset(sampleBuffer->samples[channel] + framesRead, 0,
+               sizeof(Sample) * framesToCopy);
+      }
+    }
+
+    extraData->decodedPosition += framesToCopy;
+    framesRead += framesToCopy;
+  }
+
+  if (framesRead < sampleBuffer->blocksize) {
+    logDebug("End of FLAC file reached");
+    sampleBuffer->blocksize = framesRead;
+    self->numSamplesProcessed += framesRead * sampleBuffer->numChannels;
+    return false;
+  }
+
+  self->numSamplesProcessed += framesRead * sampleBuffer->numChannels;
+  return true;
+}
+
+static boolByte _seekSampleSourceFlac(void *selfPtr, unsigned long frame) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceFlacData extraData = (SampleSourceFlacData)self->extraData;
+
+  if (extraData->decoder == NULL || extraData->decodeFailed) {
+    return false;
+  }
+
+  // libFLAC jumps close to the frame with the seek table of the file, or by
+  // bisecting the file when it has none, and then decodes the FLAC frame which
+  // contains the target. The write callback receives that frame starting at
+  // the target, so anything left over from the old position is dropped here.
+  extraData->decodedFrames = 0;
+  extraData->decodedPosition = 0;
+
+  if (!FLAC__stream_decoder_seek_absolute(extraData->decoder,
+                                          (FLAC__uint64)frame)) {
+    logDebug("Could not seek to frame %lu of '%s'", frame,
+             self->sourceName->data);
+
+    if (FLAC__stream_decoder_get_state(extraData->decoder) ==
+        FLAC__STREAM_DECODER_SEEK_ERROR) {
+      FLAC__stream_decoder_flush(extraData->decoder);
+    }
+
+    return false;
+  }
+
+  return true;
+}
+
+static void _resizeFlacEncodeBuffer(SampleSourceFlacData extraData,
+                                    const SampleBuffer sampleBuffer) {
+  ChannelCount i;
+
+  for (i = 0; i < extraData->encodeChannels; i++) {
+    free(extraData->encodeBuffer[i]);
+  }
+
+  free(extraData->encodeBuffer);
+  extraData->encodeChannels = sampleBuffer->numChannels;
+  extraData->encodeBlocksize = sampleBuffer->blocksize;
+  extraData->encodeBuffer =
+      (FLAC__int32 **)malloc(sizeof(FLAC__int32 *) * sampleBuffer->numChannels);
+
+  for (i = 0; i < sampleBuffer->numChannels; i++) {
+    extraData->encodeBuffer[i] = (FLAC__int32 *)malloc(
+        sizeof(FLAC__int32) * sampleBuffer->blocksize);
+  }
+
+  freeDither(extraData->dither);
+  extraData->dither = NULL;
+
+  if (getDitherType() != kDitherTypeNone) {
+    extraData->dither = newDither(getDitherType(), sampleBuffer->numChannels);
+  }
+}
+
+static boolByte _writeBlockToFlacFile(void *selfPtr,
+                                      const SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceFlacData extraData = (SampleSourceFlacData)self->extraData;
+  const double scale = (double)(1u << (extraData->bitDepth - 1));
+  const double maxValue = scale - 1.0;
+  double value;
+  ChannelCount channel;
+  SampleCount i;
+
+  // Smaller blocks fit into the encode buffer, so it only needs to be
+  // regenerated when writing a larger block than before
+  if (extraData->encodeBlocksize < sampleBuffer->blocksize ||
+      extraData->encodeChannels != sampleBuffer->numChannels) {
+    _resizeFlacEncodeBuffer(extraData, sampleBuffer);
+  }
+
+  for (channel = 0; channel < sampleBuffer->numChannels; channel++) {
+    for (i = 0; i < sampleBuffer->blocksize; i++) {
+      if (extraData->dither != NULL) {
+        extraData->encodeBuffer[channel][i] = (FLAC__int32)ditherQuantize(
+            extraData->dither, channel, sampleBuffer->samples[channel][i],
+            scale, (int)maxValue);
+        continue;
+      }
+
+      value = sampleBuffer->samples[channel][i] * scale;
+
+      if (value > maxValue) {
+        value = maxValue;
+      } else if (value < -scale) {
+        value = -scale;
+      }
+
+      extraData->encodeBuffer[channel][i] = (FLAC__int32)value;
+    }
+  }
+
+  if (!FLAC__stream_encoder_process(
+          extraData->encoder,
+          (const FLAC__int32 *const *)extraData->encodeBuffer,
+          (unsigned int)sampleBuffer->blocksize)) {
+    logError("Error encoding FLAC file: %s",
+             FLAC__StreamEncoderStateString[FLAC__stream_encoder_get_state(
+                 extraData->encoder)]);
+    return false;
+  }
+
+  self->numSamplesProcessed +=
+      sampleBuffer->blocksize * sampleBuffer->numChannels;
+  return true;
+}
+
+static void _closeSampleSourceFlac(void *selfPtr) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceFlacData extraData = (SampleSourceFlacData)self->extraData;
+
+  if (extraData->decoder != NULL) {
+    FLAC__stream_decoder_delete(extraData->decoder);
+    extraData->decoder = NULL;
+  }
+
+  if (extraData->encoder != NULL) {
+    // Finishing the encoder writes the last frames and the final stream info
+    if (FLAC__stream_encoder_get_state(extraData->encoder) ==
+            FLAC__STREAM_ENCODER_OK &&
+        !FLAC__stream_encoder_finish(extraData->encoder)) {
+      logError("Could not finish writing FLAC file '%s'",
+               self->sourceName->data);
+    }
+
+    FLAC__stream_encoder_delete(extraData->encoder);
+    extraData->encoder = NULL;
+  }
+}
+
+void sampleSourceFlacSetCompressionLevel(SampleSource self,
+                                         unsigned int compressionLevel) {
+  SampleSourceFlacData extraData = (SampleSourceFlacData)self->extraData;
+
+  if (compressionLevel > kSampleSourceFlacMaxCompressionLevel) {
+    logWarn("FLAC compression level %d is out of range, using %d instead",
+            compressionLevel, kSampleSourceFlacMaxCompressionLevel);
+    compressionLevel = kSampleSourceFlacMaxCompressionLevel;
+  }
+
+  extraData->compressionLevel = compressionLevel;
+}
+
+void sampleSourceFlacSetNumThreads(SampleSource self,
+                                   unsigned int numThreads) {
+  SampleSourceFlacData extraData = (SampleSourceFlacData)self->extraData;
+  extraData->numThreads = numThreads;
+}
+
+static void _freeSampleSourceDataFlac(void *extraDataPtr) {
+  SampleSourceFlacData extraData = (SampleSourceFlacData)extraDataPtr;
+  ChannelCount i;
+
+  for (i = 0; i < extraData->encodeChannels; i++) {
+    free(extraData->encodeBuffer[i]);
+  }
+
+  free(extraData->encodeBuffer);
+  freeDither(extraData->dither);
+  freeSampleBuffer(extraData->decodedBuffer);
+  free(extraData);
+}
+
+SampleSource _newSampleSourceFlac(const CharString sampleSourceName) {
+  SampleSource sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  SampleSourceFlacData extraData =
+      (SampleSourceFlacData)malloc(sizeof(SampleSourceFlacDataMembers));
+
+  sampleSource->sampleSourceType = SAMPLE_SOURCE_TYPE_FLAC;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, sampleSourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceFlac;
+  sampleSource->readSampleBlock = _readBlockFromFlacFile;
+  sampleSource->writeSampleBlock = _writeBlockToFlacFile;
+  sampleSource->seekSampleSource = _seekSampleSourceFlac;
+  sampleSource->closeSampleSource = _closeSampleSourceFlac;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataFlac;
+
+  extraData->decoder = NULL;
+  extraData->encoder = NULL;
+  extraData->compressionLevel = kSampleSourceFlacDefaultCompressionLevel;
+  extraData->numThreads = 1;
+  extraData->bitDepth = 0;
+  extraData->decodedBuffer = NULL;
+  extraData->decodedFrames = 0;
+  extraData->decodedPosition = 0;
+  extraData->decodeFailed = false;
+  extraData->encodeBuffer = NULL;
+  extraData->encodeChannels = 0;
+  extraData->encodeBlocksize = 0;
+  extraData->dither = NULL;
+
+  sampleSource->extraData = extraData;
+  return sampleSource;
+}
+
+#endif
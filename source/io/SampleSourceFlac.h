@@ -0,0 +1,88 @@
+//
+// SampleSourceFlac.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#if USE_FLAC
+
+#ifndef MrsWatson_SampleSourceFlac_h
+#define MrsWatson_SampleSourceFlac_h
+
+#include "audio/Dither.h"
+#include "io/SampleSource.h"
+
+#include <FLAC/stream_decoder.h>
+#include <FLAC/stream_encoder.h>
+
+// Compression level used by the reference flac encoder when none is given
+static const unsigned int kSampleSourceFlacDefaultCompressionLevel = 5;
+static const unsigned int kSampleSourceFlacMaxCompressionLevel = 8;
+
+typedef struct {
+  FLAC__StreamDecoder *decoder;
+  FLAC__StreamEncoder *encoder;
+  unsigned int compressionLevel;
+  unsigned int numThreads;
+  unsigned int bitDepth;
+
+  // Frames which have been decoded by libFLAC but not yet read. FLAC frames
+  // rarely line up with our blocks, so a decoded frame is usually spread over
+  // two calls to readSampleBlock().
+  SampleBuffer decodedBuffer;
+  SampleCount decodedFrames;
+  SampleCount decodedPosition;
+  boolByte decodeFailed;
+
+  // Planar integer samples which are passed to the encoder
+  FLAC__int32 **encodeBuffer;
+  ChannelCount encodeChannels;
+  SampleCount encodeBlocksize;
+  // Only created when a dither type is set in the audio settings
+  Dither dither;
+} SampleSourceFlacDataMembers;
+typedef SampleSourceFlacDataMembers *SampleSourceFlacData;
+
+/**
+ * Set the compression level used when writing a FLAC file. This must be called
+ * before the source is opened for writing.
+ * @param self FLAC sample source
+ * @param compressionLevel Level from 0 (fastest) to 8 (smallest files)
+ */
+void sampleSourceFlacSetCompressionLevel(SampleSource self,
+                                         unsigned int compressionLevel);
+
+/**
+ * Set the number of threads used to encode a FLAC file. FLAC frames are
+ * encoded independently of each other, so libFLAC can compress several frames
+ * at once on a pool of threads and then write them out in order. This requires
+ * libFLAC 1.5 or newer, and must be called before the source is opened for
+ * writing.
+ * @param self FLAC sample source
+ * @param numThreads Number of encoder threads, or 1 to encode on the thread
+ * which writes the blocks
+ */
+void sampleSourceFlacSetNumThreads(SampleSource self, unsigned int numThreads);
+
+#endif
+#endif
@@ -0,0 +1,180 @@
+//
+// SampleSourceHasher.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "SampleSourceHasher.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+
+static boolByte _openSampleSourceHasher(void *sampleSourcePtr,
+                                        const SampleSourceOpenAs openAs) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  // The wrapped source was already opened before it was wrapped
+  return (boolByte)(self->openedAs == openAs);
+}
+
+static boolByte _readBlockFromHasher(void *sampleSourcePtr,
+                                     SampleBuffer sampleBuffer) {
+  logInternalError("Cannot read from a hashed output source");
+  return false;
+}
+
+static void _finishHashedBlock(SampleSourceHasherData extraData) {
+  XxHashMembers blockHash;
+  unsigned long long channelHash;
+  byte bytes[8];
+  ChannelCount i;
+  unsigned int j;
+
+  blockHash.seed = 0;
+  xxHashReset(&blockHash);
+
+  for (i = 0; i < extraData->numChannels; i++) {
+    channelHash = xxHashDigest(extraData->channelHashes[i]);
+
+    for (j = 0; j < sizeof(bytes); j++) {
+      bytes[j] = (byte)(channelHash >> (j * 8));
+    }
+
+    xxHashUpdate(&blockHash, bytes, sizeof(bytes));
+    xxHashReset(extraData->channelHashes[i]);
+  }
+
+  outputHashesSetBlock(extraData->hashes, extraData->blockIndex,
+                       xxHashDigest(&blockHash), extraData->blockFrames);
+  extraData->blockIndex++;
+  extraData->blockFrames = 0;
+}
+
+static boolByte _writeBlockToHasher(void *sampleSourcePtr,
+                                    const SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceHasherData extraData = (SampleSourceHasherData)self->extraData;
+  const SampleCount blocksize = extraData->hashes->blocksize;
+  SampleCount offset = 0;
+  SampleCount numFrames;
+  ChannelCount i;
+
+  // Writes are split at the block boundaries of the whole output, however
+  // they line up with them
+  while (offset < sampleBuffer->blocksize) {
+    numFrames = blocksize - extraData->blockFrames;
+
+    if (numFrames > sampleBuffer->blocksize - offset) {
+      numFrames = sampleBuffer->blocksize - offset;
+    }
+
+    for (i = 0; i < extraData->numChannels && i < sampleBuffer->numChannels;
+         i++) {
+      xxHashUpdate(extraData->channelHashes[i],
+                   sampleBuffer->samples[i] + offset,
+                   sizeof(Sample) * numFrames);
+    }
+
+    extraData->blockFrames += numFrames;
+    offset += numFrames;
+
+    if (extraData->blockFrames == blocksize) {
+      _finishHashedBlock(extraData);
+    }
+  }
+
+  self->numSamplesProcessed +=
+      sampleBuffer->blocksize * sampleBuffer->numChannels;
+  return extraData->source->writeSampleBlock(extraData->source, sampleBuffer);
+}
+
+static void _closeSampleSourceHasher(void *sampleSourcePtr) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceHasherData extraData = (SampleSourceHasherData)self->extraData;
+
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_NOT_OPENED) {
+    if (extraData->blockFrames > 0) {
+      _finishHashedBlock(extraData);
+    }
+
+    extraData->source->closeSampleSource(extraData->source);
+    self->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  }
+}
+
+static void _freeSampleSourceDataHasher(void *sampleSourceDataPtr) {
+  SampleSourceHasherData extraData =
+      (SampleSourceHasherData)sampleSourceDataPtr;
+  ChannelCount i;
+
+  for (i = 0; i < extraData->numChannels; i++) {
+    freeXxHash(extraData->channelHashes[i]);
+  }
+
+  free(extraData->channelHashes);
+  freeSampleSource(extraData->source);
+  free(extraData);
+}
+
+SampleSource newSampleSourceHasher(SampleSource source, OutputHashes hashes,
+                                   unsigned long startFrame) {
+  SampleSource sampleSource;
+  SampleSourceHasherData extraData;
+  ChannelCount i;
+
+  if (source == NULL || source->openedAs != SAMPLE_SOURCE_OPEN_WRITE ||
+      hashes == NULL || startFrame % hashes->blocksize != 0) {
+    return NULL;
+  }
+
+  sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  extraData =
+      (SampleSourceHasherData)malloc(sizeof(SampleSourceHasherDataMembers));
+
+  sampleSource->sampleSourceType = source->sampleSourceType;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_WRITE;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, source->sourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceHasher;
+  sampleSource->readSampleBlock = _readBlockFromHasher;
+  sampleSource->writeSampleBlock = _writeBlockToHasher;
+  sampleSource->seekSampleSource = NULL;
+  sampleSource->closeSampleSource = _closeSampleSourceHasher;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataHasher;
+
+  extraData->source = source;
+  extraData->hashes = hashes;
+  extraData->numChannels = hashes->numChannels;
+  extraData->channelHashes =
+      (XxHash *)malloc(sizeof(XxHash) * extraData->numChannels);
+
+  for (i = 0; i < extraData->numChannels; i++) {
+    extraData->channelHashes[i] = newXxHash(0);
+  }
+
+  extraData->blockIndex = (size_t)(startFrame / hashes->blocksize);
+  extraData->blockFrames = 0;
+  sampleSource->extraData = extraData;
+  return sampleSource;
+}
@@ -0,0 +1,69 @@
+//
+// SampleSourceHasher.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_SampleSourceHasher_h
+#define MrsWatson_SampleSourceHasher_h
+
+#include "app/OutputHashes.h"
+#include "base/XxHash.h"
+#include "io/SampleSource.h"
+
+typedef struct {
+  SampleSource source;
+  OutputHashes hashes;
+  // One hash state for each channel, since the samples are stored in planar
+  // buffers and are hashed without being interleaved first
+  XxHash *channelHashes;
+  ChannelCount numChannels;
+  // Block which is being hashed, counted from the start of the whole output,
+  // and the number of its frames which were written so far
+  size_t blockIndex;
+  SampleCount blockFrames;
+} SampleSourceHasherDataMembers;
+typedef SampleSourceHasherDataMembers *SampleSourceHasherData;
+
+/**
+ * Wrap an output source so that the hash of every block is calculated as it
+ * is written, which verifies the output without reading it back afterwards.
+ * The last block is hashed when the source is closed.
+ *
+ * The returned source takes ownership of the wrapped source, which must
+ * already be opened for writing. Closing the returned source closes the
+ * wrapped source.
+ *
+ * @param source Opened output source
+ * @param hashes Hashes to store the block hashes in, which are not owned by the
+ * returned source and must outlive it
+ * @param startFrame Position of the first written frame in the whole output,
+ * which is not 0 for the segments of a render. This must be a multiple of the
+ * blocksize of the hashes.
+ * @return New sample source, or NULL if the source is not opened for writing
+ * or startFrame does not start a block. In that case, the caller retains
+ * ownership of the source.
+ */
+SampleSource newSampleSourceHasher(SampleSource source, OutputHashes hashes,
+                                   unsigned long startFrame);
+
+#endif
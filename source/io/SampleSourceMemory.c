@@ -0,0 +1,475 @@
+//
+// SampleSourceMemory.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SampleSourceMemory.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const SampleCount kSampleSourceMemoryChunkFrames = 16384;
+
+// All streams which can currently be opened by name. The registry is only
+// locked while streams are looked up, added or removed, so a spin lock is
+// enough here.
+static SampleSourceMemoryStream *_memoryStreams = NULL;
+static unsigned int _numMemoryStreams = 0;
+static unsigned int _memoryStreamsCapacity = 0;
+static volatile unsigned int _memoryStreamsLock = 0;
+
+static void _lockMemoryStreams(void) {
+  while (!atomicCompareAndSwap(&_memoryStreamsLock, 0, 1)) {
+  }
+}
+
+static void _unlockMemoryStreams(void) { atomicStore(&_memoryStreamsLock, 0); }
+
+boolByte sampleSourceIsMemoryName(const CharString sampleSourceName) {
+  return (boolByte)(sampleSourceName != NULL &&
+                    strncmp(sampleSourceName->data, SAMPLE_SOURCE_MEMORY_PREFIX,
+                            strlen(SAMPLE_SOURCE_MEMORY_PREFIX)) == 0);
+}
+
+static SampleSourceMemoryStream _newMemoryStream(const CharString name) {
+  SampleSourceMemoryStream stream = (SampleSourceMemoryStream)malloc(
+      sizeof(SampleSourceMemoryStreamMembers));
+
+  stream->name = newCharString();
+  charStringCopy(stream->name, name);
+  stream->numChannels = getNumChannels();
+  stream->sampleRate = getSampleRate();
+  stream->chunks = NULL;
+  stream->numChunks = 0;
+  stream->chunksCapacity = 0;
+  stream->numFrames = 0;
+  stream->finished = false;
+  stream->references = 1;
+  stream->mutex = newMutex();
+  stream->dataAvailable = newSemaphore(0);
+  stream->numWaiting = 0;
+  return stream;
+}
+
+static void _retainMemoryStream(SampleSourceMemoryStream stream) {
+  mutexLock(stream->mutex);
+  stream->references++;
+  mutexUnlock(stream->mutex);
+}
+
+static void _releaseMemoryStream(SampleSourceMemoryStream stream) {
+  unsigned long i;
+  unsigned int references;
+
+  mutexLock(stream->mutex);
+  references = --stream->references;
+  mutexUnlock(stream->mutex);
+
+  if (references > 0) {
+    return;
+  }
+
+  for (i = 0; i < stream->numChunks; i++) {
+    free(stream->chunks[i]);
+  }
+
+  free(stream->chunks);
+  freeCharString(stream->name);
+  freeMutex(stream->mutex);
+  freeSemaphore(stream->dataAvailable);
+  free(stream);
+}
+
+// Must be called with the stream's mutex locked
+static void _wakeMemoryStreamReaders(SampleSourceMemoryStream stream) {
+  while (stream->numWaiting > 0) {
+    stream->numWaiting--;
+    semaphorePost(stream->dataAvailable);
+  }
+}
+
+// Must be called with the registry locked
+static int _findMemoryStream(const CharString name) {
+  unsigned int i;
+
+  for (i = 0; i < _numMemoryStreams; i++) {
+    if (charStringIsEqualTo(_memoryStreams[i]->name, name, false)) {
+      return (int)i;
+    }
+  }
+
+  return -1;
+}
+
+static void _registerMemoryStream(SampleSourceMemoryStream stream) {
+  SampleSourceMemoryStream replaced = NULL;
+  int index;
+
+  _lockMemoryStreams();
+  index = _findMemoryStream(stream->name);
+
+  if (index >= 0) {
+    // Sources which are still reading the old stream keep it alive
+    replaced = _memoryStreams[index];
+    _memoryStreams[index] = stream;
+  } else {
+    if (_numMemoryStreams == _memoryStreamsCapacity) {
+      _memoryStreamsCapacity =
+          _memoryStreamsCapacity == 0 ? 8 : _memoryStreamsCapacity * 2;
+      _memoryStreams = (SampleSourceMemoryStream *)realloc(
+          _memoryStreams,
+          sizeof(SampleSourceMemoryStream) * _memoryStreamsCapacity);
+    }
+
+    _memoryStreams[_numMemoryStreams++] = stream;
+  }
+
+  // The registry's reference
+  _retainMemoryStream(stream);
+  _unlockMemoryStreams();
+
+  if (replaced != NULL) {
+    logDebug("Replacing memory stream '%s'", replaced->name->data);
+    _releaseMemoryStream(replaced);
+  }
+}
+
+static SampleSourceMemoryStream _openMemoryStream(const CharString name) {
+  SampleSourceMemoryStream stream = NULL;
+  int index;
+
+  _lockMemoryStreams();
+  index = _findMemoryStream(name);
+
+  if (index >= 0) {
+    stream = _memoryStreams[index];
+    _retainMemoryStream(stream);
+  }
+
+  _unlockMemoryStreams();
+  return stream;
+}
+
+boolByte sampleSourceMemoryRemove(const CharString sampleSourceName) {
+  SampleSourceMemoryStream stream = NULL;
+  int index;
+
+  _lockMemoryStreams();
+  index = _findMemoryStream(sampleSourceName);
+
+  if (index >= 0) {
+    stream = _memoryStreams[index];
+    _memoryStreams[index] = _memoryStreams[--_numMemoryStreams];
+  }
+
+  _unlockMemoryStreams();
+
+  if (stream == NULL) {
+    return false;
+  }
+
+  logDebug("Removed memory stream '%s' with %lu frames", stream->name->data,
+           stream->numFrames);
+  _releaseMemoryStream(stream);
+  return true;
+}
+
+void sampleSourceMemoryRemoveAll(void) {
+  SampleSourceMemoryStream *streams;
+  unsigned int numStreams;
+  unsigned int i;
+
+  _lockMemoryStreams();
+  streams = _memoryStreams;
+  numStreams = _numMemoryStreams;
+  _memoryStreams = NULL;
+  _numMemoryStreams = 0;
+  _memoryStreamsCapacity = 0;
+  _unlockMemoryStreams();
+
+  for (i = 0; i < numStreams; i++) {
+    _releaseMemoryStream(streams[i]);
+  }
+
+  free(streams);
+}
+
+static boolByte _openSampleSourceMemory(void *sampleSourcePtr,
+                                        const SampleSourceOpenAs openAs) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceMemoryData extraData = (SampleSourceMemoryData)self->extraData;
+
+  if (openAs == SAMPLE_SOURCE_OPEN_READ) {
+    extraData->stream = _openMemoryStream(self->sourceName);
+
+    if (extraData->stream == NULL) {
+      logError("Memory stream '%s' has not been written",
+               self->sourceName->data);
+      return false;
+    }
+
+    if (!setNumChannels(extraData->stream->numChannels) ||
+        !setSampleRate(extraData->stream->sampleRate)) {
+      _releaseMemoryStream(extraData->stream);
+      extraData->stream = NULL;
+      return false;
+    }
+  } else if (openAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    extraData->stream = _newMemoryStream(self->sourceName);
+    extraData->isWriter = true;
+    _registerMemoryStream(extraData->stream);
+  } else {
+    logInternalError("Invalid type for openAs in memory source");
+    return false;
+  }
+
+  extraData->position = 0;
+  self->openedAs = openAs;
+  return true;
+}
+
+static boolByte _readBlockFromMemory(void *sampleSourcePtr,
+                                     SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceMemoryData extraData = (SampleSourceMemoryData)self->extraData;
+  SampleSourceMemoryStream stream = extraData->stream;
+  const SampleCount originalBlocksize = sampleBuffer->blocksize;
+  SampleCount numFrames = 0;
+  SampleCount chunkOffset;
+  SampleCount chunkFrames;
+  ChannelCount numChannels;
+  ChannelCount i;
+  Sample *chunk;
+
+  if (stream == NULL) {
+    return false;
+  }
+
+  numChannels = sampleBuffer->numChannels < stream->numChannels
+                    ? sampleBuffer->numChannels
+                    : stream->numChannels;
+  mutexLock(stream->mutex);
+
+  // Follow a stream which is still being written, until it has enough data
+  while (!stream->finished &&
+         stream->numFrames < extraData->position + originalBlocksize) {
+    stream->numWaiting++;
+    mutexUnlock(stream->mutex);
+    semaphoreWait(stream->dataAvailable);
+    mutexLock(stream->mutex);
+  }
+
+  while (numFrames < originalBlocksize &&
+         extraData->position < stream->numFrames) {
+    chunk = stream->chunks[extraData->position /
+                           kSampleSourceMemoryChunkFrames];
+    chunkOffset = extraData->position % kSampleSourceMemoryChunkFrames;
+    chunkFrames = kSampleSourceMemoryChunkFrames - chunkOffset;
+
+    if (chunkFrames > originalBlocksize - numFrames) {
+      chunkFrames = originalBlocksize - numFrames;
+    }
+
+    if (chunkFrames > stream->numFrames - extraData->position) {
+      chunkFrames = stream->numFrames - extraData->position;
+    }
+
+    for (i = 0; i < numChannels; i++) {
+      memcpy(sampleBuffer->samples[i] + numFrames,
+             chunk + i * kSampleSourceMemoryChunkFrames + chunkOffset,
+             sizeof(Sample) * chunkFrames);
+    }
+
+    numFrames += chunkFrames;
+    extraData->position += chunkFrames;
+  }
+
+  mutexUnlock(stream->mutex);
+
+  for (i = numChannels; i < sampleBuffer->numChannels; i++) {
+    memset(sampleBuffer->samples[i], 0, sizeof(Sample) * numFrames);
+  }
+
+  sampleBuffer->blocksize = numFrames;
+  self->numSamplesProcessed += numFrames * sampleBuffer->numChannels;
+  logDebugFast("Read %d frames from memory stream", numFrames);
+  return (boolByte)(numFrames == originalBlocksize);
+}
+
+static boolByte _writeBlockToMemory(void *sampleSourcePtr,
+                                    const SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceMemoryData extraData = (SampleSourceMemoryData)self->extraData;
+  SampleSourceMemoryStream stream = extraData->stream;
+  SampleCount numFrames = 0;
+  SampleCount chunkOffset;
+  SampleCount chunkFrames;
+  ChannelCount i;
+
+  if (stream == NULL) {
+    return false;
+  } else if (sampleBuffer->numChannels != stream->numChannels) {
+    logError("Cannot change the channel count of memory stream '%s'",
+             self->sourceName->data);
+    return false;
+  }
+
+  mutexLock(stream->mutex);
+
+  while (numFrames < sampleBuffer->blocksize) {
+    chunkOffset = stream->numFrames % kSampleSourceMemoryChunkFrames;
+
+    if (chunkOffset == 0 &&
+        stream->numFrames / kSampleSourceMemoryChunkFrames ==
+            stream->numChunks) {
+      if (stream->numChunks == stream->chunksCapacity) {
+        stream->chunksCapacity =
+            stream->chunksCapacity == 0 ? 16 : stream->chunksCapacity * 2;
+        stream->chunks = (Sample **)realloc(
+            stream->chunks, sizeof(Sample *) * stream->chunksCapacity);
+      }
+
+      stream->chunks[stream->numChunks++] =
+          (Sample *)malloc(sizeof(Sample) * kSampleSourceMemoryChunkFrames *
+                           stream->numChannels);
+    }
+
+    chunkFrames = kSampleSourceMemoryChunkFrames - chunkOffset;
+
+    if (chunkFrames > sampleBuffer->blocksize - numFrames) {
+      chunkFrames = sampleBuffer->blocksize - numFrames;
+    }
+
+    for (i = 0; i < stream->numChannels; i++) {
+      memcpy(stream->chunks[stream->numChunks - 1] +
+                 i * kSampleSourceMemoryChunkFrames + chunkOffset,
+             sampleBuffer->samples[i] + numFrames,
+             sizeof(Sample) * chunkFrames);
+    }
+
+    numFrames += chunkFrames;
+    stream->numFrames += chunkFrames;
+  }
+
+  _wakeMemoryStreamReaders(stream);
+  mutexUnlock(stream->mutex);
+
+  self->numSamplesProcessed += numFrames * sampleBuffer->numChannels;
+  logDebugFast("Wrote %d frames to memory stream", numFrames);
+  return true;
+}
+
+static boolByte _seekSampleSourceMemory(void *sampleSourcePtr,
+                                        unsigned long frame) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceMemoryData extraData = (SampleSourceMemoryData)self->extraData;
+  boolByte result;
+
+  if (extraData->stream == NULL ||
+      self->openedAs != SAMPLE_SOURCE_OPEN_READ) {
+    return false;
+  }
+
+  // Frames which have not been written yet can still be seeked to, and are
+  // waited for when reading
+  mutexLock(extraData->stream->mutex);
+  result = (boolByte)(!extraData->stream->finished ||
+                      frame <= extraData->stream->numFrames);
+  mutexUnlock(extraData->stream->mutex);
+
+  if (result) {
+    extraData->position = frame;
+  }
+
+  return result;
+}
+
+static void _closeSampleSourceMemory(void *sampleSourcePtr) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceMemoryData extraData = (SampleSourceMemoryData)self->extraData;
+  SampleSourceMemoryStream stream = extraData->stream;
+
+  if (stream == NULL) {
+    return;
+  }
+
+  if (extraData->isWriter) {
+    mutexLock(stream->mutex);
+    stream->finished = true;
+    _wakeMemoryStreamReaders(stream);
+    mutexUnlock(stream->mutex);
+    logDebug("Finished memory stream '%s' with %lu frames", stream->name->data,
+             stream->numFrames);
+  }
+
+  _releaseMemoryStream(stream);
+  extraData->stream = NULL;
+}
+
+static void _freeSampleSourceDataMemory(void *extraDataPtr) {
+  SampleSourceMemoryData extraData = (SampleSourceMemoryData)extraDataPtr;
+
+  // A writer which was never closed must not leave its readers waiting
+  if (extraData->stream != NULL && extraData->isWriter) {
+    mutexLock(extraData->stream->mutex);
+    extraData->stream->finished = true;
+    _wakeMemoryStreamReaders(extraData->stream);
+    mutexUnlock(extraData->stream->mutex);
+  }
+
+  if (extraData->stream != NULL) {
+    _releaseMemoryStream(extraData->stream);
+  }
+
+  free(extraData);
+}
+
+SampleSource _newSampleSourceMemory(const CharString sampleSourceName) {
+  SampleSource sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  SampleSourceMemoryData extraData =
+      (SampleSourceMemoryData)malloc(sizeof(SampleSourceMemoryDataMembers));
+
+  sampleSource->sampleSourceType = SAMPLE_SOURCE_TYPE_MEMORY;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, sampleSourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceMemory;
+  sampleSource->readSampleBlock = _readBlockFromMemory;
+  sampleSource->writeSampleBlock = _writeBlockToMemory;
+  sampleSource->seekSampleSource = _seekSampleSourceMemory;
+  sampleSource->closeSampleSource = _closeSampleSourceMemory;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataMemory;
+
+  extraData->stream = NULL;
+  extraData->position = 0;
+  extraData->isWriter = false;
+
+  sampleSource->extraData = extraData;
+  return sampleSource;
+}
@@ -0,0 +1,95 @@
+//
+// SampleSourceMemory.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_SampleSourceMemory_h
+#define MrsWatson_SampleSourceMemory_h
+
+#include "base/Thread.h"
+#include "io/SampleSource.h"
+
+// Sources with this prefix are kept in memory instead of being written to a
+// file, so that one job in the process can read the output of another without
+// encoding it. Writing to "mem://name" creates a stream which any number of
+// sources named "mem://name" may then read, even while it is still being
+// written to.
+#define SAMPLE_SOURCE_MEMORY_PREFIX "mem://"
+
+typedef struct {
+  CharString name;
+  ChannelCount numChannels;
+  SampleRate sampleRate;
+
+  // Audio is stored in chunks of a fixed number of frames, with the channels
+  // of each chunk following each other. Growing the stream only adds chunks,
+  // so samples which were already written are never copied again.
+  Sample **chunks;
+  unsigned long numChunks;
+  unsigned long chunksCapacity;
+  SampleCount numFrames;
+  // Set once the writer has closed the stream
+  boolByte finished;
+  // Number of sources using the stream, plus one while it is registered
+  unsigned int references;
+
+  // Guards all of the above. Readers which wait for more data are counted in
+  // numWaiting, and dataAvailable is posted once for each of them whenever
+  // data is added or the stream is finished.
+  Mutex mutex;
+  Semaphore dataAvailable;
+  unsigned int numWaiting;
+} SampleSourceMemoryStreamMembers;
+typedef SampleSourceMemoryStreamMembers *SampleSourceMemoryStream;
+
+typedef struct {
+  SampleSourceMemoryStream stream;
+  // Next frame to read
+  SampleCount position;
+  // True if this source writes the stream
+  boolByte isWriter;
+} SampleSourceMemoryDataMembers;
+typedef SampleSourceMemoryDataMembers *SampleSourceMemoryData;
+
+/**
+ * @param sampleSourceName Name of a sample source
+ * @return True if the name refers to a memory stream rather than a file
+ */
+boolByte sampleSourceIsMemoryName(const CharString sampleSourceName);
+
+/**
+ * Remove a memory stream, so that its memory is released once all sources
+ * which are reading it have been freed. Later attempts to read the stream fail
+ * until another source writes it again.
+ * @param sampleSourceName Name of the stream, including the prefix
+ * @return True if the stream existed
+ */
+boolByte sampleSourceMemoryRemove(const CharString sampleSourceName);
+
+/**
+ * Remove all memory streams, as with sampleSourceMemoryRemove()
+ */
+void sampleSourceMemoryRemoveAll(void);
+
+#endif
@@ -0,0 +1,300 @@
+//
+// SampleSourceMp3.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#if USE_MP3
+
+#include "SampleSourceMp3.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static boolByte _openMp3Decoder(SampleSource self) {
+  SampleSourceMp3Data extraData = (SampleSourceMp3Data)self->extraData;
+  const long *rates;
+  size_t numRates;
+  size_t i;
+  long sampleRate;
+  int numChannels;
+  int encoding;
+  int error;
+
+  // This only sets up tables the first time, and is a no-op in libmpg123 1.27
+  // and newer
+  mpg123_init();
+  extraData->handle = mpg123_new(NULL, &error);
+
+  if (extraData->handle == NULL) {
+    logDebug("MP3 decoder could not be created: %s",
+             mpg123_plain_strerror(error));
+    return false;
+  }
+
+  // Only accept floating-point output, so that libmpg123 decodes straight to
+  // floats rather than rounding to 16-bit integers which are then converted
+  // back again. Gapless decoding is on by default, which trims the encoder
+  // delay and padding so that frame positions match the original audio.
+  mpg123_format_none(extraData->handle);
+  mpg123_rates(&rates, &numRates);
+
+  for (i = 0; i < numRates; i++) {
+    mpg123_format(extraData->handle, rates[i], MPG123_MONO | MPG123_STEREO,
+                  MPG123_ENC_FLOAT_32);
+  }
+
+  if (mpg123_open(extraData->handle, self->sourceName->data) != MPG123_OK ||
+      mpg123_getformat(extraData->handle, &sampleRate, &numChannels,
+                       &encoding) != MPG123_OK) {
+    logDebug("MP3 decoder could not be initialized: %s",
+             mpg123_strerror(extraData->handle));
+    return false;
+  }
+
+  extraData->numChannels = (ChannelCount)numChannels;
+  setNumChannels(extraData->numChannels);
+  setSampleRate((SampleRate)sampleRate);
+  logDebug("Opened MP3 file with %d channels at %ldHz for reading",
+           numChannels, sampleRate);
+  return true;
+}
+
+static boolByte _openSampleSourceMp3(void *selfPtr,
+                                     const SampleSourceOpenAs openAs) {
+  SampleSource self = (SampleSource)selfPtr;
+
+  if (openAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    logUnsupportedFeature("Writing MP3 files");
+    return false;
+  } else if (openAs != SAMPLE_SOURCE_OPEN_READ) {
+    logInternalError("Invalid type for openAs in MP3 file");
+    return false;
+  }
+
+  if (!_openMp3Decoder(self)) {
+    logError("MP3 file '%s' could not be opened for reading",
+             self->sourceName->data);
+    self->closeSampleSource(self);
+    return false;
+  }
+
+  self->openedAs = openAs;
+  return true;
+}
+
+static boolByte _decodeMp3Frame(SampleSource self) {
+  SampleSourceMp3Data extraData = (SampleSourceMp3Data)self->extraData;
+  unsigned char *audio = NULL;
+  size_t numBytes = 0;
+  off_t frameNumber;
+  long sampleRate;
+  int numChannels;
+  int encoding;
+  int result;
+
+  extraData->decodedFrames = 0;
+  extraData->decodedPosition = 0;
+  result = mpg123_decode_frame(extraData->handle, &frameNumber, &audio,
+                               &numBytes);
+
+  if (result == MPG123_NEW_FORMAT) {
+    mpg123_getformat(extraData->handle, &sampleRate, &numChannels, &encoding);
+
+    if ((ChannelCount)numChannels != extraData->numChannels) {
+      logError("MP3 file '%s' changes from %d to %d channels, which is not "
+               "supported",
+               self->sourceName->data, extraData->numChannels, numChannels);
+      extraData->endOfStream = true;
+      return false;
+    }
+
+    // The new format is announced before the frame is decoded
+    return true;
+  } else if (result == MPG123_DONE) {
+    extraData->endOfStream = true;
+    return false;
+  } else if (result != MPG123_OK) {
+    logError("Error decoding MP3 file: %s",
+             mpg123_strerror(extraData->handle));
+    extraData->endOfStream = true;
+    return false;
+  }
+
+  extraData->decodedSamples = (const float *)audio;
+  extraData->decodedFrames =
+      numBytes / (sizeof(float) * extraData->numChannels);
+  return true;
+}
+
+static boolByte _readBlockFromMp3File(void *selfPtr,
+                                      SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceMp3Data extraData = (SampleSourceMp3Data)self->extraData;
+  const ChannelCount numChannels = extraData->numChannels;
+  SampleCount framesRead = 0;
+  SampleCount framesToCopy;
+  const float *decoded;
+  ChannelCount channel;
+  SampleCount i;
+
+  while (framesRead < sampleBuffer->blocksize) {
+    if (extraData->decodedPosition >= extraData->decodedFrames) {
+      if (extraData->endOfStream || !_decodeMp3Frame(self)) {
+        break;
+      }
+
+      continue;
+    }
+
+    framesToCopy = extraData->decodedFrames - extraData->decodedPosition;
+
+    if (framesToCopy > sampleBuffer->blocksize - framesRead) {
+      framesToCopy = sampleBuffer->blocksize - framesRead;
+    }
+
+    decoded = extraData->decodedSamples +
+              extraData->decodedPosition * numChannels;
+
+    for (channel = 0; channel < sampleBuffer->numChannels; channel++) {
+      Sample *samples = sampleBuffer->samples[channel] + framesRead;
+
+      if (channel >= numChannels) {
+        memset(samples, 0, sizeof(Sample) * framesToCopy);
+        continue;
+      }
+
+      for (i = 0; i < framesToCopy; i++) {
+        samples[i] = (Sample)decoded[i * numChannels + channel];
+      }
+    }
+
+    extraData->decodedPosition += framesToCopy;
+    framesRead += framesToCopy;
+  }
+
+  self->numSamplesProcessed += framesRead * sampleBuffer->numChannels;
+
+  if (framesRead < sampleBuffer->blocksize) {
+    logDebug("End of MP3 file reached");
+    sampleBuffer->blocksize = framesRead;
+    return false;
+  }
+
+  return true;
+}
+
+static boolByte _writeBlockToMp3File(void *selfPtr,
+                                     const SampleBuffer sampleBuffer) {
+  logUnsupportedFeature("Writing MP3 files");
+  return false;
+}
+
+static boolByte _seekSampleSourceMp3(void *selfPtr, unsigned long frame) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceMp3Data extraData = (SampleSourceMp3Data)self->extraData;
+
+  if (extraData->handle == NULL) {
+    return false;
+  }
+
+  if (!extraData->seekIndexComplete) {
+    // Without a complete index, libmpg123 has to guess the position of frames
+    // which it has not decoded yet from the bitrate, which is not exact for
+    // files with a variable bitrate
+    if (mpg123_scan(extraData->handle) != MPG123_OK) {
+      logDebug("Could not scan '%s' for seeking: %s", self->sourceName->data,
+               mpg123_strerror(extraData->handle));
+    }
+
+    extraData->seekIndexComplete = true;
+  }
+
+  // Seeking jumps to the MPEG frame before the target from the index, and
+  // then decodes and drops samples up to the exact frame which was requested
+  extraData->decodedFrames = 0;
+  extraData->decodedPosition = 0;
+  extraData->endOfStream = false;
+
+  if (mpg123_seek(extraData->handle, (off_t)frame, SEEK_SET) < 0) {
+    logDebug("Could not seek to frame %lu of '%s': %s", frame,
+             self->sourceName->data, mpg123_strerror(extraData->handle));
+    return false;
+  }
+
+  return true;
+}
+
+static void _closeSampleSourceMp3(void *selfPtr) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceMp3Data extraData = (SampleSourceMp3Data)self->extraData;
+
+  if (extraData->handle != NULL) {
+    mpg123_close(extraData->handle);
+    mpg123_delete(extraData->handle);
+    extraData->handle = NULL;
+  }
+
+  extraData->decodedSamples = NULL;
+  extraData->decodedFrames = 0;
+  extraData->decodedPosition = 0;
+}
+
+static void _freeSampleSourceDataMp3(void *extraDataPtr) {
+  free(extraDataPtr);
+}
+
+SampleSource _newSampleSourceMp3(const CharString sampleSourceName) {
+  SampleSource sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  SampleSourceMp3Data extraData =
+      (SampleSourceMp3Data)malloc(sizeof(SampleSourceMp3DataMembers));
+
+  sampleSource->sampleSourceType = SAMPLE_SOURCE_TYPE_MP3;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, sampleSourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceMp3;
+  sampleSource->readSampleBlock = _readBlockFromMp3File;
+  sampleSource->writeSampleBlock = _writeBlockToMp3File;
+  sampleSource->seekSampleSource = _seekSampleSourceMp3;
+  sampleSource->closeSampleSource = _closeSampleSourceMp3;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataMp3;
+
+  extraData->handle = NULL;
+  extraData->numChannels = 0;
+  extraData->decodedSamples = NULL;
+  extraData->decodedFrames = 0;
+  extraData->decodedPosition = 0;
+  extraData->endOfStream = false;
+  extraData->seekIndexComplete = false;
+
+  sampleSource->extraData = extraData;
+  return sampleSource;
+}
+
+#endif
@@ -0,0 +1,54 @@
+//
+// SampleSourceMp3.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#if USE_MP3
+
+#ifndef MrsWatson_SampleSourceMp3_h
+#define MrsWatson_SampleSourceMp3_h
+
+#include "io/SampleSource.h"
+
+#include <mpg123.h>
+
+typedef struct {
+  mpg123_handle *handle;
+  ChannelCount numChannels;
+
+  // Interleaved floating-point samples of the last decoded MPEG frame. These
+  // are owned by libmpg123 and stay valid until the next frame is decoded.
+  const float *decodedSamples;
+  SampleCount decodedFrames;
+  SampleCount decodedPosition;
+  boolByte endOfStream;
+
+  // libmpg123 only learns where each MPEG frame starts while decoding, so the
+  // whole file is scanned to complete its seek index before the first seek.
+  // Files which are only read from start to end never pay for the scan.
+  boolByte seekIndexComplete;
+} SampleSourceMp3DataMembers;
+typedef SampleSourceMp3DataMembers *SampleSourceMp3Data;
+
+#endif
+#endif
@@ -0,0 +1,336 @@
+//
+// SampleSourceOgg.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#if USE_OGG
+
+#include "SampleSourceOgg.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static boolByte _openOggOpusDecoder(SampleSource self) {
+  SampleSourceOggData extraData = (SampleSourceOggData)self->extraData;
+  int error;
+
+  extraData->opusFile = op_open_file(self->sourceName->data, &error);
+
+  if (extraData->opusFile == NULL) {
+    // This is also how Vorbis files are told apart from Opus files
+    return false;
+  }
+
+  extraData->numChannels = (ChannelCount)op_channel_count(extraData->opusFile,
+                                                          -1);
+  extraData->opusBuffer = (float *)malloc(
+      sizeof(float) * kSampleSourceOggOpusDecodeFrames *
+      extraData->numChannels);
+  setNumChannels(extraData->numChannels);
+  setSampleRate((SampleRate)kSampleSourceOggOpusSampleRate);
+  logDebug("Opened Opus file with %d channels for reading",
+           extraData->numChannels);
+  return true;
+}
+
+static boolByte _openOggVorbisDecoder(SampleSource self) {
+  SampleSourceOggData extraData = (SampleSourceOggData)self->extraData;
+  vorbis_info *info;
+  int error;
+
+  extraData->vorbisFile = (OggVorbis_File *)malloc(sizeof(OggVorbis_File));
+  error = ov_fopen(self->sourceName->data, extraData->vorbisFile);
+
+  if (error != 0) {
+    logDebug("Ogg Vorbis decoder could not be initialized, error %d", error);
+    free(extraData->vorbisFile);
+    extraData->vorbisFile = NULL;
+    return false;
+  }
+
+  info = ov_info(extraData->vorbisFile, -1);
+  extraData->numChannels = (ChannelCount)info->channels;
+  setNumChannels(extraData->numChannels);
+  setSampleRate((SampleRate)info->rate);
+  logDebug("Opened Ogg Vorbis file with %d channels at %ldHz for reading",
+           info->channels, info->rate);
+  return true;
+}
+
+static boolByte _openSampleSourceOgg(void *selfPtr,
+                                     const SampleSourceOpenAs openAs) {
+  SampleSource self = (SampleSource)selfPtr;
+
+  if (openAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    logUnsupportedFeature("Writing Ogg files");
+    return false;
+  } else if (openAs != SAMPLE_SOURCE_OPEN_READ) {
+    logInternalError("Invalid type for openAs in Ogg file");
+    return false;
+  }
+
+  if (!_openOggOpusDecoder(self) && !_openOggVorbisDecoder(self)) {
+    logError("Ogg file '%s' could not be opened for reading, it must contain "
+             "Vorbis or Opus audio",
+             self->sourceName->data);
+    self->closeSampleSource(self);
+    return false;
+  }
+
+  self->openedAs = openAs;
+  return true;
+}
+
+static boolByte _checkOggChannels(SampleSource self, int numChannels) {
+  SampleSourceOggData extraData = (SampleSourceOggData)self->extraData;
+
+  // Chained streams may change their format at each link
+  if ((ChannelCount)numChannels != extraData->numChannels) {
+    logError("Ogg file '%s' changes from %d to %d channels, which is not "
+             "supported",
+             self->sourceName->data, extraData->numChannels, numChannels);
+    return false;
+  }
+
+  return true;
+}
+
+static boolByte _decodeOggPacket(SampleSource self) {
+  SampleSourceOggData extraData = (SampleSourceOggData)self->extraData;
+  int link;
+  long result;
+
+  extraData->decodedFrames = 0;
+  extraData->decodedPosition = 0;
+
+  if (extraData->opusFile != NULL) {
+    result = op_read_float(
+        extraData->opusFile, extraData->opusBuffer,
+        kSampleSourceOggOpusDecodeFrames * (int)extraData->numChannels, &link);
+
+    if (result > 0 &&
+        !_checkOggChannels(self,
+                           op_channel_count(extraData->opusFile, link))) {
+      result = 0;
+    } else if (result == OP_HOLE) {
+      logWarn("Ogg file '%s' has missing or corrupt data",
+              self->sourceName->data);
+      return true;
+    }
+  } else {
+    result =
+        ov_read_float(extraData->vorbisFile, &extraData->vorbisSamples,
+                      kSampleSourceOggVorbisDecodeFrames, &link);
+
+    if (result > 0 &&
+        !_checkOggChannels(self,
+                           ov_info(extraData->vorbisFile, link)->channels)) {
+      result = 0;
+    } else if (result == OV_HOLE) {
+      logWarn("Ogg file '%s' has missing or corrupt data",
+              self->sourceName->data);
+      return true;
+    }
+  }
+
+  if (result < 0) {
+    logError("Error decoding Ogg file '%s', error %ld", self->sourceName->data,
+             result);
+  }
+
+  if (result <= 0) {
+    extraData->endOfStream = true;
+    return false;
+  }
+
+  extraData->decodedFrames = (SampleCount)result;
+  return true;
+}
+
+static void _copyOggSamples(SampleSourceOggData extraData,
+                            SampleBuffer sampleBuffer, SampleCount offset,
+                            SampleCount numFrames) {
+  const ChannelCount numChannels = extraData->numChannels;
+  const SampleCount position = extraData->decodedPosition;
+  const float *decoded;
+  ChannelCount channel;
+  SampleCount i;
+
+  for (channel = 0; channel < sampleBuffer->numChannels; channel++) {
+    Sample *samples = sampleBuffer->samples[channel] + offset;
+
+    if (channel >= numChannels) {
+      memset(samples, 0, sizeof(Sample) * numFrames);
+    } else if (extraData->opusFile != NULL) {
+      decoded = extraData->opusBuffer + position * numChannels + channel;
+
+      for (i = 0; i < numFrames; i++) {
+        samples[i] = (Sample)decoded[i * numChannels];
+      }
+    } else {
+      decoded = extraData->vorbisSamples[channel] + position;
+
+      for (i = 0; i < numFrames; i++) {
+        samples[i] = (Sample)decoded[i];
+      }
+    }
+  }
+}
+
+static boolByte _readBlockFromOggFile(void *selfPtr,
+                                      SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceOggData extraData = (SampleSourceOggData)self->extraData;
+  SampleCount framesRead = 0;
+  SampleCount framesToCopy;
+
+  while (framesRead < sampleBuffer->blocksize) {
+    if (extraData->decodedPosition >= extraData->decodedFrames) {
+      if (extraData->endOfStream || !_decodeOggPacket(self)) {
+        break;
+      }
+
+      continue;
+    }
+
+    framesToCopy = extraData->decodedFrames - extraData->decodedPosition;
+
+    if (framesToCopy > sampleBuffer->blocksize - framesRead) {
+      framesToCopy = sampleBuffer->blocksize - framesRead;
+    }
+
+    _copyOggSamples(extraData, sampleBuffer, framesRead, framesToCopy);
+    extraData->decodedPosition += framesToCopy;
+    framesRead += framesToCopy;
+  }
+
+  self->numSamplesProcessed += framesRead * sampleBuffer->numChannels;
+
+  if (framesRead < sampleBuffer->blocksize) {
+    logDebug("End of Ogg file reached");
+    sampleBuffer->blocksize = framesRead;
+    return false;
+  }
+
+  return true;
+}
+
+static boolByte _writeBlockToOggFile(void *selfPtr,
+                                     const SampleBuffer sampleBuffer) {
+  logUnsupportedFeature("Writing Ogg files");
+  return false;
+}
+
+static boolByte _seekSampleSourceOgg(void *selfPtr, unsigned long frame) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceOggData extraData = (SampleSourceOggData)self->extraData;
+  int result;
+
+  // Every Ogg page is stamped with the position of its last sample, so both
+  // libraries find the page before the target by bisecting the file, and then
+  // decode and drop samples up to the exact frame. No index is needed.
+  if (extraData->opusFile != NULL) {
+    result = op_pcm_seek(extraData->opusFile, (ogg_int64_t)frame);
+  } else if (extraData->vorbisFile != NULL) {
+    result = ov_pcm_seek(extraData->vorbisFile, (ogg_int64_t)frame);
+  } else {
+    return false;
+  }
+
+  extraData->decodedFrames = 0;
+  extraData->decodedPosition = 0;
+  extraData->endOfStream = false;
+
+  if (result != 0) {
+    logDebug("Could not seek to frame %lu of '%s', error %d", frame,
+             self->sourceName->data, result);
+    return false;
+  }
+
+  return true;
+}
+
+static void _closeSampleSourceOgg(void *selfPtr) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceOggData extraData = (SampleSourceOggData)self->extraData;
+
+  if (extraData->opusFile != NULL) {
+    op_free(extraData->opusFile);
+    extraData->opusFile = NULL;
+  }
+
+  if (extraData->vorbisFile != NULL) {
+    ov_clear(extraData->vorbisFile);
+    free(extraData->vorbisFile);
+    extraData->vorbisFile = NULL;
+  }
+
+  free(extraData->opusBuffer);
+  extraData->opusBuffer = NULL;
+  extraData->vorbisSamples = NULL;
+  extraData->decodedFrames = 0;
+  extraData->decodedPosition = 0;
+}
+
+static void _freeSampleSourceDataOgg(void *extraDataPtr) {
+  SampleSourceOggData extraData = (SampleSourceOggData)extraDataPtr;
+  free(extraData->opusBuffer);
+  free(extraData);
+}
+
+SampleSource _newSampleSourceOgg(const CharString sampleSourceName) {
+  SampleSource sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  SampleSourceOggData extraData =
+      (SampleSourceOggData)malloc(sizeof(SampleSourceOggDataMembers));
+
+  sampleSource->sampleSourceType = SAMPLE_SOURCE_TYPE_OGG;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, sampleSourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceOgg;
+  sampleSource->readSampleBlock = _readBlockFromOggFile;
+  sampleSource->writeSampleBlock = _writeBlockToOggFile;
+  sampleSource->seekSampleSource = _seekSampleSourceOgg;
+  sampleSource->closeSampleSource = _closeSampleSourceOgg;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataOgg;
+
+  extraData->vorbisFile = NULL;
+  extraData->opusFile = NULL;
+  extraData->numChannels = 0;
+  extraData->vorbisSamples = NULL;
+  extraData->opusBuffer = NULL;
+  extraData->decodedFrames = 0;
+  extraData->decodedPosition = 0;
+  extraData->endOfStream = false;
+
+  sampleSource->extraData = extraData;
+  return sampleSource;
+}
+
+#endif
@@ -0,0 +1,62 @@
+//
+// SampleSourceOgg.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#if USE_OGG
+
+#ifndef MrsWatson_SampleSourceOgg_h
+#define MrsWatson_SampleSourceOgg_h
+
+#include "io/SampleSource.h"
+
+#include <opusfile.h>
+#include <vorbis/vorbisfile.h>
+
+// Opus streams are always decoded at this rate, whatever the rate of the
+// original audio was
+static const long kSampleSourceOggOpusSampleRate = 48000;
+// Number of frames decoded from an Opus stream at once. This is the longest
+// packet which Opus allows, which is 120ms at 48kHz.
+static const int kSampleSourceOggOpusDecodeFrames = 5760;
+// Largest number of frames requested from libvorbisfile at once
+static const int kSampleSourceOggVorbisDecodeFrames = 4096;
+
+typedef struct {
+  // Only one of these is opened, depending on the codec of the file
+  OggVorbis_File *vorbisFile;
+  OggOpusFile *opusFile;
+  ChannelCount numChannels;
+
+  // Vorbis is decoded to planar floats which are owned by libvorbisfile, and
+  // Opus to interleaved floats in opusBuffer
+  float **vorbisSamples;
+  float *opusBuffer;
+  SampleCount decodedFrames;
+  SampleCount decodedPosition;
+  boolByte endOfStream;
+} SampleSourceOggDataMembers;
+typedef SampleSourceOggDataMembers *SampleSourceOggData;
+
+#endif
+#endif
@@ -0,0 +1,594 @@
+//
+// SampleSourcePacked.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "SampleSourcePacked.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The header holds the magic, version, channel count, sample rate, packet size,
+// number of frames, and the offset of the packet index. The last two are
+// written when the file is closed.
+#define PACKED_HEADER_SIZE 32
+#define PACKED_NUM_FRAMES_OFFSET 16
+// Each packet starts with its number of frames and the size of its payload
+#define PACKED_PACKET_HEADER_SIZE 8
+#define PACKED_INDEX_ENTRY_SIZE 8
+
+static const char *kSampleSourcePackedMagic = "MWPK";
+static const unsigned int kSampleSourcePackedVersion = 1;
+
+static void _packUnsigned(byte *data, unsigned long long value,
+                          size_t numBytes) {
+  size_t i;
+
+  for (i = 0; i < numBytes; i++) {
+    data[i] = (byte)(value >> (8 * i));
+  }
+}
+
+static unsigned long long _unpackUnsigned(const byte *data, size_t numBytes) {
+  unsigned long long value = 0;
+  size_t i;
+
+  for (i = 0; i < numBytes; i++) {
+    value |= (unsigned long long)data[i] << (8 * i);
+  }
+
+  return value;
+}
+
+static size_t _getMaxChannelSize(SampleCount numFrames) {
+  return (numFrames + 1) / 2 + numFrames * sizeof(uint32_t);
+}
+
+// Each sample is XOR'ed with the previous one in its channel, which leaves
+// zero bytes at both ends when neighboring samples are similar, or when they
+// were converted from 16 or 24-bit integers. A 4-bit tag holds how many zero
+// bytes were dropped from each end, and the remaining bytes of all samples
+// follow the tags of the channel.
+static size_t _encodeChannel(const Sample *samples, SampleCount numFrames,
+                             byte *output) {
+  const size_t tagsSize = (numFrames + 1) / 2;
+  byte *data = output + tagsSize;
+  uint32_t previous = 0;
+  uint32_t bits;
+  uint32_t value;
+  unsigned int trailing;
+  unsigned int numBytes;
+  SampleCount i;
+  float sample;
+
+  memset(output, 0, tagsSize);
+
+  for (i = 0; i < numFrames; i++) {
+    sample = (float)samples[i];
+    memcpy(&bits, &sample, sizeof(bits));
+    value = bits ^ previous;
+    previous = bits;
+
+    if (value == 0) {
+      trailing = 1;
+      numBytes = 0;
+    } else {
+      for (trailing = 0; (value & 0xff) == 0; trailing++) {
+        value >>= 8;
+      }
+
+      for (numBytes = 1; numBytes < 4 && (value >> (8 * numBytes)) != 0;
+           numBytes++) {
+      }
+    }
+
+    output[i / 2] |= (byte)(((4 - trailing - numBytes) | (trailing << 2))
+                            << (4 * (i % 2)));
+    _packUnsigned(data, value, numBytes);
+    data += numBytes;
+  }
+
+  return (size_t)(data - output);
+}
+
+static boolByte _decodeChannel(const byte *input, size_t inputSize,
+                               SampleCount numFrames, Sample *samples,
+                               size_t *outSize) {
+  const size_t tagsSize = (numFrames + 1) / 2;
+  size_t position = tagsSize;
+  uint32_t previous = 0;
+  unsigned int tag;
+  unsigned int leading;
+  unsigned int trailing;
+  unsigned int numBytes;
+  SampleCount i;
+  float sample;
+
+  if (tagsSize > inputSize) {
+    return false;
+  }
+
+  for (i = 0; i < numFrames; i++) {
+    tag = (input[i / 2] >> (4 * (i % 2))) & 0xf;
+    leading = tag & 3;
+    trailing = tag >> 2;
+
+    if (leading + trailing > 4 ||
+        position + (4 - leading - trailing) > inputSize) {
+      return false;
+    }
+
+    numBytes = 4 - leading - trailing;
+    previous ^= (uint32_t)_unpackUnsigned(input + position, numBytes)
+                << (8 * trailing);
+    position += numBytes;
+    memcpy(&sample, &previous, sizeof(sample));
+    samples[i] = (Sample)sample;
+  }
+
+  *outSize = position;
+  return true;
+}
+
+static void _allocatePacketBuffers(SampleSourcePackedData extraData) {
+  extraData->packetBuffer =
+      newSampleBuffer(extraData->numChannels, extraData->packetFrames);
+  extraData->encodedCapacity =
+      PACKED_PACKET_HEADER_SIZE +
+      extraData->numChannels * _getMaxChannelSize(extraData->packetFrames);
+  extraData->encodedPacket = (byte *)malloc(extraData->encodedCapacity);
+}
+
+static boolByte _readPackedIndex(SampleSourcePackedData extraData,
+                                 unsigned long long indexOffset) {
+  byte entry[PACKED_INDEX_ENTRY_SIZE];
+  unsigned long i;
+
+  extraData->numPackets =
+      (extraData->numFrames + extraData->packetFrames - 1) /
+      extraData->packetFrames;
+  extraData->packetsCapacity = extraData->numPackets;
+  extraData->packetOffsets = (unsigned long long *)malloc(
+      sizeof(unsigned long long) * (extraData->numPackets + 1));
+
+  if (fseek(extraData->fileHandle, (long)indexOffset, SEEK_SET) != 0) {
+    return false;
+  }
+
+  for (i = 0; i < extraData->numPackets; i++) {
+    if (fread(entry, 1, sizeof(entry), extraData->fileHandle) !=
+        sizeof(entry)) {
+      return false;
+    }
+
+    extraData->packetOffsets[i] = _unpackUnsigned(entry, sizeof(entry));
+  }
+
+  return (boolByte)(fseek(extraData->fileHandle, PACKED_HEADER_SIZE,
+                          SEEK_SET) == 0);
+}
+
+static boolByte _readPackedHeader(SampleSource self) {
+  SampleSourcePackedData extraData = (SampleSourcePackedData)self->extraData;
+  byte header[PACKED_HEADER_SIZE];
+  unsigned long long indexOffset;
+
+  if (fread(header, 1, sizeof(header), extraData->fileHandle) !=
+          sizeof(header) ||
+      memcmp(header, kSampleSourcePackedMagic, 4) != 0) {
+    logError("'%s' is not a packed audio file", self->sourceName->data);
+    return false;
+  } else if (_unpackUnsigned(header + 4, 2) != kSampleSourcePackedVersion) {
+    logError("Packed audio file '%s' has unsupported version %d",
+             self->sourceName->data, (int)_unpackUnsigned(header + 4, 2));
+    return false;
+  }
+
+  extraData->numChannels = (ChannelCount)_unpackUnsigned(header + 6, 2);
+  extraData->sampleRate = (unsigned int)_unpackUnsigned(header + 8, 4);
+  extraData->packetFrames = (SampleCount)_unpackUnsigned(header + 12, 4);
+  extraData->numFrames =
+      (unsigned long)_unpackUnsigned(header + PACKED_NUM_FRAMES_OFFSET, 8);
+  indexOffset = _unpackUnsigned(header + PACKED_NUM_FRAMES_OFFSET + 8, 8);
+
+  if (extraData->numChannels == 0 || extraData->packetFrames == 0) {
+    logError("Packed audio file '%s' has an invalid header",
+             self->sourceName->data);
+    return false;
+  }
+
+  // A file whose writer did not finish has no index, but its packets can
+  // still be read in order
+  extraData->hasIndex = (boolByte)(indexOffset > 0);
+
+  if (!extraData->hasIndex) {
+    logWarn("Packed audio file '%s' was not closed properly, it cannot seek",
+            self->sourceName->data);
+  } else if (!_readPackedIndex(extraData, indexOffset)) {
+    logError("Could not read index of packed audio file '%s'",
+             self->sourceName->data);
+    return false;
+  }
+
+  return true;
+}
+
+static boolByte _writePackedHeader(SampleSourcePackedData extraData) {
+  byte header[PACKED_HEADER_SIZE];
+
+  memset(header, 0, sizeof(header));
+  memcpy(header, kSampleSourcePackedMagic, 4);
+  _packUnsigned(header + 4, kSampleSourcePackedVersion, 2);
+  _packUnsigned(header + 6, extraData->numChannels, 2);
+  _packUnsigned(header + 8, extraData->sampleRate, 4);
+  _packUnsigned(header + 12, extraData->packetFrames, 4);
+  return (boolByte)(fwrite(header, 1, sizeof(header), extraData->fileHandle) ==
+                    sizeof(header));
+}
+
+static boolByte _openSampleSourcePacked(void *selfPtr,
+                                        const SampleSourceOpenAs openAs) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourcePackedData extraData = (SampleSourcePackedData)self->extraData;
+
+  if (openAs == SAMPLE_SOURCE_OPEN_READ) {
+    extraData->fileHandle = fopen(self->sourceName->data, "rb");
+
+    if (extraData->fileHandle != NULL) {
+      if (_readPackedHeader(self)) {
+        setNumChannels(extraData->numChannels);
+        setSampleRate(extraData->sampleRate);
+      } else {
+        fclose(extraData->fileHandle);
+        extraData->fileHandle = NULL;
+      }
+    }
+  } else if (openAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    extraData->fileHandle = fopen(self->sourceName->data, "wb");
+    extraData->numChannels = getNumChannels();
+    extraData->sampleRate = (unsigned int)getSampleRate();
+    extraData->packetFrames = getBlocksize();
+    extraData->hasIndex = true;
+
+    if (extraData->fileHandle != NULL &&
+        !_writePackedHeader(extraData)) {
+      fclose(extraData->fileHandle);
+      extraData->fileHandle = NULL;
+    }
+  } else {
+    logInternalError("Invalid type for openAs in packed audio file");
+    return false;
+  }
+
+  if (extraData->fileHandle == NULL) {
+    logError("Packed audio file '%s' could not be opened for %s",
+             self->sourceName->data,
+             openAs == SAMPLE_SOURCE_OPEN_READ ? "reading" : "writing");
+    return false;
+  }
+
+  _allocatePacketBuffers(extraData);
+  self->openedAs = openAs;
+  return true;
+}
+
+static boolByte _readPacket(SampleSource self) {
+  SampleSourcePackedData extraData = (SampleSourcePackedData)self->extraData;
+  byte *payload = extraData->encodedPacket + PACKED_PACKET_HEADER_SIZE;
+  SampleCount numFrames;
+  size_t payloadSize;
+  size_t position = 0;
+  size_t channelSize;
+  ChannelCount i;
+
+  extraData->packetBufferFrames = 0;
+  extraData->packetPosition = 0;
+
+  if ((extraData->hasIndex &&
+       extraData->nextPacket >= extraData->numPackets) ||
+      fread(extraData->encodedPacket, 1, PACKED_PACKET_HEADER_SIZE,
+            extraData->fileHandle) != PACKED_PACKET_HEADER_SIZE) {
+    return false;
+  }
+
+  numFrames = (SampleCount)_unpackUnsigned(extraData->encodedPacket, 4);
+  payloadSize = (size_t)_unpackUnsigned(extraData->encodedPacket + 4, 4);
+
+  if (numFrames > extraData->packetFrames ||
+      payloadSize > extraData->encodedCapacity - PACKED_PACKET_HEADER_SIZE ||
+      fread(payload, 1, payloadSize, extraData->fileHandle) != payloadSize) {
+    logError("Packet %lu of '%s' is corrupt", extraData->nextPacket,
+             self->sourceName->data);
+    return false;
+  }
+
+  for (i = 0; i < extraData->numChannels; i++) {
+    if (!_decodeChannel(payload + position, payloadSize - position, numFrames,
+                        extraData->packetBuffer->samples[i], &channelSize)) {
+      logError("Packet %lu of '%s' is corrupt", extraData->nextPacket,
+               self->sourceName->data);
+      return false;
+    }
+
+    position += channelSize;
+  }
+
+  extraData->packetBufferFrames = numFrames;
+  extraData->nextPacket++;
+  return true;
+}
+
+static boolByte _readBlockFromPackedFile(void *selfPtr,
+                                         SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourcePackedData extraData = (SampleSourcePackedData)self->extraData;
+  const SampleCount blocksize = sampleBuffer->blocksize;
+  SampleCount framesRead = 0;
+  SampleCount numFrames;
+
+  while (framesRead < blocksize) {
+    if (extraData->packetPosition >= extraData->packetBufferFrames &&
+        !_readPacket(self)) {
+      break;
+    }
+
+    numFrames = extraData->packetBufferFrames - extraData->packetPosition;
+
+    if (numFrames > blocksize - framesRead) {
+      numFrames = blocksize - framesRead;
+    }
+
+    sampleBufferCopyAndMapChannelsWithOffset(
+        sampleBuffer, framesRead, extraData->packetBuffer,
+        extraData->packetPosition, numFrames);
+    extraData->packetPosition += numFrames;
+    framesRead += numFrames;
+  }
+
+  if (framesRead < blocksize) {
+    logDebugFast("End of packed audio file reached");
+    sampleBuffer->blocksize = framesRead;
+  }
+
+  self->numSamplesProcessed += framesRead * sampleBuffer->numChannels;
+  return (boolByte)(framesRead == blocksize);
+}
+
+static boolByte _writePacket(SampleSource self) {
+  SampleSourcePackedData extraData = (SampleSourcePackedData)self->extraData;
+  const SampleCount numFrames = extraData->packetBufferFrames;
+  byte *payload = extraData->encodedPacket + PACKED_PACKET_HEADER_SIZE;
+  size_t payloadSize = 0;
+  long offset;
+  ChannelCount i;
+
+  if (numFrames == 0) {
+    return true;
+  }
+
+  offset = ftell(extraData->fileHandle);
+
+  for (i = 0; i < extraData->numChannels; i++) {
+    payloadSize += _encodeChannel(extraData->packetBuffer->samples[i],
+                                  numFrames, payload + payloadSize);
+  }
+
+  _packUnsigned(extraData->encodedPacket, numFrames, 4);
+  _packUnsigned(extraData->encodedPacket + 4, payloadSize, 4);
+
+  payloadSize += PACKED_PACKET_HEADER_SIZE;
+
+  if (offset < 0 || fwrite(extraData->encodedPacket, 1, payloadSize,
+                           extraData->fileHandle) != payloadSize) {
+    logError("Could not write packet to '%s'", self->sourceName->data);
+    return false;
+  }
+
+  if (extraData->numPackets == extraData->packetsCapacity) {
+    extraData->packetsCapacity =
+        extraData->packetsCapacity > 0 ? extraData->packetsCapacity * 2 : 64;
+    extraData->packetOffsets = (unsigned long long *)realloc(
+        extraData->packetOffsets,
+        sizeof(unsigned long long) * extraData->packetsCapacity);
+  }
+
+  extraData->packetOffsets[extraData->numPackets++] =
+      (unsigned long long)offset;
+  extraData->numFrames += numFrames;
+  extraData->packetBufferFrames = 0;
+  return true;
+}
+
+static boolByte _writeBlockToPackedFile(void *selfPtr,
+                                        const SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourcePackedData extraData = (SampleSourcePackedData)self->extraData;
+  SampleCount framesWritten = 0;
+  SampleCount numFrames;
+
+  while (framesWritten < sampleBuffer->blocksize) {
+    numFrames = extraData->packetFrames - extraData->packetBufferFrames;
+
+    if (numFrames > sampleBuffer->blocksize - framesWritten) {
+      numFrames = sampleBuffer->blocksize - framesWritten;
+    }
+
+    sampleBufferCopyAndMapChannelsWithOffset(
+        extraData->packetBuffer, extraData->packetBufferFrames, sampleBuffer,
+        framesWritten, numFrames);
+    extraData->packetBufferFrames += numFrames;
+    framesWritten += numFrames;
+
+    if (extraData->packetBufferFrames == extraData->packetFrames &&
+        !_writePacket(self)) {
+      return false;
+    }
+  }
+
+  self->numSamplesProcessed += framesWritten * sampleBuffer->numChannels;
+  return true;
+}
+
+static boolByte _seekSampleSourcePacked(void *selfPtr, unsigned long frame) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourcePackedData extraData = (SampleSourcePackedData)self->extraData;
+  const unsigned long packet = frame / extraData->packetFrames;
+
+  if (!extraData->hasIndex) {
+    return false;
+  } else if (frame >= extraData->numFrames) {
+    extraData->nextPacket = extraData->numPackets;
+    extraData->packetBufferFrames = 0;
+    extraData->packetPosition = 0;
+    return true;
+  }
+
+  // Packets are encoded independently of each other, so decoding can start
+  // at the one which holds the frame
+  if (fseek(extraData->fileHandle, (long)extraData->packetOffsets[packet],
+            SEEK_SET) != 0) {
+    logDebug("Could not seek to frame %lu of '%s'", frame,
+             self->sourceName->data);
+    return false;
+  }
+
+  extraData->nextPacket = packet;
+
+  if (!_readPacket(self)) {
+    return false;
+  }
+
+  extraData->packetPosition = frame % extraData->packetFrames;
+  return true;
+}
+
+static boolByte _writePackedIndex(SampleSource self) {
+  SampleSourcePackedData extraData = (SampleSourcePackedData)self->extraData;
+  const long indexOffset = ftell(extraData->fileHandle);
+  byte entry[PACKED_INDEX_ENTRY_SIZE];
+  byte trailer[16];
+  unsigned long i;
+
+  if (indexOffset < 0) {
+    return false;
+  }
+
+  for (i = 0; i < extraData->numPackets; i++) {
+    _packUnsigned(entry, extraData->packetOffsets[i], sizeof(entry));
+
+    if (fwrite(entry, 1, sizeof(entry), extraData->fileHandle) !=
+        sizeof(entry)) {
+      return false;
+    }
+  }
+
+  _packUnsigned(trailer, extraData->numFrames, 8);
+  _packUnsigned(trailer + 8, (unsigned long long)indexOffset, 8);
+  return (boolByte)(fseek(extraData->fileHandle, PACKED_NUM_FRAMES_OFFSET,
+                          SEEK_SET) == 0 &&
+                    fwrite(trailer, 1, sizeof(trailer),
+                           extraData->fileHandle) == sizeof(trailer));
+}
+
+static void _closeSampleSourcePacked(void *selfPtr) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourcePackedData extraData = (SampleSourcePackedData)self->extraData;
+
+  if (extraData->fileHandle == NULL) {
+    return;
+  }
+
+  if (self->openedAs == SAMPLE_SOURCE_OPEN_WRITE &&
+      (!_writePacket(self) || !_writePackedIndex(self))) {
+    logError("Could not finish packed audio file '%s'",
+             self->sourceName->data);
+  }
+
+  fclose(extraData->fileHandle);
+  extraData->fileHandle = NULL;
+}
+
+unsigned long sampleSourcePackedGetLengthInFrames(SampleSource self) {
+  SampleSourcePackedData extraData = (SampleSourcePackedData)self->extraData;
+
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_READ || !extraData->hasIndex) {
+    return 0;
+  }
+
+  return extraData->numFrames;
+}
+
+static void _freeSampleSourceDataPacked(void *extraDataPtr) {
+  SampleSourcePackedData extraData = (SampleSourcePackedData)extraDataPtr;
+
+  if (extraData->fileHandle != NULL) {
+    fclose(extraData->fileHandle);
+  }
+
+  freeSampleBuffer(extraData->packetBuffer);
+  free(extraData->encodedPacket);
+  free(extraData->packetOffsets);
+  free(extraData);
+}
+
+SampleSource _newSampleSourcePacked(const CharString sampleSourceName) {
+  SampleSource sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  SampleSourcePackedData extraData =
+      (SampleSourcePackedData)malloc(sizeof(SampleSourcePackedDataMembers));
+
+  sampleSource->sampleSourceType = SAMPLE_SOURCE_TYPE_PACKED;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, sampleSourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourcePacked;
+  sampleSource->readSampleBlock = _readBlockFromPackedFile;
+  sampleSource->writeSampleBlock = _writeBlockToPackedFile;
+  sampleSource->seekSampleSource = _seekSampleSourcePacked;
+  sampleSource->closeSampleSource = _closeSampleSourcePacked;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataPacked;
+
+  extraData->fileHandle = NULL;
+  extraData->numChannels = getNumChannels();
+  extraData->sampleRate = (unsigned int)getSampleRate();
+  extraData->packetFrames = getBlocksize();
+  extraData->numFrames = 0;
+  extraData->hasIndex = false;
+  extraData->packetOffsets = NULL;
+  extraData->numPackets = 0;
+  extraData->packetsCapacity = 0;
+  extraData->nextPacket = 0;
+  extraData->packetBuffer = NULL;
+  extraData->packetBufferFrames = 0;
+  extraData->packetPosition = 0;
+  extraData->encodedPacket = NULL;
+  extraData->encodedCapacity = 0;
+
+  sampleSource->extraData = extraData;
+  return sampleSource;
+}
@@ -0,0 +1,77 @@
+//
+// SampleSourcePacked.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_SampleSourcePacked_h
+#define MrsWatson_SampleSourcePacked_h
+
+#include "io/SampleSource.h"
+
+#include <stdio.h>
+
+// Packed files are a fast lossless format for temporary files, such as the
+// intermediate results of multi-stage jobs. Samples are stored as 32-bit
+// floats in independent packets of one block each, and every sample is packed
+// into the bytes by which it differs from the one before it. This is much
+// smaller than WAVE for most audio, and far cheaper to encode than FLAC. Builds
+// with double samples round them to float, so only there the format is lossy.
+#define SAMPLE_SOURCE_PACKED_EXTENSION "mwp"
+
+typedef struct {
+  FILE *fileHandle;
+  ChannelCount numChannels;
+  unsigned int sampleRate;
+  // Number of frames in each packet, which is the blocksize that the file was
+  // written with. Only the last packet may be shorter.
+  SampleCount packetFrames;
+  unsigned long numFrames;
+
+  // File offset of each packet. Files which were not closed properly have no
+  // index, and can only be read from start to end.
+  boolByte hasIndex;
+  unsigned long long *packetOffsets;
+  unsigned long numPackets;
+  unsigned long packetsCapacity;
+  // Index of the packet which is read next
+  unsigned long nextPacket;
+
+  // Frames of the current packet, which were decoded when reading or are
+  // waiting to be encoded when writing
+  SampleBuffer packetBuffer;
+  SampleCount packetBufferFrames;
+  SampleCount packetPosition;
+  // Encoded form of the current packet
+  byte *encodedPacket;
+  size_t encodedCapacity;
+} SampleSourcePackedDataMembers;
+typedef SampleSourcePackedDataMembers *SampleSourcePackedData;
+
+/**
+ * Get the length of a packed file which has been opened for reading
+ * @param self Packed sample source
+ * @return Number of frames, or 0 if the file has no index
+ */
+unsigned long sampleSourcePackedGetLengthInFrames(SampleSource self);
+
+#endif
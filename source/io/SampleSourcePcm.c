@@ -24,6 +24,11 @@
 // POSSIBILITY OF SUCH DAMAGE.
 //
 
+// Must be declared before any system headers, needed for fallocate()
+#if LINUX
+#define _GNU_SOURCE
+#endif
+
 #include "SampleSourcePcm.h"
 
 #include "audio/AudioSettings.h"
@@ -32,17 +37,69 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if UNIX
+#include <sys/stat.h>
+#endif
+#if UNIX
+#include <unistd.h>
+#endif
+#if LINUX
+#include <fcntl.h>
+#endif
+
+static const size_t kSampleSourcePcmWriteBufferSize = 1024 * 1024;
+// Linux pipes only hold 64kb by default, which the other end of the pipe
+// fills or drains in a few blocks. Unprivileged users may enlarge them up to
+// /proc/sys/fs/pipe-max-size, which is 1mb by default.
+static const int kSampleSourcePcmPipeSize = 1024 * 1024;
+static const size_t kSampleSourcePcmCopyBufferSize = 64 * 1024;
+
+// Set up stdin or stdout for streaming. Both get a large stdio buffer so that
+// the kernel sees a few large reads and writes instead of one per block, and
+// pipes are enlarged so that the process on the other end blocks less often.
+static void _sampleSourcePcmSetupStream(SampleSourcePcmData extraData) {
+#if UNIX
+  struct stat fileStat;
+
+  if (fstat(fileno(extraData->fileHandle), &fileStat) == 0 &&
+      S_ISFIFO(fileStat.st_mode)) {
+    extraData->isPipe = true;
+#if LINUX
+    if (fcntl(fileno(extraData->fileHandle), F_SETPIPE_SZ,
+              kSampleSourcePcmPipeSize) < 0) {
+      logDebug("Could not enlarge pipe, using its default size");
+    }
+#endif
+  }
+#endif
+
+  // Must happen before anything is read from or written to the stream
+  if (setvbuf(extraData->fileHandle, NULL, _IOFBF,
+              kSampleSourcePcmWriteBufferSize) != 0) {
+    logDebug("Could not set buffer for stream");
+  }
+}
 
 static boolByte openSampleSourcePcm(void *selfPtr,
                                     const SampleSourceOpenAs openAs) {
   SampleSource self = (SampleSource)selfPtr;
   SampleSourcePcmData extraData = (SampleSourcePcmData)(self->extraData);
 
+  extraData->isPlanar = getPlanarPcm();
+
+  if (extraData->isPlanar && extraData->bitDepth != kBitDepth32Bit) {
+    logError("Planar PCM data must have a bit depth of 32");
+    return false;
+  }
+
   if (openAs == SAMPLE_SOURCE_OPEN_READ) {
     if (charStringIsEqualToCString(self->sourceName, "-", false)) {
       extraData->fileHandle = stdin;
       charStringCopyCString(self->sourceName, "stdin");
       extraData->isStream = true;
+      _sampleSourcePcmSetupStream(extraData);
     } else {
       extraData->fileHandle = fopen(self->sourceName->data, "rb");
     }
@@ -51,8 +108,12 @@ static boolByte openSampleSourcePcm(void *selfPtr,
       extraData->fileHandle = stdout;
       charStringCopyCString(self->sourceName, "stdout");
       extraData->isStream = true;
+      _sampleSourcePcmSetupStream(extraData);
     } else {
-      extraData->fileHandle = fopen(self->sourceName->data, "wb");
+      // A resumed output already exists, so it must not be truncated
+      extraData->fileHandle = fopen(self->sourceName->data,
+                                    extraData->resumeFrame > 0 ? "r+b" : "wb");
+      sampleSourcePcmBufferOutput(extraData);
     }
   } else {
     logInternalError("Invalid type for openAs in PCM file");
@@ -65,10 +126,313 @@ static boolByte openSampleSourcePcm(void *selfPtr,
     return false;
   }
 
+  // Raw PCM has no header, so every frame of a resumed output is assumed to
+  // have as many channels as are being processed now
+  if (openAs == SAMPLE_SOURCE_OPEN_WRITE && !extraData->isStream) {
+    extraData->numChannels = getNumChannels();
+  }
+
+  if (openAs == SAMPLE_SOURCE_OPEN_WRITE &&
+      !sampleSourcePcmSeekResumeFrame(self)) {
+    fclose(extraData->fileHandle);
+    extraData->fileHandle = NULL;
+    return false;
+  }
+
+  if (openAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    sampleSourcePcmSetupSparseOutput(extraData, extraData->resumeFrame > 0);
+  }
+
   self->openedAs = openAs;
   return true;
 }
 
+boolByte sampleSourcePcmMapInput(SampleSource self) {
+  SampleSourcePcmData extraData = (SampleSourcePcmData)(self->extraData);
+  const long position = ftell(extraData->fileHandle);
+
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_READ || extraData->isStream ||
+      extraData->ioRing != NULL || position < 0) {
+    return false;
+  }
+
+#if USE_AUDIOFILE
+  // In audiofile builds, 24-bit samples are expected to be already expanded to
+  // 32-bit integers, which is not how they are stored on disk
+  if (extraData->pcmSampleBuffer->bitDepth == kBitDepth24Bit) {
+    return false;
+  }
+#endif
+
+  extraData->mappedFile = newMappedFile(extraData->fileHandle);
+
+  if (extraData->mappedFile == NULL) {
+    return false;
+  }
+
+  // Reading starts wherever the file is currently positioned, which for WAVE
+  // files is the beginning of the data chunk
+  extraData->mappedReadPosition = (size_t)position;
+  extraData->mappedDataEnd = extraData->mappedFile->size;
+
+  if (extraData->dataSize > 0 &&
+      extraData->dataOffset + extraData->dataSize < extraData->mappedDataEnd) {
+    extraData->mappedDataEnd = extraData->dataOffset + extraData->dataSize;
+  }
+
+  if (extraData->mappedReadPosition > extraData->mappedDataEnd) {
+    extraData->mappedReadPosition = extraData->mappedDataEnd;
+  }
+
+  logDebug("Mapped %lu bytes of '%s' into memory",
+           (unsigned long)(extraData->mappedDataEnd -
+                           extraData->mappedReadPosition),
+           self->sourceName->data);
+  return true;
+}
+
+// Copy a block of planar 32-bit float samples to a sample buffer, where the
+// blocksize of the sample buffer has already been set to the number of frames
+static void _copyPlanarSamples(const float *floatSamples,
+                               SampleBuffer sampleBuffer) {
+  const SampleCount numFrames = sampleBuffer->blocksize;
+  ChannelCount channel;
+#if USE_DOUBLE_SAMPLES
+  SampleCount frame;
+
+  for (channel = 0; channel < sampleBuffer->numChannels; ++channel) {
+    for (frame = 0; frame < numFrames; ++frame) {
+      sampleBuffer->samples[channel][frame] =
+          (Sample)floatSamples[channel * numFrames + frame];
+    }
+  }
+#else
+  for (channel = 0; channel < sampleBuffer->numChannels; ++channel) {
+    memcpy(sampleBuffer->samples[channel], floatSamples + channel * numFrames,
+           sizeof(float) * numFrames);
+  }
+#endif
+}
+
+static SampleCount _readMappedSamples(SampleSourcePcmData extraData,
+                                      SampleBuffer sampleBuffer) {
+  const size_t bytesPerFrame =
+      extraData->pcmSampleBuffer->bytesPerSample * sampleBuffer->numChannels;
+  const SampleCount framesAvailable =
+      (SampleCount)((extraData->mappedDataEnd - extraData->mappedReadPosition) /
+                    bytesPerFrame);
+
+  if (framesAvailable < sampleBuffer->blocksize) {
+    logDebugFast("End of PCM file reached");
+    sampleBuffer->blocksize = framesAvailable;
+  }
+
+  if (extraData->isPlanar) {
+    _copyPlanarSamples(
+        (const float *)(extraData->mappedFile->data +
+                        extraData->mappedReadPosition),
+        sampleBuffer);
+  } else {
+    pcmSampleBufferConvertToSampleBuffer(
+        extraData->pcmSampleBuffer,
+        extraData->mappedFile->data + extraData->mappedReadPosition,
+        sampleBuffer);
+  }
+
+  extraData->mappedReadPosition += sampleBuffer->blocksize * bytesPerFrame;
+
+  logDebugFast("Read %d samples from PCM file",
+               sampleBuffer->blocksize * sampleBuffer->numChannels);
+  return sampleBuffer->blocksize * sampleBuffer->numChannels;
+}
+
+// Both directions of the ring hold blocks in the file's format, which in
+// audiofile builds is not how 24-bit samples are kept in memory
+static boolByte _canQueueBlocks(SampleSource self,
+                                const SampleSourceOpenAs openAs) {
+  SampleSourcePcmData extraData;
+
+  if (self->freeSampleSourceData != freeSampleSourceDataPcm ||
+      (self->sampleSourceType != SAMPLE_SOURCE_TYPE_PCM &&
+       self->sampleSourceType != SAMPLE_SOURCE_TYPE_WAVE) ||
+      self->openedAs != openAs) {
+    return false;
+  }
+
+  extraData = (SampleSourcePcmData)(self->extraData);
+
+  if (extraData->isStream || extraData->fileHandle == NULL ||
+      extraData->mappedFile != NULL || extraData->ioRing != NULL) {
+    return false;
+  }
+
+#if USE_AUDIOFILE
+  if (extraData->bitDepth == kBitDepth24Bit) {
+    return false;
+  }
+#endif
+
+  return true;
+}
+
+static boolByte _newIoRingForSource(SampleSource self, boolByte forWriting,
+                                    unsigned int numBlocks,
+                                    SampleCount blocksize) {
+  SampleSourcePcmData extraData = (SampleSourcePcmData)(self->extraData);
+  const size_t blockBytes = (size_t)blocksize * extraData->numChannels *
+                            (size_t)(extraData->bitDepth / 8);
+
+  extraData->ioRing =
+      newIoRing(extraData->fileHandle, forWriting, numBlocks, blockBytes);
+
+  if (extraData->ioRing == NULL) {
+    logDebug("Could not create an I/O ring for '%s'", self->sourceName->data);
+    return false;
+  }
+
+  extraData->ioRingStarted = false;
+  logDebug("%s %u blocks of '%s' through an I/O ring",
+           forWriting ? "Writing" : "Reading ahead", numBlocks,
+           self->sourceName->data);
+  return true;
+}
+
+// Blocks are submitted in batches, so that the kernel is entered once for
+// several of them, while the other half of the ring is still in flight
+static unsigned int _getIoRingBatchSize(const IoRing ioRing) {
+  return ioRing->numSlots > 1 ? ioRing->numSlots / 2 : 1;
+}
+
+// Blocks of another size than the ring was made for are read or written
+// normally, and the ring is dropped so that it is not restarted for each one.
+// Smaller blocks fit into the buffers of an output's ring.
+static boolByte _useIoRing(SampleSourcePcmData extraData,
+                           const SampleBuffer sampleBuffer) {
+  const size_t blockBytes = sampleBuffer->numChannels *
+                            sampleBuffer->blocksize *
+                            (size_t)(extraData->bitDepth / 8);
+
+  if (extraData->ioRing == NULL) {
+    return false;
+  } else if (extraData->ioRing->forWriting
+                 ? blockBytes <= extraData->ioRing->slotSize
+                 : blockBytes == extraData->ioRing->slotSize) {
+    return true;
+  }
+
+  logDebug("Block of %lu frames does not fit into the I/O ring",
+           sampleBuffer->blocksize);
+  sampleSourcePcmFreeIoRing(extraData);
+  return false;
+}
+
+boolByte sampleSourcePcmQueueReads(SampleSource self, unsigned int numBlocks,
+                                   SampleCount blocksize) {
+  return (boolByte)(_canQueueBlocks(self, SAMPLE_SOURCE_OPEN_READ) &&
+                    _newIoRingForSource(self, false, numBlocks, blocksize));
+}
+
+static void _queueIoRingRead(SampleSourcePcmData extraData,
+                             unsigned int slot) {
+  size_t numBytes = extraData->ioRing->slotSize;
+
+  if (extraData->ioRingQueueOffset >= extraData->ioRingEnd) {
+    return;
+  } else if (numBytes > extraData->ioRingEnd - extraData->ioRingQueueOffset) {
+    numBytes = extraData->ioRingEnd - extraData->ioRingQueueOffset;
+  }
+
+  ioRingQueue(extraData->ioRing, slot, extraData->ioRingQueueOffset, numBytes);
+  extraData->ioRingQueueOffset += numBytes;
+}
+
+// Reads start at the stream position, and are queued for every slot at once
+static boolByte _startIoRingReads(SampleSourcePcmData extraData) {
+  const long position = ftell(extraData->fileHandle);
+  unsigned int slot;
+  long end;
+
+  if (position < 0 || fseek(extraData->fileHandle, 0, SEEK_END) != 0 ||
+      (end = ftell(extraData->fileHandle)) < 0 ||
+      fseek(extraData->fileHandle, position, SEEK_SET) != 0) {
+    return false;
+  }
+
+  extraData->ioRingEnd = (size_t)end;
+
+  if (extraData->dataSize > 0 &&
+      extraData->dataOffset + extraData->dataSize < extraData->ioRingEnd) {
+    extraData->ioRingEnd = extraData->dataOffset + extraData->dataSize;
+  }
+
+  extraData->ioRingOffset = (size_t)position;
+  extraData->ioRingQueueOffset = (size_t)position;
+  extraData->ioRingSlot = 0;
+
+  for (slot = 0; slot < extraData->ioRing->numSlots; ++slot) {
+    _queueIoRingRead(extraData, slot);
+  }
+
+  ioRingSubmit(extraData->ioRing);
+  extraData->ioRingStarted = true;
+  return true;
+}
+
+static SampleCount _readIoRingSamples(SampleSourcePcmData extraData,
+                                      SampleBuffer sampleBuffer) {
+  IoRing ioRing = extraData->ioRing;
+  const size_t bytesPerFrame =
+      (size_t)(extraData->bitDepth / 8) * sampleBuffer->numChannels;
+  const unsigned int slot = extraData->ioRingSlot;
+  long bytesRead = ioRingWait(ioRing, slot);
+  SampleCount framesRead;
+
+  if (bytesRead < 0) {
+    logWarn("Could not read from PCM file");
+    bytesRead = 0;
+  }
+
+  framesRead = (SampleCount)((size_t)bytesRead / bytesPerFrame);
+
+  if (framesRead < sampleBuffer->blocksize) {
+    logDebugFast("End of PCM file reached");
+    sampleBuffer->blocksize = framesRead;
+  }
+
+  if (extraData->isPlanar) {
+    _copyPlanarSamples((const float *)ioRing->buffers[slot], sampleBuffer);
+  } else {
+    pcmSampleBufferConvertToSampleBuffer(extraData->pcmSampleBuffer,
+                                         ioRing->buffers[slot], sampleBuffer);
+  }
+
+  // The slot is refilled with the block after the last one in flight
+  extraData->ioRingOffset += (size_t)bytesRead;
+  _queueIoRingRead(extraData, slot);
+  extraData->ioRingSlot = (slot + 1) % ioRing->numSlots;
+
+  if (ioRing->numQueued >= _getIoRingBatchSize(ioRing)) {
+    ioRingSubmit(ioRing);
+  }
+
+  logDebugFast("Read %d samples from PCM file",
+               framesRead * sampleBuffer->numChannels);
+  return framesRead * sampleBuffer->numChannels;
+}
+
+// The new buffer keeps the sample format of the file, which for an AIFF input
+// may differ from the bit depth and byte order that outputs are written in
+static void _resizePcmSampleBuffer(SampleSourcePcmData extraData,
+                                   const SampleBuffer sampleBuffer) {
+  freePcmSampleBuffer(extraData->pcmSampleBuffer);
+  extraData->pcmSampleBuffer =
+      newPcmSampleBuffer(sampleBuffer->numChannels, sampleBuffer->blocksize,
+                         extraData->bitDepth);
+  extraData->pcmSampleBuffer->littleEndian = extraData->isLittleEndian;
+  extraData->dataBufferNumItems =
+      sampleBuffer->numChannels * sampleBuffer->blocksize;
+}
+
 SampleCount sampleSourcePcmRead(SampleSourcePcmData extraData,
                                 SampleBuffer sampleBuffer) {
   if (extraData == NULL || extraData->fileHandle == NULL) {
@@ -76,6 +440,13 @@ SampleCount sampleSourcePcmRead(SampleSourcePcmData extraData,
     return 0;
   }
 
+  if (extraData->mappedFile != NULL) {
+    return _readMappedSamples(extraData, sampleBuffer);
+  } else if (_useIoRing(extraData, sampleBuffer) &&
+             (extraData->ioRingStarted || _startIoRingReads(extraData))) {
+    return _readIoRingSamples(extraData, sampleBuffer);
+  }
+
   // If the blocksize has changed, then regenerate our PCM sample buffer to
   // make room for it.
   const SampleBuffer internalSampleBuffer =
@@ -83,31 +454,32 @@ SampleCount sampleSourcePcmRead(SampleSourcePcmData extraData,
 
   if (internalSampleBuffer->blocksize != sampleBuffer->blocksize ||
       internalSampleBuffer->numChannels != sampleBuffer->numChannels) {
-    freePcmSampleBuffer(extraData->pcmSampleBuffer);
-    extraData->pcmSampleBuffer = newPcmSampleBuffer(
-        sampleBuffer->numChannels, sampleBuffer->blocksize, getBitDepth());
-    extraData->dataBufferNumItems =
-        sampleBuffer->numChannels * sampleBuffer->blocksize;
+    _resizePcmSampleBuffer(extraData, sampleBuffer);
   }
 
-  // Read data into our temporary holding buffer, and then set it to the
-  // PcmSampleBuffer, which will convert it to floating point for us.
+  // Read data into our temporary holding buffer, and then convert it to
+  // floating point directly in the caller's buffer
   SampleCount pcmSamplesRead =
       (SampleCount)fread(extraData->pcmSampleBuffer->pcmSamples,
                          extraData->pcmSampleBuffer->bytesPerSample,
                          extraData->dataBufferNumItems, extraData->fileHandle);
-  extraData->pcmSampleBuffer->setSamples(extraData->pcmSampleBuffer);
-  sampleBufferCopyAndMapChannels(
-      sampleBuffer,
-      extraData->pcmSampleBuffer->getSampleBuffer(extraData->pcmSampleBuffer));
 
   if (pcmSamplesRead < extraData->dataBufferNumItems) {
-    logDebug("End of PCM file reached");
+    logDebugFast("End of PCM file reached");
     // Set the blocksize of the sample buffer to be the number of frames read
     sampleBuffer->blocksize = pcmSamplesRead / sampleBuffer->numChannels;
   }
 
-  logDebug("Read %d samples from PCM file", pcmSamplesRead);
+  if (extraData->isPlanar) {
+    _copyPlanarSamples((const float *)extraData->pcmSampleBuffer->pcmSamples,
+                       sampleBuffer);
+  } else {
+    pcmSampleBufferConvertToSampleBuffer(
+        extraData->pcmSampleBuffer, extraData->pcmSampleBuffer->pcmSamples,
+        sampleBuffer);
+  }
+
+  logDebugFast("Read %d samples from PCM file", pcmSamplesRead);
   return pcmSamplesRead;
 }
 
@@ -120,30 +492,163 @@ static boolByte readBlockFromPcmFile(void *selfPtr, SampleBuffer sampleBuffer) {
   return (boolByte)(originalBlocksize == sampleBuffer->blocksize);
 }
 
+// Write a block of samples as planar 32-bit floats, and return the number of
+// samples which were written. Float samples are written straight from the
+// sample buffer, one channel after another.
+static SampleCount _writePlanarSamples(SampleSourcePcmData extraData,
+                                       const SampleBuffer sampleBuffer) {
+  SampleCount samplesWritten = 0;
+  ChannelCount channel;
+#if USE_DOUBLE_SAMPLES
+  float *floatSamples = (float *)extraData->pcmSampleBuffer->pcmSamples;
+  SampleCount frame;
+
+  for (channel = 0; channel < sampleBuffer->numChannels; ++channel) {
+    for (frame = 0; frame < sampleBuffer->blocksize; ++frame) {
+      *floatSamples++ = (float)sampleBuffer->samples[channel][frame];
+    }
+  }
+
+  samplesWritten = (SampleCount)fwrite(
+      extraData->pcmSampleBuffer->pcmSamples, sizeof(float),
+      sampleBuffer->numChannels * sampleBuffer->blocksize,
+      extraData->fileHandle);
+#else
+  for (channel = 0; channel < sampleBuffer->numChannels; ++channel) {
+    samplesWritten += (SampleCount)fwrite(
+        sampleBuffer->samples[channel], sizeof(float), sampleBuffer->blocksize,
+        extraData->fileHandle);
+  }
+#endif
+
+  return samplesWritten;
+}
+
+// Write a silent block, which is the same in every sample format that sparse
+// output is used for, so its samples do not need to be converted
+static SampleCount _writeSilentSamples(SampleSourcePcmData extraData,
+                                       SampleCount numSamples) {
+  const size_t numBytes =
+      (size_t)numSamples * (size_t)(extraData->bitDepth / 8);
+  void *zeroes;
+  size_t bytesWritten;
+
+  if (extraData->seekOverSilence &&
+      fseek(extraData->fileHandle, (long)numBytes, SEEK_CUR) == 0) {
+    extraData->silenceAtEnd = true;
+    return numSamples;
+  }
+
+  // The PCM sample buffer is at least as large as the block, and its contents
+  // are overwritten before the next block which is not silent is written
+  zeroes = extraData->pcmSampleBuffer->pcmSamples;
+  memset(zeroes, 0, numBytes);
+  extraData->silenceAtEnd = false;
+  bytesWritten = fwrite(zeroes, 1, numBytes, extraData->fileHandle);
+
+  if (bytesWritten < numBytes) {
+    logWarn("Short write to PCM file");
+  }
+
+  return (SampleCount)(bytesWritten / (size_t)(extraData->bitDepth / 8));
+}
+
+// Writes start at the stream position, so anything which stdio has buffered
+// before it must reach the file first
+static boolByte _startIoRingWrites(SampleSourcePcmData extraData) {
+  long position;
+
+  if (fflush(extraData->fileHandle) != 0 ||
+      (position = ftell(extraData->fileHandle)) < 0) {
+    return false;
+  }
+
+  extraData->ioRingOffset = (size_t)position;
+  extraData->ioRingSlot = 0;
+  extraData->ioRingStarted = true;
+  return true;
+}
+
+static SampleCount _writeIoRingSamples(SampleSourcePcmData extraData,
+                                       const SampleBuffer sampleBuffer) {
+  IoRing ioRing = extraData->ioRing;
+  PcmSampleBuffer pcmSampleBuffer = extraData->pcmSampleBuffer;
+  void *pcmSamples = pcmSampleBuffer->pcmSamples;
+  const SampleCount numSamples =
+      sampleBuffer->numChannels * sampleBuffer->blocksize;
+  const size_t numBytes = numSamples * (size_t)(extraData->bitDepth / 8);
+  const unsigned int slot = extraData->ioRingSlot;
+
+  // The block which was written from this slot before must be finished
+  // before its buffer is reused
+  if (ioRingWait(ioRing, slot) < 0) {
+    return 0;
+  }
+
+  // The block is converted straight into the slot's buffer
+  pcmSampleBuffer->pcmSamples = ioRing->buffers[slot];
+  pcmSampleBuffer->setSampleBuffer(pcmSampleBuffer, sampleBuffer);
+  pcmSampleBuffer->pcmSamples = pcmSamples;
+
+  ioRingQueue(ioRing, slot, extraData->ioRingOffset, numBytes);
+  extraData->ioRingOffset += numBytes;
+  extraData->ioRingSlot = (slot + 1) % ioRing->numSlots;
+
+  if (ioRing->numQueued >= _getIoRingBatchSize(ioRing)) {
+    ioRingSubmit(ioRing);
+  }
+
+  return numSamples;
+}
+
 SampleCount sampleSourcePcmWrite(SampleSourcePcmData extraData,
                                  const SampleBuffer sampleBuffer) {
   SampleCount pcmSamplesWritten = 0;
   SampleCount numSamplesToWrite =
       sampleBuffer->numChannels * sampleBuffer->blocksize;
+  SampleBuffer internalSampleBuffer;
 
   if (extraData == NULL || extraData->fileHandle == NULL) {
     logCritical("Corrupt PCM data structure");
     return false;
   }
 
-  extraData->pcmSampleBuffer->setSampleBuffer(extraData->pcmSampleBuffer,
-                                              sampleBuffer);
-  pcmSamplesWritten =
-      (SampleCount)fwrite(extraData->pcmSampleBuffer->pcmSamples,
-                          extraData->pcmSampleBuffer->bytesPerSample,
-                          numSamplesToWrite, extraData->fileHandle);
+  // Smaller blocks fit into the PCM sample buffer, so it only needs to be
+  // regenerated when writing a larger block than before
+  internalSampleBuffer =
+      extraData->pcmSampleBuffer->getSampleBuffer(extraData->pcmSampleBuffer);
+
+  if (internalSampleBuffer->blocksize < sampleBuffer->blocksize ||
+      internalSampleBuffer->numChannels != sampleBuffer->numChannels) {
+    _resizePcmSampleBuffer(extraData, sampleBuffer);
+  }
+
+  if (extraData->skipSilentConversion && sampleBufferIsSilent(sampleBuffer)) {
+    return _writeSilentSamples(extraData, numSamplesToWrite);
+  }
+
+  extraData->silenceAtEnd = false;
+
+  if (extraData->isPlanar) {
+    pcmSamplesWritten = _writePlanarSamples(extraData, sampleBuffer);
+  } else if (_useIoRing(extraData, sampleBuffer) &&
+             (extraData->ioRingStarted || _startIoRingWrites(extraData))) {
+    pcmSamplesWritten = _writeIoRingSamples(extraData, sampleBuffer);
+  } else {
+    extraData->pcmSampleBuffer->setSampleBuffer(extraData->pcmSampleBuffer,
+                                                sampleBuffer);
+    pcmSamplesWritten =
+        (SampleCount)fwrite(extraData->pcmSampleBuffer->pcmSamples,
+                            extraData->pcmSampleBuffer->bytesPerSample,
+                            numSamplesToWrite, extraData->fileHandle);
+  }
 
   if (pcmSamplesWritten < numSamplesToWrite) {
     logWarn("Short write to PCM file");
     return pcmSamplesWritten;
   }
 
-  logDebug("Wrote %d samples to PCM file", pcmSamplesWritten);
+  logDebugFast("Wrote %d samples to PCM file", pcmSamplesWritten);
   return pcmSamplesWritten;
 }
 
@@ -154,18 +659,543 @@ static boolByte writeBlockToPcmFile(void *selfPtr,
   unsigned int samplesWritten =
       (int)sampleSourcePcmWrite(extraData, sampleBuffer);
   self->numSamplesProcessed += samplesWritten;
-  return (boolByte)(samplesWritten == sampleBuffer->blocksize);
+  return (boolByte)(samplesWritten ==
+                    sampleBuffer->blocksize * sampleBuffer->numChannels);
+}
+
+boolByte sampleSourcePcmQueueWrites(SampleSource self, unsigned int numBlocks,
+                                    SampleCount blocksize) {
+  SampleSourcePcmData extraData = (SampleSourcePcmData)(self->extraData);
+
+  // Planar blocks are written one channel at a time, and silent blocks of
+  // sparse outputs may be skipped with a seek
+  if (!_canQueueBlocks(self, SAMPLE_SOURCE_OPEN_WRITE) ||
+      extraData->isPlanar || extraData->skipSilentConversion) {
+    return false;
+  }
+
+  return _newIoRingForSource(self, true, numBlocks, blocksize);
+}
+
+boolByte sampleSourcePcmSyncIoRing(SampleSourcePcmData extraData) {
+  boolByte result;
+
+  if (extraData->ioRing == NULL || !extraData->ioRingStarted) {
+    return true;
+  }
+
+  // Reads which are still in flight are simply read again later
+  result = (boolByte)(ioRingWaitAll(extraData->ioRing) ||
+                      !extraData->ioRing->forWriting);
+  extraData->ioRingStarted = false;
+
+  if (!result) {
+    logWarn("Could not write all blocks of the I/O ring to PCM file");
+  }
+
+  if (fseek(extraData->fileHandle, (long)extraData->ioRingOffset, SEEK_SET) !=
+      0) {
+    logWarn("Could not move PCM file to the end of the I/O ring");
+    return false;
+  }
+
+  return result;
+}
+
+void sampleSourcePcmFreeIoRing(SampleSourcePcmData extraData) {
+  if (extraData->ioRing != NULL) {
+    sampleSourcePcmSyncIoRing(extraData);
+    freeIoRing(extraData->ioRing);
+    extraData->ioRing = NULL;
+  }
+}
+
+unsigned long sampleSourcePcmGetLengthInFrames(SampleSource self) {
+  SampleSourcePcmData extraData = (SampleSourcePcmData)(self->extraData);
+  const size_t bytesPerFrame =
+      extraData->numChannels * (size_t)(extraData->bitDepth / 8);
+  long position;
+  long end;
+
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_READ || extraData->isStream ||
+      bytesPerFrame == 0) {
+    return 0;
+  } else if (extraData->dataSize > 0) {
+    return (unsigned long)(extraData->dataSize / bytesPerFrame);
+  }
+
+  sampleSourcePcmSyncIoRing(extraData);
+  position = ftell(extraData->fileHandle);
+
+  if (position < 0 || fseek(extraData->fileHandle, 0, SEEK_END) != 0) {
+    return 0;
+  }
+
+  end = ftell(extraData->fileHandle);
+
+  if (fseek(extraData->fileHandle, position, SEEK_SET) != 0) {
+    logError("Could not seek back to the start of '%s'",
+             self->sourceName->data);
+    return 0;
+  }
+
+  return end > position ? (unsigned long)(end - position) / bytesPerFrame : 0;
+}
+
+boolByte sampleSourcePcmSeek(void *selfPtr, unsigned long frame) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourcePcmData extraData;
+  size_t bytesPerFrame;
+  size_t offset;
+
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_READ ||
+      self->freeSampleSourceData != freeSampleSourceDataPcm) {
+    return false;
+  }
+
+  extraData = (SampleSourcePcmData)self->extraData;
+  bytesPerFrame = extraData->numChannels * (size_t)(extraData->bitDepth / 8);
+
+  if (extraData->isStream || extraData->fileHandle == NULL ||
+      bytesPerFrame == 0) {
+    return false;
+  } else if (extraData->isPlanar && frame % getBlocksize() != 0) {
+    // Seeking into the middle of a planar block would mix up its channels
+    logDebug("Cannot seek to frame %lu of planar PCM, which is not at the "
+             "start of a block",
+             frame);
+    return false;
+  }
+
+  offset = frame * bytesPerFrame;
+
+  if (extraData->dataSize > 0 && offset > extraData->dataSize) {
+    offset = extraData->dataSize;
+  }
+
+  if (extraData->mappedFile != NULL) {
+    extraData->mappedReadPosition = extraData->dataOffset + offset;
+
+    if (extraData->mappedReadPosition > extraData->mappedDataEnd) {
+      extraData->mappedReadPosition = extraData->mappedDataEnd;
+    }
+
+    return true;
+  }
+
+  sampleSourcePcmSyncIoRing(extraData);
+
+  if (fseek(extraData->fileHandle, (long)(extraData->dataOffset + offset),
+            SEEK_SET) != 0) {
+    logDebug("Could not seek to frame %lu of '%s'", frame,
+             self->sourceName->data);
+    return false;
+  }
+
+  return true;
+}
+
+void sampleSourcePcmBufferOutput(SampleSourcePcmData extraData) {
+  if (extraData->fileHandle != NULL &&
+      setvbuf(extraData->fileHandle, NULL, _IOFBF,
+              kSampleSourcePcmWriteBufferSize) != 0) {
+    logDebug("Could not set buffer for output file");
+  }
+}
+
+void sampleSourcePcmSetupSparseOutput(SampleSourcePcmData extraData,
+                                      boolByte resumed) {
+  extraData->skipSilentConversion =
+      (boolByte)(getSparseOutput() && getDitherType() == kDitherTypeNone &&
+                 extraData->bitDepth != kBitDepth8Bit);
+  extraData->seekOverSilence = (boolByte)(extraData->skipSilentConversion &&
+                                          !extraData->isStream && !resumed);
+  extraData->silenceAtEnd = false;
+}
+
+void sampleSourcePcmFinishSparseOutput(SampleSourcePcmData extraData) {
+  if (!extraData->silenceAtEnd || extraData->fileHandle == NULL) {
+    return;
+  }
+
+  // Seeking past the end does not extend the file, so the last byte of the
+  // skipped silence is written
+  if (fseek(extraData->fileHandle, -1, SEEK_CUR) != 0 ||
+      fputc(0, extraData->fileHandle) == EOF) {
+    logWarn("Could not write silence at the end of PCM output");
+  }
+
+  extraData->silenceAtEnd = false;
+}
+
+boolByte sampleSourcePcmIsPipe(SampleSource self) {
+  return (boolByte)(self->freeSampleSourceData == freeSampleSourceDataPcm &&
+                    ((SampleSourcePcmData)self->extraData)->isPipe);
+}
+
+boolByte sampleSourcePcmPreallocate(SampleSource self,
+                                    unsigned long numFrames) {
+  SampleSourcePcmData extraData = (SampleSourcePcmData)(self->extraData);
+  const size_t bytesPerFrame =
+      extraData->numChannels * (size_t)(extraData->bitDepth / 8);
+
+  // Reserved space stays allocated when silence is skipped, which would defeat
+  // sparse output
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_WRITE || extraData->isStream ||
+      extraData->seekOverSilence || numFrames == 0) {
+    return false;
+  }
+
+#if LINUX
+  const long position = ftell(extraData->fileHandle);
+
+  // Keeping the size means that the file does not need to be truncated if it
+  // ends up shorter than expected, and that the WAVE header stays valid
+  if (position < 0 ||
+      fallocate(fileno(extraData->fileHandle), FALLOC_FL_KEEP_SIZE,
+                (off_t)position, (off_t)(numFrames * bytesPerFrame)) != 0) {
+    logDebug("Could not reserve space for output file '%s'",
+             self->sourceName->data);
+    return false;
+  }
+
+  logDebug("Reserved %lu bytes for output file '%s'",
+           (unsigned long)(numFrames * bytesPerFrame), self->sourceName->data);
+  extraData->preallocated = true;
+  return true;
+#else
+  (void)bytesPerFrame;
+  return false;
+#endif
+}
+
+void sampleSourcePcmReleasePreallocation(SampleSourcePcmData extraData) {
+#if LINUX
+  long end;
+
+  if (!extraData->preallocated || extraData->fileHandle == NULL) {
+    return;
+  }
+
+  // Truncating to the current size frees the reserved blocks past the end
+  fflush(extraData->fileHandle);
+  end = ftell(extraData->fileHandle);
+
+  if (end >= 0 && ftruncate(fileno(extraData->fileHandle), (off_t)end) != 0) {
+    logDebug("Could not release reserved space of output file");
+  }
+#endif
+
+  extraData->preallocated = false;
+}
+
+boolByte sampleSourcePcmPrepareRegions(SampleSource self,
+                                       unsigned long numFrames) {
+  SampleSourcePcmData extraData = (SampleSourcePcmData)(self->extraData);
+
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_WRITE ||
+      self->freeSampleSourceData != freeSampleSourceDataPcm ||
+      extraData->isStream || extraData->fileHandle == NULL) {
+    return false;
+  }
+
+  sampleSourcePcmPreallocate(self, numFrames);
+
+  // The header is still in the stdio buffer, and must reach the file before
+  // the regions start writing behind it
+  if (fflush(extraData->fileHandle) != 0) {
+    logError("Could not write header of '%s'", self->sourceName->data);
+    return false;
+  }
+
+  return true;
+}
+
+static boolByte _openSampleSourcePcmRegion(void *selfPtr,
+                                           const SampleSourceOpenAs openAs) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourcePcmData extraData = (SampleSourcePcmData)(self->extraData);
+
+  if (openAs != SAMPLE_SOURCE_OPEN_WRITE) {
+    logInternalError("Regions of an output can only be written");
+    return false;
+  }
+
+  // The output already exists, so it must not be truncated
+  extraData->fileHandle = fopen(self->sourceName->data, "r+b");
+
+  if (extraData->fileHandle == NULL) {
+    logError("Output '%s' could not be opened for writing a region",
+             self->sourceName->data);
+    return false;
+  }
+
+  sampleSourcePcmBufferOutput(extraData);
+
+  if (fseek(extraData->fileHandle, (long)extraData->dataOffset, SEEK_SET) !=
+      0) {
+    logError("Could not seek to region of '%s'", self->sourceName->data);
+    fclose(extraData->fileHandle);
+    extraData->fileHandle = NULL;
+    return false;
+  }
+
+  // The prepared output has just been created, so skipped ranges are zeroes
+  sampleSourcePcmSetupSparseOutput(extraData, false);
+
+  self->openedAs = openAs;
+  return true;
+}
+
+// Defined at the end of this file, since it is otherwise only called through
+// sampleSourceFactory()
+SampleSource _newSampleSourcePcm(const CharString sampleSourceName);
+
+SampleSource newSampleSourcePcmRegion(const SampleSource output,
+                                      unsigned long startFrame) {
+  SampleSourcePcmData outputData = (SampleSourcePcmData)(output->extraData);
+  SampleSource self = _newSampleSourcePcm(output->sourceName);
+  SampleSourcePcmData extraData = (SampleSourcePcmData)(self->extraData);
+
+  self->openSampleSource = _openSampleSourcePcmRegion;
+  extraData->isLittleEndian = outputData->isLittleEndian;
+  extraData->isPlanar = outputData->isPlanar;
+  extraData->numChannels = outputData->numChannels;
+  extraData->sampleRate = outputData->sampleRate;
+  extraData->bitDepth = outputData->bitDepth;
+  // The audio data of a region starts at its first frame
+  extraData->dataOffset =
+      outputData->dataOffset +
+      startFrame * outputData->numChannels * (size_t)(outputData->bitDepth / 8);
+  return self;
+}
+
+unsigned long sampleSourcePcmFinishRegions(SampleSource self) {
+  SampleSourcePcmData extraData = (SampleSourcePcmData)(self->extraData);
+  const size_t bytesPerFrame =
+      extraData->numChannels * (size_t)(extraData->bitDepth / 8);
+  unsigned long numFrames;
+  long end;
+
+  // The regions have written past the position of the output's own handle
+  if (bytesPerFrame == 0 || fseek(extraData->fileHandle, 0, SEEK_END) != 0 ||
+      (end = ftell(extraData->fileHandle)) < (long)extraData->dataOffset) {
+    logError("Could not find the end of '%s'", self->sourceName->data);
+    return 0;
+  }
+
+  numFrames = (unsigned long)(((size_t)end - extraData->dataOffset) /
+                              bytesPerFrame);
+  self->numSamplesProcessed = numFrames * extraData->numChannels;
+  return numFrames;
+}
+
+boolByte sampleSourcePcmCanCopy(SampleSource input, SampleSource output) {
+  SampleSourcePcmData inputData;
+  SampleSourcePcmData outputData;
+
+  // Only the PCM and WAVE sources use PCM data, which also rules out sources
+  // that are wrapped for background reads or writes
+  if (input->openedAs != SAMPLE_SOURCE_OPEN_READ ||
+      output->openedAs != SAMPLE_SOURCE_OPEN_WRITE ||
+      input->freeSampleSourceData != freeSampleSourceDataPcm ||
+      output->freeSampleSourceData != freeSampleSourceDataPcm) {
+    return false;
+  }
+
+  inputData = (SampleSourcePcmData)input->extraData;
+  outputData = (SampleSourcePcmData)output->extraData;
+  return (boolByte)(
+      inputData->fileHandle != NULL && outputData->fileHandle != NULL &&
+      (inputData->bitDepth == kBitDepth16Bit ||
+       inputData->bitDepth == kBitDepth24Bit) &&
+      inputData->bitDepth == outputData->bitDepth &&
+      inputData->isLittleEndian && outputData->isLittleEndian &&
+      inputData->numChannels == getNumChannels() &&
+      outputData->numChannels == getNumChannels() &&
+      inputData->sampleRate == outputData->sampleRate);
+}
+
+// Get the number of bytes which are left to read from the input, rounded down
+// to whole frames. Returns the given maximum if the end of the data is known
+// only once the end of the file is reached.
+static size_t _getCopyBytesRemaining(SampleSourcePcmData extraData,
+                                     size_t bytesPerFrame, size_t maxBytes) {
+  size_t remaining = maxBytes;
+  long position;
+
+  if (extraData->mappedFile != NULL) {
+    remaining = extraData->mappedDataEnd - extraData->mappedReadPosition;
+  } else if (extraData->dataSize > 0) {
+    position = ftell(extraData->fileHandle);
+    remaining = position >= 0 && (size_t)position < extraData->dataOffset +
+                                                        extraData->dataSize
+                    ? extraData->dataOffset + extraData->dataSize -
+                          (size_t)position
+                    : 0;
+  }
+
+  remaining = remaining < maxBytes ? remaining : maxBytes;
+  return remaining - (remaining % bytesPerFrame);
+}
+
+// Copy the remaining audio data of the input to the output, and scale it on
+// the way if applyGain is set
+static unsigned long _copyPcmData(SampleSource input, SampleSource output,
+                                  boolByte applyGain, Sample gain) {
+  SampleSourcePcmData inputData = (SampleSourcePcmData)input->extraData;
+  SampleSourcePcmData outputData = (SampleSourcePcmData)output->extraData;
+  const size_t bytesPerSample = (size_t)(inputData->bitDepth / 8);
+  const size_t bytesPerFrame = inputData->numChannels * bytesPerSample;
+  const size_t bufferSize =
+      kSampleSourcePcmCopyBufferSize - (kSampleSourcePcmCopyBufferSize %
+                                        bytesPerFrame);
+  byte *buffer = (byte *)malloc(bufferSize);
+  const byte *chunk;
+  unsigned long framesCopied = 0;
+  size_t numBytes;
+  size_t numSamples;
+
+  sampleSourcePcmSyncIoRing(inputData);
+  sampleSourcePcmSyncIoRing(outputData);
+
+  while ((numBytes = _getCopyBytesRemaining(inputData, bytesPerFrame,
+                                            bufferSize)) > 0) {
+    if (inputData->mappedFile != NULL) {
+      chunk = inputData->mappedFile->data + inputData->mappedReadPosition;
+      inputData->mappedReadPosition += numBytes;
+    } else {
+      numBytes = fread(buffer, 1, numBytes, inputData->fileHandle);
+      numBytes -= numBytes % bytesPerFrame;
+      chunk = buffer;
+    }
+
+    if (numBytes == 0) {
+      break;
+    }
+
+    // A plain copy needs no scratch space, and mapped data is written directly
+    numSamples = numBytes / bytesPerSample;
+
+    if (applyGain) {
+      pcmSamplesApplyGain(chunk, buffer, numSamples, inputData->bitDepth, gain);
+      chunk = buffer;
+    }
+
+    input->numSamplesProcessed += numSamples;
+
+    if (fwrite(chunk, 1, numBytes, outputData->fileHandle) < numBytes) {
+      logWarn("Short write to PCM file");
+      break;
+    }
+
+    output->numSamplesProcessed += numSamples;
+    framesCopied += (unsigned long)(numBytes / bytesPerFrame);
+  }
+
+  free(buffer);
+  logDebug("Copied %lu frames from '%s' to '%s'", framesCopied,
+           input->sourceName->data, output->sourceName->data);
+  return framesCopied;
+}
+
+unsigned long sampleSourcePcmCopy(SampleSource input, SampleSource output) {
+  return _copyPcmData(input, output, false, 1.0f);
+}
+
+unsigned long sampleSourcePcmCopyWithGain(SampleSource input,
+                                          SampleSource output, Sample gain) {
+  return _copyPcmData(input, output, true, gain);
 }
 
 static void _closeSampleSourcePcm(void *selfPtr) {
   SampleSource self = (SampleSource)selfPtr;
   SampleSourcePcmData extraData = (SampleSourcePcmData)self->extraData;
 
+  freeMappedFile(extraData->mappedFile);
+  extraData->mappedFile = NULL;
+  sampleSourcePcmFreeIoRing(extraData);
+
   if (extraData->fileHandle != NULL) {
+    if (self->openedAs == SAMPLE_SOURCE_OPEN_WRITE) {
+      sampleSourcePcmFinishSparseOutput(extraData);
+    }
+
+    sampleSourcePcmReleasePreallocation(extraData);
     fclose(extraData->fileHandle);
   }
 }
 
+boolByte sampleSourcePcmCanResume(const SampleSource self) {
+  return (boolByte)(
+      self->freeSampleSourceData == freeSampleSourceDataPcm &&
+      (self->sampleSourceType == SAMPLE_SOURCE_TYPE_PCM ||
+       self->sampleSourceType == SAMPLE_SOURCE_TYPE_WAVE) &&
+      !charStringIsEqualToCString(self->sourceName, "-", false));
+}
+
+void sampleSourcePcmSetResumeFrame(SampleSource self, unsigned long frame) {
+  ((SampleSourcePcmData)self->extraData)->resumeFrame = frame;
+}
+
+boolByte sampleSourcePcmSeekResumeFrame(SampleSource self) {
+  SampleSourcePcmData extraData = (SampleSourcePcmData)(self->extraData);
+  const size_t bytesPerFrame =
+      extraData->numChannels * (size_t)(extraData->bitDepth / 8);
+  const size_t offset =
+      extraData->dataOffset + extraData->resumeFrame * bytesPerFrame;
+  long end;
+
+  if (extraData->resumeFrame == 0) {
+    return true;
+  }
+
+  // The frames which are kept must all be there, otherwise the output was
+  // written with a different format or has been changed since
+  if (fseek(extraData->fileHandle, 0, SEEK_END) != 0 ||
+      (end = ftell(extraData->fileHandle)) < 0 || (size_t)end < offset ||
+      fseek(extraData->fileHandle, (long)offset, SEEK_SET) != 0) {
+    logError("Output '%s' is too short to resume at frame %lu",
+             self->sourceName->data, extraData->resumeFrame);
+    return false;
+  }
+
+  logInfo("Resuming output '%s' at frame %lu", self->sourceName->data,
+          extraData->resumeFrame);
+  // Anything after the end of the new output is stale, and is cut off when
+  // closing in the same way as unused reserved space
+  extraData->preallocated = true;
+  return true;
+}
+
+unsigned long sampleSourcePcmFlush(SampleSource self) {
+  SampleSourcePcmData extraData;
+  long position;
+
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_WRITE ||
+      !sampleSourcePcmCanResume(self)) {
+    return 0;
+  }
+
+  extraData = (SampleSourcePcmData)(self->extraData);
+  sampleSourcePcmSyncIoRing(extraData);
+  sampleSourcePcmFinishSparseOutput(extraData);
+
+  if (extraData->isStream || extraData->fileHandle == NULL ||
+      fflush(extraData->fileHandle) != 0) {
+    return 0;
+  }
+
+#if UNIX
+  if (fsync(fileno(extraData->fileHandle)) != 0) {
+    logWarn("Could not sync output '%s' to disk", self->sourceName->data);
+  }
+#endif
+
+  position = ftell(extraData->fileHandle);
+  return position > 0 ? (unsigned long)position : 0;
+}
+
 void sampleSourcePcmSetSampleRate(void *selfPtr, SampleRate sampleRate) {
   SampleSource self = (SampleSource)selfPtr;
   SampleSourcePcmData extraData = (SampleSourcePcmData)self->extraData;
@@ -180,6 +1210,8 @@ void sampleSourcePcmSetNumChannels(void *selfPtr, int numChannels) {
 
 void freeSampleSourceDataPcm(void *extraDataPtr) {
   SampleSourcePcmData extraData = (SampleSourcePcmData)extraDataPtr;
+  freeMappedFile(extraData->mappedFile);
+  freeIoRing(extraData->ioRing);
   freePcmSampleBuffer(extraData->pcmSampleBuffer);
   free(extraData);
 }
@@ -198,11 +1230,14 @@ SampleSource _newSampleSourcePcm(const CharString sampleSourceName) {
   sampleSource->openSampleSource = openSampleSourcePcm;
   sampleSource->readSampleBlock = readBlockFromPcmFile;
   sampleSource->writeSampleBlock = writeBlockToPcmFile;
+  sampleSource->seekSampleSource = sampleSourcePcmSeek;
   sampleSource->closeSampleSource = _closeSampleSourcePcm;
   sampleSource->freeSampleSourceData = freeSampleSourceDataPcm;
 
   extraData->isStream = false;
+  extraData->isPipe = false;
   extraData->isLittleEndian = true;
+  extraData->isPlanar = false;
   extraData->fileHandle = NULL;
   // Assume default values for these items. However, if an incoming SampleBuffer
   // has different values for the channel count or blocksize, then we will
@@ -211,6 +1246,22 @@ SampleSource _newSampleSourcePcm(const CharString sampleSourceName) {
   extraData->dataBufferNumItems = getNumChannels() * getBlocksize();
   extraData->pcmSampleBuffer =
       newPcmSampleBuffer(getNumChannels(), getBlocksize(), getBitDepth());
+  extraData->dataOffset = 0;
+  extraData->dataSize = 0;
+  extraData->mappedFile = NULL;
+  extraData->mappedReadPosition = 0;
+  extraData->mappedDataEnd = 0;
+  extraData->ioRing = NULL;
+  extraData->ioRingStarted = false;
+  extraData->ioRingSlot = 0;
+  extraData->ioRingOffset = 0;
+  extraData->ioRingQueueOffset = 0;
+  extraData->ioRingEnd = 0;
+  extraData->preallocated = false;
+  extraData->resumeFrame = 0;
+  extraData->skipSilentConversion = false;
+  extraData->seekOverSilence = false;
+  extraData->silenceAtEnd = false;
 
   extraData->numChannels = getNumChannels();
   extraData->sampleRate = getSampleRate();
@@ -28,17 +28,56 @@
 #define MrsWatson_InputSourcePcm_h
 
 #include "audio/PcmSampleBuffer.h"
+#include "base/IoRing.h"
+#include "base/MappedFile.h"
 #include "io/SampleSource.h"
 
 #include <stdio.h>
 
 typedef struct {
   boolByte isStream;
+  // Set when stdin or stdout is a pipe rather than a redirected file
+  boolByte isPipe;
   boolByte isLittleEndian;
+  // Raw PCM files may have planar blocks, see setPlanarPcm()
+  boolByte isPlanar;
   FILE *fileHandle;
   size_t dataBufferNumItems;
   PcmSampleBuffer pcmSampleBuffer;
 
+  // Byte range of the audio data within the file. A dataSize of 0 means that
+  // the audio data runs until the end of the file.
+  size_t dataOffset;
+  size_t dataSize;
+  // Only set when the input has been mapped with sampleSourcePcmMapInput()
+  MappedFile mappedFile;
+  size_t mappedReadPosition;
+  size_t mappedDataEnd;
+  // Only set when blocks are read or written through an I/O ring, see
+  // sampleSourcePcmQueueReads() and sampleSourcePcmQueueWrites()
+  IoRing ioRing;
+  // Set once the first block has gone through the ring. Until then, and after
+  // sampleSourcePcmSyncIoRing(), the stream position is where the ring starts.
+  boolByte ioRingStarted;
+  unsigned int ioRingSlot;
+  // Offset of the next block which is read or written, and for inputs the
+  // offset of the next read to queue and the end of the audio data
+  size_t ioRingOffset;
+  size_t ioRingQueueOffset;
+  size_t ioRingEnd;
+  // Set when disk space has been reserved with sampleSourcePcmPreallocate()
+  boolByte preallocated;
+  // Frame of an existing output where writing continues, see
+  // sampleSourcePcmSetResumeFrame()
+  unsigned long resumeFrame;
+  // Set by sampleSourcePcmSetupSparseOutput(). Silent blocks are written
+  // without converting them, or skipped over if the output can seek.
+  boolByte skipSilentConversion;
+  boolByte seekOverSilence;
+  // Set while the file ends with a skipped block, which does not extend the
+  // file until something is written after it
+  boolByte silenceAtEnd;
+
   ChannelCount numChannels;
   SampleRate sampleRate;
   BitDepth bitDepth;
@@ -54,6 +93,31 @@ typedef SampleSourcePcmDataMembers *SampleSourcePcmData;
 SampleCount sampleSourcePcmRead(SampleSourcePcmData extraData,
                                 SampleBuffer sampleBuffer);
 
+/**
+ * Map the audio data of a PCM or WAVE input into memory. Afterwards, blocks are
+ * converted straight from the mapped file into the caller's sample buffer,
+ * rather than being read into a temporary buffer and copied from there.
+ * @param self PCM or WAVE sample source which has been opened for reading
+ * @return True if the input was mapped. Otherwise, for example when reading
+ * from stdin, the source continues to read the file normally.
+ */
+boolByte sampleSourcePcmMapInput(SampleSource self);
+
+/**
+ * Read the next blocks of a PCM or WAVE input ahead through an I/O ring, see
+ * newIoRing(). Reads for the given number of blocks are kept in flight, so
+ * the file is read ahead without a separate thread. If blocks of another size
+ * are read, then the ring is dropped and the file is read normally.
+ * @param self Any sample source which has been opened for reading
+ * @param numBlocks Number of blocks to read ahead
+ * @param blocksize Number of frames in each block
+ * @return True if the input is read through a ring. Otherwise, for example
+ * when reading from stdin or when the platform does not support it, the
+ * source continues to read the file normally.
+ */
+boolByte sampleSourcePcmQueueReads(SampleSource self, unsigned int numBlocks,
+                                   SampleCount blocksize);
+
 /**
  * Writes data from a sample buffer to a PCM output
  * @param self
@@ -63,6 +127,225 @@ SampleCount sampleSourcePcmRead(SampleSourcePcmData extraData,
 SampleCount sampleSourcePcmWrite(SampleSourcePcmData extraData,
                                  const SampleBuffer sampleBuffer);
 
+/**
+ * Write the blocks of a PCM or WAVE output through an I/O ring, see
+ * newIoRing(). Converted blocks are submitted to the kernel in batches, and
+ * writing only waits when all of the ring's blocks are still in flight.
+ * Planar and sparse outputs are written normally.
+ * @param self Any sample source which has been opened for writing
+ * @param numBlocks Number of blocks which may be in flight at once
+ * @param blocksize Largest number of frames in a block
+ * @return True if the output is written through a ring
+ */
+boolByte sampleSourcePcmQueueWrites(SampleSource self, unsigned int numBlocks,
+                                    SampleCount blocksize);
+
+/**
+ * Wait for all blocks in the I/O ring of a PCM or WAVE source, and move the
+ * file's stream position to the next block which is read or written. This
+ * must be called before anything other than the ring reads, writes or seeks
+ * the file. The ring starts again from the stream position with the next
+ * block.
+ * @param extraData PCM data of any opened source
+ * @return False if a block could not be written
+ */
+boolByte sampleSourcePcmSyncIoRing(SampleSourcePcmData extraData);
+
+/**
+ * Finish all blocks in the I/O ring of a PCM or WAVE source like
+ * sampleSourcePcmSyncIoRing() and free the ring, so that the source is read or
+ * written normally afterwards. Called when closing the source.
+ * @param extraData PCM data of any opened source
+ */
+void sampleSourcePcmFreeIoRing(SampleSourcePcmData extraData);
+
+/**
+ * Get the number of frames in a PCM or WAVE input, so that the length of the
+ * output can be estimated before processing starts.
+ * @param self PCM or WAVE sample source which has been opened for reading
+ * @return Number of frames, or 0 if the length is not known, for example when
+ * reading from stdin
+ */
+unsigned long sampleSourcePcmGetLengthInFrames(SampleSource self);
+
+/**
+ * Move the read position of a PCM or WAVE input to another frame, so that
+ * reading a part of a long file does not have to read everything before it.
+ * @param self Any sample source which has been opened for reading
+ * @param frame Frame to read next, counted from the start of the audio data
+ * @return True if the position was changed, or false if the source cannot
+ * seek, for example when reading from stdin
+ */
+boolByte sampleSourcePcmSeek(void *selfPtr, unsigned long frame);
+
+/**
+ * Give an output file a large stdio buffer, so that blocks reach the disk in
+ * large chunks rather than with one small write per block. This must be called
+ * directly after the file is opened, before anything is written to it.
+ * @param extraData PCM data of a source which has been opened for writing
+ */
+void sampleSourcePcmBufferOutput(SampleSourcePcmData extraData);
+
+/**
+ * Decide how silent blocks are written to an output when setSparseOutput() is
+ * enabled. Skipping a block only leaves zeroes in the file when the output
+ * was created empty and silence is stored as zero bytes, so outputs which are
+ * resumed, dithered, or use 8-bit samples write every block. This
+ * must be called when the output is opened, after the file has been opened.
+ * @param extraData PCM data of a source which has been opened for writing
+ * @param resumed True if the output keeps data from an earlier render
+ */
+void sampleSourcePcmSetupSparseOutput(SampleSourcePcmData extraData,
+                                      boolByte resumed);
+
+/**
+ * Extend an output which ends with skipped silent blocks to its full length.
+ * Called before flushing or closing the output.
+ * @param extraData PCM data of a source which has been opened for writing
+ */
+void sampleSourcePcmFinishSparseOutput(SampleSourcePcmData extraData);
+
+/**
+ * Find out if a source reads from or writes to a pipe through stdin or stdout,
+ * in which case it is worth moving its I/O to a separate thread even when the
+ * user did not ask for it, so that the other end of the pipe is never waiting
+ * on the plugin chain.
+ * @param self Any sample source which has been opened
+ * @return True if the source is a PCM stream connected to a pipe
+ */
+boolByte sampleSourcePcmIsPipe(SampleSource self);
+
+/**
+ * Reserve disk space for the audio data of a PCM or WAVE output, which avoids
+ * fragmentation and the metadata updates for growing the file one block at a
+ * time. The reservation does not change the size of the file, and any space
+ * which was not written to is released when the source is closed. This is
+ * currently only supported on Linux, and not for sparse outputs.
+ * @param self PCM or WAVE sample source which has been opened for writing
+ * @param numFrames Expected number of frames in the output
+ * @return True if the space was reserved
+ */
+boolByte sampleSourcePcmPreallocate(SampleSource self, unsigned long numFrames);
+
+/**
+ * Prepare a PCM or WAVE output so that parts of it can be written by several
+ * threads at once through newSampleSourcePcmRegion(). Space is reserved for the
+ * expected length, and the header is written to disk so that the regions can
+ * open the file themselves. Nothing else may be written to the output until
+ * sampleSourcePcmFinishRegions() is called.
+ * @param self PCM or WAVE sample source which has been opened for writing
+ * @param numFrames Expected number of frames in the output
+ * @return True if the output can be written in regions, which is not the case
+ * for stdout or other sources
+ */
+boolByte sampleSourcePcmPrepareRegions(SampleSource self,
+                                       unsigned long numFrames);
+
+/**
+ * Create a source which writes to a part of an output which was prepared with
+ * sampleSourcePcmPrepareRegions(). The region has its own file handle and
+ * starts writing at the given frame, so regions which do not overlap can be
+ * written from different threads. Closing the region does not close the
+ * output.
+ * @param output Prepared PCM or WAVE output
+ * @param startFrame Frame of the output where the region starts
+ * @return Sample source which must be opened for writing like any other
+ */
+SampleSource newSampleSourcePcmRegion(const SampleSource output,
+                                      unsigned long startFrame);
+
+/**
+ * Update an output after all of its regions have been written and closed, so
+ * that its length covers everything written by them. Afterwards the output
+ * should be closed as usual, which writes the final WAVE header.
+ * @param self Output which was prepared with sampleSourcePcmPrepareRegions()
+ * @return Number of frames in the output
+ */
+unsigned long sampleSourcePcmFinishRegions(SampleSource self);
+
+/**
+ * Release any disk space which was reserved with sampleSourcePcmPreallocate()
+ * beyond the current end of the file. Called when closing the output.
+ * @param extraData PCM data of a source which has been opened for writing
+ */
+void sampleSourcePcmReleasePreallocation(SampleSourcePcmData extraData);
+
+/**
+ * Find out if the audio data of one PCM or WAVE source can be copied straight
+ * to another one with sampleSourcePcmCopy() or sampleSourcePcmCopyWithGain().
+ * This requires that both sources have the same format, and that the processing
+ * channel count matches the files so that no channels would need to be mapped.
+ * @param input Source which has been opened for reading
+ * @param output Source which has been opened for writing
+ * @return True if both sources store the same integer PCM format
+ */
+boolByte sampleSourcePcmCanCopy(SampleSource input, SampleSource output);
+
+/**
+ * Copy all remaining audio data from a PCM or WAVE input to a PCM or WAVE
+ * output without changing it. Only call this after sampleSourcePcmCanCopy()
+ * has returned true for the same sources.
+ * @param input Source which has been opened for reading
+ * @param output Source which has been opened for writing
+ * @return Number of frames copied
+ */
+unsigned long sampleSourcePcmCopy(SampleSource input, SampleSource output);
+
+/**
+ * Copy all remaining audio data from a PCM or WAVE input to a PCM or WAVE
+ * output, scaling the samples by a constant gain with pcmSamplesApplyGain().
+ * The output is the same as if the samples were processed by a chain of
+ * internal gain plugins, without going through sample buffers. Only call this
+ * after sampleSourcePcmCanCopy() has returned true for the same sources.
+ * @param input Source which has been opened for reading
+ * @param output Source which has been opened for writing
+ * @param gain Linear gain to apply
+ * @return Number of frames copied
+ */
+unsigned long sampleSourcePcmCopyWithGain(SampleSource input,
+                                          SampleSource output, Sample gain);
+
+/**
+ * Find out if an output can be continued with sampleSourcePcmSetResumeFrame()
+ * after it was interrupted.
+ * @param self Any sample source, which need not be opened
+ * @return True if the source is a PCM or WAVE file, rather than stdout or
+ * another type of source
+ */
+boolByte sampleSourcePcmCanResume(const SampleSource self);
+
+/**
+ * Continue writing an existing PCM or WAVE output instead of replacing it. When
+ * the source is opened for writing, the frames before the given one are kept
+ * and writing starts after them. Anything after that is overwritten, and on
+ * Linux it is cut off when the source is closed. The number of samples which
+ * the source has processed only counts those written after opening it. Must be
+ * called before the source is opened, and only if sampleSourcePcmCanResume()
+ * is true.
+ * @param self
+ * @param frame Number of frames to keep from the existing output
+ */
+void sampleSourcePcmSetResumeFrame(SampleSource self, unsigned long frame);
+
+/**
+ * Move the write position of an output which was opened after calling
+ * sampleSourcePcmSetResumeFrame() behind the frames which are kept. Called by
+ * the PCM and WAVE sources when they are opened for writing, after any header
+ * has been written.
+ * @param self PCM or WAVE sample source which has been opened for writing
+ * @return True if the output could be resumed, or if it was not resumed at all
+ */
+boolByte sampleSourcePcmSeekResumeFrame(SampleSource self);
+
+/**
+ * Write everything which has been buffered for a PCM or WAVE output to disk,
+ * so that it survives a crash of the program or the system.
+ * @param self Any sample source which has been opened for writing
+ * @return Offset in bytes of the end of the written data, or 0 if the source
+ * is not a PCM or WAVE file or could not be flushed
+ */
+unsigned long sampleSourcePcmFlush(SampleSource self);
+
 /**
  * Set the sample rate to be used for raw PCM file operations. This is most
  * relevant when writing a WAVE or a AIFF file, as the sample rate must be given
@@ -0,0 +1,145 @@
+//
+// SampleSourceResampler.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SampleSourceResampler.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+
+static boolByte _openSampleSourceResampler(void *sampleSourcePtr,
+                                           const SampleSourceOpenAs openAs) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  // The wrapped source was already opened before it was wrapped
+  return (boolByte)(self->openedAs == openAs);
+}
+
+static boolByte _readBlockFromResampler(void *sampleSourcePtr,
+                                        SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceResamplerData extraData =
+      (SampleSourceResamplerData)self->extraData;
+  SampleBuffer readBuffer = extraData->readBuffer;
+  const SampleCount blocksize = sampleBuffer->blocksize;
+  const SampleCount readBlocksize = extraData->readBlocksize;
+  SampleCount framesWritten = 0;
+
+  while (framesWritten < blocksize) {
+    framesWritten +=
+        resamplerPull(extraData->resampler, sampleBuffer, framesWritten);
+
+    if (framesWritten == blocksize || extraData->resampler->finished) {
+      break;
+    }
+
+    readBuffer->blocksize = readBlocksize;
+    extraData->source->readSampleBlock(extraData->source, readBuffer);
+    resamplerPush(extraData->resampler, readBuffer);
+
+    // A short read means that the end of the source was reached
+    if (readBuffer->blocksize < readBlocksize) {
+      resamplerFinish(extraData->resampler);
+    }
+  }
+
+  sampleBuffer->blocksize = framesWritten;
+  self->numSamplesProcessed += framesWritten * sampleBuffer->numChannels;
+  return (boolByte)(framesWritten == blocksize);
+}
+
+static boolByte _writeBlockToResampler(void *sampleSourcePtr,
+                                       const SampleBuffer sampleBuffer) {
+  logInternalError("Cannot write to a resampled input source");
+  return false;
+}
+
+static void _closeSampleSourceResampler(void *sampleSourcePtr) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceResamplerData extraData =
+      (SampleSourceResamplerData)self->extraData;
+
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_NOT_OPENED) {
+    extraData->source->closeSampleSource(extraData->source);
+    self->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  }
+}
+
+static void _freeSampleSourceDataResampler(void *sampleSourceDataPtr) {
+  SampleSourceResamplerData extraData =
+      (SampleSourceResamplerData)sampleSourceDataPtr;
+  freeSampleSource(extraData->source);
+  freeResampler(extraData->resampler);
+  freeSampleBuffer(extraData->readBuffer);
+  free(extraData);
+}
+
+SampleSource newSampleSourceResampler(SampleSource source,
+                                      SampleRate sourceRate,
+                                      SampleRate targetRate,
+                                      ResamplerQuality quality) {
+  SampleSource sampleSource;
+  SampleSourceResamplerData extraData;
+  Resampler resampler;
+
+  if (source == NULL || source->openedAs != SAMPLE_SOURCE_OPEN_READ) {
+    return NULL;
+  }
+
+  resampler = newResampler(getNumChannels(), sourceRate, targetRate, quality);
+
+  if (resampler == NULL) {
+    return NULL;
+  }
+
+  sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  extraData = (SampleSourceResamplerData)malloc(
+      sizeof(SampleSourceResamplerDataMembers));
+
+  sampleSource->sampleSourceType = source->sampleSourceType;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_READ;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, source->sourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceResampler;
+  sampleSource->readSampleBlock = _readBlockFromResampler;
+  sampleSource->writeSampleBlock = _writeBlockToResampler;
+  sampleSource->seekSampleSource = NULL;
+  sampleSource->closeSampleSource = _closeSampleSourceResampler;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataResampler;
+
+  extraData->source = source;
+  extraData->resampler = resampler;
+  extraData->readBlocksize = getBlocksize();
+  extraData->readBuffer =
+      newSampleBuffer(getNumChannels(), extraData->readBlocksize);
+  sampleSource->extraData = extraData;
+
+  logDebug("Converting '%s' from %.0fHz to %.0fHz", source->sourceName->data,
+           sourceRate, targetRate);
+  return sampleSource;
+}
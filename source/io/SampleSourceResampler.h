@@ -0,0 +1,64 @@
+//
+// SampleSourceResampler.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_SampleSourceResampler_h
+#define MrsWatson_SampleSourceResampler_h
+
+#include "audio/Resampler.h"
+#include "io/SampleSource.h"
+
+typedef struct {
+  SampleSource source;
+  Resampler resampler;
+  // Blocks of readBlocksize frames are read from the wrapped source into this
+  // buffer
+  SampleBuffer readBuffer;
+  SampleCount readBlocksize;
+} SampleSourceResamplerDataMembers;
+typedef SampleSourceResamplerDataMembers *SampleSourceResamplerData;
+
+/**
+ * Wrap an input source so that its audio is converted to another sample rate
+ * as it is read. The length of the converted input is the same as that of the
+ * original input, measured in seconds.
+ *
+ * The returned source takes ownership of the wrapped source, which must
+ * already be opened for reading. Closing the returned source closes the
+ * wrapped source.
+ *
+ * @param source Opened input source
+ * @param sourceRate Sample rate of the wrapped source
+ * @param targetRate Sample rate to convert to
+ * @param quality Quality preset of the conversion filter
+ * @return New sample source, or NULL if the settings are invalid. In that case,
+ * the caller retains ownership of the source.
+ */
+SampleSource newSampleSourceResampler(SampleSource source,
+                                      SampleRate sourceRate,
+                                      SampleRate targetRate,
+                                      ResamplerQuality quality);
+
+#endif
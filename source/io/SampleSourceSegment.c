@@ -0,0 +1,170 @@
+//
+// SampleSourceSegment.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SampleSourceSegment.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+static boolByte _openSampleSourceSegment(void *sampleSourcePtr,
+                                         const SampleSourceOpenAs openAs) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  // The wrapped source was already opened before it was wrapped
+  return (boolByte)(self->openedAs == openAs);
+}
+
+static boolByte _readBlockFromSegment(void *sampleSourcePtr,
+                                      SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceSegmentData extraData = (SampleSourceSegmentData)self->extraData;
+  const SampleCount blocksize = sampleBuffer->blocksize;
+  unsigned long framesRead;
+  unsigned long prerollRead;
+
+  if ((unsigned long)blocksize > extraData->framesRemaining) {
+    sampleBuffer->blocksize = (SampleCount)extraData->framesRemaining;
+  }
+
+  if (sampleBuffer->blocksize > 0) {
+    extraData->source->readSampleBlock(extraData->source, sampleBuffer);
+  }
+
+  framesRead = (unsigned long)sampleBuffer->blocksize;
+
+  if (extraData->framesRemaining != ULONG_MAX) {
+    extraData->framesRemaining -= framesRead;
+  }
+
+  prerollRead = framesRead < extraData->prerollRemaining
+                    ? framesRead
+                    : extraData->prerollRemaining;
+  extraData->prerollRemaining -= prerollRead;
+  self->numSamplesProcessed +=
+      (framesRead - prerollRead) * sampleBuffer->numChannels;
+  return (boolByte)(sampleBuffer->blocksize == blocksize);
+}
+
+static boolByte _writeBlockToSegment(void *sampleSourcePtr,
+                                     const SampleBuffer sampleBuffer) {
+  logInternalError("Cannot write to a segment of an input source");
+  return false;
+}
+
+static void _closeSampleSourceSegment(void *sampleSourcePtr) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  SampleSourceSegmentData extraData = (SampleSourceSegmentData)self->extraData;
+
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_NOT_OPENED) {
+    extraData->source->closeSampleSource(extraData->source);
+    self->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  }
+}
+
+static void _freeSampleSourceDataSegment(void *sampleSourceDataPtr) {
+  SampleSourceSegmentData extraData =
+      (SampleSourceSegmentData)sampleSourceDataPtr;
+  freeSampleSource(extraData->source);
+  free(extraData);
+}
+
+// Read and throw away frames from sources which cannot seek
+static void _skipFrames(SampleSource source, unsigned long numFrames) {
+  SampleBuffer buffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  SampleCount framesToRead;
+
+  while (numFrames > 0) {
+    framesToRead = numFrames < (unsigned long)getBlocksize()
+                       ? (SampleCount)numFrames
+                       : getBlocksize();
+    buffer->blocksize = framesToRead;
+    source->readSampleBlock(source, buffer);
+    numFrames -= (unsigned long)buffer->blocksize;
+
+    if (buffer->blocksize < framesToRead) {
+      break;
+    }
+  }
+
+  // The skipped frames belong to the wrapped source only
+  source->numSamplesProcessed = 0;
+  freeSampleBuffer(buffer);
+}
+
+SampleSource newSampleSourceSegment(SampleSource source,
+                                    unsigned long startFrame,
+                                    unsigned long numFrames,
+                                    unsigned long prerollFrames) {
+  SampleSource sampleSource;
+  SampleSourceSegmentData extraData;
+  const unsigned long readStart = startFrame - prerollFrames;
+
+  if (source == NULL || source->openedAs != SAMPLE_SOURCE_OPEN_READ ||
+      prerollFrames > startFrame) {
+    return NULL;
+  }
+
+  if (readStart > 0 && !sampleSourceSeek(source, readStart)) {
+    logDebug("Reading %lu frames to reach segment of '%s'", readStart,
+             source->sourceName->data);
+    _skipFrames(source, readStart);
+  }
+
+  sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  extraData =
+      (SampleSourceSegmentData)malloc(sizeof(SampleSourceSegmentDataMembers));
+
+  sampleSource->sampleSourceType = source->sampleSourceType;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_READ;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, source->sourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceSegment;
+  sampleSource->readSampleBlock = _readBlockFromSegment;
+  sampleSource->writeSampleBlock = _writeBlockToSegment;
+  sampleSource->seekSampleSource = NULL;
+  sampleSource->closeSampleSource = _closeSampleSourceSegment;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataSegment;
+
+  extraData->source = source;
+  extraData->prerollRemaining = prerollFrames;
+  extraData->framesRemaining =
+      numFrames > 0 ? prerollFrames + numFrames : ULONG_MAX;
+  sampleSource->extraData = extraData;
+
+  if (numFrames > 0) {
+    logDebug("Reading frames %lu to %lu of '%s'", startFrame,
+             startFrame + numFrames, source->sourceName->data);
+  } else {
+    logDebug("Reading from frame %lu to the end of '%s'", startFrame,
+             source->sourceName->data);
+  }
+
+  return sampleSource;
+}
@@ -0,0 +1,71 @@
+//
+// SampleSourceSegment.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_SampleSourceSegment_h
+#define MrsWatson_SampleSourceSegment_h
+
+#include "io/SampleSource.h"
+
+typedef struct {
+  SampleSource source;
+  // Preroll frames which still need to be read before the segment starts
+  unsigned long prerollRemaining;
+  // Frames of the segment which still need to be read, including the preroll,
+  // or ULONG_MAX to read until the end of the wrapped source
+  unsigned long framesRemaining;
+} SampleSourceSegmentDataMembers;
+typedef SampleSourceSegmentDataMembers *SampleSourceSegmentData;
+
+/**
+ * Wrap an input source so that only a part of it is read. Reading starts
+ * prerollFrames before startFrame, and the preroll is not counted in the
+ * numSamplesProcessed of the returned source. That way, the output length of a
+ * job is the length of the segment, and the caller only needs to skip the
+ * preroll at the start of the output.
+ *
+ * Inputs which support sampleSourceSeek() jump to the start of the preroll,
+ * other sources read and discard everything before it.
+ *
+ * The returned source takes ownership of the wrapped source, which must
+ * already be opened for reading. Closing the returned source closes the
+ * wrapped source.
+ *
+ * @param source Opened input source
+ * @param startFrame First frame of the segment
+ * @param numFrames Number of frames in the segment, or 0 to read until the end
+ * of the source
+ * @param prerollFrames Number of frames to read before startFrame, which must
+ * not be larger than startFrame
+ * @return New sample source, or NULL if the source is not opened for reading
+ * or the preroll is too long. In that case, the caller retains ownership of the
+ * source.
+ */
+SampleSource newSampleSourceSegment(SampleSource source,
+                                    unsigned long startFrame,
+                                    unsigned long numFrames,
+                                    unsigned long prerollFrames);
+
+#endif
@@ -62,6 +62,11 @@ static boolByte _writeBlockToSilence(void *sampleSourcePtr,
   return true;
 }
 
+static boolByte _seekSampleSourceSilence(void *sampleSourcePtr,
+                                         unsigned long frame) {
+  return true;
+}
+
 static void _freeInputSourceDataSilence(void *sampleSourceDataPtr) {}
 
 SampleSource _newSampleSourceSilence(void) {
@@ -77,6 +82,7 @@ SampleSource _newSampleSourceSilence(void) {
   sampleSource->closeSampleSource = _closeSampleSourceSilence;
   sampleSource->readSampleBlock = _readBlockFromSilence;
   sampleSource->writeSampleBlock = _writeBlockToSilence;
+  sampleSource->seekSampleSource = _seekSampleSourceSilence;
   sampleSource->freeSampleSourceData = _freeInputSourceDataSilence;
 
   return sampleSource;
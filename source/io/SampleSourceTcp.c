@@ -0,0 +1,431 @@
+//
+// SampleSourceTcp.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SampleSourceTcp.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char kSampleSourceTcpMagic[4] = {'M', 'W', 'P', 'C'};
+static const unsigned short kSampleSourceTcpVersion = 1;
+static const size_t kSampleSourceTcpFrameSizeBytes = 4;
+// Kernel send and receive buffers for the connection. The default is often
+// only a few blocks of audio, which is not enough to ride out jitter on the
+// network.
+static const int kSampleSourceTcpSocketBufferSize = 512 * 1024;
+
+// The stream uses little-endian byte order regardless of the platform, so
+// these helpers do not use the platform conversions in Endian.h
+static void _putLittleEndianShort(byte *dest, unsigned short value) {
+  dest[0] = (byte)(value & 0xff);
+  dest[1] = (byte)((value >> 8) & 0xff);
+}
+
+static void _putLittleEndianInt(byte *dest, unsigned int value) {
+  dest[0] = (byte)(value & 0xff);
+  dest[1] = (byte)((value >> 8) & 0xff);
+  dest[2] = (byte)((value >> 16) & 0xff);
+  dest[3] = (byte)((value >> 24) & 0xff);
+}
+
+static unsigned short _getLittleEndianShort(const byte *src) {
+  return (unsigned short)(src[0] | (src[1] << 8));
+}
+
+static unsigned int _getLittleEndianInt(const byte *src) {
+  return (unsigned int)src[0] | ((unsigned int)src[1] << 8) |
+         ((unsigned int)src[2] << 16) | ((unsigned int)src[3] << 24);
+}
+
+boolByte sampleSourceIsTcpName(const CharString sampleSourceName) {
+  return (boolByte)(sampleSourceName != NULL &&
+                    strncmp(sampleSourceName->data, SAMPLE_SOURCE_TCP_PREFIX,
+                            strlen(SAMPLE_SOURCE_TCP_PREFIX)) == 0);
+}
+
+// Split "tcp://host:port" into its parts. IPv6 addresses must be written in
+// brackets, as in "tcp://[::1]:port".
+static boolByte _parseTcpName(SampleSource self) {
+  SampleSourceTcpData extraData = (SampleSourceTcpData)self->extraData;
+  const char *address =
+      self->sourceName->data + strlen(SAMPLE_SOURCE_TCP_PREFIX);
+  const char *colon = strrchr(address, ':');
+  const char *hostStart = address;
+  size_t hostLength;
+  char *end = NULL;
+  long port;
+
+  if (colon == NULL) {
+    logError("TCP source '%s' has no port", self->sourceName->data);
+    return false;
+  }
+
+  port = strtol(colon + 1, &end, 10);
+
+  if (end == colon + 1 || *end != '\0' || port <= 0 || port > 65535) {
+    logError("TCP source '%s' has an invalid port", self->sourceName->data);
+    return false;
+  }
+
+  hostLength = (size_t)(colon - address);
+
+  if (hostLength >= 2 && address[0] == '[' && address[hostLength - 1] == ']') {
+    hostStart++;
+    hostLength -= 2;
+  }
+
+  if (hostLength >= extraData->host->capacity) {
+    logError("Host name of TCP source '%s' is too long",
+             self->sourceName->data);
+    return false;
+  }
+
+  charStringClear(extraData->host);
+  strncpy(extraData->host->data, hostStart, hostLength);
+  extraData->host->data[hostLength] = '\0';
+  extraData->port = (unsigned short)port;
+  return true;
+}
+
+static boolByte _openSampleSourceTcp(void *selfPtr,
+                                     const SampleSourceOpenAs openAs) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceTcpData extraData = (SampleSourceTcpData)self->extraData;
+  byte header[SAMPLE_SOURCE_TCP_HEADER_SIZE];
+  Socket listener;
+  unsigned short version;
+
+  if (!_parseTcpName(self)) {
+    return false;
+  }
+
+  if (charStringIsEmpty(extraData->host)) {
+    listener = newSocketListeningOnHost(extraData->host, extraData->port);
+
+    if (listener == NULL) {
+      return false;
+    }
+
+    logInfo("Waiting for connection on port %u", extraData->port);
+    extraData->socket = socketAccept(listener);
+    freeSocket(listener);
+  } else {
+    extraData->socket =
+        newSocketConnectedToHost(extraData->host, extraData->port);
+  }
+
+  if (extraData->socket == NULL) {
+    logError("TCP source '%s' could not be opened", self->sourceName->data);
+    return false;
+  }
+
+  socketSetStreamingOptions(extraData->socket,
+                            kSampleSourceTcpSocketBufferSize);
+
+  if (openAs == SAMPLE_SOURCE_OPEN_READ) {
+    if (socketRead(extraData->socket, header, sizeof(header)) !=
+        sizeof(header)) {
+      logError("TCP source '%s' closed before sending a header",
+               self->sourceName->data);
+      return false;
+    } else if (memcmp(header, kSampleSourceTcpMagic,
+                      sizeof(kSampleSourceTcpMagic)) != 0) {
+      logError("TCP source '%s' is not sending a MrsWatson PCM stream",
+               self->sourceName->data);
+      return false;
+    }
+
+    version = _getLittleEndianShort(header + 4);
+
+    if (version != kSampleSourceTcpVersion) {
+      logError("TCP source '%s' uses unsupported stream version %d",
+               self->sourceName->data, version);
+      return false;
+    }
+
+    extraData->numChannels = _getLittleEndianShort(header + 6);
+    extraData->sampleRate = _getLittleEndianInt(header + 8);
+    extraData->bitDepth = (BitDepth)_getLittleEndianShort(header + 12);
+
+    if (extraData->bitDepth != kBitDepth8Bit &&
+        extraData->bitDepth != kBitDepth16Bit &&
+        extraData->bitDepth != kBitDepth24Bit &&
+        extraData->bitDepth != kBitDepth32Bit) {
+      logError("TCP source '%s' has invalid bit depth %d",
+               self->sourceName->data, extraData->bitDepth);
+      return false;
+    }
+
+    if (!setNumChannels(extraData->numChannels) ||
+        !setSampleRate(extraData->sampleRate)) {
+      return false;
+    }
+  } else if (openAs != SAMPLE_SOURCE_OPEN_WRITE) {
+    logInternalError("Invalid type for openAs in TCP source");
+    return false;
+  }
+
+  logInfo("Connected TCP source '%s'", self->sourceName->data);
+  self->openedAs = openAs;
+  return true;
+}
+
+// Read audio data from the stream, crossing frame boundaries as needed
+static size_t _readStreamData(SampleSourceTcpData extraData, byte *dest,
+                              size_t numBytes) {
+  byte frameSize[4];
+  size_t numRead = 0;
+  size_t chunkSize;
+  size_t chunkRead;
+
+  while (numRead < numBytes && !extraData->endOfStream) {
+    if (extraData->frameBytesRemaining == 0) {
+      if (socketRead(extraData->socket, frameSize,
+                     kSampleSourceTcpFrameSizeBytes) !=
+          kSampleSourceTcpFrameSizeBytes) {
+        logWarn("TCP stream was closed without an end marker");
+        extraData->endOfStream = true;
+        break;
+      }
+
+      extraData->frameBytesRemaining = _getLittleEndianInt(frameSize);
+
+      if (extraData->frameBytesRemaining == 0) {
+        logDebug("End of TCP stream reached");
+        extraData->endOfStream = true;
+        break;
+      }
+    }
+
+    chunkSize = numBytes - numRead;
+
+    if (chunkSize > extraData->frameBytesRemaining) {
+      chunkSize = extraData->frameBytesRemaining;
+    }
+
+    chunkRead = socketRead(extraData->socket, dest + numRead, chunkSize);
+    numRead += chunkRead;
+    extraData->frameBytesRemaining -= chunkRead;
+
+    if (chunkRead < chunkSize) {
+      logWarn("TCP stream was closed in the middle of a frame");
+      extraData->endOfStream = true;
+    }
+  }
+
+  return numRead;
+}
+
+static boolByte _readBlockFromTcp(void *selfPtr, SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceTcpData extraData = (SampleSourceTcpData)self->extraData;
+  const SampleCount originalBlocksize = sampleBuffer->blocksize;
+  size_t bytesPerFrame;
+  size_t numBytes;
+  size_t numRead;
+  SampleBuffer internalSampleBuffer = NULL;
+
+  if (extraData->pcmSampleBuffer != NULL) {
+    internalSampleBuffer =
+        extraData->pcmSampleBuffer->getSampleBuffer(extraData->pcmSampleBuffer);
+  }
+
+  if (internalSampleBuffer == NULL ||
+      internalSampleBuffer->blocksize != sampleBuffer->blocksize) {
+    freePcmSampleBuffer(extraData->pcmSampleBuffer);
+    extraData->pcmSampleBuffer = newPcmSampleBuffer(
+        extraData->numChannels, sampleBuffer->blocksize, extraData->bitDepth);
+  }
+
+  bytesPerFrame =
+      extraData->numChannels * extraData->pcmSampleBuffer->bytesPerSample;
+  numBytes = bytesPerFrame * sampleBuffer->blocksize;
+  numRead = _readStreamData(extraData, extraData->pcmSampleBuffer->pcmSamples,
+                            numBytes);
+
+  if (numRead < numBytes) {
+    // Anything after a partial frame is silence
+    memset((byte *)extraData->pcmSampleBuffer->pcmSamples + numRead, 0,
+           numBytes - numRead);
+  }
+
+  pcmSampleBufferConvertAndMapChannels(
+      extraData->pcmSampleBuffer, extraData->pcmSampleBuffer->pcmSamples,
+      extraData->numChannels, sampleBuffer);
+
+  sampleBuffer->blocksize = (SampleCount)(numRead / bytesPerFrame);
+  self->numSamplesProcessed +=
+      sampleBuffer->blocksize * sampleBuffer->numChannels;
+  logDebugFast("Read %d frames from TCP stream", sampleBuffer->blocksize);
+  return (boolByte)(sampleBuffer->blocksize == originalBlocksize);
+}
+
+static boolByte _sendHeader(SampleSourceTcpData extraData,
+                            ChannelCount numChannels) {
+  byte header[SAMPLE_SOURCE_TCP_HEADER_SIZE];
+
+  extraData->numChannels = numChannels;
+  extraData->sampleRate = getSampleRate();
+  extraData->bitDepth = getBitDepth();
+
+  memset(header, 0, sizeof(header));
+  memcpy(header, kSampleSourceTcpMagic, sizeof(kSampleSourceTcpMagic));
+  _putLittleEndianShort(header + 4, kSampleSourceTcpVersion);
+  _putLittleEndianShort(header + 6, (unsigned short)numChannels);
+  _putLittleEndianInt(header + 8, (unsigned int)extraData->sampleRate);
+  _putLittleEndianShort(header + 12, (unsigned short)extraData->bitDepth);
+
+  extraData->headerSent = true;
+  return socketWrite(extraData->socket, header, sizeof(header));
+}
+
+static boolByte _writeBlockToTcp(void *selfPtr,
+                                 const SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceTcpData extraData = (SampleSourceTcpData)self->extraData;
+  SampleBuffer internalSampleBuffer = NULL;
+  size_t payloadSize;
+
+  if (!extraData->headerSent &&
+      !_sendHeader(extraData, sampleBuffer->numChannels)) {
+    logError("Could not send header to TCP output '%s'",
+             self->sourceName->data);
+    return false;
+  }
+
+  if (sampleBuffer->numChannels != extraData->numChannels) {
+    logError("Cannot change the channel count of TCP output '%s'",
+             self->sourceName->data);
+    return false;
+  } else if (sampleBuffer->blocksize == 0) {
+    // An empty frame would end the stream
+    return true;
+  }
+
+  if (extraData->pcmSampleBuffer != NULL) {
+    internalSampleBuffer =
+        extraData->pcmSampleBuffer->getSampleBuffer(extraData->pcmSampleBuffer);
+  }
+
+  // Like PCM files, smaller blocks fit into the existing buffers
+  if (internalSampleBuffer == NULL ||
+      internalSampleBuffer->blocksize < sampleBuffer->blocksize) {
+    freePcmSampleBuffer(extraData->pcmSampleBuffer);
+    extraData->pcmSampleBuffer = newPcmSampleBuffer(
+        extraData->numChannels, sampleBuffer->blocksize, extraData->bitDepth);
+    free(extraData->frameBuffer);
+    extraData->frameBufferSize =
+        kSampleSourceTcpFrameSizeBytes +
+        sampleBuffer->blocksize * extraData->numChannels *
+            extraData->pcmSampleBuffer->bytesPerSample;
+    extraData->frameBuffer = (byte *)malloc(extraData->frameBufferSize);
+  }
+
+  extraData->pcmSampleBuffer->setSampleBuffer(extraData->pcmSampleBuffer,
+                                              sampleBuffer);
+  payloadSize = sampleBuffer->blocksize * sampleBuffer->numChannels *
+                extraData->pcmSampleBuffer->bytesPerSample;
+  _putLittleEndianInt(extraData->frameBuffer, (unsigned int)payloadSize);
+  memcpy(extraData->frameBuffer + kSampleSourceTcpFrameSizeBytes,
+         extraData->pcmSampleBuffer->pcmSamples, payloadSize);
+
+  if (!socketWrite(extraData->socket, extraData->frameBuffer,
+                   kSampleSourceTcpFrameSizeBytes + payloadSize)) {
+    logError("Could not write to TCP output '%s'", self->sourceName->data);
+    return false;
+  }
+
+  self->numSamplesProcessed +=
+      sampleBuffer->blocksize * sampleBuffer->numChannels;
+  logDebugFast("Wrote %d frames to TCP stream", sampleBuffer->blocksize);
+  return true;
+}
+
+static void _closeSampleSourceTcp(void *selfPtr) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceTcpData extraData = (SampleSourceTcpData)self->extraData;
+  byte endMarker[4] = {0, 0, 0, 0};
+
+  if (extraData->socket != NULL && self->openedAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    // Outputs which never received a block still send a header, so that the
+    // reader sees a valid but empty stream
+    if (!extraData->headerSent) {
+      _sendHeader(extraData, getNumChannels());
+    }
+
+    socketWrite(extraData->socket, endMarker, sizeof(endMarker));
+  }
+
+  freeSocket(extraData->socket);
+  extraData->socket = NULL;
+}
+
+static void _freeSampleSourceDataTcp(void *extraDataPtr) {
+  SampleSourceTcpData extraData = (SampleSourceTcpData)extraDataPtr;
+  freeCharString(extraData->host);
+  freeSocket(extraData->socket);
+  freePcmSampleBuffer(extraData->pcmSampleBuffer);
+  free(extraData->frameBuffer);
+  free(extraData);
+}
+
+SampleSource _newSampleSourceTcp(const CharString sampleSourceName) {
+  SampleSource sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  SampleSourceTcpData extraData =
+      (SampleSourceTcpData)malloc(sizeof(SampleSourceTcpDataMembers));
+
+  sampleSource->sampleSourceType = SAMPLE_SOURCE_TYPE_TCP;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, sampleSourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceTcp;
+  sampleSource->readSampleBlock = _readBlockFromTcp;
+  sampleSource->writeSampleBlock = _writeBlockToTcp;
+  sampleSource->seekSampleSource = NULL;
+  sampleSource->closeSampleSource = _closeSampleSourceTcp;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataTcp;
+
+  extraData->host = newCharString();
+  extraData->port = 0;
+  extraData->socket = NULL;
+  extraData->pcmSampleBuffer = NULL;
+  extraData->numChannels = 0;
+  extraData->sampleRate = 0.0;
+  extraData->bitDepth = kBitDepthDefault;
+  extraData->frameBytesRemaining = 0;
+  extraData->endOfStream = false;
+  extraData->headerSent = false;
+  extraData->frameBuffer = NULL;
+  extraData->frameBufferSize = 0;
+
+  sampleSource->extraData = extraData;
+  return sampleSource;
+}
@@ -0,0 +1,74 @@
+//
+// SampleSourceTcp.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_SampleSourceTcp_h
+#define MrsWatson_SampleSourceTcp_h
+
+#include "audio/PcmSampleBuffer.h"
+#include "base/Socket.h"
+#include "io/SampleSource.h"
+
+// Sources with this prefix stream audio over a TCP connection. A name like
+// "tcp://host:port" connects to another machine, and a name without a host
+// such as "tcp://:port" waits for the other machine to connect.
+#define SAMPLE_SOURCE_TCP_PREFIX "tcp://"
+
+// The stream starts with a header of this many bytes, containing the magic
+// "MWPC", a format version, the channel count, sample rate and bit depth.
+// After that, the audio data follows as frames of interleaved little-endian
+// PCM, each preceded by its size in bytes. A frame of size 0 ends the stream.
+#define SAMPLE_SOURCE_TCP_HEADER_SIZE 16
+
+typedef struct {
+  CharString host;
+  unsigned short port;
+  Socket socket;
+  PcmSampleBuffer pcmSampleBuffer;
+
+  ChannelCount numChannels;
+  SampleRate sampleRate;
+  BitDepth bitDepth;
+
+  // Frames are not necessarily the same size as blocks, so this many bytes of
+  // the current frame still need to be read before the next size follows
+  size_t frameBytesRemaining;
+  boolByte endOfStream;
+  // For outputs, the header is sent with the first block so that it contains
+  // the final channel count and sample rate
+  boolByte headerSent;
+  // Size and audio data of one outgoing frame, sent with a single write
+  byte *frameBuffer;
+  size_t frameBufferSize;
+} SampleSourceTcpDataMembers;
+typedef SampleSourceTcpDataMembers *SampleSourceTcpData;
+
+/**
+ * @param sampleSourceName Name of a sample source
+ * @return True if the name refers to a TCP stream rather than a file
+ */
+boolByte sampleSourceIsTcpName(const CharString sampleSourceName);
+
+#endif
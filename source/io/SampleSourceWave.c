@@ -38,11 +38,32 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if UNIX
+#include <unistd.h>
+#endif
+
+// Sizes in RF64 files which are too large for a RIFF chunk are replaced with
+// this value, and the real sizes are stored in the ds64 chunk instead
+static const unsigned int kWaveRf64SizePlaceholder = 0xffffffff;
+// The ds64 chunk holds the 64-bit RIFF size, data size and frame count, and a
+// table length which is always 0 here
+static const unsigned int kWaveDs64ChunkSize = 28;
+// While writing, the header sizes are updated after each interval of audio so
+// that the output can be read before it is closed, or after a crash
+static const unsigned int kWaveHeaderUpdateIntervalInSeconds = 1;
+
+static unsigned long long _convertByteArrayToUnsigned64(const byte *value) {
+  return (unsigned long long)convertByteArrayToUnsignedInt(value) |
+         ((unsigned long long)convertByteArrayToUnsignedInt(value + 4) << 32);
+}
+
 static boolByte _readWaveFileInfo(const char *filename,
                                   SampleSourcePcmData extraData) {
   int chunkOffset = 0;
   RiffChunk chunk = newRiffChunk();
-  boolByte dataChunkFound = false;
+  RiffChunkIndex index;
+  boolByte isRf64;
+  unsigned long long rf64DataSize = 0;
   char format[4];
   size_t itemsRead;
   unsigned int audioFormat;
@@ -52,7 +73,10 @@ static boolByte _readWaveFileInfo(const char *filename,
   unsigned int expectedBlockAlign;
 
   if (riffChunkReadNext(chunk, extraData->fileHandle, false)) {
-    if (!riffChunkIsIdEqualTo(chunk, "RIFF")) {
+    isRf64 = riffChunkIsIdEqualTo(chunk, "RF64") ||
+             riffChunkIsIdEqualTo(chunk, "BW64");
+
+    if (!isRf64 && !riffChunkIsIdEqualTo(chunk, "RIFF")) {
       logFileError(filename, "Invalid RIFF chunk descriptor");
       freeRiffChunk(chunk);
       return false;
@@ -76,9 +100,34 @@ static boolByte _readWaveFileInfo(const char *filename,
     return false;
   }
 
-  if (riffChunkReadNext(chunk, extraData->fileHandle, true)) {
-    if (!riffChunkIsIdEqualTo(chunk, "fmt ")) {
-      logError(filename, "Invalid format chunk header");
+  // Broadcast WAVE files may have large bext, iXML or JUNK chunks before the
+  // audio data, so the chunks are found through an index which seeks over
+  // them. Only the chunks which are parsed here are read. RF64 files have a
+  // ds64 chunk with the 64-bit sizes before the format chunk.
+  index = newRiffChunkIndex(extraData->fileHandle, false);
+
+  if (index == NULL) {
+    logFileError(filename, "Could not seek in WAVE file");
+    freeRiffChunk(chunk);
+    return false;
+  }
+
+  if (isRf64 && riffChunkIndexFind(index, "ds64", chunk, false) &&
+      chunk->size >= 16) {
+    if (!riffChunkReadData(chunk, extraData->fileHandle)) {
+      logFileError(filename, "Invalid ds64 chunk");
+      freeRiffChunkIndex(index);
+      freeRiffChunk(chunk);
+      return false;
+    }
+
+    rf64DataSize = _convertByteArrayToUnsigned64(chunk->data + 8);
+  }
+
+  if (riffChunkIndexFind(index, "fmt ", chunk, false)) {
+    if (chunk->size < 16 || !riffChunkReadData(chunk, extraData->fileHandle)) {
+      logFileError(filename, "Invalid format chunk");
+      freeRiffChunkIndex(index);
       freeRiffChunk(chunk);
       return false;
     }
@@ -88,6 +137,7 @@ static boolByte _readWaveFileInfo(const char *filename,
 
     if (audioFormat != 1) {
       logError("WAVE file with audio format %d is not supported", audioFormat);
+      freeRiffChunkIndex(index);
       freeRiffChunk(chunk);
       return false;
     }
@@ -114,6 +164,7 @@ static boolByte _readWaveFileInfo(const char *filename,
     if (extraData->bitDepth != kBitDepth16Bit) {
       logUnsupportedFeature("Non-16-bit files with internal WAVE file support "
                             "(build with audiofile instead!)");
+      freeRiffChunkIndex(index);
       freeRiffChunk(chunk);
       return false;
     }
@@ -134,40 +185,34 @@ static boolByte _readWaveFileInfo(const char *filename,
               expectedBlockAlign);
     }
   } else {
-    logFileError(filename, "WAVE file has no chunks following format");
+    logFileError(filename, "WAVE file has no format chunk");
+    freeRiffChunkIndex(index);
     freeRiffChunk(chunk);
     return false;
   }
 
-  // We don't need the format data anymore, so free and re-alloc the chunk to
-  // avoid a small memory leak
-  freeRiffChunk(chunk);
-  chunk = newRiffChunk();
-
   // FFMpeg (and possibly other programs) have extra sections between the fmt
-  // and data chunks. They
-  // can be safely ignored. We just need to find the data chunk. See also:
+  // and data chunks, which the index skips over. See also:
   // http://forum.videohelp.com/threads/359689-ffmpeg-Override-Set-ISFT-Metadata
-  while (!dataChunkFound) {
-    if (riffChunkReadNext(chunk, extraData->fileHandle, false)) {
-      if (riffChunkIsIdEqualTo(chunk, "data")) {
-        logDebug("WAVE file has %d bytes", chunk->size);
-        dataChunkFound = true;
-      } else {
-        fseek(extraData->fileHandle, (long)chunk->size, SEEK_CUR);
-      }
-    } else {
-      break;
-    }
-  }
-
-  if (!dataChunkFound) {
+  // The file is left positioned at the start of the audio data.
+  if (!riffChunkIndexFind(index, "data", chunk, false)) {
     logFileError(filename,
                  "Could not find a data chunk. Possibly malformed WAVE file.");
+    freeRiffChunkIndex(index);
     freeRiffChunk(chunk);
     return false;
   }
 
+  logDebug("WAVE file has %d bytes", chunk->size);
+  extraData->dataOffset = (size_t)ftell(extraData->fileHandle);
+  extraData->dataSize = chunk->size;
+
+  if (isRf64 && chunk->size == kWaveRf64SizePlaceholder) {
+    extraData->dataSize = (size_t)rf64DataSize;
+    logDebug("RF64 file has %llu bytes", rf64DataSize);
+  }
+
+  freeRiffChunkIndex(index);
   freeRiffChunk(chunk);
   return true;
 }
@@ -206,6 +251,22 @@ static boolByte _writeWaveFileInfo(SampleSourcePcmData extraData) {
     return false;
   }
 
+  // Reserve space for a ds64 chunk, so that the file can be turned into an RF64
+  // file in place if the audio data outgrows the 32-bit RIFF sizes
+  memcpy(chunk->id, "JUNK", 4);
+  chunk->size = kWaveDs64ChunkSize;
+  chunk->data = (byte *)calloc(kWaveDs64ChunkSize, sizeof(byte));
+
+  if (fwrite(chunk->id, sizeof(byte), 4, extraData->fileHandle) != 4 ||
+      fwrite(&(chunk->size), sizeof(unsigned int), 1, extraData->fileHandle) !=
+          1 ||
+      fwrite(chunk->data, sizeof(byte), kWaveDs64ChunkSize,
+             extraData->fileHandle) != kWaveDs64ChunkSize) {
+    logError("Could not write JUNK chunk");
+    freeRiffChunk(chunk);
+    return false;
+  }
+
   // Write the format header
   memcpy(chunk->id, "fmt ", 4);
   chunk->size = 20;
@@ -315,7 +376,11 @@ static boolByte _openSampleSourceWave(void *sampleSourcePtr,
       }
     }
   } else if (openAs == SAMPLE_SOURCE_OPEN_WRITE) {
-    extraData->fileHandle = fopen(sampleSource->sourceName->data, "wb");
+    // A resumed output already exists, so it must not be truncated. Its header
+    // is written again, and the final sizes are set when closing as usual.
+    extraData->fileHandle = fopen(sampleSource->sourceName->data,
+                                  extraData->resumeFrame > 0 ? "r+b" : "wb");
+    sampleSourcePcmBufferOutput(extraData);
 
     if (extraData->fileHandle != NULL) {
       extraData->numChannels = (unsigned short)getNumChannels();
@@ -325,6 +390,16 @@ static boolByte _openSampleSourceWave(void *sampleSourcePtr,
       if (!_writeWaveFileInfo(extraData)) {
         fclose(extraData->fileHandle);
         extraData->fileHandle = NULL;
+      } else {
+        extraData->dataOffset = (size_t)ftell(extraData->fileHandle);
+
+        if (!sampleSourcePcmSeekResumeFrame(sampleSource)) {
+          fclose(extraData->fileHandle);
+          extraData->fileHandle = NULL;
+        } else {
+          sampleSourcePcmSetupSparseOutput(extraData,
+                                           extraData->resumeFrame > 0);
+        }
       }
     }
   } else {
@@ -353,25 +428,122 @@ static boolByte _readBlockFromWaveFile(void *sampleSourcePtr,
   return (boolByte)(originalBlocksize == sampleBuffer->blocksize);
 }
 
+// The stream must have been flushed before a value is written. On UNIX, the
+// value is written with pwrite(), which leaves the stream position as it is.
+static boolByte _writeWaveValueAt(FILE *fileHandle, long offset,
+                                  const void *value, size_t size) {
+#if UNIX
+  return (boolByte)(pwrite(fileno(fileHandle), value, size, (off_t)offset) ==
+                    (ssize_t)size);
+#else
+  return (boolByte)(fseek(fileHandle, offset, SEEK_SET) == 0 &&
+                    fwrite(value, size, 1, fileHandle) == 1);
+#endif
+}
+
+// Write the current chunk sizes to the header. If the audio data is too large
+// for a RIFF file, then the header is upgraded to RF64 by turning the JUNK
+// chunk written by _writeWaveFileInfo() into a ds64 chunk.
+static boolByte _writeWaveFileSizes(SampleSource sampleSource) {
+  SampleSourcePcmData extraData = (SampleSourcePcmData)sampleSource->extraData;
+  const long dataSizeOffset = (long)extraData->dataOffset - 4;
+  unsigned long long ds64[3];
+  unsigned int riffSize;
+  unsigned int dataSize;
+
+  // RIFF size, data size and frame count as used by the ds64 chunk. A resumed
+  // output also holds the frames which were kept from before.
+  ds64[1] = ((unsigned long long)sampleSource->numSamplesProcessed +
+             (unsigned long long)extraData->resumeFrame *
+                 extraData->numChannels) *
+            (extraData->bitDepth / 8);
+  ds64[0] = extraData->dataOffset - 8 + ds64[1];
+  ds64[2] = extraData->numChannels > 0
+                ? ds64[1] / (extraData->numChannels * (extraData->bitDepth / 8))
+                : 0;
+
+  if (ds64[0] <= kWaveRf64SizePlaceholder) {
+    riffSize = (unsigned int)ds64[0];
+    dataSize = (unsigned int)ds64[1];
+    return (boolByte)(
+        _writeWaveValueAt(extraData->fileHandle, 4, &riffSize,
+                          sizeof(riffSize)) &&
+        _writeWaveValueAt(extraData->fileHandle, dataSizeOffset, &dataSize,
+                          sizeof(dataSize)));
+  }
+
+  logDebug("WAVE file is larger than 4GB, writing RF64 header");
+  riffSize = kWaveRf64SizePlaceholder;
+  dataSize = kWaveRf64SizePlaceholder;
+  return (boolByte)(
+      _writeWaveValueAt(extraData->fileHandle, 0, "RF64", 4) &&
+      _writeWaveValueAt(extraData->fileHandle, 4, &riffSize,
+                        sizeof(riffSize)) &&
+      _writeWaveValueAt(extraData->fileHandle, 12, "ds64", 4) &&
+      _writeWaveValueAt(extraData->fileHandle, 20, ds64, sizeof(ds64)) &&
+      _writeWaveValueAt(extraData->fileHandle, dataSizeOffset, &dataSize,
+                        sizeof(dataSize)));
+}
+
+// Write the sizes of the audio which has been written so far to the header,
+// and continue writing where the output left off
+static boolByte _updateWaveFileSizes(SampleSource sampleSource) {
+  SampleSourcePcmData extraData = (SampleSourcePcmData)sampleSource->extraData;
+#if !UNIX
+  long position;
+#endif
+
+  // Blocks which are still in flight or a skipped silent block at the end
+  // must be on disk before they are counted
+  sampleSourcePcmSyncIoRing(extraData);
+  sampleSourcePcmFinishSparseOutput(extraData);
+
+  if (fflush(extraData->fileHandle) != 0) {
+    return false;
+  }
+
+#if UNIX
+  return _writeWaveFileSizes(sampleSource);
+#else
+  position = ftell(extraData->fileHandle);
+  return (boolByte)(position >= 0 && _writeWaveFileSizes(sampleSource) &&
+                    fseek(extraData->fileHandle, position, SEEK_SET) == 0);
+#endif
+}
+
 static boolByte _writeBlockToWaveFile(void *sampleSourcePtr,
                                       const SampleBuffer sampleBuffer) {
   SampleSource sampleSource = (SampleSource)sampleSourcePtr;
   SampleSourcePcmData extraData = (SampleSourcePcmData)sampleSource->extraData;
+  const SampleCount updateInterval = (SampleCount)extraData->sampleRate *
+                                     extraData->numChannels *
+                                     kWaveHeaderUpdateIntervalInSeconds;
+  const SampleCount previousSamples = sampleSource->numSamplesProcessed;
   unsigned int samplesWritten =
       (int)sampleSourcePcmWrite(extraData, sampleBuffer);
   sampleSource->numSamplesProcessed += samplesWritten;
-  return (boolByte)(samplesWritten == sampleBuffer->blocksize);
+
+  if (updateInterval > 0 &&
+      previousSamples / updateInterval !=
+          sampleSource->numSamplesProcessed / updateInterval &&
+      !_updateWaveFileSizes(sampleSource)) {
+    logWarn("Could not update WAVE file size while writing");
+  }
+
+  return (boolByte)(samplesWritten ==
+                    sampleBuffer->blocksize * sampleBuffer->numChannels);
 }
 
 void _closeSampleSourceWave(void *sampleSourceDataPtr) {
   SampleSource sampleSource = (SampleSource)sampleSourceDataPtr;
   SampleSourcePcmData extraData = (SampleSourcePcmData)sampleSource->extraData;
-  size_t numBytesWritten;
-  RiffChunk chunk;
 
   if (sampleSource->openedAs == SAMPLE_SOURCE_OPEN_WRITE) {
     // Re-open the file for editing
+    sampleSourcePcmFreeIoRing(extraData);
+    sampleSourcePcmFinishSparseOutput(extraData);
     fflush(extraData->fileHandle);
+    sampleSourcePcmReleasePreallocation(extraData);
 
     if (fclose(extraData->fileHandle) != 0) {
       logError("Could not close WAVE file for finalization");
@@ -385,65 +557,17 @@ void _closeSampleSourceWave(void *sampleSourceDataPtr) {
       return;
     }
 
-    // First go to the second chunk in the file and re-read the chunk length
-    if (fseek(extraData->fileHandle, 12, SEEK_SET) != 0) {
-      logError("Could not seek to second chunk during WAVE file finalization");
-      fclose(extraData->fileHandle);
-      return;
-    }
-
-    chunk = newRiffChunk();
-
-    if (!riffChunkReadNext(chunk, extraData->fileHandle, false)) {
-      logError("Could not read RIFF chunk during WAVE file finalization");
-      fclose(extraData->fileHandle);
-      freeRiffChunk(chunk);
-      return;
-    }
-
-    // Go to the next chunk, and then skip the type and write the new length
-    if (fseek(extraData->fileHandle, (long)(chunk->size + 4), SEEK_CUR) != 0) {
-      logError("Could not seek to next chunk during WAVE file finalization");
-      fclose(extraData->fileHandle);
-      freeRiffChunk(chunk);
-      return;
-    }
-
-    numBytesWritten =
-        sampleSource->numSamplesProcessed * extraData->bitDepth / 8;
-
-    if (fwrite(&numBytesWritten, sizeof(unsigned int), 1,
-               extraData->fileHandle) != 1) {
+    if (!_writeWaveFileSizes(sampleSource)) {
       logError("Could not write WAVE file size during finalization");
-      fclose(extraData->fileHandle);
-      freeRiffChunk(chunk);
-      return;
-    }
-
-    // Add 40 bytes for fmt chunk size and write the RIFF chunk size
-    numBytesWritten += ftell(extraData->fileHandle) - 8;
-
-    if (fseek(extraData->fileHandle, 4, SEEK_SET) != 0) {
-      logError("Could not seek to fmt chunk during WAVE file finalization");
-      fclose(extraData->fileHandle);
-      freeRiffChunk(chunk);
-      return;
-    }
-
-    if (fwrite(&numBytesWritten, sizeof(unsigned int), 1,
-               extraData->fileHandle) != 1) {
-      logError(
-          "Could not write WAVE file size in fmt chunk during finalization");
-      fclose(extraData->fileHandle);
-      freeRiffChunk(chunk);
-      return;
     }
 
     fflush(extraData->fileHandle);
     fclose(extraData->fileHandle);
-    freeRiffChunk(chunk);
   } else if (sampleSource->openedAs == SAMPLE_SOURCE_OPEN_READ &&
              extraData->fileHandle != NULL) {
+    freeMappedFile(extraData->mappedFile);
+    extraData->mappedFile = NULL;
+    sampleSourcePcmFreeIoRing(extraData);
     fclose(extraData->fileHandle);
   }
 }
@@ -462,11 +586,14 @@ SampleSource _newSampleSourceWave(const CharString sampleSourceName) {
   sampleSource->openSampleSource = _openSampleSourceWave;
   sampleSource->readSampleBlock = _readBlockFromWaveFile;
   sampleSource->writeSampleBlock = _writeBlockToWaveFile;
+  sampleSource->seekSampleSource = sampleSourcePcmSeek;
   sampleSource->closeSampleSource = _closeSampleSourceWave;
   sampleSource->freeSampleSourceData = freeSampleSourceDataPcm;
 
   extraData->isStream = false;
+  extraData->isPipe = false;
   extraData->isLittleEndian = true;
+  extraData->isPlanar = false;
   extraData->fileHandle = NULL;
   // Assume default values for these items. However, if an incoming SampleBuffer
   // has different values for the channel count or blocksize, then we will
@@ -475,6 +602,22 @@ SampleSource _newSampleSourceWave(const CharString sampleSourceName) {
   extraData->dataBufferNumItems = getNumChannels() * getBlocksize();
   extraData->pcmSampleBuffer =
       newPcmSampleBuffer(getNumChannels(), getBlocksize(), getBitDepth());
+  extraData->dataOffset = 0;
+  extraData->dataSize = 0;
+  extraData->mappedFile = NULL;
+  extraData->mappedReadPosition = 0;
+  extraData->mappedDataEnd = 0;
+  extraData->ioRing = NULL;
+  extraData->ioRingStarted = false;
+  extraData->ioRingSlot = 0;
+  extraData->ioRingOffset = 0;
+  extraData->ioRingQueueOffset = 0;
+  extraData->ioRingEnd = 0;
+  extraData->preallocated = false;
+  extraData->resumeFrame = 0;
+  extraData->skipSilentConversion = false;
+  extraData->seekOverSilence = false;
+  extraData->silenceAtEnd = false;
 
   extraData->numChannels = (unsigned short)getNumChannels();
   extraData->sampleRate = (unsigned int)getSampleRate();
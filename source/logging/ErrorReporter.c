@@ -27,9 +27,12 @@
 #include "ErrorReporter.h"
 
 #include "app/BuildInfo.h"
+#include "app/LiveMetrics.h"
+#include "audio/AudioSettings.h"
 #include "base/File.h"
 #include "base/PlatformInfo.h"
 #include "logging/EventLogger.h"
+#include "time/TraceEvents.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -251,7 +254,6 @@ boolByte errorReporterCopyPlugins(ErrorReporter self, PluginChain pluginChain) {
   Plugin currentPlugin = NULL;
   boolByte failed = false;
   unsigned int i;
-  PlatformInfo platform = newPlatformInfo();
 
   for (i = 0; i < pluginChain->numPlugins; i++) {
     currentPlugin = pluginChain->plugins[i];
@@ -261,17 +263,122 @@ boolByte errorReporterCopyPlugins(ErrorReporter self, PluginChain pluginChain) {
       logInfo(
           "Plugin '%s' does not have an absolute path and could not be copied",
           currentPlugin->pluginName->data);
-    } else if (platform->type == PLATFORM_MACOSX) {
+    } else if (platformInfoGetType() == PLATFORM_MACOSX) {
       failed |= !_copyDirectoryToErrorReportDir(self, pluginAbsolutePath);
     } else {
       failed |= !errorReportCopyFileToReport(self, pluginAbsolutePath);
     }
   }
 
-  freePlatformInfo(platform);
   return (boolByte)!failed;
 }
 
+static void _errorReporterWriteJsonString(FILE *file, const char *string) {
+  const char *c;
+
+  fputc('"', file);
+  for (c = string; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      fprintf(file, "\\%c", *c);
+    } else if ((unsigned char)*c < 0x20) {
+      fprintf(file, "\\u%04x", (unsigned char)*c);
+    } else {
+      fputc(*c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+static void _errorReporterWriteLatencyJson(FILE *file,
+                                           const LatencyHistogram latency) {
+  fprintf(file,
+          "{\"blocks\": %lu, \"p99_ms\": %f, \"max_ms\": %f, "
+          "\"max_block\": %lu, \"deadline_misses\": %lu}",
+          latency->numValues, latencyHistogramGetPercentile(latency, 99.0),
+          latency->maxValue, latency->maxValueIndex,
+          latency->numDeadlineMisses);
+}
+
+boolByte errorReporterWritePerformanceSnapshot(ErrorReporter self,
+                                               const PluginChain pluginChain,
+                                               const char *reason) {
+  CharString path = newCharString();
+  const unsigned int numBlocks = pluginChainGetNumRecentBlocks(pluginChain);
+  FILE *file;
+  unsigned int block;
+  unsigned int i;
+
+  charStringCopyCString(path, "performance.json");
+  errorReporterRemapPath(self, path);
+  file = fopen(path->data, "w");
+
+  if (file == NULL) {
+    logError("Could not open '%s' to write performance snapshot", path->data);
+    freeCharString(path);
+    return false;
+  }
+
+  fprintf(file, "{\n  \"reason\": ");
+  _errorReporterWriteJsonString(file, reason);
+  fprintf(file, ",\n  \"sample_rate\": %f,\n", getSampleRate());
+  fprintf(file, "  \"blocksize\": %lu,\n", getBlocksize());
+  fprintf(file, "  \"resident_memory_kb\": %lu,\n",
+          platformInfoGetMemoryUsage());
+  fprintf(file, "  \"peak_memory_kb\": %lu,\n",
+          platformInfoGetPeakMemoryUsage());
+  fprintf(file, "  \"queued_blocks\": {\"prefetch\": %d, "
+                "\"write_behind\": %d},\n",
+          liveMetricsGetQueuedBlocks(LIVE_METRICS_QUEUE_PREFETCH),
+          liveMetricsGetQueuedBlocks(LIVE_METRICS_QUEUE_WRITE_BEHIND));
+  fprintf(file, "  \"chain\": ");
+  _errorReporterWriteLatencyJson(file, pluginChain->chainLatency);
+  fprintf(file, ",\n  \"plugins\": [");
+
+  for (i = 0; i < pluginChain->numPlugins; i++) {
+    fprintf(file, "%s\n    {\"name\": ", i > 0 ? "," : "");
+    _errorReporterWriteJsonString(file,
+                                  pluginChain->plugins[i]->pluginName->data);
+    fprintf(file, ", \"latency\": ");
+    _errorReporterWriteLatencyJson(file, pluginChain->audioLatencies[i]);
+    fprintf(file, "}");
+  }
+
+  // Oldest block first, so that the blocks read in the order they happened
+  fprintf(file, "\n  ],\n  \"recent_blocks\": [");
+
+  for (block = numBlocks; block > 0; block--) {
+    fprintf(file, "%s\n    {\"chain_ms\": %f, \"plugin_ms\": [",
+            block < numBlocks ? "," : "",
+            pluginChainGetRecentBlockTime(pluginChain, block - 1,
+                                          pluginChain->numPlugins));
+
+    for (i = 0; i < pluginChain->numPlugins; i++) {
+      fprintf(file, "%s%f", i > 0 ? ", " : "",
+              pluginChainGetRecentBlockTime(pluginChain, block - 1, i));
+    }
+
+    fprintf(file, "]}");
+  }
+
+  fprintf(file, "\n  ]\n}\n");
+  fclose(file);
+  logInfo("Wrote performance snapshot to '%s'", path->data);
+
+  if (traceEventsIsEnabled()) {
+    traceEventsStop();
+    charStringCopyCString(path, "trace.json");
+    errorReporterRemapPath(self, path);
+
+    if (traceEventsWriteJson(path)) {
+      logInfo("Wrote %lu trace events to '%s'", traceEventsGetNumEvents(),
+              path->data);
+    }
+  }
+
+  freeCharString(path);
+  return true;
+}
+
 void errorReporterClose(ErrorReporter self) {
   // Always do this, just in case
   flushErrorLog();
@@ -95,6 +95,23 @@ boolByte errorReporterShouldCopyPlugins(void);
  */
 boolByte errorReporterCopyPlugins(ErrorReporter self, PluginChain pluginChain);
 
+/**
+ * Write what the plugin chain was doing before a failure or a hang to
+ * performance.json in the report directory. This has the processing times of
+ * each plugin in the last blocks, the latency and deadline misses of each
+ * plugin so far, the depths of the I/O queues, and the resident memory. If
+ * trace events are being recorded, they are stopped and also written to
+ * trace.json. Since this is called when a plugin hangs, it may be called while
+ * the chain is still processing on another thread.
+ * @param self
+ * @param pluginChain Initialized plugin chain
+ * @param reason Short description of why the snapshot was taken
+ * @return True if the snapshot was written
+ */
+boolByte errorReporterWritePerformanceSnapshot(ErrorReporter self,
+                                               const PluginChain pluginChain,
+                                               const char *reason);
+
 /**
  * Close any resources associated with the ErrorReporter
  * @param self
@@ -29,6 +29,7 @@
 #include "app/BuildInfo.h"
 #include "audio/AudioSettings.h"
 #include "logging/LogPrinter.h"
+#include "logging/LogSink.h"
 #include "time/AudioClock.h"
 
 #include "MrsWatson.h"
@@ -42,11 +43,29 @@
 #include <Windows.h>
 #include <io.h>
 #elif UNIX
+#include <sys/time.h>
 #include <unistd.h>
 #endif
 
+// Messages are formatted into buffers owned by the calling thread rather than
+// on the heap, so that logging does not allocate and stays safe to call from
+// the background I/O threads. These must be compile-time constants since they
+// size static arrays.
+#define LOG_LINE_MAX_LENGTH (LOG_MESSAGE_MAX_LENGTH + 32)
+
+static THREAD_LOCAL char _logMessageBuffer[LOG_MESSAGE_MAX_LENGTH];
+static THREAD_LOCAL char _logLineBuffer[LOG_LINE_MAX_LENGTH];
+
+// Number of messages which may be queued for the log file writer thread
+static const unsigned int kEventLoggerLogFileNumRecords = 512;
+
 EventLogger eventLoggerInstance = NULL;
 
+// Writes messages to the log file in the background when one is set. This is
+// kept here rather than in EventLoggerMembers, since LogSink.h depends on the
+// types declared in EventLogger.h.
+static LogSink _logFileSink = NULL;
+
 void initEventLogger(void) {
 #if WINDOWS
   ULONGLONG currentTime;
@@ -131,6 +150,32 @@ void setLogLevelFromString(const CharString logLevelString) {
   }
 }
 
+static void _printMessage(const LogLevel logLevel, const long elapsedTimeInMs,
+                          const long numFramesProcessed, const char *message,
+                          const EventLogger eventLogger);
+
+static void _writeLogRecord(const LogRecord *record, void *userData) {
+  _printMessage(record->logLevel, record->elapsedTimeInMs,
+                record->numFramesProcessed, record->message,
+                (EventLogger)userData);
+}
+
+static void _startLogFileSink(EventLogger eventLogger) {
+  // Writing to a slow disk should not stall the processing thread, so log
+  // file output goes through a background writer. If the thread can't be
+  // started, then messages are just written synchronously.
+  if (_logFileSink == NULL) {
+    _logFileSink = newLogSink(kEventLoggerLogFileNumRecords, _writeLogRecord,
+                              eventLogger);
+  }
+}
+
+static void _flushLogFileSink(void) {
+  if (_logFileSink != NULL) {
+    logSinkFlush(_logFileSink);
+  }
+}
+
 void setLogFile(const CharString logFileName) {
   EventLogger eventLogger = _getEventLoggerInstance();
   eventLogger->logFile = fopen(logFileName->data, "a");
@@ -139,6 +184,7 @@ void setLogFile(const CharString logFileName) {
     logCritical("Could not open file '%s' for logging", logFileName->data);
   } else {
     eventLogger->useColor = false;
+    _startLogFileSink(eventLogger);
   }
 }
 
@@ -216,28 +262,27 @@ static LogColor _logTimeZebraStripeColor(const long elapsedTime,
 static void _printMessage(const LogLevel logLevel, const long elapsedTimeInMs,
                           const long numFramesProcessed, const char *message,
                           const EventLogger eventLogger) {
-  char *logString = (char *)malloc(sizeof(char) * kCharStringLengthLong);
+  char *logString = _logLineBuffer;
 
   if (eventLogger->useColor) {
-    snprintf(logString, kCharStringLengthLong, "%c ",
+    snprintf(logString, LOG_LINE_MAX_LENGTH, "%c ",
              _logLevelStatusChar(logLevel));
     printToLog(_logLevelStatusColor(logLevel), eventLogger->logFile, logString);
-    snprintf(logString, kCharStringLengthLong, "%08ld ", numFramesProcessed);
+    snprintf(logString, LOG_LINE_MAX_LENGTH, "%08ld ", numFramesProcessed);
     printToLog(_logTimeZebraStripeColor(numFramesProcessed,
                                         eventLogger->zebraStripeSize),
                eventLogger->logFile, logString);
-    snprintf(logString, kCharStringLengthLong, "%06ld ", elapsedTimeInMs);
+    snprintf(logString, LOG_LINE_MAX_LENGTH, "%06ld ", elapsedTimeInMs);
     printToLog(_logTimeColor(), eventLogger->logFile, logString);
     printToLog(_logLevelStatusColor(logLevel), eventLogger->logFile, message);
   } else {
-    snprintf(logString, kCharStringLengthLong, "%c %08ld %06ld %s",
+    snprintf(logString, LOG_LINE_MAX_LENGTH, "%c %08ld %06ld %s",
              _logLevelStatusChar(logLevel), numFramesProcessed, elapsedTimeInMs,
              message);
     printToLog(COLOR_NONE, eventLogger->logFile, logString);
   }
 
   flushLog(eventLogger->logFile);
-  free(logString);
 }
 
 static void _logMessage(const LogLevel logLevel, const char *message,
@@ -250,11 +295,12 @@ static void _logMessage(const LogLevel logLevel, const char *message,
   struct timeval currentTime;
 #endif
 
+  if ((int)logLevel < LOG_LEVEL_FLOOR) {
+    return;
+  }
+
   if (eventLogger != NULL && logLevel >= eventLogger->logLevel) {
-    CharString formattedMessage =
-        newCharStringWithCapacity(kCharStringLengthDefault * 2);
-    vsnprintf(formattedMessage->data, formattedMessage->capacity, message,
-              arguments);
+    vsnprintf(_logMessageBuffer, LOG_MESSAGE_MAX_LENGTH, message, arguments);
 #if WINDOWS
     currentTime = GetTickCount();
     elapsedTimeInMs = (unsigned long)(currentTime - eventLogger->startTimeInMs);
@@ -264,9 +310,13 @@ static void _logMessage(const LogLevel logLevel, const char *message,
         ((currentTime.tv_sec - (eventLogger->startTimeInSec + 1)) * 1000) +
         (currentTime.tv_usec / 1000) + (1000 - eventLogger->startTimeInMs);
 #endif
-    _printMessage(logLevel, elapsedTimeInMs, getAudioClock()->currentFrame,
-                  formattedMessage->data, eventLogger);
-    freeCharString(formattedMessage);
+    if (_logFileSink != NULL) {
+      logSinkPush(_logFileSink, logLevel, elapsedTimeInMs,
+                  getAudioClock()->currentFrame, _logMessageBuffer);
+    } else {
+      _printMessage(logLevel, elapsedTimeInMs, getAudioClock()->currentFrame,
+                    _logMessageBuffer, eventLogger);
+    }
   }
 }
 
@@ -303,6 +353,7 @@ void logCritical(const char *message, ...) {
   CharString formattedMessage = newCharString();
   CharString wrappedMessage;
 
+  _flushLogFileSink();
   va_start(arguments, message);
   // Instead of going through the common logging method, we always dump critical
   // messages to stderr
@@ -324,6 +375,7 @@ void logInternalError(const char *message, ...) {
   va_list arguments;
   CharString formattedMessage = newCharString();
 
+  _flushLogFileSink();
   va_start(arguments, message);
   // Instead of going through the common logging method, we always dump critical
   // messages to stderr
@@ -418,6 +470,10 @@ void flushErrorLog(void) {
 }
 
 void freeEventLogger(void) {
+  // Write out any queued messages before the log file is closed
+  freeLogSink(_logFileSink);
+  _logFileSink = NULL;
+
   if (eventLoggerInstance != NULL) {
     if (eventLoggerInstance->logFile != NULL) {
       fclose(eventLoggerInstance->logFile);
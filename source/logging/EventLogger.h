@@ -33,6 +33,13 @@
 #include <stdio.h>
 #include <sys/types.h>
 
+// Messages below this level are compiled out of the build. Since the
+// preprocessor cannot compare enum values, this is the numeric value of a
+// LogLevel, so 0 keeps all messages and 1 removes debug messages.
+#ifndef LOG_LEVEL_FLOOR
+#define LOG_LEVEL_FLOOR 0
+#endif
+
 typedef enum {
   LOG_DEBUG,
   LOG_INFO,
@@ -91,7 +98,9 @@ void setLogLevel(LogLevel logLevel);
 void setLogLevelFromString(const CharString logLevelString);
 
 /**
- * Send all logging outputs tree files instead of standard error
+ * Send all logging outputs tree files instead of standard error. Messages are
+ * queued and written to the file from a background thread, so that a slow disk
+ * does not hold up audio processing.
  * @param logFileName File name to log to. The file will be opened for appending
  * text, it will not be overwritten.
  */
@@ -130,6 +139,25 @@ void setLoggingZebraSize(const unsigned long zebraStripeSize);
  */
 void logDebug(const char *message, ...);
 
+/**
+ * Log a debug message from code which runs for every block, such as the plugin
+ * chain's process loop. Unlike logDebug(), the arguments are only evaluated if
+ * debug logging is enabled, and the call is removed entirely from builds where
+ * LOG_LEVEL_FLOOR is above LOG_DEBUG.
+ * @param ... Format string, like printf, followed by its arguments
+ */
+#if LOG_LEVEL_FLOOR > 0
+#define logDebugFast(...) ((void)0)
+#else
+#define logDebugFast(...)                                                      \
+  do {                                                                         \
+    if (eventLoggerInstance != NULL &&                                         \
+        eventLoggerInstance->logLevel <= LOG_DEBUG) {                          \
+      logDebug(__VA_ARGS__);                                                   \
+    }                                                                          \
+  } while (0)
+#endif
+
 /**
  * Log a message with regular priority
  * @param message Format string, like printf
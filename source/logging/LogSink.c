@@ -0,0 +1,188 @@
+//
+// LogSink.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "LogSink.h"
+
+#include "time/TaskTimer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How long the writer thread sleeps when the ring is empty. Producers never
+// signal the writer, since that would require a lock.
+static const double kLogSinkPollIntervalInMs = 2.0;
+
+// The ring is a bounded multi-producer queue as described by Dmitry Vyukov.
+// Each record's sequence number says which position it is ready for: a
+// producer may fill the record at position p when the sequence equals p, and
+// the writer may consume it once the sequence is p + 1. After writing, the
+// sequence is advanced by numRecords to free the slot for the next lap.
+// Positions are unsigned and wrap around, so they are always compared by their
+// signed difference.
+
+static boolByte _logSinkWriteNext(LogSink self) {
+  const unsigned int position = self->readPosition;
+  LogRecord *record = &(self->records[position & (self->numRecords - 1)]);
+
+  if ((int)(atomicLoad(&record->_sequence) - (position + 1)) < 0) {
+    return false;
+  }
+
+  self->writeFunc(record, self->userData);
+  self->lastElapsedTimeInMs = record->elapsedTimeInMs;
+  self->lastNumFramesProcessed = record->numFramesProcessed;
+  atomicStore(&record->_sequence, position + self->numRecords);
+  atomicStore(&self->readPosition, position + 1);
+  return true;
+}
+
+static void _logSinkReportDropped(LogSink self) {
+  const unsigned int numDropped = atomicLoad(&self->numDropped);
+  LogRecord record;
+
+  if (numDropped != self->numDroppedReported) {
+    record.logLevel = LOG_WARN;
+    record.elapsedTimeInMs = self->lastElapsedTimeInMs;
+    record.numFramesProcessed = self->lastNumFramesProcessed;
+    snprintf(record.message, LOG_MESSAGE_MAX_LENGTH,
+             "Log buffer was full, dropped %u messages",
+             numDropped - self->numDroppedReported);
+    self->writeFunc(&record, self->userData);
+    self->numDroppedReported = numDropped;
+  }
+}
+
+static void _logSinkThreadFunc(void *userData) {
+  LogSink self = (LogSink)userData;
+  boolByte stopRequested = false;
+
+  while (true) {
+    if (_logSinkWriteNext(self)) {
+      continue;
+    }
+
+    _logSinkReportDropped(self);
+
+    if (stopRequested) {
+      break;
+    }
+
+    // Drain the ring once more after the stop request, since records may have
+    // been pushed just before it
+    if (atomicLoad(&self->stopRequested)) {
+      stopRequested = true;
+    } else {
+      taskTimerSleep(kLogSinkPollIntervalInMs);
+    }
+  }
+}
+
+LogSink newLogSink(unsigned int numRecords, LogSinkWriteFunc writeFunc,
+                   void *userData) {
+  LogSink self = (LogSink)malloc(sizeof(LogSinkMembers));
+  unsigned int i;
+
+  self->numRecords = 1;
+  while (self->numRecords < numRecords) {
+    self->numRecords <<= 1;
+  }
+
+  self->records = (LogRecord *)malloc(sizeof(LogRecord) * self->numRecords);
+  for (i = 0; i < self->numRecords; i++) {
+    self->records[i]._sequence = i;
+  }
+
+  self->writeFunc = writeFunc;
+  self->userData = userData;
+  self->writePosition = 0;
+  self->readPosition = 0;
+  self->numDropped = 0;
+  self->stopRequested = false;
+  self->numDroppedReported = 0;
+  self->lastElapsedTimeInMs = 0;
+  self->lastNumFramesProcessed = 0;
+
+  self->thread = newThread(_logSinkThreadFunc, self);
+  if (self->thread == NULL) {
+    free(self->records);
+    free(self);
+    return NULL;
+  }
+
+  return self;
+}
+
+boolByte logSinkPush(LogSink self, const LogLevel logLevel,
+                     const long elapsedTimeInMs, const long numFramesProcessed,
+                     const char *message) {
+  unsigned int position = atomicLoad(&self->writePosition);
+  LogRecord *record;
+  int difference;
+
+  while (true) {
+    record = &(self->records[position & (self->numRecords - 1)]);
+    difference = (int)(atomicLoad(&record->_sequence) - position);
+
+    if (difference == 0) {
+      if (atomicCompareAndSwap(&self->writePosition, position, position + 1)) {
+        break;
+      }
+    } else if (difference < 0) {
+      // The writer has not yet freed this record from the previous lap
+      atomicAdd(&self->numDropped, 1);
+      return false;
+    }
+
+    // Another producer claimed this position first
+    position = atomicLoad(&self->writePosition);
+  }
+
+  record->logLevel = logLevel;
+  record->elapsedTimeInMs = elapsedTimeInMs;
+  record->numFramesProcessed = numFramesProcessed;
+  strncpy(record->message, message, LOG_MESSAGE_MAX_LENGTH - 1);
+  record->message[LOG_MESSAGE_MAX_LENGTH - 1] = '\0';
+  atomicStore(&record->_sequence, position + 1);
+  return true;
+}
+
+void logSinkFlush(LogSink self) {
+  const unsigned int position = atomicLoad(&self->writePosition);
+
+  while ((int)(atomicLoad(&self->readPosition) - position) < 0) {
+    taskTimerSleep(kLogSinkPollIntervalInMs / 2.0);
+  }
+}
+
+void freeLogSink(LogSink self) {
+  if (self != NULL) {
+    atomicStore(&self->stopRequested, true);
+    threadJoinAndFree(self->thread);
+    free(self->records);
+    free(self);
+  }
+}
@@ -0,0 +1,116 @@
+//
+// LogSink.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_LogSink_h
+#define MrsWatson_LogSink_h
+
+#include "base/Thread.h"
+#include "logging/EventLogger.h"
+
+// Maximum length of a formatted log message, including the terminator. This
+// must be a compile-time constant since it sizes the record arrays.
+#define LOG_MESSAGE_MAX_LENGTH 512
+
+typedef struct {
+  LogLevel logLevel;
+  long elapsedTimeInMs;
+  long numFramesProcessed;
+  char message[LOG_MESSAGE_MAX_LENGTH];
+
+  // Position in the ring which this record is ready for, see LogSink.c
+  volatile unsigned int _sequence;
+} LogRecord;
+
+/**
+ * Called from the sink's writer thread for each queued record
+ * @param record Log record to write
+ * @param userData User-provided data passed to newLogSink()
+ */
+typedef void (*LogSinkWriteFunc)(const LogRecord *record, void *userData);
+
+typedef struct {
+  LogRecord *records;
+  unsigned int numRecords;
+  LogSinkWriteFunc writeFunc;
+  void *userData;
+  Thread thread;
+
+  // Claimed by producers with compare-and-swap
+  volatile unsigned int writePosition;
+  // Only advanced by the writer thread
+  volatile unsigned int readPosition;
+  volatile unsigned int numDropped;
+  volatile unsigned int stopRequested;
+  // Only accessed from the writer thread
+  unsigned int numDroppedReported;
+  long lastElapsedTimeInMs;
+  long lastNumFramesProcessed;
+} LogSinkMembers;
+typedef LogSinkMembers *LogSink;
+
+/**
+ * Create a new log sink, which queues log records in a fixed-size ring and
+ * writes them from a background thread. Any number of threads may push records
+ * at the same time, and pushing never blocks or allocates memory. If the ring
+ * is full, then the record is dropped and counted instead, and the writer
+ * thread later logs a warning with the number of dropped records.
+ *
+ * @param numRecords Size of the ring, which is rounded up to a power of two
+ * @param writeFunc Function to write each record
+ * @param userData Data to pass to writeFunc
+ * @return New log sink, or NULL if the writer thread could not be started
+ */
+LogSink newLogSink(unsigned int numRecords, LogSinkWriteFunc writeFunc,
+                   void *userData);
+
+/**
+ * Queue a log record to be written by the writer thread
+ * @param self
+ * @param logLevel Log level of the message
+ * @param elapsedTimeInMs Time since the logger was initialized
+ * @param numFramesProcessed Current audio clock position
+ * @param message Formatted message, which is truncated if needed
+ * @return True if the record was queued, false if it was dropped
+ */
+boolByte logSinkPush(LogSink self, const LogLevel logLevel,
+                     const long elapsedTimeInMs, const long numFramesProcessed,
+                     const char *message);
+
+/**
+ * Wait until all records pushed before this call have been written. This is
+ * used before writing anything directly to the log output, so that it does
+ * not appear ahead of earlier queued messages.
+ * @param self
+ */
+void logSinkFlush(LogSink self);
+
+/**
+ * Write any remaining records, stop the writer thread and free the sink.
+ * @param self
+ */
+void freeLogSink(LogSink self);
+
+#endif
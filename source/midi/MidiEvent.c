@@ -29,9 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-MidiEvent newMidiEvent(void) {
-  MidiEvent midiEvent = malloc(sizeof(MidiEventMembers));
-
+static void _initMidiEvent(MidiEvent midiEvent) {
   midiEvent->eventType = MIDI_TYPE_INVALID;
   midiEvent->deltaFrames = 0;
   midiEvent->timestamp = 0;
@@ -39,12 +37,25 @@ MidiEvent newMidiEvent(void) {
   midiEvent->data1 = 0;
   midiEvent->data2 = 0;
   midiEvent->extraData = NULL;
+  midiEvent->extraDataSize = 0;
+  midiEvent->_allocatedFromArena = false;
+}
+
+MidiEvent newMidiEvent(void) {
+  MidiEvent midiEvent = malloc(sizeof(MidiEventMembers));
+  _initMidiEvent(midiEvent);
+  return midiEvent;
+}
 
+MidiEvent newMidiEventInArena(MemoryArena arena) {
+  MidiEvent midiEvent = memoryArenaAlloc(arena, sizeof(MidiEventMembers));
+  _initMidiEvent(midiEvent);
+  midiEvent->_allocatedFromArena = true;
   return midiEvent;
 }
 
 void freeMidiEvent(MidiEvent self) {
-  if (self != NULL) {
+  if (self != NULL && !self->_allocatedFromArena) {
     if (self->eventType == MIDI_TYPE_SYSEX ||
         self->eventType == MIDI_TYPE_META) {
       free(self->extraData);
@@ -27,8 +27,11 @@
 #ifndef MrsWatson_MidiEvent_h
 #define MrsWatson_MidiEvent_h
 
+#include "base/MemoryArena.h"
 #include "base/Types.h"
 
+#include <stdint.h>
+
 typedef enum {
   MIDI_TYPE_INVALID,
   MIDI_TYPE_REGULAR,
@@ -45,9 +48,35 @@ typedef struct {
   byte data1;
   byte data2;
   byte *extraData;
+  // Number of bytes in extraData, for sysex and meta events
+  size_t extraDataSize;
+
+  // Private field, set for events which belong to a MemoryArena or to a
+  // MidiSequence, and which are not freed by freeMidiEvent()
+  boolByte _allocatedFromArena;
 } MidiEventMembers;
 typedef MidiEventMembers *MidiEvent;
 
+/**
+ * Compact form of a MIDI event, in which a MidiSequence stores its events in
+ * one array. A record is 16 bytes, about a quarter of a MidiEvent together
+ * with the pointer to it, so that long sequences of controller events take
+ * less memory and are read without following a pointer for each event. The
+ * extra data of sysex and meta events is kept apart from the records, which
+ * only refer to it by its offset.
+ */
+typedef struct {
+  uint64_t timestamp;
+  // Offset of the extra data, or kMidiEventRecordNoData
+  uint32_t extraDataOffset;
+  byte eventType;
+  byte status;
+  byte data1;
+  byte data2;
+} MidiEventRecord;
+
+static const uint32_t kMidiEventRecordNoData = 0xffffffff;
+
 // MIDI Meta Event types
 #define MIDI_META_TYPE_TEXT 0x01
 #define MIDI_META_TYPE_COPYRIGHT 0x02
@@ -70,6 +99,15 @@ typedef MidiEventMembers *MidiEvent;
  */
 MidiEvent newMidiEvent(void);
 
+/**
+ * Create a new MIDI event in an arena. The event, along with its extra data,
+ * is freed with the arena, so freeMidiEvent() does nothing for these events.
+ * @param arena Arena to allocate from. Any extra data for the event must also
+ * be allocated from this arena.
+ * @return MidiEvent object
+ */
+MidiEvent newMidiEventInArena(MemoryArena arena);
+
 /**
  * Free a MIDI event object and its associated resources
  * @param self
@@ -26,79 +26,450 @@
 
 #include "MidiSequence.h"
 
+#include "base/MemoryUsage.h"
 #include "logging/EventLogger.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+static const unsigned long kMidiSequenceInitialCapacity = 64;
+static const size_t kMidiSequenceArenaBlockSize = 64 * 1024;
 
 MidiSequence newMidiSequence(void) {
   MidiSequence midiSequence = malloc(sizeof(MidiSequenceMembers));
 
-  midiSequence->midiEvents = newLinkedList();
-  midiSequence->_lastEvent = midiSequence->midiEvents;
-  midiSequence->_lastTimestamp = 0;
+  midiSequence->midiEvents = NULL;
+  midiSequence->numMidiEvents = 0;
   midiSequence->numMidiEventsProcessed = 0;
+  midiSequence->_capacity = 0;
+  midiSequence->_nextEventIndex = 0;
+  midiSequence->_startTimestamp = 0;
+  midiSequence->_endTimestamp = 0;
+  midiSequence->_sorted = true;
+  midiSequence->_arena = newMemoryArena(kMidiSequenceArenaBlockSize);
+  midiSequence->_fillFunc = NULL;
+  midiSequence->_fillUserData = NULL;
+  midiSequence->_fillFinished = true;
+  midiSequence->_spareEvents = NULL;
+  midiSequence->_numSpareEvents = 0;
+  midiSequence->_spareEventsCapacity = 0;
+  midiSequence->_extraData = NULL;
+  midiSequence->_extraDataSize = 0;
+  midiSequence->_extraDataCapacity = 0;
+  midiSequence->_rangeEvents = NULL;
+  midiSequence->_rangeEventsCapacity = 0;
+  midiSequence->_accountedSize = 0;
 
   return midiSequence;
 }
 
+// Reports any growth of the sequence's memory since the last call. This is
+// cheap when nothing has changed, which is the case for most calls.
+static void _midiSequenceUpdateMemoryUsage(MidiSequence self) {
+  const size_t size =
+      self->_capacity * sizeof(MidiEventRecord) +
+      self->_spareEventsCapacity * sizeof(MidiEvent) +
+      self->_rangeEventsCapacity * sizeof(MidiEventMembers) +
+      self->_extraDataCapacity + self->_arena->totalSize;
+
+  if (size != self->_accountedSize) {
+    memoryUsageAdd(kMemoryUsageMidiSequences, size - self->_accountedSize);
+    self->_accountedSize = size;
+  }
+}
+
+MidiEvent midiSequenceNewMidiEvent(MidiSequence self) {
+  MidiEvent midiEvent;
+
+  if (self->_numSpareEvents == 0) {
+    midiEvent = newMidiEventInArena(self->_arena);
+    _midiSequenceUpdateMemoryUsage(self);
+    return midiEvent;
+  }
+
+  // Any extra data of the old event stays in the arena, since only a few meta
+  // events carry any
+  self->_numSpareEvents--;
+  midiEvent = self->_spareEvents[self->_numSpareEvents];
+  midiEvent->eventType = MIDI_TYPE_INVALID;
+  midiEvent->deltaFrames = 0;
+  midiEvent->timestamp = 0;
+  midiEvent->status = 0;
+  midiEvent->data1 = 0;
+  midiEvent->data2 = 0;
+  midiEvent->extraData = NULL;
+  midiEvent->extraDataSize = 0;
+  return midiEvent;
+}
+
+byte *midiSequenceNewMidiEventData(MidiSequence self, size_t numBytes) {
+  byte *data = (byte *)memoryArenaAlloc(self->_arena, numBytes);
+  _midiSequenceUpdateMemoryUsage(self);
+  return data;
+}
+
+// Keep an event which was created by the sequence for the next call to
+// midiSequenceNewMidiEvent(), or free any other event
+static void _recycleMidiEvent(MidiSequence self, MidiEvent midiEvent) {
+  if (!midiEvent->_allocatedFromArena) {
+    freeMidiEvent(midiEvent);
+    return;
+  }
+
+  if (self->_numSpareEvents == self->_spareEventsCapacity) {
+    self->_spareEventsCapacity = self->_spareEventsCapacity > 0
+                                     ? self->_spareEventsCapacity * 2
+                                     : kMidiSequenceInitialCapacity;
+    self->_spareEvents = (MidiEvent *)realloc(
+        self->_spareEvents, sizeof(MidiEvent) * self->_spareEventsCapacity);
+    _midiSequenceUpdateMemoryUsage(self);
+  }
+
+  self->_spareEvents[self->_numSpareEvents] = midiEvent;
+  self->_numSpareEvents++;
+}
+
+// Copy the extra data of an event after that of the other events
+// @return Offset of the data, or kMidiEventRecordNoData if it has none
+static uint32_t _addMidiEventData(MidiSequence self,
+                                  const MidiEvent midiEvent) {
+  const uint32_t dataSize = (uint32_t)midiEvent->extraDataSize;
+  const size_t offset = self->_extraDataSize;
+  const size_t newSize = offset + sizeof(dataSize) + dataSize;
+
+  if (midiEvent->extraData == NULL || midiEvent->extraDataSize == 0) {
+    return kMidiEventRecordNoData;
+  } else if (newSize >= kMidiEventRecordNoData) {
+    logError("MIDI sequence has too much sysex and meta data, dropping data "
+             "of event at %ld frames",
+             midiEvent->timestamp);
+    return kMidiEventRecordNoData;
+  }
+
+  if (newSize > self->_extraDataCapacity) {
+    self->_extraDataCapacity = self->_extraDataCapacity > 0
+                                   ? self->_extraDataCapacity * 2
+                                   : kMidiSequenceInitialCapacity;
+
+    if (newSize > self->_extraDataCapacity) {
+      self->_extraDataCapacity = newSize;
+    }
+
+    self->_extraData =
+        (byte *)realloc(self->_extraData, self->_extraDataCapacity);
+    _midiSequenceUpdateMemoryUsage(self);
+  }
+
+  // The data is not aligned, so its size is copied rather than assigned
+  memcpy(self->_extraData + offset, &dataSize, sizeof(dataSize));
+  memcpy(self->_extraData + offset + sizeof(dataSize), midiEvent->extraData,
+         dataSize);
+  self->_extraDataSize = newSize;
+  return (uint32_t)offset;
+}
+
 void appendMidiEventToSequence(MidiSequence self, MidiEvent midiEvent) {
+  MidiEventRecord *record;
+
   if (self != NULL && midiEvent != NULL) {
-    linkedListAppend(self->midiEvents, midiEvent);
+    if (self->numMidiEvents == self->_capacity) {
+      self->_capacity = self->_capacity > 0 ? self->_capacity * 2
+                                            : kMidiSequenceInitialCapacity;
+      self->midiEvents = (MidiEventRecord *)realloc(
+          self->midiEvents, sizeof(MidiEventRecord) * self->_capacity);
+      _midiSequenceUpdateMemoryUsage(self);
+    }
+
+    if (self->numMidiEvents > 0 &&
+        midiEvent->timestamp <
+            self->midiEvents[self->numMidiEvents - 1].timestamp) {
+      self->_sorted = false;
+    }
+
+    if (midiEvent->timestamp > self->_endTimestamp) {
+      self->_endTimestamp = midiEvent->timestamp;
+    }
+
+    record = &(self->midiEvents[self->numMidiEvents]);
+    record->timestamp = midiEvent->timestamp;
+    record->extraDataOffset = _addMidiEventData(self, midiEvent);
+    record->eventType = (byte)midiEvent->eventType;
+    record->status = midiEvent->status;
+    record->data1 = midiEvent->data1;
+    record->data2 = midiEvent->data2;
+    self->numMidiEvents++;
+    _recycleMidiEvent(self, midiEvent);
   }
 }
 
-boolByte fillMidiEventsFromRange(MidiSequence self,
-                                 const unsigned long startTimestamp,
-                                 const unsigned long blocksize,
-                                 LinkedList outMidiEvents) {
-  MidiEvent midiEvent;
-  LinkedListIterator iterator = self->_lastEvent;
-  const unsigned long stopTimestamp = startTimestamp + blocksize;
+static void _mergeSortMidiEvents(MidiEventRecord *events,
+                                 MidiEventRecord *scratch,
+                                 const unsigned long numEvents) {
+  const unsigned long middle = numEvents / 2;
+  unsigned long left = 0;
+  unsigned long right = middle;
+  unsigned long out = 0;
+
+  if (numEvents < 2) {
+    return;
+  }
 
-  while (true) {
-    if ((iterator == NULL) || (iterator->item == NULL)) {
-      return false;
+  _mergeSortMidiEvents(events, scratch, middle);
+  _mergeSortMidiEvents(events + middle, scratch, numEvents - middle);
+
+  // Take from the left half on ties, which keeps the sort stable
+  while (left < middle && right < numEvents) {
+    if (events[right].timestamp < events[left].timestamp) {
+      scratch[out++] = events[right++];
+    } else {
+      scratch[out++] = events[left++];
     }
+  }
+
+  while (left < middle) {
+    scratch[out++] = events[left++];
+  }
+
+  while (right < numEvents) {
+    scratch[out++] = events[right++];
+  }
+
+  memcpy(events, scratch, sizeof(MidiEventRecord) * numEvents);
+}
+
+static void _sortMidiSequence(MidiSequence self) {
+  MidiEventRecord *scratch;
+
+  if (self->_sorted) {
+    return;
+  }
+
+  logDebug("Sorting %ld MIDI events by timestamp", self->numMidiEvents);
+  scratch = (MidiEventRecord *)malloc(sizeof(MidiEventRecord) *
+                                     self->numMidiEvents);
+  _mergeSortMidiEvents(self->midiEvents, scratch, self->numMidiEvents);
+  free(scratch);
+  self->_sorted = true;
+}
+
+// Find the index of the first event at or after startIndex whose timestamp is
+// not less than the given timestamp
+static unsigned long _findFirstMidiEventAt(MidiSequence self,
+                                           unsigned long startIndex,
+                                           const unsigned long timestamp) {
+  unsigned long endIndex = self->numMidiEvents;
+  unsigned long middle;
 
-    midiEvent = iterator->item;
-
-    if (stopTimestamp < midiEvent->timestamp) {
-      // We have not yet reached this event, stop iterating
-      break;
-    } else if (startTimestamp <= midiEvent->timestamp &&
-               stopTimestamp > midiEvent->timestamp) {
-      midiEvent->deltaFrames = midiEvent->timestamp - startTimestamp;
-      logDebug("Scheduling MIDI event 0x%x (%x, %x) in %ld frames",
-               midiEvent->status, midiEvent->data1, midiEvent->data2,
-               midiEvent->deltaFrames);
-      linkedListAppend(outMidiEvents, midiEvent);
-      self->_lastEvent = iterator->nextItem;
-      self->numMidiEventsProcessed++;
-    } else if (startTimestamp > midiEvent->timestamp) {
-      logInternalError("Inconsistent MIDI sequence ordering");
+  while (startIndex < endIndex) {
+    middle = startIndex + (endIndex - startIndex) / 2;
+
+    if (self->midiEvents[middle].timestamp < timestamp) {
+      startIndex = middle + 1;
+    } else {
+      endIndex = middle;
+    }
+  }
+
+  return startIndex;
+}
+
+void midiSequenceSetFillFunc(MidiSequence self, MidiSequenceFillFunc fillFunc,
+                             void *userData) {
+  self->_fillFunc = fillFunc;
+  self->_fillUserData = userData;
+  self->_fillFinished = (boolByte)(fillFunc == NULL);
+}
+
+boolByte midiSequenceIsStreamed(MidiSequence self) {
+  return (boolByte)(self->_fillFunc != NULL);
+}
+
+// Drop the events before the read position of a streaming sequence, along
+// with their extra data.
+static void _releasePlayedMidiEvents(MidiSequence self) {
+  const unsigned long numPlayed = self->_nextEventIndex;
+  size_t firstDataOffset = self->_extraDataSize;
+  unsigned long i;
+
+  if (numPlayed == 0) {
+    return;
+  }
+
+  self->numMidiEvents -= numPlayed;
+  memmove(self->midiEvents, self->midiEvents + numPlayed,
+          sizeof(MidiEventRecord) * self->numMidiEvents);
+  self->_nextEventIndex = 0;
+
+  // Streamed events are appended in order, but the data of the remaining
+  // events is searched anyway since there are only about a block of them
+  for (i = 0; i < self->numMidiEvents; i++) {
+    if (self->midiEvents[i].extraDataOffset != kMidiEventRecordNoData &&
+        self->midiEvents[i].extraDataOffset < firstDataOffset) {
+      firstDataOffset = self->midiEvents[i].extraDataOffset;
     }
+  }
+
+  if (firstDataOffset > 0) {
+    self->_extraDataSize -= firstDataOffset;
+    memmove(self->_extraData, self->_extraData + firstDataOffset,
+            self->_extraDataSize);
 
-    // Last item in the list
-    if (iterator->nextItem == NULL) {
-      if (startTimestamp <= midiEvent->timestamp &&
-          stopTimestamp > midiEvent->timestamp) {
-        return false;
+    for (i = 0; i < self->numMidiEvents; i++) {
+      if (self->midiEvents[i].extraDataOffset != kMidiEventRecordNoData) {
+        self->midiEvents[i].extraDataOffset -= (uint32_t)firstDataOffset;
       }
+    }
+  }
+}
+
+// Pull events from the source of a streaming sequence, up to the given
+// timestamp. This does nothing for sequences which are not streamed.
+static void _fillMidiSequence(MidiSequence self,
+                              const unsigned long stopTimestamp) {
+  if (self->_fillFunc == NULL) {
+    return;
+  }
+
+  _releasePlayedMidiEvents(self);
+
+  if (!self->_fillFinished) {
+    self->_fillFinished =
+        (boolByte)!self->_fillFunc(self->_fillUserData, self, stopTimestamp);
+  }
+}
+
+void midiSequenceReadAll(MidiSequence self) {
+  if (self->_fillFunc == NULL) {
+    return;
+  }
+
+  logDebug("Reading all remaining events of streamed MIDI sequence");
+  _fillMidiSequence(self, ULONG_MAX);
+  midiSequenceSetFillFunc(self, NULL, NULL);
+}
+
+// Unpack the records of a range into the events which are handed out for it
+static MidiEvent _unpackMidiEvents(MidiSequence self, const unsigned long begin,
+                                   const unsigned long end,
+                                   const unsigned long blockStart) {
+  const MidiEventRecord *record;
+  MidiEvent midiEvent;
+  uint32_t dataSize;
+  unsigned long i;
 
-      break;
+  if (end - begin > self->_rangeEventsCapacity) {
+    self->_rangeEventsCapacity = end - begin;
+    free(self->_rangeEvents);
+    self->_rangeEvents = (MidiEventMembers *)malloc(
+        sizeof(MidiEventMembers) * self->_rangeEventsCapacity);
+    _midiSequenceUpdateMemoryUsage(self);
+  }
+
+  for (i = begin; i < end; i++) {
+    record = &(self->midiEvents[i]);
+    midiEvent = &(self->_rangeEvents[i - begin]);
+    midiEvent->eventType = (MidiEventType)record->eventType;
+    midiEvent->timestamp = (unsigned long)record->timestamp;
+    midiEvent->deltaFrames = midiEvent->timestamp - blockStart;
+    midiEvent->status = record->status;
+    midiEvent->data1 = record->data1;
+    midiEvent->data2 = record->data2;
+    midiEvent->extraData = NULL;
+    midiEvent->extraDataSize = 0;
+    midiEvent->_allocatedFromArena = true;
+
+    if (record->extraDataOffset != kMidiEventRecordNoData) {
+      memcpy(&dataSize, self->_extraData + record->extraDataOffset,
+             sizeof(dataSize));
+      midiEvent->extraData =
+          self->_extraData + record->extraDataOffset + sizeof(dataSize);
+      midiEvent->extraDataSize = dataSize;
     }
 
-    iterator = iterator->nextItem;
+    logDebugFast("Scheduling MIDI event 0x%x (%x, %x) in %ld frames",
+                 midiEvent->status, midiEvent->data1, midiEvent->data2,
+                 midiEvent->deltaFrames);
+  }
+
+  return self->_rangeEvents;
+}
+
+boolByte midiSequenceGetRange(MidiSequence self,
+                              const unsigned long startTimestamp,
+                              const unsigned long blocksize,
+                              MidiEvent *outEvents,
+                              unsigned long *outNumEvents) {
+  const unsigned long blockStart = self->_startTimestamp + startTimestamp;
+  const unsigned long stopTimestamp = blockStart + blocksize;
+  unsigned long begin;
+  unsigned long end;
+
+  _fillMidiSequence(self, stopTimestamp);
+  _sortMidiSequence(self);
+  begin = self->_nextEventIndex;
+
+  // When reading sequentially, the next event is never before the start of the
+  // block. Otherwise, the block is past the read position, so skip ahead.
+  if (begin < self->numMidiEvents &&
+      self->midiEvents[begin].timestamp < blockStart) {
+    begin = _findFirstMidiEventAt(self, begin, blockStart);
+  }
+
+  end = _findFirstMidiEventAt(self, begin, stopTimestamp);
+  *outEvents = _unpackMidiEvents(self, begin, end, blockStart);
+  *outNumEvents = end - begin;
+  self->numMidiEventsProcessed += (int)(end - begin);
+  self->_nextEventIndex = end;
+  return (boolByte)(end < self->numMidiEvents || !self->_fillFinished);
+}
+
+void midiSequenceSeek(MidiSequence self, const unsigned long timestamp) {
+  const unsigned long seekTimestamp = self->_startTimestamp + timestamp;
+
+  _fillMidiSequence(self, seekTimestamp);
+  _sortMidiSequence(self);
+  self->_nextEventIndex = _findFirstMidiEventAt(self, 0, seekTimestamp);
+}
+
+void midiSequenceSetStartTimestamp(MidiSequence self,
+                                   const unsigned long timestamp) {
+  self->_startTimestamp = timestamp;
+  midiSequenceSeek(self, 0);
+}
+
+unsigned long midiSequenceGetEndTimestamp(MidiSequence self) {
+  return self->_endTimestamp > self->_startTimestamp
+             ? self->_endTimestamp - self->_startTimestamp
+             : 0;
+}
+
+boolByte fillMidiEventsFromRange(MidiSequence self,
+                                 const unsigned long startTimestamp,
+                                 const unsigned long blocksize,
+                                 LinkedList outMidiEvents) {
+  MidiEvent midiEvents;
+  unsigned long numMidiEvents;
+  unsigned long i;
+  boolByte result = midiSequenceGetRange(self, startTimestamp, blocksize,
+                                         &midiEvents, &numMidiEvents);
+
+  for (i = 0; i < numMidiEvents; i++) {
+    linkedListAppend(outMidiEvents, &midiEvents[i]);
   }
 
-  return true;
+  return result;
 }
 
 void freeMidiSequence(MidiSequence self) {
   if (self != NULL) {
-    freeLinkedListAndItems(self->midiEvents,
-                           (LinkedListFreeItemFunc)freeMidiEvent);
+    memoryUsageRemove(kMemoryUsageMidiSequences, self->_accountedSize);
+    free(self->midiEvents);
+    free(self->_spareEvents);
+    free(self->_extraData);
+    free(self->_rangeEvents);
+    freeMemoryArena(self->_arena);
     free(self);
   }
 }
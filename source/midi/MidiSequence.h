@@ -28,20 +28,63 @@
 #define MrsWatson_MidiSequence_h
 
 #include "base/LinkedList.h"
+#include "base/MemoryArena.h"
 #include "midi/MidiEvent.h"
 
+/**
+ * Called by a streaming sequence when it needs more events. The callback should
+ * append all events with a timestamp before stopTimestamp to the sequence, in
+ * order, and leave any later events for a future call.
+ * @param userData User data which was passed to midiSequenceSetFillFunc()
+ * @param midiSequence MidiSequence to append events to
+ * @param stopTimestamp Sample frame which events must be before
+ * @return True if the source has more events to give, false once it has been
+ * fully read
+ */
+typedef boolByte (*MidiSequenceFillFunc)(void *userData, void *midiSequence,
+                                         const unsigned long stopTimestamp);
+
 typedef struct {
-  LinkedList midiEvents;
-  LinkedListIterator _lastEvent;
-  int _lastTimestamp;
+  MidiEventRecord *midiEvents;
+  unsigned long numMidiEvents;
   int numMidiEventsProcessed;
+
+  // Private fields
+  unsigned long _capacity;
+  unsigned long _nextEventIndex;
+  unsigned long _startTimestamp;
+  // Latest timestamp of all events which were appended
+  unsigned long _endTimestamp;
+  boolByte _sorted;
+  MemoryArena _arena;
+  MidiSequenceFillFunc _fillFunc;
+  void *_fillUserData;
+  boolByte _fillFinished;
+  MidiEvent *_spareEvents;
+  unsigned long _numSpareEvents;
+  unsigned long _spareEventsCapacity;
+  // Extra data of all events, where the data of each event starts with its
+  // size
+  byte *_extraData;
+  size_t _extraDataSize;
+  size_t _extraDataCapacity;
+  // Events of the last range which was read, see midiSequenceGetRange()
+  MidiEventMembers *_rangeEvents;
+  unsigned long _rangeEventsCapacity;
+  size_t _accountedSize;
 } MidiSequenceMembers;
 
 /**
  * The purpose of this class is to hold a series of MIDI events in sequential
  * order. After being read from a MidiSource, such as a file or perhaps an
  * actual device, the events are stored here where they can easily be read block
- * by block.
+ * by block. Events are kept in an array of MidiEventRecord sorted by
+ * timestamp, so finding the events for a block only requires a binary search.
+ * Only the events of the block being read are unpacked into MidiEvent objects.
+ *
+ * A sequence may also be streamed, in which case events are pulled from the
+ * source as they are needed and events which have already been played are
+ * recycled. See midiSequenceSetFillFunc().
  */
 typedef MidiSequenceMembers *MidiSequence;
 
@@ -51,19 +94,138 @@ typedef MidiSequenceMembers *MidiSequence;
  */
 MidiSequence newMidiSequence(void);
 
+/**
+ * Create a new MIDI event which is owned by the sequence. These events are
+ * allocated in bulk, and are all freed at once with the sequence, which is
+ * much faster than creating each event with newMidiEvent() when reading large
+ * MIDI files. The event should be added to the sequence with
+ * appendMidiEventToSequence(), or else it is simply left unused until the
+ * sequence is freed. Events are reused once they have been added.
+ * @param self
+ * @return New MidiEvent
+ */
+MidiEvent midiSequenceNewMidiEvent(MidiSequence self);
+
+/**
+ * Allocate extra data for an event created with midiSequenceNewMidiEvent().
+ * Like the event itself, the data is freed along with the sequence.
+ * @param self
+ * @param numBytes Number of bytes to allocate
+ * @return Pointer to the data
+ */
+byte *midiSequenceNewMidiEventData(MidiSequence self, size_t numBytes);
+
 /**
  * Add an event to the end of the sequence. The event's timestamp must be
- * properly set before making this call. Events added into the sequence in this
- * call are not sorted, it is the responsibility of the caller to add the events
- * sequentially in the order which they should be played back.
+ * properly set before making this call, as well as extraDataSize for events
+ * with extra data. Callers should add events in the order which they should be
+ * played back, but events which are added out of order are sorted by
+ * timestamp before the sequence is read. Events with the same timestamp keep
+ * the order in which they were added.
+ *
+ * The event is copied into the sequence as a MidiEventRecord, so it must not
+ * be used afterwards. Events created with midiSequenceNewMidiEvent() are
+ * reused for new events, and other events are freed.
  * @param self
- * @param midiEvent MidiEvent to add
+ * @param midiEvent MidiEvent to add. The sequence takes ownership of the event.
  */
 void appendMidiEventToSequence(MidiSequence self, MidiEvent midiEvent);
 
+/**
+ * Stream events into this sequence from a source, rather than having all of
+ * them appended up front. Each call to midiSequenceGetRange() or
+ * midiSequenceSeek() first asks the source for the events up to the end of the
+ * requested range. Events before the current block are then released, so only
+ * the events for about one block are held in memory at a time. This also means
+ * that a streaming sequence can only be read forwards.
+ *
+ * Events appended by the fill function must be in timestamp order, and should
+ * be created with midiSequenceNewMidiEvent() so that they can be reused.
+ * @param self
+ * @param fillFunc Function to pull events from the source
+ * @param userData User data which is passed to fillFunc
+ */
+void midiSequenceSetFillFunc(MidiSequence self, MidiSequenceFillFunc fillFunc,
+                             void *userData);
+
+/**
+ * @param self
+ * @return True if events are streamed into this sequence, see
+ * midiSequenceSetFillFunc()
+ */
+boolByte midiSequenceIsStreamed(MidiSequence self);
+
+/**
+ * Stop streaming the sequence, by pulling all remaining events from the source
+ * at once. Afterwards the sequence can be read like any other, including
+ * seeking backwards. Events which were played already are released first.
+ * Does nothing if the sequence is not streamed.
+ * @param self
+ */
+void midiSequenceReadAll(MidiSequence self);
+
+/**
+ * Find the slice of events which fall within a given block, and advance the
+ * sequence past them. The events are unpacked into an array which is reused
+ * for the next range, so they are only valid until the sequence is read or
+ * changed again. The deltaFrames of each event are set relative to the start
+ * of the block.
+ * @param self
+ * @param startTimestamp Sample frame that marks the starting point of the block
+ * @param blocksize Blocksize, which determines the range of events that will be
+ * returned
+ * @param outEvents Receives the array of events in the block, which are
+ * owned by the sequence
+ * @param outNumEvents Receives the number of events in the block
+ * @return True if more events remain in the sequence after this block, false
+ * otherwise. This is so that the caller can tell when the end of the MIDI
+ * sequence has been reached.
+ */
+boolByte midiSequenceGetRange(MidiSequence self,
+                              const unsigned long startTimestamp,
+                              const unsigned long blocksize,
+                              MidiEvent *outEvents,
+                              unsigned long *outNumEvents);
+
+/**
+ * Move the read position of the sequence, so that the next call to
+ * midiSequenceGetRange() or fillMidiEventsFromRange() starts with the first
+ * event at or after the given timestamp. For streaming sequences, the
+ * timestamp must not be before that of the last block which was read.
+ * @param self
+ * @param timestamp Sample frame to seek to
+ */
+void midiSequenceSeek(MidiSequence self, const unsigned long timestamp);
+
+/**
+ * Start playing the sequence from a later point, as if all events before it
+ * had been removed and all others had been moved earlier. Afterwards, the
+ * timestamps passed to midiSequenceGetRange(), midiSequenceSeek() and
+ * fillMidiEventsFromRange() count from the new start. The timestamps of the
+ * events themselves are not changed.
+ *
+ * Events before the new start are never played, including meta events such as
+ * tempo changes.
+ * @param self
+ * @param timestamp Sample frame of the original sequence which becomes frame 0
+ */
+void midiSequenceSetStartTimestamp(MidiSequence self,
+                                   const unsigned long timestamp);
+
+/**
+ * Get the time at which the sequence ends, which is the timestamp of its last
+ * event. Like the timestamps passed to midiSequenceGetRange(), this counts from
+ * the start set with midiSequenceSetStartTimestamp(). For a streamed sequence,
+ * this is only the end of the whole sequence once it has been read to the end.
+ * @param self
+ * @return Sample frame of the last event, or 0 if it is before the start
+ */
+unsigned long midiSequenceGetEndTimestamp(MidiSequence self);
+
 /**
  * Populate a linked list with MIDI events for a given block. This method does
- * not return a linked list in order to optimize for memory usage.
+ * not return a linked list in order to optimize for memory usage. The events
+ * are only valid until the sequence is read again, see midiSequenceGetRange().
  * @param self
  * @param startTimestamp Sample frame that marks the starting point of the block
  * @param blocksize Blocksize, which determines the range of events that will be
@@ -34,7 +34,10 @@
 #include <stdlib.h>
 
 MidiSourceType guessMidiSourceType(const CharString midiSourceTypeString) {
-  if (!charStringIsEmpty(midiSourceTypeString)) {
+  if (charStringIsEqualToCString(midiSourceTypeString, "-", false)) {
+    // MIDI files can also be read from stdin
+    return MIDI_SOURCE_TYPE_FILE;
+  } else if (!charStringIsEmpty(midiSourceTypeString)) {
     File midiSourceFile = newFileWithPath(midiSourceTypeString);
     CharString fileExtension = fileGetExtension(midiSourceFile);
     freeFile(midiSourceFile);
@@ -34,10 +34,18 @@
 #include <stdlib.h>
 #include <string.h>
 
+static const size_t kMidiSourceFileBufferSize = 4096;
+
 static boolByte _openMidiSourceFile(void *midiSourcePtr) {
   MidiSource midiSource = midiSourcePtr;
   MidiSourceFileData extraData = midiSource->extraData;
 
+  if (charStringIsEqualToCString(midiSource->sourceName, "-", false)) {
+    extraData->fileHandle = stdin;
+    charStringCopyCString(midiSource->sourceName, "stdin");
+    return true;
+  }
+
   extraData->fileHandle = fopen(midiSource->sourceName->data, "rb");
 
   if (extraData->fileHandle == NULL) {
@@ -46,6 +54,7 @@ static boolByte _openMidiSourceFile(void *midiSourcePtr) {
     return false;
   }
 
+  extraData->mappedFile = newMappedFile(extraData->fileHandle);
   return true;
 }
 
@@ -125,123 +134,208 @@ static boolByte _readMidiFileHeader(FILE *midiFile, unsigned short *formatType,
   return true;
 }
 
-static boolByte _readMidiFileTrack(FILE *midiFile, const int trackNumber,
-                                   const int timeDivision,
-                                   const MidiFileTimeDivisionType divisionType,
-                                   MidiSequence midiSequence) {
-  unsigned int numBytesBuffer;
-  byte *trackData, *currentByte, *endByte;
-  size_t itemsRead, numBytes;
-  unsigned long currentTimeInSampleFrames = 0;
-  unsigned long unpackedVariableLength;
-  MidiEvent midiEvent = NULL;
-  unsigned int i;
+// Read the next byte of a track, refilling the buffer from the file as
+// needed. Returns false once the end of the track has been reached.
+static boolByte _readMidiFileTrackByte(MidiSourceFileData extraData,
+                                       MidiSourceFileTrack track,
+                                       byte *outByte) {
+  size_t numBytes;
 
-  if (!_readMidiFileChunkHeader(midiFile, "MTrk")) {
-    return false;
-  }
+  if (track->position == track->size) {
+    if (track->bytesRemaining == 0) {
+      return false;
+    }
 
-  itemsRead = fread(&numBytesBuffer, sizeof(unsigned int), 1, midiFile);
+    numBytes = track->bytesRemaining < kMidiSourceFileBufferSize
+                   ? track->bytesRemaining
+                   : kMidiSourceFileBufferSize;
 
-  if (itemsRead < 1) {
-    logError("Short read of MIDI file (at track %d header, num items)",
-             trackNumber);
-    return false;
+    if (fread(extraData->_buffer, 1, numBytes, extraData->fileHandle) !=
+        numBytes) {
+      logError("Short read of MIDI file (at track data)");
+      track->bytesRemaining = 0;
+      return false;
+    }
+
+    track->bytesRemaining -= numBytes;
+    track->data = extraData->_buffer;
+    track->size = numBytes;
+    track->position = 0;
   }
 
-  // Read in the entire track in one pass and parse the events from the buffer
-  // data. Much easier
-  // than having to call fread() for each event.
-  numBytes = (size_t)convertBigEndianIntToPlatform(numBytesBuffer);
-  trackData = (byte *)malloc(numBytes);
-  itemsRead = fread(trackData, 1, numBytes, midiFile);
+  *outByte = track->data[track->position];
+  track->position++;
+  return true;
+}
 
-  if (itemsRead != numBytes) {
-    logError("Short read of MIDI file (at track %d)", trackNumber);
-    free(trackData);
-    return false;
+static boolByte _readMidiFileVariableLength(MidiSourceFileData extraData,
+                                           MidiSourceFileTrack track,
+                                           unsigned long *outValue) {
+  byte currentByte;
+
+  *outValue = 0;
+
+  do {
+    if (!_readMidiFileTrackByte(extraData, track, &currentByte)) {
+      return false;
+    }
+
+    *outValue = (*outValue << 7) + (currentByte & 0x7f);
+  } while (currentByte & 0x80);
+
+  return true;
+}
+
+static boolByte _isMidiFileTrackFinished(MidiSourceFileTrack track) {
+  return (boolByte)(track->position == track->size &&
+                    track->bytesRemaining == 0);
+}
+
+static double _getSampleFramesPerTick(const unsigned short timeDivision,
+                                      const double beatsPerMinute) {
+  const double ticksPerSecond = (double)timeDivision * beatsPerMinute / 60.0;
+  return getSampleRate() / ticksPerSecond;
+}
+
+// Start a new segment of the tempo map at the current position in the file.
+// The tempo bytes hold the length of a beat in microseconds.
+static void _setMidiFileTempo(MidiSourceFileData extraData,
+                              const byte *tempoBytes) {
+  const unsigned long beatLengthInMicroseconds =
+      (unsigned long)((tempoBytes[0] << 16) | (tempoBytes[1] << 8) |
+                      tempoBytes[2]);
+
+  if (beatLengthInMicroseconds == 0) {
+    logWarn("Ignoring MIDI tempo event with a beat length of zero");
+    return;
   }
 
-  currentByte = trackData;
-  endByte = trackData + numBytes;
+  extraData->_tempoChangeTick = extraData->_currentTick;
+  extraData->_tempoChangeTimestamp = extraData->_currentTimestamp;
+  extraData->_sampleFramesPerTick = _getSampleFramesPerTick(
+      extraData->_timeDivision, 60000000.0 / beatLengthInMicroseconds);
+  logDebug("MIDI file tempo changed to %ld microseconds per beat at %ld",
+           beatLengthInMicroseconds, extraData->_currentTimestamp);
+}
+
+// Parse events from a track until one is found which should be added to the
+// sequence, and store it as the track's next event along with its tick. The
+// next event is set to NULL at the end of the track, and false is returned if
+// the track data is invalid.
+static boolByte _readMidiFileEvent(MidiSourceFileData extraData,
+                                   MidiSourceFileTrack track,
+                                   MidiSequence midiSequence) {
+  unsigned long unpackedVariableLength;
+  MidiEvent midiEvent = NULL;
+  size_t numBytes = 0;
+  byte currentByte;
+  size_t i;
+
+  track->nextEvent = NULL;
 
-  while (currentByte < endByte) {
-    // Unpack variable length timestamp
-    unpackedVariableLength = *currentByte;
+  while (!_isMidiFileTrackFinished(track)) {
+    if (!_readMidiFileVariableLength(extraData, track,
+                                     &unpackedVariableLength)) {
+      return false;
+    }
 
-    if (unpackedVariableLength & 0x80) {
-      unpackedVariableLength &= 0x7f;
+    track->tick += unpackedVariableLength;
 
-      do {
-        unpackedVariableLength =
-            (unpackedVariableLength << 7) + (*(++currentByte) & 0x7f);
-      } while (*currentByte & 0x80);
+    // Events which are ignored are parsed into the same event object again
+    if (midiEvent == NULL) {
+      midiEvent = midiSequenceNewMidiEvent(midiSequence);
     }
 
-    currentByte++;
-    freeMidiEvent(midiEvent);
-    midiEvent = newMidiEvent();
+    if (!_readMidiFileTrackByte(extraData, track, &currentByte)) {
+      return false;
+    }
 
-    switch (*currentByte) {
+    switch (currentByte) {
     case 0xff:
       midiEvent->eventType = MIDI_TYPE_META;
-      currentByte++;
-      midiEvent->status = *(currentByte++);
-      numBytes = *(currentByte++);
-      midiEvent->extraData = (byte *)malloc(numBytes);
+
+      if (!_readMidiFileTrackByte(extraData, track, &midiEvent->status) ||
+          !_readMidiFileTrackByte(extraData, track, &currentByte)) {
+        return false;
+      }
+
+      // Only keep the data for meta events which are added to the sequence
+      numBytes = currentByte;
+      midiEvent->extraData = NULL;
+      midiEvent->extraDataSize = 0;
+
+      if (midiEvent->status == MIDI_META_TYPE_TEMPO ||
+          midiEvent->status == MIDI_META_TYPE_TIME_SIGNATURE ||
+          midiEvent->status == MIDI_META_TYPE_TRACK_END) {
+        midiEvent->extraData =
+            midiSequenceNewMidiEventData(midiSequence, numBytes);
+        midiEvent->extraDataSize = numBytes;
+      }
 
       for (i = 0; i < numBytes; i++) {
-        midiEvent->extraData[i] = *(currentByte++);
+        if (!_readMidiFileTrackByte(extraData, track, &currentByte)) {
+          return false;
+        }
+
+        if (midiEvent->extraData != NULL) {
+          midiEvent->extraData[i] = currentByte;
+        }
       }
 
       break;
 
-    case 0x7f:
-      logUnsupportedFeature("MIDI files containing sysex events");
-      free(trackData);
-      freeMidiEvent(midiEvent);
-      return false;
+    case 0xf0:
+    case 0xf7:
+      // The length of a sysex event does not count its leading 0xf0 byte,
+      // which is kept with the data so that it can be sent as it is. Escaped
+      // events which start with 0xf7 are sent without it.
+      midiEvent->eventType = MIDI_TYPE_SYSEX;
+      midiEvent->status = currentByte;
+
+      if (!_readMidiFileVariableLength(extraData, track,
+                                       &unpackedVariableLength)) {
+        return false;
+      }
+
+      i = currentByte == 0xf0 ? 1 : 0;
+      numBytes = i + unpackedVariableLength;
+      midiEvent->extraData = midiSequenceNewMidiEventData(midiSequence,
+                                                          numBytes);
+      midiEvent->extraDataSize = numBytes;
+
+      if (i > 0) {
+        midiEvent->extraData[0] = currentByte;
+      }
+
+      for (; i < numBytes; i++) {
+        if (!_readMidiFileTrackByte(extraData, track,
+                                    &midiEvent->extraData[i])) {
+          return false;
+        }
+      }
+
+      break;
 
     default:
       midiEvent->eventType = MIDI_TYPE_REGULAR;
-      midiEvent->status = *currentByte++;
-      midiEvent->data1 = *currentByte++;
+      midiEvent->status = currentByte;
+
+      if (!_readMidiFileTrackByte(extraData, track, &midiEvent->data1)) {
+        return false;
+      }
 
       // All regular MIDI events have 3 bytes except for program change and
       // channel aftertouch
       if (!((midiEvent->status & 0xf0) == 0xc0 ||
             (midiEvent->status & 0xf0) == 0xd0)) {
-        midiEvent->data2 = *currentByte++;
+        if (!_readMidiFileTrackByte(extraData, track, &midiEvent->data2)) {
+          return false;
+        }
       }
 
       break;
     }
 
-    switch (divisionType) {
-    case TIME_DIVISION_TYPE_TICKS_PER_BEAT: {
-      double ticksPerSecond = (double)timeDivision * getTempo() / 60.0;
-      double sampleFramesPerTick = getSampleRate() / ticksPerSecond;
-      currentTimeInSampleFrames +=
-          (long)(unpackedVariableLength * sampleFramesPerTick);
-    } break;
-
-    case TIME_DIVISION_TYPE_FRAMES_PER_SECOND:
-      // Actually, this should be caught when parsing the file type
-      logUnsupportedFeature("Time division frames/sec");
-      free(trackData);
-      freeMidiEvent(midiEvent);
-      return false;
-
-    case TIME_DIVISION_TYPE_INVALID:
-    default:
-      logInternalError("Invalid time division type");
-      free(trackData);
-      freeMidiEvent(midiEvent);
-      return false;
-    }
-
-    midiEvent->timestamp = currentTimeInSampleFrames;
-
     if (midiEvent->eventType == MIDI_TYPE_META) {
       switch (midiEvent->status) {
       case MIDI_META_TYPE_TEXT:
@@ -258,34 +352,179 @@ static boolByte _readMidiFileTrack(FILE *midiFile, const int trackNumber,
       case MIDI_META_TYPE_DEVICE_NAME:
       case MIDI_META_TYPE_KEY_SIGNATURE:
       case MIDI_META_TYPE_PROPRIETARY:
-        logDebug("Ignoring MIDI meta event of type 0x%x at %ld",
-                 midiEvent->status, midiEvent->timestamp);
+        logDebugFast("Ignoring MIDI meta event of type 0x%x at tick %ld",
+                     midiEvent->status, track->tick);
         break;
 
       case MIDI_META_TYPE_TEMPO:
+        if (numBytes < 3) {
+          logWarn("Ignoring MIDI tempo event with %d bytes", (int)numBytes);
+          break;
+        }
+
+        track->nextEvent = midiEvent;
+        return true;
+
       case MIDI_META_TYPE_TIME_SIGNATURE:
       case MIDI_META_TYPE_TRACK_END:
-        logDebug("Parsed MIDI meta event of type 0x%02x at %ld",
-                 midiEvent->status, midiEvent->timestamp);
-        appendMidiEventToSequence(midiSequence, midiEvent);
-        midiEvent = NULL;
-        break;
+        logDebugFast("Parsed MIDI meta event of type 0x%02x at tick %ld",
+                     midiEvent->status, track->tick);
+        track->nextEvent = midiEvent;
+        return true;
 
       default:
-        logWarn("Ignoring MIDI meta event of type 0x%x at %ld",
-                midiEvent->status, midiEvent->timestamp);
+        logWarn("Ignoring MIDI meta event of type 0x%x at tick %ld",
+                midiEvent->status, track->tick);
         break;
       }
     } else {
-      logDebug("MIDI event of type 0x%02x parsed at %ld", midiEvent->status,
-               midiEvent->timestamp);
-      appendMidiEventToSequence(midiSequence, midiEvent);
-      midiEvent = NULL;
+      logDebugFast("MIDI event of type 0x%02x parsed at tick %ld",
+                   midiEvent->status, track->tick);
+      track->nextEvent = midiEvent;
+      return true;
+    }
+  }
+
+  return true;
+}
+
+// Merge the tracks by taking the pending event with the earliest tick, which
+// becomes the source's next event. Since tempo changes apply to all tracks,
+// timestamps are only calculated here, once the events are in order.
+static boolByte _mergeNextMidiFileEvent(MidiSourceFileData extraData,
+                                        MidiSequence midiSequence) {
+  MidiSourceFileTrack track;
+  MidiEvent midiEvent;
+  unsigned short numActiveTracks;
+  unsigned short i;
+
+  extraData->_nextEvent = NULL;
+
+  while (extraData->_nextEvent == NULL) {
+    // The track of the previous event is only read from now, so that the
+    // event is still delivered if the track is broken after it
+    if (extraData->_lastTrack != NULL) {
+      if (!_readMidiFileEvent(extraData, extraData->_lastTrack,
+                              midiSequence)) {
+        return false;
+      }
+
+      extraData->_lastTrack = NULL;
+    }
+
+    // Files rarely have more than a few dozen tracks, so a linear search is
+    // cheaper than maintaining a heap. Ties go to the earlier track, so that
+    // tempo changes in the first track come before notes at the same tick.
+    track = NULL;
+    numActiveTracks = 0;
+
+    for (i = 0; i < extraData->_numTracks; i++) {
+      if (extraData->_tracks[i].nextEvent != NULL) {
+        numActiveTracks++;
+
+        if (track == NULL || extraData->_tracks[i].tick < track->tick) {
+          track = &extraData->_tracks[i];
+        }
+      }
+    }
+
+    if (track == NULL) {
+      return true;
+    }
+
+    extraData->_lastTrack = track;
+    midiEvent = track->nextEvent;
+
+    // Convert from the last tempo change, rather than adding up each delta, so
+    // that rounding errors do not accumulate over the file
+    extraData->_currentTick = track->tick;
+    extraData->_currentTimestamp =
+        extraData->_tempoChangeTimestamp +
+        (unsigned long)((extraData->_currentTick - extraData->_tempoChangeTick) *
+                        extraData->_sampleFramesPerTick);
+    midiEvent->timestamp = extraData->_currentTimestamp;
+
+    // Events after a tempo change are timed with the new tempo
+    if (midiEvent->eventType == MIDI_TYPE_META &&
+        midiEvent->status == MIDI_META_TYPE_TEMPO) {
+      _setMidiFileTempo(extraData, midiEvent->extraData);
+    }
+
+    // Every track ends with its own end event, but only the last one of these
+    // ends the sequence
+    if (!(midiEvent->eventType == MIDI_TYPE_META &&
+          midiEvent->status == MIDI_META_TYPE_TRACK_END &&
+          numActiveTracks > 1)) {
+      extraData->_nextEvent = midiEvent;
+    }
+  }
+
+  return true;
+}
+
+static boolByte _fillMidiEventsFile(void *midiSourcePtr, void *midiSequencePtr,
+                                    const unsigned long stopTimestamp) {
+  MidiSource midiSource = (MidiSource)midiSourcePtr;
+  MidiSequence midiSequence = (MidiSequence)midiSequencePtr;
+  MidiSourceFileData extraData = (MidiSourceFileData)(midiSource->extraData);
+
+  while (extraData->_nextEvent != NULL &&
+         extraData->_nextEvent->timestamp < stopTimestamp) {
+    appendMidiEventToSequence(midiSequence, extraData->_nextEvent);
+
+    if (!_mergeNextMidiFileEvent(extraData, midiSequence)) {
+      logError("MIDI file '%s' could not be read past %ld frames",
+               midiSource->sourceName->data, extraData->_currentTimestamp);
+      extraData->_nextEvent = NULL;
+    }
+  }
+
+  return (boolByte)(extraData->_nextEvent != NULL);
+}
+
+// Find the data of the next track in the file. Tracks of mapped files are
+// parsed in place, and only fall back to reading from the file handle if the
+// track claims to be longer than the file. Otherwise the entire track is read
+// through the buffer.
+static boolByte _openMidiFileTrack(MidiSourceFileData extraData,
+                                   MidiSourceFileTrack track) {
+  unsigned int numBytesBuffer;
+  size_t trackOffset;
+
+  if (!_readMidiFileChunkHeader(extraData->fileHandle, "MTrk")) {
+    return false;
+  }
+
+  if (fread(&numBytesBuffer, sizeof(unsigned int), 1, extraData->fileHandle) <
+      1) {
+    logError("Short read of MIDI file (at track header, num items)");
+    return false;
+  }
+
+  track->data = extraData->_buffer;
+  track->size = 0;
+  track->position = 0;
+  track->bytesRemaining =
+      (size_t)convertBigEndianIntToPlatform(numBytesBuffer);
+  track->tick = 0;
+  track->nextEvent = NULL;
+
+  if (extraData->mappedFile != NULL) {
+    trackOffset = (size_t)ftell(extraData->fileHandle);
+
+    if (trackOffset < extraData->mappedFile->size) {
+      track->data = extraData->mappedFile->data + trackOffset;
+      track->size = extraData->mappedFile->size - trackOffset;
+
+      if (track->size > track->bytesRemaining) {
+        track->size = track->bytesRemaining;
+      }
+
+      track->bytesRemaining -= track->size;
+      fseek(extraData->fileHandle, (long)track->size, SEEK_CUR);
     }
   }
 
-  free(trackData);
-  freeMidiEvent(midiEvent);
   return true;
 }
 
@@ -294,20 +533,28 @@ static boolByte _readMidiEventsFile(void *midiSourcePtr,
   MidiSource midiSource = (MidiSource)midiSourcePtr;
   MidiSourceFileData extraData = (MidiSourceFileData)(midiSource->extraData);
   unsigned short formatType, numTracks, timeDivision = 0;
-  int track;
+  unsigned short i;
 
   if (!_readMidiFileHeader(extraData->fileHandle, &formatType, &numTracks,
                            &timeDivision)) {
     return false;
   }
 
-  if (formatType != 0) {
-    logUnsupportedFeature("MIDI file types other than 0");
+  if (formatType != 0 && formatType != 1) {
+    logUnsupportedFeature("MIDI file types other than 0 or 1");
     return false;
   } else if (formatType == 0 && numTracks != 1) {
     logError("MIDI file '%s' is of type 0, but contains %d tracks",
              midiSource->sourceName->data, numTracks);
     return false;
+  } else if (numTracks == 0) {
+    logError("MIDI file '%s' does not contain any tracks",
+             midiSource->sourceName->data);
+    return false;
+  } else if (numTracks > 1 && extraData->mappedFile == NULL) {
+    // Each track would need to be buffered in its entirety to merge them
+    logUnsupportedFeature("Reading MIDI files with several tracks from pipes");
+    return false;
   }
 
   // Determine time division type
@@ -323,23 +570,57 @@ static boolByte _readMidiEventsFile(void *midiSourcePtr,
       "MIDI file is type %d, has %d tracks, and time division %d (type %d)",
       formatType, numTracks, timeDivision, extraData->divisionType);
 
-  for (track = 0; track < numTracks; track++) {
-    if (!_readMidiFileTrack(extraData->fileHandle, track, timeDivision,
-                            extraData->divisionType, midiSequence)) {
+  free(extraData->_tracks);
+  extraData->_tracks = (MidiSourceFileTrack)malloc(
+      sizeof(MidiSourceFileTrackMembers) * numTracks);
+  extraData->_numTracks = 0;
+  extraData->_lastTrack = NULL;
+
+  for (i = 0; i < numTracks; i++) {
+    if (!_openMidiFileTrack(extraData, &extraData->_tracks[i])) {
+      return false;
+    }
+
+    extraData->_numTracks++;
+  }
+
+  // The tempo is taken when the file is opened, so tempo changes applied to
+  // the AudioSettings during playback do not affect timestamps twice
+  extraData->_timeDivision = timeDivision;
+  extraData->_sampleFramesPerTick =
+      _getSampleFramesPerTick(timeDivision, getTempo());
+  extraData->_currentTick = 0;
+  extraData->_tempoChangeTick = 0;
+  extraData->_tempoChangeTimestamp = 0;
+  extraData->_currentTimestamp = 0;
+
+  // Read the first event of each track now, so that a track which is broken
+  // right from the start is still reported as a failure here
+  for (i = 0; i < extraData->_numTracks; i++) {
+    if (!_readMidiFileEvent(extraData, &extraData->_tracks[i], midiSequence)) {
       return false;
     }
   }
 
+  if (!_mergeNextMidiFileEvent(extraData, midiSequence)) {
+    return false;
+  }
+
+  midiSequenceSetFillFunc(midiSequence, _fillMidiEventsFile, midiSource);
   return true;
 }
 
 static void _freeMidiEventsFile(void *midiSourceDataPtr) {
   MidiSourceFileData extraData = midiSourceDataPtr;
 
-  if (extraData->fileHandle != NULL) {
+  freeMappedFile(extraData->mappedFile);
+
+  if (extraData->fileHandle != NULL && extraData->fileHandle != stdin) {
     fclose(extraData->fileHandle);
   }
 
+  free(extraData->_tracks);
+  free(extraData->_buffer);
   free(extraData);
 }
 
@@ -358,6 +639,18 @@ MidiSource newMidiSourceFile(const CharString midiSourceName) {
 
   extraData->divisionType = TIME_DIVISION_TYPE_INVALID;
   extraData->fileHandle = NULL;
+  extraData->mappedFile = NULL;
+  extraData->_buffer = (byte *)malloc(kMidiSourceFileBufferSize);
+  extraData->_tracks = NULL;
+  extraData->_numTracks = 0;
+  extraData->_lastTrack = NULL;
+  extraData->_timeDivision = 0;
+  extraData->_currentTick = 0;
+  extraData->_currentTimestamp = 0;
+  extraData->_tempoChangeTick = 0;
+  extraData->_tempoChangeTimestamp = 0;
+  extraData->_sampleFramesPerTick = 0.0;
+  extraData->_nextEvent = NULL;
   midiSource->extraData = extraData;
 
   return midiSource;
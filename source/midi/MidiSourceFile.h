@@ -27,6 +27,7 @@
 #ifndef MrsWatson_MidiSourceFile_h
 #define MrsWatson_MidiSourceFile_h
 
+#include "base/MappedFile.h"
 #include "midi/MidiSource.h"
 
 #include <stdio.h>
@@ -38,12 +39,60 @@ typedef enum {
   NUM_TIME_DIVISION_TYPES
 } MidiFileTimeDivisionType;
 
+/**
+ * Position in one of the tracks of a MIDI file
+ */
+typedef struct {
+  // Track data being parsed, which is either the read buffer or the mapping
+  const byte *data;
+  size_t size;
+  size_t position;
+  // Bytes of the track which have not been read into the buffer yet
+  size_t bytesRemaining;
+  // Tick of the next event, counted from the start of the track
+  unsigned long tick;
+  MidiEvent nextEvent;
+} MidiSourceFileTrackMembers;
+typedef MidiSourceFileTrackMembers *MidiSourceFileTrack;
+
 typedef struct {
   FILE *fileHandle;
+  // Mapping of the file, or NULL when reading from a stream
+  MappedFile mappedFile;
   MidiFileTimeDivisionType divisionType;
+
+  // Private fields, used while streaming events from the tracks
+  byte *_buffer;
+  MidiSourceFileTrack _tracks;
+  unsigned short _numTracks;
+  // Track which the next event was taken from
+  MidiSourceFileTrack _lastTrack;
+  unsigned short _timeDivision;
+  unsigned long _currentTick;
+  unsigned long _currentTimestamp;
+  // Tempo map position, which is the last tempo change read from the file
+  unsigned long _tempoChangeTick;
+  unsigned long _tempoChangeTimestamp;
+  double _sampleFramesPerTick;
+  MidiEvent _nextEvent;
 } MidiSourceFileDataMembers;
 typedef MidiSourceFileDataMembers *MidiSourceFileData;
 
+/**
+ * Create a MIDI source which reads events from a standard MIDI file of type 0
+ * or 1. Rather than parsing the entire file up front, events are parsed while
+ * the sequence is played, so large files start right away. Regular files are
+ * mapped into memory and parsed in place, and the tracks of type 1 files are
+ * merged as their events are needed. Files with a single track may also be
+ * read from a pipe in small chunks, and a name of "-" reads the file from
+ * stdin.
+ *
+ * Tempo events in the file are applied to the timestamps of all events which
+ * follow them. Until the first tempo event, the tempo from AudioSettings is
+ * used.
+ * @param midiSourceName File name
+ * @return MidiSource object
+ */
 MidiSource newMidiSourceFile(const CharString midiSourceName);
 
 #endif
@@ -0,0 +1,400 @@
+//
+// NoteRenderCache.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "NoteRenderCache.h"
+
+#include "audio/AudioSettings.h"
+#include "base/MemoryUsage.h"
+#include "logging/EventLogger.h"
+#include "midi/MidiEvent.h"
+
+#include <stdlib.h>
+
+#define NUM_MIDI_CHANNELS 16
+#define NUM_MIDI_NOTES 128
+
+static const unsigned long kNoteRenderCacheInitialPlacements = 64;
+static const long kNoteRenderCacheNoNote = -1;
+// Number of frames of the sequence which are unpacked at once when looking for
+// its notes
+static const unsigned long kNoteRenderCacheScanBlocksize = 65536;
+
+NoteRenderCache newNoteRenderCache(size_t maxSize) {
+  NoteRenderCache self =
+      (NoteRenderCache)malloc(sizeof(NoteRenderCacheMembers));
+
+  self->totalSize = 0;
+  self->maxSize = maxSize;
+  self->numHits = 0;
+  self->numMisses = 0;
+  self->verified = false;
+  self->disabled = false;
+  self->_renders = newLinkedList();
+  self->_sampleRate = 0.0;
+  self->_blocksize = 0;
+  self->_numChannels = 0;
+  self->_placements = NULL;
+  self->_numPlacements = 0;
+  self->_placementsCapacity = 0;
+  self->_firstPlacement = 0;
+  return self;
+}
+
+static void _freeNoteRender(void *item) {
+  NoteRender render = (NoteRender)item;
+  freeSampleBuffer(render->samples);
+  free(render);
+}
+
+void noteRenderCacheClear(NoteRenderCache self) {
+  freeLinkedListAndItems(self->_renders, _freeNoteRender);
+  self->_renders = newLinkedList();
+  self->totalSize = 0;
+  self->verified = false;
+  self->disabled = false;
+  self->_numPlacements = 0;
+  self->_firstPlacement = 0;
+}
+
+// Renders are only valid for the audio settings which they were made with
+static void _noteRenderCacheCheckFormat(NoteRenderCache self) {
+  if (self->_sampleRate != getSampleRate() ||
+      self->_blocksize != getBlocksize() ||
+      self->_numChannels != getNumChannels()) {
+    if (linkedListLength(self->_renders) > 0) {
+      logDebug("Audio settings have changed, clearing note renders");
+    }
+
+    noteRenderCacheClear(self);
+    self->_sampleRate = getSampleRate();
+    self->_blocksize = getBlocksize();
+    self->_numChannels = getNumChannels();
+  }
+}
+
+boolByte noteRenderCacheCanRender(NoteRenderCache self,
+                                  MidiSequence midiSequence) {
+  const MidiEventRecord *midiEvent;
+  unsigned long i;
+
+  if (self->disabled) {
+    return false;
+  } else if (midiSequenceIsStreamed(midiSequence)) {
+    logInfo("MIDI sequence is streamed, not using note renders");
+    return false;
+  }
+
+  for (i = 0; i < midiSequence->numMidiEvents; i++) {
+    midiEvent = &(midiSequence->midiEvents[i]);
+
+    if (midiEvent->eventType == MIDI_TYPE_META) {
+      continue;
+    } else if (midiEvent->eventType != MIDI_TYPE_REGULAR ||
+               ((midiEvent->status & 0xf0) != 0x80 &&
+                (midiEvent->status & 0xf0) != 0x90)) {
+      logInfo("MIDI sequence has events other than notes, not using note "
+              "renders");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static boolByte _noteRenderKeysEqual(const NoteRenderKey *a,
+                                     const NoteRenderKey *b) {
+  return (boolByte)(a->onStatus == b->onStatus && a->note == b->note &&
+                    a->onVelocity == b->onVelocity &&
+                    a->offStatus == b->offStatus &&
+                    a->offVelocity == b->offVelocity &&
+                    a->lengthInFrames == b->lengthInFrames);
+}
+
+static NoteRender _noteRenderCacheFind(NoteRenderCache self,
+                                       const NoteRenderKey *key) {
+  LinkedListIterator iterator;
+  NoteRender render;
+
+  for (iterator = linkedListBegin(self->_renders); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    render = (NoteRender)linkedListIteratorGetItem(iterator);
+
+    if (_noteRenderKeysEqual(&render->key, key)) {
+      return render;
+    }
+  }
+
+  return NULL;
+}
+
+static NoteRender _noteRenderCacheAdd(NoteRenderCache self,
+                                      const NoteRenderKey *key,
+                                      NoteRenderFunc renderFunc,
+                                      void *userData) {
+  SampleBuffer samples;
+  NoteRender render;
+  size_t size;
+
+  if (self->totalSize >= self->maxSize) {
+    logInfo("Note render cache is full, not using note renders");
+    return NULL;
+  }
+
+  samples = renderFunc(userData, key);
+
+  if (samples == NULL) {
+    return NULL;
+  }
+
+  size = sizeof(Sample) * samples->numChannels * samples->blocksize;
+
+  if (self->totalSize + size > self->maxSize ||
+      !memoryUsageFitsBudget(size)) {
+    logInfo("Note render cache is full, not using note renders");
+    freeSampleBuffer(samples);
+    return NULL;
+  }
+
+  render = (NoteRender)malloc(sizeof(NoteRenderMembers));
+  render->key = *key;
+  render->samples = samples;
+  linkedListAppend(self->_renders, render);
+  self->totalSize += size;
+  logDebug("Rendered note %d with velocity %d and length %lu, %lu frames",
+           key->note, key->onVelocity, key->lengthInFrames, samples->blocksize);
+  return render;
+}
+
+static NoteRenderPlacement *_noteRenderCacheAddPlacement(NoteRenderCache self) {
+  if (self->_numPlacements == self->_placementsCapacity) {
+    self->_placementsCapacity = self->_placementsCapacity > 0
+                                    ? self->_placementsCapacity * 2
+                                    : kNoteRenderCacheInitialPlacements;
+    self->_placements = (NoteRenderPlacement *)realloc(
+        self->_placements,
+        sizeof(NoteRenderPlacement) * self->_placementsCapacity);
+  }
+
+  return &self->_placements[self->_numPlacements++];
+}
+
+// Pair each note on event with its note off event. Notes which were released
+// before the start timestamp of the sequence are never heard, so note off
+// events without a note are skipped.
+static boolByte _noteRenderCacheFindNotes(NoteRenderCache self,
+                                          MidiSequence midiSequence) {
+  long openNotes[NUM_MIDI_CHANNELS][NUM_MIDI_NOTES];
+  const int numEventsProcessed = midiSequence->numMidiEventsProcessed;
+  unsigned long lastTimestamp = 0;
+  unsigned long blockStart;
+  unsigned long frame;
+  unsigned long numMidiEvents;
+  unsigned long i;
+  boolByte result = true;
+  NoteRenderPlacement *placement;
+  MidiEvent midiEvents;
+  MidiEvent midiEvent;
+  long *openNote;
+  int channel;
+  int note;
+
+  for (channel = 0; channel < NUM_MIDI_CHANNELS; channel++) {
+    for (note = 0; note < NUM_MIDI_NOTES; note++) {
+      openNotes[channel][note] = kNoteRenderCacheNoNote;
+    }
+  }
+
+  for (i = 0; i < midiSequence->numMidiEvents; i++) {
+    if (midiSequence->midiEvents[i].timestamp > lastTimestamp) {
+      lastTimestamp = (unsigned long)midiSequence->midiEvents[i].timestamp;
+    }
+  }
+
+  // Read the sequence in large blocks, so that only the events of one block
+  // are unpacked at a time. The frame of each event counts from the start
+  // timestamp of the sequence.
+  midiSequenceSeek(midiSequence, 0);
+
+  for (blockStart = 0; result && blockStart <= lastTimestamp;
+       blockStart += kNoteRenderCacheScanBlocksize) {
+    midiSequenceGetRange(midiSequence, blockStart,
+                         kNoteRenderCacheScanBlocksize, &midiEvents,
+                         &numMidiEvents);
+
+    for (i = 0; result && i < numMidiEvents; i++) {
+      midiEvent = &midiEvents[i];
+      frame = blockStart + midiEvent->deltaFrames;
+
+      if (midiEvent->eventType != MIDI_TYPE_REGULAR) {
+        continue;
+      }
+
+      openNote =
+          &openNotes[midiEvent->status & 0x0f][midiEvent->data1 & 0x7f];
+
+      if ((midiEvent->status & 0xf0) == 0x90 && midiEvent->data2 > 0) {
+        if (*openNote != kNoteRenderCacheNoNote) {
+          logInfo("Note %d is played again before it is released, not using "
+                  "note renders",
+                  midiEvent->data1);
+          result = false;
+        } else {
+          *openNote = (long)self->_numPlacements;
+          placement = _noteRenderCacheAddPlacement(self);
+          placement->frame = frame;
+          placement->key.onStatus = midiEvent->status;
+          placement->key.note = midiEvent->data1;
+          placement->key.onVelocity = midiEvent->data2;
+          placement->key.offStatus = 0;
+          placement->key.offVelocity = 0;
+          placement->key.lengthInFrames = 0;
+          placement->render = NULL;
+        }
+      } else if (*openNote != kNoteRenderCacheNoNote) {
+        placement = &self->_placements[*openNote];
+        placement->key.offStatus = midiEvent->status;
+        placement->key.offVelocity = midiEvent->data2;
+        placement->key.lengthInFrames = frame - placement->frame;
+        *openNote = kNoteRenderCacheNoNote;
+      }
+    }
+  }
+
+  for (channel = 0; result && channel < NUM_MIDI_CHANNELS; channel++) {
+    for (note = 0; result && note < NUM_MIDI_NOTES; note++) {
+      if (openNotes[channel][note] != kNoteRenderCacheNoNote) {
+        logInfo("Note %d is never released, not using note renders", note);
+        result = false;
+      }
+    }
+  }
+
+  midiSequenceSeek(midiSequence, 0);
+  midiSequence->numMidiEventsProcessed = numEventsProcessed;
+  return result;
+}
+
+boolByte noteRenderCachePlaceSequence(NoteRenderCache self,
+                                      MidiSequence midiSequence,
+                                      NoteRenderFunc renderFunc,
+                                      void *userData) {
+  NoteRenderPlacement *placement;
+  unsigned long numMisses = 0;
+  unsigned long i;
+
+  _noteRenderCacheCheckFormat(self);
+  self->_numPlacements = 0;
+  self->_firstPlacement = 0;
+
+  if (self->disabled || !_noteRenderCacheFindNotes(self, midiSequence)) {
+    self->_numPlacements = 0;
+    return false;
+  }
+
+  for (i = 0; i < self->_numPlacements; i++) {
+    placement = &self->_placements[i];
+    placement->render = _noteRenderCacheFind(self, &placement->key);
+
+    if (placement->render == NULL) {
+      placement->render =
+          _noteRenderCacheAdd(self, &placement->key, renderFunc, userData);
+
+      if (placement->render == NULL) {
+        self->_numPlacements = 0;
+        return false;
+      }
+
+      numMisses++;
+    }
+  }
+
+  self->numMisses += numMisses;
+  self->numHits += self->_numPlacements - numMisses;
+  logDebug("Placed %lu notes, %lu of which had to be rendered",
+           self->_numPlacements, numMisses);
+  return true;
+}
+
+boolByte noteRenderCacheGetFirstNote(NoteRenderCache self,
+                                     unsigned long *outStartFrame,
+                                     unsigned long *outEndFrame) {
+  if (self->_numPlacements == 0) {
+    return false;
+  }
+
+  *outStartFrame = self->_placements[0].frame;
+  *outEndFrame =
+      *outStartFrame + self->_placements[0].render->samples->blocksize;
+  return true;
+}
+
+void noteRenderCacheMix(NoteRenderCache self, SampleBuffer outputs,
+                        unsigned long frame) {
+  const unsigned long blockEnd = frame + outputs->blocksize;
+  NoteRenderPlacement *placement;
+  SampleBuffer samples;
+  unsigned long renderEnd;
+  unsigned long start;
+  unsigned long end;
+  unsigned long i;
+
+  sampleBufferClear(outputs);
+
+  while (self->_firstPlacement < self->_numPlacements &&
+         self->_placements[self->_firstPlacement].frame +
+                 self->_placements[self->_firstPlacement]
+                     .render->samples->blocksize <=
+             frame) {
+    self->_firstPlacement++;
+  }
+
+  for (i = self->_firstPlacement;
+       i < self->_numPlacements && self->_placements[i].frame < blockEnd;
+       i++) {
+    placement = &self->_placements[i];
+    samples = placement->render->samples;
+    renderEnd = placement->frame + samples->blocksize;
+
+    if (renderEnd <= frame) {
+      continue;
+    }
+
+    start = placement->frame > frame ? placement->frame : frame;
+    end = renderEnd < blockEnd ? renderEnd : blockEnd;
+
+    sampleBufferMixWithOffset(outputs, (SampleCount)(start - frame), samples,
+                              (SampleCount)(start - placement->frame),
+                              (SampleCount)(end - start), 1.0f);
+  }
+}
+
+void freeNoteRenderCache(NoteRenderCache self) {
+  if (self != NULL) {
+    freeLinkedListAndItems(self->_renders, _freeNoteRender);
+    free(self->_placements);
+    free(self);
+  }
+}
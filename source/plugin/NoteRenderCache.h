@@ -0,0 +1,189 @@
+//
+// NoteRenderCache.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_NoteRenderCache_h
+#define MrsWatson_NoteRenderCache_h
+
+#include "audio/SampleBuffer.h"
+#include "base/LinkedList.h"
+#include "midi/MidiSequence.h"
+
+/**
+ * Identifies a note by everything which an instrument gets to hear about it,
+ * so that two notes with the same key sound the same on a deterministic
+ * instrument. The statuses include the MIDI channel.
+ */
+typedef struct {
+  byte onStatus;
+  byte note;
+  byte onVelocity;
+  byte offStatus;
+  byte offVelocity;
+  // Frames between the note on and note off events
+  unsigned long lengthInFrames;
+} NoteRenderKey;
+
+/**
+ * Output of the plugin chain for a single note, which starts with the note on
+ * event and lasts until its tail has become silent
+ */
+typedef struct {
+  NoteRenderKey key;
+  SampleBuffer samples;
+} NoteRenderMembers;
+typedef NoteRenderMembers *NoteRender;
+
+/**
+ * A note of a MIDI sequence, and the render which is played for it
+ */
+typedef struct {
+  unsigned long frame;
+  NoteRenderKey key;
+  NoteRender render;
+} NoteRenderPlacement;
+
+/**
+ * Called to render a note which is not yet in the cache.
+ * @param userData User data which was passed to noteRenderCachePlaceSequence()
+ * @param key Note to render
+ * @return New buffer with the render, which the cache takes ownership of, or
+ * NULL if the note could not be rendered
+ */
+typedef SampleBuffer (*NoteRenderFunc)(void *userData,
+                                       const NoteRenderKey *key);
+
+/**
+ * Renders of single notes, which are mixed together to play a MIDI sequence
+ * instead of sending the sequence through an instrument. Each unique note is
+ * rendered once, and later sequences which play the same notes through the
+ * same instrument only need to mix the renders. This gives the same output as
+ * playing the sequence only if the instrument is deterministic, and its voices
+ * neither affect each other nor depend on the time at which they start.
+ *
+ * Renders are kept until the cache is cleared, or until the sample rate,
+ * blocksize or number of channels changes. Once the cache is full then
+ * sequences which need new renders can no longer be placed.
+ */
+typedef struct {
+  size_t totalSize;
+  size_t maxSize;
+  unsigned long numHits;
+  unsigned long numMisses;
+  // Set once the renders have been compared to playing a sequence directly
+  boolByte verified;
+  // Set when that comparison failed, after which no sequences are placed
+  boolByte disabled;
+
+  // Private fields
+  LinkedList _renders;
+  SampleRate _sampleRate;
+  SampleCount _blocksize;
+  ChannelCount _numChannels;
+  // Notes of the placed sequence, in the order in which they start
+  NoteRenderPlacement *_placements;
+  unsigned long _numPlacements;
+  unsigned long _placementsCapacity;
+  // All placements before this one have finished playing
+  unsigned long _firstPlacement;
+} NoteRenderCacheMembers;
+typedef NoteRenderCacheMembers *NoteRenderCache;
+
+/**
+ * Create a new note render cache
+ * @param maxSize Maximum total size of all renders, in bytes
+ * @return NoteRenderCache instance
+ */
+NoteRenderCache newNoteRenderCache(size_t maxSize);
+
+/**
+ * Find out if a sequence can be played by mixing note renders. The sequence
+ * must not be streamed, and may only contain note on and note off events
+ * besides meta events.
+ * @param self
+ * @param midiSequence Sequence to check
+ * @return True if the sequence can be placed
+ */
+boolByte noteRenderCacheCanRender(NoteRenderCache self,
+                                  MidiSequence midiSequence);
+
+/**
+ * Find the notes of a sequence and the render for each of them. Notes which
+ * are not in the cache yet are rendered with renderFunc and stored. The
+ * sequence is rewound afterwards, and it counts from its start timestamp like
+ * it does when it is played.
+ * @param self
+ * @param midiSequence Sequence to place, which must have passed
+ * noteRenderCacheCanRender()
+ * @param renderFunc Function to render a note which is not in the cache
+ * @param userData User data which is passed to renderFunc
+ * @return True if all notes have a render. False if the cache is disabled or
+ * full, if a note could not be rendered, or if a note is played again on the
+ * same channel before it is released or is never released at all, since such
+ * notes do not sound the same on their own.
+ */
+boolByte noteRenderCachePlaceSequence(NoteRenderCache self,
+                                      MidiSequence midiSequence,
+                                      NoteRenderFunc renderFunc,
+                                      void *userData);
+
+/**
+ * Get the range of frames in which the first note of the placed sequence
+ * plays, which is where the renders are compared to playing the sequence
+ * directly.
+ * @param self
+ * @param outStartFrame Set to the frame at which the first note starts
+ * @param outEndFrame Set to the frame at which its render ends
+ * @return True if the placed sequence has any notes
+ */
+boolByte noteRenderCacheGetFirstNote(NoteRenderCache self,
+                                     unsigned long *outStartFrame,
+                                     unsigned long *outEndFrame);
+
+/**
+ * Mix the renders of the placed sequence for one block. Blocks must be mixed
+ * in order, starting over only when another sequence is placed.
+ * @param self
+ * @param outputs Buffer to write the mix to, whose blocksize is the length of
+ * the block
+ * @param frame Frame of the sequence at which the block starts
+ */
+void noteRenderCacheMix(NoteRenderCache self, SampleBuffer outputs,
+                        unsigned long frame);
+
+/**
+ * Free all renders, for example because the instrument's parameters have
+ * changed. This also clears the verified and disabled flags.
+ * @param self
+ */
+void noteRenderCacheClear(NoteRenderCache self);
+
+/**
+ * Free the cache and all of its renders
+ * @param self
+ */
+void freeNoteRenderCache(NoteRenderCache self);
+
+#endif
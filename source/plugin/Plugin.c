@@ -28,10 +28,16 @@
 
 #include "audio/AudioSettings.h"
 #include "logging/EventLogger.h"
+#include "plugin/PluginConvolver.h"
+#include "plugin/PluginCpuLoad.h"
 #include "plugin/PluginGain.h"
+#include "plugin/PluginLatency.h"
 #include "plugin/PluginLimiter.h"
 #include "plugin/PluginPassthru.h"
 #include "plugin/PluginSilence.h"
+#include "plugin/PluginSine.h"
+#include "plugin/PluginTimeQuery.h"
+#include "plugin/PluginTruePeakLimiter.h"
 #include "plugin/PluginVst2x.h"
 
 #include <stdio.h>
@@ -71,9 +77,15 @@ static void _logPluginLocation(const CharString location) {
 static void _listAvailablePluginsInternal(void) {
   CharString internalLocation = newCharStringWithCString("(Internal)");
   _logPluginLocation(internalLocation);
+  logInfo("  %s", kInternalPluginConvolverName);
+  logInfo("  %s", kInternalPluginCpuLoadName);
+  logInfo("  %s", kInternalPluginLatencyName);
   logInfo("  %s", kInternalPluginLimiterName);
   logInfo("  %s", kInternalPluginPassthruName);
   logInfo("  %s", kInternalPluginSilenceName);
+  logInfo("  %s", kInternalPluginSineName);
+  logInfo("  %s", kInternalPluginTimeQueryName);
+  logInfo("  %s", kInternalPluginTruePeakLimiterName);
   freeCharString(internalLocation);
 }
 
@@ -112,8 +124,17 @@ Plugin pluginFactory(const CharString pluginName, const CharString pluginRoot) {
     return newPluginVst2x(pluginName, pluginRoot);
 
   case PLUGIN_TYPE_INTERNAL:
-    if (_internalPluginNameMatches(pluginName, kInternalPluginGainName)) {
+    if (_internalPluginNameMatches(pluginName, kInternalPluginConvolverName)) {
+      return newPluginConvolver(pluginName);
+    } else if (_internalPluginNameMatches(pluginName,
+                                          kInternalPluginCpuLoadName)) {
+      return newPluginCpuLoad(pluginName);
+    } else if (_internalPluginNameMatches(pluginName,
+                                          kInternalPluginGainName)) {
       return newPluginGain(pluginName);
+    } else if (_internalPluginNameMatches(pluginName,
+                                          kInternalPluginLatencyName)) {
+      return newPluginLatency(pluginName);
     } else if (_internalPluginNameMatches(pluginName,
                                           kInternalPluginLimiterName)) {
       return newPluginLimiter(pluginName);
@@ -123,6 +144,15 @@ Plugin pluginFactory(const CharString pluginName, const CharString pluginRoot) {
     } else if (_internalPluginNameMatches(pluginName,
                                           kInternalPluginSilenceName)) {
       return newPluginSilence(pluginName);
+    } else if (_internalPluginNameMatches(pluginName,
+                                          kInternalPluginSineName)) {
+      return newPluginSine(pluginName);
+    } else if (_internalPluginNameMatches(pluginName,
+                                          kInternalPluginTimeQueryName)) {
+      return newPluginTimeQuery(pluginName);
+    } else if (_internalPluginNameMatches(pluginName,
+                                          kInternalPluginTruePeakLimiterName)) {
+      return newPluginTruePeakLimiter(pluginName);
     } else {
       logError("'%s' is not a recognized internal plugin", pluginName->data);
       return NULL;
@@ -173,6 +203,15 @@ boolByte closePlugin(Plugin self) {
   return true;
 }
 
+PluginCapabilityState pluginGetCapability(const Plugin self,
+                                          PluginCapability capability) {
+  if (self == NULL || self->interfaceType != PLUGIN_TYPE_VST_2X) {
+    return PLUGIN_CAPABILITY_UNKNOWN;
+  }
+
+  return pluginVst2xGetCapability(self, capability);
+}
+
 Plugin _newPlugin(PluginInterfaceType interfaceType, PluginType pluginType) {
   Plugin plugin = (Plugin)malloc(sizeof(PluginMembers));
 
@@ -30,6 +30,7 @@
 #include "audio/SampleBuffer.h"
 #include "base/CharString.h"
 #include "base/LinkedList.h"
+#include "plugin/PluginCapabilities.h"
 
 // All internal plugins should start with this string
 #define INTERNAL_PLUGIN_PREFIX "mrs_"
@@ -38,6 +39,7 @@ typedef enum {
   PLUGIN_TYPE_INVALID,
   PLUGIN_TYPE_VST_2X,
   PLUGIN_TYPE_INTERNAL,
+  PLUGIN_TYPE_ISOLATED,
   NUM_PLUGIN_INTERFACE_TYPES
 } PluginInterfaceType;
 
@@ -199,6 +201,17 @@ boolByte openPlugin(Plugin self);
  */
 boolByte closePlugin(Plugin self);
 
+/**
+ * Look up a capability of a plugin, see PluginCapabilities.h. Only VST plugins
+ * which have been scanned into the plugin index have known capabilities, the
+ * plugin does not need to be open for this.
+ * @param self
+ * @param capability Capability to look up
+ * @return State of the capability
+ */
+PluginCapabilityState pluginGetCapability(const Plugin self,
+                                          PluginCapability capability);
+
 /**
 * Create a new plugin. Considered "protected", only subclasses of Plugin should
 * directly call this.
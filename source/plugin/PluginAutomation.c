@@ -0,0 +1,179 @@
+//
+// PluginAutomation.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "PluginAutomation.h"
+
+#include "base/File.h"
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned long kPluginAutomationInitialCapacity = 64;
+
+PluginAutomation newPluginAutomation(void) {
+  PluginAutomation self =
+      (PluginAutomation)malloc(sizeof(PluginAutomationMembers));
+  self->points = NULL;
+  self->numPoints = 0;
+  self->_capacity = 0;
+  return self;
+}
+
+boolByte pluginAutomationAddPoint(PluginAutomation self, double time,
+                                  unsigned int index, float value) {
+  unsigned long position;
+
+  if (time < 0.0) {
+    logError("Cannot automate parameter %d at negative time %f", index, time);
+    return false;
+  }
+
+  if (self->numPoints == self->_capacity) {
+    self->_capacity = self->_capacity > 0 ? self->_capacity * 2
+                                          : kPluginAutomationInitialCapacity;
+    self->points = (PluginAutomationPoint *)realloc(
+        self->points, sizeof(PluginAutomationPoint) * self->_capacity);
+  }
+
+  // Points are almost always given in order, in which case this finds the end
+  // of the list right away
+  position = self->numPoints;
+
+  while (position > 0 && self->points[position - 1].time > time) {
+    position--;
+  }
+
+  memmove(self->points + position + 1, self->points + position,
+          sizeof(PluginAutomationPoint) * (self->numPoints - position));
+  self->points[position].time = time;
+  self->points[position].index = index;
+  self->points[position].value = value;
+  self->numPoints++;
+  return true;
+}
+
+static boolByte _pluginAutomationAddLine(PluginAutomation self,
+                                         const char *line) {
+  const char *field = line;
+  char *fieldEnd = NULL;
+  double time;
+  long index;
+  float value;
+
+  time = strtod(field, &fieldEnd);
+
+  if (fieldEnd == field || *fieldEnd != ',') {
+    return false;
+  }
+
+  field = fieldEnd + 1;
+  index = strtol(field, &fieldEnd, 10);
+
+  if (fieldEnd == field || *fieldEnd != ',' || index < 0) {
+    return false;
+  }
+
+  field = fieldEnd + 1;
+  value = (float)strtod(field, &fieldEnd);
+
+  if (fieldEnd == field) {
+    return false;
+  }
+
+  return pluginAutomationAddPoint(self, time, (unsigned int)index, value);
+}
+
+boolByte pluginAutomationReadFile(PluginAutomation self,
+                                  const CharString filename) {
+  File automationFile = newFileWithPath(filename);
+  LinkedList lines = NULL;
+  LinkedListIterator iterator;
+  CharString line;
+  char *carriageReturn = NULL;
+  int lineNumber = 0;
+  boolByte result = true;
+
+  if (automationFile == NULL || automationFile->fileType != kFileTypeFile) {
+    logError("Automation file '%s' does not exist", filename->data);
+    freeFile(automationFile);
+    return false;
+  }
+
+  lines = fileReadLines(automationFile);
+  freeFile(automationFile);
+
+  if (lines == NULL) {
+    logError("Automation file '%s' could not be read", filename->data);
+    return false;
+  }
+
+  for (iterator = linkedListBegin(lines); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    line = (CharString)linkedListIteratorGetItem(iterator);
+    lineNumber++;
+    // Tolerate files which were saved with DOS line endings
+    carriageReturn = strrchr(line->data, '\r');
+
+    if (carriageReturn != NULL) {
+      *carriageReturn = '\0';
+    }
+
+    if (charStringIsEmpty(line) || line->data[0] == '#') {
+      continue;
+    }
+
+    if (!_pluginAutomationAddLine(self, line->data)) {
+      logError("Line %d of automation file '%s' should contain a time, a "
+               "parameter index, and a value separated by commas",
+               lineNumber, filename->data);
+      result = false;
+      break;
+    }
+  }
+
+  freeLinkedListAndItems(lines, (LinkedListFreeItemFunc)freeCharString);
+
+  if (result) {
+    logInfo("Read %lu automation points from '%s'", self->numPoints,
+            filename->data);
+  }
+
+  return result;
+}
+
+unsigned long pluginAutomationPointGetFrame(const PluginAutomationPoint *point,
+                                            SampleRate sampleRate) {
+  return (unsigned long)(point->time * sampleRate + 0.5);
+}
+
+void freePluginAutomation(PluginAutomation self) {
+  if (self != NULL) {
+    free(self->points);
+    free(self);
+  }
+}
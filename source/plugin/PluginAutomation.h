@@ -0,0 +1,100 @@
+//
+// PluginAutomation.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#ifndef MrsWatson_PluginAutomation_h
+#define MrsWatson_PluginAutomation_h
+
+#include "base/CharString.h"
+#include "base/Types.h"
+
+typedef struct {
+  // Time of the change, in seconds from the start of the input
+  double time;
+  unsigned int index;
+  float value;
+} PluginAutomationPoint;
+
+/**
+ * List of parameter changes over time, which is applied to the first plugin in
+ * a chain while it processes audio. Points are kept sorted by time, and points
+ * with the same time stay in the order that they were added. An automation
+ * list is not changed while processing, so the same list may be shared by the
+ * plugin chains of several threads.
+ */
+typedef struct {
+  PluginAutomationPoint *points;
+  unsigned long numPoints;
+
+  // Private fields
+  unsigned long _capacity;
+} PluginAutomationMembers;
+typedef PluginAutomationMembers *PluginAutomation;
+
+/**
+ * Create a new, empty automation list
+ * @return New automation list
+ */
+PluginAutomation newPluginAutomation(void);
+
+/**
+ * Add a parameter change to the list.
+ * @param self
+ * @param time Time of the change, in seconds. Must not be negative.
+ * @param index Parameter index
+ * @param value New parameter value
+ * @return True if the point was added
+ */
+boolByte pluginAutomationAddPoint(PluginAutomation self, double time,
+                                  unsigned int index, float value);
+
+/**
+ * Read parameter changes from a text file. Each line contains the time in
+ * seconds, the parameter index, and the new value, separated by commas. Empty
+ * lines and lines starting with '#' are ignored.
+ * @param self
+ * @param filename File to read
+ * @return True if all lines of the file could be read
+ */
+boolByte pluginAutomationReadFile(PluginAutomation self,
+                                  const CharString filename);
+
+/**
+ * Get the frame at which a point takes effect.
+ * @param point Automation point
+ * @param sampleRate Sample rate being processed
+ * @return Frame number, counted from the start of the input
+ */
+unsigned long pluginAutomationPointGetFrame(const PluginAutomationPoint *point,
+                                            SampleRate sampleRate);
+
+/**
+ * Free an automation list and all of its points
+ * @param self
+ */
+void freePluginAutomation(PluginAutomation self);
+
+#endif
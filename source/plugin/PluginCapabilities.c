@@ -0,0 +1,171 @@
+//
+// PluginCapabilities.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "PluginCapabilities.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char *kPluginCapabilityNames[NUM_PLUGIN_CAPABILITIES] = {
+    "parallel-load", "multi-instance", "fork-safe", "deterministic",
+    "offline"};
+static const char *kPluginCapabilityStateNames[NUM_PLUGIN_CAPABILITY_STATES] =
+    {"auto", "yes", "no"};
+static const char kPluginCapabilitiesSeparator = ',';
+
+PluginCapabilities newPluginCapabilities(void) {
+  PluginCapabilities self =
+      (PluginCapabilities)malloc(sizeof(PluginCapabilitiesMembers));
+  int i;
+
+  for (i = 0; i < NUM_PLUGIN_CAPABILITIES; i++) {
+    self->states[i] = PLUGIN_CAPABILITY_UNKNOWN;
+  }
+
+  return self;
+}
+
+const char *pluginCapabilityGetName(PluginCapability capability) {
+  return capability < NUM_PLUGIN_CAPABILITIES
+             ? kPluginCapabilityNames[capability]
+             : "invalid";
+}
+
+PluginCapability pluginCapabilityWithName(const char *name) {
+  int i;
+
+  for (i = 0; i < NUM_PLUGIN_CAPABILITIES; i++) {
+    if (strcmp(kPluginCapabilityNames[i], name) == 0) {
+      return (PluginCapability)i;
+    }
+  }
+
+  return NUM_PLUGIN_CAPABILITIES;
+}
+
+const char *pluginCapabilityStateGetName(PluginCapabilityState state) {
+  return state < NUM_PLUGIN_CAPABILITY_STATES
+             ? kPluginCapabilityStateNames[state]
+             : "invalid";
+}
+
+PluginCapabilityState pluginCapabilityStateWithName(const char *name) {
+  int i;
+
+  for (i = 0; i < NUM_PLUGIN_CAPABILITY_STATES; i++) {
+    if (strcmp(kPluginCapabilityStateNames[i], name) == 0) {
+      return (PluginCapabilityState)i;
+    }
+  }
+
+  return NUM_PLUGIN_CAPABILITY_STATES;
+}
+
+boolByte pluginCapabilitiesIsEmpty(const PluginCapabilities self) {
+  int i;
+
+  for (i = 0; i < NUM_PLUGIN_CAPABILITIES; i++) {
+    if (self->states[i] != PLUGIN_CAPABILITY_UNKNOWN) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void pluginCapabilitiesCopy(PluginCapabilities self,
+                            const PluginCapabilities other) {
+  memcpy(self->states, other->states, sizeof(self->states));
+}
+
+boolByte pluginCapabilitiesParse(PluginCapabilities self, const char *text) {
+  PluginCapabilityState states[NUM_PLUGIN_CAPABILITIES];
+  CharString buffer = newCharStringWithCString(text);
+  char *pair = buffer->data;
+  char *next;
+  char *equals;
+  PluginCapability capability;
+  PluginCapabilityState state;
+  boolByte result = true;
+
+  memcpy(states, self->states, sizeof(states));
+
+  while (*pair != '\0') {
+    next = strchr(pair, kPluginCapabilitiesSeparator);
+    if (next != NULL) {
+      *next = '\0';
+    }
+
+    equals = strchr(pair, '=');
+    if (equals == NULL) {
+      result = false;
+      break;
+    }
+
+    *equals = '\0';
+    capability = pluginCapabilityWithName(pair);
+    state = pluginCapabilityStateWithName(equals + 1);
+    if (capability == NUM_PLUGIN_CAPABILITIES ||
+        state == NUM_PLUGIN_CAPABILITY_STATES) {
+      result = false;
+      break;
+    }
+
+    states[capability] = state;
+    pair = next != NULL ? next + 1 : pair + strlen(pair);
+  }
+
+  if (result) {
+    memcpy(self->states, states, sizeof(states));
+  }
+
+  freeCharString(buffer);
+  return result;
+}
+
+CharString pluginCapabilitiesToString(const PluginCapabilities self) {
+  CharString result = newCharString();
+  int i;
+
+  for (i = 0; i < NUM_PLUGIN_CAPABILITIES; i++) {
+    if (self->states[i] == PLUGIN_CAPABILITY_UNKNOWN) {
+      continue;
+    }
+
+    if (!charStringIsEmpty(result)) {
+      charStringAppendCString(result, ",");
+    }
+    charStringAppendCString(result, kPluginCapabilityNames[i]);
+    charStringAppendCString(result, "=");
+    charStringAppendCString(result,
+                            pluginCapabilityStateGetName(self->states[i]));
+  }
+
+  return result;
+}
+
+void freePluginCapabilities(PluginCapabilities self) {
+  free(self);
+}
@@ -0,0 +1,139 @@
+//
+// PluginCapabilities.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_PluginCapabilities_h
+#define MrsWatson_PluginCapabilities_h
+
+#include "base/CharString.h"
+#include "base/Types.h"
+
+/**
+ * Behaviors which the host can only rely on for some plugins. Each one decides
+ * whether a faster way of hosting the plugin is safe.
+ */
+typedef enum {
+  // The plugin may be opened on its own thread while other plugins are being
+  // loaded, see --parallel-load
+  PLUGIN_CAPABILITY_PARALLEL_LOAD,
+  // Several instances of the plugin may process audio at the same time on
+  // different threads, as with --channel-instances and --fan-out
+  PLUGIN_CAPABILITY_MULTI_INSTANCE,
+  // The plugin keeps working in a process which was forked after it had been
+  // opened, as with the workers of --server-workers
+  PLUGIN_CAPABILITY_FORK_SAFE,
+  // The plugin produces the same output for the same input every time it has
+  // been reset, which is needed for --note-cache
+  PLUGIN_CAPABILITY_DETERMINISTIC,
+  // The plugin works when it is told that processing happens offline, see
+  // --offline
+  PLUGIN_CAPABILITY_OFFLINE,
+  NUM_PLUGIN_CAPABILITIES
+} PluginCapability;
+
+typedef enum {
+  // Not known yet, so the host falls back to the options given by the user
+  PLUGIN_CAPABILITY_UNKNOWN,
+  PLUGIN_CAPABILITY_SUPPORTED,
+  PLUGIN_CAPABILITY_UNSUPPORTED,
+  NUM_PLUGIN_CAPABILITY_STATES
+} PluginCapabilityState;
+
+/**
+ * What is known about each capability of a single plugin
+ */
+typedef struct {
+  PluginCapabilityState states[NUM_PLUGIN_CAPABILITIES];
+} PluginCapabilitiesMembers;
+typedef PluginCapabilitiesMembers *PluginCapabilities;
+
+/**
+ * @return New set of capabilities, which are all unknown
+ */
+PluginCapabilities newPluginCapabilities(void);
+
+/**
+ * @param capability Capability
+ * @return Name of the capability as used in the plugin index and on the
+ * command line, for example "parallel-load"
+ */
+const char *pluginCapabilityGetName(PluginCapability capability);
+
+/**
+ * @param name Name of a capability
+ * @return Matching capability, or NUM_PLUGIN_CAPABILITIES if there is none
+ */
+PluginCapability pluginCapabilityWithName(const char *name);
+
+/**
+ * @param state Capability state
+ * @return "yes", "no", or "auto" for an unknown state
+ */
+const char *pluginCapabilityStateGetName(PluginCapabilityState state);
+
+/**
+ * @param name "yes", "no", or "auto"
+ * @return Matching state, or NUM_PLUGIN_CAPABILITY_STATES if there is none
+ */
+PluginCapabilityState pluginCapabilityStateWithName(const char *name);
+
+/**
+ * @param self
+ * @return True if none of the capabilities are known
+ */
+boolByte pluginCapabilitiesIsEmpty(const PluginCapabilities self);
+
+/**
+ * Copy all states from another set of capabilities.
+ * @param self
+ * @param other Capabilities to copy
+ */
+void pluginCapabilitiesCopy(PluginCapabilities self,
+                            const PluginCapabilities other);
+
+/**
+ * Set capabilities from a comma-separated list of name=state pairs, as written
+ * by pluginCapabilitiesToString(). Capabilities which are not in the list keep
+ * their state.
+ * @param self
+ * @param text List of capabilities, for example "parallel-load=yes,offline=no"
+ * @return False if the list contains an unknown name or state, in which case
+ * none of the capabilities are changed
+ */
+boolByte pluginCapabilitiesParse(PluginCapabilities self, const char *text);
+
+/**
+ * @param self
+ * @return New string with a comma-separated list of all known capabilities,
+ * which is empty if none are known
+ */
+CharString pluginCapabilitiesToString(const PluginCapabilities self);
+
+/**
+ * Release a set of capabilities.
+ * @param self
+ */
+void freePluginCapabilities(PluginCapabilities self);
+
+#endif
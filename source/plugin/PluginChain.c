@@ -26,307 +26,3012 @@
 
 #include "PluginChain.h"
 
+#include "app/LiveMetrics.h"
+#include "app/RealtimeAudit.h"
+#include "app/RenderContext.h"
+#include "app/SamplingProfiler.h"
 #include "audio/AudioSettings.h"
+#include "base/FpuState.h"
 #include "logging/EventLogger.h"
+#include "midi/MidiEvent.h"
+#include "plugin/PluginGain.h"
+#include "plugin/PluginIsolated.h"
+#include "plugin/PluginPassthru.h"
+#include "plugin/PluginSilence.h"
+#include "time/AudioClock.h"
+#include "time/TraceEvents.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+static const unsigned int kPluginChainInitialCapacity = 8;
+static const unsigned short kPluginChainAllMidiChannels = 0xffff;
+// Automation points which are closer than this to the start of a part of a
+// block are applied together with it, to avoid processing very short parts
+static const SampleCount kPluginChainMinAutomationFrames = 32;
+// Longest tail which is rendered after a note, for chains which do not report
+// a tail time
+static const double kPluginChainNoteRenderMaxTailInMs = 10000.0;
+// The render of a note ends once its output has been silent for this long
+static const double kPluginChainNoteRenderSilenceInMs = 100.0;
+
 PluginChain pluginChainInstance = NULL;
 
-PluginChain getPluginChain(void) { return pluginChainInstance; }
+// Time which the calling thread spent in host callbacks, which is read before
+// and after each plugin processes audio
+static THREAD_LOCAL uint64_t _pluginChainHostCallbackTimeInNs = 0;
+// Callbacks which are made from within another callback are already counted
+static THREAD_LOCAL unsigned int _pluginChainHostCallbackDepth = 0;
+
+PluginChain getPluginChain(void) {
+  RenderContext renderContext = getRenderContext();
+  return renderContext != NULL ? renderContext->pluginChain
+                               : pluginChainInstance;
+}
+
+static void _pluginChainGrow(PluginChain self) {
+  self->_capacity = self->_capacity > 0 ? self->_capacity * 2
+                                        : kPluginChainInitialCapacity;
+  self->plugins =
+      (Plugin *)realloc(self->plugins, sizeof(Plugin) * self->_capacity);
+  self->presets = (PluginPreset *)realloc(
+      self->presets, sizeof(PluginPreset) * self->_capacity);
+  self->audioTimers = (TaskTimer *)realloc(
+      self->audioTimers, sizeof(TaskTimer) * self->_capacity);
+  self->midiTimers = (TaskTimer *)realloc(
+      self->midiTimers, sizeof(TaskTimer) * self->_capacity);
+  self->audioLatencies = (LatencyHistogram *)realloc(
+      self->audioLatencies, sizeof(LatencyHistogram) * self->_capacity);
+  self->hostCallbackTimes = (double *)realloc(
+      self->hostCallbackTimes, sizeof(double) * self->_capacity);
+  self->perfCounters = (PerfCounters *)realloc(
+      self->perfCounters, sizeof(PerfCounters) * self->_capacity);
+  self->_silentInputFrames = (unsigned long *)realloc(
+      self->_silentInputFrames, sizeof(unsigned long) * self->_capacity);
+  self->_silenceHoldFrames = (unsigned long *)realloc(
+      self->_silenceHoldFrames, sizeof(unsigned long) * self->_capacity);
+  self->_pluginBlocksizes = (SampleCount *)realloc(
+      self->_pluginBlocksizes, sizeof(SampleCount) * self->_capacity);
+  self->_reblockers = (SampleReblocker *)realloc(
+      self->_reblockers, sizeof(SampleReblocker) * self->_capacity);
+  self->_instanceGroups = (PluginChainInstanceGroup *)realloc(
+      self->_instanceGroups,
+      sizeof(PluginChainInstanceGroup) * self->_capacity);
+  self->_inputRoutes = (SampleBufferMembers *)realloc(
+      self->_inputRoutes, sizeof(SampleBufferMembers) * self->_capacity);
+  self->_midiChannels = (unsigned short *)realloc(
+      self->_midiChannels, sizeof(unsigned short) * self->_capacity);
+}
+
+PluginChain newPluginChain(void) {
+  PluginChain self = (PluginChain)malloc(sizeof(PluginChainMembers));
+
+  self->numPlugins = 0;
+  self->plugins = NULL;
+  self->presets = NULL;
+  self->audioTimers = NULL;
+  self->midiTimers = NULL;
+  self->audioLatencies = NULL;
+  self->hostCallbackTimes = NULL;
+  self->perfCounters = NULL;
+  self->_silentInputFrames = NULL;
+  self->_silenceHoldFrames = NULL;
+  self->_pluginBlocksizes = NULL;
+  self->_reblockers = NULL;
+  self->_instanceGroups = NULL;
+  self->_inputRoutes = NULL;
+  self->_midiChannels = NULL;
+  self->_capacity = 0;
+  _pluginChainGrow(self);
+  self->chainLatency = newLatencyHistogram();
+
+  self->_measurePerfCounters = false;
+  self->_realtime = false;
+  self->_scheduler = newRealtimeScheduler();
+  self->_flushDenormals = true;
+  self->_blockTimer = newTaskTimerWithCString("PluginChain", "Block");
+  self->_pipelined = false;
+  self->_stages = NULL;
+  self->_stopStages = false;
+  self->_numPipelineBlocks = 0;
+  self->_splits = NULL;
+  self->_numSplits = 0;
+  self->_splitOpen = false;
+  self->_splitsStarted = false;
+  self->_splitsBlocksize = 0;
+  self->_stopSplits = false;
+  self->_skipSilence = false;
+  self->_midiReceived = false;
+  self->_channelInstances = false;
+  self->_parallelLoading = false;
+  self->_serialLoadPlugins = newLinkedList();
+  self->_midiRoutes = newLinkedList();
+  self->_midiRouteEvents = newLinkedList();
+  self->_isolatedHost = NULL;
+  self->_sidechainPluginName = NULL;
+  self->_sidechainPlugin = NULL;
+  self->_sidechain = NULL;
+  self->_lastOutputs = NULL;
+  self->_automation = NULL;
+  self->_automationNextPoint = 0;
+  self->_automationFrame = 0;
+  self->_automationInputs = NULL;
+  self->_automationOutputs = NULL;
+  self->_automationNumChannels = 0;
+  self->_automationMidiEvents = NULL;
+  self->_automationPartMidiEvents = newLinkedList();
+  self->_noteRenderCache = NULL;
+  self->_control = NULL;
+  self->_degrader = NULL;
+  self->_degradePolicies = NULL;
+  self->_lastBlockTimeInMs = 0.0;
+  self->_lastBlockBudgetInMs = 0.0;
+  self->_recentBlockTimes = NULL;
+  self->_numRecentBlocks = 0;
+  return self;
+}
+
+void initPluginChain(void) { pluginChainInstance = newPluginChain(); }
+
+// Plugins which are not opened here are opened by _pluginChainLoadPlugins()
+static boolByte _pluginChainAppend(PluginChain self, Plugin plugin,
+                                   PluginPreset preset, boolByte open) {
+  if (plugin == NULL) {
+    return false;
+  } else if (self->_stages != NULL || self->_splitsStarted) {
+    logError("Could not add plugin '%s', chain is already processing",
+             plugin->pluginName->data);
+    return false;
+  } else if (open && !openPlugin(plugin)) {
+    return false;
+  } else {
+    if (self->numPlugins == self->_capacity) {
+      _pluginChainGrow(self);
+    }
+
+    self->plugins[self->numPlugins] = plugin;
+    self->presets[self->numPlugins] = preset;
+    self->audioTimers[self->numPlugins] =
+        newTaskTimer(plugin->pluginName, "Audio Processing");
+    self->midiTimers[self->numPlugins] =
+        newTaskTimer(plugin->pluginName, "MIDI Processing");
+    self->audioLatencies[self->numPlugins] = newLatencyHistogram();
+    self->hostCallbackTimes[self->numPlugins] = 0.0;
+    // Audio is processed once per block, so the thread's CPU clock is cheap
+    // enough to read there
+    taskTimerSetMeasureCpuTime(self->audioTimers[self->numPlugins], true);
+    self->perfCounters[self->numPlugins] = newPerfCounters();
+    self->perfCounters[self->numPlugins]->enabled = self->_measurePerfCounters;
+    self->_silentInputFrames[self->numPlugins] = 0;
+    self->_silenceHoldFrames[self->numPlugins] = 0;
+    self->_pluginBlocksizes[self->numPlugins] = 0;
+    self->_reblockers[self->numPlugins] = NULL;
+    self->_instanceGroups[self->numPlugins] = NULL;
+    self->_inputRoutes[self->numPlugins].numChannels = 0;
+    self->_inputRoutes[self->numPlugins].samples = NULL;
+    self->_midiChannels[self->numPlugins] =
+        self->numPlugins == 0 ? kPluginChainAllMidiChannels : 0;
+    self->numPlugins++;
+
+    if (self->_splitOpen) {
+      PluginChainSplit split = &(self->_splits[self->_numSplits - 1]);
+      split->branches[split->numBranches - 1].numPlugins++;
+      split->numPlugins++;
+    }
+
+    return true;
+  }
+}
+
+boolByte pluginChainAppend(PluginChain self, Plugin plugin,
+                           PluginPreset preset) {
+  return _pluginChainAppend(self, plugin, preset, true);
+}
+
+static void _pluginChainAppendBranch(PluginChainSplit split) {
+  PluginChainBranch branch;
+
+  split->branches = (PluginChainBranch)realloc(
+      split->branches, sizeof(PluginChainBranchMembers) *
+                           (split->numBranches + 1));
+  branch = &(split->branches[split->numBranches]);
+  branch->firstPlugin = split->firstPlugin + split->numPlugins;
+  branch->numPlugins = 0;
+  branch->pluginChain = NULL;
+  branch->input = NULL;
+  branch->output = NULL;
+  branch->processingTimesInMs = NULL;
+  branch->delay = 0;
+  branch->delayLine = NULL;
+  branch->delayPosition = 0;
+  branch->thread = NULL;
+  branch->start = NULL;
+  branch->done = NULL;
+  split->numBranches++;
+}
+
+boolByte pluginChainBeginSplit(PluginChain self) {
+  PluginChainSplit split;
+
+  if (self->_splitOpen) {
+    logError("Splits in the plugin chain may not be nested");
+    return false;
+  } else if (self->_stages != NULL || self->_splitsStarted) {
+    logError("Could not add split, chain is already processing");
+    return false;
+  }
+
+  self->_splits = (PluginChainSplit)realloc(
+      self->_splits, sizeof(PluginChainSplitMembers) * (self->_numSplits + 1));
+  split = &(self->_splits[self->_numSplits]);
+  split->firstPlugin = self->numPlugins;
+  split->numPlugins = 0;
+  split->numBranches = 0;
+  split->branches = NULL;
+  split->mixBuffer = NULL;
+  _pluginChainAppendBranch(split);
+
+  self->_numSplits++;
+  self->_splitOpen = true;
+  return true;
+}
+
+boolByte pluginChainAddBranch(PluginChain self) {
+  PluginChainSplit split;
+
+  if (!self->_splitOpen) {
+    logError("Could not add branch, no split has been started");
+    return false;
+  }
+
+  split = &(self->_splits[self->_numSplits - 1]);
+
+  if (split->branches[split->numBranches - 1].numPlugins == 0) {
+    logError("Branches in the plugin chain may not be empty");
+    return false;
+  }
+
+  _pluginChainAppendBranch(split);
+  return true;
+}
+
+boolByte pluginChainEndSplit(PluginChain self) {
+  PluginChainSplit split;
+
+  if (!self->_splitOpen) {
+    logError("Could not end split, no split has been started");
+    return false;
+  }
+
+  split = &(self->_splits[self->_numSplits - 1]);
+
+  if (split->branches[split->numBranches - 1].numPlugins == 0) {
+    logError("Branches in the plugin chain may not be empty");
+    return false;
+  }
+
+  // A split with only one branch is the same as a serial chain
+  if (split->numBranches == 1) {
+    free(split->branches);
+    self->_numSplits--;
+  }
+
+  self->_splitOpen = false;
+  return true;
+}
+
+static boolByte _pluginChainAddFromNameString(PluginChain self,
+                                             const char *name,
+                                             size_t nameLength,
+                                             const CharString userSearchPath) {
+  CharString pluginNameBuffer = nameLength < kCharStringLengthDefault
+                                    ? newCharString()
+                                    : newCharStringWithCapacity(nameLength + 1);
+  CharString presetNameBuffer = newCharString();
+  char *presetSeparator;
+  char *blocksizeSeparator;
+  char *blocksizeEnd;
+  long blocksize = 0;
+  PluginPreset preset = NULL;
+  Plugin plugin;
+  boolByte result = true;
+
+  strncpy(pluginNameBuffer->data, name, nameLength);
+
+  // Look for the separator for presets to load into these plugins
+  presetSeparator =
+      strchr(pluginNameBuffer->data, CHAIN_STRING_PROGRAM_SEPARATOR);
+
+  if (presetSeparator != NULL) {
+    // Null-terminate this string to force it to end, then extract preset name
+    // from next char
+    *presetSeparator = '\0';
+    charStringCopyCString(presetNameBuffer, presetSeparator + 1);
+  }
+
+  // The plugin's own blocksize may follow its name
+  blocksizeSeparator =
+      strrchr(pluginNameBuffer->data, CHAIN_STRING_BLOCKSIZE_SEPARATOR);
+
+  if (blocksizeSeparator != NULL) {
+    blocksize = strtol(blocksizeSeparator + 1, &blocksizeEnd, 10);
+
+    if (blocksizeEnd == blocksizeSeparator + 1 || *blocksizeEnd != '\0' ||
+        blocksize <= 0) {
+      logError("Invalid blocksize '%s' for plugin", blocksizeSeparator + 1);
+      freeCharString(pluginNameBuffer);
+      freeCharString(presetNameBuffer);
+      return false;
+    }
+
+    *blocksizeSeparator = '\0';
+  }
+
+  // Find preset for this plugin (if given). Isolated plugins open their
+  // preset in the child process instead.
+  if (strlen(presetNameBuffer->data) > 0 && self->_isolatedHost == NULL) {
+    logInfo("Opening preset '%s' for plugin", presetNameBuffer->data);
+    preset = pluginPresetFactory(presetNameBuffer);
+  }
+
+  if (self->_isolatedHost != NULL) {
+    plugin = newPluginIsolated(pluginNameBuffer, userSearchPath,
+                               presetNameBuffer, self->_isolatedHost);
+  } else {
+    // Guess the plugin type from the file extension, search root, etc.
+    plugin = pluginFactory(pluginNameBuffer, userSearchPath);
+  }
+
+  if (plugin != NULL) {
+    if (!_pluginChainAppend(self, plugin, preset, false)) {
+      logError("Plugin '%s' could not be added to the chain",
+               pluginNameBuffer->data);
+      result = false;
+    } else if (blocksize > 0) {
+      result = pluginChainSetPluginBlocksize(self, self->numPlugins - 1,
+                                             (SampleCount)blocksize);
+    }
+  }
+
+  freeCharString(pluginNameBuffer);
+  freeCharString(presetNameBuffer);
+  return result;
+}
+
+static boolByte _loadPresetForPlugin(Plugin plugin, PluginPreset preset) {
+  const uint64_t startTimeInNs = taskTimerGetTimestampInNs();
+
+  if (pluginPresetIsCompatibleWith(preset, plugin)) {
+    if (!preset->openPreset(preset)) {
+      logError("Could not open preset '%s'", preset->presetName->data);
+      return false;
+    }
+
+    if (!preset->loadPreset(preset, plugin)) {
+      logError("Could not load preset '%s' in plugin '%s'",
+               preset->presetName->data, plugin->pluginName->data);
+      return false;
+    }
+
+    traceEventsRecord(plugin->pluginName->data, "Load Preset", startTimeInNs,
+                      taskTimerGetTimestampInNs());
+    logInfo("Loaded preset '%s' in plugin '%s'", preset->presetName->data,
+            plugin->pluginName->data);
+    return true;
+  } else {
+    logError("Preset '%s' is not a compatible format for plugin",
+             preset->presetName->data);
+    return false;
+  }
+}
+
+// Plugins may be given with a path and extension in the chain string, which
+// are removed when they are opened, so only the name itself is compared
+static boolByte _pluginChainNameMatches(const CharString pluginName,
+                                        const CharString name) {
+  const size_t nameLength = strlen(name->data);
+  const char *basename = pluginName->data;
+  const char *extension;
+  const char *c;
+
+  for (c = pluginName->data; *c != '\0'; c++) {
+    if (*c == '/' || *c == '\\') {
+      basename = c + 1;
+    }
+  }
+
+  extension = strrchr(basename, '.');
+
+  if (extension != NULL && (size_t)(extension - basename) == nameLength &&
+      strncasecmp(basename, name->data, nameLength) == 0) {
+    return true;
+  }
+
+  return (boolByte)(strlen(basename) == nameLength &&
+                    strncasecmp(basename, name->data, nameLength) == 0);
+}
+
+static boolByte _pluginChainCanLoadInParallel(PluginChain self,
+                                              Plugin plugin) {
+  LinkedListIterator iterator;
+
+  // Internal plugins load instantly, so only plugins which load a library are
+  // worth a thread
+  if (plugin->interfaceType != PLUGIN_TYPE_VST_2X) {
+    return false;
+  }
+
+  for (iterator = self->_serialLoadPlugins; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    if (iterator->item != NULL &&
+        _pluginChainNameMatches(plugin->pluginName,
+                                (CharString)iterator->item)) {
+      return false;
+    }
+  }
+
+  // A capability in the plugin index outweighs the option, since it was
+  // either probed or set by the user for this plugin
+  switch (pluginGetCapability(plugin, PLUGIN_CAPABILITY_PARALLEL_LOAD)) {
+  case PLUGIN_CAPABILITY_SUPPORTED:
+    return true;
+  case PLUGIN_CAPABILITY_UNSUPPORTED:
+    logDebug("Plugin '%s' does not support parallel loading",
+             plugin->pluginName->data);
+    return false;
+  default:
+    return self->_parallelLoading;
+  }
+}
+
+// Open the plugin at index i, and when initializing, also check its type and
+// load its preset
+static ReturnCode _pluginChainLoadPlugin(PluginChain self, unsigned int i,
+                                         boolByte initialize) {
+  Plugin plugin = self->plugins[i];
+  PluginPreset preset = self->presets[i];
+  const uint64_t startTimeInNs = taskTimerGetTimestampInNs();
+  const boolByte opened = openPlugin(plugin);
+
+  // Plugins take their own name when opened, so the event is recorded after
+  traceEventsRecord(plugin->pluginName->data, "Load Plugin", startTimeInNs,
+                    taskTimerGetTimestampInNs());
+
+  if (!opened) {
+    return RETURN_CODE_PLUGIN_ERROR;
+  } else if (!initialize) {
+    return RETURN_CODE_SUCCESS;
+  } else if (i > 0 && plugin->pluginType == PLUGIN_TYPE_INSTRUMENT) {
+    logError("Instrument plugin '%s' must be first in the chain",
+             plugin->pluginName->data);
+    return RETURN_CODE_INVALID_PLUGIN_CHAIN;
+  } else if (plugin->pluginType == PLUGIN_TYPE_UNKNOWN) {
+    logError("Plugin '%s' has unknown type; It was probably not loaded "
+             "correctly",
+             plugin->pluginName->data);
+    return RETURN_CODE_PLUGIN_ERROR;
+  } else if (plugin->pluginType == PLUGIN_TYPE_UNSUPPORTED) {
+    logError("Plugin '%s' is of unsupported type", plugin->pluginName->data);
+    return RETURN_CODE_PLUGIN_ERROR;
+  } else if (preset != NULL && !_loadPresetForPlugin(plugin, preset)) {
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  return RETURN_CODE_SUCCESS;
+}
+
+typedef struct {
+  PluginChain pluginChain;
+  unsigned int index;
+  boolByte initialize;
+  RenderContext renderContext;
+  Thread thread;
+  ReturnCode result;
+} _PluginChainLoadJobMembers;
+typedef _PluginChainLoadJobMembers *_PluginChainLoadJob;
+
+static void _pluginChainLoadThread(void *jobPtr) {
+  _PluginChainLoadJob job = (_PluginChainLoadJob)jobPtr;
+
+  // Opening a plugin reads the blocksize and other settings, which must come
+  // from the context that the chain is being built in
+  renderContextMakeCurrent(job->renderContext);
+  job->result =
+      _pluginChainLoadPlugin(job->pluginChain, job->index, job->initialize);
+  renderContextMakeCurrent(NULL);
+}
+
+// Load all plugins starting at firstPlugin. With parallel loading, each VST
+// plugin is loaded on its own thread, and all other plugins are loaded on the
+// calling thread in the meantime. The result is that of the first plugin in
+// the chain which failed.
+static ReturnCode _pluginChainLoadPlugins(PluginChain self,
+                                          unsigned int firstPlugin,
+                                          boolByte initialize) {
+  const unsigned int numJobs = self->numPlugins - firstPlugin;
+  _PluginChainLoadJob jobs;
+  _PluginChainLoadJob job;
+  ReturnCode result = RETURN_CODE_SUCCESS;
+  unsigned int i;
+
+  if (numJobs == 0) {
+    return RETURN_CODE_SUCCESS;
+  }
+
+  jobs = (_PluginChainLoadJob)calloc(numJobs,
+                                     sizeof(_PluginChainLoadJobMembers));
+
+  for (i = 0; i < numJobs; i++) {
+    job = &(jobs[i]);
+    job->pluginChain = self;
+    job->index = firstPlugin + i;
+    job->initialize = initialize;
+    job->renderContext = getRenderContext();
+    job->result = RETURN_CODE_SUCCESS;
+
+    if (_pluginChainCanLoadInParallel(self, self->plugins[job->index])) {
+      job->thread = newThread(_pluginChainLoadThread, job);
+
+      if (job->thread == NULL) {
+        logWarn("Could not start thread to load plugin '%s', it will be "
+                "loaded on the main thread",
+                self->plugins[job->index]->pluginName->data);
+      }
+    }
+  }
+
+  for (i = 0; i < numJobs; i++) {
+    job = &(jobs[i]);
+
+    if (job->thread != NULL) {
+      threadJoinAndFree(job->thread);
+    } else if (result == RETURN_CODE_SUCCESS) {
+      job->result = _pluginChainLoadPlugin(self, job->index, initialize);
+    } else {
+      // Plugins on the calling thread are not loaded after one has failed
+      continue;
+    }
+
+    if (job->result != RETURN_CODE_SUCCESS) {
+      if (result == RETURN_CODE_SUCCESS) {
+        result = job->result;
+      }
+    } else {
+      // VST plugins take a friendlier name once they are opened
+      charStringCopy(self->audioTimers[job->index]->component,
+                     self->plugins[job->index]->pluginName);
+      charStringCopy(self->midiTimers[job->index]->component,
+                     self->plugins[job->index]->pluginName);
+    }
+  }
+
+  free(jobs);
+  return result;
+}
+boolByte pluginChainAddFromArgumentString(PluginChain pluginChain,
+                                          const CharString argumentString,
+                                          const CharString userSearchPath) {
+  // Expect a semicolon-separated string of plugins with comma separators for
+  // preset names, and splits given as pipe-separated branches in brackets
+  // Example: plugin1,preset1name;[plugin2|plugin3;plugin4];plugin5
+  const char separators[] = {
+      CHAIN_STRING_PLUGIN_SEPARATOR, CHAIN_STRING_SPLIT_START,
+      CHAIN_STRING_SPLIT_END, CHAIN_STRING_BRANCH_SEPARATOR, '\0'};
+  const unsigned int firstPlugin = pluginChain->numPlugins;
+  const char *substringStart;
+  size_t substringLength;
+  boolByte result = true;
+
+  if (charStringIsEmpty(argumentString)) {
+    logWarn("Plugin chain string is empty");
+    return false;
+  }
+
+  substringStart = argumentString->data;
+
+  while (result && *substringStart != '\0') {
+    substringLength = strcspn(substringStart, separators);
+
+    if (substringLength > 0) {
+      result = _pluginChainAddFromNameString(pluginChain, substringStart,
+                                             substringLength, userSearchPath);
+
+      if (!result) {
+        break;
+      }
+    }
+
+    substringStart += substringLength;
+
+    switch (*substringStart) {
+    case CHAIN_STRING_SPLIT_START:
+      result = pluginChainBeginSplit(pluginChain);
+      break;
+
+    case CHAIN_STRING_BRANCH_SEPARATOR:
+      result = pluginChainAddBranch(pluginChain);
+      break;
+
+    case CHAIN_STRING_SPLIT_END:
+      result = pluginChainEndSplit(pluginChain);
+      break;
+
+    default:
+      break;
+    }
+
+    if (*substringStart != '\0') {
+      substringStart++;
+    }
+  }
+
+  if (result && pluginChain->_splitOpen) {
+    logError("Split in plugin chain string is missing '%c'",
+             CHAIN_STRING_SPLIT_END);
+    result = false;
+  }
+
+  // Nothing is loaded until the whole string has been resolved, so that an
+  // invalid chain fails without paying for the plugins before the error
+  if (result) {
+    result = (boolByte)(_pluginChainLoadPlugins(pluginChain, firstPlugin,
+                                                false) == RETURN_CODE_SUCCESS);
+  }
+
+  return result;
+}
+
+static void _pluginChainInstanceThread(void *instancePtr) {
+  PluginChainInstance instance = (PluginChainInstance)instancePtr;
+  PluginChainInstanceGroup group = (PluginChainInstanceGroup)instance->group;
+
+  // This thread only processes audio, so the state is never restored
+  if (group->flushDenormals) {
+    fpuStateFlushDenormals();
+  }
+
+  while (true) {
+    semaphoreWait(instance->start);
+
+    // Only changed while all instances are idle, so no further locking is
+    // needed
+    if (group->stopInstances) {
+      break;
+    }
+
+    instance->plugin->processAudio(instance->plugin, &(instance->input),
+                                   &(instance->output));
+    semaphorePost(instance->done);
+  }
+}
+
+static void _pluginChainStopInstanceThreads(PluginChainInstanceGroup group) {
+  PluginChainInstance instance;
+  unsigned int i;
+
+  group->stopInstances = true;
+
+  for (i = 0; i < group->numInstances; i++) {
+    instance = &(group->instances[i]);
+
+    if (instance->thread != NULL) {
+      semaphorePost(instance->start);
+      threadJoinAndFree(instance->thread);
+      instance->thread = NULL;
+    }
+
+    freeSemaphore(instance->start);
+    instance->start = NULL;
+    freeSemaphore(instance->done);
+    instance->done = NULL;
+  }
+
+  group->stopInstances = false;
+}
+
+// The first instance is the plugin in the chain, so it is not freed here
+static void _freePluginChainInstanceGroup(PluginChainInstanceGroup group) {
+  unsigned int i;
+
+  if (group != NULL) {
+    _pluginChainStopInstanceThreads(group);
+
+    for (i = 1; i < group->numInstances; i++) {
+      freePlugin(group->instances[i].plugin);
+    }
+
+    free(group->instances);
+    free(group);
+  }
+}
+
+static Plugin _pluginChainNewInstance(Plugin plugin, PluginPreset preset) {
+  Plugin instance =
+      plugin->interfaceType == PLUGIN_TYPE_ISOLATED
+          ? pluginIsolatedNewInstance(plugin)
+          : pluginFactory(plugin->pluginName, plugin->pluginLocation);
+  PluginPreset instancePreset;
+  boolByte result;
+
+  if (instance == NULL || !openPlugin(instance)) {
+    freePlugin(instance);
+    return NULL;
+  }
+
+  if (preset != NULL) {
+    // Presets can only be loaded once, so each instance opens its own copy
+    instancePreset = pluginPresetFactory(preset->presetName);
+    result = instancePreset != NULL &&
+             _loadPresetForPlugin(instance, instancePreset);
+    freePluginPreset(instancePreset);
+
+    if (!result) {
+      closePlugin(instance);
+      freePlugin(instance);
+      return NULL;
+    }
+  }
+
+  return instance;
+}
+
+static boolByte _pluginChainAddInstances(PluginChain self, unsigned int i) {
+  Plugin plugin = self->plugins[i];
+  const ChannelCount numChannels = getNumChannels();
+  const ChannelCount channelsPerInstance = plugin->inputBuffer->numChannels;
+  PluginChainInstanceGroup group;
+  PluginChainInstance instance;
+  unsigned int numInstances;
+
+  if (self->_instanceGroups[i] != NULL ||
+      plugin->pluginType != PLUGIN_TYPE_EFFECT || channelsPerInstance == 0 ||
+      channelsPerInstance != plugin->outputBuffer->numChannels ||
+      channelsPerInstance >= numChannels) {
+    return true;
+  } else if (pluginGetCapability(plugin, PLUGIN_CAPABILITY_MULTI_INSTANCE) ==
+             PLUGIN_CAPABILITY_UNSUPPORTED) {
+    logInfo("Plugin '%s' does not support running several instances, "
+            "processing %d channels with one instance",
+            plugin->pluginName->data, numChannels);
+    return true;
+  }
+
+  numInstances = (numChannels + channelsPerInstance - 1) / channelsPerInstance;
+  group = (PluginChainInstanceGroup)malloc(
+      sizeof(PluginChainInstanceGroupMembers));
+  group->numInstances = 0;
+  group->channelsPerInstance = channelsPerInstance;
+  group->instances = (PluginChainInstance)calloc(
+      numInstances, sizeof(PluginChainInstanceMembers));
+  group->stopInstances = false;
+  group->flushDenormals = self->_flushDenormals;
+
+  for (group->numInstances = 0; group->numInstances < numInstances;
+       group->numInstances++) {
+    instance = &(group->instances[group->numInstances]);
+    instance->group = group;
+
+    if (group->numInstances == 0) {
+      instance->plugin = plugin;
+      continue;
+    }
+
+    instance->plugin = _pluginChainNewInstance(plugin, self->presets[i]);
+
+    if (instance->plugin == NULL) {
+      logError("Could not create instance %d of plugin '%s'",
+               group->numInstances + 1, plugin->pluginName->data);
+      _freePluginChainInstanceGroup(group);
+      return false;
+    }
+
+    instance->start = newSemaphore(0);
+    instance->done = newSemaphore(0);
+    instance->thread = newThread(_pluginChainInstanceThread, instance);
+
+    if (instance->thread == NULL) {
+      logWarn("Could not start thread for instance %d of plugin '%s', it will "
+              "be processed on the main thread",
+              group->numInstances + 1, plugin->pluginName->data);
+    }
+  }
+
+  // The chain passes all channels to the plugin, which are then divided
+  // between the instances
+  freeSampleBuffer(plugin->inputBuffer);
+  plugin->inputBuffer =
+      newSampleBuffer(channelsPerInstance * numInstances, getBlocksize());
+  freeSampleBuffer(plugin->outputBuffer);
+  plugin->outputBuffer =
+      newSampleBuffer(channelsPerInstance * numInstances, getBlocksize());
+
+  logInfo("Processing %d channels with %d instances of plugin '%s'",
+          numChannels, numInstances, plugin->pluginName->data);
+  self->_instanceGroups[i] = group;
+  return true;
+}
+
+// Plans how the channels of each plugin's source are routed to its inputs.
+// Each plugin gets one channel pointer per input, which is all that is needed
+// to map any source to it. Mismatches between neighbouring plugins in the
+// chain are logged here, since they are otherwise only visible in the output.
+static void _pluginChainPlanInputRoutes(PluginChain self) {
+  ChannelCount numSourceChannels = getNumChannels();
+  SampleBuffer route;
+  Plugin plugin;
+  unsigned int i;
+
+  for (i = 0; i < self->numPlugins; i++) {
+    plugin = self->plugins[i];
+    route = &(self->_inputRoutes[i]);
+    free(route->samples);
+    route->numChannels = 0;
+    route->blocksize = 0;
+    route->samples = NULL;
+    route->_storage = NULL;
+    route->_stride = 0;
+
+    if (plugin->inputBuffer == NULL) {
+      continue;
+    } else if (plugin->inputBuffer->numChannels > 0) {
+      route->numChannels = plugin->inputBuffer->numChannels;
+      route->samples = (Samples *)malloc(sizeof(Samples) * route->numChannels);
+
+      if (numSourceChannels != route->numChannels) {
+        logDebug("Routing %d channels to %d inputs of plugin '%s'",
+                 numSourceChannels, route->numChannels,
+                 plugin->pluginName->data);
+      }
+    }
+
+    numSourceChannels = plugin->outputBuffer->numChannels;
+  }
+}
+
+// Finds the plugin which receives the sidechain, and gives the sidechain room
+// for a block at the current blocksize
+static void _pluginChainPlanSidechain(PluginChain self) {
+  ChannelCount numChannels;
+  Plugin plugin;
+  unsigned int i;
+
+  self->_sidechainPlugin = NULL;
+
+  if (self->_sidechain == NULL) {
+    return;
+  }
+
+  numChannels = self->_sidechain->numChannels;
+  freeSampleBuffer(self->_sidechain);
+  self->_sidechain = newSampleBuffer(numChannels, getBlocksize());
+
+  for (i = 0; i < self->numPlugins; i++) {
+    plugin = self->plugins[i];
+
+    if (!_pluginChainNameMatches(plugin->pluginName,
+                                 self->_sidechainPluginName)) {
+      continue;
+    } else if (self->_instanceGroups[i] != NULL) {
+      logWarn("Plugin '%s' does not receive the sidechain, since it is "
+              "processed by several instances",
+              plugin->pluginName->data);
+    } else if (i > 0 && pluginChainGetPipelineDelayInBlocks(self) > 0) {
+      logWarn("Plugin '%s' does not receive the sidechain, since the chain is "
+              "pipelined",
+              plugin->pluginName->data);
+    } else if (self->_inputRoutes[i].numChannels <= numChannels) {
+      logWarn("Plugin '%s' has %d inputs, which leaves none for the chain "
+              "after the %d channels of the sidechain",
+              plugin->pluginName->data, self->_inputRoutes[i].numChannels,
+              numChannels);
+    } else {
+      logInfo("Routing %d channels of the sidechain to the last inputs of "
+              "plugin '%s'",
+              numChannels, plugin->pluginName->data);
+      self->_sidechainPlugin = plugin;
+    }
+
+    return;
+  }
+
+  logWarn("No plugin '%s' to receive the sidechain in the chain",
+          self->_sidechainPluginName->data);
+}
+
+// Plugins which match any route receive the channels of all of their routes,
+// and the rest keep the default of MIDI only going to the first plugin
+static void _pluginChainPlanMidiRoutes(PluginChain self) {
+  LinkedListIterator iterator;
+  PluginChainMidiRoute route;
+  unsigned short channels;
+  boolByte routed;
+  unsigned int i;
+
+  for (i = 0; i < self->numPlugins; i++) {
+    channels = 0;
+    routed = false;
+
+    for (iterator = linkedListBegin(self->_midiRoutes); iterator != NULL;
+         iterator = linkedListIteratorNext(iterator)) {
+      route = (PluginChainMidiRoute)linkedListIteratorGetItem(iterator);
+
+      if (_pluginChainNameMatches(self->plugins[i]->pluginName,
+                                  route->pluginName)) {
+        channels |= route->channels;
+        routed = true;
+      }
+    }
+
+    if (!routed) {
+      continue;
+    } else if (i > 0 && pluginChainGetPipelineDelayInBlocks(self) > 0) {
+      logWarn("Plugin '%s' does not receive MIDI, since the chain is "
+              "pipelined",
+              self->plugins[i]->pluginName->data);
+    } else {
+      logDebug("Routing MIDI channels 0x%04x to plugin '%s'", channels,
+               self->plugins[i]->pluginName->data);
+      self->_midiChannels[i] = channels;
+    }
+  }
+}
+
+static void _pluginChainPlanDegradePolicies(PluginChain self) {
+  PluginDegradePolicy policy;
+  boolByte matched;
+  unsigned int i;
+  unsigned int j;
+
+  if (self->_degrader == NULL) {
+    return;
+  }
+
+  free(self->_degradePolicies);
+  self->_degradePolicies =
+      (PluginDegradePolicy *)calloc(self->numPlugins + 1,
+                                    sizeof(PluginDegradePolicy));
+
+  for (j = 0; j < self->_degrader->numPolicies; j++) {
+    policy = self->_degrader->policies[j];
+    matched = false;
+
+    for (i = 0; i < self->numPlugins && !matched; i++) {
+      if (self->_degradePolicies[i] == NULL &&
+          _pluginChainNameMatches(self->plugins[i]->pluginName,
+                                  policy->pluginName)) {
+        policy->pluginIndex = i;
+        self->_degradePolicies[i] = policy;
+        matched = true;
+      }
+    }
+
+    if (!matched) {
+      logWarn("No plugin '%s' to degrade in the chain",
+              policy->pluginName->data);
+    }
+  }
+}
+
+ReturnCode pluginChainInitialize(PluginChain pluginChain) {
+  ReturnCode result = _pluginChainLoadPlugins(pluginChain, 0, true);
+  unsigned int i;
+
+  if (result != RETURN_CODE_SUCCESS) {
+    return result;
+  }
+
+  for (i = 0; i < pluginChain->numPlugins; i++) {
+    if (pluginChain->_channelInstances &&
+        !_pluginChainAddInstances(pluginChain, i)) {
+      return RETURN_CODE_PLUGIN_ERROR;
+    }
+  }
+
+  // Done last, since the instances change the channel counts of plugins
+  _pluginChainPlanInputRoutes(pluginChain);
+  _pluginChainPlanSidechain(pluginChain);
+  _pluginChainPlanMidiRoutes(pluginChain);
+  _pluginChainPlanDegradePolicies(pluginChain);
+
+  free(pluginChain->_recentBlockTimes);
+  pluginChain->_recentBlockTimes = (double *)calloc(
+      PLUGIN_CHAIN_RECENT_BLOCKS * (pluginChain->numPlugins + 1),
+      sizeof(double));
+  pluginChain->_numRecentBlocks = 0;
+  return RETURN_CODE_SUCCESS;
+}
+
+void pluginChainInspect(PluginChain pluginChain) {
+  Plugin plugin;
+  unsigned int i;
+
+  for (i = 0; i < pluginChain->numPlugins; i++) {
+    plugin = pluginChain->plugins[i];
+    plugin->displayInfo(plugin);
+  }
+}
+
+static void _pluginChainPrepareInstances(PluginChain self, unsigned int i,
+                                         boolByte reset) {
+  PluginChainInstanceGroup group = self->_instanceGroups[i];
+  Plugin instance;
+  unsigned int j;
+
+  if (group == NULL) {
+    return;
+  }
+
+  for (j = 1; j < group->numInstances; j++) {
+    instance = group->instances[j].plugin;
+
+    if (reset) {
+      instance->closePlugin(instance);
+    }
+
+    instance->prepareForProcessing(instance);
+  }
+}
+
+static boolByte _pluginChainIsReblocked(PluginChain self, unsigned int i) {
+  return (boolByte)(self->_pluginBlocksizes[i] > 0 &&
+                    self->_pluginBlocksizes[i] != getBlocksize());
+}
+
+// Blocks which are split for automation may have any size, so only the first
+// plugin's reblocker must be ready for that
+static SampleCount _pluginChainGetOuterBlocksize(PluginChain self,
+                                                 unsigned int i) {
+  return (i == 0 && self->_automation != NULL) ? 0 : getBlocksize();
+}
+
+// The reblocker's latency is derived from the blocksizes rather than read from
+// the reblocker, since the processing delay is needed before the chain is
+// prepared
+static unsigned long _pluginChainGetPluginDelay(PluginChain self,
+                                                unsigned int i) {
+  Plugin plugin = self->plugins[i];
+  unsigned long delay =
+      (unsigned long)plugin->getSetting(plugin, PLUGIN_INITIAL_DELAY);
+
+  if (_pluginChainIsReblocked(self, i)) {
+    delay += sampleReblockerGetLatency(self->_pluginBlocksizes[i],
+                                       _pluginChainGetOuterBlocksize(self, i));
+  }
+
+  return delay;
+}
+
+// The tail time and delay are queried once here, rather than for each block,
+// since asking a plugin for its settings may be expensive
+static void _pluginChainResetSilence(PluginChain self, unsigned int i) {
+  Plugin plugin = self->plugins[i];
+  self->_silentInputFrames[i] = 0;
+  self->_silenceHoldFrames[i] =
+      (unsigned long)(plugin->getSetting(plugin,
+                                         PLUGIN_SETTING_TAIL_TIME_IN_MS) *
+                      getSampleRate() / 1000.0) +
+      _pluginChainGetPluginDelay(self, i);
+}
+
+// A plugin with its own blocksize must see that blocksize when it is prepared,
+// so the global setting is changed while it and its instances are prepared
+static void _pluginChainPreparePlugin(PluginChain self, unsigned int i,
+                                      boolByte reset) {
+  Plugin plugin = self->plugins[i];
+  const SampleCount chainBlocksize = getBlocksize();
+  const boolByte reblocked = _pluginChainIsReblocked(self, i);
+
+  if (reblocked) {
+    logDebug("Preparing plugin '%s' with blocksize %lu",
+             plugin->pluginName->data, self->_pluginBlocksizes[i]);
+    setBlocksize(self->_pluginBlocksizes[i]);
+  }
+
+  plugin->prepareForProcessing(plugin);
+  _pluginChainPrepareInstances(self, i, reset);
+
+  if (reblocked) {
+    setBlocksize(chainBlocksize);
+  }
+
+  freeSampleReblocker(self->_reblockers[i]);
+  self->_reblockers[i] =
+      reblocked ? newSampleReblocker(plugin->inputBuffer->numChannels,
+                                     plugin->outputBuffer->numChannels,
+                                     self->_pluginBlocksizes[i],
+                                     _pluginChainGetOuterBlocksize(self, i))
+                : NULL;
+
+  if (self->_degradePolicies != NULL && self->_degradePolicies[i] != NULL) {
+    pluginDegradePolicyPrepare(self->_degradePolicies[i],
+                               plugin->outputBuffer->numChannels,
+                               _pluginChainGetPluginDelay(self, i));
+  }
+}
+
+// The first plugin may read from the chain's input and write to its output,
+// but only when their channel counts match its own buffers
+static void _pluginChainPrepareAutomation(PluginChain self) {
+  Plugin plugin = self->plugins[0];
+  ChannelCount numChannels = plugin->inputBuffer->numChannels;
+
+  if (plugin->outputBuffer->numChannels > numChannels) {
+    numChannels = plugin->outputBuffer->numChannels;
+  }
+
+  free(self->_automationInputs);
+  free(self->_automationOutputs);
+  self->_automationInputs = (Samples *)malloc(sizeof(Samples) * numChannels);
+  self->_automationOutputs = (Samples *)malloc(sizeof(Samples) * numChannels);
+  self->_automationNumChannels = numChannels;
+  self->_automationNextPoint = 0;
+  self->_automationFrame = 0;
+}
+
+void pluginChainPrepareForProcessing(PluginChain self) {
+  unsigned int i;
+
+  for (i = 0; i < self->numPlugins; i++) {
+    _pluginChainPreparePlugin(self, i, false);
+    _pluginChainResetSilence(self, i);
+  }
+
+  if (self->_automation != NULL && self->numPlugins > 0) {
+    _pluginChainPrepareAutomation(self);
+  }
+}
+
+// The blocksize of a plugin's buffers is adjusted for short blocks, so it does
+// not say how many frames were allocated. Reallocating them is cheap compared
+// to reloading the plugin, so this is done on every reset.
+static void _pluginResizeBuffers(Plugin plugin, SampleCount blocksize) {
+  ChannelCount numInputs = plugin->inputBuffer->numChannels;
+  ChannelCount numOutputs = plugin->outputBuffer->numChannels;
+
+  freeSampleBuffer(plugin->inputBuffer);
+  plugin->inputBuffer = newSampleBuffer(numInputs, blocksize);
+  freeSampleBuffer(plugin->outputBuffer);
+  plugin->outputBuffer = newSampleBuffer(numOutputs, blocksize);
+}
+
+static unsigned long _pluginChainGetDelayOfPlugins(PluginChain self,
+                                                   unsigned int firstPlugin,
+                                                   unsigned int numPlugins) {
+  unsigned long delay = 0;
+  unsigned int i;
+
+  for (i = firstPlugin; i < firstPlugin + numPlugins; i++) {
+    delay += _pluginChainGetPluginDelay(self, i);
+  }
+
+  return delay;
+}
+
+static unsigned long _pluginChainGetSplitDelay(PluginChain self,
+                                               PluginChainSplit split) {
+  unsigned long maxDelay = 0;
+  unsigned long delay;
+  unsigned int i;
+
+  for (i = 0; i < split->numBranches; i++) {
+    delay = _pluginChainGetDelayOfPlugins(self, split->branches[i].firstPlugin,
+                                          split->branches[i].numPlugins);
+
+    if (delay > maxDelay) {
+      maxDelay = delay;
+    }
+  }
+
+  return maxDelay;
+}
+
+static void _pluginChainStopSplits(PluginChain self) {
+  PluginChainSplit split;
+  PluginChainBranch branch;
+  unsigned int i, j;
+
+  if (!self->_splitsStarted) {
+    return;
+  }
+
+  self->_stopSplits = true;
+
+  for (i = 0; i < self->_numSplits; i++) {
+    split = &(self->_splits[i]);
+
+    for (j = 0; j < split->numBranches; j++) {
+      branch = &(split->branches[j]);
+
+      if (branch->thread != NULL) {
+        semaphorePost(branch->start);
+        threadJoinAndFree(branch->thread);
+        branch->thread = NULL;
+      }
+
+      freeSemaphore(branch->start);
+      branch->start = NULL;
+      freeSemaphore(branch->done);
+      branch->done = NULL;
+      freeSampleBuffer(branch->delayLine);
+      branch->delayLine = NULL;
+      free(branch->processingTimesInMs);
+      branch->processingTimesInMs = NULL;
+    }
+
+    freeSampleBuffer(split->mixBuffer);
+    split->mixBuffer = NULL;
+  }
+
+  self->_splitsStarted = false;
+  self->_stopSplits = false;
+}
+
+// Clear the delay lines of running splits, which is much cheaper than stopping
+// and restarting their threads. Splits are only stopped if the blocksize or
+// any delay has changed, in which case they are restarted with the next block.
+static void _pluginChainResetSplits(PluginChain self) {
+  PluginChainSplit split;
+  PluginChainBranch branch;
+  unsigned long splitDelay;
+  unsigned int i, j;
+
+  if (!self->_splitsStarted) {
+    return;
+  }
+
+  if (self->_splitsBlocksize != getBlocksize()) {
+    _pluginChainStopSplits(self);
+    return;
+  }
+
+  for (i = 0; i < self->_numSplits; i++) {
+    split = &(self->_splits[i]);
+    splitDelay = _pluginChainGetSplitDelay(self, split);
+
+    for (j = 0; j < split->numBranches; j++) {
+      branch = &(split->branches[j]);
+
+      if (branch->delay !=
+          splitDelay - _pluginChainGetDelayOfPlugins(self, branch->firstPlugin,
+                                                     branch->numPlugins)) {
+        _pluginChainStopSplits(self);
+        return;
+      }
+    }
+  }
+
+  for (i = 0; i < self->_numSplits; i++) {
+    split = &(self->_splits[i]);
+
+    for (j = 0; j < split->numBranches; j++) {
+      branch = &(split->branches[j]);
+      branch->delayPosition = 0;
+
+      if (branch->delayLine != NULL) {
+        sampleBufferClear(branch->delayLine);
+      }
+    }
+  }
+}
+
+void pluginChainReset(PluginChain self) {
+  Plugin plugin;
+  unsigned int i;
+
+  for (i = 0; i < self->numPlugins; i++) {
+    plugin = self->plugins[i];
+    logDebug("Resetting plugin '%s'", plugin->pluginName->data);
+    // Call the interface functions directly, closePlugin() would also free the
+    // plugin's sample buffers
+    plugin->closePlugin(plugin);
+
+    // When many short inputs are processed with the same blocksize, clearing
+    // the buffers is cheaper than allocating them again
+    if (plugin->inputBuffer->blocksize == getBlocksize() &&
+        plugin->outputBuffer->blocksize == getBlocksize()) {
+      sampleBufferClear(plugin->inputBuffer);
+      sampleBufferClear(plugin->outputBuffer);
+    } else {
+      _pluginResizeBuffers(plugin, getBlocksize());
+    }
+
+    _pluginChainPreparePlugin(self, i, true);
+    _pluginChainResetSilence(self, i);
+  }
+
+  // Refill the pipeline from scratch with the next input
+  self->_numPipelineBlocks = 0;
+  self->_automationNextPoint = 0;
+  self->_automationFrame = 0;
+  self->_automationMidiEvents = NULL;
+  realtimeSchedulerReset(self->_scheduler);
+  _pluginChainResetSplits(self);
+}
+
+uint64_t pluginChainEnterHostCallback(void) {
+  _pluginChainHostCallbackDepth++;
+  return _pluginChainHostCallbackDepth == 1 ? taskTimerGetTimestampInNs() : 0;
+}
+
+void pluginChainExitHostCallback(uint64_t enterTimeInNs) {
+  if (_pluginChainHostCallbackDepth == 0) {
+    return;
+  }
+
+  _pluginChainHostCallbackDepth--;
+
+  if (_pluginChainHostCallbackDepth == 0) {
+    _pluginChainHostCallbackTimeInNs +=
+        taskTimerGetTimestampInNs() - enterTimeInNs;
+  }
+}
+
+void pluginChainResetTimers(PluginChain self) {
+  unsigned int i;
+
+  for (i = 0; i < self->numPlugins; i++) {
+    taskTimerReset(self->audioTimers[i]);
+    taskTimerReset(self->midiTimers[i]);
+    latencyHistogramReset(self->audioLatencies[i]);
+    self->hostCallbackTimes[i] = 0.0;
+    perfCountersReset(self->perfCounters[i]);
+  }
+
+  latencyHistogramReset(self->chainLatency);
+}
+
+int pluginChainGetMaximumTailTimeInMs(PluginChain pluginChain) {
+  Plugin plugin;
+  int tailTime;
+  int maxTailTime = 0;
+  unsigned int i;
+
+  for (i = 0; i < pluginChain->numPlugins; i++) {
+    plugin = pluginChain->plugins[i];
+    tailTime = plugin->getSetting(plugin, PLUGIN_SETTING_TAIL_TIME_IN_MS);
+
+    if (tailTime > maxTailTime) {
+      maxTailTime = tailTime;
+    }
+  }
+
+  return maxTailTime;
+}
+
+unsigned long pluginChainGetProcessingDelay(PluginChain self) {
+  unsigned long processingDelay = 0;
+  unsigned int firstPlugin = 0;
+  unsigned int i;
+
+  // Each split delays its output by the latency of its slowest branch
+  for (i = 0; i < self->_numSplits; i++) {
+    processingDelay += _pluginChainGetDelayOfPlugins(
+        self, firstPlugin, self->_splits[i].firstPlugin - firstPlugin);
+    processingDelay += _pluginChainGetSplitDelay(self, &(self->_splits[i]));
+    firstPlugin = self->_splits[i].firstPlugin + self->_splits[i].numPlugins;
+  }
+
+  processingDelay += _pluginChainGetDelayOfPlugins(
+      self, firstPlugin, self->numPlugins - firstPlugin);
+
+  return processingDelay +
+         pluginChainGetPipelineDelayInBlocks(self) * getBlocksize();
+}
+
+unsigned int pluginChainGetPipelineDelayInBlocks(PluginChain self) {
+  return (self->_pipelined && self->numPlugins > 1 && self->_numSplits == 0)
+             ? self->numPlugins - 1
+             : 0;
+}
+
+static double *_pluginChainGetRecentBlockRow(const PluginChain self,
+                                             unsigned long block) {
+  return self->_recentBlockTimes +
+         (block % PLUGIN_CHAIN_RECENT_BLOCKS) * (self->numPlugins + 1);
+}
+
+unsigned int pluginChainGetNumRecentBlocks(const PluginChain self) {
+  if (self->_recentBlockTimes == NULL) {
+    return 0;
+  }
+
+  return self->_numRecentBlocks < PLUGIN_CHAIN_RECENT_BLOCKS
+             ? (unsigned int)self->_numRecentBlocks
+             : PLUGIN_CHAIN_RECENT_BLOCKS;
+}
+
+double pluginChainGetRecentBlockTime(const PluginChain self,
+                                     unsigned int blocksAgo,
+                                     unsigned int pluginIndex) {
+  if (blocksAgo >= pluginChainGetNumRecentBlocks(self) ||
+      pluginIndex > self->numPlugins) {
+    return 0.0;
+  }
+
+  // The counter is only advanced once the whole block has been processed
+  return _pluginChainGetRecentBlockRow(
+      self, self->_numRecentBlocks - 1 - blocksAgo)[pluginIndex];
+}
+
+typedef struct {
+  Plugin plugin;
+  boolByte success;
+} _PluginChainSetParameterPassData;
+
+void _pluginChainSetParameter(void *item, void *userData) {
+  // Expect that the linked list contains CharStrings, single that is what is
+  // being given from the command line.
+  char *parameterValue = (char *)item;
+  _PluginChainSetParameterPassData *passData =
+      (_PluginChainSetParameterPassData *)userData;
+  Plugin plugin = passData->plugin;
+  char *comma = NULL;
+  int index;
+  float value;
+
+  // If a previous attempt to set a parameter failed, then return right away
+  // since this method will return false anyways.
+  if (!passData->success) {
+    return;
+  }
+
+  // TODO: Need a "pair" type, this string parsing is done several times in the
+  // codebase
+  comma = strchr(parameterValue, ',');
+
+  if (comma == NULL) {
+    logError("Malformed parameter string, see --help parameter for usage");
+    return;
+  }
+
+  // The string is not modified, since the same parameter list may be applied
+  // to several plugin chains
+  index = (int)strtod(parameterValue, NULL);
+  value = (float)strtod(comma + 1, NULL);
+  passData->success = plugin->setParameter(plugin, (unsigned int)index, value);
+
+  if (passData->success) {
+    logInfo("Set parameter %d on plugin '%s' to %f", index,
+            plugin->pluginName->data, value);
+  }
+}
+
+boolByte pluginChainSetParameters(PluginChain self,
+                                  const LinkedList parameters) {
+  _PluginChainSetParameterPassData passData;
+  PluginChainInstanceGroup group = self->_instanceGroups[0];
+  unsigned int i;
+
+  passData.plugin = self->plugins[0];
+  passData.success = true;
+  logDebug("Setting parameters on head plugin in chain");
+
+  if (self->_noteRenderCache != NULL) {
+    noteRenderCacheClear(self->_noteRenderCache);
+  }
+
+  linkedListForeach(parameters, _pluginChainSetParameter, &passData);
+
+  // Any additional instances of the plugin get the same parameters
+  for (i = 1; group != NULL && i < group->numInstances; i++) {
+    passData.plugin = group->instances[i].plugin;
+    linkedListForeach(parameters, _pluginChainSetParameter, &passData);
+  }
+
+  return passData.success;
+}
+
+boolByte pluginChainSetParameter(PluginChain self, unsigned int pluginIndex,
+                                 unsigned int parameterIndex, float value) {
+  PluginChainInstanceGroup group;
+  boolByte result;
+  unsigned int i;
+
+  if (pluginIndex >= self->numPlugins) {
+    logError("Could not set parameter on plugin %u, chain has %u plugins",
+             pluginIndex, self->numPlugins);
+    return false;
+  }
+
+  if (self->_noteRenderCache != NULL) {
+    noteRenderCacheClear(self->_noteRenderCache);
+  }
+
+  result = self->plugins[pluginIndex]->setParameter(
+      self->plugins[pluginIndex], parameterIndex, value);
+  group = self->_instanceGroups[pluginIndex];
+
+  for (i = 1; result && group != NULL && i < group->numInstances; i++) {
+    result = group->instances[i].plugin->setParameter(
+        group->instances[i].plugin, parameterIndex, value);
+  }
+
+  return result;
+}
+
+void pluginChainSetRealtime(PluginChain self, boolByte realtime) {
+  self->_realtime = realtime;
+}
+
+void pluginChainSetFlushDenormals(PluginChain self, boolByte flushDenormals) {
+  self->_flushDenormals = flushDenormals;
+}
+
+void pluginChainSetPipelined(PluginChain self, boolByte pipelined) {
+  self->_pipelined = pipelined;
+}
+
+void pluginChainSetMeasurePerfCounters(PluginChain self, boolByte measure) {
+  unsigned int i;
+
+  self->_measurePerfCounters = measure;
+  for (i = 0; i < self->numPlugins; i++) {
+    self->perfCounters[i]->enabled = measure;
+  }
+}
+
+void pluginChainSetChannelInstances(PluginChain self,
+                                    boolByte channelInstances) {
+  self->_channelInstances = channelInstances;
+}
+
+boolByte pluginChainSetPluginBlocksize(PluginChain self, unsigned int index,
+                                       SampleCount blocksize) {
+  if (index >= self->numPlugins) {
+    logError("Could not set blocksize of plugin %u, chain has %u plugins",
+             index, self->numPlugins);
+    return false;
+  } else if (self->_stages != NULL || self->_splitsStarted) {
+    logError("Could not set blocksize of plugin '%s', chain is already "
+             "processing",
+             self->plugins[index]->pluginName->data);
+    return false;
+  }
+
+  logDebug("Plugin '%s' processes blocks of %lu frames",
+           self->plugins[index]->pluginName->data, blocksize);
+  self->_pluginBlocksizes[index] = blocksize;
+  return true;
+}
+
+void pluginChainSetParallelLoading(PluginChain self,
+                                   boolByte parallelLoading) {
+  self->_parallelLoading = parallelLoading;
+}
+
+void pluginChainSetSerialLoadPlugins(PluginChain self,
+                                     const LinkedList pluginNames) {
+  LinkedListIterator iterator;
+
+  freeLinkedListAndItems(self->_serialLoadPlugins,
+                         (LinkedListFreeItemFunc)freeCharString);
+  self->_serialLoadPlugins = newLinkedList();
+
+  for (iterator = pluginNames; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    if (iterator->item != NULL) {
+      linkedListAppend(self->_serialLoadPlugins,
+                       newCharStringWithCString((char *)iterator->item));
+    }
+  }
+}
+
+static void _freePluginChainMidiRoute(PluginChainMidiRoute self) {
+  if (self != NULL) {
+    freeCharString(self->pluginName);
+    free(self);
+  }
+}
+
+static unsigned long _pluginChainParseMidiChannel(const char *text,
+                                                  char **end) {
+  unsigned long channel = strtoul(text, end, 10);
+  return (*end == text || channel < 1 || channel > 16) ? 0 : channel;
+}
+
+static PluginChainMidiRoute _newPluginChainMidiRoute(const char *routeString) {
+  PluginChainMidiRoute route;
+  const char *comma = strrchr(routeString, ',');
+  unsigned long first = 1;
+  unsigned long last = 16;
+  char *end;
+
+  if (comma != NULL) {
+    first = _pluginChainParseMidiChannel(comma + 1, &end);
+    last = first;
+
+    if (first > 0 && *end == '-') {
+      last = _pluginChainParseMidiChannel(end + 1, &end);
+    }
+
+    if (first == 0 || last < first || *end != '\0') {
+      logError("Invalid MIDI channels in route '%s'", routeString);
+      return NULL;
+    }
+  }
+
+  if ((comma != NULL ? (size_t)(comma - routeString) : strlen(routeString)) ==
+      0) {
+    logError("MIDI route '%s' has no plugin name", routeString);
+    return NULL;
+  }
+
+  route = (PluginChainMidiRoute)malloc(sizeof(PluginChainMidiRouteMembers));
+  route->pluginName = newCharStringWithCString(routeString);
+
+  if (comma != NULL) {
+    route->pluginName->data[comma - routeString] = '\0';
+  }
+
+  route->channels = (unsigned short)(((1ul << last) - 1) &
+                                     ~((1ul << (first - 1)) - 1));
+  return route;
+}
+
+boolByte pluginChainSetMidiRoutes(PluginChain self, const LinkedList routes) {
+  LinkedList midiRoutes = newLinkedList();
+  LinkedListIterator iterator;
+  PluginChainMidiRoute route;
+
+  for (iterator = routes; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    if (iterator->item == NULL) {
+      continue;
+    }
+
+    route = _newPluginChainMidiRoute((char *)iterator->item);
+
+    if (route == NULL) {
+      freeLinkedListAndItems(midiRoutes,
+                             (LinkedListFreeItemFunc)_freePluginChainMidiRoute);
+      return false;
+    }
+
+    linkedListAppend(midiRoutes, route);
+  }
+
+  freeLinkedListAndItems(self->_midiRoutes,
+                         (LinkedListFreeItemFunc)_freePluginChainMidiRoute);
+  self->_midiRoutes = midiRoutes;
+  return true;
+}
+
+void pluginChainSetSidechain(PluginChain self, const CharString pluginName,
+                             ChannelCount numChannels) {
+  freeCharString(self->_sidechainPluginName);
+  self->_sidechainPluginName = newCharStringWithCString(pluginName->data);
+  freeSampleBuffer(self->_sidechain);
+  self->_sidechain = newSampleBuffer(numChannels, getBlocksize());
+}
+
+SampleBuffer pluginChainGetSidechain(const PluginChain self) {
+  return self->_sidechain;
+}
+
+SampleBuffer pluginChainGetLastOutputs(const PluginChain self) {
+  return self->_lastOutputs;
+}
+
+void pluginChainSetIsolatedHost(PluginChain self,
+                                const CharString hostExecutable) {
+  freeCharString(self->_isolatedHost);
+  self->_isolatedHost = hostExecutable != NULL
+                            ? newCharStringWithCString(hostExecutable->data)
+                            : NULL;
+}
+
+boolByte pluginChainHasCrashedPlugins(PluginChain self) {
+  PluginChainInstanceGroup group;
+  unsigned int i, j;
+
+  for (i = 0; i < self->numPlugins; i++) {
+    if (pluginIsolatedHasCrashed(self->plugins[i])) {
+      return true;
+    }
+
+    group = self->_instanceGroups[i];
+    if (group != NULL) {
+      for (j = 1; j < group->numInstances; j++) {
+        if (pluginIsolatedHasCrashed(group->instances[j].plugin)) {
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+void pluginChainSetAutomation(PluginChain self, PluginAutomation automation) {
+  self->_automation = automation;
+  self->_automationNextPoint = 0;
+  self->_automationFrame = 0;
+}
+
+void pluginChainSetControl(PluginChain self, PluginControl control) {
+  self->_control = control;
+}
+
+PluginControl pluginChainGetControl(const PluginChain self) {
+  return self->_control;
+}
+
+// The preset was already opened by the control thread, so only the plugin's
+// own work of loading it is done here
+static boolByte _pluginChainLoadOpenedPreset(PluginChain self,
+                                             unsigned int pluginIndex,
+                                             PluginPreset preset) {
+  PluginChainInstanceGroup group;
+  boolByte result;
+  unsigned int i;
+
+  if (pluginIndex >= self->numPlugins) {
+    logError("Could not load preset in plugin %u, chain has %u plugins",
+             pluginIndex, self->numPlugins);
+    return false;
+  }
+
+  if (!pluginPresetIsCompatibleWith(preset, self->plugins[pluginIndex])) {
+    logError("Preset '%s' is not a compatible format for plugin '%s'",
+             preset->presetName->data,
+             self->plugins[pluginIndex]->pluginName->data);
+    return false;
+  }
+
+  if (self->_noteRenderCache != NULL) {
+    noteRenderCacheClear(self->_noteRenderCache);
+  }
+
+  result = preset->loadPreset(preset, self->plugins[pluginIndex]);
+  group = self->_instanceGroups[pluginIndex];
+
+  for (i = 1; result && group != NULL && i < group->numInstances; i++) {
+    result = preset->loadPreset(preset, group->instances[i].plugin);
+  }
+
+  return result;
+}
+
+boolByte pluginChainSetDegradePolicies(PluginChain self,
+                                       const LinkedList policies) {
+  PluginDegrader degrader = newPluginDegrader();
+  LinkedListIterator iterator;
+  PluginDegradePolicy policy;
+
+  for (iterator = policies; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    if (iterator->item == NULL) {
+      continue;
+    }
+
+    policy = newPluginDegradePolicy((char *)iterator->item);
+
+    if (policy == NULL) {
+      freePluginDegrader(degrader);
+      return false;
+    }
+
+    pluginDegraderAdd(degrader, policy);
+  }
+
+  freePluginDegrader(self->_degrader);
+  self->_degrader = degrader->numPolicies > 0 ? degrader : NULL;
+
+  if (self->_degrader == NULL) {
+    freePluginDegrader(degrader);
+  }
+
+  return true;
+}
+
+// Runs between blocks, when no other thread is processing the plugins
+static void _pluginChainApplyDegrader(PluginChain self) {
+  PluginDegradePolicy policy =
+      pluginDegraderUpdate(self->_degrader, self->_lastBlockTimeInMs,
+                           self->_lastBlockBudgetInMs);
+  Plugin plugin;
+
+  if (policy == NULL) {
+    return;
+  }
+
+  plugin = self->plugins[policy->pluginIndex];
+
+  if (policy->degraded) {
+    logWarn("Chain spent %.1fms on a %.1fms block, degrading plugin '%s'",
+            self->_lastBlockTimeInMs, self->_lastBlockBudgetInMs,
+            plugin->pluginName->data);
+
+    if (policy->type == PLUGIN_DEGRADE_PARAMETER) {
+      pluginChainSetParameter(self, policy->pluginIndex,
+                              policy->parameterIndex, policy->degradedValue);
+    } else if (policy->_delayLine != NULL) {
+      sampleBufferClear(policy->_delayLine);
+      policy->_delayPosition = 0;
+    }
+  } else {
+    logInfo("Chain has enough headroom again, restoring plugin '%s'",
+            plugin->pluginName->data);
+
+    if (policy->type == PLUGIN_DEGRADE_PARAMETER) {
+      pluginChainSetParameter(self, policy->pluginIndex,
+                              policy->parameterIndex, policy->normalValue);
+    }
+  }
+}
+
+static void _pluginChainApplyControl(PluginChain self) {
+  PluginControlCommand command;
+  boolByte succeeded;
+
+  while (pluginControlNextCommand(self->_control, &command)) {
+    switch (command.type) {
+    case PLUGIN_CONTROL_SET_PARAMETER:
+      succeeded =
+          pluginChainSetParameter(self, command.pluginIndex,
+                                  command.parameterIndex, command.value);
+      break;
+
+    case PLUGIN_CONTROL_LOAD_PRESET:
+      succeeded = _pluginChainLoadOpenedPreset(self, command.pluginIndex,
+                                               command.preset);
+      break;
+
+    default:
+      succeeded = false;
+      break;
+    }
+
+    pluginControlFinishCommand(self->_control, &command, succeeded);
+  }
+}
+
+void pluginChainSetNoteRenderCache(PluginChain self, size_t maxSize) {
+  freeNoteRenderCache(self->_noteRenderCache);
+  self->_noteRenderCache = maxSize > 0 ? newNoteRenderCache(maxSize) : NULL;
+}
+
+typedef struct {
+  PluginChain pluginChain;
+  Sample threshold;
+} _PluginChainNoteRenderDataMembers;
+typedef _PluginChainNoteRenderDataMembers *_PluginChainNoteRenderData;
+
+// Find the end of the last sample in the first numFrames of a block which is
+// louder than the threshold, or 0 if there is none
+static SampleCount _pluginChainFindSoundEnd(const SampleBuffer buffer,
+                                            SampleCount numFrames,
+                                            Sample threshold) {
+  SampleCount result = 0;
+  ChannelCount channel;
+  SampleCount i;
+
+  for (channel = 0; channel < buffer->numChannels; channel++) {
+    for (i = numFrames; i > result; i--) {
+      if (buffer->samples[channel][i - 1] > threshold ||
+          buffer->samples[channel][i - 1] < -threshold) {
+        result = i;
+        break;
+      }
+    }
+  }
+
+  return result;
+}
+
+static void _pluginChainInitNoteEvent(MidiEventMembers *midiEvent, byte status,
+                                      byte note, byte velocity) {
+  midiEvent->eventType = MIDI_TYPE_REGULAR;
+  midiEvent->deltaFrames = 0;
+  midiEvent->timestamp = 0;
+  midiEvent->status = status;
+  midiEvent->data1 = note;
+  midiEvent->data2 = velocity;
+  midiEvent->extraData = NULL;
+  midiEvent->extraDataSize = 0;
+  midiEvent->_allocatedFromArena = false;
+}
+
+// Play a single note through the freshly reset chain, until the note has been
+// released and the output has been silent for a while
+static SampleBuffer _pluginChainRenderNote(void *userData,
+                                           const NoteRenderKey *key) {
+  _PluginChainNoteRenderData renderData =
+      (_PluginChainNoteRenderData)userData;
+  PluginChain self = renderData->pluginChain;
+  AudioClock audioClock = getAudioClock();
+  const SampleCount blocksize = getBlocksize();
+  const ChannelCount numChannels = getNumChannels();
+  const int tailTimeInMs = pluginChainGetMaximumTailTimeInMs(self);
+  const unsigned long tailFrames = (unsigned long)(
+      (tailTimeInMs > 0 ? tailTimeInMs : kPluginChainNoteRenderMaxTailInMs) *
+      getSampleRate() / 1000.0);
+  const unsigned long silenceFrames = (unsigned long)(
+      kPluginChainNoteRenderSilenceInMs * getSampleRate() / 1000.0);
+  const unsigned long releaseEnd =
+      key->lengthInFrames + pluginChainGetProcessingDelay(self);
+  const unsigned long maxFrames = releaseEnd + tailFrames + silenceFrames;
+  SampleBuffer silence = newSampleBuffer(numChannels, blocksize);
+  SampleBuffer block = newSampleBuffer(numChannels, blocksize);
+  SampleBuffer render = newSampleBuffer(numChannels, maxFrames);
+  SampleBuffer result = NULL;
+  LinkedList midiEvents = newLinkedList();
+  MidiEventMembers noteOn;
+  MidiEventMembers noteOff;
+  unsigned long soundEnd = 0;
+  unsigned long frame;
+  SampleCount numFrames;
+  SampleCount blockSoundEnd;
+  ChannelCount channel;
+  boolByte finished = false;
+
+  _pluginChainInitNoteEvent(&noteOn, key->onStatus, key->note,
+                            key->onVelocity);
+  _pluginChainInitNoteEvent(&noteOff, key->offStatus, key->note,
+                            key->offVelocity);
+  pluginChainReset(self);
+  audioClockReset(audioClock);
+
+  for (frame = 0; !finished && frame < maxFrames; frame += blocksize) {
+    linkedListClear(midiEvents);
+
+    if (frame == 0) {
+      linkedListAppend(midiEvents, &noteOn);
+    }
+
+    if (key->lengthInFrames >= frame &&
+        key->lengthInFrames < frame + blocksize) {
+      noteOff.deltaFrames = key->lengthInFrames - frame;
+      linkedListAppend(midiEvents, &noteOff);
+    }
+
+    if (linkedListLength(midiEvents) > 0) {
+      pluginChainProcessMidi(self, midiEvents);
+    }
+
+    pluginChainProcessAudio(self, silence, block);
+    advanceAudioClock(audioClock, blocksize);
+
+    numFrames = maxFrames - frame < blocksize ? maxFrames - frame : blocksize;
+
+    for (channel = 0; channel < numChannels; channel++) {
+      memcpy(render->samples[channel] + frame, block->samples[channel],
+             sizeof(Sample) * numFrames);
+    }
+
+    blockSoundEnd =
+        _pluginChainFindSoundEnd(block, numFrames, renderData->threshold);
+
+    if (blockSoundEnd > 0) {
+      soundEnd = frame + blockSoundEnd;
+    }
+
+    finished = (boolByte)(frame + blocksize >= releaseEnd + silenceFrames &&
+                          frame + blocksize >= soundEnd + silenceFrames);
+  }
+
+  if (finished) {
+    result = newSampleBuffer(numChannels, soundEnd > 0 ? soundEnd : 1);
+
+    for (channel = 0; channel < numChannels; channel++) {
+      memcpy(result->samples[channel], render->samples[channel],
+             sizeof(Sample) * result->blocksize);
+    }
+  } else {
+    logWarn("Note %d still sounds after %lu frames, not using note renders",
+            key->note, maxFrames);
+  }
+
+  freeSampleBuffer(silence);
+  freeSampleBuffer(block);
+  freeSampleBuffer(render);
+  freeLinkedList(midiEvents);
+  return result;
+}
+
+// Play the sequence through the chain while its first note sounds, and check
+// that the output matches the mix of the note renders
+static boolByte _pluginChainVerifyNoteRenders(PluginChain self,
+                                              MidiSequence midiSequence,
+                                              Sample threshold) {
+  AudioClock audioClock = getAudioClock();
+  const SampleCount blocksize = getBlocksize();
+  const ChannelCount numChannels = getNumChannels();
+  const int numEventsProcessed = midiSequence->numMidiEventsProcessed;
+  SampleBuffer silence;
+  SampleBuffer block;
+  SampleBuffer mix;
+  LinkedList midiEvents;
+  MidiEvent blockEvents;
+  unsigned long numBlockEvents;
+  unsigned long startFrame;
+  unsigned long endFrame;
+  unsigned long frame;
+  unsigned long i;
+  ChannelCount channel;
+  SampleCount j;
+  Sample difference;
+  boolByte result = true;
+
+  if (!noteRenderCacheGetFirstNote(self->_noteRenderCache, &startFrame,
+                                   &endFrame)) {
+    return true;
+  }
+
+  silence = newSampleBuffer(numChannels, blocksize);
+  block = newSampleBuffer(numChannels, blocksize);
+  mix = newSampleBuffer(numChannels, blocksize);
+  midiEvents = newLinkedList();
+
+  // Nothing sounds before the first note, so the blocks before it are skipped
+  frame = startFrame - startFrame % blocksize;
+  pluginChainReset(self);
+  audioClockReset(audioClock);
+  advanceAudioClock(audioClock, frame);
+  midiSequenceSeek(midiSequence, frame);
+
+  for (; result && frame < endFrame; frame += blocksize) {
+    midiSequenceGetRange(midiSequence, frame, blocksize, &blockEvents,
+                         &numBlockEvents);
+    linkedListClear(midiEvents);
+
+    for (i = 0; i < numBlockEvents; i++) {
+      if (blockEvents[i].eventType == MIDI_TYPE_REGULAR) {
+        linkedListAppend(midiEvents, &blockEvents[i]);
+      }
+    }
+
+    if (linkedListLength(midiEvents) > 0) {
+      pluginChainProcessMidi(self, midiEvents);
+    }
+
+    pluginChainProcessAudio(self, silence, block);
+    advanceAudioClock(audioClock, blocksize);
+    noteRenderCacheMix(self->_noteRenderCache, mix, frame);
+
+    for (channel = 0; result && channel < numChannels; channel++) {
+      for (j = 0; j < blocksize; j++) {
+        difference = block->samples[channel][j] - mix->samples[channel][j];
+
+        if (difference > threshold || difference < -threshold) {
+          logWarn("Note renders differ from the instrument by %g at frame "
+                  "%lu, not using note renders",
+                  difference, frame + j);
+          result = false;
+          break;
+        }
+      }
+    }
+  }
+
+  midiSequenceSeek(midiSequence, 0);
+  midiSequence->numMidiEventsProcessed = numEventsProcessed;
+  freeSampleBuffer(silence);
+  freeSampleBuffer(block);
+  freeSampleBuffer(mix);
+  freeLinkedList(midiEvents);
+  return result;
+}
+
+boolByte pluginChainPrepareNoteRenders(PluginChain self,
+                                       MidiSequence midiSequence,
+                                       Sample threshold) {
+  NoteRenderCache noteRenderCache = self->_noteRenderCache;
+  _PluginChainNoteRenderDataMembers renderData;
+  boolByte result;
+
+  if (noteRenderCache == NULL || noteRenderCache->disabled ||
+      self->_automation != NULL || self->_realtime) {
+    return false;
+  }
+
+  // Notes from a plugin which renders differently each time would never pass
+  // verification, so the renders are not even attempted
+  if (pluginChainGetCapability(self, PLUGIN_CAPABILITY_DETERMINISTIC) ==
+      PLUGIN_CAPABILITY_UNSUPPORTED) {
+    logInfo("Not using note renders, since the plugin chain does not render "
+            "deterministically");
+    noteRenderCache->disabled = true;
+    return false;
+  }
+
+  // All notes must be known before the sequence is played
+  midiSequenceReadAll(midiSequence);
+
+  if (!noteRenderCacheCanRender(noteRenderCache, midiSequence)) {
+    return false;
+  }
+
+  renderData.pluginChain = self;
+  renderData.threshold = threshold;
+  result = noteRenderCachePlaceSequence(noteRenderCache, midiSequence,
+                                        _pluginChainRenderNote, &renderData);
+
+  if (result && !noteRenderCache->verified) {
+    if (_pluginChainVerifyNoteRenders(self, midiSequence, threshold)) {
+      logInfo("Note renders match the instrument");
+      noteRenderCache->verified = true;
+    } else {
+      noteRenderCache->disabled = true;
+      result = false;
+    }
+  }
+
+  if (result) {
+    logInfo("Playing MIDI with note renders, %lu of %lu notes so far were "
+            "cached",
+            noteRenderCache->numHits,
+            noteRenderCache->numHits + noteRenderCache->numMisses);
+  }
+
+  pluginChainReset(self);
+  audioClockReset(getAudioClock());
+  return result;
+}
+
+PluginCapabilityState pluginChainGetCapability(const PluginChain self,
+                                               PluginCapability capability) {
+  PluginCapabilityState result = PLUGIN_CAPABILITY_SUPPORTED;
+  unsigned int i;
+
+  if (self->numPlugins == 0) {
+    return PLUGIN_CAPABILITY_UNKNOWN;
+  }
+
+  for (i = 0; i < self->numPlugins; i++) {
+    switch (pluginGetCapability(self->plugins[i], capability)) {
+    case PLUGIN_CAPABILITY_UNSUPPORTED:
+      return PLUGIN_CAPABILITY_UNSUPPORTED;
+    case PLUGIN_CAPABILITY_SUPPORTED:
+      break;
+    default:
+      result = PLUGIN_CAPABILITY_UNKNOWN;
+      break;
+    }
+  }
+
+  return result;
+}
+
+void pluginChainMixNoteRenders(PluginChain self, SampleBuffer outBuffer,
+                               unsigned long frame) {
+  noteRenderCacheMix(self->_noteRenderCache, outBuffer, frame);
+}
+
+void pluginChainSetSkipSilence(PluginChain self, boolByte skipSilence) {
+  self->_skipSilence = skipSilence;
+}
+
+boolByte pluginChainGetLinearGain(PluginChain self, Sample *outGain) {
+  Plugin plugin;
+  Sample gain = 1.0f;
+  Sample pluginGain;
+  boolByte silenced = false;
+  unsigned int numGains = 0;
+  unsigned int i;
+
+  // Realtime chains must keep running at the speed of the audio, and
+  // pipelining adds latency even to internal plugins
+  if (self->numPlugins == 0 || self->_numSplits > 0 || self->_realtime ||
+      self->_pipelined) {
+    return false;
+  }
+
+  for (i = 0; i < self->numPlugins; i++) {
+    plugin = self->plugins[i];
+
+    // The internal plugins have two channels, and like the chain they only
+    // pass through the first two channels of a larger input
+    if (plugin->interfaceType != PLUGIN_TYPE_INTERNAL ||
+        self->_instanceGroups[i] != NULL ||
+        getNumChannels() >
+            (ChannelCount)plugin->getSetting(plugin, PLUGIN_NUM_INPUTS)) {
+      return false;
+    }
+
+    if (charStringIsEqualToCString(plugin->pluginName, kInternalPluginGainName,
+                                   false)) {
+      pluginGain = ((PluginGainSettings)plugin->extraData)->gain;
+
+      if (pluginGain != 1.0f) {
+        gain = pluginGain;
+        numGains++;
+      }
+    } else if (charStringIsEqualToCString(plugin->pluginName,
+                                          kInternalPluginSilenceName, false)) {
+      silenced = true;
+    } else if (!charStringIsEqualToCString(plugin->pluginName,
+                                           kInternalPluginPassthruName,
+                                           false)) {
+      return false;
+    }
+  }
+
+  // Each gain plugin rounds its result, so several of them can't be replaced
+  // by their product without changing the output
+  if (silenced) {
+    gain = 0.0f;
+  } else if (numGains > 1) {
+    return false;
+  }
+
+  *outGain = gain;
+  return true;
+}
+
+// Each plugin is only processed by one thread at a time, so its silence
+// counter needs no locking
+static boolByte _pluginChainCanSkipPlugin(PluginChain self, unsigned int i,
+                                          const SampleBuffer inputs) {
+  Plugin plugin = self->plugins[i];
+
+  if (!self->_skipSilence || plugin->pluginType == PLUGIN_TYPE_INSTRUMENT ||
+      (self->_midiChannels[i] != 0 && self->_midiReceived)) {
+    return false;
+  } else if (!sampleBufferIsSilent(inputs)) {
+    self->_silentInputFrames[i] = 0;
+    return false;
+  }
+
+  self->_silentInputFrames[i] += inputs->blocksize;
+  // The first silent block is always processed, since the plugin may still be
+  // producing output from the previous block
+  return (boolByte)(self->_silentInputFrames[i] >
+                    self->_silenceHoldFrames[i] + inputs->blocksize);
+}
+
+static void _pluginChainCopyToPluginInput(Plugin plugin,
+                                          SampleBuffer buffer) {
+  plugin->inputBuffer->blocksize = buffer->blocksize;
+  sampleBufferCopyAndMapChannels(plugin->inputBuffer, buffer);
+}
+
+// The plugin which receives the sidechain gets the channels of the source in
+// its first inputs, which are mapped as for any other plugin, and the channels
+// of the sidechain in the rest
+static SampleBuffer _pluginChainRouteWithSidechain(PluginChain self,
+                                                   unsigned int i,
+                                                   SampleBuffer source) {
+  Plugin plugin = self->plugins[i];
+  SampleBuffer route = &(self->_inputRoutes[i]);
+  const ChannelCount numMainInputs =
+      (ChannelCount)(route->numChannels - self->_sidechain->numChannels);
+  ChannelCount channel;
+
+  if (source->numChannels == 0) {
+    plugin->inputBuffer->blocksize = source->blocksize;
+    sampleBufferClear(plugin->inputBuffer);
+    source = plugin->inputBuffer;
+  }
+
+  for (channel = 0; channel < numMainInputs; channel++) {
+    route->samples[channel] = source->samples[channel % source->numChannels];
+  }
+
+  for (channel = numMainInputs; channel < route->numChannels; channel++) {
+    route->samples[channel] =
+        self->_sidechain->samples[channel - numMainInputs];
+  }
+
+  route->blocksize = source->blocksize;
+  // The channels come from two buffers, which have no common stride
+  route->_stride = 0;
+  return route;
+}
+
+// Returns a buffer with the channels of the source mapped to the inputs of a
+// plugin in the same way as sampleBufferCopyAndMapChannels(), but by pointing
+// at the source's channels rather than copying them. Only a source without
+// any channels, or a plugin whose route was not planned, needs a copy.
+static SampleBuffer _pluginChainRouteToPluginInput(PluginChain self,
+                                                   unsigned int i,
+                                                   SampleBuffer source) {
+  Plugin plugin = self->plugins[i];
+  SampleBuffer route = &(self->_inputRoutes[i]);
+  ChannelCount channel;
+
+  if (plugin == self->_sidechainPlugin) {
+    return _pluginChainRouteWithSidechain(self, i, source);
+  } else if (source->numChannels == plugin->inputBuffer->numChannels) {
+    return source;
+  } else if (source->numChannels == 0 || route->samples == NULL ||
+             route->numChannels != plugin->inputBuffer->numChannels) {
+    _pluginChainCopyToPluginInput(plugin, source);
+    return plugin->inputBuffer;
+  }
+
+  for (channel = 0; channel < route->numChannels; channel++) {
+    route->samples[channel] =
+        source->samples[channel % source->numChannels];
+  }
+
+  route->blocksize = source->blocksize;
+  route->_stride = source->_stride;
+  return route;
+}
+
+static void _pluginChainSetChannelView(SampleBuffer view,
+                                       const SampleBuffer buffer,
+                                       ChannelCount firstChannel,
+                                       ChannelCount numChannels) {
+  view->numChannels = numChannels;
+  view->blocksize = buffer->blocksize;
+  view->samples = buffer->samples + firstChannel;
+  view->_storage = NULL;
+  view->_stride = buffer->_stride;
+}
+
+static void _pluginChainProcessInstances(PluginChainInstanceGroup group,
+                                         SampleBuffer inputs,
+                                         SampleBuffer outputs) {
+  const ChannelCount numChannels = group->channelsPerInstance;
+  PluginChainInstance instance;
+  unsigned int i;
+
+  for (i = 0; i < group->numInstances; i++) {
+    instance = &(group->instances[i]);
+    _pluginChainSetChannelView(&(instance->input), inputs,
+                               (ChannelCount)(i * numChannels), numChannels);
+    _pluginChainSetChannelView(&(instance->output), outputs,
+                               (ChannelCount)(i * numChannels), numChannels);
+
+    if (instance->thread != NULL) {
+      semaphorePost(instance->start);
+    }
+  }
+
+  for (i = 0; i < group->numInstances; i++) {
+    instance = &(group->instances[i]);
+
+    if (instance->thread == NULL) {
+      instance->plugin->processAudio(instance->plugin, &(instance->input),
+                                     &(instance->output));
+    }
+  }
+
+  for (i = 0; i < group->numInstances; i++) {
+    if (group->instances[i].thread != NULL) {
+      semaphoreWait(group->instances[i].done);
+    }
+  }
+}
+
+static void _pluginChainProcessPlugin(PluginChain self, unsigned int i,
+                                      SampleBuffer inputs,
+                                      SampleBuffer outputs) {
+  Plugin plugin = self->plugins[i];
+
+  if (self->_instanceGroups[i] != NULL) {
+    _pluginChainProcessInstances(self->_instanceGroups[i], inputs, outputs);
+  } else {
+    plugin->processAudio(plugin, inputs, outputs);
+  }
+}
+
+typedef struct {
+  PluginChain pluginChain;
+  unsigned int index;
+} _PluginChainReblockedPluginMembers;
+
+static void _pluginChainProcessReblockedPlugin(void *pluginPtr,
+                                               SampleBuffer inputs,
+                                               SampleBuffer outputs) {
+  _PluginChainReblockedPluginMembers *reblockedPlugin =
+      (_PluginChainReblockedPluginMembers *)pluginPtr;
+  _pluginChainProcessPlugin(reblockedPlugin->pluginChain,
+                            reblockedPlugin->index, inputs, outputs);
+}
+
+static double _pluginChainRunPluginWithBuffers(PluginChain self,
+                                               unsigned int i,
+                                               SampleBuffer inputs,
+                                               SampleBuffer outputs) {
+  Plugin plugin = self->plugins[i];
+  uint64_t hostCallbackTimeInNs;
+  outputs->blocksize = inputs->blocksize;
+
+  if (self->_degradePolicies != NULL && self->_degradePolicies[i] != NULL &&
+      self->_degradePolicies[i]->degraded &&
+      self->_degradePolicies[i]->type != PLUGIN_DEGRADE_PARAMETER) {
+    pluginDegradePolicyProcess(self->_degradePolicies[i], inputs, outputs);
+    return 0.0;
+  }
+
+  if (_pluginChainCanSkipPlugin(self, i, inputs)) {
+    sampleBufferClear(outputs);
+    return 0.0;
+  }
+
+  hostCallbackTimeInNs = _pluginChainHostCallbackTimeInNs;
+  taskTimerStart(self->audioTimers[i]);
+  realtimeAuditEnterPlugin(plugin->pluginName->data);
+  samplingProfilerEnterPlugin(plugin->pluginName->data,
+                              SAMPLING_PROFILER_FRAME_PROCESS_AUDIO);
+  perfCountersStart(self->perfCounters[i]);
+
+  if (self->_reblockers[i] != NULL) {
+    _PluginChainReblockedPluginMembers reblockedPlugin;
+    reblockedPlugin.pluginChain = self;
+    reblockedPlugin.index = i;
+    sampleReblockerProcess(self->_reblockers[i], inputs, outputs,
+                           _pluginChainProcessReblockedPlugin,
+                           &reblockedPlugin);
+  } else {
+    _pluginChainProcessPlugin(self, i, inputs, outputs);
+  }
+
+  perfCountersStop(self->perfCounters[i]);
+  samplingProfilerExitPlugin();
+  realtimeAuditExitPlugin();
+  self->hostCallbackTimes[i] +=
+      (double)(_pluginChainHostCallbackTimeInNs - hostCallbackTimeInNs) /
+      1000000.0;
+  return taskTimerStop(self->audioTimers[i]);
+}
+
+static void _pluginChainSetAutomatedParameter(
+    PluginChain self, const PluginAutomationPoint *point) {
+  PluginChainInstanceGroup group = self->_instanceGroups[0];
+  Plugin plugin = self->plugins[0];
+  unsigned int i;
+
+  plugin->setParameter(plugin, point->index, point->value);
+
+  for (i = 1; group != NULL && i < group->numInstances; i++) {
+    plugin = group->instances[i].plugin;
+    plugin->setParameter(plugin, point->index, point->value);
+  }
+}
+
+// Applies all automation points which fall before untilFrame of the current
+// block. Returns the frame of the next point within the block, or blocksize if
+// there are no more points in this block.
+static SampleCount _pluginChainApplyAutomation(PluginChain self,
+                                               SampleCount untilFrame,
+                                               SampleCount blocksize) {
+  const PluginAutomation automation = self->_automation;
+  const SampleRate sampleRate = getSampleRate();
+  const PluginAutomationPoint *point;
+  unsigned long pointFrame;
+
+  while (self->_automationNextPoint < automation->numPoints) {
+    point = &(automation->points[self->_automationNextPoint]);
+    pointFrame = pluginAutomationPointGetFrame(point, sampleRate);
+
+    if (pointFrame >= self->_automationFrame + untilFrame) {
+      return pointFrame < self->_automationFrame + blocksize
+                 ? (SampleCount)(pointFrame - self->_automationFrame)
+                 : blocksize;
+    }
+
+    _pluginChainSetAutomatedParameter(self, point);
+    self->_automationNextPoint++;
+  }
+
+  return blocksize;
+}
+
+static void _pluginChainSetFrameView(SampleBuffer view, Samples *viewSamples,
+                                     const SampleBuffer buffer,
+                                     SampleCount firstFrame,
+                                     SampleCount numFrames) {
+  ChannelCount i;
+
+  for (i = 0; i < buffer->numChannels; i++) {
+    viewSamples[i] = buffer->samples[i] + firstFrame;
+  }
+
+  view->numChannels = buffer->numChannels;
+  view->blocksize = numFrames;
+  view->samples = viewSamples;
+  view->_storage = NULL;
+  view->_stride = buffer->_stride;
+}
+
+// Regular events are filtered by their channel, and the other types go to
+// every plugin which receives MIDI at all
+static LinkedList _pluginChainFilterMidi(PluginChain self, unsigned int i,
+                                         LinkedList midiEvents) {
+  const unsigned short channels = self->_midiChannels[i];
+  LinkedListIterator iterator;
+  MidiEvent midiEvent;
+
+  if (channels == kPluginChainAllMidiChannels) {
+    return midiEvents;
+  }
+
+  linkedListClear(self->_midiRouteEvents);
+
+  for (iterator = linkedListBegin(midiEvents); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    midiEvent = (MidiEvent)linkedListIteratorGetItem(iterator);
+
+    if (midiEvent->eventType != MIDI_TYPE_REGULAR ||
+        (channels & (1 << (midiEvent->status & 0x0f))) != 0) {
+      linkedListAppend(self->_midiRouteEvents, midiEvent);
+    }
+  }
+
+  return self->_midiRouteEvents;
+}
+
+static void _pluginChainSendMidi(PluginChain self, unsigned int index,
+                                 LinkedList midiEvents) {
+  PluginChainInstanceGroup group = self->_instanceGroups[index];
+  Plugin plugin = self->plugins[index];
+  unsigned int i;
+
+  midiEvents = _pluginChainFilterMidi(self, index, midiEvents);
+
+  if (linkedListLength(midiEvents) == 0) {
+    return;
+  }
+
+  taskTimerStart(self->midiTimers[index]);
+  realtimeAuditEnterPlugin(plugin->pluginName->data);
+  samplingProfilerEnterPlugin(plugin->pluginName->data,
+                              SAMPLING_PROFILER_FRAME_PROCESS_MIDI);
+  plugin->processMidiEvents(plugin, midiEvents);
+
+  for (i = 1; group != NULL && i < group->numInstances; i++) {
+    plugin = group->instances[i].plugin;
+    plugin->processMidiEvents(plugin, midiEvents);
+  }
+
+  samplingProfilerExitPlugin();
+  realtimeAuditExitPlugin();
+  taskTimerStop(self->midiTimers[index]);
+}
+
+// Sends the held back MIDI events which fall within a part of the block, with
+// their offsets made relative to the start of the part. The offsets are put
+// back afterwards, since the events belong to the caller.
+static void _pluginChainSendMidiForPart(PluginChain self, SampleCount partStart,
+                                        SampleCount partEnd,
+                                        boolByte lastPart) {
+  LinkedList partEvents = self->_automationPartMidiEvents;
+  LinkedListIterator iterator;
+  MidiEvent midiEvent;
+
+  for (iterator = linkedListBegin(self->_automationMidiEvents);
+       iterator != NULL; iterator = linkedListIteratorNext(iterator)) {
+    midiEvent = (MidiEvent)linkedListIteratorGetItem(iterator);
+
+    if (midiEvent->deltaFrames >= (unsigned long)partStart &&
+        (lastPart || midiEvent->deltaFrames < (unsigned long)partEnd)) {
+      linkedListAppend(partEvents, midiEvent);
+    }
+  }
+
+  if (linkedListLength(partEvents) == 0) {
+    return;
+  }
+
+  for (iterator = linkedListBegin(partEvents); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    ((MidiEvent)linkedListIteratorGetItem(iterator))->deltaFrames -=
+        (unsigned long)partStart;
+  }
+
+  _pluginChainSendMidi(self, 0, partEvents);
+
+  for (iterator = linkedListBegin(partEvents); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    ((MidiEvent)linkedListIteratorGetItem(iterator))->deltaFrames +=
+        (unsigned long)partStart;
+  }
+
+  linkedListClear(partEvents);
+}
+
+// Processes the first plugin in parts which end at each automation point in
+// the block, so that every parameter change takes effect on its exact frame.
+// Any MIDI events for the block are sent along with the part they fall in.
+static double _pluginChainRunAutomatedPlugin(PluginChain self,
+                                             SampleBuffer inputs,
+                                             SampleBuffer outputs) {
+  const SampleCount blocksize = inputs->blocksize;
+  SampleBufferMembers inputView;
+  SampleBufferMembers outputView;
+  SampleCount partStart = 0;
+  SampleCount partEnd;
+  SampleCount untilFrame;
+  double result = 0.0;
+
+  if (inputs->numChannels > self->_automationNumChannels ||
+      outputs->numChannels > self->_automationNumChannels) {
+    _pluginChainApplyAutomation(self, blocksize, blocksize);
+
+    if (self->_automationMidiEvents != NULL) {
+      _pluginChainSendMidi(self, 0, self->_automationMidiEvents);
+    }
+
+    return _pluginChainRunPluginWithBuffers(self, 0, inputs, outputs);
+  }
+
+  while (partStart < blocksize) {
+    untilFrame = partStart + kPluginChainMinAutomationFrames;
+    partEnd = _pluginChainApplyAutomation(
+        self, untilFrame < blocksize ? untilFrame : blocksize, blocksize);
+
+    if (partStart == 0 && partEnd == blocksize) {
+      if (self->_automationMidiEvents != NULL) {
+        _pluginChainSendMidi(self, 0, self->_automationMidiEvents);
+      }
+
+      return _pluginChainRunPluginWithBuffers(self, 0, inputs, outputs);
+    }
 
-void initPluginChain(void) {
-  pluginChainInstance = (PluginChain)malloc(sizeof(PluginChainMembers));
+    if (self->_automationMidiEvents != NULL) {
+      _pluginChainSendMidiForPart(self, partStart, partEnd,
+                                  (boolByte)(partEnd == blocksize));
+    }
 
-  pluginChainInstance->numPlugins = 0;
-  pluginChainInstance->plugins = (Plugin *)malloc(sizeof(Plugin) * MAX_PLUGINS);
-  pluginChainInstance->presets =
-      (PluginPreset *)malloc(sizeof(PluginPreset) * MAX_PLUGINS);
-  pluginChainInstance->audioTimers =
-      (TaskTimer *)malloc(sizeof(TaskTimer) * MAX_PLUGINS);
-  pluginChainInstance->midiTimers =
-      (TaskTimer *)malloc(sizeof(TaskTimer) * MAX_PLUGINS);
+    _pluginChainSetFrameView(&inputView, self->_automationInputs, inputs,
+                             partStart, partEnd - partStart);
+    _pluginChainSetFrameView(&outputView, self->_automationOutputs, outputs,
+                             partStart, partEnd - partStart);
+    result += _pluginChainRunPluginWithBuffers(self, 0, &inputView,
+                                               &outputView);
+    partStart = partEnd;
+  }
 
-  pluginChainInstance->_realtime = false;
-  pluginChainInstance->_realtimeTimer = NULL;
+  outputs->blocksize = blocksize;
+  return result;
 }
 
-boolByte pluginChainAppend(PluginChain self, Plugin plugin,
-                           PluginPreset preset) {
-  if (plugin == NULL) {
-    return false;
-  } else if (self->numPlugins + 1 >= MAX_PLUGINS) {
-    logError("Could not add plugin '%s', maximum number reached",
-             plugin->pluginName->data);
-    return false;
-  } else if (!openPlugin(plugin)) {
-    return false;
+static double _pluginChainRunPlugin(PluginChain self, unsigned int i) {
+  Plugin plugin = self->plugins[i];
+  return _pluginChainRunPluginWithBuffers(self, i, plugin->inputBuffer,
+                                          plugin->outputBuffer);
+}
+
+static void _pluginChainLogProcessingTime(PluginChain self, unsigned int i,
+                                          double processingTimeInMs,
+                                          double maxProcessingTimeInMs) {
+  Plugin plugin = self->plugins[i];
+  latencyHistogramRecord(self->audioLatencies[i], processingTimeInMs,
+                         maxProcessingTimeInMs);
+
+  if (self->_degradePolicies != NULL && self->_degradePolicies[i] != NULL &&
+      !self->_degradePolicies[i]->degraded) {
+    self->_degradePolicies[i]->lastProcessingTimeInMs = processingTimeInMs;
+  }
+
+  if (self->_recentBlockTimes != NULL) {
+    _pluginChainGetRecentBlockRow(self, self->_numRecentBlocks)[i] =
+        processingTimeInMs;
+  }
+
+  liveMetricsRecordPluginBlock(plugin->pluginName->data, processingTimeInMs);
+
+  if (processingTimeInMs > maxProcessingTimeInMs && self->_realtime) {
+    logWarn(
+        "Possible dropout! Plugin '%s' spent %dms processing time (%dms max)",
+        plugin->pluginName->data, (int)processingTimeInMs,
+        (int)maxProcessingTimeInMs);
   } else {
-    self->plugins[self->numPlugins] = plugin;
-    self->presets[self->numPlugins] = preset;
-    self->audioTimers[self->numPlugins] =
-        newTaskTimer(plugin->pluginName, "Audio Processing");
-    self->midiTimers[self->numPlugins] =
-        newTaskTimer(plugin->pluginName, "MIDI Processing");
-    self->numPlugins++;
-    return true;
+    logDebugFast(
+        "Plugin '%s' spent %.3fms processing (%.1f%% effective CPU usage)",
+        plugin->pluginName->data, processingTimeInMs,
+        100.0 * processingTimeInMs / maxProcessingTimeInMs);
   }
 }
 
-boolByte pluginChainAddFromArgumentString(PluginChain pluginChain,
-                                          const CharString argumentString,
-                                          const CharString userSearchPath) {
-  // Expect a semicolon-separated string of plugins with comma separators for
-  // preset names
-  // Example: plugin1,preset1name;plugin2,preset2name
-  char *substringStart;
-  char *pluginSeparator;
-  char *endChar;
-  CharString pluginNameBuffer = NULL;
-  CharString presetNameBuffer = NULL;
-  char *presetSeparator;
-  PluginPreset preset;
-  Plugin plugin;
-  size_t substringLength;
+static void _pluginChainStageThread(void *stagePtr) {
+  PluginChainStage stage = (PluginChainStage)stagePtr;
+  PluginChain self = (PluginChain)stage->pluginChain;
 
-  if (charStringIsEmpty(argumentString)) {
-    logWarn("Plugin chain string is empty");
-    return false;
+  if (self->_flushDenormals) {
+    fpuStateFlushDenormals();
   }
 
-  substringStart = argumentString->data;
-  pluginSeparator = strchr(argumentString->data, CHAIN_STRING_PLUGIN_SEPARATOR);
-  endChar = argumentString->data + strlen(argumentString->data);
+  while (true) {
+    semaphoreWait(stage->start);
 
-  do {
-    if (pluginSeparator == NULL) {
-      substringLength = strlen(argumentString->data);
-    } else {
-      substringLength = pluginSeparator - substringStart;
+    // Only changed while all stages are idle, so no further locking is needed
+    if (self->_stopStages) {
+      break;
     }
 
-    freeCharString(pluginNameBuffer);
-    pluginNameBuffer = newCharString();
-    strncpy(pluginNameBuffer->data, substringStart, substringLength);
+    stage->processingTimeInMs = _pluginChainRunPlugin(self, stage->index);
+    semaphorePost(stage->done);
+  }
+}
+
+static void _pluginChainStartStages(PluginChain self) {
+  PluginChainStage stage;
+  unsigned int i;
 
-    // Look for the separator for presets to load into these plugins
-    freeCharString(presetNameBuffer);
-    presetNameBuffer = newCharString();
-    presetSeparator =
-        strchr(pluginNameBuffer->data, CHAIN_STRING_PROGRAM_SEPARATOR);
+  self->_stages = (PluginChainStage)malloc(sizeof(PluginChainStageMembers) *
+                                           self->numPlugins);
 
-    if (presetSeparator != NULL) {
-      // Null-terminate this string to force it to end, then extract preset name
-      // from next char
-      *presetSeparator = '\0';
-      strncpy(presetNameBuffer->data, presetSeparator + 1,
-              strlen(presetSeparator + 1));
+  for (i = 0; i < self->numPlugins; i++) {
+    stage = &(self->_stages[i]);
+    stage->index = i;
+    stage->pluginChain = self;
+    stage->processingTimeInMs = 0.0;
+    stage->thread = NULL;
+    stage->start = NULL;
+    stage->done = NULL;
+
+    // The first plugin is always processed by the calling thread
+    if (i > 0) {
+      stage->start = newSemaphore(0);
+      stage->done = newSemaphore(0);
+      stage->thread = newThread(_pluginChainStageThread, stage);
+
+      if (stage->thread == NULL) {
+        logWarn("Could not start thread for plugin '%s', it will be processed "
+                "on the main thread",
+                self->plugins[i]->pluginName->data);
+      }
     }
+  }
+}
 
-    // Find preset for this plugin (if given)
-    preset = NULL;
+static void _pluginChainStopStages(PluginChain self) {
+  unsigned int i;
 
-    if (strlen(presetNameBuffer->data) > 0) {
-      logInfo("Opening preset '%s' for plugin", presetNameBuffer->data);
-      preset = pluginPresetFactory(presetNameBuffer);
-    }
+  if (self->_stages == NULL) {
+    return;
+  }
 
-    // Guess the plugin type from the file extension, search root, etc.
-    plugin = pluginFactory(pluginNameBuffer, userSearchPath);
+  self->_stopStages = true;
 
-    if (plugin != NULL) {
-      if (!pluginChainAppend(pluginChain, plugin, preset)) {
-        logError("Plugin '%s' could not be added to the chain",
-                 pluginNameBuffer->data);
-        freeCharString(pluginNameBuffer);
-        freeCharString(presetNameBuffer);
-        return false;
-      }
+  for (i = 0; i < self->numPlugins; i++) {
+    if (self->_stages[i].thread != NULL) {
+      semaphorePost(self->_stages[i].start);
+      threadJoinAndFree(self->_stages[i].thread);
     }
 
-    if (pluginSeparator == NULL) {
-      break;
-    } else {
-      substringStart = pluginSeparator + 1;
-      pluginSeparator =
-          strchr(pluginSeparator + 1, CHAIN_STRING_PLUGIN_SEPARATOR);
-    }
-  } while (substringStart < endChar);
+    freeSemaphore(self->_stages[i].start);
+    freeSemaphore(self->_stages[i].done);
+  }
 
-  freeCharString(pluginNameBuffer);
-  freeCharString(presetNameBuffer);
-  return true;
+  free(self->_stages);
+  self->_stages = NULL;
+  self->_stopStages = false;
 }
 
-static boolByte _loadPresetForPlugin(Plugin plugin, PluginPreset preset) {
-  if (pluginPresetIsCompatibleWith(preset, plugin)) {
-    if (!preset->openPreset(preset)) {
-      logError("Could not open preset '%s'", preset->presetName->data);
-      return false;
-    }
-
-    if (!preset->loadPreset(preset, plugin)) {
-      logError("Could not load preset '%s' in plugin '%s'",
-               preset->presetName->data, plugin->pluginName->data);
-      return false;
+static void _pluginChainDelayBranchOutput(PluginChainBranch branch) {
+  SampleBuffer output = branch->output;
+  unsigned long position = branch->delayPosition;
+  Sample sample;
+  ChannelCount channel;
+  SampleCount frame;
+
+  for (channel = 0; channel < output->numChannels; channel++) {
+    position = branch->delayPosition;
+
+    for (frame = 0; frame < output->blocksize; frame++) {
+      sample = output->samples[channel][frame];
+      output->samples[channel][frame] =
+          branch->delayLine->samples[channel][position];
+      branch->delayLine->samples[channel][position] = sample;
+      position = position + 1 < branch->delay ? position + 1 : 0;
     }
-
-    logInfo("Loaded preset '%s' in plugin '%s'", preset->presetName->data,
-            plugin->pluginName->data);
-    return true;
-  } else {
-    logError("Preset '%s' is not a compatible format for plugin",
-             preset->presetName->data);
-    return false;
   }
+
+  branch->delayPosition = position;
 }
 
-ReturnCode pluginChainInitialize(PluginChain pluginChain) {
+static void _pluginChainProcessBranch(PluginChain self,
+                                      PluginChainBranch branch) {
+  SampleBuffer formerOutputBuffer = branch->input;
+  SampleBuffer nextInputBuffer;
   Plugin plugin;
-  PluginPreset preset;
   unsigned int i;
 
-  for (i = 0; i < pluginChain->numPlugins; i++) {
-    plugin = pluginChain->plugins[i];
+  for (i = 0; i < branch->numPlugins; i++) {
+    plugin = self->plugins[branch->firstPlugin + i];
 
-    if (!openPlugin(plugin)) {
-      return RETURN_CODE_PLUGIN_ERROR;
-    } else {
-      if (i > 0 && plugin->pluginType == PLUGIN_TYPE_INSTRUMENT) {
-        logError("Instrument plugin '%s' must be first in the chain",
-                 plugin->pluginName->data);
-        return RETURN_CODE_INVALID_PLUGIN_CHAIN;
-      } else if (plugin->pluginType == PLUGIN_TYPE_UNKNOWN) {
-        logError("Plugin '%s' has unknown type; It was probably not loaded "
-                 "correctly",
-                 plugin->pluginName->data);
-        return RETURN_CODE_PLUGIN_ERROR;
-      } else if (plugin->pluginType == PLUGIN_TYPE_UNSUPPORTED) {
-        logError("Plugin '%s' is of unsupported type",
-                 plugin->pluginName->data);
-        return RETURN_CODE_PLUGIN_ERROR;
+    nextInputBuffer = _pluginChainRouteToPluginInput(
+        self, branch->firstPlugin + i, formerOutputBuffer);
+    branch->processingTimesInMs[i] = _pluginChainRunPluginWithBuffers(
+        self, branch->firstPlugin + i, nextInputBuffer, plugin->outputBuffer);
+    formerOutputBuffer = plugin->outputBuffer;
+  }
+
+  branch->output = formerOutputBuffer;
+
+  if (branch->delay > 0) {
+    _pluginChainDelayBranchOutput(branch);
+  }
+}
+
+static void _pluginChainBranchThread(void *branchPtr) {
+  PluginChainBranch branch = (PluginChainBranch)branchPtr;
+  PluginChain self = (PluginChain)branch->pluginChain;
+
+  if (self->_flushDenormals) {
+    fpuStateFlushDenormals();
+  }
+
+  while (true) {
+    semaphoreWait(branch->start);
+
+    // Only changed while all branches are idle, so no further locking is
+    // needed
+    if (self->_stopSplits) {
+      break;
+    }
+
+    _pluginChainProcessBranch(self, branch);
+    semaphorePost(branch->done);
+  }
+}
+
+static ChannelCount _pluginChainGetBranchNumOutputs(PluginChain self,
+                                                    PluginChainBranch branch) {
+  Plugin lastPlugin =
+      self->plugins[branch->firstPlugin + branch->numPlugins - 1];
+  return lastPlugin->outputBuffer->numChannels;
+}
+
+static void _pluginChainStartSplits(PluginChain self) {
+  PluginChainSplit split;
+  PluginChainBranch branch;
+  unsigned long splitDelay;
+  unsigned int i, j;
+
+  for (i = 0; i < self->_numSplits; i++) {
+    split = &(self->_splits[i]);
+    splitDelay = _pluginChainGetSplitDelay(self, split);
+    split->mixBuffer = newSampleBuffer(
+        _pluginChainGetBranchNumOutputs(self, &(split->branches[0])),
+        getBlocksize());
+
+    for (j = 0; j < split->numBranches; j++) {
+      branch = &(split->branches[j]);
+      branch->pluginChain = self;
+      branch->processingTimesInMs =
+          (double *)calloc(branch->numPlugins, sizeof(double));
+      branch->delay = splitDelay - _pluginChainGetDelayOfPlugins(
+                                       self, branch->firstPlugin,
+                                       branch->numPlugins);
+      branch->delayPosition = 0;
+
+      if (branch->delay > 0) {
+        branch->delayLine = newSampleBuffer(
+            _pluginChainGetBranchNumOutputs(self, branch), branch->delay);
+        logDebug("Delaying branch %d of split %d by %lu frames", j, i,
+                 branch->delay);
       }
 
-      preset = pluginChain->presets[i];
+      // The first branch is always processed by the calling thread
+      if (j > 0) {
+        branch->start = newSemaphore(0);
+        branch->done = newSemaphore(0);
+        branch->thread = newThread(_pluginChainBranchThread, branch);
 
-      if (preset != NULL) {
-        if (!_loadPresetForPlugin(plugin, preset)) {
-          return RETURN_CODE_INVALID_ARGUMENT;
+        if (branch->thread == NULL) {
+          logWarn("Could not start thread for branch %d of split %d, it will "
+                  "be processed on the main thread",
+                  j, i);
         }
       }
     }
   }
 
-  return RETURN_CODE_SUCCESS;
+  self->_splitsBlocksize = getBlocksize();
+  self->_splitsStarted = true;
 }
 
-void pluginChainInspect(PluginChain pluginChain) {
-  Plugin plugin;
-  unsigned int i;
+static SampleBuffer _pluginChainProcessSplit(PluginChain self,
+                                             PluginChainSplit split,
+                                             SampleBuffer inBuffer,
+                                             double maxProcessingTimeInMs) {
+  PluginChainBranch branch;
+  unsigned int i, j;
 
-  for (i = 0; i < pluginChain->numPlugins; i++) {
-    plugin = pluginChain->plugins[i];
-    plugin->displayInfo(plugin);
+  for (i = 0; i < split->numBranches; i++) {
+    branch = &(split->branches[i]);
+    branch->input = inBuffer;
+
+    if (branch->thread != NULL) {
+      semaphorePost(branch->start);
+    }
   }
-}
 
-void pluginChainPrepareForProcessing(PluginChain self) {
-  Plugin plugin;
-  unsigned int i;
+  for (i = 0; i < split->numBranches; i++) {
+    branch = &(split->branches[i]);
 
-  for (i = 0; i < self->numPlugins; i++) {
-    plugin = self->plugins[i];
-    plugin->prepareForProcessing(plugin);
+    if (branch->thread == NULL) {
+      _pluginChainProcessBranch(self, branch);
+    }
   }
-}
 
-int pluginChainGetMaximumTailTimeInMs(PluginChain pluginChain) {
-  Plugin plugin;
-  int tailTime;
-  int maxTailTime = 0;
-  unsigned int i;
+  split->mixBuffer->blocksize = inBuffer->blocksize;
 
-  for (i = 0; i < pluginChain->numPlugins; i++) {
-    plugin = pluginChain->plugins[i];
-    tailTime = plugin->getSetting(plugin, PLUGIN_SETTING_TAIL_TIME_IN_MS);
+  for (i = 0; i < split->numBranches; i++) {
+    branch = &(split->branches[i]);
 
-    if (tailTime > maxTailTime) {
-      maxTailTime = tailTime;
+    if (branch->thread != NULL) {
+      semaphoreWait(branch->done);
+    }
+
+    for (j = 0; j < branch->numPlugins; j++) {
+      _pluginChainLogProcessingTime(self, branch->firstPlugin + j,
+                                    branch->processingTimesInMs[j],
+                                    maxProcessingTimeInMs);
+    }
+
+    if (i == 0) {
+      sampleBufferCopyAndMapChannels(split->mixBuffer, branch->output);
+    } else {
+      sampleBufferAdd(split->mixBuffer, branch->output);
     }
   }
 
-  return maxTailTime;
+  return split->mixBuffer;
 }
 
-unsigned long pluginChainGetProcessingDelay(PluginChain self) {
-  unsigned long processingDelay = 0;
+static void _pluginChainProcessAudioPipelined(PluginChain self,
+                                              SampleBuffer inBuffer,
+                                              SampleBuffer outBuffer,
+                                              double maxProcessingTimeInMs) {
+  // Plugins which have not yet received any output from the plugin before
+  // them are skipped, so that each plugin sees the same input as in serial mode
+  const unsigned int numActiveStages =
+      self->_numPipelineBlocks < self->numPlugins ? self->_numPipelineBlocks + 1
+                                                  : self->numPlugins;
+  Plugin lastPlugin = self->plugins[self->numPlugins - 1];
+  PluginChainStage stage;
   unsigned int i;
 
-  for (i = 0; i < self->numPlugins; i++) {
-    Plugin plugin = self->plugins[i];
-    processingDelay += plugin->getSetting(plugin, PLUGIN_INITIAL_DELAY);
+  if (self->_stages == NULL) {
+    _pluginChainStartStages(self);
   }
 
-  return processingDelay;
-}
-
-typedef struct {
-  Plugin plugin;
-  boolByte success;
-} _PluginChainSetParameterPassData;
+  // Pass on the output of the previous block, starting at the end of the chain
+  // so that each output is copied before that plugin overwrites it
+  for (i = numActiveStages - 1; i > 0; i--) {
+    _pluginChainCopyToPluginInput(self->plugins[i],
+                                  self->plugins[i - 1]->outputBuffer);
+  }
 
-void _pluginChainSetParameter(void *item, void *userData) {
-  // Expect that the linked list contains CharStrings, single that is what is
-  // being given from the command line.
-  char *parameterValue = (char *)item;
-  _PluginChainSetParameterPassData *passData =
-      (_PluginChainSetParameterPassData *)userData;
-  Plugin plugin = passData->plugin;
-  char *comma = NULL;
-  int index;
-  float value;
+  _pluginChainCopyToPluginInput(self->plugins[0], inBuffer);
 
-  // If a previous attempt to set a parameter failed, then return right away
-  // since this method will return false anyways.
-  if (!passData->success) {
-    return;
+  for (i = 0; i < numActiveStages; i++) {
+    if (self->_stages[i].thread != NULL) {
+      semaphorePost(self->_stages[i].start);
+    }
   }
 
-  // TODO: Need a "pair" type, this string parsing is done several times in the
-  // codebase
-  comma = strchr(parameterValue, ',');
+  for (i = 0; i < numActiveStages; i++) {
+    stage = &(self->_stages[i]);
 
-  if (comma == NULL) {
-    logError("Malformed parameter string, see --help parameter for usage");
-    return;
+    if (stage->thread == NULL) {
+      stage->processingTimeInMs = _pluginChainRunPlugin(self, i);
+    }
   }
 
-  *comma = '\0';
-  index = (int)strtod(parameterValue, NULL);
-  value = (float)strtod(comma + 1, NULL);
-  logDebug("Set parameter %d to %f", index, value);
-  passData->success = plugin->setParameter(plugin, (unsigned int)index, value);
-}
+  for (i = 0; i < numActiveStages; i++) {
+    stage = &(self->_stages[i]);
 
-boolByte pluginChainSetParameters(PluginChain self,
-                                  const LinkedList parameters) {
-  _PluginChainSetParameterPassData passData;
-  passData.plugin = self->plugins[0];
-  passData.success = true;
-  logDebug("Setting parameters on head plugin in chain");
-  linkedListForeach(parameters, _pluginChainSetParameter, &passData);
-  return passData.success;
-}
+    if (stage->thread != NULL) {
+      semaphoreWait(stage->done);
+    }
 
-void pluginChainSetRealtime(PluginChain self, boolByte realtime) {
-  self->_realtime = realtime;
+    _pluginChainLogProcessingTime(self, i, stage->processingTimeInMs,
+                                  maxProcessingTimeInMs);
+  }
+
+  if (numActiveStages == self->numPlugins) {
+    outBuffer->blocksize = lastPlugin->outputBuffer->blocksize;
+    sampleBufferCopyAndMapChannels(outBuffer, lastPlugin->outputBuffer);
+    self->_lastOutputs = lastPlugin->outputBuffer;
+  } else {
+    // The pipeline is still filling up, so there is no output yet
+    outBuffer->blocksize = inBuffer->blocksize;
+    sampleBufferClear(outBuffer);
+    self->_lastOutputs = outBuffer;
+  }
 
-  if (realtime) {
-    self->_realtimeTimer = newTaskTimerWithCString("PluginChain", "Realtime");
-  } else if (self->_realtimeTimer) {
-    freeTaskTimer(self->_realtimeTimer);
+  if (self->_numPipelineBlocks < self->numPlugins) {
+    self->_numPipelineBlocks++;
   }
 }
 
@@ -338,74 +3043,209 @@ void pluginChainProcessAudio(PluginChain pluginChain, SampleBuffer inBuffer,
   double totalProcessingTimeInMs;
   const double maxProcessingTimeInMs =
       inBuffer->blocksize * 1000.0 / getSampleRate();
+  SamplingProfilerFrame previousProfilerFrame;
+  FpuState previousFpuState = 0;
 
   if (pluginChain->_realtime) {
-    taskTimerStart(pluginChain->_realtimeTimer);
+    realtimeSchedulerStartBlock(pluginChain->_scheduler);
   }
 
-  SampleBuffer formerOutputBuffer = inBuffer;
-  SampleBuffer nextInputBuffer = NULL;
+  // The caller may run other code which depends on denormals, so the state is
+  // only changed for the duration of this call
+  if (pluginChain->_flushDenormals) {
+    previousFpuState = fpuStateFlushDenormals();
+  }
 
-  for (i = 0; i < pluginChain->numPlugins; i++) {
-    plugin = pluginChain->plugins[i];
-    logDebug("Processing audio with plugin '%s'", plugin->pluginName->data);
-    nextInputBuffer = plugin->inputBuffer;
-    nextInputBuffer->blocksize = formerOutputBuffer->blocksize;
-    sampleBufferCopyAndMapChannels(nextInputBuffer, formerOutputBuffer);
-    plugin->outputBuffer->blocksize = plugin->inputBuffer->blocksize;
-    taskTimerStart(pluginChain->audioTimers[i]);
-    plugin->processAudio(plugin, plugin->inputBuffer, plugin->outputBuffer);
-    processingTimeInMs = taskTimerStop(pluginChain->audioTimers[i]);
-
-    if (processingTimeInMs > maxProcessingTimeInMs && pluginChain->_realtime) {
-      logWarn(
-          "Possible dropout! Plugin '%s' spent %dms processing time (%dms max)",
-          plugin->pluginName->data, (int)processingTimeInMs,
-          (int)maxProcessingTimeInMs);
-    } else {
-      logDebug("Plugin '%s' spent %dms processing (%d%% effective CPU usage)",
-               plugin->pluginName->data, (int)processingTimeInMs,
-               (int)(processingTimeInMs / maxProcessingTimeInMs));
-    }
+  // All pipeline stages and branches have finished the previous block, so no
+  // other thread is using the plugins while the changes are applied. Loading a
+  // preset may allocate memory inside the plugin, so this is done before the
+  // block is audited.
+  if (pluginChain->_control != NULL) {
+    _pluginChainApplyControl(pluginChain);
+  }
 
-    formerOutputBuffer = plugin->outputBuffer;
+  if (pluginChain->_realtime && pluginChain->_degradePolicies != NULL &&
+      pluginChain->_lastBlockBudgetInMs > 0.0) {
+    _pluginChainApplyDegrader(pluginChain);
   }
 
-  nextInputBuffer = outBuffer;
-  nextInputBuffer->blocksize = formerOutputBuffer->blocksize;
-  sampleBufferCopyAndMapChannels(nextInputBuffer, formerOutputBuffer);
+  taskTimerStart(pluginChain->_blockTimer);
+  realtimeAuditBegin();
+  previousProfilerFrame =
+      samplingProfilerSetFrame(SAMPLING_PROFILER_FRAME_PLUGIN_CHAIN);
 
-  if (pluginChain->_realtime) {
-    totalProcessingTimeInMs = taskTimerStop(pluginChain->_realtimeTimer);
+  if (pluginChainGetPipelineDelayInBlocks(pluginChain) > 0) {
+    if (pluginChain->_automation != NULL) {
+      _pluginChainApplyAutomation(pluginChain, inBuffer->blocksize,
+                                  inBuffer->blocksize);
+    }
+
+    _pluginChainProcessAudioPipelined(pluginChain, inBuffer, outBuffer,
+                                      maxProcessingTimeInMs);
+  } else {
+    SampleBuffer formerOutputBuffer = inBuffer;
+    SampleBuffer nextInputBuffer = NULL;
+    SampleBuffer nextOutputBuffer = NULL;
+    unsigned int nextSplit = 0;
+
+    if (pluginChain->_numSplits > 0 && !pluginChain->_splitsStarted) {
+      _pluginChainStartSplits(pluginChain);
+    }
+
+    // When the chain starts with a split, the first plugin is run by a branch
+    // thread and the changes can only be applied before the block
+    if (pluginChain->_automation != NULL && pluginChain->_numSplits > 0 &&
+        pluginChain->_splits[0].firstPlugin == 0) {
+      _pluginChainApplyAutomation(pluginChain, inBuffer->blocksize,
+                                  inBuffer->blocksize);
+    }
+
+    for (i = 0; i < pluginChain->numPlugins; i++) {
+      if (nextSplit < pluginChain->_numSplits &&
+          pluginChain->_splits[nextSplit].firstPlugin == i) {
+        PluginChainSplit split = &(pluginChain->_splits[nextSplit]);
+        formerOutputBuffer = _pluginChainProcessSplit(
+            pluginChain, split, formerOutputBuffer, maxProcessingTimeInMs);
+        // Continue with the first plugin after the split
+        i += split->numPlugins - 1;
+        nextSplit++;
+        continue;
+      }
+
+      plugin = pluginChain->plugins[i];
+      logDebugFast("Processing audio with plugin '%s'",
+                   plugin->pluginName->data);
+
+      // The previous output is passed to the plugin without copying it, even
+      // when its channels have to be mapped to the plugin's inputs
+      nextInputBuffer =
+          _pluginChainRouteToPluginInput(pluginChain, i, formerOutputBuffer);
+
+      // Likewise, the last plugin can write directly to the output buffer
+      if (i == pluginChain->numPlugins - 1 &&
+          outBuffer->numChannels == plugin->outputBuffer->numChannels) {
+        nextOutputBuffer = outBuffer;
+      } else {
+        nextOutputBuffer = plugin->outputBuffer;
+      }
+
+      if (i == 0 && pluginChain->_automation != NULL) {
+        processingTimeInMs = _pluginChainRunAutomatedPlugin(
+            pluginChain, nextInputBuffer, nextOutputBuffer);
+      } else {
+        processingTimeInMs = _pluginChainRunPluginWithBuffers(
+            pluginChain, i, nextInputBuffer, nextOutputBuffer);
+      }
 
-    if (totalProcessingTimeInMs < maxProcessingTimeInMs) {
-      taskTimerSleep(maxProcessingTimeInMs - totalProcessingTimeInMs);
+      _pluginChainLogProcessingTime(pluginChain, i, processingTimeInMs,
+                                    maxProcessingTimeInMs);
+      formerOutputBuffer = nextOutputBuffer;
     }
+
+    if (formerOutputBuffer != outBuffer) {
+      outBuffer->blocksize = formerOutputBuffer->blocksize;
+      sampleBufferCopyAndMapChannels(outBuffer, formerOutputBuffer);
+    }
+
+    pluginChain->_lastOutputs = formerOutputBuffer;
+  }
+
+  pluginChain->_midiReceived = false;
+  pluginChain->_automationMidiEvents = NULL;
+  pluginChain->_automationFrame += inBuffer->blocksize;
+
+  if (pluginChain->_flushDenormals) {
+    fpuStateRestore(previousFpuState);
+  }
+
+  samplingProfilerSetFrame(previousProfilerFrame);
+  realtimeAuditEnd();
+  totalProcessingTimeInMs = taskTimerStop(pluginChain->_blockTimer);
+  latencyHistogramRecord(pluginChain->chainLatency, totalProcessingTimeInMs,
+                         maxProcessingTimeInMs);
+  liveMetricsRecordBlock(totalProcessingTimeInMs, maxProcessingTimeInMs);
+  pluginChain->_lastBlockTimeInMs = totalProcessingTimeInMs;
+  pluginChain->_lastBlockBudgetInMs = maxProcessingTimeInMs;
+
+  if (pluginChain->_recentBlockTimes != NULL) {
+    _pluginChainGetRecentBlockRow(pluginChain, pluginChain->_numRecentBlocks)
+        [pluginChain->numPlugins] = totalProcessingTimeInMs;
+    pluginChain->_numRecentBlocks++;
   }
+
+  if (pluginChain->_realtime) {
+    realtimeSchedulerWaitForBlock(pluginChain->_scheduler, inBuffer->blocksize,
+                                  getSampleRate());
+  }
+}
+
+// The first plugin is only processed in parts when it is run directly by
+// pluginChainProcessAudio(), and not by a pipeline stage or a split branch
+static boolByte _pluginChainCanSplitAutomation(PluginChain self) {
+  return (boolByte)(self->_automation != NULL &&
+                    self->_automationNumChannels > 0 &&
+                    pluginChainGetPipelineDelayInBlocks(self) == 0 &&
+                    (self->_numSplits == 0 ||
+                     self->_splits[0].firstPlugin > 0));
 }
 
 void pluginChainProcessMidi(PluginChain pluginChain, LinkedList midiEvents) {
-  Plugin plugin;
+  SamplingProfilerFrame previousProfilerFrame;
+  unsigned int firstPlugin = 0;
+  // The later stages of a pipeline are processing earlier blocks on their own
+  // threads, so only the first plugin can be sent MIDI
+  unsigned int numPlugins =
+      pluginChainGetPipelineDelayInBlocks(pluginChain) > 0
+          ? 1
+          : pluginChain->numPlugins;
+  unsigned int i;
 
   if (midiEvents->item != NULL) {
-    logDebug("Processing plugin chain MIDI events");
-    // Right now, we only process MIDI in the first plugin in the chain
-    // TODO: Is this really the correct behavior? How do other sequencers do it?
-    plugin = pluginChain->plugins[0];
-    taskTimerStart(pluginChain->midiTimers[0]);
-    plugin->processMidiEvents(plugin, midiEvents);
-    taskTimerStop(pluginChain->midiTimers[0]);
+    pluginChain->_midiReceived = true;
+
+    if (_pluginChainCanSplitAutomation(pluginChain)) {
+      logDebugFast("Holding back plugin chain MIDI events for automation");
+      pluginChain->_automationMidiEvents = midiEvents;
+      firstPlugin = 1;
+    }
+
+    realtimeAuditBegin();
+    previousProfilerFrame =
+        samplingProfilerSetFrame(SAMPLING_PROFILER_FRAME_PLUGIN_CHAIN);
+    logDebugFast("Processing plugin chain MIDI events");
+
+    for (i = firstPlugin; i < numPlugins; i++) {
+      if (pluginChain->_midiChannels[i] != 0) {
+        _pluginChainSendMidi(pluginChain, i, midiEvents);
+      }
+    }
+
+    samplingProfilerSetFrame(previousProfilerFrame);
+    realtimeAuditEnd();
   }
 }
 
 void pluginChainShutdown(PluginChain pluginChain) {
   Plugin plugin;
-  unsigned int i;
+  PluginChainInstanceGroup group;
+  unsigned int i, j;
+
+  _pluginChainStopStages(pluginChain);
+  _pluginChainStopSplits(pluginChain);
 
   for (i = 0; i < pluginChain->numPlugins; i++) {
     plugin = pluginChain->plugins[i];
     logInfo("Closing plugin '%s'", plugin->pluginName->data);
     closePlugin(plugin);
+    group = pluginChain->_instanceGroups[i];
+
+    if (group != NULL) {
+      _pluginChainStopInstanceThreads(group);
+
+      for (j = 1; j < group->numInstances; j++) {
+        closePlugin(group->instances[j].plugin);
+      }
+    }
   }
 }
 
@@ -413,22 +3253,60 @@ void freePluginChain(PluginChain pluginChain) {
   if (pluginChain != NULL) {
     unsigned int i;
 
+    _pluginChainStopStages(pluginChain);
+    _pluginChainStopSplits(pluginChain);
+
     for (i = 0; i < pluginChain->numPlugins; i++) {
+      _freePluginChainInstanceGroup(pluginChain->_instanceGroups[i]);
       freePluginPreset(pluginChain->presets[i]);
       freePlugin(pluginChain->plugins[i]);
       freeTaskTimer(pluginChain->audioTimers[i]);
       freeTaskTimer(pluginChain->midiTimers[i]);
+      freeLatencyHistogram(pluginChain->audioLatencies[i]);
+      freePerfCounters(pluginChain->perfCounters[i]);
+      freeSampleReblocker(pluginChain->_reblockers[i]);
+      free(pluginChain->_inputRoutes[i].samples);
     }
 
     free(pluginChain->presets);
     free(pluginChain->plugins);
     free(pluginChain->audioTimers);
     free(pluginChain->midiTimers);
-
-    if (pluginChain->_realtime) {
-      freeTaskTimer(pluginChain->_realtimeTimer);
+    free(pluginChain->audioLatencies);
+    free(pluginChain->hostCallbackTimes);
+    free(pluginChain->perfCounters);
+    free(pluginChain->_silentInputFrames);
+    free(pluginChain->_silenceHoldFrames);
+    free(pluginChain->_pluginBlocksizes);
+    free(pluginChain->_reblockers);
+    free(pluginChain->_instanceGroups);
+    free(pluginChain->_inputRoutes);
+    free(pluginChain->_midiChannels);
+
+    for (i = 0; i < pluginChain->_numSplits; i++) {
+      free(pluginChain->_splits[i].branches);
     }
 
+    free(pluginChain->_splits);
+    freeLinkedListAndItems(pluginChain->_serialLoadPlugins,
+                           (LinkedListFreeItemFunc)freeCharString);
+    freeLinkedListAndItems(pluginChain->_midiRoutes,
+                           (LinkedListFreeItemFunc)_freePluginChainMidiRoute);
+    freeLinkedList(pluginChain->_midiRouteEvents);
+    freeCharString(pluginChain->_isolatedHost);
+    freeCharString(pluginChain->_sidechainPluginName);
+    freeSampleBuffer(pluginChain->_sidechain);
+    free(pluginChain->_automationInputs);
+    free(pluginChain->_automationOutputs);
+    freeLinkedList(pluginChain->_automationPartMidiEvents);
+    freeNoteRenderCache(pluginChain->_noteRenderCache);
+    freePluginDegrader(pluginChain->_degrader);
+    free(pluginChain->_degradePolicies);
+    free(pluginChain->_recentBlockTimes);
+    freeLatencyHistogram(pluginChain->chainLatency);
+    freeTaskTimer(pluginChain->_blockTimer);
+    freeRealtimeScheduler(pluginChain->_scheduler);
+
     free(pluginChain);
   }
 }
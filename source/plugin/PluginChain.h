@@ -28,14 +28,121 @@
 #define MrsWatson_PluginChain_h
 
 #include "app/ReturnCodes.h"
+#include "audio/SampleReblocker.h"
 #include "base/LinkedList.h"
+#include "base/Thread.h"
+#include "plugin/NoteRenderCache.h"
 #include "plugin/Plugin.h"
+#include "plugin/PluginAutomation.h"
+#include "plugin/PluginControl.h"
+#include "plugin/PluginDegrader.h"
 #include "plugin/PluginPreset.h"
+#include "time/LatencyHistogram.h"
+#include "time/PerfCounters.h"
+#include "time/RealtimeScheduler.h"
 #include "time/TaskTimer.h"
 
-#define MAX_PLUGINS 8
 #define CHAIN_STRING_PLUGIN_SEPARATOR ';'
 #define CHAIN_STRING_PROGRAM_SEPARATOR ','
+#define CHAIN_STRING_SPLIT_START '['
+#define CHAIN_STRING_SPLIT_END ']'
+#define CHAIN_STRING_BRANCH_SEPARATOR '|'
+#define CHAIN_STRING_BLOCKSIZE_SEPARATOR '@'
+
+// Number of blocks whose processing times are kept for error reports
+#define PLUGIN_CHAIN_RECENT_BLOCKS 64
+
+/**
+ * One stage of a pipelined plugin chain, which processes a single plugin on a
+ * worker thread. Stages without a thread are processed on the calling thread.
+ */
+typedef struct {
+  unsigned int index;
+  void *pluginChain;
+  Thread thread;
+  Semaphore start;
+  Semaphore done;
+  double processingTimeInMs;
+} PluginChainStageMembers;
+typedef PluginChainStageMembers *PluginChainStage;
+
+/**
+ * One instance of a plugin which processes some of the channels of the chain.
+ * The input and output buffers only refer to the channels of the buffers which
+ * are passed to the plugin, so they must not be freed.
+ */
+typedef struct {
+  Plugin plugin;
+  void *group;
+  SampleBufferMembers input;
+  SampleBufferMembers output;
+  Thread thread;
+  Semaphore start;
+  Semaphore done;
+} PluginChainInstanceMembers;
+typedef PluginChainInstanceMembers *PluginChainInstance;
+
+/**
+ * Several instances of a plugin which together process all channels of the
+ * chain, when the plugin supports fewer channels than that. The first instance
+ * is the plugin in the chain, and all others are processed on their own worker
+ * threads.
+ */
+typedef struct {
+  unsigned int numInstances;
+  ChannelCount channelsPerInstance;
+  PluginChainInstance instances;
+  boolByte stopInstances;
+  boolByte flushDenormals;
+} PluginChainInstanceGroupMembers;
+typedef PluginChainInstanceGroupMembers *PluginChainInstanceGroup;
+
+/**
+ * One branch of a split in a plugin chain. A branch is a serial run of plugins
+ * which processes the input of the split. All branches except for the first
+ * one are processed on their own worker threads.
+ */
+typedef struct {
+  unsigned int firstPlugin;
+  unsigned int numPlugins;
+  void *pluginChain;
+  SampleBuffer input;
+  SampleBuffer output;
+  double *processingTimesInMs;
+  // Delays the output of this branch to match the branch with the highest
+  // latency in the split
+  unsigned long delay;
+  SampleBuffer delayLine;
+  unsigned long delayPosition;
+  Thread thread;
+  Semaphore start;
+  Semaphore done;
+} PluginChainBranchMembers;
+typedef PluginChainBranchMembers *PluginChainBranch;
+
+/**
+ * Section of a plugin chain which is processed in parallel branches, whose
+ * outputs are then summed together. The plugins of all branches are stored
+ * consecutively in the chain, starting at firstPlugin.
+ */
+typedef struct {
+  unsigned int firstPlugin;
+  unsigned int numPlugins;
+  unsigned int numBranches;
+  PluginChainBranch branches;
+  SampleBuffer mixBuffer;
+} PluginChainSplitMembers;
+typedef PluginChainSplitMembers *PluginChainSplit;
+
+/**
+ * MIDI channels which are sent to the plugins with a given name
+ */
+typedef struct {
+  CharString pluginName;
+  // Bit n is set when MIDI channel n + 1 is sent to the plugin
+  unsigned short channels;
+} PluginChainMidiRouteMembers;
+typedef PluginChainMidiRouteMembers *PluginChainMidiRoute;
 
 typedef struct {
   unsigned int numPlugins;
@@ -43,25 +150,128 @@ typedef struct {
   PluginPreset *presets;
   TaskTimer *audioTimers;
   TaskTimer *midiTimers;
+  // Time spent processing each block, for each plugin and the whole chain
+  LatencyHistogram *audioLatencies;
+  LatencyHistogram chainLatency;
+  // Part of each plugin's audio processing time which was spent in calls back
+  // to the host, in milliseconds
+  double *hostCallbackTimes;
+  // Hardware events counted during each plugin's audio processing, only
+  // after pluginChainSetMeasurePerfCounters() has been called
+  PerfCounters *perfCounters;
 
   // Private fields
+  unsigned int _capacity;
+  boolByte _measurePerfCounters;
   boolByte _realtime;
-  TaskTimer _realtimeTimer;
+  RealtimeScheduler _scheduler;
+  boolByte _flushDenormals;
+  TaskTimer _blockTimer;
+  boolByte _pipelined;
+  PluginChainStage _stages;
+  boolByte _stopStages;
+  unsigned int _numPipelineBlocks;
+  PluginChainSplit _splits;
+  unsigned int _numSplits;
+  boolByte _splitOpen;
+  boolByte _splitsStarted;
+  // Blocksize which the buffers of the started splits were allocated for
+  SampleCount _splitsBlocksize;
+  boolByte _stopSplits;
+  boolByte _skipSilence;
+  boolByte _midiReceived;
+  boolByte _channelInstances;
+  boolByte _parallelLoading;
+  // List of CharString names of plugins which are never loaded on a thread
+  LinkedList _serialLoadPlugins;
+  // List of PluginChainMidiRoute, which are resolved to the channels of each
+  // plugin by pluginChainInitialize()
+  LinkedList _midiRoutes;
+  // MIDI channels which each plugin receives, in the same format as the
+  // channels of a PluginChainMidiRoute
+  unsigned short *_midiChannels;
+  // Events of the current block which pass the channel filter of a plugin
+  LinkedList _midiRouteEvents;
+  // Executable which hosts each plugin in its own process, or NULL if plugins
+  // are loaded in this process. Empty for the current executable.
+  CharString _isolatedHost;
+  // Extra instances of each plugin, or NULL if a plugin has none
+  PluginChainInstanceGroup *_instanceGroups;
+  // Views of the buffer which feeds each plugin, with one channel pointer for
+  // each of the plugin's inputs. When the channel counts differ, the channels
+  // are mapped by pointing these at the source instead of copying them.
+  SampleBufferMembers *_inputRoutes;
+  // Name of the plugin which receives the sidechain, or NULL, and the plugin
+  // itself once pluginChainInitialize() has found it in the chain
+  CharString _sidechainPluginName;
+  Plugin _sidechainPlugin;
+  // Block of the sidechain which goes with the current block of the chain
+  SampleBuffer _sidechain;
+  // All outputs of the last plugin for the block which was processed last,
+  // before they were mapped to the channels of the chain's output
+  SampleBuffer _lastOutputs;
+  // Number of consecutive silent input frames for each plugin, and how many
+  // of them a plugin needs before its output is silent as well
+  unsigned long *_silentInputFrames;
+  unsigned long *_silenceHoldFrames;
+  // Blocksize which each plugin processes, or 0 for the chain's blocksize.
+  // Plugins with another blocksize are fed through a reblocker, which is NULL
+  // for all other plugins.
+  SampleCount *_pluginBlocksizes;
+  SampleReblocker *_reblockers;
+  // Parameter changes for the first plugin, which are not owned by the chain
+  PluginAutomation _automation;
+  unsigned long _automationNextPoint;
+  unsigned long _automationFrame;
+  // Channel pointers for processing part of a block, used with automation
+  Samples *_automationInputs;
+  Samples *_automationOutputs;
+  ChannelCount _automationNumChannels;
+  // MIDI events for the current block, which are sent to the first plugin
+  // together with each part of the block that they fall in
+  LinkedList _automationMidiEvents;
+  LinkedList _automationPartMidiEvents;
+  // Renders of single notes for playing MIDI sequences, or NULL if disabled
+  NoteRenderCache _noteRenderCache;
+  // Changes which are applied before each block, not owned by the chain
+  PluginControl _control;
+  // Plugins to degrade when a realtime chain misses its deadlines, or NULL.
+  // The policy of each plugin is resolved by pluginChainInitialize(), and is
+  // NULL for plugins without one.
+  PluginDegrader _degrader;
+  PluginDegradePolicy *_degradePolicies;
+  // Processing time and duration of the last block, which decide whether a
+  // plugin is degraded or restored before the next block
+  double _lastBlockTimeInMs;
+  double _lastBlockBudgetInMs;
+  // Processing times of the last PLUGIN_CHAIN_RECENT_BLOCKS blocks, with one
+  // row of numPlugins + 1 values per block, the last being the whole chain
+  double *_recentBlockTimes;
+  unsigned long _numRecentBlocks;
 } PluginChainMembers;
 
 /**
- * Class which holds multiple plugins which process audio in serial. Only one
- * instrument may be present in a plugin chain.
+ * Class which holds multiple plugins which process audio in serial. Parts of
+ * the chain may be split into parallel branches. Only one instrument may be
+ * present in a plugin chain.
  */
 typedef PluginChainMembers *PluginChain;
 
 /**
- * Get a reference to the global plugin chain instance.
- * @return Reference to global plugin chain, or NULL if the global instance has
- * not yet been initialized.
+ * Get a reference to the plugin chain of the current render context, or the
+ * global plugin chain instance if the calling thread has no render context.
+ * @return Reference to plugin chain, or NULL if the global instance has not yet
+ * been initialized.
  */
 PluginChain getPluginChain(void);
 
+/**
+ * Create a new plugin chain which is independent of the global instance. This
+ * is used to keep several chains open at once, for example in server mode.
+ * @return New plugin chain, which must be released with freePluginChain()
+ */
+PluginChain newPluginChain(void);
+
 /**
  * Initialize the global plugin chain instance. Should be called fairly
  * early in the program initialization.
@@ -69,7 +279,8 @@ PluginChain getPluginChain(void);
 void initPluginChain(void);
 
 /**
- * Append a plugin to the end of the chain
+ * Append a plugin to the end of the chain. If a split has been started with
+ * pluginChainBeginSplit(), then the plugin is appended to its last branch.
  * @param self
  * @param plugin Plugin to add
  * @param preset Preset to be loaded into the plugin. If no preset is desired,
@@ -79,13 +290,44 @@ void initPluginChain(void);
 boolByte pluginChainAppend(PluginChain self, Plugin plugin,
                            PluginPreset preset);
 
+/**
+ * Start a split in the chain, so that the following plugins are processed in
+ * parallel branches. The outputs of all branches are summed, and branches are
+ * delayed as needed so that they all have the latency of the slowest branch.
+ * Splits may not be nested.
+ * @param self
+ * @return True if the split was started
+ */
+boolByte pluginChainBeginSplit(PluginChain self);
+
+/**
+ * Start a new branch in the current split. The previous branch must contain at
+ * least one plugin.
+ * @param self
+ * @return True if the branch was started
+ */
+boolByte pluginChainAddBranch(PluginChain self);
+
+/**
+ * End the current split, so that the following plugins are appended after it
+ * and process the sum of its branches. The last branch must contain at least
+ * one plugin.
+ * @param self
+ * @return True if the split was ended
+ */
+boolByte pluginChainEndSplit(PluginChain self);
+
 // TODO: Deprecate and remove this function
+// Plugins are separated by CHAIN_STRING_PLUGIN_SEPARATOR, and a split is given
+// as branches in brackets, for example: plugin1;[plugin2|plugin3;plugin4]
+// The whole string is resolved before any of its plugins are opened.
 boolByte pluginChainAddFromArgumentString(PluginChain self,
                                           const CharString argumentString,
                                           const CharString userSearchPath);
 
 /**
- * Open and initialize all plugins in the chain.
+ * Open and initialize all plugins in the chain, and load their presets. With
+ * parallel loading, this is done for all VST plugins at the same time.
  * @param self
  * @return RETURN_CODE_SUCCESS on success, other code on failure
  */
@@ -107,12 +349,43 @@ void pluginChainInspect(PluginChain self);
 int pluginChainGetMaximumTailTimeInMs(PluginChain self);
 
 /**
- * Get the total processing delay in frames.
+ * Get the total processing delay in frames. This includes the delay of the
+ * pipeline when the chain is running in pipelined mode.
  * @param self
  * @return Total processing delay, in frames.
  */
 unsigned long pluginChainGetProcessingDelay(PluginChain self);
 
+/**
+ * Get the number of blocks which a pipelined chain lags behind its input. After
+ * the last input block has been processed, this many additional (silent)
+ * blocks must be sent through the chain to receive all of its output.
+ * @param self
+ * @return Number of blocks, or 0 if the chain is not pipelined
+ */
+unsigned int pluginChainGetPipelineDelayInBlocks(PluginChain self);
+
+/**
+ * Get the number of blocks whose processing times can be read with
+ * pluginChainGetRecentBlockTime()
+ * @param self
+ * @return Number of blocks, at most PLUGIN_CHAIN_RECENT_BLOCKS
+ */
+unsigned int pluginChainGetNumRecentBlocks(const PluginChain self);
+
+/**
+ * Get the processing time of one of the most recently processed blocks. This
+ * may be called from another thread while the chain is processing, in which
+ * case the times of the current block may be incomplete.
+ * @param self
+ * @param blocksAgo Zero for the last block, one for the block before it, etc.
+ * @param pluginIndex Index of the plugin, or numPlugins for the whole chain
+ * @return Processing time in milliseconds
+ */
+double pluginChainGetRecentBlockTime(const PluginChain self,
+                                     unsigned int blocksAgo,
+                                     unsigned int pluginIndex);
+
 /**
  * Set parameters on the first plugin in a chain.
  * @param self
@@ -122,15 +395,317 @@ unsigned long pluginChainGetProcessingDelay(PluginChain self);
 boolByte pluginChainSetParameters(PluginChain self,
                                   const LinkedList parameters);
 
+/**
+ * Set a single parameter on any plugin in a chain, including all additional
+ * instances of the plugin.
+ * @param self
+ * @param pluginIndex Index of the plugin in the chain
+ * @param parameterIndex Index of the parameter
+ * @param value New value, normally between 0 and 1
+ * @return True if the parameter was set, false otherwise
+ */
+boolByte pluginChainSetParameter(PluginChain self, unsigned int pluginIndex,
+                                 unsigned int parameterIndex, float value);
+
 /**
  * Set realtime mode for the plugin chain. When set, calls to
- * pluginChainProcessAudio()
- * will sleep for the additional time required to process the block in realtime.
+ * pluginChainProcessAudio() wait until the block's deadline on the wall clock,
+ * which is counted from the first block processed after the chain was created
+ * or reset. The thread processing the chain is also raised to realtime
+ * priority when possible.
  * @param realtime True to enable realtime mode, false to disable (default)
  * @param self
  */
 void pluginChainSetRealtime(PluginChain self, boolByte realtime);
 
+/**
+ * Set whether denormal numbers are flushed to zero while the plugins process
+ * audio. This is done for the thread which calls pluginChainProcessAudio() for
+ * the duration of the call, and for the chain's own worker threads. Many
+ * plugins become very slow when their state decays into denormals, for example
+ * in reverb tails or after the input has gone silent.
+ * This must be set before the first block is processed.
+ * @param self
+ * @param flushDenormals True to flush denormals (default), false to keep them
+ */
+void pluginChainSetFlushDenormals(PluginChain self, boolByte flushDenormals);
+
+/**
+ * Set pipelined mode for the plugin chain. When set, each plugin runs on its
+ * own thread, and calls to pluginChainProcessAudio() process consecutive
+ * blocks in all plugins at once. Plugin N then receives the output which plugin
+ * N-1 produced for the previous block, so the output lags the input by one
+ * block per additional plugin. Each plugin still sees exactly the same input
+ * as in serial mode, though plugins which query the transport position will
+ * see the position of the block which was sent into the chain.
+ * Chains which contain splits are always processed in serial.
+ * This must be set before the first block is processed.
+ * @param self
+ * @param pipelined True to enable pipelined mode, false to disable (default)
+ */
+void pluginChainSetPipelined(PluginChain self, boolByte pipelined);
+
+/**
+ * Count the CPU cycles, instructions, last level cache misses and branch
+ * misses of each plugin's audio processing, see PerfCounters. The counters
+ * follow each plugin onto the thread which processes it, so this also works in
+ * pipelined mode and in splits.
+ * @param self
+ * @param measure True to count events, false to disable (default)
+ */
+void pluginChainSetMeasurePerfCounters(PluginChain self, boolByte measure);
+
+/**
+ * Set channel instances for the plugin chain. When set, each effect plugin
+ * which supports fewer channels than the chain is given enough additional
+ * instances to process all channels, which all run at the same time. For
+ * example, a stereo plugin processing a 5.1 input runs in 3 instances. Presets
+ * and parameters are applied to all instances. Otherwise, channels are dropped
+ * or duplicated to match the plugin's channel count.
+ * This must be set before the chain is initialized.
+ * @param self
+ * @param channelInstances True to enable channel instances, false to disable
+ * (default)
+ */
+void pluginChainSetChannelInstances(PluginChain self,
+                                    boolByte channelInstances);
+
+/**
+ * Set the blocksize which a plugin processes. When this differs from the
+ * chain's blocksize, the plugin's audio is collected and split into blocks of
+ * its own size, which adds some latency to the chain. This latency is included
+ * in pluginChainGetProcessingDelay(). In a chain string, the blocksize can be
+ * given after the plugin name, like "Reverb@1024".
+ * This must be set before the chain is prepared for processing.
+ * @param self
+ * @param index Index of the plugin in the chain
+ * @param blocksize Blocksize of the plugin, or 0 for the chain's blocksize
+ * (default)
+ * @return True if the blocksize was set
+ */
+boolByte pluginChainSetPluginBlocksize(PluginChain self, unsigned int index,
+                                       SampleCount blocksize);
+
+/**
+ * Set parallel loading for the plugin chain. When set, the VST plugins given to
+ * pluginChainAddFromArgumentString() are opened at the same time, each on its
+ * own thread, and pluginChainInitialize() loads their presets the same way.
+ * This shortens startup for chains of plugins that are slow to open. Not all
+ * plugins tolerate being loaded this way, so it is disabled by default, and
+ * individual plugins can be excluded with pluginChainSetSerialLoadPlugins().
+ * @param self
+ * @param parallelLoading True to enable parallel loading, false to disable
+ * (default)
+ */
+void pluginChainSetParallelLoading(PluginChain self,
+                                   boolByte parallelLoading);
+
+/**
+ * Set the plugins which are always loaded on the calling thread, even when
+ * parallel loading is enabled. Names are compared without case, path or
+ * extension.
+ * @param self
+ * @param pluginNames List of C string plugin names (as given on the command
+ * line), which are copied
+ */
+void pluginChainSetSerialLoadPlugins(PluginChain self,
+                                     const LinkedList pluginNames);
+
+/**
+ * Set the MIDI routing of the plugin chain. By default, only the first plugin
+ * receives MIDI, on all channels. Each route sends MIDI to the plugins with a
+ * given name, which makes it possible to drive effects such as gates or
+ * vocoders later in the chain. When a plugin has routes, it only receives the
+ * channels of its routes, which also applies to the first plugin. Sysex and
+ * meta events are sent to every routed plugin. Pipelined chains can only send
+ * MIDI to their first plugin, since the later stages run behind the host.
+ * This must be called before pluginChainInitialize().
+ * @param self
+ * @param routes List of C strings in the format "name" for all channels, or
+ * "name,channel" or "name,first-last" with channels from 1 to 16. Names are
+ * compared as with pluginChainSetSerialLoadPlugins().
+ * @return True if all routes were valid, otherwise false, in which case the
+ * routing is unchanged
+ */
+boolByte pluginChainSetMidiRoutes(PluginChain self, const LinkedList routes);
+
+/**
+ * Feed a sidechain into the inputs of a plugin which follow the channels that
+ * it receives from the chain, for example the key input of a compressor. The
+ * inputs point at the channels of the sidechain, so nothing is premixed or
+ * copied. Only the first plugin with the name receives the sidechain, and it
+ * must have more inputs than the sidechain has channels. Plugins processed by
+ * several instances, and plugins after the first in a pipelined chain, do not
+ * receive it. This must be called before pluginChainInitialize().
+ * @param self
+ * @param pluginName Name of the plugin, which is compared as with
+ * pluginChainSetSerialLoadPlugins()
+ * @param numChannels Number of channels in the sidechain
+ */
+void pluginChainSetSidechain(PluginChain self, const CharString pluginName,
+                             ChannelCount numChannels);
+
+/**
+ * Get the buffer for the block of the sidechain which goes with the next block
+ * of the chain. The caller fills it before each call to
+ * pluginChainProcessAudio(), and it is silent until then.
+ * @param self
+ * @return Buffer with room for one block, or NULL if the chain has no sidechain
+ */
+SampleBuffer pluginChainGetSidechain(const PluginChain self);
+
+/**
+ * Set how plugins are degraded when the chain misses a deadline in realtime
+ * mode, rather than letting the output drop out. Each missed deadline degrades
+ * one more plugin, in the order of the policies, and the plugins are restored
+ * in reverse order once the chain has had enough headroom for a while. This
+ * must be called before pluginChainInitialize(), and has no effect unless the
+ * chain is realtime.
+ * @param self
+ * @param policies List of C strings, in the format that is parsed by
+ * newPluginDegradePolicy(). Names are compared as with
+ * pluginChainSetSerialLoadPlugins().
+ * @return True if all policies were valid, otherwise false, in which case the
+ * policies are unchanged
+ */
+boolByte pluginChainSetDegradePolicies(PluginChain self,
+                                       const LinkedList policies);
+
+/**
+ * Host each plugin which is added to the chain in its own child process, so
+ * that a crashing plugin does not take down the rest of the program. See
+ * newPluginIsolated() for details. This must be set before plugins are added
+ * to the chain.
+ * @param self
+ * @param hostExecutable Executable which hosts the plugins, which is copied.
+ * If empty, the current executable is used, and if NULL, plugins are loaded in
+ * this process (default).
+ */
+void pluginChainSetIsolatedHost(PluginChain self,
+                                const CharString hostExecutable);
+
+/**
+ * Check if any isolated plugin in the chain, or any of its channel instances,
+ * has crashed.
+ * @param self
+ * @return True if an isolated plugin has crashed
+ */
+boolByte pluginChainHasCrashedPlugins(PluginChain self);
+
+/**
+ * Set silence skipping for the plugin chain. When set, effect plugins whose
+ * input has been silent for longer than their tail time and initial delay are
+ * not processed, and output silence instead. Instruments are always processed.
+ * Note that plugins which do not report a tail time will then be skipped after
+ * a single block of silent input.
+ * @param self
+ * @param skipSilence True to enable silence skipping, false to disable
+ * (default)
+ */
+void pluginChainSetSkipSilence(PluginChain self, boolByte skipSilence);
+
+/**
+ * Set parameter automation for the first plugin in the chain, and any extra
+ * instances of it. Each change is applied to the plugin on the exact frame
+ * given by its time, by processing the plugin in several parts of a block, so
+ * that large blocks can be used without losing timing accuracy. MIDI events
+ * for the block are then held back by pluginChainProcessMidi(), and sent to
+ * the plugin with the part which they fall in. When the chain is pipelined or
+ * starts with a split, the changes are applied at the start of the block
+ * instead. Changes which fall within a few frames of each other are applied
+ * together. The automation starts over when the chain is reset.
+ * @param self
+ * @param automation Automation to apply, which must stay valid until the chain
+ * is freed, or NULL to disable automation
+ */
+void pluginChainSetAutomation(PluginChain self, PluginAutomation automation);
+
+/**
+ * Apply parameter and preset changes from a control queue while the chain is
+ * processing. The queue is emptied at the start of each block, before any
+ * plugin processes it, so every plugin sees each change at a block boundary.
+ * @param self
+ * @param control Queue to apply changes from, which must stay valid until it
+ * is replaced or the chain is freed, or NULL to stop applying changes
+ */
+void pluginChainSetControl(PluginChain self, PluginControl control);
+
+/**
+ * @param self
+ * @return Queue set with pluginChainSetControl(), or NULL if there is none
+ */
+PluginControl pluginChainGetControl(const PluginChain self);
+
+/**
+ * Play MIDI sequences by mixing renders of their notes, instead of sending
+ * the events to the instrument. Each unique note is rendered once in
+ * isolation, so rendering many sequences through the same instrument gets
+ * much faster when they share notes, like drum parts do. See NoteRenderCache
+ * for which instruments this works with. The renders are cleared whenever the
+ * parameters of the chain are set.
+ * @param self
+ * @param maxSize Maximum total size of the renders, in bytes, or 0 to disable
+ * note renders
+ */
+void pluginChainSetNoteRenderCache(PluginChain self, size_t maxSize);
+
+/**
+ * Get the note renders ready for playing a sequence, rendering any notes which
+ * are not cached yet. The first time renders are used, they are compared to
+ * playing the start of the sequence through the chain, and if the two differ
+ * then note renders are disabled for the chain. Afterwards, the chain and the
+ * audio clock are reset.
+ * @param self
+ * @param midiSequence Sequence which is about to be played. A streamed sequence
+ * is read in full, see midiSequenceReadAll().
+ * @param threshold Largest sample value which counts as silence. Renders are
+ * cut after their last louder sample, and may differ from playing the sequence
+ * directly by this much.
+ * @return True if the sequence should be played with
+ * pluginChainMixNoteRenders(), false to process it as usual. This is false
+ * when note renders are disabled, the chain is automated or realtime or does
+ * not render deterministically, or the sequence cannot be played with note
+ * renders.
+ */
+boolByte pluginChainPrepareNoteRenders(PluginChain self,
+                                       MidiSequence midiSequence,
+                                       Sample threshold);
+
+/**
+ * Combine a capability of all plugins in the chain, see pluginGetCapability().
+ * @param self
+ * @param capability Capability to look up
+ * @return PLUGIN_CAPABILITY_UNSUPPORTED if any plugin lacks the capability,
+ * PLUGIN_CAPABILITY_SUPPORTED if all plugins have it, otherwise
+ * PLUGIN_CAPABILITY_UNKNOWN
+ */
+PluginCapabilityState pluginChainGetCapability(const PluginChain self,
+                                               PluginCapability capability);
+
+/**
+ * Mix the note renders for one block of the sequence which was passed to
+ * pluginChainPrepareNoteRenders(). This takes the place of processing the
+ * block with pluginChainProcessAudio(), including after the end of the
+ * sequence.
+ * @param self
+ * @param outBuffer Output sample block
+ * @param frame Frame of the sequence at which the block starts
+ */
+void pluginChainMixNoteRenders(PluginChain self, SampleBuffer outBuffer,
+                               unsigned long frame);
+
+/**
+ * Find out if the chain only scales its input by a constant, which is the case
+ * when it only consists of internal passthru, gain and silence plugins, and at
+ * most one of the gain plugins changes the level. Such a chain can be replaced
+ * by scaling the samples directly with the same rounding. This must be called
+ * after the chain is initialized and its parameters have been set.
+ * @param self
+ * @param outGain Set to the gain of the chain
+ * @return True if the chain is linear and has no latency
+ */
+boolByte pluginChainGetLinearGain(PluginChain self, Sample *outGain);
+
 /**
  * Prepare each plugin in the chain for processing. This should be called before
  * the first block of audio is sent to the chain.
@@ -138,6 +713,56 @@ void pluginChainSetRealtime(PluginChain self, boolByte realtime);
  */
 void pluginChainPrepareForProcessing(PluginChain self);
 
+/**
+ * Reset the processing state of each plugin in the chain, so that the chain can
+ * be reused for another input source without being reloaded. Plugins are
+ * suspended and then resumed, which should flush any internal buffers (delay
+ * lines, reverb tails, etc.) while keeping parameters and presets intact.
+ * Since the plugins are suspended in between, the chain also picks up any
+ * changes to the global sample rate and blocksize without being reloaded.
+ * Buffers and split threads are kept if the blocksize has not changed, so that
+ * resetting between many short inputs is cheap.
+ * @param self
+ */
+void pluginChainReset(PluginChain self);
+
+/**
+ * Clear the timers and latency histograms of the chain and its plugins, so
+ * that blocks which were processed before, such as a warmup, are not part of
+ * the statistics.
+ * @param self
+ */
+void pluginChainResetTimers(PluginChain self);
+
+/**
+ * Called by the plugin hosts when a plugin calls back into the host, so that
+ * the time spent there can be told apart from the plugin's own processing.
+ * Must be paired with pluginChainExitHostCallback() on the same thread.
+ * @return Time at which the callback started, to be passed to
+ * pluginChainExitHostCallback()
+ */
+uint64_t pluginChainEnterHostCallback(void);
+
+/**
+ * Called by the plugin hosts when a call back into the host has finished. The
+ * time is added to the plugin which is being processed on the calling thread.
+ * @param enterTimeInNs Value returned by pluginChainEnterHostCallback()
+ */
+void pluginChainExitHostCallback(uint64_t enterTimeInNs);
+
+/**
+ * Get all outputs which the last plugin of the chain produced for the block
+ * which was processed last. Instruments may have more outputs than the chain
+ * has channels, in which case pluginChainProcessAudio() only passes the first
+ * ones on to its output buffer. While a pipelined chain is still filling up,
+ * this is the chain's own output buffer, which is silent.
+ * @param self
+ * @return Output buffer of the last plugin, or NULL if no block has been
+ * processed yet. The buffer is owned by the chain, and is only valid until the
+ * next block is processed.
+ */
+SampleBuffer pluginChainGetLastOutputs(const PluginChain self);
+
 /**
  * Process a single block of samples through each plugin in the chain.
  * @param self
@@ -0,0 +1,105 @@
+//
+// PluginChainPool.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PluginChainPool.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+
+PluginChainPool newPluginChainPool(unsigned int maxEntries) {
+  PluginChainPool self =
+      (PluginChainPool)malloc(sizeof(PluginChainPoolMembers));
+
+  self->maxEntries = maxEntries > 0 ? maxEntries : 1;
+  self->entries = (PluginChainPoolEntry *)malloc(sizeof(PluginChainPoolEntry) *
+                                                 self->maxEntries);
+  self->numEntries = 0;
+  self->_useCounter = 0;
+
+  return self;
+}
+
+static void _freePluginChainPoolEntry(PluginChainPoolEntry entry) {
+  logInfo("Closing plugin chain '%s'", entry->signature->data);
+  pluginChainShutdown(entry->pluginChain);
+  freePluginChain(entry->pluginChain);
+  freeCharString(entry->signature);
+  free(entry);
+}
+
+PluginChain pluginChainPoolGet(PluginChainPool self,
+                               const CharString signature) {
+  unsigned int i;
+
+  for (i = 0; i < self->numEntries; i++) {
+    if (charStringIsEqualTo(self->entries[i]->signature, signature, false)) {
+      self->entries[i]->lastUsed = ++self->_useCounter;
+      return self->entries[i]->pluginChain;
+    }
+  }
+
+  return NULL;
+}
+
+void pluginChainPoolAdd(PluginChainPool self, const CharString signature,
+                        PluginChain pluginChain) {
+  PluginChainPoolEntry entry;
+  unsigned int oldest = 0;
+  unsigned int i;
+
+  if (self->numEntries == self->maxEntries) {
+    for (i = 1; i < self->numEntries; i++) {
+      if (self->entries[i]->lastUsed < self->entries[oldest]->lastUsed) {
+        oldest = i;
+      }
+    }
+
+    _freePluginChainPoolEntry(self->entries[oldest]);
+    self->entries[oldest] = self->entries[self->numEntries - 1];
+    self->numEntries--;
+  }
+
+  entry = (PluginChainPoolEntry)malloc(sizeof(PluginChainPoolEntryMembers));
+  entry->signature = newCharStringWithCapacity(signature->capacity);
+  charStringCopy(entry->signature, signature);
+  entry->pluginChain = pluginChain;
+  entry->lastUsed = ++self->_useCounter;
+  self->entries[self->numEntries++] = entry;
+}
+
+void freePluginChainPool(PluginChainPool self) {
+  unsigned int i;
+
+  if (self != NULL) {
+    for (i = 0; i < self->numEntries; i++) {
+      _freePluginChainPoolEntry(self->entries[i]);
+    }
+
+    free(self->entries);
+    free(self);
+  }
+}
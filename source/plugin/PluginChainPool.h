@@ -0,0 +1,91 @@
+//
+// PluginChainPool.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_PluginChainPool_h
+#define MrsWatson_PluginChainPool_h
+
+#include "base/CharString.h"
+#include "plugin/PluginChain.h"
+
+typedef struct {
+  CharString signature;
+  PluginChain pluginChain;
+  unsigned long lastUsed;
+} PluginChainPoolEntryMembers;
+typedef PluginChainPoolEntryMembers *PluginChainPoolEntry;
+
+/**
+ * Set of initialized plugin chains which are kept open between jobs, so that
+ * plugins do not need to be loaded again when the same chain is requested.
+ * Chains are keyed by a signature string, which is normally the chain string
+ * that was used to build them. When the pool is full, the chain which was
+ * least recently used is shut down to make room for a new one.
+ */
+typedef struct {
+  PluginChainPoolEntry *entries;
+  unsigned int numEntries;
+  unsigned int maxEntries;
+
+  // Private fields
+  unsigned long _useCounter;
+} PluginChainPoolMembers;
+typedef PluginChainPoolMembers *PluginChainPool;
+
+/**
+ * Create a new pool of plugin chains
+ * @param maxEntries Maximum number of chains to keep open, must be at least 1
+ * @return New pool
+ */
+PluginChainPool newPluginChainPool(unsigned int maxEntries);
+
+/**
+ * Look up a chain in the pool, and mark it as recently used.
+ * @param self
+ * @param signature Signature which was given when the chain was added
+ * @return Chain with the given signature, or NULL if it is not in the pool
+ */
+PluginChain pluginChainPoolGet(PluginChainPool self,
+                               const CharString signature);
+
+/**
+ * Add an initialized chain to the pool. The pool takes ownership of the chain,
+ * and will shut it down and free it once it is evicted or the pool is freed.
+ * If the pool is full, then the least recently used chain is evicted first.
+ * @param self
+ * @param signature Signature to look the chain up with, which must not already
+ * be in the pool
+ * @param pluginChain Chain to add
+ */
+void pluginChainPoolAdd(PluginChainPool self, const CharString signature,
+                        PluginChain pluginChain);
+
+/**
+ * Shut down and free all chains in the pool, and then the pool itself
+ * @param self
+ */
+void freePluginChainPool(PluginChainPool self);
+
+#endif
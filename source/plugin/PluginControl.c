@@ -0,0 +1,259 @@
+//
+// PluginControl.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "PluginControl.h"
+
+#include "base/Thread.h"
+#include "logging/EventLogger.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+PluginControl newPluginControl(unsigned int maxPendingCommands) {
+  PluginControl self = (PluginControl)malloc(sizeof(PluginControlMembers));
+
+  self->numApplied = 0;
+  self->numFailed = 0;
+  self->_commands = newRingBufferMultiProducer(sizeof(PluginControlCommand),
+                                              maxPendingCommands);
+  // Each preset comes back once, and the control thread empties this ring
+  // before queueing any further presets, so it can never fill up
+  self->_finished =
+      newRingBuffer(sizeof(PluginPreset), self->_commands->numBlocks * 2);
+  return self;
+}
+
+static void _pluginControlFreeFinishedPresets(PluginControl self) {
+  PluginPreset preset;
+
+  while (ringBufferPop(self->_finished, &preset)) {
+    freePluginPreset(preset);
+  }
+}
+
+static boolByte _pluginControlPush(PluginControl self,
+                                   const PluginControlCommand *command) {
+  if (!ringBufferPush(self->_commands, command)) {
+    logWarn("Too many plugin changes are waiting to be applied");
+    return false;
+  }
+
+  return true;
+}
+
+boolByte pluginControlSetParameter(PluginControl self, unsigned int pluginIndex,
+                                   unsigned int parameterIndex, float value) {
+  PluginControlCommand command;
+
+  memset(&command, 0, sizeof(PluginControlCommand));
+  command.type = PLUGIN_CONTROL_SET_PARAMETER;
+  command.pluginIndex = pluginIndex;
+  command.parameterIndex = parameterIndex;
+  command.value = value;
+  return _pluginControlPush(self, &command);
+}
+
+boolByte pluginControlLoadPreset(PluginControl self, unsigned int pluginIndex,
+                                 PluginPreset preset) {
+  PluginControlCommand command;
+
+  if (!preset->openPreset(preset)) {
+    logError("Could not open preset '%s'", preset->presetName->data);
+    freePluginPreset(preset);
+    return false;
+  }
+
+  _pluginControlFreeFinishedPresets(self);
+  memset(&command, 0, sizeof(PluginControlCommand));
+  command.type = PLUGIN_CONTROL_LOAD_PRESET;
+  command.pluginIndex = pluginIndex;
+  command.preset = preset;
+
+  if (!_pluginControlPush(self, &command)) {
+    freePluginPreset(preset);
+    return false;
+  }
+
+  return true;
+}
+
+// Parse a number which is followed by whitespace or the end of the line, and
+// return a pointer to the next word, or NULL if the number is invalid
+static const char *_pluginControlParseIndex(const char *text,
+                                            unsigned int *outIndex) {
+  char *end;
+  unsigned long index = strtoul(text, &end, 10);
+
+  if (end == text || !isdigit((unsigned char)*text) ||
+      (*end != '\0' && !isspace((unsigned char)*end))) {
+    return NULL;
+  }
+
+  *outIndex = (unsigned int)index;
+
+  while (isspace((unsigned char)*end)) {
+    end++;
+  }
+
+  return end;
+}
+
+static boolByte _pluginControlReplyError(CharString outReply,
+                                         const char *message) {
+  snprintf(outReply->data, outReply->capacity, "ERROR\t%s", message);
+  return false;
+}
+
+static boolByte _pluginControlHandleParameter(PluginControl self,
+                                              const char *arguments,
+                                              CharString outReply) {
+  unsigned int pluginIndex;
+  unsigned int parameterIndex;
+  char *end;
+  float value;
+
+  arguments = _pluginControlParseIndex(arguments, &pluginIndex);
+
+  if (arguments != NULL) {
+    arguments = _pluginControlParseIndex(arguments, &parameterIndex);
+  }
+
+  if (arguments == NULL) {
+    return _pluginControlReplyError(outReply, "Invalid plugin or parameter");
+  }
+
+  value = (float)strtod(arguments, &end);
+
+  if (end == arguments || *end != '\0') {
+    return _pluginControlReplyError(outReply, "Invalid parameter value");
+  }
+
+  if (!pluginControlSetParameter(self, pluginIndex, parameterIndex, value)) {
+    return _pluginControlReplyError(outReply, "Too many pending changes");
+  }
+
+  charStringCopyCString(outReply, "OK");
+  return true;
+}
+
+static boolByte _pluginControlHandlePreset(PluginControl self,
+                                           const char *arguments,
+                                           CharString outReply) {
+  CharString presetName;
+  PluginPreset preset;
+  unsigned int pluginIndex;
+
+  arguments = _pluginControlParseIndex(arguments, &pluginIndex);
+
+  if (arguments == NULL || *arguments == '\0') {
+    return _pluginControlReplyError(outReply, "Invalid plugin or preset");
+  }
+
+  presetName = newCharStringWithCapacity(strlen(arguments) + 1);
+  charStringCopyCString(presetName, arguments);
+  preset = pluginPresetFactory(presetName);
+  freeCharString(presetName);
+
+  if (preset == NULL) {
+    return _pluginControlReplyError(outReply, "Unknown preset type");
+  }
+
+  if (!pluginControlLoadPreset(self, pluginIndex, preset)) {
+    return _pluginControlReplyError(outReply,
+                                    "Preset could not be opened or queued");
+  }
+
+  charStringCopyCString(outReply, "OK");
+  return true;
+}
+
+boolByte pluginControlHandleLine(PluginControl self, const CharString line,
+                                 CharString outReply) {
+  const char *command = line->data;
+  const char *arguments;
+  size_t commandLength;
+
+  while (isspace((unsigned char)*command)) {
+    command++;
+  }
+
+  commandLength = strcspn(command, " \t");
+  arguments = command + commandLength;
+
+  while (isspace((unsigned char)*arguments)) {
+    arguments++;
+  }
+
+  if (commandLength == strlen("parameter") &&
+      !strncmp(command, "parameter", commandLength)) {
+    return _pluginControlHandleParameter(self, arguments, outReply);
+  } else if (commandLength == strlen("preset") &&
+             !strncmp(command, "preset", commandLength)) {
+    return _pluginControlHandlePreset(self, arguments, outReply);
+  } else if (commandLength == strlen("status") &&
+             !strncmp(command, "status", commandLength)) {
+    _pluginControlFreeFinishedPresets(self);
+    snprintf(outReply->data, outReply->capacity, "OK\t%u\t%u\t%u",
+             atomicLoad(&self->numApplied), atomicLoad(&self->numFailed),
+             ringBufferGetNumReadable(self->_commands));
+    return true;
+  }
+
+  return _pluginControlReplyError(outReply, "Unknown command");
+}
+
+boolByte pluginControlNextCommand(PluginControl self,
+                                  PluginControlCommand *outCommand) {
+  return ringBufferPop(self->_commands, outCommand);
+}
+
+void pluginControlFinishCommand(PluginControl self,
+                                const PluginControlCommand *command,
+                                boolByte succeeded) {
+  atomicAdd(succeeded ? &self->numApplied : &self->numFailed, 1);
+
+  // Freeing the preset could block on the allocator, so that is left to the
+  // control thread
+  if (command->preset != NULL) {
+    ringBufferPush(self->_finished, &command->preset);
+  }
+}
+
+void freePluginControl(PluginControl self) {
+  PluginControlCommand command;
+
+  if (self != NULL) {
+    while (ringBufferPop(self->_commands, &command)) {
+      freePluginPreset(command.preset);
+    }
+
+    _pluginControlFreeFinishedPresets(self);
+    freeRingBuffer(self->_commands);
+    freeRingBuffer(self->_finished);
+    free(self);
+  }
+}
@@ -0,0 +1,150 @@
+//
+// PluginControl.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_PluginControl_h
+#define MrsWatson_PluginControl_h
+
+#include "base/CharString.h"
+#include "base/RingBuffer.h"
+#include "base/Types.h"
+#include "plugin/PluginPreset.h"
+
+typedef enum {
+  PLUGIN_CONTROL_SET_PARAMETER,
+  PLUGIN_CONTROL_LOAD_PRESET,
+  NUM_PLUGIN_CONTROL_TYPES
+} PluginControlType;
+
+typedef struct {
+  PluginControlType type;
+  // Index of the plugin in the chain
+  unsigned int pluginIndex;
+  // Only used by PLUGIN_CONTROL_SET_PARAMETER
+  unsigned int parameterIndex;
+  float value;
+  // Only used by PLUGIN_CONTROL_LOAD_PRESET, already opened
+  PluginPreset preset;
+} PluginControlCommand;
+
+/**
+ * Queue of parameter and preset changes for a plugin chain which is already
+ * processing audio. Parameter changes may be sent by any thread, presets are
+ * sent by a single control thread, and all changes are applied by the
+ * processing thread between two blocks, see pluginChainSetControl().
+ *
+ * Neither side ever waits for the other. Presets are opened by the control
+ * thread, so that the processing thread only passes the data to the plugin,
+ * and the processing thread hands them back to the control thread to be freed.
+ */
+typedef struct {
+  // Number of changes which were applied, or which could not be applied
+  volatile unsigned int numApplied;
+  volatile unsigned int numFailed;
+
+  // Private fields
+  RingBuffer _commands;
+  // Presets which the processing thread is done with
+  RingBuffer _finished;
+} PluginControlMembers;
+typedef PluginControlMembers *PluginControl;
+
+/**
+ * Create a new control queue
+ * @param maxPendingCommands Number of changes which can wait to be applied
+ * @return New control queue
+ */
+PluginControl newPluginControl(unsigned int maxPendingCommands);
+
+/**
+ * Queue a parameter change. May be called by any thread, for example a plugin
+ * editor's thread, at the same time as the control thread.
+ * @param self
+ * @param pluginIndex Index of the plugin in the chain
+ * @param parameterIndex Index of the parameter
+ * @param value New parameter value
+ * @return False if too many changes are already waiting
+ */
+boolByte pluginControlSetParameter(PluginControl self, unsigned int pluginIndex,
+                                   unsigned int parameterIndex, float value);
+
+/**
+ * Open a preset and queue it to be loaded into a plugin. Called by the control
+ * thread, which also does all file access for the preset.
+ * @param self
+ * @param pluginIndex Index of the plugin in the chain
+ * @param preset Preset to load, which this function takes ownership of
+ * @return False if the preset could not be opened or too many changes are
+ * already waiting, in which case the preset is freed
+ */
+boolByte pluginControlLoadPreset(PluginControl self, unsigned int pluginIndex,
+                                 PluginPreset preset);
+
+/**
+ * Handle one line of the text control protocol, which has these commands:
+ *
+ * parameter <plugin> <index> <value>
+ * preset <plugin> <preset name>
+ * status
+ *
+ * Plugins are given by their index in the chain, starting with 0. The reply
+ * is "OK" once a change is queued, "OK<TAB><applied><TAB><failed><TAB>
+ * <pending>" for the status command, or "ERROR<TAB><message>".
+ * @param self
+ * @param line Command line
+ * @param outReply String to store the reply in
+ * @return True if the command was accepted
+ */
+boolByte pluginControlHandleLine(PluginControl self, const CharString line,
+                                 CharString outReply);
+
+/**
+ * Take the next change from the queue. Called by the processing thread, and
+ * each command must be passed to pluginControlFinishCommand() afterwards.
+ * @param self
+ * @param outCommand Command to fill in
+ * @return False if no changes are waiting
+ */
+boolByte pluginControlNextCommand(PluginControl self,
+                                  PluginControlCommand *outCommand);
+
+/**
+ * Count a change which was applied, and hand its preset back to the control
+ * thread. Called by the processing thread.
+ * @param self
+ * @param command Command returned by pluginControlNextCommand()
+ * @param succeeded True if the change was applied
+ */
+void pluginControlFinishCommand(PluginControl self,
+                                const PluginControlCommand *command,
+                                boolByte succeeded);
+
+/**
+ * Free a control queue and all presets in it. The processing thread must no
+ * longer use it.
+ * @param self
+ */
+void freePluginControl(PluginControl self);
+
+#endif
@@ -0,0 +1,571 @@
+//
+// PluginConvolver.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "PluginConvolver.h"
+
+#include "audio/AudioSettings.h"
+#include "audio/Resampler.h"
+#include "logging/EventLogger.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *kInternalPluginConvolverName = INTERNAL_PLUGIN_PREFIX "convolver";
+
+// Fewer partitions than this per thread are not worth handing off
+static const unsigned int kConvolverMinPartitionsPerThread = 4;
+
+static SampleCount _getPartitionSize(void) {
+  SampleCount size = CONVOLVER_MIN_PARTITION_SIZE;
+
+  while (size < getBlocksize()) {
+    size *= 2;
+  }
+
+  return size;
+}
+
+static void _freeFloatArrays(float **arrays, ChannelCount numArrays) {
+  ChannelCount i;
+
+  if (arrays != NULL) {
+    for (i = 0; i < numArrays; i++) {
+      free(arrays[i]);
+    }
+
+    free(arrays);
+  }
+}
+
+static float **_newFloatArrays(ChannelCount numArrays, size_t size) {
+  float **arrays = (float **)malloc(sizeof(float *) * numArrays);
+  ChannelCount i;
+
+  for (i = 0; i < numArrays; i++) {
+    arrays[i] = (float *)calloc(size, sizeof(float));
+  }
+
+  return arrays;
+}
+
+static void _freeConvolverState(PluginConvolverSettings settings) {
+  unsigned int i;
+
+  if (settings->threadPool != NULL) {
+    freeThreadPool(settings->threadPool);
+    freeThreadPoolGroup(settings->threadGroup);
+  }
+
+  for (i = 0; i < settings->numTasks; i++) {
+    free(settings->tasks[i].sumReal);
+    free(settings->tasks[i].sumImag);
+  }
+
+  free(settings->tasks);
+  freeFft(settings->fft);
+  _freeFloatArrays(settings->impulseReal, settings->numImpulseChannels);
+  _freeFloatArrays(settings->impulseImag, settings->numImpulseChannels);
+  _freeFloatArrays(settings->inputReal, settings->numChannels);
+  _freeFloatArrays(settings->inputImag, settings->numChannels);
+  _freeFloatArrays(settings->inputBuffers, settings->numChannels);
+  _freeFloatArrays(settings->outputBuffers, settings->numChannels);
+  free(settings->sumReal);
+  free(settings->sumImag);
+  free(settings->scratch);
+
+  settings->threadPool = NULL;
+  settings->threadGroup = NULL;
+  settings->tasks = NULL;
+  settings->numTasks = 0;
+  settings->fft = NULL;
+  settings->impulseReal = NULL;
+  settings->impulseImag = NULL;
+  settings->numImpulseChannels = 0;
+  settings->inputReal = NULL;
+  settings->inputImag = NULL;
+  settings->inputBuffers = NULL;
+  settings->outputBuffers = NULL;
+  settings->numChannels = 0;
+  settings->sumReal = NULL;
+  settings->sumImag = NULL;
+  settings->scratch = NULL;
+  settings->prepared = false;
+}
+
+// Convert the impulse response to the sample rate of the render. A unit
+// impulse is used when no impulse response was loaded.
+static SampleBuffer _getRenderImpulse(PluginConvolverSettings settings) {
+  SampleBuffer result;
+  Resampler resampler;
+  SampleCount numFrames;
+
+  if (settings->impulse == NULL) {
+    result = newSampleBuffer(1, 1);
+    result->samples[0][0] = 1.0f;
+    return result;
+  } else if (settings->impulseSampleRate == getSampleRate() ||
+             (resampler = newResampler(
+                  settings->impulse->numChannels, settings->impulseSampleRate,
+                  getSampleRate(), RESAMPLER_QUALITY_HIGH)) == NULL) {
+    if (settings->impulseSampleRate != getSampleRate()) {
+      logWarn("Could not convert impulse response from %.0fHz to %.0fHz",
+              settings->impulseSampleRate, getSampleRate());
+    }
+
+    result = newSampleBuffer(settings->impulse->numChannels,
+                             settings->impulse->blocksize);
+    sampleBufferCopyAndMapChannels(result, settings->impulse);
+    return result;
+  }
+
+  numFrames = (SampleCount)ceil((double)settings->impulse->blocksize *
+                                getSampleRate() / settings->impulseSampleRate);
+  result = newSampleBuffer(settings->impulse->numChannels,
+                           numFrames > 0 ? numFrames : 1);
+  resamplerPush(resampler, settings->impulse);
+  resamplerFinish(resampler);
+  numFrames = 0;
+
+  while (numFrames < result->blocksize) {
+    const SampleCount pulled = resamplerPull(resampler, result, numFrames);
+
+    if (pulled == 0) {
+      break;
+    }
+
+    numFrames += pulled;
+  }
+
+  sampleBufferClearWithOffset(result, numFrames, result->blocksize - numFrames);
+  freeResampler(resampler);
+  return result;
+}
+
+// Transform each partition of the impulse response
+static void _prepareImpulse(PluginConvolverSettings settings,
+                            const SampleBuffer impulse) {
+  const SampleCount partitionSize = settings->partitionSize;
+  const size_t spectrumSize =
+      (size_t)settings->numPartitions * settings->numBins;
+  SampleCount offset, numFrames, i;
+  ChannelCount channel;
+  unsigned int partition;
+
+  settings->numImpulseChannels = impulse->numChannels;
+  settings->impulseReal =
+      _newFloatArrays(settings->numImpulseChannels, spectrumSize);
+  settings->impulseImag =
+      _newFloatArrays(settings->numImpulseChannels, spectrumSize);
+
+  for (channel = 0; channel < impulse->numChannels; channel++) {
+    for (partition = 0; partition < settings->numPartitions; partition++) {
+      offset = partition * partitionSize;
+      numFrames = impulse->blocksize - offset < partitionSize
+                      ? impulse->blocksize - offset
+                      : partitionSize;
+      memset(settings->scratch, 0, sizeof(float) * 2 * partitionSize);
+
+      for (i = 0; i < numFrames; i++) {
+        settings->scratch[i] = (float)impulse->samples[channel][offset + i];
+      }
+
+      fftForward(settings->fft, settings->scratch,
+                 settings->impulseReal[channel] +
+                     (size_t)partition * settings->numBins,
+                 settings->impulseImag[channel] +
+                     (size_t)partition * settings->numBins);
+    }
+  }
+}
+
+static void _prepareThreads(PluginConvolverSettings settings) {
+  const size_t sumSize = (size_t)settings->numChannels * settings->numBins;
+  unsigned int numTasks = settings->numThreads;
+  unsigned int i;
+
+  if (numTasks > settings->numPartitions / kConvolverMinPartitionsPerThread) {
+    numTasks = settings->numPartitions / kConvolverMinPartitionsPerThread;
+  }
+
+  if (numTasks < 2) {
+    return;
+  }
+
+  settings->threadPool = newThreadPool(numTasks - 1, false);
+
+  if (settings->threadPool == NULL) {
+    logWarn("Could not start threads for convolver, convolving serially");
+    return;
+  }
+
+  settings->threadGroup = newThreadPoolGroup();
+  settings->numTasks = numTasks;
+  settings->tasks = (PluginConvolverTask)malloc(
+      sizeof(PluginConvolverTaskMembers) * numTasks);
+
+  for (i = 0; i < numTasks; i++) {
+    settings->tasks[i].settings = settings;
+    settings->tasks[i].firstPartition = settings->numPartitions * i / numTasks;
+    settings->tasks[i].lastPartition =
+        settings->numPartitions * (i + 1) / numTasks;
+    settings->tasks[i].sumReal = (float *)malloc(sizeof(float) * sumSize);
+    settings->tasks[i].sumImag = (float *)malloc(sizeof(float) * sumSize);
+  }
+}
+
+static void _pluginConvolverPrepare(void *pluginPtr) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginConvolverSettings settings =
+      (PluginConvolverSettings)plugin->extraData;
+  SampleBuffer impulse;
+
+  _freeConvolverState(settings);
+  impulse = _getRenderImpulse(settings);
+  settings->partitionSize = _getPartitionSize();
+  settings->numPartitions =
+      (unsigned int)((impulse->blocksize + settings->partitionSize - 1) /
+                     settings->partitionSize);
+  settings->fft = newFft((unsigned int)settings->partitionSize * 2);
+  settings->numBins = fftGetNumBins(settings->fft);
+  settings->sumReal = (float *)malloc(sizeof(float) * settings->numBins);
+  settings->sumImag = (float *)malloc(sizeof(float) * settings->numBins);
+  settings->scratch =
+      (float *)malloc(sizeof(float) * 2 * settings->partitionSize);
+  _prepareImpulse(settings, impulse);
+  freeSampleBuffer(impulse);
+
+  // Extra channels are usually handled by further instances of the plugin, but
+  // a chain with more channels than instances sends them all to this one
+  settings->numChannels = getNumChannels() > 2 ? getNumChannels() : 2;
+  settings->inputReal =
+      _newFloatArrays(settings->numChannels,
+                      (size_t)settings->numPartitions * settings->numBins);
+  settings->inputImag =
+      _newFloatArrays(settings->numChannels,
+                      (size_t)settings->numPartitions * settings->numBins);
+  settings->inputBuffers =
+      _newFloatArrays(settings->numChannels, 2 * settings->partitionSize);
+  settings->outputBuffers =
+      _newFloatArrays(settings->numChannels, settings->partitionSize);
+  settings->delayLineIndex = 0;
+  settings->bufferPosition = 0;
+
+  _prepareThreads(settings);
+  settings->prepared = true;
+}
+
+// Add the products of a range of partitions of the impulse response and the
+// input spectra from that many blocks ago
+static void _convolvePartitions(PluginConvolverSettings settings,
+                                ChannelCount channel, unsigned int first,
+                                unsigned int last, float *sumReal,
+                                float *sumImag) {
+  const unsigned int numBins = settings->numBins;
+  const ChannelCount impulseChannel =
+      (ChannelCount)(channel % settings->numImpulseChannels);
+  size_t inputOffset, impulseOffset;
+  unsigned int partition;
+
+  memset(sumReal, 0, sizeof(float) * numBins);
+  memset(sumImag, 0, sizeof(float) * numBins);
+
+  for (partition = first; partition < last; partition++) {
+    inputOffset =
+        (size_t)((settings->delayLineIndex + partition) %
+                 settings->numPartitions) *
+        numBins;
+    impulseOffset = (size_t)partition * numBins;
+    fftMultiplyAccumulate(settings->inputReal[channel] + inputOffset,
+                          settings->inputImag[channel] + inputOffset,
+                          settings->impulseReal[impulseChannel] + impulseOffset,
+                          settings->impulseImag[impulseChannel] + impulseOffset,
+                          sumReal, sumImag, numBins);
+  }
+}
+
+static void _convolveTask(void *userData) {
+  PluginConvolverTask task = (PluginConvolverTask)userData;
+  PluginConvolverSettings settings = (PluginConvolverSettings)task->settings;
+  ChannelCount channel;
+
+  for (channel = 0; channel < settings->numChannels; channel++) {
+    _convolvePartitions(
+        settings, channel, task->firstPartition, task->lastPartition,
+        task->sumReal + (size_t)channel * settings->numBins,
+        task->sumImag + (size_t)channel * settings->numBins);
+  }
+}
+
+// Convolve the input buffers once they hold a whole partition of new input
+static void _processPartition(PluginConvolverSettings settings,
+                              ChannelCount numChannels) {
+  const SampleCount partitionSize = settings->partitionSize;
+  const unsigned int numBins = settings->numBins;
+  float *sumReal, *sumImag;
+  size_t inputOffset;
+  ChannelCount channel;
+  unsigned int i, bin;
+
+  // The newest spectrum replaces the oldest one in the ring
+  settings->delayLineIndex =
+      (settings->delayLineIndex + settings->numPartitions - 1) %
+      settings->numPartitions;
+  inputOffset = (size_t)settings->delayLineIndex * numBins;
+
+  for (channel = 0; channel < numChannels; channel++) {
+    fftForward(settings->fft, settings->inputBuffers[channel],
+               settings->inputReal[channel] + inputOffset,
+               settings->inputImag[channel] + inputOffset);
+    memmove(settings->inputBuffers[channel],
+            settings->inputBuffers[channel] + partitionSize,
+            sizeof(float) * partitionSize);
+  }
+
+  if (settings->numTasks > 0) {
+    for (i = 1; i < settings->numTasks; i++) {
+      threadPoolSubmit(settings->threadPool, settings->threadGroup,
+                       _convolveTask, &(settings->tasks[i]));
+    }
+
+    _convolveTask(&(settings->tasks[0]));
+    threadPoolWait(settings->threadPool, settings->threadGroup);
+  }
+
+  for (channel = 0; channel < numChannels; channel++) {
+    if (settings->numTasks > 0) {
+      sumReal = settings->tasks[0].sumReal + (size_t)channel * numBins;
+      sumImag = settings->tasks[0].sumImag + (size_t)channel * numBins;
+
+      for (i = 1; i < settings->numTasks; i++) {
+        for (bin = 0; bin < numBins; bin++) {
+          sumReal[bin] +=
+              settings->tasks[i].sumReal[(size_t)channel * numBins + bin];
+          sumImag[bin] +=
+              settings->tasks[i].sumImag[(size_t)channel * numBins + bin];
+        }
+      }
+    } else {
+      sumReal = settings->sumReal;
+      sumImag = settings->sumImag;
+      _convolvePartitions(settings, channel, 0, settings->numPartitions,
+                          sumReal, sumImag);
+    }
+
+    // Overlap-save: only the second half of the result is free of the
+    // circular wrap-around
+    fftInverse(settings->fft, sumReal, sumImag, settings->scratch);
+    memcpy(settings->outputBuffers[channel],
+           settings->scratch + partitionSize, sizeof(float) * partitionSize);
+  }
+}
+
+static void _pluginConvolverProcessAudio(void *pluginPtr, SampleBuffer inputs,
+                                         SampleBuffer outputs) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginConvolverSettings settings =
+      (PluginConvolverSettings)plugin->extraData;
+  ChannelCount numChannels = outputs->numChannels;
+  SampleCount offset, numFrames, i;
+  SampleCount position;
+  ChannelCount channel;
+  Samples input;
+  float *buffer;
+
+  if (!settings->prepared) {
+    _pluginConvolverPrepare(plugin);
+  }
+
+  if (inputs->numChannels == 0) {
+    sampleBufferClear(outputs);
+    return;
+  } else if (numChannels > settings->numChannels) {
+    logWarn("Internal convolver can only process %d channels",
+            settings->numChannels);
+    numChannels = settings->numChannels;
+    sampleBufferClear(outputs);
+  }
+
+  for (offset = 0; offset < outputs->blocksize; offset += numFrames) {
+    position = settings->bufferPosition;
+    numFrames = outputs->blocksize - offset < settings->partitionSize - position
+                    ? outputs->blocksize - offset
+                    : settings->partitionSize - position;
+
+    // All inputs are read before any output is written, so this also works
+    // when both are the same buffer
+    for (channel = 0; channel < numChannels; channel++) {
+      input = inputs->samples[channel % inputs->numChannels] + offset;
+      buffer = settings->inputBuffers[channel] + settings->partitionSize +
+               position;
+
+      for (i = 0; i < numFrames; i++) {
+        buffer[i] = (float)input[i];
+      }
+    }
+
+    for (channel = 0; channel < numChannels; channel++) {
+      buffer = settings->outputBuffers[channel] + position;
+
+      for (i = 0; i < numFrames; i++) {
+        outputs->samples[channel][offset + i] =
+            (Sample)buffer[i] * settings->gain;
+      }
+    }
+
+    settings->bufferPosition += numFrames;
+
+    if (settings->bufferPosition == settings->partitionSize) {
+      _processPartition(settings, numChannels);
+      settings->bufferPosition = 0;
+    }
+  }
+}
+
+static void _pluginConvolverEmpty(void *pluginPtr) {
+  // Nothing to do here
+}
+
+static boolByte _pluginConvolverOpen(void *pluginPtr) { return true; }
+
+static void _pluginConvolverDisplayInfo(void *pluginPtr) {
+  logInfo("Information for Internal plugin '%s'", kInternalPluginConvolverName);
+  logInfo("Type: effect, parameters: gain in dB (0), threads (1)");
+  logInfo("Description: a partitioned FFT convolver, which loads an impulse "
+          "response from an audio file given as its preset");
+}
+
+static int _pluginConvolverGetSetting(void *pluginPtr,
+                                      PluginSetting pluginSetting) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginConvolverSettings settings =
+      (PluginConvolverSettings)plugin->extraData;
+
+  switch (pluginSetting) {
+  case PLUGIN_SETTING_TAIL_TIME_IN_MS:
+    return settings->impulse == NULL
+               ? 0
+               : (int)ceil(settings->impulse->blocksize * 1000.0 /
+                           settings->impulseSampleRate);
+
+  case PLUGIN_NUM_INPUTS:
+    return 2;
+
+  case PLUGIN_NUM_OUTPUTS:
+    return 2;
+
+  case PLUGIN_INITIAL_DELAY:
+    return (int)(settings->prepared ? settings->partitionSize
+                                    : _getPartitionSize());
+
+  default:
+    return 0;
+  }
+}
+
+static void _pluginConvolverProcessMidiEvents(void *pluginPtr,
+                                              LinkedList midiEvents) {
+  // Nothing to do here
+}
+
+static boolByte _pluginConvolverSetParameter(void *pluginPtr, unsigned int i,
+                                             float value) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginConvolverSettings settings =
+      (PluginConvolverSettings)plugin->extraData;
+
+  switch (i) {
+  case PLUGIN_CONVOLVER_SETTINGS_GAIN:
+    settings->gain = powf(10.0f, value / 20.0f);
+    return true;
+
+  case PLUGIN_CONVOLVER_SETTINGS_THREADS:
+    if (value < 0.0f) {
+      logError("Number of convolver threads must not be negative");
+      return false;
+    }
+
+    // The threads are started when the plugin is next prepared
+    settings->numThreads = (unsigned int)value;
+    _freeConvolverState(settings);
+    return true;
+
+  default:
+    logError("Attempt to set invalid parameter %d on internal convolver", i);
+    return false;
+  }
+}
+
+static void _pluginConvolverFree(void *pluginDataPtr) {
+  PluginConvolverSettings settings = (PluginConvolverSettings)pluginDataPtr;
+  _freeConvolverState(settings);
+  freeSampleBuffer(settings->impulse);
+}
+
+boolByte pluginConvolverSetImpulse(Plugin self, const SampleBuffer impulse,
+                                   SampleRate sampleRate) {
+  PluginConvolverSettings settings;
+
+  if (self->processAudio != _pluginConvolverProcessAudio) {
+    logError("Impulse responses can only be loaded by '%s'",
+             kInternalPluginConvolverName);
+    return false;
+  }
+
+  settings = (PluginConvolverSettings)self->extraData;
+  freeSampleBuffer(settings->impulse);
+  settings->impulse = newSampleBuffer(impulse->numChannels, impulse->blocksize);
+  sampleBufferCopyAndMapChannels(settings->impulse, impulse);
+  settings->impulseSampleRate = sampleRate;
+  _freeConvolverState(settings);
+  return true;
+}
+
+Plugin newPluginConvolver(const CharString pluginName) {
+  Plugin plugin = _newPlugin(PLUGIN_TYPE_INTERNAL, PLUGIN_TYPE_EFFECT);
+  PluginConvolverSettings settings = (PluginConvolverSettings)malloc(
+      sizeof(PluginConvolverSettingsMembers));
+
+  charStringCopy(plugin->pluginName, pluginName);
+  charStringCopyCString(plugin->pluginLocation, "Internal");
+
+  plugin->openPlugin = _pluginConvolverOpen;
+  plugin->displayInfo = _pluginConvolverDisplayInfo;
+  plugin->getSetting = _pluginConvolverGetSetting;
+  plugin->prepareForProcessing = _pluginConvolverPrepare;
+  plugin->showEditor = _pluginConvolverEmpty;
+  plugin->processAudio = _pluginConvolverProcessAudio;
+  plugin->processMidiEvents = _pluginConvolverProcessMidiEvents;
+  plugin->setParameter = _pluginConvolverSetParameter;
+  plugin->closePlugin = _pluginConvolverEmpty;
+  plugin->freePluginData = _pluginConvolverFree;
+
+  memset(settings, 0, sizeof(PluginConvolverSettingsMembers));
+  settings->gain = 1.0f;
+  settings->prepared = false;
+
+  plugin->extraData = settings;
+  return plugin;
+}
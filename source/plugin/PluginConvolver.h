@@ -0,0 +1,134 @@
+//
+// PluginConvolver.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_PluginConvolver_h
+#define MrsWatson_PluginConvolver_h
+
+#include "audio/Fft.h"
+#include "audio/SampleBuffer.h"
+#include "base/ThreadPool.h"
+#include "plugin/Plugin.h"
+
+extern const char *kInternalPluginConvolverName;
+
+/**
+ * Smallest partition size, below which the transforms cost more than they save
+ */
+#define CONVOLVER_MIN_PARTITION_SIZE 64
+
+typedef enum {
+  PLUGIN_CONVOLVER_SETTINGS_GAIN,
+  PLUGIN_CONVOLVER_SETTINGS_THREADS,
+  PLUGIN_CONVOLVER_NUM_SETTINGS
+} PluginConvolverSettingsIndex;
+
+// Work for one thread, which convolves a range of the partitions of all
+// channels into its own spectra
+typedef struct {
+  void *settings;
+  unsigned int firstPartition;
+  unsigned int lastPartition;
+  // Sums of the partitions of each channel, numBins values per channel
+  float *sumReal;
+  float *sumImag;
+} PluginConvolverTaskMembers;
+typedef PluginConvolverTaskMembers *PluginConvolverTask;
+
+typedef struct {
+  Sample gain;
+  unsigned int numThreads;
+  // Impulse response as it was loaded, or NULL for a unit impulse
+  SampleBuffer impulse;
+  SampleRate impulseSampleRate;
+  boolByte prepared;
+
+  // Computed by prepareForProcessing from the impulse and the blocksize
+  SampleCount partitionSize;
+  unsigned int numPartitions;
+  unsigned int numBins;
+  Fft fft;
+
+  // Spectra of the zero-padded partitions of each channel of the impulse
+  // response, one partition after the other
+  ChannelCount numImpulseChannels;
+  float **impulseReal;
+  float **impulseImag;
+
+  // Channel state, allocated for numChannels channels. The spectra of the
+  // last numPartitions blocks of input are kept in a ring, and the newest one
+  // is at delayLineIndex. Each input buffer holds the previous and the current
+  // block of input, which are transformed together.
+  ChannelCount numChannels;
+  float **inputReal;
+  float **inputImag;
+  unsigned int delayLineIndex;
+  float **inputBuffers;
+  float **outputBuffers;
+  SampleCount bufferPosition;
+  // Sum of the products of all partitions when convolving serially
+  float *sumReal;
+  float *sumImag;
+  float *scratch;
+
+  // Threads which the partitions are spread across, or NULL to convolve all
+  // partitions on the processing thread
+  ThreadPool threadPool;
+  ThreadPoolGroup threadGroup;
+  PluginConvolverTask tasks;
+  unsigned int numTasks;
+} PluginConvolverSettingsMembers;
+typedef PluginConvolverSettingsMembers *PluginConvolverSettings;
+
+/**
+ * Create a convolver, which filters the audio with an impulse response, for
+ * example to simulate a room or a speaker cabinet. The impulse response is
+ * loaded as a preset from an audio file, and is converted to the sample rate
+ * of the render if needed. With a stereo impulse response, each channel is
+ * convolved with its own channel of the impulse.
+ *
+ * The impulse response is split into partitions of the blocksize, rounded up
+ * to a power of two, which are convolved with uniformly partitioned FFT
+ * convolution. This delays the output by one partition, which is reported as
+ * the plugin's initial delay.
+ *
+ * Parameters are the output gain in dB (default 0) and the number of threads
+ * to spread the partitions across (default 0, which convolves them on the
+ * processing thread).
+ * @param pluginName Name of the plugin
+ * @return New plugin instance
+ */
+Plugin newPluginConvolver(const CharString pluginName);
+
+/**
+ * Set the impulse response of a convolver
+ * @param self Convolver plugin
+ * @param impulse Impulse response, which is copied
+ * @param sampleRate Sample rate of the impulse response
+ * @return False if the plugin is not a convolver
+ */
+boolByte pluginConvolverSetImpulse(Plugin self, const SampleBuffer impulse,
+                                   SampleRate sampleRate);
+
+#endif
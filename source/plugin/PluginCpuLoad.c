@@ -0,0 +1,146 @@
+//
+// PluginCpuLoad.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "PluginCpuLoad.h"
+
+#include "audio/SampleBuffer.h"
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+
+const char *kInternalPluginCpuLoadName = INTERNAL_PLUGIN_PREFIX "cpuload";
+
+// About 4% of the time available for each frame at 44.1kHz
+static const float kCpuLoadDefaultNsPerFrame = 1000.0f;
+
+static void _pluginCpuLoadEmpty(void *pluginPtr) {
+  // Nothing to do here
+}
+
+static boolByte _pluginCpuLoadOpen(void *pluginPtr) { return true; }
+
+static void _pluginCpuLoadDisplayInfo(void *pluginPtr) {
+  logInfo("Information for Internal plugin '%s'", kInternalPluginCpuLoadName);
+  logInfo("Type: effect, parameters: nanoseconds per frame (0)");
+  logInfo("Description: passes audio through and then burns a fixed amount of "
+          "processor time for each frame");
+}
+
+static int _pluginCpuLoadGetSetting(void *pluginPtr,
+                                    PluginSetting pluginSetting) {
+  switch (pluginSetting) {
+  case PLUGIN_SETTING_TAIL_TIME_IN_MS:
+    return 0;
+
+  case PLUGIN_NUM_INPUTS:
+    return 2;
+
+  case PLUGIN_NUM_OUTPUTS:
+    return 2;
+
+  case PLUGIN_INITIAL_DELAY:
+    return 0;
+
+  default:
+    return 0;
+  }
+}
+
+static void _pluginCpuLoadProcessAudio(void *pluginPtr, SampleBuffer inputs,
+                                       SampleBuffer outputs) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginCpuLoadSettings settings = (PluginCpuLoadSettings)plugin->extraData;
+  const double loadTimeInMs =
+      settings->nsPerFrame * (double)outputs->blocksize / 1000000.0;
+
+  sampleBufferCopyAndMapChannels(outputs, inputs);
+
+  // Spinning on the clock rather than doing some arbitrary math keeps the cost
+  // the same on every processor and with every compiler
+  taskTimerStart(settings->timer);
+
+  while (taskTimerGetRunningTime(settings->timer) < loadTimeInMs) {
+    // Busy wait
+  }
+
+  taskTimerStop(settings->timer);
+}
+
+static void _pluginCpuLoadProcessMidiEvents(void *pluginPtr,
+                                            LinkedList midiEvents) {
+  // Nothing to do here
+}
+
+static boolByte _pluginCpuLoadSetParameter(void *pluginPtr, unsigned int i,
+                                           float value) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginCpuLoadSettings settings = (PluginCpuLoadSettings)plugin->extraData;
+
+  switch (i) {
+  case PLUGIN_CPU_LOAD_SETTINGS_NS_PER_FRAME:
+    if (value < 0.0f) {
+      logError("Load of internal CPU load plugin must not be negative");
+      return false;
+    }
+
+    settings->nsPerFrame = value;
+    return true;
+
+  default:
+    logError("Attempt to set invalid parameter %d on internal CPU load plugin",
+             i);
+    return false;
+  }
+}
+
+static void _pluginCpuLoadFree(void *pluginDataPtr) {
+  PluginCpuLoadSettings settings = (PluginCpuLoadSettings)pluginDataPtr;
+  freeTaskTimer(settings->timer);
+}
+
+Plugin newPluginCpuLoad(const CharString pluginName) {
+  Plugin plugin = _newPlugin(PLUGIN_TYPE_INTERNAL, PLUGIN_TYPE_EFFECT);
+  PluginCpuLoadSettings settings =
+      (PluginCpuLoadSettings)malloc(sizeof(PluginCpuLoadSettingsMembers));
+
+  charStringCopy(plugin->pluginName, pluginName);
+  charStringCopyCString(plugin->pluginLocation, "Internal");
+
+  plugin->openPlugin = _pluginCpuLoadOpen;
+  plugin->displayInfo = _pluginCpuLoadDisplayInfo;
+  plugin->getSetting = _pluginCpuLoadGetSetting;
+  plugin->prepareForProcessing = _pluginCpuLoadEmpty;
+  plugin->showEditor = _pluginCpuLoadEmpty;
+  plugin->processAudio = _pluginCpuLoadProcessAudio;
+  plugin->processMidiEvents = _pluginCpuLoadProcessMidiEvents;
+  plugin->setParameter = _pluginCpuLoadSetParameter;
+  plugin->closePlugin = _pluginCpuLoadEmpty;
+  plugin->freePluginData = _pluginCpuLoadFree;
+
+  settings->nsPerFrame = kCpuLoadDefaultNsPerFrame;
+  settings->timer = newTaskTimerWithCString("Internal", "cpuload");
+  plugin->extraData = settings;
+  return plugin;
+}
@@ -0,0 +1,48 @@
+//
+// PluginCpuLoad.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_PluginCpuLoad_h
+#define MrsWatson_PluginCpuLoad_h
+
+#include "plugin/Plugin.h"
+#include "time/TaskTimer.h"
+
+extern const char *kInternalPluginCpuLoadName;
+
+typedef enum {
+  PLUGIN_CPU_LOAD_SETTINGS_NS_PER_FRAME,
+  PLUGIN_CPU_LOAD_NUM_SETTINGS
+} PluginCpuLoadSettingsIndex;
+
+typedef struct {
+  // Time to spend in each call to process audio, for each frame of the block
+  float nsPerFrame;
+  TaskTimer timer;
+} PluginCpuLoadSettingsMembers;
+typedef PluginCpuLoadSettingsMembers *PluginCpuLoadSettings;
+
+Plugin newPluginCpuLoad(const CharString pluginName);
+
+#endif
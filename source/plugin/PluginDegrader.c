@@ -0,0 +1,248 @@
+//
+// PluginDegrader.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PluginDegrader.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char kPluginDegradeSeparator = ',';
+
+static const char *kPluginDegradeTypeNames[NUM_PLUGIN_DEGRADE_TYPES] = {
+    "bypass", "skip", "parameter"};
+
+static boolByte _parsePluginDegradeParameter(PluginDegradePolicy self,
+                                             const char *text) {
+  char *end;
+  long parameterIndex = strtol(text, &end, 10);
+
+  if (end == text || *end != kPluginDegradeSeparator || parameterIndex < 0) {
+    return false;
+  }
+
+  self->parameterIndex = (unsigned int)parameterIndex;
+  text = end + 1;
+  self->degradedValue = strtof(text, &end);
+
+  if (end == text || *end != kPluginDegradeSeparator) {
+    return false;
+  }
+
+  text = end + 1;
+  self->normalValue = strtof(text, &end);
+  return (boolByte)(end != text && *end == '\0');
+}
+
+PluginDegradePolicy newPluginDegradePolicy(const char *policyString) {
+  PluginDegradePolicy self;
+  const char *typeString = strchr(policyString, kPluginDegradeSeparator);
+  const char *arguments;
+  size_t typeLength;
+  boolByte valid;
+  int type;
+
+  if (typeString == NULL || typeString == policyString) {
+    logError("Degrade policy '%s' must start with a plugin name and a comma",
+             policyString);
+    return NULL;
+  }
+
+  typeString++;
+  arguments = strchr(typeString, kPluginDegradeSeparator);
+  typeLength = arguments != NULL ? (size_t)(arguments - typeString)
+                                 : strlen(typeString);
+
+  for (type = 0; type < NUM_PLUGIN_DEGRADE_TYPES; type++) {
+    if (strlen(kPluginDegradeTypeNames[type]) == typeLength &&
+        strncmp(kPluginDegradeTypeNames[type], typeString, typeLength) == 0) {
+      break;
+    }
+  }
+
+  if (type == NUM_PLUGIN_DEGRADE_TYPES) {
+    logError("Unknown degrade policy in '%s', expected bypass, skip, or "
+             "parameter",
+             policyString);
+    return NULL;
+  }
+
+  self = (PluginDegradePolicy)malloc(sizeof(PluginDegradePolicyMembers));
+  self->pluginName = newCharStringWithCString(policyString);
+  self->pluginName->data[typeString - 1 - policyString] = '\0';
+  self->type = (PluginDegradeType)type;
+  self->parameterIndex = 0;
+  self->degradedValue = 0.0f;
+  self->normalValue = 0.0f;
+  self->pluginIndex = 0;
+  self->degraded = false;
+  self->lastProcessingTimeInMs = 0.0;
+  self->costInMs = 0.0;
+  self->_delayLine = NULL;
+  self->_delayPosition = 0;
+
+  // Only parameter policies take arguments
+  if (self->type == PLUGIN_DEGRADE_PARAMETER) {
+    valid = (boolByte)(arguments != NULL &&
+                       _parsePluginDegradeParameter(self, arguments + 1));
+  } else {
+    valid = (boolByte)(arguments == NULL);
+  }
+
+  if (!valid) {
+    logError("Invalid arguments in degrade policy '%s'", policyString);
+    freePluginDegradePolicy(self);
+    return NULL;
+  }
+
+  return self;
+}
+
+void pluginDegradePolicyPrepare(PluginDegradePolicy self,
+                                ChannelCount numChannels,
+                                SampleCount delayFrames) {
+  freeSampleBuffer(self->_delayLine);
+  self->_delayLine = NULL;
+  self->_delayPosition = 0;
+
+  if (self->type == PLUGIN_DEGRADE_BYPASS && delayFrames > 0 &&
+      numChannels > 0) {
+    self->_delayLine = newSampleBuffer(numChannels, delayFrames);
+  }
+}
+
+void pluginDegradePolicyProcess(PluginDegradePolicy self,
+                                const SampleBuffer inputs,
+                                SampleBuffer outputs) {
+  SampleBuffer delayLine = self->_delayLine;
+  SampleCount position = self->_delayPosition;
+  ChannelCount channel;
+  SampleCount frame;
+  Sample sample;
+
+  outputs->blocksize = inputs->blocksize;
+  sampleBufferCopyAndMapChannels(outputs, inputs);
+
+  if (delayLine == NULL) {
+    return;
+  }
+
+  // Same as the delay of a parallel branch in the plugin chain
+  for (channel = 0; channel < outputs->numChannels; channel++) {
+    position = self->_delayPosition;
+
+    for (frame = 0; frame < outputs->blocksize; frame++) {
+      sample = outputs->samples[channel][frame];
+      outputs->samples[channel][frame] =
+          delayLine->samples[channel % delayLine->numChannels][position];
+      delayLine->samples[channel % delayLine->numChannels][position] = sample;
+      position = position + 1 < delayLine->blocksize ? position + 1 : 0;
+    }
+  }
+
+  self->_delayPosition = position;
+}
+
+void freePluginDegradePolicy(PluginDegradePolicy self) {
+  if (self != NULL) {
+    freeCharString(self->pluginName);
+    freeSampleBuffer(self->_delayLine);
+    free(self);
+  }
+}
+
+PluginDegrader newPluginDegrader(void) {
+  PluginDegrader self = (PluginDegrader)malloc(sizeof(PluginDegraderMembers));
+
+  self->policies = NULL;
+  self->numPolicies = 0;
+  self->numDegraded = 0;
+  self->recoverRatio = PLUGIN_DEGRADER_DEFAULT_RECOVER_RATIO;
+  self->recoverBlocks = PLUGIN_DEGRADER_DEFAULT_RECOVER_BLOCKS;
+  self->numDegradations = 0;
+  self->numRecoveries = 0;
+  self->_blocksWithHeadroom = 0;
+  return self;
+}
+
+void pluginDegraderAdd(PluginDegrader self, PluginDegradePolicy policy) {
+  self->policies = (PluginDegradePolicy *)realloc(
+      self->policies, sizeof(PluginDegradePolicy) * (self->numPolicies + 1));
+  self->policies[self->numPolicies++] = policy;
+}
+
+PluginDegradePolicy pluginDegraderUpdate(PluginDegrader self,
+                                         double blockTimeInMs,
+                                         double budgetInMs) {
+  PluginDegradePolicy policy;
+
+  if (blockTimeInMs > budgetInMs) {
+    self->_blocksWithHeadroom = 0;
+
+    if (self->numDegraded == self->numPolicies) {
+      return NULL;
+    }
+
+    policy = self->policies[self->numDegraded++];
+    policy->degraded = true;
+    policy->costInMs = policy->lastProcessingTimeInMs;
+    self->numDegradations++;
+    return policy;
+  } else if (self->numDegraded == 0) {
+    return NULL;
+  }
+
+  // Only the most recently degraded policy may be restored, since the others
+  // were already degraded when its cost was measured
+  policy = self->policies[self->numDegraded - 1];
+
+  if (blockTimeInMs + policy->costInMs > budgetInMs * self->recoverRatio) {
+    self->_blocksWithHeadroom = 0;
+    return NULL;
+  } else if (++self->_blocksWithHeadroom < self->recoverBlocks) {
+    return NULL;
+  }
+
+  self->_blocksWithHeadroom = 0;
+  self->numDegraded--;
+  policy->degraded = false;
+  self->numRecoveries++;
+  return policy;
+}
+
+void freePluginDegrader(PluginDegrader self) {
+  unsigned int i;
+
+  if (self != NULL) {
+    for (i = 0; i < self->numPolicies; i++) {
+      freePluginDegradePolicy(self->policies[i]);
+    }
+
+    free(self->policies);
+    free(self);
+  }
+}
@@ -0,0 +1,167 @@
+//
+// PluginDegrader.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_PluginDegrader_h
+#define MrsWatson_PluginDegrader_h
+
+#include "audio/SampleBuffer.h"
+#include "base/CharString.h"
+#include "base/Types.h"
+
+// Fraction of the block's budget which must be left over, even with the cost
+// of a degraded plugin added back, before that plugin is restored
+#define PLUGIN_DEGRADER_DEFAULT_RECOVER_RATIO 0.75
+// Number of consecutive blocks with enough headroom before a plugin is restored
+#define PLUGIN_DEGRADER_DEFAULT_RECOVER_BLOCKS 200
+
+typedef enum {
+  // Replace the plugin's output with its input, delayed by the plugin's
+  // latency so that the timing of the chain does not change
+  PLUGIN_DEGRADE_BYPASS,
+  // Pass the input through without any delay, for stages such as analyzers
+  // which do not change the audio
+  PLUGIN_DEGRADE_SKIP,
+  // Set a parameter to a cheaper value, such as a lower oversampling factor
+  PLUGIN_DEGRADE_PARAMETER,
+  NUM_PLUGIN_DEGRADE_TYPES
+} PluginDegradeType;
+
+/**
+ * What to do with a plugin when the chain misses a realtime deadline, and how
+ * to undo it again.
+ */
+typedef struct {
+  CharString pluginName;
+  PluginDegradeType type;
+  // Only used for PLUGIN_DEGRADE_PARAMETER
+  unsigned int parameterIndex;
+  float degradedValue;
+  float normalValue;
+
+  // Index of the plugin in the chain, which is set when the chain resolves the
+  // plugin's name
+  unsigned int pluginIndex;
+  boolByte degraded;
+  // Processing time of the plugin in the last block which it processed
+  // normally, in milliseconds
+  double lastProcessingTimeInMs;
+  // Processing time which the plugin is expected to need once it is restored
+  double costInMs;
+
+  // Private fields
+  SampleBuffer _delayLine;
+  SampleCount _delayPosition;
+} PluginDegradePolicyMembers;
+typedef PluginDegradePolicyMembers *PluginDegradePolicy;
+
+/**
+ * Parse a degrade policy, which has the form "name,bypass", "name,skip", or
+ * "name,parameter,index,degraded,normal". For example, "Oversampler,parameter,
+ * 2,0.0,0.5" sets parameter 2 of the plugin named Oversampler to 0.0 while it
+ * is degraded, and back to 0.5 when it is restored.
+ * @param policyString Policy to parse
+ * @return New policy, or NULL if the string could not be parsed
+ */
+PluginDegradePolicy newPluginDegradePolicy(const char *policyString);
+
+/**
+ * Allocate the delay line for a bypassed plugin. This must be called before
+ * the chain processes audio, since the realtime thread may not allocate.
+ * @param self
+ * @param numChannels Number of output channels of the plugin
+ * @param delayFrames Latency of the plugin, in frames
+ */
+void pluginDegradePolicyPrepare(PluginDegradePolicy self,
+                                ChannelCount numChannels,
+                                SampleCount delayFrames);
+
+/**
+ * Produce the output of a degraded plugin, by copying its input to the output
+ * and delaying it for a bypassed plugin.
+ * @param self
+ * @param inputs Input which the plugin would have processed
+ * @param outputs Buffer to write to, whose blocksize is set to the input's
+ */
+void pluginDegradePolicyProcess(PluginDegradePolicy self,
+                                const SampleBuffer inputs,
+                                SampleBuffer outputs);
+
+/**
+ * @param self
+ */
+void freePluginDegradePolicy(PluginDegradePolicy self);
+
+/**
+ * Decides which plugins of a realtime chain to degrade. Each block whose
+ * processing misses its deadline degrades the next policy, in the order that
+ * they were added. Once the chain has had enough headroom for a while to also
+ * pay for the most recently degraded plugin, that plugin is restored.
+ */
+typedef struct {
+  PluginDegradePolicy *policies;
+  unsigned int numPolicies;
+  // The first numDegraded policies are degraded
+  unsigned int numDegraded;
+  double recoverRatio;
+  unsigned long recoverBlocks;
+  unsigned long numDegradations;
+  unsigned long numRecoveries;
+
+  // Private fields
+  unsigned long _blocksWithHeadroom;
+} PluginDegraderMembers;
+typedef PluginDegraderMembers *PluginDegrader;
+
+/**
+ * @return New degrader without any policies
+ */
+PluginDegrader newPluginDegrader(void);
+
+/**
+ * Add a policy, which is degraded after all policies that were added before it
+ * @param self
+ * @param policy Policy, which is owned by the degrader
+ */
+void pluginDegraderAdd(PluginDegrader self, PluginDegradePolicy policy);
+
+/**
+ * Check the processing time of the last block, and degrade or restore a
+ * policy if needed. The caller applies the change to the chain.
+ * @param self
+ * @param blockTimeInMs Time spent processing the last block
+ * @param budgetInMs Duration of the block, which is its deadline
+ * @return Policy whose degraded flag was changed, or NULL if none was
+ */
+PluginDegradePolicy pluginDegraderUpdate(PluginDegrader self,
+                                         double blockTimeInMs,
+                                         double budgetInMs);
+
+/**
+ * @param self
+ */
+void freePluginDegrader(PluginDegrader self);
+
+#endif
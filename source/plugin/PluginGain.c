@@ -63,15 +63,7 @@ static void _pluginGainProcessAudio(void *pluginPtr, SampleBuffer inputs,
                                     SampleBuffer outputs) {
   Plugin plugin = (Plugin)pluginPtr;
   PluginGainSettings settings = (PluginGainSettings)plugin->extraData;
-  unsigned long channel, sample;
-
-  sampleBufferCopyAndMapChannels(outputs, inputs);
-
-  for (channel = 0; channel < outputs->numChannels; ++channel) {
-    for (sample = 0; sample < outputs->blocksize; ++sample) {
-      outputs->samples[channel][sample] *= settings->gain;
-    }
-  }
+  sampleBufferCopyAndMapChannelsWithGain(outputs, inputs, settings->gain);
 }
 
 static void _pluginGainProcessMidiEvents(void *pluginPtr,
@@ -0,0 +1,201 @@
+//
+// PluginIdler.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "PluginIdler.h"
+
+#include "base/Thread.h"
+#include "logging/EventLogger.h"
+#include "time/TaskTimer.h"
+
+#include <stdlib.h>
+
+// Longest time which the idle thread sleeps at once, so that it notices when
+// it is stopped even if the interval is long
+static const double kPluginIdlerMaxSleepInMs = 10.0;
+
+typedef struct {
+  void *pluginPtr;
+  PluginIdleFunc idleFunc;
+} _PluginIdlerEntry;
+
+// Guarded by _pluginIdlerMutex
+static _PluginIdlerEntry *_pluginIdlerEntries = NULL;
+static unsigned int _pluginIdlerNumEntries = 0;
+static unsigned int _pluginIdlerCapacity = 0;
+static Thread _pluginIdlerThread = NULL;
+
+// Created on first use, which is guarded by the _pluginIdlerMutexLock spin lock
+static Mutex _pluginIdlerMutex = NULL;
+static volatile unsigned int _pluginIdlerMutexLock = 0;
+static volatile unsigned int _pluginIdlerStopping = 0;
+static volatile unsigned int _pluginIdlerIntervalInUs =
+    (unsigned int)(PLUGIN_IDLER_DEFAULT_INTERVAL_IN_MS * 1000.0);
+// True on the idle thread while it calls the plugins, which already holds the
+// mutex when a plugin adds or removes itself from within its idle call
+static THREAD_LOCAL boolByte _pluginIdlerIsIdling = false;
+
+static void _pluginIdlerLock(void) {
+  if (_pluginIdlerIsIdling) {
+    return;
+  }
+
+  while (!atomicCompareAndSwap(&_pluginIdlerMutexLock, 0, 1)) {
+  }
+
+  if (_pluginIdlerMutex == NULL) {
+    _pluginIdlerMutex = newMutex();
+  }
+
+  atomicStore(&_pluginIdlerMutexLock, 0);
+  mutexLock(_pluginIdlerMutex);
+}
+
+static void _pluginIdlerUnlock(void) {
+  if (!_pluginIdlerIsIdling) {
+    mutexUnlock(_pluginIdlerMutex);
+  }
+}
+
+static void _pluginIdlerRemoveEntry(unsigned int index) {
+  _pluginIdlerNumEntries--;
+  _pluginIdlerEntries[index] = _pluginIdlerEntries[_pluginIdlerNumEntries];
+}
+
+static void _pluginIdlerSleep(void) {
+  double remainingInMs =
+      (double)atomicLoad(&_pluginIdlerIntervalInUs) / 1000.0;
+
+  while (remainingInMs > 0.0 && !atomicLoad(&_pluginIdlerStopping)) {
+    taskTimerSleep(remainingInMs < kPluginIdlerMaxSleepInMs
+                       ? remainingInMs
+                       : kPluginIdlerMaxSleepInMs);
+    remainingInMs -= kPluginIdlerMaxSleepInMs;
+  }
+}
+
+static void _pluginIdlerRun(void *userData) {
+  unsigned int i;
+
+  threadSetBackgroundPriority();
+
+  while (!atomicLoad(&_pluginIdlerStopping)) {
+    _pluginIdlerLock();
+    _pluginIdlerIsIdling = true;
+
+    for (i = 0; i < _pluginIdlerNumEntries;) {
+      if (_pluginIdlerEntries[i].idleFunc(_pluginIdlerEntries[i].pluginPtr)) {
+        i++;
+      } else {
+        _pluginIdlerRemoveEntry(i);
+      }
+    }
+
+    _pluginIdlerIsIdling = false;
+    _pluginIdlerUnlock();
+    _pluginIdlerSleep();
+  }
+}
+
+void pluginIdlerSetInterval(double intervalInMs) {
+  atomicStore(&_pluginIdlerIntervalInUs,
+              (unsigned int)(intervalInMs > 0.0 ? intervalInMs * 1000.0 : 0.0));
+}
+
+void pluginIdlerAdd(void *pluginPtr, PluginIdleFunc idleFunc) {
+  unsigned int i;
+
+  _pluginIdlerLock();
+
+  for (i = 0; i < _pluginIdlerNumEntries; i++) {
+    if (_pluginIdlerEntries[i].pluginPtr == pluginPtr) {
+      _pluginIdlerUnlock();
+      return;
+    }
+  }
+
+  if (_pluginIdlerNumEntries == _pluginIdlerCapacity) {
+    _pluginIdlerCapacity = _pluginIdlerCapacity > 0 ? _pluginIdlerCapacity * 2
+                                                    : 4;
+    _pluginIdlerEntries = (_PluginIdlerEntry *)realloc(
+        _pluginIdlerEntries, _pluginIdlerCapacity * sizeof(_PluginIdlerEntry));
+  }
+
+  _pluginIdlerEntries[_pluginIdlerNumEntries].pluginPtr = pluginPtr;
+  _pluginIdlerEntries[_pluginIdlerNumEntries].idleFunc = idleFunc;
+  _pluginIdlerNumEntries++;
+
+  if (_pluginIdlerThread == NULL) {
+    logDebug("Starting plugin idle thread");
+    _pluginIdlerThread = newThread(_pluginIdlerRun, NULL);
+  }
+
+  _pluginIdlerUnlock();
+}
+
+void pluginIdlerRemove(void *pluginPtr) {
+  unsigned int i;
+
+  _pluginIdlerLock();
+
+  for (i = 0; i < _pluginIdlerNumEntries; i++) {
+    if (_pluginIdlerEntries[i].pluginPtr == pluginPtr) {
+      _pluginIdlerRemoveEntry(i);
+      break;
+    }
+  }
+
+  _pluginIdlerUnlock();
+}
+
+unsigned int pluginIdlerGetNumPlugins(void) {
+  unsigned int result;
+
+  _pluginIdlerLock();
+  result = _pluginIdlerNumEntries;
+  _pluginIdlerUnlock();
+  return result;
+}
+
+void pluginIdlerStop(void) {
+  Thread thread;
+
+  _pluginIdlerLock();
+  thread = _pluginIdlerThread;
+  _pluginIdlerThread = NULL;
+  _pluginIdlerUnlock();
+
+  if (thread != NULL) {
+    atomicStore(&_pluginIdlerStopping, 1);
+    threadJoinAndFree(thread);
+    atomicStore(&_pluginIdlerStopping, 0);
+  }
+
+  _pluginIdlerLock();
+  free(_pluginIdlerEntries);
+  _pluginIdlerEntries = NULL;
+  _pluginIdlerNumEntries = 0;
+  _pluginIdlerCapacity = 0;
+  _pluginIdlerUnlock();
+}
@@ -0,0 +1,78 @@
+//
+// PluginIdler.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_PluginIdler_h
+#define MrsWatson_PluginIdler_h
+
+#include "base/Types.h"
+
+/**
+ * Default time between two idle calls for each plugin.
+ */
+#define PLUGIN_IDLER_DEFAULT_INTERVAL_IN_MS 50.0
+
+/**
+ * Called by the idle thread so that the plugin can do deferred work, such as
+ * streaming samples from disk, outside of the processing thread.
+ * @param pluginPtr Pointer which was passed to pluginIdlerAdd()
+ * @return True if the plugin wants to be idled again, false to stop idling it
+ */
+typedef boolByte (*PluginIdleFunc)(void *pluginPtr);
+
+/**
+ * Set the time between two idle calls. Plugins which are already being idled
+ * use the new interval after their next idle call.
+ * @param intervalInMs Interval in milliseconds
+ */
+void pluginIdlerSetInterval(double intervalInMs);
+
+/**
+ * Start idling a plugin on a low priority background thread, which is started
+ * when the first plugin is added. Adding a plugin which is already being idled
+ * does nothing. This may also be called from within an idle call.
+ * @param pluginPtr Plugin to idle, which is passed to the idle function
+ * @param idleFunc Function to call at each interval
+ */
+void pluginIdlerAdd(void *pluginPtr, PluginIdleFunc idleFunc);
+
+/**
+ * Stop idling a plugin. Once this returns, the idle function is no longer
+ * called for it, so the plugin may be freed.
+ * @param pluginPtr Plugin which was passed to pluginIdlerAdd()
+ */
+void pluginIdlerRemove(void *pluginPtr);
+
+/**
+ * @return Number of plugins which are being idled
+ */
+unsigned int pluginIdlerGetNumPlugins(void);
+
+/**
+ * Stop the idle thread, if it is running, and stop idling all plugins. No
+ * plugins may be added while this is called.
+ */
+void pluginIdlerStop(void);
+
+#endif
@@ -0,0 +1,722 @@
+//
+// PluginIndex.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PluginIndex.h"
+
+#include "base/File.h"
+#include "logging/EventLogger.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if WINDOWS
+#include <process.h>
+#define getpid _getpid
+#elif UNIX
+#include <unistd.h>
+#endif
+
+static const char *kPluginIndexHeader = "# MrsWatson plugin index v1";
+static const char kPluginIndexFieldSeparator = '\t';
+static const char kPluginIndexLocationTag = 'L';
+static const char kPluginIndexEntryTag = 'P';
+static const char kPluginIndexShellPluginTag = 'S';
+static const char kPluginIndexCapabilitiesTag = 'C';
+static const char kPluginIndexUserCapabilitiesTag = 'U';
+
+PluginIndexShellPlugin newPluginIndexShellPlugin(unsigned long id,
+                                                 const char *name) {
+  PluginIndexShellPlugin shellPlugin = (PluginIndexShellPlugin)malloc(
+      sizeof(PluginIndexShellPluginMembers));
+  shellPlugin->pluginId = newPluginVst2xIdWithId(id);
+  shellPlugin->name = newCharStringWithCString(name);
+  return shellPlugin;
+}
+
+void freePluginIndexShellPlugin(PluginIndexShellPlugin self) {
+  if (self != NULL) {
+    freePluginVst2xId(self->pluginId);
+    freeCharString(self->name);
+    free(self);
+  }
+}
+
+PluginIndexEntry newPluginIndexEntry(const char *name,
+                                     unsigned long modificationTime) {
+  PluginIndexEntry entry =
+      (PluginIndexEntry)malloc(sizeof(PluginIndexEntryMembers));
+
+  entry->name = newCharStringWithCString(name);
+  entry->modificationTime = modificationTime;
+  entry->scanned = false;
+  entry->pluginType = PLUGIN_TYPE_UNKNOWN;
+  entry->pluginId = newPluginVst2xId();
+  entry->numInputs = 0;
+  entry->numOutputs = 0;
+  entry->shellPlugins = newLinkedList();
+  entry->capabilities = newPluginCapabilities();
+
+  return entry;
+}
+
+void freePluginIndexEntry(PluginIndexEntry self) {
+  if (self != NULL) {
+    freeCharString(self->name);
+    freePluginVst2xId(self->pluginId);
+    freeLinkedListAndItems(self->shellPlugins,
+                           (LinkedListFreeItemFunc)freePluginIndexShellPlugin);
+    freePluginCapabilities(self->capabilities);
+    free(self);
+  }
+}
+
+static PluginIndexUserCapabilities
+_newPluginIndexUserCapabilities(unsigned long pluginId) {
+  PluginIndexUserCapabilities userCapabilities =
+      (PluginIndexUserCapabilities)malloc(
+          sizeof(PluginIndexUserCapabilitiesMembers));
+
+  userCapabilities->pluginId = newPluginVst2xIdWithId(pluginId);
+  userCapabilities->capabilities = newPluginCapabilities();
+
+  return userCapabilities;
+}
+
+static void _freePluginIndexUserCapabilities(void *item) {
+  PluginIndexUserCapabilities userCapabilities =
+      (PluginIndexUserCapabilities)item;
+
+  if (userCapabilities != NULL) {
+    freePluginVst2xId(userCapabilities->pluginId);
+    freePluginCapabilities(userCapabilities->capabilities);
+    free(userCapabilities);
+  }
+}
+
+static PluginIndexUserCapabilities
+_findUserCapabilities(const PluginIndex self, unsigned long pluginId) {
+  LinkedListIterator iterator;
+
+  for (iterator = self->userCapabilities; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    PluginIndexUserCapabilities userCapabilities =
+        (PluginIndexUserCapabilities)iterator->item;
+
+    if (userCapabilities != NULL &&
+        userCapabilities->pluginId->id == pluginId) {
+      return userCapabilities;
+    }
+  }
+
+  return NULL;
+}
+
+static PluginIndexLocation
+_newPluginIndexLocation(const char *path, unsigned long modificationTime) {
+  PluginIndexLocation location =
+      (PluginIndexLocation)malloc(sizeof(PluginIndexLocationMembers));
+
+  location->path = newCharStringWithCString(path);
+  location->modificationTime = modificationTime;
+  location->entries = newLinkedList();
+
+  return location;
+}
+
+static void _freePluginIndexLocation(void *item) {
+  PluginIndexLocation location = (PluginIndexLocation)item;
+
+  if (location != NULL) {
+    freeCharString(location->path);
+    freeLinkedListAndItems(location->entries,
+                           (LinkedListFreeItemFunc)freePluginIndexEntry);
+    free(location);
+  }
+}
+
+/**
+ * Check if a file name ends with the given extension, ignoring case since
+ * Windows plugins are sometimes installed as ".DLL".
+ * @return Length of the name without the extension, or 0 if it does not match
+ */
+static size_t _getNameLengthWithoutExtension(const char *name,
+                                             const char *extension) {
+  size_t nameLength = strlen(name);
+  size_t extensionLength = strlen(extension);
+  size_t i;
+
+  if (extensionLength == 0 || nameLength <= extensionLength) {
+    return 0;
+  }
+
+  for (i = 0; i < extensionLength; i++) {
+    if (tolower((unsigned char)name[nameLength - extensionLength + i]) !=
+        tolower((unsigned char)extension[i])) {
+      return 0;
+    }
+  }
+
+  return nameLength - extensionLength;
+}
+
+static PluginIndexEntry _findEntry(LinkedList entries, const char *name,
+                                   size_t nameLength) {
+  LinkedListIterator iterator;
+
+  for (iterator = entries; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    PluginIndexEntry entry = (PluginIndexEntry)iterator->item;
+
+    if (entry != NULL && strlen(entry->name->data) == nameLength &&
+        strncmp(entry->name->data, name, nameLength) == 0) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+static PluginIndexLocation _findLocation(PluginIndex self,
+                                         const CharString path) {
+  LinkedListIterator iterator;
+
+  for (iterator = self->locations; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    PluginIndexLocation location = (PluginIndexLocation)iterator->item;
+
+    if (location != NULL &&
+        charStringIsEqualTo(location->path, path, false)) {
+      return location;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Split off the next tab-separated field from a line which is being parsed.
+ * The last field on a line is the rest of the line, so that names may contain
+ * any other characters.
+ * @return Pointer to the field, or NULL if the line has no more fields
+ */
+static char *_nextField(char **cursor, boolByte isLastField) {
+  char *field = *cursor;
+  char *separator;
+
+  if (field == NULL) {
+    return NULL;
+  }
+
+  if (isLastField) {
+    *cursor = NULL;
+    return field;
+  }
+
+  separator = strchr(field, kPluginIndexFieldSeparator);
+  if (separator == NULL) {
+    *cursor = NULL;
+    return NULL;
+  }
+
+  *separator = '\0';
+  *cursor = separator + 1;
+  return field;
+}
+
+static boolByte _parseLine(PluginIndex self, CharString line,
+                           PluginIndexLocation *currentLocation,
+                           PluginIndexEntry *currentEntry) {
+  char *cursor = line->data + 2;
+  char *fields[6];
+  int i;
+
+  if (charStringIsEmpty(line)) {
+    return true;
+  } else if (line->data[1] != kPluginIndexFieldSeparator) {
+    return false;
+  }
+
+  if (line->data[0] == kPluginIndexLocationTag) {
+    fields[0] = _nextField(&cursor, false);
+    fields[1] = _nextField(&cursor, true);
+    if (fields[0] == NULL || fields[1] == NULL) {
+      return false;
+    }
+
+    *currentLocation =
+        _newPluginIndexLocation(fields[1], strtoul(fields[0], NULL, 10));
+    *currentEntry = NULL;
+    linkedListAppend(self->locations, *currentLocation);
+  } else if (line->data[0] == kPluginIndexEntryTag) {
+    for (i = 0; i < 6; i++) {
+      fields[i] = _nextField(&cursor, false);
+    }
+    if (*currentLocation == NULL || fields[5] == NULL || cursor == NULL) {
+      return false;
+    }
+
+    *currentEntry = newPluginIndexEntry(_nextField(&cursor, true),
+                                         strtoul(fields[0], NULL, 10));
+    (*currentEntry)->scanned = (boolByte)(atoi(fields[1]) != 0);
+    (*currentEntry)->pluginType = (PluginType)atoi(fields[2]);
+    freePluginVst2xId((*currentEntry)->pluginId);
+    (*currentEntry)->pluginId =
+        newPluginVst2xIdWithId(strtoul(fields[3], NULL, 10));
+    (*currentEntry)->numInputs = atoi(fields[4]);
+    (*currentEntry)->numOutputs = atoi(fields[5]);
+    linkedListAppend((*currentLocation)->entries, *currentEntry);
+  } else if (line->data[0] == kPluginIndexShellPluginTag) {
+    fields[0] = _nextField(&cursor, false);
+    fields[1] = _nextField(&cursor, true);
+    if (*currentEntry == NULL || fields[0] == NULL || fields[1] == NULL) {
+      return false;
+    }
+
+    linkedListAppend(
+        (*currentEntry)->shellPlugins,
+        newPluginIndexShellPlugin(strtoul(fields[0], NULL, 10), fields[1]));
+  } else if (line->data[0] == kPluginIndexCapabilitiesTag) {
+    fields[0] = _nextField(&cursor, true);
+    if (*currentEntry == NULL || fields[0] == NULL ||
+        !pluginCapabilitiesParse((*currentEntry)->capabilities, fields[0])) {
+      return false;
+    }
+  } else if (line->data[0] == kPluginIndexUserCapabilitiesTag) {
+    PluginIndexUserCapabilities userCapabilities;
+
+    fields[0] = _nextField(&cursor, false);
+    fields[1] = _nextField(&cursor, true);
+    if (fields[0] == NULL || fields[1] == NULL) {
+      return false;
+    }
+
+    userCapabilities =
+        _newPluginIndexUserCapabilities(strtoul(fields[0], NULL, 10));
+    linkedListAppend(self->userCapabilities, userCapabilities);
+    if (!pluginCapabilitiesParse(userCapabilities->capabilities, fields[1])) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+static void _readIndexFile(PluginIndex self) {
+  File file = newFileWithPath(self->indexFile);
+  LinkedList lines = NULL;
+  LinkedListIterator iterator;
+  PluginIndexLocation currentLocation = NULL;
+  PluginIndexEntry currentEntry = NULL;
+
+  if (file == NULL || !fileExists(file)) {
+    freeFile(file);
+    return;
+  }
+
+  lines = fileReadLines(file);
+  freeFile(file);
+  if (lines == NULL) {
+    return;
+  }
+
+  if (lines->item == NULL ||
+      !charStringIsEqualToCString((CharString)lines->item, kPluginIndexHeader,
+                                  false)) {
+    logWarn("Plugin index '%s' has an unknown format, rebuilding it",
+            self->indexFile->data);
+    self->dirty = true;
+    freeLinkedListAndItems(lines, (LinkedListFreeItemFunc)freeCharString);
+    return;
+  }
+
+  for (iterator = (LinkedListIterator)lines->nextItem; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    if (!_parseLine(self, (CharString)iterator->item, &currentLocation,
+                    &currentEntry)) {
+      logWarn("Plugin index '%s' is corrupt, rebuilding it",
+              self->indexFile->data);
+      freeLinkedListAndItems(self->locations, _freePluginIndexLocation);
+      self->locations = newLinkedList();
+      freeLinkedListAndItems(self->userCapabilities,
+                             _freePluginIndexUserCapabilities);
+      self->userCapabilities = newLinkedList();
+      self->dirty = true;
+      break;
+    }
+  }
+
+  freeLinkedListAndItems(lines, (LinkedListFreeItemFunc)freeCharString);
+}
+
+PluginIndex newPluginIndex(const CharString indexFile, const char *extension) {
+  PluginIndex index = (PluginIndex)malloc(sizeof(PluginIndexMembers));
+
+  index->indexFile = newCharStringWithCString(indexFile->data);
+  index->extension = newCharStringWithCString(extension);
+  index->locations = newLinkedList();
+  index->userCapabilities = newLinkedList();
+  index->dirty = false;
+
+  _readIndexFile(index);
+  return index;
+}
+
+static void _copyScannedInfo(PluginIndexEntry self,
+                             const PluginIndexEntry other) {
+  LinkedListIterator iterator;
+
+  self->scanned = other->scanned;
+  self->pluginType = other->pluginType;
+  freePluginVst2xId(self->pluginId);
+  self->pluginId = newPluginVst2xIdWithId(other->pluginId->id);
+  self->numInputs = other->numInputs;
+  self->numOutputs = other->numOutputs;
+  pluginCapabilitiesCopy(self->capabilities, other->capabilities);
+
+  for (iterator = other->shellPlugins; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    PluginIndexShellPlugin shellPlugin = (PluginIndexShellPlugin)iterator->item;
+
+    if (shellPlugin != NULL) {
+      linkedListAppend(self->shellPlugins,
+                       newPluginIndexShellPlugin(shellPlugin->pluginId->id,
+                                                  shellPlugin->name->data));
+    }
+  }
+}
+
+typedef struct {
+  PluginIndex index;
+  PluginIndexLocation location;
+  LinkedList oldEntries;
+} PluginIndexListContext;
+
+static void _listLocationItem(File item, const char *name, void *userData) {
+  PluginIndexListContext *context = (PluginIndexListContext *)userData;
+  size_t nameLength =
+      _getNameLengthWithoutExtension(name, context->index->extension->data);
+  CharString pluginName;
+  PluginIndexEntry entry;
+  PluginIndexEntry oldEntry;
+
+  if (nameLength == 0) {
+    return;
+  }
+
+  pluginName = newCharStringWithCapacity(nameLength + 1);
+  strncpy(pluginName->data, name, nameLength);
+  entry = newPluginIndexEntry(pluginName->data, fileGetModificationTime(item));
+  logDebug("Indexed plugin '%s'", pluginName->data);
+
+  // Keep the scanned information for plugins which have not been modified
+  // since the location was last indexed
+  oldEntry = _findEntry(context->oldEntries, pluginName->data, nameLength);
+  if (oldEntry != NULL &&
+      oldEntry->modificationTime == entry->modificationTime) {
+    _copyScannedInfo(entry, oldEntry);
+  }
+
+  linkedListAppend(context->location->entries, entry);
+  freeCharString(pluginName);
+}
+
+static void _listLocation(PluginIndex self, PluginIndexLocation location,
+                          File directory) {
+  PluginIndexListContext context;
+
+  logDebug("Indexing plugins in '%s'", location->path->data);
+  context.index = self;
+  context.location = location;
+  context.oldEntries = location->entries;
+  location->entries = newLinkedList();
+
+  fileListDirectoryForeach(directory, self->extension->data, _listLocationItem,
+                           &context);
+
+  freeLinkedListAndItems(context.oldEntries,
+                         (LinkedListFreeItemFunc)freePluginIndexEntry);
+  self->dirty = true;
+}
+
+PluginIndexLocation pluginIndexGetLocation(PluginIndex self,
+                                           const CharString path) {
+  File directory = newFileWithPath(path);
+  PluginIndexLocation location;
+  unsigned long modificationTime;
+
+  if (directory == NULL) {
+    return NULL;
+  }
+
+  // Locations are keyed on their absolute path, since relative plugin roots
+  // would otherwise depend on the current directory
+  location = _findLocation(self, directory->absolutePath);
+  if (!fileExists(directory) || directory->fileType != kFileTypeDirectory) {
+    freeFile(directory);
+    // Forget about any plugins which used to be here
+    if (location != NULL && linkedListLength(location->entries) > 0) {
+      freeLinkedListAndItems(location->entries,
+                           (LinkedListFreeItemFunc)freePluginIndexEntry);
+      location->entries = newLinkedList();
+      location->modificationTime = 0;
+      self->dirty = true;
+    }
+    return NULL;
+  }
+
+  modificationTime = fileGetModificationTime(directory);
+  if (location == NULL) {
+    location = _newPluginIndexLocation(directory->absolutePath->data,
+                                       modificationTime);
+    linkedListAppend(self->locations, location);
+    _listLocation(self, location, directory);
+  } else if (location->modificationTime != modificationTime) {
+    location->modificationTime = modificationTime;
+    _listLocation(self, location, directory);
+  }
+
+  freeFile(directory);
+  return location;
+}
+
+PluginIndexEntry pluginIndexFind(PluginIndex self, const CharString path,
+                                 const CharString pluginName) {
+  PluginIndexLocation location = pluginIndexGetLocation(self, path);
+  size_t nameLength;
+
+  if (location == NULL || charStringIsEmpty(pluginName)) {
+    return NULL;
+  }
+
+  nameLength = _getNameLengthWithoutExtension(pluginName->data,
+                                              self->extension->data);
+  if (nameLength == 0) {
+    nameLength = strlen(pluginName->data);
+  }
+
+  return _findEntry(location->entries, pluginName->data, nameLength);
+}
+
+PluginIndexShellPlugin pluginIndexEntryFindShellPlugin(
+    const PluginIndexEntry self, const char *name) {
+  LinkedListIterator iterator;
+  PluginIndexShellPlugin idMatch = NULL;
+
+  for (iterator = self->shellPlugins; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    PluginIndexShellPlugin shellPlugin = (PluginIndexShellPlugin)iterator->item;
+
+    if (shellPlugin == NULL) {
+      continue;
+    } else if (charStringIsEqualToCString(shellPlugin->name, name, true)) {
+      return shellPlugin;
+    } else if (idMatch == NULL &&
+               charStringIsEqualToCString(shellPlugin->pluginId->idString,
+                                          name, false)) {
+      idMatch = shellPlugin;
+    }
+  }
+
+  // Names are preferred, since a name may look like the ID of another plugin
+  return idMatch;
+}
+
+PluginCapabilityState pluginIndexGetCapability(const PluginIndex self,
+                                               unsigned long pluginId,
+                                               PluginCapability capability) {
+  PluginIndexUserCapabilities userCapabilities =
+      _findUserCapabilities(self, pluginId);
+  LinkedListIterator locationIterator;
+  LinkedListIterator entryIterator;
+
+  if (userCapabilities != NULL &&
+      userCapabilities->capabilities->states[capability] !=
+          PLUGIN_CAPABILITY_UNKNOWN) {
+    return userCapabilities->capabilities->states[capability];
+  }
+
+  // The same plugin may be installed in several locations, and any of them
+  // which has been probed will do
+  for (locationIterator = self->locations; locationIterator != NULL;
+       locationIterator = (LinkedListIterator)locationIterator->nextItem) {
+    PluginIndexLocation location =
+        (PluginIndexLocation)locationIterator->item;
+
+    for (entryIterator = location != NULL ? location->entries : NULL;
+         entryIterator != NULL;
+         entryIterator = (LinkedListIterator)entryIterator->nextItem) {
+      PluginIndexEntry entry = (PluginIndexEntry)entryIterator->item;
+
+      if (entry != NULL && entry->scanned && entry->pluginId->id == pluginId &&
+          entry->capabilities->states[capability] !=
+              PLUGIN_CAPABILITY_UNKNOWN) {
+        return entry->capabilities->states[capability];
+      }
+    }
+  }
+
+  return PLUGIN_CAPABILITY_UNKNOWN;
+}
+
+void pluginIndexSetUserCapability(PluginIndex self, unsigned long pluginId,
+                                  PluginCapability capability,
+                                  PluginCapabilityState state) {
+  PluginIndexUserCapabilities userCapabilities =
+      _findUserCapabilities(self, pluginId);
+
+  if (userCapabilities == NULL) {
+    userCapabilities = _newPluginIndexUserCapabilities(pluginId);
+    linkedListAppend(self->userCapabilities, userCapabilities);
+  }
+
+  userCapabilities->capabilities->states[capability] = state;
+  self->dirty = true;
+}
+
+static void _writeCapabilities(FILE *fp, const char tag, const char *prefix,
+                               const PluginCapabilities capabilities) {
+  CharString capabilitiesString;
+
+  if (pluginCapabilitiesIsEmpty(capabilities)) {
+    return;
+  }
+
+  capabilitiesString = pluginCapabilitiesToString(capabilities);
+  fprintf(fp, "%c\t%s%s\n", tag, prefix, capabilitiesString->data);
+  freeCharString(capabilitiesString);
+}
+
+static void _writeEntry(FILE *fp, const PluginIndexEntry entry) {
+  LinkedListIterator iterator;
+
+  fprintf(fp, "%c\t%lu\t%d\t%d\t%lu\t%d\t%d\t%s\n", kPluginIndexEntryTag,
+          entry->modificationTime, entry->scanned, entry->pluginType,
+          entry->pluginId->id, entry->numInputs, entry->numOutputs,
+          entry->name->data);
+  _writeCapabilities(fp, kPluginIndexCapabilitiesTag, "",
+                     entry->capabilities);
+
+  for (iterator = entry->shellPlugins; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    PluginIndexShellPlugin shellPlugin = (PluginIndexShellPlugin)iterator->item;
+
+    if (shellPlugin != NULL) {
+      fprintf(fp, "%c\t%lu\t%s\n", kPluginIndexShellPluginTag,
+              shellPlugin->pluginId->id, shellPlugin->name->data);
+    }
+  }
+}
+
+boolByte pluginIndexWrite(PluginIndex self) {
+  CharString tempFile;
+  LinkedListIterator locationIterator;
+  LinkedListIterator entryIterator;
+  LinkedListIterator userIterator;
+  char idField[32];
+  FILE *fp;
+  boolByte result;
+
+  if (!self->dirty) {
+    return true;
+  }
+
+  // Each process writes its own temporary file, so that concurrent jobs
+  // sharing the same index never see a partially written file
+  tempFile = newCharStringWithCapacity(self->indexFile->capacity + 32);
+  snprintf(tempFile->data, tempFile->capacity, "%s.%d.tmp",
+           self->indexFile->data, (int)getpid());
+  fp = fopen(tempFile->data, "w");
+  if (fp == NULL) {
+    logWarn("Could not write plugin index '%s'", tempFile->data);
+    freeCharString(tempFile);
+    return false;
+  }
+
+  fprintf(fp, "%s\n", kPluginIndexHeader);
+  // User capabilities do not belong to a location, so they come first
+  for (userIterator = self->userCapabilities; userIterator != NULL;
+       userIterator = (LinkedListIterator)userIterator->nextItem) {
+    PluginIndexUserCapabilities userCapabilities =
+        (PluginIndexUserCapabilities)userIterator->item;
+
+    if (userCapabilities != NULL) {
+      snprintf(idField, sizeof(idField), "%lu\t",
+               userCapabilities->pluginId->id);
+      _writeCapabilities(fp, kPluginIndexUserCapabilitiesTag, idField,
+                         userCapabilities->capabilities);
+    }
+  }
+
+  for (locationIterator = self->locations; locationIterator != NULL;
+       locationIterator = (LinkedListIterator)locationIterator->nextItem) {
+    PluginIndexLocation location =
+        (PluginIndexLocation)locationIterator->item;
+
+    if (location == NULL) {
+      continue;
+    }
+
+    fprintf(fp, "%c\t%lu\t%s\n", kPluginIndexLocationTag,
+            location->modificationTime, location->path->data);
+    for (entryIterator = location->entries; entryIterator != NULL;
+         entryIterator = (LinkedListIterator)entryIterator->nextItem) {
+      if (entryIterator->item != NULL) {
+        _writeEntry(fp, (PluginIndexEntry)entryIterator->item);
+      }
+    }
+  }
+
+  result = (boolByte)(fclose(fp) == 0);
+#if WINDOWS
+  // Windows cannot rename a file over an existing one
+  remove(self->indexFile->data);
+#endif
+  if (result && rename(tempFile->data, self->indexFile->data) == 0) {
+    self->dirty = false;
+  } else {
+    logWarn("Could not write plugin index '%s'", self->indexFile->data);
+    remove(tempFile->data);
+    result = false;
+  }
+
+  freeCharString(tempFile);
+  return result;
+}
+
+void freePluginIndex(PluginIndex self) {
+  if (self != NULL) {
+    freeCharString(self->indexFile);
+    freeCharString(self->extension);
+    freeLinkedListAndItems(self->locations, _freePluginIndexLocation);
+    freeLinkedListAndItems(self->userCapabilities,
+                           _freePluginIndexUserCapabilities);
+    free(self);
+  }
+}
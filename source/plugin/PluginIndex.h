@@ -0,0 +1,219 @@
+//
+// PluginIndex.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_PluginIndex_h
+#define MrsWatson_PluginIndex_h
+
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+#include "base/Types.h"
+#include "plugin/Plugin.h"
+#include "plugin/PluginCapabilities.h"
+#include "plugin/PluginVst2xId.h"
+
+typedef struct {
+  PluginVst2xId pluginId;
+  CharString name;
+} PluginIndexShellPluginMembers;
+typedef PluginIndexShellPluginMembers *PluginIndexShellPlugin;
+
+/**
+ * @param id Sub-plugin ID
+ * @param name Sub-plugin name
+ * @return New shell sub-plugin entry
+ */
+PluginIndexShellPlugin newPluginIndexShellPlugin(unsigned long id,
+                                                 const char *name);
+
+/**
+ * Release a shell sub-plugin entry.
+ * @param self
+ */
+void freePluginIndexShellPlugin(PluginIndexShellPlugin self);
+
+/**
+ * A single plugin found in an indexed location. Only the name is known after a
+ * directory has been listed. The other fields are filled in by a scanner which
+ * has loaded the plugin, and are only valid as long as the plugin file's
+ * modification time matches the one stored here.
+ */
+typedef struct {
+  /** Plugin file name, without the platform extension */
+  CharString name;
+  unsigned long modificationTime;
+
+  /** Set to true once the fields below have been filled in by a scanner */
+  boolByte scanned;
+  PluginType pluginType;
+  PluginVst2xId pluginId;
+  int numInputs;
+  int numOutputs;
+  /** List of PluginIndexShellPlugin, empty unless this is a shell plugin */
+  LinkedList shellPlugins;
+  /** Capabilities which the scanner has probed, see PluginProbe */
+  PluginCapabilities capabilities;
+} PluginIndexEntryMembers;
+typedef PluginIndexEntryMembers *PluginIndexEntry;
+
+/**
+ * @param name Plugin name, without the platform extension
+ * @param modificationTime Modification time of the plugin file
+ * @return New unscanned entry
+ */
+PluginIndexEntry newPluginIndexEntry(const char *name,
+                                     unsigned long modificationTime);
+
+/**
+ * Release an index entry and its shell sub-plugins.
+ * @param self
+ */
+void freePluginIndexEntry(PluginIndexEntry self);
+
+/**
+ * Capabilities of a plugin which were set by the user. These take precedence
+ * over the probed capabilities of every entry with the same ID, and also apply
+ * to shell sub-plugins, which are never probed.
+ */
+typedef struct {
+  PluginVst2xId pluginId;
+  PluginCapabilities capabilities;
+} PluginIndexUserCapabilitiesMembers;
+typedef PluginIndexUserCapabilitiesMembers *PluginIndexUserCapabilities;
+
+typedef struct {
+  CharString path;
+  /** Modification time of the directory when its contents were last listed */
+  unsigned long modificationTime;
+  /** List of PluginIndexEntry */
+  LinkedList entries;
+} PluginIndexLocationMembers;
+typedef PluginIndexLocationMembers *PluginIndexLocation;
+
+/**
+ * Persistent cache of the plugins found in each search location, so that
+ * resolving a plugin name does not need to search the filesystem. Each
+ * location is keyed on its path and modification time, and is only listed
+ * again when the directory has changed.
+ */
+typedef struct {
+  CharString indexFile;
+  CharString extension;
+  /** List of PluginIndexLocation */
+  LinkedList locations;
+  /** List of PluginIndexUserCapabilities */
+  LinkedList userCapabilities;
+  /** True if the index has changed since it was read from disk */
+  boolByte dirty;
+} PluginIndexMembers;
+typedef PluginIndexMembers *PluginIndex;
+
+/**
+ * Create a new plugin index and read any previously written contents from
+ * disk. If the index file does not exist or cannot be parsed, then the index
+ * starts out empty and will be rebuilt as locations are queried.
+ * @param indexFile Path to the index file
+ * @param extension Plugin file extension for this platform, including the dot
+ * @return New plugin index
+ */
+PluginIndex newPluginIndex(const CharString indexFile, const char *extension);
+
+/**
+ * Get the indexed contents of a plugin location. If the location has not been
+ * indexed yet, or if the directory has been modified since it was indexed, then
+ * it is listed again. Entries for plugins whose files have not changed keep
+ * their scanned information.
+ * @param self
+ * @param path Absolute path to the location
+ * @return Location, or NULL if the path is not a directory
+ */
+PluginIndexLocation pluginIndexGetLocation(PluginIndex self,
+                                           const CharString path);
+
+/**
+ * Find a plugin in a location by name.
+ * @param self
+ * @param path Absolute path to the location
+ * @param pluginName Plugin name, with or without the platform extension
+ * @return Matching entry, or NULL if the location has no such plugin
+ */
+PluginIndexEntry pluginIndexFind(PluginIndex self, const CharString path,
+                                 const CharString pluginName);
+
+/**
+ * Find a sub-plugin of a shell plugin, so that it can be opened without asking
+ * the shell to list all of its sub-plugins again.
+ * @param self
+ * @param name Sub-plugin name, or its four character ID
+ * @return Matching sub-plugin, or NULL if no sub-plugins of the entry are known
+ * or none of them match
+ */
+PluginIndexShellPlugin pluginIndexEntryFindShellPlugin(
+    const PluginIndexEntry self, const char *name);
+
+/**
+ * Get what is known about a capability of a plugin. A state which was set by
+ * the user is returned first, otherwise the state which was probed for any
+ * scanned entry with the same ID. Locations are not listed again to find the
+ * entries.
+ * @param self
+ * @param pluginId Unique ID of the plugin or shell sub-plugin
+ * @param capability Capability to look up
+ * @return State of the capability
+ */
+PluginCapabilityState pluginIndexGetCapability(const PluginIndex self,
+                                               unsigned long pluginId,
+                                               PluginCapability capability);
+
+/**
+ * Set a capability of a plugin by hand. Probing the plugin again does not
+ * change a capability which has been set by the user.
+ * @param self
+ * @param pluginId Unique ID of the plugin or shell sub-plugin
+ * @param capability Capability to set
+ * @param state New state, or PLUGIN_CAPABILITY_UNKNOWN to use the probed state
+ * again
+ */
+void pluginIndexSetUserCapability(PluginIndex self, unsigned long pluginId,
+                                  PluginCapability capability,
+                                  PluginCapabilityState state);
+
+/**
+ * Write the index to disk if it has changed. The index is first written to a
+ * temporary file which then replaces the index file, so that several processes
+ * may share the same index.
+ * @param self
+ * @return True if the index was written or did not need to be
+ */
+boolByte pluginIndexWrite(PluginIndex self);
+
+/**
+ * Release a plugin index and all of its locations and entries. This does not
+ * write the index to disk.
+ * @param self
+ */
+void freePluginIndex(PluginIndex self);
+
+#endif
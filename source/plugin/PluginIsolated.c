@@ -0,0 +1,768 @@
+//
+// PluginIsolated.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PluginIsolated.h"
+
+#include "audio/AudioSettings.h"
+#include "base/File.h"
+#include "base/FpuState.h"
+#include "base/Process.h"
+#include "base/SharedMemory.h"
+#include "base/Thread.h"
+#include "logging/EventLogger.h"
+#include "midi/MidiEvent.h"
+#include "plugin/PluginChain.h"
+#include "plugin/PluginVst2x.h"
+#include "time/AudioClock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if UNIX
+#include <unistd.h>
+#endif
+
+// Changed whenever the layout of the shared memory changes, so that a host
+// executable from a different build is rejected instead of misread
+#define PLUGIN_ISOLATED_MAGIC 0x4d575032
+#define PLUGIN_ISOLATED_STRING_LENGTH 1024
+#define PLUGIN_ISOLATED_MAX_CHANNELS 64
+#define PLUGIN_ISOLATED_MAX_MIDI_EVENTS 512
+// How long to wait for the other side before checking that it is still alive
+#define PLUGIN_ISOLATED_POLL_INTERVAL_IN_MS 100
+#define PLUGIN_ISOLATED_AUDIO_ALIGNMENT 64
+
+typedef enum {
+  PLUGIN_ISOLATED_COMMAND_OPEN,
+  PLUGIN_ISOLATED_COMMAND_PROCESS_AUDIO,
+  PLUGIN_ISOLATED_COMMAND_PROCESS_MIDI,
+  PLUGIN_ISOLATED_COMMAND_SET_PARAMETER,
+  PLUGIN_ISOLATED_COMMAND_PREPARE,
+  PLUGIN_ISOLATED_COMMAND_CLOSE
+} PluginIsolatedCommand;
+
+typedef struct {
+  unsigned int eventType;
+  unsigned int deltaFrames;
+  unsigned int timestamp;
+  byte status;
+  byte data1;
+  byte data2;
+  byte padding;
+} PluginIsolatedMidiEvent;
+
+// This layout is shared by processes which may have different word sizes, so
+// it only uses fixed-size types, and the doubles come first so that they are
+// aligned the same way everywhere. The audio buffers follow the header.
+typedef struct {
+  double sampleRate;
+  double tempo;
+  double currentFrame;
+  // Musical position of currentFrame, from the parent's timeline
+  double ppqPosition;
+  double barStartPosition;
+
+  // Incremented by the parent for each command
+  volatile unsigned int request;
+  // Set to the request number by the child once the command is done
+  volatile unsigned int response;
+  unsigned int magic;
+  unsigned int command;
+  unsigned int result;
+
+  unsigned int blocksize;
+  unsigned int numChannels;
+  unsigned int timeSignatureBeatsPerMeasure;
+  unsigned int timeSignatureNoteValue;
+  unsigned int isPlaying;
+  unsigned int transportChanged;
+  // Set if the parent flushes denormals while processing, so that the child
+  // does the same
+  unsigned int flushDenormals;
+  // The parent's render mode, which the child also reports to the plugin
+  unsigned int renderMode;
+  unsigned int numFrames;
+  unsigned int numInputs;
+  unsigned int numOutputs;
+  unsigned int parameterIndex;
+  float parameterValue;
+
+  unsigned int pluginType;
+  int settings[NUM_PLUGIN_SETTINGS];
+
+  unsigned int numMidiEvents;
+  PluginIsolatedMidiEvent midiEvents[PLUGIN_ISOLATED_MAX_MIDI_EVENTS];
+
+  char pluginName[PLUGIN_ISOLATED_STRING_LENGTH];
+  char pluginRoot[PLUGIN_ISOLATED_STRING_LENGTH];
+  char presetName[PLUGIN_ISOLATED_STRING_LENGTH];
+  char pluginLocation[PLUGIN_ISOLATED_STRING_LENGTH];
+  char pluginAbsolutePath[PLUGIN_ISOLATED_STRING_LENGTH];
+} PluginIsolatedHeader;
+
+typedef struct {
+  CharString pluginRoot;
+  CharString presetName;
+  CharString hostExecutable;
+  SharedMemory sharedMemory;
+  Process process;
+  boolByte crashed;
+} PluginIsolatedDataMembers;
+typedef PluginIsolatedDataMembers *PluginIsolatedData;
+
+static size_t _pluginIsolatedAudioOffset(void) {
+  return (sizeof(PluginIsolatedHeader) + PLUGIN_ISOLATED_AUDIO_ALIGNMENT - 1) &
+         ~((size_t)PLUGIN_ISOLATED_AUDIO_ALIGNMENT - 1);
+}
+
+static size_t _pluginIsolatedSize(unsigned int blocksize) {
+  return _pluginIsolatedAudioOffset() +
+         2 * PLUGIN_ISOLATED_MAX_CHANNELS * blocksize * sizeof(Sample);
+}
+
+// Input channels come first, followed by the output channels
+static Samples _pluginIsolatedChannel(PluginIsolatedHeader *header,
+                                      boolByte output, ChannelCount channel) {
+  Samples audio = (Samples)((char *)header + _pluginIsolatedAudioOffset());
+  size_t index = (size_t)channel + (output ? PLUGIN_ISOLATED_MAX_CHANNELS : 0);
+  return audio + index * header->blocksize;
+}
+
+static void _pluginIsolatedCopyString(char *destination,
+                                      const CharString source) {
+  destination[0] = '\0';
+  if (source != NULL) {
+    strncpy(destination, source->data, PLUGIN_ISOLATED_STRING_LENGTH - 1);
+    destination[PLUGIN_ISOLATED_STRING_LENGTH - 1] = '\0';
+  }
+}
+
+static boolByte _pluginIsolatedCheckAlive(Plugin plugin) {
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+
+  if (!data->crashed && processPoll(data->process)) {
+    logError("Isolated plugin '%s' exited unexpectedly with code %d, its "
+             "output will be silent",
+             plugin->pluginName->data, data->process->exitCode);
+    data->crashed = true;
+  }
+
+  return (boolByte)!data->crashed;
+}
+
+// Send a command to the child and wait until it has been handled. Returns
+// false if the child is gone, in which case the command was not handled.
+static boolByte _pluginIsolatedSendCommand(Plugin plugin,
+                                           PluginIsolatedCommand command) {
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+  PluginIsolatedHeader *header;
+  unsigned int request;
+  unsigned int response;
+
+  if (data->crashed || data->sharedMemory == NULL) {
+    return false;
+  }
+
+  header = (PluginIsolatedHeader *)data->sharedMemory->data;
+  header->command = command;
+  request = atomicAdd(&header->request, 1);
+  sharedMemoryWake(&header->request);
+
+  while ((response = atomicLoad(&header->response)) != request) {
+    if (!sharedMemoryWait(&header->response, response,
+                          PLUGIN_ISOLATED_POLL_INTERVAL_IN_MS) &&
+        !_pluginIsolatedCheckAlive(plugin)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static boolByte _pluginIsolatedOpen(void *pluginPtr) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+  PluginIsolatedHeader *header;
+  CharString executable;
+  LinkedList arguments;
+  unsigned int response;
+
+  data->sharedMemory = newSharedMemory(_pluginIsolatedSize(getBlocksize()));
+  if (data->sharedMemory == NULL) {
+    return false;
+  }
+
+  header = (PluginIsolatedHeader *)data->sharedMemory->data;
+  header->magic = PLUGIN_ISOLATED_MAGIC;
+  header->command = PLUGIN_ISOLATED_COMMAND_OPEN;
+  header->sampleRate = getSampleRate();
+  header->tempo = getTempo();
+  header->blocksize = (unsigned int)getBlocksize();
+  header->numChannels = getNumChannels();
+  header->timeSignatureBeatsPerMeasure = getTimeSignatureBeatsPerMeasure();
+  header->timeSignatureNoteValue = getTimeSignatureNoteValue();
+  header->renderMode = (unsigned int)pluginVst2xGetRenderMode();
+  _pluginIsolatedCopyString(header->pluginName, plugin->pluginName);
+  _pluginIsolatedCopyString(header->pluginRoot, data->pluginRoot);
+  _pluginIsolatedCopyString(header->presetName, data->presetName);
+  // The child answers this first request once it has opened the plugin
+  header->request = 1;
+
+  executable = charStringIsEmpty(data->hostExecutable)
+                   ? fileGetExecutablePath()
+                   : newCharStringWithCString(data->hostExecutable->data);
+  arguments = newLinkedList();
+  linkedListAppend(arguments, newCharStringWithCString("--plugin-host"));
+  linkedListAppend(arguments,
+                   newCharStringWithCString(data->sharedMemory->name->data));
+  logDebug("Starting '%s' to host plugin '%s'", executable->data,
+           plugin->pluginName->data);
+  data->process = newProcess(executable, arguments);
+  freeLinkedListAndItems(arguments, (LinkedListFreeItemFunc)freeCharString);
+  freeCharString(executable);
+
+  if (data->process == NULL) {
+    return false;
+  }
+
+  while ((response = atomicLoad(&header->response)) == 0) {
+    if (!sharedMemoryWait(&header->response, response,
+                          PLUGIN_ISOLATED_POLL_INTERVAL_IN_MS) &&
+        processPoll(data->process)) {
+      logError("Host process for plugin '%s' exited with code %d",
+               plugin->pluginName->data, data->process->exitCode);
+      return false;
+    }
+  }
+
+  // The child has mapped the memory by now, so it does not need a name which
+  // would be left behind if this process crashes
+  sharedMemoryUnlink(data->sharedMemory);
+
+  if (!header->result) {
+    logError("Plugin '%s' could not be opened in its host process",
+             plugin->pluginName->data);
+    return false;
+  }
+
+  plugin->pluginType = (PluginType)header->pluginType;
+  charStringCopyCString(plugin->pluginLocation, header->pluginLocation);
+  charStringCopyCString(plugin->pluginAbsolutePath,
+                        header->pluginAbsolutePath);
+  logInfo("Plugin '%s' is hosted in a separate process",
+          plugin->pluginName->data);
+  return true;
+}
+
+static void _pluginIsolatedDisplayInfo(void *pluginPtr) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+
+  logInfo("Information for isolated plugin '%s'", plugin->pluginName->data);
+  logInfo("Location: %s", plugin->pluginLocation->data);
+  logInfo("Type: %s, inputs: %d, outputs: %d",
+          plugin->pluginType == PLUGIN_TYPE_INSTRUMENT ? "instrument"
+                                                       : "effect",
+          plugin->getSetting(plugin, PLUGIN_NUM_INPUTS),
+          plugin->getSetting(plugin, PLUGIN_NUM_OUTPUTS));
+  logInfo("Host executable: %s", charStringIsEmpty(data->hostExecutable)
+                                     ? "(current)"
+                                     : data->hostExecutable->data);
+}
+
+static int _pluginIsolatedGetSetting(void *pluginPtr,
+                                     PluginSetting pluginSetting) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+  PluginIsolatedHeader *header;
+
+  if (data->sharedMemory == NULL || pluginSetting >= NUM_PLUGIN_SETTINGS) {
+    return 0;
+  }
+
+  // Settings do not change once the plugin has been opened
+  header = (PluginIsolatedHeader *)data->sharedMemory->data;
+  return header->settings[pluginSetting];
+}
+
+static void _pluginIsolatedProcessAudio(void *pluginPtr, SampleBuffer inputs,
+                                        SampleBuffer outputs) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+  PluginIsolatedHeader *header;
+  AudioClock audioClock = getAudioClock();
+  const ChannelCount numInputs =
+      inputs->numChannels < PLUGIN_ISOLATED_MAX_CHANNELS
+          ? inputs->numChannels
+          : PLUGIN_ISOLATED_MAX_CHANNELS;
+  const ChannelCount numOutputs =
+      outputs->numChannels < PLUGIN_ISOLATED_MAX_CHANNELS
+          ? outputs->numChannels
+          : PLUGIN_ISOLATED_MAX_CHANNELS;
+  AudioClockPositionMembers position;
+  SampleCount offset = 0;
+  SampleCount numFrames;
+  ChannelCount i;
+
+  sampleBufferClear(outputs);
+  if (data->crashed || data->sharedMemory == NULL) {
+    return;
+  }
+
+  // Blocks larger than the shared buffers are sent in several parts
+  header = (PluginIsolatedHeader *)data->sharedMemory->data;
+  while (offset < inputs->blocksize) {
+    numFrames = inputs->blocksize - offset;
+    if (numFrames > header->blocksize) {
+      numFrames = header->blocksize;
+    }
+
+    for (i = 0; i < numInputs; i++) {
+      memcpy(_pluginIsolatedChannel(header, false, i),
+             inputs->samples[i] + offset, sizeof(Sample) * numFrames);
+    }
+
+    header->numFrames = (unsigned int)numFrames;
+    header->numInputs = numInputs;
+    header->numOutputs = numOutputs;
+    header->currentFrame = (double)(audioClock->currentFrame + offset);
+    header->isPlaying = audioClock->isPlaying;
+    header->transportChanged = audioClock->transportChanged;
+    header->flushDenormals = fpuStateIsFlushingDenormals();
+    // Each part of a block gets its own position, so that the child does not
+    // need to know the timeline
+    audioClockGetPositionAtFrame(audioClock, audioClock->currentFrame + offset,
+                                 &position);
+    header->tempo = position.tempo;
+    header->timeSignatureBeatsPerMeasure =
+        position.timeSignatureBeatsPerMeasure;
+    header->timeSignatureNoteValue = position.timeSignatureNoteValue;
+    header->ppqPosition = position.ppqPosition;
+    header->barStartPosition = position.barStartPosition;
+
+    if (!_pluginIsolatedSendCommand(plugin,
+                                    PLUGIN_ISOLATED_COMMAND_PROCESS_AUDIO)) {
+      sampleBufferClear(outputs);
+      return;
+    }
+
+    for (i = 0; i < numOutputs; i++) {
+      memcpy(outputs->samples[i] + offset,
+             _pluginIsolatedChannel(header, true, i),
+             sizeof(Sample) * numFrames);
+    }
+
+    offset += numFrames;
+  }
+}
+
+static void _pluginIsolatedProcessMidiEvents(void *pluginPtr,
+                                             LinkedList midiEvents) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+  PluginIsolatedHeader *header;
+  PluginIsolatedMidiEvent *isolatedEvent;
+  LinkedListIterator iterator;
+  MidiEvent midiEvent;
+  unsigned int numEvents = 0;
+
+  if (data->crashed || data->sharedMemory == NULL) {
+    return;
+  }
+
+  header = (PluginIsolatedHeader *)data->sharedMemory->data;
+  for (iterator = midiEvents; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    midiEvent = (MidiEvent)iterator->item;
+    if (midiEvent == NULL) {
+      continue;
+    }
+
+    // Only regular events fit in the shared memory, which is also all that
+    // the plugin interfaces send to plugins
+    if (midiEvent->eventType != MIDI_TYPE_REGULAR) {
+      logDebug("Skipping non-regular MIDI event for isolated plugin");
+      continue;
+    } else if (numEvents >= PLUGIN_ISOLATED_MAX_MIDI_EVENTS) {
+      logWarn("Too many MIDI events for isolated plugin '%s', dropping some",
+              plugin->pluginName->data);
+      break;
+    }
+
+    isolatedEvent = &(header->midiEvents[numEvents++]);
+    isolatedEvent->eventType = midiEvent->eventType;
+    isolatedEvent->deltaFrames = (unsigned int)midiEvent->deltaFrames;
+    isolatedEvent->timestamp = (unsigned int)midiEvent->timestamp;
+    isolatedEvent->status = midiEvent->status;
+    isolatedEvent->data1 = midiEvent->data1;
+    isolatedEvent->data2 = midiEvent->data2;
+  }
+
+  if (numEvents > 0) {
+    header->numMidiEvents = numEvents;
+    _pluginIsolatedSendCommand(plugin, PLUGIN_ISOLATED_COMMAND_PROCESS_MIDI);
+  }
+}
+
+static boolByte _pluginIsolatedSetParameter(void *pluginPtr, unsigned int i,
+                                            float value) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+  PluginIsolatedHeader *header;
+
+  if (data->sharedMemory == NULL) {
+    return false;
+  }
+
+  header = (PluginIsolatedHeader *)data->sharedMemory->data;
+  header->parameterIndex = i;
+  header->parameterValue = value;
+  return (boolByte)(
+      _pluginIsolatedSendCommand(plugin,
+                                 PLUGIN_ISOLATED_COMMAND_SET_PARAMETER) &&
+      header->result);
+}
+
+static void _pluginIsolatedPrepareForProcessing(void *pluginPtr) {
+  _pluginIsolatedSendCommand((Plugin)pluginPtr,
+                             PLUGIN_ISOLATED_COMMAND_PREPARE);
+}
+
+static void _pluginIsolatedShowEditor(void *pluginPtr) {
+  logUnsupportedFeature("Showing the editor of an isolated plugin");
+}
+
+static void _pluginIsolatedClose(void *pluginPtr) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+
+  _pluginIsolatedSendCommand(plugin, PLUGIN_ISOLATED_COMMAND_CLOSE);
+  // The child exits on its own after closing the plugin, and is killed here
+  // if it has not done so yet
+  freeProcess(data->process);
+  data->process = NULL;
+  freeSharedMemory(data->sharedMemory);
+  data->sharedMemory = NULL;
+}
+
+static void _pluginIsolatedFree(void *pluginDataPtr) {
+  PluginIsolatedData data = (PluginIsolatedData)pluginDataPtr;
+
+  freeProcess(data->process);
+  freeSharedMemory(data->sharedMemory);
+  freeCharString(data->pluginRoot);
+  freeCharString(data->presetName);
+  freeCharString(data->hostExecutable);
+}
+
+static CharString _newCharStringOrEmpty(const CharString string) {
+  return string != NULL ? newCharStringWithCString(string->data)
+                        : newCharString();
+}
+
+Plugin newPluginIsolated(const CharString pluginName,
+                         const CharString pluginRoot,
+                         const CharString presetName,
+                         const CharString hostExecutable) {
+  Plugin plugin = _newPlugin(PLUGIN_TYPE_ISOLATED, PLUGIN_TYPE_UNKNOWN);
+  PluginIsolatedData data =
+      (PluginIsolatedData)malloc(sizeof(PluginIsolatedDataMembers));
+
+  charStringCopy(plugin->pluginName, pluginName);
+  charStringCopyCString(plugin->pluginLocation, "Isolated");
+
+  plugin->openPlugin = _pluginIsolatedOpen;
+  plugin->displayInfo = _pluginIsolatedDisplayInfo;
+  plugin->getSetting = _pluginIsolatedGetSetting;
+  plugin->prepareForProcessing = _pluginIsolatedPrepareForProcessing;
+  plugin->showEditor = _pluginIsolatedShowEditor;
+  plugin->processAudio = _pluginIsolatedProcessAudio;
+  plugin->processMidiEvents = _pluginIsolatedProcessMidiEvents;
+  plugin->setParameter = _pluginIsolatedSetParameter;
+  plugin->closePlugin = _pluginIsolatedClose;
+  plugin->freePluginData = _pluginIsolatedFree;
+
+  data->pluginRoot = _newCharStringOrEmpty(pluginRoot);
+  data->presetName = _newCharStringOrEmpty(presetName);
+  data->hostExecutable = _newCharStringOrEmpty(hostExecutable);
+  data->sharedMemory = NULL;
+  data->process = NULL;
+  data->crashed = false;
+  plugin->extraData = data;
+  return plugin;
+}
+
+Plugin pluginIsolatedNewInstance(Plugin self) {
+  PluginIsolatedData data = (PluginIsolatedData)self->extraData;
+  return newPluginIsolated(self->pluginName, data->pluginRoot,
+                           data->presetName, data->hostExecutable);
+}
+
+boolByte pluginIsolatedHasCrashed(Plugin self) {
+  return (boolByte)(self != NULL &&
+                    self->interfaceType == PLUGIN_TYPE_ISOLATED &&
+                    ((PluginIsolatedData)self->extraData)->crashed);
+}
+
+// Everything below here runs in the child process
+
+static Plugin _pluginIsolatedServeOpen(PluginChain pluginChain,
+                                       PluginIsolatedHeader *header) {
+  CharString chainString = newCharStringWithCString(header->pluginName);
+  CharString pluginRoot = newCharStringWithCString(header->pluginRoot);
+  Plugin plugin = NULL;
+  int i;
+
+  if (header->presetName[0] != '\0') {
+    charStringAppendCString(chainString, ",");
+    charStringAppendCString(chainString, header->presetName);
+  }
+
+  // The settings must be the same as the parent's before the plugin is opened
+  if (header->renderMode < NUM_PLUGIN_VST2X_RENDER_MODES) {
+    pluginVst2xSetRenderMode((PluginVst2xRenderMode)header->renderMode);
+  }
+
+  if (setSampleRate(header->sampleRate) &&
+      setBlocksize(header->blocksize) &&
+      setNumChannels((ChannelCount)header->numChannels) &&
+      setTempo(header->tempo) &&
+      setTimeSignatureBeatsPerMeasure(
+          (unsigned short)header->timeSignatureBeatsPerMeasure) &&
+      setTimeSignatureNoteValue(
+          (unsigned short)header->timeSignatureNoteValue) &&
+      pluginChainAddFromArgumentString(pluginChain, chainString, pluginRoot) &&
+      pluginChain->numPlugins == 1 &&
+      pluginChainInitialize(pluginChain) == RETURN_CODE_SUCCESS) {
+    plugin = pluginChain->plugins[0];
+    header->pluginType = plugin->pluginType;
+    for (i = 0; i < NUM_PLUGIN_SETTINGS; i++) {
+      header->settings[i] = plugin->getSetting(plugin, (PluginSetting)i);
+    }
+    _pluginIsolatedCopyString(header->pluginLocation, plugin->pluginLocation);
+    _pluginIsolatedCopyString(header->pluginAbsolutePath,
+                              plugin->pluginAbsolutePath);
+  }
+
+  freeCharString(chainString);
+  freeCharString(pluginRoot);
+  return plugin;
+}
+
+static void _pluginIsolatedServeAudio(Plugin plugin,
+                                      PluginIsolatedHeader *header,
+                                      Samples *inputSamples,
+                                      Samples *outputSamples) {
+  AudioClock audioClock = getAudioClock();
+  const unsigned long currentFrame = (unsigned long)header->currentFrame;
+  SampleBufferMembers inputs;
+  SampleBufferMembers outputs;
+  AudioClockPositionMembers position;
+  FpuState previousFpuState;
+  ChannelCount i;
+
+  if (getTempo() != header->tempo ||
+      getTimeSignatureBeatsPerMeasure() !=
+          header->timeSignatureBeatsPerMeasure ||
+      getTimeSignatureNoteValue() != header->timeSignatureNoteValue) {
+    setTempo(header->tempo);
+    setTimeSignatureBeatsPerMeasure(
+        (unsigned short)header->timeSignatureBeatsPerMeasure);
+    setTimeSignatureNoteValue((unsigned short)header->timeSignatureNoteValue);
+  }
+
+  audioClock->currentFrame = currentFrame;
+  position.sampleRate = getSampleRate();
+  position.tempo = header->tempo;
+  position.timeSignatureBeatsPerMeasure =
+      (unsigned short)header->timeSignatureBeatsPerMeasure;
+  position.timeSignatureNoteValue =
+      (unsigned short)header->timeSignatureNoteValue;
+  position.ppqPosition = header->ppqPosition;
+  position.barStartPosition = header->barStartPosition;
+  audioClockSetPosition(audioClock, &position);
+  audioClock->isPlaying = (boolByte)header->isPlaying;
+  audioClock->transportChanged = (boolByte)header->transportChanged;
+
+  for (i = 0; i < PLUGIN_ISOLATED_MAX_CHANNELS; i++) {
+    inputSamples[i] = _pluginIsolatedChannel(header, false, i);
+    outputSamples[i] = _pluginIsolatedChannel(header, true, i);
+  }
+
+  inputs.numChannels = (ChannelCount)header->numInputs;
+  inputs.blocksize = header->numFrames;
+  inputs.samples = inputSamples;
+  inputs._storage = NULL;
+  inputs._stride = header->blocksize;
+  outputs.numChannels = (ChannelCount)header->numOutputs;
+  outputs.blocksize = header->numFrames;
+  outputs.samples = outputSamples;
+  outputs._storage = NULL;
+  outputs._stride = header->blocksize;
+
+  if (header->flushDenormals) {
+    previousFpuState = fpuStateFlushDenormals();
+    plugin->processAudio(plugin, &inputs, &outputs);
+    fpuStateRestore(previousFpuState);
+  } else {
+    plugin->processAudio(plugin, &inputs, &outputs);
+  }
+}
+
+static void _pluginIsolatedServeMidi(Plugin plugin,
+                                     PluginIsolatedHeader *header) {
+  LinkedList midiEvents = newLinkedList();
+  PluginIsolatedMidiEvent *isolatedEvent;
+  MidiEvent midiEvent;
+  unsigned int i;
+
+  for (i = 0; i < header->numMidiEvents && i < PLUGIN_ISOLATED_MAX_MIDI_EVENTS;
+       i++) {
+    isolatedEvent = &(header->midiEvents[i]);
+    midiEvent = newMidiEvent();
+    midiEvent->eventType = (MidiEventType)isolatedEvent->eventType;
+    midiEvent->deltaFrames = isolatedEvent->deltaFrames;
+    midiEvent->timestamp = isolatedEvent->timestamp;
+    midiEvent->status = isolatedEvent->status;
+    midiEvent->data1 = isolatedEvent->data1;
+    midiEvent->data2 = isolatedEvent->data2;
+    linkedListAppend(midiEvents, midiEvent);
+  }
+
+  plugin->processMidiEvents(plugin, midiEvents);
+  freeLinkedListAndItems(midiEvents, (LinkedListFreeItemFunc)freeMidiEvent);
+}
+
+// Wait for the next request from the parent, and return false if the parent
+// has exited without closing the plugin
+static boolByte _pluginIsolatedServeWait(PluginIsolatedHeader *header,
+                                         unsigned int lastRequest) {
+#if UNIX
+  const pid_t parentPid = getppid();
+#endif
+
+  while (atomicLoad(&header->request) == lastRequest) {
+    if (!sharedMemoryWait(&header->request, lastRequest,
+                          PLUGIN_ISOLATED_POLL_INTERVAL_IN_MS)) {
+#if UNIX
+      if (getppid() != parentPid) {
+        return false;
+      }
+#endif
+    }
+  }
+
+  return true;
+}
+
+ReturnCode pluginIsolatedServe(const CharString sharedMemoryName) {
+  SharedMemory sharedMemory = newSharedMemoryWithName(sharedMemoryName);
+  PluginIsolatedHeader *header;
+  PluginChain pluginChain;
+  Plugin plugin;
+  Samples inputSamples[PLUGIN_ISOLATED_MAX_CHANNELS];
+  Samples outputSamples[PLUGIN_ISOLATED_MAX_CHANNELS];
+  unsigned int request = 0;
+  boolByte running = true;
+
+  if (sharedMemory == NULL) {
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  header = (PluginIsolatedHeader *)sharedMemory->data;
+  if (sharedMemory->size < sizeof(PluginIsolatedHeader) ||
+      header->magic != PLUGIN_ISOLATED_MAGIC ||
+      sharedMemory->size < _pluginIsolatedSize(header->blocksize)) {
+    logError("Shared memory '%s' was not created by a compatible host",
+             sharedMemoryName->data);
+    freeSharedMemory(sharedMemory);
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+#if UNIX
+  // Anything that the plugin prints must not fill up the pipe to the parent,
+  // which only reads it while it is waiting
+  dup2(STDERR_FILENO, STDOUT_FILENO);
+#endif
+
+  pluginChain = newPluginChain();
+  plugin = _pluginIsolatedServeOpen(pluginChain, header);
+  header->result = (unsigned int)(plugin != NULL);
+  atomicStore(&header->response, 1);
+  sharedMemoryWake(&header->response);
+  request = 1;
+
+  while (plugin != NULL && running) {
+    if (!_pluginIsolatedServeWait(header, request)) {
+      logError("Parent process exited, closing plugin");
+      break;
+    }
+
+    request = atomicLoad(&header->request);
+    header->result = true;
+    switch (header->command) {
+    case PLUGIN_ISOLATED_COMMAND_PROCESS_AUDIO:
+      _pluginIsolatedServeAudio(plugin, header, inputSamples, outputSamples);
+      break;
+
+    case PLUGIN_ISOLATED_COMMAND_PROCESS_MIDI:
+      _pluginIsolatedServeMidi(plugin, header);
+      break;
+
+    case PLUGIN_ISOLATED_COMMAND_SET_PARAMETER:
+      header->result = plugin->setParameter(plugin, header->parameterIndex,
+                                            header->parameterValue);
+      break;
+
+    case PLUGIN_ISOLATED_COMMAND_PREPARE:
+      plugin->prepareForProcessing(plugin);
+      break;
+
+    case PLUGIN_ISOLATED_COMMAND_CLOSE:
+      // The plugin is closed before answering, since the parent kills this
+      // process once it has the answer
+      pluginChainShutdown(pluginChain);
+      running = false;
+      break;
+
+    default:
+      logError("Unknown command %d from parent process", header->command);
+      header->result = false;
+      break;
+    }
+
+    atomicStore(&header->response, request);
+    sharedMemoryWake(&header->response);
+  }
+
+  if (running) {
+    pluginChainShutdown(pluginChain);
+  }
+  freePluginChain(pluginChain);
+  freeSharedMemory(sharedMemory);
+  return plugin != NULL ? RETURN_CODE_SUCCESS : RETURN_CODE_PLUGIN_ERROR;
+}
@@ -0,0 +1,78 @@
+//
+// PluginIsolated.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_PluginIsolated_h
+#define MrsWatson_PluginIsolated_h
+
+#include "app/ReturnCodes.h"
+#include "plugin/Plugin.h"
+
+/**
+ * Create a plugin which is hosted in a separate process, so that a crash in
+ * the plugin does not take down the host. Audio, MIDI and parameters are
+ * exchanged with the child through shared memory. If the child crashes, an
+ * error is logged and the plugin outputs silence from then on.
+ * @param pluginName Plugin name, as it would be given to pluginFactory()
+ * @param pluginRoot User-provided search root path. May be NULL or empty.
+ * @param presetName Preset to load in the child process. May be NULL or empty.
+ * @param hostExecutable Executable which hosts the plugin, which may be a
+ * build of a different word size than the current one. If NULL or empty, the
+ * current executable is used.
+ * @return Initialized object. The child process is started when the plugin is
+ * opened.
+ */
+Plugin newPluginIsolated(const CharString pluginName,
+                         const CharString pluginRoot,
+                         const CharString presetName,
+                         const CharString hostExecutable);
+
+/**
+ * Create another isolated plugin with the same plugin, preset and host
+ * executable, which is hosted in its own process.
+ * @param self Isolated plugin to copy
+ * @return Initialized object, which has not been opened yet
+ */
+Plugin pluginIsolatedNewInstance(Plugin self);
+
+/**
+ * Check if the child process of an isolated plugin has crashed or exited
+ * unexpectedly.
+ * @param self
+ * @return True if the plugin has crashed, false if it is still running or the
+ * plugin is not isolated
+ */
+boolByte pluginIsolatedHasCrashed(Plugin self);
+
+/**
+ * Run the child side of an isolated plugin. This opens the plugin which is
+ * described in the shared memory, and then processes commands from the parent
+ * process until the plugin is closed or the parent exits.
+ * @param sharedMemoryName Name of the shared memory created by the parent
+ * @return RETURN_CODE_SUCCESS if the plugin was closed normally
+ */
+ReturnCode pluginIsolatedServe(const CharString sharedMemoryName);
+
+#endif
@@ -0,0 +1,205 @@
+//
+// PluginLatency.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "PluginLatency.h"
+
+#include "audio/AudioSettings.h"
+#include "audio/SampleBuffer.h"
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+
+const char *kInternalPluginLatencyName = INTERNAL_PLUGIN_PREFIX "latency";
+
+static const SampleCount kLatencyDefaultFrames = 8192;
+
+static void _pluginLatencyEmpty(void *pluginPtr) {
+  // Nothing to do here
+}
+
+static boolByte _pluginLatencyOpen(void *pluginPtr) { return true; }
+
+static void _pluginLatencyDisplayInfo(void *pluginPtr) {
+  logInfo("Information for Internal plugin '%s'", kInternalPluginLatencyName);
+  logInfo("Type: effect, parameters: latency in frames (0)");
+  logInfo("Description: delays audio by a fixed number of frames and reports "
+          "it to the host as latency");
+}
+
+static int _pluginLatencyGetSetting(void *pluginPtr,
+                                    PluginSetting pluginSetting) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginLatencySettings settings = (PluginLatencySettings)plugin->extraData;
+
+  switch (pluginSetting) {
+  case PLUGIN_SETTING_TAIL_TIME_IN_MS:
+    return 0;
+
+  case PLUGIN_NUM_INPUTS:
+    return 2;
+
+  case PLUGIN_NUM_OUTPUTS:
+    return 2;
+
+  case PLUGIN_INITIAL_DELAY:
+    return (int)settings->latencyFrames;
+
+  default:
+    return 0;
+  }
+}
+
+static void _freeDelayLines(PluginLatencySettings settings) {
+  ChannelCount channel;
+
+  if (settings->delayLines != NULL) {
+    for (channel = 0; channel < settings->numChannels; channel++) {
+      free(settings->delayLines[channel]);
+    }
+
+    free(settings->delayLines);
+    settings->delayLines = NULL;
+  }
+}
+
+static void _allocateDelayLines(PluginLatencySettings settings) {
+  ChannelCount channel;
+
+  _freeDelayLines(settings);
+  // Extra channels are usually handled by further instances of the plugin, but
+  // a chain with more channels than instances sends them all to this one
+  settings->numChannels = getNumChannels() > 2 ? getNumChannels() : 2;
+  settings->delayLines =
+      (Samples *)malloc(sizeof(Samples) * settings->numChannels);
+
+  for (channel = 0; channel < settings->numChannels; channel++) {
+    settings->delayLines[channel] =
+        (Samples)calloc(settings->latencyFrames + 1, sizeof(Sample));
+  }
+
+  settings->delayIndex = 0;
+}
+
+static void _pluginLatencyPrepare(void *pluginPtr) {
+  Plugin plugin = (Plugin)pluginPtr;
+  _allocateDelayLines((PluginLatencySettings)plugin->extraData);
+}
+
+static void _pluginLatencyProcessAudio(void *pluginPtr, SampleBuffer inputs,
+                                       SampleBuffer outputs) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginLatencySettings settings = (PluginLatencySettings)plugin->extraData;
+  const SampleCount lineSize = settings->latencyFrames + 1;
+  SampleCount delayIndex = settings->delayIndex;
+  ChannelCount channel;
+  SampleCount i;
+
+  if (settings->latencyFrames == 0) {
+    sampleBufferCopyAndMapChannels(outputs, inputs);
+    return;
+  }
+
+  if (settings->delayLines == NULL) {
+    _allocateDelayLines(settings);
+  }
+
+  for (channel = 0; channel < outputs->numChannels; channel++) {
+    const Samples input = inputs->samples[channel % inputs->numChannels];
+    Samples line = settings->delayLines[channel % settings->numChannels];
+    delayIndex = settings->delayIndex;
+
+    for (i = 0; i < outputs->blocksize; i++) {
+      line[delayIndex] = input[i];
+      delayIndex = (delayIndex + 1) % lineSize;
+      outputs->samples[channel][i] = line[delayIndex];
+    }
+  }
+
+  settings->delayIndex = delayIndex;
+}
+
+static void _pluginLatencyProcessMidiEvents(void *pluginPtr,
+                                            LinkedList midiEvents) {
+  // Nothing to do here
+}
+
+static boolByte _pluginLatencySetParameter(void *pluginPtr, unsigned int i,
+                                           float value) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginLatencySettings settings = (PluginLatencySettings)plugin->extraData;
+
+  switch (i) {
+  case PLUGIN_LATENCY_SETTINGS_FRAMES:
+    if (value < 0.0f) {
+      logError("Latency of internal latency plugin must not be negative");
+      return false;
+    }
+
+    settings->latencyFrames = (SampleCount)value;
+
+    // Changing the latency after processing has started restarts the delay
+    if (settings->delayLines != NULL) {
+      _allocateDelayLines(settings);
+    }
+
+    return true;
+
+  default:
+    logError("Attempt to set invalid parameter %d on internal latency plugin",
+             i);
+    return false;
+  }
+}
+
+static void _pluginLatencyFree(void *pluginDataPtr) {
+  _freeDelayLines((PluginLatencySettings)pluginDataPtr);
+}
+
+Plugin newPluginLatency(const CharString pluginName) {
+  Plugin plugin = _newPlugin(PLUGIN_TYPE_INTERNAL, PLUGIN_TYPE_EFFECT);
+  PluginLatencySettings settings =
+      (PluginLatencySettings)malloc(sizeof(PluginLatencySettingsMembers));
+
+  charStringCopy(plugin->pluginName, pluginName);
+  charStringCopyCString(plugin->pluginLocation, "Internal");
+
+  plugin->openPlugin = _pluginLatencyOpen;
+  plugin->displayInfo = _pluginLatencyDisplayInfo;
+  plugin->getSetting = _pluginLatencyGetSetting;
+  plugin->prepareForProcessing = _pluginLatencyPrepare;
+  plugin->showEditor = _pluginLatencyEmpty;
+  plugin->processAudio = _pluginLatencyProcessAudio;
+  plugin->processMidiEvents = _pluginLatencyProcessMidiEvents;
+  plugin->setParameter = _pluginLatencySetParameter;
+  plugin->closePlugin = _pluginLatencyEmpty;
+  plugin->freePluginData = _pluginLatencyFree;
+
+  settings->latencyFrames = kLatencyDefaultFrames;
+  settings->numChannels = 0;
+  settings->delayLines = NULL;
+  settings->delayIndex = 0;
+  plugin->extraData = settings;
+  return plugin;
+}
@@ -62,19 +62,7 @@ static int _pluginLimiterGetSetting(void *pluginPtr,
 
 static void _pluginLimiterProcessAudio(void *pluginPtr, SampleBuffer inputs,
                                        SampleBuffer outputs) {
-  unsigned long channel, sample;
-
-  sampleBufferCopyAndMapChannels(outputs, inputs);
-
-  for (channel = 0; channel < outputs->numChannels; ++channel) {
-    for (sample = 0; sample < outputs->blocksize; ++sample) {
-      if (outputs->samples[channel][sample] > 1.0f) {
-        outputs->samples[channel][sample] = 1.0f;
-      } else if (outputs->samples[channel][sample] < -1.0f) {
-        outputs->samples[channel][sample] = -1.0f;
-      }
-    }
-  }
+  sampleBufferCopyAndMapChannelsWithClip(outputs, inputs, 1.0f);
 }
 
 static void _pluginLimiterProcessMidiEvents(void *pluginPtr,
@@ -29,6 +29,7 @@
 #include "base/File.h"
 #include "logging/EventLogger.h"
 #include "plugin/PluginPresetFxp.h"
+#include "plugin/PluginPresetImpulse.h"
 #include "plugin/PluginPresetInternalProgram.h"
 
 #include <stdio.h>
@@ -53,9 +54,16 @@ static PluginPresetType _pluginPresetGuessType(const CharString presetName) {
 
     // If the preset name is all numeric, then it's an internal program number
     return PRESET_TYPE_INTERNAL_PROGRAM;
-  } else if (charStringIsEqualToCString(fileExtension, "fxp", true)) {
+  } else if (charStringIsEqualToCString(fileExtension, "fxp", true) ||
+             charStringIsEqualToCString(fileExtension, "fxb", true)) {
     freeCharString(fileExtension);
     return PRESET_TYPE_FXP;
+  } else if (charStringIsEqualToCString(fileExtension, "wav", true) ||
+             charStringIsEqualToCString(fileExtension, "aif", true) ||
+             charStringIsEqualToCString(fileExtension, "aiff", true) ||
+             charStringIsEqualToCString(fileExtension, "flac", true)) {
+    freeCharString(fileExtension);
+    return PRESET_TYPE_IMPULSE;
   } else {
     logCritical("Preset '%s' does not match any supported type",
                 presetName->data);
@@ -74,6 +82,9 @@ PluginPreset pluginPresetFactory(const CharString presetName) {
   case PRESET_TYPE_INTERNAL_PROGRAM:
     return newPluginPresetInternalProgram(presetName);
 
+  case PRESET_TYPE_IMPULSE:
+    return newPluginPresetImpulse(presetName);
+
   default:
     return NULL;
   }
@@ -32,8 +32,11 @@
 
 typedef enum {
   PRESET_TYPE_INVALID,
+  // VST program (.fxp) or bank (.fxb) file
   PRESET_TYPE_FXP,
   PRESET_TYPE_INTERNAL_PROGRAM,
+  // Audio file with an impulse response for the internal convolver
+  PRESET_TYPE_IMPULSE,
   NUM_PRESET_TYPES
 } PluginPresetType;
 
@@ -0,0 +1,176 @@
+//
+// PluginPresetCache.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "PluginPresetCache.h"
+
+#include "base/MemoryUsage.h"
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned long long kFnvOffsetBasis = 0xcbf29ce484222325ull;
+static const unsigned long long kFnvPrime = 0x100000001b3ull;
+
+PluginPresetCache pluginPresetCacheInstance = NULL;
+
+void initPluginPresetCache(size_t maxSize) {
+  if (pluginPresetCacheInstance != NULL) {
+    freePluginPresetCache();
+  }
+
+  pluginPresetCacheInstance =
+      (PluginPresetCache)malloc(sizeof(PluginPresetCacheMembers));
+  pluginPresetCacheInstance->entries = newLinkedList();
+  pluginPresetCacheInstance->totalSize = 0;
+  pluginPresetCacheInstance->maxSize = maxSize;
+  pluginPresetCacheInstance->_mutex = newMutex();
+}
+
+boolByte pluginPresetCacheIsEnabled(void) {
+  return (boolByte)(pluginPresetCacheInstance != NULL);
+}
+
+unsigned long long pluginPresetCacheHash(const byte *data, size_t dataSize) {
+  unsigned long long result = kFnvOffsetBasis;
+  size_t i;
+
+  for (i = 0; i < dataSize; i++) {
+    result ^= data[i];
+    result *= kFnvPrime;
+  }
+
+  return result;
+}
+
+// Must be called with the cache's mutex held
+static PluginPresetCacheEntry _pluginPresetCacheFind(
+    PluginPresetCache self, unsigned long pluginId, unsigned long pluginVersion,
+    unsigned long long presetHash, size_t presetSize) {
+  LinkedListIterator iterator;
+  PluginPresetCacheEntry entry;
+
+  for (iterator = self->entries; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    entry = (PluginPresetCacheEntry)iterator->item;
+
+    if (entry != NULL && entry->pluginId == pluginId &&
+        entry->pluginVersion == pluginVersion &&
+        entry->presetHash == presetHash && entry->presetSize == presetSize) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+PluginPresetCacheEntry pluginPresetCacheFind(unsigned long pluginId,
+                                             unsigned long pluginVersion,
+                                             unsigned long long presetHash,
+                                             size_t presetSize) {
+  PluginPresetCache self = pluginPresetCacheInstance;
+  PluginPresetCacheEntry result;
+
+  if (self == NULL) {
+    return NULL;
+  }
+
+  mutexLock(self->_mutex);
+  result = _pluginPresetCacheFind(self, pluginId, pluginVersion, presetHash,
+                                  presetSize);
+  mutexUnlock(self->_mutex);
+  return result;
+}
+
+boolByte pluginPresetCacheAdd(unsigned long pluginId,
+                              unsigned long pluginVersion,
+                              unsigned long long presetHash, size_t presetSize,
+                              boolByte isBank, const CharString programName,
+                              const byte *chunk, size_t chunkSize) {
+  PluginPresetCache self = pluginPresetCacheInstance;
+  PluginPresetCacheEntry entry;
+  boolByte result = false;
+
+  if (self == NULL || chunk == NULL || chunkSize == 0) {
+    return false;
+  }
+
+  mutexLock(self->_mutex);
+
+  if (chunkSize > self->maxSize - self->totalSize) {
+    logDebug("Preset cache is full, not storing %lu byte chunk",
+             (unsigned long)chunkSize);
+  } else if (!memoryUsageFitsBudget(chunkSize)) {
+    logDebug("Memory budget is exhausted, not storing %lu byte chunk",
+             (unsigned long)chunkSize);
+  } else if (_pluginPresetCacheFind(self, pluginId, pluginVersion, presetHash,
+                                    presetSize) == NULL) {
+    entry = (PluginPresetCacheEntry)malloc(
+        sizeof(PluginPresetCacheEntryMembers));
+    entry->pluginId = pluginId;
+    entry->pluginVersion = pluginVersion;
+    entry->presetHash = presetHash;
+    entry->presetSize = presetSize;
+    entry->isBank = isBank;
+    entry->programName = newCharString();
+
+    if (programName != NULL) {
+      charStringCopy(entry->programName, programName);
+    }
+
+    entry->chunk = (byte *)malloc(chunkSize);
+    memcpy(entry->chunk, chunk, chunkSize);
+    entry->chunkSize = chunkSize;
+
+    linkedListAppend(self->entries, entry);
+    self->totalSize += chunkSize;
+    memoryUsageAdd(kMemoryUsagePresetChunks, chunkSize);
+    result = true;
+  }
+
+  mutexUnlock(self->_mutex);
+  return result;
+}
+
+static void _freePluginPresetCacheEntry(void *entryPtr) {
+  PluginPresetCacheEntry entry = (PluginPresetCacheEntry)entryPtr;
+  memoryUsageRemove(kMemoryUsagePresetChunks, entry->chunkSize);
+  freeCharString(entry->programName);
+  free(entry->chunk);
+  free(entry);
+}
+
+void freePluginPresetCache(void) {
+  PluginPresetCache self = pluginPresetCacheInstance;
+
+  if (self != NULL) {
+    freeLinkedListAndItems(self->entries, _freePluginPresetCacheEntry);
+    freeMutex(self->_mutex);
+    free(self);
+    pluginPresetCacheInstance = NULL;
+  }
+}
@@ -0,0 +1,124 @@
+//
+// PluginPresetCache.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#ifndef MrsWatson_PluginPresetCache_h
+#define MrsWatson_PluginPresetCache_h
+
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+#include "base/Thread.h"
+
+typedef struct {
+  unsigned long pluginId;
+  unsigned long pluginVersion;
+  unsigned long long presetHash;
+  size_t presetSize;
+  boolByte isBank;
+  CharString programName;
+  byte *chunk;
+  size_t chunkSize;
+} PluginPresetCacheEntryMembers;
+typedef PluginPresetCacheEntryMembers *PluginPresetCacheEntry;
+
+/**
+ * Snapshots of plugin state which were taken after a preset was loaded, so
+ * that loading the same preset into the same plugin again only needs to hand
+ * the plugin back its own chunk data. Entries are keyed by the plugin's unique
+ * ID and version, and a hash of the preset file contents. Entries are never
+ * removed until the cache is freed, so once the cache is full then new
+ * snapshots are simply not stored. The cache is shared by all threads.
+ */
+typedef struct {
+  LinkedList entries;
+  size_t totalSize;
+  size_t maxSize;
+
+  // Private fields
+  Mutex _mutex;
+} PluginPresetCacheMembers;
+typedef PluginPresetCacheMembers *PluginPresetCache;
+extern PluginPresetCache pluginPresetCacheInstance;
+
+/**
+ * Enable the global preset cache. If the cache was already enabled, then it is
+ * emptied first.
+ * @param maxSize Maximum total size of all stored chunks, in bytes
+ */
+void initPluginPresetCache(size_t maxSize);
+
+/**
+ * @return True if initPluginPresetCache() has been called
+ */
+boolByte pluginPresetCacheIsEnabled(void);
+
+/**
+ * Calculate the hash which is used to identify a preset's contents.
+ * @param data Preset file data
+ * @param dataSize Size of data, in bytes
+ * @return 64-bit FNV-1a hash of the data
+ */
+unsigned long long pluginPresetCacheHash(const byte *data, size_t dataSize);
+
+/**
+ * Look up a snapshot in the cache.
+ * @param pluginId Unique ID of the plugin
+ * @param pluginVersion Version of the plugin
+ * @param presetHash Hash of the preset, from pluginPresetCacheHash()
+ * @param presetSize Size of the preset data, in bytes
+ * @return Matching entry, or NULL if the cache is disabled or has no such
+ * entry. The entry remains valid until freePluginPresetCache() is called.
+ */
+PluginPresetCacheEntry pluginPresetCacheFind(unsigned long pluginId,
+                                             unsigned long pluginVersion,
+                                             unsigned long long presetHash,
+                                             size_t presetSize);
+
+/**
+ * Store a snapshot in the cache. The chunk data is copied.
+ * @param pluginId Unique ID of the plugin
+ * @param pluginVersion Version of the plugin
+ * @param presetHash Hash of the preset, from pluginPresetCacheHash()
+ * @param presetSize Size of the preset data, in bytes
+ * @param isBank True if the chunk contains all programs of the plugin
+ * @param programName Name of the loaded program
+ * @param chunk Chunk data, as returned by the plugin
+ * @param chunkSize Size of the chunk data, in bytes
+ * @return True if the snapshot was stored, false if the cache is disabled or
+ * full, or already has an entry for this key
+ */
+boolByte pluginPresetCacheAdd(unsigned long pluginId,
+                              unsigned long pluginVersion,
+                              unsigned long long presetHash, size_t presetSize,
+                              boolByte isBank, const CharString programName,
+                              const byte *chunk, size_t chunkSize);
+
+/**
+ * Free all stored snapshots and disable the cache
+ */
+void freePluginPresetCache(void);
+
+#endif
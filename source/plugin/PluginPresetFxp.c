@@ -27,246 +27,428 @@
 #include "PluginPresetFxp.h"
 
 #include "base/Endian.h"
+#include "base/MemoryUsage.h"
 #include "logging/EventLogger.h"
+#include "plugin/PluginPresetCache.h"
 #include "plugin/PluginVst2x.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+static const unsigned int kFxpChunkMagic = 0x43636E4B;       // 'CcnK'
+static const unsigned int kFxpMagicRegular = 0x4678436b;     // 'FxCk'
+static const unsigned int kFxpMagicOpaqueChunk = 0x46504368; // 'FPCh'
+static const unsigned int kFxbMagicRegular = 0x4678426b;     // 'FxBk'
+static const unsigned int kFxbMagicOpaqueChunk = 0x46424368; // 'FBCh'
+static const size_t kFxbReservedSize = 128;
+
 static boolByte _openPluginPresetFxp(void *pluginPresetPtr) {
   PluginPreset pluginPreset = (PluginPreset)pluginPresetPtr;
   PluginPresetFxpData extraData =
       (PluginPresetFxpData)(pluginPreset->extraData);
-  extraData->fileHandle = fopen(pluginPreset->presetName->data, "rb");
+  FILE *fileHandle = fopen(pluginPreset->presetName->data, "rb");
+  long fileSize;
 
-  if (extraData->fileHandle == NULL) {
+  if (fileHandle == NULL) {
     logError("Preset '%s' could not be opened for reading",
              pluginPreset->presetName->data);
     return false;
   }
 
-  return true;
-}
-
-static boolByte _loadPluginPresetFxp(void *pluginPresetPtr, Plugin plugin) {
-  PluginPreset pluginPreset = (PluginPreset)pluginPresetPtr;
-  PluginPresetFxpData extraData =
-      (PluginPresetFxpData)(pluginPreset->extraData);
-  FxpProgram inProgram = NULL;
-  PluginPresetFxpProgramType programType;
+  extraData->mappedFile = newMappedFile(fileHandle);
 
-  char *chunk;
-  size_t chunkSize;
-  unsigned int valueBuffer;
-  size_t numObjectsRead;
-  float parameterValue;
-  unsigned int i;
+  if (extraData->mappedFile != NULL) {
+    extraData->data = extraData->mappedFile->data;
+    extraData->dataSize = extraData->mappedFile->size;
+    // All of the mapped file is read, so it all becomes resident
+    memoryUsageAdd(kMemoryUsagePresetChunks, extraData->dataSize);
+    fclose(fileHandle);
+    return true;
+  }
 
-  numObjectsRead =
-      fread(&valueBuffer, sizeof(unsigned int), 1, extraData->fileHandle);
+  // Files which can't be mapped are read into memory instead
+  logDebug("Preset '%s' could not be mapped, reading it instead",
+           pluginPreset->presetName->data);
 
-  if (numObjectsRead != 1) {
-    logError("Short read of FXP preset file at chunkMagic");
+  if (fseek(fileHandle, 0, SEEK_END) != 0 ||
+      (fileSize = ftell(fileHandle)) <= 0 ||
+      fseek(fileHandle, 0, SEEK_SET) != 0) {
+    logError("Preset '%s' is empty or could not be read",
+             pluginPreset->presetName->data);
+    fclose(fileHandle);
     return false;
   }
 
-  inProgram = (FxpProgram)malloc(sizeof(FxpProgramMembers));
-  inProgram->chunkMagic = convertBigEndianIntToPlatform(valueBuffer);
+  extraData->chunk = (byte *)malloc((size_t)fileSize);
+  extraData->dataSize =
+      fread(extraData->chunk, sizeof(byte), (size_t)fileSize, fileHandle);
+  extraData->data = extraData->chunk;
+  memoryUsageAdd(kMemoryUsagePresetChunks, extraData->dataSize);
+  fclose(fileHandle);
+  return true;
+}
 
-  if (inProgram->chunkMagic != 0x43636E4B) { // 'CcnK'
-    logError("FXP preset file has bad chunk magic");
-    free(inProgram);
+static boolByte _readFxpInt(const byte **position, const byte *end,
+                            unsigned int *outValue, const char *fieldName) {
+  unsigned int valueBuffer;
+
+  if ((size_t)(end - *position) < sizeof(unsigned int)) {
+    logError("Short read of FXP preset file at %s", fieldName);
     return false;
   }
 
-  numObjectsRead =
-      fread(&valueBuffer, sizeof(unsigned int), 1, extraData->fileHandle);
+  memcpy(&valueBuffer, *position, sizeof(unsigned int));
+  *position += sizeof(unsigned int);
+  *outValue = convertBigEndianIntToPlatform(valueBuffer);
+  return true;
+}
+
+// Returns a pointer to the next numBytes bytes of the file, which are not
+// copied, or NULL if the file is too short
+static const byte *_readFxpBytes(const byte **position, const byte *end,
+                                 size_t numBytes, const char *fieldName) {
+  const byte *result = *position;
 
-  if (numObjectsRead != 1) {
-    logError("Short read of FXP preset file at byteSize");
-    free(inProgram);
-    return false;
+  if ((size_t)(end - *position) < numBytes) {
+    logError("Short read of FXP preset file at %s", fieldName);
+    return NULL;
   }
 
-  inProgram->byteSize = convertBigEndianIntToPlatform(valueBuffer);
-  logDebug("FXP program has %d bytes in main chunk", inProgram->byteSize);
+  *position += numBytes;
+  return result;
+}
 
-  numObjectsRead =
-      fread(&valueBuffer, sizeof(unsigned int), 1, extraData->fileHandle);
+// Reads the fields which are shared by programs and banks, up to and including
+// the fxVersion. The fxMagic determines which type of file this is.
+static PluginPresetFxpProgramType
+_readFxpHeader(PluginPreset pluginPreset, Plugin plugin, FxpProgram header,
+               const byte **position, const byte *end) {
+  PluginPresetFxpProgramType programType;
 
-  if (numObjectsRead != 1) {
-    logError("Short read of FXP preset file at fxMagic");
-    free(inProgram);
-    return false;
+  if (!_readFxpInt(position, end, &header->chunkMagic, "chunkMagic")) {
+    return FXP_TYPE_INVALID;
+  } else if (header->chunkMagic != kFxpChunkMagic) {
+    logError("FXP preset file has bad chunk magic");
+    return FXP_TYPE_INVALID;
+  }
+
+  if (!_readFxpInt(position, end, &header->byteSize, "byteSize")) {
+    return FXP_TYPE_INVALID;
   }
 
-  inProgram->fxMagic = convertBigEndianIntToPlatform(valueBuffer);
+  logDebug("FXP program has %d bytes in main chunk", header->byteSize);
 
-  if (inProgram->fxMagic == 0x4678436b) { // 'FxCk'
+  if (!_readFxpInt(position, end, &header->fxMagic, "fxMagic")) {
+    return FXP_TYPE_INVALID;
+  } else if (header->fxMagic == kFxpMagicRegular) {
     programType = FXP_TYPE_REGULAR;
-  } else if (inProgram->fxMagic == 0x46504368) { // 'FPCh'
+  } else if (header->fxMagic == kFxpMagicOpaqueChunk) {
     programType = FXP_TYPE_OPAQUE_CHUNK;
+  } else if (header->fxMagic == kFxbMagicRegular) {
+    programType = FXP_TYPE_BANK_REGULAR;
+  } else if (header->fxMagic == kFxbMagicOpaqueChunk) {
+    programType = FXP_TYPE_BANK_OPAQUE_CHUNK;
   } else {
     logError("FXP preset has invalid fxMagic type");
-    free(inProgram);
-    return false;
+    return FXP_TYPE_INVALID;
   }
 
-  numObjectsRead =
-      fread(&valueBuffer, sizeof(unsigned int), 1, extraData->fileHandle);
+  if (!_readFxpInt(position, end, &header->version, "version") ||
+      !_readFxpInt(position, end, &header->fxID, "fxID")) {
+    return FXP_TYPE_INVALID;
+  }
 
-  if (numObjectsRead != 1) {
-    logError("Short read of FXP preset file at version");
-    free(inProgram);
-    return false;
+  logDebug("Preset's fxID is %d", header->fxID);
+
+  if (header->fxID != pluginVst2xGetUniqueId(plugin)) {
+    logError("Preset '%s' is not compatible with plugin '%s'",
+             pluginPreset->presetName->data, plugin->pluginName->data);
+    return FXP_TYPE_INVALID;
+  }
+
+  if (!_readFxpInt(position, end, &header->fxVersion, "fxVersion")) {
+    return FXP_TYPE_INVALID;
   }
 
-  inProgram->version = convertBigEndianIntToPlatform(valueBuffer);
+  if (header->fxVersion != pluginVst2xGetVersion(plugin)) {
+    logWarn("Plugin has version %ld, but preset has version %d. Loading this "
+            "preset may result in unexpected behavior!",
+            pluginVst2xGetVersion(plugin), header->fxVersion);
+  } else {
+    logDebug("Preset's version is %d", header->fxVersion);
+  }
 
-  numObjectsRead =
-      fread(&valueBuffer, sizeof(unsigned int), 1, extraData->fileHandle);
+  return programType;
+}
 
-  if (numObjectsRead != 1) {
-    logError("Short read of FXP preset file at fxID");
-    free(inProgram);
-    return false;
+// Reads the size of an opaque chunk, and returns a pointer to the chunk
+// inside of the preset file
+static char *_readFxpChunk(FxpProgram program, const byte **position,
+                           const byte *end) {
+  if (!_readFxpInt(position, end, &program->content.data.size, "chunk size")) {
+    return NULL;
+  } else if (program->content.data.size == 0) {
+    logError("FXP preset has chunk of 0 bytes");
+    return NULL;
   }
 
-  inProgram->fxID = convertBigEndianIntToPlatform(valueBuffer);
-  logDebug("Preset's fxID is %d", inProgram->fxID);
+  logDebug("Plugin has chunk size of %d bytes", program->content.data.size);
+  // The chunk is only read by the plugin, so the const can be cast away
+  return (char *)_readFxpBytes(position, end, program->content.data.size,
+                               "chunk");
+}
+
+// Reads the parameters or chunk of a program, which follow the header
+static boolByte _loadFxpProgram(Plugin plugin, FxpProgram program,
+                                PluginPresetFxpProgramType programType,
+                                const byte **position, const byte *end) {
+  const byte *programName;
+  const byte *parameterData;
+  float parameterBuffer;
+  unsigned int i;
 
-  if (inProgram->fxID != pluginVst2xGetUniqueId(plugin)) {
-    logError("Preset '%s' is not compatible with plugin '%s'",
-             pluginPreset->presetName->data, plugin->pluginName->data);
-    free(inProgram);
+  if (!_readFxpInt(position, end, &program->numParams, "numParams")) {
     return false;
   }
 
-  numObjectsRead =
-      fread(&valueBuffer, sizeof(unsigned int), 1, extraData->fileHandle);
+  logDebug("Preset has %d params", program->numParams);
+  programName = _readFxpBytes(position, end, sizeof(program->prgName),
+                              "prgName");
 
-  if (numObjectsRead != 1) {
-    logError("Short read of FXP preset file at fxVersion");
-    free(inProgram);
+  if (programName == NULL) {
     return false;
   }
 
-  inProgram->fxVersion = convertBigEndianIntToPlatform(valueBuffer);
+  memcpy(program->prgName, programName, sizeof(program->prgName));
+  program->prgName[sizeof(program->prgName) - 1] = '\0';
 
-  if (inProgram->fxVersion != pluginVst2xGetVersion(plugin)) {
-    logWarn("Plugin has version %ld, but preset has version %d. Loading this "
-            "preset may result in unexpected behavior!",
-            pluginVst2xGetVersion(plugin), inProgram->fxVersion);
+  if (programType == FXP_TYPE_REGULAR) {
+    parameterData = _readFxpBytes(
+        position, end, sizeof(float) * program->numParams, "parameter data");
+
+    if (parameterData == NULL) {
+      return false;
+    }
+
+    for (i = 0; i < program->numParams; i++) {
+      memcpy(&parameterBuffer, parameterData + sizeof(float) * i,
+             sizeof(float));
+      plugin->setParameter(plugin, i,
+                           convertBigEndianFloatToPlatform(parameterBuffer));
+    }
+
+    return true;
+  } else if (programType == FXP_TYPE_OPAQUE_CHUNK) {
+    program->content.data.chunk = _readFxpChunk(program, position, end);
+
+    if (program->content.data.chunk == NULL) {
+      return false;
+    }
+
+    pluginVst2xSetProgramChunk(plugin, program->content.data.chunk,
+                               program->content.data.size);
+    return true;
   } else {
-    logDebug("Preset's version is %d", inProgram->fxVersion);
+    logInternalError("Invalid FXP program type");
+    return false;
   }
+}
 
-  numObjectsRead =
-      fread(&valueBuffer, sizeof(unsigned int), 1, extraData->fileHandle);
+static boolByte _loadFxbBank(Plugin plugin, FxpProgram bank,
+                             PluginPresetFxpProgramType bankType,
+                             const byte **position, const byte *end) {
+  FxpProgramMembers program;
+  PluginPresetFxpProgramType programType;
+  unsigned int numPrograms;
+  unsigned int currentProgram = 0;
+  unsigned int i;
 
-  if (numObjectsRead != 1) {
-    logError("Short read of FXP preset file at numParams");
-    free(inProgram);
+  if (!_readFxpInt(position, end, &numPrograms, "numPrograms")) {
     return false;
   }
 
-  inProgram->numParams = convertBigEndianIntToPlatform(valueBuffer);
-  logDebug("Preset has %d params", inProgram->numParams);
+  logDebug("Bank has %d programs", numPrograms);
 
-  memset(inProgram->prgName, 0, sizeof(char) * 28);
-  numObjectsRead =
-      fread(inProgram->prgName, sizeof(char), 28, extraData->fileHandle);
-
-  if (numObjectsRead != 28) {
-    logError("Short read of FXP preset file at prgName");
-    free(inProgram);
+  // Version 2 banks store the current program in the first reserved field
+  if (bank->version >= 2) {
+    if (!_readFxpInt(position, end, &currentProgram, "currentProgram") ||
+        _readFxpBytes(position, end, kFxbReservedSize - sizeof(unsigned int),
+                      "future") == NULL) {
+      return false;
+    }
+  } else if (_readFxpBytes(position, end, kFxbReservedSize, "future") ==
+             NULL) {
     return false;
   }
 
-  charStringCopyCString(pluginPreset->presetName, inProgram->prgName);
-  logDebug("Preset's name is %s", pluginPreset->presetName->data);
+  if (bankType == FXP_TYPE_BANK_OPAQUE_CHUNK) {
+    bank->content.data.chunk = _readFxpChunk(bank, position, end);
 
-  if (programType == FXP_TYPE_REGULAR) {
-    for (i = 0; i < inProgram->numParams; i++) {
-      float parameterBuffer = 0.0f;
-      numObjectsRead =
-          fread(&parameterBuffer, sizeof(float), 1, extraData->fileHandle);
-
-      if (numObjectsRead != 1) {
-        logError("Short read of FXP preset at parameter data");
-        free(inProgram);
-        return false;
-      }
-
-      parameterValue = convertBigEndianFloatToPlatform(parameterBuffer);
-      plugin->setParameter(plugin, i, parameterValue);
+    if (bank->content.data.chunk == NULL) {
+      return false;
     }
-  } else if (programType == FXP_TYPE_OPAQUE_CHUNK) {
-    numObjectsRead =
-        fread(&valueBuffer, sizeof(unsigned int), 1, extraData->fileHandle);
 
-    if (numObjectsRead != 1) {
-      logError("Short read of FXP preset file at chunk size");
-      free(inProgram);
+    pluginVst2xSetBankChunk(plugin, bank->content.data.chunk,
+                            bank->content.data.size);
+    return true;
+  }
+
+  for (i = 0; i < numPrograms; i++) {
+    if (!pluginVst2xSetProgram(plugin, (int)i)) {
       return false;
     }
 
-    inProgram->content.data.size = convertBigEndianIntToPlatform(valueBuffer);
-    chunkSize = inProgram->content.data.size;
+    memset(&program, 0, sizeof(FxpProgramMembers));
+    programType = FXP_TYPE_INVALID;
+
+    if (_readFxpInt(position, end, &program.chunkMagic, "chunkMagic") &&
+        _readFxpInt(position, end, &program.byteSize, "byteSize") &&
+        _readFxpInt(position, end, &program.fxMagic, "fxMagic") &&
+        _readFxpInt(position, end, &program.version, "version") &&
+        _readFxpInt(position, end, &program.fxID, "fxID") &&
+        _readFxpInt(position, end, &program.fxVersion, "fxVersion")) {
+      programType = program.fxMagic == kFxpMagicRegular ? FXP_TYPE_REGULAR
+                                                       : FXP_TYPE_INVALID;
+    }
 
-    if (chunkSize == 0) {
-      logError("FXP preset has chunk of 0 bytes");
-      free(inProgram);
+    if (programType == FXP_TYPE_INVALID) {
+      logError("FXB bank has invalid program %d", i);
+      return false;
+    } else if (!_loadFxpProgram(plugin, &program, programType, position,
+                                end)) {
       return false;
-    } else {
-      logDebug("Plugin has chunk size of %d bytes", chunkSize);
     }
 
-    chunk = (char *)malloc(sizeof(char) * chunkSize);
-    memset(chunk, 0, sizeof(char) * chunkSize);
-    numObjectsRead =
-        fread(chunk, sizeof(char), chunkSize, extraData->fileHandle);
+    pluginVst2xSetProgramName(plugin, program.prgName);
+  }
 
-    if (numObjectsRead != chunkSize) {
-      logError("Short read of FXP preset file at chunk");
-      free(inProgram);
-      free(chunk);
+  if (numPrograms == 0) {
+    return true;
+  } else if (currentProgram >= numPrograms) {
+    currentProgram = 0;
+  }
+
+  return pluginVst2xSetProgram(plugin, (int)currentProgram);
+}
+
+// Restores a snapshot of the plugin's state which was taken the last time that
+// the same preset was loaded into this plugin
+static boolByte _restorePluginPresetFxpFromCache(PluginPreset pluginPreset,
+                                                 Plugin plugin,
+                                                 unsigned long long presetHash,
+                                                 size_t presetSize) {
+  PluginPresetCacheEntry entry = pluginPresetCacheFind(
+      pluginVst2xGetUniqueId(plugin), pluginVst2xGetVersion(plugin),
+      presetHash, presetSize);
+
+  if (entry == NULL) {
+    return false;
+  }
+
+  logDebug("Restoring preset '%s' from cached plugin state",
+           pluginPreset->presetName->data);
+
+  if (entry->isBank) {
+    pluginVst2xSetBankChunk(plugin, (char *)entry->chunk, entry->chunkSize);
+  } else {
+    pluginVst2xSetProgramChunk(plugin, (char *)entry->chunk, entry->chunkSize);
+    charStringCopy(pluginPreset->presetName, entry->programName);
+  }
+
+  return true;
+}
+
+static void _storePluginPresetFxpInCache(PluginPreset pluginPreset,
+                                         Plugin plugin,
+                                         unsigned long long presetHash,
+                                         size_t presetSize, boolByte isBank) {
+  byte *chunk = NULL;
+  size_t chunkSize = pluginVst2xGetChunk(plugin, isBank, &chunk);
+
+  if (pluginPresetCacheAdd(pluginVst2xGetUniqueId(plugin),
+                           pluginVst2xGetVersion(plugin), presetHash,
+                           presetSize, isBank, pluginPreset->presetName, chunk,
+                           chunkSize)) {
+    logDebug("Cached %lu bytes of plugin state for preset '%s'",
+             (unsigned long)chunkSize, pluginPreset->presetName->data);
+  }
+}
+
+static boolByte _loadPluginPresetFxp(void *pluginPresetPtr, Plugin plugin) {
+  PluginPreset pluginPreset = (PluginPreset)pluginPresetPtr;
+  PluginPresetFxpData extraData =
+      (PluginPresetFxpData)(pluginPreset->extraData);
+  const byte *position = extraData->data;
+  const byte *end = extraData->data + extraData->dataSize;
+  FxpProgramMembers program;
+  PluginPresetFxpProgramType programType;
+  unsigned long long presetHash = 0;
+  boolByte useCache;
+
+  if (plugin->interfaceType != PLUGIN_TYPE_VST_2X) {
+    logInternalError("Load FXP preset to wrong plugin type");
+    return false;
+  } else if (extraData->data == NULL) {
+    logError("Preset '%s' has not been opened", pluginPreset->presetName->data);
+    return false;
+  }
+
+  // Only plugins which save their state as chunks can give us a snapshot
+  useCache = (boolByte)(pluginPresetCacheIsEnabled() &&
+                        pluginVst2xHasProgramChunks(plugin));
+
+  if (useCache) {
+    presetHash = pluginPresetCacheHash(extraData->data, extraData->dataSize);
+
+    if (_restorePluginPresetFxpFromCache(pluginPreset, plugin, presetHash,
+                                         extraData->dataSize)) {
+      return true;
+    }
+  }
+
+  memset(&program, 0, sizeof(FxpProgramMembers));
+  programType =
+      _readFxpHeader(pluginPreset, plugin, &program, &position, end);
+
+  switch (programType) {
+  case FXP_TYPE_REGULAR:
+  case FXP_TYPE_OPAQUE_CHUNK:
+    if (!_loadFxpProgram(plugin, &program, programType, &position, end)) {
       return false;
     }
 
-    // The chunk has been read, set it to the actual plugin
-    if (plugin->interfaceType == PLUGIN_TYPE_VST_2X) {
-      pluginVst2xSetProgramChunk(plugin, chunk, chunkSize);
-      free(inProgram);
-      free(chunk);
-      return true;
-    } else {
-      logInternalError("Load FXP preset to wrong plugin type");
-      free(inProgram);
-      free(chunk);
+    charStringCopyCString(pluginPreset->presetName, program.prgName);
+    logDebug("Preset's name is %s", pluginPreset->presetName->data);
+    break;
+
+  case FXP_TYPE_BANK_REGULAR:
+  case FXP_TYPE_BANK_OPAQUE_CHUNK:
+    if (!_loadFxbBank(plugin, &program, programType, &position, end)) {
       return false;
     }
-  } else {
-    logInternalError("Invalid FXP program type");
-    free(inProgram);
+
+    break;
+
+  default:
     return false;
   }
 
-  free(inProgram);
+  if (useCache) {
+    _storePluginPresetFxpInCache(
+        pluginPreset, plugin, presetHash, extraData->dataSize,
+        (boolByte)(programType == FXP_TYPE_BANK_REGULAR ||
+                   programType == FXP_TYPE_BANK_OPAQUE_CHUNK));
+  }
+
   return true;
 }
 
 static void _freePluginPresetDataFxp(void *extraDataPtr) {
   PluginPresetFxpData extraData = extraDataPtr;
-
-  if (extraData->fileHandle != NULL) {
-    fclose(extraData->fileHandle);
-  }
-
-  if (extraData->chunk != NULL) {
-    free(extraData->chunk);
-  }
+  memoryUsageRemove(kMemoryUsagePresetChunks, extraData->dataSize);
+  freeMappedFile(extraData->mappedFile);
+  free(extraData->chunk);
 }
 
 PluginPreset newPluginPresetFxp(const CharString presetName) {
@@ -284,8 +466,10 @@ PluginPreset newPluginPresetFxp(const CharString presetName) {
   pluginPreset->loadPreset = _loadPluginPresetFxp;
   pluginPreset->freePresetData = _freePluginPresetDataFxp;
 
-  extraData->fileHandle = NULL;
+  extraData->mappedFile = NULL;
   extraData->chunk = NULL;
+  extraData->data = NULL;
+  extraData->dataSize = 0;
   pluginPreset->extraData = extraData;
 
   return pluginPreset;
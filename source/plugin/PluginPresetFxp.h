@@ -27,6 +27,7 @@
 #ifndef MrsWatson_PluginPresetFxp_h
 #define MrsWatson_PluginPresetFxp_h
 
+#include "base/MappedFile.h"
 #include "plugin/PluginPreset.h"
 
 #include <stdio.h>
@@ -35,6 +36,8 @@ typedef enum {
   FXP_TYPE_INVALID,
   FXP_TYPE_REGULAR,
   FXP_TYPE_OPAQUE_CHUNK,
+  FXP_TYPE_BANK_REGULAR,
+  FXP_TYPE_BANK_OPAQUE_CHUNK,
 } PluginPresetFxpProgramType;
 
 // Copied from the VST SDK. Yes, this is a bit lame, but otherwise the C++
@@ -65,11 +68,23 @@ typedef struct {
 typedef FxpProgramMembers *FxpProgram;
 
 typedef struct {
-  FILE *fileHandle;
+  // The preset file is mapped into memory if possible, so that chunks can be
+  // passed to the plugin without being copied. Otherwise it is read into the
+  // chunk buffer.
+  MappedFile mappedFile;
   byte *chunk;
+  // Contents of the preset file, which point to either of the above
+  const byte *data;
+  size_t dataSize;
 } PluginPresetFxpDataMembers;
 typedef PluginPresetFxpDataMembers *PluginPresetFxpData;
 
+/**
+ * Create a preset which loads a VST program (.fxp) or bank (.fxb) file. The
+ * type of the file is determined from its contents.
+ * @param presetName Path to the preset file
+ * @return New preset
+ */
 PluginPreset newPluginPresetFxp(const CharString presetName);
 
 #endif
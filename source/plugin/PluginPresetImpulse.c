@@ -0,0 +1,153 @@
+//
+// PluginPresetImpulse.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "PluginPresetImpulse.h"
+
+#include "audio/AudioSettings.h"
+#include "io/SampleSource.h"
+#include "logging/EventLogger.h"
+#include "plugin/PluginConvolver.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const SampleCount kPluginPresetImpulseReadBlocksize = 4096;
+
+// Move the first numFrames frames of a buffer to a new one with twice the size
+static SampleBuffer _growBuffer(SampleBuffer buffer, SampleCount numFrames) {
+  SampleBuffer result =
+      newSampleBuffer(buffer->numChannels, buffer->blocksize * 2);
+  ChannelCount channel;
+
+  for (channel = 0; channel < buffer->numChannels; channel++) {
+    memcpy(result->samples[channel], buffer->samples[channel],
+           sizeof(Sample) * numFrames);
+  }
+
+  freeSampleBuffer(buffer);
+  return result;
+}
+
+static boolByte _openPluginPresetImpulse(void *pluginPresetPtr) {
+  PluginPreset pluginPreset = (PluginPreset)pluginPresetPtr;
+  PluginPresetImpulseData extraData =
+      (PluginPresetImpulseData)pluginPreset->extraData;
+  // Opening a source sets the audio settings to its format, which must not
+  // change the settings of the render
+  const SampleRate sampleRate = getSampleRate();
+  const ChannelCount numChannels = getNumChannels();
+  SampleSource source = sampleSourceFactory(pluginPreset->presetName);
+  SampleBuffer block;
+  SampleBuffer impulse;
+  SampleCount numFrames = 0;
+  boolByte moreBlocks = true;
+  ChannelCount channel;
+
+  if (source == NULL ||
+      source->sampleSourceType == SAMPLE_SOURCE_TYPE_INVALID ||
+      !source->openSampleSource(source, SAMPLE_SOURCE_OPEN_READ)) {
+    logError("Could not open impulse response '%s'",
+             pluginPreset->presetName->data);
+    freeSampleSource(source);
+    setSampleRate(sampleRate);
+    setNumChannels(numChannels);
+    return false;
+  }
+
+  extraData->sampleRate = getSampleRate();
+  block = newSampleBuffer(getNumChannels(), kPluginPresetImpulseReadBlocksize);
+  impulse =
+      newSampleBuffer(getNumChannels(), kPluginPresetImpulseReadBlocksize);
+
+  while (moreBlocks) {
+    block->blocksize = kPluginPresetImpulseReadBlocksize;
+    moreBlocks = source->readSampleBlock(source, block);
+
+    if (numFrames + block->blocksize > impulse->blocksize) {
+      impulse = _growBuffer(impulse, numFrames);
+    }
+
+    for (channel = 0; channel < block->numChannels; channel++) {
+      memcpy(impulse->samples[channel] + numFrames, block->samples[channel],
+             sizeof(Sample) * block->blocksize);
+    }
+
+    numFrames += block->blocksize;
+  }
+
+  // The buffer is usually larger than the impulse response, but its storage
+  // is freed in the same way whatever its blocksize
+  impulse->blocksize = numFrames;
+  source->closeSampleSource(source);
+  freeSampleSource(source);
+  freeSampleBuffer(block);
+  setSampleRate(sampleRate);
+  setNumChannels(numChannels);
+
+  if (numFrames == 0) {
+    logError("Impulse response '%s' is empty", pluginPreset->presetName->data);
+    freeSampleBuffer(impulse);
+    return false;
+  }
+
+  freeSampleBuffer(extraData->impulse);
+  extraData->impulse = impulse;
+  return true;
+}
+
+static boolByte _loadPluginPresetImpulse(void *pluginPresetPtr, Plugin plugin) {
+  PluginPreset pluginPreset = (PluginPreset)pluginPresetPtr;
+  PluginPresetImpulseData extraData =
+      (PluginPresetImpulseData)pluginPreset->extraData;
+  return extraData->impulse != NULL &&
+         pluginConvolverSetImpulse(plugin, extraData->impulse,
+                                   extraData->sampleRate);
+}
+
+static void _freePluginPresetImpulse(void *extraDataPtr) {
+  PluginPresetImpulseData extraData = (PluginPresetImpulseData)extraDataPtr;
+  freeSampleBuffer(extraData->impulse);
+}
+
+PluginPreset newPluginPresetImpulse(const CharString presetName) {
+  PluginPreset pluginPreset = (PluginPreset)malloc(sizeof(PluginPresetMembers));
+  PluginPresetImpulseData extraData = (PluginPresetImpulseData)malloc(
+      sizeof(PluginPresetImpulseDataMembers));
+
+  pluginPreset->presetType = PRESET_TYPE_IMPULSE;
+  pluginPreset->presetName = newCharString();
+  charStringCopy(pluginPreset->presetName, presetName);
+  pluginPreset->compatiblePluginTypes = 0;
+  pluginPresetSetCompatibleWith(pluginPreset, PLUGIN_TYPE_INTERNAL);
+
+  pluginPreset->openPreset = _openPluginPresetImpulse;
+  pluginPreset->loadPreset = _loadPluginPresetImpulse;
+  pluginPreset->freePresetData = _freePluginPresetImpulse;
+
+  extraData->impulse = NULL;
+  extraData->sampleRate = 0.0;
+  pluginPreset->extraData = extraData;
+  return pluginPreset;
+}
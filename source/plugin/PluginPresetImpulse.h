@@ -0,0 +1,48 @@
+//
+// PluginPresetImpulse.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_PluginPresetImpulse_h
+#define MrsWatson_PluginPresetImpulse_h
+
+#include "audio/SampleBuffer.h"
+#include "plugin/PluginPreset.h"
+
+typedef struct {
+  // Impulse response read from the file, or NULL before the preset is opened
+  SampleBuffer impulse;
+  SampleRate sampleRate;
+} PluginPresetImpulseDataMembers;
+typedef PluginPresetImpulseDataMembers *PluginPresetImpulseData;
+
+/**
+ * Create a preset which loads an audio file as the impulse response of the
+ * internal convolver plugin. The file may be in any format which can be read
+ * as an input source.
+ * @param presetName Path to the audio file
+ * @return New preset
+ */
+PluginPreset newPluginPresetImpulse(const CharString presetName);
+
+#endif
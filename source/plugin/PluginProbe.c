@@ -0,0 +1,412 @@
+//
+// PluginProbe.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "PluginProbe.h"
+
+#include "app/RenderContext.h"
+#include "audio/AudioSettings.h"
+#include "base/Process.h"
+#include "base/Thread.h"
+#include "base/XxHash.h"
+#include "logging/EventLogger.h"
+#include "midi/MidiEvent.h"
+#include "time/AudioClock.h"
+#include "time/TaskTimer.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#if UNIX
+#include <unistd.h>
+#endif
+
+// Long enough for plugins with a bit of latency or modulation to show that
+// their output differs between renders
+static const unsigned int kPluginProbeNumBlocks = 64;
+// Peak of the test signal, and the largest sample which is considered valid
+// output, since plugins with broken state tend to blow up instead of going
+// quiet
+static const Sample kPluginProbeInputPeak = 0.25f;
+static const double kPluginProbeMaxOutput = 1000.0;
+static const double kPluginProbeForkTimeoutInMs = 10000.0;
+static const double kPluginProbeForkPollIntervalInMs = 5.0;
+
+PluginProbe newPluginProbe(Plugin plugin,
+                           PluginProbeNewInstanceFunc newInstance,
+                           void *userData) {
+  PluginProbe self = (PluginProbe)malloc(sizeof(PluginProbeMembers));
+  int i;
+
+  self->plugin = plugin;
+  self->newInstance = newInstance;
+  self->newInstanceUserData = userData;
+  for (i = 0; i < PLUGIN_PROBE_NUM_INSTANCES; i++) {
+    self->_instances[i] = NULL;
+  }
+  self->_deterministic = PLUGIN_CAPABILITY_UNKNOWN;
+  self->_referenceHash = 0;
+
+  return self;
+}
+
+// Fill a block with noise which only depends on the seed, so that every render
+// gets the same input
+static void _pluginProbeFillInput(SampleBuffer input, unsigned int *seed) {
+  ChannelCount channel;
+  SampleCount frame;
+
+  for (channel = 0; channel < input->numChannels; channel++) {
+    for (frame = 0; frame < input->blocksize; frame++) {
+      *seed = *seed * 1664525u + 1013904223u;
+      input->samples[channel][frame] =
+          kPluginProbeInputPeak *
+          ((Sample)(*seed >> 8) / (Sample)(1u << 24) * 2.0f - 1.0f);
+    }
+  }
+}
+
+static void _pluginProbeSendNote(Plugin plugin, byte status) {
+  LinkedList midiEvents = newLinkedList();
+  MidiEvent midiEvent = newMidiEvent();
+
+  midiEvent->eventType = MIDI_TYPE_REGULAR;
+  midiEvent->status = status;
+  midiEvent->data1 = 60;
+  midiEvent->data2 = 100;
+  linkedListAppend(midiEvents, midiEvent);
+  plugin->processMidiEvents(plugin, midiEvents);
+  freeLinkedListAndItems(midiEvents, (LinkedListFreeItemFunc)freeMidiEvent);
+}
+
+/**
+ * Reset a plugin and render the test signal through it, in the same way that a
+ * plugin chain resets its plugins.
+ * @param plugin Open plugin
+ * @param outValid Set to false if the output contained samples which are not
+ * a number or much too loud
+ * @return Hash of the output
+ */
+static unsigned long long _pluginProbeRender(Plugin plugin,
+                                             boolByte *outValid) {
+  // The plugin may have been opened without openPlugin(), in which case it
+  // has no buffers of its own
+  SampleBuffer input = newSampleBuffer(
+      (ChannelCount)plugin->getSetting(plugin, PLUGIN_NUM_INPUTS),
+      getBlocksize());
+  SampleBuffer output = newSampleBuffer(
+      (ChannelCount)plugin->getSetting(plugin, PLUGIN_NUM_OUTPUTS),
+      getBlocksize());
+  XxHash hash = newXxHash(0);
+  unsigned long long result;
+  unsigned int seed = 1;
+  unsigned int block;
+  ChannelCount channel;
+  SampleCount frame;
+
+  *outValid = true;
+  audioClockReset(getAudioClock());
+  plugin->prepareForProcessing(plugin);
+
+  for (block = 0; block < kPluginProbeNumBlocks; block++) {
+    if (plugin->pluginType == PLUGIN_TYPE_INSTRUMENT) {
+      if (block == 0) {
+        _pluginProbeSendNote(plugin, 0x90);
+      } else if (block == kPluginProbeNumBlocks / 2) {
+        _pluginProbeSendNote(plugin, 0x80);
+      }
+    }
+
+    _pluginProbeFillInput(input, &seed);
+    sampleBufferClear(output);
+    plugin->processAudio(plugin, input, output);
+    advanceAudioClock(getAudioClock(), output->blocksize);
+
+    for (channel = 0; channel < output->numChannels; channel++) {
+      for (frame = 0; frame < output->blocksize; frame++) {
+        if (!(fabs(output->samples[channel][frame]) <=
+              kPluginProbeMaxOutput)) {
+          *outValid = false;
+        }
+      }
+      xxHashUpdate(hash, output->samples[channel],
+                   output->blocksize * sizeof(Sample));
+    }
+  }
+
+  plugin->closePlugin(plugin);
+  result = xxHashDigest(hash);
+  freeXxHash(hash);
+  freeSampleBuffer(input);
+  freeSampleBuffer(output);
+  return result;
+}
+
+static PluginCapabilityState _pluginProbeDeterministic(PluginProbe self) {
+  unsigned long long secondHash;
+  boolByte valid;
+
+  if (self->_deterministic == PLUGIN_CAPABILITY_UNKNOWN) {
+    self->_referenceHash = _pluginProbeRender(self->plugin, &valid);
+    secondHash = _pluginProbeRender(self->plugin, &valid);
+    self->_deterministic = secondHash == self->_referenceHash
+                               ? PLUGIN_CAPABILITY_SUPPORTED
+                               : PLUGIN_CAPABILITY_UNSUPPORTED;
+  }
+
+  return self->_deterministic;
+}
+
+typedef struct {
+  Plugin plugin;
+  RenderContext renderContext;
+  boolByte render;
+  Thread thread;
+  boolByte result;
+  unsigned long long hash;
+} _PluginProbeJobMembers;
+
+static void _pluginProbeJobThread(void *userData) {
+  _PluginProbeJobMembers *job = (_PluginProbeJobMembers *)userData;
+
+  renderContextMakeCurrent(job->renderContext);
+  if (job->render) {
+    job->hash = _pluginProbeRender(job->plugin, &job->result);
+  } else {
+    job->result = openPlugin(job->plugin);
+  }
+  renderContextMakeCurrent(NULL);
+}
+
+// Open or render all instances at the same time, each on its own thread with
+// its own render context
+static boolByte _pluginProbeRunJobs(PluginProbe self, boolByte render,
+                                    unsigned long long *outHashes) {
+  _PluginProbeJobMembers jobs[PLUGIN_PROBE_NUM_INSTANCES];
+  boolByte result = true;
+  int i;
+
+  for (i = 0; i < PLUGIN_PROBE_NUM_INSTANCES; i++) {
+    jobs[i].plugin = self->_instances[i];
+    jobs[i].renderContext = newRenderContext();
+    jobs[i].render = render;
+    jobs[i].result = false;
+    jobs[i].hash = 0;
+    jobs[i].thread = newThread(_pluginProbeJobThread, &jobs[i]);
+  }
+
+  for (i = 0; i < PLUGIN_PROBE_NUM_INSTANCES; i++) {
+    if (jobs[i].thread != NULL) {
+      threadJoinAndFree(jobs[i].thread);
+    } else {
+      logWarn("Could not start probe thread for plugin '%s'",
+              self->plugin->pluginName->data);
+      jobs[i].result = false;
+    }
+
+    freeRenderContext(jobs[i].renderContext);
+    result = (boolByte)(result && jobs[i].result);
+    if (outHashes != NULL) {
+      outHashes[i] = jobs[i].hash;
+    }
+  }
+
+  return result;
+}
+
+static void _pluginProbeFreeInstances(PluginProbe self) {
+  int i;
+
+  for (i = 0; i < PLUGIN_PROBE_NUM_INSTANCES; i++) {
+    if (self->_instances[i] != NULL && self->_instances[i]->isOpen) {
+      closePlugin(self->_instances[i]);
+    }
+    freePlugin(self->_instances[i]);
+    self->_instances[i] = NULL;
+  }
+}
+
+/**
+ * Create and open the other instances of the plugin, unless they have already
+ * been opened.
+ * @param inParallel Open all instances at the same time
+ * @param outOpened Set to false if any instance could not be opened
+ * @return False if the instances could not be created
+ */
+static boolByte _pluginProbeOpenInstances(PluginProbe self,
+                                          boolByte inParallel,
+                                          boolByte *outOpened) {
+  int i;
+
+  *outOpened = true;
+  if (self->_instances[0] != NULL) {
+    return true;
+  } else if (self->newInstance == NULL) {
+    return false;
+  }
+
+  for (i = 0; i < PLUGIN_PROBE_NUM_INSTANCES; i++) {
+    self->_instances[i] = self->newInstance(self->newInstanceUserData);
+    if (self->_instances[i] == NULL) {
+      _pluginProbeFreeInstances(self);
+      return false;
+    }
+  }
+
+  if (inParallel) {
+    *outOpened = _pluginProbeRunJobs(self, false, NULL);
+  } else {
+    for (i = 0; i < PLUGIN_PROBE_NUM_INSTANCES; i++) {
+      *outOpened = (boolByte)(*outOpened && openPlugin(self->_instances[i]));
+    }
+  }
+
+  if (!*outOpened) {
+    _pluginProbeFreeInstances(self);
+  }
+
+  return true;
+}
+
+static PluginCapabilityState _pluginProbeParallelLoad(PluginProbe self) {
+  boolByte opened;
+
+  if (!_pluginProbeOpenInstances(self, true, &opened)) {
+    return PLUGIN_CAPABILITY_UNKNOWN;
+  }
+
+  return opened ? PLUGIN_CAPABILITY_SUPPORTED : PLUGIN_CAPABILITY_UNSUPPORTED;
+}
+
+static PluginCapabilityState _pluginProbeMultiInstance(PluginProbe self) {
+  unsigned long long hashes[PLUGIN_PROBE_NUM_INSTANCES];
+  boolByte opened;
+  int i;
+
+  // Instances which interfere with each other can only be told apart from
+  // random output when the plugin is deterministic on its own
+  if (_pluginProbeDeterministic(self) != PLUGIN_CAPABILITY_SUPPORTED ||
+      !_pluginProbeOpenInstances(self, false, &opened) || !opened) {
+    return PLUGIN_CAPABILITY_UNKNOWN;
+  }
+
+  if (!_pluginProbeRunJobs(self, true, hashes)) {
+    return PLUGIN_CAPABILITY_UNSUPPORTED;
+  }
+
+  for (i = 0; i < PLUGIN_PROBE_NUM_INSTANCES; i++) {
+    if (hashes[i] != self->_referenceHash) {
+      return PLUGIN_CAPABILITY_UNSUPPORTED;
+    }
+  }
+
+  return PLUGIN_CAPABILITY_SUPPORTED;
+}
+
+static PluginCapabilityState _pluginProbeForkSafe(PluginProbe self) {
+#if UNIX
+  const PluginCapabilityState deterministic = _pluginProbeDeterministic(self);
+  Process child;
+  boolByte isChild;
+  boolByte valid;
+  unsigned long long hash;
+  double waitedInMs = 0.0;
+
+  child = newProcessForked(&isChild);
+  if (isChild) {
+    // Skip the exit handlers, which belong to the parent
+    hash = _pluginProbeRender(self->plugin, &valid);
+    _exit(valid && (deterministic != PLUGIN_CAPABILITY_SUPPORTED ||
+                    hash == self->_referenceHash)
+              ? 0
+              : 1);
+  } else if (child == NULL) {
+    return PLUGIN_CAPABILITY_UNKNOWN;
+  }
+
+  // Plugins with threads of their own often hang after a fork, since the
+  // threads do not exist in the child
+  while (!processPoll(child) && waitedInMs < kPluginProbeForkTimeoutInMs) {
+    taskTimerSleep(kPluginProbeForkPollIntervalInMs);
+    waitedInMs += kPluginProbeForkPollIntervalInMs;
+  }
+
+  processKill(child);
+  valid = (boolByte)(child->exitCode == 0);
+  freeProcess(child);
+  return valid ? PLUGIN_CAPABILITY_SUPPORTED : PLUGIN_CAPABILITY_UNSUPPORTED;
+#else
+  return PLUGIN_CAPABILITY_UNKNOWN;
+#endif
+}
+
+static PluginCapabilityState _pluginProbeOffline(PluginProbe self) {
+  boolByte valid;
+
+  _pluginProbeRender(self->plugin, &valid);
+  return valid ? PLUGIN_CAPABILITY_SUPPORTED : PLUGIN_CAPABILITY_UNSUPPORTED;
+}
+
+PluginCapabilityState pluginProbeRun(PluginProbe self,
+                                     PluginCapability capability) {
+  PluginCapabilityState result;
+
+  switch (capability) {
+  case PLUGIN_CAPABILITY_PARALLEL_LOAD:
+    result = _pluginProbeParallelLoad(self);
+    break;
+
+  case PLUGIN_CAPABILITY_MULTI_INSTANCE:
+    result = _pluginProbeMultiInstance(self);
+    break;
+
+  case PLUGIN_CAPABILITY_FORK_SAFE:
+    result = _pluginProbeForkSafe(self);
+    break;
+
+  case PLUGIN_CAPABILITY_DETERMINISTIC:
+    result = _pluginProbeDeterministic(self);
+    break;
+
+  case PLUGIN_CAPABILITY_OFFLINE:
+    result = _pluginProbeOffline(self);
+    break;
+
+  default:
+    result = PLUGIN_CAPABILITY_UNKNOWN;
+    break;
+  }
+
+  logDebug("Plugin '%s' probed as %s: %s", self->plugin->pluginName->data,
+           pluginCapabilityGetName(capability),
+           pluginCapabilityStateGetName(result));
+  return result;
+}
+
+void freePluginProbe(PluginProbe self) {
+  if (self != NULL) {
+    _pluginProbeFreeInstances(self);
+    free(self);
+  }
+}
@@ -0,0 +1,94 @@
+//
+// PluginProbe.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_PluginProbe_h
+#define MrsWatson_PluginProbe_h
+
+#include "base/Types.h"
+#include "plugin/Plugin.h"
+#include "plugin/PluginCapabilities.h"
+
+#define PLUGIN_PROBE_NUM_INSTANCES 2
+
+/**
+ * Called by probes which need more instances of the plugin being probed.
+ * @param userData User data which was passed to newPluginProbe()
+ * @return New plugin which has not been opened yet, or NULL
+ */
+typedef Plugin (*PluginProbeNewInstanceFunc)(void *userData);
+
+/**
+ * Finds out the capabilities of a plugin by trying them. Each probe renders a
+ * fixed test signal through the plugin, or a note for instruments, and compares
+ * hashes of the output. Probes may crash or hang with misbehaving plugins, so
+ * they should only be run in a process which exists for that purpose, like the
+ * child processes of the plugin scanner.
+ */
+typedef struct {
+  Plugin plugin;
+  PluginProbeNewInstanceFunc newInstance;
+  void *newInstanceUserData;
+
+  /** Private, more instances which are opened by the probes which need them */
+  Plugin _instances[PLUGIN_PROBE_NUM_INSTANCES];
+  /** Private, set once the plugin has rendered the test signal twice */
+  PluginCapabilityState _deterministic;
+  /** Private, hash of the first render of the test signal */
+  unsigned long long _referenceHash;
+} PluginProbeMembers;
+typedef PluginProbeMembers *PluginProbe;
+
+/**
+ * Create a probe for a plugin.
+ * @param plugin Plugin to probe, which must be open. This is not owned by the
+ * probe.
+ * @param newInstance Function to create more instances of the plugin, or NULL
+ * if the probes which need them should not be run
+ * @param userData User data to pass to newInstance
+ * @return New plugin probe
+ */
+PluginProbe newPluginProbe(Plugin plugin,
+                           PluginProbeNewInstanceFunc newInstance,
+                           void *userData);
+
+/**
+ * Probe a single capability. Since the offline probe only checks that the
+ * plugin still renders valid output, the plugin must be told that processing
+ * happens offline before that probe is run, and it should be probed last.
+ * @param self
+ * @param capability Capability to probe
+ * @return Result of the probe, which is PLUGIN_CAPABILITY_UNKNOWN if the
+ * capability cannot be probed for this plugin or on this platform
+ */
+PluginCapabilityState pluginProbeRun(PluginProbe self,
+                                     PluginCapability capability);
+
+/**
+ * Release a plugin probe and close the instances which it has opened.
+ * @param self
+ */
+void freePluginProbe(PluginProbe self);
+
+#endif
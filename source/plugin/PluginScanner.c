@@ -0,0 +1,369 @@
+//
+// PluginScanner.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PluginScanner.h"
+
+#include "base/Process.h"
+#include "logging/EventLogger.h"
+#include "time/TaskTimer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char *kPluginScannerResultTag = "PLUGIN";
+static const char *kPluginScannerShellPluginTag = "SHELL";
+static const char *kPluginScannerProbeTag = "PROBE";
+static const char *kPluginScannerCapabilityTag = "CAPABILITY";
+static const double kPluginScannerPollIntervalInMs = 5.0;
+
+typedef struct {
+  CharString pluginPath;
+  PluginIndexEntry entry;
+  Process process;
+  TaskTimer timer;
+} _PluginScannerJobMembers;
+typedef _PluginScannerJobMembers *_PluginScannerJob;
+
+static void _freePluginScannerJob(void *item) {
+  _PluginScannerJob job = (_PluginScannerJob)item;
+
+  if (job != NULL) {
+    freeCharString(job->pluginPath);
+    freeProcess(job->process);
+    freeTaskTimer(job->timer);
+    free(job);
+  }
+}
+
+PluginScanner newPluginScanner(const CharString executable,
+                               LinkedList arguments, unsigned int numJobs,
+                               double timeoutInMs) {
+  PluginScanner self = (PluginScanner)malloc(sizeof(PluginScannerMembers));
+  LinkedListIterator iterator;
+
+  self->executable = newCharStringWithCString(executable->data);
+  self->arguments = newLinkedList();
+  for (iterator = arguments; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    if (iterator->item != NULL) {
+      linkedListAppend(self->arguments,
+                       newCharStringWithCString(
+                           ((CharString)iterator->item)->data));
+    }
+  }
+  self->numJobs = numJobs > 0 ? numJobs : 1;
+  self->timeoutInMs = timeoutInMs;
+  self->_jobs = newLinkedList();
+
+  return self;
+}
+
+void pluginScannerAdd(PluginScanner self, const CharString pluginPath,
+                      PluginIndexEntry entry) {
+  _PluginScannerJob job =
+      (_PluginScannerJob)malloc(sizeof(_PluginScannerJobMembers));
+
+  job->pluginPath = newCharStringWithCString(pluginPath->data);
+  job->entry = entry;
+  job->process = NULL;
+  job->timer = newTaskTimerWithCString("PluginScanner", pluginPath->data);
+  linkedListAppend(self->_jobs, job);
+}
+
+static boolByte _startJob(PluginScanner self, _PluginScannerJob job) {
+  LinkedList arguments = newLinkedList();
+  LinkedListIterator iterator;
+
+  for (iterator = self->arguments; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    if (iterator->item != NULL) {
+      linkedListAppend(arguments, iterator->item);
+    }
+  }
+  linkedListAppend(arguments, job->pluginPath);
+
+  logDebug("Scanning plugin '%s'", job->pluginPath->data);
+  job->process = newProcess(self->executable, arguments);
+  taskTimerStart(job->timer);
+
+  // The arguments are owned by the scanner and the job
+  freeLinkedList(arguments);
+  return (boolByte)(job->process != NULL);
+}
+
+static void _markUnsupported(_PluginScannerJob job, const char *reason) {
+  logWarn("Could not scan plugin '%s', %s", job->pluginPath->data, reason);
+  job->entry->scanned = true;
+  job->entry->pluginType = PLUGIN_TYPE_UNSUPPORTED;
+}
+
+// Check if the last line which the child wrote about probes announced a
+// probe, which means that the child died during that probe
+static boolByte _isProbing(const CharString output) {
+  const char *line = output->data;
+  const size_t probeTagLength = strlen(kPluginScannerProbeTag);
+  const size_t capabilityTagLength = strlen(kPluginScannerCapabilityTag);
+  boolByte result = false;
+
+  while (line != NULL && *line != '\0') {
+    if (!strncmp(line, kPluginScannerProbeTag, probeTagLength) &&
+        line[probeTagLength] == '\t') {
+      result = true;
+    } else if (!strncmp(line, kPluginScannerCapabilityTag,
+                        capabilityTagLength) &&
+               line[capabilityTagLength] == '\t') {
+      result = false;
+    }
+
+    line = strchr(line, '\n');
+    line = line != NULL ? line + 1 : NULL;
+  }
+
+  return result;
+}
+
+static boolByte _finishJob(_PluginScannerJob job) {
+  boolByte parsed =
+      pluginScannerParseResult(job->entry, job->process->output);
+
+  if (job->process->exitCode != 0) {
+    if (!parsed || !_isProbing(job->process->output)) {
+      _markUnsupported(job, "plugin crashed or failed to load");
+      return false;
+    }
+
+    logWarn("Plugin '%s' crashed while its capabilities were probed",
+            job->pluginPath->data);
+  } else if (!parsed) {
+    _markUnsupported(job, "no information was returned");
+    return false;
+  }
+
+  logInfo("Scanned plugin '%s'", job->pluginPath->data);
+  return true;
+}
+
+unsigned int pluginScannerRun(PluginScanner self) {
+  _PluginScannerJob *running = (_PluginScannerJob *)calloc(
+      self->numJobs, sizeof(_PluginScannerJob));
+  LinkedListIterator nextJob = self->_jobs;
+  unsigned int numRunning = 0;
+  unsigned int numScanned = 0;
+  unsigned int i;
+
+  while (true) {
+    // Start new children for any free slots
+    for (i = 0; i < self->numJobs; i++) {
+      while (running[i] == NULL && nextJob != NULL) {
+        _PluginScannerJob job = (_PluginScannerJob)nextJob->item;
+        nextJob = (LinkedListIterator)nextJob->nextItem;
+
+        if (job == NULL) {
+          continue;
+        } else if (_startJob(self, job)) {
+          running[i] = job;
+          numRunning++;
+        } else {
+          _markUnsupported(job, "scanner process could not be started");
+        }
+      }
+    }
+
+    if (numRunning == 0) {
+      break;
+    }
+
+    taskTimerSleep(kPluginScannerPollIntervalInMs);
+
+    for (i = 0; i < self->numJobs; i++) {
+      _PluginScannerJob job = running[i];
+
+      if (job == NULL) {
+        continue;
+      }
+
+      taskTimerStop(job->timer);
+      if (processPoll(job->process)) {
+        if (_finishJob(job)) {
+          numScanned++;
+        }
+      } else if (job->timer->totalTaskTime > self->timeoutInMs) {
+        processKill(job->process);
+        _markUnsupported(job, "timed out");
+      } else {
+        taskTimerStart(job->timer);
+        continue;
+      }
+
+      freeProcess(job->process);
+      job->process = NULL;
+      running[i] = NULL;
+      numRunning--;
+    }
+  }
+
+  free(running);
+  freeLinkedListAndItems(self->_jobs, _freePluginScannerJob);
+  self->_jobs = newLinkedList();
+  return numScanned;
+}
+
+void pluginScannerWriteResult(FILE *output, PluginType pluginType,
+                              unsigned long uniqueId, int numInputs,
+                              int numOutputs) {
+  fprintf(output, "%s\t%d\t%lu\t%d\t%d\n", kPluginScannerResultTag,
+          pluginType, uniqueId, numInputs, numOutputs);
+}
+
+void pluginScannerWriteShellPlugin(FILE *output, unsigned long uniqueId,
+                                   const char *name) {
+  fprintf(output, "%s\t%lu\t%s\n", kPluginScannerShellPluginTag, uniqueId,
+          name);
+}
+
+void pluginScannerWriteProbe(FILE *output, PluginCapability capability) {
+  fprintf(output, "%s\t%s\n", kPluginScannerProbeTag,
+          pluginCapabilityGetName(capability));
+}
+
+void pluginScannerWriteCapability(FILE *output, PluginCapability capability,
+                                  PluginCapabilityState state) {
+  fprintf(output, "%s\t%s\t%s\n", kPluginScannerCapabilityTag,
+          pluginCapabilityGetName(capability),
+          pluginCapabilityStateGetName(state));
+}
+
+// Parse a line with the name of a capability, and optionally its state
+static PluginCapability _parseCapability(char *fields,
+                                         PluginCapabilityState *outState) {
+  char *separator = strchr(fields, '\t');
+  PluginCapability capability;
+
+  if (separator != NULL) {
+    *separator = '\0';
+  }
+
+  capability = pluginCapabilityWithName(fields);
+  *outState = separator != NULL ? pluginCapabilityStateWithName(separator + 1)
+                                : NUM_PLUGIN_CAPABILITY_STATES;
+  return capability;
+}
+
+boolByte pluginScannerParseResult(PluginIndexEntry entry,
+                                  const CharString output) {
+  LinkedList lines = charStringSplit(output, '\n');
+  LinkedListIterator iterator;
+  boolByte result = false;
+  size_t resultTagLength = strlen(kPluginScannerResultTag);
+  size_t shellPluginTagLength = strlen(kPluginScannerShellPluginTag);
+  size_t probeTagLength = strlen(kPluginScannerProbeTag);
+  size_t capabilityTagLength = strlen(kPluginScannerCapabilityTag);
+  PluginCapability capability;
+  PluginCapabilityState state;
+
+  for (iterator = lines; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    CharString line = (CharString)iterator->item;
+    int pluginType;
+    unsigned long uniqueId;
+    int numInputs;
+    int numOutputs;
+    char *name;
+
+    // Plugins may print their own junk to stdout, so only lines which start
+    // with one of the tags are considered
+    if (line == NULL) {
+      continue;
+    }
+
+    // Text mode output on Windows ends each line with CRLF
+    name = strrchr(line->data, '\r');
+    if (name != NULL && name[1] == '\0') {
+      *name = '\0';
+    }
+
+    if (!strncmp(line->data, kPluginScannerResultTag,
+                        resultTagLength) &&
+               line->data[resultTagLength] == '\t' &&
+               sscanf(line->data + resultTagLength + 1, "%d\t%lu\t%d\t%d",
+                      &pluginType, &uniqueId, &numInputs, &numOutputs) == 4) {
+      entry->scanned = true;
+      entry->pluginType = (PluginType)pluginType;
+      freePluginVst2xId(entry->pluginId);
+      entry->pluginId = newPluginVst2xIdWithId(uniqueId);
+      entry->numInputs = numInputs;
+      entry->numOutputs = numOutputs;
+      freeLinkedListAndItems(
+          entry->shellPlugins,
+          (LinkedListFreeItemFunc)freePluginIndexShellPlugin);
+      entry->shellPlugins = newLinkedList();
+      freePluginCapabilities(entry->capabilities);
+      entry->capabilities = newPluginCapabilities();
+      result = true;
+    } else if (result &&
+               !strncmp(line->data, kPluginScannerShellPluginTag,
+                        shellPluginTagLength) &&
+               line->data[shellPluginTagLength] == '\t') {
+      uniqueId = strtoul(line->data + shellPluginTagLength + 1, &name, 10);
+      if (*name == '\t') {
+        linkedListAppend(entry->shellPlugins,
+                         newPluginIndexShellPlugin(uniqueId, name + 1));
+      }
+    } else if (result &&
+               !strncmp(line->data, kPluginScannerProbeTag, probeTagLength) &&
+               line->data[probeTagLength] == '\t') {
+      capability =
+          _parseCapability(line->data + probeTagLength + 1, &state);
+      if (capability < NUM_PLUGIN_CAPABILITIES) {
+        entry->capabilities->states[capability] =
+            PLUGIN_CAPABILITY_UNSUPPORTED;
+      }
+    } else if (result &&
+               !strncmp(line->data, kPluginScannerCapabilityTag,
+                        capabilityTagLength) &&
+               line->data[capabilityTagLength] == '\t') {
+      capability =
+          _parseCapability(line->data + capabilityTagLength + 1, &state);
+      if (capability < NUM_PLUGIN_CAPABILITIES &&
+          state < NUM_PLUGIN_CAPABILITY_STATES) {
+        entry->capabilities->states[capability] = state;
+      }
+    }
+  }
+
+  freeLinkedListAndItems(lines, (LinkedListFreeItemFunc)freeCharString);
+  return result;
+}
+
+void freePluginScanner(PluginScanner self) {
+  if (self != NULL) {
+    freeCharString(self->executable);
+    freeLinkedListAndItems(self->arguments,
+                           (LinkedListFreeItemFunc)freeCharString);
+    freeLinkedListAndItems(self->_jobs, _freePluginScannerJob);
+    free(self);
+  }
+}
@@ -0,0 +1,142 @@
+//
+// PluginScanner.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_PluginScanner_h
+#define MrsWatson_PluginScanner_h
+
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+#include "plugin/PluginIndex.h"
+
+#include <stdio.h>
+
+typedef struct {
+  CharString executable;
+  /** List of CharString arguments which come before the plugin path */
+  LinkedList arguments;
+  unsigned int numJobs;
+  double timeoutInMs;
+
+  /** Private, list of plugins waiting to be scanned */
+  LinkedList _jobs;
+} PluginScannerMembers;
+typedef PluginScannerMembers *PluginScanner;
+
+/**
+ * Create a scanner which collects plugin information by loading each plugin in
+ * a separate child process. A plugin which crashes or hangs therefore only
+ * takes down its own process, and several plugins can be loaded at once.
+ *
+ * Each child is started with the given arguments followed by the absolute
+ * path to the plugin, and must print its results in the format written by
+ * pluginScannerWriteResult().
+ *
+ * @param executable Absolute path to the scanner executable
+ * @param arguments List of CharString arguments, which are copied
+ * @param numJobs Maximum number of child processes to run at once
+ * @param timeoutInMs Time after which a child process is killed
+ * @return New plugin scanner
+ */
+PluginScanner newPluginScanner(const CharString executable,
+                               LinkedList arguments, unsigned int numJobs,
+                               double timeoutInMs);
+
+/**
+ * Queue a plugin to be scanned.
+ * @param self
+ * @param pluginPath Absolute path to the plugin
+ * @param entry Index entry which receives the results, not owned
+ */
+void pluginScannerAdd(PluginScanner self, const CharString pluginPath,
+                      PluginIndexEntry entry);
+
+/**
+ * Scan all queued plugins, and block until every child process has finished
+ * or timed out. Plugins which could not be scanned are marked as unsupported
+ * in the index, so that they are not scanned again until they are modified.
+ * @param self
+ * @return Number of plugins which were scanned successfully
+ */
+unsigned int pluginScannerRun(PluginScanner self);
+
+/**
+ * Write the results for a scanned plugin. This is called in the child process.
+ * @param output File to write to, normally stdout
+ * @param pluginType Type of the plugin
+ * @param uniqueId VST unique ID
+ * @param numInputs Number of audio inputs
+ * @param numOutputs Number of audio outputs
+ */
+void pluginScannerWriteResult(FILE *output, PluginType pluginType,
+                              unsigned long uniqueId, int numInputs,
+                              int numOutputs);
+
+/**
+ * Write a sub-plugin of a shell plugin. This is called in the child process,
+ * after pluginScannerWriteResult().
+ * @param output File to write to, normally stdout
+ * @param uniqueId Sub-plugin ID
+ * @param name Sub-plugin name
+ */
+void pluginScannerWriteShellPlugin(FILE *output, unsigned long uniqueId,
+                                   const char *name);
+
+/**
+ * Announce that a capability of the scanned plugin is about to be probed. This
+ * is called in the child process, after pluginScannerWriteResult(). Until the
+ * result of the probe has been written, the plugin is assumed not to have the
+ * capability, so a plugin which crashes during a probe is still indexed.
+ * @param output File to write to, normally stdout
+ * @param capability Capability which is probed next
+ */
+void pluginScannerWriteProbe(FILE *output, PluginCapability capability);
+
+/**
+ * Write the result of probing a capability of the scanned plugin. This is
+ * called in the child process, after pluginScannerWriteProbe().
+ * @param output File to write to, normally stdout
+ * @param capability Capability which was probed
+ * @param state Result of the probe
+ */
+void pluginScannerWriteCapability(FILE *output, PluginCapability capability,
+                                  PluginCapabilityState state);
+
+/**
+ * Parse the output of a child process into an index entry.
+ * @param entry Entry to fill in
+ * @param output Output of the child process
+ * @return True if the output contained a result
+ */
+boolByte pluginScannerParseResult(PluginIndexEntry entry,
+                                  const CharString output);
+
+/**
+ * Release a plugin scanner and any plugins which are still queued.
+ * @param self
+ */
+void freePluginScanner(PluginScanner self);
+
+#endif
@@ -0,0 +1,300 @@
+//
+// PluginSine.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "PluginSine.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+#include "midi/MidiEvent.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *kInternalPluginSineName = INTERNAL_PLUGIN_PREFIX "sine";
+
+// M_PI is not part of C99
+static const double kSineTwoPi = 2.0 * 3.14159265358979323846;
+
+// Leaves enough headroom for all voices to sound at once without clipping
+static const float kSineMaxAmplitude = 0.25f;
+// Attack and release are short ramps, which is just enough to avoid clicks
+static const double kSineEnvelopeTimeInMs = 5.0;
+
+static void _pluginSineEmpty(void *pluginPtr) {
+  // Nothing to do here
+}
+
+static boolByte _pluginSineOpen(void *pluginPtr) { return true; }
+
+static void _pluginSineDisplayInfo(void *pluginPtr) {
+  logInfo("Information for Internal plugin '%s'", kInternalPluginSineName);
+  logInfo("Type: instrument, parameters: none");
+  logInfo("Description: a %d voice instrument which plays sine waves",
+          PLUGIN_SINE_NUM_VOICES);
+}
+
+static int _pluginSineGetSetting(void *pluginPtr, PluginSetting pluginSetting) {
+  switch (pluginSetting) {
+  case PLUGIN_SETTING_TAIL_TIME_IN_MS:
+    return (int)kSineEnvelopeTimeInMs;
+
+  case PLUGIN_NUM_INPUTS:
+    return 0;
+
+  case PLUGIN_NUM_OUTPUTS:
+    return 2;
+
+  case PLUGIN_INITIAL_DELAY:
+    return 0;
+
+  default:
+    return 0;
+  }
+}
+
+static void _pluginSinePrepare(void *pluginPtr) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginSineSettings settings = (PluginSineSettings)plugin->extraData;
+  settings->envelopeStep =
+      (float)(1000.0 / (kSineEnvelopeTimeInMs * getSampleRate()));
+  // Resetting the plugin chain prepares the plugin again, which must also
+  // silence any notes that were still playing
+  memset(settings->voices, 0, sizeof(settings->voices));
+  settings->numEvents = 0;
+}
+
+static void _noteOn(PluginSineSettings settings, byte note, byte velocity) {
+  PluginSineVoiceMembers *voice = NULL;
+  unsigned int i;
+
+  // Prefer a free voice, otherwise steal one which is already releasing, and
+  // as a last resort the first voice
+  for (i = 0; i < PLUGIN_SINE_NUM_VOICES; i++) {
+    if (!settings->voices[i].active) {
+      voice = &settings->voices[i];
+      break;
+    } else if (voice == NULL && settings->voices[i].releasing) {
+      voice = &settings->voices[i];
+    }
+  }
+
+  if (voice == NULL) {
+    voice = &settings->voices[0];
+  }
+
+  if (!voice->active) {
+    voice->phase = 0.0;
+    voice->envelope = 0.0f;
+  }
+
+  voice->active = true;
+  voice->releasing = false;
+  voice->note = note;
+  voice->amplitude = kSineMaxAmplitude * (float)velocity / 127.0f;
+  voice->phaseIncrement = kSineTwoPi * 440.0 *
+                          pow(2.0, ((double)note - 69.0) / 12.0) /
+                          getSampleRate();
+}
+
+static void _noteOff(PluginSineSettings settings, byte note) {
+  unsigned int i;
+
+  for (i = 0; i < PLUGIN_SINE_NUM_VOICES; i++) {
+    if (settings->voices[i].active && settings->voices[i].note == note) {
+      settings->voices[i].releasing = true;
+    }
+  }
+}
+
+static void _allNotesOff(PluginSineSettings settings) {
+  unsigned int i;
+
+  for (i = 0; i < PLUGIN_SINE_NUM_VOICES; i++) {
+    if (settings->voices[i].active) {
+      settings->voices[i].releasing = true;
+    }
+  }
+}
+
+static void _handleEvent(PluginSineSettings settings,
+                         const PluginSineEventMembers *event) {
+  switch (event->status & 0xf0) {
+  case 0x90:
+    if (event->data2 > 0) {
+      _noteOn(settings, event->data1, event->data2);
+    } else {
+      _noteOff(settings, event->data1);
+    }
+
+    break;
+
+  case 0x80:
+    _noteOff(settings, event->data1);
+    break;
+
+  case 0xb0:
+    // All sound off and all notes off
+    if (event->data1 == 0x78 || event->data1 == 0x7b) {
+      _allNotesOff(settings);
+    }
+
+    break;
+
+  default:
+    break;
+  }
+}
+
+static void _renderVoices(PluginSineSettings settings, SampleBuffer outputs,
+                          SampleCount start, SampleCount end) {
+  unsigned int v;
+  ChannelCount channel;
+  SampleCount i;
+
+  for (v = 0; v < PLUGIN_SINE_NUM_VOICES; v++) {
+    PluginSineVoiceMembers *voice = &settings->voices[v];
+
+    if (!voice->active) {
+      continue;
+    }
+
+    for (i = start; i < end; i++) {
+      Sample sample;
+
+      if (voice->releasing) {
+        voice->envelope -= settings->envelopeStep;
+
+        if (voice->envelope <= 0.0f) {
+          voice->active = false;
+          break;
+        }
+      } else if (voice->envelope < 1.0f) {
+        voice->envelope += settings->envelopeStep;
+
+        if (voice->envelope > 1.0f) {
+          voice->envelope = 1.0f;
+        }
+      }
+
+      sample = voice->amplitude * voice->envelope * (Sample)sin(voice->phase);
+      voice->phase += voice->phaseIncrement;
+
+      if (voice->phase >= kSineTwoPi) {
+        voice->phase -= kSineTwoPi;
+      }
+
+      for (channel = 0; channel < outputs->numChannels; channel++) {
+        outputs->samples[channel][i] += sample;
+      }
+    }
+  }
+}
+
+static void _pluginSineProcessAudio(void *pluginPtr, SampleBuffer inputs,
+                                    SampleBuffer outputs) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginSineSettings settings = (PluginSineSettings)plugin->extraData;
+  SampleCount position = 0;
+  unsigned int i;
+
+  sampleBufferClear(outputs);
+
+  for (i = 0; i < settings->numEvents; i++) {
+    SampleCount eventFrame = (SampleCount)settings->events[i].deltaFrames;
+
+    if (eventFrame > outputs->blocksize) {
+      eventFrame = outputs->blocksize;
+    }
+
+    if (eventFrame > position) {
+      _renderVoices(settings, outputs, position, eventFrame);
+      position = eventFrame;
+    }
+
+    _handleEvent(settings, &settings->events[i]);
+  }
+
+  _renderVoices(settings, outputs, position, outputs->blocksize);
+  settings->numEvents = 0;
+}
+
+static void _pluginSineProcessMidiEvents(void *pluginPtr,
+                                         LinkedList midiEvents) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginSineSettings settings = (PluginSineSettings)plugin->extraData;
+  LinkedListIterator iterator;
+  MidiEvent midiEvent;
+
+  for (iterator = linkedListBegin(midiEvents); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    midiEvent = (MidiEvent)linkedListIteratorGetItem(iterator);
+
+    if (midiEvent->eventType == MIDI_TYPE_REGULAR) {
+      if (settings->numEvents < PLUGIN_SINE_MAX_EVENTS) {
+        PluginSineEventMembers *event = &settings->events[settings->numEvents];
+        event->deltaFrames = midiEvent->deltaFrames;
+        event->status = midiEvent->status;
+        event->data1 = midiEvent->data1;
+        event->data2 = midiEvent->data2;
+        settings->numEvents++;
+      } else {
+        logWarn("Internal sine plugin dropped MIDI event, too many in block");
+      }
+    }
+  }
+}
+
+static boolByte _pluginSineSetParameter(void *pluginPtr, unsigned int i,
+                                        float value) {
+  logError("Attempt to set invalid parameter %d on internal sine plugin", i);
+  return false;
+}
+
+Plugin newPluginSine(const CharString pluginName) {
+  Plugin plugin = _newPlugin(PLUGIN_TYPE_INTERNAL, PLUGIN_TYPE_INSTRUMENT);
+  PluginSineSettings settings =
+      (PluginSineSettings)malloc(sizeof(PluginSineSettingsMembers));
+
+  charStringCopy(plugin->pluginName, pluginName);
+  charStringCopyCString(plugin->pluginLocation, "Internal");
+
+  plugin->openPlugin = _pluginSineOpen;
+  plugin->displayInfo = _pluginSineDisplayInfo;
+  plugin->getSetting = _pluginSineGetSetting;
+  plugin->prepareForProcessing = _pluginSinePrepare;
+  plugin->showEditor = _pluginSineEmpty;
+  plugin->processAudio = _pluginSineProcessAudio;
+  plugin->processMidiEvents = _pluginSineProcessMidiEvents;
+  plugin->setParameter = _pluginSineSetParameter;
+  plugin->closePlugin = _pluginSineEmpty;
+  plugin->freePluginData = _pluginSineEmpty;
+
+  memset(settings, 0, sizeof(PluginSineSettingsMembers));
+  settings->envelopeStep =
+      (float)(1000.0 / (kSineEnvelopeTimeInMs * getSampleRate()));
+  plugin->extraData = settings;
+  return plugin;
+}
@@ -0,0 +1,64 @@
+//
+// PluginSine.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_PluginSine_h
+#define MrsWatson_PluginSine_h
+
+#include "plugin/Plugin.h"
+
+#define PLUGIN_SINE_NUM_VOICES 16
+#define PLUGIN_SINE_MAX_EVENTS 256
+
+extern const char *kInternalPluginSineName;
+
+typedef struct {
+  boolByte active;
+  boolByte releasing;
+  byte note;
+  float amplitude;
+  double phase;
+  double phaseIncrement;
+  float envelope;
+} PluginSineVoiceMembers;
+
+typedef struct {
+  unsigned long deltaFrames;
+  byte status;
+  byte data1;
+  byte data2;
+} PluginSineEventMembers;
+
+typedef struct {
+  PluginSineVoiceMembers voices[PLUGIN_SINE_NUM_VOICES];
+  // Events for the next block, copied since the host owns the list
+  PluginSineEventMembers events[PLUGIN_SINE_MAX_EVENTS];
+  unsigned int numEvents;
+  float envelopeStep;
+} PluginSineSettingsMembers;
+typedef PluginSineSettingsMembers *PluginSineSettings;
+
+Plugin newPluginSine(const CharString pluginName);
+
+#endif
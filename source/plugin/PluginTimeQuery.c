@@ -0,0 +1,143 @@
+//
+// PluginTimeQuery.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "PluginTimeQuery.h"
+
+#include "audio/AudioSettings.h"
+#include "audio/SampleBuffer.h"
+#include "logging/EventLogger.h"
+#include "time/AudioClock.h"
+
+#include <stdlib.h>
+
+const char *kInternalPluginTimeQueryName = INTERNAL_PLUGIN_PREFIX "timequery";
+
+static const unsigned int kTimeQueryDefaultQueriesPerBlock = 100;
+
+static void _pluginTimeQueryEmpty(void *pluginPtr) {
+  // Nothing to do here
+}
+
+static boolByte _pluginTimeQueryOpen(void *pluginPtr) { return true; }
+
+static void _pluginTimeQueryDisplayInfo(void *pluginPtr) {
+  logInfo("Information for Internal plugin '%s'", kInternalPluginTimeQueryName);
+  logInfo("Type: effect, parameters: queries per block (0)");
+  logInfo("Description: passes audio through and asks the host for the "
+          "transport position many times in each block");
+}
+
+static int _pluginTimeQueryGetSetting(void *pluginPtr,
+                                      PluginSetting pluginSetting) {
+  switch (pluginSetting) {
+  case PLUGIN_SETTING_TAIL_TIME_IN_MS:
+    return 0;
+
+  case PLUGIN_NUM_INPUTS:
+    return 2;
+
+  case PLUGIN_NUM_OUTPUTS:
+    return 2;
+
+  case PLUGIN_INITIAL_DELAY:
+    return 0;
+
+  default:
+    return 0;
+  }
+}
+
+static void _pluginTimeQueryProcessAudio(void *pluginPtr, SampleBuffer inputs,
+                                         SampleBuffer outputs) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginTimeQuerySettings settings = (PluginTimeQuerySettings)plugin->extraData;
+  AudioClock audioClock = getAudioClock();
+  AudioClockPosition position;
+  unsigned int i;
+
+  sampleBufferCopyAndMapChannels(outputs, inputs);
+
+  // Internal plugins have no VST callback, but audioMasterGetTime answers from
+  // the same clock position, so this is the same work a VST plugin causes
+  for (i = 0; i < settings->queriesPerBlock; i++) {
+    position = audioClockGetPosition(audioClock);
+    settings->checksum += position->ppqPosition + position->barStartPosition +
+                          (double)audioClock->currentFrame + getTempo() +
+                          getSampleRate();
+  }
+}
+
+static void _pluginTimeQueryProcessMidiEvents(void *pluginPtr,
+                                              LinkedList midiEvents) {
+  // Nothing to do here
+}
+
+static boolByte _pluginTimeQuerySetParameter(void *pluginPtr, unsigned int i,
+                                             float value) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginTimeQuerySettings settings = (PluginTimeQuerySettings)plugin->extraData;
+
+  switch (i) {
+  case PLUGIN_TIME_QUERY_SETTINGS_QUERIES:
+    if (value < 0.0f) {
+      logError("Queries of internal time query plugin must not be negative");
+      return false;
+    }
+
+    settings->queriesPerBlock = (unsigned int)value;
+    return true;
+
+  default:
+    logError("Attempt to set invalid parameter %d on internal time query "
+             "plugin",
+             i);
+    return false;
+  }
+}
+
+Plugin newPluginTimeQuery(const CharString pluginName) {
+  Plugin plugin = _newPlugin(PLUGIN_TYPE_INTERNAL, PLUGIN_TYPE_EFFECT);
+  PluginTimeQuerySettings settings =
+      (PluginTimeQuerySettings)malloc(sizeof(PluginTimeQuerySettingsMembers));
+
+  charStringCopy(plugin->pluginName, pluginName);
+  charStringCopyCString(plugin->pluginLocation, "Internal");
+
+  plugin->openPlugin = _pluginTimeQueryOpen;
+  plugin->displayInfo = _pluginTimeQueryDisplayInfo;
+  plugin->getSetting = _pluginTimeQueryGetSetting;
+  plugin->prepareForProcessing = _pluginTimeQueryEmpty;
+  plugin->showEditor = _pluginTimeQueryEmpty;
+  plugin->processAudio = _pluginTimeQueryProcessAudio;
+  plugin->processMidiEvents = _pluginTimeQueryProcessMidiEvents;
+  plugin->setParameter = _pluginTimeQuerySetParameter;
+  plugin->closePlugin = _pluginTimeQueryEmpty;
+  plugin->freePluginData = _pluginTimeQueryEmpty;
+
+  settings->queriesPerBlock = kTimeQueryDefaultQueriesPerBlock;
+  settings->checksum = 0.0;
+  plugin->extraData = settings;
+  return plugin;
+}
@@ -0,0 +1,404 @@
+//
+// PluginTruePeakLimiter.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PluginTruePeakLimiter.h"
+
+#include "audio/AudioSettings.h"
+#include "audio/SampleBuffer.h"
+#include "audio/TruePeak.h"
+#include "logging/EventLogger.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *kInternalPluginTruePeakLimiterName =
+    INTERNAL_PLUGIN_PREFIX "truepeak_limiter";
+
+static const float kTruePeakLimiterDefaultCeilingInDb = -1.0f;
+static const float kTruePeakLimiterDefaultReleaseInMs = 50.0f;
+static const double kTruePeakLimiterLookaheadInMs = 1.5;
+// The interpolation filter is centered on this many samples in the past, which
+// adds to the delay of the lookahead
+static const SampleCount kTruePeakLimiterFilterDelay = TRUE_PEAK_FILTER_DELAY;
+
+static SampleCount _getLookaheadFrames(void) {
+  SampleCount frames =
+      (SampleCount)(kTruePeakLimiterLookaheadInMs * getSampleRate() / 1000.0 +
+                    0.5);
+  return frames > 0 ? frames : 1;
+}
+
+// The gain must reach its target lookahead - 1 frames after a peak has been
+// detected, and the detection itself lags behind by the filter delay
+static SampleCount _getDelayFrames(void) {
+  return _getLookaheadFrames() - 1 + kTruePeakLimiterFilterDelay;
+}
+
+static double _getReleaseCoefficient(float releaseTimeInMs) {
+  const double releaseFrames = releaseTimeInMs * getSampleRate() / 1000.0;
+  return releaseFrames > 1.0 ? exp(-1.0 / releaseFrames) : 0.0;
+}
+
+static void _freeChannelState(PluginTruePeakLimiterSettings settings) {
+  ChannelCount channel;
+
+  for (channel = 0; channel < settings->numChannels; channel++) {
+    free(settings->history[channel]);
+    free(settings->delayLines[channel]);
+  }
+
+  free(settings->history);
+  free(settings->delayLines);
+  free(settings->requiredGains);
+  free(settings->holdQueue);
+  free(settings->averageLine);
+  free(settings->peaks);
+  free(settings->gains);
+  settings->history = NULL;
+  settings->delayLines = NULL;
+  settings->requiredGains = NULL;
+  settings->holdQueue = NULL;
+  settings->averageLine = NULL;
+  settings->peaks = NULL;
+  settings->gains = NULL;
+  settings->numChannels = 0;
+  settings->scratchSize = 0;
+}
+
+static void _pluginTruePeakLimiterPrepare(void *pluginPtr) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginTruePeakLimiterSettings settings =
+      (PluginTruePeakLimiterSettings)plugin->extraData;
+  const SampleCount holdFrames = _getLookaheadFrames() + 1;
+  ChannelCount channel;
+  SampleCount i;
+
+  _freeChannelState(settings);
+  settings->lookaheadFrames = _getLookaheadFrames();
+  settings->delayFrames = _getDelayFrames();
+  settings->releaseCoefficient =
+      _getReleaseCoefficient(settings->releaseTimeInMs);
+
+  // Extra channels are usually handled by further instances of the plugin, but
+  // a chain with more channels than instances sends them all to this one
+  settings->numChannels = getNumChannels() > 2 ? getNumChannels() : 2;
+  settings->history =
+      (Samples *)malloc(sizeof(Samples) * settings->numChannels);
+  settings->delayLines =
+      (Samples *)malloc(sizeof(Samples) * settings->numChannels);
+
+  for (channel = 0; channel < settings->numChannels; channel++) {
+    settings->history[channel] = (Samples)calloc(
+        2 * TRUE_PEAK_LIMITER_FILTER_TAPS, sizeof(Sample));
+    settings->delayLines[channel] =
+        (Samples)calloc(settings->delayFrames, sizeof(Sample));
+  }
+
+  settings->historyIndex = 0;
+  settings->delayIndex = 0;
+
+  settings->requiredGains = (Sample *)malloc(sizeof(Sample) * holdFrames);
+  settings->holdQueue =
+      (unsigned long *)malloc(sizeof(unsigned long) * holdFrames);
+  settings->holdHead = 0;
+  settings->holdCount = 0;
+  settings->frameIndex = 0;
+  settings->releasedGain = 1.0;
+
+  settings->averageLine =
+      (Sample *)malloc(sizeof(Sample) * settings->lookaheadFrames);
+
+  for (i = 0; i < settings->lookaheadFrames; i++) {
+    settings->averageLine[i] = 1.0f;
+  }
+
+  settings->averageIndex = 0;
+  settings->averageSum = (double)settings->lookaheadFrames;
+
+  settings->scratchSize = getBlocksize();
+  settings->peaks = (Sample *)malloc(sizeof(Sample) * settings->scratchSize);
+  settings->gains = (Sample *)malloc(sizeof(Sample) * settings->scratchSize);
+}
+
+static void _detectPeaks(PluginTruePeakLimiterSettings settings,
+                         SampleBuffer inputs, SampleCount offset,
+                         SampleCount numFrames, ChannelCount numChannels) {
+  unsigned int historyIndex = settings->historyIndex;
+  ChannelCount channel;
+
+  memset(settings->peaks, 0, sizeof(Sample) * numFrames);
+
+  for (channel = 0; channel < numChannels; channel++) {
+    historyIndex = truePeakDetect(
+        settings->filter, settings->history[channel], settings->historyIndex,
+        inputs->samples[channel % inputs->numChannels] + offset, numFrames,
+        settings->peaks);
+  }
+
+  settings->historyIndex = historyIndex;
+}
+
+static Sample _getHoldGain(PluginTruePeakLimiterSettings settings,
+                           Sample requiredGain) {
+  const unsigned long holdFrames = settings->lookaheadFrames + 1;
+  const unsigned long frame = settings->frameIndex;
+  unsigned long back;
+
+  // Drop the oldest frame once it has left the hold time, which also keeps the
+  // queue from overflowing when the new frame is added below
+  if (settings->holdCount > 0 &&
+      frame - settings->holdQueue[settings->holdHead] >= holdFrames) {
+    settings->holdHead = (settings->holdHead + 1) % holdFrames;
+    settings->holdCount--;
+  }
+
+  // Frames with larger gains than this one can never be the minimum again
+  while (settings->holdCount > 0) {
+    back = (settings->holdHead + settings->holdCount - 1) % holdFrames;
+
+    if (settings->requiredGains[settings->holdQueue[back] % holdFrames] <
+        requiredGain) {
+      break;
+    }
+
+    settings->holdCount--;
+  }
+
+  settings->requiredGains[frame % holdFrames] = requiredGain;
+  settings->holdQueue[(settings->holdHead + settings->holdCount) %
+                      holdFrames] = frame;
+  settings->holdCount++;
+  return settings->requiredGains[settings->holdQueue[settings->holdHead] %
+                                 holdFrames];
+}
+
+// The gain for each frame is the minimum of the required gains over the hold
+// time, smoothed by the release and then averaged over the lookahead time. The
+// average fades the gain in ahead of a peak, and is never above the required
+// gain by the time the delayed peak reaches the output.
+static void _computeGains(PluginTruePeakLimiterSettings settings,
+                          SampleCount numFrames) {
+  const double releaseCoefficient = settings->releaseCoefficient;
+  Sample peak, requiredGain, holdGain;
+  double gain;
+  SampleCount frame;
+
+  for (frame = 0; frame < numFrames; frame++) {
+    peak = settings->peaks[frame];
+    requiredGain = peak > settings->ceiling ? settings->ceiling / peak : 1.0f;
+    holdGain = _getHoldGain(settings, requiredGain);
+    settings->frameIndex++;
+
+    if (holdGain < settings->releasedGain) {
+      settings->releasedGain = holdGain;
+    } else {
+      settings->releasedGain =
+          holdGain + (settings->releasedGain - holdGain) * releaseCoefficient;
+    }
+
+    settings->averageSum += settings->releasedGain -
+                            settings->averageLine[settings->averageIndex];
+    settings->averageLine[settings->averageIndex] =
+        (Sample)settings->releasedGain;
+    settings->averageIndex = settings->averageIndex + 1 <
+                                     settings->lookaheadFrames
+                                 ? settings->averageIndex + 1
+                                 : 0;
+    gain = settings->averageSum / settings->lookaheadFrames;
+    settings->gains[frame] = gain < 1.0 ? (Sample)gain : 1.0f;
+  }
+}
+
+static void _applyGains(PluginTruePeakLimiterSettings settings,
+                        SampleBuffer inputs, SampleBuffer outputs,
+                        SampleCount offset, SampleCount numFrames,
+                        ChannelCount numChannels) {
+  const SampleCount delayFrames = settings->delayFrames;
+  SampleCount delayIndex = settings->delayIndex;
+  Samples delayLine, input, output;
+  Sample sample;
+  ChannelCount channel;
+  SampleCount frame;
+
+  for (channel = 0; channel < numChannels; channel++) {
+    delayLine = settings->delayLines[channel];
+    input = inputs->samples[channel % inputs->numChannels] + offset;
+    output = outputs->samples[channel] + offset;
+    delayIndex = settings->delayIndex;
+
+    // The input is read before the output is written, so this also works when
+    // both are the same buffer
+    for (frame = 0; frame < numFrames; frame++) {
+      sample = input[frame];
+      output[frame] = delayLine[delayIndex] * settings->gains[frame];
+      delayLine[delayIndex] = sample;
+      delayIndex = delayIndex + 1 < delayFrames ? delayIndex + 1 : 0;
+    }
+  }
+
+  settings->delayIndex = delayIndex;
+}
+
+static void _pluginTruePeakLimiterProcessAudio(void *pluginPtr,
+                                               SampleBuffer inputs,
+                                               SampleBuffer outputs) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginTruePeakLimiterSettings settings =
+      (PluginTruePeakLimiterSettings)plugin->extraData;
+  ChannelCount numChannels = outputs->numChannels;
+  SampleCount offset, numFrames;
+
+  if (settings->scratchSize == 0) {
+    _pluginTruePeakLimiterPrepare(plugin);
+  }
+
+  if (inputs->numChannels == 0) {
+    sampleBufferClear(outputs);
+    return;
+  } else if (numChannels > settings->numChannels) {
+    logWarn("Internal limiter can only process %d channels",
+            settings->numChannels);
+    numChannels = settings->numChannels;
+    sampleBufferClear(outputs);
+  }
+
+  // Larger blocks than expected are processed in pieces, since the scratch
+  // buffers can't be reallocated here
+  for (offset = 0; offset < outputs->blocksize; offset += numFrames) {
+    numFrames = outputs->blocksize - offset < settings->scratchSize
+                    ? outputs->blocksize - offset
+                    : settings->scratchSize;
+    _detectPeaks(settings, inputs, offset, numFrames, numChannels);
+    _computeGains(settings, numFrames);
+    _applyGains(settings, inputs, outputs, offset, numFrames, numChannels);
+  }
+}
+
+static void _pluginTruePeakLimiterEmpty(void *pluginPtr) {
+  // Nothing to do here
+}
+
+static boolByte _pluginTruePeakLimiterOpen(void *pluginPtr) { return true; }
+
+static void _pluginTruePeakLimiterDisplayInfo(void *pluginPtr) {
+  logInfo("Information for Internal plugin '%s'",
+          kInternalPluginTruePeakLimiterName);
+  logInfo("Type: effect, parameters: ceiling in dBTP (0), release in ms (1)");
+  logInfo("Description: a lookahead limiter with true-peak detection");
+}
+
+static int _pluginTruePeakLimiterGetSetting(void *pluginPtr,
+                                            PluginSetting pluginSetting) {
+  switch (pluginSetting) {
+  case PLUGIN_SETTING_TAIL_TIME_IN_MS:
+    return 0;
+
+  case PLUGIN_NUM_INPUTS:
+    return 2;
+
+  case PLUGIN_NUM_OUTPUTS:
+    return 2;
+
+  case PLUGIN_INITIAL_DELAY:
+    return (int)_getDelayFrames();
+
+  default:
+    return 0;
+  }
+}
+
+static void _pluginTruePeakLimiterProcessMidiEvents(void *pluginPtr,
+                                                    LinkedList midiEvents) {
+  // Nothing to do here
+}
+
+static boolByte _pluginTruePeakLimiterSetParameter(void *pluginPtr,
+                                                   unsigned int i,
+                                                   float value) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginTruePeakLimiterSettings settings =
+      (PluginTruePeakLimiterSettings)plugin->extraData;
+
+  switch (i) {
+  case PLUGIN_TRUE_PEAK_LIMITER_SETTINGS_CEILING:
+    settings->ceiling = powf(10.0f, value / 20.0f);
+    return true;
+
+  case PLUGIN_TRUE_PEAK_LIMITER_SETTINGS_RELEASE:
+    if (value < 0.0f) {
+      logError("Release time of internal limiter must not be negative");
+      return false;
+    }
+
+    settings->releaseTimeInMs = value;
+    settings->releaseCoefficient = _getReleaseCoefficient(value);
+    return true;
+
+  default:
+    logError("Attempt to set invalid parameter %d on internal limiter", i);
+    return false;
+  }
+}
+
+static void _pluginTruePeakLimiterFree(void *pluginDataPtr) {
+  PluginTruePeakLimiterSettings settings =
+      (PluginTruePeakLimiterSettings)pluginDataPtr;
+  _freeChannelState(settings);
+  free(settings->filter);
+}
+
+Plugin newPluginTruePeakLimiter(const CharString pluginName) {
+  Plugin plugin = _newPlugin(PLUGIN_TYPE_INTERNAL, PLUGIN_TYPE_EFFECT);
+  PluginTruePeakLimiterSettings settings =
+      (PluginTruePeakLimiterSettings)malloc(
+          sizeof(PluginTruePeakLimiterSettingsMembers));
+
+  charStringCopy(plugin->pluginName, pluginName);
+  charStringCopyCString(plugin->pluginLocation, "Internal");
+
+  plugin->openPlugin = _pluginTruePeakLimiterOpen;
+  plugin->displayInfo = _pluginTruePeakLimiterDisplayInfo;
+  plugin->getSetting = _pluginTruePeakLimiterGetSetting;
+  plugin->prepareForProcessing = _pluginTruePeakLimiterPrepare;
+  plugin->showEditor = _pluginTruePeakLimiterEmpty;
+  plugin->processAudio = _pluginTruePeakLimiterProcessAudio;
+  plugin->processMidiEvents = _pluginTruePeakLimiterProcessMidiEvents;
+  plugin->setParameter = _pluginTruePeakLimiterSetParameter;
+  plugin->closePlugin = _pluginTruePeakLimiterEmpty;
+  plugin->freePluginData = _pluginTruePeakLimiterFree;
+
+  memset(settings, 0, sizeof(PluginTruePeakLimiterSettingsMembers));
+  settings->ceiling = powf(10.0f, kTruePeakLimiterDefaultCeilingInDb / 20.0f);
+  settings->releaseTimeInMs = kTruePeakLimiterDefaultReleaseInMs;
+  settings->filter = (float *)malloc(sizeof(float) *
+                                     TRUE_PEAK_LIMITER_FILTER_TAPS *
+                                     TRUE_PEAK_LIMITER_OVERSAMPLING);
+  truePeakFillFilter(settings->filter);
+
+  plugin->extraData = settings;
+  return plugin;
+}
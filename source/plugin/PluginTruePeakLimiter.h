@@ -0,0 +1,102 @@
+//
+// PluginTruePeakLimiter.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_PluginTruePeakLimiter_h
+#define MrsWatson_PluginTruePeakLimiter_h
+
+#include "audio/TruePeak.h"
+#include "plugin/Plugin.h"
+
+extern const char *kInternalPluginTruePeakLimiterName;
+
+/** Same as the oversampling of the shared true-peak detection */
+#define TRUE_PEAK_LIMITER_OVERSAMPLING TRUE_PEAK_OVERSAMPLING
+/** Number of filter taps per phase of the interpolation filter. */
+#define TRUE_PEAK_LIMITER_FILTER_TAPS TRUE_PEAK_FILTER_TAPS
+
+typedef enum {
+  PLUGIN_TRUE_PEAK_LIMITER_SETTINGS_CEILING,
+  PLUGIN_TRUE_PEAK_LIMITER_SETTINGS_RELEASE,
+  PLUGIN_TRUE_PEAK_LIMITER_NUM_SETTINGS
+} PluginTruePeakLimiterSettingsIndex;
+
+typedef struct {
+  // Largest allowed true-peak level as a linear amplitude
+  Sample ceiling;
+  float releaseTimeInMs;
+
+  // Computed by prepareForProcessing from the settings and sample rate
+  SampleCount lookaheadFrames;
+  SampleCount delayFrames;
+  double releaseCoefficient;
+
+  // Interpolation filter, stored tap by tap with the coefficients of all phases
+  // next to each other so that the phases can be computed in parallel
+  float *filter;
+
+  // Channel state, allocated for numChannels channels. Each history holds the
+  // last filter taps twice in a row, so that the most recent samples can
+  // always be read without wrapping around.
+  ChannelCount numChannels;
+  Samples *history;
+  unsigned int historyIndex;
+  Samples *delayLines;
+  SampleCount delayIndex;
+
+  // Gain computer state. The hold is a sliding minimum, which is kept as a
+  // queue of frame indexes with increasing gains.
+  Sample *requiredGains;
+  unsigned long *holdQueue;
+  unsigned long holdHead;
+  unsigned long holdCount;
+  unsigned long frameIndex;
+  double releasedGain;
+  Sample *averageLine;
+  SampleCount averageIndex;
+  double averageSum;
+
+  // Scratch space for one block, sized by prepareForProcessing
+  Sample *peaks;
+  Sample *gains;
+  SampleCount scratchSize;
+} PluginTruePeakLimiterSettingsMembers;
+typedef PluginTruePeakLimiterSettingsMembers *PluginTruePeakLimiterSettings;
+
+/**
+ * Create a lookahead limiter which keeps the true-peak level of the output
+ * below a ceiling. Peaks are detected on a 4x oversampled copy of the signal,
+ * and the gain is faded in over the lookahead time ahead of each peak, so the
+ * output is delayed by the lookahead. This delay is reported as the plugin's
+ * initial delay.
+ *
+ * Parameters are the ceiling in dBTP (default -1) and the release time in
+ * milliseconds (default 50).
+ * @param pluginName Name of the plugin
+ * @return New plugin instance
+ */
+Plugin newPluginTruePeakLimiter(const CharString pluginName);
+
+#endif
@@ -34,26 +34,41 @@
 extern "C" {
 #include "PluginVst2x.h"
 
+#include "app/RenderContext.h"
 #include "audio/AudioSettings.h"
 #include "base/File.h"
 #include "base/PlatformInfo.h"
+#include "base/Thread.h"
 #include "base/Types.h"
 #include "logging/EventLogger.h"
 #include "midi/MidiEvent.h"
 #include "plugin/Plugin.h"
+#include "plugin/PluginControl.h"
+#include "plugin/PluginIdler.h"
+#include "plugin/PluginIndex.h"
+#include "plugin/PluginProbe.h"
+#include "plugin/PluginScanner.h"
 #include "plugin/PluginVst2xId.h"
 
 extern LinkedList getVst2xPluginLocations(CharString currentDirectory);
 extern LibraryHandle
 getLibraryHandleForPlugin(const CharString pluginAbsolutePath);
 extern void showVst2xEditor(AEffect *effect, const CharString pluginName,
-                            PluginWindowSize *rect);
+                            PluginWindowSize *rect,
+                            volatile unsigned int *closeRequested);
 extern AEffect *loadVst2xPlugin(LibraryHandle libraryHandle);
 extern void closeLibraryHandle(LibraryHandle libraryHandle);
 }
 
 // Opaque struct must be declared here rather than in the header, otherwise many
 // other files in this project must be compiled as C++ code. =/
+// Storage for one converted event in the event pool, which holds either type
+// of event that is sent to plugins
+typedef union {
+  VstMidiEvent midi;
+  VstMidiSysexEvent sysex;
+} PluginVst2xEvent;
+
 typedef struct {
   AEffect *pluginHandle;
   PluginVst2xId pluginId;
@@ -62,11 +77,56 @@ typedef struct {
   boolByte isPluginShell;
   VstInt32 shellPluginId;
   // Must be retained until processReplacing() is called, so best to keep a
-  // reference in the plugin's data storage.
+  // reference in the plugin's data storage. The events are stored in a pool
+  // which is reused for each block, and only grows when a block has more
+  // events than any block before it.
   struct VstEvents *vstEvents;
+  PluginVst2xEvent *vstMidiEvents;
+  int vstEventsCapacity;
+  // Sysex dumps of the events, which are copied into a byte pool that is
+  // reused in the same way
+  char *sysexData;
+  size_t sysexDataSize;
+  size_t sysexDataCapacity;
+  // Settings which were last sent to the plugin, so that they are only sent
+  // again when they change between two inputs
+  SampleRate sampleRate;
+  SampleCount blocksize;
+  // Render context which the plugin was created in, which is made current
+  // whenever the plugin calls the host, see pluginVst2xHostCallback()
+  RenderContext renderContext;
+  // Returned to the plugin for audioMasterGetTime. Each plugin has its own
+  // copy so that plugins running in different render contexts do not share it.
+  VstTimeInfo timeInfo;
+  // Set by another thread to close the editor, see pluginVst2xCloseEditor()
+  volatile unsigned int editorCloseRequested;
+  // Parameter changes which the plugin reports with audioMasterAutomate are
+  // queued here for the chain, see pluginVst2xSetAutomationControl()
+  PluginControl automationControl;
+  unsigned int automationPluginIndex;
+  // True if the plugin index says that the plugin does not work offline, so
+  // that it is told that processing happens in realtime instead
+  boolByte realtimeOnly;
+#if USE_DOUBLE_SAMPLES
+  // True if the plugin processes doubles, otherwise the samples are converted
+  // to floats in these buffers around each call to processReplacing()
+  boolByte doublePrecision;
+  float **floatInputs;
+  float **floatOutputs;
+  float *floatStorage;
+  SampleCount floatBlocksize;
+#endif
 } PluginVst2xDataMembers;
 typedef PluginVst2xDataMembers *PluginVst2xData;
 
+// Initial number of events in the event pool, which is enough for most blocks
+static const int kPluginVst2xInitialEventPoolSize = 64;
+// Initial size of the sysex pool, which is allocated for the first sysex event
+static const size_t kPluginVst2xInitialSysexPoolSize = 4096;
+
+// Maximum length of the plugin index path, including the trailing null
+static const size_t kPluginVst2xIndexFileLength = 1024;
+
 // Implementation body starts here
 extern "C" {
 
@@ -81,19 +141,15 @@ extern "C" {
 // host (in fact, calling the plugin's main() *returns* the AEffect* which we
 // save in our extraData struct). Therefore it is not possible to have the
 // plugin reach our host callback with some custom data, and we must keep a
-// global variable to the current effect ID.  That said, this prevents
-// initializing plugins in multiple threads in the future, as as we must set
-// this to the correct ID before calling the plugin's main() function when
-// setting up the effect chain.
-VstInt32 currentPluginUniqueId;
+// variable to the current effect ID. This variable is thread-local, so
+// plugins may still be initialized in different threads, as long as this is
+// set to the correct ID before calling the plugin's main() function in the
+// same thread which is setting up the effect chain.
+THREAD_LOCAL VstInt32 currentPluginUniqueId;
 
 const char *_getVst2xPlatformExtension(void);
 const char *_getVst2xPlatformExtension(void) {
-  PlatformInfo platform = newPlatformInfo();
-  PlatformType platformType = platform->type;
-  freePlatformInfo(platform);
-
-  switch (platformType) {
+  switch (platformInfoGetType()) {
   case PLATFORM_MACOSX:
     return ".vst";
 
@@ -108,23 +164,80 @@ const char *_getVst2xPlatformExtension(void) {
   }
 }
 
-static void _logPluginVst2xInLocation(void *item, void *userData) {
-  File itemFile = (File)item;
-  CharString itemPath = newCharStringWithCString(itemFile->absolutePath->data);
-  boolByte *pluginsFound = (boolByte *)userData;
-  char *dot;
+// Path to the persistent plugin index, or an empty string if plugins should
+// be found by searching each location. This is kept in a static buffer rather
+// than a CharString since it must live for the entire lifetime of the program.
+static char pluginVst2xIndexFile[kPluginVst2xIndexFileLength];
+
+void pluginVst2xSetIndexFile(const CharString indexFile) {
+  memset(pluginVst2xIndexFile, 0, kPluginVst2xIndexFileLength);
+
+  if (!charStringIsEmpty(indexFile)) {
+    strncpy(pluginVst2xIndexFile, indexFile->data,
+            kPluginVst2xIndexFileLength - 1);
+  }
+}
+
+// Set once before any plugins are opened, so this needs no locking
+static PluginVst2xRenderMode pluginVst2xRenderMode =
+    PLUGIN_VST2X_RENDER_MODE_DEFAULT;
+// True while the calling thread is in one of the plugin's processing calls
+static THREAD_LOCAL boolByte _vst2xProcessing = false;
+
+void pluginVst2xSetRenderMode(PluginVst2xRenderMode renderMode) {
+  pluginVst2xRenderMode = renderMode;
+}
+
+PluginVst2xRenderMode pluginVst2xGetRenderMode(void) {
+  return pluginVst2xRenderMode;
+}
+
+VstInt32 pluginVst2xGetProcessLevel(const Plugin plugin) {
+  if (pluginVst2xRenderMode == PLUGIN_VST2X_RENDER_MODE_DEFAULT) {
+    return kVstProcessLevelUnknown;
+  } else if (!_vst2xProcessing) {
+    return kVstProcessLevelUser;
+  } else if (pluginVst2xRenderMode == PLUGIN_VST2X_RENDER_MODE_OFFLINE &&
+             (plugin == NULL ||
+              !((PluginVst2xData)plugin->extraData)->realtimeOnly)) {
+    return kVstProcessLevelOffline;
+  } else {
+    return kVstProcessLevelRealtime;
+  }
+}
+
+static PluginIndex _openVst2xPluginIndex(void) {
+  PluginIndex index = NULL;
+
+  if (pluginVst2xIndexFile[0] != '\0') {
+    CharString indexFile = newCharStringWithCString(pluginVst2xIndexFile);
+    index = newPluginIndex(indexFile, _getVst2xPlatformExtension());
+    freeCharString(indexFile);
+  }
+
+  return index;
+}
+
+static void _closeVst2xPluginIndex(PluginIndex index) {
+  if (index != NULL) {
+    pluginIndexWrite(index);
+    freePluginIndex(index);
+  }
+}
 
-  logDebug("Checking item '%s'", itemPath->data);
-  dot = strrchr(itemPath->data, '.');
+static void _logPluginVst2xInLocation(File item, const char *name,
+                                      void *userData) {
+  CharString itemPath = newCharStringWithCString(item->absolutePath->data);
+  boolByte *pluginsFound = (boolByte *)userData;
+  char *dot = strrchr(itemPath->data, '.');
 
+  // Only entries with the platform's extension are passed here
   if (dot != NULL) {
-    if (!strncmp(dot, _getVst2xPlatformExtension(), 3)) {
-      *dot = '\0';
-      logInfo("  %s", itemPath->data);
-      *pluginsFound = true;
-    }
+    *dot = '\0';
   }
 
+  logInfo("  %s", itemPath->data);
+  *pluginsFound = true;
   freeCharString(itemPath);
 }
 
@@ -132,45 +245,106 @@ static void _logPluginLocation(const CharString location) {
   logInfo("Location '%s', type VST 2.x:", location->data);
 }
 
+static const char *_getPluginTypeName(PluginType pluginType) {
+  switch (pluginType) {
+  case PLUGIN_TYPE_EFFECT:
+    return "effect";
+
+  case PLUGIN_TYPE_INSTRUMENT:
+    return "instrument";
+
+  case PLUGIN_TYPE_UNSUPPORTED:
+    return "unsupported";
+
+  default:
+    return "unknown";
+  }
+}
+
+static void _logPluginVst2xInIndex(void *item, void *userData) {
+  PluginIndexEntry entry = (PluginIndexEntry)item;
+  PluginIndexLocation location = (PluginIndexLocation)userData;
+  LinkedListIterator iterator;
+
+  if (!entry->scanned) {
+    logInfo("  %s%c%s", location->path->data, PATH_DELIMITER,
+            entry->name->data);
+    return;
+  }
+
+  logInfo("  %s%c%s ('%s', %s, I/O %d/%d)", location->path->data,
+          PATH_DELIMITER, entry->name->data, entry->pluginId->idString->data,
+          _getPluginTypeName(entry->pluginType), entry->numInputs,
+          entry->numOutputs);
+
+  if (!pluginCapabilitiesIsEmpty(entry->capabilities)) {
+    CharString capabilities = pluginCapabilitiesToString(entry->capabilities);
+    logInfo("    Capabilities: %s", capabilities->data);
+    freeCharString(capabilities);
+  }
+
+  for (iterator = entry->shellPlugins; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    PluginIndexShellPlugin shellPlugin = (PluginIndexShellPlugin)iterator->item;
+
+    if (shellPlugin != NULL) {
+      logInfo("    '%s' (%s)", shellPlugin->pluginId->idString->data,
+              shellPlugin->name->data);
+    }
+  }
+}
+
+static void _listPluginsVst2xInIndex(const CharString locationString,
+                                     PluginIndex index) {
+  PluginIndexLocation location = pluginIndexGetLocation(index, locationString);
+
+  if (location == NULL) {
+    logInfo("  (Empty or non-existent directory)");
+  } else if (linkedListLength(location->entries) == 0) {
+    logInfo("  (No plugins found)");
+  } else {
+    linkedListForeach(location->entries, _logPluginVst2xInIndex, location);
+  }
+}
+
 static void _listPluginsVst2xInLocation(void *item, void *userData) {
   CharString locationString;
   File location = NULL;
-  LinkedList locationItems;
   boolByte pluginsFound = false;
 
   locationString = (CharString)item;
   _logPluginLocation(locationString);
-  location = newFileWithPath(locationString);
-  locationItems = fileListDirectory(location);
 
-  if (linkedListLength(locationItems) == 0) {
-    // Empty or does not exist, return
-    logInfo("  (Empty or non-existent directory)");
-    freeLinkedList(locationItems);
-    freeFile(location);
+  if (userData != NULL) {
+    _listPluginsVst2xInIndex(locationString, (PluginIndex)userData);
     return;
   }
 
-  linkedListForeach(locationItems, _logPluginVst2xInLocation, &pluginsFound);
+  location = newFileWithPath(locationString);
 
-  if (!pluginsFound) {
+  if (!fileListDirectoryForeach(location, _getVst2xPlatformExtension(),
+                                _logPluginVst2xInLocation, &pluginsFound)) {
+    logInfo("  (Empty or non-existent directory)");
+  } else if (!pluginsFound) {
     logInfo("  (No plugins found)");
   }
 
   freeFile(location);
-  freeLinkedListAndItems(locationItems, (LinkedListFreeItemFunc)freeFile);
 }
 
 void listAvailablePluginsVst2x(const CharString pluginRoot) {
+  PluginIndex index = _openVst2xPluginIndex();
+
   if (!charStringIsEmpty(pluginRoot)) {
-    _listPluginsVst2xInLocation(pluginRoot, NULL);
+    _listPluginsVst2xInLocation(pluginRoot, index);
   }
 
   LinkedList pluginLocations =
       getVst2xPluginLocations(fileGetCurrentDirectory());
-  linkedListForeach(pluginLocations, _listPluginsVst2xInLocation, NULL);
+  linkedListForeach(pluginLocations, _listPluginsVst2xInLocation, index);
   freeLinkedListAndItems(pluginLocations,
                          (LinkedListFreeItemFunc)freeCharString);
+  _closeVst2xPluginIndex(index);
 }
 
 static boolByte _doesVst2xPluginExistAtLocation(const CharString pluginName,
@@ -234,14 +408,43 @@ static boolByte _doesVst2xPluginExistAtLocation(const CharString pluginName,
   return result;
 }
 
+static boolByte _isVst2xPluginInIndex(PluginIndex index,
+                                      const CharString pluginName,
+                                      const CharString locationName) {
+  boolByte result = false;
+  const char *subpluginSeparator = NULL;
+  CharString pluginSearchName = NULL;
+
+  // The index only knows about files directly inside of each location, so
+  // names with a path component must still be searched for on disk.
+  if (index == NULL || strchr(pluginName->data, PATH_DELIMITER) != NULL) {
+    return _doesVst2xPluginExistAtLocation(pluginName, locationName);
+  }
+
+  pluginSearchName = newCharStringWithCString(pluginName->data);
+  subpluginSeparator =
+      strrchr(pluginSearchName->data, kPluginVst2xSubpluginSeparator);
+  if (subpluginSeparator != NULL) {
+    pluginSearchName->data[subpluginSeparator - pluginSearchName->data] = '\0';
+  }
+
+  logDebug("Looking for plugin '%s' in index of '%s'", pluginSearchName->data,
+           locationName->data);
+  result = (boolByte)(pluginIndexFind(index, locationName, pluginSearchName) !=
+                      NULL);
+  freeCharString(pluginSearchName);
+  return result;
+}
+
 static CharString _getVst2xPluginLocation(const CharString pluginName,
                                           const CharString pluginRoot) {
   File pluginAbsolutePath = newFileWithPath(pluginName);
+  PluginIndex index = NULL;
+  CharString result = NULL;
 
   if (fileExists(pluginAbsolutePath)) {
     File pluginParentDir = fileGetParent(pluginAbsolutePath);
-    CharString result =
-        newCharStringWithCString(pluginParentDir->absolutePath->data);
+    result = newCharStringWithCString(pluginParentDir->absolutePath->data);
     freeFile(pluginParentDir);
     freeFile(pluginAbsolutePath);
     return result;
@@ -249,9 +452,12 @@ static CharString _getVst2xPluginLocation(const CharString pluginName,
     freeFile(pluginAbsolutePath);
   }
 
+  index = _openVst2xPluginIndex();
+
   // Then search the path given to --plugin-root, if given
   if (!charStringIsEmpty(pluginRoot)) {
-    if (_doesVst2xPluginExistAtLocation(pluginName, pluginRoot)) {
+    if (_isVst2xPluginInIndex(index, pluginName, pluginRoot)) {
+      _closeVst2xPluginIndex(index);
       return newCharStringWithCString(pluginRoot->data);
     }
   }
@@ -262,21 +468,13 @@ static CharString _getVst2xPluginLocation(const CharString pluginName,
   LinkedList pluginLocations =
       getVst2xPluginLocations(fileGetCurrentDirectory());
 
-  if (pluginLocations->item == NULL) {
-    freeLinkedListAndItems(pluginLocations,
-                           (LinkedListFreeItemFunc)freeCharString);
-    return NULL;
-  }
-
   LinkedListIterator iterator = pluginLocations;
-  while (iterator != NULL) {
+  while (iterator != NULL && iterator->item != NULL) {
     CharString searchLocation = (CharString)(iterator->item);
 
-    if (_doesVst2xPluginExistAtLocation(pluginName, searchLocation)) {
-      CharString result = newCharStringWithCString(searchLocation->data);
-      freeLinkedListAndItems(pluginLocations,
-                             (LinkedListFreeItemFunc)freeCharString);
-      return result;
+    if (_isVst2xPluginInIndex(index, pluginName, searchLocation)) {
+      result = newCharStringWithCString(searchLocation->data);
+      break;
     }
 
     iterator = (LinkedListIterator)iterator->nextItem;
@@ -284,7 +482,8 @@ static CharString _getVst2xPluginLocation(const CharString pluginName,
 
   freeLinkedListAndItems(pluginLocations,
                          (LinkedListFreeItemFunc)freeCharString);
-  return NULL;
+  _closeVst2xPluginIndex(index);
+  return result;
 }
 
 boolByte pluginVst2xExists(const CharString pluginName,
@@ -303,6 +502,49 @@ static short _canPluginDo(Plugin plugin, const char *canDoString) {
   return (short)result;
 }
 
+// Must only be called while the plugin is suspended
+static void _setVst2xAudioSettings(PluginVst2xData data) {
+  data->dispatcher(data->pluginHandle, effSetSampleRate, 0, 0, NULL,
+                   (float)getSampleRate());
+  data->dispatcher(data->pluginHandle, effSetBlockSize, 0,
+                   (VstIntPtr)getBlocksize(), NULL, 0.0f);
+  data->sampleRate = getSampleRate();
+  data->blocksize = getBlocksize();
+}
+
+#if USE_DOUBLE_SAMPLES
+// Allocates float buffers for plugins which can't process doubles. This is done
+// when the plugin is resumed, so that it does not happen while processing.
+static void _reserveVst2xFloatBuffers(PluginVst2xData data,
+                                      SampleCount blocksize) {
+  const int numInputs = data->pluginHandle->numInputs;
+  const int numOutputs = data->pluginHandle->numOutputs;
+  int i;
+
+  if (data->doublePrecision || data->floatBlocksize >= blocksize) {
+    return;
+  }
+
+  free(data->floatInputs);
+  free(data->floatOutputs);
+  free(data->floatStorage);
+  data->floatInputs = (float **)malloc(sizeof(float *) * (numInputs + 1));
+  data->floatOutputs = (float **)malloc(sizeof(float *) * (numOutputs + 1));
+  data->floatStorage =
+      (float *)malloc(sizeof(float) * (numInputs + numOutputs + 1) * blocksize);
+
+  for (i = 0; i < numInputs; i++) {
+    data->floatInputs[i] = data->floatStorage + i * blocksize;
+  }
+
+  for (i = 0; i < numOutputs; i++) {
+    data->floatOutputs[i] = data->floatStorage + (numInputs + i) * blocksize;
+  }
+
+  data->floatBlocksize = blocksize;
+}
+#endif
+
 static void _resumePlugin(Plugin plugin) {
   logDebug("Resuming plugin '%s'", plugin->pluginName->data);
   PluginVst2xData data = (PluginVst2xData)plugin->extraData;
@@ -313,6 +555,17 @@ static void _resumePlugin(Plugin plugin) {
              plugin->pluginName->data);
   }
 
+  if (data->sampleRate != getSampleRate() ||
+      data->blocksize != getBlocksize()) {
+    logDebug("Updating plugin '%s' to sample rate %.0f, blocksize %lu",
+             plugin->pluginName->data, getSampleRate(), getBlocksize());
+    _setVst2xAudioSettings(data);
+  }
+
+#if USE_DOUBLE_SAMPLES
+  _reserveVst2xFloatBuffers(data, getBlocksize());
+#endif
+
   data->dispatcher(data->pluginHandle, effMainsChanged, 0, 1, NULL, 0.0f);
   data->dispatcher(data->pluginHandle, effStartProcess, 0, 0, NULL, 0.0f);
 }
@@ -410,10 +663,23 @@ static boolByte _initVst2xPlugin(Plugin plugin) {
   }
 
   data->dispatcher(data->pluginHandle, effOpen, 0, 0, NULL, 0.0f);
-  data->dispatcher(data->pluginHandle, effSetSampleRate, 0, 0, NULL,
-                   (float)getSampleRate());
-  data->dispatcher(data->pluginHandle, effSetBlockSize, 0,
-                   (VstIntPtr)getBlocksize(), NULL, 0.0f);
+
+#if USE_DOUBLE_SAMPLES
+  // The precision must be set while the plugin is suspended. Many plugins do
+  // not implement this opcode, so its return value can't be relied upon, and
+  // the flag alone says whether processDoubleReplacing() may be called.
+  if (data->pluginHandle->flags & effFlagsCanDoubleReplacing) {
+    data->dispatcher(data->pluginHandle, effSetProcessPrecision, 0,
+                     kVstProcessPrecision64, NULL, 0.0f);
+    data->doublePrecision = true;
+  }
+
+  logDebug("Plugin '%s' processes %s precision samples",
+           plugin->pluginName->data,
+           data->doublePrecision ? "double" : "single");
+#endif
+
+  _setVst2xAudioSettings(data);
   struct VstSpeakerArrangement inSpeakers;
   _setSpeakers(&inSpeakers, data->pluginHandle->numInputs);
   struct VstSpeakerArrangement outSpeakers;
@@ -460,6 +726,364 @@ void pluginVst2xAudioMasterIOChanged(const Plugin self,
   }
 }
 
+RenderContext pluginVst2xGetRenderContext(const Plugin self) {
+  PluginVst2xData data = (PluginVst2xData)(self->extraData);
+  return data->renderContext;
+}
+
+// Some plugins report every change with audioMasterAutomate, including the ones
+// which the host makes itself, and those must not be queued again
+static THREAD_LOCAL boolByte _settingVst2xParameter = false;
+
+void pluginVst2xAudioMasterAutomate(const Plugin self, VstInt32 index,
+                                    float value) {
+  PluginVst2xData data = (PluginVst2xData)(self->extraData);
+
+  if (data->automationControl != NULL && !_settingVst2xParameter &&
+      index >= 0) {
+    pluginControlSetParameter(data->automationControl,
+                              data->automationPluginIndex,
+                              (unsigned int)index, value);
+  }
+}
+
+static boolByte _idleVst2xPlugin(void *effectPtr) {
+  AEffect *effect = (AEffect *)effectPtr;
+  return (boolByte)(effect->dispatcher(effect, effIdle, 0, 0, NULL, 0.0f) !=
+                    0);
+}
+
+void pluginVst2xAudioMasterNeedIdle(const Plugin self) {
+  PluginVst2xData data = (PluginVst2xData)(self->extraData);
+  // The plugin is idled until effIdle returns 0
+  pluginIdlerAdd(data->pluginHandle, _idleVst2xPlugin);
+}
+
+void pluginVst2xSetAutomationControl(Plugin self, PluginControl control,
+                                     unsigned int pluginIndex) {
+  PluginVst2xData data = (PluginVst2xData)(self->extraData);
+  data->automationControl = control;
+  data->automationPluginIndex = pluginIndex;
+}
+
+void pluginVst2xCloseEditor(Plugin self) {
+  PluginVst2xData data = (PluginVst2xData)(self->extraData);
+  atomicStore(&data->editorCloseRequested, 1);
+}
+
+VstTimeInfo *pluginVst2xGetTimeInfo(const Plugin self) {
+  PluginVst2xData data = (PluginVst2xData)(self->extraData);
+  return &(data->timeInfo);
+}
+
+const char *pluginVst2xGetIdString(const Plugin self) {
+  PluginVst2xData data = (PluginVst2xData)(self->extraData);
+  return data->pluginId != NULL ? data->pluginId->idString->data : NULL;
+}
+
+static void _reserveVst2xEvents(PluginVst2xData data, int capacity) {
+  if (capacity <= data->vstEventsCapacity) {
+    return;
+  }
+
+  // struct VstEvents only declares room for 2 event pointers, so the remaining
+  // pointers are allocated past the end of the struct
+  data->vstEvents = (struct VstEvents *)realloc(
+      data->vstEvents,
+      sizeof(struct VstEvents) + (capacity * sizeof(struct VstEvent *)));
+  data->vstEvents->numEvents = 0;
+  data->vstEvents->reserved = 0;
+  data->vstMidiEvents = (PluginVst2xEvent *)realloc(
+      data->vstMidiEvents, capacity * sizeof(PluginVst2xEvent));
+  data->vstEventsCapacity = capacity;
+}
+
+static void _reserveVst2xSysexData(PluginVst2xData data, size_t size) {
+  size_t capacity = data->sysexDataCapacity > 0
+                        ? data->sysexDataCapacity
+                        : kPluginVst2xInitialSysexPoolSize;
+
+  if (size <= data->sysexDataCapacity) {
+    return;
+  }
+
+  while (capacity < size) {
+    capacity *= 2;
+  }
+
+  data->sysexData = (char *)realloc(data->sysexData, capacity);
+  data->sysexDataCapacity = capacity;
+}
+
+// Ask a shell plugin for all of its sub-plugins. Large shell bundles can take
+// a long time to answer, so the result is kept in the plugin index.
+static LinkedList _listVst2xShellPlugins(AEffect *pluginHandle) {
+  LinkedList result = newLinkedList();
+  CharString nameBuffer = newCharStringWithCapacity(kCharStringLengthShort);
+
+  while (true) {
+    charStringClear(nameBuffer);
+    VstInt32 shellPluginId =
+        (VstInt32)pluginHandle->dispatcher(pluginHandle, effShellGetNextPlugin,
+                                           0, 0, nameBuffer->data, 0.0f);
+
+    if (shellPluginId == 0 || charStringIsEmpty(nameBuffer)) {
+      break;
+    }
+
+    linkedListAppend(result,
+                     newPluginIndexShellPlugin((unsigned long)shellPluginId,
+                                               nameBuffer->data));
+  }
+
+  freeCharString(nameBuffer);
+  return result;
+}
+
+static PluginIndexEntry _findVst2xPluginIndexEntry(PluginIndex index,
+                                                   const Plugin plugin) {
+  File pluginFile;
+  File pluginParentDir;
+  CharString pluginBasename;
+  PluginIndexEntry result;
+
+  if (index == NULL || charStringIsEmpty(plugin->pluginAbsolutePath)) {
+    return NULL;
+  }
+
+  pluginFile = newFileWithPath(plugin->pluginAbsolutePath);
+  pluginParentDir = fileGetParent(pluginFile);
+  pluginBasename = fileGetBasename(pluginFile);
+  result =
+      pluginIndexFind(index, pluginParentDir->absolutePath, pluginBasename);
+  freeCharString(pluginBasename);
+  freeFile(pluginParentDir);
+  freeFile(pluginFile);
+  return result;
+}
+
+// Find the unique ID of a plugin which has not been opened yet by its name and
+// location. Shell sub-plugins are given by the name of the shell followed by
+// the name or ID of the sub-plugin, in the same way as when they are opened.
+static boolByte _findVst2xPluginIdInIndex(PluginIndex index,
+                                          const CharString pluginName,
+                                          const CharString pluginLocation,
+                                          unsigned long *outPluginId) {
+  CharString name = newCharStringWithCString(pluginName->data);
+  char *subpluginSeparator =
+      strrchr(name->data, kPluginVst2xSubpluginSeparator);
+  const char *subpluginName = NULL;
+  File pluginFile = NULL;
+  File pluginParentDir = NULL;
+  CharString pluginBasename = NULL;
+  PluginIndexEntry entry = NULL;
+  PluginIndexShellPlugin shellPlugin = NULL;
+  boolByte result = false;
+
+  // As in _openVst2xPlugin(), the separator of a Windows drive letter is not
+  // taken for a sub-plugin
+  if (subpluginSeparator != NULL && subpluginSeparator - name->data > 1) {
+    *subpluginSeparator = '\0';
+    subpluginName = subpluginSeparator + 1;
+  }
+
+  if (strchr(name->data, PATH_DELIMITER) != NULL) {
+    pluginFile = newFileWithPath(name);
+    pluginParentDir = fileGetParent(pluginFile);
+    pluginBasename = fileGetBasename(pluginFile);
+    entry = pluginIndexFind(index, pluginParentDir->absolutePath,
+                            pluginBasename);
+  } else if (!charStringIsEmpty(pluginLocation)) {
+    entry = pluginIndexFind(index, pluginLocation, name);
+  }
+
+  if (entry != NULL && entry->scanned) {
+    if (subpluginName == NULL) {
+      *outPluginId = entry->pluginId->id;
+      result = true;
+    } else if ((shellPlugin = pluginIndexEntryFindShellPlugin(
+                    entry, subpluginName)) != NULL) {
+      *outPluginId = shellPlugin->pluginId->id;
+      result = true;
+    } else if (strlen(subpluginName) == 4) {
+      CharString subpluginIdString = newCharStringWithCString(subpluginName);
+      PluginVst2xId subpluginId =
+          newPluginVst2xIdWithStringId(subpluginIdString);
+      *outPluginId = subpluginId->id;
+      result = true;
+      freePluginVst2xId(subpluginId);
+      freeCharString(subpluginIdString);
+    }
+  }
+
+  freeCharString(pluginBasename);
+  freeFile(pluginParentDir);
+  freeFile(pluginFile);
+  freeCharString(name);
+  return result;
+}
+
+PluginCapabilityState pluginVst2xGetCapability(const Plugin plugin,
+                                               PluginCapability capability) {
+  PluginVst2xData data = (PluginVst2xData)plugin->extraData;
+  PluginIndex index = _openVst2xPluginIndex();
+  PluginCapabilityState result = PLUGIN_CAPABILITY_UNKNOWN;
+  unsigned long pluginId = 0;
+
+  if (index == NULL) {
+    return PLUGIN_CAPABILITY_UNKNOWN;
+  }
+
+  // Once the plugin has been loaded, its ID is known without the index
+  if (data->pluginId != NULL) {
+    result = pluginIndexGetCapability(index, data->pluginId->id, capability);
+  } else if (_findVst2xPluginIdInIndex(index, plugin->pluginName,
+                                       plugin->pluginLocation, &pluginId)) {
+    result = pluginIndexGetCapability(index, pluginId, capability);
+  }
+
+  _closeVst2xPluginIndex(index);
+  return result;
+}
+
+// Set a capability given as "name,capability,state"
+static boolByte _setVst2xPluginCapability(const char *argument,
+                                          const CharString pluginRoot) {
+  CharString pluginName = newCharStringWithCString(argument);
+  char *capabilityName = strchr(pluginName->data, ',');
+  char *stateName = NULL;
+  PluginCapability capability = NUM_PLUGIN_CAPABILITIES;
+  PluginCapabilityState state = NUM_PLUGIN_CAPABILITY_STATES;
+  CharString pluginLocation = NULL;
+  PluginIndex index = NULL;
+  unsigned long pluginId = 0;
+  boolByte result = false;
+
+  if (capabilityName != NULL) {
+    *capabilityName++ = '\0';
+    stateName = strchr(capabilityName, ',');
+  }
+
+  if (stateName != NULL) {
+    *stateName++ = '\0';
+    capability = pluginCapabilityWithName(capabilityName);
+    state = pluginCapabilityStateWithName(stateName);
+  }
+
+  if (capability == NUM_PLUGIN_CAPABILITIES ||
+      state == NUM_PLUGIN_CAPABILITY_STATES) {
+    logError("Invalid plugin capability '%s', expected "
+             "'name,capability,yes|no|auto'",
+             argument);
+    freeCharString(pluginName);
+    return false;
+  }
+
+  // Resolved before the index is opened here, since this opens it as well
+  pluginLocation = _getVst2xPluginLocation(pluginName, pluginRoot);
+  index = _openVst2xPluginIndex();
+
+  if (index == NULL) {
+    logError("Setting plugin capabilities requires a plugin index, see "
+             "--plugin-index");
+  } else if (!_findVst2xPluginIdInIndex(index, pluginName, pluginLocation,
+                                        &pluginId)) {
+    logError("Plugin '%s' has not been scanned yet, see --scan-plugins",
+             pluginName->data);
+  } else {
+    pluginIndexSetUserCapability(index, pluginId, capability, state);
+    logInfo("Capability %s of plugin '%s' set to %s",
+            pluginCapabilityGetName(capability), pluginName->data,
+            pluginCapabilityStateGetName(state));
+    result = true;
+  }
+
+  _closeVst2xPluginIndex(index);
+  freeCharString(pluginLocation);
+  freeCharString(pluginName);
+  return result;
+}
+
+boolByte pluginVst2xSetCapabilities(const LinkedList capabilities,
+                                    const CharString pluginRoot) {
+  boolByte result = true;
+
+  for (LinkedListIterator iterator = capabilities; iterator != NULL;
+       iterator = (LinkedListIterator)iterator->nextItem) {
+    if (iterator->item != NULL &&
+        !_setVst2xPluginCapability((const char *)iterator->item, pluginRoot)) {
+      result = false;
+    }
+  }
+
+  return result;
+}
+
+// Replace the sub-plugins of an index entry with the ones which a shell has
+// just listed, and take ownership of the list. The index may be NULL for an
+// entry which is not part of any index.
+static void _storeVst2xShellPlugins(PluginIndex index, PluginIndexEntry entry,
+                                    LinkedList shellPlugins) {
+  freeLinkedListAndItems(entry->shellPlugins,
+                         (LinkedListFreeItemFunc)freePluginIndexShellPlugin);
+  entry->shellPlugins = shellPlugins;
+
+  if (index != NULL) {
+    index->dirty = true;
+  }
+}
+
+// Get the ID of a shell's sub-plugin from its name or four character ID. The
+// shell is only asked to list its sub-plugins when the index does not know
+// them yet and the name is not an ID, since the sub-plugin is then opened
+// directly by passing its ID through audioMasterCurrentId.
+static VstInt32 _getVst2xShellPluginId(const Plugin plugin,
+                                       const CharString subpluginName) {
+  PluginVst2xData data = (PluginVst2xData)plugin->extraData;
+  PluginIndex index = _openVst2xPluginIndex();
+  PluginIndexEntry entry = _findVst2xPluginIndexEntry(index, plugin);
+  PluginIndexEntry listedEntry = NULL;
+  PluginIndexShellPlugin shellPlugin = NULL;
+  VstInt32 result = 0;
+
+  if (entry != NULL && linkedListLength(entry->shellPlugins) > 0) {
+    shellPlugin = pluginIndexEntryFindShellPlugin(entry, subpluginName->data);
+  } else if (strlen(subpluginName->data) != 4) {
+    currentPluginUniqueId = 0;
+    AEffect *shellHandle = loadVst2xPlugin(data->libraryHandle);
+
+    if (shellHandle != NULL && shellHandle->magic == kEffectMagic) {
+      logInfo("Listing sub-plugins of shell plugin '%s'",
+              plugin->pluginAbsolutePath->data);
+      shellHandle->dispatcher(shellHandle, effOpen, 0, 0, NULL, 0.0f);
+      LinkedList shellPlugins = _listVst2xShellPlugins(shellHandle);
+      shellHandle->dispatcher(shellHandle, effClose, 0, 0, NULL, 0.0f);
+
+      if (entry == NULL) {
+        listedEntry = newPluginIndexEntry("", 0);
+        _storeVst2xShellPlugins(NULL, listedEntry, shellPlugins);
+        entry = listedEntry;
+      } else {
+        _storeVst2xShellPlugins(index, entry, shellPlugins);
+      }
+      shellPlugin =
+          pluginIndexEntryFindShellPlugin(entry, subpluginName->data);
+    }
+  }
+
+  if (shellPlugin != NULL) {
+    result = (VstInt32)shellPlugin->pluginId->id;
+  } else if (strlen(subpluginName->data) == 4) {
+    PluginVst2xId subpluginId = newPluginVst2xIdWithStringId(subpluginName);
+    result = (VstInt32)subpluginId->id;
+    freePluginVst2xId(subpluginId);
+  }
+
+  freePluginIndexEntry(listedEntry);
+  _closeVst2xPluginIndex(index);
+  return result;
+}
+
 static boolByte _openVst2xPlugin(void *pluginPtr) {
   boolByte result = false;
   AEffect *pluginHandle;
@@ -477,12 +1101,7 @@ static boolByte _openVst2xPlugin(void *pluginPtr) {
   size_t separatorPosition = subpluginSeparator - plugin->pluginName->data;
   if (subpluginSeparator != NULL && separatorPosition > 1) {
     *subpluginSeparator = '\0';
-    subpluginIdString = newCharStringWithCapacity(kCharStringLengthShort);
-    strncpy(subpluginIdString->data, subpluginSeparator + 1, 4);
-    PluginVst2xId subpluginId = newPluginVst2xIdWithStringId(subpluginIdString);
-    data->shellPluginId = (VstInt32)subpluginId->id;
-    currentPluginUniqueId = data->shellPluginId;
-    freePluginVst2xId(subpluginId);
+    subpluginIdString = newCharStringWithCString(subpluginSeparator + 1);
   }
 
   File pluginPath = newFileWithPath(plugin->pluginName);
@@ -521,6 +1140,17 @@ static boolByte _openVst2xPlugin(void *pluginPtr) {
     return false;
   }
 
+  if (subpluginIdString != NULL) {
+    data->shellPluginId = _getVst2xShellPluginId(plugin, subpluginIdString);
+    if (data->shellPluginId == 0) {
+      logError("Shell plugin '%s' has no sub-plugin '%s'",
+               plugin->pluginAbsolutePath->data, subpluginIdString->data);
+      freeCharString(subpluginIdString);
+      return false;
+    }
+    currentPluginUniqueId = data->shellPluginId;
+  }
+
   pluginHandle = loadVst2xPlugin(data->libraryHandle);
   if (pluginHandle == NULL) {
     logError("Could not load VST2.x plugin '%s'",
@@ -550,11 +1180,25 @@ static boolByte _openVst2xPlugin(void *pluginPtr) {
   } else {
     data->dispatcher = (Vst2xPluginDispatcherFunc)(pluginHandle->dispatcher);
     data->pluginHandle = pluginHandle;
+    // Created before the plugin is initialized, so that the host callback does
+    // not need to build the ID string each time that the plugin calls it
+    data->pluginId =
+        newPluginVst2xIdWithId((unsigned long)data->pluginHandle->uniqueID);
+
+    if (pluginVst2xRenderMode == PLUGIN_VST2X_RENDER_MODE_OFFLINE &&
+        pluginVst2xGetCapability(plugin, PLUGIN_CAPABILITY_OFFLINE) ==
+            PLUGIN_CAPABILITY_UNSUPPORTED) {
+      logInfo("Plugin '%s' does not work offline, telling it that processing "
+              "happens in realtime",
+              plugin->pluginName->data);
+      data->realtimeOnly = true;
+    }
+    // Let the host callback find this plugin from its AEffect from now on
+    pluginHandle->resvd1 = (VstIntPtr)plugin;
     result = _initVst2xPlugin(plugin);
 
     if (result) {
-      data->pluginId =
-          newPluginVst2xIdWithId((unsigned long)data->pluginHandle->uniqueID);
+      _reserveVst2xEvents(data, kPluginVst2xInitialEventPoolSize);
     }
   }
 
@@ -635,26 +1279,36 @@ static void _displayVst2xPluginInfo(void *pluginPtr) {
           data->pluginHandle->flags & effFlagsHasEditor ? "yes" : "no");
 
   if (data->isPluginShell && data->shellPluginId == 0) {
-    logInfo("Sub-plugins:");
-    nameBuffer = newCharStringWithCapacity(kCharStringLengthShort);
-
-    while (true) {
-      charStringClear(nameBuffer);
-      VstInt32 shellPluginId =
-          (VstInt32)data->dispatcher(data->pluginHandle, effShellGetNextPlugin,
-                                     0, 0, nameBuffer->data, 0.0f);
+    PluginIndex index = _openVst2xPluginIndex();
+    PluginIndexEntry entry = _findVst2xPluginIndexEntry(index, plugin);
+    LinkedList shellPlugins = NULL;
+
+    if (entry == NULL || linkedListLength(entry->shellPlugins) == 0) {
+      shellPlugins = _listVst2xShellPlugins(data->pluginHandle);
+      if (entry != NULL) {
+        _storeVst2xShellPlugins(index, entry, shellPlugins);
+      }
+    }
 
-      if (shellPluginId == 0 || charStringIsEmpty(nameBuffer)) {
-        break;
-      } else {
-        PluginVst2xId subpluginId =
-            newPluginVst2xIdWithId((unsigned long)shellPluginId);
-        logInfo("  '%s' (%s)", subpluginId->idString->data, nameBuffer->data);
-        freePluginVst2xId(subpluginId);
+    logInfo("Sub-plugins:");
+    for (LinkedListIterator iterator =
+             entry != NULL ? entry->shellPlugins : shellPlugins;
+         iterator != NULL; iterator = (LinkedListIterator)iterator->nextItem) {
+      PluginIndexShellPlugin shellPlugin =
+          (PluginIndexShellPlugin)iterator->item;
+
+      if (shellPlugin != NULL) {
+        logInfo("  '%s' (%s)", shellPlugin->pluginId->idString->data,
+                shellPlugin->name->data);
       }
     }
 
-    freeCharString(nameBuffer);
+    if (entry == NULL) {
+      freeLinkedListAndItems(shellPlugins, (LinkedListFreeItemFunc)
+                                               freePluginIndexShellPlugin);
+    }
+
+    _closeVst2xPluginIndex(index);
   } else {
     nameBuffer = newCharStringWithCapacity(kCharStringLengthShort);
     logInfo("Parameters (%d total):", data->pluginHandle->numParams);
@@ -746,17 +1400,102 @@ void pluginVst2xSetProgramChunk(Plugin plugin, char *chunk, size_t chunkSize) {
                    chunk, 0.0f);
 }
 
+void pluginVst2xSetBankChunk(Plugin plugin, char *chunk, size_t chunkSize) {
+  PluginVst2xData data = (PluginVst2xData)plugin->extraData;
+  data->dispatcher(data->pluginHandle, effSetChunk, 0, (VstIntPtr)chunkSize,
+                   chunk, 0.0f);
+}
+
+void pluginVst2xSetProgramName(Plugin plugin, const char *programName) {
+  PluginVst2xData data = (PluginVst2xData)plugin->extraData;
+  char nameBuffer[kVstMaxProgNameLen + 1];
+
+  // Plugins may copy the full buffer size, regardless of the string's length
+  memset(nameBuffer, 0, sizeof(nameBuffer));
+  strncpy(nameBuffer, programName, kVstMaxProgNameLen);
+  data->dispatcher(data->pluginHandle, effSetProgramName, 0, 0, nameBuffer,
+                   0.0f);
+}
+
+boolByte pluginVst2xHasProgramChunks(const Plugin plugin) {
+  PluginVst2xData data = (PluginVst2xData)plugin->extraData;
+  return (boolByte)((data->pluginHandle->flags & effFlagsProgramChunks) != 0);
+}
+
+size_t pluginVst2xGetChunk(Plugin plugin, boolByte isBank, byte **outChunk) {
+  PluginVst2xData data = (PluginVst2xData)plugin->extraData;
+  void *chunk = NULL;
+  VstIntPtr chunkSize = data->dispatcher(
+      data->pluginHandle, effGetChunk, isBank ? 0 : 1, 0, &chunk, 0.0f);
+
+  if (chunk == NULL || chunkSize <= 0) {
+    *outChunk = NULL;
+    return 0;
+  }
+
+  *outChunk = (byte *)chunk;
+  return (size_t)chunkSize;
+}
+
+#if USE_DOUBLE_SAMPLES
+static void _processAudioVst2xPluginWithFloats(PluginVst2xData data,
+                                               SampleBuffer inputs,
+                                               SampleBuffer outputs) {
+  const SampleCount blocksize = outputs->blocksize;
+  ChannelCount channel;
+  SampleCount frame;
+
+  for (channel = 0; channel < inputs->numChannels &&
+                    channel < data->pluginHandle->numInputs;
+       channel++) {
+    for (frame = 0; frame < blocksize; frame++) {
+      data->floatInputs[channel][frame] =
+          (float)inputs->samples[channel][frame];
+    }
+  }
+
+  data->pluginHandle->processReplacing(data->pluginHandle, data->floatInputs,
+                                       data->floatOutputs,
+                                       (VstInt32)blocksize);
+
+  for (channel = 0; channel < outputs->numChannels &&
+                    channel < data->pluginHandle->numOutputs;
+       channel++) {
+    for (frame = 0; frame < blocksize; frame++) {
+      outputs->samples[channel][frame] = data->floatOutputs[channel][frame];
+    }
+  }
+}
+#endif
+
 static void _processAudioVst2xPlugin(void *pluginPtr, SampleBuffer inputs,
                                      SampleBuffer outputs) {
   Plugin plugin = (Plugin)pluginPtr;
   PluginVst2xData data = (PluginVst2xData)plugin->extraData;
+
+  _vst2xProcessing = true;
+#if USE_DOUBLE_SAMPLES
+  if (!data->doublePrecision) {
+    _processAudioVst2xPluginWithFloats(data, inputs, outputs);
+  } else {
+    data->pluginHandle->processDoubleReplacing(
+        data->pluginHandle, inputs->samples, outputs->samples,
+        (VstInt32)outputs->blocksize);
+  }
+#else
   data->pluginHandle->processReplacing(data->pluginHandle, inputs->samples,
                                        outputs->samples,
                                        (VstInt32)outputs->blocksize);
+#endif
+  _vst2xProcessing = false;
 }
 
-static void _fillVstMidiEvent(const MidiEvent midiEvent,
-                              VstMidiEvent *vstMidiEvent) {
+static boolByte _fillVstMidiEvent(PluginVst2xData data,
+                                  const MidiEvent midiEvent,
+                                  PluginVst2xEvent *event) {
+  VstMidiEvent *vstMidiEvent = &(event->midi);
+  VstMidiSysexEvent *vstSysexEvent = &(event->sysex);
+
   switch (midiEvent->eventType) {
   case MIDI_TYPE_REGULAR:
     vstMidiEvent->type = kVstMidiType;
@@ -768,78 +1507,114 @@ static void _fillVstMidiEvent(const MidiEvent midiEvent,
     vstMidiEvent->flags = 0;
     vstMidiEvent->reserved1 = 0;
     vstMidiEvent->reserved2 = 0;
-    break;
+    return true;
 
   case MIDI_TYPE_SYSEX:
-    logUnsupportedFeature("VST2.x plugin sysex messages");
-    break;
+    if (midiEvent->extraData == NULL || midiEvent->extraDataSize == 0) {
+      return false;
+    }
+
+    _reserveVst2xSysexData(data,
+                           data->sysexDataSize + midiEvent->extraDataSize);
+    memcpy(data->sysexData + data->sysexDataSize, midiEvent->extraData,
+           midiEvent->extraDataSize);
+    vstSysexEvent->type = kVstSysExType;
+    vstSysexEvent->byteSize = sizeof(VstMidiSysexEvent);
+    vstSysexEvent->deltaFrames = (VstInt32)midiEvent->deltaFrames;
+    vstSysexEvent->flags = 0;
+    vstSysexEvent->dumpBytes = (VstInt32)midiEvent->extraDataSize;
+    // The sysex pool may still move while the rest of the block is converted,
+    // so only the offset of the dump is kept until then
+    vstSysexEvent->resvd1 = (VstIntPtr)data->sysexDataSize;
+    vstSysexEvent->sysexDump = NULL;
+    vstSysexEvent->resvd2 = 0;
+    data->sysexDataSize += midiEvent->extraDataSize;
+    return true;
 
   case MIDI_TYPE_META:
     // Ignore, don't care
-    break;
+    return false;
 
   default:
     logInternalError("Cannot convert MIDI event type '%d' to VstMidiEvent",
                      midiEvent->eventType);
-    break;
+    return false;
   }
 }
 
+static boolByte _isVstMidiNoteOff(const PluginVst2xEvent *event) {
+  return (boolByte)(event->midi.type == kVstMidiType &&
+                    ((unsigned char)event->midi.midiData[0] >> 4) == 0x08);
+}
+
 static void _processMidiEventsVst2xPlugin(void *pluginPtr,
                                           LinkedList midiEvents) {
   Plugin plugin = (Plugin)pluginPtr;
   PluginVst2xData data = (PluginVst2xData)(plugin->extraData);
-  int numEvents = linkedListLength(midiEvents);
-
-  // Free events from the previous call
-  if (data->vstEvents != NULL) {
-    for (int i = 0; i < data->vstEvents->numEvents; i++) {
-      free(data->vstEvents->events[i]);
-    }
+  LinkedListIterator iterator = midiEvents;
+  int numEvents = 0;
+  int numNoteOffEvents = 0;
+  int noteOffIndex;
+  int otherIndex;
 
-    free(data->vstEvents);
-  }
+  // Convert all events in a single pass over the list. Events from the
+  // previous call are no longer needed, so their storage is reused.
+  data->sysexDataSize = 0;
 
-  data->vstEvents = (struct VstEvents *)malloc(
-      sizeof(struct VstEvent) + (numEvents * sizeof(struct VstEvent *)));
-  data->vstEvents->numEvents = numEvents;
+  while (iterator != NULL) {
+    MidiEvent midiEvent = (MidiEvent)(iterator->item);
 
-  // Some monophonic instruments have problems dealing with the order of MIDI
-  // events, so send them all note off events *first* followed by any other
-  // event types.
-  LinkedListIterator iterator = midiEvents;
-  int outIndex = 0;
+    if (midiEvent != NULL) {
+      if (numEvents == data->vstEventsCapacity) {
+        _reserveVst2xEvents(data, data->vstEventsCapacity > 0
+                                      ? data->vstEventsCapacity * 2
+                                      : kPluginVst2xInitialEventPoolSize);
+      }
 
-  while (iterator != NULL && outIndex < numEvents) {
-    MidiEvent midiEvent = (MidiEvent)(iterator->item);
+      if (_fillVstMidiEvent(data, midiEvent,
+                            &(data->vstMidiEvents[numEvents]))) {
+        if (_isVstMidiNoteOff(&(data->vstMidiEvents[numEvents]))) {
+          numNoteOffEvents++;
+        }
 
-    if (midiEvent != NULL && (midiEvent->status >> 4) == 0x08) {
-      VstMidiEvent *vstMidiEvent = (VstMidiEvent *)malloc(sizeof(VstMidiEvent));
-      _fillVstMidiEvent(midiEvent, vstMidiEvent);
-      data->vstEvents->events[outIndex] = (VstEvent *)vstMidiEvent;
-      outIndex++;
+        numEvents++;
+      }
     }
 
     iterator = (LinkedListIterator)(iterator->nextItem);
   }
 
-  iterator = midiEvents;
+  if (numEvents == 0) {
+    // Only meta events were given, which are handled by the host
+    return;
+  }
 
-  while (iterator != NULL && outIndex < numEvents) {
-    MidiEvent midiEvent = (MidiEvent)(iterator->item);
+  // Some monophonic instruments have problems dealing with the order of MIDI
+  // events, so send them all note off events *first* followed by any other
+  // event types.
+  noteOffIndex = 0;
+  otherIndex = numNoteOffEvents;
 
-    if (midiEvent != NULL && (midiEvent->status >> 4) != 0x08) {
-      VstMidiEvent *vstMidiEvent = (VstMidiEvent *)malloc(sizeof(VstMidiEvent));
-      _fillVstMidiEvent(midiEvent, vstMidiEvent);
-      data->vstEvents->events[outIndex] = (VstEvent *)vstMidiEvent;
-      outIndex++;
+  for (int i = 0; i < numEvents; i++) {
+    PluginVst2xEvent *event = &(data->vstMidiEvents[i]);
+
+    if (event->sysex.type == kVstSysExType) {
+      event->sysex.sysexDump = data->sysexData + event->sysex.resvd1;
+      event->sysex.resvd1 = 0;
     }
 
-    iterator = (LinkedListIterator)(iterator->nextItem);
+    if (_isVstMidiNoteOff(event)) {
+      data->vstEvents->events[noteOffIndex++] = (VstEvent *)event;
+    } else {
+      data->vstEvents->events[otherIndex++] = (VstEvent *)event;
+    }
   }
 
+  data->vstEvents->numEvents = numEvents;
+  _vst2xProcessing = true;
   data->dispatcher(data->pluginHandle, effProcessEvents, 0, 0, data->vstEvents,
                    0.0f);
+  _vst2xProcessing = false;
 }
 
 boolByte pluginVst2xSetProgram(Plugin plugin, const int programNumber) {
@@ -885,14 +1660,12 @@ static boolByte _setParameterVst2xPlugin(void *pluginPtr, unsigned int index,
   Plugin plugin = (Plugin)pluginPtr;
   PluginVst2xData data = (PluginVst2xData)(plugin->extraData);
 
+  // This is called for every automation point and every parameter of a
+  // preset, so it must not do anything besides setting the value
   if (index < (unsigned int)data->pluginHandle->numParams) {
-    CharString valueBuffer = newCharStringWithCapacity(kCharStringLengthShort);
+    _settingVst2xParameter = true;
     data->pluginHandle->setParameter(data->pluginHandle, index, value);
-    data->dispatcher(data->pluginHandle, effGetParamDisplay, index, 0,
-                     valueBuffer->data, 0.0f);
-    logInfo("Set parameter %d on plugin '%s' to %f (%s)", index,
-            plugin->pluginName->data, value, valueBuffer->data);
-    freeCharString(valueBuffer);
+    _settingVst2xParameter = false;
     return true;
   } else {
     logError("Cannot set parameter %d on plugin '%s', invalid index", index,
@@ -937,7 +1710,9 @@ static void _showVst2xEditor(void *pluginPtr) {
              plugin->pluginName->data);
 
     if (_pluginVst2xGetWindowRect(plugin, &windowSize)) {
-      showVst2xEditor(data->pluginHandle, plugin->pluginName, &windowSize);
+      atomicStore(&data->editorCloseRequested, 0);
+      showVst2xEditor(data->pluginHandle, plugin->pluginName, &windowSize,
+                      &data->editorCloseRequested);
     }
   } else {
     logError("Plugin '%s' does not have a GUI editor",
@@ -953,19 +1728,26 @@ static void _closeVst2xPlugin(void *pluginPtr) {
 static void _freeVst2xPluginData(void *pluginDataPtr) {
   PluginVst2xData data = (PluginVst2xData)(pluginDataPtr);
 
-  data->dispatcher(data->pluginHandle, effClose, 0, 0, NULL, 0.0f);
+  // Plugins are also freed without having been opened, for example when only
+  // their capabilities were looked up
+  pluginIdlerRemove(data->pluginHandle);
+  if (data->dispatcher != NULL) {
+    data->dispatcher(data->pluginHandle, effClose, 0, 0, NULL, 0.0f);
+  }
   data->dispatcher = NULL;
   data->pluginHandle = NULL;
   freePluginVst2xId(data->pluginId);
-  closeLibraryHandle(data->libraryHandle);
-
-  if (data->vstEvents != NULL) {
-    for (int i = 0; i < data->vstEvents->numEvents; i++) {
-      free(data->vstEvents->events[i]);
-    }
-
-    free(data->vstEvents);
+  if (data->libraryHandle != NULL) {
+    closeLibraryHandle(data->libraryHandle);
   }
+  free(data->vstEvents);
+  free(data->vstMidiEvents);
+  free(data->sysexData);
+#if USE_DOUBLE_SAMPLES
+  free(data->floatInputs);
+  free(data->floatOutputs);
+  free(data->floatStorage);
+#endif
 }
 
 Plugin newPluginVst2x(const CharString pluginName,
@@ -997,8 +1779,179 @@ Plugin newPluginVst2x(const CharString pluginName,
   extraData->isPluginShell = (boolByte)(shellPluginDelimiter != NULL);
   extraData->shellPluginId = 0;
   extraData->vstEvents = NULL;
+  extraData->vstMidiEvents = NULL;
+  extraData->vstEventsCapacity = 0;
+  extraData->sysexData = NULL;
+  extraData->sysexDataSize = 0;
+  extraData->sysexDataCapacity = 0;
+  extraData->sampleRate = 0.0;
+  extraData->blocksize = 0;
+  extraData->renderContext = getRenderContext();
+  memset(&(extraData->timeInfo), 0, sizeof(VstTimeInfo));
+  extraData->editorCloseRequested = 0;
+  extraData->automationControl = NULL;
+  extraData->automationPluginIndex = 0;
+  extraData->realtimeOnly = false;
+#if USE_DOUBLE_SAMPLES
+  extraData->doublePrecision = false;
+  extraData->floatInputs = NULL;
+  extraData->floatOutputs = NULL;
+  extraData->floatStorage = NULL;
+  extraData->floatBlocksize = 0;
+#endif
   plugin->extraData = extraData;
 
   return plugin;
 }
+
+static Plugin _newVst2xProbeInstance(void *userData) {
+  return newPluginVst2x((CharString)userData, NULL);
+}
+
+// Probe each capability of a scanned plugin, and write the results right away
+// so that the scanner knows which probe was running if the plugin crashes
+static void _probeVst2xPlugin(Plugin plugin, const CharString pluginPath) {
+  PluginProbe probe =
+      newPluginProbe(plugin, _newVst2xProbeInstance, pluginPath);
+  PluginCapabilityState state;
+
+  for (int i = 0; i < NUM_PLUGIN_CAPABILITIES; i++) {
+    PluginCapability capability = (PluginCapability)i;
+
+    // The scanner has no other use for the render mode, and offline is the
+    // last capability which is probed
+    if (capability == PLUGIN_CAPABILITY_OFFLINE) {
+      pluginVst2xSetRenderMode(PLUGIN_VST2X_RENDER_MODE_OFFLINE);
+    }
+
+    pluginScannerWriteProbe(stdout, capability);
+    fflush(stdout);
+    state = pluginProbeRun(probe, capability);
+    pluginScannerWriteCapability(stdout, capability, state);
+    fflush(stdout);
+  }
+
+  freePluginProbe(probe);
+}
+
+boolByte pluginVst2xScan(const CharString pluginPath) {
+  Plugin plugin = newPluginVst2x(pluginPath, NULL);
+  PluginVst2xData data = (PluginVst2xData)plugin->extraData;
+  LinkedList shellPlugins;
+
+  if (!plugin->openPlugin(plugin)) {
+    freePlugin(plugin);
+    return false;
+  }
+
+  pluginScannerWriteResult(stdout, plugin->pluginType, data->pluginId->id,
+                           data->pluginHandle->numInputs,
+                           data->pluginHandle->numOutputs);
+
+  if (data->isPluginShell && data->shellPluginId == 0) {
+    shellPlugins = _listVst2xShellPlugins(data->pluginHandle);
+
+    for (LinkedListIterator iterator = shellPlugins; iterator != NULL;
+         iterator = (LinkedListIterator)iterator->nextItem) {
+      PluginIndexShellPlugin shellPlugin =
+          (PluginIndexShellPlugin)iterator->item;
+
+      if (shellPlugin != NULL) {
+        pluginScannerWriteShellPlugin(stdout, shellPlugin->pluginId->id,
+                                      shellPlugin->name->data);
+      }
+    }
+
+    freeLinkedListAndItems(shellPlugins, (LinkedListFreeItemFunc)
+                                             freePluginIndexShellPlugin);
+  } else if (plugin->pluginType == PLUGIN_TYPE_EFFECT ||
+             plugin->pluginType == PLUGIN_TYPE_INSTRUMENT) {
+    _probeVst2xPlugin(plugin, pluginPath);
+  }
+
+  fflush(stdout);
+  plugin->closePlugin(plugin);
+  freePlugin(plugin);
+  return true;
+}
+
+typedef struct {
+  PluginIndex index;
+  PluginScanner scanner;
+  unsigned int numPlugins;
+} _PluginVst2xScanData;
+
+static void _addVst2xPluginsToScanner(void *item, void *userData) {
+  CharString locationString = (CharString)item;
+  _PluginVst2xScanData *scanData = (_PluginVst2xScanData *)userData;
+  PluginIndexLocation location =
+      pluginIndexGetLocation(scanData->index, locationString);
+  CharString pluginPath = newCharString();
+
+  for (LinkedListIterator iterator = location != NULL ? location->entries
+                                                      : NULL;
+       iterator != NULL; iterator = (LinkedListIterator)iterator->nextItem) {
+    PluginIndexEntry entry = (PluginIndexEntry)iterator->item;
+
+    if (entry != NULL && !entry->scanned) {
+      snprintf(pluginPath->data, pluginPath->capacity, "%s%c%s%s",
+               location->path->data, PATH_DELIMITER, entry->name->data,
+               _getVst2xPlatformExtension());
+      pluginScannerAdd(scanData->scanner, pluginPath, entry);
+      scanData->numPlugins++;
+    }
+  }
+
+  freeCharString(pluginPath);
+}
+
+boolByte scanAvailablePluginsVst2x(const CharString pluginRoot,
+                                   unsigned int numJobs, double timeoutInMs) {
+  _PluginVst2xScanData scanData;
+  CharString executable;
+  LinkedList arguments;
+  LinkedList pluginLocations;
+  unsigned int numScanned;
+
+  scanData.index = _openVst2xPluginIndex();
+  if (scanData.index == NULL) {
+    logError("Scanning plugins requires a plugin index, see --plugin-index");
+    return false;
+  }
+
+  // Each plugin is loaded by running this program again in scanner mode
+  executable = fileGetExecutablePath();
+  arguments = newLinkedList();
+  linkedListAppend(arguments, newCharStringWithCString("--quiet"));
+  linkedListAppend(arguments, newCharStringWithCString("--scan-plugin"));
+  scanData.scanner =
+      newPluginScanner(executable, arguments, numJobs, timeoutInMs);
+  scanData.numPlugins = 0;
+  freeLinkedListAndItems(arguments, (LinkedListFreeItemFunc)freeCharString);
+  freeCharString(executable);
+
+  if (!charStringIsEmpty(pluginRoot)) {
+    _addVst2xPluginsToScanner(pluginRoot, &scanData);
+  }
+
+  pluginLocations = getVst2xPluginLocations(fileGetCurrentDirectory());
+  linkedListForeach(pluginLocations, _addVst2xPluginsToScanner, &scanData);
+  freeLinkedListAndItems(pluginLocations,
+                         (LinkedListFreeItemFunc)freeCharString);
+
+  logInfo("Scanning %u plugins with %u jobs", scanData.numPlugins,
+          scanData.scanner->numJobs);
+  numScanned = pluginScannerRun(scanData.scanner);
+  logInfo("Scanned %u of %u plugins", numScanned, scanData.numPlugins);
+
+  // Failed plugins are also marked in the index, so that they are skipped
+  // until the plugin file changes
+  if (scanData.numPlugins > 0) {
+    scanData.index->dirty = true;
+  }
+
+  freePluginScanner(scanData.scanner);
+  _closeVst2xPluginIndex(scanData.index);
+  return true;
+}
 }
@@ -28,10 +28,29 @@
 #define MrsWatson_PluginVst2x_h
 
 #include "base/CharString.h"
+#include "base/LinkedList.h"
 #include "plugin/Plugin.h"
+#include "plugin/PluginCapabilities.h"
+#include "plugin/PluginControl.h"
 
 static const char kPluginVst2xSubpluginSeparator = ':';
 
+/**
+ * How the host renders, which VST plugins are told when they ask for the
+ * current process level
+ */
+typedef enum {
+  // The process level is reported as unknown, which was the only behavior
+  // before the other modes were added
+  PLUGIN_VST2X_RENDER_MODE_DEFAULT,
+  // Processing happens in realtime, so plugins must never block
+  PLUGIN_VST2X_RENDER_MODE_REALTIME,
+  // Processing happens offline, so plugins may block while processing, for
+  // example to wait for samples which are streamed from disk
+  PLUGIN_VST2X_RENDER_MODE_OFFLINE,
+  NUM_PLUGIN_VST2X_RENDER_MODES
+} PluginVst2xRenderMode;
+
 /**
  * List all available VST2.x plugins in common system locations. Note that this
  * function does not do recursive searches (yet).
@@ -74,6 +93,77 @@ unsigned long pluginVst2xGetVersion(const Plugin self);
 boolByte pluginVst2xExists(const CharString pluginName,
                            const CharString pluginRoot);
 
+/**
+ * Resolve and list plugins through a persistent index rather than searching
+ * each plugin location on disk. The index is updated whenever a location has
+ * been modified since it was last indexed.
+ * @param indexFile Path to the index file, or an empty string to disable the
+ * index
+ */
+void pluginVst2xSetIndexFile(const CharString indexFile);
+
+/**
+ * Look up a capability of a VST plugin in the plugin index. The plugin does not
+ * need to be open, but it must have been scanned, see
+ * scanAvailablePluginsVst2x().
+ * @param plugin Plugin created with newPluginVst2x()
+ * @param capability Capability to look up
+ * @return State of the capability, or PLUGIN_CAPABILITY_UNKNOWN if no plugin
+ * index has been set or the plugin has not been scanned
+ */
+PluginCapabilityState pluginVst2xGetCapability(const Plugin plugin,
+                                               PluginCapability capability);
+
+/**
+ * Set capabilities of plugins in the plugin index by hand. The plugins are
+ * found by their IDs, so the settings also apply to copies of the same plugin
+ * in other locations, and are kept when the plugins are scanned again.
+ * @param capabilities List of char* strings in the format
+ * "name,capability,state", where the state is "yes", "no", or "auto" to use the
+ * probed state again
+ * @param pluginRoot User-provided plugin root path
+ * @return False if no plugin index has been set, or if any of the plugins has
+ * not been scanned or any of the strings is invalid
+ */
+boolByte pluginVst2xSetCapabilities(const LinkedList capabilities,
+                                    const CharString pluginRoot);
+
+/**
+ * Set how the host renders for all VST plugins. This must be called before
+ * any plugins are opened. With a render mode other than the default, plugins
+ * which ask for the current process level while they process audio or MIDI
+ * are told that processing happens in realtime or offline, and any other
+ * calls are reported to come from a user thread.
+ * @param renderMode Render mode
+ */
+void pluginVst2xSetRenderMode(PluginVst2xRenderMode renderMode);
+
+/**
+ * @return Render mode set with pluginVst2xSetRenderMode()
+ */
+PluginVst2xRenderMode pluginVst2xGetRenderMode(void);
+
+/**
+ * Collect the type, unique ID, I/O configuration, and shell sub-plugins of
+ * every plugin in the plugin index which has not been scanned yet. Each plugin
+ * is loaded in a separate child process running pluginVst2xScan(), so plugins
+ * which crash or hang do not stop the scan.
+ * @param pluginRoot User-provided plugin root path
+ * @param numJobs Maximum number of plugins to load at once
+ * @param timeoutInMs Time after which a plugin is considered to be hanging
+ * @return False if no plugin index has been set
+ */
+boolByte scanAvailablePluginsVst2x(const CharString pluginRoot,
+                                   unsigned int numJobs, double timeoutInMs);
+
+/**
+ * Load a single plugin and print its information to stdout, in the format
+ * expected by the plugin scanner.
+ * @param pluginPath Absolute path to the plugin
+ * @return True if the plugin could be loaded
+ */
+boolByte pluginVst2xScan(const CharString pluginPath);
+
 /**
  * Set an internal program number for a VST2.x plugin.
  * @param self
@@ -85,9 +175,61 @@ boolByte pluginVst2xSetProgram(Plugin self, const int programNumber);
 /**
  * Set chuck preset data from an FXP preset to a VST2.x plugin.
  * @param self
- * @param chunk Chunk data to set
+ * @param chunk Chunk data to set. This may point into a read-only mapping of
+ * the preset file, and is not copied before it is passed to the plugin.
  * @param chunkSize Chunk size
  */
 void pluginVst2xSetProgramChunk(Plugin self, char *chunk, size_t chunkSize);
 
+/**
+ * Set chunk data for all programs from an FXB bank to a VST2.x plugin.
+ * @param self
+ * @param chunk Chunk data to set, which is not copied
+ * @param chunkSize Chunk size
+ */
+void pluginVst2xSetBankChunk(Plugin self, char *chunk, size_t chunkSize);
+
+/**
+ * Set the name of the plugin's current program.
+ * @param self
+ * @param programName New name, which is truncated to the VST limit
+ */
+void pluginVst2xSetProgramName(Plugin self, const char *programName);
+
+/**
+ * @param self
+ * @return True if the plugin saves its state as opaque chunk data
+ */
+boolByte pluginVst2xHasProgramChunks(const Plugin self);
+
+/**
+ * Get the plugin's current state as opaque chunk data.
+ * @param self
+ * @param isBank True to get the state of all programs, false for only the
+ * current program
+ * @param outChunk Receives a pointer to the chunk data, which is owned by the
+ * plugin and is only valid until the plugin is called again
+ * @return Size of the chunk data, or 0 if the plugin did not return a chunk
+ */
+size_t pluginVst2xGetChunk(Plugin self, boolByte isBank, byte **outChunk);
+
+/**
+ * Queue the parameter changes which the plugin reports to the host, for
+ * example when a knob is turned in its editor, so that the plugin chain also
+ * applies them to the other instances of the plugin between two blocks.
+ * @param self
+ * @param control Queue for the changes, or NULL to stop queueing them. It must
+ * be attached to the chain with pluginChainSetControl().
+ * @param pluginIndex Index of this plugin in the chain
+ */
+void pluginVst2xSetAutomationControl(Plugin self, PluginControl control,
+                                     unsigned int pluginIndex);
+
+/**
+ * Close the plugin's editor window, which may be shown on another thread. The
+ * editor's showEditor() call returns shortly afterwards.
+ * @param self
+ */
+void pluginVst2xCloseEditor(Plugin self);
+
 #endif
@@ -33,6 +33,8 @@
 // C includes
 extern "C" {
 #include "app/BuildInfo.h"
+#include "app/RenderContext.h"
+#include "app/SamplingProfiler.h"
 #include "audio/AudioSettings.h"
 #include "base/CharString.h"
 #include "logging/EventLogger.h"
@@ -41,12 +43,18 @@ extern "C" {
 #include "plugin/PluginVst2xId.h"
 #include "time/AudioClock.h"
 
-#include <math.h>
 #include <stdio.h>
 #include <string.h>
 
 void pluginVst2xAudioMasterIOChanged(const Plugin self,
                                      AEffect const *const newValues);
+void pluginVst2xAudioMasterAutomate(const Plugin self, VstInt32 index,
+                                    float value);
+void pluginVst2xAudioMasterNeedIdle(const Plugin self);
+VstInt32 pluginVst2xGetProcessLevel(const Plugin plugin);
+RenderContext pluginVst2xGetRenderContext(const Plugin self);
+VstTimeInfo *pluginVst2xGetTimeInfo(const Plugin self);
+const char *pluginVst2xGetIdString(const Plugin self);
 }
 
 // Global variables (sigh, unfortunately yes). When plugins ask for the time,
@@ -55,89 +63,154 @@ void pluginVst2xAudioMasterIOChanged(const Plugin self,
 // afterwards... which is actually the correct thing to do, given that if this
 // were the case, a huge number of plugins would probably fail to do this and
 // leak memory all over the place. Anyways, since we cannot scope this variable
-// intelligently, we instead keep one instance of it as a static variable, so it
-// is always available to plugins when they ask for the time.
-static VstTimeInfo vstTimeInfo;
+// intelligently, each plugin keeps its own instance in its extra data, so it
+// is always available to plugins when they ask for the time. This static
+// instance is only used when a plugin asks for the time before it has been
+// fully loaded, since its AEffect does not point back to it yet.
+static THREAD_LOCAL VstTimeInfo vstTimeInfo;
 
 extern "C" {
 
 // Current plugin ID, which is mostly used by shell plugins during
 // initialization. See PluginVst2x.cpp for more details, including why this
 // must be global.
-extern VstInt32 currentPluginUniqueId;
+extern THREAD_LOCAL VstInt32 currentPluginUniqueId;
+
+typedef struct {
+  unsigned long hash;
+  const char *canDoString;
+  boolByte supported;
+} HostCanDoEntry;
+
+// Answers to audioMasterCanDo, sorted by the FNV-1a hash of each string so that
+// a query only needs a binary search over the hashes and a single strcmp().
+// When adding an entry, compute its hash with _hashCanDoString() and insert it
+// in order.
+static const HostCanDoEntry kHostCanDoEntries[] = {
+    {0x1c0bba7dul, "sendVstEvents", true},
+    {0x1f739918ul, "sendVstMidiEventFlagIsRealtime", false},
+    {0x27a66434ul, "closeFileSelector", false},
+    {0x30a348e4ul, "reportConnectionChanges", false},
+    {0x3eb6ff52ul, "acceptIOChanges", false},
+    {0x517ccd77ul, "sendVstMidiEvent", true},
+    {0x6edcdfdeul, "receiveVstMidiEvent", false},
+    {0x76023386ul, "openFileSelector", false},
+    {0x9be36fc5ul, "sendVstTimeInfo", true},
+    {0xa3fa52bdul, "shellCategory", true},
+    {0xb13aa254ul, "startStopProcess", true},
+    {0xd279777eul, "receiveVstEvents", false},
+    {0xec8b9928ul, "offline", false},
+    {0xfefaf100ul, "sizeWindow", false},
+};
+static const int kNumHostCanDoEntries =
+    sizeof(kHostCanDoEntries) / sizeof(HostCanDoEntry);
+
+static unsigned long _hashCanDoString(const char *canDoString) {
+  unsigned long hash = 0x811c9dc5ul;
+  const unsigned char *c;
+
+  for (c = (const unsigned char *)canDoString; *c != '\0'; c++) {
+    hash = ((hash ^ *c) * 0x01000193ul) & 0xfffffffful;
+  }
+
+  return hash;
+}
+
+static const HostCanDoEntry *_findHostCanDoEntry(const char *canDoString) {
+  const unsigned long hash = _hashCanDoString(canDoString);
+  int low = 0;
+  int high = kNumHostCanDoEntries - 1;
+  int middle;
+
+  while (low <= high) {
+    middle = low + (high - low) / 2;
+
+    if (kHostCanDoEntries[middle].hash < hash) {
+      low = middle + 1;
+    } else if (kHostCanDoEntries[middle].hash > hash) {
+      high = middle - 1;
+    } else if (!strcmp(kHostCanDoEntries[middle].canDoString, canDoString)) {
+      return &kHostCanDoEntries[middle];
+    } else {
+      return NULL;
+    }
+  }
+
+  return NULL;
+}
 
 static int _canHostDo(const char *pluginName, const char *canDoString) {
-  boolByte supported = false;
+  const HostCanDoEntry *entry;
 
-  logDebug("Plugin '%s' asked if we can do '%s'", pluginName, canDoString);
+  logDebugFast("Plugin '%s' asked if we can do '%s'", pluginName, canDoString);
 
   if (!strcmp(canDoString, EMPTY_STRING)) {
     logWarn("Plugin '%s' asked if we can do an empty string. This is probably "
             "a bug in the plugin.",
             pluginName);
-  } else if (!strcmp(canDoString, "sendVstEvents")) {
-    supported = true;
-  } else if (!strcmp(canDoString, "sendVstMidiEvent")) {
-    supported = true;
-  } else if (!strcmp(canDoString, "sendVstTimeInfo")) {
-    supported = true;
-  } else if (!strcmp(canDoString, "receiveVstEvents")) {
-    supported = false;
-  } else if (!strcmp(canDoString, "receiveVstMidiEvent")) {
-    supported = false;
-  } else if (!strcmp(canDoString, "reportConnectionChanges")) {
-    supported = false;
-  } else if (!strcmp(canDoString, "acceptIOChanges")) {
-    supported = false;
-  } else if (!strcmp(canDoString, "sizeWindow")) {
-    supported = false;
-  } else if (!strcmp(canDoString, "offline")) {
-    supported = false;
-  } else if (!strcmp(canDoString, "openFileSelector")) {
-    supported = false;
-  } else if (!strcmp(canDoString, "closeFileSelector")) {
-    supported = false;
-  } else if (!strcmp(canDoString, "startStopProcess")) {
-    supported = true;
-  } else if (!strcmp(canDoString, "shellCategory")) {
-    supported = true;
-  } else if (!strcmp(canDoString, "sendVstMidiEventFlagIsRealtime")) {
-    supported = false;
-  } else {
+    return false;
+  }
+
+  entry = _findHostCanDoEntry(canDoString);
+
+  if (entry == NULL) {
     logInfo("Plugin '%s' asked if host canDo '%s' (unimplemented)", pluginName,
             canDoString);
+    return false;
   }
 
-  return supported;
+  return entry->supported;
 }
 
 VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
                                               VstInt32 index, VstIntPtr value,
                                               void *dataPtr, float opt) {
   // This string is used in a bunch of logging calls below
-  PluginVst2xId pluginId;
-
-  if (effect != NULL) {
-    pluginId = newPluginVst2xIdWithId((unsigned long)effect->uniqueID);
-  } else {
-    // During plugin initialization, the dispatcher can be called without a
-    // valid plugin instance, as the AEffect* struct is still not fully
-    // constructed at that point.
-    pluginId = newPluginVst2xId();
+  const char *pluginIdString = NULL;
+  PluginVst2xId pluginId = NULL;
+  VstIntPtr result = 0;
+  // Once loaded, each AEffect points back to its plugin, see _openVst2xPlugin()
+  Plugin plugin = effect != NULL ? (Plugin)effect->resvd1 : NULL;
+  RenderContext previousRenderContext = getRenderContext();
+  VstTimeInfo *timeInfo = &vstTimeInfo;
+  SamplingProfilerFrame previousProfilerFrame =
+      samplingProfilerEnterHostCallback();
+  uint64_t hostCallbackEnterTime = pluginChainEnterHostCallback();
+
+  if (plugin != NULL) {
+    // Plugins may call the host from their own threads, so the render context
+    // which the plugin was created in must be used to look up any settings
+    renderContextMakeCurrent(pluginVst2xGetRenderContext(plugin));
+    timeInfo = pluginVst2xGetTimeInfo(plugin);
+    pluginIdString = pluginVst2xGetIdString(plugin);
   }
 
-  const char *pluginIdString = pluginId->idString->data;
-  VstIntPtr result = 0;
+  // Plugins which are still loading do not have an ID string yet, so build a
+  // temporary one for them
+  if (pluginIdString == NULL) {
+    if (effect != NULL) {
+      pluginId = newPluginVst2xIdWithId((unsigned long)effect->uniqueID);
+    } else {
+      // During plugin initialization, the dispatcher can be called without a
+      // valid plugin instance, as the AEffect* struct is still not fully
+      // constructed at that point.
+      pluginId = newPluginVst2xId();
+    }
+
+    pluginIdString = pluginId->idString->data;
+  }
 
-  logDebug("Plugin '%s' called host dispatcher with %d, %d, %d", pluginIdString,
-           opcode, index, value);
+  logDebugFast("Plugin '%s' called host dispatcher with %d, %d, %d",
+               pluginIdString, opcode, index, value);
 
   switch (opcode) {
   case audioMasterAutomate:
     // The plugin will call this if a parameter has changed via MIDI or the GUI,
-    // so the host can update itself accordingly. We don't care about this (for
-    // the time being), and as we don't support either GUI's or live MIDI, this
-    // opcode can be ignored.
+    // so the host can update itself accordingly. This usually happens on the
+    // editor's thread, so the change is only queued for the plugin chain.
+    if (plugin != NULL) {
+      pluginVst2xAudioMasterAutomate(plugin, index, opt);
+    }
     break;
 
   case audioMasterVersion:
@@ -168,16 +241,18 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
 
   case audioMasterGetTime: {
     AudioClock audioClock = getAudioClock();
+    // Calculated once per block by the clock, no matter how often plugins ask
+    AudioClockPosition position = audioClockGetPosition(audioClock);
 
     // These values are always valid
-    vstTimeInfo.samplePos = audioClock->currentFrame;
-    vstTimeInfo.sampleRate = getSampleRate();
+    timeInfo->samplePos = audioClock->currentFrame;
+    timeInfo->sampleRate = position->sampleRate;
 
     // Set flags for transport state
-    vstTimeInfo.flags = 0;
-    vstTimeInfo.flags |=
+    timeInfo->flags = 0;
+    timeInfo->flags |=
         audioClock->transportChanged ? kVstTransportChanged : 0;
-    vstTimeInfo.flags |= audioClock->isPlaying ? kVstTransportPlaying : 0;
+    timeInfo->flags |= audioClock->isPlaying ? kVstTransportPlaying : 0;
 
     // Fill values based on other flags which may have been requested
     if (value & kVstNanosValid) {
@@ -191,17 +266,13 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
     }
 
     if (value & kVstPpqPosValid) {
-      // TODO: Move calculations to AudioClock
-      double samplesPerBeat = (60.0 / getTempo()) * getSampleRate();
-      // Musical time starts with 1, not 0
-      vstTimeInfo.ppqPos = (vstTimeInfo.samplePos / samplesPerBeat) + 1.0;
-      logDebug("Current PPQ position is %g", vstTimeInfo.ppqPos);
-      vstTimeInfo.flags |= kVstPpqPosValid;
+      timeInfo->ppqPos = position->ppqPosition;
+      timeInfo->flags |= kVstPpqPosValid;
     }
 
     if (value & kVstTempoValid) {
-      vstTimeInfo.tempo = getTempo();
-      vstTimeInfo.flags |= kVstTempoValid;
+      timeInfo->tempo = position->tempo;
+      timeInfo->flags |= kVstTempoValid;
     }
 
     if (value & kVstBarsValid) {
@@ -209,13 +280,8 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
         logError("Plugin requested position in bars, but not PPQ");
       }
 
-      // TODO: Move calculations to AudioClock
-      double currentBarPos =
-          floor(vstTimeInfo.ppqPos / (double)getTimeSignatureBeatsPerMeasure());
-      vstTimeInfo.barStartPos =
-          currentBarPos * (double)getTimeSignatureBeatsPerMeasure() + 1.0;
-      logDebug("Current bar is %g", vstTimeInfo.barStartPos);
-      vstTimeInfo.flags |= kVstBarsValid;
+      timeInfo->barStartPos = position->barStartPosition;
+      timeInfo->flags |= kVstBarsValid;
     }
 
     if (value & kVstCyclePosValid) {
@@ -223,9 +289,9 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
     }
 
     if (value & kVstTimeSigValid) {
-      vstTimeInfo.timeSigNumerator = getTimeSignatureBeatsPerMeasure();
-      vstTimeInfo.timeSigDenominator = getTimeSignatureNoteValue();
-      vstTimeInfo.flags |= kVstTimeSigValid;
+      timeInfo->timeSigNumerator = position->timeSignatureBeatsPerMeasure;
+      timeInfo->timeSigDenominator = position->timeSignatureNoteValue;
+      timeInfo->flags |= kVstTimeSigValid;
     }
 
     if (value & kVstSmpteValid) {
@@ -236,7 +302,7 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
       logUnsupportedFeature("Sample frames until next clock");
     }
 
-    result = (VstIntPtr)&vstTimeInfo;
+    result = (VstIntPtr)timeInfo;
     break;
   }
 
@@ -269,6 +335,13 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
       logDebug("Initial Delay: %d", effect->initialDelay);
       result = -1;
 
+      if (plugin != NULL) {
+        logDebug("Updating plugin");
+        pluginVst2xAudioMasterIOChanged(plugin, effect);
+        result = 0;
+        break;
+      }
+
       for (unsigned int i = 0; i < pluginChain->numPlugins; ++i) {
         if ((unsigned long)effect->uniqueID ==
             pluginVst2xGetUniqueId(pluginChain->plugins[i])) {
@@ -284,7 +357,16 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
   }
 
   case audioMasterNeedIdle:
-    logDeprecated("audioMasterNeedIdle", pluginIdString);
+    // Deprecated, but still used by plugins which do deferred work such as
+    // streaming samples in effIdle, which is then called on a background
+    // thread, see PluginIdler.h
+    if (plugin != NULL) {
+      pluginVst2xAudioMasterNeedIdle(plugin);
+      result = 1;
+    } else {
+      logWarn("Plugin '%s' asked for idle calls before it was loaded",
+              pluginIdString);
+    }
     break;
 
   case audioMasterSizeWindow:
@@ -301,13 +383,13 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
     break;
 
   case audioMasterGetInputLatency:
-    // Input latency is not used, and is always 0
-    result = 0;
+    // Only nonzero when processing audio from a live input device
+    result = getInputLatency();
     break;
 
   case audioMasterGetOutputLatency:
-    // Output latency is not used, and is always 0
-    result = 0;
+    // Only nonzero when playing audio through a live output device
+    result = getOutputLatency();
     break;
 
   case audioMasterGetPreviousPlug:
@@ -323,8 +405,9 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
     break;
 
   case audioMasterGetCurrentProcessLevel:
-    // We are not a multi-threaded app and have no GUI, so this is unsupported
-    result = kVstProcessLevelUnknown;
+    // Disk-streaming samplers usually only wait for their samples instead of
+    // dropping voices when they are told that processing happens offline
+    result = pluginVst2xGetProcessLevel(plugin);
     break;
 
   case audioMasterGetAutomationState:
@@ -332,6 +415,9 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
     result = kVstAutomationUnsupported;
     break;
 
+  // The offline interface is only for plugins which process whole files on
+  // their own, which MrsWatson does not host. Offline rendering is reported
+  // through audioMasterGetCurrentProcessLevel instead.
   case audioMasterOfflineStart:
     logWarn("Plugin '%s' asked us to start offline processing (unsupported)",
             pluginIdString);
@@ -456,7 +542,10 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
     break;
   }
 
+  renderContextMakeCurrent(previousRenderContext);
   freePluginVst2xId(pluginId);
+  samplingProfilerSetFrame(previousProfilerFrame);
+  pluginChainExitHostCallback(hostCallbackEnterTime);
   return result;
 }
 } // extern "C"
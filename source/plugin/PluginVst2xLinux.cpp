@@ -32,9 +32,11 @@
 extern "C" {
 #include "base/CharString.h"
 #include "base/LinkedList.h"
+#include "base/Thread.h"
 #include "logging/EventLogger.h"
 #include "plugin/Plugin.h"
 #include "plugin/PluginVst2xHostCallback.h"
+#include "time/TaskTimer.h"
 #include <X11/Xlib.h>
 #include <dlfcn.h>
 #include <stdlib.h>
@@ -104,8 +106,12 @@ AEffect *loadVst2xPlugin(LibraryHandle libraryHandle) {
   return plugin;
 }
 
+// Editors expect to be idled about as often as the screen is redrawn
+static const double kVst2xEditorIdleIntervalInMs = 20.0;
+
 extern void showVst2xEditor(AEffect *effect, const CharString pluginName,
-                            PluginWindowSize *rect) {
+                            PluginWindowSize *rect,
+                            volatile unsigned int *closeRequested) {
 // Bah, this stuff doesn't build so well for 32-bit Linux on a 64-bit
 // machine. Since most people in the Linux audio community have been able to
 // move to 64-bit, this feature is unavailable on 32-bit Linux.
@@ -115,6 +121,9 @@ extern void showVst2xEditor(AEffect *effect, const CharString pluginName,
   XEvent event;
   int screenNumber;
 
+  // The editor may run on its own thread while audio is processed, and the
+  // plugin may also talk to the X server from its own threads
+  XInitThreads();
   logDebug("Opening X display");
   display = XOpenDisplay(NULL);
 
@@ -145,14 +154,18 @@ extern void showVst2xEditor(AEffect *effect, const CharString pluginName,
   logInfo("Opening plugin editor window");
   effect->dispatcher(effect, effEditOpen, 0, 0, (void *)window, 0);
 
-  while (true) {
-    XNextEvent(display, &event);
-
-    if (event.type == Expose) {
-    }
-
-    if (event.type == KeyPress) {
-      break;
+  // Events are only read when there are some, so that the editor is idled
+  // regularly and the host can close the window while nothing happens in it
+  while (closeRequested == NULL || !atomicLoad(closeRequested)) {
+    if (XPending(display) > 0) {
+      XNextEvent(display, &event);
+
+      if (event.type == KeyPress) {
+        break;
+      }
+    } else {
+      effect->dispatcher(effect, effEditIdle, 0, 0, 0, 0);
+      taskTimerSleep(kVst2xEditorIdleIntervalInMs);
     }
   }
 
@@ -136,9 +136,18 @@ extern "C" {
         return plugin;
     }
 
-    void showVst2xEditor(AEffect* effect, const CharString pluginName, PluginWindowSize *rect);
-    void showVst2xEditor(AEffect* effect, const CharString pluginName, PluginWindowSize *rect) {
+    void showVst2xEditor(AEffect* effect, const CharString pluginName, PluginWindowSize *rect,
+                         volatile unsigned int *closeRequested);
+    void showVst2xEditor(AEffect* effect, const CharString pluginName, PluginWindowSize *rect,
+                         volatile unsigned int *closeRequested) {
 #if defined(WITH_GUI) && PLATFORM_BITS == 64
+        // AppKit only runs its event loop on the main thread, which is busy
+        // processing audio when the editor is shown beside it
+        if (![NSThread isMainThread]) {
+            logUnsupportedFeature("Showing plugin editor while processing audio");
+            return;
+        }
+
         NSRect frame;
         NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
         [NSApplication sharedApplication];
@@ -117,7 +117,8 @@ AEffect *loadVst2xPlugin(LibraryHandle libraryHandle) {
 }
 
 void showVst2xEditor(AEffect *effect, const CharString pluginName,
-                     PluginWindowSize *rect) {
+                     PluginWindowSize *rect,
+                     volatile unsigned int *closeRequested) {
   logUnsupportedFeature("Show VST editor on Windows");
 }
 
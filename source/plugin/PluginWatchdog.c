@@ -0,0 +1,171 @@
+//
+// PluginWatchdog.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PluginWatchdog.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+
+// Bounds for how often the timers are checked, which is a fraction of the
+// budget so that a hung plugin is caught soon after the budget is exceeded
+#define PLUGIN_WATCHDOG_MIN_INTERVAL_IN_MS 1.0
+#define PLUGIN_WATCHDOG_MAX_INTERVAL_IN_MS 100.0
+#define PLUGIN_WATCHDOG_CHECKS_PER_BUDGET 4.0
+
+PluginWatchdog newPluginWatchdog(PluginChain pluginChain, double budgetInMs,
+                                 PluginWatchdogExpiredFunc expiredFunc,
+                                 void *userData) {
+  PluginWatchdog self = (PluginWatchdog)malloc(sizeof(PluginWatchdogMembers));
+  unsigned int i;
+
+  self->pluginChain = pluginChain;
+  self->budgetInMs = budgetInMs;
+  self->expiredFunc = expiredFunc;
+  self->userData = userData;
+  self->expired = false;
+
+  self->_thread = NULL;
+  self->_stop = false;
+  self->_clock = newTaskTimerWithCString("PluginWatchdog", "Clock");
+  // Each plugin has an audio and a MIDI timer
+  self->_numWatched = pluginChain->numPlugins * 2;
+  self->_watchedNumTasks =
+      (unsigned long *)malloc(sizeof(unsigned long) * (self->_numWatched + 1));
+  self->_watchedSinceInMs =
+      (double *)malloc(sizeof(double) * (self->_numWatched + 1));
+
+  for (i = 0; i < self->_numWatched; i++) {
+    self->_watchedNumTasks[i] = 0;
+    self->_watchedSinceInMs[i] = -1.0;
+  }
+
+  return self;
+}
+
+static void _pluginWatchdogThread(void *userData) {
+  PluginWatchdog self = (PluginWatchdog)userData;
+  double interval = self->budgetInMs / PLUGIN_WATCHDOG_CHECKS_PER_BUDGET;
+
+  if (interval < PLUGIN_WATCHDOG_MIN_INTERVAL_IN_MS) {
+    interval = PLUGIN_WATCHDOG_MIN_INTERVAL_IN_MS;
+  } else if (interval > PLUGIN_WATCHDOG_MAX_INTERVAL_IN_MS) {
+    interval = PLUGIN_WATCHDOG_MAX_INTERVAL_IN_MS;
+  }
+
+  while (!atomicLoad(&self->_stop)) {
+    taskTimerSleep(interval);
+    if (pluginWatchdogCheck(self, taskTimerGetRunningTime(self->_clock))) {
+      break;
+    }
+  }
+}
+
+boolByte pluginWatchdogStart(PluginWatchdog self) {
+  if (self->_thread != NULL) {
+    return true;
+  }
+
+  atomicStore(&self->_stop, false);
+  taskTimerStart(self->_clock);
+  self->_thread = newThread(_pluginWatchdogThread, self);
+
+  if (self->_thread == NULL) {
+    logError("Could not start plugin watchdog thread");
+    return false;
+  }
+
+  logDebug("Started plugin watchdog with a budget of %gms per block",
+           self->budgetInMs);
+  return true;
+}
+
+// The timers are written by the processing threads without any locking, so
+// they are only read through volatile pointers. Both fields are word-sized, so
+// the worst case is a reading which is one check out of date.
+static boolByte _pluginWatchdogIsRunning(TaskTimer timer,
+                                         unsigned long *outNumTasks) {
+  *outNumTasks = *(volatile unsigned long *)&(timer->numTasks);
+  return *(volatile boolByte *)&(timer->_running);
+}
+
+boolByte pluginWatchdogCheck(PluginWatchdog self, double currentTimeInMs) {
+  PluginChain pluginChain = self->pluginChain;
+  TaskTimer timer;
+  unsigned long numTasks;
+  unsigned int i;
+
+  if (self->expired) {
+    return true;
+  }
+
+  for (i = 0; i < self->_numWatched; i++) {
+    timer = (i % 2 == 0) ? pluginChain->audioTimers[i / 2]
+                         : pluginChain->midiTimers[i / 2];
+
+    if (!_pluginWatchdogIsRunning(timer, &numTasks)) {
+      self->_watchedSinceInMs[i] = -1.0;
+    } else if (self->_watchedSinceInMs[i] < 0.0 ||
+               self->_watchedNumTasks[i] != numTasks) {
+      // The plugin has started a new block since the last check
+      self->_watchedNumTasks[i] = numTasks;
+      self->_watchedSinceInMs[i] = currentTimeInMs;
+    } else if (currentTimeInMs - self->_watchedSinceInMs[i] >
+               self->budgetInMs) {
+      self->expired = true;
+      // The audio timer counts blocks also when a MIDI timer is the one which
+      // is stuck, since MIDI is processed before the audio of each block
+      if (self->expiredFunc != NULL) {
+        self->expiredFunc(pluginChain, pluginChain->plugins[i / 2],
+                          pluginChain->audioTimers[i / 2]->numTasks,
+                          currentTimeInMs - self->_watchedSinceInMs[i],
+                          self->userData);
+      }
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void pluginWatchdogStop(PluginWatchdog self) {
+  if (self->_thread != NULL) {
+    atomicStore(&self->_stop, true);
+    threadJoinAndFree(self->_thread);
+    self->_thread = NULL;
+    taskTimerStop(self->_clock);
+  }
+}
+
+void freePluginWatchdog(PluginWatchdog self) {
+  if (self != NULL) {
+    pluginWatchdogStop(self);
+    freeTaskTimer(self->_clock);
+    free(self->_watchedNumTasks);
+    free(self->_watchedSinceInMs);
+    free(self);
+  }
+}
@@ -0,0 +1,121 @@
+//
+// PluginWatchdog.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_PluginWatchdog_h
+#define MrsWatson_PluginWatchdog_h
+
+#include "base/Thread.h"
+#include "plugin/PluginChain.h"
+#include "time/TaskTimer.h"
+
+/**
+ * Called when a plugin has spent longer than the budget on a single block.
+ * This is called on the watchdog thread while the plugin is still processing,
+ * so usually the only sensible thing to do is to exit the program.
+ * @param pluginChain Chain which is being watched
+ * @param plugin Plugin which is taking too long
+ * @param blockIndex Zero-based index of the block which the plugin is
+ * processing, counted from when the plugin chain was initialized
+ * @param elapsedTimeInMs How long the plugin has been processing the block, as
+ * measured by the watchdog
+ * @param userData User data passed to newPluginWatchdog()
+ */
+typedef void (*PluginWatchdogExpiredFunc)(const PluginChain pluginChain,
+                                          const Plugin plugin,
+                                          unsigned long blockIndex,
+                                          double elapsedTimeInMs,
+                                          void *userData);
+
+/**
+ * The plugin watchdog catches plugins which hang while processing, such as a
+ * plugin which deadlocks in its process function. A thread checks the audio
+ * and MIDI timers of each plugin in a chain at regular intervals, and if a
+ * timer has been running for the same block for longer than the budget, the
+ * expired function is called.
+ */
+typedef struct {
+  PluginChain pluginChain;
+  double budgetInMs;
+  PluginWatchdogExpiredFunc expiredFunc;
+  void *userData;
+  boolByte expired;
+
+  // Private fields
+  Thread _thread;
+  volatile unsigned int _stop;
+  TaskTimer _clock;
+  // For each watched timer, the number of tasks it had finished when it was
+  // seen running, and the watchdog time at which that was first seen. A
+  // negative time means that the timer was not running.
+  unsigned long *_watchedNumTasks;
+  double *_watchedSinceInMs;
+  unsigned int _numWatched;
+} PluginWatchdogMembers;
+typedef PluginWatchdogMembers *PluginWatchdog;
+
+/**
+ * Create a new watchdog for a plugin chain. The chain must have been
+ * initialized, and must not be freed while the watchdog is running.
+ * @param pluginChain Plugin chain to watch
+ * @param budgetInMs Maximum time which a plugin may spend on a single block
+ * @param expiredFunc Function to call when a plugin exceeds the budget
+ * @param userData User data to pass to expiredFunc
+ * @return Initialized object, which has not been started yet
+ */
+PluginWatchdog newPluginWatchdog(PluginChain pluginChain, double budgetInMs,
+                                 PluginWatchdogExpiredFunc expiredFunc,
+                                 void *userData);
+
+/**
+ * Start checking the plugin chain on a separate thread
+ * @param self
+ * @return True if the thread was started
+ */
+boolByte pluginWatchdogStart(PluginWatchdog self);
+
+/**
+ * Check the timers of each plugin once. This is called regularly by the
+ * watchdog thread, but can also be called directly. Once a plugin has
+ * exceeded the budget, no further checks are made.
+ * @param self
+ * @param currentTimeInMs Current time, which must only ever increase
+ * @return True if a plugin has exceeded the budget
+ */
+boolByte pluginWatchdogCheck(PluginWatchdog self, double currentTimeInMs);
+
+/**
+ * Stop the watchdog thread, if it was started
+ * @param self
+ */
+void pluginWatchdogStop(PluginWatchdog self);
+
+/**
+ * Stop the watchdog and free all associated resources
+ * @param self
+ */
+void freePluginWatchdog(PluginWatchdog self);
+
+#endif
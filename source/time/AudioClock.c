@@ -26,19 +26,42 @@
 
 #include "AudioClock.h"
 
+#include "app/RenderContext.h"
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 AudioClock audioClockInstance = NULL;
 
-void initAudioClock(void) {
-  audioClockInstance = (AudioClock)malloc(sizeof(AudioClockMembers));
-  audioClockInstance->currentFrame = 0;
-  audioClockInstance->transportChanged = false;
-  audioClockInstance->isPlaying = false;
+// Musical time starts with beat 1, not 0
+static const double kAudioClockFirstBeat = 1.0;
+// Tolerance for positions which should be exactly on a bar line, but are not
+// due to rounding
+static const double kAudioClockBeatEpsilon = 1.0e-9;
+
+AudioClock newAudioClock(void) {
+  AudioClock self = (AudioClock)malloc(sizeof(AudioClockMembers));
+  self->currentFrame = 0;
+  self->transportChanged = false;
+  self->isPlaying = false;
+  self->_positionValid = false;
+  self->_segments = NULL;
+  self->_numSegments = 0;
+  self->_segmentsCapacity = 0;
+  self->_currentSegment = 0;
+  return self;
 }
 
-AudioClock getAudioClock(void) { return audioClockInstance; }
+void initAudioClock(void) { audioClockInstance = newAudioClock(); }
+
+AudioClock getAudioClock(void) {
+  RenderContext renderContext = getRenderContext();
+  return renderContext != NULL ? renderContext->audioClock
+                               : audioClockInstance;
+}
 
 void advanceAudioClock(AudioClock self, const unsigned long blocksize) {
   if (self->currentFrame == 0 || !self->isPlaying) {
@@ -49,6 +72,209 @@ void advanceAudioClock(AudioClock self, const unsigned long blocksize) {
   }
 
   self->currentFrame += blocksize;
+  self->_positionValid = false;
+}
+
+// Without a timeline, the whole sequence uses the current settings
+static void _audioClockGetSettingsSegment(AudioClockSegment outSegment) {
+  outSegment->frame = 0;
+  outSegment->ppqPosition = kAudioClockFirstBeat;
+  outSegment->barOrigin = kAudioClockFirstBeat;
+  outSegment->tempo = getTempo();
+  outSegment->timeSignatureBeatsPerMeasure = getTimeSignatureBeatsPerMeasure();
+  outSegment->timeSignatureNoteValue = getTimeSignatureNoteValue();
+}
+
+static double _audioClockGetFramesPerBeat(const AudioClockSegment segment,
+                                          const SampleRate sampleRate) {
+  return (60.0 / segment->tempo) * sampleRate;
+}
+
+// Bars are counted in quarter notes, so a bar of 6/8 is 3 beats long
+static double _audioClockGetBeatsPerBar(const AudioClockSegment segment) {
+  return segment->timeSignatureBeatsPerMeasure * 4.0 /
+         segment->timeSignatureNoteValue;
+}
+
+static AudioClockSegment _audioClockFindSegment(AudioClock self,
+                                                const unsigned long frame) {
+  unsigned int i = self->_currentSegment;
+
+  while (i + 1 < self->_numSegments && self->_segments[i + 1].frame <= frame) {
+    i++;
+  }
+
+  while (i > 0 && self->_segments[i].frame > frame) {
+    i--;
+  }
+
+  self->_currentSegment = i;
+  return &(self->_segments[i]);
+}
+
+static void _audioClockFillPosition(const AudioClockSegment segment,
+                                    const unsigned long frame,
+                                    AudioClockPosition outPosition) {
+  const double beatsPerBar = _audioClockGetBeatsPerBar(segment);
+
+  outPosition->sampleRate = getSampleRate();
+  outPosition->tempo = segment->tempo;
+  outPosition->timeSignatureBeatsPerMeasure =
+      segment->timeSignatureBeatsPerMeasure;
+  outPosition->timeSignatureNoteValue = segment->timeSignatureNoteValue;
+  outPosition->ppqPosition =
+      segment->ppqPosition +
+      (frame - segment->frame) /
+          _audioClockGetFramesPerBeat(segment, outPosition->sampleRate);
+  outPosition->barStartPosition =
+      segment->barOrigin +
+      floor((outPosition->ppqPosition - segment->barOrigin) / beatsPerBar +
+            kAudioClockBeatEpsilon) *
+          beatsPerBar;
+}
+
+void audioClockGetPositionAtFrame(AudioClock self, const unsigned long frame,
+                                  AudioClockPosition outPosition) {
+  AudioClockSegmentMembers settingsSegment;
+
+  if (self->_numSegments == 0) {
+    _audioClockGetSettingsSegment(&settingsSegment);
+    _audioClockFillPosition(&settingsSegment, frame, outPosition);
+  } else {
+    _audioClockFillPosition(_audioClockFindSegment(self, frame), frame,
+                            outPosition);
+  }
+}
+
+unsigned long audioClockGetFrameAtPpq(AudioClock self,
+                                      const double ppqPosition) {
+  AudioClockSegmentMembers settingsSegment;
+  AudioClockSegment segment = &settingsSegment;
+  unsigned int i = self->_currentSegment;
+  double frames;
+
+  if (self->_numSegments == 0) {
+    _audioClockGetSettingsSegment(&settingsSegment);
+  } else {
+    while (i + 1 < self->_numSegments &&
+           self->_segments[i + 1].ppqPosition <= ppqPosition) {
+      i++;
+    }
+
+    while (i > 0 && self->_segments[i].ppqPosition > ppqPosition) {
+      i--;
+    }
+
+    self->_currentSegment = i;
+    segment = &(self->_segments[i]);
+  }
+
+  if (ppqPosition <= segment->ppqPosition) {
+    return segment->frame;
+  }
+
+  frames = (ppqPosition - segment->ppqPosition) *
+           _audioClockGetFramesPerBeat(segment, getSampleRate());
+  return segment->frame +
+         (unsigned long)ceil(frames - kAudioClockBeatEpsilon);
+}
+
+/**
+ * Get the segment of the timeline which starts at a frame, adding it if needed.
+ * The new segment continues the tempo, time signature and bars of the one
+ * before it.
+ */
+static AudioClockSegment _audioClockAddSegment(AudioClock self,
+                                                const unsigned long frame) {
+  AudioClockSegment last;
+  AudioClockPositionMembers position;
+
+  if (self->_numSegments + 1 >= self->_segmentsCapacity) {
+    self->_segmentsCapacity =
+        self->_segmentsCapacity == 0 ? 8 : self->_segmentsCapacity * 2;
+    self->_segments = (AudioClockSegment)realloc(
+        self->_segments,
+        sizeof(AudioClockSegmentMembers) * self->_segmentsCapacity);
+  }
+
+  if (self->_numSegments == 0) {
+    _audioClockGetSettingsSegment(&(self->_segments[0]));
+    self->_numSegments = 1;
+    self->_currentSegment = 0;
+  }
+
+  self->_positionValid = false;
+  last = &(self->_segments[self->_numSegments - 1]);
+
+  if (frame <= last->frame) {
+    if (frame < last->frame) {
+      logDebug("Moving tempo map change at frame %lu to frame %lu", frame,
+               last->frame);
+    }
+
+    return last;
+  }
+
+  _audioClockFillPosition(last, frame, &position);
+  self->_segments[self->_numSegments] = *last;
+  last = &(self->_segments[self->_numSegments++]);
+  last->frame = frame;
+  last->ppqPosition = position.ppqPosition;
+  last->barOrigin = position.barStartPosition;
+  return last;
+}
+
+void audioClockAddTempoChange(AudioClock self, const unsigned long frame,
+                              const Tempo tempo) {
+  if (tempo <= 0.0) {
+    logWarn("Ignoring invalid tempo %f", tempo);
+    return;
+  }
+
+  _audioClockAddSegment(self, frame)->tempo = tempo;
+}
+
+void audioClockAddTimeSignatureChange(AudioClock self,
+                                      const unsigned long frame,
+                                      const unsigned short beatsPerMeasure,
+                                      const unsigned short noteValue) {
+  AudioClockSegment segment;
+
+  if (beatsPerMeasure == 0 || noteValue == 0) {
+    logWarn("Ignoring invalid time signature %d/%d", beatsPerMeasure,
+            noteValue);
+    return;
+  }
+
+  segment = _audioClockAddSegment(self, frame);
+  segment->timeSignatureBeatsPerMeasure = beatsPerMeasure;
+  segment->timeSignatureNoteValue = noteValue;
+  segment->barOrigin = segment->ppqPosition;
+}
+
+void audioClockSetPosition(AudioClock self,
+                           const AudioClockPosition position) {
+  self->_position = *position;
+  self->_positionValid = true;
+}
+
+AudioClockPosition audioClockGetPosition(AudioClock self) {
+  AudioClockPosition position = &(self->_position);
+
+  if (self->_positionValid) {
+    return position;
+  }
+
+  audioClockGetPositionAtFrame(self, self->currentFrame, position);
+  logDebugFast("Current PPQ position is %g, bar starts at %g",
+               position->ppqPosition, position->barStartPosition);
+
+  self->_positionValid = true;
+  return position;
+}
+
+void audioClockInvalidatePosition(AudioClock self) {
+  self->_positionValid = false;
 }
 
 void audioClockStop(AudioClock self) {
@@ -56,9 +282,22 @@ void audioClockStop(AudioClock self) {
   self->transportChanged = true;
 }
 
+void audioClockReset(AudioClock self) {
+  self->currentFrame = 0;
+  self->isPlaying = false;
+  self->transportChanged = true;
+  self->_positionValid = false;
+  self->_numSegments = 0;
+  self->_currentSegment = 0;
+}
+
 void freeAudioClock(AudioClock self) {
   if (self != NULL) {
+    if (self == audioClockInstance) {
+      audioClockInstance = NULL;
+    }
+
+    free(self->_segments);
     free(self);
-    audioClockInstance = NULL;
   }
 }
@@ -36,14 +36,66 @@
  * callbacks where it is difficult to pass a void* pointer.
  */
 
+/**
+ * Musical position of the clock, along with the settings it was calculated
+ * from. This is what plugins see as the transport state.
+ */
+typedef struct {
+  SampleRate sampleRate;
+  Tempo tempo;
+  unsigned short timeSignatureBeatsPerMeasure;
+  unsigned short timeSignatureNoteValue;
+  // Position in beats, where musical time starts with 1, not 0
+  double ppqPosition;
+  // Position in beats of the start of the current bar
+  double barStartPosition;
+} AudioClockPositionMembers;
+typedef AudioClockPositionMembers *AudioClockPosition;
+
+/**
+ * Part of the clock's timeline in which the tempo and time signature stay the
+ * same. Positions within the segment are calculated from its start.
+ */
+typedef struct {
+  unsigned long frame;
+  // Position in beats of the first frame
+  double ppqPosition;
+  // Position in beats of a bar line at or before the first frame, from which
+  // the bars of this segment are counted
+  double barOrigin;
+  Tempo tempo;
+  unsigned short timeSignatureBeatsPerMeasure;
+  unsigned short timeSignatureNoteValue;
+} AudioClockSegmentMembers;
+typedef AudioClockSegmentMembers *AudioClockSegment;
+
 typedef struct {
   boolByte transportChanged;
   boolByte isPlaying;
   unsigned long currentFrame;
+
+  // Private fields
+  AudioClockPositionMembers _position;
+  boolByte _positionValid;
+  // Tempo and time signature changes, ordered by frame. If there are none,
+  // then the position is calculated from the current AudioSettings.
+  AudioClockSegment _segments;
+  unsigned int _numSegments;
+  unsigned int _segmentsCapacity;
+  // Index of the last segment which was looked up. The clock mostly moves
+  // forward, so searching from here makes lookups O(1) amortized.
+  unsigned int _currentSegment;
 } AudioClockMembers;
 typedef AudioClockMembers *AudioClock;
 extern AudioClock audioClockInstance;
 
+/**
+ * Create a new audio clock which is independent of the global instance, for
+ * example for a render context.
+ * @return New audio clock, positioned at the first frame
+ */
+AudioClock newAudioClock(void);
+
 /**
  * Initialize the global audio clock instance. Should be called fairly
  * early in the program initialization, as other components may depend
@@ -52,9 +104,10 @@ extern AudioClock audioClockInstance;
 void initAudioClock(void);
 
 /**
- * Get a reference to the global audio clock instance.
- * @return Reference to global audio clock, or NULL if the global instance has
- * not yet been initialized.
+ * Get a reference to the audio clock of the current render context, or the
+ * global audio clock instance if the calling thread has no render context.
+ * @return Reference to audio clock, or NULL if the global instance has not yet
+ * been initialized.
  */
 AudioClock getAudioClock(void);
 
@@ -66,12 +119,93 @@ AudioClock getAudioClock(void);
  */
 void advanceAudioClock(AudioClock self, const unsigned long blocksize);
 
+/**
+ * Get the musical position of the clock's current frame. The position is only
+ * calculated once after each time that the clock moves, so this is cheap to
+ * call many times per block.
+ * @param self
+ * @return Position of the current frame. The position is owned by the clock,
+ * and changes after the clock is advanced.
+ */
+AudioClockPosition audioClockGetPosition(AudioClock self);
+
+/**
+ * Recalculate the position on the next call to audioClockGetPosition(). This
+ * must be called when the tempo or time signature change while processing.
+ * @param self
+ */
+void audioClockInvalidatePosition(AudioClock self);
+
+/**
+ * Get the musical position of any frame, using the clock's timeline. This is
+ * sample accurate, so a tempo change in the middle of a block only affects
+ * the frames after it. Looking up frames close to the previous lookup is O(1).
+ * @param self
+ * @param frame Frame to get the position of
+ * @param outPosition Position to fill in
+ */
+void audioClockGetPositionAtFrame(AudioClock self, const unsigned long frame,
+                                  AudioClockPosition outPosition);
+
+/**
+ * Find the frame at which a musical position is reached, using the clock's
+ * timeline. This is the inverse of audioClockGetPositionAtFrame().
+ * @param self
+ * @param ppqPosition Position in beats, starting with 1
+ * @return First frame at or after the position
+ */
+unsigned long audioClockGetFrameAtPpq(AudioClock self,
+                                      const double ppqPosition);
+
+/**
+ * Add a tempo change to the clock's timeline. Changes must be added in order
+ * of their frames, and a change which is earlier than the last one is moved to
+ * the frame of the last one. The first change also records the tempo and time
+ * signature of the current AudioSettings as the start of the timeline, so it
+ * must be added before the settings are changed.
+ * @param self
+ * @param frame Frame at which the new tempo starts
+ * @param tempo New tempo, in beats per minute
+ */
+void audioClockAddTempoChange(AudioClock self, const unsigned long frame,
+                              const Tempo tempo);
+
+/**
+ * Add a time signature change to the clock's timeline, which starts a new bar
+ * at the given frame. The same rules apply as for audioClockAddTempoChange().
+ * @param self
+ * @param frame Frame at which the new time signature starts
+ * @param beatsPerMeasure Numerator of the time signature
+ * @param noteValue Denominator of the time signature
+ */
+void audioClockAddTimeSignatureChange(AudioClock self,
+                                      const unsigned long frame,
+                                      const unsigned short beatsPerMeasure,
+                                      const unsigned short noteValue);
+
+/**
+ * Use a position which was calculated elsewhere, for example by the process
+ * which hosts an isolated plugin, until the clock moves again.
+ * @param self
+ * @param position Position of the clock's current frame
+ */
+void audioClockSetPosition(AudioClock self,
+                           const AudioClockPosition position);
+
 /**
  * Indicate that playback is stopped.
  * @param self
  */
 void audioClockStop(AudioClock self);
 
+/**
+ * Rewind the clock back to the first frame, mark it as stopped and clear its
+ * timeline. Used when the same processing session is reused to render another
+ * source.
+ * @param self
+ */
+void audioClockReset(AudioClock self);
+
 /**
  * Free an audio clock instance and its associated resources.
  * @param self
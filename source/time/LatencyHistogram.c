@@ -0,0 +1,147 @@
+//
+// LatencyHistogram.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "LatencyHistogram.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Values are kept with this many significant bits, so each power of two range
+// is divided into 16 linear buckets, and a bucket is at most 1/16th of its
+// value wide. Values below 32ns are stored exactly.
+static const unsigned int kLatencyHistogramSubBucketBits = 5;
+static const unsigned int kLatencyHistogramHalfBuckets = 16;
+// Enough buckets to represent any 64-bit value in nanoseconds
+static const unsigned int kLatencyHistogramNumBuckets = 59 * 16 + 32;
+
+static unsigned int _getBucketIndex(uint64_t value) {
+  unsigned int highestBit = 0;
+  unsigned int shift;
+
+  while (highestBit < 63 && (value >> (highestBit + 1)) != 0) {
+    highestBit++;
+  }
+
+  // Small values map directly to a bucket. Above that, only the highest bits
+  // of the value are kept, so each bucket covers a range of values.
+  if (highestBit < kLatencyHistogramSubBucketBits) {
+    return (unsigned int)value;
+  }
+
+  shift = highestBit - kLatencyHistogramSubBucketBits + 1;
+  return shift * kLatencyHistogramHalfBuckets + (unsigned int)(value >> shift);
+}
+
+static uint64_t _getBucketUpperValue(unsigned int index) {
+  unsigned int shift;
+  uint64_t subBucket;
+
+  if (index < 2 * kLatencyHistogramHalfBuckets) {
+    return index;
+  }
+
+  shift = index / kLatencyHistogramHalfBuckets - 1;
+  subBucket = index - shift * kLatencyHistogramHalfBuckets;
+  return ((subBucket + 1) << shift) - 1;
+}
+
+LatencyHistogram newLatencyHistogram(void) {
+  LatencyHistogram self =
+      (LatencyHistogram)malloc(sizeof(LatencyHistogramMembers));
+
+  self->counts = (unsigned long *)calloc(kLatencyHistogramNumBuckets,
+                                         sizeof(unsigned long));
+  self->numValues = 0;
+  self->numDeadlineMisses = 0;
+  self->maxValue = 0.0;
+  self->maxValueIndex = 0;
+  return self;
+}
+
+void latencyHistogramRecord(LatencyHistogram self, const double valueInMs,
+                            const double deadlineInMs) {
+  const uint64_t valueInNs =
+      valueInMs > 0.0 ? (uint64_t)(valueInMs * 1000000.0) : 0;
+
+  self->counts[_getBucketIndex(valueInNs)]++;
+
+  if (valueInMs > deadlineInMs) {
+    self->numDeadlineMisses++;
+  }
+
+  if (self->numValues == 0 || valueInMs > self->maxValue) {
+    self->maxValue = valueInMs;
+    self->maxValueIndex = self->numValues;
+  }
+
+  self->numValues++;
+}
+
+double latencyHistogramGetPercentile(const LatencyHistogram self,
+                                     const double percentile) {
+  unsigned long targetCount;
+  unsigned long count = 0;
+  double value;
+  unsigned int i;
+
+  if (self->numValues == 0) {
+    return 0.0;
+  }
+
+  targetCount = (unsigned long)ceil(percentile / 100.0 * self->numValues);
+  if (targetCount < 1) {
+    targetCount = 1;
+  } else if (targetCount > self->numValues) {
+    targetCount = self->numValues;
+  }
+
+  for (i = 0; i < kLatencyHistogramNumBuckets; i++) {
+    count += self->counts[i];
+
+    if (count >= targetCount) {
+      break;
+    }
+  }
+
+  value = (double)_getBucketUpperValue(i) / 1000000.0;
+  return value < self->maxValue ? value : self->maxValue;
+}
+
+void latencyHistogramReset(LatencyHistogram self) {
+  memset(self->counts, 0, sizeof(unsigned long) * kLatencyHistogramNumBuckets);
+  self->numValues = 0;
+  self->numDeadlineMisses = 0;
+  self->maxValue = 0.0;
+  self->maxValueIndex = 0;
+}
+
+void freeLatencyHistogram(LatencyHistogram self) {
+  if (self != NULL) {
+    free(self->counts);
+    free(self);
+  }
+}
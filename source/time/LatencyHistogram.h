@@ -0,0 +1,87 @@
+//
+// LatencyHistogram.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_LatencyHistogram_h
+#define MrsWatson_LatencyHistogram_h
+
+#include "base/Types.h"
+
+#include <stdint.h>
+
+typedef struct {
+  unsigned long *counts;
+  unsigned long numValues;
+  // Number of values which were longer than their deadline
+  unsigned long numDeadlineMisses;
+  // Longest value in milliseconds, and the index at which it was recorded
+  double maxValue;
+  unsigned long maxValueIndex;
+} LatencyHistogramMembers;
+typedef LatencyHistogramMembers *LatencyHistogram;
+
+/**
+ * Create a new latency histogram. Values are sorted into buckets whose width
+ * grows with the value, like an HDR histogram, so any percentile can be read
+ * back to within about 6% of the actual value while the histogram itself
+ * stays a fixed size no matter how many values are recorded.
+ * @return New histogram
+ */
+LatencyHistogram newLatencyHistogram(void);
+
+/**
+ * Record a value, typically the time spent processing one block
+ * @param self
+ * @param valueInMs Value to record, in milliseconds
+ * @param deadlineInMs Values longer than this are counted as deadline misses
+ */
+void latencyHistogramRecord(LatencyHistogram self, const double valueInMs,
+                            const double deadlineInMs);
+
+/**
+ * Get the value at a given percentile. Since values are grouped in buckets,
+ * this is the upper end of the bucket containing the percentile, which is
+ * never larger than the actual maximum value.
+ * @param self
+ * @param percentile Percentile, from 0 to 100
+ * @return Value in milliseconds, or 0 if no values have been recorded
+ */
+double latencyHistogramGetPercentile(const LatencyHistogram self,
+                                     const double percentile);
+
+/**
+ * Forget all recorded values, for example after a warmup which should not be
+ * part of the statistics
+ * @param self
+ */
+void latencyHistogramReset(LatencyHistogram self);
+
+/**
+ * Free a latency histogram and its associated resources
+ * @param self
+ */
+void freeLatencyHistogram(LatencyHistogram self);
+
+#endif
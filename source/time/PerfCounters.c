@@ -0,0 +1,226 @@
+//
+// PerfCounters.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Must be declared before any system headers, needed for syscall()
+#if LINUX
+#define _GNU_SOURCE
+#endif
+
+#include "PerfCounters.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if LINUX
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char *kPerfCounterTypeNames[kPerfCounterNumTypes] = {
+    "cycles", "instructions", "llc_misses", "branch_misses"};
+
+#if LINUX
+static const uint64_t kPerfCountersEventConfigs[kPerfCounterNumTypes] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+// Group leader of the calling thread's counters. All events are read together
+// from the leader, so that they cover exactly the same instructions.
+#define PERF_COUNTERS_NOT_OPENED -2
+static THREAD_LOCAL int _perfCountersGroupFd = PERF_COUNTERS_NOT_OPENED;
+// Position of each event among the values read from the group, or -1 if the
+// event could not be opened
+static THREAD_LOCAL int _perfCountersValueIndex[kPerfCounterNumTypes];
+
+static int _perfCountersOpenEvent(const PerfCounterType type,
+                                  const int groupFd) {
+  struct perf_event_attr attributes;
+
+  memset(&attributes, 0, sizeof(attributes));
+  attributes.size = sizeof(attributes);
+  attributes.type = PERF_TYPE_HARDWARE;
+  attributes.config = kPerfCountersEventConfigs[type];
+  attributes.read_format = PERF_FORMAT_GROUP;
+  // Counting in the kernel is usually not allowed for unprivileged users, and
+  // the plugin's own code is what is being measured anyways
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  // Only the calling thread is counted, on whichever CPU it runs
+  return (int)syscall(__NR_perf_event_open, &attributes, 0, -1, groupFd, 0);
+}
+
+static int _perfCountersOpenThread(void) {
+  unsigned int numValues = 0;
+  int fd;
+  int i;
+
+  if (_perfCountersGroupFd != PERF_COUNTERS_NOT_OPENED) {
+    return _perfCountersGroupFd;
+  }
+
+  _perfCountersGroupFd = _perfCountersOpenEvent(PERF_COUNTER_CYCLES, -1);
+  for (i = 0; i < kPerfCounterNumTypes; i++) {
+    _perfCountersValueIndex[i] = -1;
+  }
+
+  if (_perfCountersGroupFd < 0) {
+    // Don't try again for every block of this thread
+    _perfCountersGroupFd = -1;
+    return -1;
+  }
+
+  _perfCountersValueIndex[PERF_COUNTER_CYCLES] = (int)numValues++;
+  for (i = 0; i < kPerfCounterNumTypes; i++) {
+    if (i != PERF_COUNTER_CYCLES) {
+      fd = _perfCountersOpenEvent((PerfCounterType)i, _perfCountersGroupFd);
+      if (fd >= 0) {
+        _perfCountersValueIndex[i] = (int)numValues++;
+      }
+    }
+  }
+
+  return _perfCountersGroupFd;
+}
+
+static boolByte _perfCountersRead(uint64_t *outCounts,
+                                  boolByte *outSupported) {
+  // The number of values is followed by the value of each event in the group
+  uint64_t values[kPerfCounterNumTypes + 1];
+  int groupFd = _perfCountersOpenThread();
+  int i;
+
+  if (groupFd < 0) {
+    return false;
+  }
+
+  if (read(groupFd, values, sizeof(values)) < (ssize_t)sizeof(uint64_t)) {
+    return false;
+  }
+
+  for (i = 0; i < kPerfCounterNumTypes; i++) {
+    if (_perfCountersValueIndex[i] >= 0 &&
+        (uint64_t)_perfCountersValueIndex[i] < values[0]) {
+      outCounts[i] = values[_perfCountersValueIndex[i] + 1];
+      outSupported[i] = true;
+    } else {
+      outCounts[i] = 0;
+      outSupported[i] = false;
+    }
+  }
+
+  return true;
+}
+#else
+static boolByte _perfCountersRead(uint64_t *outCounts,
+                                  boolByte *outSupported) {
+  return false;
+}
+#endif
+
+PerfCounters newPerfCounters(void) {
+  PerfCounters self = (PerfCounters)malloc(sizeof(PerfCountersMembers));
+
+  self->enabled = false;
+  self->_running = false;
+  perfCountersReset(self);
+  return self;
+}
+
+boolByte perfCountersIsAvailable(void) {
+#if LINUX
+  return (boolByte)(_perfCountersOpenThread() >= 0);
+#else
+  return false;
+#endif
+}
+
+void perfCountersStart(PerfCounters self) {
+  if (!self->enabled) {
+    return;
+  }
+
+  self->_running = _perfCountersRead(self->_startCounts, self->supported);
+}
+
+void perfCountersStop(PerfCounters self) {
+  uint64_t stopCounts[kPerfCounterNumTypes];
+  int i;
+
+  if (!self->_running) {
+    return;
+  }
+
+  self->_running = false;
+  if (!_perfCountersRead(stopCounts, self->supported)) {
+    return;
+  }
+
+  for (i = 0; i < kPerfCounterNumTypes; i++) {
+    self->counts[i] += stopCounts[i] - self->_startCounts[i];
+  }
+
+  self->numTasks++;
+}
+
+double perfCountersGetInstructionsPerCycle(const PerfCounters self) {
+  if (self->counts[PERF_COUNTER_CYCLES] == 0) {
+    return 0.0;
+  }
+
+  return (double)self->counts[PERF_COUNTER_INSTRUCTIONS] /
+         (double)self->counts[PERF_COUNTER_CYCLES];
+}
+
+double perfCountersGetPerThousandInstructions(const PerfCounters self,
+                                              const PerfCounterType type) {
+  if (self->counts[PERF_COUNTER_INSTRUCTIONS] == 0) {
+    return 0.0;
+  }
+
+  return 1000.0 * (double)self->counts[type] /
+         (double)self->counts[PERF_COUNTER_INSTRUCTIONS];
+}
+
+const char *perfCounterTypeGetName(const PerfCounterType type) {
+  return type < kPerfCounterNumTypes ? kPerfCounterTypeNames[type] : NULL;
+}
+
+void perfCountersReset(PerfCounters self) {
+  int i;
+
+  self->_running = false;
+  self->numTasks = 0;
+  for (i = 0; i < kPerfCounterNumTypes; i++) {
+    self->counts[i] = 0;
+    self->supported[i] = false;
+    self->_startCounts[i] = 0;
+  }
+}
+
+void freePerfCounters(PerfCounters self) {
+  free(self);
+}
@@ -0,0 +1,128 @@
+//
+// PerfCounters.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_PerfCounters_h
+#define MrsWatson_PerfCounters_h
+
+#include "base/Types.h"
+
+#include <stdint.h>
+
+typedef enum {
+  PERF_COUNTER_CYCLES,
+  PERF_COUNTER_INSTRUCTIONS,
+  // Misses in the last level cache, which must be served from memory
+  PERF_COUNTER_CACHE_MISSES,
+  PERF_COUNTER_BRANCH_MISSES,
+  kPerfCounterNumTypes
+} PerfCounterType;
+
+typedef struct {
+  boolByte enabled;
+  // Events counted by the calling thread during all start/stop cycles
+  uint64_t counts[kPerfCounterNumTypes];
+  // False for events which the CPU or kernel could not count, whose counts
+  // are then always 0
+  boolByte supported[kPerfCounterNumTypes];
+  unsigned long numTasks;
+
+  boolByte _running;
+  uint64_t _startCounts[kPerfCounterNumTypes];
+} PerfCountersMembers;
+typedef PerfCountersMembers *PerfCounters;
+
+/**
+ * Create a new set of hardware performance counters. These are read with
+ * perf_event_open(2) on Linux, and are not available on other platforms.
+ * Counters are disabled when they are created, so that they cost nothing
+ * unless they are asked for.
+ * @return Initialized instance
+ */
+PerfCounters newPerfCounters(void);
+
+/**
+ * Check whether the hardware counters can be read on this system. Virtual
+ * machines often do not pass the CPU's counters through, and the kernel may
+ * forbid reading them, see /proc/sys/kernel/perf_event_paranoid.
+ * @return True if at least the CPU cycles can be counted
+ */
+boolByte perfCountersIsAvailable(void);
+
+/**
+ * Start counting events for the calling thread. The counters of each thread
+ * are opened the first time it is measured, and stay open until the process
+ * exits. Each start costs a system call, so this should only be used for
+ * tasks which run once per block or less.
+ * @param self
+ */
+void perfCountersStart(PerfCounters self);
+
+/**
+ * Stop counting events, and add the events counted since the last call to
+ * perfCountersStart() to the totals. This must be called from the same thread
+ * which started the counters.
+ * @param self
+ */
+void perfCountersStop(PerfCounters self);
+
+/**
+ * Get the average number of instructions which were retired in each cycle
+ * @param self
+ * @return Instructions per cycle, or 0 if no cycles were counted
+ */
+double perfCountersGetInstructionsPerCycle(const PerfCounters self);
+
+/**
+ * Get the number of events of a given type per thousand instructions, which
+ * is the usual way to compare cache and branch misses between tasks
+ * @param self
+ * @param type Event type to get
+ * @return Events per thousand instructions, or 0 if no instructions were
+ * counted
+ */
+double perfCountersGetPerThousandInstructions(const PerfCounters self,
+                                              const PerfCounterType type);
+
+/**
+ * Get the name of an event type, as used in reports
+ * @param type Event type
+ * @return Name of the event type, which must not be freed
+ */
+const char *perfCounterTypeGetName(const PerfCounterType type);
+
+/**
+ * Stop the counters if they are running, and clear their totals
+ * @param self
+ */
+void perfCountersReset(PerfCounters self);
+
+/**
+ * Free a set of performance counters
+ * @param self
+ */
+void freePerfCounters(PerfCounters self);
+
+#endif
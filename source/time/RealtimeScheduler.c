@@ -0,0 +1,189 @@
+//
+// RealtimeScheduler.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "RealtimeScheduler.h"
+
+#include "base/Thread.h"
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+
+#if UNIX
+#include <errno.h>
+#include <time.h>
+#endif
+
+static const uint64_t kRealtimeSchedulerNsPerSecond = 1000000000;
+static const uint64_t kRealtimeSchedulerDefaultSpinTimeInNs = 200000;
+
+uint64_t realtimeSchedulerGetCurrentTimeInNs(RealtimeScheduler self) {
+#if WINDOWS
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)(counter.QuadPart / self->_counterFrequency) *
+             kRealtimeSchedulerNsPerSecond +
+         (uint64_t)(counter.QuadPart % self->_counterFrequency) *
+             kRealtimeSchedulerNsPerSecond / (uint64_t)self->_counterFrequency;
+#elif MACOSX
+  return mach_absolute_time() * self->_timebase.numer / self->_timebase.denom;
+#elif UNIX
+  struct timespec currentTime;
+  clock_gettime(CLOCK_MONOTONIC, &currentTime);
+  return (uint64_t)currentTime.tv_sec * kRealtimeSchedulerNsPerSecond +
+         (uint64_t)currentTime.tv_nsec;
+#endif
+}
+
+RealtimeScheduler newRealtimeScheduler(void) {
+  RealtimeScheduler self =
+      (RealtimeScheduler)malloc(sizeof(RealtimeSchedulerMembers));
+#if WINDOWS
+  LARGE_INTEGER queryFrequency;
+#endif
+
+  self->spinTimeInNs = kRealtimeSchedulerDefaultSpinTimeInNs;
+  self->numMissedDeadlines = 0;
+  self->_started = false;
+  self->_startTimeInNs = 0;
+  self->_scheduledTimeInNs = 0.0;
+
+#if WINDOWS
+  QueryPerformanceFrequency(&queryFrequency);
+  self->_counterFrequency = queryFrequency.QuadPart;
+  self->_timer = CreateWaitableTimer(NULL, TRUE, NULL);
+#elif MACOSX
+  mach_timebase_info(&self->_timebase);
+#endif
+
+  return self;
+}
+
+void realtimeSchedulerStartBlock(RealtimeScheduler self) {
+  static THREAD_LOCAL boolByte priorityRaised = false;
+
+  if (self->_started) {
+    return;
+  }
+
+  // Only try this once per thread, otherwise each reset would log the same
+  // warning again for unprivileged users
+  if (!priorityRaised) {
+    threadSetRealtimePriority();
+    priorityRaised = true;
+  }
+
+  self->_startTimeInNs = realtimeSchedulerGetCurrentTimeInNs(self);
+  self->_scheduledTimeInNs = 0.0;
+  self->_started = true;
+}
+
+void realtimeSchedulerSleepUntil(RealtimeScheduler self,
+                                         const uint64_t wakeTimeInNs) {
+#if WINDOWS
+  LARGE_INTEGER dueTime;
+  uint64_t currentTimeInNs = realtimeSchedulerGetCurrentTimeInNs(self);
+
+  if (wakeTimeInNs <= currentTimeInNs) {
+    return;
+  }
+
+  // Waitable timers do not use the performance counter as their clock, so the
+  // absolute time is converted into a relative one (negative, in 100ns units)
+  dueTime.QuadPart = -(LONGLONG)((wakeTimeInNs - currentTimeInNs) / 100);
+
+  if (self->_timer != NULL && SetWaitableTimer(self->_timer, &dueTime, 0, NULL,
+                                               NULL, FALSE)) {
+    WaitForSingleObject(self->_timer, INFINITE);
+  } else {
+    Sleep((DWORD)((wakeTimeInNs - currentTimeInNs) / 1000000));
+  }
+#elif MACOSX
+  mach_wait_until(wakeTimeInNs * self->_timebase.denom /
+                  self->_timebase.numer);
+#elif UNIX
+  struct timespec wakeTime;
+  wakeTime.tv_sec = (time_t)(wakeTimeInNs / kRealtimeSchedulerNsPerSecond);
+  wakeTime.tv_nsec = (long)(wakeTimeInNs % kRealtimeSchedulerNsPerSecond);
+
+  // Since the wake time is absolute, an interrupted sleep can simply be
+  // restarted with the same arguments
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeTime, NULL) ==
+         EINTR) {
+  }
+#endif
+}
+
+void realtimeSchedulerWaitForBlock(RealtimeScheduler self,
+                                   const SampleCount blocksize,
+                                   const SampleRate sampleRate) {
+  const double blockTimeInNs =
+      (double)blocksize * (double)kRealtimeSchedulerNsPerSecond / sampleRate;
+  uint64_t deadlineInNs;
+  uint64_t currentTimeInNs;
+
+  if (!self->_started) {
+    realtimeSchedulerStartBlock(self);
+  }
+
+  self->_scheduledTimeInNs += blockTimeInNs;
+  deadlineInNs = self->_startTimeInNs + (uint64_t)self->_scheduledTimeInNs;
+  currentTimeInNs = realtimeSchedulerGetCurrentTimeInNs(self);
+
+  if (currentTimeInNs >= deadlineInNs) {
+    self->numMissedDeadlines++;
+
+    if (currentTimeInNs - deadlineInNs > (uint64_t)blockTimeInNs) {
+      logDebug("Realtime schedule is %gms behind, restarting it",
+               (double)(currentTimeInNs - deadlineInNs) / 1000000.0);
+      self->_startTimeInNs = currentTimeInNs;
+      self->_scheduledTimeInNs = 0.0;
+    }
+
+    return;
+  }
+
+  if (deadlineInNs - currentTimeInNs > self->spinTimeInNs) {
+    realtimeSchedulerSleepUntil(self, deadlineInNs - self->spinTimeInNs);
+  }
+
+  // Sleeping may wake up too late by about a scheduler tick, so the last part
+  // before the deadline is spent polling the clock instead
+  while (realtimeSchedulerGetCurrentTimeInNs(self) < deadlineInNs) {
+  }
+}
+
+void realtimeSchedulerReset(RealtimeScheduler self) { self->_started = false; }
+
+void freeRealtimeScheduler(RealtimeScheduler self) {
+  if (self != NULL) {
+#if WINDOWS
+    if (self->_timer != NULL) {
+      CloseHandle(self->_timer);
+    }
+#endif
+    free(self);
+  }
+}
@@ -0,0 +1,120 @@
+//
+// RealtimeScheduler.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_RealtimeScheduler_h
+#define MrsWatson_RealtimeScheduler_h
+
+#include "base/Types.h"
+
+#include <stdint.h>
+
+#if MACOSX
+#include <mach/mach_time.h>
+#endif
+
+typedef struct {
+  // Time before each deadline which is spent busy waiting rather than
+  // sleeping, in nanoseconds. Defaults to 200 microseconds.
+  uint64_t spinTimeInNs;
+  // Number of blocks whose deadline had already passed by the time
+  // realtimeSchedulerWaitForBlock() was called
+  unsigned long numMissedDeadlines;
+
+  boolByte _started;
+  uint64_t _startTimeInNs;
+  // Time of the last deadline relative to the start time. This is summed as a
+  // double rather than rounded to whole nanoseconds on each block, so that the
+  // schedule does not drift from the wall clock over long runs.
+  double _scheduledTimeInNs;
+#if WINDOWS
+  LONGLONG _counterFrequency;
+  HANDLE _timer;
+#elif MACOSX
+  mach_timebase_info_data_t _timebase;
+#endif
+} RealtimeSchedulerMembers;
+typedef RealtimeSchedulerMembers *RealtimeScheduler;
+
+/**
+ * Create a new realtime scheduler. Unlike sleeping for the time left over
+ * after processing each block, the scheduler waits until absolute deadlines
+ * which are derived from the total number of frames processed, so errors in
+ * the sleep granularity do not add up over time.
+ * @return New scheduler
+ */
+RealtimeScheduler newRealtimeScheduler(void);
+
+/**
+ * Mark the start of a block. The first call after creating or resetting the
+ * scheduler sets the time from which all deadlines are counted, and also
+ * raises the calling thread to realtime priority if that was not already tried
+ * on this thread. Further calls do nothing.
+ * @param self
+ */
+void realtimeSchedulerStartBlock(RealtimeScheduler self);
+
+/**
+ * Wait until the deadline of the current block has passed. When a block was
+ * late by more than its own length, the schedule is restarted from the current
+ * time rather than rushing through the following blocks to catch up.
+ * @param self
+ * @param blocksize Number of frames in the block
+ * @param sampleRate Sample rate used to convert frames into time
+ */
+void realtimeSchedulerWaitForBlock(RealtimeScheduler self,
+                                   const SampleCount blocksize,
+                                   const SampleRate sampleRate);
+
+/**
+ * Get the current time of the clock which the scheduler uses for deadlines.
+ * @param self
+ * @return Current time in nanoseconds since an arbitrary starting point
+ */
+uint64_t realtimeSchedulerGetCurrentTimeInNs(RealtimeScheduler self);
+
+/**
+ * Sleep until the given time, which may return a bit early or late depending
+ * on the timer resolution of the system. This does not spin.
+ * @param self
+ * @param wakeTimeInNs Time to wake up, on the clock of
+ * realtimeSchedulerGetCurrentTimeInNs()
+ */
+void realtimeSchedulerSleepUntil(RealtimeScheduler self,
+                                 const uint64_t wakeTimeInNs);
+
+/**
+ * Restart the schedule with the next call to realtimeSchedulerStartBlock()
+ * @param self
+ */
+void realtimeSchedulerReset(RealtimeScheduler self);
+
+/**
+ * Free a realtime scheduler and its associated resources
+ * @param self
+ */
+void freeRealtimeScheduler(RealtimeScheduler self);
+
+#endif
@@ -0,0 +1,394 @@
+//
+// StreamScheduler.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "StreamScheduler.h"
+
+#include "base/PlatformInfo.h"
+#include "logging/EventLogger.h"
+#include "time/RealtimeScheduler.h"
+
+#include <stdlib.h>
+
+static const double kStreamSchedulerNsPerSecond = 1000000000.0;
+static const double kStreamSchedulerNsPerMs = 1000000.0;
+
+typedef struct {
+  StreamScheduler scheduler;
+  unsigned int index;
+  Thread thread;
+} _StreamSchedulerWorkerMembers;
+typedef _StreamSchedulerWorkerMembers *_StreamSchedulerWorker;
+
+StreamScheduler newStreamScheduler(unsigned int numWorkers,
+                                   boolByte pinToProcessors) {
+  StreamScheduler self =
+      (StreamScheduler)malloc(sizeof(StreamSchedulerMembers));
+
+  if (numWorkers == 0) {
+    numWorkers = (unsigned int)platformInfoGetNumProcessors();
+  }
+
+  self->numWorkers = numWorkers;
+  self->pinToProcessors = pinToProcessors;
+  self->numStreams = 0;
+  self->streams = NULL;
+  self->_mutex = newMutex();
+  self->_pending = NULL;
+  self->_numPending = 0;
+  self->_ready = NULL;
+  self->_numReady = 0;
+  self->_runningDeadlines =
+      (uint64_t *)calloc(self->numWorkers, sizeof(uint64_t));
+  self->_numActive = 0;
+  self->_blockFinished = newSemaphore(0);
+  self->_numIdle = 0;
+  return self;
+}
+
+StreamSchedulerStream
+streamSchedulerAddStream(StreamScheduler self, const CharString name,
+                         const SampleCount blocksize,
+                         const SampleRate sampleRate,
+                         StreamSchedulerProcessFunc process, void *userData) {
+  StreamSchedulerStream stream =
+      (StreamSchedulerStream)malloc(sizeof(StreamSchedulerStreamMembers));
+
+  stream->name = newCharStringWithCString(name->data);
+  stream->process = process;
+  stream->userData = userData;
+  stream->numBlocks = 0;
+  stream->numMissedDeadlines = 0;
+  stream->maxLatenessInMs = 0.0;
+  stream->finished = false;
+  stream->_blockTimeInNs =
+      (double)blocksize * kStreamSchedulerNsPerSecond / sampleRate;
+  stream->_startTimeInNs = 0;
+  stream->_scheduledTimeInNs = 0.0;
+  stream->_releaseTimeInNs = 0;
+  stream->_deadlineInNs = 0;
+
+  self->streams = (StreamSchedulerStream *)realloc(
+      self->streams, sizeof(StreamSchedulerStream) * (self->numStreams + 1));
+  self->streams[self->numStreams++] = stream;
+  return stream;
+}
+
+static uint64_t _streamSchedulerGetKey(const StreamSchedulerStream stream,
+                                       boolByte byDeadline) {
+  return byDeadline ? stream->_deadlineInNs : stream->_releaseTimeInNs;
+}
+
+static void _streamSchedulerHeapPush(StreamSchedulerStream *heap,
+                                     unsigned int *numItems,
+                                     StreamSchedulerStream stream,
+                                     boolByte byDeadline) {
+  const uint64_t key = _streamSchedulerGetKey(stream, byDeadline);
+  unsigned int i = (*numItems)++;
+  unsigned int parent;
+
+  while (i > 0) {
+    parent = (i - 1) / 2;
+
+    if (_streamSchedulerGetKey(heap[parent], byDeadline) <= key) {
+      break;
+    }
+
+    heap[i] = heap[parent];
+    i = parent;
+  }
+
+  heap[i] = stream;
+}
+
+static StreamSchedulerStream
+_streamSchedulerHeapPop(StreamSchedulerStream *heap, unsigned int *numItems,
+                        boolByte byDeadline) {
+  StreamSchedulerStream result = heap[0];
+  StreamSchedulerStream last = heap[--(*numItems)];
+  const uint64_t key = _streamSchedulerGetKey(last, byDeadline);
+  unsigned int i = 0;
+  unsigned int child;
+
+  while ((child = 2 * i + 1) < *numItems) {
+    if (child + 1 < *numItems &&
+        _streamSchedulerGetKey(heap[child + 1], byDeadline) <
+            _streamSchedulerGetKey(heap[child], byDeadline)) {
+      child++;
+    }
+
+    if (key <= _streamSchedulerGetKey(heap[child], byDeadline)) {
+      break;
+    }
+
+    heap[i] = heap[child];
+    i = child;
+  }
+
+  heap[i] = last;
+  return result;
+}
+
+// Set the release time and deadline of the stream's next block
+static void _streamSchedulerScheduleBlock(StreamSchedulerStream stream) {
+  stream->_releaseTimeInNs =
+      stream->_startTimeInNs + (uint64_t)stream->_scheduledTimeInNs;
+  stream->_scheduledTimeInNs += stream->_blockTimeInNs;
+  stream->_deadlineInNs =
+      stream->_startTimeInNs + (uint64_t)stream->_scheduledTimeInNs;
+}
+
+// Called with the mutex held once a block has been processed
+static void _streamSchedulerFinishBlock(StreamScheduler self,
+                                        StreamSchedulerStream stream,
+                                        boolByte hasMoreBlocks,
+                                        uint64_t finishTimeInNs) {
+  double latenessInNs;
+
+  stream->numBlocks++;
+
+  if (finishTimeInNs > stream->_deadlineInNs) {
+    latenessInNs = (double)(finishTimeInNs - stream->_deadlineInNs);
+    stream->numMissedDeadlines++;
+
+    if (latenessInNs / kStreamSchedulerNsPerMs > stream->maxLatenessInMs) {
+      stream->maxLatenessInMs = latenessInNs / kStreamSchedulerNsPerMs;
+    }
+
+    // Rushing through the following blocks to catch up would only make them
+    // late as well, and take time from the other streams
+    if (latenessInNs > stream->_blockTimeInNs) {
+      logDebug("Stream '%s' is %gms behind, restarting its schedule",
+               stream->name->data, latenessInNs / kStreamSchedulerNsPerMs);
+      stream->_startTimeInNs = finishTimeInNs;
+      stream->_scheduledTimeInNs = 0.0;
+    }
+  }
+
+  if (hasMoreBlocks) {
+    _streamSchedulerScheduleBlock(stream);
+    _streamSchedulerHeapPush(self->_pending, &self->_numPending, stream, false);
+  } else {
+    stream->finished = true;
+    self->_numActive--;
+  }
+
+  for (; self->_numIdle > 0; self->_numIdle--) {
+    semaphorePost(self->_blockFinished);
+  }
+}
+
+// Get the earliest time at which a stream may become ready, which is either
+// when the next pending stream is released, or when a running stream could
+// be released again after finishing its block. A running stream whose
+// deadline has already passed is picked up again by its own worker. Called
+// with the mutex held.
+static uint64_t _streamSchedulerGetWakeTime(StreamScheduler self,
+                                            uint64_t currentTimeInNs) {
+  uint64_t result = UINT64_MAX;
+  unsigned int i;
+
+  if (self->_numPending > 0) {
+    result = self->_pending[0]->_releaseTimeInNs;
+  }
+
+  for (i = 0; i < self->numWorkers; i++) {
+    if (self->_runningDeadlines[i] > currentTimeInNs &&
+        self->_runningDeadlines[i] < result) {
+      result = self->_runningDeadlines[i];
+    }
+  }
+
+  return result;
+}
+
+static void _streamSchedulerWorkerThread(void *userData) {
+  _StreamSchedulerWorker worker = (_StreamSchedulerWorker)userData;
+  StreamScheduler self = worker->scheduler;
+  RealtimeScheduler clock = newRealtimeScheduler();
+  StreamSchedulerStream stream;
+  boolByte hasMoreBlocks;
+  uint64_t currentTimeInNs;
+  uint64_t wakeTimeInNs;
+
+  if (self->pinToProcessors) {
+    threadSetAffinity(worker->index % platformInfoGetNumProcessors());
+  }
+
+  threadSetRealtimePriority();
+  mutexLock(self->_mutex);
+
+  while (self->_numActive > 0) {
+    currentTimeInNs = realtimeSchedulerGetCurrentTimeInNs(clock);
+
+    while (self->_numPending > 0 &&
+           self->_pending[0]->_releaseTimeInNs <= currentTimeInNs) {
+      _streamSchedulerHeapPush(
+          self->_ready, &self->_numReady,
+          _streamSchedulerHeapPop(self->_pending, &self->_numPending, false),
+          true);
+    }
+
+    if (self->_numReady > 0) {
+      stream = _streamSchedulerHeapPop(self->_ready, &self->_numReady, true);
+      self->_runningDeadlines[worker->index] = stream->_deadlineInNs;
+      mutexUnlock(self->_mutex);
+
+      hasMoreBlocks = stream->process(stream->userData);
+      currentTimeInNs = realtimeSchedulerGetCurrentTimeInNs(clock);
+
+      mutexLock(self->_mutex);
+      self->_runningDeadlines[worker->index] = 0;
+      _streamSchedulerFinishBlock(self, stream, hasMoreBlocks,
+                                  currentTimeInNs);
+    } else {
+      wakeTimeInNs = _streamSchedulerGetWakeTime(self, currentTimeInNs);
+
+      // Polling here would starve the other workers of a realtime thread on
+      // the same processor
+      if (wakeTimeInNs == UINT64_MAX) {
+        self->_numIdle++;
+        mutexUnlock(self->_mutex);
+        semaphoreWait(self->_blockFinished);
+      } else {
+        mutexUnlock(self->_mutex);
+        realtimeSchedulerSleepUntil(clock, wakeTimeInNs);
+      }
+
+      mutexLock(self->_mutex);
+    }
+  }
+
+  mutexUnlock(self->_mutex);
+  freeRealtimeScheduler(clock);
+}
+
+boolByte streamSchedulerRun(StreamScheduler self) {
+  _StreamSchedulerWorker workers;
+  RealtimeScheduler clock;
+  uint64_t startTimeInNs;
+  unsigned int numStarted;
+  unsigned int i;
+
+  if (self->numStreams == 0) {
+    return true;
+  }
+
+  self->_pending = (StreamSchedulerStream *)malloc(
+      sizeof(StreamSchedulerStream) * self->numStreams);
+  self->_ready = (StreamSchedulerStream *)malloc(sizeof(StreamSchedulerStream) *
+                                                 self->numStreams);
+  self->_numPending = 0;
+  self->_numReady = 0;
+  self->_numActive = self->numStreams;
+
+  // All streams start at the same time, and are spread over the workers by the
+  // order of their deadlines from there on
+  clock = newRealtimeScheduler();
+  startTimeInNs = realtimeSchedulerGetCurrentTimeInNs(clock);
+  freeRealtimeScheduler(clock);
+
+  for (i = 0; i < self->numStreams; i++) {
+    self->streams[i]->_startTimeInNs = startTimeInNs;
+    self->streams[i]->_scheduledTimeInNs = 0.0;
+    _streamSchedulerScheduleBlock(self->streams[i]);
+    _streamSchedulerHeapPush(self->_pending, &self->_numPending,
+                             self->streams[i], false);
+  }
+
+  logInfo("Running %d streams on %d threads", self->numStreams,
+          self->numWorkers);
+  workers = (_StreamSchedulerWorker)malloc(
+      sizeof(_StreamSchedulerWorkerMembers) * self->numWorkers);
+
+  for (numStarted = 0; numStarted < self->numWorkers; numStarted++) {
+    workers[numStarted].scheduler = self;
+    workers[numStarted].index = numStarted;
+    workers[numStarted].thread =
+        newThread(_streamSchedulerWorkerThread, &workers[numStarted]);
+
+    if (workers[numStarted].thread == NULL) {
+      logError("Could not start stream worker %d", numStarted);
+      break;
+    }
+  }
+
+  // The workers which did start still run all of the streams
+  for (i = 0; i < numStarted; i++) {
+    threadJoinAndFree(workers[i].thread);
+  }
+
+  free(workers);
+  free(self->_pending);
+  self->_pending = NULL;
+  free(self->_ready);
+  self->_ready = NULL;
+  return (boolByte)(numStarted > 0);
+}
+
+unsigned long streamSchedulerGetNumMissedDeadlines(const StreamScheduler self) {
+  unsigned long result = 0;
+  unsigned int i;
+
+  for (i = 0; i < self->numStreams; i++) {
+    result += self->streams[i]->numMissedDeadlines;
+  }
+
+  return result;
+}
+
+void streamSchedulerLogReport(const StreamScheduler self) {
+  StreamSchedulerStream stream;
+  unsigned int i;
+
+  for (i = 0; i < self->numStreams; i++) {
+    stream = self->streams[i];
+
+    if (stream->numMissedDeadlines > 0) {
+      logWarn("Stream '%s' missed %lu of %lu deadlines, by up to %.2fms",
+              stream->name->data, stream->numMissedDeadlines,
+              stream->numBlocks, stream->maxLatenessInMs);
+    } else {
+      logInfo("Stream '%s' met all %lu deadlines", stream->name->data,
+              stream->numBlocks);
+    }
+  }
+}
+
+void freeStreamScheduler(StreamScheduler self) {
+  unsigned int i;
+
+  if (self != NULL) {
+    for (i = 0; i < self->numStreams; i++) {
+      freeCharString(self->streams[i]->name);
+      free(self->streams[i]);
+    }
+
+    free(self->streams);
+    free(self->_runningDeadlines);
+    freeMutex(self->_mutex);
+    freeSemaphore(self->_blockFinished);
+    free(self);
+  }
+}
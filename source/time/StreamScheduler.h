@@ -0,0 +1,154 @@
+//
+// StreamScheduler.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatson_StreamScheduler_h
+#define MrsWatson_StreamScheduler_h
+
+#include "base/CharString.h"
+#include "base/Thread.h"
+#include "base/Types.h"
+
+#include <stdint.h>
+
+/**
+ * Process one block of a stream. This is called on one of the scheduler's
+ * worker threads, but never on two threads at the same time for one stream.
+ * @param userData User data which was passed to streamSchedulerAddStream()
+ * @return True if the stream has more blocks, false once it has ended
+ */
+typedef boolByte (*StreamSchedulerProcessFunc)(void *userData);
+
+typedef struct {
+  CharString name;
+  StreamSchedulerProcessFunc process;
+  void *userData;
+  // Number of blocks processed so far
+  unsigned long numBlocks;
+  // Number of blocks which were finished after their deadline
+  unsigned long numMissedDeadlines;
+  // Latest that any block was finished after its deadline, in milliseconds
+  double maxLatenessInMs;
+  boolByte finished;
+
+  double _blockTimeInNs;
+  // Start of the schedule, which is restarted after a block was late by more
+  // than its own length, in the same way as a RealtimeScheduler
+  uint64_t _startTimeInNs;
+  // Time of the current block's deadline relative to the start time, summed as
+  // a double so that the schedule does not drift
+  double _scheduledTimeInNs;
+  // A block may not start before the deadline of the previous block, since
+  // its input is only due by then
+  uint64_t _releaseTimeInNs;
+  uint64_t _deadlineInNs;
+} StreamSchedulerStreamMembers;
+typedef StreamSchedulerStreamMembers *StreamSchedulerStream;
+
+/**
+ * Runs many realtime streams on a few worker threads. Each stream processes one
+ * block per period of its own blocksize and sample rate, and the block with the
+ * earliest deadline among those whose period has started is always run first.
+ * Workers sleep until the next period starts instead of each stream having a
+ * thread of its own, so hundreds of light streams keep a few processors busy.
+ */
+typedef struct {
+  unsigned int numWorkers;
+  boolByte pinToProcessors;
+  unsigned int numStreams;
+  StreamSchedulerStream *streams;
+
+  // Private fields
+  Mutex _mutex;
+  // Streams waiting for their next period, as a heap ordered by release time
+  StreamSchedulerStream *_pending;
+  unsigned int _numPending;
+  // Streams whose period has started, as a heap ordered by deadline
+  StreamSchedulerStream *_ready;
+  unsigned int _numReady;
+  // Deadline of the block which each worker is running, or 0 if it is idle
+  uint64_t *_runningDeadlines;
+  unsigned int _numActive;
+  // Workers which have nothing to wait for but the blocks which are running,
+  // and which are woken up by the semaphore once any block is finished
+  Semaphore _blockFinished;
+  unsigned int _numIdle;
+} StreamSchedulerMembers;
+typedef StreamSchedulerMembers *StreamScheduler;
+
+/**
+ * Create a new stream scheduler.
+ * @param numWorkers Number of worker threads, or 0 to use one per processor
+ * @param pinToProcessors If true, pin each worker to its own processor
+ * @return New scheduler without any streams
+ */
+StreamScheduler newStreamScheduler(unsigned int numWorkers,
+                                   boolByte pinToProcessors);
+
+/**
+ * Add a stream to the scheduler. Streams may only be added before
+ * streamSchedulerRun() is called.
+ * @param self
+ * @param name Name of the stream, used in the report
+ * @param blocksize Number of frames which the stream processes per block
+ * @param sampleRate Sample rate of the stream, which sets the length of each
+ * period together with the blocksize
+ * @param process Function to process one block
+ * @param userData User data to pass to the function
+ * @return New stream, which is owned by the scheduler
+ */
+StreamSchedulerStream
+streamSchedulerAddStream(StreamScheduler self, const CharString name,
+                         const SampleCount blocksize,
+                         const SampleRate sampleRate,
+                         StreamSchedulerProcessFunc process, void *userData);
+
+/**
+ * Run all streams until they have ended. The first block of every stream
+ * starts right away, and each following block at the deadline of the one
+ * before it.
+ * @param self
+ * @return False if the worker threads could not be started
+ */
+boolByte streamSchedulerRun(StreamScheduler self);
+
+/**
+ * @param self
+ * @return Number of missed deadlines of all streams together
+ */
+unsigned long streamSchedulerGetNumMissedDeadlines(const StreamScheduler self);
+
+/**
+ * Log the number of blocks and missed deadlines of each stream.
+ * @param self
+ */
+void streamSchedulerLogReport(const StreamScheduler self);
+
+/**
+ * Free a stream scheduler and its streams. The scheduler must not be running.
+ * @param self
+ */
+void freeStreamScheduler(StreamScheduler self);
+
+#endif
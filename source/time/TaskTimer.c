@@ -26,36 +26,109 @@
 
 #include "TaskTimer.h"
 
+#include "time/TraceEvents.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 
+#if MACOSX
+#include <mach/mach_time.h>
+#endif
 #if UNIX
 #include <time.h>
 #endif
 
+static const uint64_t kTaskTimerNsPerSecond = 1000000000;
+
 TaskTimer newTaskTimer(const CharString component, const char *subcomponent) {
   const char *componentCString = component != NULL ? component->data : NULL;
   return newTaskTimerWithCString(componentCString, subcomponent);
 }
 
+uint64_t taskTimerGetTimestampInNs(void) {
+#if WINDOWS
+  static LONGLONG counterFrequency = 0;
+  LARGE_INTEGER counter;
+
+  // The frequency is fixed at boot, so threads which race here all store the
+  // same value
+  if (counterFrequency == 0) {
+    LARGE_INTEGER queryFrequency;
+    QueryPerformanceFrequency(&queryFrequency);
+    counterFrequency = queryFrequency.QuadPart;
+  }
+
+  QueryPerformanceCounter(&counter);
+  // Split into whole seconds and the remainder to avoid overflowing when
+  // multiplying a large counter value
+  return (uint64_t)(counter.QuadPart / counterFrequency) *
+             kTaskTimerNsPerSecond +
+         (uint64_t)(counter.QuadPart % counterFrequency) *
+             kTaskTimerNsPerSecond / (uint64_t)counterFrequency;
+#elif MACOSX
+  static mach_timebase_info_data_t timebase = {0, 0};
+
+  if (timebase.denom == 0) {
+    mach_timebase_info(&timebase);
+  }
+
+  return mach_absolute_time() * timebase.numer / timebase.denom;
+#elif UNIX
+  struct timespec currentTime;
+  clock_gettime(CLOCK_MONOTONIC, &currentTime);
+  return (uint64_t)currentTime.tv_sec * kTaskTimerNsPerSecond +
+         (uint64_t)currentTime.tv_nsec;
+#endif
+}
+
+static uint64_t _taskTimerGetThreadCpuTimeInNs(void) {
+#if WINDOWS
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  ULARGE_INTEGER kernel, user;
+
+  if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime,
+                      &kernelTime, &userTime)) {
+    return 0;
+  }
+
+  kernel.LowPart = kernelTime.dwLowDateTime;
+  kernel.HighPart = kernelTime.dwHighDateTime;
+  user.LowPart = userTime.dwLowDateTime;
+  user.HighPart = userTime.dwHighDateTime;
+  // FILETIME counts in units of 100ns
+  return (kernel.QuadPart + user.QuadPart) * 100;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+  struct timespec cpuTime;
+
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuTime) != 0) {
+    return 0;
+  }
+
+  return (uint64_t)cpuTime.tv_sec * kTaskTimerNsPerSecond +
+         (uint64_t)cpuTime.tv_nsec;
+#else
+  return 0;
+#endif
+}
+
 TaskTimer newTaskTimerWithCString(const char *component,
                                   const char *subcomponent) {
   TaskTimer taskTimer = (TaskTimer)malloc(sizeof(TaskTimerMembers));
-#if WINDOWS
-  LARGE_INTEGER queryFrequency;
-#endif
 
   taskTimer->component = newCharStringWithCString(component);
   taskTimer->subcomponent = newCharStringWithCString(subcomponent);
   taskTimer->enabled = true;
   taskTimer->_running = false;
   taskTimer->totalTaskTime = 0.0;
-
-#if WINDOWS
-  QueryPerformanceFrequency(&queryFrequency);
-  taskTimer->counterFrequency = (double)(queryFrequency.QuadPart) / 1000.0;
-#endif
-
+  taskTimer->minTaskTime = 0.0;
+  taskTimer->maxTaskTime = 0.0;
+  taskTimer->numTasks = 0;
+  taskTimer->totalCpuTime = 0.0;
+  taskTimer->_totalTaskTimeInNs = 0;
+  taskTimer->_startTimeInNs = 0;
+  taskTimer->_measureCpuTime = false;
+  taskTimer->_totalCpuTimeInNs = 0;
+  taskTimer->_startCpuTimeInNs = 0;
   return taskTimer;
 }
 
@@ -64,63 +137,86 @@ void taskTimerStart(TaskTimer self) {
     taskTimerStop(self);
   }
 
-#if WINDOWS
-  QueryPerformanceCounter(&(self->startTime));
-#elif UNIX
-  gettimeofday(&self->startTime, NULL);
-#endif
+  // The CPU clock is read inside of the wall clock interval, so that the cost
+  // of reading it does not make the CPU time longer than the wall time
+  self->_startTimeInNs = taskTimerGetTimestampInNs();
+  if (self->_measureCpuTime) {
+    self->_startCpuTimeInNs = _taskTimerGetThreadCpuTimeInNs();
+  }
+
   self->_running = true;
 }
 
 double taskTimerStop(TaskTimer self) {
-  double elapsedTimeInMs = 0.0;
-#if UNIX
-  double elapsedFullSeconds;
-  double elapsedMicroseconds;
-  struct timeval currentTime;
-#elif WINDOWS
-  LONGLONG elapsedTimeInClocks;
-  LARGE_INTEGER stopTime;
-#endif
+  uint64_t elapsedTimeInNs;
+  double elapsedTimeInMs;
 
   if (!self->_running) {
     return 0.0;
   }
 
-#if UNIX
+  if (self->_measureCpuTime) {
+    self->_totalCpuTimeInNs +=
+        _taskTimerGetThreadCpuTimeInNs() - self->_startCpuTimeInNs;
+    self->totalCpuTime = (double)self->_totalCpuTimeInNs / 1000000.0;
+  }
 
-  if (gettimeofday(&currentTime, NULL) == 0) {
-    if (currentTime.tv_sec == self->startTime.tv_sec) {
-      elapsedTimeInMs =
-          (double)(currentTime.tv_usec - self->startTime.tv_usec) / 1000.0;
-    } else {
-      elapsedFullSeconds =
-          (double)(currentTime.tv_sec - self->startTime.tv_sec - 1);
-      elapsedMicroseconds =
-          (double)(currentTime.tv_usec + (1000000l - self->startTime.tv_usec));
-      elapsedTimeInMs =
-          (elapsedFullSeconds * 1000.0) + (elapsedMicroseconds / 1000.0);
-    }
+  elapsedTimeInNs = taskTimerGetTimestampInNs() - self->_startTimeInNs;
+  elapsedTimeInMs = (double)elapsedTimeInNs / 1000000.0;
+
+  self->_totalTaskTimeInNs += elapsedTimeInNs;
+  self->totalTaskTime = (double)self->_totalTaskTimeInNs / 1000000.0;
 
-    self->totalTaskTime += elapsedTimeInMs;
+  if (self->numTasks == 0 || elapsedTimeInMs < self->minTaskTime) {
+    self->minTaskTime = elapsedTimeInMs;
   }
+  if (elapsedTimeInMs > self->maxTaskTime) {
+    self->maxTaskTime = elapsedTimeInMs;
+  }
+  self->numTasks++;
 
-#elif WINDOWS
-  QueryPerformanceCounter(&stopTime);
-  elapsedTimeInClocks = stopTime.QuadPart - self->startTime.QuadPart;
-  elapsedTimeInMs = (double)(elapsedTimeInClocks) / self->counterFrequency;
-  self->totalTaskTime += elapsedTimeInMs;
-#endif
+  traceEventsRecord(self->component->data, self->subcomponent->data,
+                    self->_startTimeInNs,
+                    self->_startTimeInNs + elapsedTimeInNs);
 
   self->_running = false;
   return elapsedTimeInMs;
 }
 
+void taskTimerSetMeasureCpuTime(TaskTimer self, boolByte measureCpuTime) {
+  self->_measureCpuTime = measureCpuTime;
+}
+
+void taskTimerReset(TaskTimer self) {
+  self->_running = false;
+  self->totalTaskTime = 0.0;
+  self->minTaskTime = 0.0;
+  self->maxTaskTime = 0.0;
+  self->numTasks = 0;
+  self->totalCpuTime = 0.0;
+  self->_totalTaskTimeInNs = 0;
+  self->_totalCpuTimeInNs = 0;
+}
+
+double taskTimerGetRunningTime(TaskTimer self) {
+  if (!self->_running) {
+    return 0.0;
+  }
+
+  return (double)(taskTimerGetTimestampInNs() - self->_startTimeInNs) /
+         1000000.0;
+}
+
 CharString taskTimerHumanReadbleString(TaskTimer self) {
   int hours, minutes, seconds;
   CharString outString = newCharStringWithCapacity(kCharStringLengthShort);
 
-  if (self->totalTaskTime < 1000) {
+  if (self->totalTaskTime > 0.0 && self->totalTaskTime < 10.0) {
+    // Show short times with more precision, since measuring small blocks often
+    // takes well under a millisecond
+    snprintf(outString->data, outString->capacity, "%.2fms",
+             self->totalTaskTime);
+  } else if (self->totalTaskTime < 1000) {
     snprintf(outString->data, outString->capacity, "%dms",
              (int)self->totalTaskTime);
   } else if (self->totalTaskTime < 60 * 1000) {
@@ -147,8 +243,9 @@ CharString taskTimerHumanReadbleString(TaskTimer self) {
 void taskTimerSleep(const double milliseconds) {
 #if UNIX
   struct timespec sleepTime;
-  sleepTime.tv_sec = 0;
-  sleepTime.tv_nsec = (long)(1000000.0 * milliseconds);
+  sleepTime.tv_sec = (time_t)(milliseconds / 1000.0);
+  sleepTime.tv_nsec =
+      (long)(1000000.0 * (milliseconds - 1000.0 * (double)sleepTime.tv_sec));
   nanosleep(&sleepTime, NULL);
 #elif WINDOWS
   Sleep((DWORD)milliseconds);
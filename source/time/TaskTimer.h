@@ -29,23 +29,32 @@
 
 #include "base/CharString.h"
 
-#if UNIX
-#include <sys/time.h>
-#endif
+#include <stdint.h>
 
 typedef struct {
   CharString component;
   CharString subcomponent;
   boolByte enabled;
   boolByte _running;
+  // Accumulated time of all start/stop cycles, in milliseconds
   double totalTaskTime;
+  // Shortest and longest single start/stop cycle, in milliseconds
+  double minTaskTime;
+  double maxTaskTime;
+  unsigned long numTasks;
 
-#if WINDOWS
-  LARGE_INTEGER startTime;
-  double counterFrequency;
-#elif UNIX
-  struct timeval startTime;
-#endif
+  // CPU time which the calling thread used during all start/stop cycles, in
+  // milliseconds. Only measured after taskTimerSetMeasureCpuTime() has been
+  // called, otherwise this is always 0.
+  double totalCpuTime;
+
+  // Times are accumulated in nanoseconds so that many short tasks do not
+  // round down to nothing
+  uint64_t _totalTaskTimeInNs;
+  uint64_t _startTimeInNs;
+  boolByte _measureCpuTime;
+  uint64_t _totalCpuTimeInNs;
+  uint64_t _startCpuTimeInNs;
 } TaskTimerMembers;
 typedef TaskTimerMembers *TaskTimer;
 
@@ -77,12 +86,45 @@ TaskTimer newTaskTimerWithCString(const char *component,
 void taskTimerStart(TaskTimer self);
 
 /**
- * Stop the timer. Timers may be stopped and started multiple times.
+ * Stop the timer. Timers may be stopped and started multiple times, and each
+ * start/stop cycle is counted in the timer's statistics.
  * @param self
- * @return Time used since last call to taskTimerStart()
+ * @return Time used since last call to taskTimerStart(), in milliseconds
  */
 double taskTimerStop(TaskTimer self);
 
+/**
+ * Also measure the CPU time of the thread which starts and stops the timer.
+ * Comparing this with the wall clock time shows how long the task was blocked
+ * or preempted. Reading the thread's CPU clock is a system call on most
+ * platforms, so this should only be enabled for timers which run once per
+ * block or less.
+ * @param self
+ * @param measureCpuTime True to measure CPU time
+ */
+void taskTimerSetMeasureCpuTime(TaskTimer self, boolByte measureCpuTime);
+
+/**
+ * Stop the timer if it is running, and clear its statistics.
+ * @param self
+ */
+void taskTimerReset(TaskTimer self);
+
+/**
+ * Get the time since the timer was started, without stopping it.
+ * @param self
+ * @return Time since the last call to taskTimerStart() in milliseconds, or 0
+ * if the timer is not running
+ */
+double taskTimerGetRunningTime(TaskTimer self);
+
+/**
+ * Get a timestamp from the same monotonic clock which the timers use. This can
+ * be used to measure durations where creating a timer would be too expensive.
+ * @return Current time in nanoseconds since an arbitrary starting point
+ */
+uint64_t taskTimerGetTimestampInNs(void);
+
 /**
  * Get the string representation of the total accumulated time for this timer.
  * @param self
@@ -0,0 +1,368 @@
+//
+// TraceEvents.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include "TraceEvents.h"
+
+#include "base/Thread.h"
+#include "logging/EventLogger.h"
+#include "time/TaskTimer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  char component[TRACE_EVENTS_NAME_LENGTH];
+  char name[TRACE_EVENTS_NAME_LENGTH];
+  // Set after the names have been copied, so that lookups can read the table
+  // without taking the lock
+  volatile unsigned int used;
+} _TraceEventsNameMembers;
+
+typedef struct {
+  uint64_t startTimeInNs;
+  uint64_t durationInNs;
+  unsigned int nameIndex;
+} _TraceEventMembers;
+
+typedef struct _TraceEventsBlockMembers {
+  struct _TraceEventsBlockMembers *nextBlock;
+  unsigned int numEvents;
+  _TraceEventMembers events[TRACE_EVENTS_BLOCK_SIZE];
+} _TraceEventsBlockMembers;
+
+// Only the thread which owns a buffer appends to it, the buffers are only read
+// after recording has stopped
+typedef struct _TraceEventsThreadMembers {
+  struct _TraceEventsThreadMembers *nextThread;
+  unsigned int threadId;
+  _TraceEventsBlockMembers *firstBlock;
+  _TraceEventsBlockMembers *lastBlock;
+} _TraceEventsThreadMembers;
+
+// Names are added and threads are registered under _traceEventsLock, which
+// each thread takes only once per new name and once for its own buffer
+static _TraceEventsNameMembers _traceEventsNames[TRACE_EVENTS_MAX_NAMES];
+static _TraceEventsThreadMembers *_traceEventsThreads = NULL;
+static unsigned int _traceEventsNumThreads = 0;
+static volatile unsigned int _traceEventsLock = 0;
+static volatile unsigned int _traceEventsEnabled = 0;
+static volatile unsigned int _traceEventsNumDropped = 0;
+static uint64_t _traceEventsStartTimeInNs = 0;
+
+// Buffers are freed when the events are reset, so each thread's pointer to its
+// buffer is only valid if it was registered in the current generation
+static volatile unsigned int _traceEventsGeneration = 1;
+static THREAD_LOCAL _TraceEventsThreadMembers *_traceEventsCurrentThread =
+    NULL;
+static THREAD_LOCAL unsigned int _traceEventsCurrentGeneration = 0;
+
+static void _traceEventsLockTables(void) {
+  while (!atomicCompareAndSwap(&_traceEventsLock, 0, 1)) {
+  }
+}
+
+static void _traceEventsUnlockTables(void) {
+  atomicStore(&_traceEventsLock, 0);
+}
+
+boolByte traceEventsIsEnabled(void) {
+  return (boolByte)(atomicLoad(&_traceEventsEnabled) != 0);
+}
+
+void traceEventsStart(void) {
+  traceEventsReset();
+  _traceEventsStartTimeInNs = taskTimerGetTimestampInNs();
+  atomicStore(&_traceEventsEnabled, 1);
+}
+
+void traceEventsStop(void) { atomicStore(&_traceEventsEnabled, 0); }
+
+static boolByte _traceEventsNameMatches(const _TraceEventsNameMembers *entry,
+                                        const char *component,
+                                        const char *name) {
+  return (boolByte)(
+      strncmp(entry->component, component, TRACE_EVENTS_NAME_LENGTH - 1) ==
+          0 &&
+      strncmp(entry->name, name, TRACE_EVENTS_NAME_LENGTH - 1) == 0);
+}
+
+static unsigned int _traceEventsHashName(const char *component,
+                                         const char *name) {
+  // FNV-1a over both strings, which are separated by their NULL bytes
+  unsigned int hash = 2166136261u;
+  const char *c;
+
+  for (c = component; *c != '\0'; c++) {
+    hash = (hash ^ (unsigned char)*c) * 16777619u;
+  }
+  hash *= 16777619u;
+  for (c = name; *c != '\0'; c++) {
+    hash = (hash ^ (unsigned char)*c) * 16777619u;
+  }
+
+  return hash;
+}
+
+// Find the index of a name, adding it to the table if it has not been seen
+// before. Returns TRACE_EVENTS_MAX_NAMES if the table is full.
+static unsigned int _traceEventsFindName(const char *component,
+                                         const char *name) {
+  const unsigned int hash = _traceEventsHashName(component, name);
+  _TraceEventsNameMembers *entry;
+  unsigned int index;
+  unsigned int i;
+
+  for (i = 0; i < TRACE_EVENTS_MAX_NAMES; i++) {
+    index = (hash + i) % TRACE_EVENTS_MAX_NAMES;
+    entry = &(_traceEventsNames[index]);
+
+    if (atomicLoadAcquire(&entry->used) == 0) {
+      break;
+    } else if (_traceEventsNameMatches(entry, component, name)) {
+      return index;
+    }
+  }
+
+  // Another thread may add the same name before the lock is taken, so the
+  // probe is repeated with the lock held
+  _traceEventsLockTables();
+
+  for (i = 0; i < TRACE_EVENTS_MAX_NAMES; i++) {
+    index = (hash + i) % TRACE_EVENTS_MAX_NAMES;
+    entry = &(_traceEventsNames[index]);
+
+    if (entry->used == 0) {
+      strncpy(entry->component, component, TRACE_EVENTS_NAME_LENGTH - 1);
+      entry->component[TRACE_EVENTS_NAME_LENGTH - 1] = '\0';
+      strncpy(entry->name, name, TRACE_EVENTS_NAME_LENGTH - 1);
+      entry->name[TRACE_EVENTS_NAME_LENGTH - 1] = '\0';
+      atomicStoreRelease(&entry->used, 1);
+      break;
+    } else if (_traceEventsNameMatches(entry, component, name)) {
+      break;
+    }
+  }
+
+  _traceEventsUnlockTables();
+  return i < TRACE_EVENTS_MAX_NAMES ? index : TRACE_EVENTS_MAX_NAMES;
+}
+
+static _TraceEventsThreadMembers *_traceEventsGetCurrentThread(void) {
+  const unsigned int generation = atomicLoad(&_traceEventsGeneration);
+  _TraceEventsThreadMembers *thread;
+
+  if (_traceEventsCurrentThread != NULL &&
+      _traceEventsCurrentGeneration == generation) {
+    return _traceEventsCurrentThread;
+  }
+
+  thread = (_TraceEventsThreadMembers *)malloc(
+      sizeof(_TraceEventsThreadMembers));
+  if (thread == NULL) {
+    return NULL;
+  }
+  thread->firstBlock = NULL;
+  thread->lastBlock = NULL;
+
+  _traceEventsLockTables();
+  thread->threadId = ++_traceEventsNumThreads;
+  thread->nextThread = _traceEventsThreads;
+  _traceEventsThreads = thread;
+  _traceEventsUnlockTables();
+
+  _traceEventsCurrentThread = thread;
+  _traceEventsCurrentGeneration = generation;
+  return thread;
+}
+
+void traceEventsRecord(const char *component, const char *name,
+                       uint64_t startTimeInNs, uint64_t endTimeInNs) {
+  _TraceEventsThreadMembers *thread;
+  _TraceEventsBlockMembers *block;
+  _TraceEventMembers *event;
+  unsigned int nameIndex;
+
+  if (atomicLoad(&_traceEventsEnabled) == 0) {
+    return;
+  }
+
+  nameIndex = _traceEventsFindName(component != NULL ? component : "",
+                                   name != NULL ? name : "");
+  thread = _traceEventsGetCurrentThread();
+  if (nameIndex == TRACE_EVENTS_MAX_NAMES || thread == NULL) {
+    atomicAdd(&_traceEventsNumDropped, 1);
+    return;
+  }
+
+  block = thread->lastBlock;
+  if (block == NULL || block->numEvents == TRACE_EVENTS_BLOCK_SIZE) {
+    block =
+        (_TraceEventsBlockMembers *)malloc(sizeof(_TraceEventsBlockMembers));
+    if (block == NULL) {
+      atomicAdd(&_traceEventsNumDropped, 1);
+      return;
+    }
+
+    block->nextBlock = NULL;
+    block->numEvents = 0;
+    if (thread->lastBlock == NULL) {
+      thread->firstBlock = block;
+    } else {
+      thread->lastBlock->nextBlock = block;
+    }
+    thread->lastBlock = block;
+  }
+
+  event = &(block->events[block->numEvents++]);
+  event->startTimeInNs = startTimeInNs;
+  event->durationInNs =
+      endTimeInNs > startTimeInNs ? endTimeInNs - startTimeInNs : 0;
+  event->nameIndex = nameIndex;
+}
+
+unsigned long traceEventsGetNumEvents(void) {
+  _TraceEventsThreadMembers *thread;
+  _TraceEventsBlockMembers *block;
+  unsigned long result = 0;
+
+  _traceEventsLockTables();
+
+  for (thread = _traceEventsThreads; thread != NULL;
+       thread = thread->nextThread) {
+    for (block = thread->firstBlock; block != NULL; block = block->nextBlock) {
+      result += block->numEvents;
+    }
+  }
+
+  _traceEventsUnlockTables();
+  return result;
+}
+
+unsigned long traceEventsGetNumDroppedEvents(void) {
+  return atomicLoad(&_traceEventsNumDropped);
+}
+
+static void _traceEventsWriteJsonString(FILE *file, const char *string) {
+  const char *c;
+
+  for (c = string; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      fprintf(file, "\\%c", *c);
+    } else if ((unsigned char)*c < 0x20) {
+      fprintf(file, "\\u%04x", (unsigned char)*c);
+    } else {
+      fputc(*c, file);
+    }
+  }
+}
+
+static void _traceEventsWriteEvent(FILE *file, unsigned int threadId,
+                                   const _TraceEventMembers *event) {
+  const _TraceEventsNameMembers *name = &(_traceEventsNames[event->nameIndex]);
+  // Timers which were started before recording began are clipped to the
+  // beginning of the trace
+  const uint64_t startTimeInNs =
+      event->startTimeInNs > _traceEventsStartTimeInNs
+          ? event->startTimeInNs - _traceEventsStartTimeInNs
+          : 0;
+
+  fprintf(file, ",\n{\"name\": \"");
+  if (name->component[0] != '\0') {
+    _traceEventsWriteJsonString(file, name->component);
+    fprintf(file, ": ");
+  }
+  _traceEventsWriteJsonString(file, name->name);
+  fprintf(file, "\", \"cat\": \"");
+  _traceEventsWriteJsonString(file, name->component);
+  // Timestamps are in microseconds, but fractions are allowed
+  fprintf(file,
+          "\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, "
+          "\"tid\": %u}",
+          (double)startTimeInNs / 1000.0, (double)event->durationInNs / 1000.0,
+          threadId);
+}
+
+boolByte traceEventsWriteJson(const CharString filename) {
+  FILE *file = fopen(filename->data, "w");
+  _TraceEventsThreadMembers *thread;
+  _TraceEventsBlockMembers *block;
+  unsigned int i;
+
+  if (file == NULL) {
+    logError("Could not open '%s' to write trace events", filename->data);
+    return false;
+  }
+
+  _traceEventsLockTables();
+
+  fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+                "\"args\": {\"name\": \"MrsWatson\"}}");
+
+  for (thread = _traceEventsThreads; thread != NULL;
+       thread = thread->nextThread) {
+    // The first thread to record anything is usually the main thread
+    fprintf(file,
+            ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"tid\": %u, \"args\": {\"name\": \"Thread %u\"}}",
+            thread->threadId, thread->threadId);
+
+    for (block = thread->firstBlock; block != NULL; block = block->nextBlock) {
+      for (i = 0; i < block->numEvents; i++) {
+        _traceEventsWriteEvent(file, thread->threadId, &(block->events[i]));
+      }
+    }
+  }
+
+  fprintf(file, "\n]}\n");
+  _traceEventsUnlockTables();
+  fclose(file);
+  return true;
+}
+
+void traceEventsReset(void) {
+  _TraceEventsThreadMembers *thread;
+  _TraceEventsThreadMembers *nextThread;
+  _TraceEventsBlockMembers *block;
+  _TraceEventsBlockMembers *nextBlock;
+
+  _traceEventsLockTables();
+
+  for (thread = _traceEventsThreads; thread != NULL; thread = nextThread) {
+    nextThread = thread->nextThread;
+    for (block = thread->firstBlock; block != NULL; block = nextBlock) {
+      nextBlock = block->nextBlock;
+      free(block);
+    }
+    free(thread);
+  }
+
+  _traceEventsThreads = NULL;
+  _traceEventsNumThreads = 0;
+  memset(_traceEventsNames, 0, sizeof(_traceEventsNames));
+  atomicStore(&_traceEventsNumDropped, 0);
+  atomicAdd(&_traceEventsGeneration, 1);
+  _traceEventsUnlockTables();
+}
@@ -0,0 +1,123 @@
+//
+// TraceEvents.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef MrsWatson_TraceEvents_h
+#define MrsWatson_TraceEvents_h
+
+#include "base/CharString.h"
+#include "base/Types.h"
+
+#include <stdint.h>
+
+/**
+ * Trace events record when each task started and how long it took, so that the
+ * work of all threads can be shown on one timeline. Every TaskTimer records an
+ * event when it is stopped, and other tasks such as loading plugins are
+ * recorded directly.
+ *
+ * Each thread appends events to its own buffer, so recording does not take any
+ * lock once a thread has recorded its first event and the names of its tasks
+ * have been seen. The events are written in the Chrome trace event format,
+ * which can be opened with chrome://tracing or the Perfetto UI.
+ */
+
+/**
+ * Maximum length of a component or task name, including the terminating NULL
+ * byte. Longer names are truncated in the trace.
+ */
+#define TRACE_EVENTS_NAME_LENGTH 64
+
+/**
+ * Maximum number of different component and task name pairs. Events with any
+ * further names are dropped.
+ */
+#define TRACE_EVENTS_MAX_NAMES 256
+
+/**
+ * Number of events in each block of a thread's buffer. Buffers grow by one
+ * block at a time, so threads only allocate memory once per this many events.
+ */
+#define TRACE_EVENTS_BLOCK_SIZE 16384
+
+/**
+ * Check if events are being recorded
+ * @return True if traceEventsStart() has been called, but not
+ * traceEventsStop()
+ */
+boolByte traceEventsIsEnabled(void);
+
+/**
+ * Start recording events. This discards any events from a previous run, so it
+ * must not be called while other threads may still be recording.
+ */
+void traceEventsStart(void);
+
+/**
+ * Stop recording events. The events which were recorded are kept until
+ * traceEventsStart() or traceEventsReset() is called.
+ */
+void traceEventsStop(void);
+
+/**
+ * Record a task which has finished on the calling thread. Does nothing unless
+ * events are being recorded.
+ * @param component Component which the task belongs to, for example a plugin
+ * name. May be NULL.
+ * @param name Name of the task
+ * @param startTimeInNs Time when the task started, from
+ * taskTimerGetTimestampInNs()
+ * @param endTimeInNs Time when the task finished, from
+ * taskTimerGetTimestampInNs()
+ */
+void traceEventsRecord(const char *component, const char *name,
+                       uint64_t startTimeInNs, uint64_t endTimeInNs);
+
+/**
+ * Get the number of events which have been recorded
+ * @return Number of events on all threads
+ */
+unsigned long traceEventsGetNumEvents(void);
+
+/**
+ * Get the number of events which could not be recorded, because there were
+ * too many different names or a buffer could not be allocated
+ * @return Number of dropped events
+ */
+unsigned long traceEventsGetNumDroppedEvents(void);
+
+/**
+ * Write all recorded events as a Chrome trace event JSON file. Events must not
+ * be recorded while writing, so call traceEventsStop() first.
+ * @param filename File to write
+ * @return True if the file was written
+ */
+boolByte traceEventsWriteJson(const CharString filename);
+
+/**
+ * Discard all recorded events and free their buffers. This must not be called
+ * while other threads may still be recording.
+ */
+void traceEventsReset(void);
+
+#endif
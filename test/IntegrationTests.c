@@ -751,6 +751,68 @@ static int _testInternalPassthruPlugin(const char *testName,
   return result;
 }
 
+// Render a MIDI file with the sine plugin and get the size of the output. The
+// output is not analyzed, since the sine wave has silent gaps between notes.
+static int _renderMidiWithBlocksize(const char *testName, int blocksize,
+                                    const CharString applicationPath,
+                                    const CharString resourcesPath,
+                                    size_t *outSize) {
+  CharString midiFile =
+      getTestResourcePath(resourcesPath, "midi", "c-scale.mid");
+  CharString blocksizeTestName = newCharString();
+  CharString outputFilename;
+  File outputFile;
+  int result;
+
+  snprintf(blocksizeTestName->data, blocksizeTestName->capacity, "%s %d",
+           testName, blocksize);
+  outputFilename =
+      getTestOutputFilename(blocksizeTestName->data, kTestOutputPcm);
+  result = runIntegrationTest(
+      blocksizeTestName->data,
+      buildTestArgumentString("--plugin mrs_sine --midi-file \"%s\" "
+                              "--blocksize %d --output \"%s\"",
+                              midiFile->data, blocksize, outputFilename->data),
+      RETURN_CODE_SUCCESS, kTestOutputNone, applicationPath, resourcesPath);
+
+  outputFile = newFileWithPath(outputFilename);
+  *outSize = fileExists(outputFile) ? fileGetSize(outputFile) : 0;
+
+  freeFile(outputFile);
+  freeCharString(outputFilename);
+  freeCharString(blocksizeTestName);
+  freeCharString(midiFile);
+  return result;
+}
+
+static int _testMidiOutputLengthWithBlocksize(const char *testName,
+                                              const CharString applicationPath,
+                                              const CharString resourcesPath) {
+  size_t smallBlocksSize = 0;
+  size_t largeBlocksSize = 0;
+  int result;
+
+  // The output has the length of the sequence, and not of the blocks which it
+  // took to render it
+  result = _renderMidiWithBlocksize(testName, 100, applicationPath,
+                                    resourcesPath, &smallBlocksSize);
+
+  if (result == 0) {
+    result = _renderMidiWithBlocksize(testName, 512, applicationPath,
+                                      resourcesPath, &largeBlocksSize);
+  }
+
+  if (result == 0 && smallBlocksSize != largeBlocksSize) {
+    fprintf(stderr,
+            "Output has %lu bytes with a blocksize of 100, but %lu bytes with "
+            "a blocksize of 512. ",
+            (unsigned long)smallBlocksSize, (unsigned long)largeBlocksSize);
+    result = 1;
+  }
+
+  return result;
+}
+
 #if TEST_SILENCE_PLUGIN
 static int _testInternalSilenceGenerator(const char *testName,
                                          const CharString applicationPath,
@@ -946,6 +1008,8 @@ TestSuite addIntegrationTests(File mrsWatsonExePath, File resourcesPath) {
                    _testProcessWithBlocksize);
   addTestWithPaths(testSuite, "Process with time signature",
                    _testProcessWithTimeSignature);
+  addTestWithPaths(testSuite, "MIDI output length with blocksize",
+                   _testMidiOutputLengthWithBlocksize);
 
   // Parameter tests
   addTestWithPaths(testSuite, "Set parameter", _testSetParameter);
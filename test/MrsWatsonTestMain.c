@@ -29,12 +29,17 @@
 #include "app/ProgramOption.h"
 #include "base/File.h"
 #include "base/PlatformInfo.h"
+#include "base/Process.h"
 #include "unit/ApplicationRunner.h"
+#include "unit/BenchmarkRunner.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#if WINDOWS
+#include <io.h>
+#endif
 
 extern LinkedList getTestSuites(File mrsWatsonExePath, File resourcesPath);
 extern TestSuite findTestSuite(LinkedList testSuites,
@@ -43,6 +48,12 @@ extern TestCase findTestCase(TestSuite testSuite, char *testName);
 extern void printUnitTestSuites(void);
 extern TestSuite runUnitTests(LinkedList testSuites, boolByte onlyPrintFailing);
 
+// Printed by workers after their output, followed by the number of passed,
+// failed, and skipped tests
+static const char *kTestWorkerResultsPrefix = "Worker results: ";
+static const char *kTestIntegrationSuiteName = "Integration";
+static const double kTestJobsPollIntervalInMs = 5.0;
+
 #if UNIX
 static const char *MRSWATSON_EXE_NAME = "mrswatson";
 #elif WINDOWS
@@ -131,6 +142,75 @@ etc.). Normally these files are automatically removed if a test succeeds.",
                                              true, kProgramOptionTypeEmpty,
                                              kProgramOptionArgumentTypeNone));
 
+  programOptionsAdd(
+      programOptions,
+      newProgramOptionWithName(
+          OPTION_TEST_JOBS, "jobs",
+          "When running all tests, run up to this many test suites at once, each in \
+its own process. Integration tests are run one per process, since each of them \
+waits for mrswatson to finish. The output of each process is printed when it \
+finishes, in the same order as when running one at a time.",
+          true, kProgramOptionTypeNumber, kProgramOptionArgumentTypeRequired));
+  programOptionsSetNumber(programOptions, OPTION_TEST_JOBS, 1.0f);
+
+  programOptionsAdd(
+      programOptions,
+      newProgramOptionWithName(
+          OPTION_TEST_WORKER, "worker",
+          "Used by --jobs to run a suite or test in a child process. All output is \
+written to standard output, followed by the number of tests which passed, failed, \
+and were skipped.",
+          false, kProgramOptionTypeEmpty, kProgramOptionArgumentTypeNone));
+
+  programOptionsAdd(
+      programOptions,
+      newProgramOptionWithName(
+          OPTION_TEST_BENCHMARK, "benchmark",
+          "Run benchmarks instead of tests. Benchmarks are registered in the test \
+suites, and this option can be given a suite name or a single benchmark named \
+'Suite:Name' to run. Each benchmark is warmed up and then timed several times, \
+and the median and median absolute deviation of the time per iteration are \
+printed.",
+          true, kProgramOptionTypeString, kProgramOptionArgumentTypeOptional));
+
+  programOptionsAdd(
+      programOptions,
+      newProgramOptionWithName(
+          OPTION_TEST_BENCHMARK_BASELINE, "benchmark-baseline",
+          "Compare benchmarks against the results of an earlier run, which were \
+written by --benchmark-output. Benchmarks which are significantly slower than the \
+baseline are counted as failures.",
+          false, kProgramOptionTypeString, kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      programOptions,
+      newProgramOptionWithName(
+          OPTION_TEST_BENCHMARK_CPU, "benchmark-cpu",
+          "Pin benchmarks to a list of processors, for example '2' or '0-3'. \
+Benchmarks which are moved between processors by the scheduler have much more \
+noise. For stable results, the processor should also use the 'performance' \
+frequency governor, which mrswatsontest warns about but can't set.",
+          false, kProgramOptionTypeString, kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      programOptions,
+      newProgramOptionWithName(OPTION_TEST_BENCHMARK_OUTPUT, "benchmark-output",
+                               "Write benchmark results to this JSON file",
+                               false, kProgramOptionTypeString,
+                               kProgramOptionArgumentTypeRequired));
+  programOptionsSetCString(programOptions, OPTION_TEST_BENCHMARK_OUTPUT,
+                           "benchmarks.json");
+
+  programOptionsAdd(
+      programOptions,
+      newProgramOptionWithName(OPTION_TEST_BENCHMARK_REPETITIONS,
+                               "benchmark-repetitions",
+                               "Number of times each benchmark is timed", false,
+                               kProgramOptionTypeNumber,
+                               kProgramOptionArgumentTypeRequired));
+  programOptionsSetNumber(programOptions, OPTION_TEST_BENCHMARK_REPETITIONS,
+                          15.0f);
+
   return programOptions;
 }
 
@@ -206,6 +286,210 @@ File _findMrsWatsonExe(CharString mrsWatsonExeArg) {
   return mrsWatsonExe;
 }
 
+typedef struct {
+  CharString name;
+  LinkedList arguments;
+  Process process;
+} _TestJobMembers;
+typedef _TestJobMembers *_TestJob;
+
+typedef struct {
+  LinkedList jobs;
+  LinkedList commonArguments;
+} _TestJobsData;
+
+static _TestJob _newTestJob(const char *option, const char *value,
+                            LinkedList commonArguments) {
+  _TestJob self = (_TestJob)malloc(sizeof(_TestJobMembers));
+  LinkedListIterator iterator;
+  CharString argument;
+
+  self->name = newCharStringWithCString(value);
+  self->arguments = newLinkedList();
+  self->process = NULL;
+  linkedListAppend(self->arguments, newCharStringWithCString("--worker"));
+  linkedListAppend(self->arguments, newCharStringWithCString(option));
+  linkedListAppend(self->arguments, newCharStringWithCString(value));
+
+  for (iterator = linkedListBegin(commonArguments); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    argument = (CharString)linkedListIteratorGetItem(iterator);
+    linkedListAppend(self->arguments, newCharStringWithCString(argument->data));
+  }
+
+  return self;
+}
+
+static void _freeTestJob(_TestJob self) {
+  freeCharString(self->name);
+  freeLinkedListAndItems(self->arguments,
+                         (LinkedListFreeItemFunc)freeCharString);
+  freeProcess(self->process);
+  free(self);
+}
+
+static void _addIntegrationTestJob(void *item, void *userData) {
+  TestCase testCase = (TestCase)item;
+  _TestJobsData *data = (_TestJobsData *)userData;
+  CharString testName = newCharStringWithCString(kTestIntegrationSuiteName);
+
+  charStringAppendCString(testName, ":");
+  charStringAppendCString(testName, testCase->name);
+  linkedListAppend(data->jobs, _newTestJob("--test", testName->data,
+                                           data->commonArguments));
+  freeCharString(testName);
+}
+
+static void _addTestSuiteJobs(void *item, void *userData) {
+  TestSuite testSuite = (TestSuite)item;
+  _TestJobsData *data = (_TestJobsData *)userData;
+
+  if (!strcmp(testSuite->name, kTestIntegrationSuiteName)) {
+    linkedListForeach(testSuite->testCases, _addIntegrationTestJob, data);
+  } else {
+    linkedListAppend(data->jobs, _newTestJob("--suite", testSuite->name,
+                                             data->commonArguments));
+  }
+}
+
+// Pass on the options which change how tests are run or printed
+static LinkedList _getCommonJobArguments(const ProgramOptions programOptions,
+                                         const File mrsWatsonExePath) {
+  LinkedList arguments = newLinkedList();
+  const TestProgramOptionIndex passedOptions[] = {
+      OPTION_TEST_PRINT_ONLY_FAILING, OPTION_TEST_KEEP_FILES,
+      OPTION_TEST_VERBOSE};
+  const char *passedOptionNames[] = {"--quiet", "--keep-files", "--verbose"};
+  size_t i;
+
+  for (i = 0; i < sizeof(passedOptions) / sizeof(passedOptions[0]); i++) {
+    if (programOptions->options[passedOptions[i]]->enabled) {
+      linkedListAppend(arguments,
+                       newCharStringWithCString(passedOptionNames[i]));
+    }
+  }
+
+  // The output of the workers goes to a pipe, so they cannot tell if colors
+  // should be used
+  linkedListAppend(arguments, newCharStringWithCString("--color"));
+  linkedListAppend(arguments, newCharStringWithCString(
+                                  isColoredOutputUsed() ? "force" : "none"));
+
+  if (mrsWatsonExePath != NULL) {
+    linkedListAppend(arguments, newCharStringWithCString("--mrswatson-path"));
+    linkedListAppend(arguments, newCharStringWithCString(
+                                    mrsWatsonExePath->absolutePath->data));
+  }
+
+  if (programOptions->options[OPTION_TEST_RESOURCES_PATH]->enabled) {
+    linkedListAppend(arguments, newCharStringWithCString("--resources"));
+    linkedListAppend(arguments,
+                     newCharStringWithCString(
+                         programOptionsGetString(programOptions,
+                                                 OPTION_TEST_RESOURCES_PATH)
+                             ->data));
+  }
+
+  return arguments;
+}
+
+// Print the output of a finished job, and add its results to the totals
+static void _finishTestJob(_TestJob job, TestSuite results) {
+  char *resultsLine = NULL;
+  char *next = job->process->output->data;
+  int passed, failed, skipped;
+
+  while ((next = strstr(next, kTestWorkerResultsPrefix)) != NULL) {
+    resultsLine = next;
+    next++;
+  }
+
+  if (resultsLine != NULL &&
+      sscanf(resultsLine + strlen(kTestWorkerResultsPrefix), "%d %d %d",
+             &passed, &failed, &skipped) == 3) {
+    *resultsLine = '\0';
+    fprintf(stderr, "%s", job->process->output->data);
+    results->numSuccess += passed;
+    results->numFail += failed;
+    results->numSkips += skipped;
+  } else {
+    // The worker crashed before it could print its results
+    fprintf(stderr, "%s\n  %s crashed: ", job->process->output->data,
+            job->name->data);
+    printTestFail();
+    results->numFail++;
+  }
+
+  fflush(stderr);
+}
+
+// Run each test suite in a child process, and each integration test in its own
+// process. Jobs may finish in any order, but are printed in the order that
+// they were started.
+static TestSuite _runTestJobs(LinkedList testSuites,
+                              const ProgramOptions programOptions,
+                              const File mrsWatsonExePath,
+                              unsigned int numJobs) {
+  TestSuite results = newTestSuite("Suite results", NULL, NULL);
+  CharString executable = fileGetExecutablePath();
+  _TestJobsData data;
+  _TestJob *jobs;
+  size_t numTestJobs, nextToStart = 0, nextToPrint = 0, running = 0, i;
+
+  data.jobs = newLinkedList();
+  data.commonArguments =
+      _getCommonJobArguments(programOptions, mrsWatsonExePath);
+  linkedListForeach(testSuites, _addTestSuiteJobs, &data);
+  numTestJobs = (size_t)linkedListLength(data.jobs);
+  jobs = (_TestJob *)linkedListToArray(data.jobs);
+
+  while (nextToPrint < numTestJobs) {
+    while (running < numJobs && nextToStart < numTestJobs) {
+      jobs[nextToStart]->process =
+          newProcess(executable, jobs[nextToStart]->arguments);
+      running += jobs[nextToStart]->process != NULL ? 1 : 0;
+      nextToStart++;
+    }
+
+    for (i = nextToPrint; i < nextToStart; i++) {
+      if (jobs[i]->process != NULL && !jobs[i]->process->finished &&
+          processPoll(jobs[i]->process)) {
+        running--;
+      }
+    }
+
+    while (nextToPrint < nextToStart &&
+           (jobs[nextToPrint]->process == NULL ||
+            jobs[nextToPrint]->process->finished)) {
+      if (jobs[nextToPrint]->process != NULL) {
+        _finishTestJob(jobs[nextToPrint], results);
+      } else {
+        results->numFail++;
+      }
+
+      nextToPrint++;
+    }
+
+    if (nextToPrint < numTestJobs) {
+      taskTimerSleep(kTestJobsPollIntervalInMs);
+    }
+  }
+
+  for (i = 0; i < numTestJobs; i++) {
+    _freeTestJob(jobs[i]);
+  }
+
+  free(jobs);
+  freeLinkedList(data.jobs);
+  freeLinkedListAndItems(data.commonArguments,
+                         (LinkedListFreeItemFunc)freeCharString);
+  freeCharString(executable);
+  _printTestSummary(results->numSuccess + results->numFail +
+                        results->numSkips,
+                    results->numSuccess, results->numFail, results->numSkips);
+  return results;
+}
+
 int main(int argc, char *argv[]) {
   ProgramOptions programOptions;
   int totalTestsRun = 0;
@@ -221,6 +505,7 @@ int main(int argc, char *argv[]) {
   TestSuite testSuite = NULL;
   LinkedList testSuites = NULL;
   TestSuite unitTestResults = NULL;
+  BenchmarkSettings benchmarkSettings;
   TaskTimer timer;
   char *testArgument;
   char *colon;
@@ -260,6 +545,17 @@ int main(int argc, char *argv[]) {
     return -1;
   }
 
+  // The parent of a worker only reads its standard output, and stderr is not
+  // buffered, so both are made unbuffered to keep the output in order
+  if (programOptions->options[OPTION_TEST_WORKER]->enabled) {
+    setvbuf(stdout, NULL, _IONBF, 0);
+#if WINDOWS
+    _dup2(_fileno(stdout), _fileno(stderr));
+#else
+    dup2(fileno(stdout), fileno(stderr));
+#endif
+  }
+
   useColor = programOptionsGetString(programOptions, OPTION_TEST_COLOR);
   useColoredOutput(useColor);
   if (programOptions->options[OPTION_TEST_VERBOSE]->enabled) {
@@ -274,7 +570,22 @@ int main(int argc, char *argv[]) {
   File resourcesPath = newFileWithPath(
       programOptionsGetString(programOptions, OPTION_TEST_RESOURCES_PATH));
 
-  if (programOptions->options[OPTION_TEST_NAME]->enabled) {
+  if (programOptions->options[OPTION_TEST_BENCHMARK]->enabled) {
+    benchmarkSettings.filter =
+        programOptionsGetString(programOptions, OPTION_TEST_BENCHMARK);
+    benchmarkSettings.repetitions = (unsigned int)programOptionsGetNumber(
+        programOptions, OPTION_TEST_BENCHMARK_REPETITIONS);
+    benchmarkSettings.processors =
+        programOptionsGetString(programOptions, OPTION_TEST_BENCHMARK_CPU);
+    benchmarkSettings.outputPath =
+        programOptionsGetString(programOptions, OPTION_TEST_BENCHMARK_OUTPUT);
+    benchmarkSettings.baselinePath = programOptionsGetString(
+        programOptions, OPTION_TEST_BENCHMARK_BASELINE);
+
+    testSuites = getTestSuites(mrsWatsonExePath, resourcesPath);
+    totalTestsFailed = runBenchmarks(testSuites, &benchmarkSettings);
+    freeLinkedListAndItems(testSuites, (LinkedListFreeItemFunc)freeTestSuite);
+  } else if (programOptions->options[OPTION_TEST_NAME]->enabled) {
     testArgument =
         programOptionsGetString(programOptions, OPTION_TEST_NAME)->data;
     colon = strchr(testArgument, ':');
@@ -320,6 +631,10 @@ int main(int argc, char *argv[]) {
     } else {
       printf("=== Running test %s:%s ===\n", testSuite->name, testCase->name);
       runTestCase(testCase, testSuite);
+      totalTestsRun = testSuite->numSuccess + testSuite->numFail;
+      totalTestsPassed = testSuite->numSuccess;
+      totalTestsFailed = testSuite->numFail;
+      totalTestsSkipped = testSuite->numSkips;
       freeLinkedListAndItems(testSuites, (LinkedListFreeItemFunc)freeTestSuite);
     }
   } else if (programOptions->options[OPTION_TEST_SUITE]->enabled) {
@@ -350,9 +665,17 @@ int main(int argc, char *argv[]) {
     testSuites = getTestSuites(mrsWatsonExePath, resourcesPath);
 
     printf("=== Running tests ===\n");
-    unitTestResults = runUnitTests(
-        testSuites,
-        programOptions->options[OPTION_TEST_PRINT_ONLY_FAILING]->enabled);
+
+    if (programOptionsGetNumber(programOptions, OPTION_TEST_JOBS) > 1.0f) {
+      unitTestResults = _runTestJobs(
+          testSuites, programOptions, mrsWatsonExePath,
+          (unsigned int)programOptionsGetNumber(programOptions,
+                                                OPTION_TEST_JOBS));
+    } else {
+      unitTestResults = runUnitTests(
+          testSuites,
+          programOptions->options[OPTION_TEST_PRINT_ONLY_FAILING]->enabled);
+    }
 
     totalTestsRun += unitTestResults->numSuccess + unitTestResults->numFail;
     totalTestsPassed += unitTestResults->numSuccess;
@@ -365,7 +688,10 @@ int main(int argc, char *argv[]) {
 
   taskTimerStop(timer);
 
-  if (totalTestsRun > 0) {
+  if (programOptions->options[OPTION_TEST_WORKER]->enabled) {
+    printf("%s%d %d %d\n", kTestWorkerResultsPrefix, totalTestsPassed,
+           totalTestsFailed, totalTestsSkipped);
+  } else if (totalTestsRun > 0) {
     printf("\n=== Finished ===\n");
     _printTestSummary(totalTestsRun, totalTestsPassed, totalTestsFailed,
                       totalTestsSkipped);
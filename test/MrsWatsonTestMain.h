@@ -35,5 +35,12 @@ typedef enum {
   OPTION_TEST_KEEP_FILES,
   OPTION_TEST_HELP,
   OPTION_TEST_VERBOSE,
+  OPTION_TEST_JOBS,
+  OPTION_TEST_WORKER,
+  OPTION_TEST_BENCHMARK,
+  OPTION_TEST_BENCHMARK_BASELINE,
+  OPTION_TEST_BENCHMARK_CPU,
+  OPTION_TEST_BENCHMARK_OUTPUT,
+  OPTION_TEST_BENCHMARK_REPETITIONS,
   NUM_TEST_OPTIONS
 } TestProgramOptionIndex;
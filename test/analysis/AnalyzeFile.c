@@ -27,65 +27,42 @@
 #include "AnalyzeFile.h"
 
 #include "AnalysisClipping.h"
-#include "AnalysisDistortion.h"
-#include "AnalysisSilence.h"
+#include "audio/AudioAnalysis.h"
 #include "audio/AudioSettings.h"
 #include "io/SampleSource.h"
 
 #include <stdlib.h>
 
-static LinkedList _getAnalysisFunctions(void) {
-  AnalysisFunctionData data;
-  LinkedList functionsList = newLinkedList();
-
-  data = newAnalysisFunctionData();
-  data->analysisName = "clipping";
-  data->functionPtr = (void *)analysisClipping;
-  data->failTolerance = kAnalysisClippingFailTolerance;
-  linkedListAppend(functionsList, data);
-
-  data = newAnalysisFunctionData();
-  data->analysisName = "distortion";
-  data->functionPtr = (void *)analysisDistortion;
-  linkedListAppend(functionsList, data);
-
-  data = newAnalysisFunctionData();
-  data->analysisName = "silence";
-  data->functionPtr = (void *)analysisSilence;
-  // Use a fail tolerance here of the blocksize * 2 in order to avoid false
-  // positives, which may occur with a partial last block or MIDI tests where
-  // there is some silence expected between the notes.
-  data->failTolerance = (int)getBlocksize() * 2;
-  linkedListAppend(functionsList, data);
-
-  return functionsList;
-}
-
-static void _runAnalysisFunction(void *item, void *userData) {
-  AnalysisFunctionData functionData = (AnalysisFunctionData)item;
-  AnalysisFuncPtr analysisFuncPtr =
-      (AnalysisFuncPtr)(functionData->functionPtr);
-  AnalysisData analysisData = (AnalysisData)userData;
-
-  // If we are on the first block, then set the last sample value to be the same
-  // as
-  // the first sample in the block. Otherwise, checks which use the lastSample
-  // value
-  // (such as the distortion check) will erroneously fail on the first sample.
-  if (*(analysisData->currentFrame) == 0) {
-    for (ChannelCount i = 0; i < analysisData->sampleBuffer->numChannels; ++i) {
-      functionData->lastSample[i] = analysisData->sampleBuffer->samples[i][0];
+static boolByte _checkAnalysis(const AudioAnalysis analysis,
+                               CharString failedAnalysisFunctionName,
+                               ChannelCount *failedAnalysisChannel,
+                               SampleCount *failedAnalysisFrame) {
+  // Use a fail tolerance for silence of the blocksize * 2 in order to avoid
+  // false positives, which may occur with a partial last block or MIDI tests
+  // where there is some silence expected between the notes.
+  const unsigned long silenceTolerance = (unsigned long)getBlocksize() * 2;
+  AudioAnalysisChannel channel;
+
+  for (ChannelCount i = 0; i < analysis->numChannels; ++i) {
+    channel = &(analysis->channels[i]);
+    *failedAnalysisChannel = i;
+
+    if (channel->longestClip > (unsigned long)kAnalysisClippingFailTolerance) {
+      charStringCopyCString(failedAnalysisFunctionName, "clipping");
+      *failedAnalysisFrame = (SampleCount)channel->longestClipStart;
+      return false;
+    } else if (channel->discontinuities > 0) {
+      charStringCopyCString(failedAnalysisFunctionName, "distortion");
+      *failedAnalysisFrame = (SampleCount)channel->firstDiscontinuity;
+      return false;
+    } else if (channel->longestSilence > silenceTolerance) {
+      charStringCopyCString(failedAnalysisFunctionName, "silence");
+      *failedAnalysisFrame = (SampleCount)channel->longestSilenceStart;
+      return false;
     }
   }
 
-  if (!analysisFuncPtr(analysisData->sampleBuffer, functionData)) {
-    charStringCopyCString(analysisData->failedAnalysisFunctionName,
-                          functionData->analysisName);
-    *(analysisData->failedAnalysisFrame) =
-        *(analysisData->currentFrame) + functionData->failedSample;
-    *(analysisData->failedAnalysisChannel) = functionData->failedChannel;
-    *(analysisData->result) = false;
-  }
+  return true;
 }
 
 boolByte analyzeFile(const char *filename,
@@ -95,20 +72,17 @@ boolByte analyzeFile(const char *filename,
   boolByte result;
   CharString analysisFilename;
   SampleSource sampleSource;
-  LinkedList analysisFunctions;
-  AnalysisData analysisData = (AnalysisData)malloc(sizeof(AnalysisDataMembers));
-  SampleCount currentFrame = 0;
+  SampleBuffer sampleBuffer;
+  AudioAnalysis analysis;
 
   // Needed to initialize new sample sources
   initAudioSettings();
-  analysisFunctions = _getAnalysisFunctions();
   analysisFilename = newCharStringWithCString(filename);
 
   sampleSource = sampleSourceFactory(analysisFilename);
 
   if (sampleSource == NULL) {
     freeCharString(analysisFilename);
-    free(analysisData);
     freeAudioSettings();
     return false;
   }
@@ -117,33 +91,29 @@ boolByte analyzeFile(const char *filename,
       sampleSource->openSampleSource(sampleSource, SAMPLE_SOURCE_OPEN_READ);
 
   if (!result) {
-    free(analysisData);
+    freeSampleSource(sampleSource);
+    freeCharString(analysisFilename);
+    freeAudioSettings();
     return result;
   }
 
-  analysisData->failedAnalysisFunctionName = failedAnalysisFunctionName;
-  analysisData->failedAnalysisChannel = failedAnalysisChannel;
-  analysisData->failedAnalysisFrame = failedAnalysisFrame;
-  analysisData->sampleBuffer =
-      newSampleBuffer(getNumChannels(), getBlocksize());
-  analysisData->currentFrame = &currentFrame;
-  analysisData->result = &result;
-
-  while (
-      sampleSource->readSampleBlock(sampleSource, analysisData->sampleBuffer) &&
-      result) {
-    linkedListForeach(analysisFunctions, _runAnalysisFunction, analysisData);
-    currentFrame += getBlocksize();
+  // All checks are made in a single pass over each block, and the file fails
+  // on the first block where any of them do
+  sampleBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  analysis = newAudioAnalysis(getNumChannels());
+
+  while (sampleSource->readSampleBlock(sampleSource, sampleBuffer) && result) {
+    audioAnalysisProcess(analysis, sampleBuffer);
+    result = _checkAnalysis(analysis, failedAnalysisFunctionName,
+                            failedAnalysisChannel, failedAnalysisFrame);
   }
 
   sampleSource->closeSampleSource(sampleSource);
   freeSampleSource(sampleSource);
   freeCharString(analysisFilename);
   freeAudioSettings();
-  freeSampleBuffer(analysisData->sampleBuffer);
-  freeLinkedListAndItems(analysisFunctions,
-                         (LinkedListFreeItemFunc)freeAnalysisFunctionData);
-  free(analysisData);
+  freeSampleBuffer(sampleBuffer);
+  freeAudioAnalysis(analysis);
   return result;
 }
 
@@ -46,17 +46,6 @@ typedef AnalysisFunctionDataMembers *AnalysisFunctionData;
 typedef boolByte (*AnalysisFuncPtr)(const SampleBuffer sampleBuffer,
                                     AnalysisFunctionData data);
 
-typedef struct {
-  CharString failedAnalysisFunctionName;
-  SampleCount *failedAnalysisFrame;
-  ChannelCount *failedAnalysisChannel;
-  SampleCount *currentFrame;
-  boolByte *result;
-  SampleBuffer sampleBuffer;
-  AnalysisFunctionData functionData;
-} AnalysisDataMembers;
-typedef AnalysisDataMembers *AnalysisData;
-
 AnalysisFunctionData newAnalysisFunctionData(void);
 boolByte analyzeFile(const char *filename,
                      CharString failedAnalysisFunctionName,
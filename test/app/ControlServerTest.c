@@ -0,0 +1,102 @@
+//
+// ControlServerTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "app/ControlServer.h"
+
+#include "audio/AudioSettings.h"
+#include "base/Socket.h"
+#include "plugin/PluginGain.h"
+#include "unit/TestRunner.h"
+
+static const char *kControlServerTestPort = "47915";
+
+static boolByte _sendCommand(Socket client, const char *command,
+                             CharString reply) {
+  CharString line = newCharStringWithCString(command);
+  boolByte result = socketWriteLine(client, line) &&
+                    socketReadLine(client, reply);
+  freeCharString(line);
+  return result;
+}
+
+static int _testChangeParameter(void) {
+  CharString address = newCharStringWithCString(kControlServerTestPort);
+  CharString name = newCharStringWithCString(kInternalPluginGainName);
+  CharString reply = newCharStringWithCapacity(kCharStringLengthLong);
+  PluginChain pluginChain = newPluginChain();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  Socket client;
+  SampleCount i;
+
+  assert(pluginChainAppend(pluginChain, newPluginGain(name), NULL));
+  pluginChainPrepareForProcessing(pluginChain);
+  assert(controlServerStart(address, pluginChain));
+  client = newSocketConnected(address);
+  assertNotNull(client);
+
+  assert(_sendCommand(client, "parameter 0 0 0.5", reply));
+  assertCharStringEquals("OK", reply);
+  assert(_sendCommand(client, "status", reply));
+  assertCharStringEquals("OK\t0\t0\t1", reply);
+
+  for (i = 0; i < inBuffer->blocksize; i++) {
+    inBuffer->samples[0][i] = 1.0f;
+  }
+
+  pluginChainProcessAudio(pluginChain, inBuffer, outBuffer);
+  assertDoubleEquals(0.5, outBuffer->samples[0][0], TEST_DEFAULT_TOLERANCE);
+  assert(_sendCommand(client, "status", reply));
+  assertCharStringEquals("OK\t1\t0\t0", reply);
+
+  // Stopping the server must not wait for the client to disconnect
+  controlServerStop();
+  assertFalse(_sendCommand(client, "status", reply));
+
+  freeSocket(client);
+  freePluginChain(pluginChain);
+  freeCharString(address);
+  freeCharString(name);
+  freeCharString(reply);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testStopServerWhenNotRunning(void) {
+  controlServerStop();
+  return 0;
+}
+
+TestSuite addControlServerTests(void);
+TestSuite addControlServerTests(void) {
+  TestSuite testSuite = newTestSuite("ControlServer", NULL, NULL);
+  addTest(testSuite, "ChangeParameter", _testChangeParameter);
+  addTest(testSuite, "StopServerWhenNotRunning",
+          _testStopServerWhenNotRunning);
+  return testSuite;
+}
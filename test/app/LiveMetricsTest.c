@@ -0,0 +1,195 @@
+//
+// LiveMetricsTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "app/LiveMetrics.h"
+
+#include "base/Socket.h"
+#include "unit/TestRunner.h"
+
+#include <string.h>
+
+static const char *kLiveMetricsTestPort = "47914";
+
+static void _liveMetricsTestSetup(void) {
+  liveMetricsReset();
+  liveMetricsSetEnabled(true);
+}
+
+static void _liveMetricsTestTeardown(void) {
+  liveMetricsStopServer();
+  liveMetricsSetEnabled(false);
+  liveMetricsReset();
+}
+
+static boolByte _textContains(const CharString text, const char *expected) {
+  return (boolByte)(strstr(text->data, expected) != NULL);
+}
+
+static int _testRecordNothingWhenDisabled(void) {
+  CharString text = newCharString();
+
+  liveMetricsSetEnabled(false);
+  assertFalse(liveMetricsIsEnabled());
+  liveMetricsRecordBlock(1.0, 10.0);
+  liveMetricsRecordPluginBlock("test_plugin", 1.0);
+  liveMetricsWritePrometheus(text);
+
+  assert(_textContains(text, "mrswatson_blocks_processed_total 0\n"));
+  assertFalse(_textContains(text, "test_plugin"));
+
+  freeCharString(text);
+  return 0;
+}
+
+static int _testRecordBlocks(void) {
+  CharString text = newCharString();
+
+  liveMetricsRecordBlock(0.2, 10.0);
+  liveMetricsRecordBlock(3.0, 10.0);
+  liveMetricsRecordBlock(12.0, 10.0);
+  liveMetricsWritePrometheus(text);
+
+  assert(_textContains(text, "mrswatson_blocks_processed_total 3\n"));
+  assert(_textContains(text, "mrswatson_deadline_misses_total 1\n"));
+  // Buckets are cumulative
+  assert(_textContains(
+      text, "mrswatson_block_duration_seconds_bucket{le=\"0.00025\"} 1\n"));
+  assert(_textContains(
+      text, "mrswatson_block_duration_seconds_bucket{le=\"0.005\"} 2\n"));
+  assert(_textContains(
+      text, "mrswatson_block_duration_seconds_bucket{le=\"0.01\"} 2\n"));
+  assert(_textContains(
+      text, "mrswatson_block_duration_seconds_bucket{le=\"+Inf\"} 3\n"));
+  assert(_textContains(text, "mrswatson_block_duration_seconds_sum 0.0152"));
+  assert(_textContains(text, "mrswatson_block_duration_seconds_count 3\n"));
+
+  freeCharString(text);
+  return 0;
+}
+
+static int _testRecordPluginBlocks(void) {
+  CharString text = newCharString();
+
+  liveMetricsRecordPluginBlock("plugin_a", 1.0);
+  liveMetricsRecordPluginBlock("plugin_a", 1.0);
+  liveMetricsRecordPluginBlock("quoted\"plugin", 1.0);
+  liveMetricsWritePrometheus(text);
+
+  assert(_textContains(text, "mrswatson_plugin_block_duration_seconds_count"
+                             "{plugin=\"plugin_a\"} 2\n"));
+  assert(_textContains(text, "mrswatson_plugin_block_duration_seconds_count"
+                             "{plugin=\"quoted\\\"plugin\"} 1\n"));
+
+  freeCharString(text);
+  return 0;
+}
+
+static int _testQueuedBlocks(void) {
+  CharString text = newCharString();
+
+  liveMetricsAddQueuedBlocks(LIVE_METRICS_QUEUE_PREFETCH, 3);
+  liveMetricsAddQueuedBlocks(LIVE_METRICS_QUEUE_PREFETCH, -1);
+  liveMetricsWritePrometheus(text);
+  assert(
+      _textContains(text, "mrswatson_queued_blocks{queue=\"prefetch\"} 2\n"));
+  assert(_textContains(
+      text, "mrswatson_queued_blocks{queue=\"write_behind\"} 0\n"));
+  assertIntEquals(2, liveMetricsGetQueuedBlocks(LIVE_METRICS_QUEUE_PREFETCH));
+
+  liveMetricsAddQueuedBlocks(LIVE_METRICS_QUEUE_PREFETCH, -2);
+  freeCharString(text);
+  return 0;
+}
+
+static int _testRecordJobs(void) {
+  CharString text = newCharString();
+
+  liveMetricsRecordJob(true);
+  liveMetricsRecordJob(true);
+  liveMetricsRecordJob(false);
+  liveMetricsWritePrometheus(text);
+  assert(_textContains(text, "mrswatson_jobs_total{result=\"success\"} 2\n"));
+  assert(_textContains(text, "mrswatson_jobs_total{result=\"failure\"} 1\n"));
+
+  freeCharString(text);
+  return 0;
+}
+
+static int _testServeMetrics(void) {
+  CharString address = newCharStringWithCString(kLiveMetricsTestPort);
+  CharString request = newCharStringWithCString("GET /metrics HTTP/1.0\r\n");
+  CharString line = newCharStringWithCapacity(kCharStringLengthLong);
+  CharString response = newCharString();
+  Socket client;
+
+  liveMetricsSetEnabled(false);
+  assert(liveMetricsStartServer(address));
+  assert(liveMetricsIsEnabled());
+  liveMetricsRecordBlock(1.0, 10.0);
+
+  client = newSocketConnected(address);
+  assertNotNull(client);
+  assert(socketWriteLine(client, request));
+  charStringClear(request);
+  assert(socketWriteLine(client, request));
+
+  // The server closes the connection after the reply
+  while (socketReadLine(client, line)) {
+    charStringAppend(response, line);
+    charStringAppendCString(response, "\n");
+  }
+
+  assert(_textContains(response, "HTTP/1.0 200 OK\n"));
+  assert(_textContains(response, "mrswatson_blocks_processed_total 1\n"));
+
+  freeSocket(client);
+  liveMetricsStopServer();
+  freeCharString(address);
+  freeCharString(request);
+  freeCharString(line);
+  freeCharString(response);
+  return 0;
+}
+
+static int _testStopServerWhenNotRunning(void) {
+  liveMetricsStopServer();
+  return 0;
+}
+
+TestSuite addLiveMetricsTests(void);
+TestSuite addLiveMetricsTests(void) {
+  TestSuite testSuite = newTestSuite("LiveMetrics", _liveMetricsTestSetup,
+                                     _liveMetricsTestTeardown);
+  addTest(testSuite, "RecordNothingWhenDisabled",
+          _testRecordNothingWhenDisabled);
+  addTest(testSuite, "RecordBlocks", _testRecordBlocks);
+  addTest(testSuite, "RecordPluginBlocks", _testRecordPluginBlocks);
+  addTest(testSuite, "QueuedBlocks", _testQueuedBlocks);
+  addTest(testSuite, "RecordJobs", _testRecordJobs);
+  addTest(testSuite, "ServeMetrics", _testServeMetrics);
+  addTest(testSuite, "StopServerWhenNotRunning",
+          _testStopServerWhenNotRunning);
+  return testSuite;
+}
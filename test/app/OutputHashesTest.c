@@ -0,0 +1,286 @@
+//
+// OutputHashesTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "app/OutputHashes.h"
+
+#include "audio/AudioSettings.h"
+#include "base/File.h"
+#include "io/SampleSourceHasher.h"
+#include "io/SampleSourceMemory.h"
+#include "unit/TestRunner.h"
+
+#include <stdio.h>
+
+#define TEST_HASHES_FILENAME "mrswatsontest-output-hashes.txt"
+
+static const SampleCount kOutputHashesTestBlocksize = 64;
+// Long enough for several blocks and a partial block at the end
+static const SampleCount kOutputHashesTestNumFrames = 64 * 10 + 17;
+
+static void _removeTestFile(const char *filename) {
+  File file = newFileWithPathCString(filename);
+
+  if (fileExists(file)) {
+    fileRemove(file);
+  }
+
+  freeFile(file);
+}
+
+static void _outputHashesSetup(void) {
+  initAudioSettings();
+  setNumChannels(2);
+  setBlocksize(kOutputHashesTestBlocksize);
+}
+
+static void _outputHashesTeardown(void) {
+  _removeTestFile(TEST_HASHES_FILENAME);
+  sampleSourceMemoryRemoveAll();
+  freeAudioSettings();
+}
+
+static Sample _getTestSample(SampleCount frame, ChannelCount channel) {
+  return (Sample)((frame * 3 + channel * 11) % 97) / 200.0f;
+}
+
+static SampleSource _newHashedOutput(const char *name, OutputHashes hashes,
+                                     unsigned long startFrame) {
+  CharString sourceName = newCharStringWithCString(name);
+  SampleSource output = sampleSourceFactory(sourceName);
+  freeCharString(sourceName);
+
+  if (!output->openSampleSource(output, SAMPLE_SOURCE_OPEN_WRITE)) {
+    freeSampleSource(output);
+    return NULL;
+  }
+
+  return newSampleSourceHasher(output, hashes, startFrame);
+}
+
+// Write frames [startFrame, endFrame) of the test signal in pieces of
+// writeSize frames, and close the output
+static boolByte _writeTestSignal(SampleSource output, SampleCount startFrame,
+                                 SampleCount endFrame, SampleCount writeSize) {
+  SampleBuffer buffer = newSampleBuffer(getNumChannels(), writeSize);
+  SampleCount frame = startFrame;
+  boolByte result = true;
+  ChannelCount c;
+  SampleCount i;
+
+  while (result && frame < endFrame) {
+    buffer->blocksize =
+        endFrame - frame < writeSize ? endFrame - frame : writeSize;
+
+    for (c = 0; c < buffer->numChannels; c++) {
+      for (i = 0; i < buffer->blocksize; i++) {
+        buffer->samples[c][i] = _getTestSample(frame + i, c);
+      }
+    }
+
+    result = output->writeSampleBlock(output, buffer);
+    frame += buffer->blocksize;
+  }
+
+  output->closeSampleSource(output);
+  freeSampleBuffer(buffer);
+  return result;
+}
+
+static OutputHashes _hashTestSignal(const char *name, SampleCount writeSize) {
+  OutputHashes hashes =
+      newOutputHashes(kOutputHashesTestBlocksize, getNumChannels());
+  SampleSource output = _newHashedOutput(name, hashes, 0);
+
+  if (output == NULL ||
+      !_writeTestSignal(output, 0, kOutputHashesTestNumFrames, writeSize)) {
+    freeSampleSource(output);
+    freeOutputHashes(hashes);
+    return NULL;
+  }
+
+  freeSampleSource(output);
+  return hashes;
+}
+
+static int _testHashesDoNotDependOnWriteSize(void) {
+  OutputHashes blockHashes =
+      _hashTestSignal("mem://blocks", kOutputHashesTestBlocksize);
+  OutputHashes oddHashes = _hashTestSignal("mem://odd", 23);
+  assertNotNull(blockHashes);
+  assertNotNull(oddHashes);
+
+  assertUnsignedLongEquals(11ul, (unsigned long)blockHashes->numBlocks);
+  assertUnsignedLongEquals((unsigned long)kOutputHashesTestNumFrames,
+                           blockHashes->numFrames);
+  assert(outputHashesFindFirstDifference(blockHashes, oddHashes) ==
+         OUTPUT_HASHES_NO_DIFFERENCE);
+  assert(outputHashesGetFileHash(blockHashes) ==
+         outputHashesGetFileHash(oddHashes));
+
+  freeOutputHashes(blockHashes);
+  freeOutputHashes(oddHashes);
+  return 0;
+}
+
+static int _testSegmentsMatchSerialRender(void) {
+  const unsigned long splitFrame = kOutputHashesTestBlocksize * 4;
+  OutputHashes serialHashes = _hashTestSignal("mem://serial", 100);
+  OutputHashes segmentHashes =
+      newOutputHashes(kOutputHashesTestBlocksize, getNumChannels());
+  SampleSource first = _newHashedOutput("mem://first", segmentHashes, 0);
+  SampleSource second =
+      _newHashedOutput("mem://second", segmentHashes, splitFrame);
+  assertNotNull(serialHashes);
+  assertNotNull(first);
+  assertNotNull(second);
+
+  // The later segment finishes first
+  assert(_writeTestSignal(second, splitFrame, kOutputHashesTestNumFrames, 30));
+  assert(_writeTestSignal(first, 0, splitFrame, 50));
+
+  assert(outputHashesFindFirstDifference(serialHashes, segmentHashes) ==
+         OUTPUT_HASHES_NO_DIFFERENCE);
+  assert(outputHashesGetFileHash(serialHashes) ==
+         outputHashesGetFileHash(segmentHashes));
+
+  freeSampleSource(first);
+  freeSampleSource(second);
+  freeOutputHashes(serialHashes);
+  freeOutputHashes(segmentHashes);
+  return 0;
+}
+
+static int _testRejectSegmentNotOnBlockBoundary(void) {
+  OutputHashes hashes =
+      newOutputHashes(kOutputHashesTestBlocksize, getNumChannels());
+  CharString sourceName = newCharStringWithCString("mem://unaligned");
+  SampleSource output = sampleSourceFactory(sourceName);
+  assert(output->openSampleSource(output, SAMPLE_SOURCE_OPEN_WRITE));
+
+  assertIsNull(newSampleSourceHasher(output, hashes, 10));
+
+  output->closeSampleSource(output);
+  freeSampleSource(output);
+  freeCharString(sourceName);
+  freeOutputHashes(hashes);
+  return 0;
+}
+
+static int _testFindFirstDifference(void) {
+  OutputHashes hashes = newOutputHashes(kOutputHashesTestBlocksize, 2);
+  OutputHashes other = newOutputHashes(kOutputHashesTestBlocksize, 2);
+  size_t i;
+
+  for (i = 0; i < 5; i++) {
+    outputHashesSetBlock(hashes, i, 100 + i, kOutputHashesTestBlocksize);
+    outputHashesSetBlock(other, i, 100 + i, kOutputHashesTestBlocksize);
+  }
+
+  assert(outputHashesFindFirstDifference(hashes, other) ==
+         OUTPUT_HASHES_NO_DIFFERENCE);
+
+  outputHashesSetBlock(other, 3, 1, kOutputHashesTestBlocksize);
+  assertUnsignedLongEquals(3ul, (unsigned long)outputHashesFindFirstDifference(
+                                    hashes, other));
+
+  // A longer output differs where the shorter one ends
+  outputHashesSetBlock(other, 3, 103, kOutputHashesTestBlocksize);
+  outputHashesSetBlock(other, 5, 105, kOutputHashesTestBlocksize);
+  assertUnsignedLongEquals(5ul, (unsigned long)outputHashesFindFirstDifference(
+                                    hashes, other));
+
+  freeOutputHashes(hashes);
+  freeOutputHashes(other);
+  return 0;
+}
+
+static int _testWriteAndReadFile(void) {
+  OutputHashes hashes = _hashTestSignal("mem://file", 40);
+  CharString filename = newCharStringWithCString(TEST_HASHES_FILENAME);
+  OutputHashes readHashes;
+  assertNotNull(hashes);
+
+  assert(outputHashesWrite(hashes, filename));
+  readHashes = newOutputHashesFromFile(filename);
+  assertNotNull(readHashes);
+
+  assertUnsignedLongEquals(kOutputHashesTestBlocksize, readHashes->blocksize);
+  assertIntEquals(2, readHashes->numChannels);
+  assertUnsignedLongEquals(hashes->numFrames, readHashes->numFrames);
+  assertUnsignedLongEquals((unsigned long)hashes->numBlocks,
+                           (unsigned long)readHashes->numBlocks);
+  assert(outputHashesFindFirstDifference(hashes, readHashes) ==
+         OUTPUT_HASHES_NO_DIFFERENCE);
+
+  freeOutputHashes(hashes);
+  freeOutputHashes(readHashes);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testRejectDamagedFile(void) {
+  CharString filename = newCharStringWithCString(TEST_HASHES_FILENAME);
+  OutputHashes hashes = newOutputHashes(kOutputHashesTestBlocksize, 1);
+  FILE *fp;
+
+  outputHashesSetBlock(hashes, 0, 0x1234ull, kOutputHashesTestBlocksize);
+  assert(outputHashesWrite(hashes, filename));
+
+  // Add a block which the file hash does not cover
+  fp = fopen(TEST_HASHES_FILENAME, "a");
+  assertNotNull(fp);
+  fprintf(fp, "%016llx\n", 0x5678ull);
+  fclose(fp);
+
+  assertIsNull(newOutputHashesFromFile(filename));
+
+  freeOutputHashes(hashes);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testReadMissingFile(void) {
+  CharString filename = newCharStringWithCString("invalid");
+  assertIsNull(newOutputHashesFromFile(filename));
+  freeCharString(filename);
+  return 0;
+}
+
+TestSuite addOutputHashesTests(void);
+TestSuite addOutputHashesTests(void) {
+  TestSuite testSuite = newTestSuite("OutputHashes", _outputHashesSetup,
+                                     _outputHashesTeardown);
+  addTest(testSuite, "HashesDoNotDependOnWriteSize",
+          _testHashesDoNotDependOnWriteSize);
+  addTest(testSuite, "SegmentsMatchSerialRender",
+          _testSegmentsMatchSerialRender);
+  addTest(testSuite, "RejectSegmentNotOnBlockBoundary",
+          _testRejectSegmentNotOnBlockBoundary);
+  addTest(testSuite, "FindFirstDifference", _testFindFirstDifference);
+  addTest(testSuite, "WriteAndReadFile", _testWriteAndReadFile);
+  addTest(testSuite, "RejectDamagedFile", _testRejectDamagedFile);
+  addTest(testSuite, "ReadMissingFile", _testReadMissingFile);
+  return testSuite;
+}
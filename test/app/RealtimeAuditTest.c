@@ -0,0 +1,154 @@
+//
+// RealtimeAuditTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "app/RealtimeAudit.h"
+
+#include "unit/TestRunner.h"
+
+#include <stdlib.h>
+
+static const char *kRealtimeAuditTestPluginName = "test_plugin";
+
+// Keeps the compiler from optimizing away the allocation in the test below
+static void *volatile _realtimeAuditTestAllocation = NULL;
+
+static void _realtimeAuditTestSetup(void) {
+  realtimeAuditReset();
+  realtimeAuditSetEnabled(true);
+}
+
+static void _realtimeAuditTestTeardown(void) {
+  realtimeAuditSetEnabled(false);
+  realtimeAuditReset();
+}
+
+static int _testRecordOutsideSection(void) {
+  realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "test");
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, realtimeAuditGetNumViolations());
+  return 0;
+}
+
+static int _testRecordWhenDisabled(void) {
+  realtimeAuditSetEnabled(false);
+  realtimeAuditBegin();
+  realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "test");
+  realtimeAuditEnd();
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, realtimeAuditGetNumViolations());
+  return 0;
+}
+
+static int _testRecordForHost(void) {
+  realtimeAuditBegin();
+  realtimeAuditRecordViolation(REALTIME_VIOLATION_LOCK, "test");
+  realtimeAuditRecordViolation(REALTIME_VIOLATION_LOCK, "test");
+  realtimeAuditEnd();
+  assertUnsignedLongEquals(2ul, realtimeAuditGetNumViolations());
+  assertUnsignedLongEquals(
+      2ul, realtimeAuditGetNumViolationsForOwner(NULL, REALTIME_VIOLATION_LOCK));
+  assertUnsignedLongEquals(
+      ZERO_UNSIGNED_LONG,
+      realtimeAuditGetNumViolationsForOwner(NULL, REALTIME_VIOLATION_IO));
+  return 0;
+}
+
+static int _testRecordForPlugin(void) {
+  realtimeAuditBegin();
+  realtimeAuditEnterPlugin(kRealtimeAuditTestPluginName);
+  realtimeAuditRecordViolation(REALTIME_VIOLATION_ALLOCATION, "test");
+  realtimeAuditExitPlugin();
+  realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "test");
+  realtimeAuditEnd();
+
+  assertUnsignedLongEquals(
+      1ul, realtimeAuditGetNumViolationsForOwner(kRealtimeAuditTestPluginName,
+                                                 REALTIME_VIOLATION_ALLOCATION));
+  assertUnsignedLongEquals(
+      ZERO_UNSIGNED_LONG,
+      realtimeAuditGetNumViolationsForOwner(NULL,
+                                            REALTIME_VIOLATION_ALLOCATION));
+  assertUnsignedLongEquals(
+      1ul, realtimeAuditGetNumViolationsForOwner(NULL, REALTIME_VIOLATION_IO));
+  return 0;
+}
+
+static int _testEnterPluginStartsSection(void) {
+  // Pipelined plugins are processed on their own threads, outside of the
+  // section started by the plugin chain
+  realtimeAuditEnterPlugin(kRealtimeAuditTestPluginName);
+  realtimeAuditRecordViolation(REALTIME_VIOLATION_LOCK, "test");
+  realtimeAuditExitPlugin();
+  realtimeAuditRecordViolation(REALTIME_VIOLATION_LOCK, "test");
+
+  assertUnsignedLongEquals(1ul, realtimeAuditGetNumViolations());
+  assertUnsignedLongEquals(
+      1ul, realtimeAuditGetNumViolationsForOwner(kRealtimeAuditTestPluginName,
+                                                 REALTIME_VIOLATION_LOCK));
+  return 0;
+}
+
+static int _testDetectMalloc(void) {
+  if (!realtimeAuditIsSupported()) {
+    return -1;
+  }
+
+  realtimeAuditEnterPlugin(kRealtimeAuditTestPluginName);
+  _realtimeAuditTestAllocation = malloc(16);
+  free(_realtimeAuditTestAllocation);
+  realtimeAuditExitPlugin();
+
+  assertUnsignedLongEquals(
+      2ul, realtimeAuditGetNumViolationsForOwner(kRealtimeAuditTestPluginName,
+                                                 REALTIME_VIOLATION_ALLOCATION));
+  return 0;
+}
+
+static int _testReset(void) {
+  realtimeAuditEnterPlugin(kRealtimeAuditTestPluginName);
+  realtimeAuditRecordViolation(REALTIME_VIOLATION_IO, "test");
+  realtimeAuditExitPlugin();
+  realtimeAuditReset();
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, realtimeAuditGetNumViolations());
+  assertUnsignedLongEquals(
+      ZERO_UNSIGNED_LONG,
+      realtimeAuditGetNumViolationsForOwner(kRealtimeAuditTestPluginName,
+                                            REALTIME_VIOLATION_IO));
+  return 0;
+}
+
+TestSuite addRealtimeAuditTests(void);
+TestSuite addRealtimeAuditTests(void) {
+  TestSuite testSuite = newTestSuite("RealtimeAudit", _realtimeAuditTestSetup,
+                                     _realtimeAuditTestTeardown);
+  addTest(testSuite, "RecordOutsideSection", _testRecordOutsideSection);
+  addTest(testSuite, "RecordWhenDisabled", _testRecordWhenDisabled);
+  addTest(testSuite, "RecordForHost", _testRecordForHost);
+  addTest(testSuite, "RecordForPlugin", _testRecordForPlugin);
+  addTest(testSuite, "EnterPluginStartsSection",
+          _testEnterPluginStartsSection);
+  addTest(testSuite, "DetectMalloc", _testDetectMalloc);
+  addTest(testSuite, "Reset", _testReset);
+  return testSuite;
+}
@@ -0,0 +1,251 @@
+//
+// RenderCacheTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "app/RenderCache.h"
+
+#include "base/File.h"
+#include "unit/TestRunner.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_CACHE_DIRECTORY "mrswatsontest-render-cache"
+#define TEST_INPUT_FILENAME "mrswatsontest-render-cache-in.txt"
+#define TEST_OTHER_INPUT_FILENAME "mrswatsontest-render-cache-other.txt"
+#define TEST_OUTPUT_FILENAME "mrswatsontest-render-cache-out.wav"
+
+static void _removeTestFile(const char *filename) {
+  File file = newFileWithPathCString(filename);
+
+  if (fileExists(file)) {
+    fileRemove(file);
+  }
+
+  freeFile(file);
+}
+
+static void _renderCacheTestTeardown(void) {
+  freeRenderCache();
+  _removeTestFile(TEST_CACHE_DIRECTORY);
+  _removeTestFile(TEST_INPUT_FILENAME);
+  _removeTestFile(TEST_OTHER_INPUT_FILENAME);
+  _removeTestFile(TEST_OUTPUT_FILENAME);
+}
+
+static boolByte _writeTextFile(const char *filename, const char *contents) {
+  FILE *file = fopen(filename, "w");
+
+  if (file == NULL) {
+    return false;
+  }
+
+  fputs(contents, file);
+  fclose(file);
+  return true;
+}
+
+static boolByte _textFileEquals(const char *filename, const char *contents) {
+  char buffer[64];
+  FILE *file = fopen(filename, "r");
+  size_t numBytes;
+
+  if (file == NULL) {
+    return false;
+  }
+
+  numBytes = fread(buffer, 1, sizeof(buffer) - 1, file);
+  buffer[numBytes] = '\0';
+  fclose(file);
+  return (boolByte)(strcmp(buffer, contents) == 0);
+}
+
+static boolByte _keysAreEqual(const RenderCacheKey a, const RenderCacheKey b) {
+  CharString aString = renderCacheKeyToString(a);
+  CharString bString = renderCacheKeyToString(b);
+  boolByte result = charStringIsEqualTo(aString, bString, false);
+
+  freeCharString(aString);
+  freeCharString(bString);
+  return result;
+}
+
+static int _testKeyToString(void) {
+  RenderCacheKey k = newRenderCacheKey();
+  CharString keyString;
+
+  renderCacheKeyAddString(k, "mrs_gain");
+  keyString = renderCacheKeyToString(k);
+  assertSizeEquals((size_t)32, strlen(keyString->data));
+  assertSizeEquals((size_t)32, strspn(keyString->data, "0123456789abcdef"));
+  freeCharString(keyString);
+  freeRenderCacheKey(k);
+  return 0;
+}
+
+static int _testSamePartsGiveSameKey(void) {
+  RenderCacheKey a = newRenderCacheKey();
+  RenderCacheKey b = newRenderCacheKey();
+
+  renderCacheKeyAddString(a, "mrs_gain");
+  renderCacheKeyAddNumber(a, 44100.0);
+  renderCacheKeyAddString(b, "mrs_gain");
+  renderCacheKeyAddNumber(b, 44100.0);
+  assert(_keysAreEqual(a, b));
+
+  freeRenderCacheKey(a);
+  freeRenderCacheKey(b);
+  return 0;
+}
+
+static int _testDifferentPartsGiveDifferentKeys(void) {
+  RenderCacheKey a = newRenderCacheKey();
+  RenderCacheKey b = newRenderCacheKey();
+  RenderCacheKey c = newRenderCacheKey();
+
+  renderCacheKeyAddNumber(a, 44100.0);
+  renderCacheKeyAddNumber(b, 48000.0);
+  assertFalse(_keysAreEqual(a, b));
+
+  renderCacheKeyAddString(b, "ab");
+  renderCacheKeyAddString(b, "c");
+  renderCacheKeyAddString(c, "a");
+  renderCacheKeyAddString(c, "bc");
+  assertFalse(_keysAreEqual(b, c));
+
+  freeRenderCacheKey(a);
+  freeRenderCacheKey(b);
+  freeRenderCacheKey(c);
+  return 0;
+}
+
+static int _testAddFileUsesContents(void) {
+  RenderCacheKey a = newRenderCacheKey();
+  RenderCacheKey b = newRenderCacheKey();
+  CharString input = newCharStringWithCString(TEST_INPUT_FILENAME);
+  CharString otherInput = newCharStringWithCString(TEST_OTHER_INPUT_FILENAME);
+
+  assert(_writeTextFile(TEST_INPUT_FILENAME, "same contents"));
+  assert(_writeTextFile(TEST_OTHER_INPUT_FILENAME, "same contents"));
+  assert(renderCacheKeyAddFile(a, input));
+  assert(renderCacheKeyAddFile(b, otherInput));
+  assert(_keysAreEqual(a, b));
+
+  assert(_writeTextFile(TEST_OTHER_INPUT_FILENAME, "other contents"));
+  assert(renderCacheKeyAddFile(a, input));
+  assert(renderCacheKeyAddFile(b, otherInput));
+  assertFalse(_keysAreEqual(a, b));
+
+  freeRenderCacheKey(a);
+  freeRenderCacheKey(b);
+  freeCharString(input);
+  freeCharString(otherInput);
+  return 0;
+}
+
+static int _testAddMissingFile(void) {
+  RenderCacheKey k = newRenderCacheKey();
+  CharString input = newCharStringWithCString("invalid");
+
+  assertFalse(renderCacheKeyAddFile(k, input));
+  freeRenderCacheKey(k);
+  freeCharString(input);
+  return 0;
+}
+
+static int _testFetchWithoutCache(void) {
+  RenderCacheKey k = newRenderCacheKey();
+  CharString output = newCharStringWithCString(TEST_OUTPUT_FILENAME);
+
+  assertFalse(renderCacheIsEnabled());
+  assertFalse(renderCacheFetch(k, output));
+  assertFalse(renderCacheStore(k, output));
+  freeRenderCacheKey(k);
+  freeCharString(output);
+  return 0;
+}
+
+static int _testFetchMissingEntry(void) {
+  RenderCacheKey k = newRenderCacheKey();
+  CharString directory = newCharStringWithCString(TEST_CACHE_DIRECTORY);
+  CharString output = newCharStringWithCString(TEST_OUTPUT_FILENAME);
+
+  assert(initRenderCache(directory));
+  assert(renderCacheIsEnabled());
+  assertFalse(renderCacheFetch(k, output));
+  freeRenderCacheKey(k);
+  freeCharString(directory);
+  freeCharString(output);
+  return 0;
+}
+
+static int _testStoreAndFetch(void) {
+  RenderCacheKey k = newRenderCacheKey();
+  CharString directory = newCharStringWithCString(TEST_CACHE_DIRECTORY);
+  CharString output = newCharStringWithCString(TEST_OUTPUT_FILENAME);
+
+  renderCacheKeyAddString(k, "mrs_gain");
+  assert(initRenderCache(directory));
+  assert(_writeTextFile(TEST_OUTPUT_FILENAME, "rendered"));
+  assert(renderCacheStore(k, output));
+
+  // The stale output must be replaced by the cached one
+  assert(_writeTextFile(TEST_OUTPUT_FILENAME, "stale"));
+  assert(renderCacheFetch(k, output));
+  assert(_textFileEquals(TEST_OUTPUT_FILENAME, "rendered"));
+
+  // A new render must not write through a link into the cache
+  renderCachePrepareOutput(output);
+  assert(_writeTextFile(TEST_OUTPUT_FILENAME, "changed"));
+  assert(renderCacheFetch(k, output));
+  assert(_textFileEquals(TEST_OUTPUT_FILENAME, "rendered"));
+
+  freeRenderCacheKey(k);
+  freeCharString(directory);
+  freeCharString(output);
+  return 0;
+}
+
+static int _testFreeNullRenderCacheKey(void) {
+  freeRenderCacheKey(NULL);
+  return 0;
+}
+
+TestSuite addRenderCacheTests(void);
+TestSuite addRenderCacheTests(void) {
+  TestSuite testSuite =
+      newTestSuite("RenderCache", NULL, _renderCacheTestTeardown);
+  addTest(testSuite, "KeyToString", _testKeyToString);
+  addTest(testSuite, "SamePartsGiveSameKey", _testSamePartsGiveSameKey);
+  addTest(testSuite, "DifferentPartsGiveDifferentKeys",
+          _testDifferentPartsGiveDifferentKeys);
+  addTest(testSuite, "AddFileUsesContents", _testAddFileUsesContents);
+  addTest(testSuite, "AddMissingFile", _testAddMissingFile);
+  addTest(testSuite, "FetchWithoutCache", _testFetchWithoutCache);
+  addTest(testSuite, "FetchMissingEntry", _testFetchMissingEntry);
+  addTest(testSuite, "StoreAndFetch", _testStoreAndFetch);
+  addTest(testSuite, "FreeNullRenderCacheKey", _testFreeNullRenderCacheKey);
+  return testSuite;
+}
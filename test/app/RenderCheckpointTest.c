@@ -0,0 +1,225 @@
+//
+// RenderCheckpointTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "app/RenderCheckpoint.h"
+
+#include "base/File.h"
+#include "unit/TestRunner.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_CHECKPOINT_FILENAME "mrswatsontest-out.wav.checkpoint"
+
+static void _renderCheckpointTestTeardown(void) {
+  CharString checkpointPath =
+      newCharStringWithCString(TEST_CHECKPOINT_FILENAME);
+  File checkpointFile = newFileWithPath(checkpointPath);
+
+  if (fileExists(checkpointFile)) {
+    fileRemove(checkpointFile);
+  }
+
+  freeCharString(checkpointPath);
+  freeFile(checkpointFile);
+}
+
+static boolByte _writeTextFile(const char *filename, const char *contents) {
+  FILE *file = fopen(filename, "w");
+
+  if (file == NULL) {
+    return false;
+  }
+
+  fputs(contents, file);
+  fclose(file);
+  return true;
+}
+
+static int _testNewRenderCheckpoint(void) {
+  RenderCheckpoint c = newRenderCheckpoint();
+  assertNotNull(c);
+  assert(charStringIsEmpty(c->inputSource));
+  assert(charStringIsEmpty(c->outputSource));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, c->inputFrame);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, c->outputFrame);
+  assertIntEquals(0, linkedListLength(c->pluginStates));
+  freeRenderCheckpoint(c);
+  return 0;
+}
+
+static int _testGetFilename(void) {
+  CharString output = newCharStringWithCString("mrswatsontest-out.wav");
+  CharString filename = renderCheckpointGetFilename(output);
+  assertCharStringEquals(TEST_CHECKPOINT_FILENAME, filename);
+  freeCharString(output);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testSetPluginStateReplacesState(void) {
+  RenderCheckpoint c = newRenderCheckpoint();
+  const byte first[] = {1, 2, 3};
+  const byte second[] = {4, 5};
+  RenderCheckpointPluginState pluginState;
+
+  renderCheckpointSetPluginState(c, 1, first, sizeof(first));
+  renderCheckpointSetPluginState(c, 1, second, sizeof(second));
+  assertIntEquals(1, linkedListLength(c->pluginStates));
+  pluginState = (RenderCheckpointPluginState)c->pluginStates->item;
+  assertSizeEquals(sizeof(second), pluginState->dataSize);
+  assertIntEquals(0, memcmp(second, pluginState->data, sizeof(second)));
+  freeRenderCheckpoint(c);
+  return 0;
+}
+
+static int _testWriteAndReadCheckpoint(void) {
+  RenderCheckpoint c = newRenderCheckpoint();
+  RenderCheckpoint result = newRenderCheckpoint();
+  CharString filename = newCharStringWithCString(TEST_CHECKPOINT_FILENAME);
+  const byte state[] = {0x00, 0x7f, 0x80, 0xff, 0x3c};
+  RenderCheckpointPluginState pluginState;
+
+  charStringCopyCString(c->inputSource, "in.wav");
+  charStringCopyCString(c->outputSource, "out.wav");
+  c->inputFrame = 44100;
+  c->outputFrame = 22050;
+  c->outputOffset = 88244;
+  c->clockFrame = 23074;
+  renderCheckpointSetPluginState(c, 2, state, sizeof(state));
+
+  assert(renderCheckpointWrite(c, filename));
+  assert(renderCheckpointRead(result, filename));
+  assertCharStringEquals("in.wav", result->inputSource);
+  assertCharStringEquals("out.wav", result->outputSource);
+  assertUnsignedLongEquals(44100ul, result->inputFrame);
+  assertUnsignedLongEquals(22050ul, result->outputFrame);
+  assertUnsignedLongEquals(88244ul, result->outputOffset);
+  assertUnsignedLongEquals(23074ul, result->clockFrame);
+  assertIntEquals(1, linkedListLength(result->pluginStates));
+  pluginState = (RenderCheckpointPluginState)result->pluginStates->item;
+  assertIntEquals(2, pluginState->index);
+  assertSizeEquals(sizeof(state), pluginState->dataSize);
+  assertIntEquals(0, memcmp(state, pluginState->data, sizeof(state)));
+
+  freeRenderCheckpoint(c);
+  freeRenderCheckpoint(result);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testReadCheckpointWithLongPluginState(void) {
+  RenderCheckpoint c = newRenderCheckpoint();
+  RenderCheckpoint result = newRenderCheckpoint();
+  CharString filename = newCharStringWithCString(TEST_CHECKPOINT_FILENAME);
+  byte state[4096];
+  RenderCheckpointPluginState pluginState;
+  size_t i;
+
+  for (i = 0; i < sizeof(state); i++) {
+    state[i] = (byte)(i * 7);
+  }
+
+  renderCheckpointSetPluginState(c, 0, state, sizeof(state));
+  assert(renderCheckpointWrite(c, filename));
+  assert(renderCheckpointRead(result, filename));
+  pluginState = (RenderCheckpointPluginState)result->pluginStates->item;
+  assertSizeEquals(sizeof(state), pluginState->dataSize);
+  assertIntEquals(0, memcmp(state, pluginState->data, sizeof(state)));
+
+  freeRenderCheckpoint(c);
+  freeRenderCheckpoint(result);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testReadMissingCheckpoint(void) {
+  RenderCheckpoint c = newRenderCheckpoint();
+  CharString filename = newCharStringWithCString(TEST_CHECKPOINT_FILENAME);
+  assertFalse(renderCheckpointRead(c, filename));
+  freeRenderCheckpoint(c);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testReadInvalidCheckpoint(void) {
+  RenderCheckpoint c = newRenderCheckpoint();
+  CharString filename = newCharStringWithCString(TEST_CHECKPOINT_FILENAME);
+
+  assert(_writeTextFile(TEST_CHECKPOINT_FILENAME, "input=in.wav\n"));
+  assertFalse(renderCheckpointRead(c, filename));
+  assert(_writeTextFile(TEST_CHECKPOINT_FILENAME,
+                        "MrsWatson checkpoint 1\ninput-frame=-1\n"));
+  assertFalse(renderCheckpointRead(c, filename));
+  assert(_writeTextFile(TEST_CHECKPOINT_FILENAME,
+                        "MrsWatson checkpoint 1\nplugin-state=0,abc\n"));
+  assertFalse(renderCheckpointRead(c, filename));
+  assert(_writeTextFile(TEST_CHECKPOINT_FILENAME,
+                        "MrsWatson checkpoint 1\nplugin-state=0,zz\n"));
+  assertFalse(renderCheckpointRead(c, filename));
+
+  freeRenderCheckpoint(c);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testReadCheckpointWithUnknownKey(void) {
+  RenderCheckpoint c = newRenderCheckpoint();
+  CharString filename = newCharStringWithCString(TEST_CHECKPOINT_FILENAME);
+
+  assert(_writeTextFile(TEST_CHECKPOINT_FILENAME,
+                        "MrsWatson checkpoint 1\nfuture=1\noutput-frame=5\n"));
+  assert(renderCheckpointRead(c, filename));
+  assertUnsignedLongEquals(5ul, c->outputFrame);
+
+  freeRenderCheckpoint(c);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testFreeNullRenderCheckpoint(void) {
+  freeRenderCheckpoint(NULL);
+  return 0;
+}
+
+TestSuite addRenderCheckpointTests(void);
+TestSuite addRenderCheckpointTests(void) {
+  TestSuite testSuite = newTestSuite("RenderCheckpoint", NULL,
+                                     _renderCheckpointTestTeardown);
+  addTest(testSuite, "NewRenderCheckpoint", _testNewRenderCheckpoint);
+  addTest(testSuite, "GetFilename", _testGetFilename);
+  addTest(testSuite, "SetPluginStateReplacesState",
+          _testSetPluginStateReplacesState);
+  addTest(testSuite, "WriteAndReadCheckpoint", _testWriteAndReadCheckpoint);
+  addTest(testSuite, "ReadCheckpointWithLongPluginState",
+          _testReadCheckpointWithLongPluginState);
+  addTest(testSuite, "ReadMissingCheckpoint", _testReadMissingCheckpoint);
+  addTest(testSuite, "ReadInvalidCheckpoint", _testReadInvalidCheckpoint);
+  addTest(testSuite, "ReadCheckpointWithUnknownKey",
+          _testReadCheckpointWithUnknownKey);
+  addTest(testSuite, "FreeNullRenderCheckpoint", _testFreeNullRenderCheckpoint);
+  return testSuite;
+}
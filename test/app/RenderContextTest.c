@@ -0,0 +1,190 @@
+//
+// RenderContextTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+#include "app/RenderContext.h"
+
+#include "base/Thread.h"
+#include "unit/TestRunner.h"
+
+// The global audio clock is created by the test runner for each suite
+static void _renderContextTestSetup(void) {
+  initAudioSettings();
+  initPluginChain();
+}
+
+static void _renderContextTestTeardown(void) {
+  renderContextMakeCurrent(NULL);
+  freePluginChain(getPluginChain());
+  freeAudioSettings();
+}
+
+static int _testNewRenderContext(void) {
+  RenderContext r = newRenderContext();
+  assertNotNull(r);
+  assertNotNull(r->audioSettings);
+  assertNotNull(r->audioClock);
+  assertNotNull(r->pluginChain);
+  assertIntEquals(0, r->pluginChain->numPlugins);
+  assertIsNull(getRenderContext());
+  freeRenderContext(r);
+  return 0;
+}
+
+static int _testNewRenderContextCopiesSettings(void) {
+  RenderContext r;
+
+  setSampleRate(22050.0);
+  setBlocksize(128);
+  r = newRenderContext();
+  renderContextMakeCurrent(r);
+  assertDoubleEquals(22050.0, getSampleRate(), TEST_DEFAULT_TOLERANCE);
+  assertUnsignedLongEquals(128l, getBlocksize());
+
+  renderContextMakeCurrent(NULL);
+  freeRenderContext(r);
+  return 0;
+}
+
+static int _testSetSampleRateInRenderContext(void) {
+  RenderContext r = newRenderContext();
+
+  renderContextMakeCurrent(r);
+  assert(r == getRenderContext());
+  setSampleRate(96000.0);
+  assertDoubleEquals(96000.0, getSampleRate(), TEST_DEFAULT_TOLERANCE);
+
+  renderContextMakeCurrent(NULL);
+  assertDoubleEquals(DEFAULT_SAMPLE_RATE, getSampleRate(),
+                     TEST_DEFAULT_TOLERANCE);
+
+  freeRenderContext(r);
+  return 0;
+}
+
+static int _testGetAudioClockFromRenderContext(void) {
+  AudioClock globalClock = getAudioClock();
+  RenderContext r = newRenderContext();
+
+  renderContextMakeCurrent(r);
+  assert(r->audioClock == getAudioClock());
+  advanceAudioClock(getAudioClock(), 256);
+  assertUnsignedLongEquals(256l, getAudioClock()->currentFrame);
+
+  renderContextMakeCurrent(NULL);
+  assert(globalClock == getAudioClock());
+  assert(globalClock != r->audioClock);
+
+  freeRenderContext(r);
+  return 0;
+}
+
+static int _testGetPluginChainFromRenderContext(void) {
+  PluginChain globalChain = getPluginChain();
+  RenderContext r = newRenderContext();
+
+  renderContextMakeCurrent(r);
+  assert(r->pluginChain == getPluginChain());
+  renderContextMakeCurrent(NULL);
+  assert(globalChain == getPluginChain());
+
+  freeRenderContext(r);
+  return 0;
+}
+
+typedef struct {
+  RenderContext renderContext;
+  SampleRate sampleRate;
+  SampleRate result;
+} _RenderContextTestThreadData;
+
+static void _renderContextTestThreadFunc(void *userData) {
+  _RenderContextTestThreadData *data = (_RenderContextTestThreadData *)userData;
+  int i;
+
+  renderContextMakeCurrent(data->renderContext);
+  setSampleRate(data->sampleRate);
+
+  // Give the other thread a chance to change its own sample rate
+  for (i = 0; i < 1000; i++) {
+    data->result = getSampleRate();
+
+    if (data->result != data->sampleRate) {
+      break;
+    }
+  }
+
+  renderContextMakeCurrent(NULL);
+}
+
+static int _testRenderContextsInDifferentThreads(void) {
+  _RenderContextTestThreadData data1, data2;
+  Thread t1, t2;
+
+  data1.renderContext = newRenderContext();
+  data1.sampleRate = 48000.0;
+  data2.renderContext = newRenderContext();
+  data2.sampleRate = 96000.0;
+
+  t1 = newThread(_renderContextTestThreadFunc, &data1);
+  t2 = newThread(_renderContextTestThreadFunc, &data2);
+  assertNotNull(t1);
+  assertNotNull(t2);
+  threadJoinAndFree(t1);
+  threadJoinAndFree(t2);
+
+  assertDoubleEquals(48000.0, data1.result, TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(96000.0, data2.result, TEST_DEFAULT_TOLERANCE);
+  // Neither thread should have changed the global settings
+  assertDoubleEquals(DEFAULT_SAMPLE_RATE, getSampleRate(),
+                     TEST_DEFAULT_TOLERANCE);
+
+  freeRenderContext(data1.renderContext);
+  freeRenderContext(data2.renderContext);
+  return 0;
+}
+
+static int _testFreeNullRenderContext(void) {
+  freeRenderContext(NULL);
+  return 0;
+}
+
+TestSuite addRenderContextTests(void);
+TestSuite addRenderContextTests(void) {
+  TestSuite testSuite = newTestSuite("RenderContext", _renderContextTestSetup,
+                                     _renderContextTestTeardown);
+  addTest(testSuite, "NewRenderContext", _testNewRenderContext);
+  addTest(testSuite, "NewRenderContextCopiesSettings",
+          _testNewRenderContextCopiesSettings);
+  addTest(testSuite, "SetSampleRateInRenderContext",
+          _testSetSampleRateInRenderContext);
+  addTest(testSuite, "GetAudioClockFromRenderContext",
+          _testGetAudioClockFromRenderContext);
+  addTest(testSuite, "GetPluginChainFromRenderContext",
+          _testGetPluginChainFromRenderContext);
+  addTest(testSuite, "RenderContextsInDifferentThreads",
+          _testRenderContextsInDifferentThreads);
+  addTest(testSuite, "FreeNullRenderContext", _testFreeNullRenderContext);
+  return testSuite;
+}
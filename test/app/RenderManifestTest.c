@@ -0,0 +1,227 @@
+//
+// RenderManifestTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "app/RenderManifest.h"
+
+#include "unit/TestRunner.h"
+
+static RenderManifest _newManifest(const char *lines[], unsigned int numLines) {
+  RenderManifest m = newRenderManifest();
+  LinkedList lineList = newLinkedList();
+  unsigned int i;
+
+  for (i = 0; i < numLines; i++) {
+    linkedListAppend(lineList, newCharStringWithCString(lines[i]));
+  }
+
+  if (!renderManifestParseLines(m, lineList) || !renderManifestResolve(m)) {
+    freeRenderManifest(m);
+    m = NULL;
+  }
+
+  freeLinkedListAndItems(lineList, (LinkedListFreeItemFunc)freeCharString);
+  return m;
+}
+
+static int _testParseManifest(void) {
+  const char *lines[] = {
+      "# Comment", "",
+      "name=a\tinput=in.wav\toutput=a.wav\tplugin=mrs_gain\tcost=2.5",
+      "output=b.wav\tplugin=mrs_passthru"};
+  RenderManifest m = _newManifest(lines, 4);
+
+  assertNotNull(m);
+  assertIntEquals(2, m->numJobs);
+  assertCharStringEquals("a", m->jobs[0]->name);
+  assertCharStringEquals("in.wav", m->jobs[0]->request->inputSource);
+  assertCharStringEquals("mrs_gain", m->jobs[0]->request->pluginChain);
+  assertDoubleEquals(2.5, m->jobs[0]->cost, TEST_DEFAULT_TOLERANCE);
+  // Unnamed jobs are named after their line
+  assertCharStringEquals("job4", m->jobs[1]->name);
+  assertDoubleEquals(1.0, m->jobs[1]->cost, TEST_DEFAULT_TOLERANCE);
+  assertIntEquals(RENDER_MANIFEST_JOB_PENDING, m->jobs[1]->state);
+
+  freeRenderManifest(m);
+  return 0;
+}
+
+static int _testParseInvalidManifest(void) {
+  const char *missingOutput[] = {"input=in.wav\tplugin=mrs_gain"};
+  const char *invalidCost[] = {"output=a.wav\tplugin=mrs_gain\tcost=x"};
+  const char *shutdown[] = {"shutdown"};
+
+  assertIsNull(_newManifest(missingOutput, 1));
+  assertIsNull(_newManifest(invalidCost, 1));
+  assertIsNull(_newManifest(shutdown, 1));
+  return 0;
+}
+
+static int _testResolveDependencies(void) {
+  const char *lines[] = {
+      "name=mix\tinput=a.wav\toutput=mix.wav\tplugin=mrs_gain",
+      "name=a\tinput=in.wav\toutput=a.wav\tplugin=mrs_gain",
+      "name=report\tinput=in.wav\toutput=r.wav\tplugin=mrs_gain\t"
+      "after=mix,a"};
+  RenderManifest m = _newManifest(lines, 3);
+
+  assertNotNull(m);
+  // Found by the input being the output of job "a"
+  assertIntEquals(1, m->jobs[0]->numDependencies);
+  assertIntEquals(1, m->jobs[0]->dependencies[0]);
+  assertIntEquals(0, m->jobs[1]->numDependencies);
+  assertIntEquals(2, m->jobs[2]->numDependencies);
+
+  freeRenderManifest(m);
+  return 0;
+}
+
+static int _testResolveInvalidDependencies(void) {
+  const char *unknown[] = {"output=a.wav\tplugin=mrs_gain\tafter=missing"};
+  const char *cycle[] = {"name=a\tinput=b.wav\toutput=a.wav\tplugin=mrs_gain",
+                         "name=b\tinput=a.wav\toutput=b.wav\tplugin=mrs_gain"};
+  const char *sameName[] = {"name=a\toutput=a.wav\tplugin=mrs_gain",
+                            "name=a\toutput=b.wav\tplugin=mrs_gain"};
+  const char *sameOutput[] = {"output=a.wav\tplugin=mrs_gain",
+                              "output=a.wav\tplugin=mrs_passthru"};
+
+  assertIsNull(_newManifest(unknown, 1));
+  assertIsNull(_newManifest(cycle, 2));
+  assertIsNull(_newManifest(sameName, 2));
+  assertIsNull(_newManifest(sameOutput, 2));
+  return 0;
+}
+
+static int _testNextJobWaitsForDependencies(void) {
+  const char *lines[] = {
+      "name=b\tinput=a.wav\toutput=b.wav\tplugin=mrs_gain",
+      "name=a\tinput=in.wav\toutput=a.wav\tplugin=mrs_gain"};
+  RenderManifest m = _newManifest(lines, 2);
+
+  assertNotNull(m);
+  assertIntEquals(1, renderManifestNextJob(m, -1));
+  assertIntEquals(-1, renderManifestNextJob(m, -1));
+  assertFalse(renderManifestIsFinished(m));
+  renderManifestFinishJob(m, 1, RETURN_CODE_SUCCESS);
+  assertIntEquals(0, renderManifestNextJob(m, 1));
+  renderManifestFinishJob(m, 0, RETURN_CODE_SUCCESS);
+  assert(renderManifestIsFinished(m));
+  assertIntEquals(2, renderManifestCountJobs(m, RENDER_MANIFEST_JOB_DONE));
+
+  freeRenderManifest(m);
+  return 0;
+}
+
+static int _testNextJobOrder(void) {
+  const char *lines[] = {
+      "name=cheap\tinput=in.wav\toutput=c.wav\tplugin=mrs_limiter",
+      "name=big\tinput=in.wav\toutput=big.wav\tplugin=mrs_gain\tcost=10",
+      "name=next\tinput=big.wav\toutput=n.wav\tplugin=mrs_limiter",
+      "name=same\tinput=in.wav\toutput=s.wav\tplugin=mrs_gain"};
+  RenderManifest m = _newManifest(lines, 4);
+
+  assertNotNull(m);
+  // The most expensive job starts first
+  assertIntEquals(1, renderManifestNextJob(m, -1));
+  renderManifestFinishJob(m, 1, RETURN_CODE_SUCCESS);
+  // Then the job which reads its output
+  assertIntEquals(2, renderManifestNextJob(m, 1));
+  renderManifestFinishJob(m, 2, RETURN_CODE_SUCCESS);
+  // A job with the same chain as the previous one comes before the others
+  assertIntEquals(0, renderManifestNextJob(m, 2));
+  assertIntEquals(3, renderManifestNextJob(m, -1));
+
+  freeRenderManifest(m);
+  return 0;
+}
+
+static int _testFailedJobSkipsDependents(void) {
+  const char *lines[] = {
+      "name=a\tinput=in.wav\toutput=a.wav\tplugin=mrs_gain",
+      "name=b\tinput=a.wav\toutput=b.wav\tplugin=mrs_gain",
+      "name=c\tinput=b.wav\toutput=c.wav\tplugin=mrs_gain",
+      "name=d\tinput=in.wav\toutput=d.wav\tplugin=mrs_gain"};
+  RenderManifest m = _newManifest(lines, 4);
+
+  assertNotNull(m);
+  assertIntEquals(0, renderManifestNextJob(m, -1));
+  renderManifestFinishJob(m, 0, RETURN_CODE_IO_ERROR);
+  assertIntEquals(RENDER_MANIFEST_JOB_FAILED, m->jobs[0]->state);
+  assertIntEquals(RENDER_MANIFEST_JOB_SKIPPED, m->jobs[1]->state);
+  assertIntEquals(RENDER_MANIFEST_JOB_SKIPPED, m->jobs[2]->state);
+  assertIntEquals(3, renderManifestNextJob(m, 0));
+  renderManifestFinishJob(m, 3, RETURN_CODE_SUCCESS);
+  assert(renderManifestIsFinished(m));
+
+  freeRenderManifest(m);
+  return 0;
+}
+
+static int _testIsConsumed(void) {
+  const char *lines[] = {
+      "name=a\tinput=in.wav\toutput=mem://a\tplugin=mrs_gain",
+      "name=b\tinput=mem://a\toutput=b.wav\tplugin=mrs_gain",
+      "name=c\tinput=mem://a\toutput=c.wav\tplugin=mrs_limiter"};
+  RenderManifest m = _newManifest(lines, 3);
+
+  assertNotNull(m);
+  assertFalse(renderManifestIsConsumed(m, 0));
+  assertIntEquals(0, renderManifestNextJob(m, -1));
+  renderManifestFinishJob(m, 0, RETURN_CODE_SUCCESS);
+  // Both readers of the output still need it
+  assertFalse(renderManifestIsConsumed(m, 0));
+  assertIntEquals(1, renderManifestNextJob(m, 0));
+  renderManifestFinishJob(m, 1, RETURN_CODE_SUCCESS);
+  assertFalse(renderManifestIsConsumed(m, 0));
+  assertIntEquals(2, renderManifestNextJob(m, 1));
+  assertFalse(renderManifestIsConsumed(m, 0));
+  renderManifestFinishJob(m, 2, RETURN_CODE_SUCCESS);
+  assert(renderManifestIsConsumed(m, 0));
+  assert(renderManifestIsConsumed(m, 2));
+
+  freeRenderManifest(m);
+  return 0;
+}
+
+static int _testFreeNullRenderManifest(void) {
+  freeRenderManifest(NULL);
+  return 0;
+}
+
+TestSuite addRenderManifestTests(void);
+TestSuite addRenderManifestTests(void) {
+  TestSuite testSuite = newTestSuite("RenderManifest", NULL, NULL);
+  addTest(testSuite, "ParseManifest", _testParseManifest);
+  addTest(testSuite, "ParseInvalidManifest", _testParseInvalidManifest);
+  addTest(testSuite, "ResolveDependencies", _testResolveDependencies);
+  addTest(testSuite, "ResolveInvalidDependencies",
+          _testResolveInvalidDependencies);
+  addTest(testSuite, "NextJobWaitsForDependencies",
+          _testNextJobWaitsForDependencies);
+  addTest(testSuite, "NextJobOrder", _testNextJobOrder);
+  addTest(testSuite, "FailedJobSkipsDependents", _testFailedJobSkipsDependents);
+  addTest(testSuite, "IsConsumed", _testIsConsumed);
+  addTest(testSuite, "FreeNullRenderManifest", _testFreeNullRenderManifest);
+  return testSuite;
+}
@@ -0,0 +1,236 @@
+//
+// RenderRequestTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "app/RenderRequest.h"
+
+#include "unit/TestRunner.h"
+
+#include <string.h>
+
+static boolByte _parseRequest(RenderRequest r, const char *lineCString) {
+  CharString line = newCharStringWithCString(lineCString);
+  boolByte result = renderRequestParse(r, line);
+  freeCharString(line);
+  return result;
+}
+
+static int _testNewRenderRequest(void) {
+  RenderRequest r = newRenderRequest();
+  assertNotNull(r);
+  assert(charStringIsEmpty(r->inputSource));
+  assert(charStringIsEmpty(r->outputSource));
+  assertIntEquals(0, linkedListLength(r->parameters));
+  assertDoubleEquals(0.0, r->sampleRate, TEST_DEFAULT_TOLERANCE);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, r->blocksize);
+  assertFalse(r->shutdown);
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testParseRequest(void) {
+  RenderRequest r = newRenderRequest();
+  assert(_parseRequest(r, "input=in.wav\toutput=out.wav\tplugin=mrs_gain\t"
+                          "midi=in.mid\tsample-rate=48000\tblocksize=256"));
+  assertCharStringEquals("in.wav", r->inputSource);
+  assertCharStringEquals("out.wav", r->outputSource);
+  assertCharStringEquals("mrs_gain", r->pluginChain);
+  assertCharStringEquals("in.mid", r->midiSource);
+  assertDoubleEquals(48000.0, r->sampleRate, TEST_DEFAULT_TOLERANCE);
+  assertUnsignedLongEquals(256ul, r->blocksize);
+  assertFalse(r->shutdown);
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testParseRequestWithParameters(void) {
+  RenderRequest r = newRenderRequest();
+  char *parameter;
+
+  assert(_parseRequest(r, "output=out.wav\tplugin=mrs_gain\t"
+                          "parameter=0,0.5\tparameter=1,0.25"));
+  assertIntEquals(2, linkedListLength(r->parameters));
+  parameter = (char *)r->parameters->item;
+  assertIntEquals(0, strcmp("0,0.5", parameter));
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testParseRequestWithChainString(void) {
+  RenderRequest r = newRenderRequest();
+  // Equals signs in the value should not be treated as separators
+  assert(_parseRequest(r, "output=out.wav\tplugin=a,b=c.fxp;mrs_limiter"));
+  assertCharStringEquals("a,b=c.fxp;mrs_limiter", r->pluginChain);
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testParseShutdownRequest(void) {
+  RenderRequest r = newRenderRequest();
+  assert(_parseRequest(r, "shutdown"));
+  assert(r->shutdown);
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testParseEmptyRequest(void) {
+  RenderRequest r = newRenderRequest();
+  assertFalse(_parseRequest(r, ""));
+  assertFalse(renderRequestParse(r, NULL));
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testParseRequestWithoutOutput(void) {
+  RenderRequest r = newRenderRequest();
+  assertFalse(_parseRequest(r, "input=in.wav\tplugin=mrs_gain"));
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testParseRequestWithoutPlugin(void) {
+  RenderRequest r = newRenderRequest();
+  assertFalse(_parseRequest(r, "input=in.wav\toutput=out.wav"));
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testParseRequestWithUnknownKey(void) {
+  RenderRequest r = newRenderRequest();
+  assertFalse(_parseRequest(r, "output=out.wav\tplugin=mrs_gain\tcolor=red"));
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testParseRequestWithoutValue(void) {
+  RenderRequest r = newRenderRequest();
+  assertFalse(_parseRequest(r, "output=out.wav\tplugin=mrs_gain\tinput"));
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testParseRequestWithInvalidNumbers(void) {
+  RenderRequest r = newRenderRequest();
+  assertFalse(
+      _parseRequest(r, "output=out.wav\tplugin=mrs_gain\tsample-rate=fast"));
+  assertFalse(_parseRequest(r, "output=out.wav\tplugin=mrs_gain\tblocksize=0"));
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testParseClearsPreviousRequest(void) {
+  RenderRequest r = newRenderRequest();
+  assert(_parseRequest(r, "input=in.wav\toutput=out.wav\tplugin=mrs_gain\t"
+                          "parameter=0,0.5\tblocksize=256"));
+  assert(_parseRequest(r, "output=other.wav\tplugin=mrs_limiter"));
+  assert(charStringIsEmpty(r->inputSource));
+  assertCharStringEquals("other.wav", r->outputSource);
+  assertIntEquals(0, linkedListLength(r->parameters));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, r->blocksize);
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testParseSegment(void) {
+  RenderRequest r = newRenderRequest();
+  assert(_parseRequest(r, "input=in.wav\toutput=out.wav\tplugin=mrs_gain\t"
+                          "start=441000\tlength=44100\tpreroll=4410"));
+  assertUnsignedLongEquals(441000ul, r->startFrame);
+  assertUnsignedLongEquals(44100ul, r->numFrames);
+  assertUnsignedLongEquals(4410ul, r->prerollFrames);
+  assertFalse(_parseRequest(r, "output=out.wav\tplugin=mrs_gain\tstart=-1"));
+  assertFalse(_parseRequest(r, "output=out.wav\tplugin=mrs_gain\tlength=x"));
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testFormatRequest(void) {
+  RenderRequest r = newRenderRequest();
+  RenderRequest parsed = newRenderRequest();
+  CharString line;
+  const char *expected = "input=in.wav\toutput=out.wav\tplugin=mrs_gain\t"
+                         "parameter=0,0.5\tsample-rate=48000\tblocksize=256\t"
+                         "start=1024\tpreroll=512";
+
+  assert(_parseRequest(r, expected));
+  line = renderRequestFormat(r);
+  assertCharStringEquals(expected, line);
+  assert(renderRequestParse(parsed, line));
+  assertUnsignedLongEquals(1024ul, parsed->startFrame);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, parsed->numFrames);
+
+  freeCharString(line);
+  freeRenderRequest(r);
+  freeRenderRequest(parsed);
+  return 0;
+}
+
+static int _testFormatShutdownRequest(void) {
+  RenderRequest r = newRenderRequest();
+  CharString line;
+
+  assert(_parseRequest(r, "shutdown"));
+  line = renderRequestFormat(r);
+  assertCharStringEquals("shutdown", line);
+
+  freeCharString(line);
+  freeRenderRequest(r);
+  return 0;
+}
+
+static int _testFreeNullRenderRequest(void) {
+  freeRenderRequest(NULL);
+  return 0;
+}
+
+TestSuite addRenderRequestTests(void);
+TestSuite addRenderRequestTests(void) {
+  TestSuite testSuite = newTestSuite("RenderRequest", NULL, NULL);
+  addTest(testSuite, "NewRenderRequest", _testNewRenderRequest);
+  addTest(testSuite, "ParseRequest", _testParseRequest);
+  addTest(testSuite, "ParseRequestWithParameters",
+          _testParseRequestWithParameters);
+  addTest(testSuite, "ParseRequestWithChainString",
+          _testParseRequestWithChainString);
+  addTest(testSuite, "ParseShutdownRequest", _testParseShutdownRequest);
+  addTest(testSuite, "ParseEmptyRequest", _testParseEmptyRequest);
+  addTest(testSuite, "ParseRequestWithoutOutput",
+          _testParseRequestWithoutOutput);
+  addTest(testSuite, "ParseRequestWithoutPlugin",
+          _testParseRequestWithoutPlugin);
+  addTest(testSuite, "ParseRequestWithUnknownKey",
+          _testParseRequestWithUnknownKey);
+  addTest(testSuite, "ParseRequestWithoutValue",
+          _testParseRequestWithoutValue);
+  addTest(testSuite, "ParseRequestWithInvalidNumbers",
+          _testParseRequestWithInvalidNumbers);
+  addTest(testSuite, "ParseClearsPreviousRequest",
+          _testParseClearsPreviousRequest);
+  addTest(testSuite, "ParseSegment", _testParseSegment);
+  addTest(testSuite, "FormatRequest", _testFormatRequest);
+  addTest(testSuite, "FormatShutdownRequest", _testFormatShutdownRequest);
+  addTest(testSuite, "FreeNullRenderRequest", _testFreeNullRenderRequest);
+  return testSuite;
+}
@@ -0,0 +1,120 @@
+//
+// RenderSegmentTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "app/RenderSegment.h"
+
+#include "unit/TestRunner.h"
+
+static int _testSplitIntoSegments(void) {
+  unsigned int numSegments;
+  RenderSegment segments = newRenderSegments(10000, 4, 100, 300, &numSegments);
+
+  assertIntEquals(4, numSegments);
+  assertUnsignedLongEquals(0ul, segments[0].startFrame);
+  assertUnsignedLongEquals(2500ul, segments[0].numFrames);
+  assertUnsignedLongEquals(0ul, segments[0].prerollFrames);
+  assertUnsignedLongEquals(2500ul, segments[1].startFrame);
+  assertUnsignedLongEquals(300ul, segments[1].prerollFrames);
+  assertUnsignedLongEquals(7500ul, segments[3].startFrame);
+  // The last segment runs to the end of the input
+  assertUnsignedLongEquals(0ul, segments[3].numFrames);
+
+  freeRenderSegments(segments);
+  return 0;
+}
+
+static int _testSegmentsStartOnBlockBoundaries(void) {
+  unsigned int numSegments;
+  RenderSegment segments = newRenderSegments(10000, 3, 512, 0, &numSegments);
+
+  assertIntEquals(3, numSegments);
+  assertUnsignedLongEquals(3072ul, segments[0].numFrames);
+  assertUnsignedLongEquals(3072ul, segments[1].startFrame);
+  assertUnsignedLongEquals(6144ul, segments[2].startFrame);
+
+  freeRenderSegments(segments);
+  return 0;
+}
+
+static int _testPrerollClippedToStart(void) {
+  unsigned int numSegments;
+  RenderSegment segments = newRenderSegments(1000, 2, 1, 500, &numSegments);
+
+  assertIntEquals(2, numSegments);
+  assertUnsignedLongEquals(500ul, segments[1].startFrame);
+  assertUnsignedLongEquals(500ul, segments[1].prerollFrames);
+
+  freeRenderSegments(segments);
+  return 0;
+}
+
+static int _testFewerSegmentsThanRequested(void) {
+  unsigned int numSegments;
+  // Segments shorter than the preroll are not worth rendering separately
+  RenderSegment segments = newRenderSegments(1000, 8, 1, 400, &numSegments);
+
+  assertIntEquals(2, numSegments);
+  freeRenderSegments(segments);
+  return 0;
+}
+
+static int _testUnknownInputLength(void) {
+  unsigned int numSegments;
+  RenderSegment segments = newRenderSegments(0, 4, 512, 0, &numSegments);
+
+  assertIntEquals(1, numSegments);
+  assertUnsignedLongEquals(0ul, segments[0].startFrame);
+  assertUnsignedLongEquals(0ul, segments[0].numFrames);
+
+  freeRenderSegments(segments);
+  return 0;
+}
+
+static int _testGetFilename(void) {
+  CharString outputName = newCharStringWithCString("out.wav");
+  CharString filename = newCharString();
+
+  renderSegmentGetFilename(outputName, 12, filename);
+  assertCharStringEquals("out.wav.segment012.wav", filename);
+
+  freeCharString(outputName);
+  freeCharString(filename);
+  return 0;
+}
+
+TestSuite addRenderSegmentTests(void);
+TestSuite addRenderSegmentTests(void) {
+  TestSuite testSuite = newTestSuite("RenderSegment", NULL, NULL);
+  addTest(testSuite, "SplitIntoSegments", _testSplitIntoSegments);
+  addTest(testSuite, "SegmentsStartOnBlockBoundaries",
+          _testSegmentsStartOnBlockBoundaries);
+  addTest(testSuite, "PrerollClippedToStart", _testPrerollClippedToStart);
+  addTest(testSuite, "FewerSegmentsThanRequested",
+          _testFewerSegmentsThanRequested);
+  addTest(testSuite, "UnknownInputLength", _testUnknownInputLength);
+  addTest(testSuite, "GetFilename", _testGetFilename);
+  return testSuite;
+}
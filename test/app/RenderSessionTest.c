@@ -0,0 +1,235 @@
+//
+// RenderSessionTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "app/RenderSession.h"
+
+#include "unit/TestRunner.h"
+
+static const SampleCount kRenderSessionTestBlocksize = 64;
+
+// The event logger and global audio clock are created by the test runner, so
+// initRenderSessions() is not called here
+static void _renderSessionTestSetup(void) {
+  initAudioSettings();
+  initPluginChain();
+}
+
+static void _renderSessionTestTeardown(void) {
+  renderContextMakeCurrent(NULL);
+  freePluginChain(getPluginChain());
+  freeAudioSettings();
+}
+
+static RenderSession _newTestSession(const char *pluginChainString) {
+  RenderSession s =
+      newRenderSession(44100.0, 2, kRenderSessionTestBlocksize);
+  CharString c = newCharStringWithCString(pluginChainString);
+
+  if (s != NULL) {
+    renderSessionAddPlugins(s, c, NULL);
+  }
+
+  freeCharString(c);
+  return s;
+}
+
+static int _testNewRenderSession(void) {
+  RenderSession s = newRenderSession(48000.0, 2, 128);
+
+  assertNotNull(s);
+  assertFalse(s->started);
+  renderContextMakeCurrent(s->renderContext);
+  assertDoubleEquals(48000.0, getSampleRate(), TEST_DEFAULT_TOLERANCE);
+  assertUnsignedLongEquals(128l, getBlocksize());
+  renderContextMakeCurrent(NULL);
+
+  // The settings of the calling thread are not changed
+  assertDoubleEquals(DEFAULT_SAMPLE_RATE, getSampleRate(),
+                     TEST_DEFAULT_TOLERANCE);
+  freeRenderSession(s);
+  return 0;
+}
+
+static int _testNewRenderSessionWithInvalidSettings(void) {
+  assertIsNull(newRenderSession(44100.0, 0, 128));
+  assertIsNull(newRenderSession(0.0, 2, 128));
+  assertIsNull(getRenderContext());
+  return 0;
+}
+
+static int _testAddInvalidPlugins(void) {
+  RenderSession s = newRenderSession(44100.0, 2, kRenderSessionTestBlocksize);
+  CharString c = newCharStringWithCString("invalid");
+
+  assertIntEquals(RETURN_CODE_INVALID_PLUGIN_CHAIN,
+                  renderSessionAddPlugins(s, c, NULL));
+  freeCharString(c);
+  freeRenderSession(s);
+  return 0;
+}
+
+static int _testStartWithoutPlugins(void) {
+  RenderSession s = newRenderSession(44100.0, 2, kRenderSessionTestBlocksize);
+  assertIntEquals(RETURN_CODE_INVALID_PLUGIN_CHAIN, renderSessionStart(s));
+  freeRenderSession(s);
+  return 0;
+}
+
+static int _testProcessBeforeStart(void) {
+  RenderSession s = _newTestSession("mrs_passthru");
+  SampleBuffer b = newSampleBuffer(2, kRenderSessionTestBlocksize);
+
+  assertFalse(renderSessionProcess(s, b, b));
+  freeSampleBuffer(b);
+  freeRenderSession(s);
+  return 0;
+}
+
+static int _testProcess(void) {
+  RenderSession s = _newTestSession("mrs_gain");
+  SampleBuffer input = newSampleBuffer(2, kRenderSessionTestBlocksize);
+  SampleBuffer output = newSampleBuffer(2, kRenderSessionTestBlocksize);
+  SampleCount frame;
+
+  for (frame = 0; frame < input->blocksize; frame++) {
+    input->samples[0][frame] = 0.5f;
+    input->samples[1][frame] = -0.5f;
+  }
+
+  assertIntEquals(RETURN_CODE_SUCCESS, renderSessionStart(s));
+  assert(renderSessionSetParameter(s, 0, 0, 0.5f));
+  assert(renderSessionProcess(s, input, output));
+  assertDoubleEquals(0.25, output->samples[0][10], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(-0.25, output->samples[1][10], TEST_DEFAULT_TOLERANCE);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, renderSessionGetLatency(s));
+  assertUnsignedLongEquals(
+      (unsigned long)kRenderSessionTestBlocksize,
+      s->renderContext->audioClock->currentFrame);
+
+  // Shorter blocks are allowed, for example at the end of an input
+  input->blocksize = 10;
+  assert(renderSessionProcess(s, input, output));
+  assertUnsignedLongEquals(10l, output->blocksize);
+
+  renderSessionReset(s);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           s->renderContext->audioClock->currentFrame);
+
+  freeSampleBuffer(input);
+  freeSampleBuffer(output);
+  freeRenderSession(s);
+  return 0;
+}
+
+static int _testProcessCallerOwnedSamples(void) {
+  RenderSession s = _newTestSession("mrs_gain");
+  // A planar block of caller-owned memory, like a C-contiguous array from a
+  // scripting language, which is processed in place without copying
+  Sample *planar = (Sample *)malloc(sizeof(Sample) * 2 *
+                                    kRenderSessionTestBlocksize);
+  Samples channels[2];
+  SampleBuffer buffer;
+  SampleCount frame;
+
+  channels[0] = planar;
+  channels[1] = planar + kRenderSessionTestBlocksize;
+  buffer = newSampleBufferWithChannels(2, kRenderSessionTestBlocksize,
+                                       channels);
+
+  for (frame = 0; frame < 2 * kRenderSessionTestBlocksize; frame++) {
+    planar[frame] = 0.5f;
+  }
+
+  assertIntEquals(RETURN_CODE_SUCCESS, renderSessionStart(s));
+  assert(renderSessionSetParameter(s, 0, 0, 0.5f));
+  assert(renderSessionProcess(s, buffer, buffer));
+  assertDoubleEquals(0.25, planar[10], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.25, planar[kRenderSessionTestBlocksize + 10],
+                     TEST_DEFAULT_TOLERANCE);
+
+  freeSampleBuffer(buffer);
+  free(planar);
+  freeRenderSession(s);
+  return 0;
+}
+
+static int _testProcessWithWrongChannels(void) {
+  RenderSession s = _newTestSession("mrs_passthru");
+  SampleBuffer input = newSampleBuffer(1, kRenderSessionTestBlocksize);
+  SampleBuffer output = newSampleBuffer(2, kRenderSessionTestBlocksize);
+
+  assertIntEquals(RETURN_CODE_SUCCESS, renderSessionStart(s));
+  assertFalse(renderSessionProcess(s, input, output));
+  freeSampleBuffer(input);
+  freeSampleBuffer(output);
+  freeRenderSession(s);
+  return 0;
+}
+
+static int _testSetParameterOnInvalidPlugin(void) {
+  RenderSession s = _newTestSession("mrs_gain");
+  assertFalse(renderSessionSetParameter(s, 1, 0, 0.5f));
+  freeRenderSession(s);
+  return 0;
+}
+
+static int _testAddPluginsAfterStart(void) {
+  RenderSession s = _newTestSession("mrs_passthru");
+  CharString c = newCharStringWithCString("mrs_gain");
+
+  assertIntEquals(RETURN_CODE_SUCCESS, renderSessionStart(s));
+  assertIntEquals(RETURN_CODE_INVALID_PLUGIN_CHAIN,
+                  renderSessionAddPlugins(s, c, NULL));
+  freeCharString(c);
+  freeRenderSession(s);
+  return 0;
+}
+
+static int _testFreeNullRenderSession(void) {
+  freeRenderSession(NULL);
+  return 0;
+}
+
+TestSuite addRenderSessionTests(void);
+TestSuite addRenderSessionTests(void) {
+  TestSuite testSuite = newTestSuite("RenderSession", _renderSessionTestSetup,
+                                     _renderSessionTestTeardown);
+  addTest(testSuite, "NewObject", _testNewRenderSession);
+  addTest(testSuite, "NewObjectWithInvalidSettings",
+          _testNewRenderSessionWithInvalidSettings);
+  addTest(testSuite, "AddInvalidPlugins", _testAddInvalidPlugins);
+  addTest(testSuite, "StartWithoutPlugins", _testStartWithoutPlugins);
+  addTest(testSuite, "ProcessBeforeStart", _testProcessBeforeStart);
+  addTest(testSuite, "Process", _testProcess);
+  addTest(testSuite, "ProcessCallerOwnedSamples",
+          _testProcessCallerOwnedSamples);
+  addTest(testSuite, "ProcessWithWrongChannels", _testProcessWithWrongChannels);
+  addTest(testSuite, "SetParameterOnInvalidPlugin",
+          _testSetParameterOnInvalidPlugin);
+  addTest(testSuite, "AddPluginsAfterStart", _testAddPluginsAfterStart);
+  addTest(testSuite, "FreeNullObject", _testFreeNullRenderSession);
+  return testSuite;
+}
@@ -0,0 +1,194 @@
+//
+// SamplingProfilerTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "app/SamplingProfiler.h"
+
+#include "base/File.h"
+#include "unit/TestRunner.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_PROFILE_FILENAME "mrswatsontest-profile.txt"
+
+static const char *kSamplingProfilerTestPluginName = "test_plugin";
+
+// Keeps the compiler from optimizing away the busy loop below
+static volatile double _samplingProfilerTestResult = 0.0;
+
+static void _samplingProfilerTestTeardown(void) {
+  CharString profilePath = newCharStringWithCString(TEST_PROFILE_FILENAME);
+  File profileFile = newFileWithPath(profilePath);
+
+  samplingProfilerStop();
+  samplingProfilerSetFrame(SAMPLING_PROFILER_FRAME_HOST);
+
+  if (fileExists(profileFile)) {
+    fileRemove(profileFile);
+  }
+
+  freeCharString(profilePath);
+  freeFile(profileFile);
+}
+
+// Burn CPU time until the profiler has taken a few samples, or until a second
+// of CPU time has passed
+static void _samplingProfilerTestBusyLoop(void) {
+  const clock_t stopTime = clock() + CLOCKS_PER_SEC;
+  int i;
+
+  while (samplingProfilerGetNumSamples() < 5 && clock() < stopTime) {
+    for (i = 0; i < 10000; i++) {
+      _samplingProfilerTestResult += i * 0.5;
+    }
+  }
+}
+
+static int _testSetFrame(void) {
+  SamplingProfilerFrame previousFrame =
+      samplingProfilerSetFrame(SAMPLING_PROFILER_FRAME_PLUGIN_CHAIN);
+  assertIntEquals(SAMPLING_PROFILER_FRAME_HOST, previousFrame);
+  assertIntEquals(SAMPLING_PROFILER_FRAME_PLUGIN_CHAIN,
+                  samplingProfilerSetFrame(SAMPLING_PROFILER_FRAME_HOST));
+  return 0;
+}
+
+static int _testHostCallbackOutsidePlugin(void) {
+  // Calls which are not made while processing count as host time
+  assertIntEquals(SAMPLING_PROFILER_FRAME_HOST,
+                  samplingProfilerEnterHostCallback());
+  assertIntEquals(SAMPLING_PROFILER_FRAME_HOST,
+                  samplingProfilerSetFrame(SAMPLING_PROFILER_FRAME_HOST));
+  return 0;
+}
+
+static int _testHostCallbackInsidePlugin(void) {
+  SamplingProfilerFrame previousFrame;
+
+  samplingProfilerEnterPlugin(kSamplingProfilerTestPluginName,
+                              SAMPLING_PROFILER_FRAME_PROCESS_MIDI);
+  previousFrame = samplingProfilerEnterHostCallback();
+  assertIntEquals(SAMPLING_PROFILER_FRAME_PROCESS_MIDI, previousFrame);
+  assertIntEquals(SAMPLING_PROFILER_FRAME_MIDI_HOST_CALLBACK,
+                  samplingProfilerSetFrame(previousFrame));
+  samplingProfilerExitPlugin();
+  assertIntEquals(SAMPLING_PROFILER_FRAME_PLUGIN_CHAIN,
+                  samplingProfilerSetFrame(SAMPLING_PROFILER_FRAME_HOST));
+  return 0;
+}
+
+static int _testSamplePlugin(void) {
+  if (!samplingProfilerIsSupported()) {
+    return -1;
+  }
+
+  assert(samplingProfilerStart());
+  samplingProfilerEnterPlugin(kSamplingProfilerTestPluginName,
+                              SAMPLING_PROFILER_FRAME_PROCESS_AUDIO);
+  _samplingProfilerTestBusyLoop();
+  samplingProfilerExitPlugin();
+  samplingProfilerStop();
+
+  assert(samplingProfilerGetNumSamplesForOwner(
+             kSamplingProfilerTestPluginName,
+             SAMPLING_PROFILER_FRAME_PROCESS_AUDIO) > 0);
+  assertUnsignedLongEquals(
+      ZERO_UNSIGNED_LONG,
+      samplingProfilerGetNumSamplesForOwner(
+          NULL, SAMPLING_PROFILER_FRAME_PROCESS_AUDIO));
+  return 0;
+}
+
+static int _testStartDiscardsSamples(void) {
+  if (!samplingProfilerIsSupported()) {
+    return -1;
+  }
+
+  assert(samplingProfilerStart());
+  _samplingProfilerTestBusyLoop();
+  samplingProfilerStop();
+  assert(samplingProfilerGetNumSamples() > 0);
+
+  assert(samplingProfilerStart());
+  samplingProfilerStop();
+  assertUnsignedLongEquals(
+      ZERO_UNSIGNED_LONG,
+      samplingProfilerGetNumSamplesForOwner(NULL,
+                                            SAMPLING_PROFILER_FRAME_HOST));
+  return 0;
+}
+
+static int _testWriteCollapsedStacks(void) {
+  const char *kExpectedStack =
+      "MrsWatson;PluginChain;test_plugin;processAudio ";
+  CharString profilePath = newCharStringWithCString(TEST_PROFILE_FILENAME);
+  boolByte found = false;
+  char line[256];
+  FILE *fp;
+
+  if (!samplingProfilerIsSupported()) {
+    freeCharString(profilePath);
+    return -1;
+  }
+
+  assert(samplingProfilerStart());
+  samplingProfilerEnterPlugin("test;plugin",
+                              SAMPLING_PROFILER_FRAME_PROCESS_AUDIO);
+  _samplingProfilerTestBusyLoop();
+  samplingProfilerExitPlugin();
+  samplingProfilerStop();
+  assert(samplingProfilerWriteCollapsedStacks(profilePath));
+
+  // Semicolons in plugin names would add frames to the stack
+  fp = fopen(TEST_PROFILE_FILENAME, "r");
+  assertNotNull(fp);
+
+  while (!found && fgets(line, sizeof(line), fp) != NULL) {
+    found = (boolByte)(strncmp(line, kExpectedStack, strlen(kExpectedStack)) ==
+                       0);
+  }
+
+  fclose(fp);
+  assert(found);
+
+  freeCharString(profilePath);
+  return 0;
+}
+
+TestSuite addSamplingProfilerTests(void);
+TestSuite addSamplingProfilerTests(void) {
+  TestSuite testSuite =
+      newTestSuite("SamplingProfiler", NULL, _samplingProfilerTestTeardown);
+  addTest(testSuite, "SetFrame", _testSetFrame);
+  addTest(testSuite, "HostCallbackOutsidePlugin",
+          _testHostCallbackOutsidePlugin);
+  addTest(testSuite, "HostCallbackInsidePlugin", _testHostCallbackInsidePlugin);
+  addTest(testSuite, "SamplePlugin", _testSamplePlugin);
+  addTest(testSuite, "StartDiscardsSamples", _testStartDiscardsSamples);
+  addTest(testSuite, "WriteCollapsedStacks", _testWriteCollapsedStacks);
+  return testSuite;
+}
@@ -0,0 +1,216 @@
+//
+// AudioAnalysisTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include "audio/AudioAnalysis.h"
+
+#include "unit/TestRunner.h"
+
+static void _fillRamp(SampleBuffer buffer) {
+  for (SampleCount i = 0; i < buffer->blocksize; i++) {
+    buffer->samples[0][i] = 0.1f + 0.001f * (Sample)i;
+  }
+}
+
+static int _testNewAudioAnalysis(void) {
+  AudioAnalysis a = newAudioAnalysis(2);
+  assertNotNull(a);
+  assertIntEquals(2, a->numChannels);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, a->numFrames);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, a->channels[1].clippedSamples);
+  assertDoubleEquals(0.0, a->channels[1].peak, TEST_EXACT_TOLERANCE);
+  freeAudioAnalysis(a);
+  return 0;
+}
+
+static int _testAnalyzeCleanBlock(void) {
+  AudioAnalysis a = newAudioAnalysis(1);
+  SampleBuffer b = newSampleBuffer(1, 64);
+
+  _fillRamp(b);
+  audioAnalysisProcess(a, b);
+  assertUnsignedLongEquals(64ul, a->numFrames);
+  assertDoubleEquals(0.163, a->channels[0].peak, 0.0001);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, a->channels[0].clippedSamples);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, a->channels[0].discontinuities);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, a->channels[0].longestSilence);
+  assertDoubleEquals(0.001, a->channels[0].largestJump, 0.0001);
+
+  freeSampleBuffer(b);
+  freeAudioAnalysis(a);
+  return 0;
+}
+
+static int _testAnalyzeClipping(void) {
+  AudioAnalysis a = newAudioAnalysis(1);
+  SampleBuffer b = newSampleBuffer(1, 64);
+
+  _fillRamp(b);
+  // A short run and a longer one, which is the one reported
+  b->samples[0][3] = 1.0f;
+  for (SampleCount i = 21; i < 30; i++) {
+    b->samples[0][i] = -1.0f;
+  }
+  audioAnalysisProcess(a, b);
+
+  assertUnsignedLongEquals(10ul, a->channels[0].clippedSamples);
+  assertUnsignedLongEquals(9ul, a->channels[0].longestClip);
+  assertUnsignedLongEquals(21ul, a->channels[0].longestClipStart);
+  assertDoubleEquals(1.0, a->channels[0].peak, TEST_EXACT_TOLERANCE);
+
+  freeSampleBuffer(b);
+  freeAudioAnalysis(a);
+  return 0;
+}
+
+static int _testAnalyzeDiscontinuityAcrossBlocks(void) {
+  AudioAnalysis a = newAudioAnalysis(1);
+  SampleBuffer b = newSampleBuffer(1, 16);
+
+  _fillRamp(b);
+  audioAnalysisProcess(a, b);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, a->channels[0].discontinuities);
+
+  // The first sample of the next block jumps from the end of the last one
+  for (SampleCount i = 0; i < b->blocksize; i++) {
+    b->samples[0][i] = 0.9f;
+  }
+  audioAnalysisProcess(a, b);
+
+  assertUnsignedLongEquals(1ul, a->channels[0].discontinuities);
+  assertUnsignedLongEquals(16ul, a->channels[0].firstDiscontinuity);
+  assertDoubleEquals(0.785, a->channels[0].largestJump, 0.0001);
+
+  freeSampleBuffer(b);
+  freeAudioAnalysis(a);
+  return 0;
+}
+
+static int _testAnalyzeFirstSampleIsNotDiscontinuity(void) {
+  AudioAnalysis a = newAudioAnalysis(1);
+  SampleBuffer b = newSampleBuffer(1, 8);
+
+  for (SampleCount i = 0; i < b->blocksize; i++) {
+    b->samples[0][i] = 0.9f;
+  }
+  audioAnalysisProcess(a, b);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, a->channels[0].discontinuities);
+
+  freeSampleBuffer(b);
+  freeAudioAnalysis(a);
+  return 0;
+}
+
+static int _testAnalyzeSilenceAcrossBlocks(void) {
+  AudioAnalysis a = newAudioAnalysis(1);
+  SampleBuffer b = newSampleBuffer(1, 32);
+
+  _fillRamp(b);
+  for (SampleCount i = 20; i < 32; i++) {
+    b->samples[0][i] = 0.0f;
+  }
+  audioAnalysisProcess(a, b);
+
+  _fillRamp(b);
+  for (SampleCount i = 0; i < 10; i++) {
+    b->samples[0][i] = 0.0f;
+  }
+  audioAnalysisProcess(a, b);
+
+  assertUnsignedLongEquals(22ul, a->channels[0].longestSilence);
+  assertUnsignedLongEquals(20ul, a->channels[0].longestSilenceStart);
+
+  freeSampleBuffer(b);
+  freeAudioAnalysis(a);
+  return 0;
+}
+
+static int _testAnalyzeBlockSizesAgree(void) {
+  AudioAnalysis single = newAudioAnalysis(1);
+  AudioAnalysis blocks = newAudioAnalysis(1);
+  SampleBuffer all = newSampleBuffer(1, 111);
+  SampleBuffer one = newSampleBuffer(1, 1);
+  SampleBuffer odd = newSampleBuffer(1, 37);
+  SampleCount i;
+
+  for (i = 0; i < all->blocksize; i++) {
+    all->samples[0][i] = (i % 13 == 0) ? 1.0f : 0.01f * (Sample)(i % 7);
+  }
+
+  // One frame at a time never uses the vectorized loop, so this compares it
+  // with the scalar one
+  for (i = 0; i < all->blocksize; i++) {
+    one->samples[0][0] = all->samples[0][i];
+    audioAnalysisProcess(single, one);
+  }
+
+  for (i = 0; i < all->blocksize; i += odd->blocksize) {
+    sampleBufferCopyAndMapChannelsWithOffset(odd, 0, all, i, odd->blocksize);
+    audioAnalysisProcess(blocks, odd);
+  }
+
+  assertUnsignedLongEquals(single->numFrames, blocks->numFrames);
+  assertDoubleEquals(single->channels[0].peak, blocks->channels[0].peak,
+                     TEST_EXACT_TOLERANCE);
+  assertUnsignedLongEquals(single->channels[0].clippedSamples,
+                           blocks->channels[0].clippedSamples);
+  assertUnsignedLongEquals(single->channels[0].discontinuities,
+                           blocks->channels[0].discontinuities);
+  assertUnsignedLongEquals(single->channels[0].firstDiscontinuity,
+                           blocks->channels[0].firstDiscontinuity);
+  assertDoubleEquals(single->channels[0].largestJump,
+                     blocks->channels[0].largestJump, TEST_EXACT_TOLERANCE);
+  assertUnsignedLongEquals(single->channels[0].longestSilence,
+                           blocks->channels[0].longestSilence);
+  assertUnsignedLongEquals(single->channels[0].longestSilenceStart,
+                           blocks->channels[0].longestSilenceStart);
+
+  freeSampleBuffer(all);
+  freeSampleBuffer(one);
+  freeSampleBuffer(odd);
+  freeAudioAnalysis(single);
+  freeAudioAnalysis(blocks);
+  return 0;
+}
+
+static int _testFreeNullAudioAnalysis(void) {
+  freeAudioAnalysis(NULL);
+  return 0;
+}
+
+TestSuite addAudioAnalysisTests(void);
+TestSuite addAudioAnalysisTests(void) {
+  TestSuite testSuite = newTestSuite("AudioAnalysis", NULL, NULL);
+  addTest(testSuite, "NewObject", _testNewAudioAnalysis);
+  addTest(testSuite, "AnalyzeCleanBlock", _testAnalyzeCleanBlock);
+  addTest(testSuite, "AnalyzeClipping", _testAnalyzeClipping);
+  addTest(testSuite, "AnalyzeDiscontinuityAcrossBlocks",
+          _testAnalyzeDiscontinuityAcrossBlocks);
+  addTest(testSuite, "AnalyzeFirstSampleIsNotDiscontinuity",
+          _testAnalyzeFirstSampleIsNotDiscontinuity);
+  addTest(testSuite, "AnalyzeSilenceAcrossBlocks",
+          _testAnalyzeSilenceAcrossBlocks);
+  addTest(testSuite, "AnalyzeBlockSizesAgree", _testAnalyzeBlockSizesAgree);
+  addTest(testSuite, "FreeNull", _testFreeNullAudioAnalysis);
+  return testSuite;
+}
@@ -204,6 +204,40 @@ static int _testSetBitDepth(void) {
   return 0;
 }
 
+static int _testSetDitherType(void) {
+  assertIntEquals(kDitherTypeNone, getDitherType());
+  assert(setDitherType(kDitherTypeShaped));
+  assertIntEquals(kDitherTypeShaped, getDitherType());
+  return 0;
+}
+
+static int _testSetDitherTypeFromString(void) {
+  CharString s = newCharStringWithCString("TPDF");
+  assert(setDitherTypeFromString(s));
+  assertIntEquals(kDitherTypeTpdf, getDitherType());
+  freeCharString(s);
+  return 0;
+}
+
+static int _testSetDitherTypeFromInvalidString(void) {
+  CharString s = newCharStringWithCString("invalid");
+  assert(setDitherType(kDitherTypeTpdf));
+  assertFalse(setDitherTypeFromString(s));
+  assertIntEquals(kDitherTypeTpdf, getDitherType());
+  freeCharString(s);
+  return 0;
+}
+
+static int _testSetDeviceLatency(void) {
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, getInputLatency());
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, getOutputLatency());
+  setInputLatency(256);
+  setOutputLatency(512);
+  assertUnsignedLongEquals(256ul, getInputLatency());
+  assertUnsignedLongEquals(512ul, getOutputLatency());
+  return 0;
+}
+
 TestSuite addAudioSettingsTests(void);
 TestSuite addAudioSettingsTests(void) {
   TestSuite testSuite = newTestSuite("AudioSettings", _audioSettingsSetup,
@@ -237,6 +271,11 @@ TestSuite addAudioSettingsTests(void) {
           _testSetTimeSignatureFromNullString);
 
   addTest(testSuite, "SetBitDepth", _testSetBitDepth);
+  addTest(testSuite, "SetDitherType", _testSetDitherType);
+  addTest(testSuite, "SetDitherTypeFromString", _testSetDitherTypeFromString);
+  addTest(testSuite, "SetDitherTypeFromInvalidString",
+          _testSetDitherTypeFromInvalidString);
+  addTest(testSuite, "SetDeviceLatency", _testSetDeviceLatency);
 
   return testSuite;
 }
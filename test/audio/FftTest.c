@@ -0,0 +1,161 @@
+//
+// FftTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "audio/Fft.h"
+
+#include "unit/TestRunner.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+static const double kFftTestPi = 3.14159265358979323846;
+
+static float _getTestSignal(unsigned int i) {
+  return (float)(sin(i * 0.37) + 0.5 * cos(i * 1.91) + (i % 5) * 0.1);
+}
+
+// Compare the transform with a direct evaluation of the DFT
+static int _testForwardMatchesDft(unsigned int size) {
+  Fft fft = newFft(size);
+  float *input = (float *)malloc(sizeof(float) * size);
+  float *real = (float *)malloc(sizeof(float) * (size / 2 + 1));
+  float *imag = (float *)malloc(sizeof(float) * (size / 2 + 1));
+  double expectedReal, expectedImag;
+  unsigned int i, k;
+
+  assertNotNull(fft);
+  assertIntEquals((int)(size / 2 + 1), (int)fftGetNumBins(fft));
+
+  for (i = 0; i < size; i++) {
+    input[i] = _getTestSignal(i);
+  }
+
+  fftForward(fft, input, real, imag);
+
+  for (k = 0; k <= size / 2; k++) {
+    expectedReal = 0.0;
+    expectedImag = 0.0;
+
+    for (i = 0; i < size; i++) {
+      expectedReal += input[i] * cos(2.0 * kFftTestPi * i * k / size);
+      expectedImag -= input[i] * sin(2.0 * kFftTestPi * i * k / size);
+    }
+
+    assert(fabs(real[k] - expectedReal) < 0.001 * size);
+    assert(fabs(imag[k] - expectedImag) < 0.001 * size);
+  }
+
+  free(input);
+  free(real);
+  free(imag);
+  freeFft(fft);
+  return 0;
+}
+
+static int _testForwardSize2(void) { return _testForwardMatchesDft(2); }
+
+static int _testForwardSize8(void) { return _testForwardMatchesDft(8); }
+
+static int _testForwardSize256(void) { return _testForwardMatchesDft(256); }
+
+static int _testInverseRestoresSignal(void) {
+  const unsigned int size = 1024;
+  Fft fft = newFft(size);
+  float *input = (float *)malloc(sizeof(float) * size);
+  float *output = (float *)malloc(sizeof(float) * size);
+  float *real = (float *)malloc(sizeof(float) * (size / 2 + 1));
+  float *imag = (float *)malloc(sizeof(float) * (size / 2 + 1));
+  unsigned int i;
+
+  for (i = 0; i < size; i++) {
+    input[i] = _getTestSignal(i);
+  }
+
+  fftForward(fft, input, real, imag);
+  fftInverse(fft, real, imag, output);
+
+  for (i = 0; i < size; i++) {
+    assert(fabsf(input[i] - output[i]) < 0.0001f);
+  }
+
+  free(input);
+  free(output);
+  free(real);
+  free(imag);
+  freeFft(fft);
+  return 0;
+}
+
+// Multiplying spectra is a circular convolution of the signals
+static int _testMultiplyAccumulateConvolves(void) {
+  const unsigned int size = 64;
+  Fft fft = newFft(size);
+  float signal[64], impulse[64], output[64];
+  float signalReal[33], signalImag[33];
+  float impulseReal[33], impulseImag[33];
+  float sumReal[33] = {0.0f}, sumImag[33] = {0.0f};
+  unsigned int i;
+
+  for (i = 0; i < size; i++) {
+    signal[i] = i < 32 ? _getTestSignal(i) : 0.0f;
+    impulse[i] = 0.0f;
+  }
+
+  // A delay of 3 frames at half the amplitude
+  impulse[3] = 0.5f;
+  fftForward(fft, signal, signalReal, signalImag);
+  fftForward(fft, impulse, impulseReal, impulseImag);
+  fftMultiplyAccumulate(signalReal, signalImag, impulseReal, impulseImag,
+                        sumReal, sumImag, fftGetNumBins(fft));
+  fftInverse(fft, sumReal, sumImag, output);
+
+  for (i = 0; i < size; i++) {
+    assert(fabsf(output[i] - (i >= 3 ? 0.5f * signal[i - 3] : 0.0f)) <
+           0.0001f);
+  }
+
+  freeFft(fft);
+  return 0;
+}
+
+static int _testInvalidSize(void) {
+  assertIsNull(newFft(0));
+  assertIsNull(newFft(1));
+  assertIsNull(newFft(48));
+  return 0;
+}
+
+TestSuite addFftTests(void);
+TestSuite addFftTests(void) {
+  TestSuite testSuite = newTestSuite("Fft", NULL, NULL);
+  addTest(testSuite, "ForwardSize2", _testForwardSize2);
+  addTest(testSuite, "ForwardSize8", _testForwardSize8);
+  addTest(testSuite, "ForwardSize256", _testForwardSize256);
+  addTest(testSuite, "InverseRestoresSignal", _testInverseRestoresSignal);
+  addTest(testSuite, "MultiplyAccumulateConvolves",
+          _testMultiplyAccumulateConvolves);
+  addTest(testSuite, "InvalidSize", _testInvalidSize);
+  return testSuite;
+}
@@ -0,0 +1,146 @@
+//
+// LoudnessMeterTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include "audio/LoudnessMeter.h"
+
+#include "unit/TestRunner.h"
+
+#include <math.h>
+
+static const double kLoudnessMeterTestPi = 3.14159265358979323846;
+
+// Measure a sine with the same amplitude and phase in every channel
+static LoudnessMeter _measureSine(ChannelCount numChannels,
+                                  SampleRate sampleRate, double frequency,
+                                  double amplitude, double phase,
+                                  double seconds) {
+  LoudnessMeter meter = newLoudnessMeter(numChannels, sampleRate);
+  SampleBuffer buffer = newSampleBuffer(numChannels, 1000);
+  const unsigned long numFrames = (unsigned long)(sampleRate * seconds);
+  unsigned long frame = 0;
+  ChannelCount channel;
+  SampleCount i;
+
+  while (frame < numFrames) {
+    for (i = 0; i < buffer->blocksize; i++) {
+      for (channel = 0; channel < numChannels; channel++) {
+        buffer->samples[channel][i] = (Sample)(
+            amplitude * sin(2.0 * kLoudnessMeterTestPi * frequency *
+                                (double)(frame + i) / sampleRate +
+                            phase));
+      }
+    }
+
+    loudnessMeterProcess(meter, buffer);
+    frame += buffer->blocksize;
+  }
+
+  freeSampleBuffer(buffer);
+  return meter;
+}
+
+static int _testNewLoudnessMeter(void) {
+  LoudnessMeter m = newLoudnessMeter(2, 44100.0);
+  assertNotNull(m);
+  assertIntEquals(2, m->numChannels);
+  assertDoubleEquals(0.0, loudnessMeterGetRange(m), TEST_EXACT_TOLERANCE);
+  assert(loudnessMeterGetIntegrated(m) == -HUGE_VAL);
+  assert(loudnessMeterGetTruePeak(m, 0) == -HUGE_VAL);
+  freeLoudnessMeter(m);
+  return 0;
+}
+
+static int _testIntegratedLoudnessOfSine(void) {
+  // A 1kHz sine at -23dBFS in both channels is -23 LUFS, as in the EBU
+  // conformance tests
+  const double amplitude = pow(10.0, -23.0 / 20.0);
+  LoudnessMeter m = _measureSine(2, 48000.0, 1000.0, amplitude, 0.0, 5.0);
+
+  assertDoubleEquals(-23.0, loudnessMeterGetIntegrated(m), 0.1);
+  assertDoubleEquals(0.0, loudnessMeterGetRange(m), 0.1);
+  freeLoudnessMeter(m);
+  return 0;
+}
+
+static int _testIntegratedLoudnessAtOtherSampleRate(void) {
+  const double amplitude = pow(10.0, -23.0 / 20.0);
+  LoudnessMeter m = _measureSine(2, 44100.0, 1000.0, amplitude, 0.0, 5.0);
+
+  assertDoubleEquals(-23.0, loudnessMeterGetIntegrated(m), 0.1);
+  freeLoudnessMeter(m);
+  return 0;
+}
+
+static int _testIntegratedLoudnessOfMono(void) {
+  // One channel has half the energy of two
+  const double amplitude = pow(10.0, -23.0 / 20.0);
+  LoudnessMeter m = _measureSine(1, 48000.0, 1000.0, amplitude, 0.0, 5.0);
+
+  assertDoubleEquals(-26.01, loudnessMeterGetIntegrated(m), 0.1);
+  freeLoudnessMeter(m);
+  return 0;
+}
+
+static int _testIntegratedLoudnessOfSilence(void) {
+  LoudnessMeter m = _measureSine(2, 44100.0, 1000.0, 0.0, 0.0, 2.0);
+
+  assert(loudnessMeterGetIntegrated(m) == -HUGE_VAL);
+  assert(loudnessMeterGetTruePeak(m, 1) == -HUGE_VAL);
+  freeLoudnessMeter(m);
+  return 0;
+}
+
+static int _testTruePeakBetweenSamples(void) {
+  // A sine at a quarter of the sample rate, sampled 45 degrees off its peaks,
+  // has samples 3dB below its true peak of -6dBTP
+  LoudnessMeter m = _measureSine(2, 44100.0, 44100.0 / 4.0, 0.5,
+                                 kLoudnessMeterTestPi / 4.0, 1.0);
+
+  assertDoubleEquals(-6.02, loudnessMeterGetTruePeak(m, 0), 0.5);
+  assertDoubleEquals(-6.02, loudnessMeterGetTruePeak(m, 1), 0.5);
+  freeLoudnessMeter(m);
+  return 0;
+}
+
+static int _testFreeNullLoudnessMeter(void) {
+  freeLoudnessMeter(NULL);
+  return 0;
+}
+
+TestSuite addLoudnessMeterTests(void);
+TestSuite addLoudnessMeterTests(void) {
+  TestSuite testSuite = newTestSuite("LoudnessMeter", NULL, NULL);
+  addTest(testSuite, "NewObject", _testNewLoudnessMeter);
+  addTest(testSuite, "IntegratedLoudnessOfSine",
+          _testIntegratedLoudnessOfSine);
+  addTest(testSuite, "IntegratedLoudnessAtOtherSampleRate",
+          _testIntegratedLoudnessAtOtherSampleRate);
+  addTest(testSuite, "IntegratedLoudnessOfMono",
+          _testIntegratedLoudnessOfMono);
+  addTest(testSuite, "IntegratedLoudnessOfSilence",
+          _testIntegratedLoudnessOfSilence);
+  addTest(testSuite, "TruePeakBetweenSamples", _testTruePeakBetweenSamples);
+  addTest(testSuite, "FreeNull", _testFreeNullLoudnessMeter);
+  return testSuite;
+}
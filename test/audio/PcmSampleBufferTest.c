@@ -26,11 +26,45 @@
 
 #include "audio/PcmSampleBuffer.h"
 
+#include "audio/AudioSettings.h"
 #include "audio/SampleBuffer.h"
 #include "base/Endian.h"
 #include "base/PlatformInfo.h"
 #include "unit/TestRunner.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+// Not a multiple of any vector width, so that the remainder of each block is
+// converted as well
+static const SampleCount kPcmSampleBufferTestOddBlocksize = 37;
+
+static Sample _getTestSample(ChannelCount channel, SampleCount frame) {
+  return (Sample)(((int)frame * 7 + (int)channel * 3) % 21 - 10) / 10.0f;
+}
+
+// Get a 24-bit sample written by setSampleBuffer(), which packs the samples
+// into 3 bytes each unless audiofile expands them to integers
+static int _get24BitPcmSample(const PcmSampleBuffer psb, size_t index) {
+#if USE_AUDIOFILE
+  return ((int *)psb->pcmSamples)[index];
+#else
+  const byte *bytes = (const byte *)psb->pcmSamples + index * 3;
+
+  if (psb->littleEndian) {
+    return (int)(((unsigned int)bytes[2] << 24) |
+                 ((unsigned int)bytes[1] << 16) |
+                 ((unsigned int)bytes[0] << 8)) >>
+           8;
+  } else {
+    return (int)(((unsigned int)bytes[0] << 24) |
+                 ((unsigned int)bytes[1] << 16) |
+                 ((unsigned int)bytes[2] << 8)) >>
+           8;
+  }
+#endif
+}
+
 static int _testNewPcmSampleBuffer(void) {
   PcmSampleBuffer psb = newPcmSampleBuffer(1, 512, kBitDepth24Bit);
 
@@ -115,6 +149,119 @@ static int _testSetSampleBuffer16BitStereo(void) {
   return 0;
 }
 
+static int _testSetSampleBuffer16BitOddBlocksize(ChannelCount numChannels) {
+  SampleBuffer source =
+      newSampleBuffer(numChannels, kPcmSampleBufferTestOddBlocksize);
+  PcmSampleBuffer dest = newPcmSampleBuffer(
+      numChannels, kPcmSampleBufferTestOddBlocksize, kBitDepth16Bit);
+  short *shortSamples = (short *)(dest->pcmSamples);
+  ChannelCount channel;
+  SampleCount frame;
+
+  for (channel = 0; channel < numChannels; ++channel) {
+    for (frame = 0; frame < source->blocksize; ++frame) {
+      source->samples[channel][frame] = _getTestSample(channel, frame);
+    }
+  }
+
+  dest->setSampleBuffer(dest, source);
+
+  for (frame = 0; frame < source->blocksize; ++frame) {
+    for (channel = 0; channel < numChannels; ++channel) {
+      assertIntEquals((short)(source->samples[channel][frame] * 32767.0),
+                      shortSamples[frame * numChannels + channel]);
+    }
+  }
+
+  freePcmSampleBuffer(dest);
+  freeSampleBuffer(source);
+  return 0;
+}
+
+static int _testSetSampleBuffer16BitMonoOddBlocksize(void) {
+  return _testSetSampleBuffer16BitOddBlocksize(1);
+}
+
+static int _testSetSampleBuffer16BitStereoOddBlocksize(void) {
+  return _testSetSampleBuffer16BitOddBlocksize(2);
+}
+
+static int _testSetSampleBuffer16BitSurroundOddBlocksize(void) {
+  return _testSetSampleBuffer16BitOddBlocksize(6);
+}
+
+static int _testSetSampleBuffer16BitThreeChannelsOddBlocksize(void) {
+  return _testSetSampleBuffer16BitOddBlocksize(3);
+}
+
+static int _testSetSampleBufferDithered(BitDepth bitDepth,
+                                        ChannelCount numChannels,
+                                        DitherType ditherType) {
+  SampleBuffer source =
+      newSampleBuffer(numChannels, kPcmSampleBufferTestOddBlocksize);
+  PcmSampleBuffer dest = newPcmSampleBuffer(
+      numChannels, kPcmSampleBufferTestOddBlocksize, bitDepth);
+  const int maxValue = bitDepth == kBitDepth16Bit ? 32767 : 8388607;
+  // TPDF dither changes each sample by at most 1 LSB plus rounding, and noise
+  // shaping adds up to 3 times the largest error on top of that
+  const double tolerance = ditherType == kDitherTypeTpdf ? 1.5 : 6.0;
+  double expected;
+  int value;
+  ChannelCount channel;
+  SampleCount frame;
+
+  for (channel = 0; channel < numChannels; ++channel) {
+    for (frame = 0; frame < source->blocksize; ++frame) {
+      // Go past full scale to check that the samples are clipped
+      source->samples[channel][frame] = _getTestSample(channel, frame) * 2.0f;
+    }
+  }
+
+  setDitherType(ditherType);
+  dest->setSampleBuffer(dest, source);
+  setDitherType(kDitherTypeNone);
+
+  for (frame = 0; frame < source->blocksize; ++frame) {
+    for (channel = 0; channel < numChannels; ++channel) {
+      if (bitDepth == kBitDepth16Bit) {
+        value = ((short *)dest->pcmSamples)[frame * numChannels + channel];
+      } else {
+        value = _get24BitPcmSample(dest, frame * numChannels + channel);
+      }
+
+      expected = source->samples[channel][frame] * (double)maxValue;
+
+      if (expected >= maxValue) {
+        assertIntEquals(maxValue, value);
+      } else if (expected <= -maxValue - 1) {
+        assertIntEquals(-maxValue - 1, value);
+      } else {
+        assertDoubleEquals(expected, value, tolerance);
+      }
+    }
+  }
+
+  freePcmSampleBuffer(dest);
+  freeSampleBuffer(source);
+  return 0;
+}
+
+static int _testSetSampleBuffer16BitMonoDithered(void) {
+  return _testSetSampleBufferDithered(kBitDepth16Bit, 1, kDitherTypeTpdf);
+}
+
+static int _testSetSampleBuffer16BitStereoDithered(void) {
+  return _testSetSampleBufferDithered(kBitDepth16Bit, 2, kDitherTypeTpdf);
+}
+
+static int _testSetSampleBuffer16BitStereoNoiseShaped(void) {
+  return _testSetSampleBufferDithered(kBitDepth16Bit, 2, kDitherTypeShaped);
+}
+
+static int _testSetSampleBuffer24BitStereoDithered(void) {
+  return _testSetSampleBufferDithered(kBitDepth24Bit, 2, kDitherTypeTpdf);
+}
+
 static int _testSetSampleBuffer24Bit(void) {
   SampleBuffer source = newSampleBuffer(1, 4);
   PcmSampleBuffer dest = newPcmSampleBuffer(1, 4, kBitDepth24Bit);
@@ -124,16 +271,59 @@ static int _testSetSampleBuffer24Bit(void) {
   source->samples[0][2] = -0.5f;
   source->samples[0][3] = 1.0f;
   dest->setSampleBuffer(dest, source);
-  assertIntEquals(0, ((int *)dest->pcmSamples)[0]);
-  assertIntEquals(4194303, ((int *)dest->pcmSamples)[1]);
-  assertIntEquals(-4194303, ((int *)dest->pcmSamples)[2]);
-  assertIntEquals(8388607, ((int *)dest->pcmSamples)[3]);
+  assertIntEquals(0, _get24BitPcmSample(dest, 0));
+  assertIntEquals(4194303, _get24BitPcmSample(dest, 1));
+  assertIntEquals(-4194303, _get24BitPcmSample(dest, 2));
+  assertIntEquals(8388607, _get24BitPcmSample(dest, 3));
+
+  freePcmSampleBuffer(dest);
+  freeSampleBuffer(source);
+  return 0;
+}
+
+static int _testSetSampleBuffer24BitOddBlocksize(ChannelCount numChannels,
+                                                 boolByte littleEndian) {
+  SampleBuffer source =
+      newSampleBuffer(numChannels, kPcmSampleBufferTestOddBlocksize);
+  PcmSampleBuffer dest = newPcmSampleBuffer(
+      numChannels, kPcmSampleBufferTestOddBlocksize, kBitDepth24Bit);
+  ChannelCount channel;
+  SampleCount frame;
+
+  dest->littleEndian = littleEndian;
+
+  for (channel = 0; channel < numChannels; ++channel) {
+    for (frame = 0; frame < source->blocksize; ++frame) {
+      source->samples[channel][frame] = _getTestSample(channel, frame);
+    }
+  }
+
+  dest->setSampleBuffer(dest, source);
+
+  for (frame = 0; frame < source->blocksize; ++frame) {
+    for (channel = 0; channel < numChannels; ++channel) {
+      assertIntEquals((int)(source->samples[channel][frame] * 8388607.0),
+                      _get24BitPcmSample(dest, frame * numChannels + channel));
+    }
+  }
 
   freePcmSampleBuffer(dest);
   freeSampleBuffer(source);
   return 0;
 }
 
+static int _testSetSampleBuffer24BitMonoOddBlocksize(void) {
+  return _testSetSampleBuffer24BitOddBlocksize(1, true);
+}
+
+static int _testSetSampleBuffer24BitStereoOddBlocksize(void) {
+  return _testSetSampleBuffer24BitOddBlocksize(2, true);
+}
+
+static int _testSetSampleBuffer24BitStereoBigEndianOddBlocksize(void) {
+  return _testSetSampleBuffer24BitOddBlocksize(2, false);
+}
+
 static int _testSetSampleBuffer32Bit(void) {
   SampleBuffer source = newSampleBuffer(1, 4);
   PcmSampleBuffer dest = newPcmSampleBuffer(1, 4, kBitDepth32Bit);
@@ -157,6 +347,51 @@ static int _testSetSampleBuffer32Bit(void) {
   return 0;
 }
 
+static int _testSetSampleBuffer32BitOddBlocksize(ChannelCount numChannels) {
+  SampleBuffer source =
+      newSampleBuffer(numChannels, kPcmSampleBufferTestOddBlocksize);
+  PcmSampleBuffer dest = newPcmSampleBuffer(
+      numChannels, kPcmSampleBufferTestOddBlocksize, kBitDepth32Bit);
+  const float *floatSamples = (const float *)dest->pcmSamples;
+  ChannelCount channel;
+  SampleCount frame;
+
+  for (frame = 0; frame < source->blocksize; ++frame) {
+    for (channel = 0; channel < numChannels; ++channel) {
+      source->samples[channel][frame] = _getTestSample(channel, frame);
+    }
+  }
+
+  dest->setSampleBuffer(dest, source);
+
+  for (frame = 0; frame < source->blocksize; ++frame) {
+    for (channel = 0; channel < numChannels; ++channel) {
+      assert((float)source->samples[channel][frame] ==
+             floatSamples[frame * numChannels + channel]);
+    }
+  }
+
+  freePcmSampleBuffer(dest);
+  freeSampleBuffer(source);
+  return 0;
+}
+
+static int _testSetSampleBuffer32BitMonoOddBlocksize(void) {
+  return _testSetSampleBuffer32BitOddBlocksize(1);
+}
+
+static int _testSetSampleBuffer32BitStereoOddBlocksize(void) {
+  return _testSetSampleBuffer32BitOddBlocksize(2);
+}
+
+static int _testSetSampleBuffer32BitQuadOddBlocksize(void) {
+  return _testSetSampleBuffer32BitOddBlocksize(4);
+}
+
+static int _testSetSampleBuffer32BitSurroundOddBlocksize(void) {
+  return _testSetSampleBuffer32BitOddBlocksize(6);
+}
+
 static int _testSetSamples8Bit(void) {
   PcmSampleBuffer psb = newPcmSampleBuffer(1, 4, kBitDepth8Bit);
   psb->littleEndian = true;
@@ -448,6 +683,407 @@ static int _testSetSamples32BitLittleEndian(void) {
   return 0;
 }
 
+static int _testSetSamples16BitOddBlocksize(ChannelCount numChannels) {
+  PcmSampleBuffer psb = newPcmSampleBuffer(
+      numChannels, kPcmSampleBufferTestOddBlocksize, kBitDepth16Bit);
+  short *shortSamples = (short *)(psb->pcmSamples);
+  const SampleCount numSamples = kPcmSampleBufferTestOddBlocksize * numChannels;
+  ChannelCount channel;
+  SampleCount sample;
+
+  // Use native byte order so that no swapping is done
+  psb->littleEndian = platformInfoIsLittleEndian();
+
+  for (sample = 0; sample < numSamples; ++sample) {
+    // Cover the full range, including both extremes
+    shortSamples[sample] =
+        (short)(-32768 + (sample * 65535) / (numSamples - 1));
+  }
+
+  psb->setSamples(psb);
+  Samples *psbSamples = psb->getSampleBuffer(psb)->samples;
+
+  for (sample = 0; sample < numSamples; ++sample) {
+    channel = (ChannelCount)(sample % numChannels);
+    const Sample expected = (Sample)((double)shortSamples[sample] / 32767.0);
+    assert(expected == psbSamples[channel][sample / numChannels]);
+  }
+
+  freePcmSampleBuffer(psb);
+  return 0;
+}
+
+static int _testSetSamples16BitMonoOddBlocksize(void) {
+  return _testSetSamples16BitOddBlocksize(1);
+}
+
+static int _testSetSamples16BitStereoOddBlocksize(void) {
+  return _testSetSamples16BitOddBlocksize(2);
+}
+
+static int _testSetSamples16BitSurroundOddBlocksize(void) {
+  return _testSetSamples16BitOddBlocksize(6);
+}
+
+static int _testSetSamples16BitThreeChannelsOddBlocksize(void) {
+  return _testSetSamples16BitOddBlocksize(3);
+}
+
+static int _testSetSamples16BitByteOrderChanged(void) {
+  PcmSampleBuffer psb = newPcmSampleBuffer(2, 2, kBitDepth16Bit);
+  short *shortSamples = (short *)(psb->pcmSamples);
+  Samples *psbSamples = psb->getSampleBuffer(psb)->samples;
+
+  shortSamples[0] = 0x0100;
+  shortSamples[1] = 0x0200;
+  shortSamples[2] = 0x0300;
+  shortSamples[3] = 0x0400;
+
+  psb->littleEndian = platformInfoIsLittleEndian();
+  psb->setSamples(psb);
+  assert(psbSamples[1][1] == (Sample)(0x0400 / 32767.0));
+
+  // The conversion must follow a change of byte order after the first block
+  psb->littleEndian = (boolByte)!platformInfoIsLittleEndian();
+  psb->setSamples(psb);
+  assert(psbSamples[0][0] == (Sample)(0x0001 / 32767.0));
+  assert(psbSamples[1][0] == (Sample)(0x0002 / 32767.0));
+  assert(psbSamples[0][1] == (Sample)(0x0003 / 32767.0));
+  assert(psbSamples[1][1] == (Sample)(0x0004 / 32767.0));
+
+  freePcmSampleBuffer(psb);
+  return 0;
+}
+
+#if !USE_AUDIOFILE
+static int _testSetSamples24BitOddBlocksize(ChannelCount numChannels,
+                                            boolByte littleEndian) {
+  PcmSampleBuffer psb = newPcmSampleBuffer(
+      numChannels, kPcmSampleBufferTestOddBlocksize, kBitDepth24Bit);
+  byte *bytes = (byte *)(psb->pcmSamples);
+  const SampleCount numSamples = kPcmSampleBufferTestOddBlocksize * numChannels;
+  ChannelCount channel;
+  SampleCount sample;
+  int value;
+
+  psb->littleEndian = littleEndian;
+
+  for (sample = 0; sample < numSamples; ++sample) {
+    // Cover the full range, including both extremes
+    value = (int)(-8388608 + (sample * 16777215) / (numSamples - 1));
+    bytes[sample * 3] = (byte)((littleEndian ? value : value >> 16) & 0xff);
+    bytes[sample * 3 + 1] = (byte)((value >> 8) & 0xff);
+    bytes[sample * 3 + 2] = (byte)((littleEndian ? value >> 16 : value) & 0xff);
+  }
+
+  psb->setSamples(psb);
+  Samples *psbSamples = psb->getSampleBuffer(psb)->samples;
+
+  for (sample = 0; sample < numSamples; ++sample) {
+    channel = (ChannelCount)(sample % numChannels);
+    value = (int)(-8388608 + (sample * 16777215) / (numSamples - 1));
+    const Sample expected = (Sample)((double)value / 8388607.0);
+    assert(expected == psbSamples[channel][sample / numChannels]);
+  }
+
+  freePcmSampleBuffer(psb);
+  return 0;
+}
+
+static int _testSetSamples24BitMonoOddBlocksize(void) {
+  return _testSetSamples24BitOddBlocksize(1, true);
+}
+
+static int _testSetSamples24BitStereoOddBlocksize(void) {
+  return _testSetSamples24BitOddBlocksize(2, true);
+}
+
+static int _testSetSamples24BitStereoBigEndianOddBlocksize(void) {
+  return _testSetSamples24BitOddBlocksize(2, false);
+}
+#endif
+
+static int _testSetSamples32BitStereoOddBlocksize(void) {
+  PcmSampleBuffer psb = newPcmSampleBuffer(
+      2, kPcmSampleBufferTestOddBlocksize, kBitDepth32Bit);
+  float *floatSamples = (float *)(psb->pcmSamples);
+  SampleCount frame;
+
+  psb->littleEndian = platformInfoIsLittleEndian();
+
+  for (frame = 0; frame < kPcmSampleBufferTestOddBlocksize; ++frame) {
+    floatSamples[frame * 2] = _getTestSample(0, frame);
+    floatSamples[frame * 2 + 1] = _getTestSample(1, frame);
+  }
+
+  psb->setSamples(psb);
+  Samples *psbSamples = psb->getSampleBuffer(psb)->samples;
+
+  // Compared to the float values in the file, since the samples may be
+  // doubles which the test samples can't be rounded to
+  for (frame = 0; frame < kPcmSampleBufferTestOddBlocksize; ++frame) {
+    assert(floatSamples[frame * 2] == psbSamples[0][frame]);
+    assert(floatSamples[frame * 2 + 1] == psbSamples[1][frame]);
+  }
+
+  freePcmSampleBuffer(psb);
+  return 0;
+}
+
+static int _testConvertAndMapChannels(ChannelCount pcmChannels,
+                                      ChannelCount numChannels) {
+  PcmSampleBuffer psb = newPcmSampleBuffer(
+      pcmChannels, kPcmSampleBufferTestOddBlocksize, kBitDepth16Bit);
+  SampleBuffer sampleBuffer =
+      newSampleBuffer(numChannels, kPcmSampleBufferTestOddBlocksize);
+  short *shortSamples = (short *)(psb->pcmSamples);
+  ChannelCount channel;
+  SampleCount frame;
+
+  psb->littleEndian = platformInfoIsLittleEndian();
+
+  for (frame = 0; frame < kPcmSampleBufferTestOddBlocksize; ++frame) {
+    for (channel = 0; channel < pcmChannels; ++channel) {
+      shortSamples[frame * pcmChannels + channel] =
+          (short)(_getTestSample(channel, frame) * 32767.0f);
+    }
+  }
+
+  pcmSampleBufferConvertAndMapChannels(psb, psb->pcmSamples, pcmChannels,
+                                       sampleBuffer);
+
+  // Channels are repeated or dropped like in sampleBufferCopyAndMapChannels()
+  for (frame = 0; frame < kPcmSampleBufferTestOddBlocksize; ++frame) {
+    for (channel = 0; channel < numChannels; ++channel) {
+      const short expected =
+          shortSamples[frame * pcmChannels + channel % pcmChannels];
+      assert((Sample)((double)expected / 32767.0) ==
+             sampleBuffer->samples[channel][frame]);
+    }
+  }
+
+  freeSampleBuffer(sampleBuffer);
+  freePcmSampleBuffer(psb);
+  return 0;
+}
+
+static int _testConvertAndMapChannelsMonoToStereo(void) {
+  return _testConvertAndMapChannels(1, 2);
+}
+
+static int _testConvertAndMapChannelsStereoToMono(void) {
+  return _testConvertAndMapChannels(2, 1);
+}
+
+static int _testConvertAndMapChannelsStereoToSurround(void) {
+  return _testConvertAndMapChannels(2, 6);
+}
+
+// Scale PCM data with pcmSamplesApplyGain(), and compare it to converting the
+// same data to a sample buffer, scaling that like the gain plugin does and
+// converting it back
+static int _testApplyGainMatchesFloatPath(const BitDepth bitDepth,
+                                          const Sample gain) {
+  // Every 16-bit value, or every 256th 24-bit value
+  const SampleCount blocksize = 65536;
+  const size_t bytesPerSample = (size_t)(bitDepth / 8);
+  PcmSampleBuffer psb = newPcmSampleBuffer(1, blocksize, bitDepth);
+  SampleBuffer sampleBuffer = newSampleBuffer(1, blocksize);
+  byte *input = (byte *)malloc(blocksize * bytesPerSample);
+  byte *output = (byte *)malloc(blocksize * bytesPerSample);
+  int value;
+
+  for (SampleCount i = 0; i < blocksize; i++) {
+    if (bitDepth == kBitDepth16Bit) {
+      ((short *)input)[i] = (short)((int)i - 32768);
+    } else {
+      value = (int)i * 256 + (int)(i % 256) - 8388608;
+      input[i * 3] = (byte)(value & 0xff);
+      input[i * 3 + 1] = (byte)((value >> 8) & 0xff);
+      input[i * 3 + 2] = (byte)((value >> 16) & 0xff);
+    }
+  }
+
+  pcmSampleBufferConvertToSampleBuffer(psb, input, sampleBuffer);
+  sampleBufferScale(sampleBuffer, gain);
+  psb->setSampleBuffer(psb, sampleBuffer);
+
+  assert(pcmSamplesApplyGain(input, output, blocksize, bitDepth, gain));
+  assertIntEquals(0, memcmp(psb->pcmSamples, output,
+                            blocksize * bytesPerSample));
+
+  // Scaling in place gives the same result
+  assert(pcmSamplesApplyGain(input, input, blocksize, bitDepth, gain));
+  assertIntEquals(0, memcmp(input, output, blocksize * bytesPerSample));
+
+  free(input);
+  free(output);
+  freeSampleBuffer(sampleBuffer);
+  freePcmSampleBuffer(psb);
+  return 0;
+}
+
+static int _testApplyGain16Bit(void) {
+  return _testApplyGainMatchesFloatPath(kBitDepth16Bit, 0.3f);
+}
+
+static int _testApplyGain16BitHalf(void) {
+  return _testApplyGainMatchesFloatPath(kBitDepth16Bit, 0.5f);
+}
+
+static int _testApplyGain16BitUnity(void) {
+  return _testApplyGainMatchesFloatPath(kBitDepth16Bit, 1.0f);
+}
+
+#if !USE_AUDIOFILE
+static int _testApplyGain24Bit(void) {
+  return _testApplyGainMatchesFloatPath(kBitDepth24Bit, 0.3f);
+}
+
+static int _testApplyGain24BitUnity(void) {
+  return _testApplyGainMatchesFloatPath(kBitDepth24Bit, 1.0f);
+}
+#endif
+
+static int _testApplyGainInvalidBitDepth(void) {
+  float samples[2] = {0.5f, -0.5f};
+  assertFalse(pcmSamplesApplyGain(samples, samples, 2, kBitDepth32Bit, 0.5f));
+  return 0;
+}
+
+typedef struct {
+  PcmSampleBuffer pcmSampleBuffer;
+  SampleBuffer sampleBuffer;
+} _PcmSampleBufferBenchmarkData;
+
+static void *_setupPcmSampleBufferBenchmark(const BitDepth bitDepth) {
+  _PcmSampleBufferBenchmarkData *data = (_PcmSampleBufferBenchmarkData *)malloc(
+      sizeof(_PcmSampleBufferBenchmarkData));
+  ChannelCount channel;
+  SampleCount frame;
+
+  data->pcmSampleBuffer =
+      newPcmSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE, bitDepth);
+  data->sampleBuffer = newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+
+  for (channel = 0; channel < data->sampleBuffer->numChannels; channel++) {
+    for (frame = 0; frame < data->sampleBuffer->blocksize; frame++) {
+      data->sampleBuffer->samples[channel][frame] =
+          _getTestSample(channel, frame);
+    }
+  }
+
+  // Also fill the PCM data for the benchmarks which read it
+  data->pcmSampleBuffer->setSampleBuffer(data->pcmSampleBuffer,
+                                         data->sampleBuffer);
+  return data;
+}
+
+static void *_setupPcmSampleBuffer16BitBenchmark(void) {
+  return _setupPcmSampleBufferBenchmark(kBitDepth16Bit);
+}
+
+static void *_setupPcmSampleBuffer24BitBenchmark(void) {
+  return _setupPcmSampleBufferBenchmark(kBitDepth24Bit);
+}
+
+static void _benchmarkSetSampleBuffer(void *context) {
+  _PcmSampleBufferBenchmarkData *data =
+      (_PcmSampleBufferBenchmarkData *)context;
+  data->pcmSampleBuffer->setSampleBuffer(data->pcmSampleBuffer,
+                                         data->sampleBuffer);
+}
+
+static void _benchmarkSetSamples(void *context) {
+  _PcmSampleBufferBenchmarkData *data =
+      (_PcmSampleBufferBenchmarkData *)context;
+  data->pcmSampleBuffer->setSamples(data->pcmSampleBuffer);
+}
+
+static void _teardownPcmSampleBufferBenchmark(void *context) {
+  _PcmSampleBufferBenchmarkData *data =
+      (_PcmSampleBufferBenchmarkData *)context;
+  freePcmSampleBuffer(data->pcmSampleBuffer);
+  freeSampleBuffer(data->sampleBuffer);
+  free(data);
+}
+
+// Convert the same samples to little and big-endian PCM, which must hold the
+// same bytes in reverse order, and back again. The odd blocksize covers both
+// the vectorized conversions and the scalar code which finishes the block.
+static int _testBigEndianRoundTrip(BitDepth bitDepth,
+                                   ChannelCount numChannels) {
+  SampleBuffer source =
+      newSampleBuffer(numChannels, kPcmSampleBufferTestOddBlocksize);
+  PcmSampleBuffer little = newPcmSampleBuffer(
+      numChannels, kPcmSampleBufferTestOddBlocksize, bitDepth);
+  PcmSampleBuffer big = newPcmSampleBuffer(
+      numChannels, kPcmSampleBufferTestOddBlocksize, bitDepth);
+  const size_t bytesPerSample = (size_t)little->bytesPerSample;
+  const size_t numSamples =
+      (size_t)kPcmSampleBufferTestOddBlocksize * numChannels;
+  const byte *littleBytes = (const byte *)little->pcmSamples;
+  const byte *bigBytes = (const byte *)big->pcmSamples;
+  ChannelCount channel;
+  SampleCount frame;
+  size_t sample;
+  size_t i;
+
+  big->littleEndian = false;
+
+  for (channel = 0; channel < numChannels; ++channel) {
+    for (frame = 0; frame < source->blocksize; ++frame) {
+      source->samples[channel][frame] = _getTestSample(channel, frame);
+    }
+  }
+
+  little->setSampleBuffer(little, source);
+  big->setSampleBuffer(big, source);
+
+  for (sample = 0; sample < numSamples; ++sample) {
+    for (i = 0; i < bytesPerSample; ++i) {
+      assertIntEquals(
+          littleBytes[sample * bytesPerSample + i],
+          bigBytes[sample * bytesPerSample + bytesPerSample - 1 - i]);
+    }
+  }
+
+  little->setSamples(little);
+  big->setSamples(big);
+
+  for (channel = 0; channel < numChannels; ++channel) {
+    for (frame = 0; frame < source->blocksize; ++frame) {
+      assert(little->_super->samples[channel][frame] ==
+             big->_super->samples[channel][frame]);
+    }
+  }
+
+  freePcmSampleBuffer(little);
+  freePcmSampleBuffer(big);
+  freeSampleBuffer(source);
+  return 0;
+}
+
+static int _testBigEndianRoundTrip16BitMono(void) {
+  return _testBigEndianRoundTrip(kBitDepth16Bit, 1);
+}
+
+static int _testBigEndianRoundTrip16BitStereo(void) {
+  return _testBigEndianRoundTrip(kBitDepth16Bit, 2);
+}
+
+static int _testBigEndianRoundTrip32BitMono(void) {
+  return _testBigEndianRoundTrip(kBitDepth32Bit, 1);
+}
+
+static int _testBigEndianRoundTrip32BitStereo(void) {
+  return _testBigEndianRoundTrip(kBitDepth32Bit, 2);
+}
+
+static int _testBigEndianRoundTrip32BitQuad(void) {
+  return _testBigEndianRoundTrip(kBitDepth32Bit, 4);
+}
+
 TestSuite addPcmSampleBufferTests(void);
 TestSuite addPcmSampleBufferTests(void) {
   TestSuite testSuite = newTestSuite("PcmSampleBuffer", NULL, NULL);
@@ -457,8 +1093,38 @@ TestSuite addPcmSampleBufferTests(void) {
   addTest(testSuite, "SetSampleBuffer16Bit", _testSetSampleBuffer16Bit);
   addTest(testSuite, "SetSampleBuffer16BitStereo",
           _testSetSampleBuffer16BitStereo);
+  addTest(testSuite, "SetSampleBuffer16BitMonoOddBlocksize",
+          _testSetSampleBuffer16BitMonoOddBlocksize);
+  addTest(testSuite, "SetSampleBuffer16BitStereoOddBlocksize",
+          _testSetSampleBuffer16BitStereoOddBlocksize);
+  addTest(testSuite, "SetSampleBuffer16BitSurroundOddBlocksize",
+          _testSetSampleBuffer16BitSurroundOddBlocksize);
+  addTest(testSuite, "SetSampleBuffer16BitThreeChannelsOddBlocksize",
+          _testSetSampleBuffer16BitThreeChannelsOddBlocksize);
+  addTest(testSuite, "SetSampleBuffer16BitMonoDithered",
+          _testSetSampleBuffer16BitMonoDithered);
+  addTest(testSuite, "SetSampleBuffer16BitStereoDithered",
+          _testSetSampleBuffer16BitStereoDithered);
+  addTest(testSuite, "SetSampleBuffer16BitStereoNoiseShaped",
+          _testSetSampleBuffer16BitStereoNoiseShaped);
   addTest(testSuite, "SetSampleBuffer24Bit", _testSetSampleBuffer24Bit);
+  addTest(testSuite, "SetSampleBuffer24BitMonoOddBlocksize",
+          _testSetSampleBuffer24BitMonoOddBlocksize);
+  addTest(testSuite, "SetSampleBuffer24BitStereoOddBlocksize",
+          _testSetSampleBuffer24BitStereoOddBlocksize);
+  addTest(testSuite, "SetSampleBuffer24BitStereoBigEndianOddBlocksize",
+          _testSetSampleBuffer24BitStereoBigEndianOddBlocksize);
+  addTest(testSuite, "SetSampleBuffer24BitStereoDithered",
+          _testSetSampleBuffer24BitStereoDithered);
   addTest(testSuite, "SetSampleBuffer32Bit", _testSetSampleBuffer32Bit);
+  addTest(testSuite, "SetSampleBuffer32BitMonoOddBlocksize",
+          _testSetSampleBuffer32BitMonoOddBlocksize);
+  addTest(testSuite, "SetSampleBuffer32BitStereoOddBlocksize",
+          _testSetSampleBuffer32BitStereoOddBlocksize);
+  addTest(testSuite, "SetSampleBuffer32BitQuadOddBlocksize",
+          _testSetSampleBuffer32BitQuadOddBlocksize);
+  addTest(testSuite, "SetSampleBuffer32BitSurroundOddBlocksize",
+          _testSetSampleBuffer32BitSurroundOddBlocksize);
   addTest(testSuite, "SetSamples8Bit", _testSetSamples8Bit);
   addTest(testSuite, "SetSamples16BitBigEndian", _testSetSamples16BitBigEndian);
   addTest(testSuite, "SetSamples16BitLittleEndian",
@@ -470,6 +1136,66 @@ TestSuite addPcmSampleBufferTests(void) {
   addTest(testSuite, "SetSamples32BitBigEndian", _testSetSamples32BitBigEndian);
   addTest(testSuite, "SetSamples32BitLittleEndian",
           _testSetSamples32BitLittleEndian);
+  addTest(testSuite, "SetSamples16BitMonoOddBlocksize",
+          _testSetSamples16BitMonoOddBlocksize);
+  addTest(testSuite, "SetSamples16BitStereoOddBlocksize",
+          _testSetSamples16BitStereoOddBlocksize);
+  addTest(testSuite, "SetSamples16BitSurroundOddBlocksize",
+          _testSetSamples16BitSurroundOddBlocksize);
+  addTest(testSuite, "BigEndianRoundTrip16BitMono",
+          _testBigEndianRoundTrip16BitMono);
+  addTest(testSuite, "BigEndianRoundTrip16BitStereo",
+          _testBigEndianRoundTrip16BitStereo);
+  addTest(testSuite, "BigEndianRoundTrip32BitMono",
+          _testBigEndianRoundTrip32BitMono);
+  addTest(testSuite, "BigEndianRoundTrip32BitStereo",
+          _testBigEndianRoundTrip32BitStereo);
+  addTest(testSuite, "BigEndianRoundTrip32BitQuad",
+          _testBigEndianRoundTrip32BitQuad);
+  addTest(testSuite, "SetSamples16BitThreeChannelsOddBlocksize",
+          _testSetSamples16BitThreeChannelsOddBlocksize);
+  addTest(testSuite, "SetSamples16BitByteOrderChanged",
+          _testSetSamples16BitByteOrderChanged);
+#if !USE_AUDIOFILE
+  addTest(testSuite, "SetSamples24BitMonoOddBlocksize",
+          _testSetSamples24BitMonoOddBlocksize);
+  addTest(testSuite, "SetSamples24BitStereoOddBlocksize",
+          _testSetSamples24BitStereoOddBlocksize);
+  addTest(testSuite, "SetSamples24BitStereoBigEndianOddBlocksize",
+          _testSetSamples24BitStereoBigEndianOddBlocksize);
+#endif
+  addTest(testSuite, "SetSamples32BitStereoOddBlocksize",
+          _testSetSamples32BitStereoOddBlocksize);
+  addTest(testSuite, "ConvertAndMapChannelsMonoToStereo",
+          _testConvertAndMapChannelsMonoToStereo);
+  addTest(testSuite, "ConvertAndMapChannelsStereoToMono",
+          _testConvertAndMapChannelsStereoToMono);
+  addTest(testSuite, "ConvertAndMapChannelsStereoToSurround",
+          _testConvertAndMapChannelsStereoToSurround);
+  addTest(testSuite, "ApplyGain16Bit", _testApplyGain16Bit);
+  addTest(testSuite, "ApplyGain16BitHalf", _testApplyGain16BitHalf);
+  addTest(testSuite, "ApplyGain16BitUnity", _testApplyGain16BitUnity);
+#if !USE_AUDIOFILE
+  addTest(testSuite, "ApplyGain24Bit", _testApplyGain24Bit);
+  addTest(testSuite, "ApplyGain24BitUnity", _testApplyGain24BitUnity);
+#endif
+  addTest(testSuite, "ApplyGainInvalidBitDepth",
+          _testApplyGainInvalidBitDepth);
+
+  addBenchmarkWithSetup(testSuite, "SetSampleBuffer16Bit",
+                        _setupPcmSampleBuffer16BitBenchmark,
+                        _benchmarkSetSampleBuffer,
+                        _teardownPcmSampleBufferBenchmark);
+  addBenchmarkWithSetup(testSuite, "SetSampleBuffer24Bit",
+                        _setupPcmSampleBuffer24BitBenchmark,
+                        _benchmarkSetSampleBuffer,
+                        _teardownPcmSampleBufferBenchmark);
+  addBenchmarkWithSetup(
+      testSuite, "SetSamples16Bit", _setupPcmSampleBuffer16BitBenchmark,
+      _benchmarkSetSamples, _teardownPcmSampleBufferBenchmark);
+  addBenchmarkWithSetup(
+      testSuite, "SetSamples24Bit", _setupPcmSampleBuffer24BitBenchmark,
+      _benchmarkSetSamples, _teardownPcmSampleBufferBenchmark);
 
   return testSuite;
 }
@@ -0,0 +1,147 @@
+//
+// ResamplerTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "audio/Resampler.h"
+
+#include "unit/TestRunner.h"
+
+static const SampleCount kResamplerTestBlocksize = 256;
+
+// Push numBlocks blocks of a constant value through the resampler and return
+// the total number of frames which came out. If middleOutput is not NULL, then
+// it is set to a sample from the middle of the output.
+static unsigned long _resampleConstant(Resampler resampler,
+                                       unsigned int numBlocks, Sample value,
+                                       Sample *middleOutput) {
+  SampleBuffer input = newSampleBuffer(1, kResamplerTestBlocksize);
+  SampleBuffer output = newSampleBuffer(1, kResamplerTestBlocksize);
+  unsigned long totalFrames = 0;
+  SampleCount numFrames;
+  unsigned int i;
+
+  for (i = 0; i < kResamplerTestBlocksize; ++i) {
+    input->samples[0][i] = value;
+  }
+
+  for (i = 0; i < numBlocks; ++i) {
+    resamplerPush(resampler, input);
+
+    while ((numFrames = resamplerPull(resampler, output, 0)) > 0) {
+      if (middleOutput != NULL && totalFrames <= numBlocks * 128 &&
+          totalFrames + numFrames > numBlocks * 128) {
+        *middleOutput = output->samples[0][numBlocks * 128 - totalFrames];
+      }
+
+      totalFrames += numFrames;
+    }
+  }
+
+  resamplerFinish(resampler);
+
+  while ((numFrames = resamplerPull(resampler, output, 0)) > 0) {
+    totalFrames += numFrames;
+  }
+
+  freeSampleBuffer(input);
+  freeSampleBuffer(output);
+  return totalFrames;
+}
+
+static int _testNewResamplerInvalidRates(void) {
+  assertIsNull(newResampler(1, 0.0, 48000.0, RESAMPLER_QUALITY_MEDIUM));
+  assertIsNull(newResampler(1, 44100.0, -1.0, RESAMPLER_QUALITY_MEDIUM));
+  assertIsNull(newResampler(1, 44100.0, 48000.0, NUM_RESAMPLER_QUALITIES));
+  return 0;
+}
+
+static int _testResampleSameRateKeepsLength(void) {
+  Resampler r = newResampler(1, 44100.0, 44100.0, RESAMPLER_QUALITY_LOW);
+  assertNotNull(r);
+  assertUnsignedLongEquals(10 * kResamplerTestBlocksize,
+                           _resampleConstant(r, 10, 0.5f, NULL));
+  freeResampler(r);
+  return 0;
+}
+
+static int _testResampleUpsampledLength(void) {
+  Resampler r = newResampler(1, 44100.0, 48000.0, RESAMPLER_QUALITY_MEDIUM);
+  assertNotNull(r);
+  // ceil(2560 * 48000 / 44100) = 2787
+  assertUnsignedLongEquals(2787ul, _resampleConstant(r, 10, 0.5f, NULL));
+  freeResampler(r);
+  return 0;
+}
+
+static int _testResampleDownsampledLength(void) {
+  Resampler r = newResampler(1, 48000.0, 44100.0, RESAMPLER_QUALITY_HIGH);
+  assertNotNull(r);
+  // ceil(2560 * 44100 / 48000) = 2352
+  assertUnsignedLongEquals(2352ul, _resampleConstant(r, 10, 0.5f, NULL));
+  freeResampler(r);
+  return 0;
+}
+
+static int _testResamplePreservesDc(void) {
+  Sample middle = 0.0f;
+  Resampler r = newResampler(1, 44100.0, 96000.0, RESAMPLER_QUALITY_HIGH);
+  assertNotNull(r);
+  _resampleConstant(r, 20, 0.5f, &middle);
+  assertDoubleEquals(0.5, middle, TEST_DEFAULT_TOLERANCE);
+  freeResampler(r);
+  return 0;
+}
+
+static int _testResamplerQualityFromString(void) {
+  ResamplerQuality quality = NUM_RESAMPLER_QUALITIES;
+  assert(resamplerQualityFromString("low", &quality));
+  assertIntEquals(RESAMPLER_QUALITY_LOW, quality);
+  assert(resamplerQualityFromString("high", &quality));
+  assertIntEquals(RESAMPLER_QUALITY_HIGH, quality);
+  assertFalse(resamplerQualityFromString("invalid", &quality));
+  assertIntEquals(RESAMPLER_QUALITY_HIGH, quality);
+  return 0;
+}
+
+static int _testFreeNullResampler(void) {
+  freeResampler(NULL);
+  return 0;
+}
+
+TestSuite addResamplerTests(void);
+TestSuite addResamplerTests(void) {
+  TestSuite testSuite = newTestSuite("Resampler", NULL, NULL);
+  addTest(testSuite, "NewResamplerInvalidRates", _testNewResamplerInvalidRates);
+  addTest(testSuite, "ResampleSameRateKeepsLength",
+          _testResampleSameRateKeepsLength);
+  addTest(testSuite, "ResampleUpsampledLength", _testResampleUpsampledLength);
+  addTest(testSuite, "ResampleDownsampledLength",
+          _testResampleDownsampledLength);
+  addTest(testSuite, "ResamplePreservesDc", _testResamplePreservesDc);
+  addTest(testSuite, "ResamplerQualityFromString",
+          _testResamplerQualityFromString);
+  addTest(testSuite, "FreeNullResampler", _testFreeNullResampler);
+  return testSuite;
+}
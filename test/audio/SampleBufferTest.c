@@ -27,8 +27,12 @@
 #include "audio/SampleBuffer.h"
 
 #include "audio/AudioSettings.h"
+#include "base/MemoryUsage.h"
 #include "unit/TestRunner.h"
 
+#include <math.h>
+#include <stdlib.h>
+
 static SampleBuffer _newMockSampleBuffer(void) { return newSampleBuffer(1, 1); }
 
 static int _testNewSampleBuffer(void) {
@@ -56,6 +60,59 @@ static int _testNewSampleBufferMultichannel(void) {
   return 0;
 }
 
+static int _testNewSampleBufferIsAligned(void) {
+  SampleBuffer s = newSampleBuffer(4, 100);
+  ChannelCount i;
+
+  for (i = 0; i < s->numChannels; i++) {
+    assertIntEquals(0, (int)((size_t)s->samples[i] % SAMPLE_BUFFER_ALIGNMENT));
+  }
+
+  freeSampleBuffer(s);
+  return 0;
+}
+
+static int _testNewSampleBufferIsContiguous(void) {
+  SampleBuffer s = newSampleBuffer(4, 100);
+  ChannelCount i;
+
+  // The channels are stored back to back, only separated by padding
+  for (i = 1; i < s->numChannels; i++) {
+    assert(s->samples[i] > s->samples[i - 1]);
+    assert(s->samples[i] - s->samples[i - 1] >= 100);
+    assert(s->samples[i] - s->samples[i - 1] <
+           100 + SAMPLE_BUFFER_ALIGNMENT / (int)sizeof(Sample));
+  }
+
+  freeSampleBuffer(s);
+  return 0;
+}
+
+static int _testNewSampleBufferWithChannels(void) {
+  Sample left[3] = {0.1f, 0.2f, 0.3f};
+  Sample right[3] = {-0.1f, -0.2f, -0.3f};
+  Samples channels[2];
+  SampleBuffer s;
+
+  channels[0] = left;
+  channels[1] = right;
+  s = newSampleBufferWithChannels(2, 3, channels);
+  assertIntEquals(2, s->numChannels);
+  assertUnsignedLongEquals(3l, s->blocksize);
+  // Samples are used in place and not copied
+  assert(s->samples[0] == left);
+  assert(s->samples[1] == right);
+
+  sampleBufferCopyAndMapChannelsWithGain(s, s, 2.0f);
+  assertDoubleEquals(0.6, left[2], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(-0.4, right[1], TEST_DEFAULT_TOLERANCE);
+
+  // Must not free the memory of the channels
+  freeSampleBuffer(s);
+  assertDoubleEquals(0.2, left[0], TEST_DEFAULT_TOLERANCE);
+  return 0;
+}
+
 static int _testClearSampleBuffer(void) {
   SampleBuffer s = _newMockSampleBuffer();
   s->samples[0][0] = 123;
@@ -65,6 +122,229 @@ static int _testClearSampleBuffer(void) {
   return 0;
 }
 
+static int _testClearSampleBufferWithOffset(void) {
+  SampleBuffer s = newSampleBuffer(2, 8);
+  SampleCount i;
+
+  for (i = 0; i < s->blocksize; i++) {
+    s->samples[0][i] = 1.0f;
+    s->samples[1][i] = 1.0f;
+  }
+
+  sampleBufferClearWithOffset(s, 3, 4);
+
+  for (i = 0; i < s->blocksize; i++) {
+    const Sample expected = (i >= 3 && i < 7) ? 0.0f : 1.0f;
+    assertDoubleEquals(expected, s->samples[0][i], TEST_DEFAULT_TOLERANCE);
+    assertDoubleEquals(expected, s->samples[1][i], TEST_DEFAULT_TOLERANCE);
+  }
+
+  freeSampleBuffer(s);
+  return 0;
+}
+
+static int _testSampleBufferIsSilent(void) {
+  SampleBuffer s = newSampleBuffer(2, 8);
+
+  assert(sampleBufferIsSilent(s));
+  s->samples[1][7] = 0.001f;
+  assertFalse(sampleBufferIsSilent(s));
+  // Only the frames up to the blocksize are checked
+  s->blocksize = 7;
+  assert(sampleBufferIsSilent(s));
+
+  freeSampleBuffer(s);
+  return 0;
+}
+
+static int _testSampleBufferGetPeak(void) {
+  SampleBuffer s = newSampleBuffer(2, 8);
+
+  assertDoubleEquals(0.0, sampleBufferGetPeak(s), TEST_EXACT_TOLERANCE);
+  s->samples[0][3] = 0.25f;
+  s->samples[1][5] = -0.5f;
+  assertDoubleEquals(0.5, sampleBufferGetPeak(s), TEST_DEFAULT_TOLERANCE);
+  // Only the frames up to the blocksize are checked
+  s->blocksize = 4;
+  assertDoubleEquals(0.25, sampleBufferGetPeak(s), TEST_DEFAULT_TOLERANCE);
+
+  freeSampleBuffer(s);
+  return 0;
+}
+
+static int _testSampleBufferGetPeakLongBuffer(void) {
+  // Long enough for every vector width, and not a multiple of any of them
+  SampleBuffer s = newSampleBuffer(1, 19);
+  unsigned int i;
+
+  for (i = 0; i < s->blocksize; i++) {
+    s->samples[0][i] = 0.125f;
+  }
+
+  s->samples[0][11] = -0.75f;
+  assertDoubleEquals(0.75, sampleBufferGetPeak(s), TEST_DEFAULT_TOLERANCE);
+  s->samples[0][18] = 0.875f;
+  assertDoubleEquals(0.875, sampleBufferGetPeak(s), TEST_DEFAULT_TOLERANCE);
+
+  freeSampleBuffer(s);
+  return 0;
+}
+
+static int _testSampleBufferGetRange(void) {
+  SampleBuffer s = newSampleBuffer(2, 19);
+  Sample minimum;
+  Sample maximum;
+
+  sampleBufferGetRange(s, &minimum, &maximum);
+  assertDoubleEquals(0.0, minimum, TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(0.0, maximum, TEST_EXACT_TOLERANCE);
+
+  s->samples[0][2] = -0.25f;
+  s->samples[1][17] = 0.5f;
+  sampleBufferGetRange(s, &minimum, &maximum);
+  assertDoubleEquals(-0.25, minimum, TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.5, maximum, TEST_DEFAULT_TOLERANCE);
+
+  freeSampleBuffer(s);
+  return 0;
+}
+
+static int _testSampleBufferGetRms(void) {
+  SampleBuffer s = newSampleBuffer(2, 19);
+  unsigned int i;
+
+  assertDoubleEquals(0.0, sampleBufferGetRms(s), TEST_EXACT_TOLERANCE);
+
+  for (i = 0; i < s->blocksize; i++) {
+    s->samples[0][i] = 0.5f;
+    s->samples[1][i] = -0.5f;
+  }
+
+  assertDoubleEquals(0.5, sampleBufferGetRms(s), TEST_DEFAULT_TOLERANCE);
+  // Half of the samples are silent, so the mean square is halved
+  sampleBufferClearWithOffset(s, 0, s->blocksize);
+  s->blocksize = 2;
+  s->samples[0][0] = 1.0f;
+  s->samples[1][1] = 1.0f;
+  assertDoubleEquals(sqrt(0.5), sampleBufferGetRms(s),
+                     TEST_DEFAULT_TOLERANCE);
+
+  freeSampleBuffer(s);
+  return 0;
+}
+
+static int _testSampleBufferScale(void) {
+  SampleBuffer s = newSampleBuffer(2, 19);
+  unsigned int i;
+
+  for (i = 0; i < s->blocksize; i++) {
+    s->samples[0][i] = (Sample)i;
+    s->samples[1][i] = -(Sample)i;
+  }
+
+  sampleBufferScale(s, 0.25f);
+
+  for (i = 0; i < s->blocksize; i++) {
+    assertDoubleEquals(i * 0.25, s->samples[0][i], TEST_DEFAULT_TOLERANCE);
+    assertDoubleEquals(i * -0.25, s->samples[1][i], TEST_DEFAULT_TOLERANCE);
+  }
+
+  freeSampleBuffer(s);
+  return 0;
+}
+
+static int _testSampleBufferMix(void) {
+  SampleBuffer s1 = newSampleBuffer(2, 19);
+  SampleBuffer s2 = newSampleBuffer(2, 19);
+  unsigned int i;
+
+  for (i = 0; i < s1->blocksize; i++) {
+    s1->samples[0][i] = 1.0f;
+    s1->samples[1][i] = -1.0f;
+    s2->samples[0][i] = (Sample)i;
+    s2->samples[1][i] = (Sample)i;
+  }
+
+  assert(sampleBufferMix(s1, s2, 0.5f));
+
+  for (i = 0; i < s1->blocksize; i++) {
+    assertDoubleEquals((1.0 + i * 0.5), s1->samples[0][i],
+                       TEST_DEFAULT_TOLERANCE);
+    assertDoubleEquals((-1.0 + i * 0.5), s1->samples[1][i],
+                       TEST_DEFAULT_TOLERANCE);
+    // The source buffer is not changed
+    assertDoubleEquals(i, s2->samples[0][i], TEST_EXACT_TOLERANCE);
+  }
+
+  freeSampleBuffer(s1);
+  freeSampleBuffer(s2);
+  return 0;
+}
+
+static int _testSampleBufferMixDifferentBlocksizes(void) {
+  SampleBuffer s1 = newSampleBuffer(1, 8);
+  SampleBuffer s2 = newSampleBuffer(1, 4);
+
+  s2->samples[0][0] = 1.0f;
+  assertFalse(sampleBufferMix(s1, s2, 1.0f));
+  assertDoubleEquals(0.0, s1->samples[0][0], TEST_EXACT_TOLERANCE);
+
+  freeSampleBuffer(s1);
+  freeSampleBuffer(s2);
+  return 0;
+}
+
+static int _testSampleBufferMixWithOffset(void) {
+  SampleBuffer s1 = newSampleBuffer(1, 8);
+  SampleBuffer s2 = newSampleBuffer(1, 4);
+  unsigned int i;
+
+  for (i = 0; i < s2->blocksize; i++) {
+    s2->samples[0][i] = 1.0f;
+  }
+
+  assert(sampleBufferMixWithOffset(s1, 5, s2, 1, 3, 2.0f));
+
+  for (i = 0; i < s1->blocksize; i++) {
+    assertDoubleEquals((i >= 5 ? 2.0 : 0.0), s1->samples[0][i],
+                       TEST_EXACT_TOLERANCE);
+  }
+
+  // Too many frames for the destination
+  assertFalse(sampleBufferMixWithOffset(s1, 6, s2, 0, 3, 1.0f));
+  // Too many frames for the source
+  assertFalse(sampleBufferMixWithOffset(s1, 0, s2, 2, 3, 1.0f));
+
+  freeSampleBuffer(s1);
+  freeSampleBuffer(s2);
+  return 0;
+}
+
+static int _testSampleBufferAddDifferentChannels(void) {
+  SampleBuffer s1 = newSampleBuffer(4, 1);
+  SampleBuffer s2 = newSampleBuffer(2, 1);
+  SampleBuffer empty = newSampleBuffer(0, 1);
+
+  s1->samples[3][0] = 1.0f;
+  s2->samples[0][0] = 1.0f;
+  s2->samples[1][0] = 2.0f;
+
+  assert(sampleBufferAdd(s1, s2));
+  assertDoubleEquals(1.0, s1->samples[0][0], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(2.0, s1->samples[1][0], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(1.0, s1->samples[2][0], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(3.0, s1->samples[3][0], TEST_DEFAULT_TOLERANCE);
+
+  // Adding a buffer without channels changes nothing
+  assert(sampleBufferAdd(s1, empty));
+  assertDoubleEquals(3.0, s1->samples[3][0], TEST_DEFAULT_TOLERANCE);
+
+  freeSampleBuffer(s1);
+  freeSampleBuffer(s2);
+  freeSampleBuffer(empty);
+  return 0;
+}
+
 static int _testCopyAndMapChannelsSampleBuffers(void) {
   SampleBuffer s1 = _newMockSampleBuffer();
   SampleBuffer s2 = _newMockSampleBuffer();
@@ -129,18 +409,162 @@ static int _testCopyAndMapChannelsSampleBuffersDifferentChannelsSmaller(void) {
   return 0;
 }
 
+static int _testCopyAndMapChannelsWithGain(void) {
+  // Not a multiple of the vector width, so the scalar remainder is tested too
+  SampleBuffer s1 = newSampleBuffer(2, 7);
+  SampleBuffer s2 = newSampleBuffer(2, 7);
+  unsigned int i;
+
+  for (i = 0; i < s1->blocksize; i++) {
+    s1->samples[0][i] = (Sample)i;
+    s1->samples[1][i] = -(Sample)i;
+  }
+
+  assert(sampleBufferCopyAndMapChannelsWithGain(s2, s1, 0.5f));
+
+  for (i = 0; i < s2->blocksize; i++) {
+    assertDoubleEquals(i * 0.5, s2->samples[0][i], TEST_DEFAULT_TOLERANCE);
+    assertDoubleEquals(i * -0.5, s2->samples[1][i], TEST_DEFAULT_TOLERANCE);
+  }
+
+  freeSampleBuffer(s1);
+  freeSampleBuffer(s2);
+  return 0;
+}
+
+static int _testCopyAndMapChannelsWithGainDifferentChannels(void) {
+  SampleBuffer s1 = newSampleBuffer(4, 1);
+  SampleBuffer s2 = newSampleBuffer(2, 1);
+
+  s2->samples[0][0] = 1.0;
+  s2->samples[1][0] = 2.0;
+
+  assert(sampleBufferCopyAndMapChannelsWithGain(s1, s2, 2.0f));
+  assertDoubleEquals(2.0, s1->samples[0][0], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(4.0, s1->samples[1][0], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(2.0, s1->samples[2][0], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(4.0, s1->samples[3][0], TEST_DEFAULT_TOLERANCE);
+
+  freeSampleBuffer(s1);
+  freeSampleBuffer(s2);
+  return 0;
+}
+
+static int _testCopyAndMapChannelsWithClip(void) {
+  SampleBuffer s = newSampleBuffer(1, 6);
+  const Sample input[6] = {0.5f, 1.5f, -1.5f, 1.0f, -0.25f, 3.0f};
+  const Sample expected[6] = {0.5f, 1.0f, -1.0f, 1.0f, -0.25f, 1.0f};
+  unsigned int i;
+
+  for (i = 0; i < s->blocksize; i++) {
+    s->samples[0][i] = input[i];
+  }
+
+  // Clipping in place, as the limiter does when the chain avoids copies
+  assert(sampleBufferCopyAndMapChannelsWithClip(s, s, 1.0f));
+
+  for (i = 0; i < s->blocksize; i++) {
+    assertDoubleEquals(expected[i], s->samples[0][i], TEST_DEFAULT_TOLERANCE);
+  }
+
+  freeSampleBuffer(s);
+  return 0;
+}
+
+static int _testSampleBufferCountsMemoryUsage(void) {
+  SampleBuffer s;
+
+  initMemoryUsage();
+  s = newSampleBuffer(2, 1000);
+  assert(memoryUsageInstance->current[kMemoryUsageSampleBuffers] >=
+         2 * 1000 * sizeof(Sample));
+  freeSampleBuffer(s);
+  assertSizeEquals((size_t)0,
+                   memoryUsageInstance->current[kMemoryUsageSampleBuffers]);
+  assert(memoryUsageGetPeak(kMemoryUsageSampleBuffers) >=
+         2 * 1000 * sizeof(Sample));
+
+  freeMemoryUsage();
+  return 0;
+}
+
 static int _testFreeNullSampleBuffer(void) {
   freeSampleBuffer(NULL);
   return 0;
 }
 
+typedef struct {
+  SampleBuffer input;
+  SampleBuffer output;
+} _SampleBufferBenchmarkData;
+
+static void *_setupSampleBufferBenchmark(void) {
+  _SampleBufferBenchmarkData *data =
+      (_SampleBufferBenchmarkData *)malloc(sizeof(_SampleBufferBenchmarkData));
+  data->input = newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  data->output = newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  return data;
+}
+
+static void _benchmarkClear(void *context) {
+  sampleBufferClear(((_SampleBufferBenchmarkData *)context)->output);
+}
+
+static void _benchmarkCopyAndMapChannels(void *context) {
+  _SampleBufferBenchmarkData *data = (_SampleBufferBenchmarkData *)context;
+  sampleBufferCopyAndMapChannels(data->output, data->input);
+}
+
+static void _benchmarkCopyAndMapChannelsWithGain(void *context) {
+  _SampleBufferBenchmarkData *data = (_SampleBufferBenchmarkData *)context;
+  sampleBufferCopyAndMapChannelsWithGain(data->output, data->input, 0.5f);
+}
+
+static void _benchmarkMix(void *context) {
+  _SampleBufferBenchmarkData *data = (_SampleBufferBenchmarkData *)context;
+  sampleBufferMix(data->output, data->input, 0.5f);
+}
+
+static void _benchmarkGetPeak(void *context) {
+  sampleBufferGetPeak(((_SampleBufferBenchmarkData *)context)->input);
+}
+
+static void _teardownSampleBufferBenchmark(void *context) {
+  _SampleBufferBenchmarkData *data = (_SampleBufferBenchmarkData *)context;
+  freeSampleBuffer(data->input);
+  freeSampleBuffer(data->output);
+  free(data);
+}
+
 TestSuite addSampleBufferTests(void);
 TestSuite addSampleBufferTests(void) {
   TestSuite testSuite = newTestSuite("SampleBuffer", NULL, NULL);
   addTest(testSuite, "NewObject", _testNewSampleBuffer);
   addTest(testSuite, "NewSampleBufferMultichannel",
           _testNewSampleBufferMultichannel);
+  addTest(testSuite, "NewSampleBufferIsAligned",
+          _testNewSampleBufferIsAligned);
+  addTest(testSuite, "NewSampleBufferIsContiguous",
+          _testNewSampleBufferIsContiguous);
+  addTest(testSuite, "NewSampleBufferWithChannels",
+          _testNewSampleBufferWithChannels);
   addTest(testSuite, "ClearSampleBuffer", _testClearSampleBuffer);
+  addTest(testSuite, "ClearSampleBufferWithOffset",
+          _testClearSampleBufferWithOffset);
+  addTest(testSuite, "SampleBufferIsSilent", _testSampleBufferIsSilent);
+  addTest(testSuite, "SampleBufferGetPeak", _testSampleBufferGetPeak);
+  addTest(testSuite, "SampleBufferGetPeakLongBuffer",
+          _testSampleBufferGetPeakLongBuffer);
+  addTest(testSuite, "SampleBufferGetRange", _testSampleBufferGetRange);
+  addTest(testSuite, "SampleBufferGetRms", _testSampleBufferGetRms);
+  addTest(testSuite, "SampleBufferScale", _testSampleBufferScale);
+  addTest(testSuite, "SampleBufferMix", _testSampleBufferMix);
+  addTest(testSuite, "SampleBufferMixDifferentBlocksizes",
+          _testSampleBufferMixDifferentBlocksizes);
+  addTest(testSuite, "SampleBufferMixWithOffset",
+          _testSampleBufferMixWithOffset);
+  addTest(testSuite, "SampleBufferAddDifferentChannels",
+          _testSampleBufferAddDifferentChannels);
   addTest(testSuite, "CopyAndMapChannelsSampleBuffers",
           _testCopyAndMapChannelsSampleBuffers);
   addTest(testSuite, "CopyAndMapChannelsSampleBuffersDifferentSizes",
@@ -149,6 +573,29 @@ TestSuite addSampleBufferTests(void) {
           _testCopyAndMapChannelsSampleBuffersDifferentChannelsBigger);
   addTest(testSuite, "CopyAndMapChannelsSampleBuffersDifferentChannelsSmaller",
           _testCopyAndMapChannelsSampleBuffersDifferentChannelsSmaller);
+  addTest(testSuite, "CopyAndMapChannelsWithGain",
+          _testCopyAndMapChannelsWithGain);
+  addTest(testSuite, "CopyAndMapChannelsWithGainDifferentChannels",
+          _testCopyAndMapChannelsWithGainDifferentChannels);
+  addTest(testSuite, "CopyAndMapChannelsWithClip",
+          _testCopyAndMapChannelsWithClip);
+  addTest(testSuite, "SampleBufferCountsMemoryUsage",
+          _testSampleBufferCountsMemoryUsage);
   addTest(testSuite, "FreeNullSampleBuffer", _testFreeNullSampleBuffer);
+  addBenchmarkWithSetup(testSuite, "Clear", _setupSampleBufferBenchmark,
+                        _benchmarkClear, _teardownSampleBufferBenchmark);
+  addBenchmarkWithSetup(testSuite, "CopyAndMapChannels",
+                        _setupSampleBufferBenchmark,
+                        _benchmarkCopyAndMapChannels,
+                        _teardownSampleBufferBenchmark);
+  addBenchmarkWithSetup(testSuite, "CopyAndMapChannelsWithGain",
+                        _setupSampleBufferBenchmark,
+                        _benchmarkCopyAndMapChannelsWithGain,
+                        _teardownSampleBufferBenchmark);
+  addBenchmarkWithSetup(testSuite, "Mix", _setupSampleBufferBenchmark,
+                        _benchmarkMix, _teardownSampleBufferBenchmark);
+  addBenchmarkWithSetup(testSuite, "GetPeak", _setupSampleBufferBenchmark,
+                        _benchmarkGetPeak, _teardownSampleBufferBenchmark);
+
   return testSuite;
 }
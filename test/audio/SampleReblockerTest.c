@@ -0,0 +1,224 @@
+//
+// SampleReblockerTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include "audio/SampleReblocker.h"
+
+#include "unit/TestRunner.h"
+
+typedef struct {
+  unsigned int numCalls;
+  SampleCount lastBlocksize;
+} _SampleReblockerTestCounter;
+
+static void _copyInnerBlock(void *userData, SampleBuffer inputs,
+                            SampleBuffer outputs) {
+  _SampleReblockerTestCounter *counter =
+      (_SampleReblockerTestCounter *)userData;
+  counter->numCalls++;
+  counter->lastBlocksize = inputs->blocksize;
+  sampleBufferCopyAndMapChannels(outputs, inputs);
+}
+
+// Pass a ramp through the reblocker in blocks of the given sizes, and check
+// that the output is the same ramp delayed by the expected latency
+static boolByte _passRamp(SampleReblocker r, const SampleCount *blocksizes,
+                          unsigned int numBlocks, SampleCount latency,
+                          _SampleReblockerTestCounter *counter) {
+  SampleBuffer inputs = newSampleBuffer(2, 64);
+  SampleBuffer outputs = newSampleBuffer(2, 64);
+  SampleCount frame = 0;
+  SampleCount expected;
+  boolByte result = true;
+  unsigned int i;
+  SampleCount j;
+
+  for (i = 0; i < numBlocks; i++) {
+    inputs->blocksize = blocksizes[i];
+
+    for (j = 0; j < blocksizes[i]; j++) {
+      inputs->samples[0][j] = (Sample)(frame + j + 1);
+      inputs->samples[1][j] = -(Sample)(frame + j + 1);
+    }
+
+    sampleReblockerProcess(r, inputs, outputs, _copyInnerBlock, counter);
+    result = (boolByte)(result && outputs->blocksize == blocksizes[i]);
+
+    for (j = 0; j < blocksizes[i]; j++) {
+      expected = frame + j + 1 > latency ? frame + j + 1 - latency : 0;
+      result = (boolByte)(result &&
+                          outputs->samples[0][j] == (Sample)expected &&
+                          outputs->samples[1][j] == -(Sample)expected);
+    }
+
+    frame += blocksizes[i];
+  }
+
+  freeSampleBuffer(inputs);
+  freeSampleBuffer(outputs);
+  return result;
+}
+
+static int _testGetLatency(void) {
+  assertIntEquals(512, sampleReblockerGetLatency(1024, 512));
+  assertIntEquals(768, sampleReblockerGetLatency(1024, 768));
+  assertIntEquals(0, sampleReblockerGetLatency(256, 1024));
+  assertIntEquals(0, sampleReblockerGetLatency(512, 512));
+  assertIntEquals(1023, sampleReblockerGetLatency(1024, 0));
+  return 0;
+}
+
+static int _testNewSampleReblocker(void) {
+  SampleReblocker r = newSampleReblocker(2, 1, 1024, 512);
+  assertNotNull(r);
+  assertIntEquals(2, r->numInputs);
+  assertIntEquals(1, r->numOutputs);
+  assertIntEquals(1024, r->innerBlocksize);
+  assertIntEquals(512, r->outerBlocksize);
+  assertIntEquals(512, r->latency);
+  assertIntEquals(1024, r->innerInputs->blocksize);
+  freeSampleReblocker(r);
+  return 0;
+}
+
+static int _testNewSampleReblockerInvalidBlocksize(void) {
+  assertIsNull(newSampleReblocker(2, 2, 0, 512));
+  return 0;
+}
+
+static int _testInnerBlocksLargerThanOuter(void) {
+  SampleReblocker r = newSampleReblocker(2, 2, 12, 8);
+  const SampleCount blocksizes[6] = {8, 8, 8, 8, 8, 8};
+  _SampleReblockerTestCounter counter = {0, 0};
+
+  assertIntEquals(8, r->latency);
+  assert(_passRamp(r, blocksizes, 6, 8, &counter));
+  assertUnsignedLongEquals(4ul, (unsigned long)counter.numCalls);
+  assertIntEquals(12, counter.lastBlocksize);
+  freeSampleReblocker(r);
+  return 0;
+}
+
+static int _testInnerBlocksSmallerThanOuter(void) {
+  SampleReblocker r = newSampleReblocker(2, 2, 4, 16);
+  const SampleCount blocksizes[3] = {16, 16, 16};
+  _SampleReblockerTestCounter counter = {0, 0};
+
+  assertIntEquals(0, r->latency);
+  assert(_passRamp(r, blocksizes, 3, 0, &counter));
+  assertUnsignedLongEquals(12ul, (unsigned long)counter.numCalls);
+  assertIntEquals(4, counter.lastBlocksize);
+  freeSampleReblocker(r);
+  return 0;
+}
+
+static int _testBlocksOfAnySize(void) {
+  SampleReblocker r = newSampleReblocker(2, 2, 10, 0);
+  const SampleCount blocksizes[8] = {3, 17, 1, 64, 9, 10, 2, 30};
+  _SampleReblockerTestCounter counter = {0, 0};
+
+  assertIntEquals(9, r->latency);
+  assert(_passRamp(r, blocksizes, 8, 9, &counter));
+  // Nothing is added when the output has enough latency for any blocksize
+  assertIntEquals(9, r->latency);
+  freeSampleReblocker(r);
+  return 0;
+}
+
+static int _testUnexpectedBlocksizeAddsLatency(void) {
+  SampleReblocker r = newSampleReblocker(2, 2, 4, 2);
+  const SampleCount blocksizes[4] = {1, 2, 2, 2};
+  _SampleReblockerTestCounter counter = {0, 0};
+
+  assertIntEquals(2, r->latency);
+  // After the second block, three frames are waiting for an inner block, but
+  // there were only two frames of latency in the output
+  assertFalse(_passRamp(r, blocksizes, 4, 2, &counter));
+  assertIntEquals(3, r->latency);
+  freeSampleReblocker(r);
+  return 0;
+}
+
+static int _testResetSampleReblocker(void) {
+  SampleReblocker r = newSampleReblocker(2, 2, 12, 8);
+  const SampleCount blocksizes[3] = {8, 8, 8};
+  _SampleReblockerTestCounter counter = {0, 0};
+
+  assert(_passRamp(r, blocksizes, 3, 8, &counter));
+  sampleReblockerReset(r);
+  // The ramp starts over, so the output only matches if nothing was kept
+  assert(_passRamp(r, blocksizes, 3, 8, &counter));
+  freeSampleReblocker(r);
+  return 0;
+}
+
+static int _testMissingChannelsAreSilent(void) {
+  SampleReblocker r = newSampleReblocker(2, 2, 4, 4);
+  SampleBuffer inputs = newSampleBuffer(1, 4);
+  SampleBuffer outputs = newSampleBuffer(2, 4);
+  _SampleReblockerTestCounter counter = {0, 0};
+  SampleCount i;
+
+  for (i = 0; i < 4; i++) {
+    inputs->samples[0][i] = 0.5f;
+    outputs->samples[1][i] = 1.0f;
+  }
+
+  sampleReblockerProcess(r, inputs, outputs, _copyInnerBlock, &counter);
+
+  for (i = 0; i < 4; i++) {
+    assertDoubleEquals(0.5, outputs->samples[0][i], TEST_EXACT_TOLERANCE);
+    assertDoubleEquals(0.0, outputs->samples[1][i], TEST_EXACT_TOLERANCE);
+  }
+
+  freeSampleBuffer(inputs);
+  freeSampleBuffer(outputs);
+  freeSampleReblocker(r);
+  return 0;
+}
+
+static int _testFreeNullSampleReblocker(void) {
+  freeSampleReblocker(NULL);
+  return 0;
+}
+
+TestSuite addSampleReblockerTests(void);
+TestSuite addSampleReblockerTests(void) {
+  TestSuite testSuite = newTestSuite("SampleReblocker", NULL, NULL);
+  addTest(testSuite, "GetLatency", _testGetLatency);
+  addTest(testSuite, "NewObject", _testNewSampleReblocker);
+  addTest(testSuite, "NewObjectInvalidBlocksize",
+          _testNewSampleReblockerInvalidBlocksize);
+  addTest(testSuite, "InnerBlocksLargerThanOuter",
+          _testInnerBlocksLargerThanOuter);
+  addTest(testSuite, "InnerBlocksSmallerThanOuter",
+          _testInnerBlocksSmallerThanOuter);
+  addTest(testSuite, "BlocksOfAnySize", _testBlocksOfAnySize);
+  addTest(testSuite, "UnexpectedBlocksizeAddsLatency",
+          _testUnexpectedBlocksizeAddsLatency);
+  addTest(testSuite, "Reset", _testResetSampleReblocker);
+  addTest(testSuite, "MissingChannelsAreSilent",
+          _testMissingChannelsAreSilent);
+  addTest(testSuite, "FreeNull", _testFreeNullSampleReblocker);
+  return testSuite;
+}
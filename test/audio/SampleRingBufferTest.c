@@ -0,0 +1,201 @@
+//
+// SampleRingBufferTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "audio/SampleRingBuffer.h"
+
+#include "base/Thread.h"
+#include "unit/TestRunner.h"
+
+static int _testNewSampleRingBuffer(void) {
+  SampleRingBuffer r = newSampleRingBuffer(2, 100);
+  assertNotNull(r);
+  assertIntEquals(2, r->numChannels);
+  // Rounded up to a power of two
+  assertUnsignedLongEquals(128ul, r->capacity);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, sampleRingBufferGetReadable(r));
+  assertUnsignedLongEquals(128ul, sampleRingBufferGetWritable(r));
+  freeSampleRingBuffer(r);
+  return 0;
+}
+
+static int _testWriteAndReadInterleaved(void) {
+  SampleRingBuffer r = newSampleRingBuffer(2, 4);
+  const Sample input[6] = {0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f};
+  Sample output[6] = {0.0f};
+  int i;
+
+  assertUnsignedLongEquals(3ul, sampleRingBufferWriteInterleaved(r, input, 3));
+  assertUnsignedLongEquals(3ul, sampleRingBufferGetReadable(r));
+  assertUnsignedLongEquals(3ul, sampleRingBufferReadInterleaved(r, output, 3));
+
+  for (i = 0; i < 6; i++) {
+    assertDoubleEquals(input[i], output[i], TEST_EXACT_TOLERANCE);
+  }
+
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, sampleRingBufferGetReadable(r));
+  freeSampleRingBuffer(r);
+  return 0;
+}
+
+static int _testWriteWhenFull(void) {
+  SampleRingBuffer r = newSampleRingBuffer(1, 4);
+  const Sample input[6] = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f};
+  Sample output[6] = {0.0f};
+
+  assertUnsignedLongEquals(4ul, sampleRingBufferWriteInterleaved(r, input, 6));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           sampleRingBufferWriteInterleaved(r, input, 1));
+  // Reading more than is available leaves the rest of the output untouched
+  assertUnsignedLongEquals(4ul, sampleRingBufferReadInterleaved(r, output, 6));
+  assertDoubleEquals(4.0, output[3], TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(0.0, output[4], TEST_EXACT_TOLERANCE);
+  freeSampleRingBuffer(r);
+  return 0;
+}
+
+static int _testWrapAround(void) {
+  SampleRingBuffer r = newSampleRingBuffer(1, 4);
+  const Sample input[3] = {1.0f, 2.0f, 3.0f};
+  Sample output[3] = {0.0f};
+  int i;
+
+  // Each pass starts at a different position in the ring
+  for (i = 0; i < 10; i++) {
+    assertUnsignedLongEquals(3ul,
+                             sampleRingBufferWriteInterleaved(r, input, 3));
+    assertUnsignedLongEquals(3ul,
+                             sampleRingBufferReadInterleaved(r, output, 3));
+    assertDoubleEquals(1.0, output[0], TEST_EXACT_TOLERANCE);
+    assertDoubleEquals(3.0, output[2], TEST_EXACT_TOLERANCE);
+  }
+
+  freeSampleRingBuffer(r);
+  return 0;
+}
+
+static int _testWriteAndReadBlock(void) {
+  SampleRingBuffer r = newSampleRingBuffer(2, 8);
+  SampleBuffer in = newSampleBuffer(2, 4);
+  SampleBuffer out = newSampleBuffer(2, 4);
+  Sample interleaved[8] = {0.0f};
+
+  in->samples[0][1] = 0.25f;
+  in->samples[1][1] = -0.25f;
+  assertUnsignedLongEquals(4ul, sampleRingBufferWriteBlock(r, in));
+
+  // Blocks are stored interleaved, like the frames of an audio device
+  assertUnsignedLongEquals(2ul,
+                           sampleRingBufferReadInterleaved(r, interleaved, 2));
+  assertDoubleEquals(0.25, interleaved[2], TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(-0.25, interleaved[3], TEST_EXACT_TOLERANCE);
+
+  assertUnsignedLongEquals(2ul,
+                           sampleRingBufferWriteInterleaved(r, interleaved, 2));
+  assertUnsignedLongEquals(4ul, sampleRingBufferReadBlock(r, out));
+  assertDoubleEquals(0.25, out->samples[0][3], TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(-0.25, out->samples[1][3], TEST_EXACT_TOLERANCE);
+
+  freeSampleBuffer(in);
+  freeSampleBuffer(out);
+  freeSampleRingBuffer(r);
+  return 0;
+}
+
+static int _testReadBlockWithMoreChannels(void) {
+  SampleRingBuffer r = newSampleRingBuffer(1, 4);
+  SampleBuffer in = newSampleBuffer(1, 4);
+  SampleBuffer out = newSampleBuffer(2, 4);
+
+  in->samples[0][0] = 0.5f;
+  out->samples[1][0] = 0.5f;
+  assertUnsignedLongEquals(4ul, sampleRingBufferWriteBlock(r, in));
+  assertUnsignedLongEquals(4ul, sampleRingBufferReadBlock(r, out));
+  assertDoubleEquals(0.5, out->samples[0][0], TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(0.0, out->samples[1][0], TEST_EXACT_TOLERANCE);
+
+  freeSampleBuffer(in);
+  freeSampleBuffer(out);
+  freeSampleRingBuffer(r);
+  return 0;
+}
+
+static const unsigned int kSampleRingBufferTestNumFrames = 100000;
+
+static void _sampleRingBufferTestWriter(void *userData) {
+  SampleRingBuffer r = (SampleRingBuffer)userData;
+  unsigned int written = 0;
+  Sample value;
+
+  while (written < kSampleRingBufferTestNumFrames) {
+    value = (Sample)written;
+
+    if (sampleRingBufferWriteInterleaved(r, &value, 1) == 1) {
+      written++;
+    }
+  }
+}
+
+static int _testConcurrentReadAndWrite(void) {
+  SampleRingBuffer r = newSampleRingBuffer(1, 64);
+  Thread writer = newThread(_sampleRingBufferTestWriter, r);
+  unsigned int numRead = 0;
+  boolByte inOrder = true;
+  Sample value;
+
+  assertNotNull(writer);
+
+  while (numRead < kSampleRingBufferTestNumFrames) {
+    if (sampleRingBufferReadInterleaved(r, &value, 1) == 1) {
+      inOrder = (boolByte)(inOrder && value == (Sample)numRead);
+      numRead++;
+    }
+  }
+
+  threadJoinAndFree(writer);
+  assert(inOrder);
+  freeSampleRingBuffer(r);
+  return 0;
+}
+
+static int _testFreeNullSampleRingBuffer(void) {
+  freeSampleRingBuffer(NULL);
+  return 0;
+}
+
+TestSuite addSampleRingBufferTests(void);
+TestSuite addSampleRingBufferTests(void) {
+  TestSuite testSuite = newTestSuite("SampleRingBuffer", NULL, NULL);
+  addTest(testSuite, "NewObject", _testNewSampleRingBuffer);
+  addTest(testSuite, "WriteAndReadInterleaved", _testWriteAndReadInterleaved);
+  addTest(testSuite, "WriteWhenFull", _testWriteWhenFull);
+  addTest(testSuite, "WrapAround", _testWrapAround);
+  addTest(testSuite, "WriteAndReadBlock", _testWriteAndReadBlock);
+  addTest(testSuite, "ReadBlockWithMoreChannels",
+          _testReadBlockWithMoreChannels);
+  addTest(testSuite, "ConcurrentReadAndWrite", _testConcurrentReadAndWrite);
+  addTest(testSuite, "FreeNull", _testFreeNullSampleRingBuffer);
+  return testSuite;
+}
@@ -362,6 +362,74 @@ static int _testFreeNullCharString(void) {
   freeCharString(NULL);
   return 0;
 }
+static int _testAppendCharStringsRepeatedly(void) {
+  CharString a = newCharStringWithCapacity(4);
+  int i;
+  for (i = 0; i < 10; i++) {
+    charStringAppendCString(a, "abc");
+  }
+  assertIntEquals(30, (int)strlen(a->data));
+  assertIntEquals(0, strncmp("abcabc", a->data, 6));
+  freeCharString(a);
+  return 0;
+}
+
+static int _testCopyShorterStringClearsTail(void) {
+  CharString c = newCharString();
+  charStringCopyCString(c, OTHER_TEST_STRING);
+  charStringCopyCString(c, "abc");
+  assertCharStringEquals("abc", c);
+  assertIntEquals('\0', c->data[5]);
+  assertIntEquals('\0', c->data[strlen(OTHER_TEST_STRING) - 1]);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testCopyTruncatesString(void) {
+  CharString c = newCharStringWithCapacity(5);
+  charStringCopyCString(c, TEST_STRING);
+  assertCharStringEquals("test", c);
+  assertIntEquals('\0', c->data[4]);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testClearAfterCopy(void) {
+  CharString c = newCharString();
+  charStringCopyCString(c, OTHER_TEST_STRING);
+  charStringClear(c);
+  assertCharStringEquals(EMPTY_STRING, c);
+  c->data[0] = 'x';
+  assertCharStringEquals("x", c);
+  freeCharString(c);
+  return 0;
+}
+
+static volatile boolByte _charStringBenchmarkResult = false;
+
+static void *_setupCharStringBenchmark(void) { return newCharString(); }
+
+static void _benchmarkCopyCString(void *context) {
+  charStringCopyCString((CharString)context, TEST_STRING);
+}
+
+static void _benchmarkAppendCString(void *context) {
+  CharString c = (CharString)context;
+  charStringClear(c);
+  charStringAppendCString(c, TEST_STRING);
+  charStringAppendCString(c, OTHER_TEST_STRING);
+}
+
+static void _benchmarkIsEqualToCString(void *context) {
+  CharString c = (CharString)context;
+  charStringCopyCString(c, TEST_STRING);
+  _charStringBenchmarkResult =
+      charStringIsEqualToCString(c, TEST_STRING_CAPS, true);
+}
+
+static void _teardownCharStringBenchmark(void *context) {
+  freeCharString((CharString)context);
+}
 
 TestSuite addCharStringTests(void);
 TestSuite addCharStringTests(void) {
@@ -383,6 +451,12 @@ TestSuite addCharStringTests(void) {
   addTest(testSuite, "AppendCharStrings", _testAppendCharStrings);
   addTest(testSuite, "AppendCharStringsOverCapacity",
           _testAppendCharStringsOverCapacity);
+  addTest(testSuite, "AppendCharStringsRepeatedly",
+          _testAppendCharStringsRepeatedly);
+  addTest(testSuite, "CopyShorterStringClearsTail",
+          _testCopyShorterStringClearsTail);
+  addTest(testSuite, "CopyTruncatesString", _testCopyTruncatesString);
+  addTest(testSuite, "ClearAfterCopy", _testClearAfterCopy);
 
   addTest(testSuite, "EqualsSameString", _testCharStringEqualsSameString);
   addTest(testSuite, "DoesNotEqualDifferentString",
@@ -420,5 +494,13 @@ TestSuite addCharStringTests(void) {
 
   addTest(testSuite, "FreeNullCharString", _testFreeNullCharString);
 
+  addBenchmarkWithSetup(testSuite, "CopyCString", _setupCharStringBenchmark,
+                        _benchmarkCopyCString, _teardownCharStringBenchmark);
+  addBenchmarkWithSetup(testSuite, "AppendCString", _setupCharStringBenchmark,
+                        _benchmarkAppendCString, _teardownCharStringBenchmark);
+  addBenchmarkWithSetup(testSuite, "IsEqualToCStringCaseInsensitive",
+                        _setupCharStringBenchmark, _benchmarkIsEqualToCString,
+                        _teardownCharStringBenchmark);
+
   return testSuite;
 }
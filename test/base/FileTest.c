@@ -840,6 +840,99 @@ static int _testFileListDirectoryEmpty(void) {
   return 0;
 }
 
+typedef struct {
+  int count;
+  FileType subfileType;
+  FileType subdirType;
+} FileTestListResult;
+
+static void _countDirectoryItems(File item, const char *name,
+                                 void *userData) {
+  FileTestListResult *result = (FileTestListResult *)userData;
+
+  if (strcmp(name, TEST_FILENAME) == 0) {
+    result->subfileType = item->fileType;
+  } else if (strcmp(name, TEST_DIRNAME) == 0) {
+    result->subdirType = item->fileType;
+  }
+
+  result->count++;
+}
+
+static int _testFileListDirectoryForeach(void) {
+  CharString pdest = newCharStringWithCString(TEST_DIRNAME);
+  CharString psubdir = newCharStringWithCString(TEST_DIRNAME);
+  CharString psubfile = newCharStringWithCString(TEST_FILENAME);
+  File dir = newFileWithPath(pdest);
+  File subdir;
+  File subfile;
+  FileTestListResult result = {0, kFileTypeInvalid, kFileTypeInvalid};
+
+  assert(fileCreate(dir, kFileTypeDirectory));
+  subdir = newFileWithParent(dir, psubdir);
+  assert(fileCreate(subdir, kFileTypeDirectory));
+  subfile = newFileWithParent(dir, psubfile);
+  assert(fileCreate(subfile, kFileTypeFile));
+
+  assert(fileListDirectoryForeach(dir, NULL, _countDirectoryItems, &result));
+  assertIntEquals(2, result.count);
+  assertIntEquals(kFileTypeFile, result.subfileType);
+  assertIntEquals(kFileTypeDirectory, result.subdirType);
+
+  freeFile(dir);
+  freeFile(subfile);
+  freeFile(subdir);
+  freeCharString(pdest);
+  freeCharString(psubdir);
+  freeCharString(psubfile);
+  return 0;
+}
+
+static int _testFileListDirectoryForeachWithExtension(void) {
+  CharString pdest = newCharStringWithCString(TEST_DIRNAME);
+  CharString psubdir = newCharStringWithCString(TEST_DIRNAME);
+  CharString psubfile = newCharStringWithCString(TEST_FILENAME);
+  File dir = newFileWithPath(pdest);
+  File subdir;
+  File subfile;
+  FileTestListResult result = {0, kFileTypeInvalid, kFileTypeInvalid};
+
+  assert(fileCreate(dir, kFileTypeDirectory));
+  subdir = newFileWithParent(dir, psubdir);
+  assert(fileCreate(subdir, kFileTypeDirectory));
+  subfile = newFileWithParent(dir, psubfile);
+  assert(fileCreate(subfile, kFileTypeFile));
+
+  assert(fileListDirectoryForeach(dir, ".TXT", _countDirectoryItems, &result));
+  assertIntEquals(1, result.count);
+  assertIntEquals(kFileTypeFile, result.subfileType);
+  result.count = 0;
+  assert(fileListDirectoryForeach(dir, ".wav", _countDirectoryItems, &result));
+  assertIntEquals(0, result.count);
+
+  freeFile(dir);
+  freeFile(subfile);
+  freeFile(subdir);
+  freeCharString(pdest);
+  freeCharString(psubdir);
+  freeCharString(psubfile);
+  return 0;
+}
+
+static int _testFileListDirectoryForeachNotExists(void) {
+  CharString pdest = newCharStringWithCString(TEST_DIRNAME);
+  File dir = newFileWithPath(pdest);
+  FileTestListResult result = {0, kFileTypeInvalid, kFileTypeInvalid};
+
+  assertFalse(
+      fileListDirectoryForeach(dir, NULL, _countDirectoryItems, &result));
+  assertIntEquals(0, result.count);
+
+  freeFile(dir);
+  freeCharString(pdest);
+  return 0;
+}
+
 static int _testFileGetSize(void) {
   CharString p = newCharStringWithCString(TEST_FILENAME);
   File f = newFileWithPath(p);
@@ -881,6 +974,20 @@ static int _testFileGetSizeDirectory(void) {
   return 0;
 }
 
+static int _testFileGetModificationTime(void) {
+  CharString p = newCharStringWithCString(TEST_FILENAME);
+  File f = newFileWithPath(p);
+
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, fileGetModificationTime(f));
+  assert(fileCreate(f, kFileTypeFile));
+  fileClose(f);
+  assert(fileGetModificationTime(f) > 0);
+
+  freeCharString(p);
+  freeFile(f);
+  return 0;
+}
+
 static int _testFileReadContents(void) {
   CharString p = newCharStringWithCString(TEST_FILENAME);
   File f = newFileWithPath(p);
@@ -1115,6 +1222,53 @@ static int _testFileReadBytesGreaterSize(void) {
   return 0;
 }
 
+static int _testFileMap(void) {
+  CharString p = newCharStringWithCString(TEST_FILENAME);
+  File f = newFileWithPath(p);
+  MappedFile mappedFile;
+
+  assert(fileCreate(f, kFileTypeFile));
+  assert(fileWrite(f, p));
+  mappedFile = fileMap(f);
+  assertNotNull(mappedFile);
+  assertSizeEquals(strlen(TEST_FILENAME), mappedFile->size);
+  assertIntEquals(0, memcmp(TEST_FILENAME, mappedFile->data,
+                            mappedFile->size));
+
+  // The mapping remains valid after the file is closed
+  freeFile(f);
+  assertIntEquals(0, memcmp(TEST_FILENAME, mappedFile->data,
+                            mappedFile->size));
+
+  freeMappedFile(mappedFile);
+  freeCharString(p);
+  return 0;
+}
+
+static int _testFileMapNotExists(void) {
+  CharString p = newCharStringWithCString(TEST_FILENAME);
+  File f = newFileWithPath(p);
+
+  assertFalse(fileExists(f));
+  assertIsNull(fileMap(f));
+
+  freeCharString(p);
+  freeFile(f);
+  return 0;
+}
+
+static int _testFileMapEmpty(void) {
+  CharString p = newCharStringWithCString(TEST_FILENAME);
+  File f = newFileWithPath(p);
+
+  assert(fileCreate(f, kFileTypeFile));
+  assertIsNull(fileMap(f));
+
+  freeCharString(p);
+  freeFile(f);
+  return 0;
+}
+
 static int _testFileWrite(void) {
   CharString p = newCharStringWithCString(TEST_FILENAME);
   File f = newFileWithPath(p);
@@ -1449,10 +1603,17 @@ TestSuite addFileTests(void) {
   addTest(testSuite, "FileListDirectoryNotExists",
           _testFileListDirectoryNotExists);
   addTest(testSuite, "FileListDirectoryEmpty", _testFileListDirectoryEmpty);
+  addTest(testSuite, "FileListDirectoryForeach", _testFileListDirectoryForeach);
+  addTest(testSuite, "FileListDirectoryForeachWithExtension",
+          _testFileListDirectoryForeachWithExtension);
+  addTest(testSuite, "FileListDirectoryForeachNotExists",
+          _testFileListDirectoryForeachNotExists);
 
   addTest(testSuite, "FileGetSize", _testFileGetSize);
   addTest(testSuite, "FileGetSizeNotExists", _testFileGetSizeNotExists);
   addTest(testSuite, "FileGetSizeDirectory", _testFileGetSizeDirectory);
+  addTest(testSuite, "FileGetModificationTime",
+          _testFileGetModificationTime);
 
   addTest(testSuite, "FileReadContents", _testFileReadContents);
   addTest(testSuite, "FileReadContentsNotExists",
@@ -1470,6 +1631,9 @@ TestSuite addFileTests(void) {
   addTest(testSuite, "FileReadBytesDirectory", _testFileReadBytesDirectory);
   addTest(testSuite, "FileReadBytesZeroSize", _testFileReadBytesZeroSize);
   addTest(testSuite, "FileReadBytesGreaterSize", _testFileReadBytesGreaterSize);
+  addTest(testSuite, "FileMap", _testFileMap);
+  addTest(testSuite, "FileMapNotExists", _testFileMapNotExists);
+  addTest(testSuite, "FileMapEmpty", _testFileMapEmpty);
 
   addTest(testSuite, "FileWrite", _testFileWrite);
   addTest(testSuite, "FileWriteMulitple", _testFileWriteMultiple);
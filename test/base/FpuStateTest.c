@@ -0,0 +1,87 @@
+//
+// FpuStateTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/FpuState.h"
+
+#include "unit/TestRunner.h"
+
+#include <float.h>
+
+static int _testFlushDenormals(void) {
+  const FpuState previous = fpuStateFlushDenormals();
+  const boolByte flushing = fpuStateIsFlushingDenormals();
+  fpuStateRestore(previous);
+
+#if defined(__SSE__) || defined(_M_X64) || defined(__aarch64__)
+  assert(flushing);
+#endif
+  assertFalse(fpuStateIsFlushingDenormals());
+  return 0;
+}
+
+static int _testDenormalResultIsFlushed(void) {
+  // Volatile so that the compiler does not calculate the result itself, or
+  // move the multiplication past the point where the state is restored
+  volatile float smallest = FLT_MIN;
+  volatile float half = 0.5f;
+  volatile float flushedResult;
+  float result;
+  FpuState previous;
+
+  result = smallest * half;
+  assert(result > 0.0f);
+
+  previous = fpuStateFlushDenormals();
+  flushedResult = smallest * half;
+
+  if (fpuStateIsFlushingDenormals()) {
+    fpuStateRestore(previous);
+    assert(flushedResult == 0.0f);
+  } else {
+    fpuStateRestore(previous);
+  }
+
+  return 0;
+}
+
+static int _testRestoreUnchangedState(void) {
+  const FpuState previous = fpuStateFlushDenormals();
+  const FpuState flushed = fpuStateFlushDenormals();
+  // Flushing twice must not lose the original state
+  fpuStateRestore(flushed);
+  fpuStateRestore(previous);
+  assertFalse(fpuStateIsFlushingDenormals());
+  return 0;
+}
+
+TestSuite addFpuStateTests(void);
+TestSuite addFpuStateTests(void) {
+  TestSuite testSuite = newTestSuite("FpuState", NULL, NULL);
+  addTest(testSuite, "FlushDenormals", _testFlushDenormals);
+  addTest(testSuite, "DenormalResultIsFlushed", _testDenormalResultIsFlushed);
+  addTest(testSuite, "RestoreUnchangedState", _testRestoreUnchangedState);
+  return testSuite;
+}
@@ -0,0 +1,118 @@
+//
+// IoRingTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/IoRing.h"
+
+#include "unit/TestRunner.h"
+
+#include <string.h>
+
+static const char *kIoRingTestFilename = "io-ring-test.bin";
+static const size_t kIoRingTestSlotSize = 16;
+
+static void _ioRingTeardown(void) { remove(kIoRingTestFilename); }
+
+// Write four slots in reverse order of their offsets, and read them back in
+// two larger slots
+static int _testWriteAndReadIoRing(void) {
+  FILE *fileHandle = fopen(kIoRingTestFilename, "wb");
+  IoRing ioRing = newIoRing(fileHandle, true, 4, kIoRingTestSlotSize);
+  char expected[64];
+  unsigned int slot;
+
+  // Not every platform or kernel supports asynchronous I/O
+  if (ioRing == NULL) {
+    fclose(fileHandle);
+    return 0;
+  }
+
+  for (slot = 0; slot < 4; slot++) {
+    memset(ioRing->buffers[slot], 'a' + (int)slot, kIoRingTestSlotSize);
+    memset(expected + (3 - slot) * kIoRingTestSlotSize, 'a' + (int)slot,
+           kIoRingTestSlotSize);
+    ioRingQueue(ioRing, slot, (3 - slot) * kIoRingTestSlotSize,
+                kIoRingTestSlotSize);
+  }
+
+  assertIntEquals(4, (int)ioRing->numQueued);
+  assert(ioRingSubmit(ioRing));
+  assertIntEquals(0, (int)ioRing->numQueued);
+  assert(ioRingWaitAll(ioRing));
+  freeIoRing(ioRing);
+  fclose(fileHandle);
+
+  fileHandle = fopen(kIoRingTestFilename, "rb");
+  ioRing = newIoRing(fileHandle, false, 2, 2 * kIoRingTestSlotSize);
+  assertNotNull(ioRing);
+  ioRingQueue(ioRing, 0, 0, 2 * kIoRingTestSlotSize);
+  ioRingQueue(ioRing, 1, 2 * kIoRingTestSlotSize, 2 * kIoRingTestSlotSize);
+
+  // Waiting for a slot submits it, and slots may be waited for in any order
+  assertIntEquals(32, (int)ioRingWait(ioRing, 1));
+  assertIntEquals(32, (int)ioRingWait(ioRing, 0));
+  assertIntEquals(0, memcmp(expected, ioRing->buffers[0], 32));
+  assertIntEquals(0, memcmp(expected + 32, ioRing->buffers[1], 32));
+
+  // Reads stop at the end of the file
+  ioRingQueue(ioRing, 0, 48, 2 * kIoRingTestSlotSize);
+  assertIntEquals(16, (int)ioRingWait(ioRing, 0));
+  assertIntEquals(0, memcmp(expected + 48, ioRing->buffers[0], 16));
+
+  // Nothing was queued for the slot
+  assertIntEquals(0, (int)ioRingWait(ioRing, 1));
+
+  freeIoRing(ioRing);
+  fclose(fileHandle);
+  return 0;
+}
+
+static int _testNewIoRingNullHandle(void) {
+  assertIsNull(newIoRing(NULL, false, 4, kIoRingTestSlotSize));
+  return 0;
+}
+
+static int _testNewIoRingWithoutSlots(void) {
+  FILE *fileHandle = fopen(kIoRingTestFilename, "wb");
+  assertIsNull(newIoRing(fileHandle, true, 0, kIoRingTestSlotSize));
+  assertIsNull(newIoRing(fileHandle, true, 4, 0));
+  fclose(fileHandle);
+  return 0;
+}
+
+static int _testFreeNullIoRing(void) {
+  freeIoRing(NULL);
+  return 0;
+}
+
+TestSuite addIoRingTests(void);
+TestSuite addIoRingTests(void) {
+  TestSuite testSuite = newTestSuite("IoRing", NULL, _ioRingTeardown);
+  addTest(testSuite, "WriteAndReadIoRing", _testWriteAndReadIoRing);
+  addTest(testSuite, "NewIoRingNullHandle", _testNewIoRingNullHandle);
+  addTest(testSuite, "NewIoRingWithoutSlots", _testNewIoRingWithoutSlots);
+  addTest(testSuite, "FreeNullIoRing", _testFreeNullIoRing);
+  return testSuite;
+}
@@ -222,11 +222,183 @@ static int _testForeachOverUserData(void) {
   return 0;
 }
 
+static int _testClearList(void) {
+  LinkedList l = newLinkedList();
+  LinkedList secondNode;
+
+  linkedListAppend(l, TEST_ITEM_STRING);
+  linkedListAppend(l, OTHER_TEST_ITEM_STRING);
+  secondNode = (LinkedList)l->nextItem;
+  linkedListClear(l);
+  assertIntEquals(0, linkedListLength(l));
+  assertIsNull(l->item);
+  assertIsNull(l->nextItem);
+
+  // The second node should be reused for the next append
+  linkedListAppend(l, OTHER_TEST_ITEM_STRING);
+  linkedListAppend(l, TEST_ITEM_STRING);
+  assertIntEquals(2, linkedListLength(l));
+  assert(l->nextItem == secondNode);
+  assert(l->item == OTHER_TEST_ITEM_STRING);
+  assert(secondNode->item == TEST_ITEM_STRING);
+  assertIsNull(secondNode->nextItem);
+
+  freeLinkedList(l);
+  return 0;
+}
+
+static int _testAppendAfterClear(void) {
+  LinkedList l = newLinkedList();
+  void **array;
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    linkedListAppend(l, TEST_ITEM_STRING);
+  }
+
+  linkedListClear(l);
+
+  // Append more items than there are spare nodes
+  for (i = 0; i < 6; i++) {
+    linkedListAppend(l, i % 2 ? OTHER_TEST_ITEM_STRING : TEST_ITEM_STRING);
+  }
+
+  assertIntEquals(6, linkedListLength(l));
+  array = linkedListToArray(l);
+
+  for (i = 0; i < 6; i++) {
+    assert(array[i] == (i % 2 ? OTHER_TEST_ITEM_STRING : TEST_ITEM_STRING));
+  }
+
+  assertIsNull(array[6]);
+  free(array);
+  freeLinkedList(l);
+  return 0;
+}
+
+static int _testIterateOverList(void) {
+  LinkedList l = newLinkedList();
+  LinkedListIterator iterator;
+  int numItems = 0;
+
+  linkedListAppend(l, TEST_ITEM_STRING);
+  linkedListAppend(l, OTHER_TEST_ITEM_STRING);
+  iterator = linkedListBegin(l);
+  assertNotNull(iterator);
+  assert(linkedListIteratorGetItem(iterator) == TEST_ITEM_STRING);
+  iterator = linkedListIteratorNext(iterator);
+  assertNotNull(iterator);
+  assert(linkedListIteratorGetItem(iterator) == OTHER_TEST_ITEM_STRING);
+  assertIsNull(linkedListIteratorNext(iterator));
+
+  for (iterator = linkedListBegin(l); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    numItems++;
+  }
+
+  assertIntEquals(2, numItems);
+  freeLinkedList(l);
+  return 0;
+}
+
+static int _testIterateOverEmptyList(void) {
+  LinkedList l = newLinkedList();
+  assertIsNull(linkedListBegin(l));
+  assertIsNull(linkedListBegin(NULL));
+  freeLinkedList(l);
+  return 0;
+}
+
+static int _testAppendManyItems(void) {
+  LinkedList l = newLinkedList();
+  LinkedListIterator iterator;
+  LinkedList lastNode = NULL;
+  int i;
+
+  // Appending keeps track of the last node, so this should be fast and leave
+  // the items in order
+  for (i = 0; i < 100000; i++) {
+    linkedListAppend(l, TEST_ITEM_STRING);
+  }
+
+  assertIntEquals(100000, linkedListLength(l));
+
+  for (iterator = linkedListBegin(l); iterator != NULL;
+       iterator = linkedListIteratorNext(iterator)) {
+    lastNode = iterator;
+  }
+
+  assert(lastNode == l->_lastNode);
+  freeLinkedList(l);
+  return 0;
+}
+
+static int _testClearNullList(void) {
+  linkedListClear(NULL);
+  return 0;
+}
+
 static int _testFreeNullLinkedList(void) {
   freeLinkedList(NULL);
   return 0;
 }
 
+static int _testFreeNullLinkedListAndItems(void) {
+  freeLinkedListAndItems(NULL, (LinkedListFreeItemFunc)freeCharString);
+  return 0;
+}
+
+// Number of items in the lists used by the benchmarks, which is about as many
+// as the MIDI events in a busy block
+static const int kLinkedListBenchmarkNumItems = 64;
+static volatile int _linkedListBenchmarkResult = 0;
+
+static void *_setupLinkedListBenchmark(void) {
+  LinkedList l = newLinkedList();
+  int i;
+
+  for (i = 0; i < kLinkedListBenchmarkNumItems; i++) {
+    linkedListAppend(l, TEST_ITEM_STRING);
+  }
+
+  return l;
+}
+
+static void _benchmarkAppendAndClear(void *context) {
+  LinkedList l = (LinkedList)context;
+  int i;
+
+  linkedListClear(l);
+
+  for (i = 0; i < kLinkedListBenchmarkNumItems; i++) {
+    linkedListAppend(l, TEST_ITEM_STRING);
+  }
+}
+
+static void _benchmarkIterate(void *context) {
+  LinkedListIterator iterator = linkedListBegin((LinkedList)context);
+  int numItems = 0;
+
+  while (iterator != NULL) {
+    numItems += linkedListIteratorGetItem(iterator) != NULL ? 1 : 0;
+    iterator = linkedListIteratorNext(iterator);
+  }
+
+  _linkedListBenchmarkResult = numItems;
+}
+
+static void _countItems(void *item, void *userData) { (*(int *)userData)++; }
+
+static void _benchmarkForeach(void *context) {
+  int numItems = 0;
+  linkedListForeach((LinkedList)context, _countItems, &numItems);
+  _linkedListBenchmarkResult = numItems;
+}
+
+static void _teardownLinkedListBenchmark(void *context) {
+  freeLinkedList((LinkedList)context);
+}
+
 TestSuite addLinkedListTests(void);
 TestSuite addLinkedListTests(void) {
   TestSuite testSuite = newTestSuite("LinkedList", _linkedListTestSetup, NULL);
@@ -250,7 +422,23 @@ TestSuite addLinkedListTests(void) {
   addTest(testSuite, "ForeachOverList", _testForeachOverList);
   addTest(testSuite, "ForeachWithUserData", _testForeachOverUserData);
 
+  addTest(testSuite, "ClearList", _testClearList);
+  addTest(testSuite, "AppendAfterClear", _testAppendAfterClear);
+  addTest(testSuite, "ClearNullList", _testClearNullList);
+  addTest(testSuite, "IterateOverList", _testIterateOverList);
+  addTest(testSuite, "IterateOverEmptyList", _testIterateOverEmptyList);
+  addTest(testSuite, "AppendManyItems", _testAppendManyItems);
+
   addTest(testSuite, "FreeNullLinkedList", _testFreeNullLinkedList);
+  addTest(testSuite, "FreeNullLinkedListAndItems",
+          _testFreeNullLinkedListAndItems);
+
+  addBenchmarkWithSetup(testSuite, "AppendAndClear", _setupLinkedListBenchmark,
+                        _benchmarkAppendAndClear, _teardownLinkedListBenchmark);
+  addBenchmarkWithSetup(testSuite, "Iterate", _setupLinkedListBenchmark,
+                        _benchmarkIterate, _teardownLinkedListBenchmark);
+  addBenchmarkWithSetup(testSuite, "Foreach", _setupLinkedListBenchmark,
+                        _benchmarkForeach, _teardownLinkedListBenchmark);
 
   return testSuite;
 }
@@ -0,0 +1,99 @@
+//
+// MappedFileTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/MappedFile.h"
+
+#include "unit/TestRunner.h"
+
+#include <string.h>
+
+static const char *kMappedFileTestFilename = "mapped-file-test.bin";
+static const char *kMappedFileTestContents = "MrsWatson mapped file contents";
+
+static void _mappedFileTeardown(void) { remove(kMappedFileTestFilename); }
+
+static FILE *_openTestFile(const char *contents) {
+  FILE *fileHandle = fopen(kMappedFileTestFilename, "wb");
+  fwrite(contents, 1, strlen(contents), fileHandle);
+  fclose(fileHandle);
+  return fopen(kMappedFileTestFilename, "rb");
+}
+
+static int _testNewMappedFile(void) {
+  FILE *fileHandle = _openTestFile(kMappedFileTestContents);
+  MappedFile m = newMappedFile(fileHandle);
+
+  assertNotNull(m);
+  assertSizeEquals(strlen(kMappedFileTestContents), m->size);
+  assertIntEquals(0, memcmp(kMappedFileTestContents, m->data, m->size));
+  // Mapping should not move the file position
+  assertIntEquals(0, (int)ftell(fileHandle));
+
+  fclose(fileHandle);
+  freeMappedFile(m);
+  return 0;
+}
+
+static int _testMappedFileOutlivesHandle(void) {
+  FILE *fileHandle = _openTestFile(kMappedFileTestContents);
+  MappedFile m = newMappedFile(fileHandle);
+
+  assertNotNull(m);
+  fclose(fileHandle);
+  assertIntEquals(0, memcmp(kMappedFileTestContents, m->data, m->size));
+
+  freeMappedFile(m);
+  return 0;
+}
+
+static int _testNewMappedFileEmpty(void) {
+  FILE *fileHandle = _openTestFile("");
+  assertIsNull(newMappedFile(fileHandle));
+  fclose(fileHandle);
+  return 0;
+}
+
+static int _testNewMappedFileNullHandle(void) {
+  assertIsNull(newMappedFile(NULL));
+  return 0;
+}
+
+static int _testFreeNullMappedFile(void) {
+  freeMappedFile(NULL);
+  return 0;
+}
+
+TestSuite addMappedFileTests(void);
+TestSuite addMappedFileTests(void) {
+  TestSuite testSuite = newTestSuite("MappedFile", NULL, _mappedFileTeardown);
+  addTest(testSuite, "NewMappedFile", _testNewMappedFile);
+  addTest(testSuite, "MappedFileOutlivesHandle",
+          _testMappedFileOutlivesHandle);
+  addTest(testSuite, "NewMappedFileEmpty", _testNewMappedFileEmpty);
+  addTest(testSuite, "NewMappedFileNullHandle", _testNewMappedFileNullHandle);
+  addTest(testSuite, "FreeNullMappedFile", _testFreeNullMappedFile);
+  return testSuite;
+}
@@ -0,0 +1,133 @@
+//
+// MemoryArenaTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/MemoryArena.h"
+
+#include "unit/TestRunner.h"
+
+#include <string.h>
+
+static const size_t kMemoryArenaTestBlockSize = 256;
+
+static int _testNewMemoryArena(void) {
+  MemoryArena a = newMemoryArena(kMemoryArenaTestBlockSize);
+  assertNotNull(a);
+  assertSizeEquals(kMemoryArenaTestBlockSize, a->blockSize);
+  freeMemoryArena(a);
+  return 0;
+}
+
+static int _testAllocIsAlignedAndZeroed(void) {
+  MemoryArena a = newMemoryArena(kMemoryArenaTestBlockSize);
+  char *p1 = (char *)memoryArenaAlloc(a, 3);
+  char *p2 = (char *)memoryArenaAlloc(a, 5);
+  size_t i;
+
+  assertNotNull(p1);
+  assertNotNull(p2);
+  assertSizeEquals((size_t)0, (size_t)p1 % 16);
+  assertSizeEquals((size_t)0, (size_t)p2 % 16);
+  assert(p1 + 3 <= p2);
+
+  for (i = 0; i < 5; i++) {
+    assertIntEquals(0, p2[i]);
+  }
+
+  freeMemoryArena(a);
+  return 0;
+}
+
+static int _testAllocManyBlocks(void) {
+  MemoryArena a = newMemoryArena(kMemoryArenaTestBlockSize);
+  int *values[100];
+  int i;
+
+  // Each allocation should stay valid while later ones fill more blocks
+  for (i = 0; i < 100; i++) {
+    values[i] = (int *)memoryArenaAlloc(a, 40);
+    *values[i] = i;
+  }
+
+  for (i = 0; i < 100; i++) {
+    assertIntEquals(i, *values[i]);
+  }
+
+  freeMemoryArena(a);
+  return 0;
+}
+
+static int _testAllocLargerThanBlock(void) {
+  MemoryArena a = newMemoryArena(kMemoryArenaTestBlockSize);
+  char *small1 = (char *)memoryArenaAlloc(a, 16);
+  char *large = (char *)memoryArenaAlloc(a, kMemoryArenaTestBlockSize * 4);
+  char *small2 = (char *)memoryArenaAlloc(a, 16);
+
+  assertNotNull(large);
+  memset(large, 0xff, kMemoryArenaTestBlockSize * 4);
+  // The large allocation gets its own block, so the current block is still
+  // used for the small ones
+  assert(small2 == small1 + 16);
+
+  freeMemoryArena(a);
+  return 0;
+}
+
+static int _testTotalSize(void) {
+  MemoryArena a = newMemoryArena(kMemoryArenaTestBlockSize);
+  size_t oneBlock;
+
+  assertSizeEquals((size_t)0, a->totalSize);
+  memoryArenaAlloc(a, 16);
+  oneBlock = a->totalSize;
+  assert(oneBlock >= kMemoryArenaTestBlockSize);
+
+  // Fits into the current block
+  memoryArenaAlloc(a, 16);
+  assertSizeEquals(oneBlock, a->totalSize);
+
+  memoryArenaAlloc(a, kMemoryArenaTestBlockSize * 4);
+  assert(a->totalSize >= oneBlock + kMemoryArenaTestBlockSize * 4);
+
+  freeMemoryArena(a);
+  return 0;
+}
+
+static int _testFreeNullMemoryArena(void) {
+  freeMemoryArena(NULL);
+  return 0;
+}
+
+TestSuite addMemoryArenaTests(void);
+TestSuite addMemoryArenaTests(void) {
+  TestSuite testSuite = newTestSuite("MemoryArena", NULL, NULL);
+  addTest(testSuite, "NewObject", _testNewMemoryArena);
+  addTest(testSuite, "AllocIsAlignedAndZeroed", _testAllocIsAlignedAndZeroed);
+  addTest(testSuite, "AllocManyBlocks", _testAllocManyBlocks);
+  addTest(testSuite, "AllocLargerThanBlock", _testAllocLargerThanBlock);
+  addTest(testSuite, "TotalSize", _testTotalSize);
+  addTest(testSuite, "FreeNullMemoryArena", _testFreeNullMemoryArena);
+  return testSuite;
+}
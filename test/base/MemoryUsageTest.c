@@ -0,0 +1,106 @@
+//
+// MemoryUsageTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/MemoryUsage.h"
+
+#include "unit/TestRunner.h"
+
+#include <string.h>
+
+static void _memoryUsageTestTeardown(void) { freeMemoryUsage(); }
+
+static int _testCountWithoutInit(void) {
+  memoryUsageAdd(kMemoryUsageSampleBuffers, 100);
+  assertSizeEquals((size_t)0, memoryUsageGetPeak(kMemoryUsageSampleBuffers));
+  assert(memoryUsageFitsBudget(100));
+  return 0;
+}
+
+static int _testAddAndRemove(void) {
+  initMemoryUsage();
+  memoryUsageAdd(kMemoryUsageSampleBuffers, 100);
+  memoryUsageAdd(kMemoryUsageSampleBuffers, 50);
+  memoryUsageRemove(kMemoryUsageSampleBuffers, 100);
+  memoryUsageAdd(kMemoryUsageSampleBuffers, 20);
+
+  assertSizeEquals((size_t)70,
+                   memoryUsageInstance->current[kMemoryUsageSampleBuffers]);
+  assertSizeEquals((size_t)150, memoryUsageGetPeak(kMemoryUsageSampleBuffers));
+  assertSizeEquals((size_t)0, memoryUsageGetPeak(kMemoryUsageMidiSequences));
+  return 0;
+}
+
+static int _testRemoveMoreThanAdded(void) {
+  initMemoryUsage();
+  memoryUsageAdd(kMemoryUsagePresetChunks, 10);
+  memoryUsageRemove(kMemoryUsagePresetChunks, 100);
+  assertSizeEquals((size_t)0,
+                   memoryUsageInstance->current[kMemoryUsagePresetChunks]);
+  return 0;
+}
+
+static int _testInitTwiceKeepsCounts(void) {
+  initMemoryUsage();
+  memoryUsageAdd(kMemoryUsageMidiSequences, 10);
+  initMemoryUsage();
+  assertSizeEquals((size_t)10, memoryUsageGetPeak(kMemoryUsageMidiSequences));
+  return 0;
+}
+
+static int _testGetCategoryName(void) {
+  assertIntEquals(0, strcmp("sample_buffers", memoryUsageGetCategoryName(
+                                                  kMemoryUsageSampleBuffers)));
+  assertIntEquals(0, strcmp("midi_sequences", memoryUsageGetCategoryName(
+                                                  kMemoryUsageMidiSequences)));
+  assertIntEquals(0, strcmp("preset_chunks", memoryUsageGetCategoryName(
+                                                 kMemoryUsagePresetChunks)));
+  return 0;
+}
+
+static int _testFitsBudget(void) {
+  initMemoryUsage();
+  assert(memoryUsageFitsBudget(1024));
+
+  // The process itself already uses more than this
+  memoryUsageSetBudget(1024);
+  assertFalse(memoryUsageFitsBudget(0));
+
+  memoryUsageSetBudget((size_t)1 << 40);
+  assert(memoryUsageFitsBudget(1024));
+  return 0;
+}
+
+TestSuite addMemoryUsageTests(void);
+TestSuite addMemoryUsageTests(void) {
+  TestSuite testSuite =
+      newTestSuite("MemoryUsage", NULL, _memoryUsageTestTeardown);
+  addTest(testSuite, "CountWithoutInit", _testCountWithoutInit);
+  addTest(testSuite, "AddAndRemove", _testAddAndRemove);
+  addTest(testSuite, "RemoveMoreThanAdded", _testRemoveMoreThanAdded);
+  addTest(testSuite, "InitTwiceKeepsCounts", _testInitTwiceKeepsCounts);
+  addTest(testSuite, "GetCategoryName", _testGetCategoryName);
+  addTest(testSuite, "FitsBudget", _testFitsBudget);
+  return testSuite;
+}
@@ -26,6 +26,8 @@
 
 #include "base/PlatformInfo.h"
 
+#include "base/File.h"
+
 #include "unit/TestRunner.h"
 
 static int _testGetPlatformType(void) {
@@ -39,6 +41,7 @@ static int _testGetPlatformType(void) {
 #else
   assertIntEquals(PLATFORM_UNSUPPORTED, platform->type);
 #endif
+  assertIntEquals((int)platform->type, (int)platformInfoGetType());
   freePlatformInfo(platform);
   return 0;
 }
@@ -82,6 +85,67 @@ static int _testIsHostLittleEndian(void) {
   return 0;
 }
 
+static int _testGetPeakMemoryUsage(void) {
+  // The test runner itself must have touched at least some memory
+  assert(platformInfoGetPeakMemoryUsage() > 0);
+  return 0;
+}
+
+static int _testGetMemoryUsage(void) {
+#if WINDOWS || MACOSX || LINUX
+  // The test runner itself must be using at least some memory
+  assert(platformInfoGetMemoryUsage() > 0);
+#endif
+  return 0;
+}
+
+static int _testGetProcessCpuTime(void) {
+  const double before = platformInfoGetProcessCpuTime();
+  volatile double sum = 0.0;
+  int i;
+
+  for (i = 0; i < 10000000; i++) {
+    sum += i;
+  }
+
+  // The counters are coarse on some platforms, so only check that time does
+  // not go backwards
+  assert(platformInfoGetProcessCpuTime() >= before);
+  return 0;
+}
+
+static int _testGetMappedMemoryUsage(void) {
+  CharString executablePath = fileGetExecutablePath();
+
+#if LINUX
+  // The code of the test runner itself is running, so it must be resident
+  assert(platformInfoGetMappedMemoryUsage(executablePath->data) > 0);
+#endif
+  assertUnsignedLongEquals(0ul, platformInfoGetMappedMemoryUsage(""));
+  assertUnsignedLongEquals(
+      0ul, platformInfoGetMappedMemoryUsage("/invalid/path/to/library"));
+
+  freeCharString(executablePath);
+  return 0;
+}
+
+static int _testGetNumProcessors(void) {
+  assert(platformInfoGetNumProcessors() >= 1);
+  return 0;
+}
+
+static int _testGetNumaNodeProcessorsInvalidNode(void) {
+  assertIsNull(platformInfoGetNumaNodeProcessors(100000));
+  return 0;
+}
+
+static int _testGetProcessorFrequencyInvalidProcessor(void) {
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           platformInfoGetProcessorFrequency(100000));
+  assertIsNull(platformInfoGetProcessorGovernor(100000));
+  return 0;
+}
+
 TestSuite addPlatformInfoTests(void);
 TestSuite addPlatformInfoTests(void) {
   TestSuite testSuite = newTestSuite("PlatformInfo", NULL, NULL);
@@ -91,6 +155,15 @@ TestSuite addPlatformInfoTests(void) {
   addTest(testSuite, "GetShortPlatformName", _testGetShortPlatformName);
 
   addTest(testSuite, "IsHostLittleEndian", _testIsHostLittleEndian);
+  addTest(testSuite, "GetPeakMemoryUsage", _testGetPeakMemoryUsage);
+  addTest(testSuite, "GetMemoryUsage", _testGetMemoryUsage);
+  addTest(testSuite, "GetProcessCpuTime", _testGetProcessCpuTime);
+  addTest(testSuite, "GetMappedMemoryUsage", _testGetMappedMemoryUsage);
+  addTest(testSuite, "GetNumProcessors", _testGetNumProcessors);
+  addTest(testSuite, "GetNumaNodeProcessorsInvalidNode",
+          _testGetNumaNodeProcessorsInvalidNode);
+  addTest(testSuite, "GetProcessorFrequencyInvalidProcessor",
+          _testGetProcessorFrequencyInvalidProcessor);
 
   return testSuite;
 }
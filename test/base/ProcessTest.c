@@ -0,0 +1,161 @@
+//
+// ProcessTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/Process.h"
+
+#include "time/TaskTimer.h"
+#include "unit/TestRunner.h"
+
+#if UNIX
+#include <unistd.h>
+#endif
+
+#if UNIX
+static const char *kProcessTestShell = "/bin/sh";
+
+static Process _newShellProcess(const char *script) {
+  CharString executable = newCharStringWithCString(kProcessTestShell);
+  LinkedList arguments = newLinkedList();
+  Process result;
+
+  linkedListAppend(arguments, newCharStringWithCString("-c"));
+  linkedListAppend(arguments, newCharStringWithCString(script));
+  result = newProcess(executable, arguments);
+
+  freeLinkedListAndItems(arguments, (LinkedListFreeItemFunc)freeCharString);
+  freeCharString(executable);
+  return result;
+}
+
+static void _waitForProcess(Process p) {
+  while (!processPoll(p)) {
+    taskTimerSleep(1.0);
+  }
+}
+
+static int _testCaptureOutput(void) {
+  Process p = _newShellProcess("echo hello; echo ignored >&2");
+
+  assertNotNull(p);
+  _waitForProcess(p);
+  assert(p->finished);
+  assertIntEquals(0, p->exitCode);
+  assertCharStringEquals("hello\n", p->output);
+
+  freeProcess(p);
+  return 0;
+}
+
+static int _testExitCode(void) {
+  Process p = _newShellProcess("exit 3");
+
+  assertNotNull(p);
+  _waitForProcess(p);
+  assertIntEquals(3, p->exitCode);
+
+  freeProcess(p);
+  return 0;
+}
+
+static int _testCrashedProcess(void) {
+  Process p = _newShellProcess("kill -9 $$");
+
+  assertNotNull(p);
+  _waitForProcess(p);
+  assertIntEquals(-1, p->exitCode);
+
+  freeProcess(p);
+  return 0;
+}
+
+static int _testKillProcess(void) {
+  Process p = _newShellProcess("sleep 10");
+
+  assertNotNull(p);
+  assertFalse(processPoll(p));
+  processKill(p);
+  assert(p->finished);
+  assertIntEquals(-1, p->exitCode);
+  assert(processPoll(p));
+
+  freeProcess(p);
+  return 0;
+}
+
+static int _testForkedProcess(void) {
+  boolByte isChild;
+  Process p = newProcessForked(&isChild);
+
+  if (isChild) {
+    // Leave the child without running any cleanup of the test runner
+    _exit(5);
+  }
+
+  assertNotNull(p);
+  _waitForProcess(p);
+  assertIntEquals(5, p->exitCode);
+  assertCharStringEquals("", p->output);
+
+  freeProcess(p);
+  return 0;
+}
+
+static int _testInvalidExecutable(void) {
+  CharString executable = newCharStringWithCString("/invalid/executable");
+  LinkedList arguments = newLinkedList();
+  Process p = newProcess(executable, arguments);
+
+  // The process can be started, but it fails to execute
+  assertNotNull(p);
+  _waitForProcess(p);
+  assert(p->exitCode != 0);
+
+  freeProcess(p);
+  freeLinkedList(arguments);
+  freeCharString(executable);
+  return 0;
+}
+#endif
+
+static int _testFreeNullProcess(void) {
+  freeProcess(NULL);
+  return 0;
+}
+
+TestSuite addProcessTests(void);
+TestSuite addProcessTests(void) {
+  TestSuite testSuite = newTestSuite("Process", NULL, NULL);
+#if UNIX
+  addTest(testSuite, "CaptureOutput", _testCaptureOutput);
+  addTest(testSuite, "ExitCode", _testExitCode);
+  addTest(testSuite, "CrashedProcess", _testCrashedProcess);
+  addTest(testSuite, "KillProcess", _testKillProcess);
+  addTest(testSuite, "ForkedProcess", _testForkedProcess);
+  addTest(testSuite, "InvalidExecutable", _testInvalidExecutable);
+#endif
+  addTest(testSuite, "FreeNullProcess", _testFreeNullProcess);
+  return testSuite;
+}
@@ -0,0 +1,254 @@
+//
+// RingBufferTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/RingBuffer.h"
+#include "base/Thread.h"
+
+#include "unit/TestRunner.h"
+
+static const int kRingBufferTestNumIterations = 10000;
+#define RING_BUFFER_TEST_NUM_PRODUCERS 4
+
+static int _testNewRingBuffer(void) {
+  RingBuffer r = newRingBuffer(sizeof(int), 4);
+  assertNotNull(r);
+  assertSizeEquals(sizeof(int), r->blockSize);
+  assertUnsignedLongEquals(4ul, r->numBlocks);
+  assertFalse(r->multiProducer);
+  assertUnsignedLongEquals(0ul, ringBufferGetNumReadable(r));
+  freeRingBuffer(r);
+  return 0;
+}
+
+static int _testNewRingBufferRoundsUpNumBlocks(void) {
+  RingBuffer r = newRingBuffer(sizeof(int), 5);
+  assertUnsignedLongEquals(8ul, r->numBlocks);
+  freeRingBuffer(r);
+  return 0;
+}
+
+static int _testPushAndPopInOrder(void) {
+  RingBuffer r = newRingBuffer(sizeof(int), 4);
+  int value;
+
+  for (value = 0; value < 3; value++) {
+    assert(ringBufferPush(r, &value));
+  }
+
+  assertUnsignedLongEquals(3ul, ringBufferGetNumReadable(r));
+
+  for (int i = 0; i < 3; i++) {
+    assert(ringBufferPop(r, &value));
+    assertIntEquals(i, value);
+  }
+
+  assertUnsignedLongEquals(0ul, ringBufferGetNumReadable(r));
+  freeRingBuffer(r);
+  return 0;
+}
+
+static int _testPushWhenFull(void) {
+  RingBuffer r = newRingBuffer(sizeof(int), 2);
+  int value = 1;
+
+  assert(ringBufferPush(r, &value));
+  assert(ringBufferPush(r, &value));
+  value = 2;
+  assertFalse(ringBufferPush(r, &value));
+  assertIsNull(ringBufferBeginWrite(r));
+  assert(ringBufferPop(r, &value));
+  assertIntEquals(1, value);
+
+  freeRingBuffer(r);
+  return 0;
+}
+
+static int _testPopWhenEmpty(void) {
+  RingBuffer r = newRingBuffer(sizeof(int), 2);
+  int value = 5;
+
+  assertFalse(ringBufferPop(r, &value));
+  assertIntEquals(5, value);
+  assertIsNull(ringBufferBeginRead(r));
+
+  freeRingBuffer(r);
+  return 0;
+}
+
+static int _testPushAndPopWrapsAround(void) {
+  RingBuffer r = newRingBuffer(sizeof(int), 4);
+  int value;
+
+  for (int i = 0; i < 10; i++) {
+    value = i;
+    assert(ringBufferPush(r, &value));
+    value = i + 1;
+    assert(ringBufferPush(r, &value));
+    assert(ringBufferPop(r, &value));
+    assertIntEquals(i, value);
+    assert(ringBufferPop(r, &value));
+    assertIntEquals(i + 1, value);
+  }
+
+  freeRingBuffer(r);
+  return 0;
+}
+
+static int _testWriteAndReadInPlace(void) {
+  RingBuffer r = newRingBuffer(sizeof(int) * 2, 2);
+  int *writeBlock = (int *)ringBufferBeginWrite(r);
+  const int *readBlock;
+
+  assertNotNull(writeBlock);
+  writeBlock[0] = 3;
+  writeBlock[1] = 4;
+  // Not visible to the consumer until the write is finished
+  assertIsNull(ringBufferBeginRead(r));
+  ringBufferEndWrite(r);
+
+  readBlock = (const int *)ringBufferBeginRead(r);
+  assertNotNull(readBlock);
+  assertIntEquals(3, readBlock[0]);
+  assertIntEquals(4, readBlock[1]);
+  ringBufferEndRead(r);
+  assertIsNull(ringBufferBeginRead(r));
+
+  freeRingBuffer(r);
+  return 0;
+}
+
+static int _testMultiProducerPushAndPop(void) {
+  RingBuffer r = newRingBufferMultiProducer(sizeof(int), 2);
+  int value;
+
+  assert(r->multiProducer);
+  assertIsNull(ringBufferBeginWrite(r));
+
+  for (int i = 0; i < 5; i++) {
+    value = i;
+    assert(ringBufferPush(r, &value));
+    value = i + 1;
+    assert(ringBufferPush(r, &value));
+    assertFalse(ringBufferPush(r, &value));
+    assertUnsignedLongEquals(2ul, ringBufferGetNumReadable(r));
+    assert(ringBufferPop(r, &value));
+    assertIntEquals(i, value);
+    assert(ringBufferPop(r, &value));
+    assertIntEquals(i + 1, value);
+    assertFalse(ringBufferPop(r, &value));
+  }
+
+  freeRingBuffer(r);
+  return 0;
+}
+
+static int _testFreeNullRingBuffer(void) {
+  freeRingBuffer(NULL);
+  return 0;
+}
+
+typedef struct {
+  RingBuffer ringBuffer;
+  int producerId;
+} _RingBufferTestProducerData;
+
+// Blocks carry the producer's id and a sequence number, so that the consumer
+// can check that no block was lost, duplicated or reordered
+static void _producerThreadFunc(void *userData) {
+  _RingBufferTestProducerData *data = (_RingBufferTestProducerData *)userData;
+  int block[2];
+
+  block[0] = data->producerId;
+
+  for (int i = 0; i < kRingBufferTestNumIterations; i++) {
+    block[1] = i;
+
+    while (!ringBufferPush(data->ringBuffer, block)) {
+      // Spin until the consumer has made room
+    }
+  }
+}
+
+static int _testPushAndPopFromThreads(RingBuffer r, int numProducers) {
+  _RingBufferTestProducerData data[RING_BUFFER_TEST_NUM_PRODUCERS];
+  Thread producers[RING_BUFFER_TEST_NUM_PRODUCERS];
+  int nextSequence[RING_BUFFER_TEST_NUM_PRODUCERS];
+  int block[2];
+
+  for (int i = 0; i < numProducers; i++) {
+    data[i].ringBuffer = r;
+    data[i].producerId = i;
+    nextSequence[i] = 0;
+    producers[i] = newThread(_producerThreadFunc, &data[i]);
+    assertNotNull(producers[i]);
+  }
+
+  for (int i = 0; i < kRingBufferTestNumIterations * numProducers; i++) {
+    while (!ringBufferPop(r, block)) {
+      // Spin until a producer has pushed a block
+    }
+
+    assert(block[0] >= 0 && block[0] < numProducers);
+    assertIntEquals(nextSequence[block[0]], block[1]);
+    nextSequence[block[0]]++;
+  }
+
+  for (int i = 0; i < numProducers; i++) {
+    threadJoinAndFree(producers[i]);
+  }
+
+  assertUnsignedLongEquals(0ul, ringBufferGetNumReadable(r));
+  freeRingBuffer(r);
+  return 0;
+}
+
+static int _testSingleProducerThread(void) {
+  return _testPushAndPopFromThreads(newRingBuffer(sizeof(int) * 2, 16), 1);
+}
+
+static int _testMultiProducerThreads(void) {
+  return _testPushAndPopFromThreads(
+      newRingBufferMultiProducer(sizeof(int) * 2, 16),
+      RING_BUFFER_TEST_NUM_PRODUCERS);
+}
+
+TestSuite addRingBufferTests(void);
+TestSuite addRingBufferTests(void) {
+  TestSuite testSuite = newTestSuite("RingBuffer", NULL, NULL);
+  addTest(testSuite, "NewRingBuffer", _testNewRingBuffer);
+  addTest(testSuite, "NewRingBufferRoundsUpNumBlocks",
+          _testNewRingBufferRoundsUpNumBlocks);
+  addTest(testSuite, "PushAndPopInOrder", _testPushAndPopInOrder);
+  addTest(testSuite, "PushWhenFull", _testPushWhenFull);
+  addTest(testSuite, "PopWhenEmpty", _testPopWhenEmpty);
+  addTest(testSuite, "PushAndPopWrapsAround", _testPushAndPopWrapsAround);
+  addTest(testSuite, "WriteAndReadInPlace", _testWriteAndReadInPlace);
+  addTest(testSuite, "MultiProducerPushAndPop", _testMultiProducerPushAndPop);
+  addTest(testSuite, "FreeNullRingBuffer", _testFreeNullRingBuffer);
+  addTest(testSuite, "SingleProducerThread", _testSingleProducerThread);
+  addTest(testSuite, "MultiProducerThreads", _testMultiProducerThreads);
+  return testSuite;
+}
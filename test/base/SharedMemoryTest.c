@@ -0,0 +1,190 @@
+//
+// SharedMemoryTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/SharedMemory.h"
+
+#include "base/Thread.h"
+#include "time/TaskTimer.h"
+#include "unit/TestRunner.h"
+
+#if UNIX
+static const size_t kSharedMemoryTestSize = 4096;
+
+static int _testNewSharedMemory(void) {
+  SharedMemory s = newSharedMemory(kSharedMemoryTestSize);
+  const byte *data;
+  size_t i;
+
+  assertNotNull(s);
+  assertSizeEquals(kSharedMemoryTestSize, s->size);
+  assertFalse(charStringIsEmpty(s->name));
+
+  data = (const byte *)s->data;
+  for (i = 0; i < s->size; i++) {
+    assertIntEquals(0, data[i]);
+  }
+
+  freeSharedMemory(s);
+  return 0;
+}
+
+static int _testUniqueNames(void) {
+  SharedMemory s1 = newSharedMemory(64);
+  SharedMemory s2 = newSharedMemory(64);
+
+  assertNotNull(s1);
+  assertNotNull(s2);
+  assertFalse(charStringIsEqualTo(s1->name, s2->name, false));
+
+  freeSharedMemory(s1);
+  freeSharedMemory(s2);
+  return 0;
+}
+
+static int _testOpenWithName(void) {
+  SharedMemory s = newSharedMemory(kSharedMemoryTestSize);
+  SharedMemory opened;
+
+  assertNotNull(s);
+  opened = newSharedMemoryWithName(s->name);
+  assertNotNull(opened);
+  assertSizeEquals(kSharedMemoryTestSize, opened->size);
+
+  // Both mappings refer to the same memory
+  ((char *)s->data)[100] = 42;
+  assertIntEquals(42, ((char *)opened->data)[100]);
+
+  freeSharedMemory(opened);
+  freeSharedMemory(s);
+  return 0;
+}
+
+static int _testOpenRemovedSharedMemory(void) {
+  SharedMemory s = newSharedMemory(64);
+  CharString name;
+
+  assertNotNull(s);
+  name = newCharStringWithCString(s->name->data);
+  freeSharedMemory(s);
+  assertIsNull(newSharedMemoryWithName(name));
+
+  freeCharString(name);
+  return 0;
+}
+
+static int _testUnlinkKeepsMapping(void) {
+  SharedMemory s = newSharedMemory(64);
+  SharedMemory opened;
+
+  assertNotNull(s);
+  opened = newSharedMemoryWithName(s->name);
+  assertNotNull(opened);
+  sharedMemoryUnlink(s);
+  assertIsNull(newSharedMemoryWithName(s->name));
+
+  ((char *)s->data)[10] = 7;
+  assertIntEquals(7, ((char *)opened->data)[10]);
+
+  freeSharedMemory(opened);
+  freeSharedMemory(s);
+  return 0;
+}
+
+static int _testWaitForChangedValue(void) {
+  SharedMemory s = newSharedMemory(64);
+  volatile unsigned int *value;
+
+  assertNotNull(s);
+  value = (volatile unsigned int *)s->data;
+  *value = 2;
+  assert(sharedMemoryWait(value, 1, 1000));
+
+  freeSharedMemory(s);
+  return 0;
+}
+
+static int _testWaitTimesOut(void) {
+  SharedMemory s = newSharedMemory(64);
+  volatile unsigned int *value;
+
+  assertNotNull(s);
+  value = (volatile unsigned int *)s->data;
+  assertFalse(sharedMemoryWait(value, 0, 10));
+
+  freeSharedMemory(s);
+  return 0;
+}
+
+static void _wakeThread(void *userData) {
+  volatile unsigned int *value = (volatile unsigned int *)userData;
+
+  taskTimerSleep(20.0);
+  atomicStore(value, 1);
+  sharedMemoryWake(value);
+}
+
+static int _testWakeWaitingThread(void) {
+  SharedMemory s = newSharedMemory(64);
+  volatile unsigned int *value;
+  Thread thread;
+
+  assertNotNull(s);
+  value = (volatile unsigned int *)s->data;
+  thread = newThread(_wakeThread, (void *)value);
+  assertNotNull(thread);
+
+  while (atomicLoad(value) == 0) {
+    sharedMemoryWait(value, 0, 1000);
+  }
+  assertIntEquals(1, atomicLoad(value));
+
+  threadJoinAndFree(thread);
+  freeSharedMemory(s);
+  return 0;
+}
+#endif
+
+static int _testFreeNullSharedMemory(void) {
+  freeSharedMemory(NULL);
+  return 0;
+}
+
+TestSuite addSharedMemoryTests(void);
+TestSuite addSharedMemoryTests(void) {
+  TestSuite testSuite = newTestSuite("SharedMemory", NULL, NULL);
+#if UNIX
+  addTest(testSuite, "NewSharedMemory", _testNewSharedMemory);
+  addTest(testSuite, "UniqueNames", _testUniqueNames);
+  addTest(testSuite, "OpenWithName", _testOpenWithName);
+  addTest(testSuite, "OpenRemovedSharedMemory", _testOpenRemovedSharedMemory);
+  addTest(testSuite, "UnlinkKeepsMapping", _testUnlinkKeepsMapping);
+  addTest(testSuite, "WaitForChangedValue", _testWaitForChangedValue);
+  addTest(testSuite, "WaitTimesOut", _testWaitTimesOut);
+  addTest(testSuite, "WakeWaitingThread", _testWakeWaitingThread);
+#endif
+  addTest(testSuite, "FreeNullSharedMemory", _testFreeNullSharedMemory);
+  return testSuite;
+}
@@ -0,0 +1,321 @@
+//
+// SocketTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/Socket.h"
+
+#include "unit/TestRunner.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if UNIX
+#include <unistd.h>
+#endif
+
+static const char *kSocketTestPath = "mrswatsontest.sock";
+static const char *kSocketTestPort = "47913";
+
+static void _socketTestTeardown(void) { remove(kSocketTestPath); }
+
+/**
+ * Connect a client to a listening socket. Since the connection is queued in
+ * the listen backlog, the client and server can both run on this thread.
+ */
+static int _connectClient(const char *addressCString, Socket *outServer,
+                          Socket *outClient, Socket *outConnection) {
+  CharString address = newCharStringWithCString(addressCString);
+
+  *outServer = newSocketListening(address);
+  assertNotNull(*outServer);
+  *outClient = newSocketConnected(address);
+  assertNotNull(*outClient);
+  *outConnection = socketAccept(*outServer);
+  assertNotNull(*outConnection);
+
+  freeCharString(address);
+  return 0;
+}
+
+static int _testSendLine(Socket sender, Socket receiver, const char *text) {
+  CharString line = newCharStringWithCString(text);
+  CharString received = newCharString();
+
+  assert(socketWriteLine(sender, line));
+  assert(socketReadLine(receiver, received));
+  assertCharStringEquals(text, received);
+
+  freeCharString(line);
+  freeCharString(received);
+  return 0;
+}
+
+static int _testNewSocketWithEmptyAddress(void) {
+  CharString address = newCharString();
+  assertIsNull(newSocketListening(address));
+  assertIsNull(newSocketConnected(address));
+  assertIsNull(newSocketListening(NULL));
+  freeCharString(address);
+  return 0;
+}
+
+static int _testTcpSocket(void) {
+  Socket server, client, connection;
+  int result = _connectClient(kSocketTestPort, &server, &client, &connection);
+
+  if (result == 0) {
+    result = _testSendLine(client, connection, "request");
+  }
+  if (result == 0) {
+    result = _testSendLine(connection, client, "OK\t1024");
+  }
+
+  freeSocket(connection);
+  freeSocket(client);
+  freeSocket(server);
+  return result;
+}
+
+static int _testReadFromListeningSocket(void) {
+  CharString address = newCharStringWithCString(kSocketTestPort);
+  CharString line = newCharString();
+  Socket server = newSocketListening(address);
+
+  assertNotNull(server);
+  assertFalse(socketReadLine(server, line));
+  assertFalse(socketWriteLine(server, line));
+
+  freeSocket(server);
+  freeCharString(line);
+  freeCharString(address);
+  return 0;
+}
+
+static int _testSocketOnHost(void) {
+  CharString host = newCharStringWithCString("127.0.0.1");
+  Socket server = newSocketListeningOnHost(host, 47913);
+  Socket client, connection;
+  const byte data[6] = {0, 1, 2, 253, 254, 255};
+  byte received[6];
+  size_t numRead;
+
+  assertNotNull(server);
+  client = newSocketConnectedToHost(host, 47913);
+  assertNotNull(client);
+  connection = socketAccept(server);
+  assertNotNull(connection);
+  socketSetStreamingOptions(client, 64 * 1024);
+
+  assert(socketWrite(client, data, sizeof(data)));
+  numRead = socketRead(connection, received, sizeof(received));
+  assertSizeEquals(sizeof(received), numRead);
+  assertIntEquals(0, memcmp(data, received, sizeof(data)));
+
+  // Reading past the end of a closed connection only returns what was sent
+  assert(socketWrite(client, data, 2));
+  freeSocket(client);
+  numRead = socketRead(connection, received, sizeof(received));
+  assertSizeEquals((size_t)2, numRead);
+
+  freeSocket(connection);
+  freeSocket(server);
+  freeCharString(host);
+  return 0;
+}
+
+static int _testConnectToEmptyHost(void) {
+  CharString host = newCharString();
+  assertIsNull(newSocketConnectedToHost(host, 47913));
+  assertIsNull(newSocketConnectedToHost(NULL, 47913));
+  freeCharString(host);
+  return 0;
+}
+
+#if UNIX
+static int _testUnixSocket(void) {
+  Socket server, client, connection;
+  int result = _connectClient(kSocketTestPath, &server, &client, &connection);
+
+  if (result == 0) {
+    result = _testSendLine(client, connection, "input=a.pcm\toutput=b.pcm");
+  }
+
+  freeSocket(connection);
+  freeSocket(client);
+  freeSocket(server);
+  // Closing the listening socket should remove the socket file
+  assertIsNull(fopen(kSocketTestPath, "r"));
+  return result;
+}
+
+static int _testReadLineStripsCarriageReturn(void) {
+  Socket server, client, connection;
+  CharString line = newCharStringWithCString("request\r");
+  CharString received = newCharString();
+
+  assertIntEquals(
+      0, _connectClient(kSocketTestPath, &server, &client, &connection));
+  assert(socketWriteLine(client, line));
+  assert(socketReadLine(connection, received));
+  assertCharStringEquals("request", received);
+
+  freeSocket(connection);
+  freeSocket(client);
+  freeSocket(server);
+  freeCharString(line);
+  freeCharString(received);
+  return 0;
+}
+
+static int _testReadLineTooLong(void) {
+  Socket server, client, connection;
+  CharString line = newCharStringWithCString("this line is too long");
+  CharString received = newCharStringWithCapacity(8);
+
+  assertIntEquals(
+      0, _connectClient(kSocketTestPath, &server, &client, &connection));
+  assert(socketWriteLine(client, line));
+  assertFalse(socketReadLine(connection, received));
+
+  freeSocket(connection);
+  freeSocket(client);
+  freeSocket(server);
+  freeCharString(line);
+  freeCharString(received);
+  return 0;
+}
+
+static int _testReadLineAfterClose(void) {
+  Socket server, client, connection;
+  CharString received = newCharString();
+
+  assertIntEquals(
+      0, _connectClient(kSocketTestPath, &server, &client, &connection));
+  freeSocket(client);
+  assertFalse(socketReadLine(connection, received));
+
+  freeSocket(connection);
+  freeSocket(server);
+  freeCharString(received);
+  return 0;
+}
+
+static int _testWriteLineAfterClose(void) {
+  Socket server, client, connection;
+  CharString line = newCharStringWithCString("reply");
+  int i;
+
+  assertIntEquals(
+      0, _connectClient(kSocketTestPath, &server, &client, &connection));
+  freeSocket(client);
+
+  // The first write may still succeed, since the remote end has not noticed
+  // the closed connection yet, but this must not raise SIGPIPE
+  for (i = 0; i < 4; i++) {
+    socketWriteLine(connection, line);
+  }
+  assertFalse(socketWriteLine(connection, line));
+
+  freeSocket(connection);
+  freeSocket(server);
+  freeCharString(line);
+  return 0;
+}
+
+static int _testRemoveStaleSocket(void) {
+  CharString address = newCharStringWithCString(kSocketTestPath);
+  Socket first = newSocketListening(address);
+  Socket second;
+
+  assertNotNull(first);
+  // Simulate a server which exited without removing its socket file
+  socketKeepPath(first);
+  freeSocket(first);
+
+  second = newSocketListening(address);
+  assertNotNull(second);
+
+  freeSocket(second);
+  freeCharString(address);
+  return 0;
+}
+
+static int _testKeepPath(void) {
+  CharString address = newCharStringWithCString(kSocketTestPath);
+  Socket server = newSocketListening(address);
+
+  assertNotNull(server);
+  socketKeepPath(server);
+  freeSocket(server);
+  assertIntEquals(0, access(kSocketTestPath, F_OK));
+
+  freeCharString(address);
+  return 0;
+}
+
+static int _testDoNotRemoveRegularFile(void) {
+  CharString address = newCharStringWithCString(kSocketTestPath);
+  FILE *file = fopen(kSocketTestPath, "w");
+
+  assertNotNull(file);
+  fclose(file);
+  assertIsNull(newSocketListening(address));
+  file = fopen(kSocketTestPath, "r");
+  assertNotNull(file);
+  fclose(file);
+
+  freeCharString(address);
+  return 0;
+}
+#endif
+
+static int _testFreeNullSocket(void) {
+  freeSocket(NULL);
+  return 0;
+}
+
+TestSuite addSocketTests(void);
+TestSuite addSocketTests(void) {
+  TestSuite testSuite = newTestSuite("Socket", NULL, _socketTestTeardown);
+  addTest(testSuite, "NewSocketWithEmptyAddress",
+          _testNewSocketWithEmptyAddress);
+  addTest(testSuite, "TcpSocket", _testTcpSocket);
+  addTest(testSuite, "ReadFromListeningSocket", _testReadFromListeningSocket);
+  addTest(testSuite, "SocketOnHost", _testSocketOnHost);
+  addTest(testSuite, "ConnectToEmptyHost", _testConnectToEmptyHost);
+#if UNIX
+  addTest(testSuite, "UnixSocket", _testUnixSocket);
+  addTest(testSuite, "ReadLineStripsCarriageReturn",
+          _testReadLineStripsCarriageReturn);
+  addTest(testSuite, "ReadLineTooLong", _testReadLineTooLong);
+  addTest(testSuite, "ReadLineAfterClose", _testReadLineAfterClose);
+  addTest(testSuite, "WriteLineAfterClose", _testWriteLineAfterClose);
+  addTest(testSuite, "RemoveStaleSocket", _testRemoveStaleSocket);
+  addTest(testSuite, "KeepPath", _testKeepPath);
+  addTest(testSuite, "DoNotRemoveRegularFile", _testDoNotRemoveRegularFile);
+#endif
+  addTest(testSuite, "FreeNullSocket", _testFreeNullSocket);
+  return testSuite;
+}
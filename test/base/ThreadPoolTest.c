@@ -0,0 +1,196 @@
+//
+// ThreadPoolTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/ThreadPool.h"
+
+#include "unit/TestRunner.h"
+
+static const int kThreadPoolTestNumTasks = 1000;
+static const int kThreadPoolTestNumSubtasks = 8;
+
+static void _incrementTaskFunc(void *userData) {
+  atomicAdd((volatile unsigned int *)userData, 1);
+}
+
+static int _testNewThreadPool(void) {
+  ThreadPool p = newThreadPool(2, false);
+  assertNotNull(p);
+  assertUnsignedLongEquals(2ul, p->numWorkers);
+  assertFalse(p->pinToProcessors);
+  freeThreadPool(p);
+  return 0;
+}
+
+static int _testNewThreadPoolWithDefaultNumWorkers(void) {
+  ThreadPool p = newThreadPool(0, false);
+  assertNotNull(p);
+  assert(p->numWorkers > 0);
+  freeThreadPool(p);
+  return 0;
+}
+
+static int _testRunTasks(void) {
+  ThreadPool p = newThreadPool(4, false);
+  ThreadPoolGroup g = newThreadPoolGroup();
+  volatile unsigned int counter = 0;
+
+  for (int i = 0; i < kThreadPoolTestNumTasks; i++) {
+    threadPoolSubmit(p, g, _incrementTaskFunc, (void *)&counter);
+  }
+
+  threadPoolWait(p, g);
+  assertUnsignedLongEquals(0ul, g->numPending);
+  assertUnsignedLongEquals((unsigned long)kThreadPoolTestNumTasks,
+                           atomicLoad(&counter));
+
+  freeThreadPoolGroup(g);
+  freeThreadPool(p);
+  return 0;
+}
+
+static int _testReuseGroup(void) {
+  ThreadPool p = newThreadPool(2, false);
+  ThreadPoolGroup g = newThreadPoolGroup();
+  volatile unsigned int counter = 0;
+
+  for (int i = 0; i < 10; i++) {
+    threadPoolSubmit(p, g, _incrementTaskFunc, (void *)&counter);
+    threadPoolWait(p, g);
+    assertUnsignedLongEquals((unsigned long)i + 1, atomicLoad(&counter));
+  }
+
+  freeThreadPoolGroup(g);
+  freeThreadPool(p);
+  return 0;
+}
+
+static int _testWaitForEmptyGroup(void) {
+  ThreadPool p = newThreadPool(1, false);
+  ThreadPoolGroup g = newThreadPoolGroup();
+  // Should not block
+  threadPoolWait(p, g);
+  freeThreadPoolGroup(g);
+  freeThreadPool(p);
+  return 0;
+}
+
+static int _testFreeRunsQueuedTasks(void) {
+  ThreadPool p = newThreadPool(2, false);
+  volatile unsigned int counter = 0;
+
+  for (int i = 0; i < kThreadPoolTestNumTasks; i++) {
+    threadPoolSubmit(p, NULL, _incrementTaskFunc, (void *)&counter);
+  }
+
+  freeThreadPool(p);
+  assertUnsignedLongEquals((unsigned long)kThreadPoolTestNumTasks,
+                           atomicLoad(&counter));
+  return 0;
+}
+
+typedef struct {
+  ThreadPool pool;
+  volatile unsigned int counter;
+} _ThreadPoolTestNestedData;
+
+// Each task splits into subtasks and waits for them, which only finishes if
+// waiting threads keep running tasks, since there are fewer workers than
+// waiting tasks
+static void _nestedTaskFunc(void *userData) {
+  _ThreadPoolTestNestedData *data = (_ThreadPoolTestNestedData *)userData;
+  ThreadPoolGroup subtasks = newThreadPoolGroup();
+
+  for (int i = 0; i < kThreadPoolTestNumSubtasks; i++) {
+    threadPoolSubmit(data->pool, subtasks, _incrementTaskFunc,
+                     (void *)&data->counter);
+  }
+
+  threadPoolWait(data->pool, subtasks);
+  freeThreadPoolGroup(subtasks);
+}
+
+static int _testNestedTasks(void) {
+  _ThreadPoolTestNestedData data;
+  ThreadPoolGroup g = newThreadPoolGroup();
+
+  data.pool = newThreadPool(2, false);
+  data.counter = 0;
+
+  for (int i = 0; i < 16; i++) {
+    threadPoolSubmit(data.pool, g, _nestedTaskFunc, &data);
+  }
+
+  threadPoolWait(data.pool, g);
+  assertUnsignedLongEquals((unsigned long)(16 * kThreadPoolTestNumSubtasks),
+                           atomicLoad(&data.counter));
+
+  freeThreadPoolGroup(g);
+  freeThreadPool(data.pool);
+  return 0;
+}
+
+static int _testPinToProcessors(void) {
+  ThreadPool p = newThreadPool(2, true);
+  ThreadPoolGroup g = newThreadPoolGroup();
+  volatile unsigned int counter = 0;
+
+  // Pinning may not be allowed on this system, but tasks must still run
+  assertNotNull(p);
+
+  for (int i = 0; i < kThreadPoolTestNumTasks; i++) {
+    threadPoolSubmit(p, g, _incrementTaskFunc, (void *)&counter);
+  }
+
+  threadPoolWait(p, g);
+  assertUnsignedLongEquals((unsigned long)kThreadPoolTestNumTasks,
+                           atomicLoad(&counter));
+
+  freeThreadPoolGroup(g);
+  freeThreadPool(p);
+  return 0;
+}
+
+static int _testFreeNullThreadPool(void) {
+  freeThreadPool(NULL);
+  freeThreadPoolGroup(NULL);
+  return 0;
+}
+
+TestSuite addThreadPoolTests(void);
+TestSuite addThreadPoolTests(void) {
+  TestSuite testSuite = newTestSuite("ThreadPool", NULL, NULL);
+  addTest(testSuite, "NewThreadPool", _testNewThreadPool);
+  addTest(testSuite, "NewThreadPoolWithDefaultNumWorkers",
+          _testNewThreadPoolWithDefaultNumWorkers);
+  addTest(testSuite, "RunTasks", _testRunTasks);
+  addTest(testSuite, "ReuseGroup", _testReuseGroup);
+  addTest(testSuite, "WaitForEmptyGroup", _testWaitForEmptyGroup);
+  addTest(testSuite, "FreeRunsQueuedTasks", _testFreeRunsQueuedTasks);
+  addTest(testSuite, "NestedTasks", _testNestedTasks);
+  addTest(testSuite, "PinToProcessors", _testPinToProcessors);
+  addTest(testSuite, "FreeNullThreadPool", _testFreeNullThreadPool);
+  return testSuite;
+}
@@ -0,0 +1,215 @@
+//
+// ThreadTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/Thread.h"
+
+#include "unit/TestRunner.h"
+
+static const int kThreadTestNumIterations = 1000;
+
+static void _setFlagThreadFunc(void *userData) {
+  boolByte *flag = (boolByte *)userData;
+  *flag = true;
+}
+
+static int _testNewThread(void) {
+  boolByte flag = false;
+  Thread t = newThread(_setFlagThreadFunc, &flag);
+  assertNotNull(t);
+  threadJoinAndFree(t);
+  assert(flag);
+  return 0;
+}
+
+static int _testJoinNullThread(void) {
+  threadJoinAndFree(NULL);
+  return 0;
+}
+
+static int _testSetAffinityListInvalid(void) {
+  assertFalse(threadSetAffinityList(""));
+  assertFalse(threadSetAffinityList("a"));
+  assertFalse(threadSetAffinityList("3-1"));
+  assertFalse(threadSetAffinityList("0-"));
+  assertFalse(threadSetAffinityList("0;1"));
+  assertFalse(threadSetAffinityList("0,,1"));
+  assertFalse(threadSetAffinityList("100000"));
+  return 0;
+}
+
+static void _setAffinityListThreadFunc(void *userData) {
+  boolByte *result = (boolByte *)userData;
+  *result = threadSetAffinityList("0");
+}
+
+static int _testSetAffinityList(void) {
+  boolByte result = false;
+  // Pin a separate thread, since the test runner's thread must not be pinned
+  Thread t = newThread(_setAffinityListThreadFunc, &result);
+  assertNotNull(t);
+  threadJoinAndFree(t);
+#if LINUX || WINDOWS
+  assert(result);
+#else
+  assertFalse(result);
+#endif
+  return 0;
+}
+
+static void _setBackgroundPriorityThreadFunc(void *userData) {
+  boolByte *result = (boolByte *)userData;
+  *result = threadSetBackgroundPriority();
+}
+
+static int _testSetBackgroundPriority(void) {
+  boolByte result = false;
+  // Lowering the priority can't be undone without privileges, so this is also
+  // done on a separate thread
+  Thread t = newThread(_setBackgroundPriorityThreadFunc, &result);
+  assertNotNull(t);
+  threadJoinAndFree(t);
+#if LINUX || MACOSX || WINDOWS
+  assert(result);
+#endif
+  return 0;
+}
+
+static int _testSemaphoreWithInitialCount(void) {
+  Semaphore s = newSemaphore(2);
+  // Should not block
+  semaphoreWait(s);
+  semaphoreWait(s);
+  assertIntEquals(0, s->count);
+  freeSemaphore(s);
+  return 0;
+}
+
+typedef struct {
+  Semaphore produced;
+  Semaphore consumed;
+  int value;
+  int sum;
+} _ThreadTestHandoffData;
+
+static void _consumerThreadFunc(void *userData) {
+  _ThreadTestHandoffData *data = (_ThreadTestHandoffData *)userData;
+  int i;
+
+  for (i = 0; i < kThreadTestNumIterations; i++) {
+    semaphoreWait(data->produced);
+    data->sum += data->value;
+    semaphorePost(data->consumed);
+  }
+}
+
+static int _testSemaphoreHandoff(void) {
+  _ThreadTestHandoffData data;
+  Thread consumer;
+  int expectedSum = 0;
+  int i;
+
+  data.produced = newSemaphore(0);
+  data.consumed = newSemaphore(0);
+  data.value = 0;
+  data.sum = 0;
+  consumer = newThread(_consumerThreadFunc, &data);
+  assertNotNull(consumer);
+
+  for (i = 0; i < kThreadTestNumIterations; i++) {
+    data.value = i;
+    expectedSum += i;
+    semaphorePost(data.produced);
+    semaphoreWait(data.consumed);
+  }
+
+  threadJoinAndFree(consumer);
+  assertIntEquals(expectedSum, data.sum);
+
+  freeSemaphore(data.produced);
+  freeSemaphore(data.consumed);
+  return 0;
+}
+
+static int _testFreeNullSemaphore(void) {
+  freeSemaphore(NULL);
+  return 0;
+}
+
+typedef struct {
+  Mutex mutex;
+  int counter;
+} _ThreadTestMutexData;
+
+static void _incrementThreadFunc(void *userData) {
+  _ThreadTestMutexData *data = (_ThreadTestMutexData *)userData;
+  int i;
+
+  for (i = 0; i < kThreadTestNumIterations; i++) {
+    mutexLock(data->mutex);
+    data->counter++;
+    mutexUnlock(data->mutex);
+  }
+}
+
+static int _testMutexGuardsCounter(void) {
+  _ThreadTestMutexData data;
+  Thread t1, t2;
+
+  data.mutex = newMutex();
+  data.counter = 0;
+  t1 = newThread(_incrementThreadFunc, &data);
+  t2 = newThread(_incrementThreadFunc, &data);
+  assertNotNull(t1);
+  assertNotNull(t2);
+  threadJoinAndFree(t1);
+  threadJoinAndFree(t2);
+  assertIntEquals(kThreadTestNumIterations * 2, data.counter);
+
+  freeMutex(data.mutex);
+  return 0;
+}
+
+static int _testFreeNullMutex(void) {
+  freeMutex(NULL);
+  return 0;
+}
+
+TestSuite addThreadTests(void);
+TestSuite addThreadTests(void) {
+  TestSuite testSuite = newTestSuite("Thread", NULL, NULL);
+  addTest(testSuite, "NewThread", _testNewThread);
+  addTest(testSuite, "JoinNullThread", _testJoinNullThread);
+  addTest(testSuite, "SetAffinityListInvalid", _testSetAffinityListInvalid);
+  addTest(testSuite, "SetAffinityList", _testSetAffinityList);
+  addTest(testSuite, "SetBackgroundPriority", _testSetBackgroundPriority);
+  addTest(testSuite, "SemaphoreWithInitialCount",
+          _testSemaphoreWithInitialCount);
+  addTest(testSuite, "SemaphoreHandoff", _testSemaphoreHandoff);
+  addTest(testSuite, "FreeNullSemaphore", _testFreeNullSemaphore);
+  addTest(testSuite, "MutexGuardsCounter", _testMutexGuardsCounter);
+  addTest(testSuite, "FreeNullMutex", _testFreeNullMutex);
+  return testSuite;
+}
@@ -0,0 +1,110 @@
+//
+// XxHashTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/XxHash.h"
+
+#include "unit/TestRunner.h"
+
+#include <string.h>
+
+static const char *kXxHashTestLongInput =
+    "Nobody inspects the spammish repetition";
+
+// Hashes from the reference implementation
+static int _testHashEmptyInput(void) {
+  assert(xxHash64("", 0, 0) == 0xef46db3751d8e999ull);
+  return 0;
+}
+
+static int _testHashShortInput(void) {
+  assert(xxHash64("a", 1, 0) == 0xd24ec4f1a98c6e5bull);
+  assert(xxHash64("abc", 3, 0) == 0x44bc2cf5ad770999ull);
+  return 0;
+}
+
+static int _testHashLongInput(void) {
+  assert(xxHash64(kXxHashTestLongInput, strlen(kXxHashTestLongInput), 0) ==
+         0xfbcea83c8a378bf1ull);
+  return 0;
+}
+
+static int _testSeedChangesHash(void) {
+  assert(xxHash64("abc", 3, 0) != xxHash64("abc", 3, 1));
+  return 0;
+}
+
+static int _testUpdateInPieces(void) {
+  byte data[1000];
+  XxHash x = newXxHash(42);
+  size_t position = 0;
+  size_t pieceSize = 1;
+  size_t i;
+
+  for (i = 0; i < sizeof(data); i++) {
+    data[i] = (byte)(i * 7);
+  }
+
+  // Pieces of every size from 1 byte up, which start at every offset into the
+  // 32-byte rounds
+  while (position < sizeof(data)) {
+    if (pieceSize > sizeof(data) - position) {
+      pieceSize = sizeof(data) - position;
+    }
+
+    xxHashUpdate(x, data + position, pieceSize);
+    position += pieceSize;
+    pieceSize++;
+  }
+
+  assert(xxHashDigest(x) == xxHash64(data, sizeof(data), 42));
+
+  freeXxHash(x);
+  return 0;
+}
+
+static int _testReset(void) {
+  XxHash x = newXxHash(0);
+
+  xxHashUpdate(x, "abc", 3);
+  xxHashReset(x);
+  assert(xxHashDigest(x) == 0xef46db3751d8e999ull);
+  xxHashUpdate(x, "a", 1);
+  assert(xxHashDigest(x) == 0xd24ec4f1a98c6e5bull);
+
+  freeXxHash(x);
+  return 0;
+}
+
+TestSuite addXxHashTests(void);
+TestSuite addXxHashTests(void) {
+  TestSuite testSuite = newTestSuite("XxHash", NULL, NULL);
+  addTest(testSuite, "HashEmptyInput", _testHashEmptyInput);
+  addTest(testSuite, "HashShortInput", _testHashShortInput);
+  addTest(testSuite, "HashLongInput", _testHashLongInput);
+  addTest(testSuite, "SeedChangesHash", _testSeedChangesHash);
+  addTest(testSuite, "UpdateInPieces", _testUpdateInPieces);
+  addTest(testSuite, "Reset", _testReset);
+  return testSuite;
+}
@@ -0,0 +1,170 @@
+//
+// RiffFileTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "io/RiffFile.h"
+
+#include "unit/TestRunner.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_RIFF_FILENAME "mrswatsontest-riff-index.wav"
+
+static void _riffFileTeardown(void) { remove(TEST_RIFF_FILENAME); }
+
+static void _writeChunk(FILE *fileHandle, const char *id, unsigned int size,
+                        byte value) {
+  byte sizeBytes[4];
+  unsigned int i;
+
+  sizeBytes[0] = (byte)(size & 0xff);
+  sizeBytes[1] = (byte)((size >> 8) & 0xff);
+  sizeBytes[2] = (byte)((size >> 16) & 0xff);
+  sizeBytes[3] = (byte)((size >> 24) & 0xff);
+  fwrite(id, 1, 4, fileHandle);
+  fwrite(sizeBytes, 1, 4, fileHandle);
+
+  // Chunks are padded to an even size
+  for (i = 0; i < size + (size & 1); i++) {
+    fputc(i < size ? value : 0, fileHandle);
+  }
+}
+
+// A large metadata chunk with an odd size, then the data chunk before the
+// format chunk
+static FILE *_openTestFile(void) {
+  FILE *fileHandle = fopen(TEST_RIFF_FILENAME, "wb");
+
+  if (fileHandle == NULL) {
+    return NULL;
+  }
+
+  _writeChunk(fileHandle, "bext", 100001, 1);
+  _writeChunk(fileHandle, "data", 64, 2);
+  _writeChunk(fileHandle, "fmt ", 16, 3);
+  fclose(fileHandle);
+  return fopen(TEST_RIFF_FILENAME, "rb");
+}
+
+static int _testFindChunksInAnyOrder(void) {
+  FILE *fileHandle = _openTestFile();
+  RiffChunkIndex index;
+  RiffChunk chunk = newRiffChunk();
+  assertNotNull(fileHandle);
+  index = newRiffChunkIndex(fileHandle, false);
+  assertNotNull(index);
+
+  assert(riffChunkIndexFind(index, "fmt ", chunk, true));
+  assert(riffChunkIsIdEqualTo(chunk, "fmt "));
+  assertUnsignedLongEquals(16ul, (unsigned long)chunk->size);
+  assertIntEquals(3, chunk->data[15]);
+
+  // The data chunk was already indexed while looking for the format chunk
+  assert(riffChunkIndexFind(index, "data", chunk, false));
+  assertUnsignedLongEquals(64ul, (unsigned long)chunk->size);
+  assertIntEquals(100018, (int)ftell(fileHandle));
+  assertIntEquals(2, fgetc(fileHandle));
+
+  freeRiffChunkIndex(index);
+  freeRiffChunk(chunk);
+  fclose(fileHandle);
+  return 0;
+}
+
+static int _testIndexOnlyAsFarAsNeeded(void) {
+  FILE *fileHandle = _openTestFile();
+  RiffChunkIndex index;
+  RiffChunk chunk = newRiffChunk();
+  assertNotNull(fileHandle);
+  index = newRiffChunkIndex(fileHandle, false);
+  assertNotNull(index);
+
+  assert(riffChunkIndexFind(index, "bext", chunk, false));
+  assertIsNull(chunk->data);
+  assertUnsignedLongEquals(1ul, (unsigned long)index->numEntries);
+  assert(riffChunkIndexFind(index, "data", chunk, false));
+  assertUnsignedLongEquals(2ul, (unsigned long)index->numEntries);
+
+  freeRiffChunkIndex(index);
+  freeRiffChunk(chunk);
+  fclose(fileHandle);
+  return 0;
+}
+
+static int _testFindMissingChunk(void) {
+  FILE *fileHandle = _openTestFile();
+  RiffChunkIndex index;
+  RiffChunk chunk = newRiffChunk();
+  assertNotNull(fileHandle);
+  index = newRiffChunkIndex(fileHandle, false);
+  assertNotNull(index);
+
+  assertFalse(riffChunkIndexFind(index, "LIST", chunk, false));
+  assertUnsignedLongEquals(3ul, (unsigned long)index->numEntries);
+  assert(index->finished);
+
+  freeRiffChunkIndex(index);
+  freeRiffChunk(chunk);
+  fclose(fileHandle);
+  return 0;
+}
+
+// A placeholder size, as RF64 files have for their data chunk, ends the index
+static int _testChunkRunningPastEndOfFile(void) {
+  FILE *fileHandle = fopen(TEST_RIFF_FILENAME, "wb");
+  RiffChunkIndex index;
+  RiffChunk chunk = newRiffChunk();
+  assertNotNull(fileHandle);
+  _writeChunk(fileHandle, "fmt ", 16, 3);
+  fwrite("data", 1, 4, fileHandle);
+  fwrite("\xff\xff\xff\xff", 1, 4, fileHandle);
+  _writeChunk(fileHandle, "fake", 8, 4);
+  fclose(fileHandle);
+
+  fileHandle = fopen(TEST_RIFF_FILENAME, "rb");
+  assertNotNull(fileHandle);
+  index = newRiffChunkIndex(fileHandle, false);
+  assertNotNull(index);
+
+  assert(riffChunkIndexFind(index, "data", chunk, false));
+  assertUnsignedLongEquals(0xfffffffful, (unsigned long)chunk->size);
+  assertFalse(riffChunkIndexFind(index, "fake", chunk, false));
+
+  freeRiffChunkIndex(index);
+  freeRiffChunk(chunk);
+  fclose(fileHandle);
+  return 0;
+}
+
+TestSuite addRiffFileTests(void);
+TestSuite addRiffFileTests(void) {
+  TestSuite testSuite = newTestSuite("RiffFile", NULL, _riffFileTeardown);
+  addTest(testSuite, "FindChunksInAnyOrder", _testFindChunksInAnyOrder);
+  addTest(testSuite, "IndexOnlyAsFarAsNeeded", _testIndexOnlyAsFarAsNeeded);
+  addTest(testSuite, "FindMissingChunk", _testFindMissingChunk);
+  addTest(testSuite, "ChunkRunningPastEndOfFile",
+          _testChunkRunningPastEndOfFile);
+  return testSuite;
+}
@@ -0,0 +1,323 @@
+//
+// SampleSourceAsyncTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "io/SampleSourceAsync.h"
+
+#include "audio/AudioSettings.h"
+#include "unit/TestRunner.h"
+
+#include <math.h>
+#include <stdio.h>
+
+static const char *kSampleSourceAsyncTestFilename = "async-test.pcm";
+static const char *kSampleSourceAsyncTestWaveFilename = "async-test.wav";
+static const SampleCount kSampleSourceAsyncTestBlocksize = 64;
+static const int kSampleSourceAsyncTestNumFullBlocks = 10;
+
+static void _sampleSourceAsyncSetup(void) {
+  initAudioSettings();
+  setBlocksize(kSampleSourceAsyncTestBlocksize);
+}
+
+static void _sampleSourceAsyncTeardown(void) {
+  remove(kSampleSourceAsyncTestFilename);
+  remove(kSampleSourceAsyncTestWaveFilename);
+  freeAudioSettings();
+}
+
+static Sample _getTestSample(int block, SampleCount frame) {
+  return (Sample)((block * kSampleSourceAsyncTestBlocksize + frame) % 100) /
+         200.0f;
+}
+
+// Write a few full blocks followed by one half block of test data. If
+// writeBehindBlocks is nonzero, then the file is written through an
+// asynchronous writer with that many blocks.
+static void _writeTestFile(const char *filenameCString,
+                           unsigned int writeBehindBlocks) {
+  CharString filename = newCharStringWithCString(filenameCString);
+  SampleSource s = sampleSourceFactory(filename);
+  SampleBuffer b =
+      newSampleBuffer(getNumChannels(), kSampleSourceAsyncTestBlocksize);
+  ChannelCount channel;
+  SampleCount frame;
+  int block;
+
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE);
+
+  if (writeBehindBlocks > 0) {
+    s = newSampleSourceAsyncWriter(s, writeBehindBlocks,
+                                   kSampleSourceAsyncTestBlocksize);
+  }
+
+  for (block = 0; block <= kSampleSourceAsyncTestNumFullBlocks; block++) {
+    for (channel = 0; channel < b->numChannels; channel++) {
+      for (frame = 0; frame < b->blocksize; frame++) {
+        b->samples[channel][frame] = _getTestSample(block, frame);
+      }
+    }
+
+    if (block == kSampleSourceAsyncTestNumFullBlocks) {
+      b->blocksize /= 2;
+    }
+
+    s->writeSampleBlock(s, b);
+  }
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  freeCharString(filename);
+}
+
+static SampleSource _openTestFile(const char *filenameCString) {
+  CharString filename = newCharStringWithCString(filenameCString);
+  SampleSource s = sampleSourceFactory(filename);
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_READ);
+  freeCharString(filename);
+  return s;
+}
+
+static int _testNewAsyncReaderWithUnopenedSource(void) {
+  SampleSource s = sampleSourceFactory(NULL);
+  assertIsNull(
+      newSampleSourceAsyncReader(s, 4, kSampleSourceAsyncTestBlocksize));
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testNewAsyncReaderWithZeroBlocks(void) {
+  SampleSource s;
+  _writeTestFile(kSampleSourceAsyncTestFilename, 0);
+  s = _openTestFile(kSampleSourceAsyncTestFilename);
+  assertIsNull(
+      newSampleSourceAsyncReader(s, 0, kSampleSourceAsyncTestBlocksize));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testReadAllBlocks(void) {
+  SampleSource s;
+  SampleBuffer b =
+      newSampleBuffer(getNumChannels(), kSampleSourceAsyncTestBlocksize);
+  SampleCount frame;
+  int block;
+
+  _writeTestFile(kSampleSourceAsyncTestFilename, 0);
+  s = newSampleSourceAsyncReader(_openTestFile(kSampleSourceAsyncTestFilename),
+                                 2, kSampleSourceAsyncTestBlocksize);
+  assertNotNull(s);
+  assertIntEquals(SAMPLE_SOURCE_TYPE_PCM, s->sampleSourceType);
+
+  for (block = 0; block < kSampleSourceAsyncTestNumFullBlocks; block++) {
+    assert(s->readSampleBlock(s, b));
+    assertUnsignedLongEquals(kSampleSourceAsyncTestBlocksize, b->blocksize);
+
+    for (frame = 0; frame < b->blocksize; frame++) {
+      // Compare the difference, since 16-bit PCM does not round-trip exactly
+      assertDoubleEquals(
+          0.0, fabs(_getTestSample(block, frame) - b->samples[0][frame]),
+          TEST_DEFAULT_TOLERANCE);
+    }
+  }
+
+  assertFalse(s->readSampleBlock(s, b));
+  assertUnsignedLongEquals(kSampleSourceAsyncTestBlocksize / 2, b->blocksize);
+  assertUnsignedLongEquals(
+      (kSampleSourceAsyncTestNumFullBlocks * kSampleSourceAsyncTestBlocksize +
+       kSampleSourceAsyncTestBlocksize / 2) *
+          getNumChannels(),
+      s->numSamplesProcessed);
+
+  // Reads past the end of the source should not block
+  b->blocksize = kSampleSourceAsyncTestBlocksize;
+  assertFalse(s->readSampleBlock(s, b));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, b->blocksize);
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  return 0;
+}
+
+static int _testReadBlocksLargerThanBlocksize(void) {
+  const SampleCount largeBlocksize = kSampleSourceAsyncTestBlocksize * 4;
+  SampleSource s;
+  SampleBuffer b = newSampleBuffer(getNumChannels(), largeBlocksize);
+  SampleCount frame;
+  int smallBlock;
+  int block;
+
+  _writeTestFile(kSampleSourceAsyncTestFilename, 0);
+  s = newSampleSourceAsyncReader(_openTestFile(kSampleSourceAsyncTestFilename),
+                                 2, largeBlocksize);
+  assertNotNull(s);
+
+  // 10 full blocks and one half block make two large blocks and a partial one
+  for (block = 0; block < 2; block++) {
+    assert(s->readSampleBlock(s, b));
+    assertUnsignedLongEquals(largeBlocksize, b->blocksize);
+
+    for (frame = 0; frame < b->blocksize; frame++) {
+      smallBlock = block * 4 + (int)(frame / kSampleSourceAsyncTestBlocksize);
+      assertDoubleEquals(
+          0.0,
+          fabs(_getTestSample(smallBlock,
+                              frame % kSampleSourceAsyncTestBlocksize) -
+               b->samples[0][frame]),
+          TEST_DEFAULT_TOLERANCE);
+    }
+  }
+
+  assertFalse(s->readSampleBlock(s, b));
+  assertUnsignedLongEquals(kSampleSourceAsyncTestBlocksize * 2 +
+                               kSampleSourceAsyncTestBlocksize / 2,
+                           b->blocksize);
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  return 0;
+}
+
+static int _testCloseBeforeFinished(void) {
+  SampleSource s;
+  SampleBuffer b =
+      newSampleBuffer(getNumChannels(), kSampleSourceAsyncTestBlocksize);
+
+  _writeTestFile(kSampleSourceAsyncTestFilename, 0);
+  s = newSampleSourceAsyncReader(_openTestFile(kSampleSourceAsyncTestFilename),
+                                 1, kSampleSourceAsyncTestBlocksize);
+  assertNotNull(s);
+  assert(s->readSampleBlock(s, b));
+  // The reader thread is now blocked waiting for a free block
+  s->closeSampleSource(s);
+  // Blocks which were read ahead are no longer counted as queued
+  assertUnsignedLongEquals(
+      0ul,
+      (unsigned long)((SampleSourceAsyncData)s->extraData)->numQueuedBlocks);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  return 0;
+}
+
+static int _testNewAsyncWriterWithUnopenedSource(void) {
+  SampleSource s = sampleSourceFactory(NULL);
+  assertIsNull(
+      newSampleSourceAsyncWriter(s, 4, kSampleSourceAsyncTestBlocksize));
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testNewAsyncWriterWithReadSource(void) {
+  SampleSource s;
+  _writeTestFile(kSampleSourceAsyncTestFilename, 0);
+  s = _openTestFile(kSampleSourceAsyncTestFilename);
+  assertIsNull(
+      newSampleSourceAsyncWriter(s, 4, kSampleSourceAsyncTestBlocksize));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _verifyTestFile(const char *filenameCString) {
+  SampleSource s = _openTestFile(filenameCString);
+  SampleBuffer b =
+      newSampleBuffer(getNumChannels(), kSampleSourceAsyncTestBlocksize);
+  SampleCount frame;
+  int block;
+
+  for (block = 0; block < kSampleSourceAsyncTestNumFullBlocks; block++) {
+    assert(s->readSampleBlock(s, b));
+    assertUnsignedLongEquals(kSampleSourceAsyncTestBlocksize, b->blocksize);
+
+    for (frame = 0; frame < b->blocksize; frame++) {
+      assertDoubleEquals(
+          0.0, fabs(_getTestSample(block, frame) - b->samples[0][frame]),
+          TEST_DEFAULT_TOLERANCE);
+    }
+  }
+
+  s->readSampleBlock(s, b);
+  assertUnsignedLongEquals(kSampleSourceAsyncTestBlocksize / 2, b->blocksize);
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  return 0;
+}
+
+static int _testWriteAllBlocks(void) {
+  _writeTestFile(kSampleSourceAsyncTestFilename, 2);
+  return _verifyTestFile(kSampleSourceAsyncTestFilename);
+}
+
+static int _testWriteAllBlocksToWave(void) {
+  // The WAVE header is only fixed up once the writer has drained at close
+  _writeTestFile(kSampleSourceAsyncTestWaveFilename, 3);
+  return _verifyTestFile(kSampleSourceAsyncTestWaveFilename);
+}
+
+static int _testReadFromAsyncWriter(void) {
+  CharString filename = newCharStringWithCString(kSampleSourceAsyncTestFilename);
+  SampleSource s = sampleSourceFactory(filename);
+  SampleBuffer b =
+      newSampleBuffer(getNumChannels(), kSampleSourceAsyncTestBlocksize);
+
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE);
+  s = newSampleSourceAsyncWriter(s, 2, kSampleSourceAsyncTestBlocksize);
+  assertNotNull(s);
+  assertFalse(s->readSampleBlock(s, b));
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  freeCharString(filename);
+  return 0;
+}
+
+TestSuite addSampleSourceAsyncTests(void);
+TestSuite addSampleSourceAsyncTests(void) {
+  TestSuite testSuite = newTestSuite(
+      "SampleSourceAsync", _sampleSourceAsyncSetup, _sampleSourceAsyncTeardown);
+  addTest(testSuite, "NewAsyncReaderWithUnopenedSource",
+          _testNewAsyncReaderWithUnopenedSource);
+  addTest(testSuite, "NewAsyncReaderWithZeroBlocks",
+          _testNewAsyncReaderWithZeroBlocks);
+  addTest(testSuite, "ReadAllBlocks", _testReadAllBlocks);
+  addTest(testSuite, "ReadBlocksLargerThanBlocksize",
+          _testReadBlocksLargerThanBlocksize);
+  addTest(testSuite, "CloseBeforeFinished", _testCloseBeforeFinished);
+  addTest(testSuite, "NewAsyncWriterWithUnopenedSource",
+          _testNewAsyncWriterWithUnopenedSource);
+  addTest(testSuite, "NewAsyncWriterWithReadSource",
+          _testNewAsyncWriterWithReadSource);
+  addTest(testSuite, "WriteAllBlocks", _testWriteAllBlocks);
+  addTest(testSuite, "WriteAllBlocksToWave", _testWriteAllBlocksToWave);
+  addTest(testSuite, "ReadFromAsyncWriter", _testReadFromAsyncWriter);
+  return testSuite;
+}
@@ -0,0 +1,319 @@
+//
+// SampleSourceCachedTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "io/SampleSourceCached.h"
+
+#include "audio/AudioSettings.h"
+#include "base/File.h"
+#include "unit/TestRunner.h"
+
+#include <math.h>
+#include <stdio.h>
+
+static const char *kSampleSourceCachedTestFilename = "cached-test.mwp";
+static const char *kSampleSourceCachedTestDirectory = "cached-test-entries";
+static const SampleCount kSampleSourceCachedTestBlocksize = 64;
+static const unsigned long kSampleSourceCachedTestLength = 20000;
+
+static void _sampleSourceCachedSetup(void) {
+  CharString directory =
+      newCharStringWithCString(kSampleSourceCachedTestDirectory);
+  initAudioSettings();
+  setBlocksize(kSampleSourceCachedTestBlocksize);
+  initSampleSourceCache(directory);
+  freeCharString(directory);
+}
+
+static void _sampleSourceCachedTeardown(void) {
+  File directory = newFileWithPathCString(kSampleSourceCachedTestDirectory);
+  fileRemove(directory);
+  freeFile(directory);
+  remove(kSampleSourceCachedTestFilename);
+  freeSampleSourceCache();
+  freeAudioSettings();
+}
+
+// Both the packed file and the cache entries store floats, so the samples are
+// rounded to float for builds with double samples
+static Sample _getTestSample(ChannelCount channel, unsigned long frame) {
+  return (Sample)(float)(sin((double)frame / (10.0 + channel)) * 0.7f);
+}
+
+// The wrapped source is a packed file, since it keeps float samples exactly
+// and does not need any external libraries
+static void _writeTestFile(unsigned long length) {
+  CharString filename =
+      newCharStringWithCString(kSampleSourceCachedTestFilename);
+  SampleSource s = sampleSourceFactory(filename);
+  SampleBuffer b = newSampleBuffer(getNumChannels(), 1);
+  ChannelCount channel;
+  unsigned long frame;
+
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE);
+
+  for (frame = 0; frame < length; frame++) {
+    for (channel = 0; channel < b->numChannels; channel++) {
+      b->samples[channel][0] = _getTestSample(channel, frame);
+    }
+
+    s->writeSampleBlock(s, b);
+  }
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  freeCharString(filename);
+}
+
+static SampleSource _openCachedTestFile(void) {
+  CharString filename =
+      newCharStringWithCString(kSampleSourceCachedTestFilename);
+  CharString directory =
+      newCharStringWithCString(kSampleSourceCachedTestDirectory);
+  SampleSource s =
+      newSampleSourceCached(sampleSourceFactory(filename), directory);
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_READ);
+  freeCharString(filename);
+  freeCharString(directory);
+  return s;
+}
+
+// Read until the end of the file, and check that every sample is identical
+// to the one which was written
+static unsigned long _readToEnd(SampleSource s, unsigned long firstFrame,
+                                SampleCount blocksize) {
+  SampleBuffer b = newSampleBuffer(getNumChannels(), blocksize);
+  unsigned long framesRead = 0;
+  ChannelCount channel;
+  SampleCount frame;
+  boolByte moreBlocks;
+
+  do {
+    b->blocksize = blocksize;
+    moreBlocks = s->readSampleBlock(s, b);
+
+    for (channel = 0; channel < b->numChannels; channel++) {
+      for (frame = 0; frame < b->blocksize; frame++) {
+        if (b->samples[channel][frame] !=
+            _getTestSample(channel, firstFrame + framesRead + frame)) {
+          freeSampleBuffer(b);
+          return 0;
+        }
+      }
+    }
+
+    framesRead += (unsigned long)b->blocksize;
+  } while (moreBlocks);
+
+  freeSampleBuffer(b);
+  return framesRead;
+}
+
+static unsigned long _getNumEntries(void) {
+  File directory = newFileWithPathCString(kSampleSourceCachedTestDirectory);
+  LinkedList entries = fileListDirectory(directory);
+  unsigned long result = (unsigned long)linkedListLength(entries);
+  freeLinkedListAndItems(entries, (LinkedListFreeItemFunc)freeFile);
+  freeFile(directory);
+  return result;
+}
+
+static int _testInitCreatesDirectory(void) {
+  File directory = newFileWithPathCString(kSampleSourceCachedTestDirectory);
+  assert(sampleSourceCacheIsEnabled());
+  assertIntEquals(kFileTypeDirectory, directory->fileType);
+  freeFile(directory);
+  return 0;
+}
+
+static int _testUncompressedSourcesAreNotWrapped(void) {
+  CharString filename = newCharStringWithCString("cached-test.pcm");
+  SampleSource pcm = sampleSourceFactory(filename);
+  SampleSource silence = sampleSourceFactory(NULL);
+
+  assertFalse(sampleSourceCanBeCached(pcm));
+  assertFalse(sampleSourceCanBeCached(silence));
+  assert(sampleSourceCacheWrap(pcm) == pcm);
+  assert(sampleSourceCacheWrap(silence) == silence);
+  freeSampleSource(pcm);
+  freeSampleSource(silence);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testMissThenHit(void) {
+  SampleSource s;
+
+  _writeTestFile(kSampleSourceCachedTestLength);
+  s = _openCachedTestFile();
+  assertIntEquals(SAMPLE_SOURCE_OPEN_READ, s->openedAs);
+  assertFalse(sampleSourceCachedIsHit(s));
+  assertUnsignedLongEquals(kSampleSourceCachedTestLength,
+                           _readToEnd(s, 0, 100));
+  freeSampleSource(s);
+  assertUnsignedLongEquals(1ul, _getNumEntries());
+
+  s = _openCachedTestFile();
+  assertIntEquals(SAMPLE_SOURCE_OPEN_READ, s->openedAs);
+  assert(sampleSourceCachedIsHit(s));
+  assertUnsignedLongEquals(kSampleSourceCachedTestLength,
+                           _readToEnd(s, 0, 100));
+  assertUnsignedLongEquals(kSampleSourceCachedTestLength * getNumChannels(),
+                           s->numSamplesProcessed);
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testSeekHit(void) {
+  SampleSource s;
+
+  _writeTestFile(kSampleSourceCachedTestLength);
+  s = _openCachedTestFile();
+  _readToEnd(s, 0, kSampleSourceCachedTestBlocksize);
+  freeSampleSource(s);
+
+  s = _openCachedTestFile();
+  assert(sampleSourceCachedIsHit(s));
+  assert(s->seekSampleSource(s, 16500));
+  assertUnsignedLongEquals(kSampleSourceCachedTestLength - 16500,
+                           _readToEnd(s, 16500, 1000));
+  assertFalse(s->seekSampleSource(s, kSampleSourceCachedTestLength + 1));
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testSeekMissDoesNotWriteEntry(void) {
+  SampleSource s;
+
+  _writeTestFile(kSampleSourceCachedTestLength);
+  s = _openCachedTestFile();
+  assert(s->seekSampleSource(s, 100));
+  assertUnsignedLongEquals(kSampleSourceCachedTestLength - 100,
+                           _readToEnd(s, 100, 100));
+  freeSampleSource(s);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, _getNumEntries());
+  return 0;
+}
+
+static int _testCloseBeforeEndDoesNotWriteEntry(void) {
+  SampleSource s;
+  SampleBuffer b = newSampleBuffer(getNumChannels(), getBlocksize());
+
+  _writeTestFile(kSampleSourceCachedTestLength);
+  s = _openCachedTestFile();
+  assert(s->readSampleBlock(s, b));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, _getNumEntries());
+  return 0;
+}
+
+static int _testChangedInputIsDecodedAgain(void) {
+  SampleSource s;
+
+  _writeTestFile(kSampleSourceCachedTestLength);
+  s = _openCachedTestFile();
+  _readToEnd(s, 0, 100);
+  freeSampleSource(s);
+
+  _writeTestFile(kSampleSourceCachedTestLength / 2);
+  s = _openCachedTestFile();
+  assertFalse(sampleSourceCachedIsHit(s));
+  assertUnsignedLongEquals(kSampleSourceCachedTestLength / 2,
+                           _readToEnd(s, 0, 100));
+  freeSampleSource(s);
+  assertUnsignedLongEquals(2ul, _getNumEntries());
+  return 0;
+}
+
+static void _overwriteEntry(File item, const char *name, void *userData) {
+  FILE *fp = fopen(item->absolutePath->data, "wb");
+
+  if (fp != NULL) {
+    fputs("this is not a cache entry, but it is long enough", fp);
+    fclose(fp);
+  }
+}
+
+static int _testInvalidEntryIsReplaced(void) {
+  File directory = newFileWithPathCString(kSampleSourceCachedTestDirectory);
+  SampleSource s;
+
+  _writeTestFile(kSampleSourceCachedTestLength);
+  s = _openCachedTestFile();
+  _readToEnd(s, 0, 100);
+  freeSampleSource(s);
+  fileListDirectoryForeach(directory, SAMPLE_SOURCE_CACHED_EXTENSION,
+                           _overwriteEntry, NULL);
+  freeFile(directory);
+
+  s = _openCachedTestFile();
+  assertFalse(sampleSourceCachedIsHit(s));
+  assertUnsignedLongEquals(kSampleSourceCachedTestLength,
+                           _readToEnd(s, 0, 100));
+  freeSampleSource(s);
+
+  s = _openCachedTestFile();
+  assert(sampleSourceCachedIsHit(s));
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testOpenForWriteFails(void) {
+  CharString filename =
+      newCharStringWithCString(kSampleSourceCachedTestFilename);
+  CharString directory =
+      newCharStringWithCString(kSampleSourceCachedTestDirectory);
+  SampleSource s =
+      newSampleSourceCached(sampleSourceFactory(filename), directory);
+  assertFalse(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  freeSampleSource(s);
+  freeCharString(filename);
+  freeCharString(directory);
+  return 0;
+}
+
+TestSuite addSampleSourceCachedTests(void);
+TestSuite addSampleSourceCachedTests(void) {
+  TestSuite testSuite =
+      newTestSuite("SampleSourceCached", _sampleSourceCachedSetup,
+                   _sampleSourceCachedTeardown);
+  addTest(testSuite, "InitCreatesDirectory", _testInitCreatesDirectory);
+  addTest(testSuite, "UncompressedSourcesAreNotWrapped",
+          _testUncompressedSourcesAreNotWrapped);
+  addTest(testSuite, "MissThenHit", _testMissThenHit);
+  addTest(testSuite, "SeekHit", _testSeekHit);
+  addTest(testSuite, "SeekMissDoesNotWriteEntry",
+          _testSeekMissDoesNotWriteEntry);
+  addTest(testSuite, "CloseBeforeEndDoesNotWriteEntry",
+          _testCloseBeforeEndDoesNotWriteEntry);
+  addTest(testSuite, "ChangedInputIsDecodedAgain",
+          _testChangedInputIsDecodedAgain);
+  addTest(testSuite, "InvalidEntryIsReplaced", _testInvalidEntryIsReplaced);
+  addTest(testSuite, "OpenForWriteFails", _testOpenForWriteFails);
+  return testSuite;
+}
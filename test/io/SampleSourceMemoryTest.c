@@ -0,0 +1,326 @@
+//
+// SampleSourceMemoryTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "io/SampleSourceMemory.h"
+
+#include "audio/AudioSettings.h"
+#include "base/Thread.h"
+#include "time/TaskTimer.h"
+#include "unit/TestRunner.h"
+
+#include <math.h>
+#include <string.h>
+
+static const SampleCount kSampleSourceMemoryTestBlocksize = 64;
+// Enough blocks to need more than one chunk of the stream
+static const int kSampleSourceMemoryTestNumFullBlocks = 300;
+
+static void _sampleSourceMemorySetup(void) {
+  initAudioSettings();
+  setBlocksize(kSampleSourceMemoryTestBlocksize);
+}
+
+static void _sampleSourceMemoryTeardown(void) {
+  sampleSourceMemoryRemoveAll();
+  freeAudioSettings();
+}
+
+static Sample _getTestSample(SampleCount frame, ChannelCount channel) {
+  return (Sample)((frame + channel * 7) % 100) / 200.0f;
+}
+
+// Write the test signal, ending with a partial block
+static SampleCount _writeStream(SampleSource output, double sleepMs) {
+  SampleBuffer buffer =
+      newSampleBuffer(getNumChannels(), kSampleSourceMemoryTestBlocksize);
+  SampleCount numFramesWritten = 0;
+  ChannelCount c;
+  SampleCount i;
+  int block;
+
+  for (block = 0; block <= kSampleSourceMemoryTestNumFullBlocks; block++) {
+    if (block == kSampleSourceMemoryTestNumFullBlocks) {
+      buffer->blocksize = kSampleSourceMemoryTestBlocksize / 2;
+    }
+
+    for (c = 0; c < buffer->numChannels; c++) {
+      for (i = 0; i < buffer->blocksize; i++) {
+        buffer->samples[c][i] = _getTestSample(numFramesWritten + i, c);
+      }
+    }
+
+    if (!output->writeSampleBlock(output, buffer)) {
+      break;
+    }
+
+    numFramesWritten += buffer->blocksize;
+
+    if (sleepMs > 0.0 && block % 50 == 0) {
+      taskTimerSleep(sleepMs);
+    }
+  }
+
+  freeSampleBuffer(buffer);
+  return numFramesWritten;
+}
+
+typedef struct {
+  SampleSource source;
+  boolByte opened;
+  SampleCount numFramesRead;
+  boolByte samplesMatch;
+} SampleSourceMemoryTestReader;
+
+static void _readStream(void *userData) {
+  SampleSourceMemoryTestReader *reader =
+      (SampleSourceMemoryTestReader *)userData;
+  SampleBuffer buffer =
+      newSampleBuffer(getNumChannels(), kSampleSourceMemoryTestBlocksize);
+  boolByte moreBlocks = true;
+  ChannelCount c;
+  SampleCount i;
+
+  reader->samplesMatch = true;
+  reader->opened =
+      reader->source->openSampleSource(reader->source, SAMPLE_SOURCE_OPEN_READ);
+
+  while (reader->opened && moreBlocks) {
+    buffer->blocksize = kSampleSourceMemoryTestBlocksize;
+    moreBlocks = reader->source->readSampleBlock(reader->source, buffer);
+
+    for (c = 0; c < buffer->numChannels; c++) {
+      for (i = 0; i < buffer->blocksize; i++) {
+        Sample expected = _getTestSample(reader->numFramesRead + i, c);
+        if (fabsf(buffer->samples[c][i] - expected) > 0.001f) {
+          reader->samplesMatch = false;
+        }
+      }
+    }
+
+    reader->numFramesRead += buffer->blocksize;
+  }
+
+  freeSampleBuffer(buffer);
+}
+
+static int _testIsMemoryName(void) {
+  CharString name = newCharStringWithCString("mem://stage1");
+
+  assert(sampleSourceIsMemoryName(name));
+  charStringCopyCString(name, "mem.pcm");
+  assertFalse(sampleSourceIsMemoryName(name));
+  charStringCopyCString(name, "out/mem://");
+  assertFalse(sampleSourceIsMemoryName(name));
+  assertFalse(sampleSourceIsMemoryName(NULL));
+
+  freeCharString(name);
+  return 0;
+}
+
+static int _testFactoryCreatesMemorySource(void) {
+  CharString name = newCharStringWithCString("mem://stage1");
+  SampleSource source = sampleSourceFactory(name);
+
+  assertNotNull(source);
+  assertIntEquals(SAMPLE_SOURCE_TYPE_MEMORY, source->sampleSourceType);
+  assertNotNull(source->seekSampleSource);
+
+  freeSampleSource(source);
+  freeCharString(name);
+  return 0;
+}
+
+static int _testOpenUnwrittenStream(void) {
+  CharString name = newCharStringWithCString("mem://missing");
+  SampleSource source = sampleSourceFactory(name);
+
+  assertFalse(source->openSampleSource(source, SAMPLE_SOURCE_OPEN_READ));
+
+  freeSampleSource(source);
+  freeCharString(name);
+  return 0;
+}
+
+static int _testWriteAndReadBack(void) {
+  CharString name = newCharStringWithCString("mem://stage1");
+  SampleSource output = sampleSourceFactory(name);
+  SampleSourceMemoryTestReader reader;
+  SampleCount numFramesWritten;
+
+  assert(output->openSampleSource(output, SAMPLE_SOURCE_OPEN_WRITE));
+  numFramesWritten = _writeStream(output, 0.0);
+  output->closeSampleSource(output);
+  freeSampleSource(output);
+
+  // The reader takes the channel count of the stream, but a mono buffer which
+  // was created before gets only the first channel
+  setNumChannels(1);
+  memset(&reader, 0, sizeof(reader));
+  reader.source = sampleSourceFactory(name);
+  _readStream(&reader);
+  assertIntEquals(2, getNumChannels());
+
+  assert(reader.opened);
+  assert(reader.samplesMatch);
+  assertUnsignedLongEquals(numFramesWritten, reader.numFramesRead);
+  assertUnsignedLongEquals(numFramesWritten,
+                           reader.source->numSamplesProcessed);
+
+  reader.source->closeSampleSource(reader.source);
+  freeSampleSource(reader.source);
+  freeCharString(name);
+  return 0;
+}
+
+static int _testReadWhileWriting(void) {
+  CharString name = newCharStringWithCString("mem://stage1");
+  SampleSource output = sampleSourceFactory(name);
+  SampleSourceMemoryTestReader reader;
+  SampleCount numFramesWritten;
+  Thread thread;
+
+  assert(output->openSampleSource(output, SAMPLE_SOURCE_OPEN_WRITE));
+  memset(&reader, 0, sizeof(reader));
+  reader.source = sampleSourceFactory(name);
+  thread = newThread(_readStream, &reader);
+  assertNotNull(thread);
+
+  // The reader must wait for the writer rather than end the stream early
+  numFramesWritten = _writeStream(output, 5.0);
+  output->closeSampleSource(output);
+  threadJoinAndFree(thread);
+
+  assert(reader.opened);
+  assert(reader.samplesMatch);
+  assertUnsignedLongEquals(numFramesWritten, reader.numFramesRead);
+
+  reader.source->closeSampleSource(reader.source);
+  freeSampleSource(reader.source);
+  freeSampleSource(output);
+  freeCharString(name);
+  return 0;
+}
+
+static int _testSeekAcrossChunks(void) {
+  CharString name = newCharStringWithCString("mem://stage1");
+  SampleSource source = sampleSourceFactory(name);
+  SampleBuffer buffer =
+      newSampleBuffer(getNumChannels(), kSampleSourceMemoryTestBlocksize);
+  SampleCount numFramesWritten;
+  const unsigned long frame = 16384 - 10;
+  ChannelCount c;
+  SampleCount i;
+
+  assert(source->openSampleSource(source, SAMPLE_SOURCE_OPEN_WRITE));
+  numFramesWritten = _writeStream(source, 0.0);
+  source->closeSampleSource(source);
+  freeSampleSource(source);
+
+  source = sampleSourceFactory(name);
+  assert(source->openSampleSource(source, SAMPLE_SOURCE_OPEN_READ));
+  assert(sampleSourceReadSampleBlockAt(source, frame, buffer));
+
+  for (c = 0; c < buffer->numChannels; c++) {
+    for (i = 0; i < buffer->blocksize; i++) {
+      assertDoubleEquals(_getTestSample(frame + i, c), buffer->samples[c][i],
+                         0.001);
+    }
+  }
+
+  assertFalse(sampleSourceSeek(source, numFramesWritten + 1));
+  assert(sampleSourceSeek(source, numFramesWritten - 10));
+  assertFalse(source->readSampleBlock(source, buffer));
+  assertUnsignedLongEquals(10ul, buffer->blocksize);
+
+  source->closeSampleSource(source);
+  freeSampleSource(source);
+  freeSampleBuffer(buffer);
+  freeCharString(name);
+  return 0;
+}
+
+static int _testRemoveStream(void) {
+  CharString name = newCharStringWithCString("mem://stage1");
+  SampleSource output = sampleSourceFactory(name);
+  SampleSource input = sampleSourceFactory(name);
+  SampleSource lateInput = sampleSourceFactory(name);
+  SampleBuffer buffer =
+      newSampleBuffer(getNumChannels(), kSampleSourceMemoryTestBlocksize);
+
+  assert(output->openSampleSource(output, SAMPLE_SOURCE_OPEN_WRITE));
+  _writeStream(output, 0.0);
+  output->closeSampleSource(output);
+  assert(input->openSampleSource(input, SAMPLE_SOURCE_OPEN_READ));
+
+  assert(sampleSourceMemoryRemove(name));
+  assertFalse(sampleSourceMemoryRemove(name));
+  assertFalse(lateInput->openSampleSource(lateInput, SAMPLE_SOURCE_OPEN_READ));
+
+  // Sources which opened the stream before it was removed keep reading it
+  assert(input->readSampleBlock(input, buffer));
+  assertDoubleEquals(_getTestSample(0, 0), buffer->samples[0][0], 0.001);
+
+  input->closeSampleSource(input);
+  freeSampleSource(input);
+  freeSampleSource(lateInput);
+  freeSampleSource(output);
+  freeSampleBuffer(buffer);
+  freeCharString(name);
+  return 0;
+}
+
+static int _testRejectChannelCountChange(void) {
+  CharString name = newCharStringWithCString("mem://stage1");
+  SampleSource output = sampleSourceFactory(name);
+  SampleBuffer buffer = newSampleBuffer(1, kSampleSourceMemoryTestBlocksize);
+
+  assert(output->openSampleSource(output, SAMPLE_SOURCE_OPEN_WRITE));
+  assertFalse(output->writeSampleBlock(output, buffer));
+
+  output->closeSampleSource(output);
+  freeSampleSource(output);
+  freeSampleBuffer(buffer);
+  freeCharString(name);
+  return 0;
+}
+
+TestSuite addSampleSourceMemoryTests(void);
+TestSuite addSampleSourceMemoryTests(void) {
+  TestSuite testSuite =
+      newTestSuite("SampleSourceMemory", _sampleSourceMemorySetup,
+                   _sampleSourceMemoryTeardown);
+  addTest(testSuite, "IsMemoryName", _testIsMemoryName);
+  addTest(testSuite, "FactoryCreatesMemorySource",
+          _testFactoryCreatesMemorySource);
+  addTest(testSuite, "OpenUnwrittenStream", _testOpenUnwrittenStream);
+  addTest(testSuite, "WriteAndReadBack", _testWriteAndReadBack);
+  addTest(testSuite, "ReadWhileWriting", _testReadWhileWriting);
+  addTest(testSuite, "SeekAcrossChunks", _testSeekAcrossChunks);
+  addTest(testSuite, "RemoveStream", _testRemoveStream);
+  addTest(testSuite, "RejectChannelCountChange",
+          _testRejectChannelCountChange);
+  return testSuite;
+}
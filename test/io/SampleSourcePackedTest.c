@@ -0,0 +1,253 @@
+//
+// SampleSourcePackedTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "io/SampleSourcePacked.h"
+
+#include "audio/AudioSettings.h"
+#include "unit/TestRunner.h"
+
+#include <math.h>
+#include <stdio.h>
+
+static const char *kSampleSourcePackedTestFilename = "packed-test.mwp";
+static const SampleCount kSampleSourcePackedTestBlocksize = 64;
+static const unsigned long kSampleSourcePackedTestLength = 1000;
+
+static void _sampleSourcePackedSetup(void) {
+  initAudioSettings();
+  setBlocksize(kSampleSourcePackedTestBlocksize);
+}
+
+static void _sampleSourcePackedTeardown(void) {
+  remove(kSampleSourcePackedTestFilename);
+  freeAudioSettings();
+}
+
+static Sample _getTestSample(ChannelCount channel, unsigned long frame) {
+  // Include some silence and full-precision values to cover all byte counts
+  if (frame % 50 < 10) {
+    return 0.0f;
+  }
+
+  // Packed files store floats, which builds with double samples round to
+  return (Sample)(float)(sin((double)frame / (10.0 + channel)) * 0.7f);
+}
+
+// Write blocks of a different size than the packets to test repacking
+static void _writeTestFile(SampleCount blocksize) {
+  CharString filename =
+      newCharStringWithCString(kSampleSourcePackedTestFilename);
+  SampleSource s = sampleSourceFactory(filename);
+  SampleBuffer b = newSampleBuffer(getNumChannels(), blocksize);
+  unsigned long framesWritten = 0;
+  ChannelCount channel;
+  SampleCount frame;
+
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE);
+
+  while (framesWritten < kSampleSourcePackedTestLength) {
+    if (framesWritten + blocksize > kSampleSourcePackedTestLength) {
+      b->blocksize = kSampleSourcePackedTestLength - framesWritten;
+    }
+
+    for (channel = 0; channel < b->numChannels; channel++) {
+      for (frame = 0; frame < b->blocksize; frame++) {
+        b->samples[channel][frame] =
+            _getTestSample(channel, framesWritten + frame);
+      }
+    }
+
+    s->writeSampleBlock(s, b);
+    framesWritten += b->blocksize;
+  }
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  freeCharString(filename);
+}
+
+static SampleSource _openTestFile(void) {
+  CharString filename =
+      newCharStringWithCString(kSampleSourcePackedTestFilename);
+  SampleSource s = sampleSourceFactory(filename);
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_READ);
+  freeCharString(filename);
+  return s;
+}
+
+// Read until the end of the file, and check that every sample is identical
+// to the one which was written
+static unsigned long _readToEnd(SampleSource s, unsigned long firstFrame,
+                                SampleCount blocksize) {
+  SampleBuffer b = newSampleBuffer(getNumChannels(), blocksize);
+  unsigned long framesRead = 0;
+  ChannelCount channel;
+  SampleCount frame;
+  boolByte moreBlocks;
+
+  do {
+    b->blocksize = blocksize;
+    moreBlocks = s->readSampleBlock(s, b);
+
+    for (channel = 0; channel < b->numChannels; channel++) {
+      for (frame = 0; frame < b->blocksize; frame++) {
+        if (b->samples[channel][frame] !=
+            _getTestSample(channel, firstFrame + framesRead + frame)) {
+          freeSampleBuffer(b);
+          return 0;
+        }
+      }
+    }
+
+    framesRead += (unsigned long)b->blocksize;
+  } while (moreBlocks);
+
+  freeSampleBuffer(b);
+  return framesRead;
+}
+
+static int _testGuessSampleSourceTypePacked(void) {
+  CharString filename =
+      newCharStringWithCString(kSampleSourcePackedTestFilename);
+  SampleSource s = sampleSourceFactory(filename);
+  assertIntEquals(SAMPLE_SOURCE_TYPE_PACKED, s->sampleSourceType);
+  freeCharString(filename);
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testReadWriteRoundTrip(void) {
+  SampleSource s;
+
+  _writeTestFile(100);
+  s = _openTestFile();
+  assertIntEquals(SAMPLE_SOURCE_OPEN_READ, s->openedAs);
+  assertUnsignedLongEquals(kSampleSourcePackedTestLength,
+                           sampleSourcePackedGetLengthInFrames(s));
+  assertUnsignedLongEquals(kSampleSourcePackedTestLength,
+                           _readToEnd(s, 0, 48));
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testWriteIsSmallerThanFloat(void) {
+  FILE *fp;
+  long fileSize;
+
+  _writeTestFile(kSampleSourcePackedTestBlocksize);
+  fp = fopen(kSampleSourcePackedTestFilename, "rb");
+  assertNotNull(fp);
+  fseek(fp, 0, SEEK_END);
+  fileSize = ftell(fp);
+  fclose(fp);
+  assert(fileSize > 0);
+  assert((unsigned long)fileSize <
+         kSampleSourcePackedTestLength * getNumChannels() * sizeof(float));
+  return 0;
+}
+
+static int _testSeek(void) {
+  SampleSource s;
+
+  _writeTestFile(kSampleSourcePackedTestBlocksize);
+  s = _openTestFile();
+  assert(s->seekSampleSource(s, 555));
+  assertUnsignedLongEquals(kSampleSourcePackedTestLength - 555,
+                           _readToEnd(s, 555, 100));
+  assert(s->seekSampleSource(s, 0));
+  assertUnsignedLongEquals(kSampleSourcePackedTestLength,
+                           _readToEnd(s, 0, 100));
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testSeekPastEnd(void) {
+  SampleSource s;
+  SampleBuffer b = newSampleBuffer(getNumChannels(), getBlocksize());
+
+  _writeTestFile(kSampleSourcePackedTestBlocksize);
+  s = _openTestFile();
+  assert(s->seekSampleSource(s, kSampleSourcePackedTestLength + 10));
+  assertFalse(s->readSampleBlock(s, b));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, b->blocksize);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  return 0;
+}
+
+static int _testReadWithoutIndex(void) {
+  const byte zeroes[8] = {0};
+  SampleSource s;
+  FILE *fp;
+
+  // Clear the index offset, as if the writer had not closed the file
+  _writeTestFile(kSampleSourcePackedTestBlocksize);
+  fp = fopen(kSampleSourcePackedTestFilename, "r+b");
+  assertNotNull(fp);
+  fseek(fp, 24, SEEK_SET);
+  fwrite(zeroes, 1, sizeof(zeroes), fp);
+  fclose(fp);
+
+  s = _openTestFile();
+  assertIntEquals(SAMPLE_SOURCE_OPEN_READ, s->openedAs);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           sampleSourcePackedGetLengthInFrames(s));
+  assertFalse(s->seekSampleSource(s, 100));
+  assertUnsignedLongEquals(kSampleSourcePackedTestLength,
+                           _readToEnd(s, 0, kSampleSourcePackedTestBlocksize));
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testOpenInvalidFile(void) {
+  SampleSource s;
+  FILE *fp = fopen(kSampleSourcePackedTestFilename, "wb");
+
+  assertNotNull(fp);
+  fputs("this is not a packed file, but it is long enough", fp);
+  fclose(fp);
+  s = _openTestFile();
+  assertIntEquals(SAMPLE_SOURCE_OPEN_NOT_OPENED, s->openedAs);
+  freeSampleSource(s);
+  return 0;
+}
+
+TestSuite addSampleSourcePackedTests(void);
+TestSuite addSampleSourcePackedTests(void) {
+  TestSuite testSuite =
+      newTestSuite("SampleSourcePacked", _sampleSourcePackedSetup,
+                   _sampleSourcePackedTeardown);
+  addTest(testSuite, "GuessSampleSourceTypePacked",
+          _testGuessSampleSourceTypePacked);
+  addTest(testSuite, "ReadWriteRoundTrip", _testReadWriteRoundTrip);
+  addTest(testSuite, "WriteIsSmallerThanFloat", _testWriteIsSmallerThanFloat);
+  addTest(testSuite, "Seek", _testSeek);
+  addTest(testSuite, "SeekPastEnd", _testSeekPastEnd);
+  addTest(testSuite, "ReadWithoutIndex", _testReadWithoutIndex);
+  addTest(testSuite, "OpenInvalidFile", _testOpenInvalidFile);
+  return testSuite;
+}
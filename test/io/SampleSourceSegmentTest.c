@@ -0,0 +1,219 @@
+//
+// SampleSourceSegmentTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "io/SampleSourceSegment.h"
+
+#include "audio/AudioSettings.h"
+#include "unit/TestRunner.h"
+
+#include <math.h>
+#include <stdio.h>
+
+static const char *kSampleSourceSegmentTestFilename = "segment-test.pcm";
+static const char *kSampleSourceSegmentTestWaveFilename = "segment-test.wav";
+static const SampleCount kSampleSourceSegmentTestBlocksize = 64;
+static const unsigned long kSampleSourceSegmentTestLength = 1000;
+
+static void _sampleSourceSegmentSetup(void) {
+  initAudioSettings();
+  setBlocksize(kSampleSourceSegmentTestBlocksize);
+}
+
+static void _sampleSourceSegmentTeardown(void) {
+  remove(kSampleSourceSegmentTestFilename);
+  remove(kSampleSourceSegmentTestWaveFilename);
+  freeAudioSettings();
+}
+
+static Sample _getTestSample(unsigned long frame) {
+  return (Sample)(frame % 100) / 200.0f;
+}
+
+static void _writeTestFile(const char *filenameCString) {
+  CharString filename = newCharStringWithCString(filenameCString);
+  SampleSource s = sampleSourceFactory(filename);
+  SampleBuffer b = newSampleBuffer(getNumChannels(), 1);
+  ChannelCount channel;
+  unsigned long frame;
+
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE);
+
+  for (frame = 0; frame < kSampleSourceSegmentTestLength; frame++) {
+    for (channel = 0; channel < b->numChannels; channel++) {
+      b->samples[channel][0] = _getTestSample(frame);
+    }
+
+    s->writeSampleBlock(s, b);
+  }
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  freeCharString(filename);
+}
+
+static SampleSource _openTestFile(const char *filenameCString) {
+  CharString filename = newCharStringWithCString(filenameCString);
+  SampleSource s = sampleSourceFactory(filename);
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_READ);
+  freeCharString(filename);
+  return s;
+}
+
+// Read the whole segment and check that it starts with the expected frame
+static unsigned long _readSegment(SampleSource s, unsigned long firstFrame) {
+  SampleBuffer b =
+      newSampleBuffer(getNumChannels(), kSampleSourceSegmentTestBlocksize);
+  unsigned long framesRead = 0;
+  SampleCount frame;
+  boolByte moreBlocks;
+
+  do {
+    b->blocksize = kSampleSourceSegmentTestBlocksize;
+    moreBlocks = s->readSampleBlock(s, b);
+
+    for (frame = 0; frame < b->blocksize; frame++) {
+      // Compare the difference, since 16-bit PCM does not round-trip exactly
+      if (fabs(_getTestSample(firstFrame + framesRead + frame) -
+               b->samples[0][frame]) > TEST_DEFAULT_TOLERANCE) {
+        freeSampleBuffer(b);
+        return 0;
+      }
+    }
+
+    framesRead += (unsigned long)b->blocksize;
+  } while (moreBlocks);
+
+  freeSampleBuffer(b);
+  return framesRead;
+}
+
+static int _testNewSegmentWithUnopenedSource(void) {
+  SampleSource s = sampleSourceFactory(NULL);
+  assertIsNull(newSampleSourceSegment(s, 100, 100, 0));
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testNewSegmentWithPrerollBeforeStart(void) {
+  SampleSource s;
+  _writeTestFile(kSampleSourceSegmentTestFilename);
+  s = _openTestFile(kSampleSourceSegmentTestFilename);
+  assertIsNull(newSampleSourceSegment(s, 100, 100, 101));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testReadSegment(void) {
+  SampleSource s;
+  unsigned long framesRead;
+
+  _writeTestFile(kSampleSourceSegmentTestFilename);
+  s = newSampleSourceSegment(_openTestFile(kSampleSourceSegmentTestFilename),
+                             130, 200, 20);
+  assertNotNull(s);
+  assertIntEquals(SAMPLE_SOURCE_TYPE_PCM, s->sampleSourceType);
+  framesRead = _readSegment(s, 110);
+  assertUnsignedLongEquals(220ul, framesRead);
+  // The preroll is not counted as processed
+  assertUnsignedLongEquals(200ul * getNumChannels(), s->numSamplesProcessed);
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testReadSegmentToEnd(void) {
+  SampleSource s;
+  unsigned long framesRead;
+
+  _writeTestFile(kSampleSourceSegmentTestFilename);
+  s = newSampleSourceSegment(_openTestFile(kSampleSourceSegmentTestFilename),
+                             800, 0, 64);
+  assertNotNull(s);
+  framesRead = _readSegment(s, 736);
+  assertUnsignedLongEquals(264ul, framesRead);
+  assertUnsignedLongEquals(200ul * getNumChannels(), s->numSamplesProcessed);
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testReadSegmentFromWave(void) {
+  SampleSource s;
+  unsigned long framesRead;
+
+  _writeTestFile(kSampleSourceSegmentTestWaveFilename);
+  s = newSampleSourceSegment(
+      _openTestFile(kSampleSourceSegmentTestWaveFilename), 500, 100, 0);
+  assertNotNull(s);
+  assertIntEquals(SAMPLE_SOURCE_TYPE_WAVE, s->sampleSourceType);
+  framesRead = _readSegment(s, 500);
+  assertUnsignedLongEquals(100ul, framesRead);
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testReadSegmentWithoutSeeking(void) {
+  SampleSource s;
+  unsigned long framesRead;
+
+  _writeTestFile(kSampleSourceSegmentTestFilename);
+  s = _openTestFile(kSampleSourceSegmentTestFilename);
+
+  // Behave like a pipe, so the frames before the segment are read instead
+  s->seekSampleSource = NULL;
+  s = newSampleSourceSegment(s, 130, 100, 20);
+  assertNotNull(s);
+  framesRead = _readSegment(s, 110);
+  assertUnsignedLongEquals(120ul, framesRead);
+  assertUnsignedLongEquals(100ul * getNumChannels(), s->numSamplesProcessed);
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  return 0;
+}
+
+TestSuite addSampleSourceSegmentTests(void);
+TestSuite addSampleSourceSegmentTests(void) {
+  TestSuite testSuite =
+      newTestSuite("SampleSourceSegment", _sampleSourceSegmentSetup,
+                   _sampleSourceSegmentTeardown);
+  addTest(testSuite, "NewSegmentWithUnopenedSource",
+          _testNewSegmentWithUnopenedSource);
+  addTest(testSuite, "NewSegmentWithPrerollBeforeStart",
+          _testNewSegmentWithPrerollBeforeStart);
+  addTest(testSuite, "ReadSegment", _testReadSegment);
+  addTest(testSuite, "ReadSegmentToEnd", _testReadSegmentToEnd);
+  addTest(testSuite, "ReadSegmentFromWave", _testReadSegmentFromWave);
+  addTest(testSuite, "ReadSegmentWithoutSeeking",
+          _testReadSegmentWithoutSeeking);
+  return testSuite;
+}
@@ -0,0 +1,266 @@
+//
+// SampleSourceTcpTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "io/SampleSourceTcp.h"
+
+#include "audio/AudioSettings.h"
+#include "base/Thread.h"
+#include "time/TaskTimer.h"
+#include "unit/TestRunner.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const unsigned short kSampleSourceTcpTestPort = 47914;
+static const SampleCount kSampleSourceTcpTestBlocksize = 64;
+static const int kSampleSourceTcpTestNumFullBlocks = 10;
+static const int kSampleSourceTcpTestConnectAttempts = 50;
+
+static void _sampleSourceTcpSetup(void) {
+  initAudioSettings();
+  setBlocksize(kSampleSourceTcpTestBlocksize);
+}
+
+static void _sampleSourceTcpTeardown(void) { freeAudioSettings(); }
+
+static Sample _getTestSample(SampleCount frame, ChannelCount channel) {
+  return (Sample)((frame + channel * 7) % 100) / 200.0f;
+}
+
+static CharString _newTcpName(const char *host) {
+  CharString name = newCharString();
+  snprintf(name->data, name->capacity, "tcp://%s:%u", host,
+           kSampleSourceTcpTestPort);
+  return name;
+}
+
+typedef struct {
+  SampleSource source;
+  boolByte opened;
+  SampleCount numFramesRead;
+  boolByte samplesMatch;
+} SampleSourceTcpTestReader;
+
+// Accept a connection and read everything the other end sends
+static void _readStream(void *userData) {
+  SampleSourceTcpTestReader *reader = (SampleSourceTcpTestReader *)userData;
+  SampleBuffer buffer =
+      newSampleBuffer(getNumChannels(), kSampleSourceTcpTestBlocksize);
+  boolByte moreBlocks = true;
+  ChannelCount c;
+  SampleCount i;
+
+  reader->samplesMatch = true;
+  reader->opened =
+      reader->source->openSampleSource(reader->source, SAMPLE_SOURCE_OPEN_READ);
+
+  while (reader->opened && moreBlocks) {
+    buffer->blocksize = kSampleSourceTcpTestBlocksize;
+    moreBlocks = reader->source->readSampleBlock(reader->source, buffer);
+
+    for (c = 0; c < buffer->numChannels; c++) {
+      for (i = 0; i < buffer->blocksize; i++) {
+        Sample expected = _getTestSample(reader->numFramesRead + i, c);
+        if (fabsf(buffer->samples[c][i] - expected) > 0.001f) {
+          reader->samplesMatch = false;
+        }
+      }
+    }
+
+    reader->numFramesRead += buffer->blocksize;
+  }
+
+  freeSampleBuffer(buffer);
+}
+
+// The listening side of the stream is opened on another thread, so retry
+// until it is ready to accept connections
+static boolByte _openWithRetry(SampleSource source) {
+  int i;
+
+  for (i = 0; i < kSampleSourceTcpTestConnectAttempts; i++) {
+    if (source->openSampleSource(source, SAMPLE_SOURCE_OPEN_WRITE)) {
+      return true;
+    }
+
+    taskTimerSleep(20.0);
+  }
+
+  return false;
+}
+
+static int _testIsTcpName(void) {
+  CharString name = newCharStringWithCString("tcp://localhost:5000");
+
+  assert(sampleSourceIsTcpName(name));
+  charStringCopyCString(name, "tcp.pcm");
+  assertFalse(sampleSourceIsTcpName(name));
+  charStringCopyCString(name, "out/tcp://");
+  assertFalse(sampleSourceIsTcpName(name));
+  assertFalse(sampleSourceIsTcpName(NULL));
+
+  freeCharString(name);
+  return 0;
+}
+
+static int _testFactoryCreatesTcpSource(void) {
+  CharString name = _newTcpName("localhost");
+  SampleSource source = sampleSourceFactory(name);
+
+  assertNotNull(source);
+  assertIntEquals(SAMPLE_SOURCE_TYPE_TCP, source->sampleSourceType);
+
+  freeSampleSource(source);
+  freeCharString(name);
+  return 0;
+}
+
+static int _testOpenWithInvalidPort(void) {
+  const char *names[] = {"tcp://localhost", "tcp://localhost:",
+                         "tcp://localhost:port", "tcp://localhost:70000"};
+  CharString name = newCharString();
+  SampleSource source;
+  size_t i;
+
+  for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    charStringCopyCString(name, names[i]);
+    source = sampleSourceFactory(name);
+    assertNotNull(source);
+    assertFalse(source->openSampleSource(source, SAMPLE_SOURCE_OPEN_READ));
+    freeSampleSource(source);
+  }
+
+  freeCharString(name);
+  return 0;
+}
+
+static int _testStreamThroughTcp(void) {
+  CharString inputName = _newTcpName("");
+  CharString outputName = _newTcpName("127.0.0.1");
+  SampleSource output = sampleSourceFactory(outputName);
+  SampleSourceTcpTestReader reader;
+  SampleBuffer buffer =
+      newSampleBuffer(getNumChannels(), kSampleSourceTcpTestBlocksize);
+  SampleCount numFramesWritten = 0;
+  Thread thread;
+  ChannelCount c;
+  SampleCount i;
+  int block;
+
+  memset(&reader, 0, sizeof(reader));
+  reader.source = sampleSourceFactory(inputName);
+  thread = newThread(_readStream, &reader);
+  assertNotNull(thread);
+  assert(_openWithRetry(output));
+
+  // End with a partial block to check that it is not padded to a full one
+  for (block = 0; block <= kSampleSourceTcpTestNumFullBlocks; block++) {
+    if (block == kSampleSourceTcpTestNumFullBlocks) {
+      buffer->blocksize = kSampleSourceTcpTestBlocksize / 2;
+    }
+
+    for (c = 0; c < buffer->numChannels; c++) {
+      for (i = 0; i < buffer->blocksize; i++) {
+        buffer->samples[c][i] = _getTestSample(numFramesWritten + i, c);
+      }
+    }
+
+    assert(output->writeSampleBlock(output, buffer));
+    numFramesWritten += buffer->blocksize;
+  }
+
+  output->closeSampleSource(output);
+  threadJoinAndFree(thread);
+
+  assert(reader.opened);
+  assert(reader.samplesMatch);
+  assertUnsignedLongEquals(numFramesWritten, reader.numFramesRead);
+  assertUnsignedLongEquals(numFramesWritten * getNumChannels(),
+                           output->numSamplesProcessed);
+  assertUnsignedLongEquals(numFramesWritten * getNumChannels(),
+                           reader.source->numSamplesProcessed);
+
+  reader.source->closeSampleSource(reader.source);
+  freeSampleSource(reader.source);
+  freeSampleSource(output);
+  freeSampleBuffer(buffer);
+  freeCharString(inputName);
+  freeCharString(outputName);
+  return 0;
+}
+
+typedef struct {
+  SampleSource source;
+  boolByte opened;
+} SampleSourceTcpTestOpener;
+
+static void _openForReading(void *userData) {
+  SampleSourceTcpTestOpener *opener = (SampleSourceTcpTestOpener *)userData;
+  opener->opened =
+      opener->source->openSampleSource(opener->source, SAMPLE_SOURCE_OPEN_READ);
+}
+
+static int _testRejectInvalidHeader(void) {
+  CharString host = newCharStringWithCString("127.0.0.1");
+  CharString name = _newTcpName("127.0.0.1");
+  Socket server = newSocketListeningOnHost(host, kSampleSourceTcpTestPort);
+  Socket connection;
+  SampleSourceTcpTestOpener opener;
+  Thread thread;
+  const byte header[SAMPLE_SOURCE_TCP_HEADER_SIZE] = {'R', 'I', 'F', 'F'};
+
+  assertNotNull(server);
+  opener.source = sampleSourceFactory(name);
+  opener.opened = true;
+  thread = newThread(_openForReading, &opener);
+  assertNotNull(thread);
+
+  connection = socketAccept(server);
+  assertNotNull(connection);
+  assert(socketWrite(connection, header, sizeof(header)));
+  threadJoinAndFree(thread);
+  assertFalse(opener.opened);
+
+  freeSocket(connection);
+  freeSocket(server);
+  freeSampleSource(opener.source);
+  freeCharString(name);
+  freeCharString(host);
+  return 0;
+}
+
+TestSuite addSampleSourceTcpTests(void);
+TestSuite addSampleSourceTcpTests(void) {
+  TestSuite testSuite = newTestSuite("SampleSourceTcp", _sampleSourceTcpSetup,
+                                     _sampleSourceTcpTeardown);
+  addTest(testSuite, "IsTcpName", _testIsTcpName);
+  addTest(testSuite, "FactoryCreatesTcpSource", _testFactoryCreatesTcpSource);
+  addTest(testSuite, "OpenWithInvalidPort", _testOpenWithInvalidPort);
+  addTest(testSuite, "StreamThroughTcp", _testStreamThroughTcp);
+  addTest(testSuite, "RejectInvalidHeader", _testRejectInvalidHeader);
+  return testSuite;
+}
@@ -27,13 +27,36 @@
 #include "io/SampleSource.h"
 
 #include "audio/AudioSettings.h"
+#include "io/SampleSourcePcm.h"
 #include "unit/TestRunner.h"
 
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if UNIX
+#include <unistd.h>
+#endif
+
 const char *TEST_SAMPLESOURCE_FILENAME = "test.pcm";
+static const char *kSampleSourceTestMappedFilename = "mapped-test.pcm";
+static const char *kSampleSourceTestMappedWaveFilename = "mapped-test.wav";
+static const char *kSampleSourceTestLargeBlockFilename = "large-block-test.pcm";
+static const char *kSampleSourceTestRf64Filename = "rf64-test.wav";
+static const char *kSampleSourceTestAiffFilename = "aiff-test.aif";
+static const SampleCount kSampleSourceTestBlocksize = 64;
+static const int kSampleSourceTestNumFullBlocks = 4;
 
 static void _sampleSourceSetup(void) { initAudioSettings(); }
 
-static void _sampleSourceTeardown(void) { freeAudioSettings(); }
+static void _sampleSourceTeardown(void) {
+  remove(kSampleSourceTestMappedFilename);
+  remove(kSampleSourceTestMappedWaveFilename);
+  remove(kSampleSourceTestLargeBlockFilename);
+  remove(kSampleSourceTestRf64Filename);
+  remove(kSampleSourceTestAiffFilename);
+  freeAudioSettings();
+}
 
 static int _testGuessSampleSourceTypePcm(void) {
   CharString c = newCharStringWithCString(TEST_SAMPLESOURCE_FILENAME);
@@ -62,6 +85,1052 @@ static int _testGuessSampleSourceTypeWrongCase(void) {
   return 0;
 }
 
+// Write a few full blocks followed by one half block, so that every sample in
+// the file has a different value
+static void _writeTestBlocks(SampleSource s) {
+  SampleBuffer b = newSampleBuffer(2, kSampleSourceTestBlocksize);
+  SampleCount frame;
+  int block;
+
+  for (block = 0; block <= kSampleSourceTestNumFullBlocks; block++) {
+    for (frame = 0; frame < b->blocksize; frame++) {
+      b->samples[0][frame] = (Sample)(block * 64 + frame) / 512.0f;
+      b->samples[1][frame] = -b->samples[0][frame];
+    }
+
+    if (block == kSampleSourceTestNumFullBlocks) {
+      b->blocksize /= 2;
+    }
+
+    s->writeSampleBlock(s, b);
+  }
+
+  freeSampleBuffer(b);
+}
+
+// Write a test file with _writeTestBlocks(). If reserveFrames is not 0, then
+// disk space for that many frames is reserved before writing.
+static void _writeTestFile(const char *filenameCString,
+                           unsigned long reserveFrames) {
+  CharString filename = newCharStringWithCString(filenameCString);
+  SampleSource s = sampleSourceFactory(filename);
+
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE);
+
+  if (reserveFrames > 0) {
+    sampleSourcePcmPreallocate(s, reserveFrames);
+  }
+
+  _writeTestBlocks(s);
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeCharString(filename);
+}
+
+static SampleSource _openTestFile(const char *filenameCString,
+                                  boolByte mapInput) {
+  CharString filename = newCharStringWithCString(filenameCString);
+  SampleSource s = sampleSourceFactory(filename);
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_READ);
+
+  if (mapInput) {
+    sampleSourcePcmMapInput(s);
+  }
+
+  freeCharString(filename);
+  return s;
+}
+
+static int _testReadMappedFile(const char *filenameCString) {
+  SampleSource expected, mapped;
+  SampleBuffer expectedBuffer = newSampleBuffer(2, kSampleSourceTestBlocksize);
+  SampleBuffer mappedBuffer = newSampleBuffer(2, kSampleSourceTestBlocksize);
+  boolByte expectedResult, mappedResult;
+  ChannelCount channel;
+  SampleCount frame;
+
+  setNumChannels(2);
+  _writeTestFile(filenameCString, 0);
+  expected = _openTestFile(filenameCString, false);
+  mapped = _openTestFile(filenameCString, true);
+  assertNotNull(((SampleSourcePcmData)mapped->extraData)->mappedFile);
+
+  do {
+    expectedResult = expected->readSampleBlock(expected, expectedBuffer);
+    mappedResult = mapped->readSampleBlock(mapped, mappedBuffer);
+    assertIntEquals(expectedResult, mappedResult);
+    assertUnsignedLongEquals(expectedBuffer->blocksize,
+                             mappedBuffer->blocksize);
+
+    for (channel = 0; channel < mappedBuffer->numChannels; channel++) {
+      for (frame = 0; frame < mappedBuffer->blocksize; frame++) {
+        assert(expectedBuffer->samples[channel][frame] ==
+               mappedBuffer->samples[channel][frame]);
+      }
+    }
+  } while (mappedResult);
+
+  assertUnsignedLongEquals(kSampleSourceTestBlocksize / 2,
+                           mappedBuffer->blocksize);
+  assertUnsignedLongEquals(expected->numSamplesProcessed,
+                           mapped->numSamplesProcessed);
+
+  expected->closeSampleSource(expected);
+  mapped->closeSampleSource(mapped);
+  freeSampleSource(expected);
+  freeSampleSource(mapped);
+  freeSampleBuffer(expectedBuffer);
+  freeSampleBuffer(mappedBuffer);
+  return 0;
+}
+
+static int _testReadMappedPcm(void) {
+  return _testReadMappedFile(kSampleSourceTestMappedFilename);
+}
+
+#if !USE_AUDIOFILE
+// With audiofile, WAVE files are not read by the internal PCM code
+static int _testReadMappedWave(void) {
+  return _testReadMappedFile(kSampleSourceTestMappedWaveFilename);
+}
+#endif
+
+// Check that a block holds the frames written by _writeTestFile()
+static boolByte _isTestBlock(const SampleBuffer buffer,
+                             unsigned long firstFrame) {
+  SampleCount frame;
+
+  for (frame = 0; frame < buffer->blocksize; frame++) {
+    // Compare the difference, since 16-bit PCM does not round-trip exactly
+    if (fabs((Sample)(firstFrame + frame) / 512.0f -
+             buffer->samples[0][frame]) > TEST_DEFAULT_TOLERANCE) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static int _testReadSampleBlockAt(const char *filenameCString,
+                                  boolByte mapInput) {
+  SampleSource s;
+  SampleBuffer b = newSampleBuffer(2, kSampleSourceTestBlocksize);
+
+  setNumChannels(2);
+  _writeTestFile(filenameCString, 0);
+  s = _openTestFile(filenameCString, mapInput);
+
+  assert(sampleSourceReadSampleBlockAt(s, 100, b));
+  assert(_isTestBlock(b, 100));
+  // Reading continues after the block
+  assert(s->readSampleBlock(s, b));
+  assert(_isTestBlock(b, 164));
+
+  // Only half a block is left at the end of the file
+  assertFalse(sampleSourceReadSampleBlockAt(s, 256, b));
+  assertUnsignedLongEquals(kSampleSourceTestBlocksize / 2, b->blocksize);
+  assert(_isTestBlock(b, 256));
+
+  // Seeking back works after the end was reached
+  b->blocksize = kSampleSourceTestBlocksize;
+  assert(sampleSourceReadSampleBlockAt(s, 0, b));
+  assert(_isTestBlock(b, 0));
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  return 0;
+}
+
+static int _testReadSampleBlockAtPcm(void) {
+  return _testReadSampleBlockAt(kSampleSourceTestMappedFilename, false);
+}
+
+static int _testReadSampleBlockAtMappedPcm(void) {
+  return _testReadSampleBlockAt(kSampleSourceTestMappedFilename, true);
+}
+
+static int _testReadSampleBlockAtWave(void) {
+  return _testReadSampleBlockAt(kSampleSourceTestMappedWaveFilename, false);
+}
+
+// Write a test file through an I/O ring and read it back through another one,
+// seeking while reads are still in flight
+static int _testQueuedFile(const char *filenameCString) {
+  CharString filename = newCharStringWithCString(filenameCString);
+  SampleSource s = sampleSourceFactory(filename);
+  SampleBuffer b = newSampleBuffer(2, kSampleSourceTestBlocksize);
+  unsigned long firstFrame = 0;
+
+  setNumChannels(2);
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+
+  // Not every platform or kernel supports asynchronous I/O
+  if (!sampleSourcePcmQueueWrites(s, 2, kSampleSourceTestBlocksize)) {
+    s->closeSampleSource(s);
+    freeSampleSource(s);
+    freeSampleBuffer(b);
+    freeCharString(filename);
+    return 0;
+  }
+
+  _writeTestBlocks(s);
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+
+  s = _openTestFile(filenameCString, false);
+  assertUnsignedLongEquals(288ul, sampleSourcePcmGetLengthInFrames(s));
+  assert(sampleSourcePcmQueueReads(s, 3, kSampleSourceTestBlocksize));
+
+  while (s->readSampleBlock(s, b)) {
+    assert(_isTestBlock(b, firstFrame));
+    firstFrame += kSampleSourceTestBlocksize;
+  }
+
+  assertUnsignedLongEquals(256ul, firstFrame);
+  assertUnsignedLongEquals(kSampleSourceTestBlocksize / 2, b->blocksize);
+  assert(_isTestBlock(b, 256));
+
+  b->blocksize = kSampleSourceTestBlocksize;
+  assert(sampleSourceReadSampleBlockAt(s, 100, b));
+  assert(_isTestBlock(b, 100));
+  assert(s->readSampleBlock(s, b));
+  assert(_isTestBlock(b, 164));
+  assertNotNull(((SampleSourcePcmData)s->extraData)->ioRing);
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testQueuedFilePcm(void) {
+  return _testQueuedFile(kSampleSourceTestMappedFilename);
+}
+
+static int _testQueuedFileWave(void) {
+  return _testQueuedFile(kSampleSourceTestMappedWaveFilename);
+}
+
+// Blocks which do not match the ring are read normally
+static int _testQueuedReadsOfAnotherSize(void) {
+  SampleSource s;
+  SampleBuffer b = newSampleBuffer(2, kSampleSourceTestBlocksize / 2);
+
+  setNumChannels(2);
+  _writeTestFile(kSampleSourceTestMappedFilename, 0);
+  s = _openTestFile(kSampleSourceTestMappedFilename, false);
+
+  if (sampleSourcePcmQueueReads(s, 2, kSampleSourceTestBlocksize)) {
+    assert(s->readSampleBlock(s, b));
+    assert(_isTestBlock(b, 0));
+    assertIsNull(((SampleSourcePcmData)s->extraData)->ioRing);
+    assert(s->readSampleBlock(s, b));
+    assert(_isTestBlock(b, 32));
+  }
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  return 0;
+}
+
+static int _testQueueReadsFromStdin(void) {
+  SampleSource s = _openTestFile("-", false);
+  assertFalse(sampleSourcePcmQueueReads(s, 2, kSampleSourceTestBlocksize));
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testPlanarPcm(boolByte mapInput) {
+  SampleSource s;
+  SampleBuffer b = newSampleBuffer(2, kSampleSourceTestBlocksize);
+  float block[2 * 64];
+  size_t numRead;
+  FILE *fp;
+  SampleCount frame;
+  int i;
+
+  setNumChannels(2);
+  setBlocksize(kSampleSourceTestBlocksize);
+  assert(setBitDepth(kBitDepth32Bit));
+  setPlanarPcm(true);
+  _writeTestFile(kSampleSourceTestMappedFilename, 0);
+
+  // The second block starts with all samples of the left channel, followed by
+  // all samples of the right channel
+  fp = fopen(kSampleSourceTestMappedFilename, "rb");
+  assertNotNull(fp);
+  fseek(fp, (long)sizeof(block), SEEK_SET);
+  numRead = fread(block, sizeof(float), sizeof(block) / sizeof(float), fp);
+  fclose(fp);
+  assertSizeEquals(sizeof(block) / sizeof(float), numRead);
+
+  for (frame = 0; frame < kSampleSourceTestBlocksize; frame++) {
+    assert(block[frame] == (float)(64 + frame) / 512.0f);
+    assert(block[kSampleSourceTestBlocksize + frame] == -block[frame]);
+  }
+
+  s = _openTestFile(kSampleSourceTestMappedFilename, mapInput);
+  assertIntEquals(mapInput,
+                  ((SampleSourcePcmData)s->extraData)->mappedFile != NULL);
+
+  for (i = 0; i < kSampleSourceTestNumFullBlocks; i++) {
+    assert(s->readSampleBlock(s, b));
+    assert(_isTestBlock(b, (unsigned long)(i * kSampleSourceTestBlocksize)));
+  }
+
+  // The last block is half as long, with shorter runs for each channel
+  assertFalse(s->readSampleBlock(s, b));
+  assertUnsignedLongEquals(kSampleSourceTestBlocksize / 2, b->blocksize);
+  assert(_isTestBlock(b, 256));
+  assert(b->samples[1][31] == -b->samples[0][31]);
+
+  // Only the start of a block can be sought to
+  assertFalse(s->seekSampleSource(s, 100));
+  assert(s->seekSampleSource(s, 128));
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  return 0;
+}
+
+static int _testReadPlanarPcm(void) { return _testPlanarPcm(false); }
+
+static int _testReadMappedPlanarPcm(void) { return _testPlanarPcm(true); }
+
+static int _testPlanarPcmRequires32Bit(void) {
+  CharString filename =
+      newCharStringWithCString(kSampleSourceTestMappedFilename);
+  SampleSource s = sampleSourceFactory(filename);
+
+  setPlanarPcm(true);
+  assertFalse(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  freeSampleSource(s);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testSeekUnopenedSource(void) {
+  CharString filename =
+      newCharStringWithCString(kSampleSourceTestMappedFilename);
+  SampleSource s = sampleSourceFactory(filename);
+  assertFalse(sampleSourceSeek(s, 0));
+  freeSampleSource(s);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testSeekStdin(void) {
+  CharString stdinName = newCharStringWithCString("-");
+  SampleSource s = sampleSourceFactory(stdinName);
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_READ);
+  assertFalse(sampleSourceSeek(s, 0));
+  freeSampleSource(s);
+  freeCharString(stdinName);
+  return 0;
+}
+
+static int _testWriteBlockLargerThanBlocksize(void) {
+  const SampleCount largeBlocksize =
+      kSampleSourceTestBlocksize * kSampleSourceTestNumFullBlocks;
+  SampleBuffer large = newSampleBuffer(2, largeBlocksize);
+  SampleBuffer b = newSampleBuffer(2, kSampleSourceTestBlocksize);
+  CharString filename =
+      newCharStringWithCString(kSampleSourceTestLargeBlockFilename);
+  SampleSource s;
+  SampleCount frame;
+  int block;
+
+  setNumChannels(2);
+  setBlocksize(kSampleSourceTestBlocksize);
+
+  for (frame = 0; frame < large->blocksize; frame++) {
+    large->samples[0][frame] = (Sample)frame / 512.0f;
+    large->samples[1][frame] = -large->samples[0][frame];
+  }
+
+  s = sampleSourceFactory(filename);
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE);
+  assert(s->writeSampleBlock(s, large));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+
+  s = _openTestFile(kSampleSourceTestLargeBlockFilename, false);
+
+  for (block = 0; block < kSampleSourceTestNumFullBlocks; block++) {
+    assert(s->readSampleBlock(s, b));
+
+    for (frame = 0; frame < b->blocksize; frame++) {
+      // Compare the difference, since 16-bit PCM does not round-trip exactly
+      assertDoubleEquals(
+          0.0,
+          fabs(large->samples[0][block * kSampleSourceTestBlocksize + frame] -
+               b->samples[0][frame]),
+          TEST_DEFAULT_TOLERANCE);
+    }
+  }
+
+  assertFalse(s->readSampleBlock(s, b));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, b->blocksize);
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(large);
+  freeSampleBuffer(b);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testWriteFramesFromOffset(void) {
+  const SampleCount largeBlocksize =
+      kSampleSourceTestBlocksize * kSampleSourceTestNumFullBlocks;
+  SampleBuffer large = newSampleBuffer(2, largeBlocksize);
+  SampleBuffer b = newSampleBuffer(2, kSampleSourceTestBlocksize);
+  Sample *firstChannel = large->samples[0];
+  CharString filename =
+      newCharStringWithCString(kSampleSourceTestLargeBlockFilename);
+  SampleSource s;
+  SampleCount frame;
+
+  setNumChannels(2);
+  setBlocksize(kSampleSourceTestBlocksize);
+
+  for (frame = 0; frame < large->blocksize; frame++) {
+    large->samples[0][frame] = (Sample)frame / 512.0f;
+    large->samples[1][frame] = -large->samples[0][frame];
+  }
+
+  s = sampleSourceFactory(filename);
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE);
+  assert(sampleSourceWriteFrames(s, large, kSampleSourceTestBlocksize,
+                                 kSampleSourceTestBlocksize));
+  assertFalse(sampleSourceWriteFrames(s, large, kSampleSourceTestBlocksize,
+                                      largeBlocksize));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+
+  // The buffer should be left as it was before writing
+  assertUnsignedLongEquals(largeBlocksize, large->blocksize);
+  assert(firstChannel == large->samples[0]);
+
+  s = _openTestFile(kSampleSourceTestLargeBlockFilename, false);
+  assert(s->readSampleBlock(s, b));
+
+  for (frame = 0; frame < b->blocksize; frame++) {
+    assertDoubleEquals(
+        0.0,
+        fabs(large->samples[0][kSampleSourceTestBlocksize + frame] -
+             b->samples[0][frame]),
+        TEST_DEFAULT_TOLERANCE);
+  }
+
+  assertFalse(s->readSampleBlock(s, b));
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(large);
+  freeSampleBuffer(b);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testGetLengthInFrames(const char *filenameCString,
+                                 unsigned long reserveFrames) {
+  const unsigned long expectedFrames =
+      kSampleSourceTestBlocksize * kSampleSourceTestNumFullBlocks +
+      kSampleSourceTestBlocksize / 2;
+  SampleSource s;
+
+  _writeTestFile(filenameCString, reserveFrames);
+  s = _openTestFile(filenameCString, false);
+  assertUnsignedLongEquals(expectedFrames, sampleSourcePcmGetLengthInFrames(s));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testGetLengthInFramesPcm(void) {
+  return _testGetLengthInFrames(kSampleSourceTestMappedFilename, 0);
+}
+
+static int _testGetLengthInFramesWave(void) {
+  return _testGetLengthInFrames(kSampleSourceTestMappedWaveFilename, 0);
+}
+
+// Reserved space which was not written to must not end up in the file, or be
+// counted in the size of the WAVE data chunk
+static int _testPreallocateMoreThanWritten(void) {
+  return _testGetLengthInFrames(kSampleSourceTestMappedFilename, 10000) ||
+         _testGetLengthInFrames(kSampleSourceTestMappedWaveFilename, 10000);
+}
+
+static void _writeUnsignedInt(FILE *fileHandle, unsigned int value) {
+  fwrite(&value, sizeof(value), 1, fileHandle);
+}
+
+// The sizes in the RIFF and data chunk headers are placeholders, so the RF64
+// reader must take the size of the audio data from the ds64 chunk
+static int _testReadRf64Wave(void) {
+  const unsigned int numFrames = 16;
+  const unsigned int dataSize = numFrames * 4;
+  const unsigned short format[] = {1, 2};
+  const unsigned short blockAlign[] = {4, 16};
+  SampleSource s;
+  FILE *fileHandle = fopen(kSampleSourceTestRf64Filename, "wb");
+  byte audioData[64];
+
+  assertNotNull(fileHandle);
+  memset(audioData, 0, sizeof(audioData));
+  fwrite("RF64", 1, 4, fileHandle);
+  _writeUnsignedInt(fileHandle, 0xffffffff);
+  fwrite("WAVE", 1, 4, fileHandle);
+  fwrite("ds64", 1, 4, fileHandle);
+  _writeUnsignedInt(fileHandle, 28);
+  _writeUnsignedInt(fileHandle, 72 + dataSize);
+  _writeUnsignedInt(fileHandle, 0);
+  _writeUnsignedInt(fileHandle, dataSize);
+  _writeUnsignedInt(fileHandle, 0);
+  _writeUnsignedInt(fileHandle, numFrames);
+  _writeUnsignedInt(fileHandle, 0);
+  _writeUnsignedInt(fileHandle, 0);
+  fwrite("fmt ", 1, 4, fileHandle);
+  _writeUnsignedInt(fileHandle, 16);
+  fwrite(format, sizeof(unsigned short), 2, fileHandle);
+  _writeUnsignedInt(fileHandle, 44100);
+  _writeUnsignedInt(fileHandle, 44100 * 4);
+  fwrite(blockAlign, sizeof(unsigned short), 2, fileHandle);
+  fwrite("data", 1, 4, fileHandle);
+  _writeUnsignedInt(fileHandle, 0xffffffff);
+  fwrite(audioData, 1, dataSize, fileHandle);
+  fclose(fileHandle);
+
+  s = _openTestFile(kSampleSourceTestRf64Filename, false);
+  assertIntEquals(SAMPLE_SOURCE_OPEN_READ, s->openedAs);
+  assertUnsignedLongEquals((unsigned long)numFrames,
+                           sampleSourcePcmGetLengthInFrames(s));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  return 0;
+}
+
+// Broadcast WAVE files may have large metadata chunks of odd sizes, and the
+// data chunk does not have to follow the format chunk
+static int _testReadWaveWithMetadataChunks(void) {
+  const unsigned int numFrames = 16;
+  const unsigned int metadataSize = 100001;
+  const unsigned short format[] = {1, 2};
+  const unsigned short blockAlign[] = {4, 16};
+  short audioData[32];
+  SampleBuffer buffer;
+  SampleSource s;
+  FILE *fileHandle = fopen(kSampleSourceTestMappedWaveFilename, "wb");
+  unsigned int i;
+
+  assertNotNull(fileHandle);
+  for (i = 0; i < numFrames * 2; i++) {
+    audioData[i] = (short)(i * 1000);
+  }
+
+  fwrite("RIFF", 1, 4, fileHandle);
+  _writeUnsignedInt(fileHandle, 4 + 8 + metadataSize + 1 + 8 +
+                                    sizeof(audioData) + 8 + 16);
+  fwrite("WAVE", 1, 4, fileHandle);
+  fwrite("bext", 1, 4, fileHandle);
+  _writeUnsignedInt(fileHandle, metadataSize);
+  for (i = 0; i < metadataSize + 1; i++) {
+    fputc(0, fileHandle);
+  }
+  fwrite("data", 1, 4, fileHandle);
+  _writeUnsignedInt(fileHandle, sizeof(audioData));
+  fwrite(audioData, 1, sizeof(audioData), fileHandle);
+  fwrite("fmt ", 1, 4, fileHandle);
+  _writeUnsignedInt(fileHandle, 16);
+  fwrite(format, sizeof(unsigned short), 2, fileHandle);
+  _writeUnsignedInt(fileHandle, 44100);
+  _writeUnsignedInt(fileHandle, 44100 * 4);
+  fwrite(blockAlign, sizeof(unsigned short), 2, fileHandle);
+  fclose(fileHandle);
+
+  s = _openTestFile(kSampleSourceTestMappedWaveFilename, false);
+  assertIntEquals(SAMPLE_SOURCE_OPEN_READ, s->openedAs);
+  assertIntEquals(2, getNumChannels());
+  assertUnsignedLongEquals((unsigned long)numFrames,
+                           sampleSourcePcmGetLengthInFrames(s));
+
+  buffer = newSampleBuffer(2, numFrames);
+  s->readSampleBlock(s, buffer);
+  assert(fabs(buffer->samples[0][1] - 2000.0 / 32767.0) < 0.001);
+  assert(fabs(buffer->samples[1][1] - 3000.0 / 32767.0) < 0.001);
+
+  freeSampleBuffer(buffer);
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testMapStdin(void) {
+  CharString stdinName = newCharStringWithCString("-");
+  SampleSource s = sampleSourceFactory(stdinName);
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_READ);
+  assertFalse(sampleSourcePcmMapInput(s));
+  freeSampleSource(s);
+  freeCharString(stdinName);
+  return 0;
+}
+
+#if UNIX
+static int _testStdinPipe(void) {
+  CharString stdinName = newCharStringWithCString("-");
+  SampleSource s = sampleSourceFactory(stdinName);
+  const int savedStdin = dup(STDIN_FILENO);
+  int pipeFds[2];
+
+  assertIntEquals(0, pipe(pipeFds));
+  dup2(pipeFds[0], STDIN_FILENO);
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_READ));
+  dup2(savedStdin, STDIN_FILENO);
+  close(savedStdin);
+  close(pipeFds[0]);
+  close(pipeFds[1]);
+
+  assert(sampleSourcePcmIsPipe(s));
+  freeSampleSource(s);
+  freeCharString(stdinName);
+  return 0;
+}
+#endif
+
+// Write each block through its own region, last block first, which must
+// result in the same file as writing the blocks in order
+static int _testWriteRegions(const char *filenameCString) {
+  CharString filename = newCharStringWithCString(filenameCString);
+  SampleSource s = sampleSourceFactory(filename);
+  SampleSource region;
+  SampleBuffer b = newSampleBuffer(2, kSampleSourceTestBlocksize);
+  SampleCount frame;
+  int block;
+
+  setNumChannels(2);
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE);
+  assert(sampleSourcePcmPrepareRegions(
+      s, kSampleSourceTestBlocksize * kSampleSourceTestNumFullBlocks));
+
+  for (block = kSampleSourceTestNumFullBlocks - 1; block >= 0; block--) {
+    region = newSampleSourcePcmRegion(
+        s, (unsigned long)(block * kSampleSourceTestBlocksize));
+    assert(region->openSampleSource(region, SAMPLE_SOURCE_OPEN_WRITE));
+
+    for (frame = 0; frame < b->blocksize; frame++) {
+      b->samples[0][frame] = (Sample)(block * 64 + frame) / 512.0f;
+      b->samples[1][frame] = -b->samples[0][frame];
+    }
+
+    assert(region->writeSampleBlock(region, b));
+    region->closeSampleSource(region);
+    freeSampleSource(region);
+  }
+
+  assertUnsignedLongEquals(
+      (unsigned long)(kSampleSourceTestBlocksize *
+                      kSampleSourceTestNumFullBlocks),
+      sampleSourcePcmFinishRegions(s));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  freeCharString(filename);
+
+  s = _openTestFile(filenameCString, false);
+  b = newSampleBuffer(2, kSampleSourceTestBlocksize);
+  assertUnsignedLongEquals(
+      (unsigned long)(kSampleSourceTestBlocksize *
+                      kSampleSourceTestNumFullBlocks),
+      sampleSourcePcmGetLengthInFrames(s));
+
+  for (block = 0; block < kSampleSourceTestNumFullBlocks; block++) {
+    assert(s->readSampleBlock(s, b));
+
+    for (frame = 0; frame < b->blocksize; frame++) {
+      // Compare the difference, since 16-bit PCM does not round-trip exactly
+      assertDoubleEquals(
+          0.0,
+          fabs((Sample)(block * 64 + frame) / 512.0f - b->samples[0][frame]),
+          TEST_DEFAULT_TOLERANCE);
+    }
+  }
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  return 0;
+}
+
+static int _testWriteRegionsPcm(void) {
+  return _testWriteRegions(kSampleSourceTestMappedFilename);
+}
+
+static int _testWriteRegionsWave(void) {
+  return _testWriteRegions(kSampleSourceTestMappedWaveFilename);
+}
+
+static int _testPrepareRegionsForInput(void) {
+  SampleSource s;
+
+  _writeTestFile(kSampleSourceTestMappedFilename, 0);
+  s = _openTestFile(kSampleSourceTestMappedFilename, false);
+  assertFalse(sampleSourcePcmPrepareRegions(s, 1000));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testPcmFileIsNotPipe(void) {
+  SampleSource s;
+
+  _writeTestFile(kSampleSourceTestMappedFilename, 0);
+  s = _openTestFile(kSampleSourceTestMappedFilename, false);
+  assertFalse(sampleSourcePcmIsPipe(s));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  return 0;
+}
+
+// Replace everything after frame 100 of a test file with the block which
+// starts at frame 200, and check that the frames before it are kept
+static int _testResumeOutput(const char *filenameCString) {
+  CharString filename = newCharStringWithCString(filenameCString);
+  SampleSource s = sampleSourceFactory(filename);
+  SampleBuffer b = newSampleBuffer(2, kSampleSourceTestBlocksize);
+  unsigned long offset;
+  SampleCount frame;
+
+  setNumChannels(2);
+  _writeTestFile(filenameCString, 0);
+  assert(sampleSourcePcmCanResume(s));
+  sampleSourcePcmSetResumeFrame(s, 100);
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, s->numSamplesProcessed);
+
+  for (frame = 0; frame < b->blocksize; frame++) {
+    b->samples[0][frame] = (Sample)(200 + frame) / 512.0f;
+    b->samples[1][frame] = -b->samples[0][frame];
+  }
+
+  assert(s->writeSampleBlock(s, b));
+  offset = sampleSourcePcmFlush(s);
+  assertUnsignedLongEquals(
+      ((SampleSourcePcmData)s->extraData)->dataOffset + 164 * 4, offset);
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+
+  s = _openTestFile(filenameCString, false);
+#if LINUX
+  // The rest of the previous output is cut off
+  assertUnsignedLongEquals(164ul, sampleSourcePcmGetLengthInFrames(s));
+#endif
+  assert(sampleSourceReadSampleBlockAt(s, 36, b));
+  assert(_isTestBlock(b, 36));
+  assert(s->readSampleBlock(s, b));
+  assert(_isTestBlock(b, 200));
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testResumeOutputPcm(void) {
+  return _testResumeOutput(kSampleSourceTestMappedFilename);
+}
+
+static int _testResumeOutputWave(void) {
+  return _testResumeOutput(kSampleSourceTestMappedWaveFilename);
+}
+
+static int _testResumeOutputPastEnd(void) {
+  CharString filename =
+      newCharStringWithCString(kSampleSourceTestMappedWaveFilename);
+  SampleSource s = sampleSourceFactory(filename);
+
+  setNumChannels(2);
+  _writeTestFile(kSampleSourceTestMappedWaveFilename, 0);
+  sampleSourcePcmSetResumeFrame(s, 1000);
+  assertFalse(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  freeSampleSource(s);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testCannotResumeStdout(void) {
+  CharString filename = newCharStringWithCString("-");
+  SampleSource s = sampleSourceFactory(filename);
+  assertFalse(sampleSourcePcmCanResume(s));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, sampleSourcePcmFlush(s));
+  freeSampleSource(s);
+  freeCharString(filename);
+  return 0;
+}
+
+// Write a test block between silent blocks, so that the file ends with a
+// skipped block, and check that the silence reads back as zeroes
+static int _testSparseOutput(const char *filenameCString) {
+  CharString filename = newCharStringWithCString(filenameCString);
+  SampleSource s = sampleSourceFactory(filename);
+  SampleBuffer b = newSampleBuffer(2, kSampleSourceTestBlocksize);
+  SampleCount frame;
+
+  setNumChannels(2);
+  setSparseOutput(true);
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  assert(((SampleSourcePcmData)s->extraData)->seekOverSilence);
+  sampleBufferClear(b);
+  assert(s->writeSampleBlock(s, b));
+
+  for (frame = 0; frame < b->blocksize; frame++) {
+    b->samples[0][frame] = (Sample)(64 + frame) / 512.0f;
+    b->samples[1][frame] = -b->samples[0][frame];
+  }
+
+  assert(s->writeSampleBlock(s, b));
+  sampleBufferClear(b);
+  assert(s->writeSampleBlock(s, b));
+  assert(s->writeSampleBlock(s, b));
+  assertUnsignedLongEquals(256ul * 2, s->numSamplesProcessed);
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+
+  s = _openTestFile(filenameCString, false);
+  assertUnsignedLongEquals(256ul, sampleSourcePcmGetLengthInFrames(s));
+  assert(s->readSampleBlock(s, b));
+  assert(sampleBufferIsSilent(b));
+  assert(s->readSampleBlock(s, b));
+  assert(_isTestBlock(b, 64));
+  assert(s->readSampleBlock(s, b));
+  assert(sampleBufferIsSilent(b));
+  assert(s->readSampleBlock(s, b));
+  assert(sampleBufferIsSilent(b));
+  assertFalse(s->readSampleBlock(s, b));
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testSparseOutputPcm(void) {
+  return _testSparseOutput(kSampleSourceTestMappedFilename);
+}
+
+static int _testSparseOutputWave(void) {
+  return _testSparseOutput(kSampleSourceTestMappedWaveFilename);
+}
+
+static int _testSparseOutputWithDither(void) {
+  CharString filename =
+      newCharStringWithCString(kSampleSourceTestMappedWaveFilename);
+  CharString dither = newCharStringWithCString("tpdf");
+  SampleSource s = sampleSourceFactory(filename);
+
+  setSparseOutput(true);
+  assert(setDitherTypeFromString(dither));
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  assertFalse(((SampleSourcePcmData)s->extraData)->skipSilentConversion);
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeCharString(dither);
+  freeCharString(filename);
+  return 0;
+}
+
+// After a second of audio, the header of a WAVE output which is still open
+// must already hold the sizes of the audio written so far
+static int _testWaveHeaderUpdatedWhileWriting(void) {
+  CharString filename =
+      newCharStringWithCString(kSampleSourceTestMappedWaveFilename);
+  SampleSource s = sampleSourceFactory(filename);
+  SampleBuffer b = newSampleBuffer(2, (SampleCount)getSampleRate());
+  const unsigned int expectedDataSize = (unsigned int)(b->blocksize * 2 * 2);
+  unsigned int riffSize = 0;
+  unsigned int dataSize = 0;
+  FILE *fileHandle;
+
+  setNumChannels(2);
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  sampleBufferClear(b);
+  assert(s->writeSampleBlock(s, b));
+
+  fileHandle = fopen(kSampleSourceTestMappedWaveFilename, "rb");
+  assertNotNull(fileHandle);
+  assertIntEquals(0, fseek(fileHandle, 4, SEEK_SET));
+  assertIntEquals(1, (int)fread(&riffSize, sizeof(riffSize), 1, fileHandle));
+  assertIntEquals(
+      0, fseek(fileHandle,
+               (long)((SampleSourcePcmData)s->extraData)->dataOffset - 4,
+               SEEK_SET));
+  assertIntEquals(1, (int)fread(&dataSize, sizeof(dataSize), 1, fileHandle));
+  fclose(fileHandle);
+  assertUnsignedLongEquals((unsigned long)expectedDataSize,
+                           (unsigned long)dataSize);
+  assertUnsignedLongEquals(
+      (unsigned long)(((SampleSourcePcmData)s->extraData)->dataOffset - 8 +
+                      expectedDataSize),
+      (unsigned long)riffSize);
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  freeCharString(filename);
+  return 0;
+}
+
+// Write an AIFF file and read it back, both with stdio and with the file
+// mapped into memory. The output settings are changed before reading, which
+// must use the sample format of the file instead.
+static int _testAiffRoundTrip(BitDepth bitDepth, ChannelCount numChannels,
+                              SampleCount numFrames) {
+  CharString filename =
+      newCharStringWithCString(kSampleSourceTestAiffFilename);
+  SampleSource s = sampleSourceFactory(filename);
+  SampleBuffer b = newSampleBuffer(numChannels, numFrames);
+  SampleBuffer r;
+  // Integer samples are truncated when they are written, so they may be off
+  // by one step when they are read back
+  const double tolerance =
+      bitDepth == kBitDepth32Bit ? 0.0 : 1.0 / (pow(2.0, bitDepth - 1) - 1.0);
+  ChannelCount channel;
+  SampleCount frame;
+  int mapInput;
+
+  assertIntEquals((int)SAMPLE_SOURCE_TYPE_AIFF, (int)s->sampleSourceType);
+  assert(setBitDepth(bitDepth));
+  assert(setNumChannels(numChannels));
+  assert(setSampleRate(48000.0));
+
+  // 32-bit files store floats, so the samples must be exact floats to be read
+  // back unchanged in builds with double samples
+  for (channel = 0; channel < numChannels; ++channel) {
+    for (frame = 0; frame < numFrames; ++frame) {
+      b->samples[channel][frame] =
+          (Sample)((float)(((int)frame * 7 + (int)channel * 3) % 21 - 10) /
+                   10.0f);
+    }
+  }
+
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  assert(s->writeSampleBlock(s, b));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+
+  for (mapInput = 0; mapInput <= 1; ++mapInput) {
+    assert(setBitDepth(bitDepth == kBitDepth16Bit ? kBitDepth24Bit
+                                                  : kBitDepth16Bit));
+    assert(setNumChannels(numChannels == 1 ? 2 : 1));
+    assert(setSampleRate(44100.0));
+
+    s = _openTestFile(kSampleSourceTestAiffFilename, (boolByte)mapInput);
+    assertIntEquals(SAMPLE_SOURCE_OPEN_READ, s->openedAs);
+    assertDoubleEquals(48000.0, getSampleRate(), TEST_DEFAULT_TOLERANCE);
+    assertIntEquals(numChannels, getNumChannels());
+    assertUnsignedLongEquals(numFrames, sampleSourcePcmGetLengthInFrames(s));
+
+    r = newSampleBuffer(numChannels, numFrames + 1);
+    assertFalse(s->readSampleBlock(s, r));
+    assertUnsignedLongEquals(numFrames, r->blocksize);
+
+    for (channel = 0; channel < numChannels; ++channel) {
+      for (frame = 0; frame < numFrames; ++frame) {
+        assert(fabs(b->samples[channel][frame] - r->samples[channel][frame]) <=
+               tolerance);
+      }
+    }
+
+    s->closeSampleSource(s);
+    freeSampleSource(s);
+    freeSampleBuffer(r);
+  }
+
+  freeSampleBuffer(b);
+  freeCharString(filename);
+  return 0;
+}
+
+static int _testAiffRoundTrip16BitStereo(void) {
+  return _testAiffRoundTrip(kBitDepth16Bit, 2, 100);
+}
+
+// 24-bit mono audio with an odd number of frames is followed by a pad byte
+static int _testAiffRoundTrip24BitMono(void) {
+  return _testAiffRoundTrip(kBitDepth24Bit, 1, 37);
+}
+
+// Float samples are written to an AIFF-C file
+static int _testAiffRoundTrip32BitStereo(void) {
+  return _testAiffRoundTrip(kBitDepth32Bit, 2, 37);
+}
+
+static void _writeBigEndianUnsignedInt(FILE *fileHandle, unsigned int value) {
+  const byte bytes[4] = {(byte)(value >> 24), (byte)(value >> 16),
+                         (byte)(value >> 8), (byte)value};
+  fwrite(bytes, 1, 4, fileHandle);
+}
+
+// An AIFF-C file with little-endian samples, where the sound data has an
+// offset and comes before the COMM chunk, and another chunk follows it
+static int _testReadAifcLittleEndian(void) {
+  const byte commData[] = {0x00, 0x01, 0x00, 0x00, 0x00, 0x08, 0x00,
+                           0x10, 0x40, 0x0e, 0xac, 0x44, 0x00, 0x00,
+                           0x00, 0x00, 0x00, 0x00, 's',  'o',  'w',
+                           't',  0x00, 0x00};
+  const short samples[] = {0, 1000, 2000, 3000, -1000, -2000, -3000, 32767};
+  SampleSource s;
+  SampleBuffer b = newSampleBuffer(1, 16);
+  FILE *fileHandle = fopen(kSampleSourceTestAiffFilename, "wb");
+  SampleCount frame;
+
+  assertNotNull(fileHandle);
+  fwrite("FORM", 1, 4, fileHandle);
+  _writeBigEndianUnsignedInt(fileHandle, 4 + 36 + 32 + 12);
+  fwrite("AIFC", 1, 4, fileHandle);
+  fwrite("SSND", 1, 4, fileHandle);
+  _writeBigEndianUnsignedInt(fileHandle, 28);
+  _writeBigEndianUnsignedInt(fileHandle, 4);
+  _writeBigEndianUnsignedInt(fileHandle, 0);
+  _writeBigEndianUnsignedInt(fileHandle, 0);
+
+  for (frame = 0; frame < 8; ++frame) {
+    fputc(samples[frame] & 0xff, fileHandle);
+    fputc((samples[frame] >> 8) & 0xff, fileHandle);
+  }
+
+  fwrite("COMM", 1, 4, fileHandle);
+  _writeBigEndianUnsignedInt(fileHandle, sizeof(commData));
+  fwrite(commData, 1, sizeof(commData), fileHandle);
+  fwrite("ANNO", 1, 4, fileHandle);
+  _writeBigEndianUnsignedInt(fileHandle, 4);
+  fwrite("abcd", 1, 4, fileHandle);
+  fclose(fileHandle);
+
+  s = _openTestFile(kSampleSourceTestAiffFilename, false);
+  assertIntEquals(SAMPLE_SOURCE_OPEN_READ, s->openedAs);
+  assertDoubleEquals(44100.0, getSampleRate(), TEST_DEFAULT_TOLERANCE);
+  assertFalse(s->readSampleBlock(s, b));
+  assertUnsignedLongEquals(8ul, b->blocksize);
+
+  for (frame = 0; frame < 8; ++frame) {
+    assertDoubleEquals((double)samples[frame] / 32767.0, b->samples[0][frame],
+                       TEST_DEFAULT_TOLERANCE);
+  }
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  return 0;
+}
+
 TestSuite addSampleSourceTests(void);
 TestSuite addSampleSourceTests(void) {
   TestSuite testSuite =
@@ -71,5 +1140,53 @@ TestSuite addSampleSourceTests(void) {
           _testGuessSampleSourceTypeEmpty);
   addTest(testSuite, "GuessSampleSourceTypeWrongCase",
           _testGuessSampleSourceTypeWrongCase);
+  addTest(testSuite, "ReadMappedPcm", _testReadMappedPcm);
+#if !USE_AUDIOFILE
+  addTest(testSuite, "ReadMappedWave", _testReadMappedWave);
+#endif
+  addTest(testSuite, "ReadSampleBlockAtPcm", _testReadSampleBlockAtPcm);
+  addTest(testSuite, "ReadSampleBlockAtMappedPcm",
+          _testReadSampleBlockAtMappedPcm);
+  addTest(testSuite, "ReadSampleBlockAtWave", _testReadSampleBlockAtWave);
+  addTest(testSuite, "QueuedFilePcm", _testQueuedFilePcm);
+  addTest(testSuite, "QueuedFileWave", _testQueuedFileWave);
+  addTest(testSuite, "QueuedReadsOfAnotherSize", _testQueuedReadsOfAnotherSize);
+  addTest(testSuite, "QueueReadsFromStdin", _testQueueReadsFromStdin);
+  addTest(testSuite, "ReadPlanarPcm", _testReadPlanarPcm);
+  addTest(testSuite, "ReadMappedPlanarPcm", _testReadMappedPlanarPcm);
+  addTest(testSuite, "PlanarPcmRequires32Bit", _testPlanarPcmRequires32Bit);
+  addTest(testSuite, "SeekUnopenedSource", _testSeekUnopenedSource);
+  addTest(testSuite, "SeekStdin", _testSeekStdin);
+  addTest(testSuite, "WriteBlockLargerThanBlocksize",
+          _testWriteBlockLargerThanBlocksize);
+  addTest(testSuite, "WriteFramesFromOffset", _testWriteFramesFromOffset);
+  addTest(testSuite, "GetLengthInFramesPcm", _testGetLengthInFramesPcm);
+  addTest(testSuite, "GetLengthInFramesWave", _testGetLengthInFramesWave);
+  addTest(testSuite, "PreallocateMoreThanWritten",
+          _testPreallocateMoreThanWritten);
+  addTest(testSuite, "ReadRf64Wave", _testReadRf64Wave);
+  addTest(testSuite, "ReadWaveWithMetadataChunks",
+          _testReadWaveWithMetadataChunks);
+  addTest(testSuite, "MapStdin", _testMapStdin);
+#if UNIX
+  addTest(testSuite, "StdinPipe", _testStdinPipe);
+#endif
+  addTest(testSuite, "PcmFileIsNotPipe", _testPcmFileIsNotPipe);
+  addTest(testSuite, "WriteRegionsPcm", _testWriteRegionsPcm);
+  addTest(testSuite, "WriteRegionsWave", _testWriteRegionsWave);
+  addTest(testSuite, "PrepareRegionsForInput", _testPrepareRegionsForInput);
+  addTest(testSuite, "ResumeOutputPcm", _testResumeOutputPcm);
+  addTest(testSuite, "ResumeOutputWave", _testResumeOutputWave);
+  addTest(testSuite, "ResumeOutputPastEnd", _testResumeOutputPastEnd);
+  addTest(testSuite, "CannotResumeStdout", _testCannotResumeStdout);
+  addTest(testSuite, "SparseOutputPcm", _testSparseOutputPcm);
+  addTest(testSuite, "SparseOutputWave", _testSparseOutputWave);
+  addTest(testSuite, "SparseOutputWithDither", _testSparseOutputWithDither);
+  addTest(testSuite, "WaveHeaderUpdatedWhileWriting",
+          _testWaveHeaderUpdatedWhileWriting);
+  addTest(testSuite, "AiffRoundTrip16BitStereo", _testAiffRoundTrip16BitStereo);
+  addTest(testSuite, "AiffRoundTrip24BitMono", _testAiffRoundTrip24BitMono);
+  addTest(testSuite, "AiffRoundTrip32BitStereo", _testAiffRoundTrip32BitStereo);
+  addTest(testSuite, "ReadAifcLittleEndian", _testReadAifcLittleEndian);
   return testSuite;
 }
@@ -0,0 +1,245 @@
+//
+// LogSinkTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "logging/LogSink.h"
+
+#include "unit/TestRunner.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned int kLogSinkTestNumRecords = 4;
+static const int kLogSinkTestNumMessages = 100;
+static const int kLogSinkTestNumProducers = 4;
+
+typedef struct {
+  Semaphore gate;
+  int numWritten;
+  int numMessages;
+  size_t lastMessageLength;
+  int lastIndex;
+  boolByte inOrder;
+  LogLevel lastLogLevel;
+} _LogSinkTestData;
+
+static void _initTestData(_LogSinkTestData *data) {
+  data->gate = NULL;
+  data->numWritten = 0;
+  data->numMessages = 0;
+  data->lastMessageLength = 0;
+  data->lastIndex = -1;
+  data->inOrder = true;
+  data->lastLogLevel = LOG_DEBUG;
+}
+
+static void _writeTestRecord(const LogRecord *record, void *userData) {
+  _LogSinkTestData *data = (_LogSinkTestData *)userData;
+  int index = atoi(record->message);
+
+  if (data->gate != NULL) {
+    semaphoreWait(data->gate);
+  }
+
+  // Dropped message warnings are written by the sink itself
+  if (record->logLevel != LOG_WARN) {
+    data->numMessages++;
+  }
+
+  if (record->logLevel == LOG_INFO) {
+    if (index != data->lastIndex + 1) {
+      data->inOrder = false;
+    }
+    data->lastIndex = index;
+  }
+
+  data->lastLogLevel = record->logLevel;
+  data->lastMessageLength = strlen(record->message);
+  data->numWritten++;
+}
+
+static void _pushTestMessage(LogSink s, int index) {
+  char message[32];
+  snprintf(message, 32, "%d", index);
+  logSinkPush(s, LOG_INFO, 0, 0, message);
+}
+
+static int _testNewLogSink(void) {
+  _LogSinkTestData data;
+  LogSink s;
+
+  _initTestData(&data);
+  s = newLogSink(5, _writeTestRecord, &data);
+  assertNotNull(s);
+  // Rounded up to the next power of two
+  assertIntEquals(8, s->numRecords);
+  freeLogSink(s);
+  assertIntEquals(0, data.numWritten);
+  return 0;
+}
+
+static int _testWriteRecordsInOrder(void) {
+  _LogSinkTestData data;
+  LogSink s;
+  int i;
+
+  _initTestData(&data);
+  s = newLogSink(kLogSinkTestNumMessages, _writeTestRecord, &data);
+  assertNotNull(s);
+
+  for (i = 0; i < kLogSinkTestNumMessages; i++) {
+    _pushTestMessage(s, i);
+  }
+
+  freeLogSink(s);
+  assertIntEquals(kLogSinkTestNumMessages, data.numWritten);
+  assert(data.inOrder);
+  return 0;
+}
+
+static int _testFlush(void) {
+  _LogSinkTestData data;
+  LogSink s;
+  int i;
+
+  _initTestData(&data);
+  s = newLogSink(kLogSinkTestNumMessages, _writeTestRecord, &data);
+  assertNotNull(s);
+
+  for (i = 0; i < kLogSinkTestNumMessages; i++) {
+    _pushTestMessage(s, i);
+  }
+
+  logSinkFlush(s);
+  assertIntEquals(kLogSinkTestNumMessages, data.numWritten);
+  freeLogSink(s);
+  return 0;
+}
+
+static int _testTruncateLongMessage(void) {
+  _LogSinkTestData data;
+  char message[LOG_MESSAGE_MAX_LENGTH * 2];
+  LogSink s;
+
+  _initTestData(&data);
+  memset(message, '0', LOG_MESSAGE_MAX_LENGTH * 2 - 1);
+  message[LOG_MESSAGE_MAX_LENGTH * 2 - 1] = '\0';
+  s = newLogSink(kLogSinkTestNumRecords, _writeTestRecord, &data);
+  assertNotNull(s);
+  assert(logSinkPush(s, LOG_INFO, 0, 0, message));
+  freeLogSink(s);
+  assertIntEquals(1, data.numWritten);
+  assertSizeEquals((size_t)(LOG_MESSAGE_MAX_LENGTH - 1),
+                   data.lastMessageLength);
+  return 0;
+}
+
+static int _testDropWhenFull(void) {
+  _LogSinkTestData data;
+  LogSink s;
+  unsigned int i;
+
+  _initTestData(&data);
+  // Hold the writer thread in the first write, so that nothing is freed
+  data.gate = newSemaphore(0);
+  s = newLogSink(kLogSinkTestNumRecords, _writeTestRecord, &data);
+  assertNotNull(s);
+
+  for (i = 0; i < kLogSinkTestNumRecords; i++) {
+    assert(logSinkPush(s, LOG_INFO, 0, 0, "0"));
+  }
+
+  assertFalse(logSinkPush(s, LOG_INFO, 0, 0, "0"));
+  assertIntEquals(1, s->numDropped);
+
+  // One more write for the dropped messages warning
+  for (i = 0; i <= kLogSinkTestNumRecords; i++) {
+    semaphorePost(data.gate);
+  }
+
+  freeLogSink(s);
+  assertIntEquals(kLogSinkTestNumRecords + 1, data.numWritten);
+  assertIntEquals(LOG_WARN, data.lastLogLevel);
+  freeSemaphore(data.gate);
+  return 0;
+}
+
+static void _producerThreadFunc(void *userData) {
+  LogSink s = (LogSink)userData;
+  int i;
+
+  for (i = 0; i < kLogSinkTestNumMessages; i++) {
+    logSinkPush(s, LOG_DEBUG, 0, 0, "0");
+  }
+}
+
+static int _testMultipleProducers(void) {
+  _LogSinkTestData data;
+  Thread *producers =
+      (Thread *)malloc(sizeof(Thread) * kLogSinkTestNumProducers);
+  LogSink s;
+  int numDropped;
+  int i;
+
+  _initTestData(&data);
+  s = newLogSink(kLogSinkTestNumRecords, _writeTestRecord, &data);
+  assertNotNull(s);
+
+  for (i = 0; i < kLogSinkTestNumProducers; i++) {
+    producers[i] = newThread(_producerThreadFunc, s);
+    assertNotNull(producers[i]);
+  }
+
+  for (i = 0; i < kLogSinkTestNumProducers; i++) {
+    threadJoinAndFree(producers[i]);
+  }
+
+  // Every message is either written or counted as dropped
+  numDropped = (int)s->numDropped;
+  freeLogSink(s);
+  free(producers);
+  assertIntEquals(kLogSinkTestNumMessages * kLogSinkTestNumProducers,
+                  data.numMessages + numDropped);
+  return 0;
+}
+
+static int _testFreeNullLogSink(void) {
+  freeLogSink(NULL);
+  return 0;
+}
+
+TestSuite addLogSinkTests(void);
+TestSuite addLogSinkTests(void) {
+  TestSuite testSuite = newTestSuite("LogSink", NULL, NULL);
+  addTest(testSuite, "NewLogSink", _testNewLogSink);
+  addTest(testSuite, "WriteRecordsInOrder", _testWriteRecordsInOrder);
+  addTest(testSuite, "Flush", _testFlush);
+  addTest(testSuite, "TruncateLongMessage", _testTruncateLongMessage);
+  addTest(testSuite, "DropWhenFull", _testDropWhenFull);
+  addTest(testSuite, "MultipleProducers", _testMultipleProducers);
+  addTest(testSuite, "FreeNullLogSink", _testFreeNullLogSink);
+  return testSuite;
+}
@@ -26,12 +26,17 @@
 
 #include "midi/MidiSequence.h"
 
+#include "base/MemoryUsage.h"
+
 #include "unit/TestRunner.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 static int _testNewMidiSequence(void) {
   MidiSequence m = newMidiSequence();
   assertNotNull(m);
-  assertIntEquals(0, linkedListLength(m->midiEvents));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, m->numMidiEvents);
   freeMidiSequence(m);
   return 0;
 }
@@ -40,7 +45,44 @@ static int _testAppendMidiEventToSequence(void) {
   MidiSequence m = newMidiSequence();
   MidiEvent e = newMidiEvent();
   appendMidiEventToSequence(m, e);
-  assertIntEquals(1, linkedListLength(m->midiEvents));
+  assertUnsignedLongEquals(1ul, m->numMidiEvents);
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testAppendEventsOwnedBySequence(void) {
+  MidiSequence m = newMidiSequence();
+  MidiEvent heapEvent = newMidiEvent();
+  MidiEvent e;
+  unsigned long i;
+
+  // Events from the sequence and from newMidiEvent() can be mixed, and both
+  // are copied into the sequence
+  for (i = 0; i < 1000; i++) {
+    e = midiSequenceNewMidiEvent(m);
+    e->eventType = MIDI_TYPE_REGULAR;
+    e->timestamp = i;
+    appendMidiEventToSequence(m, e);
+  }
+
+  e = midiSequenceNewMidiEvent(m);
+  e->eventType = MIDI_TYPE_META;
+  e->extraData = midiSequenceNewMidiEventData(m, 3);
+  e->extraDataSize = 3;
+  e->timestamp = i;
+  appendMidiEventToSequence(m, e);
+  heapEvent->timestamp = i + 1;
+  heapEvent->data1 = 42;
+  appendMidiEventToSequence(m, heapEvent);
+
+  assertUnsignedLongEquals(1002ul, m->numMidiEvents);
+  assertUnsignedLongEquals(500ul, (unsigned long)m->midiEvents[500].timestamp);
+  assertIntEquals(MIDI_TYPE_META, m->midiEvents[1000].eventType);
+  assert(m->midiEvents[1000].extraDataOffset != kMidiEventRecordNoData);
+  assertIntEquals(42, m->midiEvents[1001].data1);
+  // The events created by the sequence are reused
+  assertUnsignedLongEquals(1ul, m->_numSpareEvents);
+
   freeMidiSequence(m);
   return 0;
 }
@@ -48,7 +90,7 @@ static int _testAppendMidiEventToSequence(void) {
 static int _testAppendNullMidiEventToSequence(void) {
   MidiSequence m = newMidiSequence();
   appendMidiEventToSequence(m, NULL);
-  assertIntEquals(0, linkedListLength(m->midiEvents));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, m->numMidiEvents);
   freeMidiSequence(m);
   return 0;
 }
@@ -139,12 +181,403 @@ static int _testFillEventsFromRangePastSequence(void) {
   return 0;
 }
 
+static MidiEvent _newMidiEventAt(const unsigned long timestamp,
+                                  const byte data1) {
+  MidiEvent e = newMidiEvent();
+  e->status = 0x90;
+  e->data1 = data1;
+  e->timestamp = timestamp;
+  return e;
+}
+
+static int _testAppendManyEvents(void) {
+  MidiSequence m = newMidiSequence();
+  unsigned long i;
+
+  for (i = 0; i < 1000; i++) {
+    appendMidiEventToSequence(m, _newMidiEventAt(i, 0));
+  }
+
+  assertUnsignedLongEquals(1000ul, m->numMidiEvents);
+
+  for (i = 0; i < 1000; i++) {
+    assertUnsignedLongEquals(i, (unsigned long)m->midiEvents[i].timestamp);
+  }
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testCountsMemoryUsage(void) {
+  MidiSequence m;
+  MidiEvent e;
+  unsigned long i;
+
+  initMemoryUsage();
+  m = newMidiSequence();
+
+  for (i = 0; i < 1000; i++) {
+    e = midiSequenceNewMidiEvent(m);
+    e->timestamp = i;
+    appendMidiEventToSequence(m, e);
+  }
+
+  assert(memoryUsageInstance->current[kMemoryUsageMidiSequences] >=
+         1000 * sizeof(MidiEventRecord));
+  freeMidiSequence(m);
+  assertSizeEquals((size_t)0,
+                   memoryUsageInstance->current[kMemoryUsageMidiSequences]);
+  assert(memoryUsageGetPeak(kMemoryUsageMidiSequences) > 0);
+
+  freeMemoryUsage();
+  return 0;
+}
+
+static int _testGetRange(void) {
+  MidiSequence m = newMidiSequence();
+  MidiEvent events;
+  unsigned long numEvents;
+
+  appendMidiEventToSequence(m, _newMidiEventAt(10, 0));
+  appendMidiEventToSequence(m, _newMidiEventAt(20, 0));
+  appendMidiEventToSequence(m, _newMidiEventAt(300, 0));
+  assert(midiSequenceGetRange(m, 0, 256, &events, &numEvents));
+  assertUnsignedLongEquals(2ul, numEvents);
+  assertUnsignedLongEquals(20ul, events[1].deltaFrames);
+
+  assertFalse(midiSequenceGetRange(m, 256, 256, &events, &numEvents));
+  assertUnsignedLongEquals(1ul, numEvents);
+  assertUnsignedLongEquals(300ul, events[0].timestamp);
+  assertUnsignedLongEquals(44ul, events[0].deltaFrames);
+  assertIntEquals(3, m->numMidiEventsProcessed);
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testMidiEventRecordSize(void) {
+  assertSizeEquals((size_t)16, sizeof(MidiEventRecord));
+  return 0;
+}
+
+static int _testGetRangeWithExtraData(void) {
+  MidiSequence m = newMidiSequence();
+  const byte sysexData[] = {0xf0, 0x7e, 0x7f, 0x09, 0x01, 0xf7};
+  MidiEvent e = newMidiEvent();
+  MidiEvent events;
+  unsigned long numEvents;
+
+  e->eventType = MIDI_TYPE_SYSEX;
+  e->status = 0xf0;
+  e->timestamp = 10;
+  e->extraData = (byte *)malloc(sizeof(sysexData));
+  memcpy(e->extraData, sysexData, sizeof(sysexData));
+  e->extraDataSize = sizeof(sysexData);
+  appendMidiEventToSequence(m, e);
+  appendMidiEventToSequence(m, _newMidiEventAt(20, 0));
+
+  assertFalse(midiSequenceGetRange(m, 0, 256, &events, &numEvents));
+  assertUnsignedLongEquals(2ul, numEvents);
+  assertIntEquals(MIDI_TYPE_SYSEX, events[0].eventType);
+  assertSizeEquals(sizeof(sysexData), events[0].extraDataSize);
+  assertIntEquals(0,
+                  memcmp(sysexData, events[0].extraData, sizeof(sysexData)));
+  assertIsNull(events[1].extraData);
+  assertSizeEquals((size_t)0, events[1].extraDataSize);
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testGetRangeSkipsAhead(void) {
+  MidiSequence m = newMidiSequence();
+  MidiEvent events;
+  unsigned long numEvents;
+
+  appendMidiEventToSequence(m, _newMidiEventAt(10, 0));
+  appendMidiEventToSequence(m, _newMidiEventAt(600, 0));
+  appendMidiEventToSequence(m, _newMidiEventAt(1000, 0));
+  // Events before the start of the block are skipped
+  assert(midiSequenceGetRange(m, 512, 256, &events, &numEvents));
+  assertUnsignedLongEquals(1ul, numEvents);
+  assertUnsignedLongEquals(600ul, events[0].timestamp);
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testSortOutOfOrderEvents(void) {
+  MidiSequence m = newMidiSequence();
+  MidiEvent events;
+  unsigned long numEvents;
+
+  appendMidiEventToSequence(m, _newMidiEventAt(300, 1));
+  appendMidiEventToSequence(m, _newMidiEventAt(100, 2));
+  appendMidiEventToSequence(m, _newMidiEventAt(200, 3));
+  appendMidiEventToSequence(m, _newMidiEventAt(100, 4));
+  assertFalse(midiSequenceGetRange(m, 0, 512, &events, &numEvents));
+  assertUnsignedLongEquals(4ul, numEvents);
+  // Events with the same timestamp must keep their order
+  assertIntEquals(2, events[0].data1);
+  assertIntEquals(4, events[1].data1);
+  assertIntEquals(3, events[2].data1);
+  assertIntEquals(1, events[3].data1);
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testGetEndTimestamp(void) {
+  MidiSequence m = newMidiSequence();
+
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, midiSequenceGetEndTimestamp(m));
+  appendMidiEventToSequence(m, _newMidiEventAt(300, 1));
+  appendMidiEventToSequence(m, _newMidiEventAt(100, 2));
+  assertUnsignedLongEquals(300ul, midiSequenceGetEndTimestamp(m));
+
+  // The end counts from the start of the sequence, like all other timestamps
+  midiSequenceSetStartTimestamp(m, 200);
+  assertUnsignedLongEquals(100ul, midiSequenceGetEndTimestamp(m));
+  midiSequenceSetStartTimestamp(m, 400);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, midiSequenceGetEndTimestamp(m));
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testSeekMidiSequence(void) {
+  MidiSequence m = newMidiSequence();
+  LinkedList l = newLinkedList();
+
+  appendMidiEventToSequence(m, _newMidiEventAt(100, 1));
+  appendMidiEventToSequence(m, _newMidiEventAt(600, 2));
+  assertFalse(fillMidiEventsFromRange(m, 512, 256, l));
+  freeLinkedList(l);
+
+  // Seeking backwards allows the sequence to be read again
+  midiSequenceSeek(m, 0);
+  l = newLinkedList();
+  assert(fillMidiEventsFromRange(m, 0, 256, l));
+  assertIntEquals(1, linkedListLength(l));
+  assertIntEquals(1, ((MidiEvent)l->item)->data1);
+
+  freeMidiSequence(m);
+  freeLinkedList(l);
+  return 0;
+}
+
+static int _testSetStartTimestamp(void) {
+  MidiSequence m = newMidiSequence();
+  LinkedList l = newLinkedList();
+
+  appendMidiEventToSequence(m, _newMidiEventAt(100, 1));
+  appendMidiEventToSequence(m, _newMidiEventAt(1100, 2));
+  midiSequenceSetStartTimestamp(m, 1000);
+  assertFalse(fillMidiEventsFromRange(m, 0, 256, l));
+  assertIntEquals(1, linkedListLength(l));
+  assertIntEquals(2, ((MidiEvent)l->item)->data1);
+  assertUnsignedLongEquals(100ul, ((MidiEvent)l->item)->deltaFrames);
+  // The event itself still has its original timestamp
+  assertUnsignedLongEquals(1100ul, ((MidiEvent)l->item)->timestamp);
+
+  freeMidiSequence(m);
+  freeLinkedList(l);
+  return 0;
+}
+
+typedef struct {
+  unsigned long nextTimestamp;
+  unsigned long lastTimestamp;
+  // Give each event one byte of extra data, which is its timestamp / 100
+  boolByte withExtraData;
+} _MidiSequenceTestSource;
+
+// Produces one event every 100 frames, up to lastTimestamp
+static boolByte _fillMidiSequenceTestSource(void *userData,
+                                            void *midiSequencePtr,
+                                            const unsigned long stopTimestamp) {
+  _MidiSequenceTestSource *source = (_MidiSequenceTestSource *)userData;
+  MidiSequence m = (MidiSequence)midiSequencePtr;
+  MidiEvent e;
+
+  while (source->nextTimestamp <= source->lastTimestamp &&
+         source->nextTimestamp < stopTimestamp) {
+    e = midiSequenceNewMidiEvent(m);
+    e->eventType = MIDI_TYPE_REGULAR;
+    e->timestamp = source->nextTimestamp;
+
+    if (source->withExtraData) {
+      e->eventType = MIDI_TYPE_SYSEX;
+      e->extraData = midiSequenceNewMidiEventData(m, 1);
+      e->extraData[0] = (byte)(source->nextTimestamp / 100);
+      e->extraDataSize = 1;
+    }
+
+    appendMidiEventToSequence(m, e);
+    source->nextTimestamp += 100;
+  }
+
+  return (boolByte)(source->nextTimestamp <= source->lastTimestamp);
+}
+
+static int _testStreamMidiSequence(void) {
+  MidiSequence m = newMidiSequence();
+  _MidiSequenceTestSource source = {0, 100000, false};
+  unsigned long startTimestamp = 0;
+  unsigned long totalEvents = 0;
+  MidiEvent events;
+  unsigned long numEvents;
+  boolByte moreEvents = true;
+
+  midiSequenceSetFillFunc(m, _fillMidiSequenceTestSource, &source);
+
+  while (moreEvents) {
+    moreEvents =
+        midiSequenceGetRange(m, startTimestamp, 256, &events, &numEvents);
+    totalEvents += numEvents;
+    // Only the events for the current block are kept in memory
+    assert(m->numMidiEvents <= 3);
+    startTimestamp += 256;
+  }
+
+  assertUnsignedLongEquals(1001ul, totalEvents);
+  assertIntEquals(1001, m->numMidiEventsProcessed);
+  // Played events are reused for new ones
+  assert(m->_numSpareEvents > 0);
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testStreamMidiSequenceWithExtraData(void) {
+  MidiSequence m = newMidiSequence();
+  _MidiSequenceTestSource source = {0, 100000, true};
+  unsigned long startTimestamp = 0;
+  MidiEvent events;
+  unsigned long numEvents;
+  unsigned long i;
+  boolByte moreEvents = true;
+
+  midiSequenceSetFillFunc(m, _fillMidiSequenceTestSource, &source);
+
+  while (moreEvents) {
+    moreEvents =
+        midiSequenceGetRange(m, startTimestamp, 256, &events, &numEvents);
+
+    for (i = 0; i < numEvents; i++) {
+      assertSizeEquals((size_t)1, events[i].extraDataSize);
+      assertIntEquals((byte)(events[i].timestamp / 100),
+                      events[i].extraData[0]);
+    }
+
+    // The data of played events is released along with them
+    assert(m->_extraDataSize <= 3 * (sizeof(uint32_t) + 1));
+    startTimestamp += 256;
+  }
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testSetStartTimestampOfStreamedSequence(void) {
+  MidiSequence m = newMidiSequence();
+  _MidiSequenceTestSource source = {0, 100000, false};
+  MidiEvent events;
+  unsigned long numEvents;
+
+  midiSequenceSetFillFunc(m, _fillMidiSequenceTestSource, &source);
+  midiSequenceSetStartTimestamp(m, 50050);
+  assert(midiSequenceGetRange(m, 0, 256, &events, &numEvents));
+  assertUnsignedLongEquals(3ul, numEvents);
+  assertUnsignedLongEquals(50100ul, events[0].timestamp);
+  assertUnsignedLongEquals(50ul, events[0].deltaFrames);
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testSeekStreamedMidiSequence(void) {
+  MidiSequence m = newMidiSequence();
+  _MidiSequenceTestSource source = {0, 100000, false};
+  MidiEvent events;
+  unsigned long numEvents;
+
+  midiSequenceSetFillFunc(m, _fillMidiSequenceTestSource, &source);
+  midiSequenceSeek(m, 50000);
+  assert(midiSequenceGetRange(m, 50000, 256, &events, &numEvents));
+  assertUnsignedLongEquals(3ul, numEvents);
+  assertUnsignedLongEquals(50000ul, events[0].timestamp);
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+// The benchmark sequence has one event every this many frames, which is a
+// dense but realistic stream of notes
+static const unsigned long kMidiSequenceBenchmarkEventSpacing = 32;
+static const unsigned long kMidiSequenceBenchmarkNumEvents = 10000;
+static const unsigned long kMidiSequenceBenchmarkBlocksize = 512;
+
+typedef struct {
+  MidiSequence midiSequence;
+  LinkedList midiEvents;
+  unsigned long timestamp;
+} _MidiSequenceBenchmarkData;
+
+static void *_setupMidiSequenceBenchmark(void) {
+  _MidiSequenceBenchmarkData *data =
+      (_MidiSequenceBenchmarkData *)malloc(sizeof(_MidiSequenceBenchmarkData));
+  MidiEvent e;
+  unsigned long i;
+
+  data->midiSequence = newMidiSequence();
+  data->midiEvents = newLinkedList();
+  data->timestamp = 0;
+
+  for (i = 0; i < kMidiSequenceBenchmarkNumEvents; i++) {
+    e = midiSequenceNewMidiEvent(data->midiSequence);
+    e->eventType = MIDI_TYPE_REGULAR;
+    e->status = (byte)(i % 2 == 0 ? 0x90 : 0x80);
+    e->data1 = (byte)(60 + (i / 2) % 12);
+    e->data2 = 100;
+    e->timestamp = i * kMidiSequenceBenchmarkEventSpacing;
+    appendMidiEventToSequence(data->midiSequence, e);
+  }
+
+  return data;
+}
+
+static void _benchmarkFillEventsFromRange(void *context) {
+  _MidiSequenceBenchmarkData *data = (_MidiSequenceBenchmarkData *)context;
+
+  linkedListClear(data->midiEvents);
+
+  if (fillMidiEventsFromRange(data->midiSequence, data->timestamp,
+                              kMidiSequenceBenchmarkBlocksize,
+                              data->midiEvents)) {
+    data->timestamp += kMidiSequenceBenchmarkBlocksize;
+  } else {
+    // Start over from the beginning of the sequence
+    midiSequenceSeek(data->midiSequence, 0);
+    data->timestamp = 0;
+  }
+}
+
+static void _teardownMidiSequenceBenchmark(void *context) {
+  _MidiSequenceBenchmarkData *data = (_MidiSequenceBenchmarkData *)context;
+  freeMidiSequence(data->midiSequence);
+  freeLinkedList(data->midiEvents);
+  free(data);
+}
+
 TestSuite addMidiSequenceTests(void);
 TestSuite addMidiSequenceTests(void) {
   TestSuite testSuite = newTestSuite("MidiSequence", NULL, NULL);
 
   addTest(testSuite, "Initialization", _testNewMidiSequence);
   addTest(testSuite, "AppendEvent", _testAppendMidiEventToSequence);
+  addTest(testSuite, "AppendEventsOwnedBySequence",
+          _testAppendEventsOwnedBySequence);
   addTest(testSuite, "AppendNullEvent", _testAppendNullMidiEventToSequence);
   addTest(testSuite, "AppendEventToNullSequence",
           _testAppendEventToNullSequence);
@@ -154,6 +587,28 @@ TestSuite addMidiSequenceTests(void) {
   addTest(testSuite, "FillEventsSequentially", _testFillEventsSequentially);
   addTest(testSuite, "FillEventsFromRangePastSequenceEnd",
           _testFillEventsFromRangePastSequence);
+  addTest(testSuite, "AppendManyEvents", _testAppendManyEvents);
+  addTest(testSuite, "CountsMemoryUsage", _testCountsMemoryUsage);
+  addTest(testSuite, "GetRange", _testGetRange);
+  addTest(testSuite, "MidiEventRecordSize", _testMidiEventRecordSize);
+  addTest(testSuite, "GetRangeWithExtraData", _testGetRangeWithExtraData);
+  addTest(testSuite, "GetRangeSkipsAhead", _testGetRangeSkipsAhead);
+  addTest(testSuite, "SortOutOfOrderEvents", _testSortOutOfOrderEvents);
+  addTest(testSuite, "GetEndTimestamp", _testGetEndTimestamp);
+  addTest(testSuite, "SeekMidiSequence", _testSeekMidiSequence);
+  addTest(testSuite, "SetStartTimestamp", _testSetStartTimestamp);
+  addTest(testSuite, "StreamMidiSequence", _testStreamMidiSequence);
+  addTest(testSuite, "StreamMidiSequenceWithExtraData",
+          _testStreamMidiSequenceWithExtraData);
+  addTest(testSuite, "SeekStreamedMidiSequence",
+          _testSeekStreamedMidiSequence);
+  addTest(testSuite, "SetStartTimestampOfStreamedSequence",
+          _testSetStartTimestampOfStreamedSequence);
+
+  addBenchmarkWithSetup(testSuite, "FillEventsFromRange",
+                        _setupMidiSequenceBenchmark,
+                        _benchmarkFillEventsFromRange,
+                        _teardownMidiSequenceBenchmark);
 
   return testSuite;
 }
@@ -26,10 +26,32 @@
 
 #include "midi/MidiSource.h"
 
+#include "audio/AudioSettings.h"
+#include "base/File.h"
+#include "midi/MidiSourceFile.h"
 #include "unit/TestRunner.h"
 
+#include <string.h>
+
 const char *TEST_MIDI_FILENAME = "test.mid";
 
+#define TEST_MIDI_STREAM_FILENAME "mrswatsontest-stream.mid"
+
+static void _midiSourceSetup(void) { initAudioSettings(); }
+
+static void _midiSourceTeardown(void) {
+  CharString midiFilePath = newCharStringWithCString(TEST_MIDI_STREAM_FILENAME);
+  File midiFile = newFileWithPath(midiFilePath);
+
+  if (fileExists(midiFile)) {
+    fileRemove(midiFile);
+  }
+
+  freeCharString(midiFilePath);
+  freeFile(midiFile);
+  freeAudioSettings();
+}
+
 static int _testGuessMidiSourceType(void) {
   CharString c = newCharStringWithCString(TEST_MIDI_FILENAME);
   assertIntEquals(MIDI_SOURCE_TYPE_FILE, guessMidiSourceType(c));
@@ -44,6 +66,13 @@ static int _testGuessMidiSourceTypeInvalid(void) {
   return 0;
 }
 
+static int _testGuessMidiSourceTypeStdin(void) {
+  CharString c = newCharStringWithCString("-");
+  assertIntEquals(MIDI_SOURCE_TYPE_FILE, guessMidiSourceType(c));
+  freeCharString(c);
+  return 0;
+}
+
 static int _testNewMidiSource(void) {
   CharString c = newCharStringWithCString(TEST_MIDI_FILENAME);
   MidiSource m = newMidiSource(MIDI_SOURCE_TYPE_FILE, c);
@@ -54,12 +83,214 @@ static int _testNewMidiSource(void) {
   return 0;
 }
 
+static boolByte _writeTestMidiFile(const byte *data, const size_t numBytes) {
+  FILE *fp = fopen(TEST_MIDI_STREAM_FILENAME, "wb");
+  size_t bytesWritten;
+
+  if (fp == NULL) {
+    return false;
+  }
+
+  bytesWritten = fwrite(data, 1, numBytes, fp);
+  fclose(fp);
+  return (boolByte)(bytesWritten == numBytes);
+}
+
+static int _testStreamEventsFromFile(void) {
+  // Type 0 file with 480 ticks per beat, containing a note which lasts for one
+  // beat, a sequence name which should be skipped, and the end of the track
+  const byte midiFileData[] = {
+      'M',  'T',  'h',  'd',  0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00,
+      0x01, 0x01, 0xe0, 'M',  'T',  'r',  'k',  0x00, 0x00, 0x00, 0x13,
+      0x00, 0x90, 0x3c, 0x40, 0x83, 0x60, 0x80, 0x3c, 0x00, 0x00, 0xff,
+      0x03, 0x02, 'h',  'i',  0x00, 0xff, 0x2f, 0x00};
+  const unsigned long beatTimestamp = (unsigned long)(DEFAULT_SAMPLE_RATE / 2);
+  CharString c = newCharStringWithCString(TEST_MIDI_STREAM_FILENAME);
+  MidiSource m = newMidiSource(MIDI_SOURCE_TYPE_FILE, c);
+  MidiSequence s = newMidiSequence();
+  MidiEvent events;
+  unsigned long numEvents;
+
+  assert(_writeTestMidiFile(midiFileData, sizeof(midiFileData)));
+  assert(m->openMidiSource(m));
+  assert(m->readMidiEvents(m, s));
+  // Events are only read from the file once they are needed
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, s->numMidiEvents);
+
+  assert(midiSequenceGetRange(s, 0, 512, &events, &numEvents));
+  assertUnsignedLongEquals(1ul, numEvents);
+  assertIntEquals(0x90, events[0].status);
+
+  assertFalse(midiSequenceGetRange(s, beatTimestamp, 512, &events, &numEvents));
+  assertUnsignedLongEquals(2ul, numEvents);
+  assertIntEquals(0x80, events[0].status);
+  assertUnsignedLongEquals(beatTimestamp, events[0].timestamp);
+  assertIntEquals(MIDI_TYPE_META, events[1].eventType);
+  assertIntEquals(MIDI_META_TYPE_TRACK_END, events[1].status);
+  assertIntEquals(3, s->numMidiEventsProcessed);
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testMapsMidiFile(void) {
+  const byte midiFileData[] = {'M',  'T',  'h',  'd',  0x00, 0x00, 0x00, 0x06,
+                               0x00, 0x00, 0x00, 0x01, 0x01, 0xe0, 'M',  'T',
+                               'r',  'k',  0x00, 0x00, 0x00, 0x04, 0x00, 0xff,
+                               0x2f, 0x00};
+  CharString c = newCharStringWithCString(TEST_MIDI_STREAM_FILENAME);
+  MidiSource m = newMidiSource(MIDI_SOURCE_TYPE_FILE, c);
+  MidiSequence s = newMidiSequence();
+
+  assert(_writeTestMidiFile(midiFileData, sizeof(midiFileData)));
+  assert(m->openMidiSource(m));
+  assertNotNull(((MidiSourceFileData)m->extraData)->mappedFile);
+  assert(m->readMidiEvents(m, s));
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testTruncatedMidiFile(void) {
+  // The track claims to have 19 bytes, but the file ends after two of them
+  const byte midiFileData[] = {'M',  'T',  'h',  'd',  0x00, 0x00, 0x00, 0x06,
+                               0x00, 0x00, 0x00, 0x01, 0x01, 0xe0, 'M',  'T',
+                               'r',  'k',  0x00, 0x00, 0x00, 0x13, 0x00, 0x90};
+  CharString c = newCharStringWithCString(TEST_MIDI_STREAM_FILENAME);
+  MidiSource m = newMidiSource(MIDI_SOURCE_TYPE_FILE, c);
+  MidiSequence s = newMidiSequence();
+
+  assert(_writeTestMidiFile(midiFileData, sizeof(midiFileData)));
+  assert(m->openMidiSource(m));
+  assertFalse(m->readMidiEvents(m, s));
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testTempoChangesInFile(void) {
+  // Starts at 60 BPM, and changes to 120 BPM after the first beat. Each note
+  // event is one beat after the previous one.
+  const byte midiFileData[] = {
+      'M',  'T',  'h',  'd',  0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x01,
+      0x01, 0xe0, 'M',  'T',  'r',  'k',  0x00, 0x00, 0x00, 0x1c, 0x00, 0xff,
+      0x51, 0x03, 0x0f, 0x42, 0x40, 0x83, 0x60, 0x90, 0x3c, 0x40, 0x00, 0xff,
+      0x51, 0x03, 0x07, 0xa1, 0x20, 0x83, 0x60, 0x80, 0x3c, 0x00, 0x00, 0xff,
+      0x2f, 0x00};
+  const unsigned long sampleRate = (unsigned long)DEFAULT_SAMPLE_RATE;
+  CharString c = newCharStringWithCString(TEST_MIDI_STREAM_FILENAME);
+  MidiSource m = newMidiSource(MIDI_SOURCE_TYPE_FILE, c);
+  MidiSequence s = newMidiSequence();
+  MidiEvent events;
+  unsigned long numEvents;
+
+  assert(_writeTestMidiFile(midiFileData, sizeof(midiFileData)));
+  assert(m->openMidiSource(m));
+  assert(m->readMidiEvents(m, s));
+  assertFalse(midiSequenceGetRange(s, 0, sampleRate * 2, &events, &numEvents));
+  assertUnsignedLongEquals(5ul, numEvents);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, events[0].timestamp);
+  assertUnsignedLongEquals(sampleRate, events[1].timestamp);
+  assertUnsignedLongEquals(sampleRate, events[2].timestamp);
+  assertUnsignedLongEquals(sampleRate + sampleRate / 2,
+                           events[3].timestamp);
+  assertIntEquals(0x80, events[3].status);
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testMergeTracksInFile(void) {
+  // Type 1 file with the same events as above, but where the tempo changes
+  // are in their own track
+  const byte midiFileData[] = {
+      'M',  'T',  'h',  'd',  0x00, 0x00, 0x00, 0x06, 0x00, 0x01, 0x00, 0x02,
+      0x01, 0xe0, 'M',  'T',  'r',  'k',  0x00, 0x00, 0x00, 0x13, 0x00, 0xff,
+      0x51, 0x03, 0x0f, 0x42, 0x40, 0x83, 0x60, 0xff, 0x51, 0x03, 0x07, 0xa1,
+      0x20, 0x00, 0xff, 0x2f, 0x00, 'M',  'T',  'r',  'k',  0x00, 0x00, 0x00,
+      0x0e, 0x83, 0x60, 0x90, 0x3c, 0x40, 0x83, 0x60, 0x80, 0x3c, 0x00, 0x00,
+      0xff, 0x2f, 0x00};
+  const unsigned long sampleRate = (unsigned long)DEFAULT_SAMPLE_RATE;
+  CharString c = newCharStringWithCString(TEST_MIDI_STREAM_FILENAME);
+  MidiSource m = newMidiSource(MIDI_SOURCE_TYPE_FILE, c);
+  MidiSequence s = newMidiSequence();
+  MidiEvent events;
+  unsigned long numEvents;
+
+  assert(_writeTestMidiFile(midiFileData, sizeof(midiFileData)));
+  assert(m->openMidiSource(m));
+  assert(m->readMidiEvents(m, s));
+  assertFalse(midiSequenceGetRange(s, 0, sampleRate * 2, &events, &numEvents));
+  assertUnsignedLongEquals(5ul, numEvents);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, events[0].timestamp);
+  assertIntEquals(MIDI_META_TYPE_TEMPO, events[1].status);
+  assertUnsignedLongEquals(sampleRate, events[1].timestamp);
+  assertIntEquals(0x90, events[2].status);
+  assertUnsignedLongEquals(sampleRate, events[2].timestamp);
+  assertIntEquals(0x80, events[3].status);
+  assertUnsignedLongEquals(sampleRate + sampleRate / 2,
+                           events[3].timestamp);
+  // Only the end of the last track is kept
+  assertIntEquals(MIDI_META_TYPE_TRACK_END, events[4].status);
+  assertUnsignedLongEquals(sampleRate + sampleRate / 2,
+                           events[4].timestamp);
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testSysexEventInFile(void) {
+  // A General MIDI reset, where the length does not count the leading 0xf0
+  const byte midiFileData[] = {
+      'M',  'T',  'h',  'd',  0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x01,
+      0x01, 0xe0, 'M',  'T',  'r',  'k',  0x00, 0x00, 0x00, 0x0c, 0x00, 0xf0,
+      0x05, 0x7e, 0x7f, 0x09, 0x01, 0xf7, 0x00, 0xff, 0x2f, 0x00};
+  const byte sysexData[] = {0xf0, 0x7e, 0x7f, 0x09, 0x01, 0xf7};
+  CharString c = newCharStringWithCString(TEST_MIDI_STREAM_FILENAME);
+  MidiSource m = newMidiSource(MIDI_SOURCE_TYPE_FILE, c);
+  MidiSequence s = newMidiSequence();
+  MidiEvent events;
+  unsigned long numEvents;
+
+  assert(_writeTestMidiFile(midiFileData, sizeof(midiFileData)));
+  assert(m->openMidiSource(m));
+  assert(m->readMidiEvents(m, s));
+  assertFalse(midiSequenceGetRange(s, 0, 1, &events, &numEvents));
+  assertUnsignedLongEquals(2ul, numEvents);
+  assertIntEquals(MIDI_TYPE_SYSEX, events[0].eventType);
+  assertSizeEquals(sizeof(sysexData), events[0].extraDataSize);
+  assertIntEquals(0, memcmp(sysexData, events[0].extraData,
+                            sizeof(sysexData)));
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+  freeCharString(c);
+  return 0;
+}
+
 TestSuite addMidiSourceTests(void);
 TestSuite addMidiSourceTests(void) {
-  TestSuite testSuite = newTestSuite("MidiSource", NULL, NULL);
+  TestSuite testSuite = newTestSuite("MidiSource", _midiSourceSetup, _midiSourceTeardown);
   addTest(testSuite, "GuessMidiSourceType", _testGuessMidiSourceType);
   addTest(testSuite, "GuessMidiSourceTypeInvalid",
           _testGuessMidiSourceTypeInvalid);
+  addTest(testSuite, "GuessMidiSourceTypeStdin", _testGuessMidiSourceTypeStdin);
   addTest(testSuite, "NewObject", _testNewMidiSource);
+  addTest(testSuite, "StreamEventsFromFile", _testStreamEventsFromFile);
+  addTest(testSuite, "TempoChangesInFile", _testTempoChangesInFile);
+  addTest(testSuite, "MergeTracksInFile", _testMergeTracksInFile);
+  addTest(testSuite, "SysexEventInFile", _testSysexEventInFile);
+  addTest(testSuite, "MapsMidiFile", _testMapsMidiFile);
+  addTest(testSuite, "TruncatedMidiFile", _testTruncatedMidiFile);
   return testSuite;
 }
@@ -0,0 +1,370 @@
+//
+// NoteRenderCacheTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "plugin/NoteRenderCache.h"
+
+#include "audio/AudioSettings.h"
+#include "unit/TestRunner.h"
+
+// Each test render is this much longer than its note, like a release tail
+static const unsigned long kTestNoteRenderTail = 4;
+
+static void _noteRenderCacheTestSetup(void) { initAudioSettings(); }
+
+static void _noteRenderCacheTestTeardown(void) { freeAudioSettings(); }
+
+static void _addEvent(MidiSequence midiSequence, unsigned long timestamp,
+                      byte status, byte data1, byte data2) {
+  MidiEvent midiEvent = midiSequenceNewMidiEvent(midiSequence);
+
+  midiEvent->eventType = MIDI_TYPE_REGULAR;
+  midiEvent->timestamp = timestamp;
+  midiEvent->status = status;
+  midiEvent->data1 = data1;
+  midiEvent->data2 = data2;
+  appendMidiEventToSequence(midiSequence, midiEvent);
+}
+
+static void _addNote(MidiSequence midiSequence, unsigned long timestamp,
+                     unsigned long length, byte note, byte velocity) {
+  _addEvent(midiSequence, timestamp, 0x90, note, velocity);
+  _addEvent(midiSequence, timestamp + length, 0x80, note, 0);
+}
+
+// Renders each note as a constant signal of its velocity, and counts the
+// number of renders in userData
+static SampleBuffer _renderTestNote(void *userData, const NoteRenderKey *key) {
+  SampleBuffer result = newSampleBuffer(
+      getNumChannels(), key->lengthInFrames + kTestNoteRenderTail);
+  ChannelCount channel;
+  SampleCount i;
+
+  for (channel = 0; channel < result->numChannels; channel++) {
+    for (i = 0; i < result->blocksize; i++) {
+      result->samples[channel][i] = (Sample)key->onVelocity;
+    }
+  }
+
+  (*(int *)userData)++;
+  return result;
+}
+
+static SampleBuffer _renderNothing(void *userData, const NoteRenderKey *key) {
+  return NULL;
+}
+
+static boolByte _fillNothing(void *userData, void *midiSequence,
+                             const unsigned long stopTimestamp) {
+  return false;
+}
+
+static int _testCanRenderNotes(void) {
+  NoteRenderCache c = newNoteRenderCache(1024 * 1024);
+  MidiSequence m = newMidiSequence();
+  MidiEvent meta = midiSequenceNewMidiEvent(m);
+
+  meta->eventType = MIDI_TYPE_META;
+  meta->status = MIDI_META_TYPE_TEMPO;
+  appendMidiEventToSequence(m, meta);
+  _addNote(m, 0, 100, 60, 100);
+  assert(noteRenderCacheCanRender(c, m));
+
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+static int _testCanRenderWithControlChange(void) {
+  NoteRenderCache c = newNoteRenderCache(1024 * 1024);
+  MidiSequence m = newMidiSequence();
+
+  _addNote(m, 0, 100, 60, 100);
+  _addEvent(m, 50, 0xb0, 64, 127);
+  assertFalse(noteRenderCacheCanRender(c, m));
+
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+static int _testCanRenderStreamedSequence(void) {
+  NoteRenderCache c = newNoteRenderCache(1024 * 1024);
+  MidiSequence m = newMidiSequence();
+
+  midiSequenceSetFillFunc(m, _fillNothing, NULL);
+  assertFalse(noteRenderCacheCanRender(c, m));
+
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+static int _testPlaceSequenceRendersUniqueNotesOnce(void) {
+  NoteRenderCache c = newNoteRenderCache(1024 * 1024);
+  MidiSequence m = newMidiSequence();
+  int numRenders = 0;
+
+  _addNote(m, 0, 100, 36, 100);
+  _addNote(m, 200, 100, 36, 100);
+  _addNote(m, 400, 100, 36, 90);
+  _addNote(m, 600, 50, 36, 100);
+  _addNote(m, 800, 100, 36, 100);
+  assert(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+  assertIntEquals(3, numRenders);
+  assertUnsignedLongEquals(2ul, c->numHits);
+  assertUnsignedLongEquals(3ul, c->numMisses);
+
+  // A second sequence with the same notes needs no more renders
+  assert(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+  assertIntEquals(3, numRenders);
+  assertUnsignedLongEquals(7ul, c->numHits);
+
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+static int _testPlaceSequenceRewindsSequence(void) {
+  NoteRenderCache c = newNoteRenderCache(1024 * 1024);
+  MidiSequence m = newMidiSequence();
+  MidiEvent events;
+  unsigned long numEvents;
+  int numRenders = 0;
+
+  _addNote(m, 0, 100, 60, 100);
+  assert(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+  assertIntEquals(0, m->numMidiEventsProcessed);
+  midiSequenceGetRange(m, 0, 10, &events, &numEvents);
+  assertUnsignedLongEquals(1ul, numEvents);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, events[0].timestamp);
+
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+static int _testPlaceSequenceWithOverlappingNote(void) {
+  NoteRenderCache c = newNoteRenderCache(1024 * 1024);
+  MidiSequence m = newMidiSequence();
+  int numRenders = 0;
+
+  _addNote(m, 0, 100, 60, 100);
+  _addNote(m, 50, 100, 60, 100);
+  assertFalse(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+  assertIntEquals(0, numRenders);
+
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+static int _testPlaceSequenceWithUnreleasedNote(void) {
+  NoteRenderCache c = newNoteRenderCache(1024 * 1024);
+  MidiSequence m = newMidiSequence();
+  int numRenders = 0;
+
+  _addEvent(m, 0, 0x90, 60, 100);
+  assertFalse(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+static int _testPlaceSequenceWithNoteOnVelocityZero(void) {
+  NoteRenderCache c = newNoteRenderCache(1024 * 1024);
+  MidiSequence m = newMidiSequence();
+  unsigned long start;
+  unsigned long end;
+  int numRenders = 0;
+
+  _addEvent(m, 10, 0x90, 60, 100);
+  _addEvent(m, 30, 0x90, 60, 0);
+  assert(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+  assert(noteRenderCacheGetFirstNote(c, &start, &end));
+  assertUnsignedLongEquals(10ul, start);
+  assertUnsignedLongEquals(30ul + kTestNoteRenderTail, end);
+
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+static int _testPlaceSequenceFromStartTimestamp(void) {
+  NoteRenderCache c = newNoteRenderCache(1024 * 1024);
+  MidiSequence m = newMidiSequence();
+  unsigned long start;
+  unsigned long end;
+  int numRenders = 0;
+
+  // The first note is released before the start, so it is never heard
+  _addNote(m, 0, 100, 60, 100);
+  _addNote(m, 1000, 100, 62, 100);
+  midiSequenceSetStartTimestamp(m, 500);
+  assert(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+  assertIntEquals(1, numRenders);
+  assert(noteRenderCacheGetFirstNote(c, &start, &end));
+  assertUnsignedLongEquals(500ul, start);
+
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+static int _testPlaceSequenceWhenFull(void) {
+  NoteRenderCache c = newNoteRenderCache(sizeof(Sample) * 2 * 110);
+  MidiSequence m = newMidiSequence();
+  int numRenders = 0;
+
+  setNumChannels(2);
+  _addNote(m, 0, 100, 60, 100);
+  _addNote(m, 200, 100, 62, 100);
+  assertFalse(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+  assertSizeEquals(sizeof(Sample) * 2 * 104, c->totalSize);
+
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+static int _testPlaceSequenceWhenRenderFails(void) {
+  NoteRenderCache c = newNoteRenderCache(1024 * 1024);
+  MidiSequence m = newMidiSequence();
+
+  _addNote(m, 0, 100, 60, 100);
+  assertFalse(noteRenderCachePlaceSequence(c, m, _renderNothing, NULL));
+
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+static int _testPlaceSequenceWhenDisabled(void) {
+  NoteRenderCache c = newNoteRenderCache(1024 * 1024);
+  MidiSequence m = newMidiSequence();
+  int numRenders = 0;
+
+  _addNote(m, 0, 100, 60, 100);
+  assert(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+  c->disabled = true;
+  assertFalse(noteRenderCacheCanRender(c, m));
+  assertFalse(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+
+  // Clearing the cache gives the instrument another chance
+  noteRenderCacheClear(c);
+  assertFalse(c->disabled);
+  assert(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+  assertIntEquals(2, numRenders);
+
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+static int _testRendersClearedWhenBlocksizeChanges(void) {
+  NoteRenderCache c = newNoteRenderCache(1024 * 1024);
+  MidiSequence m = newMidiSequence();
+  int numRenders = 0;
+
+  _addNote(m, 0, 100, 60, 100);
+  assert(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+  setBlocksize(getBlocksize() * 2);
+  assert(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+  assertIntEquals(2, numRenders);
+
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+static int _testMixOverlappingRenders(void) {
+  NoteRenderCache c = newNoteRenderCache(1024 * 1024);
+  MidiSequence m = newMidiSequence();
+  SampleBuffer outputs = newSampleBuffer(2, 16);
+  int numRenders = 0;
+
+  setNumChannels(2);
+  _addNote(m, 4, 10, 60, 1);
+  _addNote(m, 12, 20, 62, 2);
+  assert(noteRenderCachePlaceSequence(c, m, _renderTestNote, &numRenders));
+
+  // The first render covers frames 4 to 18, the second 12 to 36
+  noteRenderCacheMix(c, outputs, 0);
+  assertDoubleEquals(0.0, outputs->samples[0][3], TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(1.0, outputs->samples[0][4], TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(1.0, outputs->samples[1][11], TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(3.0, outputs->samples[1][12], TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(3.0, outputs->samples[0][15], TEST_EXACT_TOLERANCE);
+
+  noteRenderCacheMix(c, outputs, 16);
+  assertDoubleEquals(3.0, outputs->samples[0][1], TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(2.0, outputs->samples[0][2], TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(2.0, outputs->samples[1][15], TEST_EXACT_TOLERANCE);
+
+  noteRenderCacheMix(c, outputs, 32);
+  assertDoubleEquals(2.0, outputs->samples[0][3], TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(0.0, outputs->samples[0][4], TEST_EXACT_TOLERANCE);
+
+  noteRenderCacheMix(c, outputs, 48);
+  assertDoubleEquals(0.0, sampleBufferGetPeak(outputs), TEST_EXACT_TOLERANCE);
+
+  freeSampleBuffer(outputs);
+  freeMidiSequence(m);
+  freeNoteRenderCache(c);
+  return 0;
+}
+
+TestSuite addNoteRenderCacheTests(void);
+TestSuite addNoteRenderCacheTests(void) {
+  TestSuite testSuite = newTestSuite("NoteRenderCache",
+                                     _noteRenderCacheTestSetup,
+                                     _noteRenderCacheTestTeardown);
+  addTest(testSuite, "CanRenderNotes", _testCanRenderNotes);
+  addTest(testSuite, "CanRenderWithControlChange",
+          _testCanRenderWithControlChange);
+  addTest(testSuite, "CanRenderStreamedSequence",
+          _testCanRenderStreamedSequence);
+  addTest(testSuite, "PlaceSequenceRendersUniqueNotesOnce",
+          _testPlaceSequenceRendersUniqueNotesOnce);
+  addTest(testSuite, "PlaceSequenceRewindsSequence",
+          _testPlaceSequenceRewindsSequence);
+  addTest(testSuite, "PlaceSequenceWithOverlappingNote",
+          _testPlaceSequenceWithOverlappingNote);
+  addTest(testSuite, "PlaceSequenceWithUnreleasedNote",
+          _testPlaceSequenceWithUnreleasedNote);
+  addTest(testSuite, "PlaceSequenceWithNoteOnVelocityZero",
+          _testPlaceSequenceWithNoteOnVelocityZero);
+  addTest(testSuite, "PlaceSequenceFromStartTimestamp",
+          _testPlaceSequenceFromStartTimestamp);
+  addTest(testSuite, "PlaceSequenceWhenFull", _testPlaceSequenceWhenFull);
+  addTest(testSuite, "PlaceSequenceWhenRenderFails",
+          _testPlaceSequenceWhenRenderFails);
+  addTest(testSuite, "PlaceSequenceWhenDisabled",
+          _testPlaceSequenceWhenDisabled);
+  addTest(testSuite, "RendersClearedWhenBlocksizeChanges",
+          _testRendersClearedWhenBlocksizeChanges);
+  addTest(testSuite, "MixOverlappingRenders", _testMixOverlappingRenders);
+  return testSuite;
+}
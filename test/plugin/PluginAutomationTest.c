@@ -0,0 +1,136 @@
+//
+// PluginAutomationTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "plugin/PluginAutomation.h"
+
+#include "unit/TestRunner.h"
+
+static int _testNewPluginAutomation(void) {
+  PluginAutomation automation = newPluginAutomation();
+  assertNotNull(automation);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, automation->numPoints);
+  freePluginAutomation(automation);
+  return 0;
+}
+
+static int _testAddPointsInOrder(void) {
+  PluginAutomation automation = newPluginAutomation();
+
+  assert(pluginAutomationAddPoint(automation, 0.0, 1, 0.25f));
+  assert(pluginAutomationAddPoint(automation, 1.0, 2, 0.5f));
+  assertUnsignedLongEquals(2ul, automation->numPoints);
+  assertDoubleEquals(0.0, automation->points[0].time, TEST_DEFAULT_TOLERANCE);
+  assertIntEquals(1, automation->points[0].index);
+  assertDoubleEquals(0.25, automation->points[0].value,
+                     TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(1.0, automation->points[1].time, TEST_DEFAULT_TOLERANCE);
+  assertIntEquals(2, automation->points[1].index);
+
+  freePluginAutomation(automation);
+  return 0;
+}
+
+static int _testAddPointsOutOfOrder(void) {
+  PluginAutomation automation = newPluginAutomation();
+
+  assert(pluginAutomationAddPoint(automation, 2.0, 0, 0.0f));
+  assert(pluginAutomationAddPoint(automation, 1.0, 1, 0.0f));
+  assert(pluginAutomationAddPoint(automation, 1.0, 2, 0.0f));
+  assert(pluginAutomationAddPoint(automation, 0.5, 3, 0.0f));
+  assertUnsignedLongEquals(4ul, automation->numPoints);
+  // Points with the same time keep the order they were added in
+  assertIntEquals(3, automation->points[0].index);
+  assertIntEquals(1, automation->points[1].index);
+  assertIntEquals(2, automation->points[2].index);
+  assertIntEquals(0, automation->points[3].index);
+
+  freePluginAutomation(automation);
+  return 0;
+}
+
+static int _testAddManyPoints(void) {
+  PluginAutomation automation = newPluginAutomation();
+  unsigned int i;
+
+  for (i = 0; i < 1000; i++) {
+    assert(pluginAutomationAddPoint(automation, i * 0.001, i, 0.0f));
+  }
+
+  assertUnsignedLongEquals(1000ul, automation->numPoints);
+  assertIntEquals(999, automation->points[999].index);
+
+  freePluginAutomation(automation);
+  return 0;
+}
+
+static int _testAddPointWithNegativeTime(void) {
+  PluginAutomation automation = newPluginAutomation();
+  assertFalse(pluginAutomationAddPoint(automation, -1.0, 0, 0.0f));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, automation->numPoints);
+  freePluginAutomation(automation);
+  return 0;
+}
+
+static int _testReadInvalidFile(void) {
+  PluginAutomation automation = newPluginAutomation();
+  CharString filename = newCharStringWithCString("invalid");
+  assertFalse(pluginAutomationReadFile(automation, filename));
+  freeCharString(filename);
+  freePluginAutomation(automation);
+  return 0;
+}
+
+static int _testGetPointFrame(void) {
+  PluginAutomationPoint point;
+  point.time = 0.5;
+  point.index = 0;
+  point.value = 0.0f;
+  assertUnsignedLongEquals(22050ul,
+                           pluginAutomationPointGetFrame(&point, 44100.0));
+  return 0;
+}
+
+static int _testFreeNullPluginAutomation(void) {
+  freePluginAutomation(NULL);
+  return 0;
+}
+
+TestSuite addPluginAutomationTests(void);
+TestSuite addPluginAutomationTests(void) {
+  TestSuite testSuite = newTestSuite("PluginAutomation", NULL, NULL);
+  addTest(testSuite, "NewPluginAutomation", _testNewPluginAutomation);
+  addTest(testSuite, "AddPointsInOrder", _testAddPointsInOrder);
+  addTest(testSuite, "AddPointsOutOfOrder", _testAddPointsOutOfOrder);
+  addTest(testSuite, "AddManyPoints", _testAddManyPoints);
+  addTest(testSuite, "AddPointWithNegativeTime",
+          _testAddPointWithNegativeTime);
+  addTest(testSuite, "ReadInvalidFile", _testReadInvalidFile);
+  addTest(testSuite, "GetPointFrame", _testGetPointFrame);
+  addTest(testSuite, "FreeNullPluginAutomation",
+          _testFreeNullPluginAutomation);
+  return testSuite;
+}
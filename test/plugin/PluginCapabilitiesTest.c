@@ -0,0 +1,153 @@
+//
+// PluginCapabilitiesTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "plugin/PluginCapabilities.h"
+
+#include "unit/TestRunner.h"
+
+static int _testNewPluginCapabilities(void) {
+  PluginCapabilities c = newPluginCapabilities();
+  int i;
+
+  for (i = 0; i < NUM_PLUGIN_CAPABILITIES; i++) {
+    assertIntEquals(PLUGIN_CAPABILITY_UNKNOWN, c->states[i]);
+  }
+  assert(pluginCapabilitiesIsEmpty(c));
+
+  freePluginCapabilities(c);
+  return 0;
+}
+
+static int _testCapabilityNames(void) {
+  int i;
+
+  for (i = 0; i < NUM_PLUGIN_CAPABILITIES; i++) {
+    assertIntEquals(i, pluginCapabilityWithName(
+                           pluginCapabilityGetName((PluginCapability)i)));
+  }
+  assertIntEquals(NUM_PLUGIN_CAPABILITIES, pluginCapabilityWithName("invalid"));
+  assertIntEquals(PLUGIN_CAPABILITY_SUPPORTED,
+                  pluginCapabilityStateWithName("yes"));
+  assertIntEquals(PLUGIN_CAPABILITY_UNSUPPORTED,
+                  pluginCapabilityStateWithName("no"));
+  assertIntEquals(PLUGIN_CAPABILITY_UNKNOWN,
+                  pluginCapabilityStateWithName("auto"));
+  assertIntEquals(NUM_PLUGIN_CAPABILITY_STATES,
+                  pluginCapabilityStateWithName("maybe"));
+
+  return 0;
+}
+
+static int _testParseCapabilities(void) {
+  PluginCapabilities c = newPluginCapabilities();
+
+  assert(pluginCapabilitiesParse(c, "parallel-load=yes,offline=no"));
+  assertIntEquals(PLUGIN_CAPABILITY_SUPPORTED,
+                  c->states[PLUGIN_CAPABILITY_PARALLEL_LOAD]);
+  assertIntEquals(PLUGIN_CAPABILITY_UNSUPPORTED,
+                  c->states[PLUGIN_CAPABILITY_OFFLINE]);
+  assertIntEquals(PLUGIN_CAPABILITY_UNKNOWN,
+                  c->states[PLUGIN_CAPABILITY_FORK_SAFE]);
+  assertFalse(pluginCapabilitiesIsEmpty(c));
+
+  freePluginCapabilities(c);
+  return 0;
+}
+
+static int _testParseInvalidCapabilities(void) {
+  PluginCapabilities c = newPluginCapabilities();
+
+  assertFalse(pluginCapabilitiesParse(c, "offline=no,bogus=yes"));
+  assertFalse(pluginCapabilitiesParse(c, "fork-safe=maybe"));
+  assertFalse(pluginCapabilitiesParse(c, "deterministic"));
+  // Nothing is changed by a list which is partly invalid
+  assert(pluginCapabilitiesIsEmpty(c));
+
+  freePluginCapabilities(c);
+  return 0;
+}
+
+static int _testCapabilitiesToString(void) {
+  PluginCapabilities c = newPluginCapabilities();
+  PluginCapabilities copy = newPluginCapabilities();
+  CharString s = pluginCapabilitiesToString(c);
+
+  assertCharStringEquals("", s);
+  freeCharString(s);
+
+  c->states[PLUGIN_CAPABILITY_MULTI_INSTANCE] = PLUGIN_CAPABILITY_UNSUPPORTED;
+  c->states[PLUGIN_CAPABILITY_DETERMINISTIC] = PLUGIN_CAPABILITY_SUPPORTED;
+  s = pluginCapabilitiesToString(c);
+  assertCharStringEquals("multi-instance=no,deterministic=yes", s);
+
+  // The string can be read back in
+  assert(pluginCapabilitiesParse(copy, s->data));
+  assertIntEquals(PLUGIN_CAPABILITY_UNSUPPORTED,
+                  copy->states[PLUGIN_CAPABILITY_MULTI_INSTANCE]);
+  assertIntEquals(PLUGIN_CAPABILITY_SUPPORTED,
+                  copy->states[PLUGIN_CAPABILITY_DETERMINISTIC]);
+
+  freeCharString(s);
+  freePluginCapabilities(copy);
+  freePluginCapabilities(c);
+  return 0;
+}
+
+static int _testCopyCapabilities(void) {
+  PluginCapabilities c = newPluginCapabilities();
+  PluginCapabilities copy = newPluginCapabilities();
+
+  c->states[PLUGIN_CAPABILITY_OFFLINE] = PLUGIN_CAPABILITY_SUPPORTED;
+  copy->states[PLUGIN_CAPABILITY_FORK_SAFE] = PLUGIN_CAPABILITY_SUPPORTED;
+  pluginCapabilitiesCopy(copy, c);
+  assertIntEquals(PLUGIN_CAPABILITY_SUPPORTED,
+                  copy->states[PLUGIN_CAPABILITY_OFFLINE]);
+  assertIntEquals(PLUGIN_CAPABILITY_UNKNOWN,
+                  copy->states[PLUGIN_CAPABILITY_FORK_SAFE]);
+
+  freePluginCapabilities(copy);
+  freePluginCapabilities(c);
+  return 0;
+}
+
+static int _testFreeNullPluginCapabilities(void) {
+  freePluginCapabilities(NULL);
+  return 0;
+}
+
+TestSuite addPluginCapabilitiesTests(void);
+TestSuite addPluginCapabilitiesTests(void) {
+  TestSuite testSuite = newTestSuite("PluginCapabilities", NULL, NULL);
+  addTest(testSuite, "NewPluginCapabilities", _testNewPluginCapabilities);
+  addTest(testSuite, "CapabilityNames", _testCapabilityNames);
+  addTest(testSuite, "ParseCapabilities", _testParseCapabilities);
+  addTest(testSuite, "ParseInvalidCapabilities",
+          _testParseInvalidCapabilities);
+  addTest(testSuite, "CapabilitiesToString", _testCapabilitiesToString);
+  addTest(testSuite, "CopyCapabilities", _testCopyCapabilities);
+  addTest(testSuite, "FreeNullPluginCapabilities",
+          _testFreeNullPluginCapabilities);
+  return testSuite;
+}
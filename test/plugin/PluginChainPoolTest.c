@@ -0,0 +1,144 @@
+//
+// PluginChainPoolTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "plugin/PluginChainPool.h"
+
+#include "unit/TestRunner.h"
+
+#include "PluginMock.h"
+
+static PluginChain _newTestPluginChain(void) {
+  PluginChain pluginChain = newPluginChain();
+  pluginChainAppend(pluginChain, newPluginMock(), NULL);
+  pluginChainInitialize(pluginChain);
+  return pluginChain;
+}
+
+static void _addTestPluginChain(PluginChainPool pool, const char *signature,
+                                PluginChain pluginChain) {
+  CharString signatureString = newCharStringWithCString(signature);
+  pluginChainPoolAdd(pool, signatureString, pluginChain);
+  freeCharString(signatureString);
+}
+
+static PluginChain _getTestPluginChain(PluginChainPool pool,
+                                       const char *signature) {
+  CharString signatureString = newCharStringWithCString(signature);
+  PluginChain result = pluginChainPoolGet(pool, signatureString);
+  freeCharString(signatureString);
+  return result;
+}
+
+static int _testNewPluginChainPool(void) {
+  PluginChainPool pool = newPluginChainPool(2);
+  assertNotNull(pool);
+  assertIntEquals(0, pool->numEntries);
+  assertIntEquals(2, pool->maxEntries);
+  freePluginChainPool(pool);
+  return 0;
+}
+
+static int _testNewPluginChainPoolWithZeroEntries(void) {
+  PluginChainPool pool = newPluginChainPool(0);
+  assertIntEquals(1, pool->maxEntries);
+  freePluginChainPool(pool);
+  return 0;
+}
+
+static int _testNewPluginChainIsIndependent(void) {
+  PluginChain pluginChain = newPluginChain();
+  assertNotNull(pluginChain);
+  assert(pluginChain != getPluginChain());
+  assertIntEquals(0, pluginChain->numPlugins);
+  freePluginChain(pluginChain);
+  return 0;
+}
+
+static int _testGetMissingPluginChain(void) {
+  PluginChainPool pool = newPluginChainPool(2);
+  assertIsNull(_getTestPluginChain(pool, "mrs_gain"));
+  freePluginChainPool(pool);
+  return 0;
+}
+
+static int _testAddAndGetPluginChain(void) {
+  PluginChainPool pool = newPluginChainPool(2);
+  PluginChain gain = _newTestPluginChain();
+  PluginChain limiter = _newTestPluginChain();
+
+  _addTestPluginChain(pool, "mrs_gain", gain);
+  _addTestPluginChain(pool, "mrs_limiter", limiter);
+  assertIntEquals(2, pool->numEntries);
+  assert(_getTestPluginChain(pool, "mrs_gain") == gain);
+  assert(_getTestPluginChain(pool, "mrs_limiter") == limiter);
+  // Signatures are case-sensitive, since file paths may be
+  assertIsNull(_getTestPluginChain(pool, "MRS_GAIN"));
+
+  freePluginChainPool(pool);
+  return 0;
+}
+
+static int _testEvictLeastRecentlyUsed(void) {
+  PluginChainPool pool = newPluginChainPool(2);
+  PluginChain first = _newTestPluginChain();
+  PluginChain second = _newTestPluginChain();
+  PluginChain third = _newTestPluginChain();
+
+  _addTestPluginChain(pool, "first", first);
+  _addTestPluginChain(pool, "second", second);
+  // Using the first chain again makes the second one the oldest
+  assert(_getTestPluginChain(pool, "first") == first);
+  _addTestPluginChain(pool, "third", third);
+
+  assertIntEquals(2, pool->numEntries);
+  assert(_getTestPluginChain(pool, "first") == first);
+  assertIsNull(_getTestPluginChain(pool, "second"));
+  assert(_getTestPluginChain(pool, "third") == third);
+
+  freePluginChainPool(pool);
+  return 0;
+}
+
+static int _testFreeNullPluginChainPool(void) {
+  freePluginChainPool(NULL);
+  return 0;
+}
+
+TestSuite addPluginChainPoolTests(void);
+TestSuite addPluginChainPoolTests(void) {
+  TestSuite testSuite = newTestSuite("PluginChainPool", NULL, NULL);
+  addTest(testSuite, "NewPluginChainPool", _testNewPluginChainPool);
+  addTest(testSuite, "NewPluginChainPoolWithZeroEntries",
+          _testNewPluginChainPoolWithZeroEntries);
+  addTest(testSuite, "NewPluginChainIsIndependent",
+          _testNewPluginChainIsIndependent);
+  addTest(testSuite, "GetMissingPluginChain", _testGetMissingPluginChain);
+  addTest(testSuite, "AddAndGetPluginChain", _testAddAndGetPluginChain);
+  addTest(testSuite, "EvictLeastRecentlyUsed", _testEvictLeastRecentlyUsed);
+  addTest(testSuite, "FreeNullPluginChainPool",
+          _testFreeNullPluginChainPool);
+  return testSuite;
+}
@@ -27,8 +27,11 @@
 #include "plugin/PluginChain.h"
 
 #include "audio/AudioSettings.h"
+#include "base/FpuState.h"
 #include "midi/MidiEvent.h"
+#include "plugin/PluginGain.h"
 #include "plugin/PluginPassthru.h"
+#include "plugin/PluginSine.h"
 #include "unit/TestRunner.h"
 
 #include "PluginMock.h"
@@ -131,6 +134,96 @@ static int _testAddFromArgumentStringMultiple(void) {
   return 0;
 }
 
+static int _testAddFromArgumentStringWithBlocksize(void) {
+  PluginChain p = getPluginChain();
+  CharString testArgs = newCharStringWithCString(kInternalPluginPassthruName);
+
+  charStringAppendCString(testArgs, "@1024");
+  assert(pluginChainAddFromArgumentString(p, testArgs, NULL));
+  assertIntEquals(1, p->numPlugins);
+  assertCharStringEquals(kInternalPluginPassthruName,
+                         p->plugins[0]->pluginName);
+  assertUnsignedLongEquals(1024ul, p->_pluginBlocksizes[0]);
+
+  freeCharString(testArgs);
+  return 0;
+}
+
+static int _testAddFromArgumentStringWithInvalidBlocksize(void) {
+  PluginChain p = getPluginChain();
+  CharString testArgs = newCharStringWithCString(kInternalPluginPassthruName);
+
+  charStringAppendCString(testArgs, "@big");
+  assertFalse(pluginChainAddFromArgumentString(p, testArgs, NULL));
+  assertIntEquals(0, p->numPlugins);
+
+  freeCharString(testArgs);
+  return 0;
+}
+
+static int _testAddFromArgumentStringWithSplit(void) {
+  PluginChain p = getPluginChain();
+  CharString testArgs = newCharStringWithCString(
+      "mrs_passthru;[mrs_passthru|mrs_passthru;mrs_passthru];mrs_passthru");
+
+  assert(pluginChainAddFromArgumentString(p, testArgs, NULL));
+  assertIntEquals(5, p->numPlugins);
+  assertIntEquals(1, p->_numSplits);
+  assertIntEquals(1, p->_splits[0].firstPlugin);
+  assertIntEquals(3, p->_splits[0].numPlugins);
+  assertIntEquals(2, p->_splits[0].numBranches);
+  assertIntEquals(1, p->_splits[0].branches[0].numPlugins);
+  assertIntEquals(2, p->_splits[0].branches[1].firstPlugin);
+  assertIntEquals(2, p->_splits[0].branches[1].numPlugins);
+
+  freeCharString(testArgs);
+  return 0;
+}
+
+static int _testAddFromArgumentStringWithInvalidSplit(void) {
+  PluginChain p = getPluginChain();
+  CharString testArgs = newCharStringWithCString("[mrs_passthru|mrs_passthru");
+
+  assertFalse(pluginChainAddFromArgumentString(p, testArgs, NULL));
+  charStringCopyCString(testArgs, "[mrs_passthru|]");
+  assertFalse(pluginChainAddFromArgumentString(p, testArgs, NULL));
+
+  freeCharString(testArgs);
+  return 0;
+}
+
+static int _testAddFromArgumentStringOpensPlugins(void) {
+  PluginChain p = getPluginChain();
+  CharString testArgs =
+      newCharStringWithCString("mrs_passthru;[mrs_passthru|mrs_passthru]");
+  unsigned int i;
+
+  pluginChainSetParallelLoading(p, true);
+  assert(pluginChainAddFromArgumentString(p, testArgs, NULL));
+  assertIntEquals(3, p->numPlugins);
+
+  for (i = 0; i < p->numPlugins; i++) {
+    assert(p->plugins[i]->isOpen);
+  }
+
+  freeCharString(testArgs);
+  return 0;
+}
+
+static int _testAddFromArgumentStringWithInvalidSplitOpensNothing(void) {
+  PluginChain p = getPluginChain();
+  CharString testArgs =
+      newCharStringWithCString("mrs_passthru;[mrs_passthru|]");
+
+  assertFalse(pluginChainAddFromArgumentString(p, testArgs, NULL));
+  assertIntEquals(2, p->numPlugins);
+  assertFalse(p->plugins[0]->isOpen);
+  assertFalse(p->plugins[1]->isOpen);
+
+  freeCharString(testArgs);
+  return 0;
+}
+
 static int _testAddPluginWithPresetFromArgumentString(void) {
   PluginChain p = getPluginChain();
   CharString testArgs = newCharStringWithCString("mrs_passthru,testPreset.fxp");
@@ -171,6 +264,20 @@ static int _testAppendPlugin(void) {
   return 0;
 }
 
+static int _testAppendManyPlugins(void) {
+  PluginChain p = getPluginChain();
+  unsigned int i;
+
+  for (i = 0; i < 20; i++) {
+    assert(pluginChainAppend(p, newPluginMock(), NULL));
+  }
+
+  assertIntEquals(20, p->numPlugins);
+  assertNotNull(p->plugins[19]);
+  assertNotNull(p->audioTimers[19]);
+  return 0;
+}
+
 static int _testAppendWithNullPlugin(void) {
   PluginChain p = getPluginChain();
   assertFalse(pluginChainAppend(p, NULL, NULL));
@@ -199,6 +306,23 @@ static int _testInitializePluginChain(void) {
   return 0;
 }
 
+static int _testInitializePluginChainWithParallelLoading(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+  PluginPreset mockPreset = newPluginPresetMock();
+
+  // Only VST plugins are loaded on their own thread
+  mock->interfaceType = PLUGIN_TYPE_VST_2X;
+  pluginPresetSetCompatibleWith(mockPreset, PLUGIN_TYPE_VST_2X);
+  pluginChainSetParallelLoading(p, true);
+  assert(pluginChainAppend(p, mock, mockPreset));
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  assert(((PluginMockData)mock->extraData)->isOpen);
+  assert(((PluginPresetMockData)mockPreset->extraData)->isLoaded);
+
+  return 0;
+}
+
 static int _testGetMaximumTailTime(void) {
   Plugin mock = newPluginMock();
   PluginChain p = getPluginChain();
@@ -223,6 +347,109 @@ static int _testPrepareForProcessing(void) {
   return 0;
 }
 
+static int _testResetPluginChain(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+
+  assert(pluginChainAppend(p, mock, NULL));
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  pluginChainPrepareForProcessing(p);
+  ((PluginMockData)mock->extraData)->isPrepared = false;
+  pluginChainReset(p);
+  assert(((PluginMockData)mock->extraData)->isPrepared);
+  assertNotNull(mock->inputBuffer);
+  assertNotNull(mock->outputBuffer);
+
+  return 0;
+}
+
+static int _testResetPluginChainKeepsBuffers(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+  SampleBuffer inputBuffer;
+
+  assert(pluginChainAppend(p, mock, NULL));
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  pluginChainPrepareForProcessing(p);
+  inputBuffer = mock->inputBuffer;
+  inputBuffer->samples[0][0] = 1.0f;
+
+  pluginChainReset(p);
+  assert(mock->inputBuffer == inputBuffer);
+  assertDoubleEquals(0.0, mock->inputBuffer->samples[0][0],
+                     TEST_EXACT_TOLERANCE);
+
+  return 0;
+}
+
+static int _testResetPluginChainWithNewBlocksize(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+
+  assert(pluginChainAppend(p, mock, NULL));
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  pluginChainPrepareForProcessing(p);
+  assertUnsignedLongEquals(DEFAULT_BLOCKSIZE, mock->inputBuffer->blocksize);
+
+  setBlocksize(DEFAULT_BLOCKSIZE * 2);
+  pluginChainReset(p);
+  assertUnsignedLongEquals(DEFAULT_BLOCKSIZE * 2, mock->inputBuffer->blocksize);
+  assertUnsignedLongEquals(DEFAULT_BLOCKSIZE * 2,
+                           mock->outputBuffer->blocksize);
+  setBlocksize(DEFAULT_BLOCKSIZE);
+
+  return 0;
+}
+
+static int _testGetLinearGain(void) {
+  PluginChain p = getPluginChain();
+  CharString passthruName =
+      newCharStringWithCString(kInternalPluginPassthruName);
+  CharString gainName = newCharStringWithCString(kInternalPluginGainName);
+  Sample gain = 0.0f;
+
+  assert(pluginChainAddFromArgumentString(p, passthruName, NULL));
+  assert(pluginChainAddFromArgumentString(p, gainName, NULL));
+  assert(pluginChainAddFromArgumentString(p, gainName, NULL));
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  p->plugins[1]->setParameter(p->plugins[1], 0, 0.5f);
+
+  // The second gain plugin is left at unity
+  assert(pluginChainGetLinearGain(p, &gain));
+  assertDoubleEquals(0.5, gain, TEST_DEFAULT_TOLERANCE);
+
+  freeCharString(passthruName);
+  freeCharString(gainName);
+  return 0;
+}
+
+static int _testGetLinearGainWithSeveralGains(void) {
+  PluginChain p = getPluginChain();
+  CharString gainName = newCharStringWithCString(kInternalPluginGainName);
+  Sample gain = 0.0f;
+
+  assert(pluginChainAddFromArgumentString(p, gainName, NULL));
+  assert(pluginChainAddFromArgumentString(p, gainName, NULL));
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  p->plugins[0]->setParameter(p->plugins[0], 0, 0.5f);
+  p->plugins[1]->setParameter(p->plugins[1], 0, 0.3f);
+
+  // Each plugin rounds its own result, which a single gain would not
+  assertFalse(pluginChainGetLinearGain(p, &gain));
+
+  freeCharString(gainName);
+  return 0;
+}
+
+static int _testGetLinearGainWithOtherPlugin(void) {
+  PluginChain p = getPluginChain();
+  Sample gain = 0.0f;
+
+  assert(pluginChainAppend(p, newPluginMock(), NULL));
+  assertFalse(pluginChainGetLinearGain(p, &gain));
+  return 0;
+}
+
 static int _testProcessPluginChainAudio(void) {
   Plugin mock = newPluginMock();
   PluginChain p = getPluginChain();
@@ -240,6 +467,163 @@ static int _testProcessPluginChainAudio(void) {
   return 0;
 }
 
+static int _testResetPluginChainTimers(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+
+  assert(pluginChainAppend(p, mock, NULL));
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertUnsignedLongEquals(2ul, p->audioTimers[0]->numTasks);
+
+  pluginChainResetTimers(p);
+  assertUnsignedLongEquals(0ul, p->audioTimers[0]->numTasks);
+  assertUnsignedLongEquals(0ul, p->audioLatencies[0]->numValues);
+  assertUnsignedLongEquals(0ul, p->chainLatency->numValues);
+
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static void _processAudioWithHostCallback(void *pluginPtr, SampleBuffer inputs,
+                                          SampleBuffer outputs) {
+  uint64_t enterTime = pluginChainEnterHostCallback();
+  // Nested callbacks are only counted once
+  uint64_t nestedEnterTime = pluginChainEnterHostCallback();
+  taskTimerSleep(2.0);
+  pluginChainExitHostCallback(nestedEnterTime);
+  pluginChainExitHostCallback(enterTime);
+  sampleBufferCopyAndMapChannels(outputs, inputs);
+}
+
+static int _testProcessPluginChainAudioCountsHostCallbacks(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+
+  mock->processAudio = _processAudioWithHostCallback;
+  assert(pluginChainAppend(p, mock, NULL));
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+
+  assert(p->hostCallbackTimes[0] >= 1.5);
+  assert(p->hostCallbackTimes[0] <= p->audioTimers[0]->totalTaskTime);
+  // The plugin was sleeping, which uses hardly any CPU time
+  assert(p->audioTimers[0]->totalCpuTime < p->audioTimers[0]->totalTaskTime);
+
+  pluginChainResetTimers(p);
+  assertDoubleEquals(0.0, p->hostCallbackTimes[0], TEST_EXACT_TOLERANCE);
+
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testGetLastOutputs(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+  SampleBuffer inBuffer = newSampleBuffer(1, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer = newSampleBuffer(1, DEFAULT_BLOCKSIZE);
+
+  assert(pluginChainAppend(p, mock, NULL));
+  assertIsNull(pluginChainGetLastOutputs(p));
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+
+  // The mock has more outputs than the output has channels
+  assertNotNull(pluginChainGetLastOutputs(p));
+  assertIntEquals(2, pluginChainGetLastOutputs(p)->numChannels);
+  assert(pluginChainGetLastOutputs(p) != outBuffer);
+
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testProcessPluginChainAudioCountsPerfCounters(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+
+  assert(pluginChainAppend(p, mock, NULL));
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertFalse(p->perfCounters[0]->enabled);
+  assertUnsignedLongEquals(0ul, p->perfCounters[0]->numTasks);
+
+  // Counters are also enabled for plugins which are already in the chain
+  pluginChainSetMeasurePerfCounters(p, true);
+  assert(p->perfCounters[0]->enabled);
+
+  if (perfCountersIsAvailable()) {
+    pluginChainProcessAudio(p, inBuffer, outBuffer);
+    assertUnsignedLongEquals(1ul, p->perfCounters[0]->numTasks);
+    assert(p->perfCounters[0]->counts[PERF_COUNTER_CYCLES] > 0);
+
+    pluginChainResetTimers(p);
+    assertUnsignedLongEquals(0ul, p->perfCounters[0]->numTasks);
+  }
+
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+// Some platforms can't flush denormals, in which case they are never flushed
+static boolByte _canFlushDenormals(void) {
+  const FpuState previous = fpuStateFlushDenormals();
+  const boolByte result = fpuStateIsFlushingDenormals();
+  fpuStateRestore(previous);
+  return result;
+}
+
+static int _testProcessPluginChainAudioFlushesDenormals(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+
+  assert(pluginChainAppend(p, mock, NULL));
+  assertFalse(fpuStateIsFlushingDenormals());
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertIntEquals(_canFlushDenormals(),
+                  ((PluginMockData)mock->extraData)->flushedDenormals);
+  // The caller's state must be restored afterwards
+  assertFalse(fpuStateIsFlushingDenormals());
+
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testProcessPluginChainAudioKeepsDenormals(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+
+  assert(pluginChainAppend(p, mock, NULL));
+  pluginChainSetFlushDenormals(p, false);
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertFalse(((PluginMockData)mock->extraData)->flushedDenormals);
+
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
 static int _testProcessPluginChainAudioRealtime(void) {
   Plugin mock = newPluginMock();
   PluginChain p = getPluginChain();
@@ -263,42 +647,887 @@ static int _testProcessPluginChainAudioRealtime(void) {
   return 0;
 }
 
-static int _testProcessPluginChainMidiEvents(void) {
-  Plugin mock = newPluginMock();
+static int _testProcessPluginChainAudioWithoutCopies(void) {
   PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(kInternalPluginPassthruName);
   SampleBuffer inBuffer =
       newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
   SampleBuffer outBuffer =
       newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
-  LinkedList list = newLinkedList();
-  MidiEvent midi = newMidiEvent();
 
-  linkedListAppend(list, midi);
-  assert(pluginChainAppend(p, mock, NULL));
-  pluginChainProcessMidi(p, list);
-  assert(((PluginMockData)mock->extraData)->processMidiCalled);
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  inBuffer->samples[0][0] = 0.5f;
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertDoubleEquals(0.5, outBuffer->samples[0][0], TEST_DEFAULT_TOLERANCE);
+  // The channel counts match, so the plugins' own input buffers are not used
+  assertDoubleEquals(0.0, p->plugins[0]->inputBuffer->samples[0][0],
+                     TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.0, p->plugins[1]->inputBuffer->samples[0][0],
+                     TEST_DEFAULT_TOLERANCE);
 
-  freeMidiEvent(midi);
-  freeLinkedList(list);
+  freeCharString(name);
   freeSampleBuffer(inBuffer);
   freeSampleBuffer(outBuffer);
   return 0;
 }
 
-static int _testShutdown(void) {
-  Plugin mock = newPluginMock();
+static int _testProcessPluginChainAudioMappedWithoutCopies(void) {
   PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(kInternalPluginPassthruName);
+  SampleBuffer inBuffer = newSampleBuffer(1, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
 
-  assert(pluginChainAppend(p, mock, NULL));
-  pluginChainShutdown(p);
-  assertFalse(((PluginMockData)mock->extraData)->isOpen);
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  inBuffer->samples[0][0] = 0.5f;
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  // The mono input is mapped to both channels of the plugin
+  assertDoubleEquals(0.5, outBuffer->samples[0][0], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.5, outBuffer->samples[1][0], TEST_DEFAULT_TOLERANCE);
+  // But this is done without copying to the plugin's own input buffer
+  assertDoubleEquals(0.0, p->plugins[0]->inputBuffer->samples[0][0],
+                     TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.0, p->plugins[0]->inputBuffer->samples[1][0],
+                     TEST_DEFAULT_TOLERANCE);
 
+  freeCharString(name);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
   return 0;
 }
 
-TestSuite addPluginChainTests(void);
-TestSuite addPluginChainTests(void) {
-  TestSuite testSuite = newTestSuite("PluginChain", _pluginChainTestSetup,
+static void _fillSampleBuffer(SampleBuffer buffer, Sample value) {
+  ChannelCount i;
+  SampleCount j;
+
+  for (i = 0; i < buffer->numChannels; i++) {
+    for (j = 0; j < buffer->blocksize; j++) {
+      buffer->samples[i][j] = value;
+    }
+  }
+}
+
+static int _testProcessPluginChainAudioWithAutomation(void) {
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(kInternalPluginGainName);
+  PluginAutomation automation = newPluginAutomation();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+
+  assert(pluginAutomationAddPoint(automation, 100.0 / getSampleRate(), 0,
+                                  0.5f));
+  assert(pluginAutomationAddPoint(automation, 300.0 / getSampleRate(), 0,
+                                  0.25f));
+  assert(pluginAutomationAddPoint(
+      automation, (DEFAULT_BLOCKSIZE + 200.0) / getSampleRate(), 0, 0.0f));
+  assert(pluginChainAppend(p, newPluginGain(name), NULL));
+  pluginChainSetAutomation(p, automation);
+  pluginChainPrepareForProcessing(p);
+  _fillSampleBuffer(inBuffer, 1.0f);
+
+  // The changes must take effect on the exact frame, even within a block
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertUnsignedLongEquals(DEFAULT_BLOCKSIZE, outBuffer->blocksize);
+  assertDoubleEquals(1.0, outBuffer->samples[0][99], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.5, outBuffer->samples[0][100], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.5, outBuffer->samples[1][299], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.25, outBuffer->samples[1][300], TEST_DEFAULT_TOLERANCE);
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertDoubleEquals(0.25, outBuffer->samples[0][199], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.0, outBuffer->samples[0][200], TEST_DEFAULT_TOLERANCE);
+
+  // After a reset, the automation starts over from the first point
+  pluginChainReset(p);
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertDoubleEquals(0.0, outBuffer->samples[0][99], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.5, outBuffer->samples[0][100], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.25, outBuffer->samples[0][300], TEST_DEFAULT_TOLERANCE);
+
+  freeCharString(name);
+  freePluginAutomation(automation);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testProcessPluginChainAudioWithAutomationAndMidi(void) {
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(kInternalPluginGainName);
+  PluginAutomation automation = newPluginAutomation();
+  LinkedList midiEvents = newLinkedList();
+  MidiEvent midiEvent = newMidiEvent();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+
+  assert(pluginAutomationAddPoint(automation, 100.0 / getSampleRate(), 0,
+                                  0.5f));
+  assert(pluginChainAppend(p, newPluginGain(name), NULL));
+  pluginChainSetAutomation(p, automation);
+  pluginChainPrepareForProcessing(p);
+  _fillSampleBuffer(inBuffer, 1.0f);
+  linkedListAppend(midiEvents, midiEvent);
+
+  // MIDI in the same block must not make the changes less accurate
+  pluginChainProcessMidi(p, midiEvents);
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertDoubleEquals(1.0, outBuffer->samples[0][99], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.5, outBuffer->samples[0][100], TEST_DEFAULT_TOLERANCE);
+
+  freeCharString(name);
+  freePluginAutomation(automation);
+  freeLinkedListAndItems(midiEvents, (LinkedListFreeItemFunc)freeMidiEvent);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testProcessPluginChainAudioWithControl(void) {
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(kInternalPluginGainName);
+  PluginControl control = newPluginControl(4);
+  PluginPreset preset = newPluginPresetMock();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+
+  assert(pluginChainAppend(p, newPluginGain(name), NULL));
+  pluginChainSetControl(p, control);
+  pluginChainPrepareForProcessing(p);
+  _fillSampleBuffer(inBuffer, 1.0f);
+
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertDoubleEquals(1.0, outBuffer->samples[0][0], TEST_DEFAULT_TOLERANCE);
+
+  // Queued changes take effect from the start of the next block
+  assert(pluginControlSetParameter(control, 0, 0, 0.5f));
+  assert(pluginControlLoadPreset(control, 0, preset));
+  assert(pluginControlSetParameter(control, 1, 0, 0.5f));
+  assertDoubleEquals(1.0, outBuffer->samples[0][0], TEST_DEFAULT_TOLERANCE);
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertDoubleEquals(0.5, outBuffer->samples[0][0], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.5, outBuffer->samples[1][DEFAULT_BLOCKSIZE - 1],
+                     TEST_DEFAULT_TOLERANCE);
+  assert(((PluginPresetMockData)preset->extraData)->isLoaded);
+  // There is no second plugin in the chain
+  assertUnsignedLongEquals(2ul, (unsigned long)control->numApplied);
+  assertUnsignedLongEquals(1ul, (unsigned long)control->numFailed);
+
+  pluginChainSetControl(p, NULL);
+  freePluginControl(control);
+  freeCharString(name);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testProcessPluginChainMidiWithAutomation(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+  PluginAutomation automation = newPluginAutomation();
+  LinkedList midiEvents = newLinkedList();
+  MidiEvent midiEvent = newMidiEvent();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+
+  assert(pluginAutomationAddPoint(automation, 256.0 / getSampleRate(), 0,
+                                  0.5f));
+  assert(pluginChainAppend(p, mock, NULL));
+  pluginChainSetAutomation(p, automation);
+  pluginChainPrepareForProcessing(p);
+  midiEvent->eventType = MIDI_TYPE_REGULAR;
+  midiEvent->deltaFrames = 300;
+  linkedListAppend(midiEvents, midiEvent);
+
+  // The event is held back until the part of the block which it falls in
+  pluginChainProcessMidi(p, midiEvents);
+  assertFalse(((PluginMockData)mock->extraData)->processMidiCalled);
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assert(((PluginMockData)mock->extraData)->processMidiCalled);
+  assertUnsignedLongEquals(44ul,
+                           ((PluginMockData)mock->extraData)->midiDeltaFrames);
+  assertUnsignedLongEquals(300ul, midiEvent->deltaFrames);
+
+  freePluginAutomation(automation);
+  freeLinkedListAndItems(midiEvents, (LinkedListFreeItemFunc)freeMidiEvent);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testGetPipelineDelay(void) {
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(kInternalPluginPassthruName);
+
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  pluginChainSetPipelined(p, true);
+  // A single plugin cannot be pipelined
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           pluginChainGetPipelineDelayInBlocks(p));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           pluginChainGetProcessingDelay(p));
+
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  assertUnsignedLongEquals(2ul, pluginChainGetPipelineDelayInBlocks(p));
+  assertUnsignedLongEquals(2ul * getBlocksize(),
+                           pluginChainGetProcessingDelay(p));
+
+  freeCharString(name);
+  return 0;
+}
+
+static int _testProcessPluginChainAudioPipelined(void) {
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(kInternalPluginPassthruName);
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  unsigned int i;
+
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  pluginChainSetPipelined(p, true);
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  pluginChainPrepareForProcessing(p);
+
+  // Each block is tagged with its index, and with 3 plugins the output should
+  // lag the input by 2 blocks
+  for (i = 0; i < 6; i++) {
+    inBuffer->samples[0][0] = (Sample)(i + 1);
+    pluginChainProcessAudio(p, inBuffer, outBuffer);
+    assertUnsignedLongEquals(DEFAULT_BLOCKSIZE, outBuffer->blocksize);
+    assertDoubleEquals(i < 2 ? 0.0 : (double)(i - 1), outBuffer->samples[0][0],
+                       TEST_DEFAULT_TOLERANCE);
+  }
+
+  // After a reset, the pipeline must be filled again
+  pluginChainReset(p);
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertDoubleEquals(0.0, outBuffer->samples[0][0], TEST_DEFAULT_TOLERANCE);
+
+  pluginChainShutdown(p);
+  freeCharString(name);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testProcessPluginChainAudioSplit(void) {
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(kInternalPluginPassthruName);
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  unsigned int i;
+
+  assert(pluginChainBeginSplit(p));
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  assert(pluginChainAddBranch(p));
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  assert(pluginChainEndSplit(p));
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  pluginChainPrepareForProcessing(p);
+
+  // The outputs of both branches are summed
+  for (i = 0; i < 3; i++) {
+    inBuffer->samples[0][0] = (Sample)(i + 1);
+    pluginChainProcessAudio(p, inBuffer, outBuffer);
+    assertUnsignedLongEquals(DEFAULT_BLOCKSIZE, outBuffer->blocksize);
+    assertDoubleEquals(2.0 * (i + 1), outBuffer->samples[0][0],
+                       TEST_DEFAULT_TOLERANCE);
+  }
+
+  pluginChainShutdown(p);
+  freeCharString(name);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testProcessPluginChainAudioSplitWithDelay(void) {
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(kInternalPluginPassthruName);
+  Plugin mock = newPluginMock();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  const SampleCount delay = 10;
+  SampleCount i;
+
+  // The mock plugin only outputs silence, but reports a delay which the
+  // passthru branch must be aligned with
+  ((PluginMockData)mock->extraData)->initialDelay = (int)delay;
+  assert(pluginChainBeginSplit(p));
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  assert(pluginChainAddBranch(p));
+  assert(pluginChainAppend(p, mock, NULL));
+  assert(pluginChainEndSplit(p));
+  assertUnsignedLongEquals((unsigned long)delay,
+                           pluginChainGetProcessingDelay(p));
+
+  for (i = 0; i < DEFAULT_BLOCKSIZE; i++) {
+    inBuffer->samples[0][i] = 1.0f;
+  }
+
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+
+  for (i = 0; i < DEFAULT_BLOCKSIZE; i++) {
+    assertDoubleEquals(i < delay ? 0.0 : 1.0, outBuffer->samples[0][i],
+                       TEST_DEFAULT_TOLERANCE);
+  }
+
+  pluginChainShutdown(p);
+  freeCharString(name);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testResetPluginChainAudioSplitWithDelay(void) {
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(kInternalPluginPassthruName);
+  Plugin mock = newPluginMock();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  const SampleCount delay = 10;
+  Thread branchThread;
+  SampleCount i;
+
+  ((PluginMockData)mock->extraData)->initialDelay = (int)delay;
+  assert(pluginChainBeginSplit(p));
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  assert(pluginChainAddBranch(p));
+  assert(pluginChainAppend(p, mock, NULL));
+  assert(pluginChainEndSplit(p));
+
+  for (i = 0; i < DEFAULT_BLOCKSIZE; i++) {
+    inBuffer->samples[0][i] = 1.0f;
+  }
+
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  branchThread = p->_splits[0].branches[1].thread;
+
+  // The delay line still holds the end of the last block, which must not leak
+  // into the next input, but the branch thread is kept running
+  pluginChainReset(p);
+  assert(p->_splitsStarted);
+  assert(p->_splits[0].branches[1].thread == branchThread);
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+
+  for (i = 0; i < DEFAULT_BLOCKSIZE; i++) {
+    assertDoubleEquals(i < delay ? 0.0 : 1.0, outBuffer->samples[0][i],
+                       TEST_DEFAULT_TOLERANCE);
+  }
+
+  // With another blocksize, the split is restarted with the next block
+  setBlocksize(DEFAULT_BLOCKSIZE / 2);
+  pluginChainReset(p);
+  assertFalse(p->_splitsStarted);
+  setBlocksize(DEFAULT_BLOCKSIZE);
+
+  pluginChainShutdown(p);
+  freeCharString(name);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testProcessPluginChainAudioWithPluginBlocksize(void) {
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(kInternalPluginPassthruName);
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleCount i;
+
+  // The plugin only produces output after receiving twice the chain's
+  // blocksize, so the first block of the chain is silent
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  assertFalse(pluginChainSetPluginBlocksize(p, 1, DEFAULT_BLOCKSIZE));
+  assert(pluginChainSetPluginBlocksize(p, 0, DEFAULT_BLOCKSIZE * 2));
+  assertUnsignedLongEquals((unsigned long)DEFAULT_BLOCKSIZE,
+                           pluginChainGetProcessingDelay(p));
+  pluginChainPrepareForProcessing(p);
+  assertNotNull(p->_reblockers[0]);
+
+  for (i = 0; i < DEFAULT_BLOCKSIZE; i++) {
+    inBuffer->samples[0][i] = 1.0f;
+  }
+
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+
+  for (i = 0; i < DEFAULT_BLOCKSIZE; i++) {
+    assertDoubleEquals(0.0, outBuffer->samples[0][i], TEST_EXACT_TOLERANCE);
+  }
+
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+
+  for (i = 0; i < DEFAULT_BLOCKSIZE; i++) {
+    assertDoubleEquals(1.0, outBuffer->samples[0][i], TEST_EXACT_TOLERANCE);
+  }
+
+  pluginChainShutdown(p);
+  freeCharString(name);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testProcessPluginChainAudioChannelInstances(void) {
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(kInternalPluginPassthruName);
+  const ChannelCount numChannels = 6;
+  SampleBuffer inBuffer;
+  SampleBuffer outBuffer;
+  ChannelCount i;
+
+  assert(setNumChannels(numChannels));
+  inBuffer = newSampleBuffer(numChannels, DEFAULT_BLOCKSIZE);
+  outBuffer = newSampleBuffer(numChannels, DEFAULT_BLOCKSIZE);
+
+  // The passthru plugin only has two channels, so three instances are needed
+  // to process all of the input channels
+  assert(pluginChainAppend(p, newPluginPassthru(name), NULL));
+  pluginChainSetChannelInstances(p, true);
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  assertNotNull(p->_instanceGroups[0]);
+  assertUnsignedLongEquals(3ul, p->_instanceGroups[0]->numInstances);
+  pluginChainPrepareForProcessing(p);
+
+  for (i = 0; i < numChannels; i++) {
+    inBuffer->samples[i][0] = (Sample)(i + 1) / 10.0f;
+  }
+
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+
+  for (i = 0; i < numChannels; i++) {
+    assertDoubleEquals((i + 1) / 10.0, outBuffer->samples[i][0],
+                       TEST_DEFAULT_TOLERANCE);
+  }
+
+  pluginChainShutdown(p);
+  assert(setNumChannels(DEFAULT_NUM_CHANNELS));
+  freeCharString(name);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static boolByte _processSilentBlock(PluginChain p, Plugin mock,
+                                    SampleBuffer inBuffer,
+                                    SampleBuffer outBuffer) {
+  PluginMockData mockData = (PluginMockData)mock->extraData;
+  mockData->processAudioCalled = false;
+  sampleBufferClear(inBuffer);
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  return mockData->processAudioCalled;
+}
+
+static int _testProcessPluginChainAudioSkipSilence(void) {
+  PluginChain p = getPluginChain();
+  Plugin mock = newPluginMock();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+
+  mock->pluginType = PLUGIN_TYPE_EFFECT;
+  assert(pluginChainAppend(p, mock, NULL));
+  pluginChainSetSkipSilence(p, true);
+  pluginChainPrepareForProcessing(p);
+  // The mock's tail time would take many blocks to pass, so use a shorter one
+  p->_silenceHoldFrames[0] = DEFAULT_BLOCKSIZE;
+
+  // The plugin is processed for one block plus its tail
+  assert(_processSilentBlock(p, mock, inBuffer, outBuffer));
+  assert(_processSilentBlock(p, mock, inBuffer, outBuffer));
+  assertFalse(_processSilentBlock(p, mock, inBuffer, outBuffer));
+  assertFalse(_processSilentBlock(p, mock, inBuffer, outBuffer));
+
+  // Any sound on the input resumes processing
+  inBuffer->samples[0][0] = 1.0f;
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assert(((PluginMockData)mock->extraData)->processAudioCalled);
+  assert(_processSilentBlock(p, mock, inBuffer, outBuffer));
+
+  // Instruments are never skipped
+  mock->pluginType = PLUGIN_TYPE_INSTRUMENT;
+  assert(_processSilentBlock(p, mock, inBuffer, outBuffer));
+  assert(_processSilentBlock(p, mock, inBuffer, outBuffer));
+  assert(_processSilentBlock(p, mock, inBuffer, outBuffer));
+
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testProcessPluginChainMidiEvents(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  LinkedList list = newLinkedList();
+  MidiEvent midi = newMidiEvent();
+
+  linkedListAppend(list, midi);
+  assert(pluginChainAppend(p, mock, NULL));
+  pluginChainProcessMidi(p, list);
+  assert(((PluginMockData)mock->extraData)->processMidiCalled);
+
+  freeMidiEvent(midi);
+  freeLinkedList(list);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testProcessPluginChainMidiWithRoutes(void) {
+  Plugin mock = newPluginMock();
+  Plugin gate = newPluginMock();
+  PluginChain p = getPluginChain();
+  LinkedList routes = newLinkedList();
+  LinkedList list = newLinkedList();
+  MidiEvent midi = newMidiEvent();
+
+  gate->pluginType = PLUGIN_TYPE_EFFECT;
+  charStringCopyCString(gate->pluginName, "Gate");
+  linkedListAppend(routes, "gate,10");
+  assert(pluginChainSetMidiRoutes(p, routes));
+  assert(pluginChainAppend(p, mock, NULL));
+  assert(pluginChainAppend(p, gate, NULL));
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+
+  // The first plugin still receives all channels, and the gate only its own
+  midi->eventType = MIDI_TYPE_REGULAR;
+  midi->status = 0x90;
+  linkedListAppend(list, midi);
+  pluginChainProcessMidi(p, list);
+  assert(((PluginMockData)mock->extraData)->processMidiCalled);
+  assertFalse(((PluginMockData)gate->extraData)->processMidiCalled);
+
+  midi->status = 0x99;
+  pluginChainProcessMidi(p, list);
+  assert(((PluginMockData)gate->extraData)->processMidiCalled);
+
+  freeMidiEvent(midi);
+  freeLinkedList(list);
+  freeLinkedList(routes);
+  return 0;
+}
+
+static MidiSequence _newTestNoteSequence(void) {
+  MidiSequence m = newMidiSequence();
+  const byte notes[] = {36, 38, 36, 42, 36, 38};
+  MidiEvent midiEvent;
+  unsigned long i;
+
+  // Repeated notes, some of which overlap with other notes
+  for (i = 0; i < sizeof(notes); i++) {
+    midiEvent = midiSequenceNewMidiEvent(m);
+    midiEvent->eventType = MIDI_TYPE_REGULAR;
+    midiEvent->timestamp = 300 + i * 700;
+    midiEvent->status = 0x90;
+    midiEvent->data1 = notes[i];
+    midiEvent->data2 = 100;
+    appendMidiEventToSequence(m, midiEvent);
+    midiEvent = midiSequenceNewMidiEvent(m);
+    midiEvent->eventType = MIDI_TYPE_REGULAR;
+    midiEvent->timestamp = 300 + i * 700 + 1000;
+    midiEvent->status = 0x80;
+    midiEvent->data1 = notes[i];
+    appendMidiEventToSequence(m, midiEvent);
+  }
+
+  return m;
+}
+
+static int _testPrepareNoteRendersWithoutCache(void) {
+  PluginChain p = getPluginChain();
+  MidiSequence m = _newTestNoteSequence();
+
+  assertFalse(pluginChainPrepareNoteRenders(p, m, 0.0001f));
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testMixNoteRenders(void) {
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(kInternalPluginSineName);
+  MidiSequence m = _newTestNoteSequence();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer mixBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  LinkedList midiEvents = newLinkedList();
+  unsigned long frame;
+  MidiEvent events;
+  unsigned long numEvents;
+  unsigned long i;
+  SampleCount j;
+
+  assert(pluginChainAppend(p, newPluginSine(name), NULL));
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  pluginChainPrepareForProcessing(p);
+  pluginChainSetNoteRenderCache(p, 16 * 1024 * 1024);
+  assert(pluginChainPrepareNoteRenders(p, m, 0.0001f));
+  assert(p->_noteRenderCache->verified);
+  assertUnsignedLongEquals(3ul, p->_noteRenderCache->numMisses);
+  assertUnsignedLongEquals(3ul, p->_noteRenderCache->numHits);
+
+  // Mixing the renders sounds the same as playing the sequence
+  for (frame = 0; frame < 8192; frame += DEFAULT_BLOCKSIZE) {
+    midiSequenceGetRange(m, frame, DEFAULT_BLOCKSIZE, &events, &numEvents);
+    linkedListClear(midiEvents);
+
+    for (i = 0; i < numEvents; i++) {
+      linkedListAppend(midiEvents, &events[i]);
+    }
+
+    if (numEvents > 0) {
+      pluginChainProcessMidi(p, midiEvents);
+    }
+
+    sampleBufferClear(inBuffer);
+    pluginChainProcessAudio(p, inBuffer, outBuffer);
+    pluginChainMixNoteRenders(p, mixBuffer, frame);
+
+    for (j = 0; j < DEFAULT_BLOCKSIZE; j++) {
+      assertDoubleEquals(outBuffer->samples[0][j], mixBuffer->samples[0][j],
+                         0.0001);
+    }
+  }
+
+  freeLinkedList(midiEvents);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  freeSampleBuffer(mixBuffer);
+  freeMidiSequence(m);
+  freeCharString(name);
+  return 0;
+}
+
+static int _testSetInvalidMidiRoutes(void) {
+  PluginChain p = getPluginChain();
+  const char *invalidRoutes[] = {"gate,0", "gate,17", "gate,4-2", "gate,1-",
+                                 "gate,x", ",1"};
+  LinkedList routes;
+  size_t i;
+
+  for (i = 0; i < sizeof(invalidRoutes) / sizeof(invalidRoutes[0]); i++) {
+    routes = newLinkedList();
+    linkedListAppend(routes, (void *)invalidRoutes[i]);
+    assertFalse(pluginChainSetMidiRoutes(p, routes));
+    freeLinkedList(routes);
+  }
+
+  return 0;
+}
+
+static int _getSettingWithSidechainInputs(void *pluginPtr,
+                                          PluginSetting pluginSetting) {
+  return pluginSetting == PLUGIN_NUM_INPUTS ? 4 : 2;
+}
+
+// Adds the sidechain in the last two inputs to the main channels
+static void _processAudioWithSidechain(void *pluginPtr, SampleBuffer inputs,
+                                       SampleBuffer outputs) {
+  ChannelCount channel;
+  SampleCount i;
+
+  for (channel = 0; channel < 2; channel++) {
+    for (i = 0; i < outputs->blocksize; i++) {
+      outputs->samples[channel][i] =
+          inputs->samples[channel][i] + inputs->samples[channel + 2][i];
+    }
+  }
+}
+
+static int _testProcessPluginChainWithSidechain(void) {
+  Plugin mock = newPluginMock();
+  Plugin ducker = newPluginMock();
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString("ducker");
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer sidechain;
+  SampleCount i;
+
+  ducker->pluginType = PLUGIN_TYPE_EFFECT;
+  charStringCopyCString(ducker->pluginName, "Ducker");
+  ducker->getSetting = _getSettingWithSidechainInputs;
+  ducker->processAudio = _processAudioWithSidechain;
+  // The mock only clears its output, so the ducker hears just the sidechain
+  assert(pluginChainAppend(p, mock, NULL));
+  assert(pluginChainAppend(p, ducker, NULL));
+  assertIsNull(pluginChainGetSidechain(p));
+  pluginChainSetSidechain(p, name, 2);
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  pluginChainPrepareForProcessing(p);
+
+  sidechain = pluginChainGetSidechain(p);
+  assertNotNull(sidechain);
+  assertIntEquals(2, sidechain->numChannels);
+  assertUnsignedLongEquals(DEFAULT_BLOCKSIZE, sidechain->blocksize);
+
+  for (i = 0; i < DEFAULT_BLOCKSIZE; i++) {
+    sidechain->samples[0][i] = 0.5f;
+    sidechain->samples[1][i] = -0.25f;
+  }
+
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertDoubleEquals(0.5, outBuffer->samples[0][0], TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(-0.25, outBuffer->samples[1][DEFAULT_BLOCKSIZE - 1],
+                     TEST_EXACT_TOLERANCE);
+
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  freeCharString(name);
+  return 0;
+}
+
+static int _testSidechainNeedsMoreInputs(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString("mock");
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+
+  // A stereo sidechain would take all inputs of a stereo plugin
+  charStringCopyCString(mock->pluginName, "Mock");
+  assert(pluginChainAppend(p, mock, NULL));
+  pluginChainSetSidechain(p, name, 2);
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  assertIsNull(p->_sidechainPlugin);
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assert(((PluginMockData)mock->extraData)->processAudioCalled);
+
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  freeCharString(name);
+  return 0;
+}
+
+static int _testRecentBlockTimes(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+  SampleBuffer inBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer =
+      newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  unsigned int i;
+
+  assert(pluginChainAppend(p, mock, NULL));
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  assertIntEquals(0, pluginChainGetNumRecentBlocks(p));
+
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertIntEquals(1, pluginChainGetNumRecentBlocks(p));
+  assert(pluginChainGetRecentBlockTime(p, 0, 1) >=
+         pluginChainGetRecentBlockTime(p, 0, 0));
+  assertDoubleEquals(0.0, pluginChainGetRecentBlockTime(p, 1, 0),
+                     TEST_DEFAULT_TOLERANCE);
+
+  for (i = 0; i < PLUGIN_CHAIN_RECENT_BLOCKS; i++) {
+    pluginChainProcessAudio(p, inBuffer, outBuffer);
+  }
+
+  assertIntEquals(PLUGIN_CHAIN_RECENT_BLOCKS, pluginChainGetNumRecentBlocks(p));
+
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testShutdown(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+
+  assert(pluginChainAppend(p, mock, NULL));
+  pluginChainShutdown(p);
+  assertFalse(((PluginMockData)mock->extraData)->isOpen);
+
+  return 0;
+}
+
+static const int kPluginChainBenchmarkNumPlugins = 4;
+
+typedef struct {
+  SampleBuffer inBuffer;
+  SampleBuffer outBuffer;
+} _PluginChainBenchmarkData;
+
+// Plugins are added to the global chain, which is created and freed by the
+// suite's setup and teardown
+static void *_setupPluginChainBenchmark(Plugin (*newPlugin)(const CharString),
+                                        const char *pluginName) {
+  _PluginChainBenchmarkData *data =
+      (_PluginChainBenchmarkData *)malloc(sizeof(_PluginChainBenchmarkData));
+  PluginChain p = getPluginChain();
+  CharString name = newCharStringWithCString(pluginName);
+  int i;
+
+  for (i = 0; i < kPluginChainBenchmarkNumPlugins; i++) {
+    pluginChainAppend(p, newPlugin(name), NULL);
+  }
+
+  pluginChainInitialize(p);
+  pluginChainPrepareForProcessing(p);
+  data->inBuffer = newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  data->outBuffer = newSampleBuffer(DEFAULT_NUM_CHANNELS, DEFAULT_BLOCKSIZE);
+  freeCharString(name);
+  return data;
+}
+
+static void *_setupPluginChainPassthruBenchmark(void) {
+  return _setupPluginChainBenchmark(newPluginPassthru,
+                                    kInternalPluginPassthruName);
+}
+
+static void *_setupPluginChainGainBenchmark(void) {
+  return _setupPluginChainBenchmark(newPluginGain, kInternalPluginGainName);
+}
+
+static void _benchmarkProcessAudio(void *context) {
+  _PluginChainBenchmarkData *data = (_PluginChainBenchmarkData *)context;
+  pluginChainProcessAudio(getPluginChain(), data->inBuffer, data->outBuffer);
+}
+
+static void _teardownPluginChainBenchmark(void *context) {
+  _PluginChainBenchmarkData *data = (_PluginChainBenchmarkData *)context;
+  freeSampleBuffer(data->inBuffer);
+  freeSampleBuffer(data->outBuffer);
+  free(data);
+}
+
+TestSuite addPluginChainTests(void);
+TestSuite addPluginChainTests(void) {
+  TestSuite testSuite = newTestSuite("PluginChain", _pluginChainTestSetup,
                                      _pluginChainTestTeardown);
   addTest(testSuite, "Initialization", _testInitPluginChain);
   addTest(testSuite, "AddFromArgumentStringNull",
@@ -312,25 +1541,104 @@ TestSuite addPluginChainTests(void) {
   addTest(testSuite, "AddFromArgumentString", _testAddFromArgumentString);
   addTest(testSuite, "AddFromArgumentStringMultiple",
           _testAddFromArgumentStringMultiple);
+  addTest(testSuite, "AddFromArgumentStringWithBlocksize",
+          _testAddFromArgumentStringWithBlocksize);
+  addTest(testSuite, "AddFromArgumentStringWithInvalidBlocksize",
+          _testAddFromArgumentStringWithInvalidBlocksize);
+  addTest(testSuite, "AddFromArgumentStringWithSplit",
+          _testAddFromArgumentStringWithSplit);
+  addTest(testSuite, "AddFromArgumentStringWithInvalidSplit",
+          _testAddFromArgumentStringWithInvalidSplit);
+  addTest(testSuite, "AddFromArgumentStringOpensPlugins",
+          _testAddFromArgumentStringOpensPlugins);
+  addTest(testSuite, "AddFromArgumentStringWithInvalidSplitOpensNothing",
+          _testAddFromArgumentStringWithInvalidSplitOpensNothing);
   addTest(testSuite, "AddPluginWithPresetFromArgumentString",
           _testAddPluginWithPresetFromArgumentString);
   addTest(testSuite, "AddFromArgumentStringWithPresetSpaces",
           _testAddFromArgumentStringWithPresetSpaces);
   addTest(testSuite, "AppendPlugin", _testAppendPlugin);
+  addTest(testSuite, "AppendManyPlugins", _testAppendManyPlugins);
   addTest(testSuite, "AppendWithNullPlugin", _testAppendWithNullPlugin);
   addTest(testSuite, "AppendWithPreset", _testAppendWithPreset);
   addTest(testSuite, "InitializePluginChain", _testInitializePluginChain);
+  addTest(testSuite, "InitializePluginChainWithParallelLoading",
+          _testInitializePluginChainWithParallelLoading);
 
   addTest(testSuite, "GetMaximumTailTime", _testGetMaximumTailTime);
 
   addTest(testSuite, "PrepareForProcessing", _testPrepareForProcessing);
+  addTest(testSuite, "ResetPluginChain", _testResetPluginChain);
+  addTest(testSuite, "ResetPluginChainTimers", _testResetPluginChainTimers);
+  addTest(testSuite, "ProcessPluginChainAudioCountsHostCallbacks",
+          _testProcessPluginChainAudioCountsHostCallbacks);
+  addTest(testSuite, "GetLastOutputs", _testGetLastOutputs);
+  addTest(testSuite, "ProcessPluginChainAudioCountsPerfCounters",
+          _testProcessPluginChainAudioCountsPerfCounters);
+  addTest(testSuite, "ResetPluginChainKeepsBuffers",
+          _testResetPluginChainKeepsBuffers);
+  addTest(testSuite, "ResetPluginChainWithNewBlocksize",
+          _testResetPluginChainWithNewBlocksize);
+  addTest(testSuite, "GetLinearGain", _testGetLinearGain);
+  addTest(testSuite, "GetLinearGainWithSeveralGains",
+          _testGetLinearGainWithSeveralGains);
+  addTest(testSuite, "GetLinearGainWithOtherPlugin",
+          _testGetLinearGainWithOtherPlugin);
   addTest(testSuite, "ProcessPluginChainAudio", _testProcessPluginChainAudio);
+  addTest(testSuite, "ProcessPluginChainAudioFlushesDenormals",
+          _testProcessPluginChainAudioFlushesDenormals);
+  addTest(testSuite, "ProcessPluginChainAudioKeepsDenormals",
+          _testProcessPluginChainAudioKeepsDenormals);
   addTest(testSuite, "ProcessPluginChainAudioRealtime",
           _testProcessPluginChainAudioRealtime);
+  addTest(testSuite, "ProcessPluginChainAudioWithoutCopies",
+          _testProcessPluginChainAudioWithoutCopies);
+  addTest(testSuite, "ProcessPluginChainAudioMappedWithoutCopies",
+          _testProcessPluginChainAudioMappedWithoutCopies);
+  addTest(testSuite, "ProcessAudioWithAutomation",
+          _testProcessPluginChainAudioWithAutomation);
+  addTest(testSuite, "ProcessAudioWithAutomationAndMidi",
+          _testProcessPluginChainAudioWithAutomationAndMidi);
+  addTest(testSuite, "ProcessMidiWithAutomation",
+          _testProcessPluginChainMidiWithAutomation);
+  addTest(testSuite, "GetPipelineDelay", _testGetPipelineDelay);
+  addTest(testSuite, "ProcessPluginChainAudioPipelined",
+          _testProcessPluginChainAudioPipelined);
+  addTest(testSuite, "ProcessPluginChainAudioSplit",
+          _testProcessPluginChainAudioSplit);
+  addTest(testSuite, "ProcessPluginChainAudioSplitWithDelay",
+          _testProcessPluginChainAudioSplitWithDelay);
+  addTest(testSuite, "ResetPluginChainAudioSplitWithDelay",
+          _testResetPluginChainAudioSplitWithDelay);
+  addTest(testSuite, "ProcessPluginChainAudioSkipSilence",
+          _testProcessPluginChainAudioSkipSilence);
+  addTest(testSuite, "ProcessPluginChainAudioWithPluginBlocksize",
+          _testProcessPluginChainAudioWithPluginBlocksize);
+  addTest(testSuite, "ProcessPluginChainAudioChannelInstances",
+          _testProcessPluginChainAudioChannelInstances);
   addTest(testSuite, "ProcessPluginChainMidiEvents",
           _testProcessPluginChainMidiEvents);
 
+  addTest(testSuite, "ProcessPluginChainMidiWithRoutes",
+          _testProcessPluginChainMidiWithRoutes);
+  addTest(testSuite, "PrepareNoteRendersWithoutCache",
+          _testPrepareNoteRendersWithoutCache);
+  addTest(testSuite, "MixNoteRenders", _testMixNoteRenders);
+  addTest(testSuite, "ProcessPluginChainAudioWithControl",
+          _testProcessPluginChainAudioWithControl);
+  addTest(testSuite, "SetInvalidMidiRoutes", _testSetInvalidMidiRoutes);
+  addTest(testSuite, "ProcessPluginChainWithSidechain",
+          _testProcessPluginChainWithSidechain);
+  addTest(testSuite, "SidechainNeedsMoreInputs", _testSidechainNeedsMoreInputs);
+  addTest(testSuite, "RecentBlockTimes", _testRecentBlockTimes);
   addTest(testSuite, "Shutdown", _testShutdown);
 
+  addBenchmarkWithSetup(testSuite, "ProcessAudioWithPassthru",
+                        _setupPluginChainPassthruBenchmark,
+                        _benchmarkProcessAudio, _teardownPluginChainBenchmark);
+  addBenchmarkWithSetup(testSuite, "ProcessAudioWithGain",
+                        _setupPluginChainGainBenchmark, _benchmarkProcessAudio,
+                        _teardownPluginChainBenchmark);
+
   return testSuite;
 }
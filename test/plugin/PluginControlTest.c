@@ -0,0 +1,228 @@
+//
+// PluginControlTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/Thread.h"
+#include "plugin/PluginControl.h"
+
+#include "unit/TestRunner.h"
+
+#include "PluginPresetMock.h"
+
+#include <string.h>
+
+static int _testSetParameter(void) {
+  PluginControl control = newPluginControl(4);
+  PluginControlCommand command;
+
+  assertFalse(pluginControlNextCommand(control, &command));
+  assert(pluginControlSetParameter(control, 1, 2, 0.25f));
+  assert(pluginControlNextCommand(control, &command));
+  assertIntEquals(PLUGIN_CONTROL_SET_PARAMETER, command.type);
+  assertIntEquals(1, command.pluginIndex);
+  assertIntEquals(2, command.parameterIndex);
+  assertDoubleEquals(0.25, command.value, TEST_DEFAULT_TOLERANCE);
+  assertIsNull(command.preset);
+  pluginControlFinishCommand(control, &command, true);
+  assertFalse(pluginControlNextCommand(control, &command));
+  assertIntEquals(1, control->numApplied);
+  assertIntEquals(0, control->numFailed);
+
+  freePluginControl(control);
+  return 0;
+}
+
+static int _testSetParameterWhenFull(void) {
+  PluginControl control = newPluginControl(2);
+
+  assert(pluginControlSetParameter(control, 0, 0, 0.0f));
+  assert(pluginControlSetParameter(control, 0, 1, 0.0f));
+  assertFalse(pluginControlSetParameter(control, 0, 2, 0.0f));
+
+  freePluginControl(control);
+  return 0;
+}
+
+static void _setParametersThread(void *userData) {
+  PluginControl control = (PluginControl)userData;
+  unsigned int i;
+
+  for (i = 0; i < 32; i++) {
+    pluginControlSetParameter(control, 1, i, 0.5f);
+  }
+}
+
+static int _testSetParameterFromSeveralThreads(void) {
+  PluginControl control = newPluginControl(64);
+  PluginControlCommand command;
+  Thread thread = newThread(_setParametersThread, control);
+  unsigned int i;
+  unsigned int numCommands = 0;
+
+  for (i = 0; i < 32; i++) {
+    pluginControlSetParameter(control, 0, i, 0.25f);
+  }
+
+  threadJoinAndFree(thread);
+
+  while (pluginControlNextCommand(control, &command)) {
+    assertIntEquals(PLUGIN_CONTROL_SET_PARAMETER, command.type);
+    assertDoubleEquals((command.pluginIndex == 0 ? 0.25 : 0.5), command.value,
+                       TEST_DEFAULT_TOLERANCE);
+    numCommands++;
+  }
+
+  assertIntEquals(64, numCommands);
+
+  freePluginControl(control);
+  return 0;
+}
+
+static int _testLoadPresetOpensPreset(void) {
+  PluginControl control = newPluginControl(4);
+  PluginPreset preset = newPluginPresetMock();
+  PluginControlCommand command;
+
+  assert(pluginControlLoadPreset(control, 3, preset));
+  // The preset is opened by the control thread, before it is queued
+  assert(((PluginPresetMockData)preset->extraData)->isOpen);
+  assert(pluginControlNextCommand(control, &command));
+  assertIntEquals(PLUGIN_CONTROL_LOAD_PRESET, command.type);
+  assertIntEquals(3, command.pluginIndex);
+  assert(command.preset == preset);
+  pluginControlFinishCommand(control, &command, false);
+  assertIntEquals(0, control->numApplied);
+  assertIntEquals(1, control->numFailed);
+
+  // The finished preset is freed with the queue
+  freePluginControl(control);
+  return 0;
+}
+
+static int _testFreeWithPendingPreset(void) {
+  PluginControl control = newPluginControl(4);
+
+  assert(pluginControlLoadPreset(control, 0, newPluginPresetMock()));
+  freePluginControl(control);
+  return 0;
+}
+
+static int _testHandleParameterLine(void) {
+  PluginControl control = newPluginControl(4);
+  CharString line = newCharStringWithCString("parameter 1 7 0.5");
+  CharString reply = newCharString();
+  PluginControlCommand command;
+
+  assert(pluginControlHandleLine(control, line, reply));
+  assertCharStringEquals("OK", reply);
+  assert(pluginControlNextCommand(control, &command));
+  assertIntEquals(1, command.pluginIndex);
+  assertIntEquals(7, command.parameterIndex);
+  assertDoubleEquals(0.5, command.value, TEST_DEFAULT_TOLERANCE);
+  pluginControlFinishCommand(control, &command, true);
+
+  // Tabs separate the words as well
+  charStringCopyCString(line, "parameter\t0\t2\t-1");
+  assert(pluginControlHandleLine(control, line, reply));
+  assert(pluginControlNextCommand(control, &command));
+  assertIntEquals(2, command.parameterIndex);
+  assertDoubleEquals(-1.0, command.value, TEST_DEFAULT_TOLERANCE);
+
+  freePluginControl(control);
+  freeCharString(line);
+  freeCharString(reply);
+  return 0;
+}
+
+static int _testHandleInvalidLines(void) {
+  PluginControl control = newPluginControl(4);
+  CharString line = newCharString();
+  CharString reply = newCharString();
+  const char *invalidLines[] = {"",
+                                "bogus 1 2",
+                                "parameter",
+                                "parameter 0 1",
+                                "parameter x 1 0.5",
+                                "parameter -1 1 0.5",
+                                "parameter 0 1 0.5x",
+                                "preset 0",
+                                "preset 0 invalid.txt"};
+  PluginControlCommand command;
+  unsigned int i;
+
+  for (i = 0; i < sizeof(invalidLines) / sizeof(invalidLines[0]); i++) {
+    charStringCopyCString(line, invalidLines[i]);
+    assertFalse(pluginControlHandleLine(control, line, reply));
+    assertIntEquals(0, strncmp(reply->data, "ERROR\t", 6));
+  }
+
+  assertFalse(pluginControlNextCommand(control, &command));
+
+  freePluginControl(control);
+  freeCharString(line);
+  freeCharString(reply);
+  return 0;
+}
+
+static int _testHandleStatusLine(void) {
+  PluginControl control = newPluginControl(4);
+  CharString line = newCharStringWithCString("status");
+  CharString reply = newCharString();
+  PluginControlCommand command;
+
+  assert(pluginControlSetParameter(control, 0, 0, 0.0f));
+  assert(pluginControlSetParameter(control, 0, 0, 0.0f));
+  assert(pluginControlNextCommand(control, &command));
+  pluginControlFinishCommand(control, &command, true);
+
+  assert(pluginControlHandleLine(control, line, reply));
+  assertCharStringEquals("OK\t1\t0\t1", reply);
+
+  freePluginControl(control);
+  freeCharString(line);
+  freeCharString(reply);
+  return 0;
+}
+
+static int _testFreeNullPluginControl(void) {
+  freePluginControl(NULL);
+  return 0;
+}
+
+TestSuite addPluginControlTests(void);
+TestSuite addPluginControlTests(void) {
+  TestSuite testSuite = newTestSuite("PluginControl", NULL, NULL);
+  addTest(testSuite, "SetParameter", _testSetParameter);
+  addTest(testSuite, "SetParameterWhenFull", _testSetParameterWhenFull);
+  addTest(testSuite, "SetParameterFromSeveralThreads",
+          _testSetParameterFromSeveralThreads);
+  addTest(testSuite, "LoadPresetOpensPreset", _testLoadPresetOpensPreset);
+  addTest(testSuite, "FreeWithPendingPreset", _testFreeWithPendingPreset);
+  addTest(testSuite, "HandleParameterLine", _testHandleParameterLine);
+  addTest(testSuite, "HandleInvalidLines", _testHandleInvalidLines);
+  addTest(testSuite, "HandleStatusLine", _testHandleStatusLine);
+  addTest(testSuite, "FreeNullPluginControl", _testFreeNullPluginControl);
+  return testSuite;
+}
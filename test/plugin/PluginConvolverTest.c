@@ -0,0 +1,320 @@
+//
+// PluginConvolverTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "plugin/PluginConvolver.h"
+
+#include "audio/AudioSettings.h"
+#include "audio/SampleBuffer.h"
+#include "io/SampleSource.h"
+#include "plugin/PluginPreset.h"
+#include "plugin/PluginPresetImpulse.h"
+#include "unit/TestRunner.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_IMPULSE_FILENAME "mrswatsontest-impulse.wav"
+
+static void _pluginConvolverTestSetup(void) { initAudioSettings(); }
+
+static void _pluginConvolverTestTeardown(void) {
+  remove(TEST_IMPULSE_FILENAME);
+  freeAudioSettings();
+}
+
+static Plugin _newTestConvolver(void) {
+  CharString name = newCharStringWithCString(kInternalPluginConvolverName);
+  Plugin plugin = newPluginConvolver(name);
+  freeCharString(name);
+  return plugin;
+}
+
+static Sample _getTestSignal(SampleCount frame, ChannelCount channel) {
+  return (Sample)(0.5 * sin(frame * 0.05 + channel) +
+                  0.1 * ((int)(frame % 7) - 3));
+}
+
+static SampleBuffer _newTestImpulse(ChannelCount numChannels,
+                                    SampleCount numFrames) {
+  SampleBuffer impulse = newSampleBuffer(numChannels, numFrames);
+  ChannelCount channel;
+  SampleCount i;
+
+  for (channel = 0; channel < numChannels; channel++) {
+    for (i = 0; i < numFrames; i++) {
+      impulse->samples[channel][i] =
+          (Sample)(exp(-(double)i / 200.0) * cos(i * (0.3 + channel * 0.2)));
+    }
+  }
+
+  return impulse;
+}
+
+// Process the test signal in blocks of different sizes, and return the output
+static SampleBuffer _processTestSignal(Plugin p, ChannelCount numChannels,
+                                       SampleCount numFrames) {
+  static const SampleCount blocksizes[] = {512, 300, 100, 512, 7};
+  SampleBuffer output = newSampleBuffer(numChannels, numFrames);
+  SampleBuffer block = newSampleBuffer(numChannels, getBlocksize());
+  SampleCount offset = 0;
+  ChannelCount channel;
+  SampleCount i;
+  unsigned int blockIndex = 0;
+
+  while (offset < numFrames) {
+    block->blocksize = blocksizes[blockIndex++ % 5];
+
+    if (block->blocksize > numFrames - offset) {
+      block->blocksize = numFrames - offset;
+    }
+
+    for (channel = 0; channel < numChannels; channel++) {
+      for (i = 0; i < block->blocksize; i++) {
+        block->samples[channel][i] = _getTestSignal(offset + i, channel);
+      }
+    }
+
+    // The plugin processes in place, as it does in the chain
+    p->processAudio(p, block, block);
+
+    for (channel = 0; channel < numChannels; channel++) {
+      for (i = 0; i < block->blocksize; i++) {
+        output->samples[channel][offset + i] = block->samples[channel][i];
+      }
+    }
+
+    offset += block->blocksize;
+  }
+
+  freeSampleBuffer(block);
+  return output;
+}
+
+// Check the output against a direct convolution of the test signal
+static int _assertConvolved(const SampleBuffer output,
+                            const SampleBuffer impulse, SampleCount delay) {
+  ChannelCount channel;
+  SampleCount i, j;
+  double expected;
+
+  for (channel = 0; channel < output->numChannels; channel++) {
+    for (i = 0; i < output->blocksize; i++) {
+      expected = 0.0;
+
+      for (j = 0; j < impulse->blocksize && j + delay <= i; j++) {
+        expected +=
+            impulse->samples[channel % impulse->numChannels][j] *
+            _getTestSignal(i - delay - j, channel);
+      }
+
+      assert(fabs(output->samples[channel][i] - expected) < 0.0005);
+    }
+  }
+
+  return 0;
+}
+
+static int _testInitialDelay(void) {
+  Plugin p = _newTestConvolver();
+  assertIntEquals(512, p->getSetting(p, PLUGIN_INITIAL_DELAY));
+  setBlocksize(100);
+  assertIntEquals(128, p->getSetting(p, PLUGIN_INITIAL_DELAY));
+  setBlocksize(10);
+  assertIntEquals(CONVOLVER_MIN_PARTITION_SIZE,
+                  p->getSetting(p, PLUGIN_INITIAL_DELAY));
+  freePlugin(p);
+  return 0;
+}
+
+static int _testWithoutImpulseOnlyDelays(void) {
+  Plugin p = _newTestConvolver();
+  SampleBuffer unitImpulse = newSampleBuffer(1, 1);
+  SampleBuffer output;
+
+  unitImpulse->samples[0][0] = 1.0f;
+  p->prepareForProcessing(p);
+  output = _processTestSignal(p, 2, 3000);
+  assertIntEquals(0, _assertConvolved(output, unitImpulse, 512));
+
+  freeSampleBuffer(unitImpulse);
+  freeSampleBuffer(output);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testMatchesDirectConvolution(void) {
+  Plugin p = _newTestConvolver();
+  SampleBuffer impulse = _newTestImpulse(1, 1500);
+  SampleBuffer output;
+
+  assert(pluginConvolverSetImpulse(p, impulse, getSampleRate()));
+  p->prepareForProcessing(p);
+  output = _processTestSignal(p, 2, 4000);
+  assertIntEquals(0, _assertConvolved(output, impulse, 512));
+
+  freeSampleBuffer(impulse);
+  freeSampleBuffer(output);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testStereoImpulse(void) {
+  Plugin p = _newTestConvolver();
+  SampleBuffer impulse = _newTestImpulse(2, 700);
+  SampleBuffer output;
+
+  assert(pluginConvolverSetImpulse(p, impulse, getSampleRate()));
+  p->prepareForProcessing(p);
+  output = _processTestSignal(p, 2, 2500);
+  assertIntEquals(0, _assertConvolved(output, impulse, 512));
+
+  freeSampleBuffer(impulse);
+  freeSampleBuffer(output);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testThreadsMatchSerial(void) {
+  Plugin serial = _newTestConvolver();
+  Plugin threaded = _newTestConvolver();
+  SampleBuffer impulse = _newTestImpulse(1, 512 * 20);
+  SampleBuffer serialOutput, threadedOutput;
+  ChannelCount channel;
+  SampleCount i;
+
+  assert(pluginConvolverSetImpulse(serial, impulse, getSampleRate()));
+  assert(pluginConvolverSetImpulse(threaded, impulse, getSampleRate()));
+  assert(threaded->setParameter(threaded, PLUGIN_CONVOLVER_SETTINGS_THREADS,
+                                3.0f));
+  serial->prepareForProcessing(serial);
+  threaded->prepareForProcessing(threaded);
+  assertIntEquals(3,
+                  ((PluginConvolverSettings)threaded->extraData)->numTasks);
+
+  serialOutput = _processTestSignal(serial, 2, 6000);
+  threadedOutput = _processTestSignal(threaded, 2, 6000);
+
+  for (channel = 0; channel < 2; channel++) {
+    for (i = 0; i < serialOutput->blocksize; i++) {
+      assert(fabs(serialOutput->samples[channel][i] -
+                  threadedOutput->samples[channel][i]) < 0.0001);
+    }
+  }
+
+  freeSampleBuffer(impulse);
+  freeSampleBuffer(serialOutput);
+  freeSampleBuffer(threadedOutput);
+  freePlugin(serial);
+  freePlugin(threaded);
+  return 0;
+}
+
+static int _testTailTime(void) {
+  Plugin p = _newTestConvolver();
+  SampleBuffer impulse = _newTestImpulse(1, 4410);
+
+  assertIntEquals(0, p->getSetting(p, PLUGIN_SETTING_TAIL_TIME_IN_MS));
+  assert(pluginConvolverSetImpulse(p, impulse, 22050.0));
+  assertIntEquals(200, p->getSetting(p, PLUGIN_SETTING_TAIL_TIME_IN_MS));
+
+  // The impulse response is converted to the sample rate of the render
+  p->prepareForProcessing(p);
+  assertIntEquals(18, ((PluginConvolverSettings)p->extraData)->numPartitions);
+
+  freeSampleBuffer(impulse);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testLoadImpulsePreset(void) {
+  CharString filename = newCharStringWithCString(TEST_IMPULSE_FILENAME);
+  SampleSource source = sampleSourceFactory(filename);
+  SampleBuffer impulse = _newTestImpulse(1, 1000);
+  Plugin p = _newTestConvolver();
+  PluginPreset preset;
+
+  setNumChannels(1);
+  assert(source->openSampleSource(source, SAMPLE_SOURCE_OPEN_WRITE));
+  assert(source->writeSampleBlock(source, impulse));
+  source->closeSampleSource(source);
+  freeSampleSource(source);
+
+  // Loading the preset must not change the settings of the render
+  setNumChannels(2);
+  setSampleRate(48000.0);
+  preset = pluginPresetFactory(filename);
+  assertNotNull(preset);
+  assertIntEquals(PRESET_TYPE_IMPULSE, preset->presetType);
+  assert(pluginPresetIsCompatibleWith(preset, p));
+  assert(preset->openPreset(preset));
+  assert(preset->loadPreset(preset, p));
+  assertIntEquals(2, getNumChannels());
+  assertDoubleEquals(48000.0, getSampleRate(), TEST_EXACT_TOLERANCE);
+
+  assertUnsignedLongEquals(
+      1000ul,
+      ((PluginConvolverSettings)p->extraData)->impulse->blocksize);
+  assertDoubleEquals(
+      44100.0, ((PluginConvolverSettings)p->extraData)->impulseSampleRate,
+      TEST_EXACT_TOLERANCE);
+
+  freePluginPreset(preset);
+  freeSampleBuffer(impulse);
+  freeCharString(filename);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testSetParameter(void) {
+  Plugin p = _newTestConvolver();
+  PluginConvolverSettings settings = (PluginConvolverSettings)p->extraData;
+
+  assert(p->setParameter(p, PLUGIN_CONVOLVER_SETTINGS_GAIN, -6.0f));
+  assertDoubleEquals(0.501187, settings->gain, TEST_DEFAULT_TOLERANCE);
+  assert(p->setParameter(p, PLUGIN_CONVOLVER_SETTINGS_THREADS, 2.0f));
+  assertIntEquals(2, settings->numThreads);
+  assertFalse(p->setParameter(p, PLUGIN_CONVOLVER_SETTINGS_THREADS, -1.0f));
+  assertFalse(p->setParameter(p, PLUGIN_CONVOLVER_NUM_SETTINGS, 0.0f));
+
+  freePlugin(p);
+  return 0;
+}
+
+TestSuite addPluginConvolverTests(void);
+TestSuite addPluginConvolverTests(void) {
+  TestSuite testSuite =
+      newTestSuite("PluginConvolver", _pluginConvolverTestSetup,
+                   _pluginConvolverTestTeardown);
+  addTest(testSuite, "InitialDelay", _testInitialDelay);
+  addTest(testSuite, "WithoutImpulseOnlyDelays", _testWithoutImpulseOnlyDelays);
+  addTest(testSuite, "MatchesDirectConvolution", _testMatchesDirectConvolution);
+  addTest(testSuite, "StereoImpulse", _testStereoImpulse);
+  addTest(testSuite, "ThreadsMatchSerial", _testThreadsMatchSerial);
+  addTest(testSuite, "TailTime", _testTailTime);
+  addTest(testSuite, "LoadImpulsePreset", _testLoadImpulsePreset);
+  addTest(testSuite, "SetParameter", _testSetParameter);
+  return testSuite;
+}
@@ -0,0 +1,181 @@
+//
+// PluginDegraderTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "plugin/PluginDegrader.h"
+
+#include "unit/TestRunner.h"
+
+static int _testNewBypassPolicy(void) {
+  PluginDegradePolicy policy = newPluginDegradePolicy("mrs_reverb,bypass");
+
+  assertNotNull(policy);
+  assertCharStringEquals("mrs_reverb", policy->pluginName);
+  assertIntEquals(PLUGIN_DEGRADE_BYPASS, policy->type);
+  assertFalse(policy->degraded);
+
+  freePluginDegradePolicy(policy);
+  return 0;
+}
+
+static int _testNewParameterPolicy(void) {
+  PluginDegradePolicy policy =
+      newPluginDegradePolicy("Oversampler,parameter,2,0.0,0.5");
+
+  assertNotNull(policy);
+  assertCharStringEquals("Oversampler", policy->pluginName);
+  assertIntEquals(PLUGIN_DEGRADE_PARAMETER, policy->type);
+  assertIntEquals(2, policy->parameterIndex);
+  assertDoubleEquals(0.0, policy->degradedValue, TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.5, policy->normalValue, TEST_DEFAULT_TOLERANCE);
+
+  freePluginDegradePolicy(policy);
+  return 0;
+}
+
+static int _testNewInvalidPolicies(void) {
+  assertIsNull(newPluginDegradePolicy("mrs_reverb"));
+  assertIsNull(newPluginDegradePolicy(",bypass"));
+  assertIsNull(newPluginDegradePolicy("mrs_reverb,mute"));
+  assertIsNull(newPluginDegradePolicy("mrs_reverb,bypass,1"));
+  assertIsNull(newPluginDegradePolicy("mrs_reverb,parameter"));
+  assertIsNull(newPluginDegradePolicy("mrs_reverb,parameter,1,0.0"));
+  assertIsNull(newPluginDegradePolicy("mrs_reverb,parameter,-1,0.0,1.0"));
+  assertIsNull(newPluginDegradePolicy("mrs_reverb,parameter,1,0.0,1.0x"));
+  return 0;
+}
+
+static int _testBypassDelaysInput(void) {
+  PluginDegradePolicy policy = newPluginDegradePolicy("mrs_reverb,bypass");
+  SampleBuffer inputs = newSampleBuffer(1, 4);
+  SampleBuffer outputs = newSampleBuffer(1, 4);
+  SampleCount i;
+
+  pluginDegradePolicyPrepare(policy, 1, 3);
+
+  for (i = 0; i < inputs->blocksize; i++) {
+    inputs->samples[0][i] = (Sample)(i + 1);
+  }
+
+  pluginDegradePolicyProcess(policy, inputs, outputs);
+  assertDoubleEquals(0.0, outputs->samples[0][2], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(1.0, outputs->samples[0][3], TEST_DEFAULT_TOLERANCE);
+  pluginDegradePolicyProcess(policy, inputs, outputs);
+  assertDoubleEquals(2.0, outputs->samples[0][0], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(4.0, outputs->samples[0][2], TEST_DEFAULT_TOLERANCE);
+
+  freePluginDegradePolicy(policy);
+  freeSampleBuffer(inputs);
+  freeSampleBuffer(outputs);
+  return 0;
+}
+
+static int _testSkipDoesNotDelayInput(void) {
+  PluginDegradePolicy policy = newPluginDegradePolicy("analyzer,skip");
+  SampleBuffer inputs = newSampleBuffer(2, 4);
+  SampleBuffer outputs = newSampleBuffer(2, 4);
+
+  pluginDegradePolicyPrepare(policy, 2, 3);
+  inputs->samples[1][0] = 0.5f;
+  pluginDegradePolicyProcess(policy, inputs, outputs);
+  assertDoubleEquals(0.5, outputs->samples[1][0], TEST_DEFAULT_TOLERANCE);
+
+  freePluginDegradePolicy(policy);
+  freeSampleBuffer(inputs);
+  freeSampleBuffer(outputs);
+  return 0;
+}
+
+static int _testUpdateDegradesInOrder(void) {
+  PluginDegrader degrader = newPluginDegrader();
+  PluginDegradePolicy first = newPluginDegradePolicy("first,bypass");
+  PluginDegradePolicy second = newPluginDegradePolicy("second,skip");
+
+  pluginDegraderAdd(degrader, first);
+  pluginDegraderAdd(degrader, second);
+  first->lastProcessingTimeInMs = 3.0;
+
+  assertIsNull(pluginDegraderUpdate(degrader, 5.0, 10.0));
+  assert(pluginDegraderUpdate(degrader, 12.0, 10.0) == first);
+  assert(first->degraded);
+  assertDoubleEquals(3.0, first->costInMs, TEST_DEFAULT_TOLERANCE);
+  assert(pluginDegraderUpdate(degrader, 11.0, 10.0) == second);
+  assert(second->degraded);
+  assertIsNull(pluginDegraderUpdate(degrader, 11.0, 10.0));
+  assertIntEquals(2, degrader->numDegraded);
+  assertIntEquals(2, degrader->numDegradations);
+
+  freePluginDegrader(degrader);
+  return 0;
+}
+
+static int _testUpdateRestoresWithHeadroom(void) {
+  PluginDegrader degrader = newPluginDegrader();
+  PluginDegradePolicy policy = newPluginDegradePolicy("first,bypass");
+  unsigned long i;
+
+  degrader->recoverBlocks = 4;
+  pluginDegraderAdd(degrader, policy);
+  policy->lastProcessingTimeInMs = 4.0;
+  assert(pluginDegraderUpdate(degrader, 12.0, 10.0) == policy);
+
+  // Not enough headroom to also pay for the degraded plugin
+  for (i = 0; i < 10; i++) {
+    assertIsNull(pluginDegraderUpdate(degrader, 5.0, 10.0));
+  }
+
+  for (i = 0; i < degrader->recoverBlocks - 1; i++) {
+    assertIsNull(pluginDegraderUpdate(degrader, 2.0, 10.0));
+  }
+
+  assert(pluginDegraderUpdate(degrader, 2.0, 10.0) == policy);
+  assertFalse(policy->degraded);
+  assertIntEquals(0, degrader->numDegraded);
+  assertIntEquals(1, degrader->numRecoveries);
+
+  freePluginDegrader(degrader);
+  return 0;
+}
+
+static int _testFreeNullPluginDegrader(void) {
+  freePluginDegrader(NULL);
+  freePluginDegradePolicy(NULL);
+  return 0;
+}
+
+TestSuite addPluginDegraderTests(void);
+TestSuite addPluginDegraderTests(void) {
+  TestSuite testSuite = newTestSuite("PluginDegrader", NULL, NULL);
+  addTest(testSuite, "NewBypassPolicy", _testNewBypassPolicy);
+  addTest(testSuite, "NewParameterPolicy", _testNewParameterPolicy);
+  addTest(testSuite, "NewInvalidPolicies", _testNewInvalidPolicies);
+  addTest(testSuite, "BypassDelaysInput", _testBypassDelaysInput);
+  addTest(testSuite, "SkipDoesNotDelayInput", _testSkipDoesNotDelayInput);
+  addTest(testSuite, "UpdateDegradesInOrder", _testUpdateDegradesInOrder);
+  addTest(testSuite, "UpdateRestoresWithHeadroom",
+          _testUpdateRestoresWithHeadroom);
+  addTest(testSuite, "FreeNullPluginDegrader", _testFreeNullPluginDegrader);
+  return testSuite;
+}
@@ -0,0 +1,116 @@
+//
+// PluginIdlerTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/Thread.h"
+#include "plugin/PluginIdler.h"
+#include "time/TaskTimer.h"
+
+#include "unit/TestRunner.h"
+
+// Longest time to wait for the idle thread in these tests
+static const double kPluginIdlerTestTimeoutInMs = 2000.0;
+
+typedef struct {
+  volatile unsigned int numCalls;
+  // Number of calls after which the plugin stops asking to be idled, or 0 to
+  // be idled forever
+  unsigned int maxCalls;
+} _PluginIdlerTestPluginMembers;
+
+static boolByte _pluginIdlerTestIdle(void *pluginPtr) {
+  _PluginIdlerTestPluginMembers *plugin =
+      (_PluginIdlerTestPluginMembers *)pluginPtr;
+  unsigned int numCalls = atomicAdd(&plugin->numCalls, 1);
+  return (boolByte)(plugin->maxCalls == 0 || numCalls < plugin->maxCalls);
+}
+
+static boolByte _waitForCalls(_PluginIdlerTestPluginMembers *plugin,
+                              unsigned int numCalls) {
+  double waitedInMs;
+
+  for (waitedInMs = 0.0; waitedInMs < kPluginIdlerTestTimeoutInMs;
+       waitedInMs += 1.0) {
+    if (atomicLoad(&plugin->numCalls) >= numCalls) {
+      return true;
+    }
+
+    taskTimerSleep(1.0);
+  }
+
+  return false;
+}
+
+static int _testIdlePlugin(void) {
+  _PluginIdlerTestPluginMembers plugin = {0, 0};
+  unsigned int numCalls;
+
+  pluginIdlerSetInterval(1.0);
+  pluginIdlerAdd(&plugin, _pluginIdlerTestIdle);
+  // Adding the same plugin twice does not idle it twice
+  pluginIdlerAdd(&plugin, _pluginIdlerTestIdle);
+  assertIntEquals(1, pluginIdlerGetNumPlugins());
+  assert(_waitForCalls(&plugin, 3));
+
+  pluginIdlerRemove(&plugin);
+  assertIntEquals(0, pluginIdlerGetNumPlugins());
+  numCalls = atomicLoad(&plugin.numCalls);
+  taskTimerSleep(20.0);
+  assert(numCalls == atomicLoad(&plugin.numCalls));
+
+  pluginIdlerStop();
+  pluginIdlerSetInterval(PLUGIN_IDLER_DEFAULT_INTERVAL_IN_MS);
+  return 0;
+}
+
+static int _testIdlePluginUntilDone(void) {
+  _PluginIdlerTestPluginMembers plugin = {0, 2};
+
+  pluginIdlerSetInterval(1.0);
+  pluginIdlerAdd(&plugin, _pluginIdlerTestIdle);
+  assert(_waitForCalls(&plugin, 2));
+  taskTimerSleep(20.0);
+  assertIntEquals(0, pluginIdlerGetNumPlugins());
+  assertIntEquals(2, atomicLoad(&plugin.numCalls));
+
+  pluginIdlerStop();
+  pluginIdlerSetInterval(PLUGIN_IDLER_DEFAULT_INTERVAL_IN_MS);
+  return 0;
+}
+
+static int _testStopWithoutPlugins(void) {
+  pluginIdlerStop();
+  assertIntEquals(0, pluginIdlerGetNumPlugins());
+  return 0;
+}
+
+TestSuite addPluginIdlerTests(void);
+TestSuite addPluginIdlerTests(void) {
+  TestSuite testSuite = newTestSuite("PluginIdler", NULL, NULL);
+  addTest(testSuite, "IdlePlugin", _testIdlePlugin);
+  addTest(testSuite, "IdlePluginUntilDone", _testIdlePluginUntilDone);
+  addTest(testSuite, "StopWithoutPlugins", _testStopWithoutPlugins);
+  return testSuite;
+}
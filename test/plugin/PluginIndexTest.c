@@ -0,0 +1,414 @@
+//
+// PluginIndexTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "plugin/PluginIndex.h"
+
+#include "base/File.h"
+#include "unit/TestRunner.h"
+
+#define TEST_INDEX_FILENAME "plugin_index.txt"
+#define TEST_INDEX_DIRNAME "plugin_index_dir"
+
+static const char *kPluginIndexTestExtension = ".so";
+
+static void _pluginIndexTestTeardown(void) {
+  File indexFile = newFileWithPathCString(TEST_INDEX_FILENAME);
+  File indexDir = newFileWithPathCString(TEST_INDEX_DIRNAME);
+
+  if (fileExists(indexFile)) {
+    fileRemove(indexFile);
+  }
+
+  if (fileExists(indexDir)) {
+    fileRemove(indexDir);
+  }
+
+  freeFile(indexFile);
+  freeFile(indexDir);
+}
+
+static void _createTestFile(File dir, const char *name) {
+  CharString filename = newCharStringWithCString(name);
+  File file = newFileWithParent(dir, filename);
+  fileCreate(file, kFileTypeFile);
+  freeFile(file);
+  freeCharString(filename);
+}
+
+static CharString _createTestLocation(void) {
+  File dir = newFileWithPathCString(TEST_INDEX_DIRNAME);
+  CharString result;
+
+  fileCreate(dir, kFileTypeDirectory);
+  _createTestFile(dir, "Plugin.so");
+  _createTestFile(dir, "Other Plugin.SO");
+  _createTestFile(dir, "readme.txt");
+
+  result = newCharStringWithCString(dir->absolutePath->data);
+  freeFile(dir);
+  return result;
+}
+
+static PluginIndex _newTestIndex(void) {
+  CharString indexFile = newCharStringWithCString(TEST_INDEX_FILENAME);
+  PluginIndex index = newPluginIndex(indexFile, kPluginIndexTestExtension);
+  freeCharString(indexFile);
+  return index;
+}
+
+static int _testNewPluginIndexWithoutFile(void) {
+  PluginIndex index = _newTestIndex();
+
+  assertNotNull(index);
+  assertIntEquals(0, linkedListLength(index->locations));
+  assertFalse(index->dirty);
+
+  freePluginIndex(index);
+  return 0;
+}
+
+static int _testGetLocationNotDirectory(void) {
+  PluginIndex index = _newTestIndex();
+  CharString path = newCharStringWithCString("invalid");
+
+  assertIsNull(pluginIndexGetLocation(index, path));
+
+  freeCharString(path);
+  freePluginIndex(index);
+  return 0;
+}
+
+static int _testGetLocationListsPlugins(void) {
+  PluginIndex index = _newTestIndex();
+  CharString path = _createTestLocation();
+  PluginIndexLocation location = pluginIndexGetLocation(index, path);
+
+  assertNotNull(location);
+  assertCharStringEquals(path->data, location->path);
+  assert(location->modificationTime > 0);
+  assertIntEquals(2, linkedListLength(location->entries));
+  assert(index->dirty);
+
+  freeCharString(path);
+  freePluginIndex(index);
+  return 0;
+}
+
+static int _testFindPlugin(void) {
+  PluginIndex index = _newTestIndex();
+  CharString path = _createTestLocation();
+  CharString name = newCharStringWithCString("Plugin");
+  PluginIndexEntry entry = pluginIndexFind(index, path, name);
+
+  assertNotNull(entry);
+  assertCharStringEquals("Plugin", entry->name);
+  assertFalse(entry->scanned);
+  assertIntEquals(PLUGIN_TYPE_UNKNOWN, entry->pluginType);
+
+  freeCharString(name);
+  freeCharString(path);
+  freePluginIndex(index);
+  return 0;
+}
+
+static int _testFindPluginWithExtension(void) {
+  PluginIndex index = _newTestIndex();
+  CharString path = _createTestLocation();
+  CharString name = newCharStringWithCString("Other Plugin.so");
+  PluginIndexEntry entry = pluginIndexFind(index, path, name);
+
+  assertNotNull(entry);
+  assertCharStringEquals("Other Plugin", entry->name);
+
+  freeCharString(name);
+  freeCharString(path);
+  freePluginIndex(index);
+  return 0;
+}
+
+static int _testFindInvalidPlugin(void) {
+  PluginIndex index = _newTestIndex();
+  CharString path = _createTestLocation();
+  CharString name = newCharStringWithCString("readme");
+
+  assertIsNull(pluginIndexFind(index, path, name));
+
+  freeCharString(name);
+  freeCharString(path);
+  freePluginIndex(index);
+  return 0;
+}
+
+static void _setScannedInfo(PluginIndexEntry entry) {
+  entry->scanned = true;
+  entry->pluginType = PLUGIN_TYPE_INSTRUMENT;
+  freePluginVst2xId(entry->pluginId);
+  entry->pluginId = newPluginVst2xIdWithId(0x61626364);
+  entry->numInputs = 0;
+  entry->numOutputs = 2;
+}
+
+static int _testWriteAndRead(void) {
+  PluginIndex index = _newTestIndex();
+  CharString path = _createTestLocation();
+  CharString name = newCharStringWithCString("Plugin");
+  PluginIndexEntry entry = pluginIndexFind(index, path, name);
+  unsigned long modificationTime;
+
+  assertNotNull(entry);
+  _setScannedInfo(entry);
+  modificationTime = pluginIndexGetLocation(index, path)->modificationTime;
+  assert(pluginIndexWrite(index));
+  assertFalse(index->dirty);
+  freePluginIndex(index);
+
+  index = _newTestIndex();
+  assertIntEquals(1, linkedListLength(index->locations));
+  assertUnsignedLongEquals(
+      modificationTime,
+      ((PluginIndexLocation)index->locations->item)->modificationTime);
+  entry = pluginIndexFind(index, path, name);
+  // The location should not have been listed again
+  assertFalse(index->dirty);
+  assertNotNull(entry);
+  assert(entry->scanned);
+  assertIntEquals(PLUGIN_TYPE_INSTRUMENT, entry->pluginType);
+  assertCharStringEquals("abcd", entry->pluginId->idString);
+  assertIntEquals(0, entry->numInputs);
+  assertIntEquals(2, entry->numOutputs);
+
+  freeCharString(name);
+  freeCharString(path);
+  freePluginIndex(index);
+  return 0;
+}
+
+static int _testWriteAndReadShellPlugins(void) {
+  PluginIndex index = _newTestIndex();
+  CharString path = _createTestLocation();
+  CharString name = newCharStringWithCString("Plugin");
+  PluginIndexEntry entry = pluginIndexFind(index, path, name);
+  PluginIndexShellPlugin shellPlugin;
+
+  assertNotNull(entry);
+  _setScannedInfo(entry);
+  linkedListAppend(entry->shellPlugins,
+                   newPluginIndexShellPlugin(0x73756231, "Sub Plugin"));
+  assert(pluginIndexWrite(index));
+  freePluginIndex(index);
+
+  index = _newTestIndex();
+  entry = pluginIndexFind(index, path, name);
+  assertNotNull(entry);
+  assertIntEquals(1, linkedListLength(entry->shellPlugins));
+  shellPlugin = (PluginIndexShellPlugin)entry->shellPlugins->item;
+  assertCharStringEquals("sub1", shellPlugin->pluginId->idString);
+  assertCharStringEquals("Sub Plugin", shellPlugin->name);
+
+  freeCharString(name);
+  freeCharString(path);
+  freePluginIndex(index);
+  return 0;
+}
+
+static int _testWriteAndReadCapabilities(void) {
+  PluginIndex index = _newTestIndex();
+  CharString path = _createTestLocation();
+  CharString name = newCharStringWithCString("Plugin");
+  PluginIndexEntry entry = pluginIndexFind(index, path, name);
+
+  assertNotNull(entry);
+  _setScannedInfo(entry);
+  entry->capabilities->states[PLUGIN_CAPABILITY_DETERMINISTIC] =
+      PLUGIN_CAPABILITY_SUPPORTED;
+  entry->capabilities->states[PLUGIN_CAPABILITY_FORK_SAFE] =
+      PLUGIN_CAPABILITY_UNSUPPORTED;
+  pluginIndexSetUserCapability(index, 0x61626364, PLUGIN_CAPABILITY_OFFLINE,
+                               PLUGIN_CAPABILITY_UNSUPPORTED);
+  assert(pluginIndexWrite(index));
+  freePluginIndex(index);
+
+  index = _newTestIndex();
+  entry = pluginIndexFind(index, path, name);
+  assertNotNull(entry);
+  assertIntEquals(PLUGIN_CAPABILITY_SUPPORTED,
+                  entry->capabilities->states[PLUGIN_CAPABILITY_DETERMINISTIC]);
+  assertIntEquals(PLUGIN_CAPABILITY_UNSUPPORTED,
+                  entry->capabilities->states[PLUGIN_CAPABILITY_FORK_SAFE]);
+  assertIntEquals(PLUGIN_CAPABILITY_UNKNOWN,
+                  entry->capabilities->states[PLUGIN_CAPABILITY_OFFLINE]);
+  assertIntEquals(PLUGIN_CAPABILITY_UNSUPPORTED,
+                  pluginIndexGetCapability(index, 0x61626364,
+                                           PLUGIN_CAPABILITY_OFFLINE));
+
+  freeCharString(name);
+  freeCharString(path);
+  freePluginIndex(index);
+  return 0;
+}
+
+static int _testUserCapabilityOverridesProbed(void) {
+  PluginIndex index = _newTestIndex();
+  CharString path = _createTestLocation();
+  CharString name = newCharStringWithCString("Plugin");
+  PluginIndexEntry entry = pluginIndexFind(index, path, name);
+
+  assertNotNull(entry);
+  _setScannedInfo(entry);
+  assertIntEquals(PLUGIN_CAPABILITY_UNKNOWN,
+                  pluginIndexGetCapability(index, 0x61626364,
+                                           PLUGIN_CAPABILITY_DETERMINISTIC));
+  entry->capabilities->states[PLUGIN_CAPABILITY_DETERMINISTIC] =
+      PLUGIN_CAPABILITY_UNSUPPORTED;
+  assertIntEquals(PLUGIN_CAPABILITY_UNSUPPORTED,
+                  pluginIndexGetCapability(index, 0x61626364,
+                                           PLUGIN_CAPABILITY_DETERMINISTIC));
+
+  pluginIndexSetUserCapability(index, 0x61626364,
+                               PLUGIN_CAPABILITY_DETERMINISTIC,
+                               PLUGIN_CAPABILITY_SUPPORTED);
+  assert(index->dirty);
+  assertIntEquals(PLUGIN_CAPABILITY_SUPPORTED,
+                  pluginIndexGetCapability(index, 0x61626364,
+                                           PLUGIN_CAPABILITY_DETERMINISTIC));
+  // Back to the probed state
+  pluginIndexSetUserCapability(index, 0x61626364,
+                               PLUGIN_CAPABILITY_DETERMINISTIC,
+                               PLUGIN_CAPABILITY_UNKNOWN);
+  assertIntEquals(PLUGIN_CAPABILITY_UNSUPPORTED,
+                  pluginIndexGetCapability(index, 0x61626364,
+                                           PLUGIN_CAPABILITY_DETERMINISTIC));
+  assertIntEquals(PLUGIN_CAPABILITY_UNKNOWN,
+                  pluginIndexGetCapability(index, 0x12345678,
+                                           PLUGIN_CAPABILITY_DETERMINISTIC));
+
+  freeCharString(name);
+  freeCharString(path);
+  freePluginIndex(index);
+  return 0;
+}
+
+static int _testFindShellPlugin(void) {
+  PluginIndexEntry entry = newPluginIndexEntry("Shell", 0);
+  PluginIndexShellPlugin shellPlugin;
+
+  assertIsNull(pluginIndexEntryFindShellPlugin(entry, "Sub Plugin"));
+  linkedListAppend(entry->shellPlugins,
+                   newPluginIndexShellPlugin(0x73756231, "Sub Plugin"));
+  // Named like the ID of the other sub-plugin, so the name must win
+  linkedListAppend(entry->shellPlugins,
+                   newPluginIndexShellPlugin(0x73756232, "sub1"));
+
+  shellPlugin = pluginIndexEntryFindShellPlugin(entry, "sub plugin");
+  assertNotNull(shellPlugin);
+  assertCharStringEquals("sub1", shellPlugin->pluginId->idString);
+  shellPlugin = pluginIndexEntryFindShellPlugin(entry, "sub1");
+  assertNotNull(shellPlugin);
+  assertCharStringEquals("sub2", shellPlugin->pluginId->idString);
+  shellPlugin = pluginIndexEntryFindShellPlugin(entry, "sub2");
+  assertNotNull(shellPlugin);
+  assertCharStringEquals("sub1", shellPlugin->name);
+  assertIsNull(pluginIndexEntryFindShellPlugin(entry, "Other"));
+
+  freePluginIndexEntry(entry);
+  return 0;
+}
+
+static int _testModifiedLocationKeepsScannedInfo(void) {
+  PluginIndex index = _newTestIndex();
+  CharString path = _createTestLocation();
+  CharString name = newCharStringWithCString("Plugin");
+  PluginIndexLocation location = pluginIndexGetLocation(index, path);
+  PluginIndexEntry entry = pluginIndexFind(index, path, name);
+
+  assertNotNull(entry);
+  _setScannedInfo(entry);
+  assert(pluginIndexWrite(index));
+
+  // Pretend that the directory has changed since it was indexed
+  location->modificationTime = 0;
+  entry = pluginIndexFind(index, path, name);
+  assert(index->dirty);
+  assertNotNull(entry);
+  assert(entry->scanned);
+  assertIntEquals(PLUGIN_TYPE_INSTRUMENT, entry->pluginType);
+  assertIntEquals(2, linkedListLength(location->entries));
+
+  freeCharString(name);
+  freeCharString(path);
+  freePluginIndex(index);
+  return 0;
+}
+
+static int _testReadCorruptIndex(void) {
+  CharString contents =
+      newCharStringWithCString("# MrsWatson plugin index v1\nP\tbogus\n");
+  File indexFile = newFileWithPathCString(TEST_INDEX_FILENAME);
+  PluginIndex index;
+
+  assert(fileCreate(indexFile, kFileTypeFile));
+  assert(fileWrite(indexFile, contents));
+  freeFile(indexFile);
+
+  index = _newTestIndex();
+  assertIntEquals(0, linkedListLength(index->locations));
+  assert(index->dirty);
+
+  freeCharString(contents);
+  freePluginIndex(index);
+  return 0;
+}
+
+static int _testFreeNullPluginIndex(void) {
+  freePluginIndex(NULL);
+  return 0;
+}
+
+TestSuite addPluginIndexTests(void);
+TestSuite addPluginIndexTests(void) {
+  TestSuite testSuite =
+      newTestSuite("PluginIndex", NULL, _pluginIndexTestTeardown);
+  addTest(testSuite, "NewPluginIndexWithoutFile",
+          _testNewPluginIndexWithoutFile);
+  addTest(testSuite, "GetLocationNotDirectory", _testGetLocationNotDirectory);
+  addTest(testSuite, "GetLocationListsPlugins", _testGetLocationListsPlugins);
+  addTest(testSuite, "FindPlugin", _testFindPlugin);
+  addTest(testSuite, "FindPluginWithExtension", _testFindPluginWithExtension);
+  addTest(testSuite, "FindInvalidPlugin", _testFindInvalidPlugin);
+  addTest(testSuite, "WriteAndRead", _testWriteAndRead);
+  addTest(testSuite, "WriteAndReadShellPlugins",
+          _testWriteAndReadShellPlugins);
+  addTest(testSuite, "WriteAndReadCapabilities",
+          _testWriteAndReadCapabilities);
+  addTest(testSuite, "UserCapabilityOverridesProbed",
+          _testUserCapabilityOverridesProbed);
+  addTest(testSuite, "FindShellPlugin", _testFindShellPlugin);
+  addTest(testSuite, "ModifiedLocationKeepsScannedInfo",
+          _testModifiedLocationKeepsScannedInfo);
+  addTest(testSuite, "ReadCorruptIndex", _testReadCorruptIndex);
+  addTest(testSuite, "FreeNullPluginIndex", _testFreeNullPluginIndex);
+  return testSuite;
+}
@@ -0,0 +1,127 @@
+//
+// PluginLatencyTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "plugin/PluginLatency.h"
+
+#include "audio/AudioSettings.h"
+#include "audio/SampleBuffer.h"
+#include "unit/TestRunner.h"
+
+static void _pluginLatencyTestSetup(void) { initAudioSettings(); }
+
+static void _pluginLatencyTestTeardown(void) { freeAudioSettings(); }
+
+static Plugin _newTestLatency(const float latencyFrames) {
+  CharString name = newCharStringWithCString(kInternalPluginLatencyName);
+  Plugin plugin = newPluginLatency(name);
+  freeCharString(name);
+  plugin->setParameter(plugin, PLUGIN_LATENCY_SETTINGS_FRAMES, latencyFrames);
+  plugin->prepareForProcessing(plugin);
+  return plugin;
+}
+
+static int _testInitialDelay(void) {
+  Plugin p = _newTestLatency(100.0f);
+  assertIntEquals(100, p->getSetting(p, PLUGIN_INITIAL_DELAY));
+  freePlugin(p);
+  return 0;
+}
+
+static int _testDelaysByLatency(void) {
+  // More latency than one block, so that the delay line must carry over
+  const SampleCount latency = getBlocksize() + 10;
+  Plugin p = _newTestLatency((float)latency);
+  SampleBuffer inputs = newSampleBuffer(2, getBlocksize());
+  SampleBuffer outputs = newSampleBuffer(2, getBlocksize());
+  SampleCount frame = 0;
+  SampleCount i;
+  int block;
+
+  for (block = 0; block < 3; block++) {
+    for (i = 0; i < inputs->blocksize; i++) {
+      inputs->samples[0][i] = (Sample)(frame + i + 1);
+      inputs->samples[1][i] = -(Sample)(frame + i + 1);
+    }
+
+    p->processAudio(p, inputs, outputs);
+
+    for (i = 0; i < outputs->blocksize; i++) {
+      const Sample expected =
+          frame + i < latency ? 0.0f : (Sample)(frame + i - latency + 1);
+      assertDoubleEquals(expected, outputs->samples[0][i],
+                         TEST_EXACT_TOLERANCE);
+      assertDoubleEquals(-expected, outputs->samples[1][i],
+                         TEST_EXACT_TOLERANCE);
+    }
+
+    frame += inputs->blocksize;
+  }
+
+  freeSampleBuffer(inputs);
+  freeSampleBuffer(outputs);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testZeroLatencyPassesThrough(void) {
+  Plugin p = _newTestLatency(0.0f);
+  SampleBuffer inputs = newSampleBuffer(2, getBlocksize());
+  SampleBuffer outputs = newSampleBuffer(2, getBlocksize());
+
+  inputs->samples[0][0] = 0.5f;
+  inputs->samples[1][0] = -0.5f;
+  p->processAudio(p, inputs, outputs);
+  assertIntEquals(0, p->getSetting(p, PLUGIN_INITIAL_DELAY));
+  assertDoubleEquals(0.5, outputs->samples[0][0], TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(-0.5, outputs->samples[1][0], TEST_EXACT_TOLERANCE);
+
+  freeSampleBuffer(inputs);
+  freeSampleBuffer(outputs);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testSetParameter(void) {
+  Plugin p = _newTestLatency(0.0f);
+
+  assert(p->setParameter(p, PLUGIN_LATENCY_SETTINGS_FRAMES, 64.0f));
+  assertIntEquals(64, p->getSetting(p, PLUGIN_INITIAL_DELAY));
+  assertFalse(p->setParameter(p, PLUGIN_LATENCY_SETTINGS_FRAMES, -1.0f));
+  assertFalse(p->setParameter(p, PLUGIN_LATENCY_NUM_SETTINGS, 0.0f));
+
+  freePlugin(p);
+  return 0;
+}
+
+TestSuite addPluginLatencyTests(void);
+TestSuite addPluginLatencyTests(void) {
+  TestSuite testSuite = newTestSuite("PluginLatency", _pluginLatencyTestSetup,
+                                     _pluginLatencyTestTeardown);
+  addTest(testSuite, "InitialDelay", _testInitialDelay);
+  addTest(testSuite, "DelaysByLatency", _testDelaysByLatency);
+  addTest(testSuite, "ZeroLatencyPassesThrough", _testZeroLatencyPassesThrough);
+  addTest(testSuite, "SetParameter", _testSetParameter);
+  return testSuite;
+}
@@ -26,6 +26,9 @@
 
 #include "PluginMock.h"
 
+#include "base/FpuState.h"
+#include "midi/MidiEvent.h"
+
 static void _pluginMockEmpty(void *pluginPtr) {
   // Nothing to do here
 }
@@ -38,6 +41,9 @@ static boolByte _pluginMockOpen(void *pluginPtr) {
 }
 
 static int _pluginMockGetSetting(void *pluginPtr, PluginSetting pluginSetting) {
+  Plugin self = (Plugin)pluginPtr;
+  PluginMockData extraData = (PluginMockData)self->extraData;
+
   switch (pluginSetting) {
   case PLUGIN_SETTING_TAIL_TIME_IN_MS:
     return kPluginMockTailTime;
@@ -49,7 +55,7 @@ static int _pluginMockGetSetting(void *pluginPtr, PluginSetting pluginSetting) {
     return 2;
 
   case PLUGIN_INITIAL_DELAY:
-    return 0;
+    return extraData->initialDelay;
 
   default:
     return 0;
@@ -67,6 +73,7 @@ static void _pluginMockProcessAudio(void *pluginPtr, SampleBuffer inputs,
   Plugin self = (Plugin)pluginPtr;
   PluginMockData extraData = (PluginMockData)self->extraData;
   extraData->processAudioCalled = true;
+  extraData->flushedDenormals = fpuStateIsFlushingDenormals();
   sampleBufferClear(outputs);
 }
 
@@ -75,6 +82,7 @@ static void _pluginMockProcessMidiEvents(void *pluginPtr,
   Plugin self = (Plugin)pluginPtr;
   PluginMockData extraData = (PluginMockData)self->extraData;
   extraData->processMidiCalled = true;
+  extraData->midiDeltaFrames = ((MidiEvent)midiEvents->item)->deltaFrames;
 }
 
 static boolByte _pluginMockSetParameter(void *pluginPtr, unsigned int i,
@@ -108,7 +116,10 @@ Plugin newPluginMock(void) {
   extraData->isOpen = false;
   extraData->isPrepared = false;
   extraData->processAudioCalled = false;
+  extraData->flushedDenormals = false;
   extraData->processMidiCalled = false;
+  extraData->midiDeltaFrames = 0;
+  extraData->initialDelay = 0;
   plugin->extraData = extraData;
 
   return plugin;
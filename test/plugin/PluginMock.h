@@ -36,7 +36,12 @@ typedef struct {
   boolByte isOpen;
   boolByte isPrepared;
   boolByte processAudioCalled;
+  // Whether denormals were flushed during the last call to process audio
+  boolByte flushedDenormals;
   boolByte processMidiCalled;
+  // Offset of the first MIDI event in the last call to process MIDI events
+  unsigned long midiDeltaFrames;
+  int initialDelay;
 } PluginMockDataMembers;
 typedef PluginMockDataMembers *PluginMockData;
 
@@ -0,0 +1,127 @@
+//
+// PluginPresetCacheTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "plugin/PluginPresetCache.h"
+
+#include "unit/TestRunner.h"
+
+#include <string.h>
+
+static const unsigned long kPluginPresetCacheTestId = 0x61626364;
+static const byte kPluginPresetCacheTestChunk[] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+static void _pluginPresetCacheTestTeardown(void) { freePluginPresetCache(); }
+
+static int _testPluginPresetCacheDisabledByDefault(void) {
+  assertFalse(pluginPresetCacheIsEnabled());
+  assertFalse(pluginPresetCacheAdd(
+      kPluginPresetCacheTestId, 1, 2, 3, false, NULL,
+      kPluginPresetCacheTestChunk, sizeof(kPluginPresetCacheTestChunk)));
+  assertIsNull(pluginPresetCacheFind(kPluginPresetCacheTestId, 1, 2, 3));
+  return 0;
+}
+
+static int _testPluginPresetCacheHash(void) {
+  const byte data[] = {'a'};
+  // Reference values for 64-bit FNV-1a
+  assert(pluginPresetCacheHash(NULL, 0) == 0xcbf29ce484222325ull);
+  assert(pluginPresetCacheHash(data, 1) == 0xaf63dc4c8601ec8cull);
+  return 0;
+}
+
+static int _testPluginPresetCacheAddAndFind(void) {
+  CharString programName = newCharStringWithCString("test");
+  PluginPresetCacheEntry entry;
+
+  initPluginPresetCache(1024);
+  assert(pluginPresetCacheAdd(
+      kPluginPresetCacheTestId, 1, 2, 3, false, programName,
+      kPluginPresetCacheTestChunk, sizeof(kPluginPresetCacheTestChunk)));
+  entry = pluginPresetCacheFind(kPluginPresetCacheTestId, 1, 2, 3);
+  assertNotNull(entry);
+  assertFalse(entry->isBank);
+  assertCharStringEquals("test", entry->programName);
+  assertSizeEquals(sizeof(kPluginPresetCacheTestChunk), entry->chunkSize);
+  assertIntEquals(0, memcmp(kPluginPresetCacheTestChunk, entry->chunk,
+                            sizeof(kPluginPresetCacheTestChunk)));
+  assert(entry->chunk != kPluginPresetCacheTestChunk);
+
+  freeCharString(programName);
+  return 0;
+}
+
+static int _testPluginPresetCacheFindWithDifferentKey(void) {
+  initPluginPresetCache(1024);
+  assert(pluginPresetCacheAdd(
+      kPluginPresetCacheTestId, 1, 2, 3, true, NULL,
+      kPluginPresetCacheTestChunk, sizeof(kPluginPresetCacheTestChunk)));
+  assertIsNull(pluginPresetCacheFind(kPluginPresetCacheTestId + 1, 1, 2, 3));
+  assertIsNull(pluginPresetCacheFind(kPluginPresetCacheTestId, 2, 2, 3));
+  assertIsNull(pluginPresetCacheFind(kPluginPresetCacheTestId, 1, 3, 3));
+  assertIsNull(pluginPresetCacheFind(kPluginPresetCacheTestId, 1, 2, 4));
+  return 0;
+}
+
+static int _testPluginPresetCacheAddDuplicate(void) {
+  initPluginPresetCache(1024);
+  assert(pluginPresetCacheAdd(
+      kPluginPresetCacheTestId, 1, 2, 3, false, NULL,
+      kPluginPresetCacheTestChunk, sizeof(kPluginPresetCacheTestChunk)));
+  assertFalse(pluginPresetCacheAdd(
+      kPluginPresetCacheTestId, 1, 2, 3, false, NULL,
+      kPluginPresetCacheTestChunk, sizeof(kPluginPresetCacheTestChunk)));
+  assertSizeEquals(sizeof(kPluginPresetCacheTestChunk),
+                   pluginPresetCacheInstance->totalSize);
+  return 0;
+}
+
+static int _testPluginPresetCacheAddWhenFull(void) {
+  initPluginPresetCache(sizeof(kPluginPresetCacheTestChunk) + 1);
+  assert(pluginPresetCacheAdd(
+      kPluginPresetCacheTestId, 1, 2, 3, false, NULL,
+      kPluginPresetCacheTestChunk, sizeof(kPluginPresetCacheTestChunk)));
+  assertFalse(pluginPresetCacheAdd(
+      kPluginPresetCacheTestId, 1, 4, 3, false, NULL,
+      kPluginPresetCacheTestChunk, sizeof(kPluginPresetCacheTestChunk)));
+  assertIsNull(pluginPresetCacheFind(kPluginPresetCacheTestId, 1, 4, 3));
+  return 0;
+}
+
+TestSuite addPluginPresetCacheTests(void);
+TestSuite addPluginPresetCacheTests(void) {
+  TestSuite testSuite = newTestSuite("PluginPresetCache", NULL,
+                                     _pluginPresetCacheTestTeardown);
+  addTest(testSuite, "DisabledByDefault",
+          _testPluginPresetCacheDisabledByDefault);
+  addTest(testSuite, "Hash", _testPluginPresetCacheHash);
+  addTest(testSuite, "AddAndFind", _testPluginPresetCacheAddAndFind);
+  addTest(testSuite, "FindWithDifferentKey",
+          _testPluginPresetCacheFindWithDifferentKey);
+  addTest(testSuite, "AddDuplicate", _testPluginPresetCacheAddDuplicate);
+  addTest(testSuite, "AddWhenFull", _testPluginPresetCacheAddWhenFull);
+  return testSuite;
+}
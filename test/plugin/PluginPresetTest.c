@@ -41,6 +41,24 @@ static int _testGuessPluginPresetType(void) {
   return 0;
 }
 
+static int _testGuessPluginPresetTypeBank(void) {
+  CharString c = newCharStringWithCString("test.fxb");
+  PluginPreset p = pluginPresetFactory(c);
+  assertIntEquals(PRESET_TYPE_FXP, p->presetType);
+  freePluginPreset(p);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testGuessPluginPresetTypeImpulse(void) {
+  CharString c = newCharStringWithCString("room.wav");
+  PluginPreset p = pluginPresetFactory(c);
+  assertIntEquals(PRESET_TYPE_IMPULSE, p->presetType);
+  freePluginPreset(p);
+  freeCharString(c);
+  return 0;
+}
+
 static int _testGuessPluginPresetTypeInvalid(void) {
   CharString c = newCharStringWithCString("invalid");
   PluginPreset p = pluginPresetFactory(c);
@@ -92,6 +110,10 @@ TestSuite addPluginPresetTests(void);
 TestSuite addPluginPresetTests(void) {
   TestSuite testSuite = newTestSuite("PluginPreset", NULL, NULL);
   addTest(testSuite, "GuessPluginPresetType", _testGuessPluginPresetType);
+  addTest(testSuite, "GuessPluginPresetTypeBank",
+          _testGuessPluginPresetTypeBank);
+  addTest(testSuite, "GuessPluginPresetTypeImpulse",
+          _testGuessPluginPresetTypeImpulse);
   addTest(testSuite, "GuessPluginPresetTypeInvalid",
           _testGuessPluginPresetTypeInvalid);
   addTest(testSuite, "NewObject", _testNewObject);
@@ -0,0 +1,155 @@
+//
+// PluginProbeTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "plugin/PluginProbe.h"
+
+#include "PluginMock.h"
+#include "plugin/PluginPassthru.h"
+#include "unit/TestRunner.h"
+
+#include <math.h>
+
+static Plugin _newTestPassthru(void *userData) {
+  CharString pluginName = newCharStringWithCString("mrs_passthru");
+  Plugin result = newPluginPassthru(pluginName);
+  freeCharString(pluginName);
+  return result;
+}
+
+// Renders differently each time, like a plugin with a free-running LFO
+static void _processAudioCounting(void *pluginPtr, SampleBuffer inputs,
+                                  SampleBuffer outputs) {
+  static unsigned long numCalls = 0;
+  sampleBufferClear(outputs);
+  outputs->samples[0][0] = (Sample)(++numCalls % 100) / 100.0f;
+}
+
+static void _processAudioNan(void *pluginPtr, SampleBuffer inputs,
+                             SampleBuffer outputs) {
+  sampleBufferClear(outputs);
+  outputs->samples[0][0] = (Sample)NAN;
+}
+
+static PluginCapabilityState _probeOpenPlugin(Plugin plugin,
+                                              PluginProbeNewInstanceFunc func,
+                                              PluginCapability capability) {
+  PluginProbe probe;
+  PluginCapabilityState result;
+
+  openPlugin(plugin);
+  probe = newPluginProbe(plugin, func, NULL);
+  result = pluginProbeRun(probe, capability);
+  freePluginProbe(probe);
+  closePlugin(plugin);
+  freePlugin(plugin);
+  return result;
+}
+
+static int _testProbeDeterministic(void) {
+  assertIntEquals(PLUGIN_CAPABILITY_SUPPORTED,
+                  _probeOpenPlugin(_newTestPassthru(NULL), NULL,
+                                   PLUGIN_CAPABILITY_DETERMINISTIC));
+  return 0;
+}
+
+static int _testProbeNotDeterministic(void) {
+  Plugin plugin = newPluginMock();
+  plugin->processAudio = _processAudioCounting;
+  assertIntEquals(PLUGIN_CAPABILITY_UNSUPPORTED,
+                  _probeOpenPlugin(plugin, NULL,
+                                   PLUGIN_CAPABILITY_DETERMINISTIC));
+  return 0;
+}
+
+static int _testProbeParallelLoad(void) {
+  assertIntEquals(PLUGIN_CAPABILITY_SUPPORTED,
+                  _probeOpenPlugin(_newTestPassthru(NULL), _newTestPassthru,
+                                   PLUGIN_CAPABILITY_PARALLEL_LOAD));
+  return 0;
+}
+
+static int _testProbeMultiInstance(void) {
+  assertIntEquals(PLUGIN_CAPABILITY_SUPPORTED,
+                  _probeOpenPlugin(_newTestPassthru(NULL), _newTestPassthru,
+                                   PLUGIN_CAPABILITY_MULTI_INSTANCE));
+  return 0;
+}
+
+static int _testProbeWithoutNewInstance(void) {
+  assertIntEquals(PLUGIN_CAPABILITY_UNKNOWN,
+                  _probeOpenPlugin(_newTestPassthru(NULL), NULL,
+                                   PLUGIN_CAPABILITY_PARALLEL_LOAD));
+  assertIntEquals(PLUGIN_CAPABILITY_UNKNOWN,
+                  _probeOpenPlugin(_newTestPassthru(NULL), NULL,
+                                   PLUGIN_CAPABILITY_MULTI_INSTANCE));
+  return 0;
+}
+
+#if UNIX
+static int _testProbeForkSafe(void) {
+  assertIntEquals(PLUGIN_CAPABILITY_SUPPORTED,
+                  _probeOpenPlugin(_newTestPassthru(NULL), NULL,
+                                   PLUGIN_CAPABILITY_FORK_SAFE));
+  return 0;
+}
+#endif
+
+static int _testProbeOffline(void) {
+  assertIntEquals(PLUGIN_CAPABILITY_SUPPORTED,
+                  _probeOpenPlugin(_newTestPassthru(NULL), NULL,
+                                   PLUGIN_CAPABILITY_OFFLINE));
+  return 0;
+}
+
+static int _testProbeOfflineInvalidOutput(void) {
+  Plugin plugin = newPluginMock();
+  plugin->processAudio = _processAudioNan;
+  assertIntEquals(PLUGIN_CAPABILITY_UNSUPPORTED,
+                  _probeOpenPlugin(plugin, NULL, PLUGIN_CAPABILITY_OFFLINE));
+  return 0;
+}
+
+static int _testFreeNullPluginProbe(void) {
+  freePluginProbe(NULL);
+  return 0;
+}
+
+TestSuite addPluginProbeTests(void);
+TestSuite addPluginProbeTests(void) {
+  TestSuite testSuite = newTestSuite("PluginProbe", NULL, NULL);
+  addTest(testSuite, "ProbeDeterministic", _testProbeDeterministic);
+  addTest(testSuite, "ProbeNotDeterministic", _testProbeNotDeterministic);
+  addTest(testSuite, "ProbeParallelLoad", _testProbeParallelLoad);
+  addTest(testSuite, "ProbeMultiInstance", _testProbeMultiInstance);
+  addTest(testSuite, "ProbeWithoutNewInstance", _testProbeWithoutNewInstance);
+#if UNIX
+  addTest(testSuite, "ProbeForkSafe", _testProbeForkSafe);
+#endif
+  addTest(testSuite, "ProbeOffline", _testProbeOffline);
+  addTest(testSuite, "ProbeOfflineInvalidOutput",
+          _testProbeOfflineInvalidOutput);
+  addTest(testSuite, "FreeNullPluginProbe", _testFreeNullPluginProbe);
+  return testSuite;
+}
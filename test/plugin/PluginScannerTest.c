@@ -0,0 +1,261 @@
+//
+// PluginScannerTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "plugin/PluginScanner.h"
+
+#include "unit/TestRunner.h"
+
+static const unsigned long kPluginScannerTestId = 0x61626364;
+
+static int _testParseResult(void) {
+  PluginIndexEntry entry = newPluginIndexEntry("Plugin", 0);
+  CharString output =
+      newCharStringWithCString("PLUGIN\t3\t1633837924\t0\t2\n");
+
+  assert(pluginScannerParseResult(entry, output));
+  assert(entry->scanned);
+  assertIntEquals(PLUGIN_TYPE_INSTRUMENT, entry->pluginType);
+  assertUnsignedLongEquals(kPluginScannerTestId, entry->pluginId->id);
+  assertIntEquals(0, entry->numInputs);
+  assertIntEquals(2, entry->numOutputs);
+  assertIntEquals(0, linkedListLength(entry->shellPlugins));
+
+  freeCharString(output);
+  freePluginIndexEntry(entry);
+  return 0;
+}
+
+static int _testParseResultWithOtherOutput(void) {
+  PluginIndexEntry entry = newPluginIndexEntry("Plugin", 0);
+  CharString output = newCharStringWithCString(
+      "Plugin says hi\nPLUGIN\t2\t1633837924\t2\t2\r\nPLUGINS are great\n");
+
+  assert(pluginScannerParseResult(entry, output));
+  assertIntEquals(PLUGIN_TYPE_EFFECT, entry->pluginType);
+  assertIntEquals(2, entry->numInputs);
+
+  freeCharString(output);
+  freePluginIndexEntry(entry);
+  return 0;
+}
+
+static int _testParseResultWithShellPlugins(void) {
+  PluginIndexEntry entry = newPluginIndexEntry("Plugin", 0);
+  CharString output = newCharStringWithCString(
+      "PLUGIN\t2\t1633837924\t2\t2\nSHELL\t1937072689\tSub One\r\n"
+      "SHELL\t1937072690\tSub Two\n");
+  PluginIndexShellPlugin shellPlugin;
+
+  assert(pluginScannerParseResult(entry, output));
+  assertIntEquals(2, linkedListLength(entry->shellPlugins));
+  shellPlugin = (PluginIndexShellPlugin)entry->shellPlugins->item;
+  assertCharStringEquals("sub1", shellPlugin->pluginId->idString);
+  assertCharStringEquals("Sub One", shellPlugin->name);
+
+  freeCharString(output);
+  freePluginIndexEntry(entry);
+  return 0;
+}
+
+static int _testParseResultWithCapabilities(void) {
+  PluginIndexEntry entry = newPluginIndexEntry("Plugin", 0);
+  CharString output = newCharStringWithCString(
+      "PLUGIN\t2\t1633837924\t2\t2\nPROBE\tdeterministic\n"
+      "CAPABILITY\tdeterministic\tyes\nPROBE\tfork-safe\n"
+      "CAPABILITY\tfork-safe\tno\nPROBE\toffline\n");
+
+  assert(pluginScannerParseResult(entry, output));
+  assertIntEquals(PLUGIN_CAPABILITY_SUPPORTED,
+                  entry->capabilities->states[PLUGIN_CAPABILITY_DETERMINISTIC]);
+  assertIntEquals(PLUGIN_CAPABILITY_UNSUPPORTED,
+                  entry->capabilities->states[PLUGIN_CAPABILITY_FORK_SAFE]);
+  // The plugin stopped while this was probed
+  assertIntEquals(PLUGIN_CAPABILITY_UNSUPPORTED,
+                  entry->capabilities->states[PLUGIN_CAPABILITY_OFFLINE]);
+  assertIntEquals(PLUGIN_CAPABILITY_UNKNOWN,
+                  entry->capabilities->states[PLUGIN_CAPABILITY_PARALLEL_LOAD]);
+
+  freeCharString(output);
+  freePluginIndexEntry(entry);
+  return 0;
+}
+
+static int _testParseEmptyResult(void) {
+  PluginIndexEntry entry = newPluginIndexEntry("Plugin", 0);
+  CharString output = newCharStringWithCString("SHELL\t1937072689\tSub\n");
+
+  assertFalse(pluginScannerParseResult(entry, output));
+  assertFalse(entry->scanned);
+  assertIntEquals(0, linkedListLength(entry->shellPlugins));
+
+  freeCharString(output);
+  freePluginIndexEntry(entry);
+  return 0;
+}
+
+#if UNIX
+static PluginScanner _newShellScanner(const char *script,
+                                      unsigned int numJobs,
+                                      double timeoutInMs) {
+  CharString executable = newCharStringWithCString("/bin/sh");
+  LinkedList arguments = newLinkedList();
+  PluginScanner result;
+
+  // The plugin path is passed to the script as $1
+  linkedListAppend(arguments, newCharStringWithCString("-c"));
+  linkedListAppend(arguments, newCharStringWithCString(script));
+  linkedListAppend(arguments, newCharStringWithCString("sh"));
+  result = newPluginScanner(executable, arguments, numJobs, timeoutInMs);
+
+  freeLinkedListAndItems(arguments, (LinkedListFreeItemFunc)freeCharString);
+  freeCharString(executable);
+  return result;
+}
+
+static int _testRunScansAllPlugins(void) {
+  PluginScanner s = _newShellScanner(
+      "printf 'PLUGIN\\t2\\t1633837924\\t%d\\t2\\n' ${#1}", 2, 10000.0);
+  PluginIndexEntry entries[3];
+  CharString path = newCharString();
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    entries[i] = newPluginIndexEntry("Plugin", 0);
+    // Use the path length to check that each entry gets its own result
+    charStringAppendCString(path, "x");
+    pluginScannerAdd(s, path, entries[i]);
+  }
+
+  assertUnsignedLongEquals(3ul, (unsigned long)pluginScannerRun(s));
+  for (i = 0; i < 3; i++) {
+    assert(entries[i]->scanned);
+    assertIntEquals(PLUGIN_TYPE_EFFECT, entries[i]->pluginType);
+    assertIntEquals(i + 1, entries[i]->numInputs);
+    freePluginIndexEntry(entries[i]);
+  }
+
+  freeCharString(path);
+  freePluginScanner(s);
+  return 0;
+}
+
+static int _testRunCrashedPlugin(void) {
+  PluginScanner s = _newShellScanner("kill -9 $$", 1, 10000.0);
+  PluginIndexEntry entry = newPluginIndexEntry("Plugin", 0);
+  CharString path = newCharStringWithCString("crash");
+
+  pluginScannerAdd(s, path, entry);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           (unsigned long)pluginScannerRun(s));
+  assert(entry->scanned);
+  assertIntEquals(PLUGIN_TYPE_UNSUPPORTED, entry->pluginType);
+
+  freeCharString(path);
+  freePluginIndexEntry(entry);
+  freePluginScanner(s);
+  return 0;
+}
+
+static int _testRunPluginCrashedWhileProbing(void) {
+  PluginScanner s = _newShellScanner(
+      "printf 'PLUGIN\\t2\\t1633837924\\t2\\t2\\nPROBE\\tfork-safe\\n'; "
+      "kill -9 $$",
+      1, 10000.0);
+  PluginIndexEntry entry = newPluginIndexEntry("Plugin", 0);
+  CharString path = newCharStringWithCString("crash");
+
+  pluginScannerAdd(s, path, entry);
+  assertUnsignedLongEquals(1ul, (unsigned long)pluginScannerRun(s));
+  assert(entry->scanned);
+  assertIntEquals(PLUGIN_TYPE_EFFECT, entry->pluginType);
+  assertIntEquals(PLUGIN_CAPABILITY_UNSUPPORTED,
+                  entry->capabilities->states[PLUGIN_CAPABILITY_FORK_SAFE]);
+
+  freeCharString(path);
+  freePluginIndexEntry(entry);
+  freePluginScanner(s);
+  return 0;
+}
+
+static int _testRunTimedOutPlugin(void) {
+  PluginScanner s = _newShellScanner("sleep 10", 1, 50.0);
+  PluginIndexEntry entry = newPluginIndexEntry("Plugin", 0);
+  CharString path = newCharStringWithCString("hang");
+
+  pluginScannerAdd(s, path, entry);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           (unsigned long)pluginScannerRun(s));
+  assert(entry->scanned);
+  assertIntEquals(PLUGIN_TYPE_UNSUPPORTED, entry->pluginType);
+
+  freeCharString(path);
+  freePluginIndexEntry(entry);
+  freePluginScanner(s);
+  return 0;
+}
+#endif
+
+static int _testRunWithoutPlugins(void) {
+  CharString executable = newCharStringWithCString("invalid");
+  LinkedList arguments = newLinkedList();
+  PluginScanner s = newPluginScanner(executable, arguments, 4, 1000.0);
+
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           (unsigned long)pluginScannerRun(s));
+
+  freePluginScanner(s);
+  freeLinkedList(arguments);
+  freeCharString(executable);
+  return 0;
+}
+
+static int _testFreeNullPluginScanner(void) {
+  freePluginScanner(NULL);
+  return 0;
+}
+
+TestSuite addPluginScannerTests(void);
+TestSuite addPluginScannerTests(void) {
+  TestSuite testSuite = newTestSuite("PluginScanner", NULL, NULL);
+  addTest(testSuite, "ParseResult", _testParseResult);
+  addTest(testSuite, "ParseResultWithOtherOutput",
+          _testParseResultWithOtherOutput);
+  addTest(testSuite, "ParseResultWithShellPlugins",
+          _testParseResultWithShellPlugins);
+  addTest(testSuite, "ParseResultWithCapabilities",
+          _testParseResultWithCapabilities);
+  addTest(testSuite, "ParseEmptyResult", _testParseEmptyResult);
+#if UNIX
+  addTest(testSuite, "RunScansAllPlugins", _testRunScansAllPlugins);
+  addTest(testSuite, "RunCrashedPlugin", _testRunCrashedPlugin);
+  addTest(testSuite, "RunPluginCrashedWhileProbing",
+          _testRunPluginCrashedWhileProbing);
+  addTest(testSuite, "RunTimedOutPlugin", _testRunTimedOutPlugin);
+#endif
+  addTest(testSuite, "RunWithoutPlugins", _testRunWithoutPlugins);
+  addTest(testSuite, "FreeNullPluginScanner", _testFreeNullPluginScanner);
+  return testSuite;
+}
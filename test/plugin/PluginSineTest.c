@@ -0,0 +1,159 @@
+//
+// PluginSineTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "plugin/PluginSine.h"
+
+#include "audio/AudioSettings.h"
+#include "audio/SampleBuffer.h"
+#include "midi/MidiEvent.h"
+#include "unit/TestRunner.h"
+
+#include <math.h>
+
+static void _pluginSineTestSetup(void) { initAudioSettings(); }
+
+static void _pluginSineTestTeardown(void) { freeAudioSettings(); }
+
+static Plugin _newTestSine(void) {
+  CharString name = newCharStringWithCString(kInternalPluginSineName);
+  Plugin plugin = newPluginSine(name);
+  freeCharString(name);
+  plugin->prepareForProcessing(plugin);
+  return plugin;
+}
+
+static void _sendEvent(Plugin plugin, unsigned long deltaFrames, byte status,
+                       byte data1, byte data2) {
+  LinkedList midiEvents = newLinkedList();
+  MidiEvent midiEvent = newMidiEvent();
+
+  midiEvent->eventType = MIDI_TYPE_REGULAR;
+  midiEvent->deltaFrames = deltaFrames;
+  midiEvent->status = status;
+  midiEvent->data1 = data1;
+  midiEvent->data2 = data2;
+  linkedListAppend(midiEvents, midiEvent);
+  plugin->processMidiEvents(plugin, midiEvents);
+  freeLinkedListAndItems(midiEvents, (LinkedListFreeItemFunc)freeMidiEvent);
+}
+
+static Sample _getPeak(SampleBuffer buffer, ChannelCount channel,
+                       SampleCount start, SampleCount end) {
+  Sample peak = 0.0f;
+  SampleCount i;
+
+  for (i = start; i < end; i++) {
+    if (fabsf(buffer->samples[channel][i]) > peak) {
+      peak = fabsf(buffer->samples[channel][i]);
+    }
+  }
+
+  return peak;
+}
+
+static int _testSilentWithoutNotes(void) {
+  Plugin p = _newTestSine();
+  SampleBuffer outputs = newSampleBuffer(2, getBlocksize());
+
+  p->processAudio(p, NULL, outputs);
+  assertDoubleEquals(0.0, _getPeak(outputs, 0, 0, outputs->blocksize),
+                     TEST_EXACT_TOLERANCE);
+
+  freeSampleBuffer(outputs);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testNoteOnStartsAtDeltaFrames(void) {
+  Plugin p = _newTestSine();
+  SampleBuffer outputs = newSampleBuffer(2, getBlocksize());
+
+  _sendEvent(p, 100, 0x90, 69, 127);
+  p->processAudio(p, NULL, outputs);
+
+  assertDoubleEquals(0.0, _getPeak(outputs, 0, 0, 100), TEST_EXACT_TOLERANCE);
+  assert(_getPeak(outputs, 0, 100, outputs->blocksize) > 0.1f);
+  assert(_getPeak(outputs, 0, 100, outputs->blocksize) <= 0.25f);
+  assertDoubleEquals(_getPeak(outputs, 0, 0, outputs->blocksize),
+                     _getPeak(outputs, 1, 0, outputs->blocksize),
+                     TEST_EXACT_TOLERANCE);
+
+  freeSampleBuffer(outputs);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testNoteOffReleasesVoice(void) {
+  Plugin p = _newTestSine();
+  SampleBuffer outputs = newSampleBuffer(2, getBlocksize());
+
+  _sendEvent(p, 0, 0x90, 60, 100);
+  p->processAudio(p, NULL, outputs);
+  // Note on with zero velocity is also a note off
+  _sendEvent(p, 0, 0x90, 60, 0);
+  p->processAudio(p, NULL, outputs);
+
+  // The release is much shorter than one block
+  assertDoubleEquals(0.0,
+                     _getPeak(outputs, 0, outputs->blocksize / 2,
+                              outputs->blocksize),
+                     TEST_EXACT_TOLERANCE);
+
+  freeSampleBuffer(outputs);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testAllNotesOff(void) {
+  Plugin p = _newTestSine();
+  SampleBuffer outputs = newSampleBuffer(2, getBlocksize());
+
+  _sendEvent(p, 0, 0x90, 60, 100);
+  _sendEvent(p, 0, 0x90, 64, 100);
+  p->processAudio(p, NULL, outputs);
+  _sendEvent(p, 0, 0xb0, 0x7b, 0);
+  p->processAudio(p, NULL, outputs);
+
+  assertDoubleEquals(0.0,
+                     _getPeak(outputs, 0, outputs->blocksize / 2,
+                              outputs->blocksize),
+                     TEST_EXACT_TOLERANCE);
+
+  freeSampleBuffer(outputs);
+  freePlugin(p);
+  return 0;
+}
+
+TestSuite addPluginSineTests(void);
+TestSuite addPluginSineTests(void) {
+  TestSuite testSuite = newTestSuite("PluginSine", _pluginSineTestSetup,
+                                     _pluginSineTestTeardown);
+  addTest(testSuite, "SilentWithoutNotes", _testSilentWithoutNotes);
+  addTest(testSuite, "NoteOnStartsAtDeltaFrames",
+          _testNoteOnStartsAtDeltaFrames);
+  addTest(testSuite, "NoteOffReleasesVoice", _testNoteOffReleasesVoice);
+  addTest(testSuite, "AllNotesOff", _testAllNotesOff);
+  return testSuite;
+}
@@ -93,6 +93,29 @@ static int _testPluginFactoryNullRoot(void) {
   return 0;
 }
 
+static int _testPluginFactoryInternalPlugins(void) {
+  const char *names[] = {"mrs_cpuload", "mrs_gain",   "mrs_latency",
+                         "mrs_limiter", "mrs_passthru", "mrs_silence",
+                         "mrs_sine",    "mrs_timequery"};
+  CharString pluginName = newCharString();
+  CharString pluginRoot = newCharString();
+  Plugin p;
+  size_t i;
+
+  for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    charStringCopyCString(pluginName, names[i]);
+    p = pluginFactory(pluginName, pluginRoot);
+    assertNotNull(p);
+    assertIntEquals(PLUGIN_TYPE_INTERNAL, p->interfaceType);
+    assertCharStringEquals(names[i], p->pluginName);
+    freePlugin(p);
+  }
+
+  freeCharString(pluginName);
+  freeCharString(pluginRoot);
+  return 0;
+}
+
 static int _testFreeNullPlugin(void) {
   freePlugin(NULL);
   return 0;
@@ -109,6 +132,8 @@ TestSuite addPluginTests(void) {
   addTest(testSuite, "PluginFactoryEmptyPluginName",
           _testPluginFactoryEmptyPluginName);
   addTest(testSuite, "PluginFactoryNullRoot", _testPluginFactoryNullRoot);
+  addTest(testSuite, "PluginFactoryInternalPlugins",
+          _testPluginFactoryInternalPlugins);
   addTest(testSuite, "FreeNullPlugin", _testFreeNullPlugin);
   return testSuite;
 }
@@ -0,0 +1,173 @@
+//
+// PluginTruePeakLimiterTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "plugin/PluginTruePeakLimiter.h"
+
+#include "audio/AudioSettings.h"
+#include "audio/SampleBuffer.h"
+#include "unit/TestRunner.h"
+
+#include <math.h>
+
+static const Sample kTruePeakLimiterTestCeiling = 0.891251f;
+
+static void _pluginTruePeakLimiterTestSetup(void) { initAudioSettings(); }
+
+static void _pluginTruePeakLimiterTestTeardown(void) { freeAudioSettings(); }
+
+static Plugin _newTestLimiter(void) {
+  CharString name =
+      newCharStringWithCString(kInternalPluginTruePeakLimiterName);
+  Plugin plugin = newPluginTruePeakLimiter(name);
+  freeCharString(name);
+  plugin->prepareForProcessing(plugin);
+  return plugin;
+}
+
+static int _testInitialDelay(void) {
+  Plugin p = _newTestLimiter();
+  // 1.5ms lookahead at 44.1kHz, less one frame, plus the filter delay
+  assertIntEquals(71, p->getSetting(p, PLUGIN_INITIAL_DELAY));
+  freePlugin(p);
+  return 0;
+}
+
+static int _testQuietSignalIsOnlyDelayed(void) {
+  Plugin p = _newTestLimiter();
+  SampleBuffer inputs = newSampleBuffer(2, getBlocksize());
+  SampleBuffer outputs = newSampleBuffer(2, getBlocksize());
+  const int delay = p->getSetting(p, PLUGIN_INITIAL_DELAY);
+  SampleCount i;
+
+  for (i = 0; i < inputs->blocksize; i++) {
+    inputs->samples[0][i] = 0.5f * sinf((float)i * 0.01f);
+    inputs->samples[1][i] = -inputs->samples[0][i];
+  }
+
+  p->processAudio(p, inputs, outputs);
+
+  for (i = 0; i < (SampleCount)delay; i++) {
+    assertDoubleEquals(0.0, outputs->samples[0][i], TEST_EXACT_TOLERANCE);
+  }
+
+  for (i = (SampleCount)delay; i < outputs->blocksize; i++) {
+    assertDoubleEquals(inputs->samples[0][i - delay], outputs->samples[0][i],
+                       TEST_EXACT_TOLERANCE);
+    assertDoubleEquals(inputs->samples[1][i - delay], outputs->samples[1][i],
+                       TEST_EXACT_TOLERANCE);
+  }
+
+  freeSampleBuffer(inputs);
+  freeSampleBuffer(outputs);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testLimitsSamplePeaks(void) {
+  Plugin p = _newTestLimiter();
+  SampleBuffer inputs = newSampleBuffer(1, getBlocksize());
+  SampleBuffer outputs = newSampleBuffer(1, getBlocksize());
+  SampleCount i;
+
+  // The interpolation overshoots at a sudden jump, which would otherwise keep
+  // the gain down for the whole release time
+  p->setParameter(p, PLUGIN_TRUE_PEAK_LIMITER_SETTINGS_RELEASE, 0.0f);
+
+  // A sudden jump must already be limited when it reaches the output
+  for (i = 0; i < inputs->blocksize; i++) {
+    inputs->samples[0][i] = i < 100 ? 0.1f : 2.0f;
+  }
+
+  p->processAudio(p, inputs, outputs);
+
+  for (i = 0; i < outputs->blocksize; i++) {
+    assert(outputs->samples[0][i] <= kTruePeakLimiterTestCeiling + 0.0001f);
+  }
+
+  assertDoubleEquals(kTruePeakLimiterTestCeiling,
+                     outputs->samples[0][outputs->blocksize - 1],
+                     TEST_DEFAULT_TOLERANCE);
+
+  freeSampleBuffer(inputs);
+  freeSampleBuffer(outputs);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testLimitsIntersamplePeaks(void) {
+  Plugin p = _newTestLimiter();
+  SampleBuffer inputs = newSampleBuffer(1, getBlocksize());
+  SampleBuffer outputs = newSampleBuffer(1, getBlocksize());
+  // A sine at a quarter of the sample rate, sampled at 45 degrees, never has a
+  // sample above 0.707 even though its peaks are at 1
+  const Sample samplePeak = 0.707107f;
+  SampleCount i;
+
+  for (i = 0; i < inputs->blocksize; i++) {
+    inputs->samples[0][i] = (i / 2) % 2 == 0 ? samplePeak : -samplePeak;
+  }
+
+  p->processAudio(p, inputs, outputs);
+
+  for (i = outputs->blocksize / 2; i < outputs->blocksize; i++) {
+    assert(fabsf(outputs->samples[0][i]) <
+           samplePeak * kTruePeakLimiterTestCeiling);
+  }
+
+  freeSampleBuffer(inputs);
+  freeSampleBuffer(outputs);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testSetParameter(void) {
+  Plugin p = _newTestLimiter();
+  PluginTruePeakLimiterSettings settings =
+      (PluginTruePeakLimiterSettings)p->extraData;
+
+  assert(p->setParameter(p, PLUGIN_TRUE_PEAK_LIMITER_SETTINGS_CEILING, -6.0f));
+  assertDoubleEquals(0.501187, settings->ceiling, TEST_DEFAULT_TOLERANCE);
+  assert(p->setParameter(p, PLUGIN_TRUE_PEAK_LIMITER_SETTINGS_RELEASE, 100.0f));
+  assertFalse(
+      p->setParameter(p, PLUGIN_TRUE_PEAK_LIMITER_SETTINGS_RELEASE, -1.0f));
+  assertFalse(p->setParameter(p, PLUGIN_TRUE_PEAK_LIMITER_NUM_SETTINGS, 0.0f));
+
+  freePlugin(p);
+  return 0;
+}
+
+TestSuite addPluginTruePeakLimiterTests(void);
+TestSuite addPluginTruePeakLimiterTests(void) {
+  TestSuite testSuite =
+      newTestSuite("PluginTruePeakLimiter", _pluginTruePeakLimiterTestSetup,
+                   _pluginTruePeakLimiterTestTeardown);
+  addTest(testSuite, "InitialDelay", _testInitialDelay);
+  addTest(testSuite, "QuietSignalIsOnlyDelayed", _testQuietSignalIsOnlyDelayed);
+  addTest(testSuite, "LimitsSamplePeaks", _testLimitsSamplePeaks);
+  addTest(testSuite, "LimitsIntersamplePeaks", _testLimitsIntersamplePeaks);
+  addTest(testSuite, "SetParameter", _testSetParameter);
+  return testSuite;
+}
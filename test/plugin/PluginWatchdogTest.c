@@ -0,0 +1,242 @@
+//
+// PluginWatchdogTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "plugin/PluginWatchdog.h"
+
+#include "unit/TestRunner.h"
+
+#include "PluginMock.h"
+
+static Plugin _lastExpiredPlugin = NULL;
+static unsigned long _lastExpiredBlockIndex = 0;
+static unsigned int _numExpiredCalls = 0;
+
+static void _pluginWatchdogTestSetup(void) {
+  initPluginChain();
+  _lastExpiredPlugin = NULL;
+  _lastExpiredBlockIndex = 0;
+  _numExpiredCalls = 0;
+}
+
+static void _pluginWatchdogTestTeardown(void) {
+  freePluginChain(getPluginChain());
+}
+
+static void _pluginWatchdogTestExpired(const PluginChain pluginChain,
+                                       const Plugin plugin,
+                                       unsigned long blockIndex,
+                                       double elapsedTimeInMs,
+                                       void *userData) {
+  _lastExpiredPlugin = plugin;
+  _lastExpiredBlockIndex = blockIndex;
+  _numExpiredCalls++;
+}
+
+static PluginChain _newTestPluginChain(unsigned int numPlugins) {
+  PluginChain pluginChain = getPluginChain();
+  unsigned int i;
+
+  for (i = 0; i < numPlugins; i++) {
+    pluginChainAppend(pluginChain, newPluginMock(), NULL);
+  }
+
+  pluginChainInitialize(pluginChain);
+  return pluginChain;
+}
+
+static int _testNewPluginWatchdog(void) {
+  PluginChain pluginChain = _newTestPluginChain(2);
+  PluginWatchdog w = newPluginWatchdog(pluginChain, 100.0,
+                                       _pluginWatchdogTestExpired, NULL);
+
+  assertNotNull(w);
+  assert(w->pluginChain == pluginChain);
+  assertDoubleEquals(100.0, w->budgetInMs, TEST_DEFAULT_TOLERANCE);
+  assertFalse(w->expired);
+  assertIntEquals(4, w->_numWatched);
+
+  freePluginWatchdog(w);
+  return 0;
+}
+
+static int _testCheckIdlePluginChain(void) {
+  PluginChain pluginChain = _newTestPluginChain(1);
+  PluginWatchdog w = newPluginWatchdog(pluginChain, 10.0,
+                                       _pluginWatchdogTestExpired, NULL);
+
+  assertFalse(pluginWatchdogCheck(w, 0.0));
+  assertFalse(pluginWatchdogCheck(w, 1000.0));
+  assertIntEquals(0, _numExpiredCalls);
+
+  freePluginWatchdog(w);
+  return 0;
+}
+
+static int _testCheckWithinBudget(void) {
+  PluginChain pluginChain = _newTestPluginChain(1);
+  PluginWatchdog w = newPluginWatchdog(pluginChain, 10.0,
+                                       _pluginWatchdogTestExpired, NULL);
+
+  taskTimerStart(pluginChain->audioTimers[0]);
+  assertFalse(pluginWatchdogCheck(w, 0.0));
+  assertFalse(pluginWatchdogCheck(w, 5.0));
+  assertFalse(pluginWatchdogCheck(w, 10.0));
+  assertIntEquals(0, _numExpiredCalls);
+
+  taskTimerStop(pluginChain->audioTimers[0]);
+  freePluginWatchdog(w);
+  return 0;
+}
+
+static int _testCheckHungPlugin(void) {
+  PluginChain pluginChain = _newTestPluginChain(2);
+  PluginWatchdog w = newPluginWatchdog(pluginChain, 10.0,
+                                       _pluginWatchdogTestExpired, NULL);
+  const unsigned long expectedBlockIndex = 1;
+
+  // Finish one block, then hang in the second plugin on the next one
+  taskTimerStart(pluginChain->audioTimers[1]);
+  taskTimerStop(pluginChain->audioTimers[1]);
+  taskTimerStart(pluginChain->audioTimers[1]);
+  assertFalse(pluginWatchdogCheck(w, 0.0));
+  assert(pluginWatchdogCheck(w, 20.0));
+
+  assertIntEquals(1, _numExpiredCalls);
+  assert(_lastExpiredPlugin == pluginChain->plugins[1]);
+  assertUnsignedLongEquals(expectedBlockIndex, _lastExpiredBlockIndex);
+  assert(w->expired);
+
+  taskTimerStop(pluginChain->audioTimers[1]);
+  freePluginWatchdog(w);
+  return 0;
+}
+
+static int _testCheckHungPluginMidi(void) {
+  PluginChain pluginChain = _newTestPluginChain(1);
+  PluginWatchdog w = newPluginWatchdog(pluginChain, 10.0,
+                                       _pluginWatchdogTestExpired, NULL);
+
+  taskTimerStart(pluginChain->midiTimers[0]);
+  assertFalse(pluginWatchdogCheck(w, 0.0));
+  assert(pluginWatchdogCheck(w, 20.0));
+  assert(_lastExpiredPlugin == pluginChain->plugins[0]);
+
+  taskTimerStop(pluginChain->midiTimers[0]);
+  freePluginWatchdog(w);
+  return 0;
+}
+
+static int _testCheckNewBlockResetsBudget(void) {
+  PluginChain pluginChain = _newTestPluginChain(1);
+  PluginWatchdog w = newPluginWatchdog(pluginChain, 10.0,
+                                       _pluginWatchdogTestExpired, NULL);
+
+  // Each block is short, but the timer is always running when checked
+  taskTimerStart(pluginChain->audioTimers[0]);
+  assertFalse(pluginWatchdogCheck(w, 0.0));
+  taskTimerStop(pluginChain->audioTimers[0]);
+  taskTimerStart(pluginChain->audioTimers[0]);
+  assertFalse(pluginWatchdogCheck(w, 8.0));
+  taskTimerStop(pluginChain->audioTimers[0]);
+  taskTimerStart(pluginChain->audioTimers[0]);
+  assertFalse(pluginWatchdogCheck(w, 16.0));
+  assertIntEquals(0, _numExpiredCalls);
+
+  taskTimerStop(pluginChain->audioTimers[0]);
+  freePluginWatchdog(w);
+  return 0;
+}
+
+static int _testCheckExpiresOnlyOnce(void) {
+  PluginChain pluginChain = _newTestPluginChain(1);
+  PluginWatchdog w = newPluginWatchdog(pluginChain, 10.0,
+                                       _pluginWatchdogTestExpired, NULL);
+
+  taskTimerStart(pluginChain->audioTimers[0]);
+  assertFalse(pluginWatchdogCheck(w, 0.0));
+  assert(pluginWatchdogCheck(w, 20.0));
+  assert(pluginWatchdogCheck(w, 40.0));
+  assertIntEquals(1, _numExpiredCalls);
+
+  taskTimerStop(pluginChain->audioTimers[0]);
+  freePluginWatchdog(w);
+  return 0;
+}
+
+static int _testStartWithHungPlugin(void) {
+  PluginChain pluginChain = _newTestPluginChain(1);
+  PluginWatchdog w = newPluginWatchdog(pluginChain, 5.0,
+                                       _pluginWatchdogTestExpired, NULL);
+
+  taskTimerStart(pluginChain->audioTimers[0]);
+  assert(pluginWatchdogStart(w));
+  taskTimerSleep(100.0);
+  pluginWatchdogStop(w);
+
+  assert(w->expired);
+  assertIntEquals(1, _numExpiredCalls);
+
+  taskTimerStop(pluginChain->audioTimers[0]);
+  freePluginWatchdog(w);
+  return 0;
+}
+
+static int _testStartAndStop(void) {
+  PluginChain pluginChain = _newTestPluginChain(1);
+  PluginWatchdog w = newPluginWatchdog(pluginChain, 5.0,
+                                       _pluginWatchdogTestExpired, NULL);
+
+  assert(pluginWatchdogStart(w));
+  taskTimerSleep(20.0);
+  pluginWatchdogStop(w);
+  assertFalse(w->expired);
+
+  freePluginWatchdog(w);
+  return 0;
+}
+
+static int _testFreeNullPluginWatchdog(void) {
+  freePluginWatchdog(NULL);
+  return 0;
+}
+
+TestSuite addPluginWatchdogTests(void);
+TestSuite addPluginWatchdogTests(void) {
+  TestSuite testSuite = newTestSuite("PluginWatchdog", _pluginWatchdogTestSetup,
+                                     _pluginWatchdogTestTeardown);
+  addTest(testSuite, "NewObject", _testNewPluginWatchdog);
+  addTest(testSuite, "CheckIdlePluginChain", _testCheckIdlePluginChain);
+  addTest(testSuite, "CheckWithinBudget", _testCheckWithinBudget);
+  addTest(testSuite, "CheckHungPlugin", _testCheckHungPlugin);
+  addTest(testSuite, "CheckHungPluginMidi", _testCheckHungPluginMidi);
+  addTest(testSuite, "CheckNewBlockResetsBudget",
+          _testCheckNewBlockResetsBudget);
+  addTest(testSuite, "CheckExpiresOnlyOnce", _testCheckExpiresOnlyOnce);
+  addTest(testSuite, "StartWithHungPlugin", _testStartWithHungPlugin);
+  addTest(testSuite, "StartAndStop", _testStartAndStop);
+  addTest(testSuite, "FreeNull", _testFreeNullPluginWatchdog);
+  return testSuite;
+}
@@ -26,6 +26,7 @@
 
 #include "time/AudioClock.h"
 
+#include "audio/AudioSettings.h"
 #include "unit/TestRunner.h"
 
 static const unsigned long kAudioClockTestBlocksize = 256;
@@ -86,6 +87,127 @@ static int _testAdvanceClockMulitpleTimes(void) {
   return 0;
 }
 
+static int _testResetAudioClock(void) {
+  AudioClock audioClock = getAudioClock();
+  advanceAudioClock(audioClock, kAudioClockTestBlocksize);
+  advanceAudioClock(audioClock, kAudioClockTestBlocksize);
+  audioClockReset(audioClock);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, audioClock->currentFrame);
+  assertFalse(audioClock->isPlaying);
+  assert(audioClock->transportChanged);
+  return 0;
+}
+
+static int _testGetAudioClockPosition(void) {
+  AudioClock audioClock = getAudioClock();
+  AudioClockPosition position;
+
+  initAudioSettings();
+  // Five and a half beats at 120 BPM, which is in the second bar of 4/4
+  advanceAudioClock(audioClock, (unsigned long)(DEFAULT_SAMPLE_RATE * 2.75));
+  position = audioClockGetPosition(audioClock);
+  assertDoubleEquals(DEFAULT_TEMPO, position->tempo, TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(6.5, position->ppqPosition, TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(5.0, position->barStartPosition, TEST_DEFAULT_TOLERANCE);
+  assertIntEquals(4, position->timeSignatureBeatsPerMeasure);
+  // The position is not recalculated until the clock moves
+  assert(position == audioClockGetPosition(audioClock));
+
+  setTempo(60.0f);
+  audioClockInvalidatePosition(audioClock);
+  position = audioClockGetPosition(audioClock);
+  assertDoubleEquals(3.75, position->ppqPosition, TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(1.0, position->barStartPosition, TEST_DEFAULT_TOLERANCE);
+
+  freeAudioSettings();
+  return 0;
+}
+
+static int _testTempoChangeIsSampleAccurate(void) {
+  AudioClock audioClock = getAudioClock();
+  AudioClockPositionMembers position;
+  const unsigned long oneSecond = (unsigned long)DEFAULT_SAMPLE_RATE;
+
+  initAudioSettings();
+  // Two beats at 120 BPM, then the tempo halves
+  audioClockAddTempoChange(audioClock, oneSecond, 60.0);
+  setTempo(60.0);
+
+  audioClockGetPositionAtFrame(audioClock, oneSecond / 2, &position);
+  assertDoubleEquals(DEFAULT_TEMPO, position.tempo, TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(2.0, position.ppqPosition, TEST_DEFAULT_TOLERANCE);
+  audioClockGetPositionAtFrame(audioClock, oneSecond * 3, &position);
+  assertDoubleEquals(60.0, position.tempo, TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(5.0, position.ppqPosition, TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(5.0, position.barStartPosition, TEST_DEFAULT_TOLERANCE);
+  // Looking up an earlier frame again uses the first tempo
+  audioClockGetPositionAtFrame(audioClock, oneSecond - 1, &position);
+  assertDoubleEquals(DEFAULT_TEMPO, position.tempo, TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(1.0, position.barStartPosition, TEST_DEFAULT_TOLERANCE);
+
+  advanceAudioClock(audioClock, oneSecond * 2);
+  assertDoubleEquals(4.0, audioClockGetPosition(audioClock)->ppqPosition,
+                     TEST_DEFAULT_TOLERANCE);
+
+  freeAudioSettings();
+  return 0;
+}
+
+static int _testTimeSignatureChangeStartsBar(void) {
+  AudioClock audioClock = getAudioClock();
+  AudioClockPositionMembers position;
+  const unsigned long oneBeat = (unsigned long)(DEFAULT_SAMPLE_RATE / 2.0);
+
+  initAudioSettings();
+  // Three beats of 4/4, then 6/8 which has bars of three quarter notes
+  audioClockAddTimeSignatureChange(audioClock, oneBeat * 3, 6, 8);
+
+  audioClockGetPositionAtFrame(audioClock, oneBeat * 2, &position);
+  assertIntEquals(4, position.timeSignatureBeatsPerMeasure);
+  assertDoubleEquals(1.0, position.barStartPosition, TEST_DEFAULT_TOLERANCE);
+  audioClockGetPositionAtFrame(audioClock, oneBeat * 3, &position);
+  assertIntEquals(6, position.timeSignatureBeatsPerMeasure);
+  assertIntEquals(8, position.timeSignatureNoteValue);
+  assertDoubleEquals(4.0, position.barStartPosition, TEST_DEFAULT_TOLERANCE);
+  audioClockGetPositionAtFrame(audioClock, oneBeat * 7 + 10, &position);
+  assertDoubleEquals(7.0, position.barStartPosition, TEST_DEFAULT_TOLERANCE);
+
+  freeAudioSettings();
+  return 0;
+}
+
+static int _testGetFrameAtPpq(void) {
+  AudioClock audioClock = getAudioClock();
+  const unsigned long oneSecond = (unsigned long)DEFAULT_SAMPLE_RATE;
+
+  initAudioSettings();
+  assertUnsignedLongEquals(oneSecond, audioClockGetFrameAtPpq(audioClock, 3.0));
+  audioClockAddTempoChange(audioClock, oneSecond, 60.0);
+  assertUnsignedLongEquals(oneSecond * 3,
+                           audioClockGetFrameAtPpq(audioClock, 5.0));
+  assertUnsignedLongEquals(oneSecond / 2,
+                           audioClockGetFrameAtPpq(audioClock, 2.0));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           audioClockGetFrameAtPpq(audioClock, 0.5));
+
+  freeAudioSettings();
+  return 0;
+}
+
+static int _testResetClearsTimeline(void) {
+  AudioClock audioClock = getAudioClock();
+  AudioClockPositionMembers position;
+
+  initAudioSettings();
+  audioClockAddTempoChange(audioClock, 0, 60.0);
+  audioClockReset(audioClock);
+  audioClockGetPositionAtFrame(audioClock, 0, &position);
+  assertDoubleEquals(DEFAULT_TEMPO, position.tempo, TEST_DEFAULT_TOLERANCE);
+
+  freeAudioSettings();
+  return 0;
+}
+
 TestSuite addAudioClockTests(void);
 TestSuite addAudioClockTests(void) {
   TestSuite testSuite =
@@ -95,5 +217,13 @@ TestSuite addAudioClockTests(void) {
   addTest(testSuite, "StopClock", _testStopAudioClock);
   addTest(testSuite, "RestartClock", _testRestartAudioClock);
   addTest(testSuite, "MultipleAdvance", _testAdvanceClockMulitpleTimes);
+  addTest(testSuite, "ResetClock", _testResetAudioClock);
+  addTest(testSuite, "GetPosition", _testGetAudioClockPosition);
+  addTest(testSuite, "TempoChangeIsSampleAccurate",
+          _testTempoChangeIsSampleAccurate);
+  addTest(testSuite, "TimeSignatureChangeStartsBar",
+          _testTimeSignatureChangeStartsBar);
+  addTest(testSuite, "GetFrameAtPpq", _testGetFrameAtPpq);
+  addTest(testSuite, "ResetClearsTimeline", _testResetClearsTimeline);
   return testSuite;
 }
@@ -0,0 +1,152 @@
+//
+// LatencyHistogramTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "time/LatencyHistogram.h"
+
+#include "unit/TestRunner.h"
+
+// Percentiles are only accurate to the width of a bucket
+static const double kLatencyHistogramTestTolerance = 1.0 / 16.0;
+
+static int _testNewLatencyHistogram(void) {
+  LatencyHistogram h = newLatencyHistogram();
+  assertNotNull(h);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, h->numValues);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, h->numDeadlineMisses);
+  assertDoubleEquals(0.0, latencyHistogramGetPercentile(h, 50.0),
+                     TEST_EXACT_TOLERANCE);
+  freeLatencyHistogram(h);
+  return 0;
+}
+
+static int _testPercentiles(void) {
+  LatencyHistogram h = newLatencyHistogram();
+  int i;
+
+  // Values from 0.01ms to 10ms in 0.01ms steps
+  for (i = 1; i <= 1000; i++) {
+    latencyHistogramRecord(h, i / 100.0, 100.0);
+  }
+
+  assertUnsignedLongEquals(1000ul, h->numValues);
+  assertDoubleEquals(5.0, latencyHistogramGetPercentile(h, 50.0),
+                     5.0 * kLatencyHistogramTestTolerance);
+  assertDoubleEquals(9.9, latencyHistogramGetPercentile(h, 99.0),
+                     9.9 * kLatencyHistogramTestTolerance);
+  assertDoubleEquals(10.0, latencyHistogramGetPercentile(h, 100.0),
+                     TEST_EXACT_TOLERANCE);
+  assert(latencyHistogramGetPercentile(h, 99.9) <= h->maxValue);
+  assert(latencyHistogramGetPercentile(h, 50.0) <=
+         latencyHistogramGetPercentile(h, 99.0));
+
+  freeLatencyHistogram(h);
+  return 0;
+}
+
+static int _testSmallValuesAreExact(void) {
+  LatencyHistogram h = newLatencyHistogram();
+  // 20ns, which is below the first bucket with a range of values
+  latencyHistogramRecord(h, 0.00002, 1.0);
+  assert(latencyHistogramGetPercentile(h, 50.0) == h->maxValue);
+  freeLatencyHistogram(h);
+  return 0;
+}
+
+static int _testMaxValueIndex(void) {
+  LatencyHistogram h = newLatencyHistogram();
+
+  latencyHistogramRecord(h, 1.0, 10.0);
+  latencyHistogramRecord(h, 5.0, 10.0);
+  latencyHistogramRecord(h, 2.0, 10.0);
+
+  assertDoubleEquals(5.0, h->maxValue, TEST_EXACT_TOLERANCE);
+  assertUnsignedLongEquals(1ul, h->maxValueIndex);
+  freeLatencyHistogram(h);
+  return 0;
+}
+
+static int _testDeadlineMisses(void) {
+  LatencyHistogram h = newLatencyHistogram();
+
+  latencyHistogramRecord(h, 1.0, 2.0);
+  latencyHistogramRecord(h, 3.0, 2.0);
+  latencyHistogramRecord(h, 2.0, 2.0);
+  latencyHistogramRecord(h, 4.0, 2.0);
+
+  assertUnsignedLongEquals(2ul, h->numDeadlineMisses);
+  freeLatencyHistogram(h);
+  return 0;
+}
+
+static int _testReset(void) {
+  LatencyHistogram h = newLatencyHistogram();
+
+  latencyHistogramRecord(h, 1.0, 2.0);
+  latencyHistogramRecord(h, 3.0, 2.0);
+  latencyHistogramReset(h);
+
+  assertUnsignedLongEquals(0ul, h->numValues);
+  assertUnsignedLongEquals(0ul, h->numDeadlineMisses);
+  assertDoubleEquals(0.0, h->maxValue, TEST_EXACT_TOLERANCE);
+
+  latencyHistogramRecord(h, 2.0, 2.0);
+  assertUnsignedLongEquals(1ul, h->numValues);
+  assertUnsignedLongEquals(0ul, h->maxValueIndex);
+  assertDoubleEquals(2.0, latencyHistogramGetPercentile(h, 50.0),
+                     2.0 * kLatencyHistogramTestTolerance);
+  freeLatencyHistogram(h);
+  return 0;
+}
+
+static int _testRecordLargeValue(void) {
+  LatencyHistogram h = newLatencyHistogram();
+  // One hour, which should still land in a valid bucket
+  latencyHistogramRecord(h, 60.0 * 60.0 * 1000.0, 1.0);
+  assertDoubleEquals(60.0 * 60.0 * 1000.0,
+                     latencyHistogramGetPercentile(h, 50.0),
+                     60.0 * 60.0 * 1000.0 * kLatencyHistogramTestTolerance);
+  freeLatencyHistogram(h);
+  return 0;
+}
+
+static int _testFreeNullLatencyHistogram(void) {
+  freeLatencyHistogram(NULL);
+  return 0;
+}
+
+TestSuite addLatencyHistogramTests(void);
+TestSuite addLatencyHistogramTests(void) {
+  TestSuite testSuite = newTestSuite("LatencyHistogram", NULL, NULL);
+  addTest(testSuite, "NewObject", _testNewLatencyHistogram);
+  addTest(testSuite, "Percentiles", _testPercentiles);
+  addTest(testSuite, "SmallValuesAreExact", _testSmallValuesAreExact);
+  addTest(testSuite, "MaxValueIndex", _testMaxValueIndex);
+  addTest(testSuite, "DeadlineMisses", _testDeadlineMisses);
+  addTest(testSuite, "Reset", _testReset);
+  addTest(testSuite, "RecordLargeValue", _testRecordLargeValue);
+  addTest(testSuite, "FreeNull", _testFreeNullLatencyHistogram);
+  return testSuite;
+}
@@ -0,0 +1,174 @@
+//
+// PerfCountersTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "time/PerfCounters.h"
+
+#include "unit/TestRunner.h"
+
+#include <string.h>
+
+// Keeps the loop from being optimized away
+static volatile unsigned long _perfCountersTestSum = 0;
+
+static void _doSomeWork(void) {
+  unsigned long i;
+
+  for (i = 0; i < 100000; i++) {
+    _perfCountersTestSum += i;
+  }
+}
+
+static int _testNewPerfCounters(void) {
+  PerfCounters p = newPerfCounters();
+  assertNotNull(p);
+  assertFalse(p->enabled);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, p->numTasks);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           (unsigned long)p->counts[PERF_COUNTER_CYCLES]);
+  freePerfCounters(p);
+  return 0;
+}
+
+static int _testDisabledCountsNothing(void) {
+  PerfCounters p = newPerfCounters();
+  perfCountersStart(p);
+  _doSomeWork();
+  perfCountersStop(p);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, p->numTasks);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           (unsigned long)p->counts[PERF_COUNTER_CYCLES]);
+  freePerfCounters(p);
+  return 0;
+}
+
+static int _testStopWithoutStart(void) {
+  PerfCounters p = newPerfCounters();
+  p->enabled = true;
+  perfCountersStop(p);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, p->numTasks);
+  freePerfCounters(p);
+  return 0;
+}
+
+static int _testCountWork(void) {
+  PerfCounters p = newPerfCounters();
+
+  // Counters are often not available in virtual machines and containers
+  if (!perfCountersIsAvailable()) {
+    freePerfCounters(p);
+    return 0;
+  }
+
+  p->enabled = true;
+  perfCountersStart(p);
+  _doSomeWork();
+  perfCountersStop(p);
+  perfCountersStart(p);
+  _doSomeWork();
+  perfCountersStop(p);
+
+  assertUnsignedLongEquals(2ul, p->numTasks);
+  assert(p->supported[PERF_COUNTER_CYCLES]);
+  assert(p->counts[PERF_COUNTER_CYCLES] > 0);
+  if (p->supported[PERF_COUNTER_INSTRUCTIONS]) {
+    // Each iteration of the loop is at least a few instructions
+    assert(p->counts[PERF_COUNTER_INSTRUCTIONS] > 200000);
+    assert(perfCountersGetInstructionsPerCycle(p) > 0.0);
+  }
+
+  freePerfCounters(p);
+  return 0;
+}
+
+static int _testInstructionsPerCycle(void) {
+  PerfCounters p = newPerfCounters();
+  assertDoubleEquals(0.0, perfCountersGetInstructionsPerCycle(p),
+                     TEST_EXACT_TOLERANCE);
+  p->counts[PERF_COUNTER_CYCLES] = 1000;
+  p->counts[PERF_COUNTER_INSTRUCTIONS] = 2500;
+  assertDoubleEquals(2.5, perfCountersGetInstructionsPerCycle(p),
+                     TEST_DEFAULT_TOLERANCE);
+  freePerfCounters(p);
+  return 0;
+}
+
+static int _testPerThousandInstructions(void) {
+  PerfCounters p = newPerfCounters();
+  p->counts[PERF_COUNTER_BRANCH_MISSES] = 30;
+  assertDoubleEquals(0.0, perfCountersGetPerThousandInstructions(
+                              p, PERF_COUNTER_BRANCH_MISSES),
+                     TEST_EXACT_TOLERANCE);
+  p->counts[PERF_COUNTER_INSTRUCTIONS] = 20000;
+  assertDoubleEquals(1.5, perfCountersGetPerThousandInstructions(
+                              p, PERF_COUNTER_BRANCH_MISSES),
+                     TEST_DEFAULT_TOLERANCE);
+  freePerfCounters(p);
+  return 0;
+}
+
+static int _testReset(void) {
+  PerfCounters p = newPerfCounters();
+  p->enabled = true;
+  p->numTasks = 3;
+  p->counts[PERF_COUNTER_CACHE_MISSES] = 42;
+  p->supported[PERF_COUNTER_CACHE_MISSES] = true;
+  perfCountersReset(p);
+  assert(p->enabled);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, p->numTasks);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           (unsigned long)p->counts[PERF_COUNTER_CACHE_MISSES]);
+  assertFalse(p->supported[PERF_COUNTER_CACHE_MISSES]);
+  freePerfCounters(p);
+  return 0;
+}
+
+static int _testTypeNames(void) {
+  assert(strcmp(perfCounterTypeGetName(PERF_COUNTER_CYCLES), "cycles") == 0);
+  assert(strcmp(perfCounterTypeGetName(PERF_COUNTER_CACHE_MISSES),
+                "llc_misses") == 0);
+  assertIsNull(perfCounterTypeGetName(kPerfCounterNumTypes));
+  return 0;
+}
+
+static int _testFreeNullPerfCounters(void) {
+  freePerfCounters(NULL);
+  return 0;
+}
+
+TestSuite addPerfCountersTests(void);
+TestSuite addPerfCountersTests(void) {
+  TestSuite testSuite = newTestSuite("PerfCounters", NULL, NULL);
+  addTest(testSuite, "NewObject", _testNewPerfCounters);
+  addTest(testSuite, "DisabledCountsNothing", _testDisabledCountsNothing);
+  addTest(testSuite, "StopWithoutStart", _testStopWithoutStart);
+  addTest(testSuite, "CountWork", _testCountWork);
+  addTest(testSuite, "InstructionsPerCycle", _testInstructionsPerCycle);
+  addTest(testSuite, "PerThousandInstructions", _testPerThousandInstructions);
+  addTest(testSuite, "Reset", _testReset);
+  addTest(testSuite, "TypeNames", _testTypeNames);
+  addTest(testSuite, "FreeNull", _testFreeNullPerfCounters);
+  return testSuite;
+}
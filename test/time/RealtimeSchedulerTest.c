@@ -0,0 +1,134 @@
+//
+// RealtimeSchedulerTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "time/RealtimeScheduler.h"
+#include "time/TaskTimer.h"
+
+#include "unit/TestRunner.h"
+
+// 441 frames at 44.1kHz, which is exactly 10ms
+static const SampleCount kRealtimeSchedulerTestBlocksize = 441;
+static const SampleRate kRealtimeSchedulerTestSampleRate = 44100.0;
+static const double kRealtimeSchedulerTestBlockTimeInMs = 10.0;
+
+static int _testNewRealtimeScheduler(void) {
+  RealtimeScheduler s = newRealtimeScheduler();
+  assertNotNull(s);
+  assertFalse(s->_started);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, s->numMissedDeadlines);
+  assert(s->spinTimeInNs > 0);
+  freeRealtimeScheduler(s);
+  return 0;
+}
+
+static int _testWaitForBlocks(void) {
+  RealtimeScheduler s = newRealtimeScheduler();
+  TaskTimer t = newTaskTimerWithCString("test", "test");
+  int i;
+
+  taskTimerStart(t);
+  realtimeSchedulerStartBlock(s);
+
+  // The time spent "processing" each block is absorbed by the wait, so the
+  // total time does not depend on it
+  for (i = 0; i < 10; i++) {
+    realtimeSchedulerStartBlock(s);
+    taskTimerSleep(i % 3);
+    realtimeSchedulerWaitForBlock(s, kRealtimeSchedulerTestBlocksize,
+                                  kRealtimeSchedulerTestSampleRate);
+  }
+
+  assertTimeEquals(10 * kRealtimeSchedulerTestBlockTimeInMs, taskTimerStop(t),
+                   0.1);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, s->numMissedDeadlines);
+
+  freeTaskTimer(t);
+  freeRealtimeScheduler(s);
+  return 0;
+}
+
+static int _testWaitForLateBlock(void) {
+  RealtimeScheduler s = newRealtimeScheduler();
+  TaskTimer t = newTaskTimerWithCString("test", "test");
+
+  realtimeSchedulerStartBlock(s);
+  taskTimerSleep(2.5 * kRealtimeSchedulerTestBlockTimeInMs);
+  realtimeSchedulerWaitForBlock(s, kRealtimeSchedulerTestBlocksize,
+                                kRealtimeSchedulerTestSampleRate);
+  assertUnsignedLongEquals(1ul, s->numMissedDeadlines);
+
+  // The schedule restarts rather than returning immediately for the blocks
+  // which were missed
+  taskTimerStart(t);
+  realtimeSchedulerWaitForBlock(s, kRealtimeSchedulerTestBlocksize,
+                                kRealtimeSchedulerTestSampleRate);
+  assertTimeEquals(kRealtimeSchedulerTestBlockTimeInMs, taskTimerStop(t), 0.1);
+  assertUnsignedLongEquals(1ul, s->numMissedDeadlines);
+
+  freeTaskTimer(t);
+  freeRealtimeScheduler(s);
+  return 0;
+}
+
+static int _testResetRealtimeScheduler(void) {
+  RealtimeScheduler s = newRealtimeScheduler();
+  TaskTimer t = newTaskTimerWithCString("test", "test");
+
+  realtimeSchedulerStartBlock(s);
+  realtimeSchedulerWaitForBlock(s, kRealtimeSchedulerTestBlocksize,
+                                kRealtimeSchedulerTestSampleRate);
+  realtimeSchedulerReset(s);
+  assertFalse(s->_started);
+
+  // A pause between resetting and the next block is not counted against it
+  taskTimerSleep(2.0 * kRealtimeSchedulerTestBlockTimeInMs);
+  taskTimerStart(t);
+  realtimeSchedulerStartBlock(s);
+  realtimeSchedulerWaitForBlock(s, kRealtimeSchedulerTestBlocksize,
+                                kRealtimeSchedulerTestSampleRate);
+  assertTimeEquals(kRealtimeSchedulerTestBlockTimeInMs, taskTimerStop(t), 0.1);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, s->numMissedDeadlines);
+
+  freeTaskTimer(t);
+  freeRealtimeScheduler(s);
+  return 0;
+}
+
+static int _testFreeNullRealtimeScheduler(void) {
+  freeRealtimeScheduler(NULL);
+  return 0;
+}
+
+TestSuite addRealtimeSchedulerTests(void);
+TestSuite addRealtimeSchedulerTests(void) {
+  TestSuite testSuite = newTestSuite("RealtimeScheduler", NULL, NULL);
+  addTest(testSuite, "NewObject", _testNewRealtimeScheduler);
+  addTest(testSuite, "WaitForBlocks", _testWaitForBlocks);
+  addTest(testSuite, "WaitForLateBlock", _testWaitForLateBlock);
+  addTest(testSuite, "Reset", _testResetRealtimeScheduler);
+  addTest(testSuite, "FreeNull", _testFreeNullRealtimeScheduler);
+  return testSuite;
+}
@@ -0,0 +1,187 @@
+//
+// StreamSchedulerTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/CharString.h"
+#include "time/StreamScheduler.h"
+#include "time/TaskTimer.h"
+
+#include "unit/TestRunner.h"
+
+// 441 frames at 44.1kHz, which is exactly 10ms
+static const SampleCount kStreamSchedulerTestBlocksize = 441;
+static const SampleRate kStreamSchedulerTestSampleRate = 44100.0;
+static const double kStreamSchedulerTestBlockTimeInMs = 10.0;
+static const unsigned long kStreamSchedulerTestNumBlocks = 10;
+// Deadlines depend on the machine's load, so the tests tolerate a few misses
+// per stream rather than requiring none at all
+static const unsigned long kStreamSchedulerTestMaxMissedDeadlines = 3;
+
+typedef struct {
+  unsigned long numBlocks;
+  // Time to spend on the first block, in milliseconds
+  double firstBlockTimeInMs;
+} _StreamSchedulerTestData;
+
+static boolByte _streamSchedulerTestProcess(void *userData) {
+  _StreamSchedulerTestData *data = (_StreamSchedulerTestData *)userData;
+
+  if (data->numBlocks == 0 && data->firstBlockTimeInMs > 0.0) {
+    taskTimerSleep(data->firstBlockTimeInMs);
+  }
+
+  data->numBlocks++;
+  return (boolByte)(data->numBlocks < kStreamSchedulerTestNumBlocks);
+}
+
+static void _addTestStream(StreamScheduler s, _StreamSchedulerTestData *data) {
+  CharString name = newCharStringWithCString("test");
+  streamSchedulerAddStream(s, name, kStreamSchedulerTestBlocksize,
+                           kStreamSchedulerTestSampleRate,
+                           _streamSchedulerTestProcess, data);
+  freeCharString(name);
+}
+
+static int _testNewStreamScheduler(void) {
+  StreamScheduler s = newStreamScheduler(2, false);
+  assertNotNull(s);
+  assertIntEquals(2, s->numWorkers);
+  assertIntEquals(0, s->numStreams);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           streamSchedulerGetNumMissedDeadlines(s));
+  freeStreamScheduler(s);
+  return 0;
+}
+
+static int _testNewStreamSchedulerPerProcessor(void) {
+  StreamScheduler s = newStreamScheduler(0, false);
+  assert(s->numWorkers > 0);
+  freeStreamScheduler(s);
+  return 0;
+}
+
+static int _testAddStream(void) {
+  StreamScheduler s = newStreamScheduler(1, false);
+  _StreamSchedulerTestData data = {0, 0.0};
+  StreamSchedulerStream stream;
+
+  _addTestStream(s, &data);
+  assertIntEquals(1, s->numStreams);
+  stream = s->streams[0];
+  assertCharStringEquals("test", stream->name);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, stream->numBlocks);
+  assertFalse(stream->finished);
+
+  freeStreamScheduler(s);
+  return 0;
+}
+
+static int _testRunWithoutStreams(void) {
+  StreamScheduler s = newStreamScheduler(1, false);
+  assert(streamSchedulerRun(s));
+  freeStreamScheduler(s);
+  return 0;
+}
+
+static int _testRunStreams(void) {
+  StreamScheduler s = newStreamScheduler(2, false);
+  TaskTimer t = newTaskTimerWithCString("test", "test");
+  _StreamSchedulerTestData data[8];
+  unsigned int i;
+
+  for (i = 0; i < 8; i++) {
+    data[i].numBlocks = 0;
+    data[i].firstBlockTimeInMs = 0.0;
+    _addTestStream(s, &data[i]);
+  }
+
+  taskTimerStart(t);
+  assert(streamSchedulerRun(s));
+
+  // Blocks are never started before their deadline, so the run can't finish
+  // sooner than the schedule. It may well take longer on a loaded machine.
+  assert(taskTimerStop(t) >= (kStreamSchedulerTestNumBlocks - 1) *
+                                     kStreamSchedulerTestBlockTimeInMs -
+                                 1.0);
+
+  for (i = 0; i < 8; i++) {
+    assertUnsignedLongEquals(kStreamSchedulerTestNumBlocks, data[i].numBlocks);
+    assertUnsignedLongEquals(kStreamSchedulerTestNumBlocks,
+                             s->streams[i]->numBlocks);
+    assert(s->streams[i]->finished);
+    assert(s->streams[i]->numMissedDeadlines <=
+           kStreamSchedulerTestMaxMissedDeadlines);
+  }
+
+  freeTaskTimer(t);
+  freeStreamScheduler(s);
+  return 0;
+}
+
+static int _testRunLateStream(void) {
+  StreamScheduler s = newStreamScheduler(2, false);
+  _StreamSchedulerTestData slow = {0, 2.5 * kStreamSchedulerTestBlockTimeInMs};
+  _StreamSchedulerTestData fast = {0, 0.0};
+
+  _addTestStream(s, &slow);
+  _addTestStream(s, &fast);
+  assert(streamSchedulerRun(s));
+
+  // The slow stream's first block always misses its deadline, and its
+  // schedule restarts afterwards. The other stream keeps running on the
+  // second worker meanwhile, so only load on the machine can make it late.
+  assert(s->streams[0]->numMissedDeadlines >= 1ul);
+  assert(s->streams[0]->numMissedDeadlines <=
+         1ul + kStreamSchedulerTestMaxMissedDeadlines);
+  assert(s->streams[0]->maxLatenessInMs > kStreamSchedulerTestBlockTimeInMs);
+  assert(s->streams[1]->numMissedDeadlines <=
+         kStreamSchedulerTestMaxMissedDeadlines);
+  assertUnsignedLongEquals(s->streams[0]->numMissedDeadlines +
+                               s->streams[1]->numMissedDeadlines,
+                           streamSchedulerGetNumMissedDeadlines(s));
+  assertUnsignedLongEquals(kStreamSchedulerTestNumBlocks, slow.numBlocks);
+  assertUnsignedLongEquals(kStreamSchedulerTestNumBlocks, fast.numBlocks);
+
+  freeStreamScheduler(s);
+  return 0;
+}
+
+static int _testFreeNullStreamScheduler(void) {
+  freeStreamScheduler(NULL);
+  return 0;
+}
+
+TestSuite addStreamSchedulerTests(void);
+TestSuite addStreamSchedulerTests(void) {
+  TestSuite testSuite = newTestSuite("StreamScheduler", NULL, NULL);
+  addTest(testSuite, "NewObject", _testNewStreamScheduler);
+  addTest(testSuite, "NewObjectPerProcessor",
+          _testNewStreamSchedulerPerProcessor);
+  addTest(testSuite, "AddStream", _testAddStream);
+  addTest(testSuite, "RunWithoutStreams", _testRunWithoutStreams);
+  addTest(testSuite, "RunStreams", _testRunStreams);
+  addTest(testSuite, "RunLateStream", _testRunLateStream);
+  addTest(testSuite, "FreeNull", _testFreeNullStreamScheduler);
+  return testSuite;
+}
@@ -190,6 +190,25 @@ static int _testTaskTimerCallStopTwice(void) {
   return 0;
 }
 
+static int _testRunningTime(void) {
+  double runningTime;
+
+  assertDoubleEquals(0.0, taskTimerGetRunningTime(_testTaskTimer),
+                     TEST_DEFAULT_TOLERANCE);
+  taskTimerStart(_testTaskTimer);
+  _testSleep();
+  runningTime = taskTimerGetRunningTime(_testTaskTimer);
+  assertTimeEquals(SLEEP_DURATION_MS, runningTime, MAX_TIMER_TOLERANCE_MS);
+  // The timer keeps running, and no task has been counted yet
+  assert(_testTaskTimer->_running);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, _testTaskTimer->numTasks);
+
+  taskTimerStop(_testTaskTimer);
+  assertDoubleEquals(0.0, taskTimerGetRunningTime(_testTaskTimer),
+                     TEST_DEFAULT_TOLERANCE);
+  return 0;
+}
+
 static int _testCallStopBeforeStart(void) {
   taskTimerStop(_testTaskTimer);
   taskTimerStart(_testTaskTimer);
@@ -200,6 +219,95 @@ static int _testCallStopBeforeStart(void) {
   return 0;
 }
 
+static int _testTaskTimerStatistics(void) {
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    taskTimerStart(_testTaskTimer);
+    taskTimerSleep(SLEEP_DURATION_MS * (i + 1));
+    taskTimerStop(_testTaskTimer);
+  }
+
+  // Stopping a timer which is not running does not count as a task
+  taskTimerStop(_testTaskTimer);
+  assertUnsignedLongEquals(3ul, _testTaskTimer->numTasks);
+  assertTimeEquals(SLEEP_DURATION_MS, _testTaskTimer->minTaskTime,
+                   MAX_TIMER_TOLERANCE_MS);
+  assertTimeEquals(3.0 * SLEEP_DURATION_MS, _testTaskTimer->maxTaskTime,
+                   MAX_TIMER_TOLERANCE_MS);
+  return 0;
+}
+
+static int _testTaskTimerReset(void) {
+  taskTimerStart(_testTaskTimer);
+  taskTimerSleep(SLEEP_DURATION_MS);
+  taskTimerStop(_testTaskTimer);
+  taskTimerStart(_testTaskTimer);
+  taskTimerReset(_testTaskTimer);
+
+  assertUnsignedLongEquals(0ul, _testTaskTimer->numTasks);
+  assertDoubleEquals(0.0, _testTaskTimer->totalTaskTime, TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(0.0, _testTaskTimer->maxTaskTime, TEST_EXACT_TOLERANCE);
+  assertDoubleEquals(0.0, taskTimerGetRunningTime(_testTaskTimer),
+                     TEST_EXACT_TOLERANCE);
+
+  // The next task is counted as if it were the first one
+  taskTimerStart(_testTaskTimer);
+  taskTimerStop(_testTaskTimer);
+  assertUnsignedLongEquals(1ul, _testTaskTimer->numTasks);
+  return 0;
+}
+
+static int _testMeasureCpuTime(void) {
+  volatile double sum = 0.0;
+  int i;
+
+  taskTimerSetMeasureCpuTime(_testTaskTimer, true);
+  taskTimerStart(_testTaskTimer);
+  // Sleeping uses no CPU time, but the busy loop does
+  taskTimerSleep(SLEEP_DURATION_MS);
+  for (i = 0; i < 1000000; i++) {
+    sum += i;
+  }
+  taskTimerStop(_testTaskTimer);
+
+  assert(_testTaskTimer->totalCpuTime > 0.0);
+  assert(_testTaskTimer->totalTaskTime - _testTaskTimer->totalCpuTime >=
+         SLEEP_DURATION_MS - MAX_TIMER_TOLERANCE_MS);
+  return 0;
+}
+
+static int _testCpuTimeNotMeasuredByDefault(void) {
+  taskTimerStart(_testTaskTimer);
+  taskTimerStop(_testTaskTimer);
+  assertDoubleEquals(0.0, _testTaskTimer->totalCpuTime, TEST_EXACT_TOLERANCE);
+  return 0;
+}
+
+static int _testShortTasksAccumulate(void) {
+  int i;
+
+  // Each of these takes far less than a millisecond
+  for (i = 0; i < 1000; i++) {
+    taskTimerStart(_testTaskTimer);
+    taskTimerStop(_testTaskTimer);
+  }
+
+  assertUnsignedLongEquals(1000ul, _testTaskTimer->numTasks);
+  assert(_testTaskTimer->totalTaskTime > 0.0);
+  assert(_testTaskTimer->minTaskTime <= _testTaskTimer->maxTaskTime);
+  return 0;
+}
+
+static int _testHumanReadableTimeShortMs(void) {
+  CharString s;
+  _testTaskTimer->totalTaskTime = 0.25;
+  s = taskTimerHumanReadbleString(_testTaskTimer);
+  assertCharStringEquals("0.25ms", s);
+  freeCharString(s);
+  return 0;
+}
+
 static int _testHumanReadableTimeMs(void) {
   CharString s;
   _testTaskTimer->totalTaskTime = 230;
@@ -282,7 +390,16 @@ TestSuite addTaskTimerTests(void) {
   addTest(testSuite, "CallStopTwice", _testTaskTimerCallStopTwice);
   addTest(testSuite, "CallStartTwice", _testTaskTimerCallStartTwice);
   addTest(testSuite, "CallStopBeforeStart", _testCallStopBeforeStart);
-
+  addTest(testSuite, "RunningTime", _testRunningTime);
+  addTest(testSuite, "Statistics", _testTaskTimerStatistics);
+  addTest(testSuite, "Reset", _testTaskTimerReset);
+  addTest(testSuite, "MeasureCpuTime", _testMeasureCpuTime);
+  addTest(testSuite, "CpuTimeNotMeasuredByDefault",
+          _testCpuTimeNotMeasuredByDefault);
+  addTest(testSuite, "ShortTasksAccumulate", _testShortTasksAccumulate);
+
+  addTest(testSuite, "HumanReadableTimeShortMs",
+          _testHumanReadableTimeShortMs);
   addTest(testSuite, "HumanReadableTimeMs", _testHumanReadableTimeMs);
   addTest(testSuite, "HumanReadableTimeSec", _testHumanReadableTimeSec);
   addTest(testSuite, "HumanReadableTimeMinSec", _testHumanReadableTimeMinSec);
@@ -0,0 +1,218 @@
+//
+// TraceEventsTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include "time/TraceEvents.h"
+
+#include "base/File.h"
+#include "base/Thread.h"
+#include "time/TaskTimer.h"
+#include "unit/TestRunner.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_TRACE_FILENAME "mrswatsontest-trace.json"
+#define TEST_NUM_THREAD_EVENTS 100
+
+static void _traceEventsTestTeardown(void) {
+  CharString tracePath = newCharStringWithCString(TEST_TRACE_FILENAME);
+  File traceFile = newFileWithPath(tracePath);
+
+  traceEventsStop();
+  traceEventsReset();
+
+  if (fileExists(traceFile)) {
+    fileRemove(traceFile);
+  }
+
+  freeCharString(tracePath);
+  freeFile(traceFile);
+}
+
+static int _testRecordNothingWhenStopped(void) {
+  assertFalse(traceEventsIsEnabled());
+  traceEventsRecord("component", "task", 0, 1000);
+  assertUnsignedLongEquals(0ul, traceEventsGetNumEvents());
+  return 0;
+}
+
+static int _testRecordEvent(void) {
+  traceEventsStart();
+  assert(traceEventsIsEnabled());
+  traceEventsRecord("component", "task", 0, 1000);
+  traceEventsRecord(NULL, "task", 0, 1000);
+  traceEventsStop();
+  assertFalse(traceEventsIsEnabled());
+
+  // Stopping keeps the events until they are written
+  assertUnsignedLongEquals(2ul, traceEventsGetNumEvents());
+  assertUnsignedLongEquals(0ul, traceEventsGetNumDroppedEvents());
+  return 0;
+}
+
+static int _testStartDiscardsEvents(void) {
+  traceEventsStart();
+  traceEventsRecord("component", "task", 0, 1000);
+  traceEventsStop();
+  traceEventsStart();
+  assertUnsignedLongEquals(0ul, traceEventsGetNumEvents());
+
+  // The thread's old buffer was freed, so a new one must be registered
+  traceEventsRecord("component", "task", 0, 1000);
+  assertUnsignedLongEquals(1ul, traceEventsGetNumEvents());
+  return 0;
+}
+
+static int _testTaskTimerRecordsEvent(void) {
+  TaskTimer taskTimer = newTaskTimerWithCString("component", "task");
+
+  taskTimerStart(taskTimer);
+  taskTimerStop(taskTimer);
+  assertUnsignedLongEquals(0ul, traceEventsGetNumEvents());
+
+  traceEventsStart();
+  taskTimerStart(taskTimer);
+  taskTimerStop(taskTimer);
+  // Stopping a timer which is not running is not a task
+  taskTimerStop(taskTimer);
+  assertUnsignedLongEquals(1ul, traceEventsGetNumEvents());
+
+  freeTaskTimer(taskTimer);
+  return 0;
+}
+
+static int _testRecordPastOneBlock(void) {
+  unsigned int i;
+
+  traceEventsStart();
+  for (i = 0; i < TRACE_EVENTS_BLOCK_SIZE + 1; i++) {
+    traceEventsRecord("component", "task", i, i + 1);
+  }
+
+  assertUnsignedLongEquals((unsigned long)TRACE_EVENTS_BLOCK_SIZE + 1,
+                           traceEventsGetNumEvents());
+  assertUnsignedLongEquals(0ul, traceEventsGetNumDroppedEvents());
+  return 0;
+}
+
+static int _testDropEventsWithTooManyNames(void) {
+  char name[32];
+  unsigned int i;
+
+  traceEventsStart();
+  for (i = 0; i < TRACE_EVENTS_MAX_NAMES + 1; i++) {
+    snprintf(name, sizeof(name), "task %u", i);
+    traceEventsRecord("component", name, 0, 1000);
+  }
+
+  assertUnsignedLongEquals((unsigned long)TRACE_EVENTS_MAX_NAMES,
+                           traceEventsGetNumEvents());
+  assertUnsignedLongEquals(1ul, traceEventsGetNumDroppedEvents());
+  return 0;
+}
+
+static void _traceEventsTestThreadFunc(void *userData) {
+  const char *name = (const char *)userData;
+  unsigned int i;
+
+  for (i = 0; i < TEST_NUM_THREAD_EVENTS; i++) {
+    traceEventsRecord("component", name, i, i + 1);
+  }
+}
+
+static int _testRecordOnManyThreads(void) {
+  Thread threads[4];
+  unsigned int i;
+
+  traceEventsStart();
+  // Two threads share each name, so names are also added concurrently
+  threads[0] = newThread(_traceEventsTestThreadFunc, (void *)"even");
+  threads[1] = newThread(_traceEventsTestThreadFunc, (void *)"odd");
+  threads[2] = newThread(_traceEventsTestThreadFunc, (void *)"even");
+  threads[3] = newThread(_traceEventsTestThreadFunc, (void *)"odd");
+
+  for (i = 0; i < 4; i++) {
+    assertNotNull(threads[i]);
+    threadJoinAndFree(threads[i]);
+  }
+
+  traceEventsStop();
+  assertUnsignedLongEquals(4ul * TEST_NUM_THREAD_EVENTS,
+                           traceEventsGetNumEvents());
+  assertUnsignedLongEquals(0ul, traceEventsGetNumDroppedEvents());
+  return 0;
+}
+
+static int _testWriteJson(void) {
+  CharString tracePath = newCharStringWithCString(TEST_TRACE_FILENAME);
+  const uint64_t startTimeInNs = taskTimerGetTimestampInNs();
+  boolByte foundEvent = false;
+  boolByte foundThread = false;
+  char line[512];
+  FILE *fp;
+
+  traceEventsStart();
+  traceEventsRecord("test \"plugin\"", "Audio Processing",
+                    startTimeInNs + 2000, startTimeInNs + 3500);
+  traceEventsStop();
+  assert(traceEventsWriteJson(tracePath));
+
+  fp = fopen(TEST_TRACE_FILENAME, "r");
+  assertNotNull(fp);
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (strstr(line, "\"name\": \"test \\\"plugin\\\": Audio Processing\"") !=
+        NULL) {
+      foundEvent = true;
+      assertNotNull(strstr(line, "\"ph\": \"X\""));
+      assertNotNull(strstr(line, "\"dur\": 1.500"));
+    } else if (strstr(line, "\"thread_name\"") != NULL) {
+      foundThread = true;
+    }
+  }
+
+  fclose(fp);
+  assert(foundEvent);
+  assert(foundThread);
+
+  freeCharString(tracePath);
+  return 0;
+}
+
+TestSuite addTraceEventsTests(void);
+TestSuite addTraceEventsTests(void) {
+  TestSuite testSuite =
+      newTestSuite("TraceEvents", NULL, _traceEventsTestTeardown);
+  addTest(testSuite, "RecordNothingWhenStopped",
+          _testRecordNothingWhenStopped);
+  addTest(testSuite, "RecordEvent", _testRecordEvent);
+  addTest(testSuite, "StartDiscardsEvents", _testStartDiscardsEvents);
+  addTest(testSuite, "TaskTimerRecordsEvent", _testTaskTimerRecordsEvent);
+  addTest(testSuite, "RecordPastOneBlock", _testRecordPastOneBlock);
+  addTest(testSuite, "DropEventsWithTooManyNames",
+          _testDropEventsWithTooManyNames);
+  addTest(testSuite, "RecordOnManyThreads", _testRecordOnManyThreads);
+  addTest(testSuite, "WriteJson", _testWriteJson);
+  return testSuite;
+}
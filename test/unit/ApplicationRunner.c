@@ -27,14 +27,31 @@
 #include "ApplicationRunner.h"
 
 #include "analysis/AnalyzeFile.h"
+#include "audio/AudioSettings.h"
 #include "base/File.h"
 #include "base/PlatformInfo.h"
+#include "io/SampleSource.h"
 
 #include <stdarg.h>
 #include <stdio.h>
 
 static const char *kApplicationRunnerOutputFolder = "out";
+static const char *kApplicationRunnerGoldenExtension = "golden";
 static const int kApplicationRunnerWaitTimeoutInMs = 1000;
+// Same FNV-1a hash as the preset cache, which can be continued from a previous
+// hash to cover several pieces of data
+static const unsigned long long kApplicationRunnerHashBasis =
+    0xcbf29ce484222325ull;
+static const unsigned long long kApplicationRunnerHashPrime = 0x100000001b3ull;
+
+// Output of the last passing run of a test, and the hash of everything which
+// went into making it
+typedef struct {
+  unsigned long long key;
+  unsigned long long *checksums;
+  size_t numChecksums;
+} _GoldenOutputMembers;
+typedef _GoldenOutputMembers *_GoldenOutput;
 
 CharString buildTestArgumentString(const char *arguments, ...) {
   CharString formattedArguments;
@@ -192,6 +209,228 @@ static void _removeOutputFiles(const char *testName) {
   freeCharString(outputFilename);
 }
 
+static unsigned long long _hashBytes(unsigned long long hash, const void *data,
+                                     size_t dataSize) {
+  const byte *bytes = (const byte *)data;
+  size_t i;
+
+  for (i = 0; i < dataSize; i++) {
+    hash ^= bytes[i];
+    hash *= kApplicationRunnerHashPrime;
+  }
+
+  return hash;
+}
+
+static unsigned long long _hashFile(unsigned long long hash, File file) {
+  MappedFile mappedFile;
+
+  hash = _hashBytes(hash, file->absolutePath->data,
+                    strlen(file->absolutePath->data));
+  mappedFile = fileMap(file);
+
+  if (mappedFile != NULL) {
+    hash = _hashBytes(hash, mappedFile->data, mappedFile->size);
+    freeMappedFile(mappedFile);
+  }
+
+  fileClose(file);
+  return hash;
+}
+
+static void _hashDirectoryEntry(File item, const char *name, void *userData) {
+  unsigned long long *hash = (unsigned long long *)userData;
+  // The listed item is reused for the next entry, so it cannot be opened
+  File file = newFileWithPath(item->absolutePath);
+
+  if (file != NULL && file->fileType == kFileTypeFile) {
+    *hash = _hashFile(*hash, file);
+  }
+
+  freeFile(file);
+}
+
+// Hash the executable, the arguments, and the contents of each test resource
+// which is named in the arguments. Directories such as the plugin root are
+// hashed by the files directly inside of them, which covers the plugins that
+// are loaded from there. Files outside of the resources are not hashed, since
+// the log and output files change with every run.
+static unsigned long long _getCacheKey(const CharString mrsWatsonExePath,
+                                       const CharString resourcesPath,
+                                       const CharString arguments) {
+  unsigned long long hash = kApplicationRunnerHashBasis;
+  CharString argumentsCopy = newCharString();
+  File file = newFileWithPath(mrsWatsonExePath);
+  char *piece;
+
+  hash = _hashFile(hash, file);
+  freeFile(file);
+  hash = _hashBytes(hash, arguments->data, strlen(arguments->data));
+
+  // Plugin lists name presets after commas, and separate plugins by semicolons
+  charStringCopy(argumentsCopy, arguments);
+  piece = strtok(argumentsCopy->data, " \",;");
+
+  while (piece != NULL) {
+    if (strncmp(piece, resourcesPath->data, strlen(resourcesPath->data)) ==
+        0) {
+      file = newFileWithPathCString(piece);
+
+      if (file != NULL && file->fileType == kFileTypeFile) {
+        hash = _hashFile(hash, file);
+      } else if (file != NULL && file->fileType == kFileTypeDirectory) {
+        fileListDirectoryForeach(file, NULL, _hashDirectoryEntry, &hash);
+      }
+
+      freeFile(file);
+    }
+
+    piece = strtok(NULL, " \",;");
+  }
+
+  freeCharString(argumentsCopy);
+  return hash;
+}
+
+// Checksums are chained from one block to the next, so the first block which
+// differs from the golden output is the first one with a different checksum
+static _GoldenOutput _newGoldenOutput(unsigned long long key,
+                                      const CharString outputFilename) {
+  _GoldenOutput self = (_GoldenOutput)malloc(sizeof(_GoldenOutputMembers));
+  unsigned long long checksum = kApplicationRunnerHashBasis;
+  size_t capacity = 0;
+  CharString filename;
+  SampleSource sampleSource;
+  SampleBuffer sampleBuffer;
+  ChannelCount i;
+
+  self->key = key;
+  self->checksums = NULL;
+  self->numChecksums = 0;
+
+  if (outputFilename == NULL) {
+    return self;
+  }
+
+  // Needed to initialize new sample sources
+  initAudioSettings();
+  filename = newCharStringWithCString(outputFilename->data);
+  sampleSource = sampleSourceFactory(filename);
+  freeCharString(filename);
+
+  if (sampleSource == NULL ||
+      !sampleSource->openSampleSource(sampleSource, SAMPLE_SOURCE_OPEN_READ)) {
+    freeSampleSource(sampleSource);
+    freeAudioSettings();
+    free(self);
+    return NULL;
+  }
+
+  sampleBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+
+  while (sampleSource->readSampleBlock(sampleSource, sampleBuffer)) {
+    for (i = 0; i < sampleBuffer->numChannels; i++) {
+      checksum = _hashBytes(checksum, sampleBuffer->samples[i],
+                            sizeof(Sample) * sampleBuffer->blocksize);
+    }
+
+    if (self->numChecksums == capacity) {
+      capacity = capacity > 0 ? capacity * 2 : 64;
+      self->checksums = (unsigned long long *)realloc(
+          self->checksums, sizeof(unsigned long long) * capacity);
+    }
+
+    self->checksums[self->numChecksums++] = checksum;
+  }
+
+  sampleSource->closeSampleSource(sampleSource);
+  freeSampleSource(sampleSource);
+  freeSampleBuffer(sampleBuffer);
+  freeAudioSettings();
+  return self;
+}
+
+static CharString _getGoldenFilename(const char *testName) {
+  CharString filename = getTestOutputFilename(testName, kTestOutputText);
+  // Replace the "txt" extension
+  filename->data[strlen(filename->data) - 3] = '\0';
+  charStringAppendCString(filename, kApplicationRunnerGoldenExtension);
+  return filename;
+}
+
+static _GoldenOutput _readGoldenOutput(const CharString filename) {
+  _GoldenOutput self;
+  FILE *file = fopen(filename->data, "r");
+  unsigned long long checksum;
+  size_t capacity = 0;
+
+  if (file == NULL) {
+    return NULL;
+  }
+
+  self = (_GoldenOutput)malloc(sizeof(_GoldenOutputMembers));
+  self->checksums = NULL;
+  self->numChecksums = 0;
+
+  if (fscanf(file, "%llx", &self->key) != 1) {
+    fclose(file);
+    free(self);
+    return NULL;
+  }
+
+  while (fscanf(file, "%llx", &checksum) == 1) {
+    if (self->numChecksums == capacity) {
+      capacity = capacity > 0 ? capacity * 2 : 64;
+      self->checksums = (unsigned long long *)realloc(
+          self->checksums, sizeof(unsigned long long) * capacity);
+    }
+
+    self->checksums[self->numChecksums++] = checksum;
+  }
+
+  fclose(file);
+  return self;
+}
+
+static void _writeGoldenOutput(const _GoldenOutput self,
+                               const CharString filename) {
+  FILE *file = fopen(filename->data, "w");
+  size_t i;
+
+  if (file == NULL) {
+    return;
+  }
+
+  fprintf(file, "%016llx\n", self->key);
+
+  for (i = 0; i < self->numChecksums; i++) {
+    fprintf(file, "%016llx\n", self->checksums[i]);
+  }
+
+  fclose(file);
+}
+
+// Find the first block where two outputs differ
+static size_t _getFirstDifferentBlock(const _GoldenOutput self,
+                                      const _GoldenOutput other) {
+  size_t i;
+
+  for (i = 0; i < self->numChecksums && i < other->numChecksums; i++) {
+    if (self->checksums[i] != other->checksums[i]) {
+      return i;
+    }
+  }
+
+  return i;
+}
+
+static void _freeGoldenOutput(_GoldenOutput self) {
+  if (self != NULL) {
+    free(self->checksums);
+    free(self);
+  }
+}
+
 static const char *_getResultCodeString(const int resultCode) {
   switch (resultCode) {
   case RETURN_CODE_SUCCESS:
@@ -221,6 +460,12 @@ static const char *_getResultCodeString(const int resultCode) {
   case RETURN_CODE_INTERNAL_ERROR:
     return "Internal error";
 
+  case RETURN_CODE_REALTIME_VIOLATION:
+    return "Real-time violation";
+
+  case RETURN_CODE_OUTPUT_MISMATCH:
+    return "Output mismatch";
+
   case RETURN_CODE_SIGNAL:
     return "Caught signal";
 
@@ -239,23 +484,17 @@ int runIntegrationTest(const char *testName, CharString testArguments,
   ReturnCode resultCode;
   ChannelCount failedAnalysisChannel;
   SampleCount failedAnalysisFrame;
+  unsigned long long cacheKey;
+  CharString goldenFilename;
+  _GoldenOutput goldenOutput;
+  _GoldenOutput output = NULL;
+  size_t firstDifferentBlock;
 
 #if WINDOWS
   STARTUPINFOA startupInfo;
   PROCESS_INFORMATION processInfo;
 #endif
 
-  // Remove files from a previous test run
-  File outputFolder = newFileWithPathCString(kApplicationRunnerOutputFolder);
-
-  if (fileExists(outputFolder)) {
-    _removeOutputFiles(testName);
-  } else {
-    fileCreate(outputFolder, kFileTypeDirectory);
-  }
-
-  freeFile(outputFolder);
-
   if (mrsWatsonExePath == NULL) {
     return -1;
   } else {
@@ -303,6 +542,31 @@ int runIntegrationTest(const char *testName, CharString testArguments,
   // boilerplate code.
   freeCharString(testArguments);
 
+  // When nothing that goes into the test has changed since it last passed, it
+  // would render the same output again, so it is skipped
+  cacheKey = _getCacheKey(mrsWatsonExePath, resourcesPath, arguments);
+  goldenFilename = _getGoldenFilename(testName);
+  goldenOutput = _readGoldenOutput(goldenFilename);
+
+  if (goldenOutput != NULL && goldenOutput->key == cacheKey) {
+    _freeGoldenOutput(goldenOutput);
+    freeCharString(goldenFilename);
+    freeCharString(outputFilename);
+    freeCharString(arguments);
+    return 0;
+  }
+
+  // Remove files from a previous test run
+  File outputFolder = newFileWithPathCString(kApplicationRunnerOutputFolder);
+
+  if (fileExists(outputFolder)) {
+    _removeOutputFiles(testName);
+  } else {
+    fileCreate(outputFolder, kFileTypeDirectory);
+  }
+
+  freeFile(outputFolder);
+
 #if WINDOWS
   memset(&startupInfo, 0, sizeof(startupInfo));
   memset(&processInfo, 0, sizeof(processInfo));
@@ -336,12 +600,24 @@ int runIntegrationTest(const char *testName, CharString testArguments,
     logCritical("Could not launch shell, got return code %d\n\
 Please check the executable path specified in the --mrswatson-path argument.",
                 resultCode);
-    return 1;
+    result = 1;
   } else if (resultCode == expectedResultCode) {
     CharString failedAnalysisFunctionName = newCharString();
     if (testOutputType != kTestOutputNone) {
-      if (analyzeFile(outputFilename->data, failedAnalysisFunctionName,
-                      &failedAnalysisChannel, &failedAnalysisFrame)) {
+      output = _newGoldenOutput(cacheKey, outputFilename);
+      firstDifferentBlock =
+          goldenOutput != NULL && output != NULL
+              ? _getFirstDifferentBlock(goldenOutput, output)
+              : 0;
+
+      // Output which is the same as that of the last passing run would pass
+      // the analysis again, so only changed output is analyzed
+      if (goldenOutput != NULL && output != NULL &&
+          goldenOutput->numChecksums == output->numChecksums &&
+          firstDifferentBlock == output->numChecksums) {
+        result = 0;
+      } else if (analyzeFile(outputFilename->data, failedAnalysisFunctionName,
+                             &failedAnalysisChannel, &failedAnalysisFrame)) {
         // TODO:
         //                if (!testEnvironment->results->keepFiles) {
         //                    _removeOutputFiles(testName);
@@ -352,6 +628,13 @@ Please check the executable path specified in the --mrswatson-path argument.",
                 "Audio analysis check for %s failed at frame %lu, channel %d. ",
                 failedAnalysisFunctionName->data, failedAnalysisFrame,
                 failedAnalysisChannel);
+
+        if (goldenOutput != NULL && output != NULL) {
+          fprintf(stderr,
+                  "Output differs from the last passing run from frame %lu. ",
+                  (unsigned long)(firstDifferentBlock * DEFAULT_BLOCKSIZE));
+        }
+
         result = 1;
       }
     } else {
@@ -363,6 +646,14 @@ Please check the executable path specified in the --mrswatson-path argument.",
       //            }
     }
     freeCharString(failedAnalysisFunctionName);
+
+    if (result == 0) {
+      if (output == NULL) {
+        output = _newGoldenOutput(cacheKey, NULL);
+      }
+
+      _writeGoldenOutput(output, goldenFilename);
+    }
   } else {
     fprintf(stderr, "Expected result code %d (%s), got %d (%s). ",
             expectedResultCode, _getResultCodeString(expectedResultCode),
@@ -370,6 +661,9 @@ Please check the executable path specified in the --mrswatson-path argument.",
     result = 1;
   }
 
+  _freeGoldenOutput(goldenOutput);
+  _freeGoldenOutput(output);
+  freeCharString(goldenFilename);
   freeCharString(outputFilename);
   return result;
 }
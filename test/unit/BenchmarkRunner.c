@@ -0,0 +1,475 @@
+//
+// BenchmarkRunner.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "BenchmarkRunner.h"
+
+#include "base/File.h"
+#include "base/PlatformInfo.h"
+#include "base/Thread.h"
+#include "time/AudioClock.h"
+#include "time/TaskTimer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Each benchmark runs for this long before it is timed. This warms up the
+// caches, and also finds how many iterations fit into one repetition.
+static const double kBenchmarkWarmupTimeInMs = 50.0;
+static const double kBenchmarkRepetitionTimeInMs = 20.0;
+// A difference to the baseline must be larger than this many median absolute
+// deviations of both runs to be reported. It must also be larger than the
+// minimum relative change, since very stable benchmarks have almost no
+// deviation at all.
+static const double kBenchmarkSignificantDeviations = 3.0;
+static const double kBenchmarkMinSignificantChange = 0.03;
+
+typedef struct {
+  CharString name;
+  unsigned long iterations;
+  double medianInNs;
+  double deviationInNs;
+  double minInNs;
+  unsigned long frequencyInMhz;
+} BenchmarkResultMembers;
+typedef BenchmarkResultMembers *BenchmarkResult;
+
+typedef struct {
+  const BenchmarkSettings *settings;
+  TestSuite testSuite;
+  CharString testSuiteFilter;
+  CharString benchmarkFilter;
+  LinkedList results;
+  LinkedList baseline;
+  unsigned int processor;
+  int numRegressions;
+} _BenchmarkRunData;
+
+static BenchmarkResult _newBenchmarkResult(const char *testSuiteName,
+                                           const char *benchmarkName) {
+  BenchmarkResult self =
+      (BenchmarkResult)malloc(sizeof(BenchmarkResultMembers));
+  self->name = newCharStringWithCString(testSuiteName);
+
+  if (benchmarkName != NULL) {
+    charStringAppendCString(self->name, ":");
+    charStringAppendCString(self->name, benchmarkName);
+  }
+
+  self->iterations = 0;
+  self->medianInNs = 0.0;
+  self->deviationInNs = 0.0;
+  self->minInNs = 0.0;
+  self->frequencyInMhz = 0;
+  return self;
+}
+
+static void _freeBenchmarkResult(BenchmarkResult self) {
+  if (self != NULL) {
+    freeCharString(self->name);
+    free(self);
+  }
+}
+
+static int _compareDoubles(const void *a, const void *b) {
+  const double first = *(const double *)a;
+  const double second = *(const double *)b;
+  return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+// Sorts the values in place
+static double _getMedian(double *values, const unsigned int numValues) {
+  qsort(values, numValues, sizeof(double), _compareDoubles);
+
+  if (numValues % 2 == 0) {
+    return (values[numValues / 2 - 1] + values[numValues / 2]) / 2.0;
+  } else {
+    return values[numValues / 2];
+  }
+}
+
+static unsigned long _getIterationsPerRepetition(const unsigned long iterations,
+                                                 const double elapsedTimeInMs) {
+  const double result =
+      (double)iterations * kBenchmarkRepetitionTimeInMs / elapsedTimeInMs;
+  return result >= 1.0 ? (unsigned long)result : 1;
+}
+
+static BenchmarkResult _runBenchmark(const TestSuite testSuite,
+                                     const BenchmarkCase benchmarkCase,
+                                     const unsigned int repetitions,
+                                     const unsigned int processor) {
+  BenchmarkResult result =
+      _newBenchmarkResult(testSuite->name, benchmarkCase->name);
+  TaskTimer timer = newTaskTimerWithCString("Benchmark", benchmarkCase->name);
+  double *timesInNs = (double *)malloc(sizeof(double) * repetitions);
+  unsigned long warmupIterations = 0;
+  void *context = NULL;
+  unsigned long i;
+  unsigned int r;
+
+  if (testSuite->setup != NULL) {
+    testSuite->setup();
+  }
+
+  if (benchmarkCase->setup != NULL) {
+    context = benchmarkCase->setup();
+  }
+
+  taskTimerStart(timer);
+
+  do {
+    benchmarkCase->benchmarkFunc(context);
+    warmupIterations++;
+  } while (taskTimerGetRunningTime(timer) < kBenchmarkWarmupTimeInMs);
+
+  result->iterations = _getIterationsPerRepetition(warmupIterations,
+                                                   taskTimerStop(timer));
+
+  // Reading the timer on every warmup iteration makes fast benchmarks look
+  // slower than they are, so the estimate is corrected with one more pass
+  taskTimerStart(timer);
+
+  for (i = 0; i < result->iterations; i++) {
+    benchmarkCase->benchmarkFunc(context);
+  }
+
+  result->iterations =
+      _getIterationsPerRepetition(result->iterations, taskTimerStop(timer));
+
+  // Read while the processor is busy, since idle processors clock down
+  result->frequencyInMhz = platformInfoGetProcessorFrequency(processor);
+
+  for (r = 0; r < repetitions; r++) {
+    taskTimerStart(timer);
+
+    for (i = 0; i < result->iterations; i++) {
+      benchmarkCase->benchmarkFunc(context);
+    }
+
+    timesInNs[r] =
+        taskTimerStop(timer) * 1000000.0 / (double)result->iterations;
+  }
+
+  result->medianInNs = _getMedian(timesInNs, repetitions);
+  result->minInNs = timesInNs[0];
+
+  for (r = 0; r < repetitions; r++) {
+    timesInNs[r] = fabs(timesInNs[r] - result->medianInNs);
+  }
+
+  result->deviationInNs = _getMedian(timesInNs, repetitions);
+
+  if (benchmarkCase->teardown != NULL) {
+    benchmarkCase->teardown(context);
+  }
+
+  if (testSuite->teardown != NULL) {
+    testSuite->teardown();
+  }
+
+  free(timesInNs);
+  freeTaskTimer(timer);
+  return result;
+}
+
+static BenchmarkResult _findBenchmarkResult(LinkedList results,
+                                            const CharString name) {
+  LinkedListIterator iterator = linkedListBegin(results);
+  BenchmarkResult result;
+
+  while (iterator != NULL) {
+    result = (BenchmarkResult)linkedListIteratorGetItem(iterator);
+
+    if (result != NULL && charStringIsEqualTo(result->name, name, false)) {
+      return result;
+    }
+
+    iterator = linkedListIteratorNext(iterator);
+  }
+
+  return NULL;
+}
+
+static boolByte _printBaselineComparison(const BenchmarkResult result,
+                                         const BenchmarkResult baseline) {
+  const double difference = result->medianInNs - baseline->medianInNs;
+  double threshold = kBenchmarkSignificantDeviations *
+                     (result->deviationInNs + baseline->deviationInNs);
+  char message[64];
+
+  if (threshold < kBenchmarkMinSignificantChange * baseline->medianInNs) {
+    threshold = kBenchmarkMinSignificantChange * baseline->medianInNs;
+  }
+
+  snprintf(message, sizeof(message), ", %+.1f%% ",
+           100.0 * difference / baseline->medianInNs);
+  printToLog(getLogColor(kTestLogEventReset), NULL, message);
+
+  if (difference > threshold) {
+    printToLog(getLogColor(kTestLogEventFail), NULL, "slower");
+    return true;
+  } else if (difference < -threshold) {
+    printToLog(getLogColor(kTestLogEventPass), NULL, "faster");
+  } else {
+    printToLog(getLogColor(kTestLogEventReset), NULL, "no change");
+  }
+
+  return false;
+}
+
+static void _runBenchmarkCase(void *item, void *userData) {
+  BenchmarkCase benchmarkCase = (BenchmarkCase)item;
+  _BenchmarkRunData *data = (_BenchmarkRunData *)userData;
+  BenchmarkResult result;
+  BenchmarkResult baseline;
+  char message[128];
+
+  if (!charStringIsEmpty(data->benchmarkFilter) &&
+      !charStringIsEqualToCString(data->benchmarkFilter, benchmarkCase->name,
+                                  true)) {
+    return;
+  }
+
+  printTestName(benchmarkCase->name);
+  result = _runBenchmark(data->testSuite, benchmarkCase,
+                         data->settings->repetitions, data->processor);
+  snprintf(message, sizeof(message), "%.1fns +/- %.1f (%u x %lu iterations)",
+           result->medianInNs, result->deviationInNs,
+           data->settings->repetitions, result->iterations);
+  printToLog(getLogColor(kTestLogEventReset), NULL, message);
+  baseline = _findBenchmarkResult(data->baseline, result->name);
+
+  if (baseline != NULL && _printBaselineComparison(result, baseline)) {
+    data->numRegressions++;
+  }
+
+  flushLog(NULL);
+  linkedListAppend(data->results, result);
+}
+
+static void _runBenchmarksInSuite(void *item, void *userData) {
+  TestSuite testSuite = (TestSuite)item;
+  _BenchmarkRunData *data = (_BenchmarkRunData *)userData;
+
+  if (linkedListLength(testSuite->benchmarks) == 0 ||
+      (!charStringIsEmpty(data->testSuiteFilter) &&
+       !charStringIsEqualToCString(data->testSuiteFilter, testSuite->name,
+                                   true))) {
+    return;
+  }
+
+  // See runTestSuite() for why the clock is created again for each suite
+  initAudioClock();
+
+  printToLog(getLogColor(kTestLogEventReset), NULL, "Running benchmarks in ");
+  printToLog(getLogColor(kTestLogEventSection), NULL, testSuite->name);
+  flushLog(NULL);
+
+  data->testSuite = testSuite;
+  linkedListForeach(testSuite->benchmarks, _runBenchmarkCase, data);
+}
+
+// The baseline is only read back from files written by _writeResults(), which
+// puts each benchmark on its own line, so there is no need for a JSON parser
+static LinkedList _readBaseline(const CharString baselinePath) {
+  LinkedList baseline = newLinkedList();
+  File baselineFile = newFileWithPath(baselinePath);
+  LinkedList lines = fileReadLines(baselineFile);
+  LinkedListIterator iterator = linkedListBegin(lines);
+  BenchmarkResult result;
+  CharString line;
+  char *name;
+  char *nameEnd;
+  char *median;
+  char *deviation;
+
+  if (lines == NULL) {
+    freeLinkedList(baseline);
+    freeFile(baselineFile);
+    return NULL;
+  }
+
+  while (iterator != NULL) {
+    line = (CharString)linkedListIteratorGetItem(iterator);
+    name = strstr(line->data, "\"name\": \"");
+    median = strstr(line->data, "\"median_ns\": ");
+    deviation = strstr(line->data, "\"mad_ns\": ");
+
+    if (name != NULL && median != NULL && deviation != NULL) {
+      name += strlen("\"name\": \"");
+      nameEnd = strchr(name, '"');
+
+      if (nameEnd != NULL) {
+        *nameEnd = '\0';
+        result = _newBenchmarkResult(name, NULL);
+        result->medianInNs = strtod(median + strlen("\"median_ns\": "), NULL);
+        result->deviationInNs =
+            strtod(deviation + strlen("\"mad_ns\": "), NULL);
+        linkedListAppend(baseline, result);
+      }
+    }
+
+    iterator = linkedListIteratorNext(iterator);
+  }
+
+  freeLinkedListAndItems(lines, (LinkedListFreeItemFunc)freeCharString);
+  freeFile(baselineFile);
+  return baseline;
+}
+
+static boolByte _writeResults(const _BenchmarkRunData *data) {
+  FILE *output = fopen(data->settings->outputPath->data, "w");
+  PlatformInfo platformInfo;
+  CharString governor;
+  LinkedListIterator iterator;
+  BenchmarkResult result;
+
+  if (output == NULL) {
+    return false;
+  }
+
+  platformInfo = newPlatformInfo();
+  governor = platformInfoGetProcessorGovernor(data->processor);
+  fprintf(output, "{\n");
+  fprintf(output, "  \"platform\": \"%s\",\n", platformInfo->name->data);
+  fprintf(output, "  \"processors\": \"%s\",\n",
+          data->settings->processors->data);
+
+  if (governor != NULL) {
+    fprintf(output, "  \"governor\": \"%s\",\n", governor->data);
+  } else {
+    fprintf(output, "  \"governor\": null,\n");
+  }
+
+  fprintf(output, "  \"repetitions\": %u,\n", data->settings->repetitions);
+  fprintf(output, "  \"benchmarks\": [\n");
+  iterator = linkedListBegin(data->results);
+
+  while (iterator != NULL) {
+    result = (BenchmarkResult)linkedListIteratorGetItem(iterator);
+    iterator = linkedListIteratorNext(iterator);
+    fprintf(output,
+            "    {\"name\": \"%s\", \"iterations\": %lu, \"median_ns\": %.3f, "
+            "\"mad_ns\": %.3f, \"min_ns\": %.3f, \"frequency_mhz\": ",
+            result->name->data, result->iterations, result->medianInNs,
+            result->deviationInNs, result->minInNs);
+
+    if (result->frequencyInMhz > 0) {
+      fprintf(output, "%lu}", result->frequencyInMhz);
+    } else {
+      fprintf(output, "null}");
+    }
+
+    fprintf(output, "%s\n", iterator != NULL ? "," : "");
+  }
+
+  fprintf(output, "  ]\n");
+  fprintf(output, "}\n");
+  fclose(output);
+  freeCharString(governor);
+  freePlatformInfo(platformInfo);
+  return true;
+}
+
+int runBenchmarks(LinkedList testSuites, const BenchmarkSettings *settings) {
+  _BenchmarkRunData data;
+  CharString governor;
+  char *colon;
+
+  if (settings->repetitions == 0) {
+    fprintf(stderr, "ERROR: Benchmarks need at least one repetition\n");
+    return -1;
+  }
+
+  memset(&data, 0, sizeof(data));
+  data.settings = settings;
+
+  if (!charStringIsEmpty(settings->processors)) {
+    if (!threadSetAffinityList(settings->processors->data)) {
+      fprintf(stderr, "ERROR: Could not pin benchmarks to processors '%s'\n",
+              settings->processors->data);
+      return -1;
+    }
+
+    // Clock speed and governor are read from the first pinned processor
+    data.processor =
+        (unsigned int)strtoul(settings->processors->data, NULL, 10);
+  }
+
+  if (!charStringIsEmpty(settings->baselinePath)) {
+    data.baseline = _readBaseline(settings->baselinePath);
+
+    if (data.baseline == NULL) {
+      fprintf(stderr, "ERROR: Could not read baseline '%s'\n",
+              settings->baselinePath->data);
+      return -1;
+    }
+  }
+
+  governor = platformInfoGetProcessorGovernor(data.processor);
+
+  if (governor != NULL &&
+      !charStringIsEqualToCString(governor, "performance", false)) {
+    fprintf(stderr,
+            "Warning: Processor %u uses the '%s' frequency governor, so its "
+            "clock speed may change during the benchmarks.\n",
+            data.processor, governor->data);
+  }
+
+  freeCharString(governor);
+
+  data.testSuiteFilter = newCharStringWithCString(
+      settings->filter != NULL ? settings->filter->data : NULL);
+  data.benchmarkFilter = newCharString();
+  colon = strchr(data.testSuiteFilter->data, ':');
+
+  if (colon != NULL) {
+    charStringCopyCString(data.benchmarkFilter, colon + 1);
+    *colon = '\0';
+  }
+
+  data.results = newLinkedList();
+  linkedListForeach(testSuites, _runBenchmarksInSuite, &data);
+
+  if (linkedListLength(data.results) == 0) {
+    fprintf(stderr, "ERROR: No benchmarks matched '%s'\n",
+            settings->filter != NULL ? settings->filter->data : "");
+    data.numRegressions = -1;
+  } else if (!charStringIsEmpty(settings->outputPath) &&
+             !_writeResults(&data)) {
+    fprintf(stderr, "ERROR: Could not write benchmark results to '%s'\n",
+            settings->outputPath->data);
+    data.numRegressions = -1;
+  }
+
+  freeLinkedListAndItems(data.results,
+                         (LinkedListFreeItemFunc)_freeBenchmarkResult);
+  freeLinkedListAndItems(data.baseline,
+                         (LinkedListFreeItemFunc)_freeBenchmarkResult);
+  freeCharString(data.testSuiteFilter);
+  freeCharString(data.benchmarkFilter);
+  return data.numRegressions;
+}
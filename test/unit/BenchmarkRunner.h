@@ -0,0 +1,59 @@
+//
+// BenchmarkRunner.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MrsWatsonTest_BenchmarkRunner_h
+#define MrsWatsonTest_BenchmarkRunner_h
+
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+#include "unit/TestRunner.h"
+
+typedef struct {
+  // Only run the benchmarks of this suite, or a single benchmark when given
+  // as 'Suite:Name'. Empty to run all benchmarks.
+  CharString filter;
+  // Number of timed repetitions of each benchmark, which are summarized by
+  // their median and median absolute deviation
+  unsigned int repetitions;
+  // Processors to pin the benchmarks to, in the format accepted by
+  // threadSetAffinityList(). Empty to let the scheduler move them around.
+  CharString processors;
+  // Results are written here as JSON, unless this is empty
+  CharString outputPath;
+  // JSON file written by an earlier run to compare against, or empty
+  CharString baselinePath;
+} BenchmarkSettings;
+
+/**
+ * Run the benchmarks registered in a list of test suites with addBenchmark(),
+ * and print their results.
+ * @param testSuites List of TestSuite
+ * @param settings Benchmark settings
+ * @return Number of benchmarks which are significantly slower than the
+ * baseline, or -1 if the benchmarks could not be run
+ */
+int runBenchmarks(LinkedList testSuites, const BenchmarkSettings *settings);
+
+#endif
@@ -48,10 +48,16 @@ void useColoredOutput(const CharString state) {
   }
 }
 
+boolByte isColoredOutputUsed(void) { return gUseColor; }
+
 void addTestToTestSuite(TestSuite testSuite, TestCase testCase) {
   linkedListAppend(testSuite->testCases, testCase);
 }
 
+void addBenchmarkToTestSuite(TestSuite testSuite, BenchmarkCase benchmarkCase) {
+  linkedListAppend(testSuite->benchmarks, benchmarkCase);
+}
+
 const LogColor getLogColor(TestLogEventType eventType) {
   switch (eventType) {
   case kTestLogEventSection:
@@ -178,6 +184,7 @@ TestSuite newTestSuite(char *name, TestCaseSetupFunc setup,
   testSuite->numFail = 0;
   testSuite->numSkips = 0;
   testSuite->testCases = newLinkedList();
+  testSuite->benchmarks = newLinkedList();
   testSuite->setup = setup;
   testSuite->teardown = teardown;
   testSuite->onlyPrintFailing = false;
@@ -209,12 +216,31 @@ TestCase newTestCaseWithPaths(char *name, char *filename, int lineNumber,
   return testCase;
 }
 
+BenchmarkCase newBenchmarkCase(char *name, char *filename, int lineNumber,
+                               BenchmarkSetupFunc setup,
+                               BenchmarkExecFunc benchmarkFunc,
+                               BenchmarkTeardownFunc teardown) {
+  BenchmarkCase benchmarkCase =
+      (BenchmarkCase)malloc(sizeof(BenchmarkCaseMembers));
+  benchmarkCase->name = name;
+  benchmarkCase->filename = filename;
+  benchmarkCase->lineNumber = lineNumber;
+  benchmarkCase->setup = setup;
+  benchmarkCase->benchmarkFunc = benchmarkFunc;
+  benchmarkCase->teardown = teardown;
+  return benchmarkCase;
+}
+
 void freeTestCase(TestCase self) { free(self); }
 
+void freeBenchmarkCase(BenchmarkCase self) { free(self); }
+
 void freeTestSuite(TestSuite self) {
   if (self != NULL) {
     freeLinkedListAndItems(self->testCases,
                            (LinkedListFreeItemFunc)freeTestCase);
+    freeLinkedListAndItems(self->benchmarks,
+                           (LinkedListFreeItemFunc)freeBenchmarkCase);
     freeCharString(self->applicationPath);
     freeCharString(self->resourcesPath);
     free(self);
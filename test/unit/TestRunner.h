@@ -53,6 +53,7 @@ typedef enum {
 } TestLogEventType;
 
 void useColoredOutput(const CharString state);
+boolByte isColoredOutputUsed(void);
 const LogColor getLogColor(TestLogEventType eventType);
 
 typedef int (*TestCaseExecFunc)(void);
@@ -62,6 +63,12 @@ typedef int (*TestCaseExecWithPathsFunc)(const char *testName,
 typedef void (*TestCaseSetupFunc)(void);
 typedef void (*TestCaseTeardownFunc)(void);
 
+// Benchmark setup functions return the context which is passed to the
+// benchmark function on every iteration, and to the teardown afterwards
+typedef void *(*BenchmarkSetupFunc)(void);
+typedef void (*BenchmarkExecFunc)(void *context);
+typedef void (*BenchmarkTeardownFunc)(void *context);
+
 typedef struct {
   char *name;
   char *filename;
@@ -71,12 +78,23 @@ typedef struct {
 } TestCaseMembers;
 typedef TestCaseMembers *TestCase;
 
+typedef struct {
+  char *name;
+  char *filename;
+  int lineNumber;
+  BenchmarkSetupFunc setup;
+  BenchmarkExecFunc benchmarkFunc;
+  BenchmarkTeardownFunc teardown;
+} BenchmarkCaseMembers;
+typedef BenchmarkCaseMembers *BenchmarkCase;
+
 typedef struct {
   char *name;
   int numSuccess;
   int numFail;
   int numSkips;
   LinkedList testCases;
+  LinkedList benchmarks;
   TestCaseSetupFunc setup;
   TestCaseTeardownFunc teardown;
   boolByte onlyPrintFailing;
@@ -87,6 +105,7 @@ typedef struct {
 typedef TestSuiteMembers *TestSuite;
 
 void addTestToTestSuite(TestSuite testSuite, TestCase testCase);
+void addBenchmarkToTestSuite(TestSuite testSuite, BenchmarkCase benchmarkCase);
 void runTestSuite(void *testSuitePtr, void *extraData);
 void runTestCase(void *item, void *extraData);
 void printTestName(const char *testName);
@@ -99,8 +118,13 @@ TestCase newTestCase(char *name, char *filename, int lineNumber,
                      TestCaseExecFunc testCaseFunc);
 TestCase newTestCaseWithPaths(char *name, char *filename, int lineNumber,
                               TestCaseExecWithPathsFunc testCaseFunc);
+BenchmarkCase newBenchmarkCase(char *name, char *filename, int lineNumber,
+                               BenchmarkSetupFunc setup,
+                               BenchmarkExecFunc benchmarkFunc,
+                               BenchmarkTeardownFunc teardown);
 
 void freeTestCase(TestCase self);
+void freeBenchmarkCase(BenchmarkCase self);
 void freeTestSuite(TestSuite self);
 
 #if __clang__
@@ -142,6 +166,23 @@ static const char *_getFileBasename(const char *filename) {
         newTestCaseWithPaths(name, __FILE__, __LINE__, testCaseFunc));         \
   }
 
+// Benchmarks are run with mrswatsontest --benchmark. The benchmark function is
+// called once per iteration, so it should do one small unit of work, such as
+// processing a single block.
+#define addBenchmark(testSuite, name, benchmarkFunc)                           \
+  {                                                                            \
+    addBenchmarkToTestSuite(testSuite,                                         \
+                            newBenchmarkCase(name, __FILE__, __LINE__, NULL,   \
+                                             benchmarkFunc, NULL));            \
+  }
+
+#define addBenchmarkWithSetup(testSuite, name, setup, benchmarkFunc, teardown) \
+  {                                                                            \
+    addBenchmarkToTestSuite(testSuite,                                         \
+                            newBenchmarkCase(name, __FILE__, __LINE__, setup,  \
+                                             benchmarkFunc, teardown));        \
+  }
+
 #define assert(_result)                                                        \
   {                                                                            \
     if (!(_result)) {                                                          \
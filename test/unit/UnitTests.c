@@ -30,24 +30,84 @@
 
 #include <stdlib.h>
 
+extern TestSuite addAudioAnalysisTests(void);
 extern TestSuite addAudioClockTests(void);
 extern TestSuite addAudioSettingsTests(void);
 extern TestSuite addCharStringTests(void);
 extern TestSuite addEndianTests(void);
+extern TestSuite addFftTests(void);
 extern TestSuite addFileTests(void);
+extern TestSuite addFpuStateTests(void);
+extern TestSuite addIoRingTests(void);
+extern TestSuite addLatencyHistogramTests(void);
+extern TestSuite addPerfCountersTests(void);
+extern TestSuite addRealtimeSchedulerTests(void);
+extern TestSuite addStreamSchedulerTests(void);
 extern TestSuite addLinkedListTests(void);
+extern TestSuite addControlServerTests(void);
+extern TestSuite addLiveMetricsTests(void);
+extern TestSuite addLoudnessMeterTests(void);
+extern TestSuite addLogSinkTests(void);
+extern TestSuite addMappedFileTests(void);
+extern TestSuite addMemoryArenaTests(void);
+extern TestSuite addMemoryLockTests(void);
+extern TestSuite addMemoryUsageTests(void);
 extern TestSuite addMidiSequenceTests(void);
 extern TestSuite addMidiSourceTests(void);
+extern TestSuite addNoteRenderCacheTests(void);
+extern TestSuite addOutputHashesTests(void);
 extern TestSuite addPcmSampleBufferTests(void);
 extern TestSuite addPlatformInfoTests(void);
 extern TestSuite addPluginTests(void);
+extern TestSuite addPluginAutomationTests(void);
+extern TestSuite addPluginCapabilitiesTests(void);
 extern TestSuite addPluginChainTests(void);
+extern TestSuite addPluginChainPoolTests(void);
+extern TestSuite addPluginControlTests(void);
+extern TestSuite addPluginConvolverTests(void);
+extern TestSuite addPluginDegraderTests(void);
+extern TestSuite addPluginIdlerTests(void);
+extern TestSuite addPluginIndexTests(void);
 extern TestSuite addPluginPresetTests(void);
+extern TestSuite addPluginPresetCacheTests(void);
+extern TestSuite addPluginProbeTests(void);
+extern TestSuite addPluginScannerTests(void);
+extern TestSuite addPluginLatencyTests(void);
+extern TestSuite addPluginSineTests(void);
+extern TestSuite addPluginTruePeakLimiterTests(void);
 extern TestSuite addPluginVst2xIdTests(void);
+extern TestSuite addPluginWatchdogTests(void);
+extern TestSuite addProcessTests(void);
 extern TestSuite addProgramOptionTests(void);
+extern TestSuite addRealtimeAuditTests(void);
+extern TestSuite addRenderCacheTests(void);
+extern TestSuite addRenderCheckpointTests(void);
+extern TestSuite addRenderContextTests(void);
+extern TestSuite addRenderManifestTests(void);
+extern TestSuite addRenderRequestTests(void);
+extern TestSuite addRenderSegmentTests(void);
+extern TestSuite addRenderSessionTests(void);
+extern TestSuite addResamplerTests(void);
+extern TestSuite addRiffFileTests(void);
+extern TestSuite addRingBufferTests(void);
 extern TestSuite addSampleBufferTests(void);
+extern TestSuite addSampleReblockerTests(void);
+extern TestSuite addSampleRingBufferTests(void);
 extern TestSuite addSampleSourceTests(void);
+extern TestSuite addSampleSourceAsyncTests(void);
+extern TestSuite addSampleSourceCachedTests(void);
+extern TestSuite addSampleSourceSegmentTests(void);
+extern TestSuite addSampleSourceMemoryTests(void);
+extern TestSuite addSampleSourcePackedTests(void);
+extern TestSuite addSampleSourceTcpTests(void);
+extern TestSuite addSamplingProfilerTests(void);
+extern TestSuite addSharedMemoryTests(void);
+extern TestSuite addSocketTests(void);
 extern TestSuite addTaskTimerTests(void);
+extern TestSuite addThreadTests(void);
+extern TestSuite addThreadPoolTests(void);
+extern TestSuite addTraceEventsTests(void);
+extern TestSuite addXxHashTests(void);
 
 extern TestSuite addAnalysisClippingTests(void);
 extern TestSuite addAnalysisDistortionTests(void);
@@ -69,24 +129,84 @@ LinkedList getTestSuites(File mrsWatsonExePath, File resourcesPath);
 LinkedList getTestSuites(File mrsWatsonExePath, File resourcesPath) {
   LinkedList unitTestSuites = newLinkedList();
 
+  linkedListAppend(unitTestSuites, addAudioAnalysisTests());
   linkedListAppend(unitTestSuites, addAudioClockTests());
   linkedListAppend(unitTestSuites, addAudioSettingsTests());
   linkedListAppend(unitTestSuites, addCharStringTests());
   linkedListAppend(unitTestSuites, addEndianTests());
+  linkedListAppend(unitTestSuites, addFftTests());
   linkedListAppend(unitTestSuites, addFileTests());
+  linkedListAppend(unitTestSuites, addFpuStateTests());
+  linkedListAppend(unitTestSuites, addIoRingTests());
+  linkedListAppend(unitTestSuites, addLatencyHistogramTests());
+  linkedListAppend(unitTestSuites, addPerfCountersTests());
+  linkedListAppend(unitTestSuites, addRealtimeSchedulerTests());
+  linkedListAppend(unitTestSuites, addStreamSchedulerTests());
   linkedListAppend(unitTestSuites, addLinkedListTests());
+  linkedListAppend(unitTestSuites, addControlServerTests());
+  linkedListAppend(unitTestSuites, addLiveMetricsTests());
+  linkedListAppend(unitTestSuites, addLoudnessMeterTests());
+  linkedListAppend(unitTestSuites, addLogSinkTests());
+  linkedListAppend(unitTestSuites, addMappedFileTests());
+  linkedListAppend(unitTestSuites, addMemoryArenaTests());
+  linkedListAppend(unitTestSuites, addMemoryLockTests());
+  linkedListAppend(unitTestSuites, addMemoryUsageTests());
   linkedListAppend(unitTestSuites, addMidiSequenceTests());
   linkedListAppend(unitTestSuites, addMidiSourceTests());
+  linkedListAppend(unitTestSuites, addNoteRenderCacheTests());
+  linkedListAppend(unitTestSuites, addOutputHashesTests());
   linkedListAppend(unitTestSuites, addPcmSampleBufferTests());
   linkedListAppend(unitTestSuites, addPlatformInfoTests());
   linkedListAppend(unitTestSuites, addPluginTests());
+  linkedListAppend(unitTestSuites, addPluginAutomationTests());
+  linkedListAppend(unitTestSuites, addPluginCapabilitiesTests());
   linkedListAppend(unitTestSuites, addPluginChainTests());
+  linkedListAppend(unitTestSuites, addPluginChainPoolTests());
+  linkedListAppend(unitTestSuites, addPluginControlTests());
+  linkedListAppend(unitTestSuites, addPluginConvolverTests());
+  linkedListAppend(unitTestSuites, addPluginDegraderTests());
+  linkedListAppend(unitTestSuites, addPluginIdlerTests());
+  linkedListAppend(unitTestSuites, addPluginIndexTests());
   linkedListAppend(unitTestSuites, addPluginPresetTests());
+  linkedListAppend(unitTestSuites, addPluginPresetCacheTests());
+  linkedListAppend(unitTestSuites, addPluginProbeTests());
+  linkedListAppend(unitTestSuites, addPluginScannerTests());
+  linkedListAppend(unitTestSuites, addPluginLatencyTests());
+  linkedListAppend(unitTestSuites, addPluginSineTests());
+  linkedListAppend(unitTestSuites, addPluginTruePeakLimiterTests());
   linkedListAppend(unitTestSuites, addPluginVst2xIdTests());
+  linkedListAppend(unitTestSuites, addPluginWatchdogTests());
+  linkedListAppend(unitTestSuites, addProcessTests());
   linkedListAppend(unitTestSuites, addProgramOptionTests());
+  linkedListAppend(unitTestSuites, addRealtimeAuditTests());
+  linkedListAppend(unitTestSuites, addRenderCacheTests());
+  linkedListAppend(unitTestSuites, addRenderCheckpointTests());
+  linkedListAppend(unitTestSuites, addRenderContextTests());
+  linkedListAppend(unitTestSuites, addRenderManifestTests());
+  linkedListAppend(unitTestSuites, addRenderRequestTests());
+  linkedListAppend(unitTestSuites, addRenderSegmentTests());
+  linkedListAppend(unitTestSuites, addRenderSessionTests());
+  linkedListAppend(unitTestSuites, addResamplerTests());
+  linkedListAppend(unitTestSuites, addRiffFileTests());
+  linkedListAppend(unitTestSuites, addRingBufferTests());
   linkedListAppend(unitTestSuites, addSampleBufferTests());
+  linkedListAppend(unitTestSuites, addSampleReblockerTests());
+  linkedListAppend(unitTestSuites, addSampleRingBufferTests());
   linkedListAppend(unitTestSuites, addSampleSourceTests());
+  linkedListAppend(unitTestSuites, addSampleSourceAsyncTests());
+  linkedListAppend(unitTestSuites, addSampleSourceCachedTests());
+  linkedListAppend(unitTestSuites, addSampleSourceSegmentTests());
+  linkedListAppend(unitTestSuites, addSampleSourceMemoryTests());
+  linkedListAppend(unitTestSuites, addSampleSourcePackedTests());
+  linkedListAppend(unitTestSuites, addSampleSourceTcpTests());
+  linkedListAppend(unitTestSuites, addSamplingProfilerTests());
+  linkedListAppend(unitTestSuites, addSharedMemoryTests());
+  linkedListAppend(unitTestSuites, addSocketTests());
   linkedListAppend(unitTestSuites, addTaskTimerTests());
+  linkedListAppend(unitTestSuites, addThreadTests());
+  linkedListAppend(unitTestSuites, addThreadPoolTests());
+  linkedListAppend(unitTestSuites, addTraceEventsTests());
+  linkedListAppend(unitTestSuites, addXxHashTests());
 
   linkedListAppend(unitTestSuites, addAnalysisClippingTests());
   linkedListAppend(unitTestSuites, addAnalysisDistortionTests());
@@ -132,8 +252,8 @@ TestCase findTestCase(TestSuite testSuite, char *testName) {
     if (iterator->item != NULL) {
       currentTestCase = (TestCase)iterator->item;
 
-      if (!strncasecmp(currentTestCase->name, testName,
-                       strlen(currentTestCase->name))) {
+      // Some test names start with the name of another test
+      if (!strcasecmp(currentTestCase->name, testName)) {
         return currentTestCase;
       }
     }